@@ -67,7 +67,7 @@ NULL		   		EQU		0
 CR					EQU		0x0D
 LF					EQU		0x0A
 
-maxSectorCount		EQU		64									; maximum sector count for readSectors
+maxSectorCount		EQU		120									; maximum sector count for readSectors (120 * 512 + 12-bit offset < 64KB)
 kSectorBytes		EQU		512									; sector size in bytes
 kBootSignature		EQU		0xAA55								; boot sector signature
 
@@ -62,7 +62,7 @@ CR					EQU		0x0D
 LF					EQU		0x0A
 
 mallocStart			EQU		0x1000								; start address of local workspace area
-maxSectorCount		EQU		64									; maximum sector count for readSectors
+maxSectorCount		EQU		120									; maximum sector count for readSectors (120 * 512 + 12-bit offset < 64KB)
 maxNodeSize			EQU		16384
 
 kSectorBytes		EQU		512									; sector size in bytes
@@ -353,6 +353,7 @@ BiosKeyboardDriverBindingStart (
   BiosKeyboardPrivate->StatusRegisterAddress      = KEYBOARD_8042_STATUS_REGISTER;
   BiosKeyboardPrivate->CommandRegisterAddress     = KEYBOARD_8042_COMMAND_REGISTER;
   BiosKeyboardPrivate->ExtendedKeyboard           = TRUE;
+  BiosKeyboardPrivate->IdlePolls                  = 0;
 
   BiosKeyboardPrivate->Queue.Front                = 0;
   BiosKeyboardPrivate->Queue.Rear                 = 0;
@@ -1069,8 +1070,11 @@ KeyboardReadKeyStrokeWorker (
   // e.g. usb keyboard driver.
   // Add a stall period can greatly increate other driver performance during the WaitForKey is recursivly invoked.
   // 1ms delay will make little impact to the thunk keyboard driver, and user can not feel the delay at all when input.
+  // No thunk is made while nothing is pending, so no delay is needed either.
   //
-  gBS->Stall (1000);
+  if (BiosKeyboardKeyPending (BiosKeyboardPrivate)) {
+    gBS->Stall (1000);
+  }
 
   OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
 
@@ -1549,8 +1553,11 @@ BiosKeyboardWaitForKey (
   // e.g. usb keyboard driver.
   // Add a stall period can greatly increate other driver performance during the WaitForKey is recursivly invoked.
   // 1ms delay will make little impact to the thunk keyboard driver, and user can not feel the delay at all when input.
+  // No thunk is made while nothing is pending, so no delay is needed either.
   //
-  gBS->Stall (1000);
+  if (BiosKeyboardKeyPending (BIOS_KEYBOARD_DEV_FROM_THIS (Context))) {
+    gBS->Stall (1000);
+  }
   //
   // Use TimerEvent callback function to check whether there's any key pressed
   //
@@ -1829,6 +1836,35 @@ CheckKeyboardConnect (
   return TRUE;
 }
 
+/**
+  Check without an INT16 thunk whether a keystroke may be waiting: either the
+  BIOS keyboard buffer in the BDA is not empty or the 8042 holds a byte for
+  INT9 to collect.
+
+  @param  BiosKeyboardPrivate  Keyboard Private Data Struture
+
+  @retval TRUE  A key may be pending, or there is no 8042 to ask.
+  @retval FALSE Nothing is pending.
+
+**/
+BOOLEAN
+BiosKeyboardKeyPending (
+  IN  BIOS_KEYBOARD_DEV     *BiosKeyboardPrivate
+  )
+{
+  UINT8          Status;
+
+  if (*((UINT16 *) (UINTN) BDA_KEYBOARD_BUFFER_HEAD) != *((UINT16 *) (UINTN) BDA_KEYBOARD_BUFFER_TAIL)) {
+    return TRUE;
+  }
+
+  //
+  // Any output byte counts, mouse data left unread would block the keyboard too
+  //
+  Status = KeyReadStatusRegister (BiosKeyboardPrivate);
+  return (BOOLEAN) (Status == 0xFF || (Status & KBC_STSREG_VIA64_OUTB) != 0);
+}
+
 /**
   Timer event handler: read a series of key stroke from 8042
   and put them into memory key buffer.
@@ -2065,12 +2101,23 @@ BiosKeyboardTimerHandler (
     Regs.H.AH = 0x01;
   }
 
+  //
+  // Skip the real mode round trip while neither the BDA nor the 8042 has
+  // anything; the periodic timer still asks INT16 now and then for BIOSes
+  // that keep keystrokes elsewhere.
+  //
+  if (!BiosKeyboardKeyPending (BiosKeyboardPrivate) &&
+      (Event == NULL || ++BiosKeyboardPrivate->IdlePolls < KEYBOARD_IDLE_THUNK_POLLS)) {
+    Regs.E.EFLAGS.Bits.ZF = 1;
+  } else {
+    BiosKeyboardPrivate->IdlePolls = 0;
 /*  BiosKeyboardPrivate->LegacyBios->Int86 (
                                      BiosKeyboardPrivate->LegacyBios,
                                      0x16,
                                      &Regs
                                      ); */
-	LegacyBiosInt86 (BiosKeyboardPrivate, 0x16, &Regs);
+    LegacyBiosInt86 (BiosKeyboardPrivate, 0x16, &Regs);
+  }
   if (Regs.E.EFLAGS.Bits.ZF != 0) {
     gBS->RestoreTPL (OldTpl);
     if ( apple_need_zero ) {
@@ -66,6 +66,13 @@ extern EFI_COMPONENT_NAME2_PROTOCOL gBiosKeyboardComponentName2;
 #define KEYBOARD_WAITFORVALUE_TIMEOUT   1000000 // 1s
 #define KEYBOARD_BAT_TIMEOUT            4000000 // 4s
 #define KEYBOARD_TIMER_INTERVAL         200000  // 0.02s
+#define KEYBOARD_IDLE_THUNK_POLLS       5       // INT16 at least every 0.1s when nothing looks pending
+
+//
+// BDA keyboard buffer head and tail pointers, filled by the BIOS INT9 handler
+//
+#define BDA_KEYBOARD_BUFFER_HEAD        0x41A
+#define BDA_KEYBOARD_BUFFER_TAIL        0x41C
 //  KEYBOARD COMMAND BYTE -- read by writing command KBC_CMDREG_VIA64_CMDBYTE_R to 64H, then read from 60H
 //                           write by wrting command KBC_CMDREG_VIA64_CMDBYTE_W to 64H, then write to  60H
 //  7: Reserved
@@ -228,6 +235,7 @@ typedef struct {
 	UINT16                                      StatusRegisterAddress;
 	UINT16                                      CommandRegisterAddress;
 	BOOLEAN                                     ExtendedKeyboard;
+	UINTN                                       IdlePolls;
 	
 	//
 	// Buffer storing EFI_KEY_DATA
@@ -552,6 +560,22 @@ CheckKeyboardConnect (
   IN  BIOS_KEYBOARD_DEV     *BiosKeyboardPrivate
   );
 
+/**
+  Check without an INT16 thunk whether a keystroke may be waiting: either the
+  BIOS keyboard buffer in the BDA is not empty or the 8042 holds a byte for
+  INT9 to collect.
+
+  @param  BiosKeyboardPrivate  Keyboard Private Data Struture
+
+  @retval TRUE  A key may be pending, or there is no 8042 to ask.
+  @retval FALSE Nothing is pending.
+
+**/
+BOOLEAN
+BiosKeyboardKeyPending (
+  IN  BIOS_KEYBOARD_DEV     *BiosKeyboardPrivate
+  );
+
 /**
   Timer event handler: read a series of key stroke from 8042
   and put them into memory key buffer. 
@@ -2374,7 +2374,9 @@ BiosVideoGraphicsOutputSetMode (
 #endif
 /**
 
-  Update physical frame buffer, copy 4 bytes block, then copy remaining bytes.
+  Update physical frame buffer. The linear frame buffer is identity mapped, so the line is
+  copied with plain stores in one run instead of element by element through PciIo->Mem.Write.
+  These are write-combined when the frame buffer is WC.
 
 
   @param PciIo           - The pointer of EFI_PCI_IO_PROTOCOL
@@ -2402,90 +2404,151 @@ CopyVideoBuffer (
   )
 {
   UINTN                 FrameBufferAddr;
-  UINTN                 CopyBlockNum;
-  UINTN                 RemainingBytes;
-  UINTN                 UnalignedBytes;
-  EFI_STATUS            Status;
 
   FrameBufferAddr = (UINTN) MemAddress + (DestinationY * BytesPerScanLine) + DestinationX * VbePixelWidth;
+  CopyMem ((VOID *) FrameBufferAddr, VbeBuffer, TotalBytes);
+}
 
-  //
-  // If TotalBytes is less than 4 bytes, only start byte copy.
-  //
-  if (TotalBytes < 4) {
-    Status = PciIo->Mem.Write (
-                     PciIo,
-                     EfiPciIoWidthUint8,
-                     EFI_PCI_IO_PASS_THROUGH_BAR,
-                     (UINT64) FrameBufferAddr,
-                     TotalBytes,
-                     VbeBuffer
-                     );
-//    ASSERT_EFI_ERROR(Status);
+/**
+
+  Convert a line of Blt pixels to the VBE pixel format.
+  BGRX 32-bit lines are a copy, BGR 24-bit lines are packed 4 pixels to 3 dwords,
+  other layouts go pixel by pixel through the color masks.
+
+
+  @param Mode            - Current VBE mode
+  @param Blt             - First Blt pixel of the line
+  @param VbeBuffer       - Where the line goes in the VBE layout
+  @param Width           - Pixels in the line
+
+  @return None.
+
+**/
+STATIC
+VOID
+BltLineToVbe (
+  IN  BIOS_VIDEO_MODE_DATA           *Mode,
+  IN  EFI_GRAPHICS_OUTPUT_BLT_PIXEL  *Blt,
+  OUT UINT8                          *VbeBuffer,
+  IN  UINTN                          Width
+  )
+{
+  UINT32                         *Src;
+  UINT32                         *Dst;
+  UINT32                         Pixel;
+  UINTN                          Index;
+
+  if (Mode->PixelFormat == PixelBlueGreenRedReserved8BitPerColor) {
+    CopyMem (VbeBuffer, Blt, Width * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
     return;
   }
 
-  //
-  // If VbeBuffer is not 4-byte aligned, start byte copy.
-  //
-  UnalignedBytes  = (4 - ((UINTN) VbeBuffer & 0x3)) & 0x3;
+  if (Mode->BitsPerPixel == 24 &&
+      Mode->Blue.Position == 0 && Mode->Green.Position == 8 && Mode->Red.Position == 16 &&
+      Mode->Blue.Mask == 0xff && Mode->Green.Mask == 0xff && Mode->Red.Mask == 0xff) {
+    Src = (UINT32 *) Blt;
+    Dst = (UINT32 *) VbeBuffer;
+    for (Index = 0; Index + 4 <= Width; Index += 4) {
+      Dst[0] = (Src[0] & 0x00ffffff) | (Src[1] << 24);
+      Dst[1] = ((Src[1] >> 8) & 0x0000ffff) | (Src[2] << 16);
+      Dst[2] = ((Src[2] >> 16) & 0x000000ff) | (Src[3] << 8);
+      Src += 4;
+      Dst += 3;
+    }
+    VbeBuffer = (UINT8 *) Dst;
+    for (; Index < Width; Index++) {
+      VbeBuffer[0] = (UINT8) *Src;
+      VbeBuffer[1] = (UINT8) (*Src >> 8);
+      VbeBuffer[2] = (UINT8) (*Src >> 16);
+      Src++;
+      VbeBuffer += 3;
+    }
+    return;
+  }
 
-  if (UnalignedBytes != 0) {
-    Status = PciIo->Mem.Write (
-                     PciIo,
-                     EfiPciIoWidthUint8,
-                     EFI_PCI_IO_PASS_THROUGH_BAR,
-                     (UINT64) FrameBufferAddr,
-                     UnalignedBytes,
-                     VbeBuffer
-                     );
-//    ASSERT_EFI_ERROR(Status);
-	  if (EFI_ERROR(Status)) {
-		  return;
-	  }
-    FrameBufferAddr += UnalignedBytes;
-    VbeBuffer       += UnalignedBytes;
+  for (Index = 0; Index < Width; Index++) {
+    //
+    // Shuffle the RGB fields in EFI_GRAPHICS_OUTPUT_BLT_PIXEL to match the hardware buffer
+    //
+    Pixel = ((Blt->Red & Mode->Red.Mask) << Mode->Red.Position) |
+      ((Blt->Green & Mode->Green.Mask) << Mode->Green.Position) |
+        ((Blt->Blue & Mode->Blue.Mask) << Mode->Blue.Position);
+    CopyMem (VbeBuffer, &Pixel, Mode->BitsPerPixel / 8);
+    Blt++;
+    VbeBuffer += Mode->BitsPerPixel / 8;
   }
+}
 
-  //
-  // Calculate 4-byte block count and remaining bytes.
-  //
-  CopyBlockNum   = (TotalBytes - UnalignedBytes) >> 2;
-  RemainingBytes = (TotalBytes - UnalignedBytes) &  3;
+/**
 
-  //
-  // Copy 4-byte block and remaining bytes to physical frame buffer.
-  //
-  if (CopyBlockNum != 0) {
-    Status = PciIo->Mem.Write (
-                    PciIo,
-                    EfiPciIoWidthUint32,
-                    EFI_PCI_IO_PASS_THROUGH_BAR,
-                    (UINT64) FrameBufferAddr,
-                    CopyBlockNum,
-                    VbeBuffer
-                    );
-//    ASSERT_EFI_ERROR(Status);
-	  if (EFI_ERROR(Status)) {
-		  return;
-	  }
+  Convert a line of VBE pixels to Blt pixels, the reverse of BltLineToVbe().
+
+
+  @param Mode            - Current VBE mode
+  @param VbeBuffer       - First VBE pixel of the line
+  @param Blt             - Where the line goes as Blt pixels
+  @param Width           - Pixels in the line
+
+  @return None.
+
+**/
+STATIC
+VOID
+VbeLineToBlt (
+  IN  BIOS_VIDEO_MODE_DATA           *Mode,
+  IN  UINT8                          *VbeBuffer,
+  OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL  *Blt,
+  IN  UINTN                          Width
+  )
+{
+  UINT32                         *Src;
+  UINT32                         *Dst;
+  UINT32                         Pixel;
+  UINTN                          Index;
+
+  if (Mode->PixelFormat == PixelBlueGreenRedReserved8BitPerColor) {
+    Src = (UINT32 *) VbeBuffer;
+    Dst = (UINT32 *) Blt;
+    for (Index = 0; Index < Width; Index++) {
+      Dst[Index] = Src[Index] & 0x00ffffff;
+    }
+    return;
   }
 
-  if (RemainingBytes != 0) {
-    FrameBufferAddr += (CopyBlockNum << 2);
-    VbeBuffer       += (CopyBlockNum << 2);
-    Status = PciIo->Mem.Write (
-                    PciIo,
-                    EfiPciIoWidthUint8,
-                    EFI_PCI_IO_PASS_THROUGH_BAR,
-                    (UINT64) FrameBufferAddr,
-                    RemainingBytes,
-                    VbeBuffer
-                    );
- //   ASSERT_EFI_ERROR(Status);
-	  if (EFI_ERROR(Status)) {
-		  return;
-	  }
+  if (Mode->BitsPerPixel == 24 &&
+      Mode->Blue.Position == 0 && Mode->Green.Position == 8 && Mode->Red.Position == 16 &&
+      Mode->Blue.Mask == 0xff && Mode->Green.Mask == 0xff && Mode->Red.Mask == 0xff) {
+    Src = (UINT32 *) VbeBuffer;
+    Dst = (UINT32 *) Blt;
+    for (Index = 0; Index + 4 <= Width; Index += 4) {
+      Dst[0] = Src[0] & 0x00ffffff;
+      Dst[1] = (Src[0] >> 24) | ((Src[1] & 0x0000ffff) << 8);
+      Dst[2] = (Src[1] >> 16) | ((Src[2] & 0x000000ff) << 16);
+      Dst[3] = Src[2] >> 8;
+      Src += 3;
+      Dst += 4;
+    }
+    VbeBuffer = (UINT8 *) Src;
+    for (; Index < Width; Index++) {
+      *Dst = VbeBuffer[0] | VbeBuffer[1] << 8 | VbeBuffer[2] << 16;
+      Dst++;
+      VbeBuffer += 3;
+    }
+    return;
+  }
+
+  for (Index = 0; Index < Width; Index++) {
+    //
+    // Shuffle the packed bytes in the hardware buffer to match EFI_GRAPHICS_OUTPUT_BLT_PIXEL
+    //
+    Pixel         = 0;
+    CopyMem (&Pixel, VbeBuffer, Mode->BitsPerPixel / 8);
+    Blt->Red      = (UINT8) ((Pixel >> Mode->Red.Position) & Mode->Red.Mask);
+    Blt->Blue     = (UINT8) ((Pixel >> Mode->Blue.Position) & Mode->Blue.Mask);
+    Blt->Green    = (UINT8) ((Pixel >> Mode->Green.Position) & Mode->Green.Mask);
+    Blt->Reserved = 0;
+    Blt++;
+    VbeBuffer += Mode->BitsPerPixel / 8;
   }
 }
 
@@ -2536,7 +2599,6 @@ BiosVideoGraphicsOutputVbeBlt (
   EFI_TPL                        OriginalTPL;
   UINTN                          DstY;
   UINTN                          SrcY;
-  UINTN                          DstX;
   EFI_GRAPHICS_OUTPUT_BLT_PIXEL  *Blt;
   VOID                           *MemAddress;
   EFI_GRAPHICS_OUTPUT_BLT_PIXEL  *VbeFrameBuffer;
@@ -2546,7 +2608,6 @@ BiosVideoGraphicsOutputVbeBlt (
   UINT8                          *VbeBuffer1;
   UINT8                          *BltUint8;
   UINT32                         VbePixelWidth;
-  UINT32                         Pixel;
   UINTN                          TotalBytes;
 
   if (This == NULL || ((UINTN) BltOperation) >= EfiGraphicsOutputBltOperationMax) {
@@ -2614,20 +2675,8 @@ BiosVideoGraphicsOutputVbeBlt (
   case EfiBltVideoToBltBuffer:
     for (SrcY = SourceY, DstY = DestinationY; DstY < (Height + DestinationY); SrcY++, DstY++) {
       Blt = (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *) (BltUint8 + DstY * Delta + DestinationX * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
-      //
-      // Shuffle the packed bytes in the hardware buffer to match EFI_GRAPHICS_OUTPUT_BLT_PIXEL
-      //
       VbeBuffer = ((UINT8 *) VbeFrameBuffer + (SrcY * BytesPerScanLine + SourceX * VbePixelWidth));
-      for (DstX = DestinationX; DstX < (Width + DestinationX); DstX++) {
-        Pixel         = VbeBuffer[0] | VbeBuffer[1] << 8 | VbeBuffer[2] << 16 | VbeBuffer[3] << 24;
-        Blt->Red      = (UINT8) ((Pixel >> Mode->Red.Position) & Mode->Red.Mask);
-        Blt->Blue     = (UINT8) ((Pixel >> Mode->Blue.Position) & Mode->Blue.Mask);
-        Blt->Green    = (UINT8) ((Pixel >> Mode->Green.Position) & Mode->Green.Mask);
-        Blt->Reserved = 0;
-        Blt++;
-        VbeBuffer += VbePixelWidth;
-      }
-
+      VbeLineToBlt (Mode, VbeBuffer, Blt, Width);
     }
     break;
 
@@ -2669,24 +2718,13 @@ BiosVideoGraphicsOutputVbeBlt (
   case EfiBltVideoFill:
     VbeBuffer = (UINT8 *) ((UINTN) VbeFrameBuffer + (DestinationY * BytesPerScanLine) + DestinationX * VbePixelWidth);
     Blt       = (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *) BltUint8;
-    //
-    // Shuffle the RGB fields in EFI_GRAPHICS_OUTPUT_BLT_PIXEL to match the hardware buffer
-    //
-    Pixel = ((Blt->Red & Mode->Red.Mask) << Mode->Red.Position) |
-      (
-        (Blt->Green & Mode->Green.Mask) <<
-        Mode->Green.Position
-      ) |
-          ((Blt->Blue & Mode->Blue.Mask) << Mode->Blue.Position);
-
-    for (Index = 0; Index < Width; Index++) {
- /*     CopyMem(
-            VbeBuffer,
-            &Pixel,
-            VbePixelWidth
-            ); */
-		*(UINT32*)VbeBuffer = Pixel;
-      VbeBuffer += VbePixelWidth;
+    if (Mode->PixelFormat == PixelBlueGreenRedReserved8BitPerColor) {
+      SetMem32 (VbeBuffer, TotalBytes, *(UINT32 *) Blt);
+    } else {
+      for (Index = 0; Index < Width; Index++) {
+        BltLineToVbe (Mode, Blt, VbeBuffer, 1);
+        VbeBuffer += VbePixelWidth;
+      }
     }
 
     VbeBuffer = (UINT8 *) ((UINTN) VbeFrameBuffer + (DestinationY * BytesPerScanLine) + DestinationX * VbePixelWidth);
@@ -2718,24 +2756,7 @@ BiosVideoGraphicsOutputVbeBlt (
     for (SrcY = SourceY, DstY = DestinationY; SrcY < (Height + SourceY); SrcY++, DstY++) {
       Blt       = (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *) (BltUint8 + (SrcY * Delta) + (SourceX) * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
       VbeBuffer = ((UINT8 *) VbeFrameBuffer + (DstY * BytesPerScanLine + DestinationX * VbePixelWidth));
-      for (DstX = DestinationX; DstX < (Width + DestinationX); DstX++) {
-        //
-        // Shuffle the RGB fields in EFI_GRAPHICS_OUTPUT_BLT_PIXEL to match the hardware buffer
-        //
-        Pixel = ((Blt->Red & Mode->Red.Mask) << Mode->Red.Position) |
-          ((Blt->Green & Mode->Green.Mask) << Mode->Green.Position) |
-            ((Blt->Blue & Mode->Blue.Mask) << Mode->Blue.Position);
-  /*      CopyMem(
-              VbeBuffer,
-              &Pixel,
-              VbePixelWidth
-              ); */
-		  *(UINT32*)VbeBuffer = Pixel; //I think vbebuffer is always 4bytes aligned
-        Blt++;
-        VbeBuffer += VbePixelWidth;
-      }
-
-      VbeBuffer = ((UINT8 *) VbeFrameBuffer + (DstY * BytesPerScanLine + DestinationX * VbePixelWidth));
+      BltLineToVbe (Mode, Blt, VbeBuffer, Width);
 
       //
       // Update physical frame buffer.
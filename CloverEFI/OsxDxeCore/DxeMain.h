@@ -411,6 +411,27 @@ CoreTimerTick (
   );
 
 
+/**
+  Switches the timer to tickless operation. Called once the Timer
+  Architectural Protocol is available.
+
+**/
+VOID
+CoreStartTicklessTimer (
+  VOID
+  );
+
+
+/**
+  Leaves tickless operation before the timer is disabled.
+
+**/
+VOID
+CoreStopTicklessTimer (
+  VOID
+  );
+
+
 /**
   Initialize the dispatcher. Initialize the notification function that runs when
   an FV2 protocol is added to the system.
@@ -769,6 +769,7 @@ CoreExitBootServices (
   //
   // Disable Timer
   //
+  CoreStopTicklessTimer ();
   gTimer->SetTimerPeriod (gTimer, 0);
 
   //
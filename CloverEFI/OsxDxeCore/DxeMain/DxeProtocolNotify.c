@@ -157,6 +157,7 @@ GenericProtocolNotify (
     // Register the Core timer tick handler with the Timer AP
     //
     gTimer->RegisterHandler (gTimer, CoreTimerTick);
+    CoreStartTicklessTimer ();
   }
 
   if (CompareGuid (Entry->ProtocolGuid, &gEfiRuntimeArchProtocolGuid)) {
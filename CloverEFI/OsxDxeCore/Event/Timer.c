@@ -27,6 +27,21 @@ EFI_EVENT        mEfiCheckTimerEvent = NULL;
 EFI_LOCK         mEfiSystemTimeLock = EFI_INITIALIZE_LOCK_VARIABLE (TPL_HIGH_LEVEL);
 UINT64           mEfiSystemTime = 0;
 
+//
+// Tickless operation: the timer is reprogrammed on each tick for the next due
+// timer event, in multiples of the period the timer driver started with.
+// The ACPI PM timer covers the part of a tick that elapsed when an earlier
+// event forces the timer to be rearmed before its interrupt.
+//
+#define TIMER_TICKLESS_MAX_PERIOD   500000
+#define TIMER_COALESCE_MAX_SLACK    50000
+
+UINT64           mEfiTimerBasePeriod = 0;
+UINT64           mEfiTimerPeriod = 0;
+UINT64           mEfiTimerNextTick = 0;
+UINT64           mEfiTimerCounterStamp = 0;
+UINT64           mEfiTimerCounterMask = 0;
+
 //
 // Timer functions
 //
@@ -35,14 +50,18 @@ UINT64           mEfiSystemTime = 0;
 
   @param  Event                  Points to the internal structure of timer event
                                  to be installed
+  @param  Slack                  How much later than its trigger time the event
+                                 may be signaled to share another timer's wakeup
 
 **/
 VOID
 CoreInsertEventTimer (
-  IN IEVENT   *Event
+  IN IEVENT   *Event,
+  IN UINT64   Slack
   )
 {
   UINT64          TriggerTime;
+  UINT64          Limit;
   LIST_ENTRY      *Link;
   IEVENT          *Event2;
 
@@ -52,6 +71,7 @@ CoreInsertEventTimer (
   // Get the timer's trigger time
   //
   TriggerTime = Event->Timer.TriggerTime;
+  Limit = TriggerTime + Slack;
 
   //
   // Insert the timer into the timer database in assending sorted order
@@ -60,13 +80,75 @@ CoreInsertEventTimer (
     Event2 = CR (Link, IEVENT, Timer.Link, EVENT_SIGNATURE);
 
     if (Event2->Timer.TriggerTime > TriggerTime) {
-      break;
+      if (Event2->Timer.TriggerTime > Limit) {
+        break;
+      }
+      //
+      // Close enough to a queued deadline, fire together with it
+      //
+      TriggerTime = Limit = Event2->Timer.TriggerTime;
     }
   }
 
+  Event->Timer.TriggerTime = TriggerTime;
   InsertTailList (Link, &Event->Timer.Link);
 }
 
+/**
+  Returns the time elapsed since the last timer tick, as measured by the
+  performance counter.
+
+  @return The elapsed time in 100ns units, at most the current timer period
+
+**/
+UINT64
+CoreTimerElapsedSinceTick (
+  VOID
+  )
+{
+  UINT64          Elapsed;
+
+  Elapsed = (GetPerformanceCounter () - mEfiTimerCounterStamp) & mEfiTimerCounterMask;
+  Elapsed = DivU64x32 (GetTimeInNanoSecond (Elapsed), 100);
+
+  return MIN (Elapsed, mEfiTimerPeriod);
+}
+
+/**
+  Brings the next timer interrupt forward when a timer event is queued with
+  a trigger time before it, while the timer is programmed for a long period.
+
+  @param  TriggerTime            The trigger time of the new timer event
+
+**/
+VOID
+CoreRearmTimer (
+  IN UINT64   TriggerTime
+  )
+{
+  UINT64          Elapsed;
+
+  CoreAcquireLock (&mEfiSystemTimeLock);
+
+  if (mEfiTimerBasePeriod != 0 &&
+      mEfiTimerPeriod > mEfiTimerBasePeriod &&
+      TriggerTime < mEfiTimerNextTick) {
+    Elapsed = CoreTimerElapsedSinceTick ();
+    if (mEfiSystemTime + Elapsed + mEfiTimerBasePeriod < mEfiTimerNextTick) {
+      //
+      // Reprogramming restarts the count, account for the part already run
+      //
+      mEfiSystemTime += Elapsed;
+      mEfiTimerCounterStamp = GetPerformanceCounter ();
+      mEfiTimerPeriod = mEfiTimerBasePeriod;
+      mEfiTimerNextTick = mEfiSystemTime + mEfiTimerPeriod;
+      gTimer->SetTimerPeriod (gTimer, mEfiTimerPeriod);
+    }
+  }
+
+  CoreReleaseLock (&mEfiSystemTimeLock);
+}
+
 /**
   Returns the current system time.
 
@@ -154,10 +236,10 @@ CoreCheckTimers (
         //
         // Add the timer
         //
-        CoreInsertEventTimer (Event);
+        CoreInsertEventTimer (Event, 0);
       } else {
         Event->Timer.TriggerTime = SystemTime;
-        CoreInsertEventTimer (Event);
+        CoreInsertEventTimer (Event, 0);
         break;
       }
     }
@@ -193,6 +275,55 @@ CoreInitializeTimer (
 }
 
 
+/**
+  Switches the timer to tickless operation. Called once the Timer
+  Architectural Protocol is available. Without a performance counter the
+  timer keeps its fixed period.
+
+**/
+VOID
+CoreStartTicklessTimer (
+  VOID
+  )
+{
+  UINT64      Period;
+  UINT64      StartValue;
+  UINT64      EndValue;
+
+  Period = 0;
+  gTimer->GetTimerPeriod (gTimer, &Period);
+  if (Period == 0 ||
+      GetPerformanceCounterProperties (&StartValue, &EndValue) == 0 ||
+      StartValue > EndValue) {
+    return;
+  }
+
+  CoreAcquireLock (&mEfiSystemTimeLock);
+  mEfiTimerCounterMask = EndValue;
+  mEfiTimerCounterStamp = GetPerformanceCounter ();
+  mEfiTimerPeriod = Period;
+  mEfiTimerNextTick = mEfiSystemTime + Period;
+  mEfiTimerBasePeriod = Period;
+  CoreReleaseLock (&mEfiSystemTimeLock);
+}
+
+
+/**
+  Leaves tickless operation, so that a timer disabled by the caller is not
+  reprogrammed by a later tick.
+
+**/
+VOID
+CoreStopTicklessTimer (
+  VOID
+  )
+{
+  CoreAcquireLock (&mEfiSystemTimeLock);
+  mEfiTimerBasePeriod = 0;
+  CoreReleaseLock (&mEfiSystemTimeLock);
+}
+
+
 /**
   Called by the platform code to process a tick.
 
@@ -207,6 +338,7 @@ CoreTimerTick (
   )
 {
   IEVENT          *Event;
+  UINT64          Period;
 
   //
   // Check runtiem flag in case there are ticks while exiting boot services
@@ -230,6 +362,32 @@ CoreTimerTick (
     }
   }
 
+  //
+  // Program the next interrupt for the first due timer event, rounded down
+  // to whole base periods
+  //
+  if (mEfiTimerBasePeriod != 0) {
+    mEfiTimerCounterStamp = GetPerformanceCounter ();
+    Period = TIMER_TICKLESS_MAX_PERIOD;
+    if (!IsListEmpty (&mEfiTimerList)) {
+      Event = CR (mEfiTimerList.ForwardLink, IEVENT, Timer.Link, EVENT_SIGNATURE);
+      if (Event->Timer.TriggerTime <= mEfiSystemTime) {
+        Period = 0;
+      } else if (Event->Timer.TriggerTime - mEfiSystemTime < Period) {
+        Period = Event->Timer.TriggerTime - mEfiSystemTime;
+      }
+    }
+    Period = MultU64x64 (DivU64x64Remainder (Period, mEfiTimerBasePeriod, NULL), mEfiTimerBasePeriod);
+    if (Period < mEfiTimerBasePeriod) {
+      Period = mEfiTimerBasePeriod;
+    }
+    if (Period != mEfiTimerPeriod) {
+      mEfiTimerPeriod = Period;
+      gTimer->SetTimerPeriod (gTimer, Period);
+    }
+    mEfiTimerNextTick = mEfiSystemTime + mEfiTimerPeriod;
+  }
+
   CoreReleaseLock (&mEfiSystemTimeLock);
 }
 
@@ -298,7 +456,15 @@ CoreSetTimer (
     }
 
     Event->Timer.TriggerTime = CoreCurrentSystemTime () + TriggerTime;
-    CoreInsertEventTimer (Event);
+    if (Type == TimerRelative) {
+      //
+      // One-shot timers may be delayed by up to 1/8 of their delay to share a wakeup
+      //
+      CoreInsertEventTimer (Event, MIN (RShiftU64 (TriggerTime, 3), TIMER_COALESCE_MAX_SLACK));
+    } else {
+      CoreInsertEventTimer (Event, 0);
+    }
+    CoreRearmTimer (Event->Timer.TriggerTime);
 
     if (TriggerTime == 0) {
       CoreSignalEvent (mEfiCheckTimerEvent);
@@ -18,10 +18,19 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #define POOL_FREE_SIGNATURE   SIGNATURE_32('p','f','r','0')
 typedef struct {
   UINT32          Signature;
-  UINT32          Index;
+  UINT32          Size;
   LIST_ENTRY      Link;
 } POOL_FREE;
 
+//
+// Last bytes of a free block, so that the block after it can find it and merge with it
+//
+#define POOL_FREE_TAIL_SIGNATURE   SIGNATURE_32('p','f','t','0')
+typedef struct {
+  UINT32          Signature;
+  UINT32          Size;
+} POOL_FREE_TAIL;
+
 
 #define POOL_HEAD_SIGNATURE   SIGNATURE_32('p','h','d','0')
 typedef struct {
@@ -42,18 +51,34 @@ typedef struct {
 } POOL_TAIL;
 
 
-#define POOL_SHIFT  7
-
 #define POOL_OVERHEAD (SIZE_OF_POOL_HEAD + sizeof(POOL_TAIL))
 
 #define HEAD_TO_TAIL(a)   \
   ((POOL_TAIL *) (((CHAR8 *) (a)) + (a)->Size - sizeof(POOL_TAIL)));
 
+//
+// Blocks inside the pool pages are multiples of POOL_GRANULE, the smallest one still holds
+// a POOL_FREE and a POOL_FREE_TAIL. A pooled allocation has Head->Size equal to its block size,
+// so the POOL_TAIL ends the block. Free blocks are kept in the list of the largest size of
+// mPoolSizeTable that they hold, and an allocation takes the first block of the first non
+// empty list that is large enough, splitting off what it doesn't need.
+//
+#define POOL_GRANULE      32
+
+STATIC CONST UINT16 mPoolSizeTable[] = {
+    32,   64,   96,  128,  160,  192,  224,  256,
+   320,  384,  448,  512,  640,  768,  896, 1024,
+  1280, 1536, 1792, 2048, 2560, 3072, 3584, 4096
+};
 
-#define SIZE_TO_LIST(a)   ((a) >> POOL_SHIFT)
-#define LIST_TO_SIZE(a)   ((a+1) << POOL_SHIFT)
+#define LIST_TO_SIZE(a)   (mPoolSizeTable[a])
 
-#define MAX_POOL_LIST       SIZE_TO_LIST(DEFAULT_PAGE_ALLOCATION)
+#define MAX_POOL_LIST       (sizeof (mPoolSizeTable) / sizeof (mPoolSizeTable[0]))
+
+//
+// Larger allocations get their own pages
+//
+#define MAX_POOL_BLOCK      MIN (DEFAULT_PAGE_ALLOCATION, LIST_TO_SIZE (MAX_POOL_LIST - 1))
 
 #define MAX_POOL_SIZE     (MAX_ADDRESS - POOL_OVERHEAD)
 
@@ -66,6 +91,9 @@ typedef struct {
     INTN             Signature;
     UINTN            Used;
     EFI_MEMORY_TYPE  MemoryType;
+    UINT32           NonEmpty;            // bit n set when FreeList[n] is not empty
+    UINTN            PeakUsed;
+    UINTN            PoolPages;           // DEFAULT_PAGE_ALLOCATION blocks carved into pool
     LIST_ENTRY       FreeList[MAX_POOL_LIST];
     LIST_ENTRY       Link;
 } POOL;
@@ -81,6 +109,113 @@ POOL            mPoolHead[EfiMaxMemoryType];
 LIST_ENTRY      mPoolHeadList = INITIALIZE_LIST_HEAD_VARIABLE (mPoolHeadList);
 
 
+/**
+  Index of the smallest list whose blocks can hold Size.
+
+  @param  Size                   Block size, at most MAX_POOL_BLOCK
+
+  @return Index in mPoolSizeTable.
+
+**/
+STATIC
+UINTN
+SizeToList (
+  IN UINTN  Size
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < MAX_POOL_LIST - 1; Index++) {
+    if (LIST_TO_SIZE (Index) >= Size) {
+      break;
+    }
+  }
+  return Index;
+}
+
+
+/**
+  Index of the list a free block of Size goes to: the largest size it holds.
+
+  @param  Size                   Free block size, a multiple of POOL_GRANULE
+
+  @return Index in mPoolSizeTable.
+
+**/
+STATIC
+UINTN
+FreeSizeToList (
+  IN UINTN  Size
+  )
+{
+  UINTN  Index;
+
+  for (Index = MAX_POOL_LIST - 1; Index > 0; Index--) {
+    if (LIST_TO_SIZE (Index) <= Size) {
+      break;
+    }
+  }
+  return Index;
+}
+
+
+/**
+  Make Block a free block of Size bytes and put it on its free list.
+
+  @param  Pool                   Pool the block belongs to
+  @param  Block                  Start of the block
+  @param  Size                   Size of the block
+
+**/
+STATIC
+VOID
+PoolInsertFree (
+  IN POOL   *Pool,
+  IN VOID   *Block,
+  IN UINTN  Size
+  )
+{
+  POOL_FREE       *Free;
+  POOL_FREE_TAIL  *FreeTail;
+  UINTN           Index;
+
+  Free            = (POOL_FREE *) Block;
+  Free->Signature = POOL_FREE_SIGNATURE;
+  Free->Size      = (UINT32) Size;
+  FreeTail            = (POOL_FREE_TAIL *) ((CHAR8 *) Block + Size - sizeof (POOL_FREE_TAIL));
+  FreeTail->Signature = POOL_FREE_TAIL_SIGNATURE;
+  FreeTail->Size      = (UINT32) Size;
+
+  Index = FreeSizeToList (Size);
+  InsertHeadList (&Pool->FreeList[Index], &Free->Link);
+  Pool->NonEmpty |= 1u << Index;
+}
+
+
+/**
+  Take a free block off its free list.
+
+  @param  Pool                   Pool the block belongs to
+  @param  Free                   The free block
+
+**/
+STATIC
+VOID
+PoolRemoveFree (
+  IN POOL       *Pool,
+  IN POOL_FREE  *Free
+  )
+{
+  UINTN  Index;
+
+  Index = FreeSizeToList (Free->Size);
+  RemoveEntryList (&Free->Link);
+  if (IsListEmpty (&Pool->FreeList[Index])) {
+    Pool->NonEmpty &= ~(1u << Index);
+  }
+}
+
+
 /**
   Called to initialize the pool.
 
@@ -97,6 +232,9 @@ CoreInitializePool (
     mPoolHead[Type].Signature  = 0;
     mPoolHead[Type].Used       = 0;
     mPoolHead[Type].MemoryType = (EFI_MEMORY_TYPE) Type;
+    mPoolHead[Type].NonEmpty   = 0;
+    mPoolHead[Type].PeakUsed   = 0;
+    mPoolHead[Type].PoolPages  = 0;
     for (Index=0; Index < MAX_POOL_LIST; Index++) {
         InitializeListHead (&mPoolHead[Type].FreeList[Index]);
     }
@@ -134,6 +272,13 @@ LookupPoolHead (
     for (Link = mPoolHeadList.ForwardLink; Link != &mPoolHeadList; Link = Link->ForwardLink) {
       Pool = CR(Link, POOL, Link, POOL_SIGNATURE);
       if (Pool->MemoryType == MemoryType) {
+        //
+        // Loaders use one or two types, keep the last one first
+        //
+        if (Link != mPoolHeadList.ForwardLink) {
+          RemoveEntryList (Link);
+          InsertHeadList (&mPoolHeadList, Link);
+        }
         return Pool;
       }
     }
@@ -146,6 +291,9 @@ LookupPoolHead (
     Pool->Signature = POOL_SIGNATURE;
     Pool->Used      = 0;
     Pool->MemoryType = MemoryType;
+    Pool->NonEmpty  = 0;
+    Pool->PeakUsed  = 0;
+    Pool->PoolPages = 0;
     for (Index=0; Index < MAX_POOL_LIST; Index++) {
       InitializeListHead (&Pool->FreeList[Index]);
     }
@@ -240,12 +388,11 @@ CoreAllocatePoolI (
   POOL_FREE   *Free;
   POOL_HEAD   *Head;
   POOL_TAIL   *Tail;
-  CHAR8       *NewPage;
   VOID        *Buffer;
   UINTN       Index;
   UINTN       FSize;
-  UINTN       Offset;
   UINTN       NoPages;
+  UINT32      Lists;
 
 //  ASSERT_LOCKED (&gMemoryLock);
 
@@ -261,7 +408,6 @@ CoreAllocatePoolI (
   Size = ALIGN_VARIABLE (Size);
 
   Size += POOL_OVERHEAD;
-  Index = SIZE_TO_LIST(Size);
   Pool = LookupPoolHead (PoolType);
   if (Pool== NULL) {
     return NULL;
@@ -272,56 +418,44 @@ CoreAllocatePoolI (
   // If allocation is over max size, just allocate pages for the request
   // (slow)
   //
-  if (Index >= MAX_POOL_LIST) {
+  if (Size > MAX_POOL_BLOCK) {
     NoPages = EFI_SIZE_TO_PAGES(Size) + EFI_SIZE_TO_PAGES (DEFAULT_PAGE_ALLOCATION) - 1;
     NoPages &= ~(UINTN)(EFI_SIZE_TO_PAGES (DEFAULT_PAGE_ALLOCATION) - 1);
     Head = CoreAllocatePoolPages (PoolType, NoPages, DEFAULT_PAGE_ALLOCATION);
     goto Done;
   }
 
+  Size  = ALIGN_VALUE (Size, POOL_GRANULE);
+  Index = SizeToList (Size);
+
   //
-  // If there's no free pool in the proper list size, go get some more pages
+  // First non empty list with blocks large enough
   //
-  if (IsListEmpty (&Pool->FreeList[Index])) {
-
+  Lists = Pool->NonEmpty & ~((1u << Index) - 1);
+  if (Lists != 0) {
+    Index = (UINTN) LowBitSet32 (Lists);
+    Free  = CR (Pool->FreeList[Index].ForwardLink, POOL_FREE, Link, POOL_FREE_SIGNATURE);
+    PoolRemoveFree (Pool, Free);
+    FSize = Free->Size;
+  } else {
     //
     // Get another page
     //
-    NewPage = CoreAllocatePoolPages(PoolType, EFI_SIZE_TO_PAGES (DEFAULT_PAGE_ALLOCATION), DEFAULT_PAGE_ALLOCATION);
-    if (NewPage == NULL) {
+    Free = CoreAllocatePoolPages (PoolType, EFI_SIZE_TO_PAGES (DEFAULT_PAGE_ALLOCATION), DEFAULT_PAGE_ALLOCATION);
+    if (Free == NULL) {
       goto Done;
     }
-
-    //
-    // Carve up new page into free pool blocks
-    //
-    Offset = 0;
-    while (Offset < DEFAULT_PAGE_ALLOCATION) {
-//      ASSERT (Index < MAX_POOL_LIST);
-      FSize = LIST_TO_SIZE(Index);
-
-      while (Offset + FSize <= DEFAULT_PAGE_ALLOCATION) {
-        Free = (POOL_FREE *) &NewPage[Offset];
-        Free->Signature = POOL_FREE_SIGNATURE;
-        Free->Index     = (UINT32)Index;
-        InsertHeadList (&Pool->FreeList[Index], &Free->Link);
-        Offset += FSize;
-      }
-
-      Index -= 1;
-    }
-
-//    ASSERT (Offset == DEFAULT_PAGE_ALLOCATION);
-    Index = SIZE_TO_LIST(Size);
+    FSize = DEFAULT_PAGE_ALLOCATION;
+    Pool->PoolPages++;
   }
 
   //
-  // Remove entry from free pool list
+  // Serve the request from the head of the block, the rest stays free
   //
-  Free = CR (Pool->FreeList[Index].ForwardLink, POOL_FREE, Link, POOL_FREE_SIGNATURE);
-  RemoveEntryList (&Free->Link);
-
   Head = (POOL_HEAD *) Free;
+  if (FSize > Size) {
+    PoolInsertFree (Pool, (CHAR8 *) Head + Size, FSize - Size);
+  }
 
 Done:
   Buffer = NULL;
@@ -336,6 +470,7 @@ Done:
     Head->Type      = (EFI_MEMORY_TYPE) PoolType;
     Tail            = HEAD_TO_TAIL (Head);
     Tail->Signature = POOL_TAIL_SIGNATURE;
+    Tail->Reserved  = 0;    // may overlay the POOL_FREE_TAIL of a block that was here
     Tail->Size      = Size;
     Buffer          = Head->Data;
     DEBUG_CLEAR_MEMORY (Buffer, Size - POOL_OVERHEAD);
@@ -352,9 +487,13 @@ Done:
     // Account the allocation
     //
     Pool->Used += Size;
+    if (Pool->Used > Pool->PeakUsed) {
+      Pool->PeakUsed = Pool->Used;
+    }
 
   } else {
-    DEBUG ((DEBUG_ERROR | DEBUG_POOL, "AllocatePool: failed to allocate %ld bytes\n", (UINT64) Size));
+    DEBUG ((DEBUG_ERROR | DEBUG_POOL, "AllocatePool: failed to allocate %ld bytes, type %x used %ld peak %ld in %ld pool pages\n",
+      (UINT64) Size, PoolType, (UINT64) Pool->Used, (UINT64) Pool->PeakUsed, (UINT64) Pool->PoolPages));
   }
 
   return Buffer;
@@ -406,17 +545,15 @@ CoreFreePoolI (
   IN VOID       *Buffer
   )
 {
-  POOL        *Pool;
-  POOL_HEAD   *Head;
-  POOL_TAIL   *Tail;
-  POOL_FREE   *Free;
-  UINTN       Index;
-  UINTN       NoPages;
-  UINTN       Size;
-  CHAR8       *NewPage;
-  UINTN       FSize;
-  UINTN       Offset;
-  BOOLEAN     AllFree;
+  POOL            *Pool;
+  POOL_HEAD       *Head;
+  POOL_TAIL       *Tail;
+  POOL_FREE       *Free;
+  POOL_FREE_TAIL  *FreeTail;
+  UINTN           NoPages;
+  UINTN           Size;
+  CHAR8           *Block;
+  CHAR8           *Page;
 
 //  ASSERT(Buffer != NULL);
   if (!Buffer) {
@@ -457,16 +594,12 @@ CoreFreePoolI (
   Pool->Used -= Size;
 //  DEBUG ((DEBUG_POOL, "FreePool: %p (len %lx) %,ld\n", Head->Data, (UINT64)(Head->Size - POOL_OVERHEAD), (UINT64) Pool->Used));
 
-  //
-  // Determine the pool list
-  //
-  Index = SIZE_TO_LIST(Size);
 //  DEBUG_CLEAR_MEMORY (Head, Size);
 
   //
-  // If it's not on the list, it must be pool pages
+  // If it's not in a pool page, it must be pool pages
   //
-  if (Index >= MAX_POOL_LIST) {
+  if (Size > MAX_POOL_BLOCK) {
 
     //
     // Return the memory pages back to free memory
@@ -477,71 +610,43 @@ CoreFreePoolI (
 
   } else {
 
+    Block = (CHAR8 *) Head;
+    Page  = (CHAR8 *)((UINTN) Block & ~((UINTN) DEFAULT_PAGE_ALLOCATION - 1));
+    Head->Signature = 0;
+
     //
-    // Put the pool entry onto the free pool list
+    // Merge with the free block after this one
     //
-    Free = (POOL_FREE *) Head;
-//    ASSERT(Free != NULL);
-    Free->Signature = POOL_FREE_SIGNATURE;
-    Free->Index     = (UINT32)Index;
-    InsertHeadList (&Pool->FreeList[Index], &Free->Link);
+    if (Block + Size < Page + DEFAULT_PAGE_ALLOCATION) {
+      Free = (POOL_FREE *) (Block + Size);
+      if (Free->Signature == POOL_FREE_SIGNATURE) {
+        PoolRemoveFree (Pool, Free);
+        Free->Signature = 0;
+        Size += Free->Size;
+      }
+    }
 
     //
-    // See if all the pool entries in the same page as Free are freed pool
-    // entries
+    // and with the one before
     //
-    NewPage = (CHAR8 *)((UINTN)Free & ~((DEFAULT_PAGE_ALLOCATION) -1));
-    Free = (POOL_FREE *) &NewPage[0];
-//    ASSERT(Free != NULL);
-
-    if (Free->Signature == POOL_FREE_SIGNATURE) {
-
-      Index = Free->Index;
-
-      AllFree = TRUE;
-      Offset = 0;
-
-      while ((Offset < DEFAULT_PAGE_ALLOCATION) && (AllFree)) {
-        FSize = LIST_TO_SIZE(Index);
-        while (Offset + FSize <= DEFAULT_PAGE_ALLOCATION) {
-          Free = (POOL_FREE *) &NewPage[Offset];
-//          ASSERT(Free != NULL);
-          if (Free->Signature != POOL_FREE_SIGNATURE) {
-            AllFree = FALSE;
-          }
-          Offset += FSize;
-        }
-        Index -= 1;
+    if (Block > Page) {
+      FreeTail = (POOL_FREE_TAIL *) (Block - sizeof (POOL_FREE_TAIL));
+      if (FreeTail->Signature == POOL_FREE_TAIL_SIGNATURE) {
+        Free = (POOL_FREE *) (Block - FreeTail->Size);
+        PoolRemoveFree (Pool, Free);
+        Block = (CHAR8 *) Free;
+        Size += FreeTail->Size;
       }
+    }
 
-      if (AllFree) {
-
-        //
-        // All of the pool entries in the same page as Free are free pool
-        // entries
-        // Remove all of these pool entries from the free loop lists.
-        //
-        Free = (POOL_FREE *) &NewPage[0];
-  //      ASSERT(Free != NULL);
-        Index = Free->Index;
-        Offset = 0;
-
-        while (Offset < DEFAULT_PAGE_ALLOCATION) {
-          FSize = LIST_TO_SIZE(Index);
-          while (Offset + FSize <= DEFAULT_PAGE_ALLOCATION) {
-            Free = (POOL_FREE *) &NewPage[Offset];
- //           ASSERT(Free != NULL);
-            RemoveEntryList (&Free->Link);
-            Offset += FSize;
-          }
-          Index -= 1;
-        }
-
-        //
-        // Free the page
-        //
-        CoreFreePoolPages ((EFI_PHYSICAL_ADDRESS) (UINTN)NewPage, EFI_SIZE_TO_PAGES (DEFAULT_PAGE_ALLOCATION));
-      }
+    if (Size == DEFAULT_PAGE_ALLOCATION) {
+      //
+      // The whole page is free, give it back
+      //
+      Pool->PoolPages--;
+      CoreFreePoolPages ((EFI_PHYSICAL_ADDRESS) (UINTN) Page, EFI_SIZE_TO_PAGES (DEFAULT_PAGE_ALLOCATION));
+    } else {
+      PoolInsertFree (Pool, Block, Size);
     }
   }
 
@@ -57,6 +57,8 @@ EfiLoader (
   UINT32                ScratchSize;
   UINTN                 BfvPageNumber;
   UINTN                 BfvBase;
+  UINTN                 ScratchBuffer;
+  UINTN                 DecompressBuffer;
   EFI_MAIN_ENTRYPOINT   EfiMainEntrypoint;
 //  CHAR8                 PrintBuffer[256];
   EFILDRHANDOFF         Handoff;
@@ -115,12 +117,24 @@ EfiLoader (
   }
   
 //  PrintString ("BFV decompress: DestinationSize = %x, ScratchSize = %x\n", (UINTN) DestinationSize, (UINTN) ScratchSize);
+  BfvPageNumber = EFI_SIZE_TO_PAGES (DestinationSize);
+  BfvBase = (UINTN) FindSpace (BfvPageNumber, &NumberOfMemoryMapEntries, EfiMemoryDescriptor, EfiRuntimeServicesData, EFI_MEMORY_WB);
+  if (BfvBase == 0) {
+    SystemHang ("Failed to find free space to hold decompressed BFV\n");
+  }
+
+  //
+  // The BFV is several MB: decompress it where it stays rather than at EFI_DECOMPRESSED_BUFFER_ADDRESS
+  // and then copy it, unless that space is under the scratch buffer (very small memory).
+  //
+  ScratchBuffer = (EFI_DECOMPRESSED_BUFFER_ADDRESS + DestinationSize + 0x1000) & 0xfffff000;
+  DecompressBuffer = (BfvBase >= ScratchBuffer + ScratchSize) ? BfvBase : EFI_DECOMPRESSED_BUFFER_ADDRESS;
   Status =  LzmaUefiDecompress (
 //  Status =  UefiDecompress (
     (VOID *)(UINTN)(EFILDR_HEADER_ADDRESS + EFILDRImage->Offset),
     EFILDRImage->Length,
-    (VOID *)(UINTN)EFI_DECOMPRESSED_BUFFER_ADDRESS, 
-    (VOID *)(UINTN)((EFI_DECOMPRESSED_BUFFER_ADDRESS + DestinationSize + 0x1000) & 0xfffff000)
+    (VOID *)(UINTN)DecompressBuffer, 
+    (VOID *)(UINTN)ScratchBuffer
     );
   
 
@@ -128,13 +142,13 @@ EfiLoader (
     SystemHang ("Failed to decompress BFV!\n");
   }
 
-  BfvPageNumber = EFI_SIZE_TO_PAGES (DestinationSize);
-  BfvBase = (UINTN) FindSpace (BfvPageNumber, &NumberOfMemoryMapEntries, EfiMemoryDescriptor, EfiRuntimeServicesData, EFI_MEMORY_WB);
-  if (BfvBase == 0) {
-    SystemHang ("Failed to find free space to hold decompressed BFV\n");
+  if (DecompressBuffer != BfvBase) {
+    CopyMem((VOID *)(UINTN)BfvBase, (VOID *)(UINTN)DecompressBuffer, DestinationSize);
   }
-  ZeroMem ((VOID *)(UINTN)BfvBase, BfvPageNumber * EFI_PAGE_SIZE);
-  CopyMem((VOID *)(UINTN)BfvBase, (VOID *)(UINTN)EFI_DECOMPRESSED_BUFFER_ADDRESS, DestinationSize);
+  //
+  // only the end of the last page is left to clear
+  //
+  ZeroMem ((VOID *)(UINTN)(BfvBase + DestinationSize), BfvPageNumber * EFI_PAGE_SIZE - DestinationSize);
 
 //  PrintHeader ('B');
 
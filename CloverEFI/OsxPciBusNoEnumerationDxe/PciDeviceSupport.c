@@ -246,6 +246,72 @@ Returns:
   return EFI_NOT_FOUND;
 }
 
+VOID
+FillPciDeviceInfo (
+  IN  PCI_IO_DEVICE                  *PciIoDevice
+  )
+/*++
+
+Routine Description:
+
+  Fills the PCI_DEVICE_INFO_PROTOCOL of the device from the header read during
+  enumeration and one walk of its capability list.
+
+Arguments:
+
+  PciIoDevice   - A PCI_IO_DEVICE pointer to the PCI IO device to be registered.
+
+Returns:
+
+  None
+
+--*/
+{
+  PCI_DEVICE_INFO_PROTOCOL  *Info;
+  EFI_STATUS                Status;
+  UINT8                     Offset;
+  UINT16                    IdNext;
+  UINTN                     Loops;
+
+  Info = &PciIoDevice->DeviceInfo;
+  ZeroMem (Info, sizeof (PCI_DEVICE_INFO_PROTOCOL));
+  Info->Revision = PCI_DEVICE_INFO_PROTOCOL_REVISION;
+  Info->Segment  = PciIoDevice->PciRootBridgeIo->SegmentNumber;
+  Info->Bus      = PciIoDevice->BusNumber;
+  Info->Device   = PciIoDevice->DeviceNumber;
+  Info->Function = PciIoDevice->FunctionNumber;
+  CopyMem (&Info->Pci, &PciIoDevice->Pci, sizeof (PCI_TYPE00));
+
+  if ((PciIoDevice->Pci.Hdr.Status & EFI_PCI_STATUS_CAPABILITY) == 0) {
+    return;
+  }
+
+  if (IS_CARDBUS_BRIDGE (&PciIoDevice->Pci)) {
+    Status = PciIoDevice->PciIo.Pci.Read (&PciIoDevice->PciIo, EfiPciIoWidthUint8, EFI_PCI_CARDBUS_BRIDGE_CAPABILITY_PTR, 1, &Offset);
+    if (EFI_ERROR(Status)) {
+      return;
+    }
+  } else {
+    Offset = PciIoDevice->Pci.Device.CapabilityPtr;
+  }
+
+  //
+  // 48 entries at most fit in 0x40-0xFF, more means a loop in the list
+  //
+  Offset &= 0xFC;
+  Loops = 0;
+  while (Offset >= 0x40 && Loops++ < 48 && Info->CapCount < PCI_DEVICE_INFO_MAX_CAPS) {
+    Status = PciIoDevice->PciIo.Pci.Read (&PciIoDevice->PciIo, EfiPciIoWidthUint16, Offset, 1, &IdNext);
+    if (EFI_ERROR(Status) || (IdNext & 0xFF) == 0xFF) {
+      break;
+    }
+    Info->CapId[Info->CapCount]     = (UINT8) IdNext;
+    Info->CapOffset[Info->CapCount] = Offset;
+    Info->CapCount++;
+    Offset = (UINT8) (IdNext >> 8) & 0xFC;
+  }
+}
+
 EFI_STATUS
 RegisterPciDevice (
   IN  EFI_HANDLE                     Controller,
@@ -275,6 +341,9 @@ Returns:
 {
   EFI_STATUS          Status;
   UINT8               PciExpressCapRegOffset;
+  UINTN               Index;
+
+  FillPciDeviceInfo (PciIoDevice);
 
   //
   // Install the pciio protocol, device path protocol and 
@@ -290,6 +359,8 @@ Returns:
                   &PciIoDevice->PciIo,
                   &gEfiBusSpecificDriverOverrideProtocolGuid,
                   &PciIoDevice->PciDriverOverride,
+                  &gPciDeviceInfoProtocolGuid,
+                  &PciIoDevice->DeviceInfo,
                   NULL
                   );
   } else {
@@ -299,6 +370,8 @@ Returns:
                   PciIoDevice->DevicePath,
                   &gEfiPciIoProtocolGuid,
                   &PciIoDevice->PciIo,
+                  &gPciDeviceInfoProtocolGuid,
+                  &PciIoDevice->DeviceInfo,
                   NULL
                   );
   }
@@ -328,13 +401,24 @@ Returns:
   // Detect if PCI Express Device
   //
   PciExpressCapRegOffset = 0;
-  Status = LocateCapabilityRegBlock (
-             PciIoDevice,
-             EFI_PCI_CAPABILITY_ID_PCIEXP,
-             &PciExpressCapRegOffset,
-             NULL
-             );
-  if (!EFI_ERROR(Status)) {
+  for (Index = 0; Index < PciIoDevice->DeviceInfo.CapCount; Index++) {
+    if (PciIoDevice->DeviceInfo.CapId[Index] == EFI_PCI_CAPABILITY_ID_PCIEXP) {
+      PciExpressCapRegOffset = PciIoDevice->DeviceInfo.CapOffset[Index];
+      break;
+    }
+  }
+  if (PciExpressCapRegOffset == 0 && PciIoDevice->DeviceInfo.CapCount == PCI_DEVICE_INFO_MAX_CAPS) {
+    //
+    // The list didn't fit in DeviceInfo, walk it all
+    //
+    LocateCapabilityRegBlock (
+      PciIoDevice,
+      EFI_PCI_CAPABILITY_ID_PCIEXP,
+      &PciExpressCapRegOffset,
+      NULL
+      );
+  }
+  if (PciExpressCapRegOffset != 0) {
     PciIoDevice->IsPciExp = TRUE;
 //    DEBUG ((EFI_D_ERROR, "PciExp - %x (B-%x, D-%x, F-%x)\n", PciIoDevice->IsPciExp, PciIoDevice->BusNumber, PciIoDevice->DeviceNumber, PciIoDevice->FunctionNumber));
     DBG("PciExp - %x (B-%x, D-%x, F-%x)\n", PciIoDevice->IsPciExp, PciIoDevice->BusNumber, PciIoDevice->DeviceNumber, PciIoDevice->FunctionNumber);
@@ -449,6 +533,8 @@ Returns:
                       &PciIoDevice->PciIo,
                       &gEfiBusSpecificDriverOverrideProtocolGuid,
                       &PciIoDevice->PciDriverOverride,
+                      &gPciDeviceInfoProtocolGuid,
+                      &PciIoDevice->DeviceInfo,
                       NULL
                       );
     } else {
@@ -458,6 +544,8 @@ Returns:
                       PciIoDevice->DevicePath,
                       &gEfiPciIoProtocolGuid,
                       &PciIoDevice->PciIo,
+                      &gPciDeviceInfoProtocolGuid,
+                      &PciIoDevice->DeviceInfo,
                       NULL
                       );
     }
@@ -9,38 +9,182 @@
 #include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 #include <IOKit/IOKitLib.h>
 
-int main(int argc, char *argv[])
+// Layouts published by Clover's SetupBooterLog(), see MemLogLib.h
+#define LZSS_SIGNATURE   0x73737a6c // "lzss"
+#define PHASE_NAME_SIZE  28
+
+typedef struct {
+  uint32_t  signature;
+  uint32_t  length;
+} lzss_header_t;
+
+typedef struct {
+  uint32_t  offset;
+  char      name[PHASE_NAME_SIZE];
+} phase_t;
+
+static CFTypeRef get_property(CFStringRef name)
 {
   io_registry_entry_t root;
-  CFTypeRef bootLog = NULL;
+  CFTypeRef prop = NULL;
 
   root = IORegistryEntryFromPath(kIOMasterPortDefault, "IOService:/");
 
   if (root)
-    bootLog = IORegistryEntryCreateCFProperty(root, CFSTR("boot-log"), kCFAllocatorDefault, 0);
+    prop = IORegistryEntryCreateCFProperty(root, name, kCFAllocatorDefault, 0);
 
-  if (!bootLog)
+  if (!prop)
   {
     // Check for Clover boot log
     root = IORegistryEntryFromPath(kIOMasterPortDefault, "IODeviceTree:/efi/platform");
 
     if (root)
-      bootLog = IORegistryEntryCreateCFProperty(root, CFSTR("boot-log"), kCFAllocatorDefault, 0);
+      prop = IORegistryEntryCreateCFProperty(root, name, kCFAllocatorDefault, 0);
+  }
+
+  return prop;
+}
+
+// LZSS, N=4096, F=18, threshold 2, same as compressed kernelcaches
+static char *lzss_decode(const UInt8 *src, size_t srclen, size_t *outlen)
+{
+  const lzss_header_t *header = (const lzss_header_t *)src;
+  const UInt8 *end = src + srclen;
+  UInt8 ring[4096];
+  unsigned int flags = 0, r = 4096 - 18, i, j, k;
+  char *out, *dst;
+
+  if (srclen < sizeof(*header) || header->signature != LZSS_SIGNATURE)
+    return NULL;
+
+  out = dst = malloc(header->length + 1);
+  if (!out)
+    return NULL;
+  memset(ring, ' ', sizeof(ring));
+  src += sizeof(*header);
+
+  while (src < end && (size_t)(dst - out) < header->length)
+  {
+    if (((flags >>= 1) & 0x100) == 0)
+    {
+      flags = *src++ | 0xff00;
+      if (src >= end)
+        break;
+    }
+    if (flags & 1)
+    {
+      ring[r++ & 4095] = *dst++ = *src++;
+    }
+    else
+    {
+      if (src + 1 >= end)
+        break;
+      i = *src++;
+      j = *src++;
+      i |= (j & 0xf0) << 4;
+      j = (j & 0x0f) + 2;
+      for (k = 0; k <= j && (size_t)(dst - out) < header->length; k++)
+        ring[r++ & 4095] = *dst++ = ring[(i + k) & 4095];
+    }
+  }
+
+  *dst = '\0';
+  *outlen = dst - out;
+  return out;
+}
+
+static void usage(void)
+{
+  printf("Usage: bdmesg [-o offset | -p phase | -l]\n"
+         "  -o: print from log offset\n"
+         "  -p: print one phase\n"
+         "  -l: list phases with their offsets\n");
+}
+
+int main(int argc, char *argv[])
+{
+  CFTypeRef bootLog = NULL;
+  CFTypeRef phasesProp = NULL;
+  const phase_t *phases = NULL;
+  size_t phaseCount = 0, i;
+  size_t offset = 0, length = 0, logLength;
+  const char *phase = NULL;
+  int list = 0, opt;
+  char *msglog = NULL;
+
+  while ((opt = getopt(argc, argv, "o:p:l")) != -1)
+  {
+    switch (opt)
+    {
+      case 'o': offset = strtoul(optarg, NULL, 0); break;
+      case 'p': phase = optarg; break;
+      case 'l': list = 1; break;
+      default: usage(); return 1;
+    }
+  }
+
+  phasesProp = get_property(CFSTR("boot-log-phases"));
+  if (phasesProp)
+  {
+    phases = (const phase_t *)CFDataGetBytePtr((CFDataRef)phasesProp);
+    phaseCount = CFDataGetLength((CFDataRef)phasesProp) / sizeof(phase_t);
   }
 
-  if (!bootLog)
+  if (list)
   {
-    printf("\"boot-log\" property not found.\n");
+    for (i = 0; i < phaseCount; i++)
+      printf("%8u  %.*s\n", phases[i].offset, PHASE_NAME_SIZE, phases[i].name);
     return 0;
   }
 
-  const UInt8 *msglog = CFDataGetBytePtr((CFDataRef)bootLog);
+  if (phase)
+  {
+    for (i = 0; i < phaseCount; i++)
+      if (strncmp(phases[i].name, phase, PHASE_NAME_SIZE - 1) == 0)
+        break;
+    if (i == phaseCount)
+    {
+      printf("Phase \"%s\" not found, -l lists them.\n", phase);
+      return 1;
+    }
+    offset = phases[i].offset;
+    if (i + 1 < phaseCount)
+      length = phases[i + 1].offset - offset;
+  }
+
+  // The compressed log is complete, the plain one may be cut
+  bootLog = get_property(CFSTR("boot-log-lzss"));
+  if (bootLog)
+    msglog = lzss_decode(CFDataGetBytePtr((CFDataRef)bootLog), CFDataGetLength((CFDataRef)bootLog), &logLength);
+
+  if (!msglog)
+  {
+    bootLog = get_property(CFSTR("boot-log"));
+    if (!bootLog)
+    {
+      printf("\"boot-log\" property not found.\n");
+      return 0;
+    }
+    logLength = CFDataGetLength((CFDataRef)bootLog);
+    msglog = malloc(logLength + 1);
+    if (!msglog)
+      return 1;
+    memcpy(msglog, CFDataGetBytePtr((CFDataRef)bootLog), logLength);
+    msglog[logLength] = '\0';
+    logLength = strlen(msglog);
+  }
+
+  if (offset < logLength)
+  {
+    if (!length || length > logLength - offset)
+      length = logLength - offset;
+    printf("%.*s\n", (int)length, msglog + offset);
+  }
 
-  if (msglog)
-    printf("%s\n", msglog);
-  
+  free(msglog);
   return 0;
 }
@@ -534,8 +534,10 @@ AhciBuildCommand (
   UINTN      MemAddr;
   DATA_64    Data64;
   UINT32     Offset;
+  EFI_AHCI_COMMAND_TABLE *CommandTable;
 
   if (!PciIo) return;
+  CommandTable = &AhciRegisters->AhciCommandTable[CommandSlotNumber];
   //
   // Filling the PRDT
   // Note: DataLength is at most 2^25
@@ -560,14 +562,14 @@ AhciBuildCommand (
 
   CommandFis->AhciCFisPmNum = PortMultiplier;
 
-  CopyMem(&AhciRegisters->AhciCommandTable->CommandFis, CommandFis, sizeof (EFI_AHCI_COMMAND_FIS));
+  CopyMem(&CommandTable->CommandFis, CommandFis, sizeof (EFI_AHCI_COMMAND_FIS));
 
-  ZeroMem (&AhciRegisters->AhciCommandTable->AtapiCmd, 0x40U + (PrdtNumber << 4));
+  ZeroMem (&CommandTable->AtapiCmd, 0x40U + (PrdtNumber << 4));
 
   Offset = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_CMD;
   if (AtapiCommand != NULL) {
     CopyMem(
-      &AhciRegisters->AhciCommandTable->AtapiCmd,
+      &CommandTable->AtapiCmd,
       AtapiCommand,
       AtapiCommandLength
       );
@@ -589,14 +591,14 @@ AhciBuildCommand (
 
   for (PrdtIndex = 0; PrdtIndex < PrdtNumber; PrdtIndex++) {
     if (RemainedData < EFI_AHCI_MAX_DATA_PER_PRDT) {
-      AhciRegisters->AhciCommandTable->PrdtTable[PrdtIndex].AhciPrdtDbc = (UINT32)RemainedData - 1;
+      CommandTable->PrdtTable[PrdtIndex].AhciPrdtDbc = (UINT32)RemainedData - 1;
     } else {
-      AhciRegisters->AhciCommandTable->PrdtTable[PrdtIndex].AhciPrdtDbc = EFI_AHCI_MAX_DATA_PER_PRDT - 1;
+      CommandTable->PrdtTable[PrdtIndex].AhciPrdtDbc = EFI_AHCI_MAX_DATA_PER_PRDT - 1;
     }
 
     Data64.Uint64 = (UINT64)MemAddr;
-    AhciRegisters->AhciCommandTable->PrdtTable[PrdtIndex].AhciPrdtDba  = Data64.Uint32.Lower32;
-    AhciRegisters->AhciCommandTable->PrdtTable[PrdtIndex].AhciPrdtDbau = Data64.Uint32.Upper32;
+    CommandTable->PrdtTable[PrdtIndex].AhciPrdtDba  = Data64.Uint32.Lower32;
+    CommandTable->PrdtTable[PrdtIndex].AhciPrdtDbau = Data64.Uint32.Upper32;
     RemainedData -= EFI_AHCI_MAX_DATA_PER_PRDT;
     MemAddr      += EFI_AHCI_MAX_DATA_PER_PRDT;
   }
@@ -608,7 +610,7 @@ AhciBuildCommand (
   // Set the last PRDT to Interrupt On Complete
   //
   if (PrdtNumber > 0) {
-    AhciRegisters->AhciCommandTable->PrdtTable[PrdtNumber - 1].AhciPrdtIoc = 1;
+    CommandTable->PrdtTable[PrdtNumber - 1].AhciPrdtIoc = 1;
   }
 #endif
 
@@ -618,7 +620,7 @@ AhciBuildCommand (
     sizeof (EFI_AHCI_COMMAND_LIST)
     );
 
-  Data64.Uint64 = (UINT64)(UINTN) AhciRegisters->AhciCommandTablePciAddr;
+  Data64.Uint64 = (UINT64)(UINTN) &AhciRegisters->AhciCommandTablePciAddr[CommandSlotNumber];
   AhciRegisters->AhciCmdList[CommandSlotNumber].AhciCmdCtba  = Data64.Uint32.Lower32;
   AhciRegisters->AhciCmdList[CommandSlotNumber].AhciCmdCtbau = Data64.Uint32.Upper32;
   AhciRegisters->AhciCmdList[CommandSlotNumber].AhciCmdPmp   = PortMultiplier;
@@ -1112,6 +1114,377 @@ Exit:
   return Status;
 }
 
+/**
+  Abort the native command queuing commands in flight. The port is stopped, the
+  buffers are unmapped and the status blocks report an error. The tasks stay in
+  the non blocking task list.
+
+  @param[in]  Instance          A pointer to the ATA_ATAPI_PASS_THRU_INSTANCE instance.
+
+**/
+VOID
+EFIAPI
+AhciNcqAbort (
+  IN  ATA_ATAPI_PASS_THRU_INSTANCE  *Instance
+  )
+{
+  EFI_PCI_IO_PROTOCOL  *PciIo;
+  ATA_NONBLOCK_TASK    *Task;
+  UINT8                Slot;
+
+  if (Instance->NcqActive == 0) {
+    return;
+  }
+
+  PciIo = Instance->PciIo;
+  AhciStopCommand (PciIo, (UINT8) Instance->NcqPort, ATA_ATAPI_TIMEOUT);
+  AhciClearPortStatus (PciIo, (UINT8) Instance->NcqPort);
+  AhciDisableFisReceive (PciIo, (UINT8) Instance->NcqPort, ATA_ATAPI_TIMEOUT);
+
+  for (Slot = 0; Slot < EFI_AHCI_MAX_COMMAND_SLOTS; Slot++) {
+    Task = Instance->NcqTask[Slot];
+    if (Task == NULL) {
+      continue;
+    }
+    PciIo->Unmap (PciIo, Task->Map);
+    Task->Packet->Asb->AtaStatus = 0x01;
+    Instance->NcqTask[Slot] = NULL;
+  }
+  Instance->NcqActive = 0;
+}
+
+/**
+  Read the NCQ command error log of the device, after a queued command failed.
+  The device aborts all the queued commands and ignores the new ones until the
+  log page 10h is read.
+
+  @param[in]  Instance          A pointer to the ATA_ATAPI_PASS_THRU_INSTANCE instance.
+  @param[in]  Port              The number of port.
+  @param[in]  PortMultiplier    The number of port multiplier.
+
+**/
+STATIC
+VOID
+AhciNcqRecover (
+  IN  ATA_ATAPI_PASS_THRU_INSTANCE  *Instance,
+  IN  UINT8                         Port,
+  IN  UINT8                         PortMultiplier
+  )
+{
+  EFI_ATA_COMMAND_BLOCK  Acb;
+  EFI_ATA_STATUS_BLOCK   Asb;
+  VOID                   *Log;
+
+  Log = AllocateZeroPool(0x200);
+  if (Log == NULL) {
+    return;
+  }
+
+  ZeroMem (&Acb, sizeof (EFI_ATA_COMMAND_BLOCK));
+  Acb.AtaCommand      = ATA_CMD_READ_LOG_EXT;
+  Acb.AtaSectorNumber = 0x10;
+  Acb.AtaSectorCount  = 1;
+
+  AhciPioTransfer (
+    Instance->PciIo,
+    &Instance->AhciRegisters,
+    Port,
+    PortMultiplier,
+    NULL,
+    0,
+    TRUE,
+    &Acb,
+    &Asb,
+    Log,
+    0x200,
+    ATA_ATAPI_TIMEOUT,
+    NULL
+    );
+
+  FreePool(Log);
+}
+
+/**
+  Issue a FPDMA QUEUED task in a free command slot. The port is started by the
+  first task, the next ones are only added to PxSACT and PxCI.
+
+  @param[in]  Instance          A pointer to the ATA_ATAPI_PASS_THRU_INSTANCE instance.
+  @param[in]  Task              The FPDMA task.
+  @param[in]  Slot              The free command slot, also the NCQ tag.
+
+  @retval EFI_SUCCESS           The command is issued.
+  @retval EFI_BAD_BUFFER_SIZE   The data buffer could not be mapped.
+  @retval others                The port could not be started.
+
+**/
+STATIC
+EFI_STATUS
+AhciNcqIssue (
+  IN  ATA_ATAPI_PASS_THRU_INSTANCE  *Instance,
+  IN  ATA_NONBLOCK_TASK             *Task,
+  IN  UINT8                         Slot
+  )
+{
+  EFI_STATUS                        Status;
+  EFI_PCI_IO_PROTOCOL               *PciIo;
+  EFI_ATA_PASS_THRU_COMMAND_PACKET  *Packet;
+  EFI_PCI_IO_PROTOCOL_OPERATION     Flag;
+  EFI_PHYSICAL_ADDRESS              PhyAddr;
+  VOID                              *Map;
+  UINTN                             MapLength;
+  VOID                              *MemoryAddr;
+  UINT32                            DataCount;
+  BOOLEAN                           Read;
+  EFI_AHCI_COMMAND_FIS              CFis;
+  EFI_AHCI_COMMAND_LIST             CmdList;
+  UINT32                            Offset;
+
+  PciIo  = Instance->PciIo;
+  Packet = Task->Packet;
+  Read   = (BOOLEAN) (Packet->InTransferLength != 0);
+  if (Read) {
+    Flag       = EfiPciIoOperationBusMasterWrite;
+    MemoryAddr = Packet->InDataBuffer;
+    DataCount  = Packet->InTransferLength;
+  } else {
+    Flag       = EfiPciIoOperationBusMasterRead;
+    MemoryAddr = Packet->OutDataBuffer;
+    DataCount  = Packet->OutTransferLength;
+  }
+
+  MapLength = DataCount;
+  Status = PciIo->Map (
+                    PciIo,
+                    Flag,
+                    MemoryAddr,
+                    &MapLength,
+                    &PhyAddr,
+                    &Map
+                    );
+  if (EFI_ERROR(Status) || (DataCount != MapLength)) {
+    if (!EFI_ERROR(Status)) {
+      PciIo->Unmap (PciIo, Map);
+    }
+    return EFI_BAD_BUFFER_SIZE;
+  }
+
+  if (Instance->NcqActive == 0) {
+    Status = AhciStartPort (PciIo, (UINT8) Task->Port, ATA_ATAPI_TIMEOUT);
+    if (EFI_ERROR(Status)) {
+      PciIo->Unmap (PciIo, Map);
+      return Status;
+    }
+    Instance->NcqPort           = Task->Port;
+    Instance->NcqPortMultiplier = Task->PortMultiplier;
+  }
+
+  //
+  // The count is in the features, the tag in the sector count.
+  // Device bit 6 must be set, bit 7 is FUA.
+  //
+  AhciBuildCommandFis (&CFis, Packet->Acb);
+  CFis.AhciCFisSecCount = (UINT8) (Slot << 3);
+  CFis.AhciCFisDevHead  = BIT6;
+
+  ZeroMem (&CmdList, sizeof (EFI_AHCI_COMMAND_LIST));
+  CmdList.AhciCmdCfl = EFI_AHCI_FIS_REGISTER_H2D_LENGTH / 4;
+  CmdList.AhciCmdW   = Read ? 0 : 1;
+
+  AhciBuildCommand (
+    PciIo,
+    &Instance->AhciRegisters,
+    (UINT8) Task->Port,
+    (UINT8) Task->PortMultiplier,
+    &CFis,
+    &CmdList,
+    NULL,
+    0,
+    Slot,
+    (VOID *)(UINTN)PhyAddr,
+    DataCount
+    );
+
+  Task->IsStart = TRUE;
+  Task->Map     = Map;
+  Task->Slot    = Slot;
+  Instance->NcqTask[Slot] = Task;
+  Instance->NcqActive    |= (UINT32) 1 << Slot;
+
+  //
+  // PxSACT before PxCI, both are write 1 to set.
+  //
+  Offset = EFI_AHCI_PORT_START + Task->Port * EFI_AHCI_PORT_REG_WIDTH;
+  AhciWriteReg (PciIo, Offset + EFI_AHCI_PORT_SACT, (UINT32) 1 << Slot);
+  AhciWriteReg (PciIo, Offset + EFI_AHCI_PORT_CI, (UINT32) 1 << Slot);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Complete the native command queuing commands done by the device and, if Issue
+  is TRUE, issue the FPDMA tasks found at the head of the non blocking task list.
+
+  A command is done when its bit is cleared in both PxSACT and PxCI. The FPDMA
+  tasks are issued in list order until a task of another kind, of another device
+  while commands are in flight, or until the slots allowed by the HBA and the
+  device queue depth are used.
+
+  @param[in]  Instance          A pointer to the ATA_ATAPI_PASS_THRU_INSTANCE instance.
+  @param[in]  Issue             Whether the queued FPDMA tasks are issued.
+
+  @retval EFI_SUCCESS           The completed tasks are signaled.
+  @retval EFI_DEVICE_ERROR      A queued command failed, the commands in flight are aborted.
+  @retval EFI_TIMEOUT           A queued command timed out, the commands in flight are aborted.
+  @retval others                A task could not be issued.
+
+**/
+EFI_STATUS
+EFIAPI
+AhciNcqTransferRoutine (
+  IN  ATA_ATAPI_PASS_THRU_INSTANCE  *Instance,
+  IN  BOOLEAN                       Issue
+  )
+{
+  EFI_STATUS           Status;
+  EFI_PCI_IO_PROTOCOL  *PciIo;
+  LIST_ENTRY           *Entry;
+  LIST_ENTRY           *Node;
+  ATA_NONBLOCK_TASK    *Task;
+  EFI_ATA_DEVICE_INFO  *DeviceInfo;
+  UINT32               Offset;
+  UINT32               Pending;
+  UINT32               IntStatus;
+  UINT32               Done;
+  UINT8                Slot;
+  UINT8                Port;
+  UINT8                PortMultiplier;
+
+  PciIo  = Instance->PciIo;
+  Status = EFI_SUCCESS;
+
+  if (Instance->NcqActive != 0) {
+    Port      = (UINT8) Instance->NcqPort;
+    Offset    = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH;
+    IntStatus = AhciReadReg (PciIo, Offset + EFI_AHCI_PORT_IS);
+    Pending   = AhciReadReg (PciIo, Offset + EFI_AHCI_PORT_SACT) | AhciReadReg (PciIo, Offset + EFI_AHCI_PORT_CI);
+    Done      = Instance->NcqActive & ~Pending;
+
+    while (Done != 0) {
+      Slot  = (UINT8) LowBitSet32 (Done);
+      Done &= Done - 1;
+      Task  = Instance->NcqTask[Slot];
+
+      PciIo->Unmap (PciIo, Task->Map);
+      ZeroMem (Task->Packet->Asb, sizeof (EFI_ATA_STATUS_BLOCK));
+      Instance->NcqTask[Slot] = NULL;
+      Instance->NcqActive    &= ~((UINT32) 1 << Slot);
+
+      RemoveEntryList (&Task->Link);
+      gBS->SignalEvent (Task->Event);
+      FreePool(Task);
+    }
+
+    if ((IntStatus & EFI_AHCI_PORT_IS_ERROR) != 0) {
+      Status = EFI_DEVICE_ERROR;
+    } else {
+      for (Slot = 0; Slot < EFI_AHCI_MAX_COMMAND_SLOTS; Slot++) {
+        Task = Instance->NcqTask[Slot];
+        if ((Task != NULL) && !Task->InfiniteWait && (--Task->RetryTimes == 0)) {
+          Status = EFI_TIMEOUT;
+        }
+      }
+    }
+
+    if (EFI_ERROR(Status)) {
+      PortMultiplier = (UINT8) Instance->NcqPortMultiplier;
+      AhciNcqAbort (Instance);
+      AhciNcqRecover (Instance, Port, PortMultiplier);
+      return Status;
+    }
+
+    if (Instance->NcqActive == 0) {
+      //
+      // Idle, the port is left stopped like after the other transfers.
+      //
+      AhciStopCommand (PciIo, Port, ATA_ATAPI_TIMEOUT);
+      AhciDisableFisReceive (PciIo, Port, ATA_ATAPI_TIMEOUT);
+    }
+  }
+
+  if (!Issue) {
+    return EFI_SUCCESS;
+  }
+
+  for (Entry = GetFirstNode (&Instance->NonBlockingTaskList);
+       !IsNull (&Instance->NonBlockingTaskList, Entry);
+       Entry = GetNextNode (&Instance->NonBlockingTaskList, Entry)) {
+    Task = ATA_NON_BLOCK_TASK_FROM_ENTRY (Entry);
+    if (Task->Packet->Protocol != EFI_ATA_PASS_THRU_PROTOCOL_FPDMA) {
+      break;
+    }
+    if (Task->IsStart) {
+      continue;
+    }
+
+    if (Instance->NcqActive == 0) {
+      //
+      // The queue depth of the device is in identify word 75, zero based.
+      //
+      Instance->NcqDepth = Instance->AhciRegisters.MaxCommandSlotNumber;
+      Node = SearchDeviceInfoList (Instance, Task->Port, Task->PortMultiplier, EfiIdeHarddisk);
+      if (Node != NULL) {
+        DeviceInfo = ATA_ATAPI_DEVICE_INFO_FROM_THIS (Node);
+        if ((DeviceInfo->IdentifyData->AtaData.queue_depth & 0x1F) + 1 < Instance->NcqDepth) {
+          Instance->NcqDepth = (UINT8) ((DeviceInfo->IdentifyData->AtaData.queue_depth & 0x1F) + 1);
+        }
+      }
+    } else if ((Task->Port != Instance->NcqPort) || (Task->PortMultiplier != Instance->NcqPortMultiplier)) {
+      break;
+    }
+
+    Slot = (UINT8) LowBitSet32 (~Instance->NcqActive);
+    if (Slot >= Instance->NcqDepth) {
+      break;
+    }
+
+    Status = AhciNcqIssue (Instance, Task, Slot);
+    if (EFI_ERROR(Status)) {
+      AhciNcqAbort (Instance);
+      return Status;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Wait for the native command queuing commands in flight, before a command is
+  sent without queuing.
+
+  @param[in]  Instance          A pointer to the ATA_ATAPI_PASS_THRU_INSTANCE instance.
+
+**/
+VOID
+EFIAPI
+AhciNcqWait (
+  IN  ATA_ATAPI_PASS_THRU_INSTANCE  *Instance
+  )
+{
+  //
+  // Note: This code always enters at TPL_NOTIFY
+  //
+  while (Instance->NcqActive != 0) {
+    if (EFI_ERROR(AhciNcqTransferRoutine (Instance, FALSE))) {
+      DestroyAsynTaskList (Instance, TRUE);
+      break;
+    }
+    //
+    // Stall for 100us.
+    //
+    MicroSecondDelay (100);
+  }
+}
+
 /**
   Start a non data transfer on specific port.
 
@@ -1273,24 +1646,22 @@ AhciStopCommand (
 }
 
 /**
-  Start command for give slot on specific port.
+  Start the command list processing of a port, without issuing a command.
 
   @param  PciIo              The PCI IO protocol instance.
   @param  Port               The number of port.
-  @param  CommandSlot        The number of Command Slot.
   @param  Timeout            The timeout value of start, uses 100ns as a unit.
 
-  @retval EFI_DEVICE_ERROR   The command start unsuccessfully.
+  @retval EFI_DEVICE_ERROR   The port start unsuccessfully.
   @retval EFI_TIMEOUT        The operation is time out.
-  @retval EFI_SUCCESS        The command start successfully.
+  @retval EFI_SUCCESS        The port start successfully.
 
 **/
 EFI_STATUS
 EFIAPI
-AhciStartCommand (
+AhciStartPort (
   IN  EFI_PCI_IO_PROTOCOL       *PciIo,
   IN  UINT8                     Port,
-  IN  UINT8                     CommandSlot,
   IN  UINT64                    Timeout
   )
 {
@@ -1347,6 +1718,39 @@ AhciStartCommand (
   Offset = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_CMD;
   AhciOrReg (PciIo, Offset, EFI_AHCI_PORT_CMD_ST | StartCmd);
 
+  return EFI_SUCCESS;
+}
+
+/**
+  Start command for give slot on specific port.
+
+  @param  PciIo              The PCI IO protocol instance.
+  @param  Port               The number of port.
+  @param  CommandSlot        The number of Command Slot.
+  @param  Timeout            The timeout value of start, uses 100ns as a unit.
+
+  @retval EFI_DEVICE_ERROR   The command start unsuccessfully.
+  @retval EFI_TIMEOUT        The operation is time out.
+  @retval EFI_SUCCESS        The command start successfully.
+
+**/
+EFI_STATUS
+EFIAPI
+AhciStartCommand (
+  IN  EFI_PCI_IO_PROTOCOL       *PciIo,
+  IN  UINT8                     Port,
+  IN  UINT8                     CommandSlot,
+  IN  UINT64                    Timeout
+  )
+{
+  EFI_STATUS Status;
+  UINT32     Offset;
+
+  Status = AhciStartPort (PciIo, Port, Timeout);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
   //
   // Setting the command
   //
@@ -2141,9 +2545,10 @@ AhciCreateTransferDescriptor (
   //
   // Allocate memory for command table
   // According to AHCI 1.3 spec, a PRD table can contain maximum 65535 entries.
+  // One table per command slot, the queued commands are built in their own slot.
   //
   Buffer = NULL;
-  MaxCommandTableSize = sizeof (EFI_AHCI_COMMAND_TABLE);
+  MaxCommandTableSize = MaxCommandSlotNumber * sizeof (EFI_AHCI_COMMAND_TABLE);
 
   Status = PciIo->AllocateBuffer (
                     PciIo,
@@ -2193,6 +2598,8 @@ AhciCreateTransferDescriptor (
     goto Error1;
   }
   AhciRegisters->AhciCommandTablePciAddr = (EFI_AHCI_COMMAND_TABLE *)(UINTN)AhciCommandTablePciAddr;
+  AhciRegisters->MaxCommandSlotNumber    = MaxCommandSlotNumber;
+  AhciRegisters->SupportNcq              = (BOOLEAN) ((Capability & EFI_AHCI_CAP_SNCQ) != 0);
 
   return EFI_SUCCESS;
   //
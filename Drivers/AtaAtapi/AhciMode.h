@@ -19,6 +19,7 @@
 #define EFI_AHCI_CAPABILITY_OFFSET             0x0000
 #define   EFI_AHCI_CAP_SAM                     BIT18
 #define   EFI_AHCI_CAP_SSS                     BIT27
+#define   EFI_AHCI_CAP_SNCQ                    BIT30
 #define   EFI_AHCI_CAP_S64A                    BIT31
 #define EFI_AHCI_GHC_OFFSET                    0x0004
 #define   EFI_AHCI_GHC_RESET                   BIT0
@@ -28,6 +29,7 @@
 #define EFI_AHCI_PI_OFFSET                     0x000C
 
 #define EFI_AHCI_MAX_PORTS                     32
+#define EFI_AHCI_MAX_COMMAND_SLOTS             32
 
 typedef struct {
   UINT32  Lower32;
@@ -114,6 +116,7 @@ typedef union {
 #define   EFI_AHCI_PORT_IS_CPDS                BIT31
 #define   EFI_AHCI_PORT_IS_CLEAR               0xFFFFFFFF
 #define   EFI_AHCI_PORT_IS_FIS_CLEAR           0x0000000F
+#define   EFI_AHCI_PORT_IS_ERROR               (EFI_AHCI_PORT_IS_TFES | EFI_AHCI_PORT_IS_HBFS | EFI_AHCI_PORT_IS_HBDS | EFI_AHCI_PORT_IS_IFS)
 
 #define EFI_AHCI_PORT_IE                       0x0014
 #define EFI_AHCI_PORT_CMD                      0x0018
@@ -301,6 +304,8 @@ typedef struct {
   VOID                      *MapRFis;
   VOID                      *MapCmdList;
   VOID                      *MapCommandTable;
+  UINT8                     MaxCommandSlotNumber;  // One command table per slot
+  BOOLEAN                   SupportNcq;            // CAP.SNCQ
 } EFI_AHCI_REGISTERS;
 
 /**
@@ -350,6 +355,26 @@ AhciStartCommand (
   IN  UINT64                    Timeout
   );
 
+/**
+  Start the command list processing of a port, without issuing a command.
+
+  @param  PciIo              The PCI IO protocol instance.
+  @param  Port               The number of port.
+  @param  Timeout            The timeout value of start, uses 100ns as a unit.
+
+  @retval EFI_DEVICE_ERROR   The port start unsuccessfully.
+  @retval EFI_TIMEOUT        The operation is time out.
+  @retval EFI_SUCCESS        The port start successfully.
+
+**/
+EFI_STATUS
+EFIAPI
+AhciStartPort (
+  IN  EFI_PCI_IO_PROTOCOL       *PciIo,
+  IN  UINT8                     Port,
+  IN  UINT64                    Timeout
+  );
+
 /**
   Stop command running for giving port
     
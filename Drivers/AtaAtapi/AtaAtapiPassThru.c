@@ -408,6 +408,17 @@ AsyncNonBlockingTransferRoutine (
 
   Instance   = (ATA_ATAPI_PASS_THRU_INSTANCE *) Context;
   EntryHeader = &Instance->NonBlockingTaskList;
+
+  //
+  // The FPDMA tasks at the head of the list are queued together by the NCQ routine.
+  //
+  if (Instance->Mode == EfiAtaAhciMode) {
+    Status = AhciNcqTransferRoutine (Instance, TRUE);
+    if (EFI_ERROR(Status)) {
+      DestroyAsynTaskList (Instance, TRUE);
+      return;
+    }
+  }
   //
   // Get the Taks from the Taks List and execute it, until there is
   // no task in the list or the device is busy with task (EFI_NOT_READY).
@@ -420,6 +431,10 @@ AsyncNonBlockingTransferRoutine (
       return;
     }
 
+    if ((Task->Packet->Protocol == EFI_ATA_PASS_THRU_PROTOCOL_FPDMA) || (Instance->NcqActive != 0)) {
+      return;
+    }
+
     Status = AtaPassThruPassThruExecute (
                Task->Port,
                Task->PortMultiplier,
@@ -1138,6 +1153,7 @@ DestroyAsynTaskList (
   EFI_TPL              OldTpl;
 
   OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  AhciNcqAbort (Instance);
   if (!IsListEmpty (&Instance->NonBlockingTaskList)) {
     //
     // Free the Subtask list.
@@ -1360,6 +1376,16 @@ AtaPassThruPassThru (
     return EFI_BAD_BUFFER_SIZE;
   }
 
+  //
+  // FPDMA QUEUED commands are only queued in AHCI mode, non-blocking, when both the
+  // HBA (CAP.SNCQ) and the device (identify word 76 bit 8) support them.
+  //
+  if ((Packet->Protocol == EFI_ATA_PASS_THRU_PROTOCOL_FPDMA) &&
+      ((Event == NULL) || (Instance->Mode != EfiAtaAhciMode) || !Instance->AhciRegisters.SupportNcq ||
+       (DeviceInfo->Type != EfiIdeHarddisk) || ((IdentifyData->AtaData.serial_ata_capabilities & BIT8) == 0))) {
+    return EFI_UNSUPPORTED;
+  }
+
   //
   // For non-blocking mode, queue the Task into the list.
   //
@@ -1390,6 +1416,9 @@ AtaPassThruPassThru (
   } else {
     EFI_STATUS Status;
     OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+    if (Instance->Mode == EfiAtaAhciMode) {
+      AhciNcqWait (Instance);
+    }
     Status = AtaPassThruPassThruExecute (
                Port,
                PortMultiplierPort,
@@ -1990,6 +2019,7 @@ ExtScsiPassThruPassThru (
   UINTN                           SenseDataLen;
   EFI_STATUS                      SenseStatus;
   UINT8                           AtapiUdmaFlags;
+  EFI_TPL                         OldTpl;
 
   SenseDataLen = 0;
   Instance     = EXT_SCSI_PASS_THRU_PRIVATE_DATA_FROM_THIS (This);
@@ -2093,7 +2123,10 @@ ExtScsiPassThruPassThru (
       break;
     case EfiAtaAhciMode:
       AtapiUdmaFlags = (UINT8) DeviceInfo->IdentifyData->AtapiData.reserved_224_254[0]; // stashed by AhciModeInitialization()
+      OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+      AhciNcqWait (Instance);
       Status = AhciPacketCommandExecute (Instance->PciIo, &Instance->AhciRegisters, Port, PortMultiplier | (AtapiUdmaFlags << 4), Packet);
+      gBS->RestoreTPL (OldTpl);
 //      DBG(L"EfiAtaAhciMode on port %d\n", Port);
       break;
     default :
@@ -121,6 +121,16 @@ typedef struct {
   //
   EFI_EVENT                         TimerEvent;
   LIST_ENTRY                        NonBlockingTaskList;
+
+  //
+  // Native command queuing, AHCI mode. The FPDMA tasks of the list are issued
+  // together on one port, the bit n of NcqActive is the task in slot n.
+  //
+  ATA_NONBLOCK_TASK                 *NcqTask[EFI_AHCI_MAX_COMMAND_SLOTS];
+  UINT32                            NcqActive;
+  UINT16                            NcqPort;
+  UINT16                            NcqPortMultiplier;
+  UINT8                             NcqDepth;
 } ATA_ATAPI_PASS_THRU_INSTANCE;
 
 //
@@ -141,6 +151,7 @@ struct _ATA_NONBLOCK_TASK {
   VOID                              *TableMap;       // Pointer to PRD table map.
   EFI_ATA_DMA_PRD                   *MapBaseAddress; //  Pointer to range Base address for Map.
   UINTN                             PageCount;       //  The page numbers used by PCIO freebuffer.
+  UINT8                             Slot;            //  The command slot of a queued FPDMA command.
 };
 
 //
@@ -537,6 +548,53 @@ AsyncNonBlockingTransferRoutine (
   VOID*      Context
   );
 
+/**
+  Complete the native command queuing commands done by the device and, if Issue
+  is TRUE, issue the FPDMA tasks found at the head of the non blocking task list.
+
+  @param[in]  Instance          A pointer to the ATA_ATAPI_PASS_THRU_INSTANCE instance.
+  @param[in]  Issue             Whether the queued FPDMA tasks are issued.
+
+  @retval EFI_SUCCESS           The completed tasks are signaled.
+  @retval EFI_DEVICE_ERROR      A queued command failed, the commands in flight are aborted.
+  @retval EFI_TIMEOUT           A queued command timed out, the commands in flight are aborted.
+  @retval others                A task could not be issued.
+
+**/
+EFI_STATUS
+EFIAPI
+AhciNcqTransferRoutine (
+  IN  ATA_ATAPI_PASS_THRU_INSTANCE  *Instance,
+  IN  BOOLEAN                       Issue
+  );
+
+/**
+  Wait for the native command queuing commands in flight, before a command is
+  sent without queuing.
+
+  @param[in]  Instance          A pointer to the ATA_ATAPI_PASS_THRU_INSTANCE instance.
+
+**/
+VOID
+EFIAPI
+AhciNcqWait (
+  IN  ATA_ATAPI_PASS_THRU_INSTANCE  *Instance
+  );
+
+/**
+  Abort the native command queuing commands in flight. The port is stopped, the
+  buffers are unmapped and the status blocks report an error. The tasks stay in
+  the non blocking task list.
+
+  @param[in]  Instance          A pointer to the ATA_ATAPI_PASS_THRU_INSTANCE instance.
+
+**/
+VOID
+EFIAPI
+AhciNcqAbort (
+  IN  ATA_ATAPI_PASS_THRU_INSTANCE  *Instance
+  );
+
 /**
   Sends an ATA command to an ATA device that is attached to the ATA controller. This function
   supports both blocking I/O and non-blocking I/O. The blocking I/O functionality is required,
@@ -100,6 +100,7 @@ ATA_DEVICE gAtaDeviceTemplate = {
   NULL,                        // Asb
   FALSE,                       // UdmaValid
   FALSE,                       // Lba48Bit
+  FALSE,                       // NcqValid
   NULL,                        // IdentifyData
   NULL,                        // ExitBootServiceEvent
   NULL,                        // ControllerNameTable
@@ -44,6 +44,9 @@
 #define ATA_CMD_TRUST_SEND        0x5E
 #define ATA_CMD_TRUST_SEND_DMA    0x5F
 
+#define ATA_CMD_READ_FPDMA_QUEUED   0x60
+#define ATA_CMD_WRITE_FPDMA_QUEUED  0x61
+
 //
 // Look up table (UdmaValid, IsWrite) for EFI_ATA_PASS_THRU_CMD_PROTOCOL
 //
@@ -352,6 +355,14 @@ IdentifyAtaDevice (
     AtaDevice->Lba48Bit = FALSE;
   }
 
+  //
+  // Native command queuing (word 76 bit 8), used by the non-blocking reads and writes.
+  // Word 76 is 0xFFFF on a device that is not Serial ATA.
+  //
+  AtaDevice->NcqValid = (BOOLEAN) (AtaDevice->UdmaValid &&
+                                   (IdentifyData->serial_ata_capabilities != 0xFFFF) &&
+                                   ((IdentifyData->serial_ata_capabilities & BIT8) != 0));
+
   //
   // Block Media Information:
   //
@@ -489,6 +500,7 @@ TransferAtaDevice (
   IN EFI_EVENT                            Event OPTIONAL
   )
 {
+  EFI_STATUS                        Status;
   EFI_ATA_COMMAND_BLOCK             *Acb;
   EFI_ATA_PASS_THRU_COMMAND_PACKET  *Packet;
 
@@ -571,9 +583,43 @@ TransferAtaDevice (
     //
     Packet->Timeout  = EFI_TIMER_PERIOD_SECONDS ((TransferLength * AtaDevice->BlockMedia.BlockSize) / 3300000 + 1);
   }
-  
 
-  return AtaDevicePassThru (AtaDevice, TaskPacket, Event);
+  //
+  // Non-blocking DMA transfers are queued: READ/WRITE FPDMA QUEUED always take a 48-bit
+  // LBA, the count is in the features and the pass thru puts the tag in the sector count.
+  //
+  if ((Event != NULL) && AtaDevice->NcqValid) {
+    Acb->AtaCommand         = IsWrite ? ATA_CMD_WRITE_FPDMA_QUEUED : ATA_CMD_READ_FPDMA_QUEUED;
+    Acb->AtaFeatures        = (UINT8) TransferLength;
+    Acb->AtaFeaturesExp     = (UINT8) (TransferLength >> 8);
+    Acb->AtaSectorCount     = 0;
+    Acb->AtaSectorCountExp  = 0;
+    Acb->AtaSectorNumberExp = (UINT8) RShiftU64 (StartLba, 24);
+    Acb->AtaCylinderLowExp  = (UINT8) RShiftU64 (StartLba, 32);
+    Acb->AtaCylinderHighExp = (UINT8) RShiftU64 (StartLba, 40);
+    Acb->AtaDeviceHead      = BIT6;
+    Packet->Protocol        = EFI_ATA_PASS_THRU_PROTOCOL_FPDMA;
+  }
+
+  Status = AtaDevicePassThru (AtaDevice, TaskPacket, Event);
+
+  //
+  // The controller may not queue: fall back to plain DMA for this device.
+  //
+  if ((Status == EFI_UNSUPPORTED) && (Packet->Protocol == EFI_ATA_PASS_THRU_PROTOCOL_FPDMA)) {
+    AtaDevice->NcqValid = FALSE;
+    if (TaskPacket != NULL) {
+      if (TaskPacket->Asb != NULL) {
+        FreeAlignedBuffer (TaskPacket->Asb, sizeof (EFI_ATA_STATUS_BLOCK));
+      }
+      if (TaskPacket->Acb != NULL) {
+        FreePool(TaskPacket->Acb);
+      }
+    }
+    Status = TransferAtaDevice (AtaDevice, TaskPacket, Buffer, StartLba, TransferLength, IsWrite, Event);
+  }
+
+  return Status;
 }
 
 /**
@@ -769,7 +815,10 @@ AccessAtaDevice(
   //
   if ((Token != NULL) && (Token->Event != NULL)) {
     OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
-    if (!IsListEmpty (&AtaDevice->AtaSubTaskList)) {
+    //
+    // With native command queuing the sub tasks of several requests are queued together.
+    //
+    if (!IsListEmpty (&AtaDevice->AtaSubTaskList) && !AtaDevice->NcqValid) {
       AtaTask = AllocateZeroPool(sizeof (ATA_BUS_ASYN_TASK));
       if (AtaTask == NULL) {
         gBS->RestoreTPL (OldTpl);
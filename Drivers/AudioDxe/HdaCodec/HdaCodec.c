@@ -27,19 +27,145 @@
 //#include <IndustryStandard/HdaCodec.h>
 #include <Library/HdaModels.h>
 
+// Verbs for a single node, sent with one SendCommands() call so the controller
+// fills the CORB once and collects all responses from the RIRB.
+#define HDA_VERB_BATCH_MAX  (2 * 256 + 32)
+
+typedef struct {
+  UINT32 Count;
+  UINT32 Verbs[HDA_VERB_BATCH_MAX];
+  UINT32 Responses[HDA_VERB_BATCH_MAX];
+} HDA_VERB_BATCH;
+
+STATIC
+UINT32
+HdaVerbBatchAdd(
+                IN HDA_VERB_BATCH *Batch,
+                IN UINT32 Verb)
+{
+  Batch->Verbs[Batch->Count] = Verb;
+  return Batch->Count++;
+}
+
+STATIC
 EFI_STATUS
-EFIAPI
-HdaCodecProbeWidget(
-                    IN HDA_WIDGET_DEV *HdaWidget)
+HdaVerbBatchSend(
+                 IN EFI_HDA_IO_PROTOCOL *HdaIo,
+                 IN UINT8 Node,
+                 IN HDA_VERB_BATCH *Batch)
 {
-  //DEBUG((DEBUG_INFO, "HdaCodecProbeWidget(): start\n"));
+  EFI_HDA_IO_VERB_LIST VerbList;
+  
+  if (Batch->Count == 0)
+    return EFI_SUCCESS;
+  VerbList.Count = Batch->Count;
+  VerbList.Verbs = Batch->Verbs;
+  VerbList.Responses = Batch->Responses;
+  return HdaIo->SendCommands(HdaIo, Node, &VerbList);
+}
+
+// Codec topology cache.
+// Widget capabilities, parameters and connection lists only depend on the codec model, so
+// another codec with the same vendor/device/revision (typically one HDMI codec per GPU port)
+// copies them instead of asking the hardware again. Defaults (gains, pin config...) are
+// still read from every codec.
+typedef struct {
+  UINT32 VendorId;
+  UINT32 RevisionId;
+  UINT8 FuncGroupNodeId;
+  UINT8 WidgetStart;
+  UINT8 WidgetsCount;
+  HDA_WIDGET_DEV *Widgets;
+} HDA_CODEC_TOPOLOGY;
+
+#define HDA_CODEC_TOPOLOGY_MAX 16
+
+STATIC HDA_CODEC_TOPOLOGY mHdaCodecTopologies[HDA_CODEC_TOPOLOGY_MAX];
+STATIC UINTN mHdaCodecTopologiesCount = 0;
+
+STATIC
+HDA_CODEC_TOPOLOGY *
+HdaCodecFindTopology(
+                     IN HDA_FUNC_GROUP *FuncGroup,
+                     IN UINT8 WidgetStart,
+                     IN UINT8 WidgetsCount)
+{
+  HDA_CODEC_TOPOLOGY *Topology;
+  
+  for (UINTN i = 0; i < mHdaCodecTopologiesCount; i++) {
+    Topology = mHdaCodecTopologies + i;
+    if ((Topology->VendorId == FuncGroup->HdaCodecDev->VendorId) &&
+        (Topology->RevisionId == FuncGroup->HdaCodecDev->RevisionId) &&
+        (Topology->FuncGroupNodeId == FuncGroup->NodeId) &&
+        (Topology->WidgetStart == WidgetStart) && (Topology->WidgetsCount == WidgetsCount))
+      return Topology;
+  }
+  return NULL;
+}
+
+STATIC
+VOID
+HdaCodecStoreTopology(
+                      IN HDA_FUNC_GROUP *FuncGroup,
+                      IN UINT8 WidgetStart)
+{
+  HDA_CODEC_TOPOLOGY *Topology;
+  HDA_WIDGET_DEV *CachedWidget;
   
-  // Create variables.
+  if (mHdaCodecTopologiesCount >= HDA_CODEC_TOPOLOGY_MAX)
+    return;
+  Topology = mHdaCodecTopologies + mHdaCodecTopologiesCount;
+  Topology->Widgets = AllocateZeroPool(sizeof(HDA_WIDGET_DEV) * FuncGroup->WidgetsCount);
+  if (Topology->Widgets == NULL)
+    return;
+  
+  // Keep the model-dependent fields only.
+  for (UINT8 w = 0; w < FuncGroup->WidgetsCount; w++) {
+    CachedWidget = Topology->Widgets + w;
+    CachedWidget->NodeId = FuncGroup->Widgets[w].NodeId;
+    CachedWidget->Type = FuncGroup->Widgets[w].Type;
+    CachedWidget->Capabilities = FuncGroup->Widgets[w].Capabilities;
+    CachedWidget->AmpOverride = FuncGroup->Widgets[w].AmpOverride;
+    CachedWidget->ConnectionListLength = FuncGroup->Widgets[w].ConnectionListLength;
+    CachedWidget->ConnectionCount = FuncGroup->Widgets[w].ConnectionCount;
+    if (CachedWidget->ConnectionCount > 0) {
+      CachedWidget->Connections = AllocateCopyPool(sizeof(UINT16) * CachedWidget->ConnectionCount, FuncGroup->Widgets[w].Connections);
+      if (CachedWidget->Connections == NULL) {
+        while (w-- > 0) {
+          if (Topology->Widgets[w].Connections != NULL)
+            FreePool(Topology->Widgets[w].Connections);
+        }
+        FreePool(Topology->Widgets);
+        return;
+      }
+    }
+    CachedWidget->SupportedPowerStates = FuncGroup->Widgets[w].SupportedPowerStates;
+    CachedWidget->AmpInCapabilities = FuncGroup->Widgets[w].AmpInCapabilities;
+    CachedWidget->AmpOutCapabilities = FuncGroup->Widgets[w].AmpOutCapabilities;
+    CachedWidget->SupportedPcmRates = FuncGroup->Widgets[w].SupportedPcmRates;
+    CachedWidget->SupportedFormats = FuncGroup->Widgets[w].SupportedFormats;
+    CachedWidget->PinCapabilities = FuncGroup->Widgets[w].PinCapabilities;
+    CachedWidget->VolumeCapabilities = FuncGroup->Widgets[w].VolumeCapabilities;
+  }
+  Topology->VendorId = FuncGroup->HdaCodecDev->VendorId;
+  Topology->RevisionId = FuncGroup->HdaCodecDev->RevisionId;
+  Topology->FuncGroupNodeId = FuncGroup->NodeId;
+  Topology->WidgetStart = WidgetStart;
+  Topology->WidgetsCount = FuncGroup->WidgetsCount;
+  mHdaCodecTopologiesCount++;
+}
+
+STATIC
+EFI_STATUS
+HdaCodecProbeWidgetTopology(
+                            IN HDA_WIDGET_DEV *HdaWidget,
+                            IN HDA_VERB_BATCH *Batch)
+{
   EFI_STATUS Status;
   EFI_HDA_IO_PROTOCOL *HdaIo = HdaWidget->FuncGroup->HdaCodecDev->HdaIo;
   UINT32 Response = 0;
+  UINT32 Index = 0;
   UINT8 ConnectionListThresh;
-  UINT8 AmpInCount;
   
   // Get widget capabilities.
   Status = HdaIo->SendCommand(HdaIo, HdaWidget->NodeId,
@@ -51,42 +177,69 @@ HdaCodecProbeWidget(
   //DEBUG((DEBUG_INFO, "Widget @ 0x%X type: 0x%X\n", HdaWidget->NodeId, HdaWidget->Type));
   //DEBUG((DEBUG_INFO, "Widget @ 0x%X capabilities: 0x%X\n", HdaWidget->NodeId, HdaWidget->Capabilities));
   
-  // Get default unsolicitation.
-  if (HdaWidget->Capabilities & HDA_PARAMETER_WIDGET_CAPS_UNSOL_CAPABLE) {
-    Status = HdaIo->SendCommand(HdaIo, HdaWidget->NodeId,
-                                HDA_CODEC_VERB(HDA_VERB_GET_UNSOL_RESPONSE, 0), &Response);
-    if (EFI_ERROR(Status))
-      return Status;
-    HdaWidget->DefaultUnSol = (UINT8)Response;
-    //DEBUG((DEBUG_INFO, "Widget @ 0x%X unsolicitation: 0x%X\n", HdaWidget->NodeId, HdaWidget->DefaultUnSol));
+  // Parameters selected by the capabilities, all in one batch.
+  Batch->Count = 0;
+  if (HdaWidget->Capabilities & HDA_PARAMETER_WIDGET_CAPS_CONN_LIST)
+    HdaVerbBatchAdd(Batch, HDA_CODEC_VERB(HDA_VERB_GET_PARAMETER, HDA_PARAMETER_CONN_LIST_LENGTH));
+  if (HdaWidget->Capabilities & HDA_PARAMETER_WIDGET_CAPS_POWER_CNTRL)
+    HdaVerbBatchAdd(Batch, HDA_CODEC_VERB(HDA_VERB_GET_PARAMETER, HDA_PARAMETER_SUPPORTED_POWER_STATES));
+  if (HdaWidget->Capabilities & HDA_PARAMETER_WIDGET_CAPS_IN_AMP)
+    HdaVerbBatchAdd(Batch, HDA_CODEC_VERB(HDA_VERB_GET_PARAMETER, HDA_PARAMETER_AMP_CAPS_INPUT));
+  if (HdaWidget->Capabilities & HDA_PARAMETER_WIDGET_CAPS_OUT_AMP)
+    HdaVerbBatchAdd(Batch, HDA_CODEC_VERB(HDA_VERB_GET_PARAMETER, HDA_PARAMETER_AMP_CAPS_OUTPUT));
+  if ((HdaWidget->Type == HDA_WIDGET_TYPE_INPUT || HdaWidget->Type == HDA_WIDGET_TYPE_OUTPUT) &&
+      (HdaWidget->Capabilities & HDA_PARAMETER_WIDGET_CAPS_FORMAT_OVERRIDE)) {
+    HdaVerbBatchAdd(Batch, HDA_CODEC_VERB(HDA_VERB_GET_PARAMETER, HDA_PARAMETER_SUPPORTED_PCM_SIZE_RATES));
+    HdaVerbBatchAdd(Batch, HDA_CODEC_VERB(HDA_VERB_GET_PARAMETER, HDA_PARAMETER_SUPPORTED_STREAM_FORMATS));
+  } else if (HdaWidget->Type == HDA_WIDGET_TYPE_PIN_COMPLEX) {
+    HdaVerbBatchAdd(Batch, HDA_CODEC_VERB(HDA_VERB_GET_PARAMETER, HDA_PARAMETER_PIN_CAPS));
+  } else if (HdaWidget->Type == HDA_WIDGET_TYPE_VOLUME_KNOB) {
+    HdaVerbBatchAdd(Batch, HDA_CODEC_VERB(HDA_VERB_GET_PARAMETER, HDA_PARAMETER_VOLUME_KNOB_CAPS));
   }
+  Status = HdaVerbBatchSend(HdaIo, HdaWidget->NodeId, Batch);
+  if (EFI_ERROR(Status))
+    return Status;
   
-  // Get connections.
+  // Responses come back in the order the verbs were added.
   if (HdaWidget->Capabilities & HDA_PARAMETER_WIDGET_CAPS_CONN_LIST) {
-    // Get connection list length.
-    Status = HdaIo->SendCommand(HdaIo, HdaWidget->NodeId,
-                                HDA_CODEC_VERB(HDA_VERB_GET_PARAMETER, HDA_PARAMETER_CONN_LIST_LENGTH), &HdaWidget->ConnectionListLength);
-    if (EFI_ERROR(Status))
-      return Status;
+    HdaWidget->ConnectionListLength = Batch->Responses[Index++];
     HdaWidget->ConnectionCount = HDA_PARAMETER_CONN_LIST_LENGTH_LEN(HdaWidget->ConnectionListLength);
     //DEBUG((DEBUG_INFO, "Widget @ 0x%X connection list length: 0x%X\n", HdaWidget->NodeId, HdaWidget->ConnectionListLength));
-    
-    // Get connections.
+  }
+  if (HdaWidget->Capabilities & HDA_PARAMETER_WIDGET_CAPS_POWER_CNTRL)
+    HdaWidget->SupportedPowerStates = Batch->Responses[Index++];
+  if (HdaWidget->Capabilities & HDA_PARAMETER_WIDGET_CAPS_IN_AMP)
+    HdaWidget->AmpInCapabilities = Batch->Responses[Index++];
+  if (HdaWidget->Capabilities & HDA_PARAMETER_WIDGET_CAPS_OUT_AMP)
+    HdaWidget->AmpOutCapabilities = Batch->Responses[Index++];
+  if ((HdaWidget->Type == HDA_WIDGET_TYPE_INPUT || HdaWidget->Type == HDA_WIDGET_TYPE_OUTPUT) &&
+      (HdaWidget->Capabilities & HDA_PARAMETER_WIDGET_CAPS_FORMAT_OVERRIDE)) {
+    HdaWidget->SupportedPcmRates = Batch->Responses[Index++];
+    HdaWidget->SupportedFormats = Batch->Responses[Index++];
+  } else if (HdaWidget->Type == HDA_WIDGET_TYPE_PIN_COMPLEX) {
+    HdaWidget->PinCapabilities = Batch->Responses[Index++];
+  } else if (HdaWidget->Type == HDA_WIDGET_TYPE_VOLUME_KNOB) {
+    HdaWidget->VolumeCapabilities = Batch->Responses[Index++];
+  }
+  
+  // Get connections.
+  if (HdaWidget->ConnectionCount > 0) {
     HdaWidget->Connections = AllocateZeroPool(sizeof(UINT16) * HdaWidget->ConnectionCount);
     if (HdaWidget->Connections == NULL)
       return EFI_OUT_OF_RESOURCES;
+    
+    // One verb returns 2 long or 4 short entries.
     ConnectionListThresh = (HdaWidget->ConnectionListLength & HDA_PARAMETER_CONN_LIST_LENGTH_LONG) ? 2 : 4;
+    Batch->Count = 0;
+    for (UINT8 c = 0; c < HdaWidget->ConnectionCount; c += ConnectionListThresh)
+      HdaVerbBatchAdd(Batch, HDA_CODEC_VERB(HDA_VERB_GET_CONN_LIST_ENTRY, c));
+    Status = HdaVerbBatchSend(HdaIo, HdaWidget->NodeId, Batch);
+    if (EFI_ERROR(Status))
+      return Status;
+    
+    // Populate entry list.
     for (UINT8 c = 0; c < HdaWidget->ConnectionCount; c++) {
-      // Do we need to get entries?
-      if (!(c % ConnectionListThresh)) {
-        // Get connection entries.
-        Status = HdaIo->SendCommand(HdaIo, HdaWidget->NodeId,
-                                    HDA_CODEC_VERB(HDA_VERB_GET_CONN_LIST_ENTRY, c), &Response);
-        if (EFI_ERROR(Status))
-          return Status;
-      }
-      
-      // Populate entry list.
+      Response = Batch->Responses[c / ConnectionListThresh];
       if ((HdaWidget->ConnectionListLength & HDA_PARAMETER_CONN_LIST_LENGTH_LONG))
         HdaWidget->Connections[c] = HDA_VERB_GET_CONN_LIST_ENTRY_LONG(Response, c % 2);
       else
@@ -100,33 +253,51 @@ HdaCodecProbeWidget(
   //DEBUG((DEBUG_INFO, " 0x%X", HdaWidget->Connections[c]));
   //DEBUG((DEBUG_INFO, "\n"));
   
-  // Does the widget support power management?
-  if (HdaWidget->Capabilities & HDA_PARAMETER_WIDGET_CAPS_POWER_CNTRL) {
-    // Get supported power states.
-    Status = HdaIo->SendCommand(HdaIo, HdaWidget->NodeId,
-                                HDA_CODEC_VERB(HDA_VERB_GET_PARAMETER, HDA_PARAMETER_SUPPORTED_POWER_STATES), &HdaWidget->SupportedPowerStates);
-    if (EFI_ERROR(Status))
-      return Status;
-    //DEBUG((DEBUG_INFO, "Widget @ 0x%X supported power states: 0x%X\n", HdaWidget->NodeId, HdaWidget->SupportedPowerStates));
-    
-    // Get default power state.
-    Status = HdaIo->SendCommand(HdaIo, HdaWidget->NodeId,
-                                HDA_CODEC_VERB(HDA_VERB_GET_POWER_STATE, 0), &HdaWidget->DefaultPowerState);
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+HdaCodecProbeWidget(
+                    IN HDA_WIDGET_DEV *HdaWidget,
+                    IN HDA_VERB_BATCH *Batch,
+                    IN HDA_WIDGET_DEV *CachedWidget OPTIONAL)
+{
+  //DEBUG((DEBUG_INFO, "HdaCodecProbeWidget(): start\n"));
+  
+  // Create variables.
+  EFI_STATUS Status;
+  EFI_HDA_IO_PROTOCOL *HdaIo = HdaWidget->FuncGroup->HdaCodecDev->HdaIo;
+  UINT32 Index = 0;
+  UINT8 AmpInCount = 0;
+  
+  // Get capabilities, parameters and connections, from the cache when this codec model was already probed.
+  if (CachedWidget != NULL) {
+    HdaWidget->Type = CachedWidget->Type;
+    HdaWidget->Capabilities = CachedWidget->Capabilities;
+    HdaWidget->AmpOverride = CachedWidget->AmpOverride;
+    HdaWidget->ConnectionListLength = CachedWidget->ConnectionListLength;
+    HdaWidget->ConnectionCount = CachedWidget->ConnectionCount;
+    if (HdaWidget->ConnectionCount > 0) {
+      HdaWidget->Connections = AllocateCopyPool(sizeof(UINT16) * HdaWidget->ConnectionCount, CachedWidget->Connections);
+      if (HdaWidget->Connections == NULL)
+        return EFI_OUT_OF_RESOURCES;
+    }
+    HdaWidget->SupportedPowerStates = CachedWidget->SupportedPowerStates;
+    HdaWidget->AmpInCapabilities = CachedWidget->AmpInCapabilities;
+    HdaWidget->AmpOutCapabilities = CachedWidget->AmpOutCapabilities;
+    HdaWidget->SupportedPcmRates = CachedWidget->SupportedPcmRates;
+    HdaWidget->SupportedFormats = CachedWidget->SupportedFormats;
+    HdaWidget->PinCapabilities = CachedWidget->PinCapabilities;
+    HdaWidget->VolumeCapabilities = CachedWidget->VolumeCapabilities;
+  } else {
+    Status = HdaCodecProbeWidgetTopology(HdaWidget, Batch);
     if (EFI_ERROR(Status))
       return Status;
-    //DEBUG((DEBUG_INFO, "Widget @ 0x%X power state: 0x%X\n", HdaWidget->NodeId, HdaWidget->DefaultPowerState));
   }
   
-  // Do we have input amps?
+  // Allocate input amp defaults, one per connection.
   if (HdaWidget->Capabilities & HDA_PARAMETER_WIDGET_CAPS_IN_AMP) {
-    // Get input amp capabilities.
-    Status = HdaIo->SendCommand(HdaIo, HdaWidget->NodeId,
-                                HDA_CODEC_VERB(HDA_VERB_GET_PARAMETER, HDA_PARAMETER_AMP_CAPS_INPUT), &HdaWidget->AmpInCapabilities);
-    if (EFI_ERROR(Status))
-      return Status;
-    //DEBUG((DEBUG_INFO, "Widget @ 0x%X input amp capabilities: 0x%X\n", HdaWidget->NodeId, HdaWidget->AmpInCapabilities));
-    
-    // Determine number of input amps and allocate arrays.
     AmpInCount = HdaWidget->ConnectionCount;
     if (AmpInCount < 1)
       AmpInCount = 1;
@@ -134,147 +305,67 @@ HdaCodecProbeWidget(
     HdaWidget->AmpInRightDefaultGainMute = AllocateZeroPool(sizeof(UINT8) * AmpInCount);
     if ((HdaWidget->AmpInLeftDefaultGainMute == NULL) || (HdaWidget->AmpInRightDefaultGainMute == NULL))
       return EFI_OUT_OF_RESOURCES;
-    
-    // Get default gain/mute for input amps.
-    for (UINT8 i = 0; i < AmpInCount; i++) {
-      // Get left.
-      Status = HdaIo->SendCommand(HdaIo, HdaWidget->NodeId,
-                                  HDA_CODEC_VERB(HDA_VERB_GET_AMP_GAIN_MUTE,
-                                                 HDA_VERB_GET_AMP_GAIN_MUTE_PAYLOAD(i, TRUE, FALSE)), &Response);
-      if (EFI_ERROR(Status))
-        return Status;
-      HdaWidget->AmpInLeftDefaultGainMute[i] = (UINT8)Response;
-      
-      // Get right.
-      Status = HdaIo->SendCommand(HdaIo, HdaWidget->NodeId,
-                                  HDA_CODEC_VERB(HDA_VERB_GET_AMP_GAIN_MUTE,
-                                                 HDA_VERB_GET_AMP_GAIN_MUTE_PAYLOAD(i, FALSE, FALSE)), &Response);
-      if (EFI_ERROR(Status))
-        return Status;
-      HdaWidget->AmpInRightDefaultGainMute[i] = (UINT8)Response;
-      //DEBUG((DEBUG_INFO, "Widget @ 0x%X input amp %u defaults: 0x%X 0x%X\n", HdaWidget->NodeId, i,
-      //    HdaWidget->AmpInLeftDefaultGainMute[i], HdaWidget->AmpInRightDefaultGainMute[i]));
-    }
   }
   
-  // Do we have an output amp?
+  // Get the defaults of this codec, all in one batch.
+  Batch->Count = 0;
+  if (HdaWidget->Capabilities & HDA_PARAMETER_WIDGET_CAPS_UNSOL_CAPABLE)
+    HdaVerbBatchAdd(Batch, HDA_CODEC_VERB(HDA_VERB_GET_UNSOL_RESPONSE, 0));
+  if (HdaWidget->Capabilities & HDA_PARAMETER_WIDGET_CAPS_POWER_CNTRL)
+    HdaVerbBatchAdd(Batch, HDA_CODEC_VERB(HDA_VERB_GET_POWER_STATE, 0));
+  for (UINT8 i = 0; i < AmpInCount; i++) {
+    HdaVerbBatchAdd(Batch, HDA_CODEC_VERB(HDA_VERB_GET_AMP_GAIN_MUTE, HDA_VERB_GET_AMP_GAIN_MUTE_PAYLOAD(i, TRUE, FALSE)));
+    HdaVerbBatchAdd(Batch, HDA_CODEC_VERB(HDA_VERB_GET_AMP_GAIN_MUTE, HDA_VERB_GET_AMP_GAIN_MUTE_PAYLOAD(i, FALSE, FALSE)));
+  }
   if (HdaWidget->Capabilities & HDA_PARAMETER_WIDGET_CAPS_OUT_AMP) {
-    // Get output amp capabilities.
-    Status = HdaIo->SendCommand(HdaIo, HdaWidget->NodeId,
-                                HDA_CODEC_VERB(HDA_VERB_GET_PARAMETER, HDA_PARAMETER_AMP_CAPS_OUTPUT), &HdaWidget->AmpOutCapabilities);
-    if (EFI_ERROR(Status))
-      return Status;
-    //DEBUG((DEBUG_INFO, "Widget @ 0x%X output amp capabilities: 0x%X\n", HdaWidget->NodeId, HdaWidget->AmpOutCapabilities));
-    
-    // Get left.
-    Status = HdaIo->SendCommand(HdaIo, HdaWidget->NodeId,
-                                HDA_CODEC_VERB(HDA_VERB_GET_AMP_GAIN_MUTE,
-                                               HDA_VERB_GET_AMP_GAIN_MUTE_PAYLOAD(0, TRUE, TRUE)), &Response);
-    if (EFI_ERROR(Status))
-      return Status;
-    HdaWidget->AmpOutLeftDefaultGainMute = (UINT8)Response;
-    
-    // Get right.
-    Status = HdaIo->SendCommand(HdaIo, HdaWidget->NodeId,
-                                HDA_CODEC_VERB(HDA_VERB_GET_AMP_GAIN_MUTE,
-                                               HDA_VERB_GET_AMP_GAIN_MUTE_PAYLOAD(0, FALSE, TRUE)), &Response);
-    if (EFI_ERROR(Status))
-      return Status;
-    HdaWidget->AmpOutRightDefaultGainMute = (UINT8)Response;
-    //DEBUG((DEBUG_INFO, "Widget @ 0x%X output amp defaults: 0x%X 0x%X\n", HdaWidget->NodeId,
-    //    HdaWidget->AmpOutLeftDefaultGainMute, HdaWidget->AmpOutRightDefaultGainMute));
+    HdaVerbBatchAdd(Batch, HDA_CODEC_VERB(HDA_VERB_GET_AMP_GAIN_MUTE, HDA_VERB_GET_AMP_GAIN_MUTE_PAYLOAD(0, TRUE, TRUE)));
+    HdaVerbBatchAdd(Batch, HDA_CODEC_VERB(HDA_VERB_GET_AMP_GAIN_MUTE, HDA_VERB_GET_AMP_GAIN_MUTE_PAYLOAD(0, FALSE, TRUE)));
   }
+  if (HdaWidget->Type == HDA_WIDGET_TYPE_INPUT || HdaWidget->Type == HDA_WIDGET_TYPE_OUTPUT) {
+    HdaVerbBatchAdd(Batch, HDA_CODEC_VERB(HDA_VERB_GET_CONVERTER_FORMAT, 0));
+    HdaVerbBatchAdd(Batch, HDA_CODEC_VERB(HDA_VERB_GET_CONVERTER_STREAM_CHANNEL, 0));
+    HdaVerbBatchAdd(Batch, HDA_CODEC_VERB(HDA_VERB_GET_CONVERTER_CHANNEL_COUNT, 0));
+  } else if (HdaWidget->Type == HDA_WIDGET_TYPE_PIN_COMPLEX) {
+    if (HdaWidget->PinCapabilities & HDA_PARAMETER_PIN_CAPS_EAPD)
+      HdaVerbBatchAdd(Batch, HDA_CODEC_VERB(HDA_VERB_GET_EAPD_BTL_ENABLE, 0));
+    HdaVerbBatchAdd(Batch, HDA_CODEC_VERB(HDA_VERB_GET_PIN_WIDGET_CONTROL, 0));
+    HdaVerbBatchAdd(Batch, HDA_CODEC_VERB(HDA_VERB_GET_CONFIGURATION_DEFAULT, 0));
+  } else if (HdaWidget->Type == HDA_WIDGET_TYPE_VOLUME_KNOB) {
+    HdaVerbBatchAdd(Batch, HDA_CODEC_VERB(HDA_VERB_GET_VOLUME_KNOB, 0));
+  }
+  Status = HdaVerbBatchSend(HdaIo, HdaWidget->NodeId, Batch);
+  if (EFI_ERROR(Status))
+    return Status;
   
-  // Is the widget an Input or Output?
+  // Responses come back in the order the verbs were added.
+  if (HdaWidget->Capabilities & HDA_PARAMETER_WIDGET_CAPS_UNSOL_CAPABLE)
+    HdaWidget->DefaultUnSol = (UINT8)Batch->Responses[Index++];
+  if (HdaWidget->Capabilities & HDA_PARAMETER_WIDGET_CAPS_POWER_CNTRL)
+    HdaWidget->DefaultPowerState = Batch->Responses[Index++];
+  for (UINT8 i = 0; i < AmpInCount; i++) {
+    HdaWidget->AmpInLeftDefaultGainMute[i] = (UINT8)Batch->Responses[Index++];
+    HdaWidget->AmpInRightDefaultGainMute[i] = (UINT8)Batch->Responses[Index++];
+    //DEBUG((DEBUG_INFO, "Widget @ 0x%X input amp %u defaults: 0x%X 0x%X\n", HdaWidget->NodeId, i,
+    //    HdaWidget->AmpInLeftDefaultGainMute[i], HdaWidget->AmpInRightDefaultGainMute[i]));
+  }
+  if (HdaWidget->Capabilities & HDA_PARAMETER_WIDGET_CAPS_OUT_AMP) {
+    HdaWidget->AmpOutLeftDefaultGainMute = (UINT8)Batch->Responses[Index++];
+    HdaWidget->AmpOutRightDefaultGainMute = (UINT8)Batch->Responses[Index++];
+  }
   if (HdaWidget->Type == HDA_WIDGET_TYPE_INPUT || HdaWidget->Type == HDA_WIDGET_TYPE_OUTPUT) {
-    if (HdaWidget->Capabilities & HDA_PARAMETER_WIDGET_CAPS_FORMAT_OVERRIDE) {
-      // Get supported PCM sizes/rates.
-      Status = HdaIo->SendCommand(HdaIo, HdaWidget->NodeId,
-                                  HDA_CODEC_VERB(HDA_VERB_GET_PARAMETER, HDA_PARAMETER_SUPPORTED_PCM_SIZE_RATES), &HdaWidget->SupportedPcmRates);
-      if (EFI_ERROR(Status))
-        return Status;
-      //DEBUG((DEBUG_INFO, "Widget @ 0x%X supported PCM sizes/rates: 0x%X\n", HdaWidget->NodeId, HdaWidget->SupportedPcmRates));
-      
-      // Get supported stream formats.
-      Status = HdaIo->SendCommand(HdaIo, HdaWidget->NodeId,
-                                  HDA_CODEC_VERB(HDA_VERB_GET_PARAMETER, HDA_PARAMETER_SUPPORTED_STREAM_FORMATS), &HdaWidget->SupportedFormats);
-      if (EFI_ERROR(Status))
-        return Status;
-      //DEBUG((DEBUG_INFO, "Widget @ 0x%X supported formats: 0x%X\n", HdaWidget->NodeId, HdaWidget->SupportedFormats));
-    }
-    
-    // Get default converter format.
-    Status = HdaIo->SendCommand(HdaIo, HdaWidget->NodeId,
-                                HDA_CODEC_VERB(HDA_VERB_GET_CONVERTER_FORMAT, 0), &Response);
-    if (EFI_ERROR(Status))
-      return Status;
-    HdaWidget->DefaultConvFormat = (UINT16)Response;
-    //DEBUG((DEBUG_INFO, "Widget @ 0x%X default format: 0x%X\n", HdaWidget->NodeId, HdaWidget->DefaultConvFormat));
-    
-    // Get default converter stream/channel.
-    Status = HdaIo->SendCommand(HdaIo, HdaWidget->NodeId,
-                                HDA_CODEC_VERB(HDA_VERB_GET_CONVERTER_STREAM_CHANNEL, 0), &Response);
-    if (EFI_ERROR(Status))
-      return Status;
-    HdaWidget->DefaultConvStreamChannel = (UINT8)Response;
-    //DEBUG((DEBUG_INFO, "Widget @ 0x%X default stream/channel: 0x%X\n", HdaWidget->NodeId, HdaWidget->DefaultConvStreamChannel));
-    
-    // Get default converter channel count.
-    Status = HdaIo->SendCommand(HdaIo, HdaWidget->NodeId,
-                                HDA_CODEC_VERB(HDA_VERB_GET_CONVERTER_CHANNEL_COUNT, 0), &Response);
-    if (EFI_ERROR(Status))
-      return Status;
-    HdaWidget->DefaultConvChannelCount = (UINT8)Response;
-    //DEBUG((DEBUG_INFO, "Widget @ 0x%X default channel count: 0x%X\n", HdaWidget->NodeId, HdaWidget->DefaultConvChannelCount));
-  } else if (HdaWidget->Type == HDA_WIDGET_TYPE_PIN_COMPLEX) { // Is the widget a Pin Complex?
-                                                               // Get pin capabilities.
-    Status = HdaIo->SendCommand(HdaIo, HdaWidget->NodeId,
-                                HDA_CODEC_VERB(HDA_VERB_GET_PARAMETER, HDA_PARAMETER_PIN_CAPS), &HdaWidget->PinCapabilities);
-    if (EFI_ERROR(Status))
-      return Status;
-    //DEBUG((DEBUG_INFO, "Widget @ 0x%X pin capabilities: 0x%X\n", HdaWidget->NodeId, HdaWidget->PinCapabilities));
-    
-    // Get default EAPD.
+    HdaWidget->DefaultConvFormat = (UINT16)Batch->Responses[Index++];
+    HdaWidget->DefaultConvStreamChannel = (UINT8)Batch->Responses[Index++];
+    HdaWidget->DefaultConvChannelCount = (UINT8)Batch->Responses[Index++];
+  } else if (HdaWidget->Type == HDA_WIDGET_TYPE_PIN_COMPLEX) {
     if (HdaWidget->PinCapabilities & HDA_PARAMETER_PIN_CAPS_EAPD) {
-      Status = HdaIo->SendCommand(HdaIo, HdaWidget->NodeId,
-                                  HDA_CODEC_VERB(HDA_VERB_GET_EAPD_BTL_ENABLE, 0), &Response);
-      if (EFI_ERROR(Status))
-        return Status;
-      HdaWidget->DefaultEapd = (UINT8)Response;
+      HdaWidget->DefaultEapd = (UINT8)Batch->Responses[Index++];
       HdaWidget->DefaultEapd &= 0x7;
       HdaWidget->DefaultEapd |= HDA_EAPD_BTL_ENABLE_EAPD;
-      //DEBUG((DEBUG_INFO, "Widget @ 0x%X EAPD: 0x%X\n", HdaWidget->NodeId, HdaWidget->DefaultEapd));
     }
-    
-    // Get default pin control.
-    Status = HdaIo->SendCommand(HdaIo, HdaWidget->NodeId,
-                                HDA_CODEC_VERB(HDA_VERB_GET_PIN_WIDGET_CONTROL, 0), &Response);
-    if (EFI_ERROR(Status))
-      return Status;
-    HdaWidget->DefaultPinControl = (UINT8)Response;
-    //DEBUG((DEBUG_INFO, "Widget @ 0x%X default pin control: 0x%X\n", HdaWidget->NodeId, HdaWidget->DefaultPinControl));
-    
-    // Get default pin configuration.
-    Status = HdaIo->SendCommand(HdaIo, HdaWidget->NodeId,
-                                HDA_CODEC_VERB(HDA_VERB_GET_CONFIGURATION_DEFAULT, 0), &HdaWidget->DefaultConfiguration);
-    if (EFI_ERROR(Status))
-      return Status;
-    //DEBUG((DEBUG_INFO, "Widget @ 0x%X default pin configuration: 0x%X\n", HdaWidget->NodeId, HdaWidget->DefaultConfiguration));
-  } else if (HdaWidget->Type == HDA_WIDGET_TYPE_VOLUME_KNOB) { // Is the widget a Volume Knob?
-                                                               // Get volume knob capabilities.
-    Status = HdaIo->SendCommand(HdaIo, HdaWidget->NodeId,
-                                HDA_CODEC_VERB(HDA_VERB_GET_PARAMETER, HDA_PARAMETER_VOLUME_KNOB_CAPS), &HdaWidget->VolumeCapabilities);
-    if (EFI_ERROR(Status))
-      return Status;
-    //DEBUG((DEBUG_INFO, "Widget @ 0x%X volume knob capabilities: 0x%X\n", HdaWidget->NodeId, HdaWidget->VolumeCapabilities));
-    
-    // Get default volume.
-    Status = HdaIo->SendCommand(HdaIo, HdaWidget->NodeId,
-                                HDA_CODEC_VERB(HDA_VERB_GET_VOLUME_KNOB, 0), &Response);
-    if (EFI_ERROR(Status))
-      return Status;
-    HdaWidget->DefaultVolume = (UINT8)Response;
-    //DEBUG((DEBUG_INFO, "Widget @ 0x%X default volume: 0x%X\n", HdaWidget->NodeId, HdaWidget->DefaultVolume));
+    HdaWidget->DefaultPinControl = (UINT8)Batch->Responses[Index++];
+    HdaWidget->DefaultConfiguration = Batch->Responses[Index++];
+  } else if (HdaWidget->Type == HDA_WIDGET_TYPE_VOLUME_KNOB) {
+    HdaWidget->DefaultVolume = (UINT8)Batch->Responses[Index++];
   }
   
   return EFI_SUCCESS;
@@ -296,6 +387,9 @@ HdaCodecProbeFuncGroup(
   UINT8 WidgetCount;
   HDA_WIDGET_DEV *HdaWidget;
   HDA_WIDGET_DEV *HdaConnectedWidget;
+  HDA_VERB_BATCH *Batch;
+  HDA_CODEC_TOPOLOGY *Topology;
+  BOOLEAN WidgetsProbed = TRUE;
   
   // Get function group type.
   Status = HdaIo->SendCommand(HdaIo, FuncGroup->NodeId,
@@ -310,60 +404,33 @@ HdaCodecProbeFuncGroup(
   if (FuncGroup->Type != HDA_FUNC_GROUP_TYPE_AUDIO)
     return EFI_UNSUPPORTED;
   
-  // Get function group capabilities.
-  Status = HdaIo->SendCommand(HdaIo, FuncGroup->NodeId,
-                              HDA_CODEC_VERB(HDA_VERB_GET_PARAMETER, HDA_PARAMETER_FUNC_GROUP_CAPS), &FuncGroup->Capabilities);
+  // Get function group parameters, all in one batch.
+  Batch = AllocatePool(sizeof(HDA_VERB_BATCH));
+  if (Batch == NULL)
+    return EFI_OUT_OF_RESOURCES;
+  Batch->Count = 0;
+  HdaVerbBatchAdd(Batch, HDA_CODEC_VERB(HDA_VERB_GET_PARAMETER, HDA_PARAMETER_FUNC_GROUP_CAPS));
+  HdaVerbBatchAdd(Batch, HDA_CODEC_VERB(HDA_VERB_GET_PARAMETER, HDA_PARAMETER_SUPPORTED_PCM_SIZE_RATES));
+  HdaVerbBatchAdd(Batch, HDA_CODEC_VERB(HDA_VERB_GET_PARAMETER, HDA_PARAMETER_SUPPORTED_STREAM_FORMATS));
+  HdaVerbBatchAdd(Batch, HDA_CODEC_VERB(HDA_VERB_GET_PARAMETER, HDA_PARAMETER_AMP_CAPS_INPUT));
+  HdaVerbBatchAdd(Batch, HDA_CODEC_VERB(HDA_VERB_GET_PARAMETER, HDA_PARAMETER_AMP_CAPS_OUTPUT));
+  HdaVerbBatchAdd(Batch, HDA_CODEC_VERB(HDA_VERB_GET_PARAMETER, HDA_PARAMETER_SUPPORTED_POWER_STATES));
+  HdaVerbBatchAdd(Batch, HDA_CODEC_VERB(HDA_VERB_GET_PARAMETER, HDA_PARAMETER_GPIO_COUNT));
+  HdaVerbBatchAdd(Batch, HDA_CODEC_VERB(HDA_VERB_GET_PARAMETER, HDA_PARAMETER_SUBNODE_COUNT));
+  Status = HdaVerbBatchSend(HdaIo, FuncGroup->NodeId, Batch);
   if (EFI_ERROR(Status))
-    return Status;
+    goto DONE;
+  FuncGroup->Capabilities = Batch->Responses[0];
+  FuncGroup->SupportedPcmRates = Batch->Responses[1];
+  FuncGroup->SupportedFormats = Batch->Responses[2];
+  FuncGroup->AmpInCapabilities = Batch->Responses[3];
+  FuncGroup->AmpOutCapabilities = Batch->Responses[4];
+  FuncGroup->SupportedPowerStates = Batch->Responses[5];
+  FuncGroup->GpioCapabilities = Batch->Responses[6];
+  Response = Batch->Responses[7];
   //DEBUG((DEBUG_INFO, "Function group @ 0x%X capabilities: 0x%X\n", FuncGroup->NodeId, FuncGroup->Capabilities));
   
-  // Get default supported PCM sizes/rates.
-  Status = HdaIo->SendCommand(HdaIo, FuncGroup->NodeId,
-                              HDA_CODEC_VERB(HDA_VERB_GET_PARAMETER, HDA_PARAMETER_SUPPORTED_PCM_SIZE_RATES), &FuncGroup->SupportedPcmRates);
-  if (EFI_ERROR(Status))
-    return Status;
-  //DEBUG((DEBUG_INFO, "Function group @ 0x%X supported PCM sizes/rates: 0x%X\n", FuncGroup->NodeId, FuncGroup->SupportedPcmRates));
-  
-  // Get default supported stream formats.
-  Status = HdaIo->SendCommand(HdaIo, FuncGroup->NodeId,
-                              HDA_CODEC_VERB(HDA_VERB_GET_PARAMETER, HDA_PARAMETER_SUPPORTED_STREAM_FORMATS), &FuncGroup->SupportedFormats);
-  if (EFI_ERROR(Status))
-    return Status;
-  //DEBUG((DEBUG_INFO, "Function group @ 0x%X supported formats: 0x%X\n", FuncGroup->NodeId, FuncGroup->SupportedFormats));
-  
-  // Get default input amp capabilities.
-  Status = HdaIo->SendCommand(HdaIo, FuncGroup->NodeId,
-                              HDA_CODEC_VERB(HDA_VERB_GET_PARAMETER, HDA_PARAMETER_AMP_CAPS_INPUT), &FuncGroup->AmpInCapabilities);
-  if (EFI_ERROR(Status))
-    return Status;
-  //DEBUG((DEBUG_INFO, "Function group @ 0x%X input amp capabilities: 0x%X\n", FuncGroup->NodeId, FuncGroup->AmpInCapabilities));
-  
-  // Get default output amp capabilities.
-  Status = HdaIo->SendCommand(HdaIo, FuncGroup->NodeId,
-                              HDA_CODEC_VERB(HDA_VERB_GET_PARAMETER, HDA_PARAMETER_AMP_CAPS_OUTPUT), &FuncGroup->AmpOutCapabilities);
-  if (EFI_ERROR(Status))
-    return Status;
-  //DEBUG((DEBUG_INFO, "Function group @ 0x%X output amp capabilities: 0x%X\n", FuncGroup->NodeId, FuncGroup->AmpOutCapabilities));
-  
-  // Get supported power states.
-  Status = HdaIo->SendCommand(HdaIo, FuncGroup->NodeId,
-                              HDA_CODEC_VERB(HDA_VERB_GET_PARAMETER, HDA_PARAMETER_SUPPORTED_POWER_STATES), &FuncGroup->SupportedPowerStates);
-  if (EFI_ERROR(Status))
-    return Status;
-  //DEBUG((DEBUG_INFO, "Function group @ 0x%X supported power states: 0x%X\n", FuncGroup->NodeId, FuncGroup->SupportedPowerStates));
-  
-  // Get GPIO capabilities.
-  Status = HdaIo->SendCommand(HdaIo, FuncGroup->NodeId,
-                              HDA_CODEC_VERB(HDA_VERB_GET_PARAMETER, HDA_PARAMETER_GPIO_COUNT), &FuncGroup->GpioCapabilities);
-  if (EFI_ERROR(Status))
-    return Status;
-  //DEBUG((DEBUG_INFO, "Function group @ 0x%X GPIO capabilities: 0x%X\n", FuncGroup->NodeId, FuncGroup->GpioCapabilities));
-  
   // Get number of widgets in function group.
-  Status = HdaIo->SendCommand(HdaIo, FuncGroup->NodeId,
-                              HDA_CODEC_VERB(HDA_VERB_GET_PARAMETER, HDA_PARAMETER_SUBNODE_COUNT), &Response);
-  if (EFI_ERROR(Status))
-    return Status;
   WidgetStart = HDA_PARAMETER_SUBNODE_COUNT_START(Response);
   WidgetCount = HDA_PARAMETER_SUBNODE_COUNT_TOTAL(Response);
   WidgetEnd = WidgetStart + WidgetCount - 1;
@@ -375,17 +442,22 @@ HdaCodecProbeFuncGroup(
   ASSERT_EFI_ERROR(Status);
   
   // Ensure there are widgets.
-  if (WidgetCount == 0)
-    return EFI_UNSUPPORTED;
+  if (WidgetCount == 0) {
+    Status = EFI_UNSUPPORTED;
+    goto DONE;
+  }
   
   // Allocate space for widgets.
   FuncGroup->Widgets = AllocateZeroPool(sizeof(HDA_WIDGET_DEV) * WidgetCount);
-  if (FuncGroup->Widgets == NULL)
-    return EFI_OUT_OF_RESOURCES;
+  if (FuncGroup->Widgets == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto DONE;
+  }
   FuncGroup->WidgetsCount = WidgetCount;
   
   // Probe widgets.
-  DEBUG((DEBUG_INFO, "HdaCodecProbeFuncGroup(): probing widgets\n"));
+  Topology = HdaCodecFindTopology(FuncGroup, WidgetStart, WidgetCount);
+  DEBUG((DEBUG_INFO, "HdaCodecProbeFuncGroup(): probing widgets%a\n", (Topology != NULL) ? " (cached topology)" : ""));
   for (UINT8 w = 0; w < WidgetCount; w++) {
     // Get widget.
     HdaWidget = FuncGroup->Widgets + w;
@@ -393,8 +465,10 @@ HdaCodecProbeFuncGroup(
     // Probe widget.
     HdaWidget->FuncGroup = FuncGroup;
     HdaWidget->NodeId = WidgetStart + w;
-    Status = HdaCodecProbeWidget(HdaWidget);
+    Status = HdaCodecProbeWidget(HdaWidget, Batch, (Topology != NULL) ? Topology->Widgets + w : NULL);
     ASSERT_EFI_ERROR(Status);
+    if (EFI_ERROR(Status))
+      WidgetsProbed = FALSE;
     
     // Power up.
     if (HdaWidget->Capabilities & HDA_PARAMETER_WIDGET_CAPS_POWER_CNTRL) {
@@ -402,6 +476,11 @@ HdaCodecProbeFuncGroup(
       ASSERT_EFI_ERROR(Status);
     }
   }
+  FreePool(Batch);
+  
+  // Remember this model's topology for the next identical codec.
+  if ((Topology == NULL) && WidgetsProbed)
+    HdaCodecStoreTopology(FuncGroup, WidgetStart);
   
   // Probe widget connections.
   DEBUG((DEBUG_INFO, "HdaCodecProbeFuncGroup(): probing widget connections\n"));
@@ -436,6 +515,10 @@ HdaCodecProbeFuncGroup(
   }
   
   return EFI_SUCCESS;
+  
+DONE:
+  FreePool(Batch);
+  return Status;
 }
 
 EFI_STATUS
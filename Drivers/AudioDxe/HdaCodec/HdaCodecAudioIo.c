@@ -28,9 +28,10 @@
 #include "../AudioDxe.h"
 //#include <IndustryStandard/HdaCodec.h>
 #include <Protocol/AudioIo.h>
-/*
-// HDA I/O Stream callback.
+
+// HDA I/O Stream callback, runs from the controller poll timer when the last block was played.
 VOID
+EFIAPI
 HdaCodecHdaIoStreamCallback(
     IN EFI_HDA_IO_PROTOCOL_TYPE Type,
     IN VOID *Context1,
@@ -50,7 +51,7 @@ HdaCodecHdaIoStreamCallback(
     // Invoke callback.
     AudioIoCallback(AudioIo, Context3);
 }
-*/
+
 /**
   Gets the collection of output ports.
 
@@ -229,8 +230,59 @@ HdaCodecAudioIoGetOutputs(
   return EFI_SUCCESS;
 }
 
+// Formats tried when the codec can't play the source one, best first: { AudioIo, codec support bit, Hz or bits }.
+STATIC CONST UINT32 HdaCodecAudioIoFreqs[][3] = {
+    { EfiAudioIoFreq48kHz,  HDA_PARAMETER_SUPPORTED_PCM_SIZE_RATES_48KHZ,  48000 },
+    { EfiAudioIoFreq44kHz,  HDA_PARAMETER_SUPPORTED_PCM_SIZE_RATES_44KHZ,  44100 },
+    { EfiAudioIoFreq96kHz,  HDA_PARAMETER_SUPPORTED_PCM_SIZE_RATES_96KHZ,  96000 },
+    { EfiAudioIoFreq88kHz,  HDA_PARAMETER_SUPPORTED_PCM_SIZE_RATES_88KHZ,  88200 },
+    { EfiAudioIoFreq192kHz, HDA_PARAMETER_SUPPORTED_PCM_SIZE_RATES_192KHZ, 192000 },
+    { EfiAudioIoFreq32kHz,  HDA_PARAMETER_SUPPORTED_PCM_SIZE_RATES_32KHZ,  32000 },
+    { EfiAudioIoFreq22kHz,  HDA_PARAMETER_SUPPORTED_PCM_SIZE_RATES_22KHZ,  22050 },
+    { EfiAudioIoFreq16kHz,  HDA_PARAMETER_SUPPORTED_PCM_SIZE_RATES_16KHZ,  16000 },
+    { EfiAudioIoFreq11kHz,  HDA_PARAMETER_SUPPORTED_PCM_SIZE_RATES_11KHZ,  11025 },
+    { EfiAudioIoFreq8kHz,   HDA_PARAMETER_SUPPORTED_PCM_SIZE_RATES_8KHZ,   8000 }
+};
+
+STATIC CONST UINT32 HdaCodecAudioIoBits[][3] = {
+    { EfiAudioIoBits16, HDA_PARAMETER_SUPPORTED_PCM_SIZE_RATES_16BIT, 16 },
+    { EfiAudioIoBits24, HDA_PARAMETER_SUPPORTED_PCM_SIZE_RATES_24BIT, 24 },
+    { EfiAudioIoBits32, HDA_PARAMETER_SUPPORTED_PCM_SIZE_RATES_32BIT, 32 },
+    { EfiAudioIoBits20, HDA_PARAMETER_SUPPORTED_PCM_SIZE_RATES_20BIT, 20 },
+    { EfiAudioIoBits8,  HDA_PARAMETER_SUPPORTED_PCM_SIZE_RATES_8BIT,  8 }
+};
+
+// Returns Format if the codec supports it, else the best supported one of Formats.
+STATIC
+UINTN
+HdaCodecAudioIoNativeFormat(
+    IN CONST UINT32 (*Formats)[3],
+    IN UINTN Count,
+    IN UINT32 SupportedRates,
+    IN UINTN Format,
+    OUT UINT32 *SourceValue)
+{
+    UINTN i;
+
+    *SourceValue = 0;
+    for (i = 0; i < Count; i++) {
+        if (Formats[i][0] == Format) {
+            *SourceValue = Formats[i][2];
+            if (SupportedRates & Formats[i][1])
+                return Format;
+        }
+    }
+    for (i = 0; i < Count; i++) {
+        if (SupportedRates & Formats[i][1])
+            return Formats[i][0];
+    }
+    return Format;
+}
+
 /**
   Sets up the device to play audio data.
+  When the output doesn't support the format of the data, the stream is set up with a format
+  it supports and the samples are converted by the controller while they are streamed.
 
   @param[in] This               A pointer to the EFI_AUDIO_IO_PROTOCOL instance.
   @param[in] OutputIndex        The zero-based index of the desired output.
@@ -270,9 +322,16 @@ HdaCodecAudioIoSetupPlayback(
     UINT8 StreamBits, StreamDiv, StreamMult = 0;
     BOOLEAN StreamBase44kHz = FALSE;
     UINT16 StreamFmt;
+    UINT8 StreamChannels;
+    EFI_AUDIO_IO_PROTOCOL_FREQ StreamFreq;
+    EFI_AUDIO_IO_PROTOCOL_BITS StreamBitsFormat;
+    UINT32 SourceRate;
+    UINT32 SourceBits;
+    BOOLEAN Convert;
 
     // If a parameter is invalid, return error.
-    if ((This == NULL) || (Volume > EFI_AUDIO_IO_PROTOCOL_MAX_VOLUME))
+    if ((This == NULL) || (Volume > EFI_AUDIO_IO_PROTOCOL_MAX_VOLUME) ||
+        (Channels == 0) || (Channels > EFI_AUDIO_IO_PROTOCOL_MAX_CHANNELS))
         return EFI_INVALID_PARAMETER;
 
     // Get private data.
@@ -295,6 +354,27 @@ HdaCodecAudioIoSetupPlayback(
     if (EFI_ERROR(Status))
         return Status;
 
+    // Pick the stream format. 20 and 24-bit sources are packed in 3 bytes, the stream uses 4.
+    Convert = (Bits == EfiAudioIoBits20) || (Bits == EfiAudioIoBits24);
+    StreamChannels = Channels;
+    if (StreamChannels > HDA_PARAMETER_WIDGET_CAPS_CHAN_COUNT(OutputWidget->Capabilities) + 1) {
+        StreamChannels = HDA_PARAMETER_WIDGET_CAPS_CHAN_COUNT(OutputWidget->Capabilities) + 1;
+        Convert = TRUE;
+    }
+    StreamFreq = (EFI_AUDIO_IO_PROTOCOL_FREQ)HdaCodecAudioIoNativeFormat(HdaCodecAudioIoFreqs,
+        ARRAY_SIZE(HdaCodecAudioIoFreqs), SupportedRates, Freq, &SourceRate);
+    StreamBitsFormat = (EFI_AUDIO_IO_PROTOCOL_BITS)HdaCodecAudioIoNativeFormat(HdaCodecAudioIoBits,
+        ARRAY_SIZE(HdaCodecAudioIoBits), SupportedRates, Bits, &SourceBits);
+    if ((SourceRate == 0) || (SourceBits == 0))
+        return EFI_INVALID_PARAMETER;
+    if ((StreamFreq != Freq) || (StreamBitsFormat != Bits))
+        Convert = TRUE;
+    // the converter writes whole frames in a BDL block
+    while (Convert && (StreamChannels & (StreamChannels - 1)) != 0)
+        StreamChannels--;
+    Freq = StreamFreq;
+    Bits = StreamBitsFormat;
+
     // Determine bitness of samples, ensuring desired bitness is supported.
     switch (Bits) {
         // 8-bit.
@@ -449,13 +529,22 @@ HdaCodecAudioIoSetupPlayback(
         return Status;
 
     // Calculate stream format and setup stream.
-    StreamFmt = HDA_CONVERTER_FORMAT_SET(Channels - 1, StreamBits,
+    StreamFmt = HDA_CONVERTER_FORMAT_SET(StreamChannels - 1, StreamBits,
         StreamDiv - 1, StreamMult - 1, StreamBase44kHz);
     DEBUG((DEBUG_INFO, "HdaCodecAudioIoPlay(): Stream format 0x%X\n", StreamFmt));
     Status = HdaIo->SetupStream(HdaIo, EfiHdaIoTypeOutput, StreamFmt, &HdaStreamId);
     if (EFI_ERROR(Status))
         return Status;
 
+    // Source format differs, the controller converts.
+    if (Convert) {
+        DEBUG((DEBUG_INFO, "HdaCodecAudioIoPlay(): converting from %u Hz %u bits %u channels\n",
+            SourceRate, SourceBits, Channels));
+        Status = HdaIo->SetStreamSource(HdaIo, EfiHdaIoTypeOutput, SourceRate, (UINT8)SourceBits, Channels);
+        if (EFI_ERROR(Status))
+            goto CLOSE_STREAM;
+    }
+
     // Setup widget path for desired output.
     AudioIoPrivateData->SelectedOutputIndex = OutputIndex;
     Status = HdaCodecEnableWidgetPath(PinWidget, Volume, HdaStreamId, StreamFmt);
@@ -569,11 +658,9 @@ HdaCodecAudioIoStartPlaybackAsync(
   }
     HdaIo = AudioIoPrivateData->HdaCodecDev->HdaIo;
 
-    // Start stream.
-//    Status = HdaIo->StartStream(HdaIo, EfiHdaIoTypeOutput, Data, DataLength, Position,
-//        (VOID*)HdaCodecHdaIoStreamCallback, (VOID*)This, (VOID*)Callback, Context);
-  Status = HdaIo->StartStream(HdaIo, EfiHdaIoTypeOutput, Data, DataLength, Position,
-                              NULL, (VOID*)This, NULL, Context);
+    // Start stream. The controller refills its BDL ring from Data on its poll timer.
+    Status = HdaIo->StartStream(HdaIo, EfiHdaIoTypeOutput, Data, DataLength, Position,
+        (Callback != NULL) ? HdaCodecHdaIoStreamCallback : NULL, (VOID*)This, (VOID*)Callback, Context);
 
     return Status;
 }
@@ -86,24 +86,22 @@ HdaControllerStreamPollTimerHandler(
             goto CLEAR_BIT;
         }
 
-        // Determine number of bytes to pull from or push to source data.
-        HdaSourceLength = HDA_BDL_BLOCKSIZE;
-        if ((HdaStream->BufferSourcePosition + HdaSourceLength) > HdaStream->BufferSourceLength)
-            HdaSourceLength = HdaStream->BufferSourceLength - HdaStream->BufferSourcePosition;
-
         // Is this an output stream (copy data to)?
         if (HdaStream->Output) {
-            // Copy data to DMA buffer.
-            if (HdaSourceLength < HDA_BDL_BLOCKSIZE)
-                SetMem(HdaStream->BufferData + (HdaNextBlock * HDA_BDL_BLOCKSIZE), HDA_BDL_BLOCKSIZE, 0);
-            CopyMem(HdaStream->BufferData + (HdaNextBlock * HDA_BDL_BLOCKSIZE), HdaStream->BufferSource + HdaStream->BufferSourcePosition, HdaSourceLength);
+            // Copy or convert data to DMA buffer, this increases source position.
+            HdaControllerStreamFill(HdaStream, HdaStream->BufferData + (HdaNextBlock * HDA_BDL_BLOCKSIZE), HDA_BDL_BLOCKSIZE);
         } else { // Input stream (copy data from).
+            // Determine number of bytes to push to source data.
+            HdaSourceLength = HDA_BDL_BLOCKSIZE;
+            if ((HdaStream->BufferSourcePosition + HdaSourceLength) > HdaStream->BufferSourceLength)
+                HdaSourceLength = HdaStream->BufferSourceLength - HdaStream->BufferSourcePosition;
+
             // Copy data from DMA buffer.
             CopyMem(HdaStream->BufferSource + HdaStream->BufferSourcePosition, HdaStream->BufferData + (HdaNextBlock * HDA_BDL_BLOCKSIZE), HdaSourceLength);
-        }
 
-        // Increase source position.
-        HdaStream->BufferSourcePosition += HdaSourceLength;
+            // Increase source position.
+            HdaStream->BufferSourcePosition += HdaSourceLength;
+        }
 //        DEBUG((DEBUG_INFO, "Block %u of %u filled! (current position 0x%X, buffer 0x%X)\n",
 //            HdaStreamDmaPos / HDA_BDL_BLOCKSIZE, HDA_BDL_ENTRY_COUNT, HdaStreamDmaPos, HdaStream->BufferSourcePosition));
 
@@ -329,6 +327,7 @@ HdaControllerScanCodecs(
       HdaIoPrivateData->HdaIo.GetStream = HdaControllerHdaIoGetStream;
       HdaIoPrivateData->HdaIo.StartStream = HdaControllerHdaIoStartStream;
       HdaIoPrivateData->HdaIo.StopStream = HdaControllerHdaIoStopStream;
+      HdaIoPrivateData->HdaIo.SetStreamSource = HdaControllerHdaIoSetStreamSource;
       
       // Assign output stream.
       if (CurrentOutputStreamIndex < HdaControllerDev->OutputStreamsCount) {
@@ -420,7 +419,7 @@ HdaControllerSendCommands(
     UINT16 HdaCorbReadPointer = 0;
     UINT16 HdaRirbWritePointer = 0;
     BOOLEAN ResponseReceived;
-    UINT8 ResponseTimeout;
+    UINT32 ResponseTimeout;
     UINT64 RirbResponse;
     UINT32 VerbCommand;
     BOOLEAN Retry = FALSE;
@@ -451,7 +450,7 @@ START:
             //DEBUG((DEBUG_INFO, "old RP: 0x%X\n", HdaCorbReadPointer));
 
             // Add verbs to CORB until all of them are added or the CORB becomes full.
-            while (RemainingVerbs && ((HdaDev->CorbWritePointer + 1 % HdaDev->CorbEntryCount) != HdaCorbReadPointer)) {
+            while (RemainingVerbs && (((HdaDev->CorbWritePointer + 1) % HdaDev->CorbEntryCount) != HdaCorbReadPointer)) {
                 // Move write pointer and write verb to CORB.
                 HdaDev->CorbWritePointer++;
                 HdaDev->CorbWritePointer %= HdaDev->CorbEntryCount;
@@ -470,7 +469,7 @@ START:
 
         // Get responses from RIRB.
         ResponseReceived = FALSE;
-        ResponseTimeout = 10;
+        ResponseTimeout = HDA_RIRB_POLL_COUNT;
         while (!ResponseReceived) {
             // Get current RIRB write pointer.
             Status = PciIo->Mem.Read(PciIo, EfiPciIoWidthUint16, PCI_HDA_BAR, HDA_REG_RIRBWP, 1, &HdaRirbWritePointer);
@@ -506,9 +505,9 @@ START:
                 }
 
                 ResponseTimeout--;
-                gBS->Stall(MS_TO_MICROSECOND(5));
-              if (ResponseTimeout < 5) {
-                    DEBUG((DEBUG_INFO, "%u timeouts reached while waiting for response!\n", ResponseTimeout));
+                gBS->Stall(HDA_RIRB_POLL_STALL_US);
+              if (ResponseTimeout == HDA_RIRB_POLL_COUNT / 2) {
+                    DEBUG((DEBUG_INFO, "25 ms passed while waiting for response!\n"));
               }
             }
         }
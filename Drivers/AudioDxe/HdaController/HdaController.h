@@ -86,6 +86,10 @@ typedef struct {
 #define HDA_RIRB_CAD(Response)      ((Response >> 32) & 0xF)
 #define HDA_RIRB_UNSOL(Response)    ((Response >> 36) & 0x1)
 
+// RIRB polling. Codecs answer within microseconds, so poll in short steps; total budget stays 50 ms.
+#define HDA_RIRB_POLL_STALL_US  10
+#define HDA_RIRB_POLL_COUNT     (MS_TO_MICROSECOND(50) / HDA_RIRB_POLL_STALL_US)
+
 //
 // Streams.
 //
@@ -128,6 +132,23 @@ typedef struct {
 #define HDA_STREAM_ID_MIN       1
 #define HDA_STREAM_ID_MAX       15
 
+// Sample format converter of an output stream. Linear (2-tap) polyphase resampler
+// with Up phases: Up output frames for Down source frames, in integers only.
+#define HDA_CONVERT_MAX_CHANNELS    16
+typedef struct {
+    BOOLEAN Enabled;
+    UINT8 SrcBytes;
+    UINT8 SrcChannels;
+    UINT8 DstBytes;
+    UINT8 DstChannels;
+    UINT32 Up;
+    UINT32 Down;
+    UINT32 Phase;
+    UINT16 *Weights;
+    INT32 Cur[HDA_CONVERT_MAX_CHANNELS];
+    INT32 Next[HDA_CONVERT_MAX_CHANNELS];
+} HDA_STREAM_CONVERTER;
+
 // Stream structure.
 typedef struct {
     // Parent controller, type, and index.
@@ -151,6 +172,7 @@ typedef struct {
     UINTN BufferSourceLength;
     UINTN BufferSourcePosition;
     BOOLEAN BufferSourceDone;
+    HDA_STREAM_CONVERTER Converter;
 
     // Timing elements for buffer filling.
     EFI_EVENT PollTimer;
@@ -327,6 +349,15 @@ HdaControllerHdaIoStopStream(
     IN EFI_HDA_IO_PROTOCOL *This,
     IN EFI_HDA_IO_PROTOCOL_TYPE Type);
 
+EFI_STATUS
+EFIAPI
+HdaControllerHdaIoSetStreamSource(
+    IN EFI_HDA_IO_PROTOCOL *This,
+    IN EFI_HDA_IO_PROTOCOL_TYPE Type,
+    IN UINT32 Rate,
+    IN UINT8 Bits,
+    IN UINT8 Channels);
+
 //
 // HDA Controller Info protcol functions.
 //
@@ -435,6 +466,35 @@ HdaControllerSetStreamId(
     IN HDA_STREAM *HdaStream,
     IN UINT8 Index);
 
+//
+// Sample format conversion.
+//
+EFI_STATUS
+EFIAPI
+HdaControllerConvertSetup(
+    IN HDA_STREAM_CONVERTER *Converter,
+    IN UINT32 SrcRate,
+    IN UINT8 SrcBits,
+    IN UINT8 SrcChannels,
+    IN UINT16 Format);
+
+VOID
+EFIAPI
+HdaControllerConvertReset(
+    IN HDA_STREAM_CONVERTER *Converter);
+
+VOID
+EFIAPI
+HdaControllerConvertFree(
+    IN HDA_STREAM_CONVERTER *Converter);
+
+UINTN
+EFIAPI
+HdaControllerStreamFill(
+    IN HDA_STREAM *HdaStream,
+    IN UINT8 *Data,
+    IN UINTN Length);
+
 //
 // Driver Binding protocol functions.
 //
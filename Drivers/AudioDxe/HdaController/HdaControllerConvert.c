@@ -0,0 +1,256 @@
+/*
+ * File: HdaControllerConvert.c
+ *
+ * Sample format conversion of an output stream, done block by block by the stream
+ * poll timer while the DMA ring is refilled, so the source is never converted upfront.
+ * The source is WAV style PCM: 8-bit unsigned, 16/32-bit signed, 20/24-bit packed in
+ * 3 bytes. The stream gets the HDA containers: 1, 2 or 4 bytes, MSB justified.
+ * Samples are resampled as 32-bit values, the phase weights are computed once.
+ */
+
+#include "HdaController.h"
+
+STATIC
+UINT32
+HdaControllerConvertGcd(
+    IN UINT32 a,
+    IN UINT32 b)
+{
+    UINT32 t;
+
+    while (b != 0) {
+        t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+EFI_STATUS
+EFIAPI
+HdaControllerConvertSetup(
+    IN HDA_STREAM_CONVERTER *Converter,
+    IN UINT32 SrcRate,
+    IN UINT8 SrcBits,
+    IN UINT8 SrcChannels,
+    IN UINT16 Format)
+{
+    UINT32 DstRate;
+    UINT8 DstBytes;
+    UINT8 DstChannels;
+    UINT8 SrcBytes;
+    UINT32 Gcd;
+    UINT32 p;
+
+    HdaControllerConvertFree(Converter);
+
+    // Destination from the stream format.
+    DstRate = (Format & HDA_CONVERTER_FORMAT_BASE_44KHZ) ? 44100 : 48000;
+    DstRate = DstRate * (HDA_CONVERTER_FORMAT_MULT(Format) + 1) / (HDA_CONVERTER_FORMAT_DIV(Format) + 1);
+    DstChannels = HDA_CONVERTER_FORMAT_CHAN(Format) + 1;
+    switch (HDA_CONVERTER_FORMAT_BITS(Format)) {
+        case HDA_CONVERTER_FORMAT_BITS_8:
+            DstBytes = 1;
+            break;
+        case HDA_CONVERTER_FORMAT_BITS_16:
+            DstBytes = 2;
+            break;
+        default:
+            DstBytes = 4;
+            break;
+    }
+
+    switch (SrcBits) {
+        case 8:
+            SrcBytes = 1;
+            break;
+        case 16:
+            SrcBytes = 2;
+            break;
+        case 20:
+        case 24:
+            SrcBytes = 3;
+            break;
+        case 32:
+            SrcBytes = 4;
+            break;
+        default:
+            return EFI_UNSUPPORTED;
+    }
+    if ((SrcRate == 0) || (SrcChannels == 0) || (SrcChannels > HDA_CONVERT_MAX_CHANNELS))
+        return EFI_INVALID_PARAMETER;
+
+    // Same format, the samples are copied.
+    if ((SrcRate == DstRate) && (SrcBytes == DstBytes) && (SrcChannels == DstChannels))
+        return EFI_SUCCESS;
+
+    // The converter writes whole frames, they must not straddle two BDL blocks.
+    if ((HDA_BDL_BLOCKSIZE % (DstBytes * DstChannels)) != 0)
+        return EFI_UNSUPPORTED;
+
+    Gcd = HdaControllerConvertGcd(SrcRate, DstRate);
+    Converter->Up = DstRate / Gcd;
+    Converter->Down = SrcRate / Gcd;
+    if (Converter->Up > MAX_UINT16)
+        return EFI_UNSUPPORTED;
+    Converter->Weights = AllocatePool(Converter->Up * sizeof(UINT16));
+    if (Converter->Weights == NULL)
+        return EFI_OUT_OF_RESOURCES;
+    for (p = 0; p < Converter->Up; p++)
+        Converter->Weights[p] = (UINT16)((p << 16) / Converter->Up);
+
+    Converter->SrcBytes = SrcBytes;
+    Converter->SrcChannels = SrcChannels;
+    Converter->DstBytes = DstBytes;
+    Converter->DstChannels = DstChannels;
+    Converter->Enabled = TRUE;
+    HdaControllerConvertReset(Converter);
+    return EFI_SUCCESS;
+}
+
+VOID
+EFIAPI
+HdaControllerConvertReset(
+    IN HDA_STREAM_CONVERTER *Converter)
+{
+    // Starts from silence, the first source frame is read by the first output frame.
+    Converter->Phase = Converter->Up;
+    ZeroMem(Converter->Cur, sizeof(Converter->Cur));
+    ZeroMem(Converter->Next, sizeof(Converter->Next));
+}
+
+VOID
+EFIAPI
+HdaControllerConvertFree(
+    IN HDA_STREAM_CONVERTER *Converter)
+{
+    if (Converter->Weights != NULL)
+        FreePool(Converter->Weights);
+    ZeroMem(Converter, sizeof(HDA_STREAM_CONVERTER));
+}
+
+STATIC
+INT32
+HdaControllerConvertLoad(
+    IN CONST UINT8 *Src,
+    IN UINT8 Bytes)
+{
+    switch (Bytes) {
+        case 1:
+            return ((INT32)Src[0] - 0x80) * (1 << 24);
+        case 2:
+            return (INT32)(((UINT32)Src[0] << 16) | ((UINT32)Src[1] << 24));
+        case 3:
+            return (INT32)(((UINT32)Src[0] << 8) | ((UINT32)Src[1] << 16) | ((UINT32)Src[2] << 24));
+        default:
+            return (INT32)ReadUnaligned32((CONST UINT32*)Src);
+    }
+}
+
+STATIC
+VOID
+HdaControllerConvertStore(
+    IN UINT8 *Dst,
+    IN UINT8 Bytes,
+    IN INT32 Sample)
+{
+    switch (Bytes) {
+        case 1:
+            *Dst = (UINT8)((Sample >> 24) + 0x80);
+            break;
+        case 2:
+            WriteUnaligned16((UINT16*)Dst, (UINT16)(Sample >> 16));
+            break;
+        default:
+            WriteUnaligned32((UINT32*)Dst, (UINT32)Sample);
+            break;
+    }
+}
+
+// Reads the next source frame, mapped to the destination channels.
+STATIC
+VOID
+HdaControllerConvertReadFrame(
+    IN HDA_STREAM_CONVERTER *Converter,
+    IN CONST UINT8 *Src)
+{
+    INT64 Sum;
+    UINT8 c;
+
+    CopyMem(Converter->Cur, Converter->Next, Converter->DstChannels * sizeof(INT32));
+    if (Converter->DstChannels == 1 && Converter->SrcChannels > 1) {
+        // downmix
+        Sum = 0;
+        for (c = 0; c < Converter->SrcChannels; c++)
+            Sum += HdaControllerConvertLoad(Src + c * Converter->SrcBytes, Converter->SrcBytes);
+        Converter->Next[0] = (INT32)(Sum / Converter->SrcChannels);
+        return;
+    }
+    // extra source channels are dropped, missing ones repeat the source (mono to stereo)
+    for (c = 0; c < Converter->DstChannels; c++)
+        Converter->Next[c] = HdaControllerConvertLoad(Src + (c % Converter->SrcChannels) * Converter->SrcBytes,
+            Converter->SrcBytes);
+}
+
+/**
+  Fills a part of the DMA buffer from the stream source, converted if needed, and advances the
+  source position. What can't be filled is zeroed.
+
+  @retval The number of bytes filled from the source.
+**/
+UINTN
+EFIAPI
+HdaControllerStreamFill(
+    IN HDA_STREAM *HdaStream,
+    IN UINT8 *Data,
+    IN UINTN Length)
+{
+    HDA_STREAM_CONVERTER *Converter = &HdaStream->Converter;
+    CONST UINT8 *Src = HdaStream->BufferSource + HdaStream->BufferSourcePosition;
+    UINTN SrcLength = HdaStream->BufferSourceLength - HdaStream->BufferSourcePosition;
+    UINTN SrcFrame;
+    UINTN DstFrame;
+    UINTN Used = 0;
+    UINTN Out = 0;
+    INT32 Sample;
+    UINT16 Weight;
+    UINT8 c;
+
+    if (HdaStream->BufferSourcePosition >= HdaStream->BufferSourceLength)
+        SrcLength = 0;
+
+    if (!Converter->Enabled) {
+        Out = (Length < SrcLength) ? Length : SrcLength;
+        CopyMem(Data, Src, Out);
+        HdaStream->BufferSourcePosition += Out;
+    } else {
+        SrcFrame = Converter->SrcBytes * Converter->SrcChannels;
+        DstFrame = Converter->DstBytes * Converter->DstChannels;
+        while (Out + DstFrame <= Length) {
+            while (Converter->Phase >= Converter->Up) {
+                if (Used + SrcFrame > SrcLength)
+                    goto DONE;
+                HdaControllerConvertReadFrame(Converter, Src + Used);
+                Used += SrcFrame;
+                Converter->Phase -= Converter->Up;
+            }
+            Weight = Converter->Weights[Converter->Phase];
+            for (c = 0; c < Converter->DstChannels; c++) {
+                Sample = Converter->Cur[c] +
+                    (INT32)((((INT64)Converter->Next[c] - Converter->Cur[c]) * Weight) >> 16);
+                HdaControllerConvertStore(Data + Out, Converter->DstBytes, Sample);
+                Out += Converter->DstBytes;
+            }
+            Converter->Phase += Converter->Down;
+        }
+DONE:
+        HdaStream->BufferSourcePosition += Used;
+        // A partial frame left can't be played.
+        if (Out < Length)
+            HdaStream->BufferSourcePosition = HdaStream->BufferSourceLength;
+    }
+
+    if (Out < Length)
+        SetMem(Data + Out, Length - Out, 0);
+    return Out;
+}
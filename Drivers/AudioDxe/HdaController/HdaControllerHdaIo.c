@@ -187,6 +187,9 @@ HdaControllerHdaIoSetupStream(
     if (EFI_ERROR(Status))
         goto DONE;
 
+    // New format, the samples are copied until SetStreamSource() says otherwise.
+    HdaControllerConvertFree(&HdaStream->Converter);
+
     // Reset stream if format has changed.
     if (Format != HdaStreamFormat) {
         // Reset stream.
@@ -391,6 +394,7 @@ HdaControllerHdaIoStartStream(
 //        HdaStream->Index, HdaStreamDmaPos));
 
     // Save pointer to buffer.
+    HdaControllerConvertReset(&HdaStream->Converter);
     HdaStream->BufferSource = Buffer;
     HdaStream->BufferSourceLength = BufferLength;
     HdaStream->BufferSourcePosition = BufferPosition;
@@ -404,20 +408,13 @@ HdaControllerHdaIoStartStream(
 
     // Fill rest of current block.
     HdaStreamDmaRemainingLength = HDA_BDL_BLOCKSIZE - (HdaStreamDmaPos - (HdaStreamCurrentBlock * HDA_BDL_BLOCKSIZE));
-    if ((HdaStream->BufferSourcePosition + HdaStreamDmaRemainingLength) > BufferLength)
-        HdaStreamDmaRemainingLength = BufferLength;
-    CopyMem(HdaStream->BufferData + HdaStreamDmaPos, HdaStream->BufferSource + HdaStream->BufferSourcePosition, HdaStreamDmaRemainingLength);
-    HdaStream->BufferSourcePosition += HdaStreamDmaRemainingLength;
+    HdaControllerStreamFill(HdaStream, HdaStream->BufferData + HdaStreamDmaPos, HdaStreamDmaRemainingLength);
 //    DEBUG((DEBUG_INFO, "%u (0x%X) bytes written to 0x%X (block %u of %u)\n", HdaStreamDmaRemainingLength, HdaStreamDmaRemainingLength,
 //        HdaStream->BufferData + HdaStreamDmaPos, HdaStreamCurrentBlock, HDA_BDL_ENTRY_COUNT));
 
     // Fill next block.
     if (HdaStream->BufferSourcePosition < BufferLength) {
-        HdaStreamDmaRemainingLength = HDA_BDL_BLOCKSIZE;
-        if ((HdaStream->BufferSourcePosition + HdaStreamDmaRemainingLength) > BufferLength)
-            HdaStreamDmaRemainingLength = BufferLength;
-        CopyMem(HdaStream->BufferData + (HdaStreamNextBlock * HDA_BDL_BLOCKSIZE), HdaStream->BufferSource + HdaStream->BufferSourcePosition, HdaStreamDmaRemainingLength);
-        HdaStream->BufferSourcePosition += HdaStreamDmaRemainingLength;
+        HdaControllerStreamFill(HdaStream, HdaStream->BufferData + (HdaStreamNextBlock * HDA_BDL_BLOCKSIZE), HDA_BDL_BLOCKSIZE);
 //        DEBUG((DEBUG_INFO, "%u (0x%X) bytes written to 0x%X (block %u of %u)\n", HdaStreamDmaRemainingLength, HdaStreamDmaRemainingLength,
 //            HdaStream->BufferData + (HdaStreamNextBlock * HDA_BDL_BLOCKSIZE), HdaStreamNextBlock, HDA_BDL_ENTRY_COUNT));
     }
@@ -498,3 +495,36 @@ HdaControllerHdaIoStopStream(
     HdaStream->CallbackContext3 = NULL;
     return EFI_SUCCESS;
 }
+
+EFI_STATUS
+EFIAPI
+HdaControllerHdaIoSetStreamSource(
+    IN EFI_HDA_IO_PROTOCOL *This,
+    IN EFI_HDA_IO_PROTOCOL_TYPE Type,
+    IN UINT32 Rate,
+    IN UINT8 Bits,
+    IN UINT8 Channels)
+{
+    // Create variables.
+    EFI_STATUS Status;
+    HDA_IO_PRIVATE_DATA *HdaIoPrivateData;
+    EFI_PCI_IO_PROTOCOL *PciIo;
+    HDA_STREAM *HdaStream;
+    UINT16 HdaStreamFormat = 0;
+
+    // Only output streams are converted.
+    if ((This == NULL) || (Type != EfiHdaIoTypeOutput))
+        return EFI_INVALID_PARAMETER;
+
+    // Get private data and stream.
+    HdaIoPrivateData = HDA_IO_PRIVATE_DATA_FROM_THIS(This);
+    PciIo = HdaIoPrivateData->HdaControllerDev->PciIo;
+    HdaStream = HdaIoPrivateData->HdaOutputStream;
+
+    // Convert to the format set by SetupStream().
+    Status = PciIo->Mem.Read(PciIo, EfiPciIoWidthUint16, PCI_HDA_BAR,
+        HDA_REG_SDNFMT(HdaStream->Index), 1, &HdaStreamFormat);
+    if (EFI_ERROR(Status))
+        return Status;
+    return HdaControllerConvertSetup(&HdaStream->Converter, Rate, Bits, Channels, HdaStreamFormat);
+}
@@ -678,6 +678,7 @@ HdaControllerCleanupStreams(
 
         // Close polling timer.
         gBS->CloseEvent(HdaStream->PollTimer);
+        HdaControllerConvertFree(&HdaStream->Converter);
 
         // Stop stream.
         HdaControllerSetStreamId(HdaStream, 0);
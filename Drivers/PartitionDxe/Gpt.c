@@ -173,6 +173,334 @@ PartitionSetCrc (
   IN OUT EFI_TABLE_HEADER *Hdr
   );
 
+//
+// CRC32 of the partition entry array, 16KB for the usual 128 entries. The GPT
+// CRC is the IEEE polynomial, so the SSE4.2 crc32 instruction (Castagnoli) can't
+// be used; on X64 it is computed by carry-less multiply folding (Intel "Fast CRC
+// Computation for Generic Polynomials Using PCLMULQDQ") when CPUID reports
+// PCLMULQDQ, else by the boot services. Vector extensions and builtins are used,
+// there is no <immintrin.h> in the freestanding build.
+//
+//
+// The unused type GUID is all zero. Inline test for the entry scan, which is
+// quadratic in the number of entries.
+//
+#define GPT_ENTRY_UNUSED(Entry) \
+  ((ReadUnaligned64 ((UINT64 *) &(Entry)->PartitionTypeGUID) | \
+    ReadUnaligned64 ((UINT64 *) &(Entry)->PartitionTypeGUID + 1)) == 0)
+
+#if defined (MDE_CPU_X64) && defined (__GNUC__)
+#define GPT_CRC_PCLMUL  1
+typedef UINT64     GPT_V2U __attribute__((vector_size (16)));
+typedef UINT32     GPT_V4U __attribute__((vector_size (16)));
+typedef long long  GPT_V2I __attribute__((vector_size (16)));
+typedef UINT64     GPT_V2U_UNALIGNED __attribute__((vector_size (16), aligned (1)));
+
+#define GPT_CLMUL(a, b, Imm)  ((GPT_V2U)__builtin_ia32_pclmulqdq128 ((GPT_V2I)(a), (GPT_V2I)(b), (Imm)))
+#define GPT_FOLD(a, k)        (GPT_CLMUL (a, k, 0x00) ^ GPT_CLMUL (a, k, 0x11))
+#define GPT_LOAD(p)           (*(CONST GPT_V2U_UNALIGNED *)(p))
+
+//
+// 0 unknown, 1 PCLMULQDQ present, 2 absent
+//
+STATIC UINT8  mGptCrcPclmul = 0;
+
+/**
+  Fold the data into the CRC32 register (not inverted) with PCLMULQDQ.
+
+  @param  Data  The data, at least 64 bytes.
+  @param  Size  The size of the data, a multiple of 16.
+  @param  Crc   The CRC register.
+
+  @return The CRC register after the data.
+
+**/
+__attribute__((target ("pclmul")))
+STATIC
+UINT32
+PartitionCrc32Pclmul (
+  IN CONST UINT8  *Data,
+  IN UINTN        Size,
+  IN UINT32       Crc
+  )
+{
+  CONST GPT_V2U  K1K2  = { 0x154442bd4ULL, 0x1c6e41596ULL };
+  CONST GPT_V2U  K3K4  = { 0x1751997d0ULL, 0x0ccaa009eULL };
+  CONST GPT_V2U  K5    = { 0x163cd6124ULL, 0 };
+  CONST GPT_V2U  Poly  = { 0x1db710641ULL, 0x1f7011641ULL };
+  CONST GPT_V2U  Low32 = { 0xFFFFFFFFULL, 0xFFFFFFFFULL };
+  GPT_V2U        X1;
+  GPT_V2U        X2;
+  GPT_V2U        X3;
+  GPT_V2U        X4;
+  GPT_V4U        W;
+
+  X1 = GPT_LOAD (Data);
+  X2 = GPT_LOAD (Data + 16);
+  X3 = GPT_LOAD (Data + 32);
+  X4 = GPT_LOAD (Data + 48);
+  X1[0] ^= Crc;
+
+  //
+  // 4 x 128 bits in parallel, then down to 128 bits
+  //
+  for (Data += 64, Size -= 64; Size >= 64; Data += 64, Size -= 64) {
+    X1 = GPT_FOLD (X1, K1K2) ^ GPT_LOAD (Data);
+    X2 = GPT_FOLD (X2, K1K2) ^ GPT_LOAD (Data + 16);
+    X3 = GPT_FOLD (X3, K1K2) ^ GPT_LOAD (Data + 32);
+    X4 = GPT_FOLD (X4, K1K2) ^ GPT_LOAD (Data + 48);
+  }
+  X1 = GPT_FOLD (X1, K3K4) ^ X2;
+  X1 = GPT_FOLD (X1, K3K4) ^ X3;
+  X1 = GPT_FOLD (X1, K3K4) ^ X4;
+  for (; Size >= 16; Data += 16, Size -= 16) {
+    X1 = GPT_FOLD (X1, K3K4) ^ GPT_LOAD (Data);
+  }
+
+  //
+  // 128 to 64 bits, then Barrett reduction to 32 bits
+  //
+  X2 = GPT_CLMUL (X1, K3K4, 0x10);
+  X1 = (GPT_V2U){ X1[1], 0 } ^ X2;
+  W  = (GPT_V4U)X1;
+  X2 = (GPT_V2U)(GPT_V4U){ W[1], W[2], W[3], 0 };
+  X1 = GPT_CLMUL (X1 & Low32, K5, 0x00) ^ X2;
+  X2 = GPT_CLMUL (X1 & Low32, Poly, 0x10);
+  X2 = GPT_CLMUL (X2 & Low32, Poly, 0x00);
+  X1 ^= X2;
+  return ((GPT_V4U)X1)[1];
+}
+#else
+#define GPT_CRC_PCLMUL  0
+#endif
+
+/**
+  Calculate the CRC32 of a buffer, like gBS->CalculateCrc32().
+
+  @param[in]   Data    The buffer.
+  @param[in]   Size    The size of the buffer.
+  @param[out]  Crc32   The CRC32.
+
+  @retval EFI_SUCCESS  The CRC32 was calculated.
+  @retval other        gBS->CalculateCrc32() failed.
+
+**/
+STATIC
+EFI_STATUS
+PartitionCalculateCrc32 (
+  IN  VOID    *Data,
+  IN  UINTN   Size,
+  OUT UINT32  *Crc32
+  )
+{
+#if GPT_CRC_PCLMUL == 1
+  CONST UINT8  *Ptr;
+  UINT32       Crc;
+  UINT32       Ecx;
+  UINTN        Bit;
+
+  if (mGptCrcPclmul == 0) {
+    AsmCpuid (1, NULL, NULL, &Ecx, NULL);
+    mGptCrcPclmul = ((Ecx & BIT1) != 0) ? 1 : 2;
+  }
+  if (mGptCrcPclmul == 1 && Size >= 64) {
+    Ptr = (CONST UINT8 *) Data;
+    Crc = PartitionCrc32Pclmul (Ptr, Size & ~(UINTN) 15, 0xFFFFFFFF);
+    for (Ptr += Size & ~(UINTN) 15, Size &= 15; Size > 0; Ptr++, Size--) {
+      Crc ^= *Ptr;
+      for (Bit = 0; Bit < 8; Bit++) {
+        Crc = (Crc >> 1) ^ (0xEDB88320 & (0 - (Crc & 1)));
+      }
+    }
+    *Crc32 = ~Crc;
+    return EFI_SUCCESS;
+  }
+#endif
+  return gBS->CalculateCrc32 (Data, Size, Crc32);
+}
+
+//
+// GPT parse of the disks already scanned. A disk is scanned again on every
+// connect of the partition driver, when the primary header did not change the
+// backup header, the entry array and their CRC are not read again: the header
+// holds the CRC of the entries, so they can't change without it.
+//
+typedef struct {
+  LIST_ENTRY                  Link;
+  EFI_DEVICE_PATH_PROTOCOL    *DevicePath;
+  UINTN                       DevicePathSize;
+  UINT32                      MediaId;
+  UINT32                      BlockSize;
+  EFI_LBA                     LastBlock;
+  EFI_PARTITION_TABLE_HEADER  Header;
+  EFI_PARTITION_ENTRY         *PartEntry;
+  EFI_PARTITION_ENTRY_STATUS  *PEntryStatus;
+} GPT_CACHE_ENTRY;
+
+STATIC LIST_ENTRY  mGptCache = INITIALIZE_LIST_HEAD_VARIABLE (mGptCache);
+
+/**
+  Find the cached GPT parse of a disk.
+
+  @param[in]  DevicePath  Parent Device Path.
+
+  @return The cache entry of the disk, or NULL.
+
+**/
+STATIC
+GPT_CACHE_ENTRY *
+PartitionGptCacheFind (
+  IN  EFI_DEVICE_PATH_PROTOCOL     *DevicePath
+  )
+{
+  LIST_ENTRY       *Link;
+  GPT_CACHE_ENTRY  *Cache;
+  UINTN            Size;
+
+  Size = GetDevicePathSize (DevicePath);
+  for (Link = GetFirstNode (&mGptCache); !IsNull (&mGptCache, Link); Link = GetNextNode (&mGptCache, Link)) {
+    Cache = BASE_CR (Link, GPT_CACHE_ENTRY, Link);
+    if ((Cache->DevicePathSize == Size) && (CompareMem (Cache->DevicePath, DevicePath, Size) == 0)) {
+      return Cache;
+    }
+  }
+  return NULL;
+}
+
+/**
+  Use the cached GPT parse of a disk if the media and the primary header on the
+  disk did not change.
+
+  @param[in]  DevicePath     Parent Device Path.
+  @param[in]  BlockIo        Parent BlockIo interface.
+  @param[in]  DiskIo         Disk Io protocol.
+  @param[out] PartHeader     The cached primary header.
+  @param[out] PartEntry      A copy of the cached partition entries.
+  @param[out] PEntryStatus   A copy of the cached entry status.
+
+  @retval TRUE      The cached parse is returned.
+  @retval FALSE     No cached parse, or it is not valid any more.
+
+**/
+STATIC
+BOOLEAN
+PartitionGptCacheLookup (
+  IN  EFI_DEVICE_PATH_PROTOCOL     *DevicePath,
+  IN  EFI_BLOCK_IO_PROTOCOL        *BlockIo,
+  IN  EFI_DISK_IO_PROTOCOL         *DiskIo,
+  OUT EFI_PARTITION_TABLE_HEADER   *PartHeader,
+  OUT EFI_PARTITION_ENTRY          **PartEntry,
+  OUT EFI_PARTITION_ENTRY_STATUS   **PEntryStatus
+  )
+{
+  EFI_STATUS       Status;
+  GPT_CACHE_ENTRY  *Cache;
+  VOID             *Block;
+  BOOLEAN          Same;
+
+  if (DevicePath == NULL) {
+    return FALSE;
+  }
+  Cache = PartitionGptCacheFind (DevicePath);
+  if ((Cache == NULL) ||
+      (Cache->MediaId != BlockIo->Media->MediaId) ||
+      (Cache->BlockSize != BlockIo->Media->BlockSize) ||
+      (Cache->LastBlock != BlockIo->Media->LastBlock)) {
+    return FALSE;
+  }
+
+  Block = AllocatePool (Cache->BlockSize);
+  if (Block == NULL) {
+    return FALSE;
+  }
+  Status = DiskIo->ReadDisk (
+                     DiskIo,
+                     Cache->MediaId,
+                     MultU64x32 (PRIMARY_PART_HEADER_LBA, Cache->BlockSize),
+                     Cache->BlockSize,
+                     Block
+                     );
+  Same = (BOOLEAN) (!EFI_ERROR(Status) && (CompareMem (Block, &Cache->Header, sizeof (EFI_PARTITION_TABLE_HEADER)) == 0));
+  FreePool(Block);
+  if (!Same) {
+    return FALSE;
+  }
+
+  *PartEntry = AllocateCopyPool(Cache->Header.NumberOfPartitionEntries * Cache->Header.SizeOfPartitionEntry, Cache->PartEntry);
+  *PEntryStatus = AllocateCopyPool(Cache->Header.NumberOfPartitionEntries * sizeof (EFI_PARTITION_ENTRY_STATUS), Cache->PEntryStatus);
+  if ((*PartEntry == NULL) || (*PEntryStatus == NULL)) {
+    return FALSE;
+  }
+  CopyMem(PartHeader, &Cache->Header, sizeof (EFI_PARTITION_TABLE_HEADER));
+  return TRUE;
+}
+
+/**
+  Keep the GPT parse of a disk, replacing the previous one.
+
+  @param[in]  DevicePath     Parent Device Path.
+  @param[in]  BlockIo        Parent BlockIo interface.
+  @param[in]  PartHeader     The valid primary header.
+  @param[in]  PartEntry      The partition entries.
+  @param[in]  PEntryStatus   The entry status.
+
+**/
+STATIC
+VOID
+PartitionGptCacheSave (
+  IN  EFI_DEVICE_PATH_PROTOCOL     *DevicePath,
+  IN  EFI_BLOCK_IO_PROTOCOL        *BlockIo,
+  IN  EFI_PARTITION_TABLE_HEADER   *PartHeader,
+  IN  EFI_PARTITION_ENTRY          *PartEntry,
+  IN  EFI_PARTITION_ENTRY_STATUS   *PEntryStatus
+  )
+{
+  GPT_CACHE_ENTRY  *Cache;
+
+  if ((DevicePath == NULL) || (PartHeader->Header.Signature != EFI_PTAB_HEADER_ID)) {
+    return;
+  }
+
+  Cache = PartitionGptCacheFind (DevicePath);
+  if (Cache != NULL) {
+    FreePool(Cache->PartEntry);
+    FreePool(Cache->PEntryStatus);
+  } else {
+    Cache = AllocateZeroPool(sizeof (GPT_CACHE_ENTRY));
+    if (Cache == NULL) {
+      return;
+    }
+    Cache->DevicePathSize = GetDevicePathSize (DevicePath);
+    Cache->DevicePath     = AllocateCopyPool(Cache->DevicePathSize, DevicePath);
+    if (Cache->DevicePath == NULL) {
+      FreePool(Cache);
+      return;
+    }
+    InsertTailList (&mGptCache, &Cache->Link);
+  }
+
+  Cache->MediaId      = BlockIo->Media->MediaId;
+  Cache->BlockSize    = BlockIo->Media->BlockSize;
+  Cache->LastBlock    = BlockIo->Media->LastBlock;
+  CopyMem(&Cache->Header, PartHeader, sizeof (EFI_PARTITION_TABLE_HEADER));
+  Cache->PartEntry    = AllocateCopyPool(PartHeader->NumberOfPartitionEntries * PartHeader->SizeOfPartitionEntry, PartEntry);
+  Cache->PEntryStatus = AllocateCopyPool(PartHeader->NumberOfPartitionEntries * sizeof (EFI_PARTITION_ENTRY_STATUS), PEntryStatus);
+  if ((Cache->PartEntry == NULL) || (Cache->PEntryStatus == NULL)) {
+    //
+    // Not usable, a lookup fails on the MediaId.
+    //
+    if (Cache->PartEntry != NULL) {
+      FreePool(Cache->PartEntry);
+    }
+    if (Cache->PEntryStatus != NULL) {
+      FreePool(Cache->PEntryStatus);
+    }
+    RemoveEntryList (&Cache->Link);
+    FreePool(Cache->DevicePath);
+    FreePool(Cache);
+  }
+}
+
 /**
   Install child handles if the Handle supports GPT partition structure.
 
@@ -285,6 +613,19 @@ PartitionInstallGptChildHandles (
     goto Done;
   }
 
+  if (PartitionGptCacheLookup (DevicePath, BlockIo, DiskIo, PrimaryHeader, &PartEntry, &PEntryStatus)) {
+    GptValidStatus = EFI_SUCCESS;
+    goto CreateChildren;
+  }
+  if (PartEntry != NULL) {
+    FreePool(PartEntry);
+    PartEntry = NULL;
+  }
+  if (PEntryStatus != NULL) {
+    FreePool(PEntryStatus);
+    PEntryStatus = NULL;
+  }
+
   //
   // Check primary and backup partition tables
   //
@@ -305,7 +646,13 @@ PartitionInstallGptChildHandles (
         DEBUG ((EFI_D_INFO, " Restore backup partition table success\n"));
       }
     }
-  } else if (!PartitionValidGptTable (BlockIo, DiskIo, PrimaryHeader->AlternateLBA, BackupHeader)) {
+  }
+#ifdef PARTITION_GPT_PARANOID
+  //
+  // A valid primary is enough to use the disk, the backup header and its entry
+  // array are read, checked and restored only in the paranoid build.
+  //
+  else if (!PartitionValidGptTable (BlockIo, DiskIo, PrimaryHeader->AlternateLBA, BackupHeader)) {
     DEBUG ((EFI_D_INFO, " Valid primary and !Valid backup partition table\n"));
     DEBUG ((EFI_D_INFO, " Restore backup partition table by the primary\n"));
     if (!PartitionRestoreGptTable (BlockIo, DiskIo, PrimaryHeader)) {
@@ -317,6 +664,7 @@ PartitionInstallGptChildHandles (
     }
 
   }
+#endif
 
 //  DEBUG ((EFI_D_INFO, " Valid primary and Valid backup partition table\n"));
 
@@ -356,12 +704,14 @@ PartitionInstallGptChildHandles (
   // Check the integrity of partition entries
   //
   PartitionCheckGptEntry (PrimaryHeader, PartEntry, PEntryStatus);
+  PartitionGptCacheSave (DevicePath, BlockIo, PrimaryHeader, PartEntry, PEntryStatus);
 
   //
   // If we got this far the GPT layout of the disk is valid and we should return true
   //
   GptValidStatus = EFI_SUCCESS;
 
+CreateChildren:
   //
   // Create child device handles
   //
@@ -564,7 +914,7 @@ PartitionCheckGptEntryArrayCRC (
 
   Size    = PartHeader->NumberOfPartitionEntries * PartHeader->SizeOfPartitionEntry;
 
-  Status  = gBS->CalculateCrc32 (Ptr, Size, &Crc);
+  Status  = PartitionCalculateCrc32 (Ptr, Size, &Crc);
   if (EFI_ERROR(Status)) {
     DEBUG ((EFI_D_ERROR, "CheckPEntryArrayCRC: Crc calculation failed\n"));
     FreePool(Ptr);
@@ -707,7 +1057,7 @@ PartitionCheckGptEntry (
   DEBUG ((EFI_D_INFO, " start check partition entries\n"));
   for (Index1 = 0; Index1 < PartHeader->NumberOfPartitionEntries; Index1++) {
     Entry = (EFI_PARTITION_ENTRY *) ((UINT8 *) PartEntry + Index1 * PartHeader->SizeOfPartitionEntry);
-    if (CompareGuid (&Entry->PartitionTypeGUID, &gEfiPartTypeUnusedGuid)) {
+    if (GPT_ENTRY_UNUSED (Entry)) {
       continue;
     }
 
@@ -732,7 +1082,7 @@ PartitionCheckGptEntry (
 
     for (Index2 = Index1 + 1; Index2 < PartHeader->NumberOfPartitionEntries; Index2++) {
       Entry = (EFI_PARTITION_ENTRY *) ((UINT8 *) PartEntry + Index2 * PartHeader->SizeOfPartitionEntry);
-      if (CompareGuid (&Entry->PartitionTypeGUID, &gEfiPartTypeUnusedGuid)) {
+      if (GPT_ENTRY_UNUSED (Entry)) {
         continue;
       }
 
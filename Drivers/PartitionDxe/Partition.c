@@ -874,6 +874,32 @@ PartitionCreateAccessTask (
   return Task;
 }
 
+/**
+  Check if a BlockIo2 request can go straight to the parent BlockIo2: the
+  partition has the parent block size and the buffer meets the parent IoAlign.
+  DiskIo2 handles the other requests.
+
+  @param  Private  The partition.
+  @param  Buffer   The buffer of the request.
+
+  @retval TRUE     Forward the token to ParentBlockIo2.
+  @retval FALSE    Use DiskIo2.
+**/
+BOOLEAN
+PartitionForwardBlockIo2 (
+  IN PARTITION_PRIVATE_DATA  *Private,
+  IN VOID                    *Buffer
+  )
+{
+  UINT32                    IoAlign;
+
+  if (!Private->ForwardBlockIo2) {
+    return FALSE;
+  }
+  IoAlign = Private->ParentBlockIo2->Media->IoAlign;
+  return (BOOLEAN) ((IoAlign <= 1) || (((UINTN) Buffer & (IoAlign - 1)) == 0));
+}
+
 /**
   Read BufferSize bytes from Lba into Buffer.
   
@@ -934,6 +960,10 @@ PartitionReadBlocksEx (
     return ProbeMediaStatusEx (Private->DiskIo2, MediaId, EFI_INVALID_PARAMETER);
   }
 
+  if (PartitionForwardBlockIo2 (Private, Buffer)) {
+    return Private->ParentBlockIo2->ReadBlocksEx (Private->ParentBlockIo2, MediaId, Lba + Private->StartLba, Token, BufferSize, Buffer);
+  }
+
   if ((Token != NULL) && (Token->Event != NULL)) {
     Task = PartitionCreateAccessTask (Token);
     if (Task == NULL) {
@@ -1009,7 +1039,11 @@ PartitionWriteBlocksEx (
   if (Offset + BufferSize > Private->End) {
     return ProbeMediaStatusEx (Private->DiskIo2, MediaId, EFI_INVALID_PARAMETER);
   }
-  
+
+  if (PartitionForwardBlockIo2 (Private, Buffer)) {
+    return Private->ParentBlockIo2->WriteBlocksEx (Private->ParentBlockIo2, MediaId, Lba + Private->StartLba, Token, BufferSize, Buffer);
+  }
+
   if ((Token != NULL) && (Token->Event != NULL)) {
     Task = PartitionCreateAccessTask (Token);
     if (Task == NULL) {
@@ -1162,6 +1196,11 @@ PartitionInstallChildHandle (
     Private->BlockIo2.ReadBlocksEx   = PartitionReadBlocksEx;
     Private->BlockIo2.WriteBlocksEx  = PartitionWriteBlocksEx;
     Private->BlockIo2.FlushBlocksEx  = PartitionFlushBlocksEx; 
+
+    if (ParentBlockIo2->Media->BlockSize == BlockSize) {
+      Private->ForwardBlockIo2 = TRUE;
+      Private->StartLba        = DivU64x32 (Private->Start, BlockSize);
+    }
   }
 
   Private->Media.IoAlign   = 0;
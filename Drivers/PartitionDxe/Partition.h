@@ -67,6 +67,12 @@ typedef struct {
   UINT64                    Start;
   UINT64                    End;
   UINT32                    BlockSize;
+  //
+  // Same block size as the parent: the BlockIo2 tokens are forwarded to
+  // ParentBlockIo2 with the Lba moved by StartLba, without a DiskIo2 task.
+  //
+  BOOLEAN                   ForwardBlockIo2;
+  EFI_LBA                   StartLba;
 
   EFI_GUID                  *EspGuid;
 
@@ -684,6 +684,7 @@ UsbFindChild (
 
   @param  HubIf                 The HUB that has the device connected.
   @param  Port                  The port index of the hub (started with zero).
+  @param  Stable                The caller already waited for the connection to be stable.
 
   @retval EFI_SUCCESS           The device is enumerated (added or removed).
   @retval EFI_OUT_OF_RESOURCES  Failed to allocate resource for the device.
@@ -693,7 +694,8 @@ UsbFindChild (
 EFI_STATUS
 UsbEnumerateNewDev (
   IN USB_INTERFACE        *HubIf,
-  IN UINT8                Port
+  IN UINT8                Port,
+  IN BOOLEAN              Stable
   )
 {
   USB_BUS                 *Bus;
@@ -709,8 +711,10 @@ UsbEnumerateNewDev (
   Bus     = Parent->Bus;
   HubApi  = HubIf->HubApi;  
   Address = Bus->MaxDevices;
-  DBG("USB_WAIT_PORT_STABLE_STALL\n");
-  gBS->Stall (USB_WAIT_PORT_STABLE_STALL); //100ms
+  if (!Stable) {
+    DBG("USB_WAIT_PORT_STABLE_STALL\n");
+    gBS->Stall (USB_WAIT_PORT_STABLE_STALL); //100ms
+  }
   
   //
   // Hub resets the device for at least 10 milliseconds.
@@ -917,6 +921,7 @@ ON_ERROR:
 
   @param  HubIf                 The HUB that has the device connected.
   @param  Port                  The port index of the hub (started with zero).
+  @param  Stable                The caller already waited for the connection to be stable.
 
   @retval EFI_SUCCESS           The device is enumerated (added or removed).
   @retval EFI_OUT_OF_RESOURCES  Failed to allocate resource for the device.
@@ -926,7 +931,8 @@ ON_ERROR:
 EFI_STATUS
 UsbEnumeratePort (
   IN USB_INTERFACE        *HubIf,
-  IN UINT8                Port
+  IN UINT8                Port,
+  IN BOOLEAN              Stable
   )
 {
   USB_HUB_API             *HubApi;
@@ -952,7 +958,7 @@ UsbEnumeratePort (
   // Only handle connection/enable/overcurrent/reset change.
   // Usb super speed hub may report other changes, such as warm reset change. Ignore them.
   //
-  if ((PortState.PortChangeStatus & (USB_PORT_STAT_C_CONNECTION | USB_PORT_STAT_C_ENABLE | USB_PORT_STAT_C_OVERCURRENT | USB_PORT_STAT_C_RESET)) == 0) {
+  if ((PortState.PortChangeStatus & USB_PORT_STAT_C_ENUMERATED) == 0) {
     return EFI_SUCCESS;
   }
 
@@ -1027,7 +1033,7 @@ UsbEnumeratePort (
     //
 //   DEBUG (( EFI_D_INFO, "UsbEnumeratePort: new device connected at port %d\n", Port));
     DBG("UsbEnumeratePort: new device connected at port %d\n", Port);
-    Status = UsbEnumerateNewDev (HubIf, Port);
+    Status = UsbEnumerateNewDev (HubIf, Port, Stable);
   
   } else {
 //    DEBUG (( EFI_D_INFO, "UsbEnumeratePort: device disconnected event on port %d\n", Port));
@@ -1040,6 +1046,84 @@ UsbEnumeratePort (
 }
 
 
+/**
+  Enumerate the ports of a hub. The devices connected to several ports are
+  waited for once, not 100ms each. A device has to be reset and addressed
+  alone, because it answers at address 0 until then, so the rest stays one
+  port after the other. The low speed devices, mostly keyboards and mice,
+  are enumerated first to get the input working as soon as possible.
+
+  @param  HubIf                 The HUB interface.
+  @param  PortMap               The ports to enumerate, bit N for the port N.
+
+**/
+VOID
+UsbEnumeratePorts (
+  IN USB_INTERFACE        *HubIf,
+  IN UINT8                *PortMap
+  )
+{
+  USB_HUB_API             *HubApi;
+  EFI_USB_PORT_STATUS     PortState;
+  UINT8                   Stable[USB_PORT_MAP_SIZE];
+  UINT8                   LowSpeed[USB_PORT_MAP_SIZE];
+  BOOLEAN                 Connected;
+  BOOLEAN                 IsLowSpeed;
+  UINT8                   Pass;
+  UINTN                   Index;
+  EFI_STATUS              Status;
+
+  HubApi    = HubIf->HubApi;
+  Connected = FALSE;
+  ZeroMem (Stable, sizeof (Stable));
+  ZeroMem (LowSpeed, sizeof (LowSpeed));
+
+  //
+  // Find the ports that will get a new device, see UsbEnumeratePort. Hubs
+  // that report the low speed bit at the connection, before the port reset,
+  // get their low speed devices enumerated first.
+  //
+  for (Index = 0; Index < HubIf->NumOfPort; Index++) {
+    if (!USB_BIT_IS_SET (PortMap[Index / 8], USB_BIT (Index % 8))) {
+      continue;
+    }
+    Status = HubApi->GetPortStatus (HubIf, (UINT8) Index, &PortState);
+    if (EFI_ERROR(Status) ||
+        ((PortState.PortChangeStatus & USB_PORT_STAT_C_ENUMERATED) == 0) ||
+        !USB_BIT_IS_SET (PortState.PortStatus, USB_PORT_STAT_CONNECTION)) {
+      continue;
+    }
+    Connected = TRUE;
+    Stable[Index / 8] |= (UINT8) USB_BIT (Index % 8);
+    if (USB_BIT_IS_SET (PortState.PortStatus, USB_PORT_STAT_LOW_SPEED)) {
+      LowSpeed[Index / 8] |= (UINT8) USB_BIT (Index % 8);
+    }
+  }
+
+  if (Connected) {
+    DBG("USB_WAIT_PORT_STABLE_STALL\n");
+    gBS->Stall (USB_WAIT_PORT_STABLE_STALL); //100ms for all the ports
+  }
+
+  //
+  // A port connected in the meantime isn't in Stable, UsbEnumerateNewDev waits for it.
+  //
+  for (Pass = 0; Pass < 2; Pass++) {
+    for (Index = 0; Index < HubIf->NumOfPort; Index++) {
+      if (!USB_BIT_IS_SET (PortMap[Index / 8], USB_BIT (Index % 8))) {
+        continue;
+      }
+      IsLowSpeed = USB_BIT_IS_SET (LowSpeed[Index / 8], USB_BIT (Index % 8));
+      if (IsLowSpeed != (Pass == 0)) {
+        continue;
+      }
+      UsbEnumeratePort (HubIf, (UINT8) Index, USB_BIT_IS_SET (Stable[Index / 8], USB_BIT (Index % 8)));
+      DBG("Port %d enumerated\n", Index);
+    }
+  }
+}
+
+
 /**
   Enumerate all the changed hub ports.
 
@@ -1059,6 +1143,7 @@ UsbHubEnumeration (
   UINT8                   Bit;
   UINT8                   Index;
   USB_DEVICE              *Child;
+  UINT8                   PortMap[USB_PORT_MAP_SIZE];
 
 //  ASSERT (Context != NULL);
   if (!Context) {
@@ -1085,16 +1170,18 @@ UsbHubEnumeration (
   //
   Byte  = 0;
   Bit   = 1;
+  ZeroMem (PortMap, sizeof (PortMap));
   DBG("Enumerate %d ports\n", HubIf->NumOfPort);
   for (Index = 0; Index < HubIf->NumOfPort; Index++) {
     if (USB_BIT_IS_SET (HubIf->ChangeMap[Byte], USB_BIT (Bit))) {
-      UsbEnumeratePort (HubIf, Index);
-      DBG("Port %d enumerated\n", Index);
+      PortMap[Index / 8] |= (UINT8) USB_BIT (Index % 8);
     }
 
     USB_NEXT_BIT (Byte, Bit);
   }
 
+  UsbEnumeratePorts (HubIf, PortMap);
+
   UsbHubAckHubStatus (HubIf->Device);
 
   gBS->FreePool(HubIf->ChangeMap);
@@ -1120,6 +1207,7 @@ UsbRootHubEnumeration (
   USB_INTERFACE           *RootHub;
   UINT8                   Index;
   USB_DEVICE              *Child;
+  UINT8                   PortMap[USB_PORT_MAP_SIZE];
 
   RootHub = (USB_INTERFACE *) Context;
   if (!RootHub) {
@@ -1134,7 +1222,8 @@ UsbRootHubEnumeration (
       UsbRemoveDevice (Child);
       DBG("device removed\n");
     }
-    
-    UsbEnumeratePort (RootHub, Index);
   }
+
+  SetMem (PortMap, sizeof (PortMap), 0xFF);
+  UsbEnumeratePorts (RootHub, PortMap);
 }
@@ -28,6 +28,17 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
             }                 \
           } while (0)
 
+//
+// Port changes handled by the enumeration. Usb super speed hub may
+// report other changes, such as warm reset change.
+//
+#define USB_PORT_STAT_C_ENUMERATED  (USB_PORT_STAT_C_CONNECTION | USB_PORT_STAT_C_ENABLE | \
+                                     USB_PORT_STAT_C_OVERCURRENT | USB_PORT_STAT_C_RESET)
+
+//
+// Size of a bit map with one bit per hub port, up to 255 ports.
+//
+#define USB_PORT_MAP_SIZE           32
 
 //
 // Common interface used by usb bus enumeration process.
@@ -54,8 +54,8 @@ UsbHcAllocMemBlock (
 //  ASSERT (USBHC_MEM_UNIT * 8 <= EFI_PAGE_SIZE);
 
   Block->BufLen   = EFI_PAGES_TO_SIZE (Pages);
-  Block->BitsLen  = Block->BufLen / (USBHC_MEM_UNIT * 8);
-  Block->Bits     = AllocateZeroPool(Block->BitsLen);
+  Block->BitsLen  = Block->BufLen / (USBHC_MEM_UNIT * 64);
+  Block->Bits     = AllocateZeroPool(Block->BitsLen * sizeof (UINT64));
 
   if (Block->Bits == NULL) {
     gBS->FreePool(Block);
@@ -139,6 +139,158 @@ UsbHcFreeMemBlock (
 }
 
 
+/**
+  Get the index of the lowest bit set.
+
+  @param  Data           The bits, must not be 0.
+
+  @return The index of the lowest bit set.
+
+**/
+STATIC
+UINTN
+UsbHcLowBit (
+  IN UINT64               Data
+  )
+{
+#if defined(__GNUC__)
+  return (UINTN) __builtin_ctzll (Data);
+#else
+  return (UINTN) LowBitSet64 (Data);
+#endif
+}
+
+
+/**
+  Mark a range of units of the block as allocated or free, a word at a time.
+
+  @param  Block          The memory block.
+  @param  Start          The first unit.
+  @param  Units          Number of units.
+  @param  Allocated      TRUE to set the bits, FALSE to clear them.
+
+**/
+STATIC
+VOID
+UsbHcMarkUnits (
+  IN USBHC_MEM_BLOCK      *Block,
+  IN UINTN                Start,
+  IN UINTN                Units,
+  IN BOOLEAN              Allocated
+  )
+{
+  UINTN                   Count;
+  UINT64                  Mask;
+
+  while (Units > 0) {
+    Count = MIN (Units, 64 - (Start % 64));
+    Mask  = ((Count == 64) ? MAX_UINT64 : ((1ULL << Count) - 1)) << (Start % 64);
+    if (Allocated) {
+      Block->Bits[Start / 64] |= Mask;
+    } else {
+      Block->Bits[Start / 64] &= ~Mask;
+    }
+    Start += Count;
+    Units -= Count;
+  }
+}
+
+
+/**
+  Are all the units of a range free?
+
+  @param  Block          The memory block.
+  @param  Start          The first unit.
+  @param  Units          Number of units.
+
+  @retval TRUE           The units are free.
+  @retval FALSE          At least one unit is allocated.
+
+**/
+STATIC
+BOOLEAN
+UsbHcIsRangeFree (
+  IN USBHC_MEM_BLOCK      *Block,
+  IN UINTN                Start,
+  IN UINTN                Units
+  )
+{
+  UINTN                   Count;
+  UINT64                  Mask;
+
+  while (Units > 0) {
+    Count = MIN (Units, 64 - (Start % 64));
+    Mask  = ((Count == 64) ? MAX_UINT64 : ((1ULL << Count) - 1)) << (Start % 64);
+    if ((Block->Bits[Start / 64] & Mask) != 0) {
+      return FALSE;
+    }
+    Start += Count;
+    Units -= Count;
+  }
+  return TRUE;
+}
+
+
+/**
+  Find the first run of free units in the block. Allocated words are skipped
+  whole and the runs are measured with find first set, not bit by bit.
+
+  @param  Block          The memory block.
+  @param  Units          Number of units of the run.
+
+  @return The first unit of the run, or the number of units of the block if
+          there is no such run.
+
+**/
+STATIC
+UINTN
+UsbHcFindFreeUnits (
+  IN USBHC_MEM_BLOCK      *Block,
+  IN UINTN                Units
+  )
+{
+  UINTN                   Total;
+  UINTN                   Index;
+  UINTN                   Start;
+  UINT64                  Data;
+
+  Total = Block->BitsLen * 64;
+  Index = 0;
+
+  while (Index + Units <= Total) {
+    //
+    // Move to the next free unit.
+    //
+    Data = ~Block->Bits[Index / 64] >> (Index % 64);
+    if (Data == 0) {
+      Index = (Index / 64 + 1) * 64;
+      continue;
+    }
+    Index += UsbHcLowBit (Data);
+
+    //
+    // Move to the next allocated unit, or far enough.
+    //
+    Start = Index;
+    while ((Index - Start < Units) && (Index < Total)) {
+      Data = Block->Bits[Index / 64] >> (Index % 64);
+      if (Data == 0) {
+        Index = (Index / 64 + 1) * 64;
+      } else {
+        Index += UsbHcLowBit (Data);
+        break;
+      }
+    }
+
+    if (Index - Start >= Units) {
+      return Start;
+    }
+  }
+
+  return Total;
+}
+
+
 /**
   Alloc some memory from the block.
 
@@ -155,67 +307,36 @@ UsbHcAllocMemFromBlock (
   IN  UINTN               Units
   )
 {
-  UINTN                   Byte;
-  UINT8                   Bit;
-  UINTN                   StartByte;
-  UINT8                   StartBit;
-  UINTN                   Available;
-  UINTN                   Count;
+  UINTN                   Total;
+  UINTN                   Start;
 
 //  ASSERT ((Block != 0) && (Units != 0));
   if (!Block || !Units) {
     return NULL;
   }
 
-  StartByte  = 0;
-  StartBit   = 0;
-  Available  = 0;
-
-  for (Byte = 0, Bit = 0; Byte < Block->BitsLen;) {
-    //
-    // If current bit is zero, the corresponding memory unit is
-    // available, otherwise we need to restart our searching.
-    // Available counts the consective number of zero bit.
-    //
-    if (!USB_HC_BIT_IS_SET (Block->Bits[Byte], Bit)) {
-      Available++;
-
-      if (Available >= Units) {
-        break;
-      }
-
-      NEXT_BIT (Byte, Bit);
-
-    } else {
-      NEXT_BIT (Byte, Bit);
+  Total = Block->BitsLen * 64;
 
-      Available  = 0;
-      StartByte  = Byte;
-      StartBit   = Bit;
+  //
+  // The transfers allocate and free the same sizes over and over, so the
+  // units freed last, or the ones after the last allocation, are tried first.
+  //
+  if ((Block->Hint + Units <= Total) && UsbHcIsRangeFree (Block, Block->Hint, Units)) {
+    Start = Block->Hint;
+  } else {
+    Start = UsbHcFindFreeUnits (Block, Units);
+    if (Start >= Total) {
+      return NULL;
     }
   }
 
-  if (Available < Units) {
-    return NULL;
-  }
-
   //
   // Mark the memory as allocated
   //
-  Byte  = StartByte;
-  Bit   = StartBit;
-
-  for (Count = 0; Count < Units; Count++) {
-//    ASSERT (!USB_HC_BIT_IS_SET (Block->Bits[Byte], Bit));
-    if (USB_HC_BIT_IS_SET (Block->Bits[Byte], Bit)) {
-      break;
-    }
+  UsbHcMarkUnits (Block, Start, Units, TRUE);
+  Block->Hint = Start + Units;
 
-    Block->Bits[Byte] = (UINT8) (Block->Bits[Byte] | USB_HC_BIT (Bit));
-    NEXT_BIT (Byte, Bit);
-  }
-
-  return Block->BufHost + (StartByte * 8 + StartBit) * USBHC_MEM_UNIT;
+  return Block->BufHost + Start * USBHC_MEM_UNIT;
 }
 
 /**
@@ -426,6 +547,7 @@ UsbHcInitMemPool (
   }
 
   Pool->PciIo   = PciIo;
+  Pool->Hint    = NULL;
   Pool->Head    = UsbHcAllocMemBlock (Pool, USBHC_MEM_DEFAULT_PAGES);
 
   if (Pool->Head == NULL) {
@@ -510,9 +632,21 @@ UsbHcAllocateMem (
   }
 
   //
-  // First check whether current memory blocks can satisfy the allocation.
+  // First try the block of the last free, then check whether current
+  // memory blocks can satisfy the allocation.
   //
+  if (Pool->Hint != NULL) {
+    Mem = UsbHcAllocMemFromBlock (Pool->Hint, AllocSize / USBHC_MEM_UNIT);
+    if (Mem != NULL) {
+      ZeroMem (Mem, Size);
+      return Mem;
+    }
+  }
+
   for (Block = Head; Block != NULL; Block = Block->Next) {
+    if (Block == Pool->Hint) {
+      continue;
+    }
     Mem = UsbHcAllocMemFromBlock (Block, AllocSize / USBHC_MEM_UNIT);
 
     if (Mem != NULL) {
@@ -577,9 +711,7 @@ UsbHcFreeMem (
   USBHC_MEM_BLOCK         *Block;
   UINT8                   *ToFree;
   UINTN                   AllocSize;
-  UINTN                   Byte;
-  UINTN                   Bit;
-  UINTN                   Count;
+  UINTN                   Start;
 
   if (!Pool || !Mem) {
     return;
@@ -596,23 +728,13 @@ UsbHcFreeMem (
     //
     if ((Block->BufHost <= ToFree) && ((ToFree + AllocSize) <= (Block->BufHost + Block->BufLen))) {
       //
-      // compute the start byte and bit in the bit array
-      //
-      Byte  = ((ToFree - Block->BufHost) / USBHC_MEM_UNIT) / 8;
-      Bit   = ((ToFree - Block->BufHost) / USBHC_MEM_UNIT) % 8;
-
-      //
-      // reset associated bits in bit array
+      // reset associated bits in bit array, the next allocation of
+      // the same size gets these units back
       //
-      for (Count = 0; Count < (AllocSize / USBHC_MEM_UNIT); Count++) {
-//        ASSERT (USB_HC_BIT_IS_SET (Block->Bits[Byte], Bit));
-        if (!(USB_HC_BIT_IS_SET (Block->Bits[Byte], Bit))) {
-          continue;
-        }
-
-        Block->Bits[Byte] = (UINT8) (Block->Bits[Byte] ^ USB_HC_BIT (Bit));
-        NEXT_BIT (Byte, Bit);
-      }
+      Start = (ToFree - Block->BufHost) / USBHC_MEM_UNIT;
+      UsbHcMarkUnits (Block, Start, AllocSize / USBHC_MEM_UNIT, FALSE);
+      Block->Hint = Start;
+      Pool->Hint  = Block;
 
       break;
     }
@@ -632,6 +754,7 @@ UsbHcFreeMem (
   // Release the current memory block if it is empty and not the head
   //
   if ((Block != Head) && UsbHcIsMemBlockEmpty (Block)) {
+    Pool->Hint = NULL;
     UsbHcUnlinkMemBlock (Head, Block);
     UsbHcFreeMemBlock (Pool, Block);
   }
@@ -16,15 +16,11 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #ifndef _EFI_XHCI_MEM_H_
 #define _EFI_XHCI_MEM_H_
 
-#define USB_HC_BIT(a)                  ((UINTN)(1 << (a)))
-
-#define USB_HC_BIT_IS_SET(Data, Bit)   \
-          ((BOOLEAN)(((Data) & USB_HC_BIT(Bit)) == USB_HC_BIT(Bit)))
-
 typedef struct _USBHC_MEM_BLOCK USBHC_MEM_BLOCK;
 struct _USBHC_MEM_BLOCK {
-  UINT8                   *Bits;    // Bit array to record which unit is allocated
-  UINTN                   BitsLen;
+  UINT64                  *Bits;    // Bit array to record which unit is allocated
+  UINTN                   BitsLen;  // Number of 64 bits words
+  UINTN                   Hint;     // Unit tried first by the next allocation
   UINT8                   *Buf;
   UINT8                   *BufHost;
   UINTN                   BufLen;   // Memory size in bytes
@@ -42,6 +38,7 @@ typedef struct _USBHC_MEM_POOL {
   BOOLEAN                 Check4G;
   UINT32                  Which4G;
   USBHC_MEM_BLOCK         *Head;
+  USBHC_MEM_BLOCK         *Hint;    // Block of the last free, tried first
 } USBHC_MEM_POOL;
 
 //
@@ -54,18 +51,6 @@ typedef struct _USBHC_MEM_POOL {
 
 #define USBHC_MEM_ROUND(Len)  (((Len) + USBHC_MEM_UNIT_MASK) & (~USBHC_MEM_UNIT_MASK))
 
-//
-// Advance the byte and bit to the next bit, adjust byte accordingly.
-//
-#define NEXT_BIT(Byte, Bit)   \
-          do {                \
-            (Bit)++;          \
-            if ((Bit) > 7) {  \
-              (Byte)++;       \
-              (Bit) = 0;      \
-            }                 \
-          } while (0)
-
 
 
 /**
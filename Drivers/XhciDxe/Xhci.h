@@ -71,6 +71,13 @@ typedef struct _USB_DEV_CONTEXT      USB_DEV_CONTEXT;
 //
 #define XHC_POLL_DELAY               (100)
 //
+// Synchronous transfer polling: checks of the event ring in memory before the
+// first stall, then the stall doubles up to XHC_POLL_MAX_STALL.
+// The unit of XHC_POLL_MAX_STALL is microsecond.
+//
+#define XHC_POLL_SPIN_COUNT          (64)
+#define XHC_POLL_MAX_STALL           (8)
+//
 #define XHC_ASYNC_TIMER_INTERVAL     EFI_TIMER_PERIOD_MILLISECONDS(1)
 
 //
@@ -1313,9 +1313,34 @@ EXIT:
 }
 
 
+/**
+  Check in memory, without register access, if the controller wrote a new event.
+
+  @param  Xhc               The XHCI Instance.
+
+  @return TRUE if the event at the dequeue pointer belongs to the current cycle.
+
+**/
+STATIC
+BOOLEAN
+XhcIsEventPending (
+  IN  USB_XHCI_INSTANCE   *Xhc
+  )
+{
+  volatile TRB_TEMPLATE   *EvtTrb;
+
+  EvtTrb = Xhc->EventRing.EventRingDequeue;
+  return (BOOLEAN)(EvtTrb->CycleBit == Xhc->EventRing.EventRingCCS);
+}
+
 /**
   Execute the transfer by polling the URB. This is a synchronous operation.
 
+  The event ring is read in memory first, the URB result and the controller
+  registers are only checked when an event came, or every millisecond to see
+  a halted controller. Short transfers are caught while spinning, long ones
+  back off to XHC_POLL_MAX_STALL between checks.
+
   @param  Xhc               The XHCI Instance.
   @param  CmdTransfer       The executed URB is for cmd transfer or not.
   @param  Urb               The URB to execute.
@@ -1336,10 +1361,12 @@ XhcExecTransfer (
 {
   EFI_STATUS              Status;
   UINTN                   Index;
-  UINT64                  Loop;
+  UINTN                   Stall;
+  UINTN                   SinceCheck;
   UINT8                   SlotId;
   UINT8                   Dci;
   BOOLEAN                 Finished;
+  EFI_EVENT               TimeoutEvent;
 
   if (CmdTransfer) {
     SlotId = 0;
@@ -1357,23 +1384,62 @@ XhcExecTransfer (
     }
   }
 
-  Status = EFI_SUCCESS;
-  Loop   = Timeout * XHC_1_MILLISECOND;
-  if (Timeout == 0) {
-    Loop = 0xFFFFFFFF;
+  //
+  // The timeout is measured by a timer, the stalls below are much shorter
+  // than the firmware overhead around them.
+  //
+  TimeoutEvent = NULL;
+  if (Timeout != 0) {
+    Status = gBS->CreateEvent (EVT_TIMER, TPL_CALLBACK, NULL, NULL, &TimeoutEvent);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+    Status = gBS->SetTimer (TimeoutEvent, TimerRelative, EFI_TIMER_PERIOD_MILLISECONDS (Timeout));
+    if (EFI_ERROR (Status)) {
+      gBS->CloseEvent (TimeoutEvent);
+      return Status;
+    }
   }
 
+  Status     = EFI_SUCCESS;
+  Finished   = FALSE;
+  Stall      = 0;
+  SinceCheck = 0;
+
   XhcRingDoorBell (Xhc, SlotId, Dci);
 
-  for (Index = 0; Index < Loop; Index++) {
-    Finished = XhcCheckUrbResult (Xhc, Urb);
-    if (Finished) {
+  for (Index = 0; ; Index++) {
+    if (Urb->Finished || XhcIsEventPending (Xhc) || (SinceCheck >= XHC_1_MILLISECOND)) {
+      SinceCheck = 0;
+      Finished   = XhcCheckUrbResult (Xhc, Urb);
+      if (Finished) {
+        break;
+      }
+    }
+
+    if (Index < XHC_POLL_SPIN_COUNT) {
+      CpuPause ();
+      continue;
+    }
+
+    if ((TimeoutEvent != NULL) && !EFI_ERROR (gBS->CheckEvent (TimeoutEvent))) {
+      //
+      // Last look, the transfer may have completed during the stall.
+      //
+      Finished = XhcCheckUrbResult (Xhc, Urb);
       break;
     }
-    gBS->Stall (XHC_1_MICROSECOND);
+
+    Stall = (Stall == 0) ? XHC_1_MICROSECOND : MIN (Stall * 2, XHC_POLL_MAX_STALL);
+    gBS->Stall (Stall);
+    SinceCheck += Stall;
+  }
+
+  if (TimeoutEvent != NULL) {
+    gBS->CloseEvent (TimeoutEvent);
   }
 
-  if (Index == Loop) {
+  if (!Finished) {
     Urb->Result = EFI_USB_ERR_TIMEOUT;
     Status      = EFI_TIMEOUT;
   } else if (Urb->Result != EFI_USB_NOERROR) {
@@ -220,6 +220,97 @@ StriStartsWithBasic(IN CHAR16 *String1, IN CHAR16 *String2)
 	return Result;
 }
 
+/** Adds String to path trie with given Flags. Chars are folded with ToUpperChar, as in StrCmpiBasic. */
+EFI_STATUS
+EFIAPI
+FSIPathTrieAdd(IN FSI_PATH_NODE *Root, IN CHAR16 *String, IN UINT8 Flags)
+{
+	FSI_PATH_NODE	*Node;
+	FSI_PATH_NODE	*Child;
+	CHAR16			Chr;
+	
+	for (Node = Root; *String != L'\0'; String++) {
+		Chr = ToUpperChar(*String);
+		for (Child = Node->Child; Child != NULL && Child->Chr != Chr; Child = Child->Next);
+		if (Child == NULL) {
+			Child = AllocateZeroPool(sizeof(FSI_PATH_NODE));
+			if (Child == NULL) {
+				return EFI_OUT_OF_RESOURCES;
+			}
+			Child->Chr = Chr;
+			Child->Next = Node->Child;
+			Node->Child = Child;
+		}
+		Node = Child;
+	}
+	Node->Flags |= Flags;
+	return EFI_SUCCESS;
+}
+
+/** Releases path trie nodes. */
+VOID
+EFIAPI
+FSIPathTrieFree(IN FSI_PATH_NODE *Node)
+{
+	FSI_PATH_NODE	*Next;
+	
+	while (Node != NULL) {
+		Next = Node->Next;
+		FSIPathTrieFree(Node->Child);
+		FreePool(Node);
+		Node = Next;
+	}
+}
+
+/**
+ * Matches FName against the path trie in one pass. Returns FSI_PATH_BLACKLIST if FName starts with
+ * some Blacklist entry (same as StriStartsWithBasic), else Flags of strings equal to FName (same as StrCmpiBasic).
+ */
+UINT8
+EFIAPI
+FSIPathTrieMatch(IN FSI_PATH_NODE *Root, IN CHAR16 *FName)
+{
+	FSI_PATH_NODE	*Node;
+	CHAR16			Chr;
+	
+	if (Root == NULL || FName == NULL) {
+		return 0;
+	}
+	for (Node = Root; *FName != L'\0'; FName++) {
+		Chr = ToUpperChar(*FName);
+		for (Node = Node->Child; Node != NULL && Node->Chr != Chr; Node = Node->Next);
+		if (Node == NULL) {
+			return 0;
+		}
+		if ((Node->Flags & FSI_PATH_BLACKLIST) != 0) {
+			return FSI_PATH_BLACKLIST;
+		}
+	}
+	return Node->Flags;
+}
+
+/** Returns TRUE if FName contains one of ForceLoadKexts. */
+BOOLEAN
+EFIAPI
+IsForceLoadKext(IN FSI_STRING_LIST *StringList, IN CHAR16 *FName)
+{
+	FSI_STRING_LIST_ENTRY	*StringEntry;
+	
+	if (StringList == NULL || FName == NULL) {
+		return FALSE;
+	}
+	for (StringEntry = (FSI_STRING_LIST_ENTRY *)GetFirstNode(&StringList->List);
+		 !IsNull (&StringList->List, &StringEntry->List);
+		 StringEntry = (FSI_STRING_LIST_ENTRY *)GetNextNode(&StringList->List, &StringEntry->List)
+		 )
+	{
+		if (StrStr(FName, StringEntry->String) != NULL) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
 /** Composes file name from Parent and FName. Allocates memory for result which should be released by caller. */
 CHAR16*
 EFIAPI
@@ -380,26 +471,18 @@ FSI_FP_Open(
 	CHAR16					*InjFName = NULL;
 	FSI_FILE_PROTOCOL		*FSIThis;
 	FSI_FILE_PROTOCOL		*FSINew;
-	FSI_STRING_LIST			*StringList;
-	FSI_STRING_LIST_ENTRY	*StringEntry;
+	UINT8					PathFlags;
 
 	DBG("FSI_FP %p.Open('%s', %x, %x) ", This, FileName, OpenMode, Attributes);
 	FSIThis = FSI_FROM_FILE_PROTOCOL(This);
 	NewFName = GetNormalizedFName(FSIThis->FName, FileName);
 	
-	StringList = FSIThis->FSI_FS->Blacklist;
-	if (StringList != NULL && !IsListEmpty(&StringList->List)) {
+	// one pass for Blacklist prefixes, kernel names and injection point
+	PathFlags = FSIPathTrieMatch(FSIThis->FSI_FS->PathTrie, NewFName);
+	if ((PathFlags & FSI_PATH_BLACKLIST) != 0) {
 		// blocking files in Blacklist
-		for (StringEntry = (FSI_STRING_LIST_ENTRY *)GetFirstNode(&StringList->List);
-			 !IsNull (&StringList->List, &StringEntry->List);
-			 StringEntry = (FSI_STRING_LIST_ENTRY *)GetNextNode(&StringList->List, &StringEntry->List)
-			 )
-		{
-			if (StriStartsWithBasic(NewFName, StringEntry->String)) {
-				DBG("Blacklisted\n");
-				return EFI_NOT_FOUND;
-			}
-		}
+		DBG("Blacklisted\n");
+		return EFI_NOT_FOUND;
 	}
 	
 	// create our FP implementation
@@ -415,7 +498,7 @@ FSI_FP_Open(
 	FSINew->SrcFP = NULL;
 	
 	// mach_kernel - if exists in SrcDir, then inject this one
-	if (StrCmpiBasic(NewFName, L"\\mach_kernel") == 0) {
+	if ((PathFlags & FSI_PATH_MACH_KERNEL) != 0) {
 		DBG("mach_kernel ");
 		if (FSIThis->FSI_FS->SrcDir != NULL && FSIThis->FSI_FS->SrcFS != NULL) {
 			InjFName = GetInjectionFName(L"\0", FSIThis->FSI_FS->SrcDir, NewFName);
@@ -433,7 +516,7 @@ FSI_FP_Open(
 		}
 	}
 	// S/L/Kernels/kernel - if exists in SrcDir, then inject this one
-	if (StrCmpiBasic(NewFName, L"\\System\\Library\\Kernels\\kernel") == 0) {
+	if ((PathFlags & FSI_PATH_KERNEL) != 0) {
 		DBG("kernel ");
 		if (FSIThis->FSI_FS->SrcDir != NULL && FSIThis->FSI_FS->SrcFS != NULL) {
 			InjFName = GetInjectionFName(L"\0", FSIThis->FSI_FS->SrcDir, L"\\kernel");
@@ -544,7 +627,7 @@ FSI_FP_Open(
 
 	// check if this is injection point (target dir where we should inject)
 	if (FSINew->TgtFP != NULL && FSINew->FSI_FS->SrcFS != NULL && FSINew->FSI_FS->SrcDir != NULL
-		&& StrCmpiBasic(FSINew->FSI_FS->TgtDir, FSINew->FName) == 0)
+		&& (PathFlags & FSI_PATH_TGT_DIR) != 0)
 	{
 		// it is - open injection dir also
 		// this FP will have both TgtFP and SrcFP - can be used for test later
@@ -556,6 +639,11 @@ FSI_FP_Open(
 			DBG("Error opening with SrcFP ");
 		}
 	}
+	
+	// plists from target are patched on Read if they are in ForceLoadKexts
+	if (FSINew->TgtFP != NULL && FSINew->SrcFP == NULL) {
+		FSINew->ForceLoad = IsForceLoadKext(FSINew->FSI_FS->ForceLoadKexts, FSINew->FName);
+	}
 		
 	
 SuccessExit:
@@ -599,6 +687,10 @@ FSI_FP_Close(IN EFI_FILE_PROTOCOL  *This)
 		FreePool(FSIThis->FName);
 		FSIThis->FName = NULL;
 	}
+	if (FSIThis->DirList != NULL) {
+		FreePool(FSIThis->DirList);
+		FSIThis->DirList = NULL;
+	}
 	FreePool(FSIThis);
 	DBG("= %r\n", Status);
 	return Status;
@@ -630,11 +722,103 @@ FSI_FP_Delete(IN EFI_FILE_PROTOCOL  *This)
 		FreePool(FSIThis->FName);
 		FSIThis->FName = NULL;
 	}
+	if (FSIThis->DirList != NULL) {
+		FreePool(FSIThis->DirList);
+		FSIThis->DirList = NULL;
+	}
 	FreePool(FSIThis);
 	DBG("= %r\n", Status);
 	return Status;
 }
 
+/** Appends the remaining entries of Dir to the merged listing of FSIThis. Entry is a read buffer, grown when needed. */
+STATIC
+EFI_STATUS
+AppendDirEntries(
+	IN FSI_FILE_PROTOCOL	*FSIThis,
+	IN EFI_FILE_PROTOCOL	*Dir,
+	IN OUT VOID				**Entry,
+	IN OUT UINTN			*EntrySize
+)
+{
+	EFI_STATUS				Status;
+	UINTN					Size;
+	UINTN					RecordSize;
+	UINTN					NewAllocated;
+	UINT8					*NewList;
+	
+	for (;;) {
+		Size = *EntrySize;
+		Status = Dir->Read(Dir, &Size, *Entry);
+		if (Status == EFI_BUFFER_TOO_SMALL) {
+			FreePool(*Entry);
+			*Entry = AllocatePool(Size);
+			*EntrySize = (*Entry != NULL) ? Size : 0;
+			if (*Entry == NULL) {
+				return EFI_OUT_OF_RESOURCES;
+			}
+			continue;
+		}
+		if (EFI_ERROR(Status) || Size == 0) {
+			return Status;
+		}
+		RecordSize = FSI_DIR_RECORD_SIZE(Size);
+		if (FSIThis->DirListSize + RecordSize > FSIThis->DirListAllocated) {
+			NewAllocated = MAX(FSIThis->DirListAllocated * 2, FSIThis->DirListSize + RecordSize);
+			NewList = ReallocatePool(FSIThis->DirListAllocated, NewAllocated, FSIThis->DirList);
+			if (NewList == NULL) {
+				return EFI_OUT_OF_RESOURCES;
+			}
+			FSIThis->DirList = NewList;
+			FSIThis->DirListAllocated = NewAllocated;
+		}
+		*(UINT64 *)(FSIThis->DirList + FSIThis->DirListSize) = Size;
+		CopyMem(FSIThis->DirList + FSIThis->DirListSize + sizeof(UINT64), *Entry, Size);
+		FSIThis->DirListSize += RecordSize;
+	}
+}
+
+/**
+ * Reads the entries of an injection point once: SrcFP ones, then TgtFP ones, as the reads
+ * alternating between both did. boot.efi lists Extensions many times, SetPosition(0) rewinds the listing.
+ */
+STATIC
+EFI_STATUS
+BuildDirList(IN FSI_FILE_PROTOCOL *FSIThis)
+{
+	EFI_STATUS				Status = EFI_OUT_OF_RESOURCES;
+	VOID					*Entry;
+	UINTN					EntrySize = SIZE_OF_EFI_FILE_INFO + 256 * sizeof(CHAR16);
+	
+	FSIThis->DirListAllocated = EFI_PAGE_SIZE;
+	FSIThis->DirListSize = 0;
+	FSIThis->DirListPos = 0;
+	FSIThis->DirList = AllocatePool(FSIThis->DirListAllocated);
+	Entry = AllocatePool(EntrySize);
+	if (FSIThis->DirList != NULL && Entry != NULL) {
+		Status = AppendDirEntries(FSIThis, FSIThis->SrcFP, &Entry, &EntrySize);
+		if (!EFI_ERROR(Status)) {
+			Status = AppendDirEntries(FSIThis, FSIThis->TgtFP, &Entry, &EntrySize);
+		}
+	}
+	if (Entry != NULL) {
+		FreePool(Entry);
+	}
+	if (EFI_ERROR(Status)) {
+		// next Read tries again from the start
+		if (FSIThis->DirList != NULL) {
+			FreePool(FSIThis->DirList);
+			FSIThis->DirList = NULL;
+		}
+		FSIThis->DirListSize = 0;
+		FSIThis->DirListAllocated = 0;
+		FSIThis->SrcFP->SetPosition(FSIThis->SrcFP, 0);
+		FSIThis->TgtFP->SetPosition(FSIThis->TgtFP, 0);
+	}
+	DBG("BuildDirList %d bytes = %r ", FSIThis->DirListSize, Status);
+	return Status;
+}
+
 /** EFI_FILE_PROTOCOL.Read - Reads data from a file. */
 EFI_STATUS
 EFIAPI
@@ -649,10 +833,8 @@ FSI_FP_Read(
 #if DBG_TO  
 	EFI_FILE_INFO			*FInfo;
 #endif
-	UINTN					BufferSizeOrig;
+	UINTN					EntrySize;
 	CHAR8					*String;
-	FSI_STRING_LIST			*StringList;
-	FSI_STRING_LIST_ENTRY	*StringEntry;
 	VOID					*TmpBuffer;
 	UINTN					OrigBufferSize = *BufferSize;
 	
@@ -661,18 +843,30 @@ FSI_FP_Read(
 	FSIThis = FSI_FROM_FILE_PROTOCOL(This);
 	if (FSIThis->TgtFP != NULL && FSIThis->SrcFP != NULL) {
 		// this is injection point
-		// first read dir entries from Src and then from Tgt
-		BufferSizeOrig = *BufferSize;
-		Status = FSIThis->SrcFP->Read(FSIThis->SrcFP, BufferSize, Buffer);
-		if (*BufferSize == 0) {
-			// no more in Src - read from Tgt
-			*BufferSize = BufferSizeOrig;
-			Status = FSIThis->TgtFP->Read(FSIThis->TgtFP, BufferSize, Buffer);
+		// dir entries from Src and then from Tgt, read once into DirList
+		Status = EFI_SUCCESS;
+		if (FSIThis->DirList == NULL) {
+			Status = BuildDirList(FSIThis);
+		}
+		if (!EFI_ERROR(Status)) {
+			if (FSIThis->DirListPos >= FSIThis->DirListSize) {
+				// no more entries
+				*BufferSize = 0;
+			} else {
+				EntrySize = (UINTN)*(UINT64 *)(FSIThis->DirList + FSIThis->DirListPos);
+				if (*BufferSize < EntrySize) {
+					*BufferSize = EntrySize;
+					Status = EFI_BUFFER_TOO_SMALL;
+				} else {
+					CopyMem(Buffer, FSIThis->DirList + FSIThis->DirListPos + sizeof(UINT64), EntrySize);
+					*BufferSize = EntrySize;
+					FSIThis->DirListPos += FSI_DIR_RECORD_SIZE(EntrySize);
+				}
+			}
 		}
 	} else if (FSIThis->TgtFP != NULL) {
 		// do it with target FP
 		Status = FSIThis->TgtFP->Read(FSIThis->TgtFP, BufferSize, Buffer);
-		StringList = FSIThis->FSI_FS->ForceLoadKexts;
 		if (Status == EFI_INVALID_PARAMETER && *BufferSize == 0) {
 			// On some systems FS driver seems to have alignment restrictions on given buffer.
 			// UEFIs buffers allocated with standard AllocatePool seem to be aligned properly and reads
@@ -685,28 +879,20 @@ FSI_FP_Read(
 			}
 			FreePool(TmpBuffer);
 		}
-		if (Status == EFI_SUCCESS && StringList != NULL && FSIThis->FName != NULL) {
-			// check ForceLoadKexts
-			for (StringEntry = (FSI_STRING_LIST_ENTRY *)GetFirstNode(&StringList->List);
-				 !IsNull (&StringList->List, &StringEntry->List);
-				 StringEntry = (FSI_STRING_LIST_ENTRY *)GetNextNode(&StringList->List, &StringEntry->List)
-				 )
-			{
-				if (StrStr(FSIThis->FName, StringEntry->String) != NULL) {
-					//Print(L"\nGot: %s\n", FSIThis->FName);
-					String = AsciiStrStr((CHAR8*)Buffer, "<string>Safe Boot</string>");
-					if (String != NULL) {
-						CopyMem(String, "<string>Root</string>     ", 26);
-						Print(L"\nForced load: %s\n", FSIThis->FName);
-						//gBS->Stall(5000000);
-					} else {
-						String = AsciiStrStr((CHAR8*)Buffer, "<string>Network-Root</string>");
-						if (String != NULL) {
-							CopyMem(String, "<string>Root</string>        ", 29);
-							Print(L"\nForced load: %s\n", FSIThis->FName);
-							//gBS->Stall(5000000);
-						}
-					}
+		if (Status == EFI_SUCCESS && FSIThis->ForceLoad) {
+			// in ForceLoadKexts - matched once in Open
+			//Print(L"\nGot: %s\n", FSIThis->FName);
+			String = AsciiStrStr((CHAR8*)Buffer, "<string>Safe Boot</string>");
+			if (String != NULL) {
+				CopyMem(String, "<string>Root</string>     ", 26);
+				Print(L"\nForced load: %s\n", FSIThis->FName);
+				//gBS->Stall(5000000);
+			} else {
+				String = AsciiStrStr((CHAR8*)Buffer, "<string>Network-Root</string>");
+				if (String != NULL) {
+					CopyMem(String, "<string>Root</string>        ", 29);
+					Print(L"\nForced load: %s\n", FSIThis->FName);
+					//gBS->Stall(5000000);
 				}
 			}
 		}
@@ -787,6 +973,11 @@ FSI_FP_SetPosition(
 		// and with Src
 		Status = FSIThis->SrcFP->SetPosition(FSIThis->SrcFP, Position);
 	}
+	if (FSIThis->DirList != NULL && Position == 0) {
+		// rewind the listing of the injection point
+		FSIThis->DirListPos = 0;
+		Status = EFI_SUCCESS;
+	}
 	DBG("= %r\n", Status);
 	return Status;
 }
@@ -939,6 +1130,11 @@ CreateFSInjectFP(VOID)
 	FSINew->TgtFP = NULL;
 	FSINew->SrcFP = NULL;
 	FSINew->FromTgt = FALSE;
+	FSINew->ForceLoad = FALSE;
+	FSINew->DirList = NULL;
+	FSINew->DirListSize = 0;
+	FSINew->DirListAllocated = 0;
+	FSINew->DirListPos = 0;
 	
 	return FSINew;
 }
@@ -1017,6 +1213,7 @@ FSInjectionInstall (
 	EFI_SIMPLE_FILE_SYSTEM_PROTOCOL		*TgtFS;
 	EFI_SIMPLE_FILE_SYSTEM_PROTOCOL		*SrcFS;
 	FSI_SIMPLE_FILE_SYSTEM_PROTOCOL		*OurFS;
+	FSI_STRING_LIST_ENTRY				*StringEntry;
 	
 	
 	DBG("FSInjectionInstall ...\n");
@@ -1073,6 +1270,39 @@ FSInjectionInstall (
 		OurFS->ForceLoadKexts = ForceLoadKexts;
 	}
 	
+	// case folded trie with Blacklist prefixes and exact names checked on every Open
+	OurFS->PathTrie = AllocateZeroPool(sizeof(FSI_PATH_NODE));
+	if (OurFS->PathTrie == NULL) {
+		Status = EFI_OUT_OF_RESOURCES;
+		goto TrieError;
+	}
+	if (OurFS->Blacklist != NULL) {
+		for (StringEntry = (FSI_STRING_LIST_ENTRY *)GetFirstNode(&Blacklist->List);
+			 !IsNull (&Blacklist->List, &StringEntry->List);
+			 StringEntry = (FSI_STRING_LIST_ENTRY *)GetNextNode(&Blacklist->List, &StringEntry->List)
+			 )
+		{
+			// empty entry never matched with StriStartsWithBasic
+			if (StringEntry->String[0] == L'\0') {
+				continue;
+			}
+			Status = FSIPathTrieAdd(OurFS->PathTrie, StringEntry->String, FSI_PATH_BLACKLIST);
+			if (EFI_ERROR(Status)) {
+				goto TrieError;
+			}
+		}
+	}
+	Status = FSIPathTrieAdd(OurFS->PathTrie, L"\\mach_kernel", FSI_PATH_MACH_KERNEL);
+	if (!EFI_ERROR(Status)) {
+		Status = FSIPathTrieAdd(OurFS->PathTrie, L"\\System\\Library\\Kernels\\kernel", FSI_PATH_KERNEL);
+	}
+	if (!EFI_ERROR(Status)) {
+		Status = FSIPathTrieAdd(OurFS->PathTrie, OurFS->TgtDir, FSI_PATH_TGT_DIR);
+	}
+	if (EFI_ERROR(Status)) {
+		goto TrieError;
+	}
+	
 	// replace existing tagret EFI_SIMPLE_FILE_SYSTEM_PROTOCOL with out implementation
 	Status = gBS->ReinstallProtocolInterface(TgtHandle, &gEfiSimpleFileSystemProtocolGuid, TgtFS, &OurFS->FS);
 	if (EFI_ERROR(Status)) {
@@ -1083,6 +1313,9 @@ FSInjectionInstall (
 	DBG("- Our FSI_SIMPLE_FILE_SYSTEM_PROTOCOL installed on handle: %X\n", TgtHandle);
 	return EFI_SUCCESS;
 	
+TrieError:
+	DBG("- path trie: %r\n", Status);
+	FSIPathTrieFree(OurFS->PathTrie);
 ErrorExit:
 	if (OurFS->TgtDir != NULL) FreePool(OurFS->TgtDir);
 	if (OurFS->SrcDir != NULL) FreePool(OurFS->SrcDir);
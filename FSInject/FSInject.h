@@ -13,6 +13,22 @@ Module Name:
 #ifndef __FSInject_H__
 #define __FSInject_H__
 
+/**
+ * Node of the path trie built at install time. Chr is upper case (ASCII only, like StrCmpiBasic),
+ * Flags tell which strings end at this node.
+ */
+typedef struct _FSI_PATH_NODE {
+	struct _FSI_PATH_NODE				*Child;			// first node for the next char
+	struct _FSI_PATH_NODE				*Next;			// next node for another char at the same position
+	CHAR16								Chr;			// upper case char of this node
+	UINT8								Flags;			// FSI_PATH_xxx
+} FSI_PATH_NODE;
+
+#define FSI_PATH_BLACKLIST		0x01	// a Blacklist entry ends here: blocks every name starting with it
+#define FSI_PATH_MACH_KERNEL	0x02	// exact \mach_kernel
+#define FSI_PATH_KERNEL			0x04	// exact \System\Library\Kernels\kernel
+#define FSI_PATH_TGT_DIR		0x08	// exact TgtDir, the injection point
+
 /**
  * FSInjection EFI_SIMPLE_FILE_SYSTEM_PROTOCOL private structure
  */
@@ -31,6 +47,7 @@ typedef struct {
 	
 	FSI_STRING_LIST						*Blacklist;		// linked list of file names to be blocked on target volume
 	FSI_STRING_LIST						*ForceLoadKexts;// linked list of kext plists
+	FSI_PATH_NODE						*PathTrie;		// Blacklist and special names, case folded, matched once per Open
 } FSI_SIMPLE_FILE_SYSTEM_PROTOCOL;
 
 /** Signature for FSI_SIMPLE_FILE_SYSTEM_PROTOCOL */
@@ -55,8 +72,18 @@ typedef struct {
 	EFI_FILE_PROTOCOL					*TgtFP;			// target EFI_FILE_PROTOCOL
 	EFI_FILE_PROTOCOL					*SrcFP;			// EFI_FILE_PROTOCOL from injection volume
 	BOOLEAN								FromTgt;		// TRUE if file is opened from original target volume, FALSE if from injection volume
+	BOOLEAN								ForceLoad;		// TRUE if FName contains one of ForceLoadKexts
+	UINT8								*DirList;		// injection point: entries of SrcFP then TgtFP, read once on the first Read
+	UINTN								DirListSize;	// bytes used in DirList
+	UINTN								DirListAllocated;
+	UINTN								DirListPos;		// offset of the next entry to return
 } FSI_FILE_PROTOCOL;
 
+/**
+ * DirList record: UINT64 size of the EFI_FILE_INFO, then the EFI_FILE_INFO padded to 8 bytes.
+ */
+#define FSI_DIR_RECORD_SIZE(InfoSize)	(sizeof(UINT64) + ALIGN_VALUE((InfoSize), 8))
+
 /** Signature for FSI_FILE_PROTOCOL */
 #define FSI_FILE_PROTOCOL_SIGNATURE  SIGNATURE_32('f', 'i', 'f', 'p')
 
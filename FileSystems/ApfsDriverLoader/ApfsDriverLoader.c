@@ -25,22 +25,50 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 STATIC BOOLEAN  LegacyScan       = FALSE;
 STATIC UINT64   LegacyBaseOffset = 0;
 
+//
+// Embedded drivers started so far. Containers carrying the same apfs.efi
+// are connected to the running instance instead of starting another one.
+//
+STATIC APFS_STARTED_DRIVER  mStartedDrivers[APFS_MAX_STARTED_DRIVERS];
+STATIC UINTN                mStartedDriverCount = 0;
+
+//
+// Fletcher-64 over 32-bit words. Four words are summed per step, which needs
+// fewer dependent additions than the plain loop:
+//   Sum1' = Sum1 + (a + b + c + d)
+//   Sum2' = Sum2 + 4 * Sum1 + (4a + 3b + 2c + d)
+// Both sums are reduced every APFS_CHECKSUM_REDUCE_STEPS steps, so blocks of
+// any size stay within 64 bits.
+//
 UINT64
 ApfsBlockChecksumCalculate (
   UINT32  *Data,
   UINTN   DataSize
   )
 {
-  UINTN         Index;
+  UINTN         Count;
+  UINTN         Steps;
   UINT64        Sum1 = 0;
   UINT64        Check1 = 0;
   UINT64        Sum2 = 0;
   UINT64        Check2 = 0;
   CONST UINT64  ModValue = 0xFFFFFFFFull;
 
-  for (Index = 0; Index < DataSize / sizeof (UINT32); Index++) {
-//    Sum1 = ((Sum1 + (UINT64)Data[Index]) % ModValue);
-//    Sum2 = (Sum2 + Sum1) % ModValue;
+  Count = DataSize / sizeof (UINT32);
+  while (Count >= 4) {
+    Steps = MIN (Count / 4, APFS_CHECKSUM_REDUCE_STEPS);
+    Count -= Steps * 4;
+    while (Steps-- > 0) {
+      Sum2 += 4 * Sum1
+        + 4 * (UINT64)Data[0] + 3 * (UINT64)Data[1] + 2 * (UINT64)Data[2] + (UINT64)Data[3];
+      Sum1 += (UINT64)Data[0] + (UINT64)Data[1] + (UINT64)Data[2] + (UINT64)Data[3];
+      Data += 4;
+    }
+    Sum1 %= ModValue;
+    Sum2 %= ModValue;
+  }
+
+  while (Count-- > 0) {
     Sum1 += (UINT64)*Data++;
     Sum2 += Sum1;
   }
@@ -601,6 +629,287 @@ ApfsDriverLoaderSupported (
   return Status;
 }
 
+//
+// Read the embedded EFI driver from the extents of the EfiBootRecord.
+// Extents are usually written back to back, so physically adjacent ones are
+// read with a single request into one buffer of the final size.
+//
+STATIC
+EFI_STATUS
+ReadEfiBootRecordFile (
+  IN  EFI_DISK_IO_PROTOCOL   *DiskIo,
+  IN  EFI_DISK_IO2_PROTOCOL  *DiskIo2,
+  IN  UINT32                 MediaId,
+  IN  APFS_EFI_BOOT_RECORD   *EfiBootRecordBlock,
+  IN  UINT32                 ApfsBlockSize,
+  OUT VOID                   **EfiFileBuffer
+  )
+{
+  EFI_STATUS     Status;
+  UINTN          Index;
+  UINTN          CurPos     = 0;
+  UINT64         TotalBlocks = 0;
+  UINT64         RunStart;
+  UINT64         RunBlocks;
+  UINT8          *Buffer;
+  PhysicalRange  *Extents   = EfiBootRecordBlock->RecordExtents;
+
+  for (Index = 0; Index < EfiBootRecordBlock->NumOfExtents; Index++) {
+    TotalBlocks += Extents[Index].BlockCount;
+  }
+
+  if (TotalBlocks == 0
+    || TotalBlocks > DivU64x32 (MAX_UINTN, ApfsBlockSize)
+    || MultU64x32 (TotalBlocks, ApfsBlockSize) < EfiBootRecordBlock->EfiFileLen) {
+    return EFI_VOLUME_CORRUPTED;
+  }
+
+  Buffer = AllocatePool ((UINTN)MultU64x32 (TotalBlocks, ApfsBlockSize));
+  if (Buffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Index = 0;
+  while (Index < EfiBootRecordBlock->NumOfExtents) {
+    RunStart  = (UINT64)Extents[Index].StartPhysicalAddr;
+    RunBlocks = Extents[Index].BlockCount;
+    for (Index++; Index < EfiBootRecordBlock->NumOfExtents; Index++) {
+      if ((UINT64)Extents[Index].StartPhysicalAddr != RunStart + RunBlocks) {
+        break;
+      }
+      RunBlocks += Extents[Index].BlockCount;
+    }
+
+    if (RunBlocks == 0) {
+      continue;
+    }
+
+    DEBUG ((
+      DEBUG_VERBOSE,
+      "EFI embedded driver run located at: %llu block\n with size %llu\n",
+      RunStart,
+      RunBlocks
+      ));
+
+    Status = ReadDisk (
+      DiskIo,
+      DiskIo2,
+      MediaId,
+      MultU64x32 (RunStart, ApfsBlockSize) + LegacyBaseOffset,
+      (UINTN)MultU64x32 (RunBlocks, ApfsBlockSize),
+      Buffer + CurPos
+      );
+
+    if (EFI_ERROR(Status)) {
+      FreePool(Buffer);
+      return EFI_DEVICE_ERROR;
+    }
+
+    CurPos += (UINTN)MultU64x32 (RunBlocks, ApfsBlockSize);
+  }
+
+  //
+  // Drop tail
+  // We do it because we read blocksize aligned data
+  // Apfs driver size given in bytes
+  //
+  *EfiFileBuffer = ReallocatePool (CurPos, EfiBootRecordBlock->EfiFileLen, Buffer);
+  if (*EfiFileBuffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  return EFI_SUCCESS;
+}
+
+//
+// Open the driver cache file of a container in the misc directory of the
+// volume this loader was started from.
+//
+STATIC
+EFI_STATUS
+ApfsDriverCacheOpen (
+  IN  EFI_GUID           *ContainerUuid,
+  IN  UINT64             OpenMode,
+  OUT EFI_FILE_PROTOCOL  **File
+  )
+{
+  EFI_STATUS                       Status;
+  EFI_LOADED_IMAGE_PROTOCOL        *LoadedImage = NULL;
+  EFI_SIMPLE_FILE_SYSTEM_PROTOCOL  *FileSystem  = NULL;
+  EFI_FILE_PROTOCOL                *Root        = NULL;
+  CHAR16                           FileName[80];
+
+  Status = gBS->HandleProtocol (
+    gImageHandle,
+    &gEfiLoadedImageProtocolGuid,
+    (VOID **) &LoadedImage
+    );
+  if (EFI_ERROR(Status) || LoadedImage->DeviceHandle == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  Status = gBS->HandleProtocol (
+    LoadedImage->DeviceHandle,
+    &gEfiSimpleFileSystemProtocolGuid,
+    (VOID **) &FileSystem
+    );
+  if (EFI_ERROR(Status)) {
+    return EFI_NOT_FOUND;
+  }
+
+  Status = FileSystem->OpenVolume (FileSystem, &Root);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  UnicodeSPrint (FileName, sizeof (FileName), L"%s\\apfs-%g.bin", APFS_DRIVER_CACHE_DIR, ContainerUuid);
+  Status = Root->Open (Root, File, FileName, OpenMode, 0);
+  Root->Close (Root);
+
+  return Status;
+}
+
+//
+// Load the embedded EFI driver saved by an earlier boot. The cache is keyed by
+// the EfiBootRecord itself: its checksum and transaction id change whenever
+// the container gets another driver, and the image carries its own CRC.
+// With EfiFileBuffer NULL only the image CRC is returned.
+//
+STATIC
+EFI_STATUS
+ApfsDriverCacheLoad (
+  IN  EFI_GUID              *ContainerUuid,
+  IN  APFS_EFI_BOOT_RECORD  *EfiBootRecordBlock,
+  OUT VOID                  **EfiFileBuffer  OPTIONAL,
+  OUT UINT32                *ImageCrc32
+  )
+{
+  EFI_STATUS                Status;
+  EFI_FILE_PROTOCOL         *File = NULL;
+  APFS_DRIVER_CACHE_HEADER  Header;
+  UINTN                     Size;
+  VOID                      *Buffer;
+  UINT32                    Crc32 = 0;
+
+  Status = ApfsDriverCacheOpen (ContainerUuid, EFI_FILE_MODE_READ, &File);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  Size = sizeof (Header);
+  Status = File->Read (File, &Size, &Header);
+  if (EFI_ERROR(Status)
+    || Size != sizeof (Header)
+    || Header.Signature != APFS_DRIVER_CACHE_SIGNATURE
+    || Header.EfiFileLen != EfiBootRecordBlock->EfiFileLen
+    || Header.RecordChecksum != EfiBootRecordBlock->BlockHeader.Checksum
+    || Header.RecordXid != EfiBootRecordBlock->BlockHeader.ObjectXid
+    || !CompareGuid (&Header.ContainerUuid, ContainerUuid)) {
+    File->Close (File);
+    return EFI_NOT_FOUND;
+  }
+
+  if (EfiFileBuffer == NULL) {
+    File->Close (File);
+    *ImageCrc32 = Header.ImageCrc32;
+    return EFI_SUCCESS;
+  }
+
+  Buffer = AllocatePool (Header.EfiFileLen);
+  if (Buffer == NULL) {
+    File->Close (File);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Size = Header.EfiFileLen;
+  Status = File->Read (File, &Size, Buffer);
+  File->Close (File);
+  if (!EFI_ERROR(Status) && Size == Header.EfiFileLen) {
+    Status = gBS->CalculateCrc32 (Buffer, Size, &Crc32);
+  }
+  if (EFI_ERROR(Status) || Size != Header.EfiFileLen || Crc32 != Header.ImageCrc32) {
+    FreePool(Buffer);
+    return EFI_NOT_FOUND;
+  }
+
+  DEBUG ((DEBUG_VERBOSE, "EFI embedded driver loaded from cache\n"));
+  *EfiFileBuffer = Buffer;
+  *ImageCrc32    = Crc32;
+  return EFI_SUCCESS;
+}
+
+//
+// Save the embedded EFI driver for the next boot. Failing to save is not an error.
+//
+STATIC
+VOID
+ApfsDriverCacheSave (
+  IN EFI_GUID              *ContainerUuid,
+  IN APFS_EFI_BOOT_RECORD  *EfiBootRecordBlock,
+  IN VOID                  *EfiFileBuffer,
+  IN UINT32                ImageCrc32
+  )
+{
+  EFI_STATUS                Status;
+  EFI_FILE_PROTOCOL         *File = NULL;
+  APFS_DRIVER_CACHE_HEADER  Header;
+  UINTN                     Size;
+
+  ZeroMem (&Header, sizeof (Header));
+  Header.Signature      = APFS_DRIVER_CACHE_SIGNATURE;
+  Header.EfiFileLen     = EfiBootRecordBlock->EfiFileLen;
+  Header.RecordChecksum = EfiBootRecordBlock->BlockHeader.Checksum;
+  Header.RecordXid      = EfiBootRecordBlock->BlockHeader.ObjectXid;
+  CopyMem(&Header.ContainerUuid, ContainerUuid, sizeof (EFI_GUID));
+  Header.ImageCrc32     = ImageCrc32;
+
+  Status = ApfsDriverCacheOpen (
+    ContainerUuid,
+    EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE | EFI_FILE_MODE_CREATE,
+    &File
+    );
+  if (EFI_ERROR(Status)) {
+    return;
+  }
+
+  //
+  // Write the image first and the header last, a torn write is never valid
+  //
+  File->SetPosition (File, sizeof (Header));
+  Size = Header.EfiFileLen;
+  Status = File->Write (File, &Size, EfiFileBuffer);
+  if (!EFI_ERROR(Status)) {
+    File->SetPosition (File, 0);
+    Size = sizeof (Header);
+    Status = File->Write (File, &Size, &Header);
+  }
+  File->Close (File);
+
+  DEBUG ((DEBUG_VERBOSE, "EFI embedded driver cache saved: %r\n", Status));
+}
+
+//
+// Check whether an embedded driver image is already running.
+//
+STATIC
+BOOLEAN
+ApfsDriverIsStarted (
+  IN UINT32  ImageCrc32,
+  IN UINT32  ImageSize
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < mStartedDriverCount; Index++) {
+    if (mStartedDrivers[Index].ImageCrc32 == ImageCrc32
+      && mStartedDrivers[Index].ImageSize == ImageSize) {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
 /**
   Routine Description:
 
@@ -630,8 +939,6 @@ ApfsDriverLoaderStart (
   )
 {
   EFI_STATUS                        Status;
-  UINTN                             Index                        = 0;
-  UINTN                             CurPos                       = 0;
   EFI_BLOCK_IO_PROTOCOL             *BlockIo                     = NULL;
   EFI_BLOCK_IO2_PROTOCOL            *BlockIo2                    = NULL;
   EFI_DISK_IO_PROTOCOL              *DiskIo                      = NULL;
@@ -644,9 +951,9 @@ ApfsDriverLoaderStart (
   INT64                             EfiBootRecordBlockPtr        = 0;
   APFS_EFI_BOOT_RECORD              *EfiBootRecordBlock          = NULL;
   APFS_CSB                          *ContainerSuperBlock         = NULL;
-  UINT64                            EfiFileCurrentExtentOffset   = 0;
   VOID                              *EfiFileBuffer               = NULL;
-  UINTN                             EfiFileCurrentExtentSize     = 0;
+  UINT32                            ImageCrc32                   = 0;
+  BOOLEAN                           DriverStarted                = FALSE;
   APFS_DRIVER_INFO_PRIVATE_DATA     *Private                     = NULL;
   APFS_EFIBOOTRECORD_LOCATION_INFO  *EfiBootRecordLocationInfo   = NULL;
 
@@ -725,7 +1032,11 @@ ApfsDriverLoaderStart (
     MediaId       = BlockIo->Media->MediaId;
   }
 
-  ApfsBlock = AllocateZeroPool(2048);
+  //
+  // APFS blocks are never smaller than APFS_MIN_BLOCK_SIZE, usually exactly that,
+  // so the whole ContainerSuperblock comes with the first read.
+  //
+  ApfsBlock = AllocateZeroPool(APFS_MIN_BLOCK_SIZE);
   if (ApfsBlock == NULL) {
     return EFI_OUT_OF_RESOURCES;
   }
@@ -738,7 +1049,7 @@ ApfsDriverLoaderStart (
     DiskIo2,
     MediaId,
     LegacyBaseOffset,
-    2048,
+    APFS_MIN_BLOCK_SIZE,
     ApfsBlock
     );
 
@@ -798,31 +1109,40 @@ ApfsDriverLoaderStart (
     EfiBootRecordBlockPtr
     ));
 
-  //
-  // Free ApfsBlock and allocate one of a correct size.
-  // ContainerSuperBlock (& EfiBootRecordBlockPtr ?) will not valid now
-  //
-  FreePool(ApfsBlock);
-  ApfsBlock = AllocateZeroPool(ApfsBlockSize);
-  if (ApfsBlock == NULL) {
-    return EFI_OUT_OF_RESOURCES;
+  if (ApfsBlockSize < APFS_MIN_BLOCK_SIZE
+    || ApfsBlockSize > APFS_MAX_BLOCK_SIZE
+    || (ApfsBlockSize & (ApfsBlockSize - 1)) != 0) {
+    FreePool(ApfsBlock);
+    return EFI_UNSUPPORTED;
   }
 
-  //
-  // Read full ContainerSuperblock with known BlockSize.
-  //
-  Status = ReadDisk (
-    DiskIo,
-    DiskIo2,
-    MediaId,
-    LegacyBaseOffset,
-    ApfsBlockSize,
-    ApfsBlock
-    );
-
-  if (EFI_ERROR(Status)) {
+  if (ApfsBlockSize != APFS_MIN_BLOCK_SIZE) {
+    //
+    // Free ApfsBlock and allocate one of a correct size.
+    // ContainerSuperBlock (& EfiBootRecordBlockPtr ?) will not valid now
+    //
     FreePool(ApfsBlock);
-    return EFI_DEVICE_ERROR;
+    ApfsBlock = AllocateZeroPool(ApfsBlockSize);
+    if (ApfsBlock == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    //
+    // Read full ContainerSuperblock with known BlockSize.
+    //
+    Status = ReadDisk (
+      DiskIo,
+      DiskIo2,
+      MediaId,
+      LegacyBaseOffset,
+      ApfsBlockSize,
+      ApfsBlock
+      );
+
+    if (EFI_ERROR(Status)) {
+      FreePool(ApfsBlock);
+      return EFI_DEVICE_ERROR;
+    }
   }
 
   //
@@ -878,7 +1198,9 @@ ApfsDriverLoaderStart (
   }
 
   EfiBootRecordBlock = (APFS_EFI_BOOT_RECORD *) ApfsBlock;
-  if (EfiBootRecordBlock->Magic != APFS_EFIBOOTRECORD_SIGNATURE) {
+  if (EfiBootRecordBlock->Magic != APFS_EFIBOOTRECORD_SIGNATURE
+    || EfiBootRecordBlock->NumOfExtents
+       > (ApfsBlockSize - sizeof (APFS_EFI_BOOT_RECORD)) / sizeof (PhysicalRange)) {
     FreePool(ApfsBlock);
     return EFI_UNSUPPORTED;
   }
@@ -889,10 +1211,6 @@ ApfsDriverLoaderStart (
     EfiBootRecordBlock->BlockHeader.Checksum
     ));
 
-  //
-  // Loop over extents inside EfiBootRecord
-  //        EFI embedded driver could be defragmented across whole container
-  //
   DEBUG ((
     DEBUG_VERBOSE,
     "EFI embedded driver extents number %u\n",
@@ -900,88 +1218,43 @@ ApfsDriverLoaderStart (
     ));
 
   //
-  // Read EFI embedded file from extents
+  // A container whose cached driver is already running only needs connecting
   //
-  for (Index = 0; Index < EfiBootRecordBlock->NumOfExtents; Index++) {
-    DEBUG ((
-        DEBUG_VERBOSE,
-        "EFI embedded driver extent located at: %lld block\n with size %llu\n",
-        EfiBootRecordBlock->RecordExtents[Index].StartPhysicalAddr,
-        EfiBootRecordBlock->RecordExtents[Index].BlockCount
-        ));
-
-    EfiFileCurrentExtentOffset = MultU64x32 (
-                                (UINT64)EfiBootRecordBlock->RecordExtents[Index].StartPhysicalAddr,
-                                ApfsBlockSize
-                                )  + LegacyBaseOffset;
-
-    EfiFileCurrentExtentSize = (UINTN)MultU64x32 (
-                                EfiBootRecordBlock->RecordExtents[Index].BlockCount,
-                                ApfsBlockSize
-                                );
-
-    if (EfiFileCurrentExtentSize == 0) {
-      continue;
-    }
-    //
-    // Adjust buffer size
-    //
-    EfiFileBuffer = ReallocatePool (
-                      CurPos,
-                      CurPos + EfiFileCurrentExtentSize,
-                      EfiFileBuffer
-                      );
+  Status = ApfsDriverCacheLoad (&ContainerUuid, EfiBootRecordBlock, NULL, &ImageCrc32);
+  DriverStarted = !EFI_ERROR(Status)
+    && ApfsDriverIsStarted (ImageCrc32, EfiBootRecordBlock->EfiFileLen);
 
-    if (EfiFileBuffer == NULL) {
-      FreePool(ApfsBlock);
-      return EFI_OUT_OF_RESOURCES;
-    }
+  //
+  // Take EFI embedded file from the cache, or read it from extents
+  //
+  if (!DriverStarted) {
+    Status = ApfsDriverCacheLoad (&ContainerUuid, EfiBootRecordBlock, &EfiFileBuffer, &ImageCrc32);
+    if (EFI_ERROR(Status)) {
+      Status = ReadEfiBootRecordFile (
+        DiskIo,
+        DiskIo2,
+        MediaId,
+        EfiBootRecordBlock,
+        ApfsBlockSize,
+        &EfiFileBuffer
+        );
 
-    //
-    // Read current extent
-    //
-    Status = ReadDisk (
-      DiskIo,
-      DiskIo2,
-      MediaId,
-      EfiFileCurrentExtentOffset,
-      EfiFileCurrentExtentSize,
-      (UINT8*)EfiFileBuffer + CurPos
-      );
+      if (!EFI_ERROR(Status)) {
+        Status = gBS->CalculateCrc32 (EfiFileBuffer, EfiBootRecordBlock->EfiFileLen, &ImageCrc32);
+        if (EFI_ERROR(Status)) {
+          FreePool(EfiFileBuffer);
+        }
+      }
 
-    if (EFI_ERROR(Status)) {
-      FreePool(EfiFileBuffer);
-      FreePool(ApfsBlock);
-      return EFI_DEVICE_ERROR;
-    }
-    //
-    // Sum size for buffer offset
-    //
-    CurPos += EfiFileCurrentExtentSize;
+      if (EFI_ERROR(Status)) {
+        FreePool(ApfsBlock);
+        return Status == EFI_OUT_OF_RESOURCES ? Status : EFI_DEVICE_ERROR;
+      }
 
-  }
+      ApfsDriverCacheSave (&ContainerUuid, EfiBootRecordBlock, EfiFileBuffer, ImageCrc32);
+    }
 
-  //
-  // Drop tail
-  // We do it because we read blocksize aligned data
-  // Apfs driver size given in bytes
-  //
-  if (CurPos > EfiBootRecordBlock->EfiFileLen) {
-    //
-    // Zero tail
-    //
-    ZeroMem (
-      (UINT8*)EfiFileBuffer + EfiBootRecordBlock->EfiFileLen,
-      CurPos - EfiBootRecordBlock->EfiFileLen
-      );
-    //
-    // Reallocate buffer
-    //
-    EfiFileBuffer = ReallocatePool (
-                      CurPos,
-                      EfiBootRecordBlock->EfiFileLen,
-                      EfiFileBuffer
-                      );
+    DriverStarted = ApfsDriverIsStarted (ImageCrc32, EfiBootRecordBlock->EfiFileLen);
   }
 
   //
@@ -1025,11 +1298,26 @@ ApfsDriverLoaderStart (
     return Status;
   }
 
-  Status = StartApfsDriver (
-    ControllerHandle,
-    EfiFileBuffer,
-    EfiBootRecordBlock->EfiFileLen
-    );
+  if (DriverStarted) {
+    //
+    // The same apfs.efi already runs for another container, let it bind this one
+    //
+    DEBUG ((DEBUG_VERBOSE, "apfs.efi %08x already started, connecting\n", ImageCrc32));
+    gBS->ConnectController (ControllerHandle, NULL, NULL, TRUE);
+    Status = EFI_SUCCESS;
+  } else {
+    Status = StartApfsDriver (
+      ControllerHandle,
+      EfiFileBuffer,
+      EfiBootRecordBlock->EfiFileLen
+      );
+
+    if (!EFI_ERROR(Status) && mStartedDriverCount < APFS_MAX_STARTED_DRIVERS) {
+      mStartedDrivers[mStartedDriverCount].ImageCrc32 = ImageCrc32;
+      mStartedDrivers[mStartedDriverCount].ImageSize  = EfiBootRecordBlock->EfiFileLen;
+      mStartedDriverCount++;
+    }
+  }
 
   FreePool(ApfsBlock);
 
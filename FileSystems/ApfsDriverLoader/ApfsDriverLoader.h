@@ -24,6 +24,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Library/BaseMemoryLib.h>
 #include <Library/DevicePathLib.h>
 #include <Library/MemoryAllocationLib.h>
+#include <Library/PrintLib.h>
 #include <Library/UefiDriverEntryPoint.h>
 #include <Library/UefiBootServicesTableLib.h>
 #include <Library/UefiRuntimeServicesTableLib.h>
@@ -33,6 +34,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Protocol/BlockIo2.h>
 #include <Protocol/DiskIo2.h>
 #include <Protocol/LoadedImage.h>
+#include <Protocol/SimpleFileSystem.h>
 #include <Protocol/ComponentName.h>
 #include <Protocol/DriverBinding.h>
 #include <Protocol/PartitionInfo.h>
@@ -70,6 +72,28 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #define APFS_EFIBOOTRECORD_SIGNATURE  SIGNATURE_32 ('J', 'S', 'D', 'R')
 #define APFS_EFIBOOTRECORD_VERSION 1
 
+//
+// Container block size limits
+//
+#define APFS_MIN_BLOCK_SIZE  4096
+#define APFS_MAX_BLOCK_SIZE  65536
+
+//
+// Four-word checksum steps between reductions, keeps the Fletcher sums in 64 bits
+//
+#define APFS_CHECKSUM_REDUCE_STEPS  4096
+
+//
+// Embedded driver cache on the loader's own volume
+//
+#define APFS_DRIVER_CACHE_SIGNATURE  SIGNATURE_32 ('A', 'D', 'C', '1')
+#define APFS_DRIVER_CACHE_DIR        L"\\EFI\\CLOVER\\misc"
+
+//
+// Distinct embedded driver images remembered as started
+//
+#define APFS_MAX_STARTED_DRIVERS  8
+
 typedef struct PhysicalRange_ {
     INT64     StartPhysicalAddr;
     UINT64    BlockCount;
@@ -369,4 +393,35 @@ typedef struct APFS_EFI_BOOT_RECORD_
 } APFS_EFI_BOOT_RECORD;
 #pragma pack(pop)
 
+//
+// Header of an embedded driver cache file, the image follows
+//
+#pragma pack(push, 1)
+typedef struct APFS_DRIVER_CACHE_HEADER_
+{
+  UINT32             Signature;
+  UINT32             EfiFileLen;
+  //
+  // EfiBootRecord the image was read from
+  //
+  UINT64             RecordChecksum;
+  UINT64             RecordXid;
+  EFI_GUID           ContainerUuid;
+  //
+  // CRC32 of the image
+  //
+  UINT32             ImageCrc32;
+  UINT32             Reserved;
+} APFS_DRIVER_CACHE_HEADER;
+#pragma pack(pop)
+
+//
+// Embedded driver image started by this loader
+//
+typedef struct APFS_STARTED_DRIVER_
+{
+  UINT32             ImageCrc32;
+  UINT32             ImageSize;
+} APFS_STARTED_DRIVER;
+
 #endif // APFS_DRIVER_LOADER_H_
@@ -602,6 +602,8 @@ Returns:
   FAT_ODIR    *ODir;
   FAT_DIRENT  *DirEnt;
   EFI_STATUS  Status;
+  UINT32      LongNameHash;
+  UINT32      ShortNameHash;
 
   ODir = OFile->ODir;
   ASSERT (ODir != NULL);
@@ -610,17 +612,21 @@ Returns:
   //
   PossibleShortName = FatCheckIs8Dot3Name (FileNameString, File8Dot3Name);
   //
-  // Search the hash table first
+  // Search the hash table first. Once the whole directory has been read
+  // the tables hold every entry, and a name that is not there does not exist.
   //
   DirEnt = *FatLongNameHashSearch (ODir, FileNameString);
   if (DirEnt == NULL && PossibleShortName) {
       DirEnt = *FatShortNameHashSearch (ODir, File8Dot3Name);
   }
-  if (DirEnt == NULL) {
+  if (DirEnt == NULL && !ODir->EndOfDir) {
     //
     // We fail to get the directory entry from hash table; we then
-    // search the rest directory
+    // search the rest directory. Every loaded entry goes to the head of
+    // its hash chains, so only entries hashing like the name are compared.
     //
+    LongNameHash  = FatHashLongName (FileNameString);
+    ShortNameHash = FatHashShortName (File8Dot3Name);
     while (!ODir->EndOfDir) {
       Status = FatLoadNextDirEnt (OFile, &DirEnt);
       if (EFI_ERROR(Status)) {
@@ -628,11 +634,13 @@ Returns:
       }
 
       if (DirEnt != NULL) {
-        if (FatStriCmp (FileNameString, DirEnt->FileString) == 0) {
+        if (ODir->LongNameHashTable[LongNameHash] == DirEnt &&
+            FatStriCmp (FileNameString, DirEnt->FileString) == 0) {
           break;
         }
 
-        if (PossibleShortName && CompareMem (File8Dot3Name, DirEnt->Entry.FileName, FAT_NAME_LEN) == 0) {
+        if (PossibleShortName && ODir->ShortNameHashTable[ShortNameHash] == DirEnt &&
+            CompareMem (File8Dot3Name, DirEnt->Entry.FileName, FAT_NAME_LEN) == 0) {
           break;
         }
       }
@@ -99,6 +99,53 @@ Returns:
   }
 }
 
+STATIC
+BOOLEAN
+FatDataCacheRangeDirty (
+  IN  FAT_VOLUME         *Volume,
+  IN  UINTN              StartPageNo,
+  IN  UINTN              EndPageNo
+  )
+/*++
+
+Routine Description:
+
+  Check whether the Data Cache holds a dirty page in this range, whose content
+  is newer than the disk.
+
+Arguments:
+
+  Volume                - FAT file system volume.
+  StartPageNo           - First PageNo to be checked in the cache.
+  EndPageNo             - Last PageNo to be checked in the cache.
+
+Returns:
+
+  TRUE                  - A dirty page is in the range.
+  FALSE                 - The disk is up to date for the whole range.
+
+--*/
+{
+  UINTN       GroupNo;
+  DISK_CACHE  *DiskCache;
+  CACHE_TAG   *CacheTag;
+
+  DiskCache = &Volume->DiskCache[CACHE_DATA];
+  if (!DiskCache->Dirty) {
+    return FALSE;
+  }
+
+  for (GroupNo = 0; GroupNo <= DiskCache->GroupMask; GroupNo++) {
+    CacheTag = &DiskCache->CacheTag[GroupNo];
+    if (CacheTag->RealSize > 0 && CacheTag->Dirty &&
+        CacheTag->PageNo >= StartPageNo && CacheTag->PageNo <= EndPageNo) {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
 STATIC
 EFI_STATUS
 FatExchangeCachePage (
@@ -321,6 +368,8 @@ Routine Description:
      The access data will be divided into UnderRun data, Aligned data and OverRun data;
      The UnderRun data and OverRun data will be accessed by the Data cache,
      but the Aligned data will be accessed with disk directly.
+     A read of at least PcdFatDirectReadThreshold bytes is accessed with disk directly
+     as a whole, unless a dirty cache page overlaps it.
 
 Arguments:
 
@@ -362,6 +411,16 @@ Returns:
   PageNo        = (UINTN) RShiftU64 (EntryPos, PageAlignment);
   UnderRun      = ((UINTN) EntryPos) & (PageSize - 1);
 
+  //
+  // A large read (one cluster run of a kernel, a ramdisk or an image) needs no page
+  // of the cache: partial head and tail pages would cost a whole page read each
+  //
+  if (CacheDataType == CACHE_DATA && IoMode == READ_DISK &&
+      PcdGet32 (PcdFatDirectReadThreshold) != 0 && BufferSize >= PcdGet32 (PcdFatDirectReadThreshold) &&
+      !FatDataCacheRangeDirty (Volume, PageNo, (UINTN) RShiftU64 (EntryPos + BufferSize - 1, PageAlignment))) {
+    return FatDiskIo (Volume, IoMode, Offset, BufferSize, Buffer, Task);
+  }
+
   if (UnderRun > 0) {
     Length = PageSize - UnderRun;
     if (Length > BufferSize) {
@@ -499,14 +558,31 @@ Returns:
 {
   DISK_CACHE  *DiskCache;
   UINTN       FatCacheGroupCount;
+  UINTN       DataCacheGroupCount;
   UINTN       DataCacheSize;
   UINTN       FatCacheSize;
+  UINT8       DataPageAlignment;
   UINT8       *CacheBuffer;
 
   DiskCache = Volume->DiskCache;
   //
   // Configure the parameters of disk cache
   //
+  DataCacheGroupCount = PcdGet32 (PcdFatDataCachePageCount);
+  if (DataCacheGroupCount == 0) {
+    DataCacheGroupCount = 1;
+  } else if (DataCacheGroupCount > FAT_DATACACHE_GROUP_MAX_COUNT) {
+    DataCacheGroupCount = FAT_DATACACHE_GROUP_MAX_COUNT;
+  }
+  DataCacheGroupCount = GetPowerOfTwo32 ((UINT32) DataCacheGroupCount);
+
+  DataPageAlignment = PcdGet8 (PcdFatDataCachePageAlignment);
+  if (DataPageAlignment < FAT_DATACACHE_PAGE_MIN_ALIGNMENT) {
+    DataPageAlignment = FAT_DATACACHE_PAGE_MIN_ALIGNMENT;
+  } else if (DataPageAlignment > FAT_DATACACHE_PAGE_MAX_ALIGNMENT) {
+    DataPageAlignment = FAT_DATACACHE_PAGE_MAX_ALIGNMENT;
+  }
+
   if (Volume->FatType == FAT12) {
     FatCacheGroupCount                  = FAT_FATCACHE_GROUP_MIN_COUNT;
     DiskCache[CACHE_FAT].PageAlignment  = FAT_FATCACHE_PAGE_MIN_ALIGNMENT;
@@ -514,21 +590,21 @@ Returns:
   } else {
     FatCacheGroupCount                  = FAT_FATCACHE_GROUP_MAX_COUNT;
     DiskCache[CACHE_FAT].PageAlignment  = FAT_FATCACHE_PAGE_MAX_ALIGNMENT;
-    DiskCache[CACHE_DATA].PageAlignment = FAT_DATACACHE_PAGE_MAX_ALIGNMENT;
+    DiskCache[CACHE_DATA].PageAlignment = DataPageAlignment;
   }
 
-  DiskCache[CACHE_DATA].GroupMask     = FAT_DATACACHE_GROUP_COUNT - 1;
+  DiskCache[CACHE_DATA].GroupMask     = DataCacheGroupCount - 1;
   DiskCache[CACHE_DATA].BaseAddress   = Volume->RootPos;
   DiskCache[CACHE_DATA].LimitAddress  = Volume->VolumeSize;
   DiskCache[CACHE_FAT].GroupMask      = FatCacheGroupCount - 1;
   DiskCache[CACHE_FAT].BaseAddress    = Volume->FatPos;
   DiskCache[CACHE_FAT].LimitAddress   = Volume->FatPos + Volume->FatSize;
   FatCacheSize                        = FatCacheGroupCount << DiskCache[CACHE_FAT].PageAlignment;
-  DataCacheSize                       = FAT_DATACACHE_GROUP_COUNT << DiskCache[CACHE_DATA].PageAlignment;
+  DataCacheSize                       = DataCacheGroupCount << DiskCache[CACHE_DATA].PageAlignment;
   //
-  // Allocate the Fat Cache buffer
+  // Allocate the Fat Cache buffer, the cache tags of both caches follow the pages
   //
-  CacheBuffer = AllocateZeroPool(FatCacheSize + DataCacheSize);
+  CacheBuffer = AllocateZeroPool(FatCacheSize + DataCacheSize + (FatCacheGroupCount + DataCacheGroupCount) * sizeof (CACHE_TAG));
   if (CacheBuffer == NULL) {
     return EFI_OUT_OF_RESOURCES;
   }
@@ -536,5 +612,7 @@ Returns:
   Volume->CacheBuffer             = CacheBuffer;
   DiskCache[CACHE_FAT].CacheBase  = CacheBuffer;
   DiskCache[CACHE_DATA].CacheBase = CacheBuffer + FatCacheSize;
+  DiskCache[CACHE_FAT].CacheTag   = (CACHE_TAG *) (CacheBuffer + FatCacheSize + DataCacheSize);
+  DiskCache[CACHE_DATA].CacheTag  = DiskCache[CACHE_FAT].CacheTag + FatCacheGroupCount;
   return EFI_SUCCESS;
 }
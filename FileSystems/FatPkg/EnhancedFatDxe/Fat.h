@@ -86,13 +86,14 @@ Revision History
 
 //
 // Minimum fat page size is 8K, maximum fat page alignment is 32K
-// Minimum data page size is 8K, maximum fat page alignment is 64K
+// Minimum data page size is 8K, maximum data page alignment is 1M,
+// data page size and count come from PcdFatDataCachePageAlignment and PcdFatDataCachePageCount
 //
 #define FAT_FATCACHE_PAGE_MIN_ALIGNMENT   13
 #define FAT_FATCACHE_PAGE_MAX_ALIGNMENT   15
 #define FAT_DATACACHE_PAGE_MIN_ALIGNMENT  13
-#define FAT_DATACACHE_PAGE_MAX_ALIGNMENT  16
-#define FAT_DATACACHE_GROUP_COUNT         64
+#define FAT_DATACACHE_PAGE_MAX_ALIGNMENT  20
+#define FAT_DATACACHE_GROUP_MAX_COUNT     1024
 #define FAT_FATCACHE_GROUP_MIN_COUNT      1
 #define FAT_FATCACHE_GROUP_MAX_COUNT      16
 
@@ -118,6 +119,15 @@ Revision History
 
 #define FAT_MAX_DIR_CACHE_COUNT 8
 #define FAT_MAX_DIRENTRY_COUNT  0xFFFF
+
+//
+// Volatile variable (UINT32, milliseconds) under gFatPkgCloverVariableGuid that turns on
+// delayed metadata commits: FAT, dirent and FSInfo updates stay in the disk cache and are
+// written by a per-volume timer, by an explicit Flush() or when the volume is stopped.
+// Absent or zero keeps the original commit on every request.
+//
+#define FAT_DELAYED_FLUSH_VARIABLE_NAME L"Clover.FatDelayedFlush"
+#define FAT_DELAYED_FLUSH_MAX_DELAY     10000
 typedef CHAR8                   LC_ISO_639_2;
 
 //
@@ -168,7 +178,7 @@ typedef struct {
   BOOLEAN   Dirty;
   UINT8     PageAlignment;
   UINTN     GroupMask;
-  CACHE_TAG CacheTag[FAT_DATACACHE_GROUP_COUNT];
+  CACHE_TAG *CacheTag;      // GroupMask + 1 tags, allocated with the cache pages
 } DISK_CACHE;
 
 //
@@ -177,6 +187,11 @@ typedef struct {
 #define HASH_TABLE_SIZE  0x400
 #define HASH_TABLE_MASK  (HASH_TABLE_SIZE - 1)
 
+//
+// Code points folded through the precomputed upper-case table
+//
+#define FAT_UPCASE_TABLE_SIZE  0x100
+
 //
 // The directory entry for opened directory
 //
@@ -354,6 +369,12 @@ typedef struct _FAT_VOLUME {
   UINT32                          DirtyValue;
   UINT32                          NotDirtyValue;
 
+  //
+  // Delayed commit of the volume metadata
+  //
+  EFI_EVENT                       CommitEvent;    // Timer that commits pending updates
+  BOOLEAN                         CommitPending;  // If a commit is deferred to CommitEvent
+
   //
   // The root directory entry and opened root file
   //
@@ -836,6 +857,19 @@ FatCleanupVolume (
   IN FAT_TASK           *Task
   );
 
+EFI_STATUS
+FatCommitVolume (
+  IN FAT_VOLUME         *Volume,
+  IN FAT_TASK           *Task
+  );
+
+VOID
+EFIAPI
+FatCommitTimerNotify (
+  IN EFI_EVENT          Event,
+  IN VOID               *Context
+  );
+
 //
 // FileSpace.c
 //
@@ -1021,6 +1055,11 @@ FatStrUpr (
   IN CHAR16             *Str
   );
 
+CHAR16
+FatCharUpr (
+  IN CHAR16             Char
+  );
+
 INTN
 FatStriCmp (
   IN CHAR16             *Str1,
@@ -1183,6 +1222,16 @@ FatSetVolumeEntry (
 //
 // Hash.c
 //
+UINT32
+FatHashLongName (
+  IN CHAR16             *LongNameString
+  );
+
+UINT32
+FatHashShortName (
+  IN CHAR8              *ShortNameString
+  );
+
 FAT_DIRENT **
 FatLongNameHashSearch (
   IN FAT_ODIR           *ODir,
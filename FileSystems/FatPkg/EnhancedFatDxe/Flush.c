@@ -96,6 +96,12 @@ Returns:
   FatAcquireLock ();
   Status  = FatOFileFlush (OFile);
   Status  = FatCleanupVolume (OFile->Volume, OFile, Status, Task);
+  //
+  // An explicit flush also commits the updates deferred on the volume.
+  //
+  if (!EFI_ERROR(Status) && Volume->Valid && Volume->CommitPending) {
+    Status = FatCommitVolume (Volume, Task);
+  }
   FatReleaseLock ();
 
   if (Token != NULL) {
@@ -410,6 +416,102 @@ Returns:
   }
 }
 
+STATIC
+UINT32
+FatGetCommitDelay (
+  VOID
+  )
+/*++
+
+Routine Description:
+
+  Read the delayed commit policy set by the boot manager.
+
+Arguments:
+
+  None.
+
+Returns:
+
+  The commit delay in milliseconds, 0 if updates are committed at once.
+
+--*/
+{
+  EFI_STATUS  Status;
+  UINT32      Delay;
+  UINTN       DataSize;
+
+  Delay     = 0;
+  DataSize  = sizeof (Delay);
+  Status    = gRT->GetVariable (
+                     FAT_DELAYED_FLUSH_VARIABLE_NAME,
+                     &gFatPkgCloverVariableGuid,
+                     NULL,
+                     &DataSize,
+                     &Delay
+                     );
+  if (EFI_ERROR(Status) || DataSize != sizeof (Delay)) {
+    return 0;
+  }
+
+  return MIN (Delay, FAT_DELAYED_FLUSH_MAX_DELAY);
+}
+
+STATIC
+BOOLEAN
+FatDeferCommit (
+  IN FAT_VOLUME       *Volume,
+  IN FAT_TASK         *Task
+  )
+/*++
+
+Routine Description:
+
+  Decide whether the metadata commit of a request can be left to the volume
+  commit timer. The timer is armed by the first deferred request only, so
+  a steady stream of updates is still committed once per delay.
+
+Arguments:
+
+  Volume                - The volume being cleaned up.
+  Task                  - The non-blocking task of the request, if any.
+
+Returns:
+
+  TRUE                  - The commit is pending on the volume timer.
+  FALSE                 - The caller has to commit now.
+
+--*/
+{
+  EFI_STATUS  Status;
+  UINT32      Delay;
+
+  //
+  // Non-blocking requests complete with their writes, and a read only
+  // volume has nothing to commit.
+  //
+  if (Task != NULL || Volume->ReadOnly || Volume->CommitEvent == NULL) {
+    return FALSE;
+  }
+
+  if (Volume->CommitPending) {
+    return TRUE;
+  }
+
+  Delay = FatGetCommitDelay ();
+  if (Delay == 0) {
+    return FALSE;
+  }
+
+  Status = gBS->SetTimer (Volume->CommitEvent, TimerRelative, MultU64x32 (Delay, 10000));
+  if (EFI_ERROR(Status)) {
+    return FALSE;
+  }
+
+  Volume->CommitPending = TRUE;
+  return TRUE;
+}
+
 EFI_STATUS
 FatCleanupVolume (
   IN FAT_VOLUME       *Volume,
@@ -452,31 +554,8 @@ Returns:
   // volume be cleaned up even the volume is invalid.
   //
   FatCheckVolumeRef (Volume);
-  if (Volume->Valid) {
-    //
-    // Update the free hint info. Volume->FreeInfoPos != 0
-    // indicates this a FAT32 volume
-    //
-    if (Volume->FreeInfoValid && Volume->FatDirty && Volume->FreeInfoPos) {
-      Status = FatDiskIo (Volume, WRITE_DISK, Volume->FreeInfoPos, sizeof (FAT_INFO_SECTOR), &Volume->FatInfoSector, Task);
-      if (EFI_ERROR(Status)) {
-        return Status;
-      }
-    }
-    //
-    // Update that the volume is not dirty
-    //
-    if (Volume->FatDirty && Volume->FatType != FAT12) {
-      Volume->FatDirty  = FALSE;
-      Status            = FatAccessVolumeDirty (Volume, WRITE_FAT, &Volume->NotDirtyValue);
-      if (EFI_ERROR(Status)) {
-        return Status;
-      }
-    }
-    //
-    // Flush all dirty cache entries to disk
-    //
-    Status = FatVolumeFlushCache (Volume, Task);
+  if (Volume->Valid && !FatDeferCommit (Volume, Task)) {
+    Status = FatCommitVolume (Volume, Task);
     if (EFI_ERROR(Status)) {
       return Status;
     }
@@ -534,3 +613,106 @@ Returns:
     FatSetVolumeError (ChildOFile, Status);
   }
 }
+
+EFI_STATUS
+FatCommitVolume (
+  IN FAT_VOLUME       *Volume,
+  IN FAT_TASK         *Task
+  )
+/*++
+
+Routine Description:
+
+  Write the free cluster info, mark the volume clean and flush all dirty
+  cache entries of the volume to the disk.
+
+Arguments:
+
+  Volume                - The volume to commit.
+  Task                  - The non-blocking task of the request, if any.
+
+Returns:
+
+  EFI_SUCCESS           - The volume metadata is on the disk.
+  Others                - Writing to the disk failed.
+
+--*/
+{
+  EFI_STATUS  Status;
+
+  Volume->CommitPending = FALSE;
+  if (Volume->CommitEvent != NULL) {
+    gBS->SetTimer (Volume->CommitEvent, TimerCancel, 0);
+  }
+  //
+  // Update the free hint info. Volume->FreeInfoPos != 0
+  // indicates this a FAT32 volume
+  //
+  if (Volume->FreeInfoValid && Volume->FatDirty && Volume->FreeInfoPos) {
+    Status = FatDiskIo (Volume, WRITE_DISK, Volume->FreeInfoPos, sizeof (FAT_INFO_SECTOR), &Volume->FatInfoSector, Task);
+    if (EFI_ERROR(Status)) {
+      return Status;
+    }
+  }
+  //
+  // Update that the volume is not dirty
+  //
+  if (Volume->FatDirty && Volume->FatType != FAT12) {
+    Volume->FatDirty  = FALSE;
+    Status            = FatAccessVolumeDirty (Volume, WRITE_FAT, &Volume->NotDirtyValue);
+    if (EFI_ERROR(Status)) {
+      return Status;
+    }
+  }
+  //
+  // Flush all dirty cache entries to disk
+  //
+  return FatVolumeFlushCache (Volume, Task);
+}
+
+VOID
+EFIAPI
+FatCommitTimerNotify (
+  IN EFI_EVENT        Event,
+  IN VOID             *Context
+  )
+/*++
+
+Routine Description:
+
+  Commit timer of a volume. Writes the updates deferred by FatCleanupVolume.
+
+Arguments:
+
+  Event                 - The volume commit timer.
+  Context               - The volume.
+
+Returns:
+
+  None.
+
+--*/
+{
+  FAT_VOLUME  *Volume;
+  EFI_STATUS  Status;
+
+  Volume = (FAT_VOLUME *) Context;
+
+  //
+  // A request is in progress on the volume, try again shortly.
+  //
+  Status = FatAcquireLockOrFail ();
+  if (EFI_ERROR(Status)) {
+    gBS->SetTimer (Event, TimerRelative, MultU64x32 (FAT_DELAYED_FLUSH_MAX_DELAY / 10, 10000));
+    return;
+  }
+
+  if (Volume->Valid && Volume->CommitPending) {
+    Status = FatCommitVolume (Volume, NULL);
+    if (EFI_ERROR(Status)) {
+      DEBUG ((EFI_D_ERROR, "FAT: delayed commit failed, %r\n", Status));
+    }
+  }
+
+  FatReleaseLock ();
+}
@@ -20,7 +20,13 @@ Revision History
 
 #include "Fat.h"
 
-STATIC
+//
+// FNV-1a, folded to the table size
+//
+#define FAT_HASH_BASIS  0x811C9DC5
+#define FAT_HASH_PRIME  0x01000193
+#define FAT_HASH_FOLD(Hash)  (((Hash) ^ ((Hash) >> 10) ^ ((Hash) >> 20)) & HASH_TABLE_MASK)
+
 UINT32
 FatHashLongName (
   IN CHAR16   *LongNameString
@@ -29,7 +35,8 @@ FatHashLongName (
 
 Routine Description:
 
-  Get hash value for long name.
+  Get hash value for long name. Characters are upper-cased one at a time through
+  the collation table, equal names in any case get the same value.
 
 Arguments:
 
@@ -42,19 +49,18 @@ Returns:
 --*/
 {
   UINT32  HashValue;
-  CHAR16  UpCasedLongFileName[EFI_PATH_STRING_LENGTH];
-  StrnCpyS (
-    UpCasedLongFileName,
-    sizeof (UpCasedLongFileName) / sizeof (UpCasedLongFileName[0]),
-    LongNameString,
-    sizeof (UpCasedLongFileName) / sizeof (UpCasedLongFileName[0]) - 1
-    );
-  FatStrUpr (UpCasedLongFileName);
-  gBS->CalculateCrc32 (UpCasedLongFileName, StrSize (UpCasedLongFileName), &HashValue);
-  return (HashValue & HASH_TABLE_MASK);
+  UINTN   Index;
+  CHAR16  Char;
+
+  HashValue = FAT_HASH_BASIS;
+  for (Index = 0; LongNameString[Index] != 0 && Index < EFI_PATH_STRING_LENGTH - 1; Index++) {
+    Char      = FatCharUpr (LongNameString[Index]);
+    HashValue = (HashValue ^ (Char & 0xFF)) * FAT_HASH_PRIME;
+    HashValue = (HashValue ^ (Char >> 8)) * FAT_HASH_PRIME;
+  }
+  return FAT_HASH_FOLD (HashValue);
 }
 
-STATIC
 UINT32
 FatHashShortName (
   IN CHAR8   *ShortNameString
@@ -76,8 +82,13 @@ Returns:
 --*/
 {
   UINT32  HashValue;
-  gBS->CalculateCrc32 (ShortNameString, FAT_NAME_LEN, &HashValue);
-  return (HashValue & HASH_TABLE_MASK);
+  UINTN   Index;
+
+  HashValue = FAT_HASH_BASIS;
+  for (Index = 0; Index < FAT_NAME_LEN; Index++) {
+    HashValue = (HashValue ^ (UINT8) ShortNameString[Index]) * FAT_HASH_PRIME;
+  }
+  return FAT_HASH_FOLD (HashValue);
 }
 
 FAT_DIRENT **
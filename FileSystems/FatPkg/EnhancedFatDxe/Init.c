@@ -91,6 +91,19 @@ Returns:
     goto Done;
   }
   //
+  // Timer for the delayed commit policy, only armed when the policy is on
+  //
+  Status = gBS->CreateEvent (
+                  EVT_TIMER | EVT_NOTIFY_SIGNAL,
+                  TPL_CALLBACK,
+                  FatCommitTimerNotify,
+                  Volume,
+                  &Volume->CommitEvent
+                  );
+  if (EFI_ERROR(Status)) {
+    goto Done;
+  }
+  //
   // Install our protocol interfaces on the device's handle
   //
   Status = gBS->InstallMultipleProtocolInterfaces (
@@ -172,6 +185,13 @@ Returns:
   // use. In two cases, we could get here. One is EFI_MEDIA_CHANGED, the other is
   // EFI_NO_MEDIA.
   //
+  //
+  // Do not lose updates still waiting for the commit timer.
+  //
+  if (LockedByMe && Volume->CommitPending) {
+    FatCommitVolume (Volume, NULL);
+  }
+
   if (Volume->Root != NULL) {
     FatSetVolumeError (
       Volume->Root,
@@ -552,6 +552,12 @@ Returns:
 
 --*/
 {
+  //
+  // Stop the commit timer
+  //
+  if (Volume->CommitEvent != NULL) {
+    gBS->CloseEvent (Volume->CommitEvent);
+  }
   //
   // Free disk cache
   //
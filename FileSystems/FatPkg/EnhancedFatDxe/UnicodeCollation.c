@@ -13,6 +13,38 @@
 
 EFI_UNICODE_COLLATION_PROTOCOL  *mUnicodeCollationInterface = NULL;
 
+//
+// Upper case of the first FAT_UPCASE_TABLE_SIZE code points, as StrUpr of the
+// collation protocol in use maps them. Rebuilt whenever the protocol is located.
+//
+STATIC CHAR16                   mFatUpCaseTable[FAT_UPCASE_TABLE_SIZE];
+
+/**
+  Fill the upper-case table with one StrUpr call of the current collation protocol.
+
+**/
+STATIC
+VOID
+FatBuildUpCaseTable (
+  VOID
+  )
+{
+  UINTN   Index;
+  CHAR16  String[FAT_UPCASE_TABLE_SIZE];
+
+  for (Index = 1; Index < FAT_UPCASE_TABLE_SIZE; Index++) {
+    String[Index - 1] = (CHAR16) Index;
+  }
+  String[FAT_UPCASE_TABLE_SIZE - 1] = 0;
+
+  mUnicodeCollationInterface->StrUpr (mUnicodeCollationInterface, String);
+
+  mFatUpCaseTable[0] = 0;
+  for (Index = 1; Index < FAT_UPCASE_TABLE_SIZE; Index++) {
+    mFatUpCaseTable[Index] = String[Index - 1];
+  }
+}
+
 /**
   Worker function to initialize Unicode Collation support.
 
@@ -149,6 +181,10 @@ InitializeUnicodeCollationSupport (
                );
   }
 
+  if (!EFI_ERROR(Status)) {
+    FatBuildUpCaseTable ();
+  }
+
   return Status;
 }
 
@@ -201,6 +237,32 @@ FatStrUpr (
 }
 
 
+/**
+  Uppercase a character. Characters of the precomputed table need no protocol call.
+
+  @param  Char                  The character to be upper-cased.
+
+  @return The upper-case character.
+
+**/
+CHAR16
+FatCharUpr (
+  IN CHAR16       Char
+  )
+{
+  CHAR16  String[2];
+
+  if (Char < FAT_UPCASE_TABLE_SIZE) {
+    return mFatUpCaseTable[Char];
+  }
+
+  String[0] = Char;
+  String[1] = 0;
+  FatStrUpr (String);
+  return String[0];
+}
+
+
 /**
   Lowercase a string
 
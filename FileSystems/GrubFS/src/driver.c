@@ -400,6 +400,7 @@ FSDriverInstall(EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE* SystemTable)
 
 	//InitializeLib(ImageHandle, SystemTable);
 	SetLogging();
+	SetDiskCache();
 	EfiImageHandle = ImageHandle;
 
 	/* Prevent the driver from being loaded twice by detecting and trying to
@@ -115,6 +115,40 @@ extern Print_t PrintExtra;
 /* Forward declaration */
 struct _EFI_FS;
 
+/* Directory entry cache, see path.c */
+#define DENTRY_CACHE_BUCKETS    256
+#define DENTRY_CACHE_MAX        4096
+
+#define DENTRY_EXISTS           0x01
+#define DENTRY_DIR              0x02
+#define DENTRY_MTIME            0x04
+#define DENTRY_CASE_INSENSITIVE 0x08
+#define DENTRY_LISTED           0x10
+
+/* A cached lookup result, keyed by normalized absolute path. Entries without
+ * DENTRY_EXISTS are negative. DENTRY_LISTED is set on directories whose
+ * every child is in the cache, so any other name below them is known missing.
+ */
+typedef struct _EFI_FS_DENTRY {
+	struct _EFI_FS_DENTRY *Next;
+	UINT32                 Hash;
+	UINT32                 Flags;
+	INT32                  Mtime;
+	CHAR8                  Path[1];
+} EFI_FS_DENTRY;
+
+/* Disk cache, see grub_file.c. The size can be overridden (in KB, 0 disables
+ * the cache) through the FS_DISK_CACHE shell variable.
+ */
+#define DISK_CACHE_DEFAULT_KB   2048
+#define DISK_CACHE_WAYS         4
+
+typedef struct _EFI_FS_CACHE_LINE {
+	UINT64                 Tag;
+	UINT32                 Age;
+	BOOLEAN                Valid;
+} EFI_FS_CACHE_LINE;
+
 /* A file instance */
 typedef struct _EFI_GRUB_FILE {
 	EFI_FILE               EfiFile;
@@ -142,6 +176,18 @@ typedef struct _EFI_FS {
 	EFI_GRUB_FILE         *RootFile;
 	VOID                  *GrubDevice;
 	CHAR16                *DevicePathString;
+	EFI_FS_DENTRY        **DentryCache;
+	UINTN                  DentryCount;
+	BOOLEAN                DentryCacheFull;
+	UINT8                 *DiskCacheData;
+	EFI_FS_CACHE_LINE     *DiskCacheLines;
+	UINTN                  DiskCacheSets;
+	UINT32                 DiskCacheMediaId;
+	UINT32                 DiskCacheClock;
+	UINT64                 DiskCacheHits;
+	UINT64                 DiskCacheMisses;
+	UINT64                 DiskCacheDirect;
+	UINT64                 DiskCacheReported;
 } EFI_FS;
 
 /* Mirrors a similar construct from GRUB, while EFI-zing it */
@@ -166,6 +212,9 @@ extern VOID strcpya(CHAR8 *dst, CONST CHAR8 *src);
 extern CHAR8 *strchra(const CHAR8 *s, INTN c);
 extern CHAR8 *strrchra(const CHAR8 *s, INTN c);
 extern VOID SetLogging(VOID);
+extern VOID SetDiskCache(VOID);
+extern VOID DiskCacheLog(EFI_FS *This);
+extern VOID DiskCacheFree(EFI_FS *This);
 extern VOID EFIAPI PrintStatusError(EFI_STATUS Status, const CHAR16 *Format, ...);
 extern VOID GrubDriverInit(VOID);
 extern VOID GrubDriverExit(VOID);
@@ -175,6 +224,11 @@ extern EFI_STATUS GrubDeviceInit(EFI_FS *This);
 extern EFI_STATUS GrubDeviceExit(EFI_FS *This);
 extern VOID GrubTimeToEfiTime(const INT32 t, EFI_TIME *tp);
 extern VOID CopyPathRelative(CHAR8 *dest, CHAR8 *src, INTN len);
+extern EFI_FS_DENTRY *DentryLookup(EFI_FS *This, CONST CHAR8 *path);
+extern EFI_FS_DENTRY *DentryAdd(EFI_FS *This, CONST CHAR8 *path, UINTN len,
+		UINT32 Flags, INT32 Mtime);
+extern VOID DentryMarkListed(EFI_FS *This, CONST CHAR8 *path);
+extern VOID DentryCacheFree(EFI_FS *This);
 extern EFI_STATUS GrubOpen(EFI_GRUB_FILE *File);
 extern EFI_STATUS GrubDir(EFI_GRUB_FILE *File, const CHAR8 *path,
 		GRUB_DIRHOOK Hook, VOID *HookData);
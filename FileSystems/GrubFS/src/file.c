@@ -41,11 +41,33 @@ FileName(EFI_GRUB_FILE *File)
 	return Path;
 }
 
-/* Simple hook to populate the timestamp and directory flag when opening a file */
+/* Simple hook to populate the timestamp and directory flag when opening a file.
+ * All the other entries of the directory are added to the dentry cache on the way.
+ */
 static INT32
 InfoHook(const CHAR8 *name, const GRUB_DIRHOOK_INFO *Info, VOID *Data)
 {
 	EFI_GRUB_FILE *File = (EFI_GRUB_FILE *) Data;
+	CHAR8 path[MAX_PATH];
+	INTN dirlen = File->basename - File->path, namelen = strlena(name);
+	UINT32 Flags = DENTRY_EXISTS;
+
+	if ((strcmpa(name, ".") != 0) && (strcmpa(name, "..") != 0)) {
+		if (dirlen + namelen < MAX_PATH) {
+			CopyMem(path, File->path, dirlen);
+			CopyMem(&path[dirlen], name, namelen);
+			if (Info->Dir)
+				Flags |= DENTRY_DIR;
+			if (Info->MtimeSet)
+				Flags |= DENTRY_MTIME;
+			if (Info->CaseInsensitive)
+				Flags |= DENTRY_CASE_INSENSITIVE;
+			DentryAdd(File->FileSystem, path, dirlen + namelen, Flags, Info->Mtime);
+		} else {
+			/* Can't cache this one, so the listing is incomplete */
+			File->FileSystem->DentryCacheFull = TRUE;
+		}
+	}
 
 	/* Look for a specific file */
 	if (strcmpa(name, File->basename) != 0)
@@ -75,6 +97,7 @@ FileOpen(EFI_FILE_HANDLE This, EFI_FILE_HANDLE *New,
 	EFI_STATUS Status;
 	EFI_GRUB_FILE *File = _CR(This, EFI_GRUB_FILE, EfiFile);
 	EFI_GRUB_FILE *NewFile;
+	EFI_FS_DENTRY *Dentry;
 
 	// TODO: Use dynamic buffers?
 	char path[MAX_PATH], clean_path[MAX_PATH], *dirname;
@@ -142,6 +165,13 @@ FileOpen(EFI_FILE_HANDLE This, EFI_FILE_HANDLE *New,
 		return EFI_SUCCESS;
 	}
 
+	/* Known missing paths fail without walking the directories again */
+	Dentry = DentryLookup(File->FileSystem, clean_path);
+	if ((Dentry != NULL) && !(Dentry->Flags & DENTRY_EXISTS)) {
+		PrintInfo(L"  Not found (cached)\n");
+		return EFI_NOT_FOUND;
+	}
+
 	// TODO: eventually we should seek for already opened files and increase RefCount */
 	/* Allocate and initialise an instance of a file */
 	Status = GrubCreateFile(&NewFile, File->FileSystem);
@@ -170,10 +200,21 @@ FileOpen(EFI_FILE_HANDLE This, EFI_FILE_HANDLE *New,
 	NewFile->basename = &NewFile->path[i+1];
 
 	/* Find if we're working with a directory and fill the grub timestamp */
-	Status = GrubDir(NewFile, dirname, InfoHook, (VOID *) NewFile);
+	if (Dentry != NULL) {
+		NewFile->IsDir = (Dentry->Flags & DENTRY_DIR) != 0;
+		if (Dentry->Flags & DENTRY_MTIME)
+			NewFile->Mtime = Dentry->Mtime;
+		Status = EFI_SUCCESS;
+	} else {
+		Status = GrubDir(NewFile, dirname, InfoHook, (VOID *) NewFile);
+		if (!EFI_ERROR(Status))
+			DentryMarkListed(File->FileSystem, dirname);
+	}
 	if (EFI_ERROR(Status)) {
 		if (Status != EFI_NOT_FOUND)
 			PrintStatusError(Status, L"Could not get file attributes for '%s'", Name);
+		else
+			DentryAdd(File->FileSystem, NewFile->path, strlena(NewFile->path), 0, 0);
 
         if (NewFile->path != NULL)
         {
@@ -191,6 +232,8 @@ FileOpen(EFI_FILE_HANDLE This, EFI_FILE_HANDLE *New,
 		if (EFI_ERROR(Status)) {
 			if (Status != EFI_NOT_FOUND)
 				PrintStatusError(Status, L"Could not open file '%s'", Name);
+			else
+				DentryAdd(File->FileSystem, NewFile->path, strlena(NewFile->path), 0, 0);
 
             if (NewFile->path != NULL)
             {
@@ -231,9 +274,13 @@ FileClose(EFI_FILE_HANDLE This)
 	PrintInfo(L"Close(%llx|'%s') %s\n", (UINTN) This, FileName(File),
 		IS_ROOT(File)?L"<ROOT>":L"");
 
-	/* Nothing to do it this is the root */
-	if (IS_ROOT(File))
+	/* Nothing to do it this is the root. Clover closes it once it is done
+	 * scanning the volume though, so that's when we report on the disk cache.
+	 */
+	if (IS_ROOT(File)) {
+		DiskCacheLog(File->FileSystem);
 		return EFI_SUCCESS;
+	}
 
 	if (--File->RefCount == 0) {
 		/* Close the file if it's a regular one */
@@ -775,4 +822,7 @@ FSUninstall(EFI_FS *This, EFI_HANDLE ControllerHandle)
 	BS->UninstallMultipleProtocolInterfaces(ControllerHandle,
 			&gEfiSimpleFileSystemProtocolGuid, &This->FileIoInterface,
 			NULL);
+
+	DiskCacheLog(This);
+	DentryCacheFree(This);
 }
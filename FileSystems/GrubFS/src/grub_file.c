@@ -27,6 +27,8 @@
 
 #include "driver.h"
 
+#include <Protocol/MsgLog.h>
+
 /* The file system list should only ever contain one element */
 grub_fs_t grub_fs_list = NULL;
 
@@ -137,6 +139,165 @@ grub_device_iterate(grub_device_iterate_hook_t hook, void *hook_data)
 */
 grub_disk_read_hook_t grub_file_progress_hook = NULL;
 
+/* A small set-associative cache sits between GRUB and DiskIo, since the GRUB
+ * fs modules tend to re-read the same metadata sectors (MFT records, B-tree
+ * nodes, FAT) over and over. Lines are GRUB_DISK_CACHE_SIZE sectors, as in
+ * GRUB's own disk.c, and are allocated on first access to a volume.
+ * Whole-line data reads bypass the cache, so that large file reads do not
+ * evict metadata.
+ */
+#define DISK_CACHE_LINE_SIZE	(GRUB_DISK_CACHE_SIZE << GRUB_DISK_SECTOR_BITS)
+
+static MESSAGE_LOG_PROTOCOL *Msg = NULL;
+static CHAR8 *msgCursor = NULL;
+static UINTN DiskCacheSize = DISK_CACHE_DEFAULT_KB * 1024;
+
+/* You can set the size of the per-volume disk cache, in KB, through the shell
+ * environment variable FS_DISK_CACHE. A value of 0 disables the cache.
+ */
+VOID
+SetDiskCache(VOID)
+{
+	EFI_STATUS Status;
+	CHAR16 CacheVar[8];
+	UINTN CacheVarSize = sizeof(CacheVar);
+
+	Status = RT->GetVariable(L"FS_DISK_CACHE", &ShellVariable, NULL, &CacheVarSize, CacheVar);
+	if ((Status == EFI_SUCCESS) && (CacheVarSize >= sizeof(CHAR16))) {
+		CacheVar[MIN(CacheVarSize / sizeof(CHAR16), ARRAY_SIZE(CacheVar)) - 1] = 0;
+		DiskCacheSize = (UINTN) Atoi(CacheVar) * 1024;
+	}
+
+	PrintExtra(L"DiskCacheSize = %d KB\n", DiskCacheSize / 1024);
+}
+
+static EFI_STATUS
+DiskReadRaw(EFI_FS *FileSystem, EFI_BLOCK_IO_MEDIA *Media, UINT64 Offset,
+		UINTN Size, VOID *Buf)
+{
+	if (FileSystem->DiskIo2 != NULL)
+		return FileSystem->DiskIo2->ReadDiskEx(FileSystem->DiskIo2, Media->MediaId,
+				Offset, &(FileSystem->DiskIo2Token), Size, Buf);
+	return FileSystem->DiskIo->ReadDisk(FileSystem->DiskIo, Media->MediaId,
+			Offset, Size, Buf);
+}
+
+static VOID
+DiskCacheInit(EFI_FS *FileSystem)
+{
+	UINTN Sets = DiskCacheSize / (DISK_CACHE_WAYS * DISK_CACHE_LINE_SIZE);
+
+	if ((Sets == 0) || (Sets > MAX_UINT32))
+		return;
+	FileSystem->DiskCacheLines = AllocateZeroPool(Sets * DISK_CACHE_WAYS *
+			sizeof(EFI_FS_CACHE_LINE));
+	FileSystem->DiskCacheData = AllocatePool(Sets * DISK_CACHE_WAYS *
+			DISK_CACHE_LINE_SIZE);
+	if ((FileSystem->DiskCacheLines == NULL) || (FileSystem->DiskCacheData == NULL)) {
+		PrintWarning(L"Could not allocate disk cache\n");
+		DiskCacheFree(FileSystem);
+		return;
+	}
+	FileSystem->DiskCacheSets = Sets;
+}
+
+VOID
+DiskCacheFree(EFI_FS *FileSystem)
+{
+	if (FileSystem->DiskCacheLines != NULL) {
+		FreePool(FileSystem->DiskCacheLines);
+		FileSystem->DiskCacheLines = NULL;
+	}
+	if (FileSystem->DiskCacheData != NULL) {
+		FreePool(FileSystem->DiskCacheData);
+		FileSystem->DiskCacheData = NULL;
+	}
+	FileSystem->DiskCacheSets = 0;
+}
+
+/* Return the way holding Tag, or the one to evict if Fill is set */
+static UINTN
+DiskCacheFind(EFI_FS *FileSystem, UINT64 Tag, BOOLEAN Fill)
+{
+	EFI_FS_CACHE_LINE *Line;
+	UINTN Set = (UINTN) ModU64x32(Tag, (UINT32) FileSystem->DiskCacheSets) * DISK_CACHE_WAYS;
+	UINTN i, Victim = Set;
+
+	for (i = Set; i < Set + DISK_CACHE_WAYS; i++) {
+		Line = &FileSystem->DiskCacheLines[i];
+		if (!Line->Valid) {
+			Victim = i;
+			if (Fill)
+				break;
+			continue;
+		}
+		if (Line->Tag == Tag)
+			return i;
+		if (FileSystem->DiskCacheLines[Victim].Valid &&
+				(Line->Age < FileSystem->DiskCacheLines[Victim].Age))
+			Victim = i;
+	}
+
+	return Fill ? Victim : (UINTN) -1;
+}
+
+/* Read line Tag into the cache. Returns NULL if it can't be cached */
+static UINT8 *
+DiskCacheFill(EFI_FS *FileSystem, EFI_BLOCK_IO_MEDIA *Media, UINT64 Tag)
+{
+	EFI_FS_CACHE_LINE *Line;
+	UINT8 *Data;
+	UINTN i;
+
+	/* Don't cache the partial line at the end of the disk */
+	if ((Tag + 1) * DISK_CACHE_LINE_SIZE > MultU64x32(Media->LastBlock + 1, Media->BlockSize))
+		return NULL;
+
+	i = DiskCacheFind(FileSystem, Tag, TRUE);
+	Line = &FileSystem->DiskCacheLines[i];
+	Data = &FileSystem->DiskCacheData[i * DISK_CACHE_LINE_SIZE];
+	Line->Valid = FALSE;
+	if (EFI_ERROR(DiskReadRaw(FileSystem, Media, Tag * DISK_CACHE_LINE_SIZE,
+			DISK_CACHE_LINE_SIZE, Data)))
+		return NULL;
+	Line->Tag = Tag;
+	Line->Age = ++FileSystem->DiskCacheClock;
+	Line->Valid = TRUE;
+
+	return Data;
+}
+
+/* Write the disk cache statistics to the Clover boot log, if they changed */
+VOID
+DiskCacheLog(EFI_FS *FileSystem)
+{
+	UINT64 Total = FileSystem->DiskCacheHits + FileSystem->DiskCacheMisses +
+			FileSystem->DiskCacheDirect;
+
+	if ((FileSystem->DiskCacheSets == 0) || (Total == FileSystem->DiskCacheReported))
+		return;
+	FileSystem->DiskCacheReported = Total;
+
+	PrintInfo(L"Disk cache: %lld hits, %lld misses, %lld direct\n",
+			FileSystem->DiskCacheHits, FileSystem->DiskCacheMisses,
+			FileSystem->DiskCacheDirect);
+
+	if (Msg == NULL) {
+		if (EFI_ERROR(BS->LocateProtocol(&gMsgLogProtocolGuid, NULL, (VOID **) &Msg)))
+			Msg = NULL;
+	}
+	if (Msg == NULL)
+		return;
+	/* Other drivers write to the same log, so pick up where they left off */
+	msgCursor = Msg->Cursor;
+	BootLog("%a: disk cache %d KB, %ld hits, %ld misses, %ld direct on %s\n",
+			grub_fs_list->name,
+			FileSystem->DiskCacheSets * DISK_CACHE_WAYS * DISK_CACHE_LINE_SIZE / 1024,
+			FileSystem->DiskCacheHits, FileSystem->DiskCacheMisses,
+			FileSystem->DiskCacheDirect, FileSystem->DevicePathString);
+	Msg->Dirty = TRUE;
+}
+
 grub_err_t
 grub_disk_read(grub_disk_t disk, grub_disk_addr_t sector,
 		grub_off_t offset, grub_size_t size, void *buf)
@@ -144,6 +305,10 @@ grub_disk_read(grub_disk_t disk, grub_disk_addr_t sector,
 	EFI_STATUS Status;
 	EFI_FS* FileSystem = (EFI_FS *) disk->data;
   EFI_BLOCK_IO_MEDIA *Media;
+	UINT8 *Dst = (UINT8 *) buf, *Data;
+	UINT64 Pos, End, Tag, DirectPos = 0;
+	UINTN In, Len, i, DirectLen = 0;
+	UINT8 *DirectDst = NULL;
 
 //	ASSERT(FileSystem != NULL);
 //	ASSERT(FileSystem->DiskIo != NULL);
@@ -163,15 +328,66 @@ grub_disk_read(grub_disk_t disk, grub_disk_addr_t sector,
 	/* NB: We could get the actual blocksize through FileSystem->BlockIo->Media->BlockSize
 	 * but GRUB uses the fixed GRUB_DISK_SECTOR_SIZE, so we follow suit
 	 */
-    if (FileSystem->DiskIo2 != NULL)
-    {
-      Status = FileSystem->DiskIo2->ReadDiskEx(FileSystem->DiskIo2, Media->MediaId,
-                                               sector * GRUB_DISK_SECTOR_SIZE + offset, &(FileSystem->DiskIo2Token), size, buf);
-    } else {
-        Status = FileSystem->DiskIo->ReadDisk(FileSystem->DiskIo, Media->MediaId,
-			sector * GRUB_DISK_SECTOR_SIZE + offset, size, buf);
-    }
+	Pos = sector * GRUB_DISK_SECTOR_SIZE + offset;
+
+	if (FileSystem->DiskCacheSets == 0) {
+		Status = DiskReadRaw(FileSystem, Media, Pos, size, buf);
+		goto out;
+	}
+
+	/* Drop everything if the media changed under us */
+	if (Media->MediaId != FileSystem->DiskCacheMediaId) {
+		for (i = 0; i < FileSystem->DiskCacheSets * DISK_CACHE_WAYS; i++)
+			FileSystem->DiskCacheLines[i].Valid = FALSE;
+		FileSystem->DiskCacheMediaId = Media->MediaId;
+	}
 
+	Status = EFI_SUCCESS;
+	for (End = Pos + size; Pos < End; Pos += Len, Dst += Len) {
+		Tag = Pos >> (GRUB_DISK_CACHE_BITS + GRUB_DISK_SECTOR_BITS);
+		In = (UINTN) (Pos & (DISK_CACHE_LINE_SIZE - 1));
+		Len = (UINTN) MIN(DISK_CACHE_LINE_SIZE - In, End - Pos);
+
+		i = DiskCacheFind(FileSystem, Tag, FALSE);
+		if ((i == (UINTN) -1) && (In == 0) && (Len == DISK_CACHE_LINE_SIZE)) {
+			/* Agglomerate uncached whole lines into a single direct read */
+			if (DirectLen == 0) {
+				DirectPos = Pos;
+				DirectDst = Dst;
+			}
+			DirectLen += Len;
+			FileSystem->DiskCacheDirect++;
+			continue;
+		}
+
+		if (DirectLen != 0) {
+			Status = DiskReadRaw(FileSystem, Media, DirectPos, DirectLen, DirectDst);
+			if (EFI_ERROR(Status))
+				goto out;
+			DirectLen = 0;
+		}
+
+		if (i != (UINTN) -1) {
+			FileSystem->DiskCacheLines[i].Age = ++FileSystem->DiskCacheClock;
+			Data = &FileSystem->DiskCacheData[i * DISK_CACHE_LINE_SIZE];
+			FileSystem->DiskCacheHits++;
+		} else {
+			Data = DiskCacheFill(FileSystem, Media, Tag);
+			FileSystem->DiskCacheMisses++;
+		}
+		if (Data != NULL) {
+			CopyMem(Dst, &Data[In], Len);
+		} else {
+			Status = DiskReadRaw(FileSystem, Media, Pos, Len, Dst);
+			if (EFI_ERROR(Status))
+				goto out;
+		}
+	}
+
+	if (DirectLen != 0)
+		Status = DiskReadRaw(FileSystem, Media, DirectPos, DirectLen, DirectDst);
+
+out:
 	if (EFI_ERROR(Status)) {
 		PrintStatusError(Status, L"Could not read block at address %08x", sector);
 		return GRUB_ERR_READ_ERROR;
@@ -272,6 +488,8 @@ GrubDeviceInit(EFI_FS *FileSystem)
 	/* Insert this filesystem in our list */
 	InsertTailList(&FsListHead, (LIST_ENTRY *) FileSystem);
 
+	DiskCacheInit(FileSystem);
+
 	FileSystem->GrubDevice = (VOID *) grub_device_open_2((const char *) name);
 
 	if (name != NULL)
@@ -281,6 +499,7 @@ GrubDeviceInit(EFI_FS *FileSystem)
     }
 
 	if (FileSystem->GrubDevice == NULL) {
+		DiskCacheFree(FileSystem);
 		RemoveEntryList((LIST_ENTRY *)FileSystem);
 		return EFI_NOT_FOUND;
 	}
@@ -292,6 +511,7 @@ EFI_STATUS
 GrubDeviceExit(EFI_FS *FileSystem)
 {
 	grub_device_close_2((grub_device_t) FileSystem->GrubDevice);
+	DiskCacheFree(FileSystem);
 	RemoveEntryList((LIST_ENTRY *)FileSystem);
 
 	return EFI_SUCCESS;
@@ -89,3 +89,173 @@ VOID CopyPathRelative(CHAR8 *dest, CHAR8 *src, INTN len)
 	}
 	o[len?0:-1] = '\0';
 }
+
+/* Directory entry cache
+ *
+ * Every Open() resolves its path through the grub dir() hook of the parent
+ * directory. Loader scanning probes the same well-known paths over and over,
+ * so the results are kept per volume: each entry reported by a dir() walk is
+ * cached, along with failed lookups, and a directory that was fully walked is
+ * flagged so that any other name below it is known not to exist.
+ * The filesystems are read-only, so entries never go stale while the volume
+ * is installed.
+ */
+
+static inline CHAR8
+DentryFold(CHAR8 c)
+{
+	return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+}
+
+static UINT32
+DentryHash(CONST CHAR8 *path, UINTN len)
+{
+	UINT32 Hash = 2166136261U;
+	UINTN i;
+
+	for (i = 0; i < len; i++) {
+		Hash ^= (UINT8) DentryFold(path[i]);
+		Hash *= 16777619U;
+	}
+	return Hash;
+}
+
+static BOOLEAN
+DentryMatch(CONST EFI_FS_DENTRY *Dentry, CONST CHAR8 *path, UINTN len)
+{
+	UINTN i;
+
+	if (Dentry->Path[len] != 0)
+		return FALSE;
+	if (!(Dentry->Flags & DENTRY_CASE_INSENSITIVE))
+		return CompareMem(Dentry->Path, path, len) == 0;
+	for (i = 0; i < len; i++) {
+		if (DentryFold(Dentry->Path[i]) != DentryFold(path[i]))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static EFI_FS_DENTRY *
+DentryFind(EFI_FS *This, CONST CHAR8 *path, UINTN len, UINT32 Hash)
+{
+	EFI_FS_DENTRY *Dentry;
+
+	if (This->DentryCache == NULL)
+		return NULL;
+	for (Dentry = This->DentryCache[Hash % DENTRY_CACHE_BUCKETS]; Dentry != NULL;
+			Dentry = Dentry->Next) {
+		if (Dentry->Hash == Hash && DentryMatch(Dentry, path, len))
+			return Dentry;
+	}
+	return NULL;
+}
+
+/* Add or update the entry for the first len bytes of path */
+EFI_FS_DENTRY *
+DentryAdd(EFI_FS *This, CONST CHAR8 *path, UINTN len, UINT32 Flags, INT32 Mtime)
+{
+	EFI_FS_DENTRY *Dentry;
+	UINT32 Hash = DentryHash(path, len);
+
+	Dentry = DentryFind(This, path, len, Hash);
+	if (Dentry == NULL) {
+		if (This->DentryCount >= DENTRY_CACHE_MAX) {
+			This->DentryCacheFull = TRUE;
+			return NULL;
+		}
+		if (This->DentryCache == NULL) {
+			This->DentryCache = AllocateZeroPool(DENTRY_CACHE_BUCKETS * sizeof(EFI_FS_DENTRY *));
+			if (This->DentryCache == NULL)
+				return NULL;
+		}
+		Dentry = AllocatePool(sizeof(EFI_FS_DENTRY) + len);
+		if (Dentry == NULL) {
+			This->DentryCacheFull = TRUE;
+			return NULL;
+		}
+		CopyMem(Dentry->Path, path, len);
+		Dentry->Path[len] = 0;
+		Dentry->Hash = Hash;
+		Dentry->Flags = 0;
+		Dentry->Next = This->DentryCache[Hash % DENTRY_CACHE_BUCKETS];
+		This->DentryCache[Hash % DENTRY_CACHE_BUCKETS] = Dentry;
+		This->DentryCount++;
+	}
+	/* A failed lookup doesn't override a name seen in a listing, which may
+	 * differ in case only on a case-insensitive filesystem
+	 */
+	if (!(Flags & DENTRY_EXISTS) && (Dentry->Flags & DENTRY_EXISTS))
+		return Dentry;
+	/* Keep what a previous listing found out about the directory */
+	if (Flags & DENTRY_DIR)
+		Flags |= Dentry->Flags & DENTRY_LISTED;
+	Dentry->Flags = Flags;
+	Dentry->Mtime = Mtime;
+	return Dentry;
+}
+
+/* Look up an absolute normalized path. Returns NULL if nothing is known about it */
+EFI_FS_DENTRY *
+DentryLookup(EFI_FS *This, CONST CHAR8 *path)
+{
+	EFI_FS_DENTRY *Dentry, *Parent;
+	CHAR8 *p;
+	UINTN len = strlena(path), plen;
+
+	Dentry = DentryFind(This, path, len, DentryHash(path, len));
+	if (Dentry != NULL || This->DentryCache == NULL)
+		return Dentry;
+
+	/* Not cached: if the parent was fully listed, the name doesn't exist.
+	 * Only trust this for ASCII names, as the case folding above is ASCII only.
+	 */
+	for (p = (CHAR8 *) path; *p; p++) {
+		if ((UINT8) *p >= 0x80)
+			return NULL;
+	}
+	p = strrchra(path, '/');
+	if (p == NULL)
+		return NULL;
+	plen = (p == path) ? 1 : (UINTN) (p - path);
+	Parent = DentryFind(This, path, plen, DentryHash(path, plen));
+	if (Parent == NULL || !(Parent->Flags & DENTRY_LISTED))
+		return NULL;
+	return DentryAdd(This, path, len, 0, 0);
+}
+
+/* Flag a directory whose every child was just added to the cache */
+VOID
+DentryMarkListed(EFI_FS *This, CONST CHAR8 *path)
+{
+	EFI_FS_DENTRY *Dentry;
+	UINTN len = strlena(path);
+
+	if (This->DentryCacheFull)
+		return;
+	Dentry = DentryFind(This, path, len, DentryHash(path, len));
+	if (Dentry == NULL)
+		Dentry = DentryAdd(This, path, len, DENTRY_EXISTS | DENTRY_DIR, 0);
+	if (Dentry != NULL && (Dentry->Flags & DENTRY_DIR))
+		Dentry->Flags |= DENTRY_LISTED;
+}
+
+VOID
+DentryCacheFree(EFI_FS *This)
+{
+	EFI_FS_DENTRY *Dentry, *Next;
+	UINTN i;
+
+	if (This->DentryCache == NULL)
+		return;
+	for (i = 0; i < DENTRY_CACHE_BUCKETS; i++) {
+		for (Dentry = This->DentryCache[i]; Dentry != NULL; Dentry = Next) {
+			Next = Dentry->Next;
+			FreePool(Dentry);
+		}
+	}
+	FreePool(This->DentryCache);
+	This->DentryCache = NULL;
+	This->DentryCount = 0;
+	This->DentryCacheFull = FALSE;
+}
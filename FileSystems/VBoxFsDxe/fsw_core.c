@@ -186,6 +186,231 @@ void fsw_set_blocksize_(struct fsw_volume *vol, fsw_u32 phys_blocksize, fsw_u32
     vol->log_blocksize = log_blocksize;
 }
 
+/*
+ * Block cache internals. The entries live in one array and refer to each other by
+ * index, so the array can be reallocated when the cache grows. Entries holding a
+ * block are chained in hash buckets keyed by the physical block number. All entries
+ * are on a LRU list; empty entries are kept at its tail so they get used first.
+ */
+
+static fsw_u32 fsw_bcache_bucket(struct fsw_volume *vol, fsw_u32 phys_bno)
+{
+  return ((phys_bno * 0x9E3779B1U) & 0xFFFFFFFFU) >> (32 - vol->bcache_hash_bits);
+}
+
+static fsw_u32 fsw_bcache_lookup(struct fsw_volume *vol, fsw_u32 phys_bno)
+{
+  fsw_u32 i;
+
+  if (vol->bcache_hash == NULL)
+    return FSW_BCACHE_NIL;
+  for (i = vol->bcache_hash[fsw_bcache_bucket(vol, phys_bno)]; i != FSW_BCACHE_NIL; i = vol->bcache[i].hash_next) {
+    if (vol->bcache[i].phys_bno == phys_bno)
+      return i;
+  }
+  return FSW_BCACHE_NIL;
+}
+
+static void fsw_bcache_hash_insert(struct fsw_volume *vol, fsw_u32 i)
+{
+  fsw_u32 bucket = fsw_bcache_bucket(vol, vol->bcache[i].phys_bno);
+
+  vol->bcache[i].hash_next = vol->bcache_hash[bucket];
+  vol->bcache_hash[bucket] = i;
+}
+
+static void fsw_bcache_hash_remove(struct fsw_volume *vol, fsw_u32 i)
+{
+  fsw_u32 *link = &vol->bcache_hash[fsw_bcache_bucket(vol, vol->bcache[i].phys_bno)];
+
+  while (*link != FSW_BCACHE_NIL) {
+    if (*link == i) {
+      *link = vol->bcache[i].hash_next;
+      break;
+    }
+    link = &vol->bcache[*link].hash_next;
+  }
+  vol->bcache[i].hash_next = FSW_BCACHE_NIL;
+}
+
+static void fsw_bcache_lru_unlink(struct fsw_volume *vol, fsw_u32 i)
+{
+  struct fsw_blockcache *entry = &vol->bcache[i];
+
+  if (entry->lru_prev != FSW_BCACHE_NIL)
+    vol->bcache[entry->lru_prev].lru_next = entry->lru_next;
+  else
+    vol->bcache_lru_head = entry->lru_next;
+  if (entry->lru_next != FSW_BCACHE_NIL)
+    vol->bcache[entry->lru_next].lru_prev = entry->lru_prev;
+  else
+    vol->bcache_lru_tail = entry->lru_prev;
+  entry->lru_prev = FSW_BCACHE_NIL;
+  entry->lru_next = FSW_BCACHE_NIL;
+}
+
+static void fsw_bcache_lru_push_front(struct fsw_volume *vol, fsw_u32 i)
+{
+  vol->bcache[i].lru_prev = FSW_BCACHE_NIL;
+  vol->bcache[i].lru_next = vol->bcache_lru_head;
+  if (vol->bcache_lru_head != FSW_BCACHE_NIL)
+    vol->bcache[vol->bcache_lru_head].lru_prev = i;
+  else
+    vol->bcache_lru_tail = i;
+  vol->bcache_lru_head = i;
+}
+
+static void fsw_bcache_lru_push_back(struct fsw_volume *vol, fsw_u32 i)
+{
+  vol->bcache[i].lru_next = FSW_BCACHE_NIL;
+  vol->bcache[i].lru_prev = vol->bcache_lru_tail;
+  if (vol->bcache_lru_tail != FSW_BCACHE_NIL)
+    vol->bcache[vol->bcache_lru_tail].lru_next = i;
+  else
+    vol->bcache_lru_head = i;
+  vol->bcache_lru_tail = i;
+}
+
+/**
+ * Enlarge / create the block cache. The entry array doubles up to bcache_max entries,
+ * the hash table is rebuilt so that there is at least one bucket per entry. New empty
+ * entries are appended to the LRU tail.
+ */
+
+static fsw_status_t fsw_bcache_grow(struct fsw_volume *vol)
+{
+  fsw_status_t    status;
+  fsw_u32         i, old_bcache_size, new_bcache_size, hash_bits;
+  struct fsw_blockcache *new_bcache = NULL;
+  fsw_u32         *new_hash = NULL;
+
+  if (vol->bcache_max == 0) {
+    vol->bcache_max = FSW_BCACHE_MAX_BYTES / vol->phys_blocksize;
+    if (vol->bcache_max < 16)
+      vol->bcache_max = 16;
+  }
+  old_bcache_size = vol->bcache_size;
+  if (old_bcache_size < 16)
+    new_bcache_size = 16;
+  else
+    new_bcache_size = old_bcache_size << 1;
+  if (old_bcache_size < vol->bcache_max && new_bcache_size > vol->bcache_max)
+    new_bcache_size = vol->bcache_max;
+  for (hash_bits = 4; hash_bits < 31 && ((fsw_u32)1 << hash_bits) < new_bcache_size; hash_bits++)
+    ;
+
+  status = fsw_alloc(new_bcache_size * sizeof(struct fsw_blockcache), &new_bcache);
+  if (status)
+    return status;
+  status = fsw_alloc(((fsw_u32)1 << hash_bits) * sizeof(fsw_u32), &new_hash);
+  if (status) {
+    fsw_free(new_bcache);
+    return status;
+  }
+  if (old_bcache_size > 0) {
+    fsw_memcpy(new_bcache, vol->bcache, old_bcache_size * sizeof(struct fsw_blockcache));
+  } else {
+    vol->bcache_lru_head = FSW_BCACHE_NIL;
+    vol->bcache_lru_tail = FSW_BCACHE_NIL;
+  }
+
+  // switch caches
+  if (vol->bcache != NULL)
+    fsw_free(vol->bcache);
+  if (vol->bcache_hash != NULL)
+    fsw_free(vol->bcache_hash);
+  vol->bcache = new_bcache;
+  vol->bcache_size = new_bcache_size;
+  vol->bcache_hash = new_hash;
+  vol->bcache_hash_bits = hash_bits;
+
+  // rehash the existing entries, queue the new ones as empty
+  for (i = 0; i < ((fsw_u32)1 << hash_bits); i++)
+    new_hash[i] = FSW_BCACHE_NIL;
+  for (i = 0; i < old_bcache_size; i++) {
+    if (new_bcache[i].phys_bno != (fsw_u32)FSW_INVALID_BNO)
+      fsw_bcache_hash_insert(vol, i);
+  }
+  for (i = old_bcache_size; i < new_bcache_size; i++) {
+    new_bcache[i].refcount = 0;
+    new_bcache[i].cache_level = 0;
+    new_bcache[i].phys_bno = (fsw_u32)FSW_INVALID_BNO;
+    new_bcache[i].data = NULL;
+    new_bcache[i].hash_next = FSW_BCACHE_NIL;
+    fsw_bcache_lru_push_back(vol, i);
+  }
+  return FSW_SUCCESS;
+}
+
+/**
+ * Give back an entry obtained from fsw_bcache_take that could not be filled.
+ */
+
+static void fsw_bcache_untake(struct fsw_volume *vol, fsw_u32 i)
+{
+  vol->bcache[i].refcount = 0;
+  fsw_bcache_lru_unlink(vol, i);
+  fsw_bcache_lru_push_back(vol, i);
+}
+
+/**
+ * Take a cache entry to read a new block into. Empty entries are used first, then the
+ * cache grows up to bcache_max entries, then the least recently used unreferenced entry
+ * of the lowest cache level is recycled. The cache only grows past bcache_max when all
+ * entries are referenced. The entry returned is empty, has a data buffer, is moved to
+ * the LRU head and holds a reference so it can't be recycled before it is filled.
+ */
+
+static fsw_status_t fsw_bcache_take(struct fsw_volume *vol, fsw_u32 *index_out)
+{
+  fsw_status_t    status;
+  fsw_u32         i, candidate, candidate_level;
+
+  i = FSW_BCACHE_NIL;
+  if (vol->bcache_size > 0) {
+    i = vol->bcache_lru_tail;
+    if (vol->bcache[i].phys_bno != (fsw_u32)FSW_INVALID_BNO || vol->bcache[i].refcount != 0)
+      i = FSW_BCACHE_NIL;
+  }
+  if (i == FSW_BCACHE_NIL && vol->bcache_size >= vol->bcache_max && vol->bcache_max > 0) {
+    candidate = FSW_BCACHE_NIL;
+    candidate_level = MAX_CACHE_LEVEL + 1;
+    for (i = vol->bcache_lru_tail; i != FSW_BCACHE_NIL; i = vol->bcache[i].lru_prev) {
+      if (vol->bcache[i].refcount == 0 && vol->bcache[i].cache_level < candidate_level) {
+        candidate = i;
+        candidate_level = vol->bcache[i].cache_level;
+        if (candidate_level == 0)
+          break;
+      }
+    }
+    i = candidate;
+  }
+  if (i == FSW_BCACHE_NIL) {
+    status = fsw_bcache_grow(vol);
+    if (status)
+      return status;
+    i = vol->bcache_lru_tail;
+  }
+
+  if (vol->bcache[i].phys_bno != (fsw_u32)FSW_INVALID_BNO) {
+    fsw_bcache_hash_remove(vol, i);
+    vol->bcache[i].phys_bno = (fsw_u32)FSW_INVALID_BNO;
+  }
+  if (vol->bcache[i].data == NULL) {
+    status = fsw_alloc(vol->phys_blocksize, &vol->bcache[i].data);
+    if (status) {
+      vol->bcache[i].data = NULL;
+      fsw_bcache_untake(vol, i);
+      return status;
+    }
+  }
+  vol->bcache[i].refcount = 1;
+  fsw_bcache_lru_unlink(vol, i);
+  fsw_bcache_lru_push_front(vol, i);
+  *index_out = i;
+  return FSW_SUCCESS;
+}
+
 /**
  * Get a block of data from the disk. This function is called by the file system driver
  * or by core functions. It calls through to the host driver's device access routine.
@@ -204,90 +429,100 @@ void fsw_set_blocksize_(struct fsw_volume *vol, fsw_u32 phys_blocksize, fsw_u32
  */
 
 fsw_status_t fsw_block_get_(struct VOLSTRUCTNAME *vol, fsw_u32 phys_bno, fsw_u32 cache_level, void **buffer_out)
+{
+  return fsw_block_get_ra_(vol, phys_bno, 0, cache_level, buffer_out);
+}
+
+/**
+ * Same as fsw_block_get, with a read-ahead hint. ra_count is the number of blocks
+ * following phys_bno that are known to belong to the same run on disk (e.g. the rest
+ * of an extent). On a cache miss, up to FSW_BCACHE_READAHEAD blocks of that run are
+ * fetched with a single host read_blocks call and enter the cache unreferenced.
+ */
+
+fsw_status_t fsw_block_get_ra_(struct VOLSTRUCTNAME *vol, fsw_u32 phys_bno, fsw_u32 ra_count, fsw_u32 cache_level, void **buffer_out)
 {
   fsw_status_t    status;
-  fsw_u32         i, discard_level, new_bcache_size;
-  struct fsw_blockcache *new_bcache = NULL;
-  
+  fsw_u32         i, n, count;
+  fsw_u32         slots[FSW_BCACHE_READAHEAD];
+
   // TODO: allow the host driver to do its own caching; just call through if
   //  the appropriate function pointers are set
-  
+
   if (cache_level > MAX_CACHE_LEVEL)
     cache_level = MAX_CACHE_LEVEL;
-  
+
   // check block cache
-  for (i = 0; i < vol->bcache_size; i++) {
-    if (vol->bcache[i].phys_bno == phys_bno) {
-      // cache hit!
-      if (vol->bcache[i].cache_level < cache_level)
-        vol->bcache[i].cache_level = cache_level;  // promote the entry
-      vol->bcache[i].refcount++;
-      *buffer_out = vol->bcache[i].data;
-      return FSW_SUCCESS;
+  i = fsw_bcache_lookup(vol, phys_bno);
+  if (i != FSW_BCACHE_NIL) {
+    // cache hit!
+    if (vol->bcache[i].cache_level < cache_level)
+      vol->bcache[i].cache_level = cache_level;  // promote the entry
+    vol->bcache[i].refcount++;
+    fsw_bcache_lru_unlink(vol, i);
+    fsw_bcache_lru_push_front(vol, i);
+    *buffer_out = vol->bcache[i].data;
+    return FSW_SUCCESS;
+  }
+
+  // extend the read over the following blocks of the run, up to the first cached one
+  count = 1;
+  if (vol->host_table->read_blocks != NULL && ra_count > 0) {
+    if (ra_count > FSW_BCACHE_READAHEAD - 1)
+      ra_count = FSW_BCACHE_READAHEAD - 1;
+    if (phys_bno + ra_count < phys_bno)
+      ra_count = 0;
+    while (count <= ra_count && fsw_bcache_lookup(vol, phys_bno + count) == FSW_BCACHE_NIL)
+      count++;
+    if (count > 1 && vol->bcache_rabuf == NULL &&
+        fsw_alloc(FSW_BCACHE_READAHEAD * vol->phys_blocksize, &vol->bcache_rabuf) != FSW_SUCCESS) {
+      vol->bcache_rabuf = NULL;
+      count = 1;
     }
   }
-  
-  // find a free entry in the cache table
-  for (i = 0; i < vol->bcache_size; i++) {
-    if (vol->bcache[i].phys_bno == (fsw_u32)FSW_INVALID_BNO)
-      break;
+
+  for (n = 0; n < count; n++) {
+    status = fsw_bcache_take(vol, &slots[n]);
+    if (status) {
+      if (n == 0)
+        return status;
+      break;  // read ahead less
+    }
   }
-  if (i >= vol->bcache_size) {
-    for (discard_level = 0; discard_level <= MAX_CACHE_LEVEL; discard_level++) {
-      for (i = 0; i < vol->bcache_size; i++) {
-        if (vol->bcache[i].refcount == 0 && vol->bcache[i].cache_level <= discard_level)
-          break;
-      }
-      if (i < vol->bcache_size)
-        break;
+  count = n;
+
+  // read the data
+  status = FSW_UNSUPPORTED;
+  if (count > 1) {
+    status = vol->host_table->read_blocks(vol, phys_bno, count, vol->bcache_rabuf);
+    if (status == FSW_SUCCESS) {
+      for (n = 0; n < count; n++)
+        fsw_memcpy(vol->bcache[slots[n]].data, (fsw_u8 *)vol->bcache_rabuf + n * vol->phys_blocksize, vol->phys_blocksize);
+    } else {
+      // the run may cross the end of the device, fall back to the requested block only
+      for (n = 1; n < count; n++)
+        fsw_bcache_untake(vol, slots[n]);
+      count = 1;
     }
   }
-  if (i >= vol->bcache_size) {
-    // enlarge / create the cache
-    if (vol->bcache_size < 16)
-      new_bcache_size = 16;
-    else
-      new_bcache_size = vol->bcache_size << 1;
-    status = fsw_alloc(new_bcache_size * sizeof(struct fsw_blockcache), &new_bcache);
-    if (status != FSW_SUCCESS) {
-      if (new_bcache) {
-        fsw_free(new_bcache);
-      }
+  if (status) {
+    status = vol->host_table->read_block(vol, phys_bno, vol->bcache[slots[0]].data);
+    if (status) {
+      fsw_bcache_untake(vol, slots[0]);
       return status;
     }
-    if (vol->bcache_size > 0) {
-      fsw_memcpy(new_bcache, vol->bcache, vol->bcache_size * sizeof(struct fsw_blockcache));
-    }
-    for (i = vol->bcache_size; i < new_bcache_size; i++) {
-      new_bcache[i].refcount = 0;
-      new_bcache[i].cache_level = 0;
-      new_bcache[i].phys_bno = (fsw_u32)FSW_INVALID_BNO;
-      new_bcache[i].data = NULL;
-    }
-    i = vol->bcache_size;
-    
-    // switch caches
-    if (vol->bcache != NULL)
-      fsw_free(vol->bcache);
-    vol->bcache = new_bcache;
-    vol->bcache_size = new_bcache_size;
   }
-  vol->bcache[i].phys_bno = (fsw_u32)FSW_INVALID_BNO;
-  
-  // read the data
-  if (vol->bcache[i].data == NULL) {
-    status = fsw_alloc(vol->phys_blocksize, &vol->bcache[i].data);
-    if (status)
-      return status;
+
+  for (n = count; n-- > 0; ) {
+    i = slots[n];
+    vol->bcache[i].phys_bno = phys_bno + n;
+    vol->bcache[i].cache_level = cache_level;
+    vol->bcache[i].refcount = (n == 0) ? 1 : 0;
+    fsw_bcache_hash_insert(vol, i);
+    fsw_bcache_lru_unlink(vol, i);
+    fsw_bcache_lru_push_front(vol, i);
   }
-  status = vol->host_table->read_block(vol, phys_bno, vol->bcache[i].data);
-  if (status)
-    return status;
-  
-  vol->bcache[i].phys_bno = phys_bno;
-  vol->bcache[i].cache_level = cache_level;
-  vol->bcache[i].refcount = 1;
-  *buffer_out = vol->bcache[i].data;
+  *buffer_out = vol->bcache[slots[0]].data;
   return FSW_SUCCESS;
 }
 
@@ -307,10 +542,9 @@ void fsw_block_release_(struct VOLSTRUCTNAME *vol, fsw_u32 phys_bno, void *buffe
   //  the appropriate function pointers are set
   
   // update block cache
-  for (i = 0; i < vol->bcache_size; i++) {
-    if (vol->bcache[i].phys_bno == phys_bno && vol->bcache[i].refcount > 0)
-      vol->bcache[i].refcount--;
-  }
+  i = fsw_bcache_lookup(vol, phys_bno);
+  if (i != FSW_BCACHE_NIL && vol->bcache[i].refcount > 0)
+    vol->bcache[i].refcount--;
 }
 
 /**
@@ -333,7 +567,19 @@ static void fsw_blockcache_free(struct fsw_volume *vol)
     fsw_free(vol->bcache);
     vol->bcache = NULL;
   }
+  if (vol->bcache_hash != NULL) {
+    fsw_free(vol->bcache_hash);
+    vol->bcache_hash = NULL;
+  }
+  if (vol->bcache_rabuf != NULL) {
+    fsw_free(vol->bcache_rabuf);
+    vol->bcache_rabuf = NULL;
+  }
   vol->bcache_size = 0;
+  vol->bcache_max = 0;
+  vol->bcache_hash_bits = 0;
+  vol->bcache_lru_head = FSW_BCACHE_NIL;
+  vol->bcache_lru_tail = FSW_BCACHE_NIL;
 }
 
 /**
@@ -1046,6 +1292,10 @@ void fsw_shandle_close(struct fsw_shandle *shand)
 /**
  * Read data from a shandle (storage handle for a dnode). This function is called by the
  * host driver or internally when data is read from a file. TODO: more
+ *
+ * Whole physical blocks of regular files are read with the host's read_blocks call
+ * directly into the caller's buffer, one call per extent, bypassing the block cache.
+ * Partial blocks, directories and metadata go through fsw_block_get as before.
  */
 
 fsw_status_t fsw_shandle_read(struct fsw_shandle *shand, fsw_u32 *buffer_size_inout, void *buffer_in)
@@ -1056,7 +1306,8 @@ fsw_status_t fsw_shandle_read(struct fsw_shandle *shand, fsw_u32 *buffer_size_in
   fsw_u8          *buffer, *block_buffer;
   fsw_u32         buflen, copylen, pos;
   fsw_u32         log_bno, pos_in_extent, phys_bno, pos_in_physblock;
-  fsw_u32         cache_level;
+  fsw_u32         cache_level, ra_count;
+  fsw_u64         extent_end;
   
   if (shand->pos >= dno->size) {   // already at EOF
     *buffer_size_inout = 0;
@@ -1098,12 +1349,37 @@ fsw_status_t fsw_shandle_read(struct fsw_shandle *shand, fsw_u32 *buffer_size_in
       // convert to physical block number and offset
       phys_bno = shand->extent.phys_start + pos_in_extent / vol->phys_blocksize;
       pos_in_physblock = pos_in_extent & (vol->phys_blocksize - 1);
+      extent_end = (fsw_u64)shand->extent.log_count * vol->log_blocksize;
+      
+      // file data: read whole blocks of the extent straight into the caller's buffer
+      if (dno->type == FSW_DNODE_TYPE_FILE && pos_in_physblock == 0 && buflen >= vol->phys_blocksize &&
+          vol->host_table->read_blocks != NULL) {
+        copylen = buflen & ~(vol->phys_blocksize - 1);
+        if (copylen > extent_end - pos_in_extent)
+          copylen = (fsw_u32)(extent_end - pos_in_extent);
+        status = vol->host_table->read_blocks(vol, phys_bno, copylen / vol->phys_blocksize, buffer);
+        if (status)
+          return status;
+        
+        buffer += copylen;
+        buflen -= copylen;
+        pos    += copylen;
+        continue;
+      }
+      
       copylen = vol->phys_blocksize - pos_in_physblock;
       if (copylen > buflen)
         copylen = buflen;
       
+      // the rest of the extent is contiguous on disk, let the block cache read ahead
+      ra_count = FSW_BCACHE_READAHEAD;
+      if ((extent_end - pos_in_extent) / vol->phys_blocksize < ra_count)
+        ra_count = (fsw_u32)((extent_end - pos_in_extent) / vol->phys_blocksize);
+      if (ra_count > 0)
+        ra_count--;
+      
       // get one physical block
-      status = fsw_block_get(vol, phys_bno, cache_level, (void **)&block_buffer);
+      status = fsw_block_get_ra(vol, phys_bno, ra_count, cache_level, (void **)&block_buffer);
       if (status)
         return status;
       
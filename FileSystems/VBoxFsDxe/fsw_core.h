@@ -62,6 +62,16 @@ extern const char* fsw_errors[];
 #define FSW_DNODE_CACHE_SIZE (0)
 #endif
 
+/** Upper bound for the memory used by the block cache data buffers of one volume. */
+#ifndef FSW_BCACHE_MAX_BYTES
+#define FSW_BCACHE_MAX_BYTES (4 * 1024 * 1024)
+#endif
+
+/** Maximum number of contiguous blocks fetched by one read-ahead request. */
+#ifndef FSW_BCACHE_READAHEAD
+#define FSW_BCACHE_READAHEAD (16)
+#endif
+
 /** Maximum size for a path, specifically symlink target paths. */
 #ifndef VBOX
 #define FSW_PATH_MAX (4096)
@@ -77,6 +87,8 @@ extern const char* fsw_errors[];
 
 /** Indicates that the block cache entry is empty. */
 #define FSW_INVALID_BNO (~0UL)
+/** End marker for the block cache hash chains and LRU list. */
+#define FSW_BCACHE_NIL (~0U)
 
 #define USE_FULL_LOWERCASE 0
 //
@@ -256,6 +268,9 @@ struct fsw_blockcache {
     fsw_u32     cache_level;        //!< Level of importance of this block
     fsw_u32     phys_bno;           //!< Physical block number
     void        *data;              //!< Block data buffer
+    fsw_u32     hash_next;          //!< Next entry in the same hash bucket
+    fsw_u32     lru_prev;           //!< LRU list: more recently used entry
+    fsw_u32     lru_next;           //!< LRU list: less recently used entry
 };
 
 /**
@@ -273,6 +288,12 @@ struct fsw_volume {
 
     struct fsw_blockcache *bcache;  //!< Array of block cache entries
     fsw_u32     bcache_size;        //!< Number of entries in the block cache array
+    fsw_u32     bcache_max;         //!< Entry count allowed by FSW_BCACHE_MAX_BYTES
+    fsw_u32     *bcache_hash;       //!< Hash buckets, first entry index of each chain
+    fsw_u32     bcache_hash_bits;   //!< log2 of the number of hash buckets
+    fsw_u32     bcache_lru_head;    //!< Most recently used entry
+    fsw_u32     bcache_lru_tail;    //!< Least recently used entry, empty entries gather here
+    void        *bcache_rabuf;      //!< Bounce buffer for multi-block reads
 
     void        *host_data;         //!< Hook for a host-specific data structure
     struct fsw_host_table *host_table;      //!< Dispatch table for host-specific functions
@@ -392,6 +413,7 @@ struct fsw_host_table
                                      fsw_u32 old_phys_blocksize, fsw_u32 old_log_blocksize,
                                      fsw_u32 new_phys_blocksize, fsw_u32 new_log_blocksize);
     fsw_status_t (*read_block)(struct fsw_volume *vol, fsw_u32 phys_bno, void *buffer);
+    fsw_status_t (*read_blocks)(struct fsw_volume *vol, fsw_u32 phys_bno, fsw_u32 count, void *buffer);  //!< Optional, may be NULL
 };
 
 /**
@@ -446,6 +468,9 @@ void         fsw_set_blocksize_(struct fsw_volume *vol, fsw_u32 phys_blocksize,
 //fsw_status_t fsw_block_get(struct VOLSTRUCTNAME *vol, fsw_u32 phys_bno, fsw_u32 cache_level, void **buffer_out);
 #define      fsw_block_get(x, y, z, w) fsw_block_get_(SafeCast1(x), (y), (z), (w))
 fsw_status_t fsw_block_get_(struct fsw_volume *vol, fsw_u32 phys_bno, fsw_u32 cache_level, void **buffer_out);
+//fsw_status_t fsw_block_get_ra(struct VOLSTRUCTNAME *vol, fsw_u32 phys_bno, fsw_u32 ra_count, fsw_u32 cache_level, void **buffer_out);
+#define      fsw_block_get_ra(x, y, v, z, w) fsw_block_get_ra_(SafeCast1(x), (y), (v), (z), (w))
+fsw_status_t fsw_block_get_ra_(struct fsw_volume *vol, fsw_u32 phys_bno, fsw_u32 ra_count, fsw_u32 cache_level, void **buffer_out);
 //void         fsw_block_release(struct VOLSTRUCTNAME *vol, fsw_u32 phys_bno, void *buffer);
 #define      fsw_block_release(x, y, z) fsw_block_release_(SafeCast1(x), (y), (z))
 void         fsw_block_release_(struct fsw_volume *vol, fsw_u32 phys_bno, void *buffer);
@@ -50,6 +50,7 @@
  */
 
 #include "fsw_efi.h"
+#include <Library/MemLogLib.h>
 
 #define DEBUG_LEVEL 0
 
@@ -72,6 +73,9 @@ MESSAGE_LOG_PROTOCOL *Msg = NULL;
 #define DBG(...)	
 #endif
 
+/** Reads of at least this many bytes get their throughput logged. */
+#define FSW_EFI_LOG_READ_SIZE (1024 * 1024)
+
 
 /** Helper macro for stringification. */
 #define FSW_EFI_STRINGIFY(x) L ## #x
@@ -104,6 +108,7 @@ void fsw_efi_change_blocksize(struct fsw_volume *vol,
                               fsw_u32 old_phys_blocksize, fsw_u32 old_log_blocksize,
                               fsw_u32 new_phys_blocksize, fsw_u32 new_log_blocksize);
 fsw_status_t fsw_efi_read_block(struct fsw_volume *vol, fsw_u32 phys_bno, void *buffer);
+fsw_status_t fsw_efi_read_blocks(struct fsw_volume *vol, fsw_u32 phys_bno, fsw_u32 count, void *buffer);
 
 EFI_STATUS fsw_efi_map_status(fsw_status_t fsw_status, FSW_VOLUME_DATA *Volume);
 
@@ -181,7 +186,8 @@ struct fsw_host_table   fsw_efi_host_table = {
     FSW_STRING_TYPE_UTF16,
 
     fsw_efi_change_blocksize,
-    fsw_efi_read_block
+    fsw_efi_read_block,
+    fsw_efi_read_blocks
 };
 
 extern struct fsw_fstype_table FSW_FSTYPE_TABLE_NAME (
@@ -586,6 +592,33 @@ fsw_status_t fsw_efi_read_block(struct fsw_volume *vol, fsw_u32 phys_bno, void *
     return FSW_SUCCESS;
 }
 
+/**
+ * FSW interface function to read a run of contiguous data blocks with one disk access.
+ * Used by the FSW core for read-ahead. The buffer must hold count physical blocks.
+ */
+
+fsw_status_t fsw_efi_read_blocks(struct fsw_volume *vol, fsw_u32 phys_bno, fsw_u32 count, void *buffer)
+{
+    EFI_STATUS          Status;
+    FSW_VOLUME_DATA     *Volume = (FSW_VOLUME_DATA *)vol->host_data;
+
+    // read from disk
+    if (Volume->DiskIo2 != NULL)
+    {
+      Status = Volume->DiskIo2->ReadDiskEx(Volume->DiskIo2, Volume->MediaId, (UINT64)phys_bno * vol->phys_blocksize, &(Volume->DiskIo2Token), (UINTN)count * vol->phys_blocksize, buffer);
+    } else {
+      Status = Volume->DiskIo->ReadDisk(Volume->DiskIo, Volume->MediaId,
+                                      (UINT64)phys_bno * vol->phys_blocksize,
+                                      (UINTN)count * vol->phys_blocksize,
+                                      buffer);
+    }
+
+    Volume->LastIOStatus = Status;
+    if (EFI_ERROR(Status))
+        return FSW_IO_ERROR;
+    return FSW_SUCCESS;
+}
+
 /**
  * Map FSW status codes to EFI status codes. The FSW_IO_ERROR code is only produced
  * by fsw_efi_read_block, so we map it back to the EFI status code remembered from
@@ -891,16 +924,30 @@ EFI_STATUS fsw_efi_file_read(IN FSW_FILE_DATA *File,
 {
   EFI_STATUS          Status;
   fsw_u32             buffer_size;
+  UINT64              StartTsc, Ticks, TicksPerMs;
   
 #if DEBUG_LEVEL
   Print(L"fsw_efi_file_read %d bytes\n", *BufferSize);
 #endif
   
   buffer_size = (fsw_u32)*BufferSize;
+  StartTsc = AsmReadTsc();
   Status = fsw_efi_map_status(fsw_shandle_read(&File->shand, &buffer_size, Buffer),
                               (FSW_VOLUME_DATA *)File->shand.dnode->vol->host_data);
   *BufferSize = buffer_size;
   
+  // report throughput of big reads (kernel, kernelcache, prelinkedkernel)
+  if (buffer_size >= FSW_EFI_LOG_READ_SIZE) {
+    Ticks = AsmReadTsc() - StartTsc;
+    TicksPerMs = DivU64x64Remainder(GetMemLogTscTicksPerSecond(), 1000, NULL);
+    if (TicksPerMs == 0) {
+      TicksPerMs = 1;
+    }
+    Ticks = DivU64x64Remainder(Ticks, TicksPerMs, NULL);
+    MemLog(TRUE, 1, "VBoxFs: read %d KB in %llu ms, %llu KB/s\n", buffer_size >> 10, Ticks,
+           DivU64x64Remainder((UINT64)(buffer_size >> 10) * 1000, (Ticks == 0) ? 1 : Ticks, NULL));
+  }
+  
   return Status;
 }
 
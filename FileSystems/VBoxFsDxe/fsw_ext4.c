@@ -41,6 +41,8 @@ static fsw_status_t fsw_ext4_get_by_blkaddr(struct fsw_ext4_volume *vol, struct
                                         struct fsw_extent *extent);
 static fsw_status_t fsw_ext4_get_by_extent(struct fsw_ext4_volume *vol, struct fsw_ext4_dnode *dno,
                                         struct fsw_extent *extent);
+static fsw_status_t fsw_ext4_extent_map_build(struct fsw_ext4_volume *vol, struct fsw_ext4_dnode *dno,
+                                              struct ext4_extent_header *header, fsw_u32 size, int depth);
 
 static fsw_status_t fsw_ext4_dir_lookup(struct fsw_ext4_volume *vol, struct fsw_ext4_dnode *dno,
                                         struct fsw_string *lookup_name, struct fsw_ext4_dnode **child_dno);
@@ -110,7 +112,7 @@ static fsw_status_t fsw_ext4_volume_mount(struct fsw_ext4_volume *vol)
     fsw_status_t    status;
     void            *buffer;
     fsw_u32         blocksize;
-    fsw_u32         groupcnt, groupno, gdesc_per_block, gdesc_bno, gdesc_index, metabg_of_gdesc;
+    fsw_u32         groupcnt, groupno, gdesc_per_block, gdesc_bno, gdesc_index, metabg_of_gdesc, ra_count;
     struct ext4_group_desc *gdesc;
     int             i;
     struct fsw_string s;
@@ -192,35 +194,40 @@ static fsw_status_t fsw_ext4_volume_mount(struct fsw_ext4_volume *vol)
     if (status)
         return status;
 
-    // Loop through all block group descriptors in order to get inode table locations
-    for (groupno = 0; groupno < groupcnt; groupno++) {
+    // Loop through the block group descriptor blocks in order to get inode table locations,
+    // each block is read once for all the groups it describes. Outside of meta_bg (flex_bg
+    // volumes included) the descriptors are one run after the super block, so the block
+    // cache reads it ahead in a few large requests.
+    for (groupno = 0; groupno < groupcnt; groupno += gdesc_per_block) {
 
-        // Calculate the block number which contains the block group descriptor we look for
-        if(vol->sb->s_feature_incompat & EXT4_FEATURE_INCOMPAT_META_BG && groupno >= vol->sb->s_first_meta_bg)
+        // Calculate the block number which contains the block group descriptors we look for
+        if(vol->sb->s_feature_incompat & EXT4_FEATURE_INCOMPAT_META_BG && groupno / gdesc_per_block >= vol->sb->s_first_meta_bg)
         {
             // If option meta_bg is set, the block group descriptor is in meta block group...
-            metabg_of_gdesc = (fsw_u32)(groupno / gdesc_per_block) * gdesc_per_block;
+            metabg_of_gdesc = groupno;
             gdesc_bno = fsw_ext4_group_first_block_no(vol->sb, metabg_of_gdesc);
             // We need to know if the block group in questition has a super block, if yes, the 
             // block group descriptors are in the next block number
             if(!(vol->sb->s_feature_ro_compat & EXT4_FEATURE_RO_COMPAT_SPARSE_SUPER) || fsw_ext4_group_sparse(metabg_of_gdesc))
                 gdesc_bno += 1;
+            ra_count = 0;
         }
         else
         {
             // All group descriptors follow the super block (+1)
             gdesc_bno = (vol->sb->s_first_data_block + 1) + groupno / gdesc_per_block;
+            ra_count = (groupcnt - groupno - 1) / gdesc_per_block;
         }
-        gdesc_index = groupno % gdesc_per_block;
 
-        // Get block if necessary...
-        status = fsw_block_get(vol, gdesc_bno, 1, (void **)&buffer);
+        status = fsw_block_get_ra(vol, gdesc_bno, ra_count, 1, (void **)&buffer);
         if (status)
             return status;
 
-        // Get group descriptor table and block number of inode table...
-        gdesc = (struct ext4_group_desc *)((char *)buffer + gdesc_index * vol->sb->s_desc_size);
-        vol->inotab_bno[groupno] = gdesc->bg_inode_table_lo;
+        // Get group descriptor table and block numbers of inode tables...
+        for (gdesc_index = 0; gdesc_index < gdesc_per_block && groupno + gdesc_index < groupcnt; gdesc_index++) {
+            gdesc = (struct ext4_group_desc *)((char *)buffer + gdesc_index * vol->sb->s_desc_size);
+            vol->inotab_bno[groupno + gdesc_index] = gdesc->bg_inode_table_lo;
+        }
 
         fsw_block_release(vol, gdesc_bno, buffer);
     }
@@ -322,6 +329,8 @@ static void fsw_ext4_dnode_free(struct fsw_ext4_volume *vol, struct fsw_ext4_dno
 {
     if (dno->raw)
         fsw_free(dno->raw);
+    if (dno->extent_map)
+        fsw_free(dno->extent_map);
 }
 
 /**
@@ -379,77 +388,158 @@ static fsw_status_t fsw_ext4_get_extent(struct fsw_ext4_volume *vol, struct fsw_
 }
 
 /**
- * New ext4 extents...
+ * Append one leaf extent to the flattened extent list of a dnode, merging it
+ * into the previous run when both are contiguous on disk.
  */
-static fsw_status_t fsw_ext4_get_by_extent(struct fsw_ext4_volume *vol, struct fsw_ext4_dnode *dno,
-                                        struct fsw_extent *extent)
+static fsw_status_t fsw_ext4_extent_map_add(struct fsw_ext4_dnode *dno, fsw_u32 log_start,
+                                            fsw_u32 phys_start, fsw_u32 count)
+{
+  fsw_status_t  status;
+  fsw_u32       size;
+  struct fsw_ext4_extent_map_entry *map;
+  
+  if (dno->extent_map_count > 0) {
+    map = &dno->extent_map[dno->extent_map_count - 1];
+    if (log_start < map->log_start + map->count)
+      return FSW_VOLUME_CORRUPTED;   // leaves must be sorted and disjoint
+    if (log_start == map->log_start + map->count && phys_start == map->phys_start + map->count) {
+      map->count += count;
+      return FSW_SUCCESS;
+    }
+  }
+  
+  if (dno->extent_map_count == dno->extent_map_size) {
+    size = dno->extent_map_size * 2;
+    status = fsw_alloc(size * sizeof(struct fsw_ext4_extent_map_entry), &map);
+    if (status)
+      return status;
+    fsw_memcpy(map, dno->extent_map, dno->extent_map_count * sizeof(struct fsw_ext4_extent_map_entry));
+    fsw_free(dno->extent_map);
+    dno->extent_map = map;
+    dno->extent_map_size = size;
+  }
+  
+  map = &dno->extent_map[dno->extent_map_count++];
+  map->log_start = log_start;
+  map->phys_start = phys_start;
+  map->count = count;
+  return FSW_SUCCESS;
+}
+
+/**
+ * Walk one node of the extent tree, in the inode or in a block of size bytes,
+ * and append its leaves in order. Uninitialized extents read as zeros, so they
+ * are left out and show up as holes.
+ */
+static fsw_status_t fsw_ext4_extent_map_build(struct fsw_ext4_volume *vol, struct fsw_ext4_dnode *dno,
+                                              struct ext4_extent_header *header, fsw_u32 size, int depth)
 {
   fsw_status_t  status;
-  fsw_u32       bno;
-  //, release_bno,
-  fsw_u32       buf_offset;
-  //, file_bcnt;
-  int           ext_cnt;
+  fsw_u32       ext_cnt, len, leaf_bno;
   void          *buffer;
   
-  struct ext4_extent_header  *ext4_extent_header;
   struct ext4_extent_idx     *ext4_extent_idx;
   struct ext4_extent         *ext4_extent;
   
-  // Logical block requested by core...
-  bno = extent->log_start;
+  if (header->eh_magic != EXT4_EXT_MAGIC ||
+      header->eh_depth != depth ||
+      sizeof(struct ext4_extent_header) + header->eh_entries * sizeof(struct ext4_extent) > size)
+    return FSW_VOLUME_CORRUPTED;
+  
+  if (header->eh_depth == 0) {
+    // Leaf node, the header is followed by actual extents
+    ext4_extent = (struct ext4_extent *)(header + 1);
+    for (ext_cnt = 0; ext_cnt < header->eh_entries; ext_cnt++, ext4_extent++) {
+      len = ext4_extent->ee_len;
+      if (len > EXT4_EXT_INIT_MAX_LEN)
+        continue;
+      status = fsw_ext4_extent_map_add(dno, ext4_extent->ee_block, ext4_extent->ee_start_lo, len);
+      if (status)
+        return status;
+    }
+    return FSW_SUCCESS;
+  }
   
-  // First buffer is the i_block field from inode...
-  buffer = (void *)dno->raw->i_block;
-  buf_offset = 0;
-  while(1) {
-    ext4_extent_header = (struct ext4_extent_header *)((char *)buffer + buf_offset);
-    buf_offset += sizeof(struct ext4_extent_header);
- //   FSW_MSG_DEBUG((FSW_MSGSTR("fsw_ext4_get_by_extent: extent header with %d entries\n"),
- //                  ext4_extent_header->eh_entries));
-    if(ext4_extent_header->eh_magic != EXT4_EXT_MAGIC)
-      return FSW_VOLUME_CORRUPTED;
+  // Index node, follow the tree one level down for every entry
+  ext4_extent_idx = (struct ext4_extent_idx *)(header + 1);
+  for (ext_cnt = 0; ext_cnt < header->eh_entries; ext_cnt++, ext4_extent_idx++) {
+    leaf_bno = ext4_extent_idx->ei_leaf_lo;
+    status = fsw_block_get(vol, leaf_bno, 1, &buffer);
+    if (status)
+      return status;
+    status = fsw_ext4_extent_map_build(vol, dno, (struct ext4_extent_header *)buffer,
+                                       vol->g.phys_blocksize, depth - 1);
+    fsw_block_release(vol, leaf_bno, buffer);
+    if (status)
+      return status;
+  }
+  return FSW_SUCCESS;
+}
+
+/**
+ * New ext4 extents... The extent tree is flattened into a sorted list of runs
+ * on first use and kept with the dnode, lookups are a binary search of that list.
+ */
+static fsw_status_t fsw_ext4_get_by_extent(struct fsw_ext4_volume *vol, struct fsw_ext4_dnode *dno,
+                                        struct fsw_extent *extent)
+{
+  fsw_status_t  status;
+  fsw_u32       bno, file_bcnt;
+  fsw_u32       lower, upper, middle;
+  struct ext4_extent_header        *header;
+  struct fsw_ext4_extent_map_entry *run;
+  
+  if (dno->extent_map == NULL) {
+    status = fsw_alloc(EXT4_EXTENT_MAP_INITIAL * sizeof(struct fsw_ext4_extent_map_entry), &dno->extent_map);
+    if (status)
+      return status;
+    dno->extent_map_size = EXT4_EXTENT_MAP_INITIAL;
+    dno->extent_map_count = 0;
     
-    for(ext_cnt = 0;ext_cnt < ext4_extent_header->eh_entries;ext_cnt++)
-    {
-      if(ext4_extent_header->eh_depth == 0)
-      {
-        // Leaf node, the header follows actual extents
-        ext4_extent = (struct ext4_extent *)((char *)buffer + buf_offset);
-        buf_offset += sizeof(struct ext4_extent);
- //       FSW_MSG_DEBUG((FSW_MSGSTR("fsw_ext4_get_by_extent: extent node cover %d...\n"), ext4_extent->ee_block));
-        
-        // Is the requested block in this extent?
-        if(bno >= ext4_extent->ee_block && bno < ext4_extent->ee_block + ext4_extent->ee_len)
-        {
-          extent->phys_start = ext4_extent->ee_start_lo + (bno - ext4_extent->ee_block);
-          extent->log_count = ext4_extent->ee_len - (bno - ext4_extent->ee_block);
-          return FSW_SUCCESS;
-        }
-      }
-      else
-      {
-  //      FSW_MSG_DEBUG((FSW_MSGSTR("fsw_ext4_get_by_extent: index extents, depth %d\n"),
-  //                     ext4_extent_header->eh_depth));
-        ext4_extent_idx = (struct ext4_extent_idx *)((char *)buffer + buf_offset);
-        buf_offset += sizeof(struct ext4_extent_idx);
-        
- //       FSW_MSG_DEBUG((FSW_MSGSTR("fsw_ext4_get_by_extent: index node covers block %d...\n"),
- //                      ext4_extent_idx->ei_block));
-        if(bno >= ext4_extent_idx->ei_block)
-        {
-          // Follow extent tree...
-          status = fsw_block_get(vol, ext4_extent_idx->ei_leaf_lo, 1, (void **)&buffer);
-          if (status)
-            return status;
-          buf_offset = 0;
-          break;
-        }
-      }
+    // First node is the i_block field from inode...
+    header = (struct ext4_extent_header *)dno->raw->i_block;
+    if (header->eh_depth > EXT4_EXTENT_MAX_DEPTH)
+      status = FSW_VOLUME_CORRUPTED;
+    else
+      status = fsw_ext4_extent_map_build(vol, dno, header, sizeof(dno->raw->i_block), header->eh_depth);
+    if (status) {
+      fsw_free(dno->extent_map);
+      dno->extent_map = NULL;
+      return status;
     }
   }
   
-  return FSW_NOT_FOUND;
+  // Logical block requested by core...
+  bno = extent->log_start;
+  
+  // Find the first run ending after bno
+  lower = 0;
+  upper = dno->extent_map_count;
+  while (lower < upper) {
+    middle = lower + (upper - lower) / 2;
+    run = &dno->extent_map[middle];
+    if (run->log_start + run->count <= bno)
+      lower = middle + 1;
+    else
+      upper = middle;
+  }
+  
+  if (lower < dno->extent_map_count && dno->extent_map[lower].log_start <= bno) {
+    run = &dno->extent_map[lower];
+    extent->phys_start = run->phys_start + (bno - run->log_start);
+    extent->log_count = run->count - (bno - run->log_start);
+    return FSW_SUCCESS;
+  }
+  
+  // A hole, up to the next run or the end of the file
+  extent->type = FSW_EXTENT_TYPE_SPARSE;
+  if (lower < dno->extent_map_count) {
+    extent->log_count = dno->extent_map[lower].log_start - bno;
+  } else {
+    file_bcnt = (fsw_u32)((dno->g.size + vol->g.log_blocksize - 1) / vol->g.log_blocksize);
+    extent->log_count = (file_bcnt > bno) ? file_bcnt - bno : 1;
+  }
+  return FSW_SUCCESS;
 }
 
 /**
@@ -36,6 +36,10 @@
 #define EXT4_SUPERBLOCK_BLOCKSIZE  1024
 //! Block number where the (master copy of the) ext4 superblock resides.
 #define EXT4_SUPERBLOCK_BLOCKNO       1
+//! Initial number of runs in a dnode's extent list.
+#define EXT4_EXTENT_MAP_INITIAL       8
+//! Deepest extent tree accepted, the kernel never builds more than 5 levels.
+#define EXT4_EXTENT_MAX_DEPTH         5
 
 
 /**
@@ -52,6 +56,16 @@ struct fsw_ext4_volume {
     fsw_u32     inode_size;         //!< Size of inode structure in bytes
 };
 
+/**
+ * ext4: One run of a file's flattened extent tree.
+ */
+
+struct fsw_ext4_extent_map_entry {
+    fsw_u32     log_start;          //!< First logical block of the run
+    fsw_u32     phys_start;         //!< First physical block of the run
+    fsw_u32     count;              //!< Number of blocks in the run
+};
+
 /**
  * ext2: Dnode structure with ext2-specific data.
  */
@@ -60,6 +74,9 @@ struct fsw_ext4_dnode {
     struct fsw_dnode g;             //!< Generic dnode structure
     
     struct ext4_inode *raw;         //!< Full raw inode structure
+    struct fsw_ext4_extent_map_entry *extent_map; //!< Sorted runs of the extent tree, built on first use
+    fsw_u32     extent_map_count;   //!< Number of runs in extent_map
+    fsw_u32     extent_map_size;    //!< Allocated entries in extent_map
 };
 
 
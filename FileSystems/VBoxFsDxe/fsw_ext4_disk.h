@@ -496,5 +496,10 @@ struct ext4_extent_header {
 
 #define EXT4_EXT_MAGIC		(0xf30a)
 
+/*
+ * ee_len above this marks an uninitialized extent of ee_len - EXT4_EXT_INIT_MAX_LEN blocks.
+ */
+#define EXT4_EXT_INIT_MAX_LEN	(1UL << 15)
+
 
 #endif
@@ -31,7 +31,6 @@
 #include <Library/PrintLib.h>
 
 
-#define VBOXHFS_BTREE_BINSEARCH 0
 #define DEBUG_HFS 0
 
 #if DEBUG_HFS==2
@@ -62,6 +61,8 @@ static int hardlink = 0;
 
 static fsw_status_t fsw_hfs_volume_mount(struct fsw_hfs_volume *vol);
 static void         fsw_hfs_volume_free(struct fsw_hfs_volume *vol);
+static void         fsw_hfs_btree_free_cache(struct fsw_hfs_btree *btree);
+static void         fsw_hfs_extent_map_free(struct fsw_hfs_dnode *dno);
 static fsw_status_t fsw_hfs_volume_stat(struct fsw_hfs_volume *vol, struct fsw_volume_stat *sb);
 
 static fsw_status_t fsw_hfs_dnode_fill(struct fsw_hfs_volume *vol, struct fsw_hfs_dnode *dno);
@@ -395,6 +396,12 @@ static fsw_status_t fsw_hfs_volume_mount(struct fsw_hfs_volume *vol)
 
 static void fsw_hfs_volume_free(struct fsw_hfs_volume *vol)
 {
+  fsw_hfs_btree_free_cache(&vol->catalog_tree);
+  fsw_hfs_btree_free_cache(&vol->extents_tree);
+  if (vol->lookup_cache) {
+    fsw_free(vol->lookup_cache);
+    vol->lookup_cache = NULL;
+  }
   if (vol->primary_voldesc) {
     fsw_free(vol->primary_voldesc);
     vol->primary_voldesc = NULL;
@@ -440,6 +447,7 @@ static fsw_status_t fsw_hfs_dnode_fill(struct fsw_hfs_volume *vol, struct fsw_hf
 
 static void fsw_hfs_dnode_free(struct fsw_hfs_volume *vol, struct fsw_hfs_dnode *dno)
 {
+  fsw_hfs_extent_map_free(dno);
 }
 
 static fsw_u32 mac_to_posix(fsw_u32 mac_time)
@@ -469,31 +477,6 @@ static fsw_status_t fsw_hfs_dnode_stat(struct fsw_hfs_volume *vol,
   return FSW_SUCCESS;
 }
 
-static int
-fsw_hfs_find_block(HFSPlusExtentRecord *exts,
-                   fsw_u32             *lbno,
-                   fsw_u32             *pbno)
-{
-  int i;
-  fsw_u32 cur_lbno = *lbno;
-//  DBG("search for lbno=%d\n", *lbno);
-  
-  for (i = 0; i < 8; i++) {
-    fsw_u32 start = be32_to_cpu ((*exts)[i].startBlock);
-    fsw_u32 count = be32_to_cpu ((*exts)[i].blockCount);
-    
-    if (cur_lbno < count) {
-      *pbno = start + cur_lbno;
-//      DBG("found block %d in segment %d\n", *pbno, i);
-      return 1;
-    }
-    cur_lbno -= count;
-  }
-  
-  *lbno = cur_lbno;
-  return 0;
-}
-
 //
 // Find record offset, numbering starts from the end
 //
@@ -544,6 +527,68 @@ fsw_hfs_btree_next_node (BTreeKey *currkey)
   return be32_to_cpu_ua(pointer);
 }
 
+//
+// Read a B-tree node into buffer, from the node cache when it is there.
+// The upper index nodes are read by every search, so they stay.
+//
+static fsw_status_t
+fsw_hfs_btree_read_node (struct fsw_hfs_btree *btree,
+                         fsw_u32              node_num,
+                         fsw_u8               *buffer)
+{
+  struct fsw_hfs_node_cache *slot;
+  struct fsw_hfs_node_cache *victim = &btree->cache[0];
+  fsw_u32 i;
+
+  for (i = 0; i < FSW_HFS_NODE_CACHE_SIZE; i++) {
+    slot = &btree->cache[i];
+    if (slot->buffer != NULL && slot->node_num == node_num) {
+      fsw_memcpy(buffer, slot->buffer, btree->node_size);
+      slot->stamp = ++btree->cache_stamp;
+      return FSW_SUCCESS;
+    }
+    if (victim->buffer != NULL && (slot->buffer == NULL || slot->stamp < victim->stamp)) {
+      victim = slot;
+    }
+  }
+
+  if ((fsw_u32)fsw_hfs_read_file(btree->file,
+                                 MultU64x32(node_num, btree->node_size),
+                                 btree->node_size, buffer) !=
+      btree->node_size) {
+    DBG("differ node size while read file\n");
+    return FSW_VOLUME_CORRUPTED;
+  }
+
+  if (victim->buffer == NULL && fsw_alloc(btree->node_size, &victim->buffer) != FSW_SUCCESS) {
+    victim->buffer = NULL;
+    return FSW_SUCCESS; // not cached, no matter
+  }
+  fsw_memcpy(victim->buffer, buffer, btree->node_size);
+  victim->node_num = node_num;
+  victim->stamp = ++btree->cache_stamp;
+  return FSW_SUCCESS;
+}
+
+static void
+fsw_hfs_btree_free_cache (struct fsw_hfs_btree *btree)
+{
+  fsw_u32 i;
+
+  for (i = 0; i < FSW_HFS_NODE_CACHE_SIZE; i++) {
+    if (btree->cache[i].buffer != NULL) {
+      fsw_free(btree->cache[i].buffer);
+      btree->cache[i].buffer = NULL;
+    }
+  }
+}
+
+//
+// Binary search over the record offset table of each node: the last record whose key
+// is <= key. In an index node that is the child to go down to, in a leaf it is the
+// record if the keys are equal. A key bigger than all the records of a leaf may be
+// at the start of the next one.
+//
 static fsw_status_t
 fsw_hfs_btree_search (struct fsw_hfs_btree *btree,
                       BTreeKey             *key,
@@ -556,11 +601,10 @@ fsw_hfs_btree_search (struct fsw_hfs_btree *btree,
   BTNodeDescriptor *node;
   fsw_u32 currnode;
   fsw_u32 recnum;
-#ifdef VBOXHFS_BTREE_BINSEARCH
   fsw_u32 lower, upper;
-#endif
+  fsw_u32 depth = 0;
 
-  currnode = btree->root_node; //always from root?
+  currnode = btree->root_node;
   status = fsw_alloc(btree->node_size, &buffer);
   if (status != FSW_SUCCESS) {
     fsw_free(buffer);
@@ -569,21 +613,20 @@ fsw_hfs_btree_search (struct fsw_hfs_btree *btree,
   node = (BTNodeDescriptor *) buffer;
 
   for (;;) { //node cycle
-    fsw_s32 cmp = 0;
-    int match;
+    fsw_s32 cmp;
     fsw_u32 count;
     BTreeKey *currkey;
 
-    match = 0;
+    // a corrupted tree must not loop forever
+    if (++depth > 64) {
+      status = FSW_VOLUME_CORRUPTED;
+      break;
+    }
     /* Read a node */
-    if ((fsw_u32)fsw_hfs_read_file(btree->file,
-                                   MultU64x32(currnode, btree->node_size),
-                                   btree->node_size, buffer) !=
-        btree->node_size) {
-          status = FSW_VOLUME_CORRUPTED;
-          DBG("differ node size while read file\n");
-          break;
-        }
+    status = fsw_hfs_btree_read_node(btree, currnode, buffer);
+    if (status != FSW_SUCCESS) {
+      break;
+    }
 //check record0 pointing to end of descriptor
     if (be16_to_cpu (*(fsw_u16 *) (buffer + btree->node_size - 2)) !=
         sizeof (BTNodeDescriptor)) {
@@ -592,113 +635,55 @@ fsw_hfs_btree_search (struct fsw_hfs_btree *btree,
       break;
     }
     count = be16_to_cpu (node->numRecords);
-
-#ifndef VBOXHFS_BTREE_BINSEARCH
-    //preliminary test for last record. May be not needed look all for this node
-    currkey = fsw_hfs_btree_rec (btree, node, count - 1);
-    cmp = compare_keys (currkey, key);
-    if ((cmp == 0) && (node->kind == kBTLeafNode)) {
-      /* Found!  */
-      *result = node;
-      *key_offset = recnum;
-      hardlink = 0;
-      return FSW_SUCCESS;
-    } else if (cmp < 0) { //all records has key less than searched
-      if (node->kind == kBTIndexNode) {
-        currnode = fsw_hfs_btree_next_node (currkey);
-      } else if (node->fLink) {
-        currnode = be32_to_cpu (node->fLink);
-      } else {
-        status = FSW_NOT_FOUND;
-        break;
-      }
-      continue;
-    } //else search for all records
-    
-    for (recnum = 0; recnum < count; recnum++) {
-      currkey = fsw_hfs_btree_rec (btree, node, recnum);
-      cmp = compare_keys (currkey, key);  //fsw_hfs_cmpi_catkey
- //     DBG(": currnode %d rec=%d count %d cmp=%d kind=%d\n",
- //         currnode, recnum, count, cmp, node->kind);
-
-      /* Leaf node. */
-      if (node->kind == kBTLeafNode) {
-        if (cmp == 0) {
-          /* Found!  */
-          *result = node;
-          *key_offset = recnum;
-          hardlink = 0;
-          return FSW_SUCCESS;
-        }
-      } else if (node->kind == kBTIndexNode) {
-        if (cmp > 0)
-          break;
-        currnode = fsw_hfs_btree_next_node (currkey); //largest that <= search
-      }
-    }
-    if (node->kind == kBTLeafNode) {
+    if (count == 0 || (node->kind != kBTLeafNode && node->kind != kBTIndexNode)) {
       status = FSW_NOT_FOUND;
       break;
     }
 
-    if (cmp <= 0 && node->fLink) {
-      currnode = be32_to_cpu (node->fLink);
-    }
-#else
-    /* Perform binary search */
+    /* lower = number of records with a key <= key */
     lower = 0;
-    upper = count - 1;
-    currkey = NULL;
-
-    if (count == 0) {
-      status = FSW_NOT_FOUND;
-      goto done;
-    }
-
-    while (lower <= upper) {
-      recnum = (lower + upper) / 2;
-
+    upper = count;
+    while (lower < upper) {
+      recnum = lower + (upper - lower) / 2;
       currkey = fsw_hfs_btree_rec (btree, node, recnum);
-
+      if (currkey == NULL) {
+        status = FSW_VOLUME_CORRUPTED;
+        goto done;
+      }
       cmp = compare_keys (currkey, key);  //fsw_hfs_cmpi_catkey
  //     DBG(": currnode %d lower/recnum/upper %d/%d/%d (%d) cmp=%d kind=%d\n",
  //         currnode, lower, recnum, upper, count, cmp, node->kind);
-      if (cmp > 0) {
-        upper = recnum - 1;
-      } else if (cmp < 0) {
+      if (cmp == 0 && node->kind == kBTLeafNode) {
+        /* Found!  */
+        *result = node;
+        *key_offset = recnum;
+        hardlink = 0;
+        return FSW_SUCCESS;
+      }
+      if (cmp <= 0) {
         lower = recnum + 1;
-      } else if (cmp == 0) {
-        if (node->kind == kBTLeafNode) {
-          // Found!
-          *result = node;
-          *key_offset = recnum;
-          return FSW_SUCCESS;
-
-        } else if (node->kind == kBTIndexNode) {
-          currnode = fsw_hfs_btree_next_node (currkey);
-          break;
-        }
+      } else {
+        upper = recnum;
       }
     }
 
-    if (cmp > 0) {
-      currkey = fsw_hfs_btree_rec (btree, node, upper);
-    }
-
-    if (node->kind == kBTIndexNode && currkey != NULL) {
-      currnode = fsw_hfs_btree_next_node (currkey);
- //     DBG(": candidate for the next currnode is %d\n", currnode);
-    }
-    else {
+    if (node->kind == kBTLeafNode) {
+      if (lower == count && node->fLink) {
+        currnode = be32_to_cpu (node->fLink);
+        continue;
+      }
       status = FSW_NOT_FOUND;
       break;
     }
-#endif
+    if (lower == 0) {
+      status = FSW_NOT_FOUND; // smaller than the whole subtree
+      break;
+    }
+    currnode = fsw_hfs_btree_next_node (fsw_hfs_btree_rec (btree, node, lower - 1));
+ //   DBG(": candidate for the next currnode is %d\n", currnode);
   }
 
-#ifdef VBOXHFS_BTREE_BINSEARCH
 done:
-#endif
   if (buffer != NULL && status != FSW_SUCCESS)
     fsw_free(buffer);
   
@@ -1172,59 +1157,149 @@ fsw_hfs_cmp_id (BTreeKey *key1, void *param)
  * the requested logical block number.
  */
 
+static void
+fsw_hfs_extent_map_free(struct fsw_hfs_dnode *dno)
+{
+  if (dno->extent_map != NULL) {
+    fsw_free(dno->extent_map);
+    dno->extent_map = NULL;
+  }
+  dno->extent_map_count = 0;
+  dno->extent_map_size = 0;
+  dno->extent_map_blocks = 0;
+}
+
+//
+// Append the runs of an extent record to the map of the file.
+// Sets *added to the number of blocks added, 0 for an empty record.
+//
+static fsw_status_t
+fsw_hfs_extent_map_add(struct fsw_hfs_dnode *dno,
+                       HFSPlusExtentRecord  *exts,
+                       fsw_u32              *added)
+{
+  fsw_status_t status;
+  struct fsw_hfs_extent_map_entry *map;
+  int i;
+
+  *added = 0;
+  for (i = 0; i < 8; i++) {
+    fsw_u32 start = be32_to_cpu ((*exts)[i].startBlock);
+    fsw_u32 count = be32_to_cpu ((*exts)[i].blockCount);
+
+    if (count == 0) {
+      break;
+    }
+    if (dno->extent_map_count == dno->extent_map_size) {
+      fsw_u32 size = dno->extent_map_size ? dno->extent_map_size * 2 : 8;
+      status = fsw_alloc(size * sizeof(struct fsw_hfs_extent_map_entry), &map);
+      if (status) {
+        return status;
+      }
+      if (dno->extent_map != NULL) {
+        fsw_memcpy(map, dno->extent_map, dno->extent_map_count * sizeof(struct fsw_hfs_extent_map_entry));
+        fsw_free(dno->extent_map);
+      }
+      dno->extent_map = map;
+      dno->extent_map_size = size;
+    }
+    map = &dno->extent_map[dno->extent_map_count++];
+    map->log_start = dno->extent_map_blocks;
+    map->phys_start = start;
+    map->count = count;
+    dno->extent_map_blocks += count;
+    *added += count;
+  }
+  return FSW_SUCCESS;
+}
+
+//
+// Extend the map with the next extents overflow record of the file, the one
+// starting where the map ends.
+//
+static fsw_status_t
+fsw_hfs_extent_map_grow(struct fsw_hfs_volume *vol,
+                        struct fsw_hfs_dnode  *dno)
+{
+  fsw_status_t             status;
+  BTNodeDescriptor         *node = NULL;
+  struct HFSPlusExtentKey  *key;
+  struct HFSPlusExtentKey  overflowkey;
+  fsw_u32                  ptr;
+  fsw_u32                  added = 0;
+
+  if (vol->extents_tree.node_size == 0) {
+    return FSW_NOT_FOUND; // still mounting
+  }
+  overflowkey.forkType = 0;  //data fork
+  overflowkey.fileID = dno->g.dnode_id;
+  overflowkey.startBlock = dno->extent_map_blocks;
+
+  status = fsw_hfs_btree_search (&vol->extents_tree,
+                                 (BTreeKey*)&overflowkey,
+                                 fsw_hfs_cmp_extkey,
+                                 &node, &ptr);
+  if (status) {
+    return status;
+  }
+
+  key = (struct HFSPlusExtentKey *) fsw_hfs_btree_rec (&vol->extents_tree, node, ptr);
+  if (key == NULL) {
+    status = FSW_VOLUME_CORRUPTED;
+  } else {
+    status = fsw_hfs_extent_map_add(dno, (HFSPlusExtentRecord*) (key + 1), &added);
+    if (!status && added == 0) {
+      status = FSW_NOT_FOUND;
+    }
+  }
+  fsw_free(node);
+  return status;
+}
+
 static fsw_status_t fsw_hfs_get_extent(struct fsw_hfs_volume * vol,
                                        struct fsw_hfs_dnode  * dno,
                                        struct fsw_extent     * extent)
 {
   fsw_status_t         status;
   fsw_u32              lbno;
-  HFSPlusExtentRecord  *exts;
-  BTNodeDescriptor     *node = NULL;
-  struct HFSPlusExtentKey* key;
-  struct HFSPlusExtentKey  overflowkey;
-  fsw_u32                  ptr;
-  fsw_u32                  phys_bno;
+  fsw_u32              lower, upper, middle;
+  fsw_u32              added;
+  struct fsw_hfs_extent_map_entry *run;
   
   extent->type = FSW_EXTENT_TYPE_PHYSBLOCK;
   extent->log_count = 1;
   lbno = extent->log_start;
   
   /* we only care about data forks atm, do we? */
-  exts = &dno->extents;
-  
-  while (1) {
-    if (fsw_hfs_find_block(exts, &lbno, &phys_bno)) {
-      extent->phys_start = phys_bno + vol->emb_block_off;
-      status = FSW_SUCCESS;
-      break;
-    }
-    
-    /* Find appropriate overflow record */
-    overflowkey.forkType = 0;  //data fork
-    overflowkey.fileID = dno->g.dnode_id;
-    overflowkey.startBlock = extent->log_start - lbno;
-    
-    if (node != NULL) {
-      fsw_free(node);
-      node = NULL;
+  if (dno->extent_map == NULL) {
+    status = fsw_hfs_extent_map_add(dno, &dno->extents, &added);
+    if (status) {
+      return status;
     }
-    
-    status = fsw_hfs_btree_search (&vol->extents_tree,
-                                   (BTreeKey*)&overflowkey,
-                                   fsw_hfs_cmp_extkey,
-                                   &node, &ptr);
+  }
+  /* the overflow records are read once, when the file is read that far */
+  while (lbno >= dno->extent_map_blocks) {
+    status = fsw_hfs_extent_map_grow(vol, dno);
     if (status) {
-      break;
+      return status;
     }
-    
-    key = (struct HFSPlusExtentKey *) fsw_hfs_btree_rec (&vol->extents_tree, node, ptr);
-    exts = (HFSPlusExtentRecord*) (key + 1);
   }
   
-  if (node != NULL)
-    fsw_free(node);
-  
-  return status;
+  /* the last run starting at or before lbno */
+  lower = 0;
+  upper = dno->extent_map_count;
+  while (upper - lower > 1) {
+    middle = lower + (upper - lower) / 2;
+    if (dno->extent_map[middle].log_start <= lbno) {
+      lower = middle;
+    } else {
+      upper = middle;
+    }
+  }
+  run = &dno->extent_map[lower];
+  extent->phys_start = run->phys_start + (lbno - run->log_start) + vol->emb_block_off;
+  extent->log_count = run->count - (lbno - run->log_start);
+  return FSW_SUCCESS;
 }
 
 static fsw_status_t
@@ -1248,6 +1323,12 @@ create_hfs_dnode(struct fsw_hfs_dnode  *dno,
   baby->ctime = file_info->ctime;
   baby->mtime = file_info->mtime;
   
+  /* An existing dnode may come back with other extents, a hardlink now resolved */
+  if (baby->extent_map != NULL &&
+      !fsw_memeq(baby->extents, &file_info->extents, sizeof(file_info->extents))) {
+    fsw_hfs_extent_map_free(baby);
+  }
+
   /* Fill-in extents info */
   if (file_info->type == FSW_DNODE_TYPE_FILE) {
     fsw_memcpy(baby->extents, &file_info->extents, sizeof(file_info->extents));
@@ -1265,6 +1346,78 @@ create_hfs_dnode(struct fsw_hfs_dnode  *dno,
   return FSW_SUCCESS;
 }
 
+//
+// Name lookup cache, see struct fsw_hfs_lookup_cache. Boot loaders probe the same
+// deep paths over and over, most of them not there.
+//
+static struct fsw_hfs_lookup_cache *
+fsw_hfs_lookup_cache_find (struct fsw_hfs_volume *vol,
+                           fsw_u32               parent_id,
+                           fsw_u16               *name,
+                           fsw_u32               name_len)
+{
+  struct fsw_hfs_lookup_cache *entry;
+  fsw_u32 i;
+
+  if (vol->lookup_cache == NULL) {
+    return NULL;
+  }
+  for (i = 0; i < FSW_HFS_LOOKUP_CACHE_SIZE; i++) {
+    entry = &vol->lookup_cache[i];
+    if (entry->parent_id == parent_id && entry->name_len == name_len &&
+        fsw_memeq(entry->name, name, name_len * sizeof(fsw_u16))) {
+      entry->stamp = ++vol->lookup_stamp;
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+static void
+fsw_hfs_lookup_cache_add (struct fsw_hfs_volume *vol,
+                          fsw_u32               parent_id,
+                          fsw_u16               *name,
+                          fsw_u32               name_len,
+                          fsw_status_t          status,
+                          file_info_t           *file_info)
+{
+  struct fsw_hfs_lookup_cache *entry;
+  struct fsw_hfs_lookup_cache *victim;
+  fsw_u32 i;
+
+  if (parent_id == 0 || name_len > 255) {
+    return;
+  }
+  if (vol->lookup_cache == NULL &&
+      fsw_alloc_zero(FSW_HFS_LOOKUP_CACHE_SIZE * sizeof(struct fsw_hfs_lookup_cache),
+                     (void **)&vol->lookup_cache) != FSW_SUCCESS) {
+    vol->lookup_cache = NULL;
+    return;
+  }
+  victim = &vol->lookup_cache[0];
+  for (i = 0; i < FSW_HFS_LOOKUP_CACHE_SIZE; i++) {
+    entry = &vol->lookup_cache[i];
+    if (entry->parent_id == 0) {
+      victim = entry;
+      break;
+    }
+    if (entry->stamp < victim->stamp) {
+      victim = entry;
+    }
+  }
+  victim->parent_id = parent_id;
+  victim->stamp = ++vol->lookup_stamp;
+  victim->status = status;
+  victim->name_len = (fsw_u16)name_len;
+  fsw_memcpy(victim->name, name, name_len * sizeof(fsw_u16));
+  if (file_info != NULL) {
+    fsw_memcpy(&victim->file_info, file_info, sizeof(file_info_t));
+  } else {
+    fsw_memzero(&victim->file_info, sizeof(file_info_t));
+  }
+  victim->file_info.name = NULL;
+}
+
 /**
  * Lookup a directory's child dnode by name. This function is called on a directory
  * to retrieve the directory entry with the given name. A dnode is constructed for
@@ -1286,6 +1439,7 @@ static fsw_status_t fsw_hfs_dir_lookup(struct fsw_hfs_volume * vol,
   int                     free_data = 0; //, i;
   HFSPlusCatalogKey*      file_key;
   file_info_t             file_info;
+  struct fsw_hfs_lookup_cache *cached;
   
   fsw_memzero(&file_info, sizeof(file_info_t));
   file_info.name = &rec_name;
@@ -1308,6 +1462,19 @@ static fsw_status_t fsw_hfs_dir_lookup(struct fsw_hfs_volume * vol,
   }
     
   catkey.keyLength = (fsw_u16)(6 + rec_name.size);
+
+  cached = fsw_hfs_lookup_cache_find(vol, catkey.parentID, catkey.nodeName.unicode, catkey.nodeName.length);
+  if (cached != NULL) {
+    status = cached->status;
+    if (status) {
+      goto done;
+    }
+    fsw_memcpy(&file_info, &cached->file_info, sizeof(file_info_t));
+    file_info.name = &rec_name;
+    status = create_hfs_dnode(dno, &file_info,  child_dno_out);
+    goto done;
+  }
+
   status = fsw_hfs_btree_search (&vol->catalog_tree,
                                  (BTreeKey*)&catkey,
                                  vol->case_sensitive ?
@@ -1315,12 +1482,16 @@ static fsw_status_t fsw_hfs_dir_lookup(struct fsw_hfs_volume * vol,
                                  &node, &ptr);
   if (status) {
 //    DBG("fsw_hfs_btree_search dir lookup  status %a\n", fsw_errors[status]);
+    if (status == FSW_NOT_FOUND) {
+      fsw_hfs_lookup_cache_add(vol, catkey.parentID, catkey.nodeName.unicode, catkey.nodeName.length, status, NULL);
+    }
     goto done;
   }
   
   file_key = (HFSPlusCatalogKey *)fsw_hfs_btree_rec (&vol->catalog_tree, node, ptr);
   
   fill_fileinfo (vol, file_key, &file_info);
+  fsw_hfs_lookup_cache_add(vol, catkey.parentID, catkey.nodeName.unicode, catkey.nodeName.length, FSW_SUCCESS, &file_info);
   status = create_hfs_dnode(dno, &file_info,  child_dno_out); //&tmp_dno_out); //
 //  if (status) {
 //    DBG("create_hfs_dnode  status %a\n", fsw_errors[status]);
@@ -90,6 +90,17 @@ typedef enum {
     FSW_HFS_PLUS_EMB
 } fsw_hfs_kind;
 
+/**
+ * HFS: One contiguous run of a file, file blocks from log_start on disk blocks from phys_start.
+ */
+
+struct fsw_hfs_extent_map_entry
+{
+  fsw_u32                   log_start;
+  fsw_u32                   phys_start;
+  fsw_u32                   count;
+};
+
 /**
  * HFS: Dnode structure with HFS-specific data.
  */
@@ -107,16 +118,36 @@ struct fsw_hfs_dnode
   /* hardlinks stuff */
   fsw_u32 ilink;
   fsw_u32 isDirLink;
+  /* the runs of extents and of the overflow records read so far, sorted by log_start */
+  struct fsw_hfs_extent_map_entry *extent_map;
+  fsw_u32                   extent_map_count;
+  fsw_u32                   extent_map_size;     // allocated entries
+  fsw_u32                   extent_map_blocks;   // file blocks covered
 };
 
 /**
  * HFS: In-memory B-tree structure.
  */
+//! B-tree nodes kept per tree, the least recently used one is replaced.
+#define FSW_HFS_NODE_CACHE_SIZE    16
+
+//! Name lookups kept per volume, the least recently used one is replaced.
+#define FSW_HFS_LOOKUP_CACHE_SIZE  32
+
+struct fsw_hfs_node_cache
+{
+    fsw_u32                  node_num;
+    fsw_u32                  stamp;        // last use
+    fsw_u8                   *buffer;      // node_size bytes, NULL for a free slot
+};
+
 struct fsw_hfs_btree
 {
     fsw_u32                  root_node;
     fsw_u32                  node_size;
     struct fsw_hfs_dnode*    file;
+    struct fsw_hfs_node_cache cache[FSW_HFS_NODE_CACHE_SIZE];
+    fsw_u32                  cache_stamp;
 };
 
 
@@ -136,6 +167,8 @@ struct fsw_hfs_volume
     fsw_u32                       block_size_shift;
     fsw_hfs_kind                  hfs_kind;
     fsw_u32                       emb_block_off;
+    struct fsw_hfs_lookup_cache   *lookup_cache;    // FSW_HFS_LOOKUP_CACHE_SIZE entries, allocated on first lookup
+    fsw_u32                       lookup_stamp;
 };
 
 
@@ -156,6 +189,21 @@ typedef struct {
   HFSPlusExtentRecord extents;
 } file_info_t;
 
+/**
+ * HFS: Result of a name lookup in a directory, found or not. The volume is read-only,
+ * so it holds until unmount. file_info.name is not kept.
+ */
+
+struct fsw_hfs_lookup_cache
+{
+    fsw_u32             parent_id;     // 0 for a free slot
+    fsw_u32             stamp;         // last use
+    fsw_status_t        status;
+    fsw_u16             name_len;      // UTF-16 chars
+    fsw_u16             name[255];
+    file_info_t         file_info;
+};
+
 
 /* Endianess swappers */
 static __inline fsw_u16
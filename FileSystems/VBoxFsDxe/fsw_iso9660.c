@@ -96,6 +96,9 @@ static fsw_status_t fsw_iso9660_dir_lookup(struct fsw_iso9660_volume *vol, struc
 static fsw_status_t fsw_iso9660_dir_read(struct fsw_iso9660_volume *vol, struct fsw_iso9660_dnode *dno,
                                          struct fsw_shandle *shand, struct fsw_iso9660_dnode **child_dno);
 static fsw_status_t fsw_iso9660_read_dirrec(struct fsw_iso9660_volume *vol, struct fsw_shandle *shand, struct iso9660_dirrec_buffer *dirrec_buffer);
+static fsw_u32      fsw_iso9660_name_hash(struct fsw_string *name);
+static fsw_status_t fsw_iso9660_dir_index(struct fsw_iso9660_volume *vol, struct fsw_iso9660_dnode *dno);
+static void         fsw_iso9660_dir_index_free(struct fsw_iso9660_dnode *dno);
 
 static fsw_status_t fsw_iso9660_readlink(struct fsw_iso9660_volume *vol, struct fsw_iso9660_dnode *dno,
                                          struct fsw_string *link);
@@ -442,6 +445,7 @@ static fsw_status_t fsw_iso9660_dnode_fill(struct fsw_iso9660_volume *vol, struc
 
 static void fsw_iso9660_dnode_free(struct fsw_iso9660_volume *vol, struct fsw_iso9660_dnode *dno)
 {
+    fsw_iso9660_dir_index_free(dno);
 }
 
 /**
@@ -496,51 +500,176 @@ static fsw_status_t fsw_iso9660_get_extent(struct fsw_iso9660_volume *vol, struc
 
 static fsw_status_t fsw_iso9660_dir_lookup(struct fsw_iso9660_volume *vol, struct fsw_iso9660_dnode *dno,
                                            struct fsw_string *lookup_name, struct fsw_iso9660_dnode **child_dno_out)
+{
+    fsw_status_t    status;
+    struct fsw_string host_name;
+    struct fsw_string *name = lookup_name;
+    struct fsw_iso9660_dir_entry *entry = NULL;
+    fsw_u32         hash, i;
+
+    // Preconditions: The caller has checked that dno is a directory node.
+
+    // read the whole directory once
+    if (dno->dir_buckets == NULL) {
+        status = fsw_iso9660_dir_index(vol, dno);
+        if (status)
+            return status;
+    }
+
+    // the index holds host strings
+    host_name.type = FSW_STRING_TYPE_EMPTY;
+    if (lookup_name->type != vol->g.host_string_type) {
+        status = fsw_strdup_coerce(&host_name, vol->g.host_string_type, lookup_name);
+        if (status)
+            return status;
+        name = &host_name;
+    }
+
+    // look for the file in its bucket
+    hash = fsw_iso9660_name_hash(name);
+    for (i = dno->dir_buckets[hash & dno->dir_bucket_mask]; i != ISO9660_DIR_INDEX_NIL; i = entry->next) {
+        entry = &dno->dir_index[i];
+        if (entry->hash == hash && fsw_streq(name, &entry->name))  // TODO: compare case-insensitively
+            break;
+    }
+
+    if (i == ISO9660_DIR_INDEX_NIL) {
+        status = FSW_NOT_FOUND;
+    } else {
+        // setup a dnode for the child item
+        status = fsw_dnode_create(dno, entry->ino, FSW_DNODE_TYPE_UNKNOWN, &entry->name, child_dno_out);
+        if (status == FSW_SUCCESS)
+            fsw_memcpy(&(*child_dno_out)->dirrec, &entry->dirrec, sizeof(struct iso9660_dirrec));
+    }
+
+    fsw_strfree(&host_name);
+    return status;
+}
+
+/**
+ * Hash a name of the directory index. Names are compared in the host string
+ * type, so hashing their bytes is enough.
+ */
+
+static fsw_u32 fsw_iso9660_name_hash(struct fsw_string *name)
+{
+    fsw_u8          *p = (fsw_u8 *)name->data;
+    fsw_u32         hash = 2166136261U;
+    int             i;
+
+    for (i = 0; i < name->size; i++)
+        hash = (hash ^ p[i]) * 16777619U;
+    return hash;
+}
+
+/**
+ * Read a directory once into its name index. Rock Ridge and Joliet names are
+ * resolved and converted to the host string type here, so lookups only hash
+ * and compare. Entries keep directory order within a bucket.
+ */
+
+static fsw_status_t fsw_iso9660_dir_index(struct fsw_iso9660_volume *vol, struct fsw_iso9660_dnode *dno)
 {
     fsw_status_t    status;
     struct fsw_shandle shand;
     struct iso9660_dirrec_buffer dirrec_buffer;
     struct iso9660_dirrec *dirrec = &dirrec_buffer.dirrec;
+    struct fsw_iso9660_dir_entry *entry, *entries = NULL;
+    fsw_u32         count = 0, size = 0, nbuckets, i;
+    fsw_u32         *buckets = NULL;
 
-    // Preconditions: The caller has checked that dno is a directory node.
-
-    // setup handle to read the directory
     status = fsw_shandle_open(dno, &shand);
     if (status)
         return status;
 
-    // scan the directory for the file
-    while (1) {
+    while (shand.pos < dno->g.size) {
         // read next entry
         status = fsw_iso9660_read_dirrec(vol, &shand, &dirrec_buffer);
         if (status)
             goto errorexit;
         if (dirrec->dirrec_length == 0) {
-            // end of directory reached
-            status = FSW_NOT_FOUND;
-            goto errorexit;
+            // records don't cross blocks, the rest of this one is padding
+            shand.pos = (shand.pos & ~(vol->g.log_blocksize - 1)) + vol->g.log_blocksize;
+            continue;
         }
 
         // skip . and ..
         if (dirrec->file_identifier_length == 1 &&
-            (dirrec->file_identifier[0] == 0 || dirrec->file_identifier[0] == 1))
-            continue;
+            (dirrec->file_identifier[0] == 0 || dirrec->file_identifier[0] == 1)) {
+            status = FSW_SUCCESS;
+        } else {
+            if (count == size) {
+                size = size ? size * 2 : 32;
+                status = fsw_alloc(size * sizeof(struct fsw_iso9660_dir_entry), &entry);
+                if (status)
+                    goto errorexit;
+                if (entries != NULL) {
+                    fsw_memcpy(entry, entries, count * sizeof(struct fsw_iso9660_dir_entry));
+                    fsw_free(entries);
+                }
+                entries = entry;
+            }
+            entry = &entries[count];
+            status = fsw_strdup_coerce(&entry->name, vol->g.host_string_type, &dirrec_buffer.name);
+            if (status == FSW_SUCCESS) {
+                entry->hash = fsw_iso9660_name_hash(&entry->name);
+                entry->ino = dirrec_buffer.ino;
+                fsw_memcpy(&entry->dirrec, dirrec, sizeof(struct iso9660_dirrec));
+                count++;
+            }
+        }
 
-        // compare name
-        if (fsw_streq(lookup_name, &dirrec_buffer.name))  // TODO: compare case-insensitively
-            break;
+        // Rock Ridge names are allocated by rr_find_nm
+        if (dirrec_buffer.name.data != NULL && dirrec_buffer.name.data != (void *)dirrec->file_identifier)
+            fsw_free(dirrec_buffer.name.data);
+        if (status)
+            goto errorexit;
     }
 
-    // setup a dnode for the child item
-    status = fsw_dnode_create(dno, dirrec_buffer.ino, FSW_DNODE_TYPE_UNKNOWN, &dirrec_buffer.name, child_dno_out);
-    if (status == FSW_SUCCESS)
-        fsw_memcpy(&(*child_dno_out)->dirrec, dirrec, sizeof(struct iso9660_dirrec));
+    for (nbuckets = 16; nbuckets < count; nbuckets <<= 1)
+        ;
+    status = fsw_alloc(nbuckets * sizeof(fsw_u32), &buckets);
+    if (status)
+        goto errorexit;
+    for (i = 0; i < nbuckets; i++)
+        buckets[i] = ISO9660_DIR_INDEX_NIL;
+    // link backwards so every bucket lists its entries in directory order
+    for (i = count; i-- > 0; ) {
+        entries[i].next = buckets[entries[i].hash & (nbuckets - 1)];
+        buckets[entries[i].hash & (nbuckets - 1)] = i;
+    }
+
+    dno->dir_index = entries;
+    dno->dir_index_count = count;
+    dno->dir_buckets = buckets;
+    dno->dir_bucket_mask = nbuckets - 1;
+    fsw_shandle_close(&shand);
+    return FSW_SUCCESS;
 
 errorexit:
+    for (i = 0; i < count; i++)
+        fsw_strfree(&entries[i].name);
+    if (entries != NULL)
+        fsw_free(entries);
     fsw_shandle_close(&shand);
     return status;
 }
 
+static void fsw_iso9660_dir_index_free(struct fsw_iso9660_dnode *dno)
+{
+    fsw_u32         i;
+
+    for (i = 0; i < dno->dir_index_count; i++)
+        fsw_strfree(&dno->dir_index[i].name);
+    if (dno->dir_index != NULL)
+        fsw_free(dno->dir_index);
+    if (dno->dir_buckets != NULL)
+        fsw_free(dno->dir_buckets);
+    dno->dir_index = NULL;
+    dno->dir_index_count = 0;
+    dno->dir_buckets = NULL;
+}
+
 /**
  * Get the next directory entry when reading a directory. This function is called during
  * directory iteration to retrieve the next directory entry. A dnode is constructed for
@@ -160,10 +160,29 @@ struct fsw_iso9660_volume {
  * ISO9660: Dnode structure with ISO9660-specific data.
  */
 
+/**
+ * ISO9660: One entry of a directory's name index.
+ */
+
+struct fsw_iso9660_dir_entry {
+    fsw_u32     hash;               //!< Hash of name
+    fsw_u32     next;               //!< Next entry in the same bucket, or ISO9660_DIR_INDEX_NIL
+    fsw_u32     ino;                //!< Inode number as returned by fsw_iso9660_read_dirrec
+    struct fsw_string name;         //!< Final name (Rock Ridge, Joliet or plain) in host string type
+    struct iso9660_dirrec dirrec;   //!< Fixed part of the directory record
+};
+
+#define ISO9660_DIR_INDEX_NIL      0xFFFFFFFF
+
 struct fsw_iso9660_dnode {
     struct fsw_dnode g;             //!< Generic dnode structure
 
     struct iso9660_dirrec dirrec;   //!< Fixed part of the directory record (i.e. w/o name)
+
+    struct fsw_iso9660_dir_entry *dir_index;  //!< Directory entries, built on first lookup
+    fsw_u32     dir_index_count;    //!< Number of entries in dir_index
+    fsw_u32     *dir_buckets;       //!< Hash heads into dir_index
+    fsw_u32     dir_bucket_mask;    //!< Number of buckets - 1
 };
 
 
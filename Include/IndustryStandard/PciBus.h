@@ -33,6 +33,7 @@ Revision History
 #include <Protocol/UgaIo.h>
 #include <Protocol/LoadedImage.h>
 #include <Protocol/BusSpecificDriverOverride.h>
+#include <Protocol/PciDeviceInfo.h>
 
 #include <Guid/PciOptionRomTable.h>
 
@@ -184,6 +185,11 @@ typedef struct _PCI_IO_DEVICE {
 
   BOOLEAN                                   IsPciExp;
 
+  //
+  // Published with PciIo so that consumers don't have to read the header again
+  //
+  PCI_DEVICE_INFO_PROTOCOL                  DeviceInfo;
+
 } PCI_IO_DEVICE;
 
 
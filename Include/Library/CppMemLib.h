@@ -0,0 +1,66 @@
+/** @file
+    Small-object allocator behind the C++ operator new and delete.
+
+    Blocks up to CPP_MEM_MAX_SMALL bytes are taken from size classes, each class carving its
+    blocks from chunks of CPP_MEM_CHUNK_PAGES pages. A freed block goes back to the free list of
+    its class and the chunks are never given back. Bigger blocks, and all blocks once the chunk
+    table is full, go to AllocatePool.
+**/
+
+#ifndef __CPP_MEM_LIB_H__
+#define __CPP_MEM_LIB_H__
+
+#define CPP_MEM_CLASS_COUNT   16
+#define CPP_MEM_MAX_SMALL     4096
+#define CPP_MEM_CHUNK_PAGES   16
+#define CPP_MEM_MAX_CHUNKS    1024
+
+typedef struct {
+  UINT32  BlockSize;
+  UINT32  Chunks;
+  UINT64  Allocs;
+  UINT64  Frees;
+  UINT64  InUse;
+  UINT64  PeakInUse;
+} CPP_MEM_CLASS_STATS;
+
+typedef struct {
+  CPP_MEM_CLASS_STATS Class[CPP_MEM_CLASS_COUNT];
+  UINT64              LargeAllocs;    // AllocatePool, too big or no chunk
+  UINT64              LargeFrees;
+  UINT32              Chunks;
+} CPP_MEM_STATS;
+
+/**
+  Allocates Size bytes, 16 bytes aligned if they are in a size class.
+
+  @return NULL if there is no memory.
+**/
+VOID*
+CppMemAllocate (
+  IN UINTN  Size
+  );
+
+/**
+  Frees a block from CppMemAllocate(). A block from AllocatePool is given to FreePool.
+  Does nothing if Buffer is NULL.
+**/
+VOID
+CppMemFree (
+  IN VOID   *Buffer
+  );
+
+/**
+  TRUE if Buffer is a block of a size class.
+**/
+BOOLEAN
+CppMemIsSmall (
+  IN CONST VOID  *Buffer
+  );
+
+VOID
+CppMemGetStats (
+  OUT CPP_MEM_STATS  *Stats
+  );
+
+#endif
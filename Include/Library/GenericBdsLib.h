@@ -377,6 +377,26 @@ BdsLibConnectAllDriversToAllControllers (
   VOID
   );
 
+/**
+  This function starts the timer connecting the controllers left by Boot/DeferConnect or Boot/LazyConnect.
+
+**/
+VOID
+EFIAPI
+BdsLibStartDeferredConnect (
+  VOID
+  );
+
+/**
+  This function connects the controllers left by Boot/DeferConnect that are not connected yet.
+
+**/
+VOID
+EFIAPI
+BdsLibConnectDeferred (
+  VOID
+  );
+
 /**
   This function connects all system drivers to controllers.
 
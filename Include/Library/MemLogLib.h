@@ -12,6 +12,28 @@
 #define MEM_LOG_INITIAL_SIZE    (128 * 1024)
 #define MEM_LOG_MAX_SIZE        (2 * 1024 * 1024)
 #define MEM_LOG_MAX_LINE_SIZE   1024
+// Ring for messages logged from APs, drained into the mem log by the BSP
+#define MEM_LOG_AP_RING_SIZE      (64 * 1024) // power of 2
+#define MEM_LOG_AP_MAX_LINE_SIZE  256
+// Index of phase markers, one entry per MemLogMarkPhase()
+#define MEM_LOG_MAX_PHASES        64
+#define MEM_LOG_PHASE_NAME_SIZE   28
+
+typedef struct {
+  UINT32  Offset;                         // log offset where the phase starts
+  CHAR8   Name[MEM_LOG_PHASE_NAME_SIZE];  // zero terminated, cut if longer
+} MEM_LOG_PHASE;
+
+//
+// Compressed log : MEM_LOG_LZSS_HEADER followed by LZSS data (N=4096, F=18, threshold 2,
+// ring initialised with spaces), the same encoding as the one of Apple compressed kernelcaches.
+//
+#define MEM_LOG_LZSS_SIGNATURE    SIGNATURE_32 ('l', 'z', 's', 's')
+
+typedef struct {
+  UINT32  Signature;
+  UINT32  Length;                         // uncompressed length
+} MEM_LOG_LZSS_HEADER;
 
 
 /** Callback that can be installed to be called when some message is printed with MemLog() or MemLogVA(). **/
@@ -151,7 +173,90 @@ MemLogf (
   ...
   ) __attribute__((format(printf, 3, 4)));
 
+/**
+  Logs a message from an AP (or the BSP). No boot services, no allocation : the message is formatted on the stack,
+  then copied in a ring where the space is reserved with an atomic compare-exchange.
+  If the ring is full, the message is dropped and counted. MemLogDrainAp() reports the count.
+  Messages are cut at MEM_LOG_AP_MAX_LINE_SIZE-1 chars.
+
+  @param  Format      The format string for the debug message to print.
+  @param  Marker      VA_LIST with variable arguments for Format.
+**/
+VOID
+EFIAPI
+MemLogApfVA (
+  IN  CONST CHAR8   *Format,
+  IN  VA_LIST       Marker
+  );
+
+VOID
+EFIAPI
+MemLogApf (
+  IN  CONST CHAR8   *Format,
+  ...
+  ) __attribute__((format(printf, 1, 2)));
+
+/**
+  Moves the committed AP messages to the mem log, in reservation order. BSP only.
+  Called before the log is read (debug log file, boot-log) and after parallel work.
+**/
+VOID
+EFIAPI
+MemLogDrainAp (
+  VOID
+  );
+
+/**
+  Returns the part of the log written since Offset, without copying it.
+  A tool can keep the returned length added to Offset as its cursor and only fetch what is new next time.
+
+  @param  Offset      Offset in the log, as returned by GetMemLogLen() or a phase marker.
+  @param  Chunk       Receives a pointer to the log at Offset.
+
+  @return Number of chars from Offset to the end of log, 0 if Offset is past it.
+**/
+UINTN
+EFIAPI
+GetMemLogChunk (
+  IN  UINTN         Offset,
+  OUT CONST CHAR8   **Chunk
+  );
 
+/**
+  Records the current end of log as the start of phase Name. Markers past MEM_LOG_MAX_PHASES are ignored.
+**/
+VOID
+EFIAPI
+MemLogMarkPhase (
+  IN  CONST CHAR8   *Name
+  );
+
+/**
+  Returns the phase markers, in log order.
+
+  @param  Phases      Receives a pointer to the index.
+
+  @return Number of markers.
+**/
+UINTN
+EFIAPI
+GetMemLogPhases (
+  OUT CONST MEM_LOG_PHASE **Phases
+  );
+
+/**
+  Compresses Length chars of Log into Buffer : a MEM_LOG_LZSS_HEADER then the LZSS data.
+
+  @return Size written to Buffer, 0 if it doesn't fit in BufferSize or memory is missing.
+**/
+UINTN
+EFIAPI
+MemLogCompress (
+  IN  CONST CHAR8   *Log,
+  IN  UINTN         Length,
+  OUT UINT8         *Buffer,
+  IN  UINTN         BufferSize
+  );
 
 
 #endif // __MEMLOG_LIB_H__
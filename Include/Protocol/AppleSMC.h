@@ -161,6 +161,26 @@ IN   SMC_KEY_ATTRIBUTES     Attributes
 );
 
 
+// SMC_KEY_RECORD
+/// One key for SmcAddKeys: the key is added and, when Data is not NULL, its value written
+typedef struct {
+  SMC_KEY             Key;
+  SMC_DATA_SIZE       Size;
+  SMC_KEY_TYPE        Type;
+  SMC_KEY_ATTRIBUTES  Attributes;
+  CONST SMC_DATA      *Data;
+} SMC_KEY_RECORD;
+
+// SMC_IO_SMC_ADD_KEYS
+// Clover SMCHelper only (Signature == NON_APPLE_SMC_SIGNATURE)
+typedef
+EFI_STATUS
+(EFIAPI *SMC_IO_SMC_ADD_KEYS)(
+IN   APPLE_SMC_IO_PROTOCOL  *This,
+IN   UINTN                  Count,
+IN   CONST SMC_KEY_RECORD   *Records
+);
+
 // SMC_IO_SMC_GET_KEY_FROM_INDEX
 typedef
 EFI_STATUS
@@ -282,6 +302,7 @@ struct _APPLE_SMC_IO_PROTOCOL {
   SMC_INDEX                     Index;               ///<
   SMC_ADDRESS                   Address;             ///<
   BOOLEAN                       Mmio;                ///<
+  SMC_IO_SMC_ADD_KEYS           SmcAddKeys;          ///< SMCHelper only, see above
 /*  SMC_IO_SMC_UNKNOWN_1          SmcUnknown1;         ///<
   SMC_IO_SMC_UNKNOWN_2          SmcUnknown2;         ///<
   SMC_IO_SMC_UNKNOWN_3          SmcUnknown3;         ///<
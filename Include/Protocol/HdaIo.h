@@ -153,6 +153,28 @@ EFI_STATUS
     IN EFI_HDA_IO_PROTOCOL *This,
     IN EFI_HDA_IO_PROTOCOL_TYPE Type);
 
+/**
+  Sets the format of the buffers given to StartStream() when it isn't the stream format
+  (call it after SetupStream()). The samples are then converted block by block while streaming.
+
+  @param[in] This               A pointer to the HDA_IO_PROTOCOL instance.
+  @param[in] Type               The stream type, only output streams are converted.
+  @param[in] Rate               The sample rate of the source in Hz.
+  @param[in] Bits               The sample size of the source: 8, 16, 20, 24 (packed in 3 bytes) or 32.
+  @param[in] Channels           The number of channels of the source.
+
+  @retval EFI_SUCCESS           The source format was set.
+  @retval EFI_UNSUPPORTED       The source can't be converted to the stream format.
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EFI_HDA_IO_SET_STREAM_SOURCE)(
+    IN EFI_HDA_IO_PROTOCOL *This,
+    IN EFI_HDA_IO_PROTOCOL_TYPE Type,
+    IN UINT32 Rate,
+    IN UINT8 Bits,
+    IN UINT8 Channels);
+
 // HDA I/O protocol structure.
 struct _EFI_HDA_IO_PROTOCOL {
     EFI_HDA_IO_GET_ADDRESS      GetAddress;
@@ -163,6 +185,7 @@ struct _EFI_HDA_IO_PROTOCOL {
     EFI_HDA_IO_GET_STREAM       GetStream;
     EFI_HDA_IO_START_STREAM     StartStream;
     EFI_HDA_IO_STOP_STREAM      StopStream;
+    EFI_HDA_IO_SET_STREAM_SOURCE SetStreamSource;
 };
 
 //
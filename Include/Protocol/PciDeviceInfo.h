@@ -0,0 +1,55 @@
+/** @file
+
+Module Name:
+
+  PciDeviceInfo.h
+
+  Read-only description of a PCI function, installed by the DUET PCI bus driver
+  next to PciIo on every handle it creates : location, config header and
+  capability list as read during enumeration, so consumers need no config cycles.
+
+**/
+
+#ifndef __PciDeviceInfo_H__
+#define __PciDeviceInfo_H__
+
+#include <IndustryStandard/Pci.h>
+
+#define PCI_DEVICE_INFO_PROTOCOL_REVISION  1
+#define PCI_DEVICE_INFO_MAX_CAPS           16
+
+/**
+ * PCI_DEVICE_INFO_PROTOCOL
+ */
+typedef struct {
+    ///
+    /// PCI_DEVICE_INFO_PROTOCOL_REVISION
+    ///
+    UINT32          Revision;
+    UINT32          Segment;
+    UINT8           Bus;
+    UINT8           Device;
+    UINT8           Function;
+    ///
+    /// Number of valid entries in CapId/CapOffset, in list order
+    ///
+    UINT8           CapCount;
+    UINT8           CapId[PCI_DEVICE_INFO_MAX_CAPS];
+    UINT8           CapOffset[PCI_DEVICE_INFO_MAX_CAPS];
+    ///
+    /// Config space 0x00-0x3F as read during enumeration
+    ///
+    PCI_TYPE00      Pci;
+} PCI_DEVICE_INFO_PROTOCOL;
+
+
+#define PCI_DEVICE_INFO_PROTOCOL_GUID \
+  { \
+    0xbee5670c, 0x3797, 0x4fef, {0x85, 0xca, 0xe8, 0x88, 0x62, 0x21, 0x52, 0x55 } \
+  }
+
+/** PCI_DEVICE_INFO_PROTOCOL GUID */
+extern EFI_GUID gPciDeviceInfoProtocolGuid;
+
+
+#endif
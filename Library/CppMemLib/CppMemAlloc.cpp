@@ -0,0 +1,201 @@
+//
+//  CppMemAlloc.cpp
+//
+//  Size classes for operator new. A chunk belongs to one class, its blocks are handed out
+//  in order, then the freed ones are reused from the free list of the class.
+//  The chunk table is sorted by address, so a free finds its chunk with a binary search.
+//
+
+extern "C" {
+#include <Uefi.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/CppMemLib.h>
+}
+
+#define CPP_MEM_CHUNK_SIZE  EFI_PAGES_TO_SIZE(CPP_MEM_CHUNK_PAGES)
+
+static CONST UINT32 mBlockSizes[CPP_MEM_CLASS_COUNT] = {
+  16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096
+};
+
+typedef struct CPP_MEM_FREE_BLOCK {
+  struct CPP_MEM_FREE_BLOCK  *Next;
+} CPP_MEM_FREE_BLOCK;
+
+typedef struct {
+  CPP_MEM_FREE_BLOCK  *FreeList;
+  UINT8               *Next;      // never used blocks of the last chunk
+  UINT8               *End;
+} CPP_MEM_CLASS;
+
+static CPP_MEM_CLASS  mClasses[CPP_MEM_CLASS_COUNT];
+static UINTN          mChunkBase[CPP_MEM_MAX_CHUNKS];   // sorted
+static UINT8          mChunkClass[CPP_MEM_MAX_CHUNKS];
+static UINTN          mChunkCount = 0;
+static UINT8          mClassOf[CPP_MEM_MAX_SMALL / 16 + 1];  // by (Size + 15) / 16
+static BOOLEAN        mClassOfReady = FALSE;
+static CPP_MEM_STATS  mStats;
+
+static UINTN ClassOf(UINTN Size)
+{
+  UINTN Class = 0;
+  UINTN Index;
+
+  if (!mClassOfReady) {
+    for (Index = 0; Index <= CPP_MEM_MAX_SMALL / 16; Index++) {
+      while (mBlockSizes[Class] < Index * 16) {
+        Class++;
+      }
+      mClassOf[Index] = (UINT8)Class;
+    }
+    for (Class = 0; Class < CPP_MEM_CLASS_COUNT; Class++) {
+      mStats.Class[Class].BlockSize = mBlockSizes[Class];
+    }
+    mClassOfReady = TRUE;
+  }
+  return mClassOf[(Size + 15) / 16];
+}
+
+// index of the chunk holding Buffer, mChunkCount if none
+static UINTN FindChunk(CONST VOID *Buffer)
+{
+  UINTN Address = (UINTN)Buffer;
+  UINTN Lo = 0;
+  UINTN Hi = mChunkCount;
+  UINTN Mid;
+
+  while (Lo < Hi) {
+    Mid = (Lo + Hi) / 2;
+    if (mChunkBase[Mid] <= Address) {
+      Lo = Mid + 1;
+    } else {
+      Hi = Mid;
+    }
+  }
+  if (Lo == 0 || Address - mChunkBase[Lo - 1] >= CPP_MEM_CHUNK_SIZE) {
+    return mChunkCount;
+  }
+  return Lo - 1;
+}
+
+static BOOLEAN AddChunk(UINTN Class)
+{
+  UINT8 *Chunk;
+  UINTN Index;
+
+  if (mChunkCount >= CPP_MEM_MAX_CHUNKS) {
+    return FALSE;
+  }
+  Chunk = (UINT8 *)AllocatePages(CPP_MEM_CHUNK_PAGES);
+  if (Chunk == NULL) {
+    return FALSE;
+  }
+  Index = mChunkCount;
+  while (Index > 0 && mChunkBase[Index - 1] > (UINTN)Chunk) {
+    mChunkBase[Index] = mChunkBase[Index - 1];
+    mChunkClass[Index] = mChunkClass[Index - 1];
+    Index--;
+  }
+  mChunkBase[Index] = (UINTN)Chunk;
+  mChunkClass[Index] = (UINT8)Class;
+  mChunkCount++;
+
+  mClasses[Class].Next = Chunk;
+  mClasses[Class].End = Chunk + CPP_MEM_CHUNK_SIZE - CPP_MEM_CHUNK_SIZE % mBlockSizes[Class];
+  mStats.Class[Class].Chunks++;
+  mStats.Chunks++;
+  return TRUE;
+}
+
+VOID*
+CppMemAllocate (
+  IN UINTN  Size
+  )
+{
+  CPP_MEM_CLASS       *Pool;
+  CPP_MEM_CLASS_STATS *Stats;
+  VOID                *Buffer = NULL;
+  UINTN               Class;
+  EFI_TPL             OldTpl;
+
+  if (Size <= CPP_MEM_MAX_SMALL) {
+    OldTpl = gBS->RaiseTPL(TPL_NOTIFY);
+    Class = ClassOf(Size);
+    Pool = &mClasses[Class];
+    if (Pool->FreeList != NULL) {
+      Buffer = Pool->FreeList;
+      Pool->FreeList = Pool->FreeList->Next;
+    } else if (Pool->Next < Pool->End || AddChunk(Class)) {
+      Buffer = Pool->Next;
+      Pool->Next += mBlockSizes[Class];
+    }
+    if (Buffer != NULL) {
+      Stats = &mStats.Class[Class];
+      Stats->Allocs++;
+      if (++Stats->InUse > Stats->PeakInUse) {
+        Stats->PeakInUse = Stats->InUse;
+      }
+    }
+    gBS->RestoreTPL(OldTpl);
+    if (Buffer != NULL) {
+      return Buffer;
+    }
+  }
+  Buffer = AllocatePool(Size);
+  if (Buffer != NULL) {
+    mStats.LargeAllocs++;
+  }
+  return Buffer;
+}
+
+VOID
+CppMemFree (
+  IN VOID   *Buffer
+  )
+{
+  CPP_MEM_FREE_BLOCK  *Block;
+  UINTN               Chunk;
+  UINTN               Class;
+  EFI_TPL             OldTpl;
+
+  if (Buffer == NULL) {
+    return;
+  }
+  OldTpl = gBS->RaiseTPL(TPL_NOTIFY);
+  Chunk = FindChunk(Buffer);
+  if (Chunk < mChunkCount) {
+    Class = mChunkClass[Chunk];
+    if (((UINTN)Buffer - mChunkBase[Chunk]) % mBlockSizes[Class] == 0) {
+      Block = (CPP_MEM_FREE_BLOCK *)Buffer;
+      Block->Next = mClasses[Class].FreeList;
+      mClasses[Class].FreeList = Block;
+      mStats.Class[Class].Frees++;
+      mStats.Class[Class].InUse--;
+    }
+    //else not a block, do nothing rather than break the free list
+    gBS->RestoreTPL(OldTpl);
+    return;
+  }
+  gBS->RestoreTPL(OldTpl);
+  mStats.LargeFrees++;
+  FreePool(Buffer);
+}
+
+BOOLEAN
+CppMemIsSmall (
+  IN CONST VOID  *Buffer
+  )
+{
+  return Buffer != NULL && FindChunk(Buffer) < mChunkCount;
+}
+
+VOID
+CppMemGetStats (
+  OUT CPP_MEM_STATS  *Stats
+  )
+{
+  ClassOf(0); // block sizes
+  CopyMem(Stats, &mStats, sizeof(mStats));
+}
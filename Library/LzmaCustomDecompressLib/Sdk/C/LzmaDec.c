@@ -196,7 +196,18 @@ static int MY_FAST_CALL LzmaDec_DecodeReal(CLzmaDec *p, SizeT limit, const Byte
       {
         state -= (state < 4) ? state : 3;
         symbol = 1;
+        #ifdef _LZMA_SIZE_OPT
         do { GET_BIT(prob + symbol, symbol) } while (symbol < 0x100);
+        #else
+        GET_BIT(prob + symbol, symbol)
+        GET_BIT(prob + symbol, symbol)
+        GET_BIT(prob + symbol, symbol)
+        GET_BIT(prob + symbol, symbol)
+        GET_BIT(prob + symbol, symbol)
+        GET_BIT(prob + symbol, symbol)
+        GET_BIT(prob + symbol, symbol)
+        GET_BIT(prob + symbol, symbol)
+        #endif
       }
       else
       {
@@ -420,9 +431,16 @@ static int MY_FAST_CALL LzmaDec_DecodeReal(CLzmaDec *p, SizeT limit, const Byte
           ptrdiff_t src = (ptrdiff_t)pos - (ptrdiff_t)dicPos;
           const Byte *lim = dest + curLen;
           dicPos += curLen;
-          do
+          #if defined(MDE_CPU_X64) || defined(MDE_CPU_IA32)
+          /* x86: a word at once while the source is at least a word behind */
+          if (src <= -(ptrdiff_t)sizeof(SizeT))
+          {
+            for (; lim - dest >= (ptrdiff_t)sizeof(SizeT); dest += sizeof(SizeT))
+              *((volatile SizeT *)dest) = *(const SizeT *)(dest + src);
+          }
+          #endif
+          for (; dest != lim; dest++)
             *((volatile Byte *)dest) = (Byte)*(dest + src);
-          while (++dest != lim);
         }
         else
         {
@@ -8,6 +8,7 @@
 #include <Library/BaseMemoryLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiRuntimeServicesTableLib.h>
 #include <Library/MemLogLib.h>
 #include <Library/DebugLib.h>
 #include <Library/SerialPortLib.h>
@@ -15,9 +16,26 @@
 
 #include <Library/IoLib.h>
 #include <Library/PciLib.h>
+#include <Library/SynchronizationLib.h>
 #include "GenericIch.h"
 
 #include <Library/printf_lite.h>
+
+//
+// Ring for AP messages. Head and Tail are byte counters that only grow, the position in Data is the counter modulo the size.
+// Each record is a UINT32 header followed by the text, padded to 4 bytes. The header is 0 while the producer writes,
+// then length | MEM_LOG_AP_RECORD_COMMITTED. The drain clears it before giving the space back.
+//
+#define MEM_LOG_AP_RECORD_COMMITTED  0x80000000
+
+typedef struct {
+  volatile UINT32   Head;     // reserved by producers
+  volatile UINT32   Tail;     // given back by the drain
+  volatile UINT32   Dropped;  // messages that didn't fit since the last drain
+  UINT32            Reserved;
+  CHAR8             Data[MEM_LOG_AP_RING_SIZE];
+} MEM_LOG_AP_RING;
+
 //
 // Struct for holding mem buffer.
 //
@@ -33,6 +51,11 @@ typedef struct {
   UINT64            TscLast;
   /// TSC ticks per second.
   UINT64            TscFreqSec;
+  /// Messages from APs, waiting for MemLogDrainAp().
+  MEM_LOG_AP_RING   *ApRing;
+  /// Phase markers, see MemLogMarkPhase().
+  UINTN             PhaseCount;
+  MEM_LOG_PHASE     Phases[MEM_LOG_MAX_PHASES];
 } MEM_LOG;
 
 
@@ -89,6 +112,126 @@ GetTiming(VOID)
 
 
 
+//
+// TSC frequency measured at a previous boot, variable MEM_LOG_TSC_VARIABLE of mMemLogProtocolGuid.
+// Valid for the same CPU signature and microcode revision.
+//
+#define MEM_LOG_TSC_VARIABLE   L"MemLogTscFreq"
+#define CPUID_VENDOR_INTEL     0x756E6547 // "Genu"
+#define MSR_BIOS_SIGN_ID       0x8B
+
+typedef struct {
+  UINT32            Signature;
+  UINT32            MicroCode;
+  UINT64            TscFreqSec;
+} MEM_LOG_TSC_CACHE;
+
+/**
+  Measures TSC ticks per second during Ms milliseconds, with the ACPI PM Timer at TimerAddr, or gBS->Stall() if TimerAddr is 0.
+**/
+STATIC
+UINT64
+MeasureTscFrequency (
+  IN  UINT32  TimerAddr,
+  IN  UINT32  Ms,
+  OUT UINT64  *TscStart
+  )
+{
+  UINT64          Tsc0, Tsc1;
+  UINT32          AcpiTick0, AcpiTick1, AcpiTicksDelta, AcpiTicksTarget;
+
+  if (TimerAddr == 0) {
+    Tsc0 = AsmReadTsc();
+    gBS->Stall(Ms * 1000);
+    Tsc1 = AsmReadTsc();
+    *TscStart = Tsc0;
+    return DivU64x32(MultU64x32((Tsc1 - Tsc0), 1000), Ms);
+  }
+
+  // ACPI PM timers are usually of 24-bit length, but there are some less common cases of 32-bit length also. When the maximal number is reached, it overflows.
+  // The code below can handle overflow with AcpiTicksTarget of up to 24-bit size, on both available sizes of ACPI PM Timers (24-bit and 32-bit).
+
+  AcpiTicksTarget = (UINT32)DivU64x32(MultU64x32(V_ACPI_TMR_FREQUENCY, Ms), 1000); // 357954 clocks of ACPI timer for 100ms
+
+  AcpiTick0 = IoRead32 (TimerAddr); // read ACPI tick
+  Tsc0 = AsmReadTsc(); // read TSC
+  do {
+    CpuPause();
+    // check how many AcpiTicks passed since we started
+    AcpiTick1 = IoRead32 (TimerAddr);
+    if (AcpiTick0 <= AcpiTick1) { // no overflow
+      AcpiTicksDelta = AcpiTick1 - AcpiTick0;
+    } else if (AcpiTick0 - AcpiTick1 <= 0x00FFFFFF) { // overflow, 24-bit timer
+      AcpiTicksDelta = (0x00FFFFFF - AcpiTick0) + AcpiTick1;
+    } else { // overflow, 32-bit timer
+      AcpiTicksDelta = (0xFFFFFFFF - AcpiTick0) + AcpiTick1;
+    }
+  } while (AcpiTicksDelta < AcpiTicksTarget); // keep checking Acpi ticks until target is reached
+  Tsc1 = AsmReadTsc(); // we're done, get another TSC
+  *TscStart = Tsc0;
+  return DivU64x32(MultU64x32((Tsc1 - Tsc0), V_ACPI_TMR_FREQUENCY), AcpiTicksDelta);
+}
+
+/**
+  TSC ticks per second without measuring : the value kept at a previous boot, else CPUID 0x15 (crystal clock
+  and TSC ratio), else CPUID 0x16 (base frequency). 0 if none is there. Fills Key for SaveTscFrequency().
+**/
+STATIC
+UINT64
+KnownTscFrequency (
+  OUT MEM_LOG_TSC_CACHE  *Key,
+  OUT CONST CHAR8        **Source
+  )
+{
+  MEM_LOG_TSC_CACHE  Cache;
+  UINTN              Size = sizeof (Cache);
+  UINT32             MaxLeaf, Vendor, Eax, Ebx, Ecx;
+
+  AsmCpuid (0, &MaxLeaf, &Vendor, NULL, NULL);
+  if (Vendor == CPUID_VENDOR_INTEL) {
+    AsmWriteMsr64 (MSR_BIOS_SIGN_ID, 0); // the microcode revision is loaded by CPUID 1
+  }
+  AsmCpuid (1, &Key->Signature, NULL, NULL, NULL);
+  Key->MicroCode = Vendor == CPUID_VENDOR_INTEL ? (UINT32)RShiftU64 (AsmReadMsr64 (MSR_BIOS_SIGN_ID), 32) : 0;
+  Key->TscFreqSec = 0;
+
+  if (!EFI_ERROR (gRT->GetVariable (MEM_LOG_TSC_VARIABLE, &mMemLogProtocolGuid, NULL, &Size, &Cache)) && Size == sizeof (Cache) &&
+      Cache.Signature == Key->Signature && Cache.MicroCode == Key->MicroCode && Cache.TscFreqSec != 0) {
+    *Source = "previous boot";
+    return Cache.TscFreqSec;
+  }
+  if (Vendor == CPUID_VENDOR_INTEL && MaxLeaf >= 0x15) {
+    AsmCpuid (0x15, &Eax, &Ebx, &Ecx, NULL);
+    if (Eax != 0 && Ebx != 0 && Ecx != 0) {
+      *Source = "CPUID 0x15";
+      return DivU64x32 (MultU64x32 (Ecx, Ebx), Eax);
+    }
+    if (MaxLeaf >= 0x16) {
+      AsmCpuid (0x16, &Eax, NULL, NULL, NULL);
+      if ((Eax & 0xFFFF) != 0) {
+        *Source = "CPUID 0x16";
+        return MultU64x32 (1000000, Eax & 0xFFFF); // MHz
+      }
+    }
+  }
+  return 0;
+}
+
+/**
+  Keeps a measured frequency for the next boots, written only after a full measurement.
+**/
+STATIC
+VOID
+SaveTscFrequency (
+  IN OUT MEM_LOG_TSC_CACHE  *Key,
+  IN     UINT64             TscFreqSec
+  )
+{
+  Key->TscFreqSec = TscFreqSec;
+  gRT->SetVariable (MEM_LOG_TSC_VARIABLE, &mMemLogProtocolGuid,
+                    EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS, sizeof (*Key), Key);
+}
+
 /**
   Inits mem log.
 
@@ -103,9 +246,12 @@ MemLogInit (
 {
   EFI_STATUS      Status;
   UINT32          TimerAddr = 0;
-  UINT64          Tsc0, Tsc1;
-  UINT32          AcpiTick0, AcpiTick1, AcpiTicksDelta, AcpiTicksTarget;
+  UINT64          Tsc0;
+  UINT32          AcpiTick0, AcpiTick1;
   CHAR8           InitError[50];
+  MEM_LOG_TSC_CACHE  TscCache;
+  CONST CHAR8     *TscSource = NULL;
+  UINT64          TscFreqKnown, TscFreqCheck, TscDelta;
   
   if (mMemLog != NULL) {
     return  EFI_SUCCESS;
@@ -133,6 +279,7 @@ MemLogInit (
   mMemLog->Buffer = AllocateZeroPool(MEM_LOG_INITIAL_SIZE);
   mMemLog->Cursor = mMemLog->Buffer;
   mMemLog->Callback = NULL;
+  mMemLog->ApRing = AllocateZeroPool(sizeof (MEM_LOG_AP_RING));
   
   //
   // Calibrate TSC for timings
@@ -166,36 +313,23 @@ MemLogInit (
     }
   }
 
-  // We prefer to use the ACPI PM Timer when possible. If it is not available we fallback to old method.
-  if (TimerAddr != 0) { // ACPI PM Timer seems to be working
-
-    // ACPI PM timers are usually of 24-bit length, but there are some less common cases of 32-bit length also. When the maximal number is reached, it overflows.
-    // The code below can handle overflow with AcpiTicksTarget of up to 24-bit size, on both available sizes of ACPI PM Timers (24-bit and 32-bit).
-
-    AcpiTicksTarget = V_ACPI_TMR_FREQUENCY/10; // 357954 clocks of ACPI timer (100ms)
-
-    AcpiTick0 = IoRead32 (TimerAddr); // read ACPI tick
-    Tsc0 = AsmReadTsc(); // read TSC
-    do {
-      CpuPause();
-      // check how many AcpiTicks passed since we started
-      AcpiTick1 = IoRead32 (TimerAddr);
-      if (AcpiTick0 <= AcpiTick1) { // no overflow
-        AcpiTicksDelta = AcpiTick1 - AcpiTick0;
-      } else if (AcpiTick0 - AcpiTick1 <= 0x00FFFFFF) { // overflow, 24-bit timer
-        AcpiTicksDelta = (0x00FFFFFF - AcpiTick0) + AcpiTick1;
-      } else { // overflow, 32-bit timer
-        AcpiTicksDelta = (0xFFFFFFFF - AcpiTick0) + AcpiTick1;
-      }
-    } while (AcpiTicksDelta < AcpiTicksTarget); // keep checking Acpi ticks until target is reached
-    Tsc1 = AsmReadTsc(); // we're done, get another TSC
-    mMemLog->TscFreqSec = DivU64x32(MultU64x32((Tsc1 - Tsc0), V_ACPI_TMR_FREQUENCY), AcpiTicksDelta);
-  } else { 
-    // ACPI PM Timer is not working, fallback to old method
-    Tsc0 = AsmReadTsc();
-    gBS->Stall(100000); // 100ms
-    Tsc1 = AsmReadTsc();
-    mMemLog->TscFreqSec = MultU64x32((Tsc1 - Tsc0), 10);
+  // A known frequency is only checked during 10ms, against the ACPI PM Timer when possible. The full 100ms
+  // measurement is done when there is none, or when it is off (BCLK overclocking, hypervisors), and is then kept.
+  TscFreqKnown = KnownTscFrequency(&TscCache, &TscSource);
+  if (TscFreqKnown != 0) {
+    TscFreqCheck = MeasureTscFrequency(TimerAddr, 10, &Tsc0);
+    TscDelta = TscFreqCheck > TscFreqKnown ? TscFreqCheck - TscFreqKnown : TscFreqKnown - TscFreqCheck;
+    if (MultU64x32(TscDelta, TimerAddr != 0 ? 200 : 50) > TscFreqKnown) { // 0.5%, 2% with Stall()
+      MemLogf(TRUE, 1, "TSC freq from %s is off: %lld, measured %lld\n", TscSource, TscFreqKnown, TscFreqCheck);
+      TscFreqKnown = 0;
+    }
+  }
+  if (TscFreqKnown != 0) {
+    mMemLog->TscFreqSec = TscFreqKnown;
+  } else {
+    // We prefer to use the ACPI PM Timer when possible. If it is not available we fallback to old method.
+    mMemLog->TscFreqSec = MeasureTscFrequency(TimerAddr, 100, &Tsc0);
+    SaveTscFrequency(&TscCache, mMemLog->TscFreqSec);
   }
   mMemLog->TscStart = Tsc0;
   mMemLog->TscLast = Tsc0;
@@ -210,7 +344,9 @@ MemLogInit (
                                                    NULL
                                                    );
   MemLogf(TRUE, 1, "MemLog inited, TSC freq: %lld\n", mMemLog->TscFreqSec);
-  if (InitError[0] != '\0') {
+  if (TscFreqKnown != 0) {
+    MemLogf(TRUE, 1, "CPU TSC freq from %s, checked with %s\n", TscSource, InitError[0] != '\0' ? "RTC" : "ACPI PM Timer");
+  } else if (InitError[0] != '\0') {
     MemLogf(TRUE, 1, "CPU was calibrated with RTC\n");
   } else {
     MemLogf(TRUE, 1, "CPU was calibrated with ACPI PM Timer\n");
@@ -596,3 +732,304 @@ MemLogf (
   MemLogfVA (Timing, DebugMode, Format, Marker);
   VA_END (Marker);
 }
+
+#define MEM_LOG_AP_RECORD_SIZE(Len)  ALIGN_VALUE (sizeof (UINT32) + (Len), sizeof (UINT32))
+
+STATIC
+VOID
+ApRingCopyIn (
+  IN  MEM_LOG_AP_RING *Ring,
+  IN  UINT32          Pos,
+  IN  CONST CHAR8     *Src,
+  IN  UINT32          Len
+  )
+{
+  UINT32 Offset = Pos & (MEM_LOG_AP_RING_SIZE - 1);
+  UINT32 First = MIN (Len, MEM_LOG_AP_RING_SIZE - Offset);
+
+  CopyMem (&Ring->Data[Offset], Src, First);
+  CopyMem (&Ring->Data[0], Src + First, Len - First);
+}
+
+STATIC
+VOID
+ApRingCopyOut (
+  IN  MEM_LOG_AP_RING *Ring,
+  IN  UINT32          Pos,
+  OUT CHAR8           *Dst,
+  IN  UINT32          Len
+  )
+{
+  UINT32 Offset = Pos & (MEM_LOG_AP_RING_SIZE - 1);
+  UINT32 First = MIN (Len, MEM_LOG_AP_RING_SIZE - Offset);
+
+  CopyMem (Dst, &Ring->Data[Offset], First);
+  CopyMem (Dst + First, &Ring->Data[0], Len - First);
+}
+
+/**
+  Logs a message from an AP. See MemLogLib.h.
+**/
+VOID
+EFIAPI
+MemLogApfVA (
+  IN  CONST CHAR8   *Format,
+  IN  VA_LIST       Marker
+  )
+{
+  MEM_LOG_AP_RING *Ring;
+  CHAR8           Line[MEM_LOG_AP_MAX_LINE_SIZE];
+  UINT32          Len;
+  UINT32          RecordSize;
+  UINT32          Head;
+
+  // An AP can't init the mem log, it must exist already
+  if (Format == NULL || mMemLog == NULL || mMemLog->ApRing == NULL) {
+    return;
+  }
+  Ring = mMemLog->ApRing;
+
+  Len = (UINT32)vsnprintf(Line, sizeof(Line), Format, Marker);
+  if (Len >= sizeof(Line)) {
+    Len = sizeof(Line) - 1;
+  }
+  RecordSize = MEM_LOG_AP_RECORD_SIZE (Len);
+
+  for (;;) {
+    Head = Ring->Head;
+    if (Head + RecordSize - Ring->Tail > MEM_LOG_AP_RING_SIZE) {
+      if (Ring->Head != Head) {
+        continue; // Head moved meanwhile, Tail may already be past the value we read
+      }
+      InterlockedIncrement (&Ring->Dropped);
+      return;
+    }
+    if (InterlockedCompareExchange32 (&Ring->Head, Head, Head + RecordSize) == Head) {
+      break;
+    }
+  }
+
+  ApRingCopyIn (Ring, Head + sizeof (UINT32), Line, Len);
+  MemoryFence ();
+  *(volatile UINT32 *)&Ring->Data[Head & (MEM_LOG_AP_RING_SIZE - 1)] = Len | MEM_LOG_AP_RECORD_COMMITTED;
+}
+
+VOID
+EFIAPI
+MemLogApf (
+  IN  CONST CHAR8   *Format,
+  ...
+  )
+{
+  VA_LIST           Marker;
+
+  VA_START (Marker, Format);
+  MemLogApfVA (Format, Marker);
+  VA_END (Marker);
+}
+
+/**
+  Moves the committed AP messages to the mem log. See MemLogLib.h.
+**/
+VOID
+EFIAPI
+MemLogDrainAp (
+  VOID
+  )
+{
+  MEM_LOG_AP_RING *Ring;
+  CHAR8           Line[MEM_LOG_AP_MAX_LINE_SIZE];
+  UINT32          Tail;
+  UINT32          Header;
+  UINT32          Len;
+  UINT32          Dropped;
+
+  if (mMemLog == NULL || mMemLog->ApRing == NULL) {
+    return;
+  }
+  Ring = mMemLog->ApRing;
+
+  while (Ring->Tail != Ring->Head) {
+    Tail = Ring->Tail;
+    Header = *(volatile UINT32 *)&Ring->Data[Tail & (MEM_LOG_AP_RING_SIZE - 1)];
+    if ((Header & MEM_LOG_AP_RECORD_COMMITTED) == 0) {
+      // still being written, the next ones wait to keep the order
+      break;
+    }
+    Len = Header & ~MEM_LOG_AP_RECORD_COMMITTED;
+    ApRingCopyOut (Ring, Tail + sizeof (UINT32), Line, Len);
+    Line[Len] = '\0';
+    *(volatile UINT32 *)&Ring->Data[Tail & (MEM_LOG_AP_RING_SIZE - 1)] = 0;
+    MemoryFence ();
+    Ring->Tail = Tail + MEM_LOG_AP_RECORD_SIZE (Len);
+    MemLogf (TRUE, 1, "%s", Line);
+  }
+
+  do {
+    Dropped = Ring->Dropped;
+  } while (Dropped != 0 && InterlockedCompareExchange32 (&Ring->Dropped, Dropped, 0) != Dropped);
+  if (Dropped != 0) {
+    MemLogf (TRUE, 1, "MemLog: %d messages from APs dropped, ring full\n", Dropped);
+  }
+}
+
+/**
+  Returns the part of the log written since Offset. See MemLogLib.h.
+**/
+UINTN
+EFIAPI
+GetMemLogChunk (
+  IN  UINTN         Offset,
+  OUT CONST CHAR8   **Chunk
+  )
+{
+  UINTN Len = GetMemLogLen ();
+
+  *Chunk = NULL;
+  if (Len == 0 || Offset >= Len) {
+    return 0;
+  }
+  *Chunk = mMemLog->Buffer + Offset;
+  return Len - Offset;
+}
+
+/**
+  Records the start of a phase. See MemLogLib.h.
+**/
+VOID
+EFIAPI
+MemLogMarkPhase (
+  IN  CONST CHAR8   *Name
+  )
+{
+  MEM_LOG_PHASE *Phase;
+
+  if (Name == NULL || GetMemLogBuffer () == NULL || mMemLog->PhaseCount >= MEM_LOG_MAX_PHASES) {
+    return;
+  }
+  Phase = &mMemLog->Phases[mMemLog->PhaseCount++];
+  Phase->Offset = (UINT32)(mMemLog->Cursor - mMemLog->Buffer);
+  AsciiStrnCpyS (Phase->Name, sizeof (Phase->Name), Name, sizeof (Phase->Name) - 1);
+}
+
+/**
+  Returns the phase markers. See MemLogLib.h.
+**/
+UINTN
+EFIAPI
+GetMemLogPhases (
+  OUT CONST MEM_LOG_PHASE **Phases
+  )
+{
+  if (GetMemLogBuffer () == NULL) {
+    *Phases = NULL;
+    return 0;
+  }
+  *Phases = mMemLog->Phases;
+  return mMemLog->PhaseCount;
+}
+
+//
+// LZSS encoder. Matches are found with hash chains on 3 chars, limited to LZSS_MAX_CHAIN candidates,
+// and never reach before the start of Log, so the initial spaces of the decoder ring are not needed.
+//
+#define LZSS_N          4096
+#define LZSS_F          18
+#define LZSS_THRESHOLD  2
+#define LZSS_HASH_SIZE  4096
+#define LZSS_MAX_CHAIN  32
+#define LZSS_HASH(p)    ((((UINT32)(p)[0] << 8) ^ ((UINT32)(p)[1] << 4) ^ (p)[2]) & (LZSS_HASH_SIZE - 1))
+
+UINTN
+EFIAPI
+MemLogCompress (
+  IN  CONST CHAR8   *Log,
+  IN  UINTN         Length,
+  OUT UINT8         *Buffer,
+  IN  UINTN         BufferSize
+  )
+{
+  CONST UINT8          *Src = (CONST UINT8 *)Log;
+  UINT8                *Dst;
+  UINT8                *DstEnd;
+  UINT8                *Flags;
+  UINT8                FlagBit;
+  UINT32               *Head;
+  UINT32               *Prev;
+  UINT32               Pos, Cand, MatchPos, MatchLen, Len, Max, Chain, Ring;
+  MEM_LOG_LZSS_HEADER  *Header;
+
+  if (Log == NULL || Buffer == NULL || BufferSize < sizeof (MEM_LOG_LZSS_HEADER) || Length > MAX_UINT32) {
+    return 0;
+  }
+  // chain links are positions + 1, 0 ends the chain
+  Head = AllocateZeroPool ((LZSS_HASH_SIZE + LZSS_N) * sizeof (UINT32));
+  if (Head == NULL) {
+    return 0;
+  }
+  Prev = Head + LZSS_HASH_SIZE;
+
+  Header = (MEM_LOG_LZSS_HEADER *)Buffer;
+  Header->Signature = MEM_LOG_LZSS_SIGNATURE;
+  Header->Length = (UINT32)Length;
+  Dst = Buffer + sizeof (MEM_LOG_LZSS_HEADER);
+  DstEnd = Buffer + BufferSize;
+  Flags = NULL;
+  FlagBit = 0;
+
+  Pos = 0;
+  while (Pos < Length) {
+    // flags byte + the longest item
+    if (FlagBit == 0 && Dst + 3 > DstEnd) {
+      Dst = NULL;
+      break;
+    }
+    if (FlagBit == 0) {
+      Flags = Dst++;
+      *Flags = 0;
+      FlagBit = 1;
+    } else if (Dst + 2 > DstEnd) {
+      Dst = NULL;
+      break;
+    }
+
+    MatchLen = 0;
+    MatchPos = 0;
+    if (Pos + LZSS_THRESHOLD + 1 <= Length) {
+      Max = (UINT32)MIN (LZSS_F, Length - Pos);
+      Cand = Head[LZSS_HASH (Src + Pos)];
+      for (Chain = 0; Cand != 0 && Pos - (Cand - 1) <= LZSS_N - LZSS_F && Chain < LZSS_MAX_CHAIN; Chain++) {
+        for (Len = 0; Len < Max && Src[Cand - 1 + Len] == Src[Pos + Len]; Len++);
+        if (Len > MatchLen) {
+          MatchLen = Len;
+          MatchPos = Cand - 1;
+          if (Len == Max) {
+            break;
+          }
+        }
+        Cand = Prev[(Cand - 1) & (LZSS_N - 1)];
+      }
+    }
+
+    if (MatchLen > LZSS_THRESHOLD) {
+      Ring = (LZSS_N - LZSS_F + MatchPos) & (LZSS_N - 1);
+      *Dst++ = (UINT8)Ring;
+      *Dst++ = (UINT8)(((Ring >> 4) & 0xF0) | (MatchLen - (LZSS_THRESHOLD + 1)));
+    } else {
+      *Flags |= FlagBit;
+      *Dst++ = Src[Pos];
+      MatchLen = 1;
+    }
+    FlagBit <<= 1;
+
+    for (; MatchLen > 0; MatchLen--, Pos++) {
+      if (Pos + LZSS_THRESHOLD + 1 <= Length) {
+        Prev[Pos & (LZSS_N - 1)] = Head[LZSS_HASH (Src + Pos)];
+        Head[LZSS_HASH (Src + Pos)] = Pos + 1;
+      }
+    }
+  }
+
+  FreePool (Head);
+  return Dst == NULL ? 0 : (UINTN)(Dst - Buffer);
+}
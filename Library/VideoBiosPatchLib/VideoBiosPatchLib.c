@@ -22,6 +22,13 @@ EFI_LEGACY_REGION2_PROTOCOL   *mLegacyRegion2 = NULL;
 //
 UINT8     *mEdid = NULL;
 
+//
+// Volatile variable with VBIOS_PATCH_KEY of the last native patch. Video bios shadow
+// is rebuilt on every boot, so the key lives only until ExitBootServices, but it is
+// seen by both CloverEFI's BiosVideo and Clover.efi
+//
+#define VBIOS_PATCH_KEY_VARIABLE  L"CloverVBiosPatchKey"
+
 
 /**
   Searches Source for Search pattern of size SearchSize
@@ -49,9 +56,21 @@ VideoBiosPatchSearchAndReplace (
 {
   UINTN     NumReplaces = 0;
   BOOLEAN   NoReplacesRestriction = MaxReplaces <= 0;
-  UINT8     *End = Source + SourceSize;
+  UINT8     *End;
   
+  if (SearchSize == 0 || SearchSize > SourceSize) {
+    return 0;
+  }
+  //
+  // Last position where the whole pattern fits, then jump from one occurrence
+  // of the first byte to the next instead of comparing at every byte
+  //
+  End = Source + SourceSize - SearchSize + 1;
   while (Source < End && (NoReplacesRestriction || MaxReplaces > 0)) {
+    Source = ScanMem8 (Source, End - Source, Search[0]);
+    if (Source == NULL) {
+      break;
+    }
     if (CompareMem(Source, Search, SearchSize) == 0) {
       CopyMem(Source, Replace, SearchSize);
       NumReplaces++;
@@ -273,9 +292,48 @@ UINT8* VideoBiosPatchGetEdid (VOID)
 }
 
 
+/**
+  Fills Key for patching current video bios from Edid.
+ 
+  @param  Edid          Edid block, at least EDID_LENGTH bytes.
+  @param  Key           Receives PCI ids of video bios (zero if there is no PCIR header) and Edid hash.
+ 
+**/
+VOID
+VideoBiosPatchGetKey (
+  IN  UINT8             *Edid,
+  OUT VBIOS_PATCH_KEY   *Key
+  )
+{
+  PCI_EXPANSION_ROM_HEADER  *RomHeader;
+  PCI_DATA_STRUCTURE        *Pcir;
+  UINT32                    Hash;
+  UINTN                     Index;
+  
+  ZeroMem(Key, sizeof(*Key));
+  RomHeader = (PCI_EXPANSION_ROM_HEADER*)(UINTN)VBIOS_START;
+  if (RomHeader->Signature == PCI_EXPANSION_ROM_HEADER_SIGNATURE &&
+      RomHeader->PcirOffset <= VBIOS_SIZE - sizeof(PCI_DATA_STRUCTURE)) {
+    Pcir = (PCI_DATA_STRUCTURE*)((UINT8*)RomHeader + RomHeader->PcirOffset);
+    if (Pcir->Signature == PCI_DATA_STRUCTURE_SIGNATURE) {
+      Key->VendorId = Pcir->VendorId;
+      Key->DeviceId = Pcir->DeviceId;
+    }
+  }
+  
+  Hash = 2166136261U;
+  for (Index = 0; Index < EDID_LENGTH; Index++) {
+    Hash = (Hash ^ Edid[Index]) * 16777619U;
+  }
+  Key->EdidHash = Hash;
+}
+
+
 /**
   Determines "native" resolution from Edid detail timing descriptor
   and patches first video mode with that timing/resolution info.
+  Skips the video bios scan if this video bios was already patched
+  from the same Edid during this boot.
  
   @param  Edid          Edid to use. If NULL, then Edid will be read from EFI_EDID_ACTIVE_PROTOCOL
  
@@ -292,6 +350,9 @@ VideoBiosPatchNativeFromEdid (
   EFI_STATUS          Status;
   BOOLEAN             ReleaseEdid;
   vbios_map           *map;
+  VBIOS_PATCH_KEY     Key;
+  VBIOS_PATCH_KEY     DoneKey;
+  UINTN               DoneKeySize;
   
   DBG("VideoBiosPatchNativeFromEdid:\n");
   
@@ -304,6 +365,17 @@ VideoBiosPatchNativeFromEdid (
     ReleaseEdid = TRUE;
   }
   
+  VideoBiosPatchGetKey (Edid, &Key);
+  DoneKeySize = sizeof(DoneKey);
+  Status = gRT->GetVariable (VBIOS_PATCH_KEY_VARIABLE, &gEfiGlobalVariableGuid, NULL, &DoneKeySize, &DoneKey);
+  if (!EFI_ERROR(Status) && DoneKeySize == sizeof(DoneKey) && CompareMem(&DoneKey, &Key, sizeof(Key)) == 0) {
+    DBG(" = already patched for %04x:%04x, Edid hash %08x.\n", Key.VendorId, Key.DeviceId, Key.EdidHash);
+    if (ReleaseEdid) {
+      FreePool(Edid);
+    }
+    return EFI_SUCCESS;
+  }
+  
   map = open_vbios(CT_UNKNOWN);
   if (map == NULL) {
     DBG(" = unknown video bios.\n");
@@ -316,6 +388,10 @@ VideoBiosPatchNativeFromEdid (
   Status = VideoBiosUnlock ();
   if (EFI_ERROR(Status)) {
     DBG(" = not done.\n");
+    close_vbios (map);
+    if (ReleaseEdid) {
+      FreePool(Edid);
+    }
     return Status;
   }
   
@@ -330,6 +406,14 @@ VideoBiosPatchNativeFromEdid (
   
   close_vbios (map);
   
+  gRT->SetVariable (
+                    VBIOS_PATCH_KEY_VARIABLE,
+                    &gEfiGlobalVariableGuid,
+                    EFI_VARIABLE_BOOTSERVICE_ACCESS,
+                    sizeof(Key),
+                    &Key
+                    );
+  
   return EFI_SUCCESS;
   
 }
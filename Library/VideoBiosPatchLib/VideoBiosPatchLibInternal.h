@@ -13,6 +13,7 @@
 #include <Library/BaseMemoryLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiRuntimeServicesTableLib.h>
 #include <Library/MemLogLib.h>
 #include <Library/VideoBiosPatchLib.h>
 
@@ -21,6 +22,9 @@
 #include <Protocol/EdidActive.h>
 
 #include <IndustryStandard/AtomBios.h>
+#include <IndustryStandard/Pci22.h>
+
+#include <Guid/GlobalVariable.h>
 
 //#include "shortatombios.h"
 #include "915resolution.h"
@@ -52,6 +56,17 @@
 #define inb(...)    0
 
 
+//
+// Identifies a native patch: PCI ids from the video bios PCIR header
+// and FNV-1a hash of the Edid block the patch was made from
+//
+typedef struct {
+  UINT16    VendorId;
+  UINT16    DeviceId;
+  UINT32    EdidHash;
+} VBIOS_PATCH_KEY;
+
+
 //
 // Temp var for passing Edid to readEDID() in edid.c
 //
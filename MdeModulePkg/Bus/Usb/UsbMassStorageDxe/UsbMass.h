@@ -182,6 +182,7 @@ struct _USB_MASS_DEVICE {
   EFI_DISK_INFO_PROTOCOL    DiskInfo;
   USB_BOOT_INQUIRY_DATA     InquiryData;
   BOOLEAN                   Cdb16Byte;
+  UINT32                    MaxCarrySize; ///< Bytes carried by one READ/WRITE command
 };
 
 #endif
@@ -823,7 +823,7 @@ UsbBootReadWriteBlocks (
   UINT32                     Timeout;
 
   BlockSize = UsbMass->BlockIoMedia.BlockSize;
-  CountMax  = USB_BOOT_MAX_CARRY_SIZE / BlockSize;
+  CountMax  = UsbMass->MaxCarrySize / BlockSize;
   Status    = EFI_SUCCESS;
 
   while (TotalBlock > 0) {
@@ -906,7 +906,7 @@ UsbBootReadWriteBlocks16 (
   UINT32                    Timeout;
 
   BlockSize = UsbMass->BlockIoMedia.BlockSize;
-  CountMax  = USB_BOOT_MAX_CARRY_SIZE / BlockSize;
+  CountMax  = UsbMass->MaxCarrySize / BlockSize;
   Status    = EFI_SUCCESS;
 
   while (TotalBlock > 0) {
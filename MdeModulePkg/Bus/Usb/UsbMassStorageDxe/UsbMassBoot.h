@@ -60,8 +60,11 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 //
 // Other parameters, Max carried size is 64KB.
+// SuperSpeed devices carry 1MB per command, 2048 sectors like other hosts use for them.
 //
 #define USB_BOOT_MAX_CARRY_SIZE         SIZE_64KB
+#define USB_BOOT_MAX_CARRY_SIZE_SUPER   SIZE_1MB
+#define USB_BOOT_SUPER_SPEED_PACKET     1024
 
 //
 // Retry mass command times, set by experience
@@ -455,6 +455,51 @@ ON_EXIT:
   return Status;
 }
 
+/**
+  Get the bytes carried by one READ/WRITE command of the device.
+
+  SuperSpeed bulk endpoints have 1024 bytes packets, such devices take much
+  larger transfers than the 64KB that suit full and high speed devices.
+
+  @param  Controller      The USB mass storage device.
+
+  @return The max carried size.
+
+**/
+UINT32
+UsbMassGetMaxCarrySize (
+  IN EFI_HANDLE                    Controller
+  )
+{
+  EFI_USB_IO_PROTOCOL           *UsbIo;
+  EFI_USB_INTERFACE_DESCRIPTOR  Interface;
+  EFI_USB_ENDPOINT_DESCRIPTOR   EndPoint;
+  EFI_STATUS                    Status;
+  UINT8                         Index;
+
+  Status = gBS->HandleProtocol (Controller, &gEfiUsbIoProtocolGuid, (VOID **) &UsbIo);
+  if (EFI_ERROR(Status)) {
+    return USB_BOOT_MAX_CARRY_SIZE;
+  }
+
+  Status = UsbIo->UsbGetInterfaceDescriptor (UsbIo, &Interface);
+  if (EFI_ERROR(Status)) {
+    return USB_BOOT_MAX_CARRY_SIZE;
+  }
+
+  for (Index = 0; Index < Interface.NumEndpoints; Index++) {
+    Status = UsbIo->UsbGetEndpointDescriptor (UsbIo, Index, &EndPoint);
+    if (EFI_ERROR(Status) || !USB_IS_BULK_ENDPOINT (EndPoint.Attributes)) {
+      continue;
+    }
+    if (EndPoint.MaxPacketSize >= USB_BOOT_SUPER_SPEED_PACKET) {
+      return USB_BOOT_MAX_CARRY_SIZE_SUPER;
+    }
+  }
+
+  return USB_BOOT_MAX_CARRY_SIZE;
+}
+
 /**
   Initialize data for device that supports multiple LUNSs.
 
@@ -508,6 +553,7 @@ UsbMassInitMultiLun (
     UsbMass->Transport            = Transport;
     UsbMass->Context              = Context;
     UsbMass->Lun                  = Index;
+    UsbMass->MaxCarrySize         = UsbMassGetMaxCarrySize (Controller);
 
     //
     // Initialize the media parameter data for EFI_BLOCK_IO_MEDIA of Block I/O Protocol.
@@ -648,6 +694,7 @@ UsbMassInitNonLun (
   UsbMass->OpticalStorage       = FALSE;
   UsbMass->Transport            = Transport;
   UsbMass->Context              = Context;
+  UsbMass->MaxCarrySize         = UsbMassGetMaxCarrySize (Controller);
 
   //
   // Initialize the media parameter data for EFI_BLOCK_IO_MEDIA of Block I/O Protocol.
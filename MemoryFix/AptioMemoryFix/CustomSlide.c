@@ -118,28 +118,38 @@ GenerateRandomSlideValue (
 {
   UINT32  Clock = 0;
   UINT32  Ecx = 0;
-  UINT8   Slide = 0;
+  UINT32  First;
+  UINT32  Count;
+  UINT32  Limit;
+  UINT32  Index;
   UINT16  Value = 0;
   BOOLEAN RdRandSupport;
 
+  //
+  // slide=0 disables KASLR, so slide 0 is only used when it is the only valid one.
+  // mValidSlides is sorted, 0 can only be its first entry.
+  //
+  First = (mValidSlides[0] == 0 && mValidSlidesNum > 1) ? 1 : 0;
+  Count = mValidSlidesNum - First;
+
   AsmCpuid (0x1, NULL, NULL, &Ecx, NULL);
   RdRandSupport = (Ecx & 0x40000000) != 0;
 
+  //
+  // Values at or above the largest multiple of Count are dropped, so that every valid slide is equally likely.
+  //
+  Limit = 0x10000 - (0x10000 % Count);
   do {
-    if (RdRandSupport && GetRandomNumber16 (&Value) == EFI_SUCCESS && (UINT8) Value != 0) {
-      Slide = (UINT8) Value;
-    } else {
+    if (!RdRandSupport || GetRandomNumber16 (&Value) != EFI_SUCCESS) {
       Clock = (UINT32) AsmReadTsc ();
-      Slide = (Clock & 0xFF) ^ ((Clock >> 8) & 0xFF);
+      Value = (UINT16) (Clock ^ (Clock >> 16));
     }
-  } while (Slide == 0);
+  } while (Value >= Limit);
 
-  DEBUG ((DEBUG_VERBOSE, "Generated slide index %d value %d\n", Slide, mValidSlides[Slide % mValidSlidesNum]));
+  Index = First + Value % Count;
+  DEBUG ((DEBUG_VERBOSE, "Generated slide index %d value %d\n", Index, mValidSlides[Index]));
 
-  //
-  //FIXME: This is bad due to uneven distribution, but let's use it for now.
-  //
-  return mValidSlides[Slide % mValidSlidesNum];
+  return mValidSlides[Index];
 }
 
 #if APTIOFIX_CLEANUP_SLIDE_BOOT_ARGUMENT == 1
@@ -201,6 +211,8 @@ DecideOnCustomSlideImplementation (
   UINTN                  NumEntries;
   UINTN                  MaxAvailableSize = 0;
   UINT8                  FallbackSlide = 0;
+  EFI_MEMORY_DESCRIPTOR  *FirstDesc;
+  EFI_MEMORY_DESCRIPTOR  *MemoryMapEnd;
 
   Status = GetMemoryMapAlloc (
     &AllocatedMapPages,
@@ -218,8 +230,12 @@ DecideOnCustomSlideImplementation (
 
   //
   // At this point we have a memory map that we could use to determine what slide values are allowed.
+  // Sorted, and with slide regions in increasing order, the descriptors that end below a region
+  // end below all the next ones: a single sweep, each slide only looks at the descriptors of its region.
   //
-  NumEntries = MemoryMapSize / DescriptorSize;
+  SortMemMap (MemoryMapSize, MemoryMap, DescriptorSize);
+  MemoryMapEnd = NEXT_MEMORY_DESCRIPTOR (MemoryMap, MemoryMapSize);
+  FirstDesc = MemoryMap;
 
   //
   // Reset valid slides to zero and find actually working ones.
@@ -227,7 +243,7 @@ DecideOnCustomSlideImplementation (
   mValidSlidesNum = 0;
 
   for (Slide = 0; Slide < TOTAL_SLIDE_NUM; Slide++) {
-    EFI_MEMORY_DESCRIPTOR  *Desc = MemoryMap;
+    EFI_MEMORY_DESCRIPTOR  *Desc;
     BOOLEAN                Supported = TRUE;
     UINTN                  StartAddr;
     UINTN                  EndAddr;
@@ -238,7 +254,12 @@ DecideOnCustomSlideImplementation (
 
     AvailableSize = 0;
 
-    for (Index = 0; Index < NumEntries; Index++) {
+    while (FirstDesc < MemoryMapEnd
+      && FirstDesc->PhysicalStart + EFI_PAGES_TO_SIZE (FirstDesc->NumberOfPages) <= StartAddr) {
+      FirstDesc = NEXT_MEMORY_DESCRIPTOR (FirstDesc, DescriptorSize);
+    }
+
+    for (Desc = FirstDesc; Desc < MemoryMapEnd && Desc->PhysicalStart < EndAddr; Desc = NEXT_MEMORY_DESCRIPTOR (Desc, DescriptorSize)) {
       DescEndAddr = (Desc->PhysicalStart + EFI_PAGES_TO_SIZE (Desc->NumberOfPages));
 
       if ((Desc->PhysicalStart < EndAddr) && (DescEndAddr > StartAddr)) {
@@ -274,8 +295,6 @@ DecideOnCustomSlideImplementation (
           }
         }
       }
-
-      Desc = NEXT_MEMORY_DESCRIPTOR (Desc, DescriptorSize);
     }
 
     if (AvailableSize > MaxAvailableSize) {
@@ -38,6 +38,45 @@ STATIC CHAR16 *mEfiMemoryTypeDesc[EfiMaxMemoryType] = {
   L"PAL_code"
 };
 
+/** Size of the last memory map obtained by GetMemoryMapAlloc, to get the next one in a single call. */
+STATIC UINTN  mMemoryMapSizeHint = 0;
+
+/** Extra space for the descriptors added by the allocation of the map itself. */
+#define MEMORY_MAP_HEADROOM  512
+
+VOID
+SortMemMap (
+  IN     UINTN                  MemoryMapSize,
+  IN OUT EFI_MEMORY_DESCRIPTOR  *MemoryMap,
+  IN     UINTN                  DescriptorSize
+  )
+{
+  UINT8                   Saved[128];
+  EFI_MEMORY_DESCRIPTOR   *MemoryMapEnd;
+  EFI_MEMORY_DESCRIPTOR   *Desc;
+  EFI_MEMORY_DESCRIPTOR   *Dest;
+
+  if (DescriptorSize > sizeof (Saved)) {
+    return;
+  }
+
+  //
+  // Insertion sort: firmwares give sorted or almost sorted maps, so it is one pass with a few moves.
+  //
+  MemoryMapEnd = NEXT_MEMORY_DESCRIPTOR (MemoryMap, MemoryMapSize);
+  for (Desc = NEXT_MEMORY_DESCRIPTOR (MemoryMap, DescriptorSize); Desc < MemoryMapEnd; Desc = NEXT_MEMORY_DESCRIPTOR (Desc, DescriptorSize)) {
+    Dest = Desc;
+    while (Dest > MemoryMap && PREV_MEMORY_DESCRIPTOR (Dest, DescriptorSize)->PhysicalStart > Desc->PhysicalStart) {
+      Dest = PREV_MEMORY_DESCRIPTOR (Dest, DescriptorSize);
+    }
+    if (Dest != Desc) {
+      CopyMem (Saved, Desc, DescriptorSize);
+      CopyMem (NEXT_MEMORY_DESCRIPTOR (Dest, DescriptorSize), Dest, (UINT8 *)Desc - (UINT8 *)Dest);
+      CopyMem (Dest, Saved, DescriptorSize);
+    }
+  }
+}
+
 VOID
 ShrinkMemMap (
   IN OUT UINTN                  *MemoryMapSize,
@@ -50,13 +89,18 @@ ShrinkMemMap (
   EFI_MEMORY_DESCRIPTOR   *PrevDesc;
   EFI_MEMORY_DESCRIPTOR   *Desc;
   BOOLEAN                 CanBeJoined;
-  BOOLEAN                 HasEntriesToRemove;
 
+  if (*MemoryMapSize < DescriptorSize) {
+    return;
+  }
+
+  //
+  // Single pass: PrevDesc is the last kept descriptor, Desc is either joined to it or copied right after it.
+  //
   PrevDesc           = MemoryMap;
   Desc               = NEXT_MEMORY_DESCRIPTOR (PrevDesc, DescriptorSize);
   SizeFromDescToEnd  = *MemoryMapSize - DescriptorSize;
   *MemoryMapSize     = DescriptorSize;
-  HasEntriesToRemove = FALSE;
 
   while (SizeFromDescToEnd > 0) {
     Bytes = EFI_PAGES_TO_SIZE (PrevDesc->NumberOfPages);
@@ -84,21 +128,17 @@ ShrinkMemMap (
       //
       PrevDesc->Type = EfiConventionalMemory;
       PrevDesc->NumberOfPages += Desc->NumberOfPages;
-      HasEntriesToRemove = TRUE;
     } else {
       //
       // Cannot be joined - we need to move to next
       //
       *MemoryMapSize += DescriptorSize;
       PrevDesc = NEXT_MEMORY_DESCRIPTOR (PrevDesc, DescriptorSize);
-      if (HasEntriesToRemove) {
+      if (PrevDesc != Desc) {
         //
-        // Have entries between PrevDesc and Desc which are joined to PrevDesc,
-        // we need to copy [Desc, end of list] to PrevDesc + 1
+        // Have entries between PrevDesc and Desc which are joined, bring Desc down
         //
-        CopyMem(PrevDesc, Desc, SizeFromDescToEnd);
-        Desc = PrevDesc;
-        HasEntriesToRemove = FALSE;
+        CopyMem(PrevDesc, Desc, DescriptorSize);
       }
     }
 
@@ -223,27 +263,35 @@ GetMemoryMapAlloc (
   )
 {
   EFI_STATUS               Status;
+  UINTN                    Size;
 
-  *MemoryMapSize       = 0;
   *MemoryMap           = NULL;
-  Status = OrgGetMemoryMap (
-    MemoryMapSize,
-    *MemoryMap,
-    MapKey,
-    DescriptorSize,
-    DescriptorVersion
-    );
+  Size                 = mMemoryMapSizeHint;
+  if (Size == 0) {
+    *MemoryMapSize     = 0;
+    Status = OrgGetMemoryMap (
+      MemoryMapSize,
+      *MemoryMap,
+      MapKey,
+      DescriptorSize,
+      DescriptorVersion
+      );
 
-  if (Status != EFI_BUFFER_TOO_SMALL) {
-    DEBUG ((DEBUG_INFO, "Insane GetMemoryMap %r\n", Status));
-    return Status;
+    if (Status != EFI_BUFFER_TOO_SMALL) {
+      DEBUG ((DEBUG_INFO, "Insane GetMemoryMap %r\n", Status));
+      return Status;
+    }
+    Size = *MemoryMapSize;
   }
 
+  //
+  // After the first call the size is known, and the map is usually obtained in one call.
+  //
   do {
     //
     // This is done because extra allocations may increase memory map size.
     //
-    *MemoryMapSize   += 512;
+    *MemoryMapSize   = Size + MEMORY_MAP_HEADROOM;
 
     //
     // Requested to allocate from top via pages.
@@ -286,11 +334,14 @@ GetMemoryMapAlloc (
         FreePool(*MemoryMap);
       }
       *MemoryMap = NULL;
+      Size = *MemoryMapSize;
     }
   } while (Status == EFI_BUFFER_TOO_SMALL);
 
   if (Status != EFI_SUCCESS) {
     DEBUG ((DEBUG_INFO, "Failed to obtain memory map %r\n", Status));
+  } else {
+    mMemoryMapSizeHint = *MemoryMapSize;
   }
 
   return Status;
@@ -320,6 +371,11 @@ AllocatePagesFromTop (
 
   Status = EFI_NOT_FOUND;
 
+  //
+  // The scan from the end is a scan from the top only if the map is sorted
+  //
+  SortMemMap (MemoryMapSize, MemoryMap, DescriptorSize);
+
   MemoryMapEnd = NEXT_MEMORY_DESCRIPTOR (MemoryMap, MemoryMapSize);
   Desc = PREV_MEMORY_DESCRIPTOR (MemoryMapEnd, DescriptorSize);
 
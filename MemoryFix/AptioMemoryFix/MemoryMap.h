@@ -13,6 +13,14 @@
 #define PREV_MEMORY_DESCRIPTOR(MemoryDescriptor, Size) \
   ((EFI_MEMORY_DESCRIPTOR *)((UINT8 *)(MemoryDescriptor) - (Size)))
 
+/** Sorts mem map by physical address. */
+VOID
+SortMemMap (
+  IN     UINTN                  MemoryMapSize,
+  IN OUT EFI_MEMORY_DESCRIPTOR  *MemoryMap,
+  IN     UINTN                  DescriptorSize
+  );
+
 /** Shrinks mem map by joining non-runtime records. */
 VOID
 ShrinkMemMap (
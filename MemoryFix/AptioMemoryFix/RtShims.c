@@ -35,6 +35,7 @@ extern UINTN gSetWakeupTime;
 extern UINTN gGetNextHighMonoCount;
 extern UINTN gResetSystem;
 extern UINTN gGetVariableOverride;
+extern UINT64 gRtShimCallCounts[RT_SHIM_COUNT_NUM];
 
 extern UINTN gRequiresWriteUnprotect;
 extern UINTN gBootVariableRedirect;
@@ -162,6 +163,7 @@ VirtualizeRtShims (
 {
   EFI_MEMORY_DESCRIPTOR  *Desc;
   UINTN                  Index, Index2, FixedCount = 0;
+  UINT64                 Counts[RT_SHIM_COUNT_NUM];
 
   //
   // For some reason creating an event for catching SetVirtualAddress doesn't work on APTIO IV Z77,
@@ -174,6 +176,21 @@ VirtualizeRtShims (
   if (mRtShimsAddrUpdated)
     return;
 
+  //
+  // Calls made by boot.efi, the ones of the OS add to them
+  //
+  if (GetRtShimCallCounts (Counts)) {
+    DEBUG ((
+      DEBUG_INFO,
+      "RtShims calls: GetVariable %Lu SetVariable %Lu GetNextVariableName %Lu GetTime %Lu, WP cleared %Lu\n",
+      Counts[RT_SHIM_COUNT_GET_VARIABLE],
+      Counts[RT_SHIM_COUNT_SET_VARIABLE],
+      Counts[RT_SHIM_COUNT_GET_NEXT_VARIABLE_NAME],
+      Counts[RT_SHIM_COUNT_GET_TIME],
+      Counts[RT_SHIM_COUNT_UNPROTECTED]
+      ));
+  }
+
   Desc = MemoryMap;
 
   //
@@ -356,3 +373,20 @@ SetBootVariableRedirect (
   *(BOOLEAN *)((UINTN)gRtShims + ((UINTN)&gBootVariableRedirect - (UINTN)&gRtShimsDataStart)) = Enable;
   return Previous;
 }
+
+BOOLEAN
+GetRtShimCallCounts (
+  OUT    UINT64                 *Counts
+  )
+{
+  if (gRtShims == NULL) {
+    return FALSE;
+  }
+
+  CopyMem (
+    Counts,
+    (VOID *)((UINTN)gRtShims + ((UINTN)&gRtShimCallCounts - (UINTN)&gRtShimsDataStart)),
+    sizeof (gRtShimCallCounts)
+    );
+  return TRUE;
+}
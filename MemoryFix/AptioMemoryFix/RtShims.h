@@ -11,6 +11,22 @@
 
 extern VOID *gRtShims;
 
+//
+// Calls counted by the shims, indexes of GetRtShimCallCounts().
+// Must match X64/AsmRtShims.nasm.
+//
+#define RT_SHIM_COUNT_GET_VARIABLE            0
+#define RT_SHIM_COUNT_SET_VARIABLE            1
+#define RT_SHIM_COUNT_GET_NEXT_VARIABLE_NAME  2
+#define RT_SHIM_COUNT_GET_TIME                3
+#define RT_SHIM_COUNT_SET_TIME                4
+#define RT_SHIM_COUNT_GET_WAKEUP_TIME         5
+#define RT_SHIM_COUNT_SET_WAKEUP_TIME         6
+#define RT_SHIM_COUNT_GET_NEXT_HIGH_MONO      7
+#define RT_SHIM_COUNT_RESET_SYSTEM            8
+#define RT_SHIM_COUNT_UNPROTECTED             9  // calls that cleared CR0.WP
+#define RT_SHIM_COUNT_NUM                     10
+
 typedef struct {
   UINTN           *gFunc;
   UINTN           *Func;
@@ -76,4 +92,13 @@ SetBootVariableRedirect (
   IN     BOOLEAN                Enable
   );
 
+/**
+  Copies the call counters of the installed shims, RT_SHIM_COUNT_NUM entries.
+  Returns FALSE if the shims are not installed.
+**/
+BOOLEAN
+GetRtShimCallCounts (
+  OUT    UINT64                 *Counts
+  );
+
 #endif // APTIOFIX_RT_SHIMS_H
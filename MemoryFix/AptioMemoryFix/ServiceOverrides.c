@@ -420,6 +420,11 @@ MOGetMemoryMap (
       PrintMemMap (L"GetMemoryMap", *MemoryMapSize, *DescriptorSize, MemoryMap, gRtShims, gSysTableRtArea);
     }
 
+    //
+    // Sorted, the neighbours in memory are neighbours in the map and ShrinkMemMap joins all it can.
+    //
+    SortMemMap (*MemoryMapSize, MemoryMap, *DescriptorSize);
+
 #if APTIOFIX_PROTECT_CSM_REGION == 1
     ProtectCsmRegion (*MemoryMapSize, MemoryMap, *DescriptorSize);
 #endif
@@ -7,6 +7,7 @@
 **/
 
 #include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
 
@@ -320,30 +321,24 @@ VmAllocatePages (
   return AllocatedPages;
 }
 
-/** Maps (remaps) 4K page given by VirtualAddr to PhysicalAddr page in PageTable. */
-EFI_STATUS
-VmMapVirtualPage (
+/** Returns the PDPE entry for VirtualAddr in PageTable, creating the PML4 entry if needed.
+  * NULL if there are no more pages in the vm memory pool.
+  */
+STATIC
+PAGE_MAP_AND_DIRECTORY_POINTER *
+VmGetPdpe (
   PAGE_MAP_AND_DIRECTORY_POINTER  *PageTable,
-  EFI_VIRTUAL_ADDRESS             VirtualAddr,
-  EFI_PHYSICAL_ADDRESS            PhysicalAddr
+  VIRTUAL_ADDR                    VA
   )
 {
   EFI_PHYSICAL_ADDRESS            Start;
-  VIRTUAL_ADDR                    VA;
   VIRTUAL_ADDR                    VAStart;
   VIRTUAL_ADDR                    VAEnd;
   PAGE_MAP_AND_DIRECTORY_POINTER  *PML4;
   PAGE_MAP_AND_DIRECTORY_POINTER  *PDPE;
-  PAGE_MAP_AND_DIRECTORY_POINTER  *PDE;
-  PAGE_TABLE_4K_ENTRY             *PTE4K;
-  PAGE_TABLE_4K_ENTRY             *PTE4KTmp;
-  PAGE_TABLE_2M_ENTRY             *PTE2M;
   PAGE_TABLE_1G_ENTRY             *PTE1G;
   UINTN                           Index;
 
-  VA.Uint64 = (UINT64)VirtualAddr;
-  //VA_FIX_SIGN_EXTEND(VA);
-  DEBUG ((DEBUG_VERBOSE, "VmMapVirtualPage VA %lx => PA %lx\nPageTable: %p\n", VirtualAddr, PhysicalAddr, PageTable));
   DEBUG ((DEBUG_VERBOSE, "VA: %lx => Indexes PML4=%x, PDP=%x, PD=%x, PT=%x\n",
     VA.Uint64, VA.Pg4K.PML4Offset, VA.Pg4K.PDPOffset, VA.Pg4K.PDOffset, VA.Pg4K.PTOffset));
 
@@ -372,7 +367,7 @@ VmMapVirtualPage (
     PDPE = (PAGE_MAP_AND_DIRECTORY_POINTER *)VmAllocatePages(1);
     if (PDPE == NULL) {
       DEBUG ((DEBUG_VERBOSE, "No memory - exiting.\n"));
-      return EFI_NO_MAPPING;
+      return NULL;
     }
 
     ZeroMem(PDPE, EFI_PAGE_SIZE);
@@ -408,12 +403,35 @@ VmMapVirtualPage (
   VAStart.Pg4K.PDPOffset = VA.Pg4K.PDPOffset;
   VAEnd.Pg4K.PDPOffset = VA.Pg4K.PDPOffset;
   DEBUG ((DEBUG_VERBOSE, "PDPE[%03x] at %p = %lx Region: %lx - %lx\n", VA.Pg4K.PDPOffset, PDPE, PDPE->Uint64, VAStart.Uint64, VAEnd.Uint64));
+  return PDPE;
+}
+
+/** Returns the PDE entry for VirtualAddr in PageTable, creating the PML4 and PDPE entries if needed.
+  * A 1GB page on the way is split in 2MB pages. NULL if there are no more pages in the vm memory pool.
+  */
+STATIC
+PAGE_MAP_AND_DIRECTORY_POINTER *
+VmGetPde (
+  PAGE_MAP_AND_DIRECTORY_POINTER  *PageTable,
+  VIRTUAL_ADDR                    VA
+  )
+{
+  EFI_PHYSICAL_ADDRESS            Start;
+  PAGE_MAP_AND_DIRECTORY_POINTER  *PDPE;
+  PAGE_MAP_AND_DIRECTORY_POINTER  *PDE;
+  PAGE_TABLE_2M_ENTRY             *PTE2M;
+  UINTN                           Index;
+
+  PDPE = VmGetPdpe(PageTable, VA);
+  if (PDPE == NULL) {
+    return NULL;
+  }
   if (!PDPE->Bits.Present || (PDPE->Bits.MustBeZero & 0x1)) {
     DEBUG ((DEBUG_VERBOSE, "-> Mapping not present or mapped as 1GB page, creating new PDPE entry and page with PDE entries!\n"));
     PDE = (PAGE_MAP_AND_DIRECTORY_POINTER *)VmAllocatePages(1);
     if (PDE == NULL) {
       DEBUG ((DEBUG_VERBOSE, "No memory - exiting.\n"));
-      return EFI_NO_MAPPING;
+      return NULL;
     }
     ZeroMem(PDE, EFI_PAGE_SIZE);
 
@@ -449,15 +467,36 @@ VmMapVirtualPage (
   // PDE
   PDE = (PAGE_MAP_AND_DIRECTORY_POINTER *)(PDPE->Uint64 & PT_ADDR_MASK_4K);
   PDE += VA.Pg4K.PDOffset;
-  VAStart.Pg4K.PDOffset = VA.Pg4K.PDOffset;
-  VAEnd.Pg4K.PDOffset = VA.Pg4K.PDOffset;
-  DEBUG ((DEBUG_VERBOSE, "PDE[%03x] at %p = %lx Region: %lx - %lx\n", VA.Pg4K.PDOffset, PDE, PDE->Uint64, VAStart.Uint64, VAEnd.Uint64));
+  DEBUG ((DEBUG_VERBOSE, "PDE[%03x] at %p = %lx\n", VA.Pg4K.PDOffset, PDE, PDE->Uint64));
+  return PDE;
+}
+
+/** Returns the PTE entry for VirtualAddr in PageTable, creating the upper entries if needed.
+  * Large pages on the way are split. NULL if there are no more pages in the vm memory pool.
+  */
+STATIC
+PAGE_TABLE_4K_ENTRY *
+VmGetPte (
+  PAGE_MAP_AND_DIRECTORY_POINTER  *PageTable,
+  VIRTUAL_ADDR                    VA
+  )
+{
+  EFI_PHYSICAL_ADDRESS            Start;
+  PAGE_MAP_AND_DIRECTORY_POINTER  *PDE;
+  PAGE_TABLE_4K_ENTRY             *PTE4K;
+  PAGE_TABLE_4K_ENTRY             *PTE4KTmp;
+  UINTN                           Index;
+
+  PDE = VmGetPde(PageTable, VA);
+  if (PDE == NULL) {
+    return NULL;
+  }
   if (!PDE->Bits.Present || (PDE->Bits.MustBeZero & 0x1)) {
     DEBUG ((DEBUG_VERBOSE, "-> Mapping not present or mapped as 2MB page, creating new PDE entry and page with PTE4K entries!\n"));
     PTE4K = (PAGE_TABLE_4K_ENTRY *)VmAllocatePages(1);
     if (PTE4K == NULL) {
       DEBUG ((DEBUG_VERBOSE, "No memory - exiting.\n"));
-      return EFI_NO_MAPPING;
+      return NULL;
     }
     ZeroMem(PTE4K, EFI_PAGE_SIZE);
 
@@ -492,9 +531,18 @@ VmMapVirtualPage (
   // PTE
   PTE4K = (PAGE_TABLE_4K_ENTRY *)(PDE->Uint64 & PT_ADDR_MASK_4K);
   PTE4K += VA.Pg4K.PTOffset;
-  VAStart.Pg4K.PTOffset = VA.Pg4K.PTOffset;
-  VAEnd.Pg4K.PTOffset = VA.Pg4K.PTOffset;
-  DEBUG ((DEBUG_VERBOSE, "PTE[%03x] at %p = %lx Region: %lx - %lx\n", VA.Pg4K.PTOffset, PTE4K, PTE4K->Uint64, VAStart.Uint64, VAEnd.Uint64));
+  DEBUG ((DEBUG_VERBOSE, "PTE[%03x] at %p = %lx\n", VA.Pg4K.PTOffset, PTE4K, PTE4K->Uint64));
+  return PTE4K;
+}
+
+/** Puts PhysicalAddr in PTE4K as a present, writable 4K page. */
+STATIC
+VOID
+VmSetPte (
+  PAGE_TABLE_4K_ENTRY   *PTE4K,
+  EFI_PHYSICAL_ADDRESS  PhysicalAddr
+  )
+{
   if (PTE4K->Bits.Present) {
     DEBUG ((DEBUG_VERBOSE, "mapping already present - remapping!\n"));
   }
@@ -510,12 +558,58 @@ VmMapVirtualPage (
   PTE4K->Bits.ReadWrite = 1;
   PTE4K->Bits.Present = 1;
   DEBUG ((DEBUG_VERBOSE, "added to PTE4K as %lx\n", PTE4K->Uint64));
+}
+
+/** Maps (remaps) 4K page given by VirtualAddr to PhysicalAddr page in PageTable. */
+EFI_STATUS
+VmMapVirtualPage (
+  PAGE_MAP_AND_DIRECTORY_POINTER  *PageTable,
+  EFI_VIRTUAL_ADDRESS             VirtualAddr,
+  EFI_PHYSICAL_ADDRESS            PhysicalAddr
+  )
+{
+  VIRTUAL_ADDR                    VA;
+  PAGE_TABLE_4K_ENTRY             *PTE4K;
+
+  VA.Uint64 = (UINT64)VirtualAddr;
+  //VA_FIX_SIGN_EXTEND(VA);
+  DEBUG ((DEBUG_VERBOSE, "VmMapVirtualPage VA %lx => PA %lx\nPageTable: %p\n", VirtualAddr, PhysicalAddr, PageTable));
+
+  PTE4K = VmGetPte(PageTable, VA);
+  if (PTE4K == NULL) {
+    return EFI_NO_MAPPING;
+  }
+  VmSetPte(PTE4K, PhysicalAddr);
 
   return EFI_SUCCESS;
+}
 
+/** TRUE if the CPU can map 1GB pages (CPUID 0x80000001 EDX bit 26). */
+STATIC
+BOOLEAN
+VmHas1GPages (
+  VOID
+  )
+{
+  STATIC INTN  Has1GPages = -1;
+  UINT32       MaxExtLeaf;
+  UINT32       Edx;
+
+  if (Has1GPages < 0) {
+    Has1GPages = 0;
+    AsmCpuid (0x80000000, &MaxExtLeaf, NULL, NULL, NULL);
+    if (MaxExtLeaf >= 0x80000001) {
+      AsmCpuid (0x80000001, NULL, NULL, NULL, &Edx);
+      Has1GPages = (Edx & BIT26) != 0;
+    }
+  }
+  return Has1GPages != 0;
 }
 
-/** Maps (remaps) NumPages 4K pages given by VirtualAddr to PhysicalAddr pages in PageTable. */
+/** Maps (remaps) NumPages 4K pages given by VirtualAddr to PhysicalAddr pages in PageTable.
+  * The parts of the range where both addresses are 1GB or 2MB aligned are mapped with large pages.
+  * Between two large pages, the consecutive PTEs of one page table are written without a new walk.
+  */
 EFI_STATUS
 VmMapVirtualPages (
   PAGE_MAP_AND_DIRECTORY_POINTER  *PageTable,
@@ -524,17 +618,62 @@ VmMapVirtualPages (
   EFI_PHYSICAL_ADDRESS            PhysicalAddr
   )
 {
-  EFI_STATUS  Status;
-
-  Status = EFI_SUCCESS;
-  while (NumPages > 0 && (Status == EFI_SUCCESS)) {
-    Status = VmMapVirtualPage(PageTable, VirtualAddr, PhysicalAddr);
-    VirtualAddr += 0x1000;
-    PhysicalAddr += 0x1000;
-    NumPages--;
+  VIRTUAL_ADDR                    VA;
+  PAGE_MAP_AND_DIRECTORY_POINTER  *Entry;
+  PAGE_TABLE_2M_ENTRY             *PTE2M;
+  PAGE_TABLE_1G_ENTRY             *PTE1G;
+  PAGE_TABLE_4K_ENTRY             *PTE4K;
+  UINTN                           Pages;
+
+  PTE4K = NULL;
+  while (NumPages > 0) {
+    VA.Uint64 = (UINT64)VirtualAddr;
+    if (((VirtualAddr | PhysicalAddr) & (SIZE_1GB - 1)) == 0 && NumPages >= EFI_SIZE_TO_PAGES(SIZE_1GB) && VmHas1GPages()) {
+      Entry = VmGetPdpe(PageTable, VA);
+      if (Entry == NULL) {
+        return EFI_NO_MAPPING;
+      }
+      // a PDE table there is left unused : the pool pages are never freed anyway
+      PTE1G = (PAGE_TABLE_1G_ENTRY *)Entry;
+      PTE1G->Uint64 = ((UINT64)PhysicalAddr) & PT_ADDR_MASK_1G;
+      PTE1G->Bits.ReadWrite = 1;
+      PTE1G->Bits.Present = 1;
+      PTE1G->Bits.MustBe1 = 1;
+      DEBUG ((DEBUG_VERBOSE, "added to PDPE as 1GB page %lx\n", PTE1G->Uint64));
+      Pages = EFI_SIZE_TO_PAGES(SIZE_1GB);
+      PTE4K = NULL;
+    } else if (((VirtualAddr | PhysicalAddr) & (SIZE_2MB - 1)) == 0 && NumPages >= EFI_SIZE_TO_PAGES(SIZE_2MB)) {
+      Entry = VmGetPde(PageTable, VA);
+      if (Entry == NULL) {
+        return EFI_NO_MAPPING;
+      }
+      PTE2M = (PAGE_TABLE_2M_ENTRY *)Entry;
+      PTE2M->Uint64 = ((UINT64)PhysicalAddr) & PT_ADDR_MASK_2M;
+      PTE2M->Bits.ReadWrite = 1;
+      PTE2M->Bits.Present = 1;
+      PTE2M->Bits.MustBe1 = 1;
+      DEBUG ((DEBUG_VERBOSE, "added to PDE as 2MB page %lx\n", PTE2M->Uint64));
+      Pages = EFI_SIZE_TO_PAGES(SIZE_2MB);
+      PTE4K = NULL;
+    } else {
+      if (PTE4K != NULL && VA.Pg4K.PTOffset != 0) {
+        // still in the page table of the previous page
+        PTE4K++;
+      } else {
+        PTE4K = VmGetPte(PageTable, VA);
+        if (PTE4K == NULL) {
+          return EFI_NO_MAPPING;
+        }
+      }
+      VmSetPte(PTE4K, PhysicalAddr);
+      Pages = 1;
+    }
+    VirtualAddr += EFI_PAGES_TO_SIZE(Pages);
+    PhysicalAddr += EFI_PAGES_TO_SIZE(Pages);
+    NumPages -= Pages;
     DEBUG ((DEBUG_VERBOSE, "NumPages: %d, %lx => %lx\n", NumPages, VirtualAddr, PhysicalAddr));
   }
-  return Status;
+  return EFI_SUCCESS;
 }
 
 /** Flashes TLB caches. */
@@ -108,66 +108,93 @@ VOID egCopyPlane(IN UINT8 *SrcPlanePtr, IN UINT8 *DestPlanePtr, IN UINTN PixelCo
 }
 
 
-VOID egDecompressIcnsRLE(IN OUT UINT8 **CompData, IN OUT UINTN *CompLen, IN UINT8 *PixelData, IN UINTN PixelCount)
+//
+// Decode the RGB planes of an icns RLE block straight into the pixels: the planes follow each other in
+// the stream, a packet may continue into the next plane.
+//
+STATIC VOID egDecompressIcnsRGB(IN UINT8 *cp, IN UINTN CompLen, IN EFI_UGA_PIXEL *Pixels, IN UINTN PixelCount)
 {
-    UINT8 *cp;
-    UINT8 *cp_end;
-    UINT8 *pp;
-    UINTN pp_left;
-    UINTN len, i;
-    UINT8 value;
-    
-    // setup variables
-    cp = *CompData;
-    cp_end = cp + *CompLen;
-    pp = PixelData;
-    pp_left = PixelCount;
-    
-    // decode
-    while (cp + 1 < cp_end && pp_left > 0) {
-        len = *cp++;
-        if (len & 0x80) {   // compressed data: repeat next byte
-            len -= 125;
-            if (len > pp_left)
-                break;
-            value = *cp++;
-            for (i = 0; i < len; i++) {
-                *pp = value;
-                pp += 4;
-            }
-        } else {            // uncompressed data: copy bytes
-            len++;
-            if (len > pp_left || cp + len > cp_end)
-                break;
-            for (i = 0; i < len; i++) {
-                *pp = *cp++;
-                pp += 4;
-            }
+  STATIC CONST UINTN PlaneOffset[3] = {
+    OFFSET_OF(EFI_UGA_PIXEL, Red),
+    OFFSET_OF(EFI_UGA_PIXEL, Green),
+    OFFSET_OF(EFI_UGA_PIXEL, Blue)
+  };
+  UINT8   *cp_end = cp + CompLen;
+  UINTN   Plane = 0;
+  UINT8   *pp = (UINT8 *)Pixels + PlaneOffset[0];
+  UINTN   pp_left = PixelCount;
+  UINTN   len, n;
+  BOOLEAN Repeat;
+  UINT8   value;
+
+  while (cp + 1 < cp_end && Plane < 3) {
+    len = *cp++;
+    Repeat = (len & 0x80) != 0;
+    value = 0;
+    if (Repeat) {   // compressed data: repeat next byte
+      len -= 125;
+      value = *cp++;
+    } else {        // uncompressed data: copy bytes
+      len++;
+      if (cp + len > cp_end) {
+        break;
+      }
+    }
+    while (len > 0 && Plane < 3) {
+      n = (len < pp_left) ? len : pp_left;
+      len -= n;
+      pp_left -= n;
+      if (Repeat) {
+        for (; n > 0; n--, pp += 4) {
+          *pp = value;
         }
-        pp_left -= len;
+      } else {
+        for (; n > 0; n--, pp += 4) {
+          *pp = *cp++;
+        }
+      }
+      if (pp_left == 0 && ++Plane < 3) {
+        pp = (UINT8 *)Pixels + PlaneOffset[Plane];
+        pp_left = PixelCount;
+      }
     }
-    
-  if (pp_left > 0) {
-    DBG(" egDecompressIcnsRLE: still need %d bytes of pixel data\n", pp_left);
   }
-    
-    // record what's left of the compressed data stream
-    *CompData = cp;
-    *CompLen = (UINTN)(cp_end - cp);
+  if (Plane < 3) {
+    DBG(" egDecompressIcnsRGB: still need %d bytes of pixel data\n", (3 - Plane - 1) * PixelCount + pp_left);
+  } else if (cp < cp_end) {
+    DBG(" egDecompressIcnsRGB: %d bytes of compressed data left\n", (UINTN)(cp_end - cp));
+  }
 }
 
 //
 // Load Apple .icns icons
 //
 
+// the icns block types we can decode, one row per pixel size
+typedef struct {
+  UINTN  PixelSize;
+  UINT32 DataType;   // RGB, RLE compressed below 3 bytes per pixel
+  UINT32 MaskType;   // 8 bit alpha
+} ICNS_SIZE;
+
+#define ICNS_TYPE(a, b, c, d) (((UINT32)(a) << 24) | ((UINT32)(b) << 16) | ((UINT32)(c) << 8) | (UINT32)(d))
+
+STATIC CONST ICNS_SIZE IcnsSizes[] = {
+  {  16, ICNS_TYPE('i','s','3','2'), ICNS_TYPE('s','8','m','k') },
+  {  32, ICNS_TYPE('i','l','3','2'), ICNS_TYPE('l','8','m','k') },
+  {  48, ICNS_TYPE('i','h','3','2'), ICNS_TYPE('h','8','m','k') },
+  { 128, ICNS_TYPE('i','t','3','2'), ICNS_TYPE('t','8','m','k') },
+};
+#define ICNS_SIZE_COUNT (sizeof(IcnsSizes) / sizeof(IcnsSizes[0]))
+
 EG_IMAGE * egDecodeICNS(IN UINT8 *FileData, IN UINTN FileDataLength, IN UINTN IconSize, IN BOOLEAN WantAlpha)
 {
     EG_IMAGE            *NewImage;
-    UINT8               *Ptr, *BufferEnd, *DataPtr, *MaskPtr;
-    UINT32              BlockLen, DataLen, MaskLen;
-    UINTN               FetchPixelSize, PixelCount, i;
-    UINT8               *CompData;
-    UINTN               CompLen;
+    UINT8               *Ptr, *BufferEnd;
+    UINT8               *DataPtr[ICNS_SIZE_COUNT], *MaskPtr[ICNS_SIZE_COUNT];
+    UINT32              DataLen[ICNS_SIZE_COUNT], MaskLen[ICNS_SIZE_COUNT];
+    UINT32              BlockType, BlockLen;
+    UINTN               Index, Best, FetchPixelSize, PixelCount, i;
     UINT8               *SrcPtr;
     EFI_UGA_PIXEL       *DestPtr;
     
@@ -178,78 +205,54 @@ EG_IMAGE * egDecodeICNS(IN UINT8 *FileData, IN UINTN FileDataLength, IN UINTN Ic
       return NULL;
     }
     
-    FetchPixelSize = IconSize;
-    for (;;) {
-        DataPtr = NULL;
-        DataLen = 0;
-        MaskPtr = NULL;
-        MaskLen = 0;
-        
-        Ptr = FileData + 8;
-        BufferEnd = FileData + FileDataLength;
-        // iterate over tagged blocks in the file
-        while (Ptr + 8 <= BufferEnd) {
-            BlockLen = ((UINT32)Ptr[4] << 24) + ((UINT32)Ptr[5] << 16) + ((UINT32)Ptr[6] << 8) + (UINT32)Ptr[7];
-            if (Ptr + BlockLen > BufferEnd)   // block continues beyond end of file
-                break;
-            
-            // extract the appropriate blocks for each pixel size
-            if (FetchPixelSize == 128) {
-                if (Ptr[0] == 'i' && Ptr[1] == 't' && Ptr[2] == '3' && Ptr[3] == '2') {
-                    if (Ptr[8] == 0 && Ptr[9] == 0 && Ptr[10] == 0 && Ptr[11] == 0) {
-                        DataPtr = Ptr + 12;
-                        DataLen = BlockLen - 12;
+    // one walk over the tagged blocks, remembering where each size is. Nothing is decoded yet
+    ZeroMem(DataPtr, sizeof(DataPtr));
+    ZeroMem(MaskPtr, sizeof(MaskPtr));
+    ZeroMem(DataLen, sizeof(DataLen));
+    ZeroMem(MaskLen, sizeof(MaskLen));
+    Ptr = FileData + 8;
+    BufferEnd = FileData + FileDataLength;
+    while (Ptr + 8 <= BufferEnd) {
+        BlockType = ICNS_TYPE(Ptr[0], Ptr[1], Ptr[2], Ptr[3]);
+        BlockLen = ((UINT32)Ptr[4] << 24) + ((UINT32)Ptr[5] << 16) + ((UINT32)Ptr[6] << 8) + (UINT32)Ptr[7];
+        if (BlockLen < 8 || BlockLen > (UINTN)(BufferEnd - Ptr))   // block continues beyond end of file
+            break;
+        for (Index = 0; Index < ICNS_SIZE_COUNT; Index++) {
+            if (BlockType == IcnsSizes[Index].DataType) {
+                if (IcnsSizes[Index].PixelSize == 128) { // it32 data starts with 4 zero bytes
+                    if (BlockLen >= 12 && Ptr[8] == 0 && Ptr[9] == 0 && Ptr[10] == 0 && Ptr[11] == 0) {
+                        DataPtr[Index] = Ptr + 12;
+                        DataLen[Index] = BlockLen - 12;
                     }
-                } else if (Ptr[0] == 't' && Ptr[1] == '8' && Ptr[2] == 'm' && Ptr[3] == 'k') {
-                    MaskPtr = Ptr + 8;
-                    MaskLen = BlockLen - 8;
-                }
-                
-            } else if (FetchPixelSize == 48) {
-                if (Ptr[0] == 'i' && Ptr[1] == 'h' && Ptr[2] == '3' && Ptr[3] == '2') {
-                    DataPtr = Ptr + 8;
-                    DataLen = BlockLen - 8;
-                } else if (Ptr[0] == 'h' && Ptr[1] == '8' && Ptr[2] == 'm' && Ptr[3] == 'k') {
-                    MaskPtr = Ptr + 8;
-                    MaskLen = BlockLen - 8;
+                } else {
+                    DataPtr[Index] = Ptr + 8;
+                    DataLen[Index] = BlockLen - 8;
                 }
-                
-            } else if (FetchPixelSize == 32) {
-                if (Ptr[0] == 'i' && Ptr[1] == 'l' && Ptr[2] == '3' && Ptr[3] == '2') {
-                    DataPtr = Ptr + 8;
-                    DataLen = BlockLen - 8;
-                } else if (Ptr[0] == 'l' && Ptr[1] == '8' && Ptr[2] == 'm' && Ptr[3] == 'k') {
-                    MaskPtr = Ptr + 8;
-                    MaskLen = BlockLen - 8;
-                }
-                
-            } else if (FetchPixelSize == 16) {
-                if (Ptr[0] == 'i' && Ptr[1] == 's' && Ptr[2] == '3' && Ptr[3] == '2') {
-                    DataPtr = Ptr + 8;
-                    DataLen = BlockLen - 8;
-                } else if (Ptr[0] == 's' && Ptr[1] == '8' && Ptr[2] == 'm' && Ptr[3] == 'k') {
-                    MaskPtr = Ptr + 8;
-                    MaskLen = BlockLen - 8;
-                }
-                
+            } else if (BlockType == IcnsSizes[Index].MaskType) {
+                MaskPtr[Index] = Ptr + 8;
+                MaskLen[Index] = BlockLen - 8;
             }
-            
-            Ptr += BlockLen;
         }
-        //TODO - take different larger size if not found
-        // FUTURE: try to load a different size and scale it later
-            if (DataPtr == NULL && FetchPixelSize == 128) {
-                FetchPixelSize = 32;
-                continue;
-            }
-        
-        break;
+        Ptr += BlockLen;
+    }
+    
+    // the requested size, else the smallest bigger one, else the biggest we have
+    Best = ICNS_SIZE_COUNT;
+    for (Index = 0; Index < ICNS_SIZE_COUNT; Index++) {
+        if (DataPtr[Index] == NULL) {
+            continue;
+        }
+        if (Best == ICNS_SIZE_COUNT ||
+            (IcnsSizes[Best].PixelSize < IconSize && IcnsSizes[Index].PixelSize > IcnsSizes[Best].PixelSize)) {
+            Best = Index;
+        }
     }
     
-  if (DataPtr == NULL) {
+  if (Best == ICNS_SIZE_COUNT) {
     DBG("not found such IconSize\n");
     return NULL;   // no image found
   }
+    FetchPixelSize = IcnsSizes[Best].PixelSize;
     
     // allocate image structure and buffer
     NewImage = egCreateImage(FetchPixelSize, FetchPixelSize, WantAlpha);
@@ -257,39 +260,27 @@ EG_IMAGE * egDecodeICNS(IN UINT8 *FileData, IN UINTN FileDataLength, IN UINTN Ic
         return NULL;
     PixelCount = FetchPixelSize * FetchPixelSize;
     
-    if (DataLen < PixelCount * 3) {
-        
+    if (DataLen[Best] < PixelCount * 3) {
         // pixel data is compressed, RGB planar
-        CompData = DataPtr;
-        CompLen  = DataLen;
-        egDecompressIcnsRLE(&CompData, &CompLen, PLPTR(NewImage, Red), PixelCount);
-        egDecompressIcnsRLE(&CompData, &CompLen, PLPTR(NewImage, Green), PixelCount);
-        egDecompressIcnsRLE(&CompData, &CompLen, PLPTR(NewImage, Blue), PixelCount);
-        // possible assertion: CompLen == 0
-        if (CompLen > 0) {
-            DBG(" egLoadICNSIcon: %d bytes of compressed data left\n", CompLen);
-        }
-        
+        egDecompressIcnsRGB(DataPtr[Best], DataLen[Best], NewImage->PixelData, PixelCount);
     } else {
-        
         // pixel data is uncompressed, RGB interleaved
-        SrcPtr  = DataPtr;
+        SrcPtr  = DataPtr[Best];
         DestPtr = NewImage->PixelData;
         for (i = 0; i < PixelCount; i++, DestPtr++) {
             DestPtr->Red = *SrcPtr++;
             DestPtr->Green = *SrcPtr++;
             DestPtr->Blue = *SrcPtr++;
         }
-        
     }
     
     // add/set alpha plane
-    if (MaskPtr != NULL && MaskLen >= PixelCount && WantAlpha)
-        egInsertPlane(MaskPtr, PLPTR(NewImage, Reserved), PixelCount);
+    if (MaskPtr[Best] != NULL && MaskLen[Best] >= PixelCount && WantAlpha)
+        egInsertPlane(MaskPtr[Best], PLPTR(NewImage, Reserved), PixelCount);
     else
         egSetPlane(PLPTR(NewImage, Reserved), WantAlpha ? 255 : 0, PixelCount);
     
-    // FUTURE: scale to originally requested size if we had to load another size
+    // the codec has no scaler, a different size is returned as it is
     
     return NewImage;
 }
@@ -12,6 +12,7 @@
 **/
 
 #include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/DebugLib.h>
@@ -127,15 +128,16 @@ KeyMapCreateKeyStrokesBuffer (
     gBS->FreePool((VOID *)Aggregator->KeyBuffer);
   }
   
+  // KeyBuffer gets the merge of all pending reports of all keyboards, in keys not bytes
   BufferSize                 = (Aggregator->KeyBuffersSize + KeyBufferSize);
   Aggregator->KeyBuffersSize = BufferSize;
-  Memory                     = AllocateZeroPool(BufferSize);
+  Memory                     = AllocateZeroPool(BufferSize * APPLE_KEY_REPORTS_NUM * sizeof (APPLE_KEY_CODE));
   Aggregator->KeyBuffer      = Memory;
   Status                     = EFI_OUT_OF_RESOURCES;
   
   if (Memory != NULL) {
     KeyStrokesInfo = AllocateZeroPool(sizeof (APPLE_KEY_STROKES_INFO)
-                                       + (KeyBufferSize * sizeof (APPLE_KEY_CODE)));
+                                       + (APPLE_KEY_REPORTS_NUM * KeyBufferSize * sizeof (APPLE_KEY_CODE)));
     Status         = EFI_OUT_OF_RESOURCES;
     
     if (KeyStrokesInfo != NULL) {
@@ -201,6 +203,10 @@ KeyMapSetKeyStrokeBufferKeys (
   
   APPLE_KEY_MAP_AGGREGATOR *Aggregator;
   APPLE_KEY_STROKES_INFO   *KeyStrokesInfo;
+  APPLE_KEY_REPORT         *Report;
+  APPLE_KEY_CODE           *SlotKeys;
+  UINTN                    Head;
+  UINTN                    Slot;
   
   if (!This || !Keys) {
     return EFI_INVALID_PARAMETER;
@@ -214,18 +220,98 @@ KeyMapSetKeyStrokeBufferKeys (
     Status = EFI_OUT_OF_RESOURCES;
     
     if (KeyStrokesInfo->Hdr.KeyBufferSize >= NumberOfKeys) {
-      KeyStrokesInfo->Hdr.NumberOfKeys = NumberOfKeys;
-      KeyStrokesInfo->Hdr.Modifiers    = Modifiers;
+      Status = EFI_SUCCESS;
+      Head   = KeyStrokesInfo->Hdr.Head;
       
-      CopyMem((VOID *)&KeyStrokesInfo->Keys, (VOID *)Keys, (NumberOfKeys * sizeof(APPLE_KEY_CODE)));
+      // Keyboards report on every poll, an unchanged state does not take a slot
+      if (Head > 0) {
+        Slot     = (Head - 1) & (APPLE_KEY_REPORTS_NUM - 1);
+        Report   = &KeyStrokesInfo->Hdr.Reports[Slot];
+        SlotKeys = &(&KeyStrokesInfo->Keys)[Slot * KeyStrokesInfo->Hdr.KeyBufferSize];
+        if ((Report->NumberOfKeys == NumberOfKeys) && (Report->Modifiers == Modifiers)
+         && (CompareMem ((VOID *)SlotKeys, (VOID *)Keys, (NumberOfKeys * sizeof(APPLE_KEY_CODE))) == 0)) {
+          return Status;
+        }
+      }
       
-      Status = EFI_SUCCESS;
+      Slot                 = Head & (APPLE_KEY_REPORTS_NUM - 1);
+      Report               = &KeyStrokesInfo->Hdr.Reports[Slot];
+      SlotKeys             = &(&KeyStrokesInfo->Keys)[Slot * KeyStrokesInfo->Hdr.KeyBufferSize];
+      Report->NumberOfKeys = NumberOfKeys;
+      Report->Modifiers    = Modifiers;
+      
+      CopyMem((VOID *)SlotKeys, (VOID *)Keys, (NumberOfKeys * sizeof(APPLE_KEY_CODE)));
+      
+      // publish the slot only once it is complete
+      MemoryFence ();
+      KeyStrokesInfo->Hdr.Head = Head + 1;
     }
   }
   
   return Status;
 }
 
+// KeyMapMergeKeyStrokes
+// Adds the reports of one keyboard not read yet to the aggregated state, or its last report if there is
+// no new one, so that keys pressed and released between two ReadKeyState are not lost.
+// Keys already in KeyBuffer are not added again.
+STATIC
+VOID
+KeyMapMergeKeyStrokes (
+                       IN     APPLE_KEY_MAP_AGGREGATOR *Aggregator,
+                       IN     APPLE_KEY_STROKES_INFO   *KeyStrokesInfo,
+                       IN OUT APPLE_MODIFIER_MAP       *DbModifiers,
+                       IN OUT UINTN                    *DbNoKeyStrokes
+                       )
+{
+  APPLE_KEY_REPORT *Report;
+  APPLE_KEY_CODE   *SlotKeys;
+  APPLE_KEY_CODE   Key;
+  UINTN            Head;
+  UINTN            First;
+  UINTN            Slot;
+  UINTN            Index;
+  UINTN            Index2;
+  
+  Head = KeyStrokesInfo->Hdr.Head;
+  KeyStrokesInfo->Hdr.Merged = Head;
+  // slots up to Head are complete
+  MemoryFence ();
+  
+  if (Head == 0) {
+    return;
+  }
+  
+  First = KeyStrokesInfo->Hdr.Tail;
+  if (First == Head) {
+    // nothing new, the last report is still the current state
+    First = Head - 1;
+  } else if ((Head - First) > APPLE_KEY_REPORTS_NUM) {
+    // not read for too long, the oldest reports were overwritten
+    First = Head - APPLE_KEY_REPORTS_NUM;
+  }
+  
+  for (; First != Head; ++First) {
+    Slot     = First & (APPLE_KEY_REPORTS_NUM - 1);
+    Report   = &KeyStrokesInfo->Hdr.Reports[Slot];
+    SlotKeys = &(&KeyStrokesInfo->Keys)[Slot * KeyStrokesInfo->Hdr.KeyBufferSize];
+    
+    *DbModifiers |= Report->Modifiers;
+    for (Index = 0; Index < Report->NumberOfKeys; ++Index) {
+      Key = SlotKeys[Index];
+      for (Index2 = 0; Index2 < *DbNoKeyStrokes; ++Index2) {
+        if (Aggregator->KeyBuffer[Index2] == Key) {
+          break;
+        }
+      }
+      if (*DbNoKeyStrokes == Index2) {
+        Aggregator->KeyBuffer[*DbNoKeyStrokes] = Key;
+        ++(*DbNoKeyStrokes);
+      }
+    }
+  }
+}
+
 //->ReadKeyState(), count=1, flags=0x0 states={7028,0}, status=Success
 EFI_STATUS
 EFIAPI
@@ -241,9 +327,6 @@ ReadKeyState (APPLE_KEY_STATE_PROTOCOL* This,
   APPLE_MODIFIER_MAP       DbModifiers;
   BOOLEAN                  Result;
   UINTN                    DbNoKeyStrokes;
-  UINTN                    Index;
-  UINTN                    Index2;
-  APPLE_KEY_CODE                Key;
   
   if (!This || !ModifyFlags || !PressedKeyCount) {
     return EFI_INVALID_PARAMETER;
@@ -262,23 +345,7 @@ ReadKeyState (APPLE_KEY_STATE_PROTOCOL* This,
     DbNoKeyStrokes    = 0;
     
     do {
-      DbModifiers |= KeyStrokesInfo->Hdr.Modifiers;     
-      if (KeyStrokesInfo->Hdr.NumberOfKeys > 0) {
-        Index = 0;        
-        do {
-          Key = (&KeyStrokesInfo->Keys)[Index];
-          ++Index;          
-          for (Index2 = 0; Index2 < DbNoKeyStrokes; ++Index2) {
-            if (Aggregator->KeyBuffer[Index2] == Key) {
-              break;
-            }
-          }          
-          if (DbNoKeyStrokes == Index2) {
-            Aggregator->KeyBuffer[DbNoKeyStrokes] = Key;
-            ++DbNoKeyStrokes;
-          }
-        } while (Index < KeyStrokesInfo->Hdr.NumberOfKeys);
-      }
+      KeyMapMergeKeyStrokes (Aggregator, KeyStrokesInfo, &DbModifiers, &DbNoKeyStrokes);
       
       KeyStrokesInfo = APPLE_KEY_STROKES_INFO_FROM_LIST_ENTRY (
                                                                GetNextNode (&Aggregator->KeyStrokesInfoList,
@@ -292,8 +359,17 @@ ReadKeyState (APPLE_KEY_STATE_PROTOCOL* This,
     Status  = EFI_BUFFER_TOO_SMALL;
     
     if (Result) {
+      // reports stay pending for the retry with a larger buffer
       return Status;
     }
+    
+    // the merged reports are consumed
+    for (KeyStrokesInfo = APPLE_KEY_STROKES_INFO_FROM_LIST_ENTRY (GetFirstNode (&Aggregator->KeyStrokesInfoList));
+         !IsNull (&Aggregator->KeyStrokesInfoList, &KeyStrokesInfo->Hdr.This);
+         KeyStrokesInfo = APPLE_KEY_STROKES_INFO_FROM_LIST_ENTRY (GetNextNode (&Aggregator->KeyStrokesInfoList,
+                                                                               &KeyStrokesInfo->Hdr.This))) {
+      KeyStrokesInfo->Hdr.Tail = KeyStrokesInfo->Hdr.Merged;
+    }
   }
   
   *ModifyFlags = DbModifiers;
@@ -48,17 +48,34 @@ typedef struct _EFI_LIST_ENTRY {
 typedef EFI_LIST_ENTRY EFI_LIST;
 */
 
+// Reports kept per keyboard until ReadKeyState, power of 2.
+// A key pressed and released between two reads is still returned once.
+#define APPLE_KEY_REPORTS_NUM  8
+
+// APPLE_KEY_REPORT
+typedef struct {
+  UINTN              NumberOfKeys;   ///<
+  APPLE_MODIFIER_MAP Modifiers;      ///<
+} APPLE_KEY_REPORT;
+
 // APPLE_KEY_STROKES_INFO_HDR
+// Reports is a ring with a single writer (SetKeyStrokeBufferKeys from the keyboard driver,
+// possibly at TPL_NOTIFY) and a single reader (ReadKeyState), no lock and no TPL raise.
+// The writer fills slot Head % APPLE_KEY_REPORTS_NUM then publishes it by incrementing Head,
+// the reader merges the slots Tail..Head-1 and moves Tail up to Head.
 typedef struct {
   UINTN              Signature;      ///<
   LIST_ENTRY         This;           ///<
   UINTN              Index;          ///<
   UINTN              KeyBufferSize;  ///<
-  UINTN              NumberOfKeys;   ///<
-  APPLE_MODIFIER_MAP Modifiers;      ///<
+  volatile UINTN     Head;           ///< reports written
+  UINTN              Tail;           ///< reports read
+  UINTN              Merged;         ///< Head seen by the last merge, becomes Tail once the keys are returned
+  APPLE_KEY_REPORT   Reports[APPLE_KEY_REPORTS_NUM];  ///<
 } APPLE_KEY_STROKES_INFO_HDR;
 
 // APPLE_KEY_STROKES_INFO
+// Keys is APPLE_KEY_REPORTS_NUM * KeyBufferSize codes, KeyBufferSize per report slot
 typedef struct {
   APPLE_KEY_STROKES_INFO_HDR Hdr;   ///<
   APPLE_KEY_CODE                  Keys;  ///<
@@ -69,7 +86,7 @@ typedef struct {
 typedef struct {
   UINTN                             Signature;           ///<0
   UINTN                             NextKeyStrokeIndex;  ///<0x08
-  APPLE_KEY_CODE                         *KeyBuffer;          ///<0x10
+  APPLE_KEY_CODE                         *KeyBuffer;          ///<0x10 APPLE_KEY_REPORTS_NUM * KeyBuffersSize codes
   UINTN                             KeyBuffersSize;      ///<0x18
   LIST_ENTRY                        KeyStrokesInfoList;  ///<0x20
   APPLE_KEY_MAP_DATABASE_PROTOCOL   DatabaseProtocol;    ///<0x30 size=8*4
@@ -13,6 +13,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 **/
 
 #include "AIK.h"
+#include "../Timer/AIT.h"
 
 #include <Library/DebugLib.h>
 #include <Library/UefiBootServicesTableLib.h>
@@ -133,6 +134,7 @@ AIKPollKeyboardHandler (
         ));
       AIKDataWriteEntry (&Keycode->Data, &KeyData);
       AIKTargetWriteEntry (&Keycode->Target, &KeyData);
+      AITInputActivity ();
     }
 
     Index++;
@@ -13,6 +13,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 **/
 
 #include "AIM.h"
+#include "../Timer/AIT.h"
 
 #include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
@@ -240,6 +241,7 @@ AmiShimPointerPositionHandler (
             Pointer->PositionY += PositionState.PositionY;
             Pointer->PositionZ += PositionState.PositionZ;
             Pointer->PositionChanged = TRUE;
+            AITInputActivity ();
           }
         } else {
           //FIXME: Add support for devices with absolute positioning
@@ -270,6 +272,10 @@ AmiShimPointerUpdateState (
     return EFI_NOT_READY;
   }
 
+  if (ButtonState.Changed) {
+    AITInputActivity ();
+  }
+
   DEBUG ((DEBUG_VERBOSE, "Button: %d %d %d %d, Position: %d %d %d %d\n",
     ButtonState.Changed, ButtonState.LeftButton, ButtonState.MiddleButton, ButtonState.RightButton,
     Pointer->PositionChanged, Pointer->PositionX, Pointer->PositionY, Pointer->PositionZ));
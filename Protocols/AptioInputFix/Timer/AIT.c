@@ -20,6 +20,54 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 
 STATIC UINTN                    mOriginalTimerPeriod;
 STATIC EFI_TIMER_ARCH_PROTOCOL  *mTimerProtocol;
+STATIC BOOLEAN                  mBoosted;
+STATIC UINTN                    mIdleChecks;
+STATIC EFI_EVENT                mIdleEvent;
+
+STATIC
+VOID
+AITSetBoost (
+  IN BOOLEAN  Boost
+  )
+{
+  EFI_STATUS  Status;
+
+  Status = mTimerProtocol->SetTimerPeriod (mTimerProtocol, Boost ? AIT_TIMER_PERIOD : mOriginalTimerPeriod);
+  if (!EFI_ERROR(Status)) {
+    mBoosted = Boost;
+  } else {
+    DEBUG ((DEBUG_INFO, "AIFTimerBoost failed to %a period - %r\n", Boost ? "boost" : "restore", Status));
+  }
+}
+
+STATIC
+VOID
+EFIAPI
+AITIdleHandler (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  if (mTimerProtocol == NULL || !mBoosted) {
+    return;
+  }
+
+  mIdleChecks++;
+  if (mIdleChecks >= AIT_IDLE_CHECKS) {
+    AITSetBoost (FALSE);
+  }
+}
+
+VOID
+AITInputActivity (
+  VOID
+  )
+{
+  mIdleChecks = 0;
+  if (mTimerProtocol != NULL && !mBoosted) {
+    AITSetBoost (TRUE);
+  }
+}
 
 EFI_STATUS
 AITInit (
@@ -40,6 +88,18 @@ AITInit (
         if (!EFI_ERROR(Status)) {
           DEBUG ((DEBUG_INFO, "AIFTimerBoostInit changed period %d to %d\n",
             mOriginalTimerPeriod, AIT_TIMER_PERIOD));
+          mBoosted = TRUE;
+          //
+          // Idle detection, without it the boost stays on as before.
+          //
+          if (!EFI_ERROR(gBS->CreateEvent (EVT_TIMER | EVT_NOTIFY_SIGNAL, TPL_NOTIFY, AITIdleHandler, NULL, &mIdleEvent))) {
+            if (EFI_ERROR(gBS->SetTimer (mIdleEvent, TimerPeriodic, AIT_IDLE_CHECK_INTERVAL))) {
+              gBS->CloseEvent (mIdleEvent);
+              mIdleEvent = NULL;
+            }
+          } else {
+            mIdleEvent = NULL;
+          }
         } else {
           DEBUG ((DEBUG_INFO, "AIFTimerBoostInit failed to change period %d to %d, error - %r\n",
             mOriginalTimerPeriod, AIT_TIMER_PERIOD, Status));
@@ -67,6 +127,12 @@ AITExit (
 
   Status = EFI_SUCCESS;
 
+  if (mIdleEvent != NULL) {
+    gBS->SetTimer (mIdleEvent, TimerCancel, 0);
+    gBS->CloseEvent (mIdleEvent);
+    mIdleEvent = NULL;
+  }
+
   if (mTimerProtocol != NULL) {
     //
     // You are not allowed to call this on APTIO IV, as it results in an interrupt with 0x0 pointer
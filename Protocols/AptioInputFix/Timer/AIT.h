@@ -23,11 +23,28 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 //
 #define AIT_TIMER_PERIOD  EFI_TIMER_PERIOD_MILLISECONDS(5)
 
+//
+// The boosted rate costs CPU time to everything else, so it is only kept while there is input:
+// without key or pointer input for AIT_IDLE_CHECKS checks of AIT_IDLE_CHECK_INTERVAL
+// the original period is restored, the next input boosts it again.
+//
+#define AIT_IDLE_CHECK_INTERVAL  EFI_TIMER_PERIOD_MILLISECONDS(100)
+#define AIT_IDLE_CHECKS          20
+
 EFI_STATUS
 AITInit (
   VOID
   );
 
+/**
+  Reports key or pointer input, keeps or restores the boosted timer rate.
+  Called from the input polling handlers at TPL_NOTIFY.
+**/
+VOID
+AITInputActivity (
+  VOID
+  );
+
 EFI_STATUS
 AITExit (
   VOID
@@ -80,6 +80,7 @@ OvrAllocatePages(
 //	EFI_PHYSICAL_ADDRESS	inMemory = *Memory;
 	
 	Status = gOrgBS.AllocatePages(Type, MemoryType, NumberOfPages, Memory);
+	TRACE(ALLOCATE_PAGES, Status, Type, MemoryType, NumberOfPages, (Memory != NULL) ? *Memory : 0);
 //	PRINT("-> AllocatePages(%s, %s, 0x%x, 0x%lx/0x%lx) = %r\n", EfiAllocateTypeDesc[Type], EfiMemoryTypeDesc[MemoryType], NumberOfPages, inMemory, *Memory, Status);
 	return Status;
 }
@@ -93,6 +94,7 @@ OvrFreePages(
 	EFI_STATUS			Status;
 	
 	Status = gOrgBS.FreePages(Memory, Pages);
+	TRACE(FREE_PAGES, Status, Memory, Pages, 0, 0);
 //	PRINT("->FreePages(0x%lx, 0x%x) = %r\n", Memory, Pages, Status);
 	return Status;
 }
@@ -110,6 +112,7 @@ OvrGetMemoryMap(
 //	UINTN				inMemoryMapSize = *MemoryMapSize;
 	
 	Status = gOrgBS.GetMemoryMap(MemoryMapSize, MemoryMap, MapKey, DescriptorSize, DescriptorVersion);
+	TRACE(GET_MEMORY_MAP, Status, (MemoryMapSize != NULL) ? *MemoryMapSize : 0, TRACE_PTR(MemoryMap), (MapKey != NULL) ? *MapKey : 0, 0);
 	// if print to console, then ExitBootServices will not work
 //	PRINT("->GetMemoryMap(0x%x/0x%x, %p, 0x%x, 0x%x, 0x%x) = %r\n", inMemoryMapSize, *MemoryMapSize, MemoryMap, *MapKey, *DescriptorSize, *DescriptorVersion, Status);
 	if (Status == EFI_SUCCESS) {
@@ -131,6 +134,7 @@ OvrAllocatePool(
 	EFI_STATUS			Status;
 	
 	Status = gOrgBS.AllocatePool(PoolType, Size, Buffer);
+	TRACE(ALLOCATE_POOL, Status, PoolType, Size, TRACE_PTR((Buffer != NULL) ? *Buffer : NULL), 0);
 	// printing to console requires AllocatePool - recursion, but this is solved by safety check in LogPrint
 	// do not print to serial - too many calls from UEFI
 	//DebugPrint(1, "->AllocatePool(%s, 0x%x, %p) = %r\n", EfiMemoryTypeDesc[PoolType], Size, *Buffer, Status);
@@ -148,6 +152,7 @@ OvrFreePool(
 	EFI_STATUS			Status;
 	
 	Status = gOrgBS.FreePool(Buffer);
+	TRACE(FREE_POOL, Status, TRACE_PTR(Buffer), 0, 0, 0);
 	// do not print to console - requires FreePool - recursion
 	// do not print to serial - too many calls from UEFI
 	//DebugPrint(1, "->FreePool(%p) = %r\n", Buffer, Status);
@@ -166,6 +171,7 @@ OvrCreateEvent(
 	EFI_STATUS			Status;
 	
 	Status = gOrgBS.CreateEvent(Type, NotifyTpl, NotifyFunction, NotifyContext, Event);
+	TRACE(CREATE_EVENT, Status, Type, NotifyTpl, TRACE_PTR(NotifyFunction), TRACE_PTR(NotifyContext));
 	//PRINT("->CreateEvent(0x%x, 0x%x, %p, %p, %p) = %r\n", Type, NotifyTpl, NotifyFunction, NotifyContext, *Event, Status);
 	return Status;
 }
@@ -180,6 +186,7 @@ OvrSetTimer(
 	EFI_STATUS			Status;
 	
 	Status = gOrgBS.SetTimer(Event, Type, TriggerTime);
+	TRACE(SET_TIMER, Status, TRACE_PTR(Event), Type, TriggerTime, 0);
 //	PRINT("->SetTimer(%p, %d, 0x%x) = %r\n", Event, Type, TriggerTime, Status);
 	return Status;
 }
@@ -194,6 +201,7 @@ OvrWaitForEvent(
 	EFI_STATUS			Status;
 	
 	Status = gOrgBS.WaitForEvent(NumberOfEvents, Event, Index);
+	TRACE(WAIT_FOR_EVENT, Status, NumberOfEvents, TRACE_PTR(Event), 0, 0);
 //	PRINT("->WaitForEvent(%d, %p, %d) = %r\n", NumberOfEvents, *Event, *Index, Status);
 	return Status;
 }
@@ -206,6 +214,7 @@ OvrSignalEvent(
 	EFI_STATUS			Status;
 	
 	Status = gOrgBS.SignalEvent(Event);
+	TRACE(SIGNAL_EVENT, Status, TRACE_PTR(Event), 0, 0, 0);
 	//PRINT("->SignalEvent(%p) = %r\n", Event, Status);
 	return Status;
 }
@@ -218,6 +227,7 @@ OvrCloseEvent(
 	EFI_STATUS			Status;
 	
 	Status = gOrgBS.CloseEvent(Event);
+	TRACE(CLOSE_EVENT, Status, TRACE_PTR(Event), 0, 0, 0);
 	//PRINT("->CloseEvent(%p) = %r\n", Event, Status);
 	return Status;
 }
@@ -230,6 +240,7 @@ OvrCheckEvent(
 	EFI_STATUS			Status;
 	
 	Status = gOrgBS.CheckEvent(Event);
+	TRACE(CHECK_EVENT, Status, TRACE_PTR(Event), 0, 0, 0);
 	//PRINT("->CheckEvent(%p) = %r\n", Event, Status);
 	return Status;
 }
@@ -245,6 +256,7 @@ OvrInstallProtocolInterface(
 	EFI_STATUS			Status;
 	
 	Status = gOrgBS.InstallProtocolInterface(Handle, Protocol, InterfaceType, Interface);
+	TRACE(INSTALL_PROTOCOL_INTERFACE, Status, TRACE_PTR(Handle), TRACE_PTR(Protocol), InterfaceType, TRACE_PTR(Interface));
 	PRINT("->InstallProtocolInterface(%p, %s, %d, %p) = %r\n", Handle, GuidStr(Protocol), InterfaceType, Interface, Status);
 	return Status;
 }
@@ -260,6 +272,7 @@ OvrReinstallProtocolInterface(
 	EFI_STATUS			Status;
 	
 	Status = gOrgBS.ReinstallProtocolInterface(Handle, Protocol, OldInterface, NewInterface);
+	TRACE(REINSTALL_PROTOCOL_INTERFACE, Status, TRACE_PTR(Handle), TRACE_PTR(Protocol), TRACE_PTR(OldInterface), TRACE_PTR(NewInterface));
 	PRINT("->ReinstallProtocolInterface(%p, %s, %p, %p) = %r\n", Handle, GuidStr(Protocol), OldInterface, NewInterface, Status);
 	return Status;
 }
@@ -274,6 +287,7 @@ OvrUninstallProtocolInterface(
 	EFI_STATUS			Status;
 	
 	Status = gOrgBS.UninstallProtocolInterface(Handle, Protocol, Interface);
+	TRACE(UNINSTALL_PROTOCOL_INTERFACE, Status, TRACE_PTR(Handle), TRACE_PTR(Protocol), TRACE_PTR(Interface), 0);
 	PRINT("->UninstallProtocolInterface(%p, %s, %p) = %r\n", Handle, GuidStr(Protocol), Interface, Status);
 	return Status;
 }
@@ -288,6 +302,7 @@ OvrHandleProtocol(
 	EFI_STATUS			Status;
 	
 	Status = gOrgBS.HandleProtocol(Handle, Protocol, Interface);
+	TRACE(HANDLE_PROTOCOL, Status, TRACE_PTR(Handle), TRACE_PTR(Protocol), TRACE_PTR(*Interface), 0);
 #if HANDLE_PROTOCOL
 	PRINT("->HandleProtocol(%p, %s, %p) = %r\n", Handle, GuidStr(Protocol), *Interface, Status);
 #endif
@@ -304,6 +319,7 @@ OvrRegisterProtocolNotify(
 	EFI_STATUS			Status;
 	
 	Status = gOrgBS.RegisterProtocolNotify(Protocol, Event, Registration);
+	TRACE(REGISTER_PROTOCOL_NOTIFY, Status, TRACE_PTR(Protocol), TRACE_PTR(Event), TRACE_PTR(*Registration), 0);
 	PRINT("->RegisterProtocolNotify(%s, %p, %p) = %r\n", GuidStr(Protocol), Event, *Registration, Status);
 	return Status;
 }
@@ -321,6 +337,7 @@ OvrLocateHandle(
 	UINTN				BufferSizeIn = *BufferSize;
 	
 	Status = gOrgBS.LocateHandle(SearchType, Protocol, SearchKey, BufferSize, Buffer);
+	TRACE(LOCATE_HANDLE, Status, SearchType, TRACE_PTR(Protocol), *BufferSize, TRACE_PTR(Buffer));
 	PRINT("->LocateHandle(%d, %s, %p, 0x%x/0x%x, %p) = %r\n", SearchType, GuidStr(Protocol), SearchKey, BufferSizeIn, *BufferSize, Buffer, Status);
 	return Status;
 }
@@ -336,6 +353,7 @@ OvrLocateDevicePath(
 	EFI_DEVICE_PATH_PROTOCOL	*DevicePathIn = *DevicePath;
 //	PRINT("... try to do LocateDevicePath\n");
 	Status = gOrgBS.LocateDevicePath(Protocol, DevicePath, Device);
+	TRACE(LOCATE_DEVICE_PATH, Status, TRACE_PTR(Protocol), TRACE_PTR(DevicePathIn), TRACE_PTR(Device), 0);
 	// TODO: device path to str
 	PRINT("->LocateDevicePath(%s, %p/%p, %p) = %r\n", GuidStr(Protocol), DevicePathIn, DevicePath, Device, Status);
 	return Status;
@@ -350,6 +368,7 @@ OvrInstallConfigurationTable(
 	EFI_STATUS					Status;
 	
 	Status = gOrgBS.InstallConfigurationTable(Guid, Table);
+	TRACE(INSTALL_CONFIGURATION_TABLE, Status, TRACE_PTR(Guid), TRACE_PTR(Table), 0, 0);
 	// TODO: table guids to Lib.c
 	PRINT("->InstallConfigurationTable(%s, %p) = %r\n", GuidStr(Guid), Table, Status);
 	return Status;
@@ -368,6 +387,7 @@ OvrLoadImage(
 	EFI_STATUS					Status;
 	
 	Status = gOrgBS.LoadImage(BootPolicy, ParentImageHandle, DevicePath, SourceBuffer, SourceSize, ImageHandle);
+	TRACE(LOAD_IMAGE, Status, BootPolicy, TRACE_PTR(ParentImageHandle), TRACE_PTR(SourceBuffer), SourceSize);
 	// TODO: dev path to str
 	PRINT("->LoadImage(%c, %p, %p, %p, 0x%x, %p) = %r\n", BootPolicy ? L'T' : L'F', ParentImageHandle, DevicePath, SourceBuffer, SourceSize, ImageHandle, Status);
 	return Status;
@@ -383,6 +403,7 @@ OvrStartImage(
 	EFI_STATUS					Status;
 	
 	Status = gOrgBS.StartImage(ImageHandle, ExitDataSize, ExitData);
+	TRACE(START_IMAGE, Status, TRACE_PTR(ImageHandle), 0, 0, 0);
 	PRINT("->StartImage(%p, 0x%x, %p) = %r\n", ImageHandle, *ExitDataSize, *ExitData, Status);
 	return Status;
 }
@@ -398,6 +419,7 @@ OvrExit(
 	EFI_STATUS					Status;
 	
 	Status = gOrgBS.Exit(ImageHandle, ExitStatus, ExitDataSize, ExitData);
+	TRACE(EXIT, Status, TRACE_PTR(ImageHandle), ExitStatus, ExitDataSize, 0);
 	PRINT("->Exit(%p, %r, 0x%x, %s) = %r\n", ImageHandle, ExitStatus, ExitDataSize, ExitData, Status);
 	return Status;
 }
@@ -410,6 +432,7 @@ OvrUnloadImage(
 	EFI_STATUS					Status;
 	
 	Status = gOrgBS.UnloadImage(ImageHandle);
+	TRACE(UNLOAD_IMAGE, Status, TRACE_PTR(ImageHandle), 0, 0, 0);
 	PRINT("->UnloadImage(%p) = %r\n", ImageHandle, Status);
 	return Status;
 }
@@ -439,6 +462,8 @@ OvrExitBootServices(
 	#endif
 	
 	PRINT("->ExitBootServices(%p, 0x%x) ...\n", ImageHandle, MapKey);
+	// last record, the status is not known yet
+	TRACE(EXIT_BOOT_SERVICES, EFI_SUCCESS, TRACE_PTR(ImageHandle), MapKey, 0, 0);
 	
 	// Set flag to FALSE to stop some loggers from messing with memory
 	InBootServices = FALSE;
@@ -492,6 +517,7 @@ OvrGetNextMonotonicCount(
 	EFI_STATUS					Status;
 	
 	Status = gOrgBS.GetNextMonotonicCount(Count);
+	TRACE(GET_NEXT_MONOTONIC_COUNT, Status, *Count, 0, 0, 0);
 	PRINT("->GetNextMonotonicCount(0x%x) = %r\n", *Count, Status);
 	return Status;
 }
@@ -504,6 +530,7 @@ OvrStall(
 	EFI_STATUS					Status;
 	
 	Status = gOrgBS.Stall(Microseconds);
+	TRACE(STALL, Status, Microseconds, 0, 0, 0);
 	// do not print - too many calls
 	//PRINT("->Stall(%d) = %r\n", Microseconds, Status);
 	return Status;
@@ -520,6 +547,7 @@ OvrSetWatchdogTimer(
 	EFI_STATUS					Status;
 	
 	Status = gOrgBS.SetWatchdogTimer(Timeout, WatchdogCode, DataSize, WatchdogData);
+	TRACE(SET_WATCHDOG_TIMER, Status, Timeout, WatchdogCode, DataSize, TRACE_PTR(WatchdogData));
 	PRINT("->SetWatchdogTimer(%d, 0x%x, %d, %s) = %r\n", Timeout, WatchdogCode, DataSize, WatchdogData, Status);
 	return Status;
 }
@@ -535,6 +563,7 @@ OvrConnectController(
 	EFI_STATUS					Status;
 	
 	Status = gOrgBS.ConnectController(ControllerHandle, DriverImageHandle, RemainingDevicePath, Recursive);
+	TRACE(CONNECT_CONTROLLER, Status, TRACE_PTR(ControllerHandle), TRACE_PTR(DriverImageHandle), TRACE_PTR(RemainingDevicePath), Recursive);
 	// TODO: dev path to str
 	PRINT("->ConnectController(%p, %p, %p, %c) = %r\n", ControllerHandle, DriverImageHandle, RemainingDevicePath, Recursive ? L'T' : L'F', Status);
 	return Status;
@@ -550,6 +579,7 @@ OvrDisconnectController(
 	EFI_STATUS					Status;
 	
 	Status = gOrgBS.DisconnectController(ControllerHandle, DriverImageHandle, ChildHandle);
+	TRACE(DISCONNECT_CONTROLLER, Status, TRACE_PTR(ControllerHandle), TRACE_PTR(DriverImageHandle), TRACE_PTR(ChildHandle), 0);
 	PRINT("->DisconnectController(%p, %p, %p) = %r\n", ControllerHandle, DriverImageHandle, ChildHandle, Status);
 	return Status;
 }
@@ -569,6 +599,7 @@ OvrOpenProtocol(
 	VOID				*InterfaceIn = *Interface;
 #endif
 	Status = gOrgBS.OpenProtocol(Handle, Protocol, Interface, AgentHandle, ControllerHandle, Attributes);
+	TRACE(OPEN_PROTOCOL, Status, TRACE_PTR(Handle), TRACE_PTR(Protocol), TRACE_PTR(AgentHandle), Attributes);
 #if OPEN_PROTOCOL
 	PRINT("->OpenProtocol(%p, %s, %p/%p, %p, %p, %x) = %r\n", Handle, GuidStr(Protocol), InterfaceIn, *Interface, AgentHandle, ControllerHandle, Attributes, Status);
 #endif
@@ -586,6 +617,7 @@ OvrCloseProtocol(
 	EFI_STATUS			Status;
 	
 	Status = gOrgBS.CloseProtocol(Handle, Protocol, AgentHandle, ControllerHandle);
+	TRACE(CLOSE_PROTOCOL, Status, TRACE_PTR(Handle), TRACE_PTR(Protocol), TRACE_PTR(AgentHandle), TRACE_PTR(ControllerHandle));
 #if OPEN_PROTOCOL
 	PRINT("->CloseProtocol(%p, %s, %p, %p) = %r\n", Handle, GuidStr(Protocol), AgentHandle, ControllerHandle, Status);
 #endif
@@ -603,6 +635,7 @@ OvrOpenProtocolInformation(
 	EFI_STATUS			Status;
 	
 	Status = gOrgBS.OpenProtocolInformation(Handle, Protocol, EntryBuffer, EntryCount);
+	TRACE(OPEN_PROTOCOL_INFORMATION, Status, TRACE_PTR(Handle), TRACE_PTR(Protocol), *EntryCount, 0);
 	PRINT("->OpenProtocolInformation(%p, %s, %p, %d) = %r\n", Handle, GuidStr(Protocol), *EntryBuffer, *EntryCount, Status);
 	return Status;
 }
@@ -617,6 +650,7 @@ OvrProtocolsPerHandle(
 	EFI_STATUS			Status;
 	
 	Status = gOrgBS.ProtocolsPerHandle(Handle, ProtocolBuffer, ProtocolBufferCount);
+	TRACE(PROTOCOLS_PER_HANDLE, Status, TRACE_PTR(Handle), *ProtocolBufferCount, 0, 0);
 	// TODO: print list of protocols returned
 	PRINT("->ProtocolsPerHandle(%p, %p, %d) = %r\n", Handle, *ProtocolBuffer, *ProtocolBufferCount, Status);
 	return Status;
@@ -635,6 +669,7 @@ OvrLocateHandleBuffer(
   STATIC UINTN OldBuffer = 0;
 	
 	Status = gOrgBS.LocateHandleBuffer(SearchType, Protocol, SearchKey, NoHandles, Buffer);
+	TRACE(LOCATE_HANDLE_BUFFER, Status, SearchType, TRACE_PTR(Protocol), TRACE_PTR(SearchKey), *NoHandles);
   if (!CompareGuid(Protocol, &mEfiSimplePointerProtocolGuid) || (UINTN)Buffer != OldBuffer) {
     OldBuffer = (UINTN)Buffer;
     PRINT("->LocateHandleBuffer(%s, %s, %p, %d, %p) = %r\n", EfiLocateSearchType[SearchType], GuidStr(Protocol), SearchKey, *NoHandles, *Buffer, Status);
@@ -654,6 +689,7 @@ OvrLocateProtocol(
 	VOID				*InterfaceIn = *Interface;
 	
 	Status = gOrgBS.LocateProtocol(Protocol, Registration, Interface);
+	TRACE(LOCATE_PROTOCOL, Status, TRACE_PTR(Protocol), TRACE_PTR(Registration), TRACE_PTR(*Interface), 0);
 	PRINT("->LocateProtocol(%s, %p, %p/%p) = %r\n", GuidStr(Protocol), Registration, InterfaceIn, *Interface, Status);
 	return Status;
 }
@@ -721,6 +757,8 @@ OvrInstallMultipleProtocolInterfaces(
 		PRINT("->InstallMultipleProtocolInterfaces(%p, ...) = %r, too many Protocol/Interface pairs\n", *Handle, Status);
 		break;
 	}
+	TRACE(INSTALL_MULTIPLE_PROTOCOL_INTERFACES, Status, TRACE_PTR(*Handle), Index,
+		TRACE_PTR((Index >= 1) ? Protocol[1] : NULL), TRACE_PTR((Index >= 1) ? Interface[1] : NULL));
 	return Status;
 }
 
@@ -787,6 +825,8 @@ OvrUninstallMultipleProtocolInterfaces(
 		PRINT("->UninstallMultipleProtocolInterfaces(%p, ...) = %r, too many Protocol/Interface pairs\n", Handle, Status);
 		break;
 	}
+	TRACE(UNINSTALL_MULTIPLE_PROTOCOL_INTERFACES, Status, TRACE_PTR(Handle), Index,
+		TRACE_PTR((Index >= 1) ? Protocol[1] : NULL), TRACE_PTR((Index >= 1) ? Interface[1] : NULL));
 	return Status;
 }
 
@@ -799,6 +839,7 @@ OvrCalculateCrc32(
 {
 	EFI_STATUS			Status;
 	Status = gOrgBS.CalculateCrc32(Data, DataSize, Crc32);
+	TRACE(CALCULATE_CRC32, Status, TRACE_PTR(Data), DataSize, 0, 0);
 	
 	// Omit printing this when using append while logging, as it can end up in calling a file operating inside another file operation
 	// (some implementations of File functions use CalculateCrc32)
@@ -846,6 +887,7 @@ OvrCreateEventEx(
 	EFI_STATUS			Status;
 	
 	Status = gOrgBS.CreateEventEx(Type, NotifyTpl, NotifyFunction, NotifyContext, EventGroup, Event);
+	TRACE(CREATE_EVENT_EX, Status, Type, NotifyTpl, TRACE_PTR(NotifyFunction), TRACE_PTR(EventGroup));
 //	PRINT("->CreateEventEx(0x%x, 0x%x, %p, %p, %g, %p) = %r\n", Type, NotifyTpl, NotifyFunction, NotifyContext, EventGroup, *Event, Status);
 	return Status;
 }
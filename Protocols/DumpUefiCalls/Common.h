@@ -71,11 +71,37 @@
 #define LOG_TO_FILE_PATH L"\\EFI\\EfiCalls.log"
 #endif
 
+//
+// TRACE_BINARY:
+// 2 - will record every call as a fixed size binary record (Trace.c) and disable PRINT, use it when text logging changes timings too much
+// 1 - will record binary records in addition to PRINT
+// 0 - will disable binary records
+// The ring of the last TRACE_RING_RECORDS calls is saved to TRACE_TO_FILE_PATH when ExitBootServices() is called,
+// decode it with DecodeTrace.py.
+//
+#define TRACE_BINARY			0
+
+//
+// TRACE_RING_RECORDS: size of the binary trace ring, must be a power of 2 (a record is 56 bytes)
+//
+#define TRACE_RING_RECORDS		(64 * 1024)
+
+#ifdef CLOVER_BUILD
+#define TRACE_TO_FILE_PATH L"\\EFI\\CLOVER\\misc\\EfiCalls.bin"
+#else
+#define TRACE_TO_FILE_PATH L"\\EFI\\EfiCalls.bin"
+#endif
+
 //
 // PRINT calls our main logger.
 //
 // the following ensures that we don't end up calling print from another print, which was observed in some cases and could cause reboot/hang
+#if TRACE_BINARY == 2
+// arguments stay referenced, but nothing is formatted
+#define PRINT(...) do { if (0) { LogPrint(__VA_ARGS__); } } while (0);
+#else
 #define PRINT(...) LogPrint(__VA_ARGS__);
+#endif
 
 //
 // WORK_DURING_RUNTIME:
@@ -151,6 +177,7 @@
 
 #include "Lib.h"
 #include "Log.h"
+#include "Trace.h"
 #include "FileLib.h"
 #include "BootServices.h"
 #include "RuntimeServices.h"
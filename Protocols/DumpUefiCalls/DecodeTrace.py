@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+#
+# DecodeTrace.py
+#
+# Decodes the binary call trace written by DumpUefiCalls with TRACE_BINARY >= 1 (Common.h)
+# to one text line per call, oldest first:
+#   python3 DecodeTrace.py EfiCalls.bin > EfiCalls.txt
+#
+# Layout, little endian, see Trace.h:
+#   TRACE_HEADER  'DUCT', Version 1, RecordSize, Capacity, Count, TscStart, TscPerSecond
+#   TRACE_RECORD  Tsc, Service, Reserved, Args[4], Status   (min(Count, Capacity) times, ring order)
+#
+# Columns: record number, microseconds since tracing started, microseconds since the previous
+# record, service, arguments, status.
+#
+
+import struct
+import sys
+
+SIGNATURE = b"DUCT"
+VERSION = 1
+HEADER = struct.Struct("<4sIIIQQQ")
+RECORD = struct.Struct("<QII4QQ")
+
+# TRACE_SERVICE in Trace.h, same order
+SERVICES = [
+    "None",
+    # Boot services
+    "AllocatePages",
+    "FreePages",
+    "GetMemoryMap",
+    "AllocatePool",
+    "FreePool",
+    "CreateEvent",
+    "SetTimer",
+    "WaitForEvent",
+    "SignalEvent",
+    "CloseEvent",
+    "CheckEvent",
+    "InstallProtocolInterface",
+    "ReinstallProtocolInterface",
+    "UninstallProtocolInterface",
+    "HandleProtocol",
+    "RegisterProtocolNotify",
+    "LocateHandle",
+    "LocateDevicePath",
+    "InstallConfigurationTable",
+    "LoadImage",
+    "StartImage",
+    "Exit",
+    "UnloadImage",
+    "ExitBootServices",
+    "GetNextMonotonicCount",
+    "Stall",
+    "SetWatchdogTimer",
+    "ConnectController",
+    "DisconnectController",
+    "OpenProtocol",
+    "CloseProtocol",
+    "OpenProtocolInformation",
+    "ProtocolsPerHandle",
+    "LocateHandleBuffer",
+    "LocateProtocol",
+    "InstallMultipleProtocolInterfaces",
+    "UninstallMultipleProtocolInterfaces",
+    "CalculateCrc32",
+    "CreateEventEx",
+    # Runtime services
+    "GetTime",
+    "SetTime",
+    "GetWakeupTime",
+    "SetWakeupTime",
+    "GetVariable",
+    "GetNextVariableName",
+    "SetVariable",
+    "GetNextHighMonotonicCount",
+    "ResetSystem",
+    "UpdateCapsule",
+    "QueryCapsuleCapabilities",
+    "QueryVariableInfo",
+]
+
+# EFI_STATUS error codes without the high bit
+ERRORS = {
+    1: "Load Error", 2: "Invalid Parameter", 3: "Unsupported", 4: "Bad Buffer Size",
+    5: "Buffer Too Small", 6: "Not Ready", 7: "Device Error", 8: "Write Protected",
+    9: "Out of Resources", 10: "Volume Corrupt", 11: "Volume Full", 12: "No Media",
+    13: "Media changed", 14: "Not Found", 15: "Access Denied", 16: "No Response",
+    17: "No mapping", 18: "Time out", 19: "Not started", 20: "Already started",
+    21: "Aborted", 22: "ICMP Error", 23: "TFTP Error", 24: "Protocol Error",
+    25: "Incompatible Version", 26: "Security Violation", 27: "CRC Error",
+    28: "End of Media", 31: "End of File", 32: "Invalid Language", 33: "Compromised Data",
+}
+
+
+def status_str(status):
+    if status == 0:
+        return "Success"
+    if status & (1 << 63):
+        return ERRORS.get(status & ~(1 << 63), "Error 0x%x" % (status & ~(1 << 63)))
+    return "Warning 0x%x" % status
+
+
+def decode(data, out):
+    if len(data) < HEADER.size:
+        raise ValueError("file too small")
+    sig, version, record_size, capacity, count, tsc_start, tsc_per_second = HEADER.unpack_from(data, 0)
+    if sig != SIGNATURE or version != VERSION or record_size != RECORD.size:
+        raise ValueError("not a DumpUefiCalls trace v%d" % VERSION)
+    records = min(count, capacity)
+    if len(data) < HEADER.size + records * RECORD.size:
+        raise ValueError("truncated trace")
+    # oldest record is the next one to be overwritten
+    first = count % capacity if count > capacity else 0
+    if count > capacity:
+        out.write("# ring wrapped, %d oldest records lost\n" % (count - capacity))
+    if tsc_per_second == 0:
+        tsc_per_second = 1000000  # unknown rate, times are in ticks
+        out.write("# TSC rate unknown, times in ticks\n")
+
+    previous = tsc_start
+    for n in range(records):
+        offset = HEADER.size + ((first + n) % capacity) * RECORD.size
+        tsc, service, _, a0, a1, a2, a3, status = RECORD.unpack_from(data, offset)
+        name = SERVICES[service] if service < len(SERVICES) else "Service%d" % service
+        out.write("%8d %12.1f %+10.1f  %s(0x%x, 0x%x, 0x%x, 0x%x) = %s\n" % (
+            count - records + n,
+            (tsc - tsc_start) * 1e6 / tsc_per_second,
+            (tsc - previous) * 1e6 / tsc_per_second,
+            name, a0, a1, a2, a3, status_str(status)))
+        previous = tsc
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.stderr.write("usage: %s EfiCalls.bin\n" % sys.argv[0])
+        return 1
+    with open(sys.argv[1], "rb") as f:
+        data = f.read()
+    try:
+        decode(data, sys.stdout)
+    except ValueError as e:
+        sys.stderr.write("%s: %s\n" % (sys.argv[1], e))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
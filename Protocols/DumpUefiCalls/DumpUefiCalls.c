@@ -32,6 +32,9 @@ StartOverrides()
 	gRT->GetTime(&Now, NULL);
 	PRINT("DumpUefiCalls overrides started on %04d.%02d.%02d (yyyy.mm.dd), at %02d:%02d:%02d.\n",
 	       Now.Year, Now.Month, Now.Day, Now.Hour, Now.Minute, Now.Second);
+	#if TRACE_BINARY >= 1
+	TraceInit();
+	#endif
 	#if CAPTURE_FILESYSTEM_ACCESS == 1
 	OvrFs();
 	#endif
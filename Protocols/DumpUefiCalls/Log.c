@@ -120,4 +120,8 @@ LogOnExitBootServices(VOID)
 		gBS->Stall(3000000);
 	}
 	#endif
+	
+	#if TRACE_BINARY >= 1
+	TraceSave();
+	#endif
 }	
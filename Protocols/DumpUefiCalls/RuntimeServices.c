@@ -40,6 +40,7 @@ OvrGetTime(
 	EFI_STATUS					Status;
 	
 	Status = gOrgRS.GetTime(Time, Capabilities);
+	TRACE(GET_TIME, Status, TRACE_PTR(Time), TRACE_PTR(Capabilities), 0, 0);
 	if (Capabilities != NULL) {
 		PRINT("->GetTime(%t, {Res = %x, Acc = %x, To0: %c}) = %r\n",
 			Time,
@@ -59,6 +60,7 @@ OvrSetTime(
 	EFI_STATUS			Status;
 	
 	Status = gOrgRS.SetTime(Time);
+	TRACE(SET_TIME, Status, TRACE_PTR(Time), 0, 0, 0);
 	PRINT("->SetTime(%t) = %r\n", Time, Status);
 	return Status;
 }
@@ -74,6 +76,7 @@ OvrGetWakeupTime(
 	EFI_STATUS					Status;
 	
 	Status = gOrgRS.GetWakeupTime(Enabled, Pending, Time);
+	TRACE(GET_WAKEUP_TIME, Status, *Enabled, *Pending, TRACE_PTR(Time), 0);
 	PRINT("->GetWakeupTime(%c, %c, %t) = %r\n", *Enabled ? L'T' : 'F', *Pending ? L'T' : 'F', Time, Status);
 	return Status;
 }
@@ -87,6 +90,7 @@ OvrSetWakeupTime(
 	EFI_STATUS					Status;
 	
 	Status = gOrgRS.SetWakeupTime(Enabled, Time);
+	TRACE(SET_WAKEUP_TIME, Status, Enabled, TRACE_PTR(Time), 0, 0);
 	PRINT("->SetWakeupTime(%c, %t) = %r\n", Enabled ? L'T' : 'F', Time, Status);
 	return Status;
 }
@@ -160,6 +164,7 @@ OvrGetVariable(
 		OurAttributes = *Attributes;
 	}
 	Status = gOrgRS.GetVariable(VariableName, VendorGuid, &OurAttributes, DataSize, Data);
+	TRACE(GET_VARIABLE, Status, TRACE_PTR(VariableName), TRACE_PTR(VendorGuid), *DataSize, TRACE_PTR(Data));
 	if (Attributes != NULL) {
 		*Attributes = OurAttributes;
 	}
@@ -193,6 +198,7 @@ OvrGetNextVariableName(
 	
 	PRINT("->GetNextVariableName(%x, %s, %s)", *VariableNameSize, VariableName, GuidStr(VendorGuid));
 	Status = gOrgRS.GetNextVariableName(VariableNameSize, VariableName, VendorGuid);
+	TRACE(GET_NEXT_VARIABLE_NAME, Status, *VariableNameSize, TRACE_PTR(VariableName), TRACE_PTR(VendorGuid), 0);
 	PRINT(" -> (%x, %s, %s) = %r\n", *VariableNameSize, VariableName, GuidStr(VendorGuid), Status);
 	//PRINT("->GetNextVariableName()\n");
 	return Status;
@@ -210,6 +216,7 @@ OvrSetVariable(
 	EFI_STATUS			Status;
 	
 	Status = gOrgRS.SetVariable(VariableName, VendorGuid, Attributes, DataSize, Data);
+	TRACE(SET_VARIABLE, Status, TRACE_PTR(VariableName), TRACE_PTR(VendorGuid), Attributes, DataSize);
 	//PRINT("->SetVariable(%s)\n", VariableName);
 	PRINT("->SetVariable(%s, %s, %x, %x, %p) = %r\n", VariableName, GuidStr(VendorGuid), Attributes, DataSize, Data, Status);
 	PrintBytes((CHAR8 *)Data, DataSize);
@@ -226,6 +233,7 @@ OvrGetNextHighMonotonicCount(
 	EFI_STATUS			Status;
 	
 	Status = gOrgRS.GetNextHighMonotonicCount(HighCount);
+	TRACE(GET_NEXT_HIGH_MONOTONIC_COUNT, Status, *HighCount, 0, 0, 0);
 	PRINT("->GetNextHighMonotonicCount(%x) = %r\n", *HighCount, Status);
 	return Status;
 }
@@ -240,6 +248,7 @@ OvrResetSystem(
 )
 {
 	
+	TRACE(RESET_SYSTEM, EFI_SUCCESS, ResetType, ResetStatus, DataSize, TRACE_PTR(ResetData));
 	PRINT("->ResetSystem(%s, %r, %x, %p)\n", EfiResetType[ResetType], ResetStatus, DataSize, ResetData);
 	PrintBytes((CHAR8 *)ResetData, DataSize);
 //	gOrgRS.ResetSystem(ResetType, ResetStatus, DataSize, ResetData);
@@ -256,6 +265,7 @@ OvrUpdateCapsule(
 	EFI_STATUS			Status;
 	
 	Status = gOrgRS.UpdateCapsule(CapsuleHeaderArray, CapsuleCount, ScatterGatherList);
+	TRACE(UPDATE_CAPSULE, Status, TRACE_PTR(CapsuleHeaderArray), CapsuleCount, ScatterGatherList, 0);
 	PRINT("->UpdateCapsule(%p, %x, %lx) = %r\n", CapsuleHeaderArray, CapsuleCount, ScatterGatherList, Status);
 	return Status;
 }
@@ -272,6 +282,7 @@ OvrQueryCapsuleCapabilities(
 	EFI_STATUS			Status;
 	
 	Status = gOrgRS.QueryCapsuleCapabilities(CapsuleHeaderArray, CapsuleCount, MaximumCapsuleSize, ResetType);
+	TRACE(QUERY_CAPSULE_CAPABILITIES, Status, TRACE_PTR(CapsuleHeaderArray), CapsuleCount, *MaximumCapsuleSize, *ResetType);
 	PRINT("->QueryCapsuleCapabilities(%p, %x, %lx, %s) = %r\n",
 		CapsuleHeaderArray, CapsuleCount, *MaximumCapsuleSize, EfiResetType[*ResetType], Status);
 	return Status;
@@ -289,6 +300,7 @@ OvrQueryVariableInfo(
 	EFI_STATUS			Status;
 	
 	Status = gOrgRS.QueryVariableInfo(Attributes, MaximumVariableStorageSize, RemainingVariableStorageSize, MaximumVariableSize);
+	TRACE(QUERY_VARIABLE_INFO, Status, Attributes, *MaximumVariableStorageSize, *RemainingVariableStorageSize, *MaximumVariableSize);
 	PRINT("->QueryVariableInfo(%x, %lx, %lx, %lx) = %r\n",
 		Attributes, *MaximumVariableStorageSize, *RemainingVariableStorageSize, *MaximumVariableSize, Status);
 	return Status;
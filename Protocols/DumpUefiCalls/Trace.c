@@ -0,0 +1,84 @@
+/** @file
+
+  Binary call trace.
+  A record is a few stores, no formatting and no allocation, so tracing barely changes timings.
+
+**/
+
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+#include "Common.h"
+
+
+/** Header and ring, one buffer so it is saved with one write. */
+static TRACE_HEADER	*mTrace = NULL;
+static TRACE_RECORD	*mTraceRecords = NULL;
+
+
+/** Allocates the ring, called when overrides start. */
+EFI_STATUS
+TraceInit(VOID)
+{
+	UINT64		Tsc;
+	
+	if (mTrace != NULL) {
+		return EFI_SUCCESS;
+	}
+	mTrace = AllocateZeroPool(sizeof(TRACE_HEADER) + TRACE_RING_RECORDS * sizeof(TRACE_RECORD));
+	if (mTrace == NULL) {
+		return EFI_OUT_OF_RESOURCES;
+	}
+	mTraceRecords = (TRACE_RECORD *)(mTrace + 1);
+	
+	mTrace->Signature = TRACE_SIGNATURE;
+	mTrace->Version = TRACE_VERSION;
+	mTrace->RecordSize = sizeof(TRACE_RECORD);
+	mTrace->Capacity = TRACE_RING_RECORDS;
+	
+	// TSC rate for the decoder, 1 ms is enough for its precision
+	Tsc = AsmReadTsc();
+	gBS->Stall(1000);
+	mTrace->TscPerSecond = MultU64x32(AsmReadTsc() - Tsc, 1000);
+	mTrace->TscStart = AsmReadTsc();
+	return EFI_SUCCESS;
+}
+
+/** Writes one record. Does nothing if the ring is not allocated or boot services are over. */
+VOID
+TraceCall(IN UINT32 Service, IN UINT64 Status, IN UINT64 Arg0, IN UINT64 Arg1, IN UINT64 Arg2, IN UINT64 Arg3)
+{
+	TRACE_RECORD	*Record;
+	
+	if (mTrace == NULL || !InBootServices) {
+		return;
+	}
+	// Count is incremented first: a call traced from an event in between takes the next record
+	Record = &mTraceRecords[(UINTN)(mTrace->Count++) & (TRACE_RING_RECORDS - 1)];
+	Record->Tsc = AsmReadTsc();
+	Record->Service = Service;
+	Record->Reserved = 0;
+	Record->Args[0] = Arg0;
+	Record->Args[1] = Arg1;
+	Record->Args[2] = Arg2;
+	Record->Args[3] = Arg3;
+	Record->Status = Status;
+}
+
+/** Saves the ring to TRACE_TO_FILE_PATH, called from LogOnExitBootServices(). */
+EFI_STATUS
+TraceSave(VOID)
+{
+	UINTN		Records = TRACE_RING_RECORDS;
+	
+	if (mTrace == NULL) {
+		return EFI_NOT_STARTED;
+	}
+	// not wrapped yet - only the written records
+	if (mTrace->Count < TRACE_RING_RECORDS) {
+		Records = (UINTN)mTrace->Count;
+	}
+	return FsSaveMemToFileToDefaultDir(TRACE_TO_FILE_PATH, (VOID*)mTrace, sizeof(TRACE_HEADER) + Records * sizeof(TRACE_RECORD));
+}
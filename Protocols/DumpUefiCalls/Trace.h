@@ -0,0 +1,131 @@
+/** @file
+
+  Binary call trace.
+  Every traced call is one fixed size record in a ring preallocated when overrides start,
+  the ring is saved to TRACE_TO_FILE_PATH when ExitBootServices() is called
+  and decoded offline by DecodeTrace.py.
+  Enabled by TRACE_BINARY in Common.h.
+
+**/
+
+#ifndef __DMP_TRACE_H__
+#define __DMP_TRACE_H__
+
+
+/** Signature of the trace file: "DUCT". */
+#define TRACE_SIGNATURE		SIGNATURE_32('D', 'U', 'C', 'T')
+#define TRACE_VERSION		1
+
+/** Traced services, DecodeTrace.py has the names in the same order.
+ *  SetVirtualAddressMap() and ConvertPointer() are called after ExitBootServices(), when tracing is over.
+ */
+typedef enum {
+	TRACE_NONE = 0,
+	// Boot services
+	TRACE_ALLOCATE_PAGES,
+	TRACE_FREE_PAGES,
+	TRACE_GET_MEMORY_MAP,
+	TRACE_ALLOCATE_POOL,
+	TRACE_FREE_POOL,
+	TRACE_CREATE_EVENT,
+	TRACE_SET_TIMER,
+	TRACE_WAIT_FOR_EVENT,
+	TRACE_SIGNAL_EVENT,
+	TRACE_CLOSE_EVENT,
+	TRACE_CHECK_EVENT,
+	TRACE_INSTALL_PROTOCOL_INTERFACE,
+	TRACE_REINSTALL_PROTOCOL_INTERFACE,
+	TRACE_UNINSTALL_PROTOCOL_INTERFACE,
+	TRACE_HANDLE_PROTOCOL,
+	TRACE_REGISTER_PROTOCOL_NOTIFY,
+	TRACE_LOCATE_HANDLE,
+	TRACE_LOCATE_DEVICE_PATH,
+	TRACE_INSTALL_CONFIGURATION_TABLE,
+	TRACE_LOAD_IMAGE,
+	TRACE_START_IMAGE,
+	TRACE_EXIT,
+	TRACE_UNLOAD_IMAGE,
+	TRACE_EXIT_BOOT_SERVICES,
+	TRACE_GET_NEXT_MONOTONIC_COUNT,
+	TRACE_STALL,
+	TRACE_SET_WATCHDOG_TIMER,
+	TRACE_CONNECT_CONTROLLER,
+	TRACE_DISCONNECT_CONTROLLER,
+	TRACE_OPEN_PROTOCOL,
+	TRACE_CLOSE_PROTOCOL,
+	TRACE_OPEN_PROTOCOL_INFORMATION,
+	TRACE_PROTOCOLS_PER_HANDLE,
+	TRACE_LOCATE_HANDLE_BUFFER,
+	TRACE_LOCATE_PROTOCOL,
+	TRACE_INSTALL_MULTIPLE_PROTOCOL_INTERFACES,
+	TRACE_UNINSTALL_MULTIPLE_PROTOCOL_INTERFACES,
+	TRACE_CALCULATE_CRC32,
+	TRACE_CREATE_EVENT_EX,
+	// Runtime services
+	TRACE_GET_TIME,
+	TRACE_SET_TIME,
+	TRACE_GET_WAKEUP_TIME,
+	TRACE_SET_WAKEUP_TIME,
+	TRACE_GET_VARIABLE,
+	TRACE_GET_NEXT_VARIABLE_NAME,
+	TRACE_SET_VARIABLE,
+	TRACE_GET_NEXT_HIGH_MONOTONIC_COUNT,
+	TRACE_RESET_SYSTEM,
+	TRACE_UPDATE_CAPSULE,
+	TRACE_QUERY_CAPSULE_CAPABILITIES,
+	TRACE_QUERY_VARIABLE_INFO,
+	TRACE_SERVICE_COUNT
+} TRACE_SERVICE;
+
+#pragma pack(1)
+
+/** File header, followed by Capacity records in ring order. */
+typedef struct {
+	UINT32	Signature;		// TRACE_SIGNATURE
+	UINT32	Version;		// TRACE_VERSION
+	UINT32	RecordSize;		// sizeof(TRACE_RECORD)
+	UINT32	Capacity;		// number of records in the ring, a power of 2
+	UINT64	Count;			// records written, the ring holds the last min(Count, Capacity) ones
+	UINT64	TscStart;		// TSC when tracing started
+	UINT64	TscPerSecond;	// measured with Stall() at start
+} TRACE_HEADER;
+
+/** One call. */
+typedef struct {
+	UINT64	Tsc;			// TSC when the call returned
+	UINT32	Service;		// TRACE_SERVICE
+	UINT32	Reserved;
+	UINT64	Args[4];		// first arguments, pointers as addresses
+	UINT64	Status;			// returned EFI_STATUS
+} TRACE_RECORD;
+
+#pragma pack()
+
+
+/** Allocates the ring, called when overrides start. */
+EFI_STATUS
+TraceInit(VOID);
+
+/** Writes one record. Does nothing if the ring is not allocated or boot services are over. */
+VOID
+TraceCall(IN UINT32 Service, IN UINT64 Status, IN UINT64 Arg0, IN UINT64 Arg1, IN UINT64 Arg2, IN UINT64 Arg3);
+
+/** Saves the ring to TRACE_TO_FILE_PATH, called from LogOnExitBootServices(). */
+EFI_STATUS
+TraceSave(VOID);
+
+//
+// TRACE(Service, Status, Arg0..Arg3) records a call, Service without the TRACE_ prefix.
+// Use TRACE_PTR() for pointer arguments.
+//
+#define TRACE_PTR(Ptr)	((UINT64)(UINTN)(Ptr))
+
+#if TRACE_BINARY >= 1
+#define TRACE(Service, Status, Arg0, Arg1, Arg2, Arg3) \
+	TraceCall(TRACE_##Service, (UINT64)(Status), (UINT64)(Arg0), (UINT64)(Arg1), (UINT64)(Arg2), (UINT64)(Arg3))
+#else
+#define TRACE(Service, Status, Arg0, Arg1, Arg2, Arg3)
+#endif
+
+
+#endif // __DMP_TRACE_H__
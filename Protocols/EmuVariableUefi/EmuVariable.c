@@ -274,6 +274,420 @@ GetEndPointer (
   return (VARIABLE_HEADER *) HEADER_ALIGN ((UINTN) VolHeader + VolHeader->Size);
 }
 
+/**
+  Gets the base of the volatile or the non-volatile variable store.
+
+  @param  Volatile      TRUE for the volatile store.
+
+  @return Pointer to the variable store header, NULL before the store is allocated.
+
+**/
+VARIABLE_STORE_HEADER *
+GetVariableStore (
+  IN BOOLEAN            Volatile
+  )
+{
+  VARIABLE_GLOBAL *Global;
+
+  Global = &mVariableModuleGlobal->VariableGlobal[Physical];
+  if (Volatile) {
+    return (VARIABLE_STORE_HEADER *) (UINTN) Global->VolatileVariableBase;
+  }
+  return (VARIABLE_STORE_HEADER *) (UINTN) Global->NonVolatileVariableBase;
+}
+
+/**
+  Computes the index hash of a variable, FNV-1a over the name and the GUID.
+
+  @param  VariableName  Null-terminated name of the variable.
+  @param  VendorGuid    Vendor GUID of the variable.
+
+  @return The hash.
+
+**/
+UINT32
+VariableIndexHash (
+  IN CONST CHAR16       *VariableName,
+  IN CONST EFI_GUID     *VendorGuid
+  )
+{
+  UINT32      Hash;
+  CONST UINT8 *Bytes;
+  UINTN       Index;
+
+  Hash = 0x811C9DC5;
+  for (; *VariableName != 0; VariableName++) {
+    Hash = (Hash ^ *VariableName) * 0x01000193;
+  }
+  Bytes = (CONST UINT8 *) VendorGuid;
+  for (Index = 0; Index < sizeof (EFI_GUID); Index++) {
+    Hash = (Hash ^ Bytes[Index]) * 0x01000193;
+  }
+  return Hash;
+}
+
+/**
+  Adds a variable to the index. At boot time a full index is doubled,
+  at runtime it is given up and FindVariable() walks the stores again.
+
+  @param  Variable      Header of the variable, in its store.
+  @param  Volatile      TRUE if the variable is in the volatile store.
+
+**/
+VOID
+VariableIndexAdd (
+  IN VARIABLE_HEADER    *Variable,
+  IN BOOLEAN            Volatile
+  )
+{
+  VARIABLE_INDEX        *VarIndex;
+  VARIABLE_INDEX_ENTRY  *Entries;
+  VARIABLE_INDEX_ENTRY  *Entry;
+  UINT32                EntryIndex;
+  UINT32                Bucket;
+
+  VarIndex = &mVariableModuleGlobal->Index;
+  if (!VarIndex->Valid) {
+    return;
+  }
+
+  if (VarIndex->FreeList != VARIABLE_INDEX_NIL) {
+    EntryIndex          = VarIndex->FreeList;
+    VarIndex->FreeList  = VarIndex->Entries[EntryIndex].Next;
+  } else {
+    if (VarIndex->Used == VarIndex->Capacity) {
+      Entries = NULL;
+      if (!VariableClassAtRuntime ()) {
+        Entries = AllocateRuntimePool (VarIndex->Capacity * 2 * sizeof (VARIABLE_INDEX_ENTRY));
+      }
+      if (Entries == NULL) {
+        VarIndex->Valid = FALSE;
+        return;
+      }
+      CopyMem (Entries, VarIndex->Entries, VarIndex->Capacity * sizeof (VARIABLE_INDEX_ENTRY));
+      FreePool (VarIndex->Entries);
+      VarIndex->Entries   = Entries;
+      VarIndex->Capacity *= 2;
+    }
+    EntryIndex = VarIndex->Used++;
+  }
+
+  Entry           = &VarIndex->Entries[EntryIndex];
+  Entry->Hash     = VariableIndexHash (GET_VARIABLE_NAME_PTR (Variable), &Variable->VendorGuid);
+  Entry->Offset   = (UINT32) ((UINTN) Variable - (UINTN) GetVariableStore (Volatile));
+  Entry->Volatile = Volatile;
+  Bucket          = Entry->Hash & (VARIABLE_INDEX_BUCKETS - 1);
+  Entry->Next     = VarIndex->Buckets[Bucket];
+  VarIndex->Buckets[Bucket] = EntryIndex;
+}
+
+/**
+  Removes a variable from the index, if it is there.
+
+  @param  Variable      Header of the variable, in its store.
+  @param  Volatile      TRUE if the variable is in the volatile store.
+
+**/
+VOID
+VariableIndexRemove (
+  IN VARIABLE_HEADER    *Variable,
+  IN BOOLEAN            Volatile
+  )
+{
+  VARIABLE_INDEX        *VarIndex;
+  VARIABLE_INDEX_ENTRY  *Entry;
+  UINT32                *Link;
+  UINT32                EntryIndex;
+  UINT32                Offset;
+
+  VarIndex = &mVariableModuleGlobal->Index;
+  if (!VarIndex->Valid) {
+    return;
+  }
+
+  Offset  = (UINT32) ((UINTN) Variable - (UINTN) GetVariableStore (Volatile));
+  Link    = &VarIndex->Buckets[VariableIndexHash (GET_VARIABLE_NAME_PTR (Variable), &Variable->VendorGuid) & (VARIABLE_INDEX_BUCKETS - 1)];
+  while (*Link != VARIABLE_INDEX_NIL) {
+    EntryIndex  = *Link;
+    Entry       = &VarIndex->Entries[EntryIndex];
+    if (Entry->Offset == Offset && Entry->Volatile == Volatile) {
+      *Link               = Entry->Next;
+      Entry->Next         = VarIndex->FreeList;
+      VarIndex->FreeList  = EntryIndex;
+      return;
+    }
+    Link = &Entry->Next;
+  }
+}
+
+/**
+  Rebuilds the index from both variable stores, and counts the space
+  taken by the deleted variables of each store.
+
+**/
+VOID
+VariableIndexRebuild (
+  VOID
+  )
+{
+  VARIABLE_INDEX        *VarIndex;
+  VARIABLE_STORE_HEADER *VariableStore;
+  VARIABLE_HEADER       *Variable;
+  VARIABLE_HEADER       *NextVariable;
+  UINTN                 DeletedSize;
+  UINTN                 Index;
+
+  VarIndex = &mVariableModuleGlobal->Index;
+  if (VarIndex->Buckets == NULL || VarIndex->Entries == NULL) {
+    VarIndex->Valid = FALSE;
+    return;
+  }
+
+  SetMem (VarIndex->Buckets, VARIABLE_INDEX_BUCKETS * sizeof (UINT32), 0xFF);
+  VarIndex->Used      = 0;
+  VarIndex->FreeList  = VARIABLE_INDEX_NIL;
+  VarIndex->Valid     = TRUE;
+
+  //
+  // 0: Non-Volatile, 1: Volatile
+  //
+  for (Index = 0; Index < 2; Index++) {
+    VariableStore = GetVariableStore ((BOOLEAN) Index);
+    if (VariableStore == NULL) {
+      continue;
+    }
+    DeletedSize = 0;
+    Variable    = (VARIABLE_HEADER *) HEADER_ALIGN (VariableStore + 1);
+    while (Variable < GetEndPointer (VariableStore) && Variable->StartId == VARIABLE_DATA) {
+      NextVariable = GetNextPotentialVariablePtr (Variable);
+      if (Variable->State == VAR_ADDED) {
+        VariableIndexAdd (Variable, (BOOLEAN) Index);
+      } else {
+        DeletedSize += (UINTN) NextVariable - (UINTN) Variable;
+      }
+      Variable = NextVariable;
+    }
+    if (Index == 0) {
+      mVariableModuleGlobal->NonVolatileDeletedSize = DeletedSize;
+    } else {
+      mVariableModuleGlobal->VolatileDeletedSize = DeletedSize;
+    }
+  }
+}
+
+/**
+  Allocates the index. It is only used once VariableIndexRebuild() ran,
+  until then FindVariable() walks the stores.
+
+**/
+VOID
+VariableIndexInitialize (
+  VOID
+  )
+{
+  VARIABLE_INDEX  *VarIndex;
+
+  VarIndex            = &mVariableModuleGlobal->Index;
+  VarIndex->Buckets   = AllocateRuntimePool (VARIABLE_INDEX_BUCKETS * sizeof (UINT32));
+  VarIndex->Entries   = AllocateRuntimePool (VARIABLE_INDEX_INITIAL_ENTRIES * sizeof (VARIABLE_INDEX_ENTRY));
+  VarIndex->Capacity  = VARIABLE_INDEX_INITIAL_ENTRIES;
+  VarIndex->Valid     = FALSE;
+}
+
+/**
+  Finds a variable through the index. Same result as the walk of FindVariable():
+  a non-volatile variable is preferred, and at runtime only runtime variables are seen.
+
+  @param  VariableName  Name of the variable to be found, not empty.
+  @param  VendorGuid    Vendor GUID to be found.
+  @param  PtrTrack      VARIABLE_POINTER_TRACK structure for output.
+
+  @retval EFI_SUCCESS   Variable successfully found.
+  @retval EFI_NOT_FOUND Variable not found.
+
+**/
+EFI_STATUS
+FindVariableInIndex (
+  IN  CHAR16                  *VariableName,
+  IN  EFI_GUID                *VendorGuid,
+  OUT VARIABLE_POINTER_TRACK  *PtrTrack
+  )
+{
+  VARIABLE_INDEX        *VarIndex;
+  VARIABLE_INDEX_ENTRY  *Entry;
+  VARIABLE_STORE_HEADER *VariableStore;
+  VARIABLE_HEADER       *Variable;
+  VARIABLE_HEADER       *Found;
+  BOOLEAN               FoundVolatile;
+  UINT32                Hash;
+  UINT32                EntryIndex;
+
+  VarIndex      = &mVariableModuleGlobal->Index;
+  Hash          = VariableIndexHash (VariableName, VendorGuid);
+  Found         = NULL;
+  FoundVolatile = TRUE;
+
+  for (EntryIndex = VarIndex->Buckets[Hash & (VARIABLE_INDEX_BUCKETS - 1)];
+       EntryIndex != VARIABLE_INDEX_NIL;
+       EntryIndex = Entry->Next) {
+    Entry = &VarIndex->Entries[EntryIndex];
+    if (Entry->Hash != Hash || (Found != NULL && Entry->Volatile)) {
+      continue;
+    }
+    Variable = (VARIABLE_HEADER *) ((UINTN) GetVariableStore (Entry->Volatile) + Entry->Offset);
+    if (Variable->State != VAR_ADDED ||
+        (VariableClassAtRuntime () && ((Variable->Attributes & EFI_VARIABLE_RUNTIME_ACCESS) == 0)) ||
+        !CompareGuid (VendorGuid, &Variable->VendorGuid) ||
+        CompareMem (VariableName, GET_VARIABLE_NAME_PTR (Variable), Variable->NameSize) != 0) {
+      continue;
+    }
+    Found         = Variable;
+    FoundVolatile = Entry->Volatile;
+    if (!FoundVolatile) {
+      break;
+    }
+  }
+
+  VariableStore       = GetVariableStore (FoundVolatile);
+  PtrTrack->StartPtr  = (VARIABLE_HEADER *) HEADER_ALIGN (VariableStore + 1);
+  PtrTrack->EndPtr    = GetEndPointer (VariableStore);
+  PtrTrack->CurrPtr   = Found;
+  PtrTrack->Volatile  = FoundVolatile;
+  return (Found != NULL) ? EFI_SUCCESS : EFI_NOT_FOUND;
+}
+
+/**
+  Compacts a variable store : the deleted variables are dropped and the
+  others moved down, in place, so this also works at runtime.
+
+  The variable being updated by UpdateVariable() is kept, and Tracked
+  follows it to its new place.
+
+  @param  Volatile      TRUE to reclaim the volatile store.
+  @param  Tracked       If not NULL, a variable of this store to keep track of.
+
+**/
+VOID
+ReclaimVariableStore (
+  IN     BOOLEAN            Volatile,
+  IN OUT VARIABLE_HEADER    **Tracked OPTIONAL
+  )
+{
+  VARIABLE_STORE_HEADER *VariableStore;
+  VARIABLE_HEADER       *Variable;
+  VARIABLE_HEADER       *NextVariable;
+  UINT8                 *Dest;
+  UINTN                 VarSize;
+  UINTN                 *LastVariableOffset;
+  UINTN                 CommonVariableTotalSize;
+  UINTN                 HwErrVariableTotalSize;
+
+  VariableStore           = GetVariableStore (Volatile);
+  LastVariableOffset      = Volatile ? &mVariableModuleGlobal->VolatileLastVariableOffset : &mVariableModuleGlobal->NonVolatileLastVariableOffset;
+  CommonVariableTotalSize = 0;
+  HwErrVariableTotalSize  = 0;
+
+  Variable  = (VARIABLE_HEADER *) HEADER_ALIGN (VariableStore + 1);
+  Dest      = (UINT8 *) Variable;
+  while (Variable < GetEndPointer (VariableStore) && Variable->StartId == VARIABLE_DATA) {
+    NextVariable  = GetNextPotentialVariablePtr (Variable);
+    VarSize       = (UINTN) NextVariable - (UINTN) Variable;
+    if (Variable->State == VAR_ADDED ||
+        (Tracked != NULL && Variable == *Tracked)) {
+      if (Tracked != NULL && Variable == *Tracked) {
+        *Tracked = (VARIABLE_HEADER *) Dest;
+      }
+      CopyMem (Dest, Variable, VarSize);
+      if ((((VARIABLE_HEADER *) Dest)->Attributes & EFI_VARIABLE_HARDWARE_ERROR_RECORD) != 0) {
+        HwErrVariableTotalSize += VarSize;
+      } else {
+        CommonVariableTotalSize += VarSize;
+      }
+      Dest += VarSize;
+    }
+    Variable = NextVariable;
+  }
+
+  //
+  // The free space of a store is all 0xFF
+  //
+  SetMem (Dest, (UINTN) VariableStore + *LastVariableOffset - (UINTN) Dest, 0xFF);
+  *LastVariableOffset = (UINTN) Dest - (UINTN) VariableStore;
+
+  if (!Volatile) {
+    mVariableModuleGlobal->CommonVariableTotalSize  = CommonVariableTotalSize;
+    mVariableModuleGlobal->HwErrVariableTotalSize   = HwErrVariableTotalSize;
+  }
+
+  VariableIndexRebuild ();
+}
+
+/**
+  Reclaims a store before a variable of NewSize bytes is added to it, when
+  the deleted variables pass VARIABLE_RECLAIM_THRESHOLD or the new one doesn't fit.
+
+  @param  Volatile      TRUE for the volatile store.
+  @param  NewSize       Size of the variable to be added.
+  @param  Variable      The variable being updated, if any.
+
+**/
+VOID
+ReclaimIfFragmented (
+  IN     BOOLEAN                  Volatile,
+  IN     UINTN                    NewSize,
+  IN OUT VARIABLE_POINTER_TRACK   *Variable
+  )
+{
+  VARIABLE_STORE_HEADER *VariableStore;
+  UINTN                 DeletedSize;
+  UINTN                 LastVariableOffset;
+
+  VariableStore = GetVariableStore (Volatile);
+  if (Volatile) {
+    DeletedSize         = mVariableModuleGlobal->VolatileDeletedSize;
+    LastVariableOffset  = mVariableModuleGlobal->VolatileLastVariableOffset;
+  } else {
+    DeletedSize         = mVariableModuleGlobal->NonVolatileDeletedSize;
+    LastVariableOffset  = mVariableModuleGlobal->NonVolatileLastVariableOffset;
+  }
+
+  if (DeletedSize == 0 ||
+      (DeletedSize < VARIABLE_RECLAIM_THRESHOLD (VariableStore->Size) &&
+       LastVariableOffset + HEADER_ALIGN (NewSize) < VariableStore->Size)) {
+    return;
+  }
+
+  ReclaimVariableStore (
+    Volatile,
+    (Variable->CurrPtr != NULL && Variable->Volatile == Volatile) ? &Variable->CurrPtr : NULL
+    );
+}
+
+/**
+  Marks a variable deleted, and takes it out of the index.
+
+  @param  Variable      Header of the variable.
+  @param  Volatile      TRUE if the variable is in the volatile store.
+
+**/
+VOID
+DeleteVariableHeader (
+  IN VARIABLE_HEADER    *Variable,
+  IN BOOLEAN            Volatile
+  )
+{
+  UINTN VarSize;
+
+  VariableIndexRemove (Variable, Volatile);
+  Variable->State &= VAR_DELETED;
+  VarSize = (UINTN) GetNextPotentialVariablePtr (Variable) - (UINTN) Variable;
+  if (Volatile) {
+    mVariableModuleGlobal->VolatileDeletedSize += VarSize;
+  } else {
+    mVariableModuleGlobal->NonVolatileDeletedSize += VarSize;
+  }
+}
+
 /**
   Routine used to track statistical information about variable usage. 
   The data is stored in the EFI system table so it can be accessed later.
@@ -935,7 +1349,7 @@ UpdateVariable (
     // specified causes it to be deleted.
     //
     if (DataSize == 0 || (Attributes & (EFI_VARIABLE_RUNTIME_ACCESS | EFI_VARIABLE_BOOTSERVICE_ACCESS)) == 0) {
-      Variable->CurrPtr->State &= VAR_DELETED;
+      DeleteVariableHeader (Variable->CurrPtr, Variable->Volatile);
       UpdateVariableInfo (VariableName, VendorGuid, Variable->Volatile, FALSE, FALSE, TRUE, FALSE);
       Status = EFI_SUCCESS;
       goto Done;
@@ -991,12 +1405,14 @@ UpdateVariable (
   VarDataOffset = VarNameOffset + VarNameSize + GET_PAD_SIZE (VarNameSize);
   VarSize       = VarDataOffset + DataSize + GET_PAD_SIZE (DataSize);
 
+  ReclaimIfFragmented ((BOOLEAN) ((Attributes & EFI_VARIABLE_NON_VOLATILE) == 0), VarSize, Variable);
+
   if ((Attributes & EFI_VARIABLE_NON_VOLATILE) != 0) {
     NonVolatileVarableStoreSize = ((VARIABLE_STORE_HEADER *)(UINTN)(Global->NonVolatileVariableBase))->Size;
     if ((((Attributes & EFI_VARIABLE_HARDWARE_ERROR_RECORD) != 0) 
       && ((HEADER_ALIGN (VarSize) + mVariableModuleGlobal->HwErrVariableTotalSize) > PcdGet32 (PcdHwErrStorageSize)))
       || (((Attributes & EFI_VARIABLE_HARDWARE_ERROR_RECORD) == 0) 
-      && ((HEADER_ALIGN (VarSize) + mVariableModuleGlobal->CommonVariableTotalSize) > NonVolatileVarableStoreSize - sizeof (VARIABLE_STORE_HEADER) - PcdGet32 (PcdHwErrStorageSize)))) {
+      && ((HEADER_ALIGN (VarSize) + mVariableModuleGlobal->CommonVariableTotalSize) >= NonVolatileVarableStoreSize - sizeof (VARIABLE_STORE_HEADER) - PcdGet32 (PcdHwErrStorageSize)))) {
       Status = EFI_OUT_OF_RESOURCES;
       goto Done;
     }
@@ -1011,7 +1427,10 @@ UpdateVariable (
       mVariableModuleGlobal->CommonVariableTotalSize += HEADER_ALIGN (VarSize);
     }
   } else {
-    if ((UINT32) (HEADER_ALIGN (VarSize) + mVariableModuleGlobal->VolatileLastVariableOffset) >
+    //
+    // The store keeps a free header at its end, a walk stops there and not past the store
+    //
+    if ((UINT32) (HEADER_ALIGN (VarSize) + mVariableModuleGlobal->VolatileLastVariableOffset) >=
           ((VARIABLE_STORE_HEADER *) ((UINTN) (Global->VolatileVariableBase)))->Size
           ) {
       Status = EFI_OUT_OF_RESOURCES;
@@ -1052,8 +1471,9 @@ UpdateVariable (
   // Mark the old variable as deleted
   //
   if (Variable->CurrPtr != NULL) {
-    Variable->CurrPtr->State &= VAR_DELETED;
+    DeleteVariableHeader (Variable->CurrPtr, Variable->Volatile);
   }
+  VariableIndexAdd (NextVariable, (BOOLEAN) ((Attributes & EFI_VARIABLE_NON_VOLATILE) == 0));
 
   UpdateVariableInfo (VariableName, VendorGuid, Variable->Volatile, FALSE, TRUE, FALSE, FALSE);
 
@@ -1113,6 +1533,9 @@ FindVariable (
   if (VariableName[0] != 0 && VendorGuid == NULL) {
     return EFI_INVALID_PARAMETER;
   }
+  if (VariableName[0] != 0 && mVariableModuleGlobal->Index.Valid) {
+    return FindVariableInIndex (VariableName, VendorGuid, PtrTrack);
+  }
   //
   // Find the variable by walk through non-volatile and volatile variable store
   //
@@ -1783,6 +2206,7 @@ VariableCommonInitialize (
   }
 
   EfiInitializeLock(&mVariableModuleGlobal->VariableGlobal[Physical].VariableServicesLock, TPL_NOTIFY);
+  VariableIndexInitialize ();
 
   //
   // Intialize volatile variable store
@@ -1797,5 +2221,10 @@ VariableCommonInitialize (
   //
   Status = InitializeVariableStore (FALSE);
 
+  //
+  // Index what the stores hold now, a reserved NV store may come with variables
+  //
+  VariableIndexRebuild ();
+
   return Status;
 }
@@ -74,12 +74,46 @@ typedef struct {
   EFI_LOCK              VariableServicesLock;
 } VARIABLE_GLOBAL;
 
+///
+/// Hashed index over both variable stores, keyed by VendorGuid and VariableName.
+/// Entries keep the offset of the variable in its store, so the index stays valid
+/// after SetVirtualAddressMap and only has to be rebuilt when a store is reclaimed.
+///
+#define VARIABLE_INDEX_BUCKETS          512
+#define VARIABLE_INDEX_INITIAL_ENTRIES  256
+#define VARIABLE_INDEX_NIL              0xFFFFFFFF
+
+///
+/// A store is compacted when the deleted variables take a quarter of it,
+/// or earlier if a new variable doesn't fit anymore.
+///
+#define VARIABLE_RECLAIM_THRESHOLD(StoreSize)  ((StoreSize) / 4)
+
+typedef struct {
+  UINT32          Hash;
+  UINT32          Next;           // next entry of the bucket, or of the free list
+  UINT32          Offset;         // of the VARIABLE_HEADER from its store base
+  BOOLEAN         Volatile;
+} VARIABLE_INDEX_ENTRY;
+
+typedef struct {
+  UINT32                *Buckets;
+  VARIABLE_INDEX_ENTRY  *Entries;
+  UINT32                Capacity;
+  UINT32                Used;     // entries handed out so far, free list included
+  UINT32                FreeList;
+  BOOLEAN               Valid;    // FALSE : FindVariable() walks the stores
+} VARIABLE_INDEX;
+
 typedef struct {
   VARIABLE_GLOBAL VariableGlobal[2];
   UINTN           VolatileLastVariableOffset;
   UINTN           NonVolatileLastVariableOffset;
   UINTN           CommonVariableTotalSize;
   UINTN           HwErrVariableTotalSize;
+  UINTN           VolatileDeletedSize;      // bytes of deleted variables, given back by a reclaim
+  UINTN           NonVolatileDeletedSize;
+  VARIABLE_INDEX  Index;
   CHAR8           *PlatformLangCodes;
   CHAR8           *LangCodes;
   CHAR8           *PlatformLang;
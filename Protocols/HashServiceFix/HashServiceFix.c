@@ -3,15 +3,24 @@
  *
  * If an existing SHA1 implementation is found and produces wrong hashes,
  * is is first unregistered and then replaced with a working one. This
- * replacement protocol only implements SHA1.
+ * replacement protocol implements SHA1 and SHA256, with the SHA extensions
+ * when CPUID reports them (rEFIt_UEFI/Platform/Sha1.c and Sha256.c, shared
+ * with the secure boot image hashes).
  * 
  * Author: Joel Höner <athre0z@zyantific.com>
  */
 
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/MemoryAllocationLib.h>
+
 #include <Protocol/ServiceBinding.h>
 #include <Protocol/Hash.h>
 
-#include "sha1.h"
+#include "../../rEFIt_UEFI/Platform/Sha1.h"
+#include "../../rEFIt_UEFI/Platform/Sha256.h"
 
 /* ===================================================================== */
 /* [Hash Protocol]                                                            */
@@ -19,7 +28,8 @@
 
 typedef struct _HS_PRIVATE_DATA
 {
-  SHA1_CTX Sha1Ctx;
+  SHA1_CONTEXT Sha1Ctx;
+  SHA256_CONTEXT Sha256Ctx;
   EFI_HASH_PROTOCOL Proto;
 } HS_PRIVATE_DATA;
 
@@ -44,6 +54,11 @@ HSGetHashSize(
     return EFI_SUCCESS;
   }
 
+  if (CompareGuid(&gEfiHashAlgorithmSha256Guid, HashAlgorithm)) {
+    *HashSize = sizeof(EFI_SHA256_HASH);
+    return EFI_SUCCESS;
+  }
+
   return EFI_UNSUPPORTED;
 }
 
@@ -59,28 +74,38 @@ HSHash(
   )
 {
   HS_PRIVATE_DATA *PrivateData;
-  SHA1_CTX        CtxCopy;
+  SHA1_CONTEXT    Sha1Copy;
+  SHA256_CONTEXT  Sha256Copy;
 
   if (!This || !HashAlgorithm || !Message || !Hash || !MessageSize) {
     return EFI_INVALID_PARAMETER;
   }
-  if (!CompareGuid(&gEfiHashAlgorithmSha1Guid, HashAlgorithm)) {
-    return EFI_UNSUPPORTED;
-  }
 
   PrivateData = HS_PRIVATE_FROM_PROTO(This);
-  if (!Extend) {
-    SHA1Init(&PrivateData->Sha1Ctx);
-  }
 
-  SHA1Update(&PrivateData->Sha1Ctx, Message, MessageSize);
-
-  // SHA1Final clears the context, so we need to create a copy 
+  // Final pads the context, so we need to create a copy
   // in order to be able to support later updates.
-  CopyMem(&CtxCopy, &PrivateData->Sha1Ctx, sizeof CtxCopy);
-  SHA1Final(*Hash->Sha1Hash, &CtxCopy);
+  if (CompareGuid(&gEfiHashAlgorithmSha1Guid, HashAlgorithm)) {
+    if (!Extend) {
+      Sha1Init(&PrivateData->Sha1Ctx);
+    }
+    Sha1Update(&PrivateData->Sha1Ctx, Message, (UINTN)MessageSize);
+    CopyMem(&Sha1Copy, &PrivateData->Sha1Ctx, sizeof Sha1Copy);
+    Sha1Final(&Sha1Copy, *Hash->Sha1Hash);
+    return EFI_SUCCESS;
+  }
 
-  return EFI_SUCCESS;  
+  if (CompareGuid(&gEfiHashAlgorithmSha256Guid, HashAlgorithm)) {
+    if (!Extend) {
+      Sha256Init(&PrivateData->Sha256Ctx);
+    }
+    Sha256Update(&PrivateData->Sha256Ctx, Message, (UINTN)MessageSize);
+    CopyMem(&Sha256Copy, &PrivateData->Sha256Ctx, sizeof Sha256Copy);
+    Sha256Final(&Sha256Copy, *Hash->Sha256Hash);
+    return EFI_SUCCESS;
+  }
+
+  return EFI_UNSUPPORTED;
 }
 
 EFI_HASH_PROTOCOL mHashProto = {
@@ -108,6 +133,8 @@ HSCreateChild(
   }
 
   CopyMem(&PrivateData->Proto, &mHashProto, sizeof mHashProto);
+  Sha1Init(&PrivateData->Sha1Ctx);
+  Sha256Init(&PrivateData->Sha256Ctx);
 
   Status = gBS->InstallProtocolInterface(
     ChildHandle,
@@ -256,6 +283,30 @@ HSTestExistingShaImpl(BOOLEAN *ImplExists)
 /* [Entry Point]                                                              */
 /* ========================================================================== */
 
+//
+// SHA extensions: CPUID.7.0:EBX[29], the SHA code also needs SSE4.1: CPUID.1:ECX[19].
+//
+VOID
+HSDetectShaNi(VOID)
+{
+#if defined(MDE_CPU_IA32) || defined(MDE_CPU_X64)
+  UINT32  MaxLeaf;
+  UINT32  Ebx;
+  UINT32  Ecx;
+  BOOLEAN ShaNi;
+
+  AsmCpuid(0, &MaxLeaf, NULL, NULL, NULL);
+  if (MaxLeaf < 7) {
+    return;
+  }
+  AsmCpuid(1, NULL, NULL, &Ecx, NULL);
+  AsmCpuidEx(7, 0, NULL, &Ebx, NULL, NULL);
+  ShaNi = (Ebx & BIT29) != 0 && (Ecx & BIT19) != 0;
+  Sha1SetShaNi(ShaNi);
+  Sha256SetShaNi(ShaNi);
+#endif
+}
+
 EFI_STATUS
 EFIAPI
 HSEntryPoint(
@@ -270,6 +321,8 @@ HSEntryPoint(
   BOOLEAN                       CurImplExists;
   UINTN                         NumHandles;
 
+  HSDetectShaNi();
+
   // Does the currently registered (if any) SHA implementation work?
   CurImplWorks = HSTestExistingShaImpl(&CurImplExists);
 
@@ -62,6 +62,100 @@ OverrideFunctions()
   return EFI_SUCCESS;
 }
 
+// FAT_ARCH_CPU_TYPE
+/// The slice of a Fat Binary loaded on the running architecture
+#if defined(EFI32) || defined(MDE_CPU_IA32)
+#define FAT_ARCH_CPU_TYPE    CPU_TYPE_X86
+#elif defined(EFIX64) || defined(MDE_CPU_X64)
+#define FAT_ARCH_CPU_TYPE    CPU_TYPE_X86_64
+#else
+#error "Undefined Platform"
+#endif
+
+// ReadImageFile
+/// Reads an image file into a pool buffer. From a Fat Binary only the header
+/// and the slice of the running architecture are read, the other slices are
+/// skipped on disk, and the buffer holds the thin image.
+///
+/// @param[in]   FileHandle   The opened image file.
+/// @param[in]   FileSize     The size of the file.
+/// @param[out]  Buffer       The allocated image.
+/// @param[out]  BufferSize   The size of the image.
+///
+/// @retval EFI_SUCCESS           The image is read.
+/// @retval EFI_OUT_OF_RESOURCES  The buffer can't be allocated.
+/// @retval other                 The file can't be read.
+STATIC
+EFI_STATUS
+ReadImageFile(IN  EFI_FILE_HANDLE FileHandle,
+              IN  UINT64          FileSize,
+              OUT VOID            **Buffer,
+              OUT UINTN           *BufferSize)
+{
+  EFI_STATUS  Status;
+  UINT8       Header[512];
+  UINTN       HeaderSize;
+  FAT_HEADER  *FatHeader;
+  FAT_ARCH    *FatArch;
+  UINT64      Offset;
+  UINTN       Size;
+  UINTN       ReadSize;
+  UINT32      Index;
+
+  *Buffer     = NULL;
+  *BufferSize = 0;
+
+  HeaderSize = (FileSize < sizeof(Header)) ? (UINTN)FileSize : sizeof(Header);
+  Status     = FileHandle->Read(FileHandle, &HeaderSize, Header);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  // A thin image, or a Fat Binary without our slice, is read whole
+  Offset    = 0;
+  Size      = (UINTN)FileSize;
+  FatHeader = (FAT_HEADER *)Header;
+  if (HeaderSize >= sizeof(FAT_HEADER) && FatHeader->Magic == FAT_BINARY_MAGIC) {
+    FatArch = (FAT_ARCH *)(FatHeader + 1);
+    for (Index = 0; Index < FatHeader->NumFatArch && (UINT8 *)(FatArch + 1) <= Header + HeaderSize; Index++, FatArch++) {
+      if (FatArch->CpuType == FAT_ARCH_CPU_TYPE && FatArch->CpuSubtype == CPU_SUBTYPE_I386_ALL) {
+        if (FatArch->Offset >= HeaderSize && (UINT64)FatArch->Offset + FatArch->Size <= FileSize) {
+          Offset = FatArch->Offset;
+          Size   = FatArch->Size;
+        }
+        break;
+      }
+    }
+  }
+
+  gBS->AllocatePool(EfiBootServicesData, Size, Buffer);
+  if (*Buffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  if (Offset == 0) {
+    // the header is already read
+    CopyMem(*Buffer, Header, HeaderSize);
+    ReadSize = Size - HeaderSize;
+    Status   = FileHandle->Read(FileHandle, &ReadSize, (UINT8 *)*Buffer + HeaderSize);
+    ReadSize += HeaderSize;
+  } else {
+    ReadSize = Size;
+    Status   = FileHandle->SetPosition(FileHandle, Offset);
+    if (!EFI_ERROR(Status)) {
+      Status = FileHandle->Read(FileHandle, &ReadSize, *Buffer);
+    }
+  }
+
+  if (EFI_ERROR(Status)) {
+    gBS->FreePool(*Buffer);
+    *Buffer = NULL;
+    return Status;
+  }
+  *BufferSize = ReadSize;
+  return EFI_SUCCESS;
+}
+
 // OvrLoadImage
 /// Loads an EFI image into memory. Supports the Fat Binary format.
 ///
@@ -214,19 +308,14 @@ OvrLoadImage(IN      BOOLEAN                  BootPolicy,
                 return EFI_OUT_OF_RESOURCES;
               }
 
-              gBS->AllocatePool(EfiBootServicesData, (UINTN)FileInfo->FileSize, &SourceBuffer);
+              Status = ReadImageFile(FileHandle, FileInfo->FileSize, &SourceBuffer, &SourceSize);
 
               if (SourceBuffer != NULL) {
-                SourceSize = (UINTN)FileInfo->FileSize;
                 FreeSourceBuffer = TRUE;
-                Status     = FileHandle->Read(FileHandle, &SourceSize, SourceBuffer);
-
-                FileHandle->Close(FileHandle);
-                gBS->FreePool(FileInfo);
-                FileInfo = NULL; //FreePoll will not zero pointer
-              } else {
-                Status = EFI_OUT_OF_RESOURCES;
               }
+              FileHandle->Close(FileHandle);
+              gBS->FreePool(FileInfo);
+              FileInfo = NULL; //FreePoll will not zero pointer
 
               break;
             }
@@ -274,14 +363,7 @@ OvrLoadImage(IN      BOOLEAN                  BootPolicy,
     if (FatHeader->Magic == FAT_BINARY_MAGIC) {
       FatArch = (FAT_ARCH *)(FatHeader + 1);
       for (Index = 0; Index < FatHeader->NumFatArch; Index++, FatArch++) {
-#if defined(EFI32) || defined(MDE_CPU_IA32)
-        if (FatArch->CpuType == CPU_TYPE_X86 && FatArch->CpuSubtype == CPU_SUBTYPE_I386_ALL)
-#elif defined(EFIX64) || defined(MDE_CPU_X64)
-        if (FatArch->CpuType == CPU_TYPE_X86_64 && FatArch->CpuSubtype == CPU_SUBTYPE_I386_ALL)
-#else
-#error "Undefined Platform"
-#endif
-        {
+        if (FatArch->CpuType == FAT_ARCH_CPU_TYPE && FatArch->CpuSubtype == CPU_SUBTYPE_I386_ALL) {
           break;
         }
       }
@@ -45,18 +45,130 @@ EFI_HANDLE              mHandle = NULL;
 
 extern EFI_GUID gEfiAppleBootGuid;
 
-typedef struct _SMC_STACK SMC_STACK;
+// How an entry's Data was allocated, so SmcResetImpl frees it the same way
+#define SMC_DATA_SINGLE        0 // own pool
+#define SMC_DATA_BATCH_OWNER   1 // start of a SmcAddKeys data block, frees the whole block
+#define SMC_DATA_BATCH_MEMBER  2 // inside that block, nothing to free
 
-struct _SMC_STACK {
-  SMC_STACK           *Next;
+typedef struct {
   SMC_KEY             Id;
   SMC_KEY_TYPE        Type;
   SMC_DATA_SIZE       DataLen;
   SMC_KEY_ATTRIBUTES  Attributes;
+  UINT8               Alloc;
   SMC_DATA            *Data;
-};
+} SMC_KEY_ENTRY;
+
+// Keys in the order they were added. SMC index 0 is the newest key, as it was
+// with the former linked list, so index N is SmcKeys[SmcKeyCount - 1 - N].
+SMC_KEY_ENTRY *SmcKeys = NULL;
+UINTN         SmcKeyCount = 0;
+UINTN         SmcKeyCapacity = 0;
+
+// Open addressing on the 32-bit key. A slot holds (entry index + 1) of the newest
+// entry with that key, 0 is empty. Size is a power of two, at least twice SmcKeyCount.
+UINT32        *SmcKeyHash = NULL;
+UINTN         SmcKeyHashSize = 0;
+
+STATIC
+UINTN
+SmcKeySlot (IN SMC_KEY Key)
+{
+  UINT32 Hash = Key * 0x9E3779B1u;
+  return (Hash ^ (Hash >> 16)) & (SmcKeyHashSize - 1);
+}
 
-SMC_STACK *SmcStack = NULL;
+STATIC
+SMC_KEY_ENTRY *
+SmcFindKey (IN SMC_KEY Key)
+{
+  UINTN Slot;
+  if (!SmcKeyHashSize) {
+    return NULL;
+  }
+  for (Slot = SmcKeySlot(Key); SmcKeyHash[Slot]; Slot = (Slot + 1) & (SmcKeyHashSize - 1)) {
+    if (SmcKeys[SmcKeyHash[Slot] - 1].Id == Key) {
+      return &SmcKeys[SmcKeyHash[Slot] - 1];
+    }
+  }
+  return NULL;
+}
+
+STATIC
+VOID
+SmcHashInsert (IN UINTN Index)
+{
+  UINTN Slot;
+  for (Slot = SmcKeySlot(SmcKeys[Index].Id); SmcKeyHash[Slot]; Slot = (Slot + 1) & (SmcKeyHashSize - 1)) {
+    if (SmcKeys[SmcKeyHash[Slot] - 1].Id == SmcKeys[Index].Id) {
+      break; // a key added twice: the newer entry shadows the older one
+    }
+  }
+  SmcKeyHash[Slot] = (UINT32)(Index + 1);
+}
+
+// Makes room for Count more entries, growing the hash so it stays at most half full
+STATIC
+EFI_STATUS
+SmcReserveKeys (IN UINTN Count)
+{
+  SMC_KEY_ENTRY *NewKeys;
+  UINT32        *NewHash;
+  UINTN         NewSize;
+  UINTN         Index;
+
+  if (SmcKeyCount + Count > SmcKeyCapacity) {
+    NewSize = MAX(MAX(SmcKeyCapacity * 2, SmcKeyCount + Count), 64);
+    NewKeys = ReallocatePool(SmcKeyCapacity * sizeof(SMC_KEY_ENTRY), NewSize * sizeof(SMC_KEY_ENTRY), SmcKeys);
+    if (!NewKeys) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+    SmcKeys = NewKeys;
+    SmcKeyCapacity = NewSize;
+  }
+  if ((SmcKeyCount + Count) * 2 > SmcKeyHashSize) {
+    NewSize = SmcKeyHashSize ? SmcKeyHashSize : 128;
+    while ((SmcKeyCount + Count) * 2 > NewSize) {
+      NewSize *= 2;
+    }
+    NewHash = AllocateZeroPool(NewSize * sizeof(UINT32));
+    if (!NewHash) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+    if (SmcKeyHash) {
+      FreePool(SmcKeyHash);
+    }
+    SmcKeyHash = NewHash;
+    SmcKeyHashSize = NewSize;
+    for (Index = 0; Index < SmcKeyCount; Index++) {
+      SmcHashInsert(Index);
+    }
+  }
+  return EFI_SUCCESS;
+}
+
+// SmcReserveKeys must have been called
+STATIC
+SMC_KEY_ENTRY *
+SmcAppendKey (IN SMC_KEY             Key,
+              IN SMC_DATA_SIZE       Size,
+              IN SMC_KEY_TYPE        Type,
+              IN SMC_KEY_ATTRIBUTES  Attributes,
+              IN UINT8               Alloc,
+              IN SMC_DATA            *Data
+              )
+{
+  SMC_KEY_ENTRY *Entry = &SmcKeys[SmcKeyCount];
+  Entry->Id = Key;
+  Entry->DataLen = Size;
+  Entry->Type = Type;
+  Entry->Attributes = Attributes;
+  Entry->Alloc = Alloc;
+  Entry->Data = Data;
+  SmcHashInsert(SmcKeyCount);
+  SmcKeyCount++;
+  return Entry;
+}
 
 CHAR8 *StringId(UINT32 DataId)
 {
@@ -156,7 +268,7 @@ SmcReadValueImpl (IN  APPLE_SMC_IO_PROTOCOL  *This,
                   )
 {
 
-  SMC_STACK *TmpStack = SmcStack;
+  SMC_KEY_ENTRY *Entry;
   INTN Len;
   CHAR8 *Str;
   
@@ -167,14 +279,11 @@ SmcReadValueImpl (IN  APPLE_SMC_IO_PROTOCOL  *This,
   Str = StringId(Key);
   DBG("asked for SMC=%x (%a) len=%d\n", Key, Str, Size);
   FreePool(Str);
-  while (TmpStack) {
-    if (TmpStack->Id == Key) {
-      Len = MIN(TmpStack->DataLen, Size);
-      CopyMem(Value, TmpStack->Data, Len);
-      return EFI_SUCCESS;
-    } else {
-      TmpStack = TmpStack->Next;
-    }
+  Entry = SmcFindKey(Key);
+  if (Entry) {
+    Len = MIN(Entry->DataLen, Size);
+    CopyMem(Value, Entry->Data, Len);
+    return EFI_SUCCESS;
   }
   return EFI_NOT_FOUND;
   
@@ -218,28 +327,22 @@ SmcWriteValueImpl (IN  APPLE_SMC_IO_PROTOCOL  *This,
                    OUT SMC_DATA               *Value
                    )
 {  //IN UINT32 DataId, IN UINT32 DataLength, IN VOID* DataBuffer
-  SMC_STACK *TmpStack = SmcStack;
+  SMC_KEY_ENTRY *Entry;
   UINTN Len;
   //First find existing key
-  while (TmpStack) {
-    if (TmpStack->Id == Key) {
-      Len = MIN(TmpStack->DataLen, Size);
-      CopyMem(TmpStack->Data, Value, Len);
-      SetNvramForTheKey(Key, TmpStack->Type, Size, Value);
-      return EFI_SUCCESS;
-    } else {
-      TmpStack = TmpStack->Next;
-    }
+  Entry = SmcFindKey(Key);
+  if (Entry) {
+    Len = MIN(Entry->DataLen, Size);
+    CopyMem(Entry->Data, Value, Len);
+    SetNvramForTheKey(Key, Entry->Type, Size, Value);
+    return EFI_SUCCESS;
   }
   //if not found then create new. Not recommended!
-  TmpStack = AllocatePool(sizeof(SMC_STACK));
-  TmpStack->Next = SmcStack;
-  TmpStack->Id = Key;
-  TmpStack->DataLen = Size;
-  TmpStack->Attributes = SMC_KEY_ATTRIBUTE_WRITE | SMC_KEY_ATTRIBUTE_READ;
-  TmpStack->Data = AllocateCopyPool(Size, Value);
-  TmpStack->Type = SmcKeyTypeFlag;
-  SmcStack = TmpStack;
+  if (EFI_ERROR(SmcReserveKeys(1))) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  SmcAppendKey(Key, Size, SmcKeyTypeFlag, SMC_KEY_ATTRIBUTE_WRITE | SMC_KEY_ATTRIBUTE_READ,
+               SMC_DATA_SINGLE, AllocateCopyPool(Size, Value));
   return EFI_SUCCESS;
 }
 
@@ -250,16 +353,11 @@ SmcGetKeyCountImpl (IN  APPLE_SMC_IO_PROTOCOL  *This,
                     OUT SMC_DATA               *Count
                     )
 {
-  UINT32 Index = 0;
+  UINT32 Index = (UINT32)SmcKeyCount;
   SMC_DATA *Big = Count;
-  SMC_STACK *TmpStack = SmcStack;
   if (!Count) {
     return EFI_INVALID_PARAMETER;
   }
-  while (TmpStack) {
-    Index++;
-    TmpStack = TmpStack->Next;
-  }
   //take into account BigEndian
   *Big++ = (SMC_DATA)(Index >> 24);
   *Big++ = (SMC_DATA)(Index >> 16);
@@ -291,15 +389,53 @@ SmcAddKeyImpl (IN   APPLE_SMC_IO_PROTOCOL  *This,
                IN   SMC_KEY_ATTRIBUTES     Attributes
                )
 {
-  SMC_STACK *TmpStack;
-  TmpStack = AllocatePool(sizeof(SMC_STACK));
-  TmpStack->Next = SmcStack;
-  TmpStack->Id = Key;
-  TmpStack->DataLen = Size;
-  TmpStack->Attributes = Attributes;
-  TmpStack->Data = AllocatePool(Size);
-  TmpStack->Type = Type;
-  SmcStack = TmpStack;
+  if (EFI_ERROR(SmcReserveKeys(1))) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  SmcAppendKey(Key, Size, Type, Attributes, SMC_DATA_SINGLE, AllocatePool(Size));
+  return EFI_SUCCESS;
+}
+
+// Same as SmcAddKey followed by SmcWriteValue for every record, but the data
+// of all keys shares one allocation
+EFI_STATUS
+EFIAPI
+SmcAddKeysImpl (IN   APPLE_SMC_IO_PROTOCOL  *This,
+                IN   UINTN                  Count,
+                IN   CONST SMC_KEY_RECORD   *Records
+                )
+{
+  SMC_DATA  *Data;
+  UINTN     Index;
+  UINTN     DataSize = 0;
+
+  if (!Count) {
+    return EFI_SUCCESS;
+  }
+  if (!Records) {
+    return EFI_INVALID_PARAMETER;
+  }
+  for (Index = 0; Index < Count; Index++) {
+    DataSize += Records[Index].Size;
+  }
+  if (EFI_ERROR(SmcReserveKeys(Count))) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Data = AllocatePool(DataSize);
+  if (!Data && DataSize) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  for (Index = 0; Index < Count; Index++) {
+    SmcAppendKey(Records[Index].Key, Records[Index].Size, Records[Index].Type, Records[Index].Attributes,
+                 (Index == 0) ? SMC_DATA_BATCH_OWNER : SMC_DATA_BATCH_MEMBER, Data);
+    if (Records[Index].Data) {
+      CopyMem(Data, Records[Index].Data, Records[Index].Size);
+      SetNvramForTheKey(Records[Index].Key, Records[Index].Type, Records[Index].Size, Data);
+    } else {
+      ZeroMem(Data, Records[Index].Size);
+    }
+    Data += Records[Index].Size;
+  }
   return EFI_SUCCESS;
 }
 
@@ -310,20 +446,14 @@ SmcGetKeyFromIndexImpl(IN  APPLE_SMC_IO_PROTOCOL  *This,
                        OUT SMC_KEY                *Key
                        )
 {
-  UINT32 Num = 0;
-  SMC_STACK *TmpStack = SmcStack;
   if (!Key) {
     return EFI_INVALID_PARAMETER;
   }
-  while (TmpStack) {
-    if (Num == Index) {
-      *Key = TmpStack->Id;
-      return EFI_SUCCESS;
-    }
-    Num++;
-    TmpStack = TmpStack->Next;
+  if (Index >= SmcKeyCount) {
+    return EFI_NOT_FOUND;
   }
-  return EFI_NOT_FOUND;
+  *Key = SmcKeys[SmcKeyCount - 1 - Index].Id;
+  return EFI_SUCCESS;
 }
 
 EFI_STATUS
@@ -335,20 +465,16 @@ SmcGetKeyInfoImpl (IN  APPLE_SMC_IO_PROTOCOL  *This,
                    OUT SMC_KEY_ATTRIBUTES     *Attributes
                    )
 {
-  UINT32 Num = 0;
-  SMC_STACK *TmpStack = SmcStack;
+  SMC_KEY_ENTRY *Entry;
   if (!Size || !Type || !Attributes) {
     return EFI_INVALID_PARAMETER;
   }
-  while (TmpStack) {
-    if (Key == TmpStack->Id) {
-      *Size = TmpStack->DataLen;
-      *Type = TmpStack->Type;
-      *Attributes = TmpStack->Attributes;
-      return EFI_SUCCESS;
-    }
-    Num++;
-    TmpStack = TmpStack->Next;
+  Entry = SmcFindKey(Key);
+  if (Entry) {
+    *Size = Entry->DataLen;
+    *Type = Entry->Type;
+    *Attributes = Entry->Attributes;
+    return EFI_SUCCESS;
   }
   return EFI_NOT_FOUND;  
 }
@@ -359,13 +485,16 @@ SmcResetImpl (IN APPLE_SMC_IO_PROTOCOL  *This,
               IN UINT32                 Mode
               )
 {
-  SMC_STACK *TmpStack = SmcStack;
+  UINTN Index;
   if (Mode) {
-    while (TmpStack) {
-      FreePool(TmpStack->Data);
-      SmcStack = TmpStack->Next;
-      FreePool(TmpStack);
-      TmpStack = SmcStack;
+    for (Index = 0; Index < SmcKeyCount; Index++) {
+      if (SmcKeys[Index].Alloc != SMC_DATA_BATCH_MEMBER && SmcKeys[Index].Data) {
+        FreePool(SmcKeys[Index].Data);
+      }
+    }
+    SmcKeyCount = 0;
+    if (SmcKeyHash) {
+      ZeroMem(SmcKeyHash, SmcKeyHashSize * sizeof(UINT32));
     }
   }
   return EFI_SUCCESS;
@@ -479,6 +608,7 @@ APPLE_SMC_IO_PROTOCOL SMCHelperProtocol = {
   0,
   SMC_PORT_BASE,
   FALSE,
+  SmcAddKeysImpl,
 /*  SmcUnknown1Impl,
   SmcUnknown2Impl,
   SmcUnknown3Impl,
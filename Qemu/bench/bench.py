@@ -0,0 +1,388 @@
+#!/usr/bin/env python3
+#
+# bench.py
+#
+# Boot time benchmark of CloverX64 under QEMU/OVMF, headless.
+#
+#   python3 Qemu/bench/bench.py run CloverX64.efi -n 5 -o new.json
+#   python3 Qemu/bench/bench.py compare base.json new.json
+#
+# "run" boots Clover with each fixture (see FIXTURES), N times. The ESP is a host directory given to QEMU as a
+# vvfat drive: EFI/BOOT/BOOTX64.efi is Clover, EFI/Microsoft/Boot/bootmgfw.efi is a copy of it, only there to
+# be the default entry. Clover logs to the serial port. When StartLoader() has logged the BootTimeline and
+# PerfCounters sections the run is done and QEMU is killed, the entry itself is never started.
+# If the serial log stays quiet (the menu is waiting, the default entry was not found), Enter is sent through the
+# QEMU monitor.
+# The medians of each phase and counter over the runs are written to the JSON file and printed.
+#
+# "compare" prints both medians per fixture and phase, and exits with 1 if a phase is slower than the base by more
+# than --threshold percent and --min-ms milliseconds (the noise of short phases), or a counter grew by more than
+# --threshold percent.
+#
+# Times are from the TSC through BootTimeline, so they are only comparable between builds on the same host,
+# same accelerator (-accel, KVM when /dev/kvm is usable, else TCG) and same QEMU.
+#
+
+import argparse
+import json
+import os
+import plistlib
+import re
+import shutil
+import socket
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+QEMU_DIR = os.path.dirname(SCRIPT_DIR)
+REPO_DIR = os.path.dirname(QEMU_DIR)
+THEMES_DIR = os.path.join(REPO_DIR, "CloverPackage", "CloverV2", "themespkg")
+
+VOLUME_LABEL = "QEMU VVFAT"  # label of the vvfat drives
+END_MARKER = re.compile(r"blt: \d+ calls")  # last line of PerfCountersSave()
+QUIET_SECONDS = 5  # serial log unchanged that long: Clover is in the menu
+
+
+# ---------------------------------------------------------------- fixtures
+
+def base_config():
+    return {
+        "Boot": {
+            "Timeout": 0,
+            "DefaultVolume": VOLUME_LABEL,
+            "DefaultLoader": "bootmgfw.efi",
+            "Fast": False,
+            "NeverHibernate": True,
+        },
+        "GUI": {
+            "Theme": "embedded",
+            "ScreenResolution": "1024x768",
+            "Scan": {"Entries": True, "Tool": False, "Legacy": False, "Linux": False, "Kernel": False},
+        },
+        "SystemParameters": {"InjectKexts": "No"},
+    }
+
+
+def kernel_patches(count):
+    # distinct, never matching patterns: they cost the parsing and the settings, and the search if a kernel is booted
+    patches = []
+    for index in range(count):
+        find = bytes([0x0f, 0x0b, 0xcc, index & 0xff, (index >> 8) & 0xff, 0x90, 0x90, 0x90])
+        patches.append({
+            "Comment": "bench patch %d" % index,
+            "Disabled": False,
+            "Find": find,
+            "Replace": find[:5] + b"\xc3\x90\x90",
+            "MatchOS": "All",
+        })
+    return patches
+
+
+def fixture_plain(esp):
+    return base_config(), 0
+
+
+def fixture_kernel_patches(esp):
+    config = base_config()
+    config["KernelAndKextPatches"] = {"KernelToPatch": kernel_patches(60)}
+    return config, 0
+
+
+def fixture_vector_theme(esp):
+    # the largest SVG theme of the package
+    themes = [t for t in os.listdir(THEMES_DIR) if os.path.isfile(os.path.join(THEMES_DIR, t, "theme.svg"))]
+    theme = max(themes, key=lambda t: os.path.getsize(os.path.join(THEMES_DIR, t, "theme.svg")))
+    shutil.copytree(os.path.join(THEMES_DIR, theme), os.path.join(esp, "EFI", "CLOVER", "themes", theme))
+    config = base_config()
+    config["GUI"]["Theme"] = theme
+    return config, 0
+
+
+def fixture_volumes(esp):
+    return base_config(), 20
+
+
+FIXTURES = {
+    "plain": fixture_plain,
+    "kernel-patches-60": fixture_kernel_patches,
+    "vector-theme": fixture_vector_theme,
+    "volumes-20": fixture_volumes,
+}
+
+
+def make_esp(root, clover, fixture):
+    esp = os.path.join(root, "esp")
+    for path in ("EFI/BOOT", "EFI/CLOVER/misc", "EFI/CLOVER/drivers/UEFI", "EFI/Microsoft/Boot"):
+        os.makedirs(os.path.join(esp, path))
+    shutil.copyfile(clover, os.path.join(esp, "EFI", "BOOT", "BOOTX64.efi"))
+    shutil.copyfile(clover, os.path.join(esp, "EFI", "CLOVER", "CLOVERX64.efi"))
+    shutil.copyfile(clover, os.path.join(esp, "EFI", "Microsoft", "Boot", "bootmgfw.efi"))
+    config, volumes = FIXTURES[fixture](esp)
+    with open(os.path.join(esp, "EFI", "CLOVER", "config.plist"), "wb") as f:
+        plistlib.dump(config, f)
+    extra = []
+    for index in range(volumes):
+        volume = os.path.join(root, "vol%02d" % index)
+        os.makedirs(volume)
+        with open(os.path.join(volume, "readme.txt"), "w") as f:
+            f.write("bench volume %d\n" % index)
+        extra.append(volume)
+    return esp, extra
+
+
+# ---------------------------------------------------------------- QEMU
+
+def qemu_binary(args):
+    if args.qemu:
+        return args.qemu, []
+    portable = os.path.join(QEMU_DIR, "qemu_portable")
+    if sys.platform == "darwin" and os.path.isfile(os.path.join(portable, "qemu-system-x86_64")):
+        return os.path.join(portable, "qemu-system-x86_64"), ["-L", portable]
+    return "qemu-system-x86_64", []
+
+
+def accel(args):
+    if args.accel != "auto":
+        return args.accel
+    if sys.platform.startswith("linux") and os.access("/dev/kvm", os.R_OK | os.W_OK):
+        return "kvm"
+    return "tcg"
+
+
+def free_port():
+    with socket.socket() as s:
+        s.bind(("127.0.0.1", 0))
+        return s.getsockname()[1]
+
+
+def boot_once(args, esp, volumes, serial):
+    binary, extra = qemu_binary(args)
+    port = free_port()
+    cmd = [binary] + extra + [
+        "-machine", "q35", "-accel", accel(args), "-m", "2048", "-cpu", args.cpu,
+        "-bios", args.ovmf,
+        "-display", "none", "-vga", "std",
+        "-serial", "file:" + serial,
+        "-monitor", "tcp:127.0.0.1:%d,server,nowait" % port,
+        "-device", "ahci,id=ahci",
+        "-drive", "if=none,id=esp,format=raw,file=fat:16:" + esp,
+        "-device", "ide-hd,bus=ahci.0,drive=esp,bootindex=0",
+        "-usb", "-device", "usb-kbd",
+    ]
+    for index, volume in enumerate(volumes):
+        cmd += ["-drive", "if=none,id=vol%d,format=raw,file=fat:16:%s" % (index, volume),
+                "-device", "virtio-blk-pci,drive=vol%d" % index]
+
+    start = time.monotonic()
+    errors = open(serial + ".err", "wb")
+    qemu = subprocess.Popen(cmd, stdin=subprocess.DEVNULL, stdout=subprocess.DEVNULL, stderr=errors)
+    last_size = 0
+    last_change = start
+    try:
+        while True:
+            time.sleep(0.2)
+            if qemu.poll() is not None:
+                with open(serial + ".err", "rb") as f:
+                    raise RuntimeError("QEMU exited: " + f.read().decode(errors="replace").strip())
+            with open(serial, "rb") as f:
+                log = f.read().decode(errors="replace")
+            if END_MARKER.search(log):
+                return log, time.monotonic() - start
+            now = time.monotonic()
+            if now - start > args.timeout:
+                raise RuntimeError("no BootTimeline after %d s, see %s" % (args.timeout, serial))
+            if len(log) != last_size:
+                last_size = len(log)
+                last_change = now
+            elif log and now - last_change > QUIET_SECONDS:
+                # the menu is waiting, boot the selected entry
+                last_change = now
+                try:
+                    with socket.create_connection(("127.0.0.1", port), timeout=1) as monitor:
+                        monitor.sendall(b"sendkey ret\n")
+                except OSError:
+                    pass
+    finally:
+        qemu.kill()
+        qemu.wait()
+        errors.close()
+
+
+# ---------------------------------------------------------------- log parsing
+
+# optional "0:100  0:000  " MemLog timing, then a row of TimelineReport()
+TIMING = re.compile(r"^\d+:\d{3}\s+\d+:\d{3}\s\s")
+SPAN = re.compile(r"^\s*(\d+)\.(\d{3})\s+(\d+)\.(\d{3})  ( *)(\S.*?)( \(open\))?$")
+COUNTERS = [
+    (re.compile(r"^files: (\d+) opened, (\d+) bytes read"), ("FileOpens", "FileBytesRead")),
+    (re.compile(r"^patches: (\d+) compares, (\d+) matches, (\d+) replaces"),
+     ("CompareMemCalls", "PatchMatches", "PatchReplaces")),
+    (re.compile(r"^plist: (\d+) nodes"), ("PlistNodes",)),
+    (re.compile(r"^pool: (\d+) allocs, peak (\d+) bytes"), ("PoolAllocs", "PoolPeakBytes")),
+    (re.compile(r"^blt: (\d+) calls, (\d+) pixels"), ("BltCalls", "BltPixels")),
+]
+
+
+def parse_log(log):
+    """Phases in ms, nested ones as Parent/Child, repeated ones summed, and the counters of the last report."""
+    phases = {}
+    counters = {}
+    section = None
+    stack = []
+    for line in log.splitlines():
+        line = TIMING.sub("", line.rstrip("\r"))
+        if line.startswith("=== ["):
+            section = line[5:].split("]")[0].strip()
+            stack = []
+            continue
+        if section == "BootTimeline":
+            match = SPAN.match(line)
+            if match:
+                duration = int(match.group(3)) + int(match.group(4)) / 1000.0
+                depth = len(match.group(5)) // 2
+                del stack[depth:]
+                stack.append(match.group(6))
+                name = "/".join(stack)
+                phases[name] = phases.get(name, 0.0) + duration
+                end = int(match.group(1)) + int(match.group(2)) / 1000.0 + duration
+                phases["(total)"] = max(phases.get("(total)", 0.0), end)
+        elif section == "PerfCounters":
+            for regex, names in COUNTERS:
+                match = regex.match(line)
+                if match:
+                    for name, value in zip(names, match.groups()):
+                        counters[name] = int(value)
+    return phases, counters
+
+
+def medians(samples):
+    keys = sorted(set(k for sample in samples for k in sample))
+    return {k: statistics.median(sample.get(k, 0) for sample in samples) for k in keys}
+
+
+# ---------------------------------------------------------------- commands
+
+def cmd_run(args):
+    if not os.path.isfile(args.clover):
+        sys.stderr.write("%s doesn't exist\n" % args.clover)
+        return 1
+    fixtures = args.fixture or list(FIXTURES)
+    results = {"clover": os.path.abspath(args.clover), "accel": accel(args), "cpu": args.cpu, "runs": args.runs,
+               "fixtures": {}}
+    for fixture in fixtures:
+        phase_runs, counter_runs, walls = [], [], []
+        for run in range(args.runs):
+            root = tempfile.mkdtemp(prefix="clover-bench-")
+            try:
+                esp, volumes = make_esp(root, args.clover, fixture)
+                serial = os.path.join(root, "serial.log")
+                open(serial, "w").close()
+                log, wall = boot_once(args, esp, volumes, serial)
+            except RuntimeError as e:
+                sys.stderr.write("%s run %d: %s\n" % (fixture, run, e))
+                if args.keep:
+                    sys.stderr.write("kept %s\n" % root)
+                    root = None
+                return 1
+            finally:
+                if root and not args.keep:
+                    shutil.rmtree(root, ignore_errors=True)
+            if args.logs:
+                os.makedirs(args.logs, exist_ok=True)
+                with open(os.path.join(args.logs, "%s-%d.log" % (fixture, run)), "w") as f:
+                    f.write(log)
+            phases, counters = parse_log(log)
+            if not phases:
+                sys.stderr.write("%s run %d: no BootTimeline rows in the log\n" % (fixture, run))
+                return 1
+            phase_runs.append(phases)
+            counter_runs.append(counters)
+            walls.append(wall * 1000)
+            sys.stderr.write("%s run %d: %.1f ms\n" % (fixture, run, phases["(total)"]))
+        results["fixtures"][fixture] = {
+            "phases": medians(phase_runs),
+            "counters": medians(counter_runs),
+            "wall_ms": statistics.median(walls),
+        }
+    print_results(results)
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(results, f, indent=1, sort_keys=True)
+            f.write("\n")
+    return 0
+
+
+def print_results(results):
+    for fixture, data in results["fixtures"].items():
+        print("%s (median of %d, host %.0f ms)" % (fixture, results["runs"], data["wall_ms"]))
+        for phase, ms in data["phases"].items():
+            print("  %10.3f ms  %s" % (ms, phase))
+        for counter, value in data["counters"].items():
+            print("  %14d  %s" % (value, counter))
+
+
+def cmd_compare(args):
+    with open(args.base) as f:
+        base = json.load(f)
+    with open(args.new) as f:
+        new = json.load(f)
+    if (base.get("accel"), base.get("cpu")) != (new.get("accel"), new.get("cpu")):
+        print("warning: runs with different accelerator or CPU model, times are not comparable")
+    regressions = 0
+    for fixture, data in new["fixtures"].items():
+        old = base["fixtures"].get(fixture)
+        if old is None:
+            continue
+        print(fixture)
+        rows = [(k, old["phases"].get(k), v, "ms") for k, v in data["phases"].items()]
+        rows += [(k, old["counters"].get(k), v, "") for k, v in data["counters"].items()]
+        for name, before, after, unit in rows:
+            if before is None:
+                print("  %-44s %14s %14.3f  new" % (name, "-", after))
+                continue
+            delta = after - before
+            percent = 100.0 * delta / before if before else (0.0 if delta == 0 else 100.0)
+            slower = percent > args.threshold and (unit != "ms" or delta > args.min_ms)
+            regressions += slower
+            print("  %-44s %14.3f %14.3f  %+7.1f%%%s" % (name, before, after, percent, "  REGRESSION" if slower else ""))
+    if regressions:
+        print("%d regressions over %.1f%%" % (regressions, args.threshold))
+        return 1
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="CloverX64 boot time benchmark under QEMU/OVMF")
+    sub = parser.add_subparsers(dest="command")
+    sub.required = True
+
+    run = sub.add_parser("run", help="boot each fixture N times and report per-phase medians")
+    run.add_argument("clover", help="CloverX64.efi to benchmark")
+    run.add_argument("-n", "--runs", type=int, default=5)
+    run.add_argument("-o", "--output", help="results JSON, input of compare")
+    run.add_argument("-f", "--fixture", action="append", choices=list(FIXTURES), help="default: all")
+    run.add_argument("--ovmf", default=os.path.join(QEMU_DIR, "OVMF.fd"))
+    run.add_argument("--qemu", help="qemu-system-x86_64 to use")
+    run.add_argument("--accel", default="auto", help="kvm, hvf, tcg, default kvm if usable else tcg")
+    run.add_argument("--cpu", default="Penryn", help="QEMU CPU model, as Qemu/test.sh")
+    run.add_argument("--timeout", type=int, default=180, help="seconds per boot")
+    run.add_argument("--logs", help="directory to keep the serial logs")
+    run.add_argument("--keep", action="store_true", help="keep the ESP of a failed run")
+    run.set_defaults(func=cmd_run)
+
+    compare = sub.add_parser("compare", help="flag phases slower than the base")
+    compare.add_argument("base")
+    compare.add_argument("new")
+    compare.add_argument("--threshold", type=float, default=10.0, help="percent, default 10")
+    compare.add_argument("--min-ms", type=float, default=2.0, help="ignore smaller time differences, default 2")
+    compare.set_defaults(func=cmd_compare)
+
+    args = parser.parse_args()
+    return args.func(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -20,6 +20,9 @@
 #include <vector>
 
 #include "../../../rEFIt_UEFI/cpp_foundation/unicode_conversions.h"
+#include "../../../rEFIt_UEFI/Platform/PerfCounters.h"
+
+PERF_COUNTERS gPerfCounters;
 
 void CpuDeadLoop(void)
 {
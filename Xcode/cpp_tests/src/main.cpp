@@ -6,18 +6,106 @@
 //  Copyright © 2020 JF Knudsen. All rights reserved.
 //
 
+#include <Platform.h>
 #include <iostream>
 #include <locale.h>
 
 #include "../../../rEFIt_UEFI/cpp_unit_test/all_tests.h"
+#ifdef CPP_TESTS_BENCHMARKS
+#include "../../../rEFIt_UEFI/cpp_unit_test/all_benchmarks.h"
+#endif
+#include "../../../rEFIt_UEFI/cpp_unit_test/patch_replay.h"
+
+// whole file in a malloc'ed buffer, NULL if it can't be read
+static void* readFile(const char* path, size_t* size)
+{
+	FILE* f = fopen(path, "rb");
+	if ( !f ) {
+		fprintf(stderr, "Cannot open %s\n", path);
+		return NULL;
+	}
+	fseek(f, 0, SEEK_END);
+	long len = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	void* data = len > 0 ? malloc((size_t)len) : NULL;
+	if ( data  &&  fread(data, 1, (size_t)len, f) != (size_t)len ) {
+		free(data);
+		data = NULL;
+	}
+	fclose(f);
+	*size = data ? (size_t)len : 0;
+	return data;
+}
+
+#ifdef CPP_TESTS_BENCHMARKS
+/*
+ * cpp_tests --bench [--config=config.plist] [--kernel=kernelcache] [--svg=theme.svg] [--dsdt=DSDT.aml]
+ * The kernelcache must be uncompressed.
+ */
+static int benchmarks(int argc, const char * argv[])
+{
+	BENCHMARK_INPUTS inputs;
+	memset(&inputs, 0, sizeof(inputs));
+	for ( int i = 2 ; i < argc ; i++ ) {
+		if ( strncmp(argv[i], "--config=", 9) == 0 ) inputs.Config = (const char*)readFile(argv[i] + 9, &inputs.ConfigSize);
+		else if ( strncmp(argv[i], "--kernel=", 9) == 0 ) inputs.Kernel = (UINT8*)readFile(argv[i] + 9, &inputs.KernelSize);
+		else if ( strncmp(argv[i], "--svg=", 6) == 0 ) inputs.Svg = (const char*)readFile(argv[i] + 6, &inputs.SvgSize);
+		else if ( strncmp(argv[i], "--dsdt=", 7) == 0 ) inputs.Dsdt = (const UINT8*)readFile(argv[i] + 7, &inputs.DsdtSize);
+		else {
+			fprintf(stderr, "Unknown option %s\n", argv[i]);
+			return -1;
+		}
+	}
+	all_benchmarks(inputs);
+	free((void*)inputs.Config);
+	free(inputs.Kernel);
+	free((void*)inputs.Svg);
+	free((void*)inputs.Dsdt);
+	return 0;
+}
+#endif
+
+/*
+ * cpp_tests --replay --config=config.plist --kernel=kernelcache [--bins=16]
+ * Replays KernelToPatch and KextsToPatch on the kernel, see patch_replay.h. The kernelcache must be uncompressed.
+ */
+static int replay(int argc, const char * argv[])
+{
+	PATCH_REPLAY_INPUTS inputs;
+	memset(&inputs, 0, sizeof(inputs));
+	for ( int i = 2 ; i < argc ; i++ ) {
+		if ( strncmp(argv[i], "--config=", 9) == 0 ) inputs.Config = (const char*)readFile(argv[i] + 9, &inputs.ConfigSize);
+		else if ( strncmp(argv[i], "--kernel=", 9) == 0 ) inputs.Kernel = (UINT8*)readFile(argv[i] + 9, &inputs.KernelSize);
+		else if ( strncmp(argv[i], "--bins=", 7) == 0 ) inputs.Bins = (UINTN)strtoul(argv[i] + 7, NULL, 10);
+		else {
+			fprintf(stderr, "Unknown option %s\n", argv[i]);
+			return -1;
+		}
+	}
+	int count = patch_replay(inputs);
+	if ( count < 0 ) {
+		fprintf(stderr, "--config and --kernel are needed, config must be a valid plist\n");
+	}
+	free((void*)inputs.Config);
+	free(inputs.Kernel);
+	return count < 0 ? -1 : 0;
+}
 
 
 extern "C" int main(int argc, const char * argv[])
 {
-	(void)argc;
-	(void)argv;
 	setlocale(LC_ALL, "en_US"); // to allow printf unicode char
 
+#ifdef CPP_TESTS_BENCHMARKS
+	// only the "cpp_tests UTF16 signed char" target builds all_benchmarks.cpp and the code it measures
+	if ( argc > 1  &&  strcmp(argv[1], "--bench") == 0 ) {
+		return benchmarks(argc, argv);
+	}
+#endif
+	if ( argc > 1  &&  strcmp(argv[1], "--replay") == 0 ) {
+		return replay(argc, argv);
+	}
+
 printf("sizeof(wchar_t)=%zu\n", sizeof(wchar_t));
 printf("%lc\n", L'Ľ');
 printf("sizeof(size_t)=%zu\n", sizeof(size_t));
@@ -1,31 +1,72 @@
 #include <Library/UefiLib.h>
 #include <Library/ShellLib.h>
 #include <Library/MemLogLib.h>
+#include <Library/BaseLib.h>
+
+static SHELL_PARAM_ITEM const ParamList[] = {
+	{ L"-o", TypeValue },
+	{ L"-p", TypeValue },
+	{ L"-l", TypeFlag },
+	{ NULL, TypeMax }
+};
 
 EFI_STATUS
 EFIAPI
 BdmesgMain(IN EFI_HANDLE ImageHandle, IN EFI_SYSTEM_TABLE *SystemTable)
 {
 	static CHAR16 const NoMemLog[] = L"%EUnsuccessful getting memory log%N\n";
-	static CHAR16 const Usage[] = L"%HUsage: bdmesg [-b]\n  -b: paginate%N\n";
+	static CHAR16 const NoPhase[] = L"%EPhase not found, -l lists them%N\n";
+	static CHAR16 const Usage[] = L"%HUsage: bdmesg [-b] [-o offset | -p phase | -l]\n  -b: paginate\n  -o: print from log offset\n  -p: print one phase\n  -l: list phases with their offsets%N\n";
 	CHAR8 const* log;
+	CHAR8 phaseName[MEM_LOG_PHASE_NAME_SIZE];
+	CHAR16 const* value;
+	MEM_LOG_PHASE const* phases;
 	LIST_ENTRY* Package;
-	UINTN logLength, numPrinted;
+	UINTN logLength, numPrinted, offset, phaseCount, i;
 	EFI_STATUS Status;
 	BOOLEAN SkipLn;
 
-	logLength = GetMemLogLen();
-	log = GetMemLogBuffer();
-	if (!log) {
+	MemLogDrainAp();
+	if (!GetMemLogBuffer()) {
 		ShellPrintEx(-1, -1, &NoMemLog[0]);
 		return EFI_NOT_FOUND;
 	}
-	Status = ShellCommandLineParseEx(&EmptyParamList[0], &Package, NULL, TRUE, FALSE);
+	Status = ShellCommandLineParseEx((SHELL_PARAM_ITEM*)&ParamList[0], &Package, NULL, TRUE, FALSE);
 	if (EFI_ERROR(Status)) {
 		ShellPrintEx(-1, -1, &Usage[0]);
 		return EFI_INVALID_PARAMETER;
 	}
+	phaseCount = GetMemLogPhases(&phases);
+	if (ShellCommandLineGetFlag(Package, L"-l")) {
+		ShellCommandLineFreeVarList(Package);
+		for (i = 0; i < phaseCount; i++)
+			Print(L"%8d  %a\n", phases[i].Offset, phases[i].Name);
+		return EFI_SUCCESS;
+	}
+	offset = 0;
+	logLength = 0;
+	value = ShellCommandLineGetValue(Package, L"-o");
+	if (value)
+		offset = ShellStrToUintn(value);
+	value = ShellCommandLineGetValue(Package, L"-p");
+	if (value) {
+		UnicodeStrnToAsciiStrS(value, sizeof(phaseName) - 1, phaseName, sizeof(phaseName), &i);
+		for (i = 0; i < phaseCount; i++)
+			if (AsciiStrCmp(phases[i].Name, phaseName) == 0)
+				break;
+		if (i == phaseCount) {
+			ShellCommandLineFreeVarList(Package);
+			ShellPrintEx(-1, -1, &NoPhase[0]);
+			return EFI_NOT_FOUND;
+		}
+		offset = phases[i].Offset;
+		if (i + 1 < phaseCount)
+			logLength = phases[i + 1].Offset - offset;
+	}
 	ShellCommandLineFreeVarList(Package);
+	numPrinted = GetMemLogChunk(offset, &log);
+	if (!logLength || logLength > numPrinted)
+		logLength = numPrinted;
 	Status = EFI_SUCCESS;
 	SkipLn = TRUE;
 	while (logLength) {
@@ -72,22 +72,20 @@ static UINTN check_mbr(VOID)
     return 0;
 }
 
-static UINTN write_mbr(VOID)
+static UINT8 new_mbr_sector[512];
+
+static VOID build_mbr(VOID)
 {
-    UINTN               status = 0;
     UINTN               i = 0;
     UINTN			  k = 0;
     UINT8               active = 0;
     UINT64              lba = 0;
     MBR_PARTITION_INFO  *table = NULL;
     BOOLEAN             have_bootcode = FALSE;
+    UINT8               *sector = new_mbr_sector;
     
-    Print(L"\nWriting new MBR...\n");
-    
-    // read MBR data
-    status = read_sector(0, sector);
-    if (status != 0)
-        return status;
+    // start from the MBR data read by read_mbr()
+    CopyMem(sector, mbr_sector, 512);
     
     // write partition table
     *((UINT16 *)(sector + 510)) = 0xaa55;
@@ -161,11 +159,19 @@ static UINTN write_mbr(VOID)
         CopyMem(sector, clover_boot0ss_mbr, CLOVER_BOOT0SS_MBR_SIZE);
 #endif /* _MBR_COPY_DATA_H_ */
     }
+}
+
+static UINTN write_mbr(VOID)
+{
+    UINTN               status = 0;
+    
+    Print(L"\nWriting new MBR...\n");
     
     // write MBR data
-    status = write_sector(0, sector);
+    status = write_sector(0, new_mbr_sector);
     if (status != 0)
         return status;
+    CopyMem(mbr_sector, new_mbr_sector, 512);
     
     Print(L"MBR updated successfully!\n");
     
@@ -487,6 +493,13 @@ UINTN gptsync(VOID)
     if (new_mbr_part_count == 0)
         return status;
     
+    // compose the new sector and skip the write if nothing would change
+    build_mbr();
+    if (CompareMem(new_mbr_sector, mbr_sector, 512) == 0) {
+        Print(L"\nStatus: MBR on disk already matches, no need to write.\n");
+        return 0;
+    }
+    
     // offer user the choice what to do
     status = input_boolean(STR("\nMay I update the MBR as printed above? [y/N] "), &proceed);
     if ((status != 0) || (proceed != TRUE))
@@ -132,6 +132,7 @@ typedef struct {
 //
 
 UINTN read_sector(UINT64 lba, UINT8 *buffer);
+UINTN read_sectors(UINT64 lba, UINTN count, UINT8 *buffer);
 UINTN write_sector(UINT64 lba, UINT8 *buffer);
 UINTN input_boolean(CHARN *prompt, BOOLEAN *bool_out);
 
@@ -150,6 +151,7 @@ extern PARTITION_INFO  new_mbr_parts[4];
 extern UINTN           new_mbr_part_count;
 
 extern UINT8           sector[512];
+extern UINT8           mbr_sector[512];
 
 extern MBR_PARTTYPE    mbr_types[];
 extern GPT_PARTTYPE    gpt_types[];
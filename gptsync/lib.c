@@ -49,6 +49,7 @@ PARTITION_INFO  new_mbr_parts[4];
 UINTN           new_mbr_part_count = 0;
 
 UINT8           sector[512];
+UINT8           mbr_sector[512];    // MBR as currently on disk
 
 MBR_PARTTYPE    mbr_types[] = {
     { 0x01, STR("FAT12 (CHS)") },
@@ -192,6 +193,7 @@ UINTN read_mbr(VOID)
     if (status != 0) {
         return status;
     }
+    CopyMem(mbr_sector, sector, 512);
 
     // check for validity
     if (*((UINT16 *)(sector + 510)) != 0xaa55) {
@@ -275,6 +277,8 @@ UINTN read_gpt(VOID)
     UINT64      entry_lba = 0;
     UINTN       entry_count = 0;
     UINTN       entry_size = 0;
+    UINTN       entry_sectors = 0;
+    UINT8       *entries = NULL;
     UINTN       i = 0;
     
     Print(L"\nCurrent GPT partition table:\n");
@@ -307,17 +311,21 @@ UINTN read_gpt(VOID)
     entry_lba   = header->entry_lba;
     entry_size  = header->entry_size;
     entry_count = header->entry_count;
+    entry_sectors = (entry_count * entry_size + 511) / 512;
     
-    for (i = 0; i < entry_count; i++) {
-        if (((i * entry_size) % 512) == 0) {
-            status = read_sector(entry_lba, sector);
-            if (status != 0) {
-                return status;
-            }
-            entry_lba++;
-        }
-
-        entry = (GPT_ENTRY *)(sector + ((i * entry_size) % 512));
+    // fetch the whole entry array with a single request
+    entries = AllocatePool(entry_sectors * 512);
+    if (entries == NULL) {
+        return 1;
+    }
+    status = read_sectors(entry_lba, entry_sectors, entries);
+    if (status != 0) {
+        FreePool(entries);
+        return status;
+    }
+    
+    for (i = 0; i < entry_count && gpt_part_count < 128; i++) {
+        entry = (GPT_ENTRY *)(entries + i * entry_size);
         
         if (guids_are_equal(entry->type_guid, empty_guid)) {
             continue;
@@ -343,6 +351,7 @@ UINTN read_gpt(VOID)
         
         gpt_part_count++;
     }
+    FreePool(entries);
 
     if (gpt_part_count == 0) {
         Print(L" No partitions defined\n");
@@ -46,15 +46,15 @@ EFI_BLOCK_IO2_TOKEN BlockIO2Token;
 // sector I/O functions
 //
 
-UINTN read_sector(UINT64 lba, UINT8 *buffer)
+UINTN read_sectors(UINT64 lba, UINTN count, UINT8 *buffer)
 {
     EFI_STATUS          Status;
 
     if (BlockIO2 != NULL)
     {
-      Status = BlockIO2->ReadBlocksEx(BlockIO2, BlockIO2->Media->MediaId, lba, &BlockIO2Token, 512, buffer);
+      Status = BlockIO2->ReadBlocksEx(BlockIO2, BlockIO2->Media->MediaId, lba, &BlockIO2Token, count * 512, buffer);
     } else {
-      Status = BlockIO->ReadBlocks(BlockIO, BlockIO->Media->MediaId, lba, 512, buffer);
+      Status = BlockIO->ReadBlocks(BlockIO, BlockIO->Media->MediaId, lba, count * 512, buffer);
     }
     if (EFI_ERROR(Status)) {
         // TODO: report error
@@ -63,6 +63,11 @@ UINTN read_sector(UINT64 lba, UINT8 *buffer)
     return 0;
 }
 
+UINTN read_sector(UINT64 lba, UINT8 *buffer)
+{
+    return read_sectors(lba, 1, buffer);
+}
+
 UINTN write_sector(UINT64 lba, UINT8 *buffer)
 {
     EFI_STATUS          Status;
@@ -0,0 +1,72 @@
+/*
+ * AcpiDumpSet.cpp
+ *
+ * Two chained hashes over the same items, one of the address and one of Length and CRC32.
+ */
+
+#include "AcpiDumpSet.h"
+
+static UINT32 AddressSlotOf(const void* Table)
+{
+  UINT64 Address = (UINT64)(UINTN)Table;
+  return (UINT32)(((Address >> 3) ^ (Address >> 17)) * 2654435761U) >> 24; // 256 slots
+}
+
+static UINT32 ContentSlotOf(UINT32 Length, UINT32 Crc32)
+{
+  return ((Crc32 ^ (Length * 2654435761U)) * 2654435761U) >> 24;
+}
+
+void AcpiDumpSet::Reset()
+{
+  Items.setEmpty();
+  SetMem(AddressSlots, sizeof(AddressSlots), 0);
+  SetMem(ContentSlots, sizeof(ContentSlots), 0);
+}
+
+BOOLEAN AcpiDumpSet::IsSaved(const void* Table) const
+{
+  UINT32 Item = AddressSlots[AddressSlotOf(Table)];
+
+  while (Item != 0) {
+    if (Items.ElementAt((size_t)Item - 1).Table == Table) {
+      return TRUE;
+    }
+    Item = Items.ElementAt((size_t)Item - 1).NextAddress;
+  }
+  return FALSE;
+}
+
+const void* AcpiDumpSet::FindSame(const void* Table, UINT32 Length, UINT32 Crc32) const
+{
+  UINT32 Item = ContentSlots[ContentSlotOf(Length, Crc32)];
+
+  while (Item != 0) {
+    const ACPI_DUMP_ITEM& Saved = Items.ElementAt((size_t)Item - 1);
+    if (Saved.Length == Length && Saved.Crc32 == Crc32 &&
+        (Saved.Table == Table || CompareMem(Saved.Table, Table, Length) == 0)) {
+      return Saved.Table;
+    }
+    Item = Saved.NextContent;
+  }
+  return NULL;
+}
+
+void AcpiDumpSet::Add(const void* Table, UINT32 Length, UINT32 Crc32)
+{
+  ACPI_DUMP_ITEM Item;
+  UINT32 AddressSlot = AddressSlotOf(Table);
+  UINT32 ContentSlot = ContentSlotOf(Length, Crc32);
+
+  if (IsSaved(Table)) {
+    return;
+  }
+  Item.Table = Table;
+  Item.Length = Length;
+  Item.Crc32 = Crc32;
+  Item.NextAddress = AddressSlots[AddressSlot];
+  Item.NextContent = ContentSlots[ContentSlot];
+  Items.Add(Item);
+  AddressSlots[AddressSlot] = (UINT32)Items.size();
+  ContentSlots[ContentSlot] = (UINT32)Items.size();
+}
@@ -0,0 +1,45 @@
+/*
+ * AcpiDumpSet.h
+ *
+ * Tables already saved by DumpTables(), found by their address and by their content.
+ * A table at an address already seen is not saved twice, a table having the same bytes as
+ * a saved one (same Length and CRC32, then compared) is not saved twice either.
+ */
+
+#ifndef PLATFORM_ACPIDUMPSET_H_
+#define PLATFORM_ACPIDUMPSET_H_
+
+#include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+#include "../cpp_foundation/XArray.h"
+
+#define ACPI_DUMP_SET_SLOTS  256
+
+typedef struct {
+  const void* Table;
+  UINT32      Length;
+  UINT32      Crc32;
+  UINT32      NextAddress;  // chains of the slots, item + 1, 0 at the end
+  UINT32      NextContent;
+} ACPI_DUMP_ITEM;
+
+class AcpiDumpSet
+{
+protected:
+  XArray<ACPI_DUMP_ITEM> Items;
+  UINT32                 AddressSlots[ACPI_DUMP_SET_SLOTS];  // item + 1, 0 if free
+  UINT32                 ContentSlots[ACPI_DUMP_SET_SLOTS];
+
+public:
+  AcpiDumpSet() : Items() { Reset(); }
+
+  void    Reset();
+  size_t  size() const { return Items.size(); }
+
+  BOOLEAN IsSaved(const void* Table) const;
+  // a saved table having the same Length bytes as Table, NULL if none
+  const void* FindSame(const void* Table, UINT32 Length, UINT32 Crc32) const;
+  // does nothing if this address is already saved
+  void    Add(const void* Table, UINT32 Length, UINT32 Crc32);
+};
+
+#endif /* PLATFORM_ACPIDUMPSET_H_ */
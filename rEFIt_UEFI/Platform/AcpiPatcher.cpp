@@ -21,11 +21,14 @@
 #include "AmlGenerator.h"
 #include "AcpiPatcher.h"
 #include "FixBiosDsdt.h"
+#include "XsdtIndex.h"
+#include "AcpiDumpSet.h"
 #include "platformdata.h"
 #include "smbios.h"
 #include "cpu.h"
 #include "Self.h"
 #include "SelfOem.h"
+#include "BootTimeline.h"
 
 #define EBDA_BASE_ADDRESS            0x40E
 
@@ -51,7 +54,6 @@ CONST CHAR8  creatorID[4]   = APPLE_CREATOR_ID;
 //Global pointers
 RSDT_TABLE    *Rsdt = NULL;
 XSDT_TABLE    *Xsdt = NULL;
-UINTN         *XsdtReplaceSizes = NULL;
 
 #define IndexFromEntryPtr(xsdt_or_rsdt, entry_ptr) \
 ((UINT32)(((CHAR8*)(entry_ptr) - (CHAR8*)&(xsdt_or_rsdt)->Entry)/sizeof((xsdt_or_rsdt)->Entry)))
@@ -66,6 +68,17 @@ UINTN         *XsdtReplaceSizes = NULL;
 #define RsdtEntryFromIndex(index) (EFI_ACPI_DESCRIPTION_HEADER*)(UINTN)*RsdtEntryPtrFromIndex(index)
 #define XsdtEntryFromIndex(index) (EFI_ACPI_DESCRIPTION_HEADER*)(UINTN)ReadUnaligned64(XsdtEntryPtrFromIndex(index))
 
+// The XSDT entries are edited in XsdtTables from the first change and written back by PostCleanupXSDT()
+static XsdtIndex XsdtTables;
+
+static XsdtIndex& GetXsdtTables()
+{
+  if (!XsdtTables.IsBuiltFrom(Xsdt)) {
+    XsdtTables.Build(Xsdt, XsdtEntryPtrFromIndex(0), (UINT32)XsdtTableCount());
+  }
+  return XsdtTables;
+}
+
 UINT64      BiosDsdt;
 UINT32      BiosDsdtLen;
 UINT8       acpi_cpu_count;
@@ -130,16 +143,6 @@ void* FindAcpiRsdPtr()
   return NULL;
 }
 
-UINT8 Checksum8(void* startPtr, UINT32 len)
-{
-  UINT8 Value = 0;
-  UINT8 *ptr = (UINT8*)startPtr;
-  UINT8 *endPtr = ptr + len;
-  while (ptr < endPtr)
-    Value += *ptr++;
-  return Value;
-}
-
 void FixChecksum(EFI_ACPI_DESCRIPTION_HEADER* Table)
 {
   Table->Checksum = 0;
@@ -148,23 +151,21 @@ void FixChecksum(EFI_ACPI_DESCRIPTION_HEADER* Table)
 
 void SaveMergedXsdtEntrySize(UINT32 Index, UINTN Size)
 {
-  // manage XsdtReplaceSizes (free existing, store new)
-  if (XsdtReplaceSizes) {
-    if (XsdtReplaceSizes[Index]) {
-      // came from patched table in ACPI/patched, so free original pages
-      gBS->FreePages((EFI_PHYSICAL_ADDRESS)(UINTN)XsdtEntryFromIndex(Index), XsdtReplaceSizes[Index]);
-      XsdtReplaceSizes[Index] = 0;
-    }
-    XsdtReplaceSizes[Index] = EFI_SIZE_TO_PAGES(Size);
+  // manage merged pages in XsdtTables (free existing, store new)
+  XsdtIndex& Tables = GetXsdtTables();
+  if (Tables.GetMergedPages(Index)) {
+    // came from patched table in ACPI/patched, so free original pages
+    gBS->FreePages((EFI_PHYSICAL_ADDRESS)Tables.GetEntry(Index), Tables.GetMergedPages(Index));
   }
+  Tables.SetMergedPages(Index, EFI_SIZE_TO_PAGES(Size));
 }
 
 BOOLEAN IsXsdtEntryMerged(UINT32 Index)
 {
-  if (!XsdtReplaceSizes) {
+  if (!XsdtTables.IsBuiltFrom(Xsdt)) {
     return FALSE;
   }
-  return 0 != XsdtReplaceSizes[Index];
+  return 0 != XsdtTables.GetMergedPages(Index);
 }
 
 UINT32* ScanRSDT2(UINT32 Signature, UINT64 TableId, UINTN MatchIndex)
@@ -204,6 +205,11 @@ UINT64* ScanXSDT2(UINT32 Signature, UINT64 TableId, UINTN MatchIndex)
   if (!Xsdt || (0 == Signature && 0 == TableId)) {
     return NULL;
   }
+  if (XsdtTables.IsBuiltFrom(Xsdt)) {
+    // pointer to the entry in XsdtTables, valid until a table is inserted
+    UINT32 Index = XsdtTables.Find(Signature, TableId, MatchIndex);
+    return (Index == XSDT_INDEX_NONE) ? NULL : XsdtTables.GetEntryPtr(Index);
+  }
 
   UINT32 Count = XsdtTableCount();
   UINTN MatchingCount = 0;
@@ -343,31 +349,28 @@ void DropTableFromXSDT(UINT32 Signature, UINT64 TableId, UINT32 Length)
   CopyMem(&OTID[0], &TableId, 8);
   DBG("Drop tables from XSDT, SIGN=%s TableID=%s Length=%d\n", sign, OTID, (INT32)Length);
 
-  UINT32 Count = XsdtTableCount();
-  //DBG(" Xsdt has tables count=%d\n", Count);
-  UINT64* Ptr = XsdtEntryPtrFromIndex(0);
-  UINT64* EndPtr = XsdtEntryPtrFromIndex(Count);
-  for (; Ptr < EndPtr; Ptr++) {
-    EFI_ACPI_DESCRIPTION_HEADER* Table = (EFI_ACPI_DESCRIPTION_HEADER*)(UINTN)ReadUnaligned64(Ptr);
-    if (!Table) {
-      // skip NULL entry
-      continue;
-    }
+  // only the tables having this signature are visited
+  XsdtIndex& Tables = GetXsdtTables();
+  UINTN Nth = 0;
+  UINT32 Index;
+  while (Signature && (Index = Tables.GetNth(Signature, Nth)) != XSDT_INDEX_NONE) {
+    EFI_ACPI_DESCRIPTION_HEADER* Table = (EFI_ACPI_DESCRIPTION_HEADER*)(UINTN)Tables.GetEntry(Index);
     CopyMem(&sign[0], &Table->Signature, 4);
     CopyMem(&OTID[0], &Table->OemTableId, 8);
     //DBG(" Found table: %s  %s\n", sign, OTID);
-    if (!((Signature && Table->Signature == Signature) &&
-          (!TableId || Table->OemTableId == TableId) &&
+    if (!((!TableId || Table->OemTableId == TableId) &&
           (!Length || Table->Length == Length))) {
+      Nth++;
       continue;
     }
-    if (IsXsdtEntryMerged(IndexFromXsdtEntryPtr(Ptr))) {
-      DBG(" attempt to drop already merged table[%d]: %s  %s  %d ignored\n", IndexFromXsdtEntryPtr(Ptr), sign, OTID, (INT32)Table->Length);
+    if (IsXsdtEntryMerged(Index)) {
+      DBG(" attempt to drop already merged table[%d]: %s  %s  %d ignored\n", Index, sign, OTID, (INT32)Table->Length);
+      Nth++;
       continue;
     }
-    // drop matching table by simply replacing entry with NULL
-    WriteUnaligned64(Ptr, 0);
-    DBG(" Table[%d]: %s  %s  %d dropped\n", IndexFromXsdtEntryPtr(Ptr), sign, OTID, (INT32)Table->Length);
+    // drop matching table, the next one takes its place in the list
+    Tables.Drop(Index);
+    DBG(" Table[%d]: %s  %s  %d dropped\n", Index, sign, OTID, (INT32)Table->Length);
   }
 }
 
@@ -405,12 +408,13 @@ BOOLEAN PatchTableHeader(EFI_ACPI_DESCRIPTION_HEADER *Header)
 
 void PatchAllTables()
 {
-  UINT32 Count = XsdtTableCount();
-  UINT64* Ptr = XsdtEntryPtrFromIndex(0);
-  UINT64* EndPtr = XsdtEntryPtrFromIndex(Count);
-  for (; Ptr < EndPtr; Ptr++) {
+  XsdtIndex& Tables = GetXsdtTables();
+  DsdtPatchPlan Plan; // same patches for all the SSDTs, grouped once
+
+  Plan.Build();
+  for (UINT32 Index = 0; Index < Tables.GetCount(); Index++) {
     BOOLEAN Patched = FALSE;
-    EFI_ACPI_DESCRIPTION_HEADER* Table = (EFI_ACPI_DESCRIPTION_HEADER*)(UINTN)ReadUnaligned64(Ptr);
+    EFI_ACPI_DESCRIPTION_HEADER* Table = (EFI_ACPI_DESCRIPTION_HEADER*)(UINTN)Tables.GetEntry(Index);
     if (!Table) {
       // skip NULL entry
       continue;
@@ -435,43 +439,25 @@ void PatchAllTables()
     CopyMem(NewTable, Table, Len);
     if ((gSettings.FixDsdt & FIX_HEADERS) || gSettings.FixHeaders) {
       // Merged tables already have the header patched, so no need to do it again
-      if (!IsXsdtEntryMerged(IndexFromXsdtEntryPtr(Ptr))) {
+      if (!IsXsdtEntryMerged(Index)) {
         // table header NOT already patched
         Patched = PatchTableHeader(NewTable);
       }
     }
     if (NewTable->Signature == EFI_ACPI_4_0_SECONDARY_SYSTEM_DESCRIPTION_TABLE_SIGNATURE) {
+      UINT64 PatchStart = AsmReadTsc();
+      CHAR8  OTID[9];
+      OTID[8] = 0;
+      CopyMem(OTID, &NewTable->OemTableId, 8);
       if (gSettings.DSDTPatchArray.size() > 0) {
         DBG("Patching SSDTs: %zu patches each\n", gSettings.DSDTPatchArray.size());
-
-//        CHAR8  OTID[9];
-//        OTID[8] = 0;
-//        CopyMem(OTID, &NewTable->OemTableId, 8);
 //        DBG("Patching SSDT %s Length=%d\n",  OTID, (INT32)Len);
-
-        for (UINT32 i = 0; i < gSettings.DSDTPatchArray.size(); i++) {
-          if ( gSettings.DSDTPatchArray[i].PatchDsdtFind.isEmpty() ) {
-            continue;
-          }
-//          DBG("%d. [%s]:", i, gSettings.PatchDsdtLabel[i]);
-          if (!gSettings.DSDTPatchArray[i].PatchDsdtMenuItem.BValue) {
-//            DBG(" disabled\n");
-            continue;
-          }
-          if ( gSettings.DSDTPatchArray[i].PatchDsdtTgt.isEmpty() ) {
-            Len = FixAny((UINT8*)NewTable, Len,
-                         gSettings.DSDTPatchArray[i].PatchDsdtFind,
-                         gSettings.DSDTPatchArray[i].PatchDsdtReplace);
-            //DBG(" OK\n");
-          }else{
-            //DBG("Patching: renaming in bridge\n");
-            Len = FixRenameByBridge2((UINT8*)NewTable, Len, gSettings.DSDTPatchArray[i].PatchDsdtTgt, gSettings.DSDTPatchArray[i].PatchDsdtFind, gSettings.DSDTPatchArray[i].PatchDsdtReplace);
-          }
-        }
+        Len = Plan.Apply((UINT8*)NewTable, Len, FALSE);
       }
       // fixup length and checksum
       NewTable->Length = Len;
       RenameDevices((UINT8*)NewTable);
+      MsgLog("SSDT %s patched in %llu us\n", OTID, AcpiPatchTime(PatchStart));
       GetBiosRegions((UINT8*)NewTable);  //take Regions from SSDT even if they will be dropped
       Patched = TRUE;
     }
@@ -481,7 +467,7 @@ void PatchAllTables()
       NewTable->Length = (UINT32)(UINTN)Len1;      Patched = TRUE;
     }
     if (Patched) {
-      WriteUnaligned64(Ptr, BufferPtr);
+      Tables.Replace(Index, BufferPtr);
       FixChecksum(NewTable);
     }
     else {
@@ -521,10 +507,7 @@ EFI_STATUS InsertTable(void* TableEntry, UINTN Length)
     }
     //insert into XSDT
     if (Xsdt) {
-      UINT64* Ptr = XsdtEntryPtrFromIndex(XsdtTableCount());
-      WriteUnaligned64(Ptr, BufferPtr);
-      Xsdt->Header.Length += sizeof(UINT64);
-      //DBG("Xsdt->Length = %d\n", Xsdt->Header.Length);
+      GetXsdtTables().Add(BufferPtr);
     }
   }
   return Status;
@@ -598,26 +581,23 @@ EFI_STATUS ReplaceOrInsertTable(void* TableEntry, UINTN Length, UINTN MatchIndex
 #endif
     //insert/modify into XSDT
     if (Xsdt) {
-      UINT64* Ptr = NULL;
+      XsdtIndex& Tables = GetXsdtTables();
+      UINT32 Index = XSDT_INDEX_NONE;
       if (hdr->Signature != EFI_ACPI_4_0_SECONDARY_SYSTEM_DESCRIPTION_TABLE_SIGNATURE || MatchIndex != IGNORE_INDEX) {
         // SSDT with target index or non-SSDT, try to find matching entry
-        Ptr = ScanXSDT2(hdr->Signature, hdr->OemTableId, MatchIndex);
+        Index = Tables.Find(hdr->Signature, hdr->OemTableId, MatchIndex);
       }
       // Now is a good time to fix the table header and checksum (*MUST* be done after matching)
       PatchTableHeader(TableHeader);
       FixChecksum(TableHeader);
-      if (Ptr) {
-        UINT32 Index = IndexFromXsdtEntryPtr(Ptr);
+      if (Index != XSDT_INDEX_NONE) {
 		  DBG("@%llu ", (UINT64)Index);
         // keep track of new table size in case it needs to be freed later
         SaveMergedXsdtEntrySize(Index, Length);
-        WriteUnaligned64(Ptr, BufferPtr);
+        Tables.Replace(Index, BufferPtr);
         Status = EFI_SUCCESS;
       } else if (AUTOMERGE_PASS2 == Pass) {
-        Ptr = XsdtEntryPtrFromIndex(XsdtTableCount());
-        WriteUnaligned64(Ptr, BufferPtr);
-        Xsdt->Header.Length += sizeof(UINT64);
-        //DBG("Xsdt->Length = %d\n", Xsdt->Header.Length);
+        Tables.Add(BufferPtr);
         Status = EFI_SUCCESS;
       }
     }
@@ -719,28 +699,18 @@ void PreCleanupXSDT()
 
 void PostCleanupXSDT()
 {
-  UINT64 *Dest, *EndPtr, *Source;
   if (!Xsdt) {
     return;
   }
 
-  // remove NULL entries from XSDT table
-  UINT32 Count = XsdtTableCount();
+  // write the entries kept in XsdtTables in one pass, without the NULL ones
+  XsdtIndex& Tables = GetXsdtTables();
+  UINT32 Count = Tables.GetCount();
   DBG("Cleanup XSDT: count=%d, length=%d\n", Count, (UINT32)Xsdt->Header.Length);
-  Source = XsdtEntryPtrFromIndex(0);
-  Dest = Source;
-  EndPtr = XsdtEntryPtrFromIndex(Count);
-  while (Source < EndPtr) {
-    if (0 == *Source) {
-      // skip NULL entry
-      Source++;
-      continue;
-    }
-    WriteUnaligned64(Dest++, ReadUnaligned64(Source++));
-  }
+  Count = Tables.Write(XsdtEntryPtrFromIndex(0));
+  Tables.Reset();
   // fix header length
-  Xsdt->Header.Length = (UINT32)((CHAR8*)Dest - (CHAR8*)Xsdt);
-  Count = XsdtTableCount();
+  Xsdt->Header.Length = (UINT32)((CHAR8*)XsdtEntryPtrFromIndex(Count) - (CHAR8*)Xsdt);
   DBG("corrected XSDT count=%d, length=%d\n", Count, (UINT32)Xsdt->Header.Length);
   FixChecksum(&Xsdt->Header);
 }
@@ -766,76 +736,200 @@ EFI_STATUS SaveBufferToDisk(void *Buffer, UINTN Length, CONST CHAR16 *DirName, C
 //
 // Remembering saved tables
 //
-#define SAVED_TABLES_ALLOC_ENTRIES  64
-void   **mSavedTables = NULL;
-UINTN   mSavedTablesEntries = 0;
-UINTN   mSavedTablesNum = 0;
+static AcpiDumpSet SavedTables;
 
 /** Returns TRUE is TableEntry is already saved. */
 BOOLEAN IsTableSaved(void *TableEntry)
 {
-  UINTN   Index;
+  return SavedTables.IsSaved(TableEntry);
+}
 
-  if (mSavedTables != NULL) {
-    for (Index = 0; Index < mSavedTablesNum; Index++) {
-      if (mSavedTables[Index] == TableEntry) {
-        return TRUE;
-      }
+//
+// Files of the dump, written together by WriteDumpFiles() at the end of DumpTables()
+//
+#define ACPI_DUMP_MANIFEST  L"manifest.txt"
+
+class ACPI_DUMP_FILE
+{
+public:
+  const void* Table;
+  UINT32      Length;
+  UINT32      Crc32;
+  XStringW    FileName;
+  XString8    Signature;
+  XString8    OemId;
+  XString8    OemTableId;
+  BOOLEAN     Unchanged;  // same file in the previous dump
+
+  ACPI_DUMP_FILE() : Table(NULL), Length(0), Crc32(0), FileName(), Signature(), OemId(), OemTableId(), Unchanged(FALSE) {}
+};
+
+static XObjArray<ACPI_DUMP_FILE> DumpFiles;
+
+static XString8 DumpField(CONST CHAR8 *Field, UINTN Size)
+{
+  CHAR8 Buffer[9];
+
+  CopyMem(Buffer, Field, Size);
+  Buffer[Size] = 0;
+  stripTrailingSpaces(Buffer);
+  return S8Printf("%s", Buffer);
+}
+
+/** Queues TableEntry of Length to be saved as FileName.
+ *  A table with the same content as a table already queued is not saved again.
+ */
+EFI_STATUS SaveTableToDump(void *TableEntry, UINTN Length, const XStringW& FileName)
+{
+  ACPI_DUMP_FILE *File;
+  const void     *Same;
+  UINT32          Crc32 = 0;
+
+  if (SavedTables.IsSaved(TableEntry)) {
+    return EFI_ALREADY_STARTED;
+  }
+  Crc32 = GetCrc32(TableEntry, Length);
+  Same = SavedTables.FindSame(TableEntry, (UINT32)Length, Crc32);
+  SavedTables.Add(TableEntry, (UINT32)Length, Crc32);
+  if (Same != NULL) {
+    DBG(" (same as %llx)", (uintptr_t)Same);
+    return EFI_ALREADY_STARTED;
+  }
+
+  File = new ACPI_DUMP_FILE;
+  File->Table = TableEntry;
+  File->Length = (UINT32)Length;
+  File->Crc32 = Crc32;
+  File->FileName = FileName;
+  if (*(UINT64*)TableEntry == EFI_ACPI_1_0_ROOT_SYSTEM_DESCRIPTION_POINTER_SIGNATURE) {
+    File->Signature = "RSDP"_XS8;
+    File->OemId = DumpField((CHAR8*)((EFI_ACPI_2_0_ROOT_SYSTEM_DESCRIPTION_POINTER*)TableEntry)->OemId, 6);
+  } else {
+    File->Signature = DumpField((CHAR8*)TableEntry, 4);
+    if (((EFI_ACPI_DESCRIPTION_HEADER*)TableEntry)->Signature != EFI_ACPI_1_0_FIRMWARE_ACPI_CONTROL_STRUCTURE_SIGNATURE &&
+        Length >= sizeof(EFI_ACPI_DESCRIPTION_HEADER)) {
+      File->OemId = DumpField((CHAR8*)((EFI_ACPI_DESCRIPTION_HEADER*)TableEntry)->OemId, 6);
+      File->OemTableId = DumpField((CHAR8*)&((EFI_ACPI_DESCRIPTION_HEADER*)TableEntry)->OemTableId, 8);
     }
   }
-  return FALSE;
+  DumpFiles.AddReference(File, true);
+  return EFI_SUCCESS;
 }
 
-/** Adds TableEntry to mSavedTables if not already there. */
-void MarkTableAsSaved(void *TableEntry)
+/** Marks the queued files found with the same Length and CRC32 in the manifest of the previous dump. */
+static void FindUnchangedDumpFiles(const EFI_FILE* Dir)
 {
-  //
-  // If mSavedTables does not exists yet - allocate it
-  //
-  if (mSavedTables == NULL) {
-    //DBG(" Allocaing mSavedTables");
-    mSavedTablesEntries = SAVED_TABLES_ALLOC_ENTRIES;
-    mSavedTablesNum = 0;
-    mSavedTables = (__typeof__(mSavedTables))AllocateZeroPool(sizeof(*mSavedTables) * mSavedTablesEntries);
-    if (mSavedTables == NULL) {
-      return;
+  UINT8      *Data = NULL;
+  UINTN       Size = 0;
+  UINTN       Pos, End, Field;
+  UINT32      Length, Crc32 = 0;
+  EFI_FILE   *FileHandle;
+  size_t      Index;
+
+  if (EFI_ERROR(egLoadFile(Dir, ACPI_DUMP_MANIFEST, &Data, &Size)) || Data == NULL) {
+    return;
+  }
+  // Length\tCRC32\tSignature\tOemId\tOemTableId\tFile
+  for (Pos = 0; Pos < Size; Pos = End + 1) {
+    for (End = Pos; End < Size && Data[End] != '\n'; End++) {}
+    if (End == Size) {
+      break; // the numbers are parsed up to the end of line
+    }
+    if (Data[Pos] == '#') {
+      continue;
+    }
+    Length = (UINT32)AsciiStrDecimalToUintn((CHAR8*)Data + Pos);
+    for (Field = 0; Field < 5 && Pos < End; Pos++) {
+      if (Data[Pos] == '\t') {
+        if (++Field == 1) {
+          Crc32 = (UINT32)AsciiStrHexToUintn((CHAR8*)Data + Pos + 1);
+        }
+      }
+    }
+    if (Field < 5) {
+      continue;
+    }
+    XString8 Name;
+    Name.strncpy((CHAR8*)Data + Pos, End - Pos);
+    for (Index = 0; Index < DumpFiles.size(); Index++) {
+      ACPI_DUMP_FILE& File = DumpFiles[Index];
+      if (File.Length == Length && File.Crc32 == Crc32 && File.FileName == Name) {
+        // the file must still be there
+        if (!EFI_ERROR(Dir->Open(Dir, &FileHandle, File.FileName.wc_str(), EFI_FILE_MODE_READ, 0))) {
+          FileHandle->Close(FileHandle);
+          File.Unchanged = TRUE;
+        }
+        break;
+      }
     }
   }
+  FreePool(Data);
+}
 
-  //
-  // If TableEntry is not in mSavedTables - add it
-  //
-  //DBG(" MarkTableAsSaved %llx", TableEntry);
-  if (IsTableSaved(TableEntry)) {
-    // already saved
-    //DBG(" - already saved\n");
+static EFI_STATUS WriteDumpFile(const EFI_FILE* Dir, CONST CHAR16 *FileName, CONST void *Buffer, UINTN Length)
+{
+  EFI_STATUS  Status;
+  EFI_FILE   *FileHandle;
+
+  Status = Dir->Open(Dir, &FileHandle, FileName, EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE, 0);
+  if (!EFI_ERROR(Status)) {
+    FileHandle->Delete(FileHandle);
+  }
+  Status = Dir->Open(Dir, &FileHandle, FileName, EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE | EFI_FILE_MODE_CREATE, 0);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+  Status = FileHandle->Write(FileHandle, &Length, (void*)Buffer);
+  FileHandle->Close(FileHandle);
+  return Status;
+}
+
+/** Writes the queued files into OemDir\\DirName, the directory is opened once,
+ *  then the manifest listing them. Files unchanged since the previous dump are not written again.
+ */
+static void WriteDumpFiles(CONST CHAR16 *DirName)
+{
+  EFI_STATUS  Status;
+  EFI_FILE   *Dir;
+  const EFI_FILE* ConfigDir = &selfOem.getConfigDir();
+  XString8    Manifest;
+  size_t      Index;
+  UINTN       Written = 0, Unchanged = 0;
+
+  if (DumpFiles.size() == 0) {
     return;
   }
+  Status = ConfigDir->Open(ConfigDir, &Dir, DirName, EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE, EFI_FILE_DIRECTORY);
+  if (EFI_ERROR(Status)) {
+    Status = ConfigDir->Open(ConfigDir, &Dir, DirName, EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE | EFI_FILE_MODE_CREATE, EFI_FILE_DIRECTORY);
+  }
+  if (EFI_ERROR(Status)) {
+    DBG("Cannot open %ls: %s\n", DirName, efiStrError(Status));
+    DumpFiles.setEmpty();
+    return;
+  }
+  FindUnchangedDumpFiles(Dir);
 
-  //
-  // If mSavedTables is full - extend it
-  //
-  if (mSavedTablesNum + 1 >= mSavedTablesEntries) {
-    // not enough space
-    //DBG(" - extending mSavedTables from %d", mSavedTablesEntries);
-    mSavedTables = (__typeof__(mSavedTables))ReallocatePool(
-                                  sizeof(*mSavedTables) * mSavedTablesEntries,
-                                  sizeof(*mSavedTables) * (mSavedTablesEntries + SAVED_TABLES_ALLOC_ENTRIES),
-                                  mSavedTables
-                                  );
-    if (mSavedTables == NULL) {
-      return;
+  Manifest = "# Length\tCRC32\tSignature\tOemId\tOemTableId\tFile\n"_XS8;
+  for (Index = 0; Index < DumpFiles.size(); Index++) {
+    const ACPI_DUMP_FILE& File = DumpFiles[Index];
+    if (File.Unchanged) {
+      Unchanged++;
+    } else {
+      Status = WriteDumpFile(Dir, File.FileName.wc_str(), File.Table, File.Length);
+      if (EFI_ERROR(Status)) {
+        DBG(" %ls - %s\n", File.FileName.wc_str(), efiStrError(Status));
+        continue;
+      }
+      Written++;
     }
-    mSavedTablesEntries = mSavedTablesEntries + SAVED_TABLES_ALLOC_ENTRIES;
-    //DBG(" to %d", mSavedTablesEntries);
+    Manifest.S8Catf("%u\t%08X\t%s\t%s\t%s\t%ls\n", File.Length, File.Crc32, File.Signature.c_str(),
+                    File.OemId.c_str(), File.OemTableId.c_str(), File.FileName.wc_str());
   }
-
-  //
-  // Add TableEntry to mSavedTables
-  //
-  mSavedTables[mSavedTablesNum] = TableEntry;
-  //DBG(" - added to index %d\n", mSavedTablesNum);
-  mSavedTablesNum++;
+  WriteDumpFile(Dir, ACPI_DUMP_MANIFEST, Manifest.c_str(), Manifest.length());
+  Dir->Close(Dir);
+  DBG("Saved %llu tables to %ls, %llu unchanged\n", Written, DirName, Unchanged);
+  DumpFiles.setEmpty();
 }
 
 #define AML_OP_NAME    0x08
@@ -941,13 +1035,10 @@ void DumpChildSsdt(EFI_ACPI_DESCRIPTION_HEADER *TableEntry, CONST CHAR16 *DirNam
             XStringW FileName = GenerateFileName(FileNamePrefix, SsdtCount, ChildCount, OemTableId);
             len = ((UINT16*)adr)[2];
 			      DBG("Internal length = %llu", len);
-            Status = SaveBufferToDisk((void*)adr, len, DirName, FileName.wc_str());
+            Status = SaveTableToDump((void*)adr, len, FileName);
             if (!EFI_ERROR(Status)) {
               DBG(" -> %ls", FileName.wc_str());
-              MarkTableAsSaved((void*)adr);
               ChildCount++;
-            } else {
-              DBG(" -> %s", efiStrError(Status));
             }
           }
           DBG("\n");
@@ -984,13 +1075,10 @@ void DumpChildSsdt(EFI_ACPI_DESCRIPTION_HEADER *TableEntry, CONST CHAR16 *DirNam
         }
         if ((AsciiStrCmp(Signature, "SSDT") == 0) && (len < 0x20000) && DirName != NULL && !IsTableSaved((void*)adr)) {
           XStringW FileName = GenerateFileName(FileNamePrefix, SsdtCount, ChildCount, OemTableId);
-          Status = SaveBufferToDisk((void*)adr, len, DirName, FileName.wc_str());
+          Status = SaveTableToDump((void*)adr, len, FileName);
           if (!EFI_ERROR(Status)) {
             DBG(" -> %ls", FileName.wc_str());
-            MarkTableAsSaved((void*)adr);
             ChildCount++;
-          } else {
-            DBG(" -> %s", efiStrError(Status));
           }
         }
         DBG("\n");
@@ -1083,9 +1171,11 @@ EFI_STATUS DumpTable(EFI_ACPI_DESCRIPTION_HEADER *TableEntry, CONST CHAR8 *Check
   }
   DBG(" -> %ls", ReleaseFileName.wc_str());
 
-  // Save it
-  Status = SaveBufferToDisk(TableEntry, TableEntry->Length, DirName, ReleaseFileName.wc_str());
-  MarkTableAsSaved(TableEntry);
+  // Save it, with the other tables at the end of DumpTables()
+  Status = SaveTableToDump(TableEntry, TableEntry->Length, ReleaseFileName);
+  if (Status == EFI_ALREADY_STARTED) {
+    Status = EFI_SUCCESS;
+  }
 
   if (TableEntry->Signature == EFI_ACPI_1_0_SECONDARY_SYSTEM_DESCRIPTION_TABLE_SIGNATURE && SsdtCount != NULL) {
     DumpChildSsdt(TableEntry, DirName, FileNamePrefix, *SsdtCount);
@@ -1165,12 +1255,7 @@ EFI_STATUS DumpFadtTables(EFI_ACPI_2_0_FIXED_ACPI_DESCRIPTION_TABLE *Fadt, CONST
     if (DirName != NULL && !IsTableSaved(Facs)) {
       XStringW FileName = SWPrintf("%lsFACS.aml", FileNamePrefix);
       DBG(" -> %ls", FileName.wc_str());
-      Status = SaveBufferToDisk(Facs, Facs->Length, DirName, FileName.wc_str());
-      MarkTableAsSaved(Facs);
-      if (EFI_ERROR(Status)) {
-        DBG(" - %s\n", efiStrError(Status));
-        return Status;
-      }
+      SaveTableToDump(Facs, Facs->Length, FileName);
     }
     DBG("\n");
   }
@@ -1232,12 +1317,12 @@ EFI_ACPI_2_0_FIXED_ACPI_DESCRIPTION_TABLE* GetFadt()
   return FadtPointer;
 }
 
-/** Saves to disk (DirName != NULL)
+/** Queues to be saved (DirName != NULL)
  *  or prints to debug log (DirName == NULL)
  *  ACPI tables given by RsdPtr.
  *  Takes tables from Xsdt if present or from Rsdt if Xsdt is not present.
  */
-void DumpTables(void *RsdPtrVoid, CONST CHAR16 *DirName)
+static void DumpTablesFromRsdp(void *RsdPtrVoid, CONST CHAR16 *DirName)
 {
   EFI_STATUS      Status;
   UINTN           Length;
@@ -1287,12 +1372,7 @@ void DumpTables(void *RsdPtrVoid, CONST CHAR16 *DirName)
   //
   if (DirName != NULL && !IsTableSaved(RsdPtr)) {
     DBG(" -> RSDP.aml");
-    Status = SaveBufferToDisk(RsdPtr, Length, DirName, L"RSDP.aml");
-    MarkTableAsSaved(RsdPtr);
-    if (EFI_ERROR(Status)) {
-      DBG(" - %s\n", efiStrError(Status));
-      return;
-    }
+    SaveTableToDump(RsdPtr, Length, L"RSDP.aml"_XSW);
   }
   DBG("\n");
 
@@ -1429,6 +1509,19 @@ void DumpTables(void *RsdPtrVoid, CONST CHAR16 *DirName)
   } // if Rsdt
 }
 
+/** Saves to disk (DirName != NULL)
+ *  or prints to debug log (DirName == NULL)
+ *  ACPI tables given by RsdPtr, with a manifest.txt of their OEM Id, length and CRC32.
+ */
+void DumpTables(void *RsdPtrVoid, CONST CHAR16 *DirName)
+{
+  DumpFiles.setEmpty();
+  DumpTablesFromRsdp(RsdPtrVoid, DirName);
+  if (DirName != NULL) {
+    WriteDumpFiles(DirName);
+  }
+}
+
 /** Saves OEM ACPI tables to disk.
  *  Searches BIOS, then UEFI Sys.Tables for Acpi 2.0 or newer tables, then for Acpi 1.0 tables
  *  CloverEFI:
@@ -1490,7 +1583,7 @@ void SaveOemTables()
     //    Saved = TRUE;
   }
   SaveBufferToDisk(MemLogStart, GetMemLogLen() - MemLogStartLen, AcpiOriginPath.wc_str(), L"DumpLog.txt");
-  FreePool(mSavedTables);
+  SavedTables.Reset();
 }
 
 void SaveOemDsdt(BOOLEAN FullPatch)
@@ -1674,6 +1767,7 @@ void LoadAllPatchedAML(const XStringW& acpiPathUnderOem, UINTN Pass)
 
 EFI_STATUS PatchACPI(IN REFIT_VOLUME *Volume, const MacOsVersion& OSVersion)
 {
+  TimelineSpan Span("PatchACPI");
   EFI_STATUS                    Status = EFI_SUCCESS;
   UINTN                         Index;
   EFI_ACPI_2_0_ROOT_SYSTEM_DESCRIPTION_POINTER  *RsdPointer = NULL;
@@ -2079,9 +2173,11 @@ EFI_STATUS PatchACPI(IN REFIT_VOLUME *Volume, const MacOsVersion& OSVersion)
   PreCleanupRSDT();
   PreCleanupXSDT();
 
-  // XsdtReplaceSizes array is used to keep track of allocations for the merged tables,
+  // XsdtTables keeps the XSDT entries until PostCleanupXSDT() and the allocations for the merged tables,
   //  as those tables may need to be freed if patched later.
-  XsdtReplaceSizes = (__typeof__(XsdtReplaceSizes))AllocateZeroPool(XsdtTableCount() * sizeof(*XsdtReplaceSizes));
+  if (Xsdt) {
+    XsdtTables.Build(Xsdt, XsdtEntryPtrFromIndex(0), (UINT32)XsdtTableCount());
+  }
 
   // Load merged ACPI files from ACPI/patched
   LoadAllPatchedAML(L"ACPI\\patched"_XSW, AUTOMERGE_PASS1);
@@ -2113,10 +2209,7 @@ EFI_STATUS PatchACPI(IN REFIT_VOLUME *Volume, const MacOsVersion& OSVersion)
   // Load add-on ACPI files from ACPI/patched
   LoadAllPatchedAML(L"ACPI\\patched"_XSW, AUTOMERGE_PASS2);
 
-  if (XsdtReplaceSizes) {
-    FreePool(XsdtReplaceSizes);
-    XsdtReplaceSizes = NULL;
-  }
+  XsdtTables.ClearMergedPages();
 
   //Slice - this is a time to patch MADT table.
   //  DBG("Fool proof: size of APIC NMI  = %d\n", sizeof(EFI_ACPI_2_0_LOCAL_APIC_NMI_STRUCTURE));
@@ -49,14 +49,11 @@ PatchACPI(IN REFIT_VOLUME *Volume, const MacOsVersion& OSVersion);
 EFI_STATUS
 PatchACPI_OtherOS(CONST CHAR16* OsSubdir, BOOLEAN DropSSDT);
 
-UINT8
-Checksum8 (
-  void *startPtr,
-  UINT32 len
-  );
-
 void FixChecksum(EFI_ACPI_DESCRIPTION_HEADER* Table);
 
+// n of a file name as "SSDT-n.aml" or "SSDT-n-Name.aml", MAX_UINTN if none
+UINTN IndexFromFileName(CONST CHAR16* FileName);
+
 
 void
 SaveOemDsdt (
@@ -0,0 +1,218 @@
+/*
+ * AcpiPatternSet.cpp
+ *
+ * The automaton is a complete transition table, 256 entries per state,
+ * so a table is scanned with one lookup per byte whatever the number of patterns.
+ * A set holds a few DSDT patches or device names, the states are limited to ACPI_PATTERN_MAX_STATES.
+ */
+
+#include "AcpiPatternSet.h"
+
+// TRUE if B can be found at some shift over A with the common bytes equal
+static BOOLEAN PatternsOverlap(const UINT8* A, UINT32 LenA, const UINT8* B, UINT32 LenB)
+{
+  INT32 Shift;
+  INT32 Lo, Hi;
+
+  for (Shift = 1 - (INT32)LenB; Shift < (INT32)LenA; Shift++) {
+    Lo = (Shift > 0) ? Shift : 0;
+    Hi = ((INT32)LenA < Shift + (INT32)LenB) ? (INT32)LenA : Shift + (INT32)LenB;
+    if (CompareMem(A + Lo, B + Lo - Shift, Hi - Lo) == 0) {
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+void AcpiPatternSet::FreeAutomaton()
+{
+  if (Goto) {
+    FreePool(Goto);
+    Goto = NULL;
+  }
+  if (Out) {
+    FreePool(Out);
+    Out = NULL;
+  }
+  if (Dict) {
+    FreePool(Dict);
+    Dict = NULL;
+  }
+  StateCount = 0;
+}
+
+void AcpiPatternSet::Reset()
+{
+  FreeAutomaton();
+  Bytes.setEmpty();
+  Offsets.setEmpty();
+  Sizes.setEmpty();
+}
+
+BOOLEAN AcpiPatternSet::IsIndependent(const UINT8* Find, const UINT8* Replace, UINT32 Size) const
+{
+  size_t Index;
+
+  for (Index = 0; Index < Sizes.size(); Index++) {
+    if (PatternsOverlap(GetFind(Index), GetSize(Index), Find, Size)) {
+      return FALSE;
+    }
+    if (PatternsOverlap(GetReplace(Index), GetSize(Index), Find, Size)) {
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+BOOLEAN AcpiPatternSet::Add(const UINT8* Find, const UINT8* Replace, UINT32 Size)
+{
+  UINT32 States = 1;
+  size_t Index;
+
+  if (Size == 0) {
+    return FALSE;
+  }
+  for (Index = 0; Index < Sizes.size(); Index++) {
+    States += GetSize(Index);
+  }
+  if (States + Size > ACPI_PATTERN_MAX_STATES) {
+    return FALSE;
+  }
+  FreeAutomaton();
+  Offsets.Add((UINT32)Bytes.size());
+  Sizes.Add(Size);
+  Bytes.AddArray(Find, Size);
+  Bytes.AddArray(Replace ? Replace : Find, Size);
+  return TRUE;
+}
+
+BOOLEAN AcpiPatternSet::Build()
+{
+  UINT32  MaxStates = 1;
+  UINT16* Fail;
+  UINT16* Queue;
+  UINT32  Head, Tail;
+  UINT32  Index, j;
+  UINT32  State, Next, c;
+  const UINT8* Find;
+
+  FreeAutomaton();
+  for (Index = 0; Index < Sizes.size(); Index++) {
+    MaxStates += GetSize(Index);
+  }
+  Goto = (__typeof__(Goto))AllocateZeroPool(MaxStates * 256 * sizeof(*Goto));
+  Out = (__typeof__(Out))AllocateZeroPool(MaxStates * sizeof(*Out));
+  Dict = (__typeof__(Dict))AllocateZeroPool(MaxStates * sizeof(*Dict));
+  Fail = (__typeof__(Fail))AllocateZeroPool(MaxStates * sizeof(*Fail));
+  Queue = (__typeof__(Queue))AllocatePool(MaxStates * sizeof(*Queue));
+  if (!Goto || !Out || !Dict || !Fail || !Queue) {
+    if (Fail) FreePool(Fail);
+    if (Queue) FreePool(Queue);
+    FreeAutomaton();
+    return FALSE;
+  }
+
+  //trie, state 0 is the root and is never a target of the trie so 0 means no transition yet
+  StateCount = 1;
+  for (Index = 0; Index < Sizes.size(); Index++) {
+    Find = GetFind(Index);
+    State = 0;
+    for (j = 0; j < GetSize(Index); j++) {
+      Next = Goto[State * 256 + Find[j]];
+      if (Next == 0) {
+        Next = StateCount++;
+        Goto[State * 256 + Find[j]] = (UINT16)Next;
+      }
+      State = Next;
+    }
+    if (Out[State] == 0) {
+      Out[State] = (UINT16)(Index + 1);
+    }
+  }
+
+  //failure links in breadth first order, the missing transitions are taken from the failure state
+  Head = Tail = 0;
+  for (c = 0; c < 256; c++) {
+    Next = Goto[c];
+    if (Next != 0) {
+      Fail[Next] = 0;
+      Queue[Tail++] = (UINT16)Next;
+    }
+  }
+  while (Head < Tail) {
+    State = Queue[Head++];
+    for (c = 0; c < 256; c++) {
+      Next = Goto[State * 256 + c];
+      if (Next != 0) {
+        Fail[Next] = Goto[Fail[State] * 256 + c];
+        Dict[Next] = Out[Fail[Next]] ? Fail[Next] : Dict[Fail[Next]];
+        Queue[Tail++] = (UINT16)Next;
+      } else {
+        Goto[State * 256 + c] = Goto[Fail[State] * 256 + c];
+      }
+    }
+  }
+
+  FreePool(Fail);
+  FreePool(Queue);
+  return TRUE;
+}
+
+void AcpiPatternSet::ReplaceAll(UINT8* Table, UINT32 Start, UINT32 Len, UINT32* Hits, UINT32* First) const
+{
+  UINT32 i;
+  UINT32 State = 0;
+  UINT32 Match;
+  UINT32 Pattern, Size, Pos;
+  UINT32 LastEnd = Start;
+
+  for (i = 0; i < Sizes.size(); i++) {
+    Hits[i] = 0;
+    First[i] = MAX_UINT32;
+  }
+  if (!Goto) {
+    return;
+  }
+  for (i = Start; i < Len; i++) {
+    State = Goto[State * 256 + Table[i]];
+    Match = Out[State] ? State : Dict[State];
+    if (Match == 0) {
+      continue;
+    }
+    //the patterns are independent, at most one of them ends here
+    Pattern = Out[Match] - 1;
+    Size = GetSize(Pattern);
+    Pos = i + 1 - Size;
+    if (Pos < LastEnd) {
+      continue; //overlaps the previous replacement of the same pattern
+    }
+    //the automaton has already read the old bytes, the scan goes on unchanged
+    CopyMem(Table + Pos, GetReplace(Pattern), Size);
+    if (Hits[Pattern] == 0) {
+      First[Pattern] = Pos;
+    }
+    Hits[Pattern]++;
+    LastEnd = i + 1;
+  }
+}
+
+void AcpiPatternSet::FindAll(const UINT8* Table, UINT32 Start, UINT32 Len, XArray<ACPI_PATTERN_HIT>& Hits) const
+{
+  UINT32 i;
+  UINT32 State = 0;
+  UINT32 Match;
+  ACPI_PATTERN_HIT Hit;
+
+  Hits.setEmpty();
+  if (!Goto) {
+    return;
+  }
+  for (i = Start; i < Len; i++) {
+    State = Goto[State * 256 + Table[i]];
+    for (Match = Out[State] ? State : Dict[State]; Match != 0; Match = Dict[Match]) {
+      Hit.Pattern = Out[Match] - 1;
+      Hit.Pos = i + 1 - GetSize(Hit.Pattern);
+      Hits.Add(Hit);
+    }
+  }
+}
@@ -0,0 +1,65 @@
+/*
+ * AcpiPatternSet.h
+ *
+ * Several binary patterns matched together in one pass over an ACPI table (Aho-Corasick automaton).
+ * Used for the same size DSDT/SSDT patches and for the name renames.
+ */
+
+#ifndef PLATFORM_ACPIPATTERNSET_H_
+#define PLATFORM_ACPIPATTERNSET_H_
+
+#include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+#include "../cpp_foundation/XArray.h"
+
+#define ACPI_PATTERN_MAX_STATES  4096
+
+class ACPI_PATTERN_HIT
+{
+public:
+  UINT32 Pattern;
+  UINT32 Pos;
+
+  ACPI_PATTERN_HIT() : Pattern(0), Pos(0) {}
+};
+
+class AcpiPatternSet
+{
+protected:
+  XArray<UINT8>  Bytes;    // Find then Replace of each pattern
+  XArray<UINT32> Offsets;  // of each pattern in Bytes
+  XArray<UINT32> Sizes;
+  UINT32         StateCount;
+  UINT16*        Goto;     // StateCount * 256, complete transitions
+  UINT16*        Out;      // pattern + 1 ending at this state, 0 if none
+  UINT16*        Dict;     // nearest state on the failure chain having an Out, 0 if none
+
+  void FreeAutomaton();
+
+public:
+  AcpiPatternSet() : Bytes(), Offsets(), Sizes(), StateCount(0), Goto(NULL), Out(NULL), Dict(NULL) {}
+  ~AcpiPatternSet() { FreeAutomaton(); }
+  AcpiPatternSet(const AcpiPatternSet&) = delete;
+  AcpiPatternSet& operator=(const AcpiPatternSet&) = delete;
+
+  size_t GetCount() const { return Sizes.size(); }
+  const UINT8* GetFind(size_t Index) const { return Bytes.data() + Offsets.ElementAt(Index); }
+  const UINT8* GetReplace(size_t Index) const { return Bytes.data() + Offsets.ElementAt(Index) + Sizes.ElementAt(Index); }
+  UINT32 GetSize(size_t Index) const { return Sizes.ElementAt(Index); }
+
+  // TRUE if Find can't share a byte of the table with a pattern already in the set,
+  // nor be created by the Replace of one of them.
+  // Then replacing all the patterns in one pass gives the same table as one pattern after the other.
+  BOOLEAN IsIndependent(const UINT8* Find, const UINT8* Replace, UINT32 Size) const;
+  // Replace may be NULL for a search only
+  BOOLEAN Add(const UINT8* Find, const UINT8* Replace, UINT32 Size);
+  BOOLEAN Build();
+  void    Reset();
+
+  // replace the leftmost not overlapping matches in [Start, Len)
+  // Hits[i] counts the replacements of pattern i, First[i] is the first one (MAX_UINT32 if none)
+  void    ReplaceAll(UINT8* Table, UINT32 Start, UINT32 Len, UINT32* Hits, UINT32* First) const;
+  // all matches in [Start, Len), in the order of their ends
+  void    FindAll(const UINT8* Table, UINT32 Start, UINT32 Len, XArray<ACPI_PATTERN_HIT>& Hits) const;
+};
+
+#endif /* PLATFORM_ACPIPATTERNSET_H_ */
@@ -50,10 +50,75 @@ BOOLEAN aml_add_to_parent(AML_CHUNK* parent, AML_CHUNK* node)
 	return FALSE;
 }
 
+static VOID* aml_arena_alloc(AML_ARENA* arena, UINT32 size)
+{
+	AML_ARENA_BLOCK* block = arena->Blocks;
+	UINT32 blockSize;
+	VOID* ptr;
+
+	size = (size + 7) & ~7U;
+	if (!block || block->Used + size > block->Size)
+	{
+		blockSize = (size > AML_ARENA_BLOCK_SIZE) ? size : AML_ARENA_BLOCK_SIZE;
+		block = (AML_ARENA_BLOCK*)AllocateZeroPool(sizeof(AML_ARENA_BLOCK) + blockSize);
+		if (!block)
+			return NULL;
+		block->Size = blockSize;
+		if (arena->Blocks && size > AML_ARENA_BLOCK_SIZE)
+		{
+			// a big buffer gets its own block, the current block stays in use
+			block->Next = arena->Blocks->Next;
+			arena->Blocks->Next = block;
+		}
+		else
+		{
+			block->Next = arena->Blocks;
+			arena->Blocks = block;
+		}
+	}
+
+	ptr = (UINT8*)(block + 1) + block->Used;
+	block->Used += size;
+	return ptr;
+}
+
+static VOID aml_arena_free(AML_ARENA* arena)
+{
+	AML_ARENA_BLOCK* block = arena->Blocks;
+
+	while (block)
+	{
+		AML_ARENA_BLOCK* next = block->Next;
+		FreePool(block);
+		block = next;
+	}
+	FreePool(arena);
+}
+
+static CHAR8* aml_alloc_buffer(AML_CHUNK* node, UINT32 size)
+{
+	node->Arena->MaxSize += size;
+	return (CHAR8*)aml_arena_alloc(node->Arena, size);
+}
+
 AML_CHUNK* aml_create_node(AML_CHUNK* parent)
 {
-	AML_CHUNK* node = (AML_CHUNK*)AllocateZeroPool(sizeof(AML_CHUNK));
-	
+	AML_ARENA* arena = parent ? parent->Arena : (AML_ARENA*)AllocateZeroPool(sizeof(AML_ARENA));
+	AML_CHUNK* node;
+
+	if (!arena)
+		return NULL;
+
+	node = (AML_CHUNK*)aml_arena_alloc(arena, sizeof(AML_CHUNK));
+	if (!node)
+	{
+		if (!parent)
+			aml_arena_free(arena);
+		return NULL;
+	}
+	node->Arena = arena;
+	arena->MaxSize += AML_NODE_MAX_HEADER;
+
 	aml_add_to_parent(parent, node);
 	
 	return node;
@@ -61,26 +126,14 @@ AML_CHUNK* aml_create_node(AML_CHUNK* parent)
 
 void aml_destroy_node(AML_CHUNK* node)
 {
-	// Delete child nodes
-	AML_CHUNK* child = node->First;
-	
-	while (child) 
-	{
-		AML_CHUNK* next = child->Next;
-		
-		if (child->Buffer)
-			FreePool(child->Buffer);
-		
-		FreePool(child);
-		
-		child = next;
-	}
-	
-	// Free node
-	if (node->Buffer)
-		FreePool(node->Buffer);
-	
-	FreePool(node);
+	// the whole tree is in the arena
+	if (node && node->Arena)
+		aml_arena_free(node->Arena);
+}
+
+UINT32 aml_max_size(AML_CHUNK* node)
+{
+	return (node && node->Arena) ? node->Arena->MaxSize : 0;
 }
 
 AML_CHUNK* aml_add_buffer(AML_CHUNK* parent,  CONST UINT8* buffer, UINT32 size)
@@ -91,7 +144,7 @@ AML_CHUNK* aml_add_buffer(AML_CHUNK* parent,  CONST UINT8* buffer, UINT32 size)
 	{
 		node->Type = AML_CHUNK_NONE;
 		node->Length = (UINT16)size;
-		node->Buffer = (__typeof__(node->Buffer))AllocateZeroPool(node->Length);
+		node->Buffer = aml_alloc_buffer(node, node->Length);
 		CopyMem(node->Buffer, buffer, node->Length);
 	}
 	
@@ -107,7 +160,7 @@ AML_CHUNK* aml_add_byte(AML_CHUNK* parent, UINT8 value)
 		node->Type = AML_CHUNK_BYTE;
 		
 		node->Length = 1;
-		node->Buffer = (__typeof__(node->Buffer))AllocateZeroPool(node->Length);
+		node->Buffer = aml_alloc_buffer(node, node->Length);
 		node->Buffer[0] = value;
 	}
 	
@@ -122,7 +175,7 @@ AML_CHUNK* aml_add_word(AML_CHUNK* parent, UINT16 value)
 	{
 		node->Type = AML_CHUNK_WORD;
 		node->Length = 2;
-		node->Buffer = (__typeof__(node->Buffer))AllocateZeroPool(node->Length);
+		node->Buffer = aml_alloc_buffer(node, node->Length);
 		node->Buffer[0] = value & 0xff;
 		node->Buffer[1] = value >> 8;
 	}
@@ -138,7 +191,7 @@ AML_CHUNK* aml_add_dword(AML_CHUNK* parent, UINT32 value)
 	{
 		node->Type = AML_CHUNK_DWORD;
 		node->Length = 4;
-		node->Buffer = (__typeof__(node->Buffer))AllocateZeroPool(node->Length);
+		node->Buffer = aml_alloc_buffer(node, node->Length);
 		node->Buffer[0] = value & 0xff;
 		node->Buffer[1] = (value >> 8) & 0xff;
 		node->Buffer[2] = (value >> 16) & 0xff;
@@ -156,7 +209,7 @@ AML_CHUNK* aml_add_qword(AML_CHUNK* parent, UINT64 value)
 	{
 		node->Type = AML_CHUNK_QWORD;
 		node->Length = 8;
-		node->Buffer = (__typeof__(node->Buffer))AllocateZeroPool(node->Length);
+		node->Buffer = aml_alloc_buffer(node, node->Length);
 		node->Buffer[0] = value & 0xff;
     node->Buffer[1] = RShiftU64(value, 8) & 0xff;
     node->Buffer[2] = RShiftU64(value, 16) & 0xff;
@@ -206,7 +259,7 @@ UINT32 aml_fill_name(AML_CHUNK* node, CONST CHAR8* name)
 	if (count == 1) 
 	{
 		node->Length = (UINT16)(4 + root);
-		node->Buffer = (__typeof__(node->Buffer))AllocateZeroPool(node->Length+4);
+		node->Buffer = aml_alloc_buffer(node, node->Length+4);
 		CopyMem(node->Buffer, name, 4 + root);
     offset += 4 + root;
 		return (UINT32)offset;
@@ -215,7 +268,7 @@ UINT32 aml_fill_name(AML_CHUNK* node, CONST CHAR8* name)
 	if (count == 2) 
 	{
 		node->Length = 2 + 8;
-		node->Buffer = (__typeof__(node->Buffer))AllocateZeroPool(node->Length+4);
+		node->Buffer = aml_alloc_buffer(node, node->Length+4);
 		node->Buffer[offset++] = 0x5c; // Root Char
 		node->Buffer[offset++] = 0x2e; // Double name
 		CopyMem(node->Buffer+offset, name + root, 8);
@@ -224,7 +277,7 @@ UINT32 aml_fill_name(AML_CHUNK* node, CONST CHAR8* name)
 	}
 	
 	node->Length = (UINT16)(3 + (count << 2));
-	node->Buffer = (__typeof__(node->Buffer))AllocateZeroPool(node->Length+4);
+	node->Buffer = aml_alloc_buffer(node, node->Length+4);
 	node->Buffer[offset++] = 0x5c; // Root Char
 	node->Buffer[offset++] = 0x2f; // Multi name
 	node->Buffer[offset++] = (CHAR8)count; // Names count
@@ -288,7 +341,7 @@ AML_CHUNK* aml_add_package(AML_CHUNK* parent)
 		node->Type = AML_CHUNK_PACKAGE;
 		
 		node->Length = 1;
-		node->Buffer = (__typeof__(node->Buffer))AllocateZeroPool(node->Length);
+		node->Buffer = aml_alloc_buffer(node, node->Length);
 	}
 	
 	return node;
@@ -303,7 +356,7 @@ AML_CHUNK* aml_add_alias(AML_CHUNK* parent, /* CONST*/ CHAR8* name1, /* CONST*/
 		node->Type = AML_CHUNK_ALIAS;
 		
 		node->Length = 8;
-		node->Buffer = (__typeof__(node->Buffer))AllocateZeroPool(node->Length);
+		node->Buffer = aml_alloc_buffer(node, node->Length);
 		aml_fill_simple_name(node->Buffer, name1);
 		aml_fill_simple_name(node->Buffer+4, name2);
 	}
@@ -385,10 +438,10 @@ AML_CHUNK* aml_add_byte_buffer(AML_CHUNK* parent, /* CONST*/ UINT8* data, UINT32
 	    INTN offset=0;
 		node->Type = AML_CHUNK_BUFFER;
 		node->Length = (UINT8)(size + 2);
-		node->Buffer = (__typeof__(node->Buffer))AllocateZeroPool(node->Length);
+		node->Buffer = aml_alloc_buffer(node, node->Length);
 		node->Buffer[offset++] = AML_CHUNK_BYTE;  //0x0A
 		node->Buffer[offset++] = (CHAR8)size;
-		CopyMem(node->Buffer+offset, data, node->Length);
+		CopyMem(node->Buffer+offset, data, node->Length - offset);
 	}
 	
 	return node;
@@ -404,7 +457,7 @@ AML_CHUNK* aml_add_string_buffer(AML_CHUNK* parent, CONST CHAR8* StringBuf)
 	    UINTN len = AsciiStrLen(StringBuf);
 		node->Type = AML_CHUNK_BUFFER;
 		node->Length = (UINT8)(len + 3);
-		node->Buffer = (__typeof__(node->Buffer))AllocateZeroPool(node->Length);
+		node->Buffer = aml_alloc_buffer(node, node->Length);
 		node->Buffer[offset++] = AML_CHUNK_BYTE;
 		node->Buffer[offset++] = (CHAR8)(len + 1);
 		CopyMem(node->Buffer+offset, StringBuf, len);
@@ -423,7 +476,7 @@ AML_CHUNK* aml_add_string(AML_CHUNK* parent, CONST CHAR8* StringBuf)
 	    INTN len = AsciiStrLen(StringBuf);
 		node->Type = AML_CHUNK_STRING;
 		node->Length = (UINT8)(len + 1);
-		node->Buffer = (__typeof__(node->Buffer))AllocateZeroPool(len + 1);
+		node->Buffer = aml_alloc_buffer(node, len + 1);
 		CopyMem(node->Buffer, StringBuf, len);
 //		node->Buffer[len] = '\0';
 	}
@@ -457,79 +510,6 @@ UINT8 aml_get_size_length(UINT32 size)
 	return 4; /* Encode 0xfffffff in 4 bits and 2 bytes */
 }
 
-UINT32 aml_calculate_size(AML_CHUNK* node)
-{
-	if (node)
-	{
-		// Calculate child nodes size
-		AML_CHUNK* child = node->First;
-		UINT8 child_count = 0;
-		
-      node->Size = 0;
-		while (child) 
-		{
-			child_count++;
-			
-			node->Size += (UINT16)aml_calculate_size(child);
-			
-			child = child->Next;
-		}
-		
-		switch (node->Type) 
-		{
-			case AML_CHUNK_NONE:
-			case AML_STORE_OP:
-      case AML_CHUNK_LOCAL0:
-				node->Size += node->Length;
-				break;  
-            
-      case AML_CHUNK_METHOD:  
-			case AML_CHUNK_SCOPE:
-			case AML_CHUNK_BUFFER: 
-				node->Size += 1 + node->Length;
-				node->Size += aml_get_size_length(node->Size);
-				break;
-				
-      case AML_CHUNK_DEVICE:
-				node->Size += 2 + node->Length;
-				node->Size += aml_get_size_length(node->Size);
-				break;
-
-			case AML_CHUNK_PACKAGE:
-				node->Buffer[0] = child_count;
-				node->Size += 1 + node->Length;
-				node->Size += aml_get_size_length(node->Size);
-				break;
-				
-			case AML_CHUNK_BYTE:
-				if (node->Buffer[0] == 0x0 || node->Buffer[0] == 0x1) 
-				{
-					node->Size += node->Length;
-				}
-				else 
-				{
-					node->Size += 1 + node->Length;
-				}
-				
-				break;
-				
-			case AML_CHUNK_WORD:
-			case AML_CHUNK_DWORD:
-			case AML_CHUNK_QWORD:
-			case AML_CHUNK_ALIAS:
-			case AML_CHUNK_NAME:
-      case AML_CHUNK_RETURN:
-      case AML_CHUNK_STRING:
-				node->Size += 1 + node->Length;
-				break;
-		}
-		
-		return node->Size;
-	}
-	
-	return 0;
-}
-
 UINT32 aml_write_byte(UINT8 value, CHAR8* buffer, UINT32 offset)
 {
 	buffer[offset++] = value;
@@ -607,12 +587,29 @@ UINT32 aml_write_size(UINT32 size, CHAR8* buffer, UINT32 offset)
 	return offset;
 }
 
+// the body [start + 1, end) was written after one byte reserved at start for its length,
+// the body is moved if the length takes more bytes
+static UINT32 aml_write_package_length(CHAR8* buffer, UINT32 start, UINT32 end)
+{
+	CHAR8  size[4];
+	UINT32 body = end - start - 1;
+	UINT32 count = aml_write_size(body + aml_get_size_length(body), size, 0);
+
+	if (count > 1)
+		CopyMem(buffer + start + count, buffer + start + 1, body);
+	CopyMem(buffer + start, size, count);
+
+	return start + count + body;
+}
+
 UINT32 aml_write_node(AML_CHUNK* node, CHAR8* buffer, UINT32 offset)
 {
 	if (node && buffer) 
 	{
 		UINT32 old = offset;
-      AML_CHUNK* child = node->First;
+		UINT32 start = 0; // package length, 0 if none
+		UINT8 child_count = 0;
+		AML_CHUNK* child = node->First;
 		
 		switch (node->Type) 
 		{
@@ -620,7 +617,7 @@ UINT32 aml_write_node(AML_CHUNK* node, CHAR8* buffer, UINT32 offset)
 				offset = aml_write_buffer(node->Buffer, node->Length, buffer, offset);
 				break;
 
-            case AML_CHUNK_LOCAL0:
+			case AML_CHUNK_LOCAL0:
 			case AML_STORE_OP:
 				offset = aml_write_byte(node->Type, buffer, offset);
 				break;
@@ -628,16 +625,16 @@ UINT32 aml_write_node(AML_CHUNK* node, CHAR8* buffer, UINT32 offset)
 			case AML_CHUNK_DEVICE:
 				offset = aml_write_byte(AML_CHUNK_OP, buffer, offset);
 				offset = aml_write_byte(node->Type, buffer, offset);
-				offset = aml_write_size(node->Size-2, buffer, offset);
+				start = offset++;
 				offset = aml_write_buffer(node->Buffer, node->Length, buffer, offset);
 				break;
 
 			case AML_CHUNK_SCOPE:
-      case AML_CHUNK_METHOD:
+			case AML_CHUNK_METHOD:
 			case AML_CHUNK_PACKAGE:
 			case AML_CHUNK_BUFFER:
 				offset = aml_write_byte(node->Type, buffer, offset);
-				offset = aml_write_size(node->Size-1, buffer, offset);
+				start = offset++;
 				offset = aml_write_buffer(node->Buffer, node->Length, buffer, offset);
 				break;
 				
@@ -655,8 +652,8 @@ UINT32 aml_write_node(AML_CHUNK* node, CHAR8* buffer, UINT32 offset)
 			case AML_CHUNK_QWORD:
 			case AML_CHUNK_ALIAS:
 			case AML_CHUNK_NAME:
-      case AML_CHUNK_RETURN:
-      case AML_CHUNK_STRING:
+			case AML_CHUNK_RETURN:
+			case AML_CHUNK_STRING:
 				offset = aml_write_byte(node->Type, buffer, offset);
 				offset = aml_write_buffer(node->Buffer, node->Length, buffer, offset);
 				break;
@@ -667,13 +664,19 @@ UINT32 aml_write_node(AML_CHUNK* node, CHAR8* buffer, UINT32 offset)
 
 		while (child) {
 			offset = aml_write_node(child, buffer, offset);
+			child_count++;
 			child = child->Next;
 		}
+
+		if (start) {
+			if (node->Type == AML_CHUNK_PACKAGE) {
+				node->Buffer[0] = child_count;
+				buffer[start + 1] = child_count; // NumElements
+			}
+			offset = aml_write_package_length(buffer, start, offset);
+		}
 		
-		if (offset - old != node->Size) {
-			MsgLog("Node size incorrect: type=0x%hhX size=%hX offset=%X\n",
-             node->Type, node->Size, (offset - old));
-    }
+		node->Size = (UINT16)(offset - old);
 	}
 	
 	return offset;
@@ -20,6 +20,30 @@ static inline BOOLEAN aml_isvalidchar(char c)
 */
 
 
+/*
+ * All the nodes of a tree and their buffers are allocated from an arena created with the root node,
+ * aml_destroy_node() frees the whole tree at once.
+ */
+#define AML_ARENA_BLOCK_SIZE  4096
+// opcode(s) and package length, at most
+#define AML_NODE_MAX_HEADER   6
+
+struct aml_arena_block
+{
+  struct aml_arena_block*  Next;
+  UINT32                   Size;
+  UINT32                   Used;
+};
+typedef struct aml_arena_block AML_ARENA_BLOCK;
+
+struct aml_arena
+{
+  AML_ARENA_BLOCK*   Blocks;
+  UINT32             MaxSize;  // the tree can't be written in more bytes
+  UINT32             pad;
+};
+typedef struct aml_arena AML_ARENA;
+
 struct aml_chunk
 {
   UINT8              Type;
@@ -34,6 +58,7 @@ struct aml_chunk
   struct aml_chunk*  Next;
   struct aml_chunk*  First;
   struct aml_chunk*  Last;
+  AML_ARENA*         Arena;
 };
 typedef struct aml_chunk AML_CHUNK;
 
@@ -71,9 +96,13 @@ typedef struct aml_chunk AML_CHUNK;
 #define  AML_CHUNK_ARG3          0x6B
 
 
+// parent NULL creates a new tree, node and parent must be from the same tree
 BOOLEAN aml_add_to_parent(AML_CHUNK* parent, AML_CHUNK* node);
 AML_CHUNK* aml_create_node(AML_CHUNK* parent);
+// frees the whole tree the node belongs to
 void aml_destroy_node(AML_CHUNK* node);
+// size of a buffer large enough for aml_write_node() of any node of the tree
+UINT32 aml_max_size(AML_CHUNK* node);
 AML_CHUNK* aml_add_buffer(AML_CHUNK* parent, CONST UINT8* buffer, UINT32 size);
 AML_CHUNK* aml_add_byte(AML_CHUNK* parent, UINT8 value);
 AML_CHUNK* aml_add_word(AML_CHUNK* parent, UINT16 value);
@@ -86,7 +115,7 @@ AML_CHUNK* aml_add_return_name(AML_CHUNK* parent, CONST CHAR8* name);
 AML_CHUNK* aml_add_return_byte(AML_CHUNK* parent, UINT8 value);
 AML_CHUNK* aml_add_package(AML_CHUNK* parent);
 AML_CHUNK* aml_add_alias(AML_CHUNK* parent, /* CONST*/ CHAR8* name1, /* CONST*/ CHAR8* name2);
-UINT32 aml_calculate_size(AML_CHUNK* node);
+// writes the node and its children, returns the end offset. node->Size is set on the way
 UINT32 aml_write_node(AML_CHUNK* node, CHAR8* buffer, UINT32 offset);
 UINT32 aml_write_size(UINT32 size, CHAR8* buffer, UINT32 offset);
 
@@ -0,0 +1,669 @@
+/*
+ * AmlTree.cpp
+ *
+ * The tree holds only the objects that have a PkgLength, the rest of the table is bytes between them.
+ * Terms are parsed by their opcode so the bytes of a constant or a buffer are never taken for an object.
+ * A method invocation is parsed as a name followed by its arguments as separate terms,
+ * this gives the same term boundaries without knowing the number of arguments.
+ * Where an opcode is unknown, objects are searched the same way FixBiosDsdt does it
+ * (opcode, valid PkgLength, valid name) until the end of the parent object.
+ */
+
+#include "AmlTree.h"
+
+#ifdef DBG
+#undef DBG
+#endif
+
+#ifndef DEBUG_FIX
+#ifndef DEBUG_ALL
+#define DEBUG_FIX 0
+#else
+#define DEBUG_FIX DEBUG_ALL
+#endif
+#endif
+
+#if DEBUG_FIX==0
+#define DBG(...)
+#else
+#define DBG(...) DebugLog(DEBUG_FIX, __VA_ARGS__)
+#endif
+
+#define AML_NOT_FOUND  0xFFFFFFFF
+#define AML_MAX_DEPTH  128
+
+//largest PkgLength that can be encoded with 1..4 bytes
+static CONST UINT32 PkgLengthMax[5] = { 0, 0x3F, 0xFFF, 0xFFFFF, 0xFFFFFFF };
+
+// operands of the opcodes without PkgLength
+// T - TermArg, S - SuperName, G - Target (SuperName or NullName), N - NameString
+// B, W, D, Q - byte, word, dword, qword data
+typedef struct {
+  UINT8        Opcode;
+  CONST CHAR8* Operands;
+} AML_OPCODE;
+
+static CONST AML_OPCODE AmlOpcodes[] = {
+  { 0x00, "" },    { 0x01, "" },    { 0xFF, "" },     //Zero One Ones
+  { 0x0A, "B" },   { 0x0B, "W" },   { 0x0C, "D" },    { 0x0E, "Q" },
+  { 0x06, "NN" },  { 0x08, "NT" },  { 0x15, "NBB" },  //Alias Name External
+  { 0x70, "TS" },  { 0x71, "S" },   { 0x72, "TTG" },  { 0x73, "TTG" },  { 0x74, "TTG" },
+  { 0x75, "S" },   { 0x76, "S" },   { 0x77, "TTG" },  { 0x78, "TTGG" }, { 0x79, "TTG" },
+  { 0x7A, "TTG" }, { 0x7B, "TTG" }, { 0x7C, "TTG" },  { 0x7D, "TTG" },  { 0x7E, "TTG" },
+  { 0x7F, "TTG" }, { 0x80, "TG" },  { 0x81, "TG" },   { 0x82, "TG" },   { 0x83, "T" },
+  { 0x84, "TTG" }, { 0x85, "TTG" }, { 0x86, "ST" },   { 0x87, "S" },    { 0x88, "TTG" },
+  { 0x89, "TBTBTT" }, { 0x8A, "TTN" }, { 0x8B, "TTN" }, { 0x8C, "TTN" }, { 0x8D, "TTN" },
+  { 0x8E, "S" },   { 0x8F, "TTN" }, { 0x90, "TT" },   { 0x91, "TT" },   { 0x92, "T" },
+  { 0x93, "TT" },  { 0x94, "TT" },  { 0x95, "TT" },   { 0x96, "TG" },   { 0x97, "TG" },
+  { 0x98, "TG" },  { 0x99, "TG" },  { 0x9C, "TTG" },  { 0x9D, "TS" },   { 0x9E, "TTTG" },
+  { 0x9F, "" },    { 0xA3, "" },    { 0xA4, "T" },    { 0xA5, "" },     { 0xCC, "" },
+};
+
+// after 0x5B
+static CONST AML_OPCODE AmlExtOpcodes[] = {
+  { 0x01, "NB" },  { 0x02, "N" },   { 0x12, "SG" },   { 0x13, "TTTN" }, { 0x1F, "TTTTTT" },
+  { 0x20, "NG" },  { 0x21, "T" },   { 0x22, "T" },    { 0x23, "SW" },   { 0x24, "S" },
+  { 0x25, "ST" },  { 0x26, "S" },   { 0x27, "S" },    { 0x28, "TG" },   { 0x29, "TG" },
+  { 0x2A, "S" },   { 0x30, "" },    { 0x31, "" },     { 0x32, "BDT" },  { 0x33, "" },
+  { 0x80, "NBTT" }, { 0x88, "NTTT" },
+};
+
+static CONST CHAR8* FindOperands(CONST AML_OPCODE* Opcodes, UINTN Count, UINT8 Opcode)
+{
+  UINTN i;
+  for (i = 0; i < Count; i++) {
+    if (Opcodes[i].Opcode == Opcode) {
+      return Opcodes[i].Operands;
+    }
+  }
+  return NULL;
+}
+
+static BOOLEAN IsLeadNameChar(UINT8 c)
+{
+  return (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static BOOLEAN IsNameChar(UINT8 c)
+{
+  return IsLeadNameChar(c) || (c >= '0' && c <= '9');
+}
+
+static BOOLEAN IsNameStart(UINT8 c)
+{
+  return IsLeadNameChar(c) || c == '\\' || c == '^' || c == 0x2E || c == 0x2F;
+}
+
+// length of the NameString at Pos, 0 if there is no valid name
+static UINT32 NameLength(const UINT8* Table, UINT32 Pos, UINT32 End)
+{
+  UINT32 i = Pos;
+  UINT32 Segs = 1;
+  UINT32 k;
+  if (i < End && Table[i] == '\\') {
+    i++;
+  } else {
+    while (i < End && Table[i] == '^') {
+      i++;
+    }
+  }
+  if (i >= End) {
+    return 0;
+  }
+  if (Table[i] == 0x2E) {        //DualNamePrefix
+    Segs = 2;
+    i++;
+  } else if (Table[i] == 0x2F) { //MultiNamePrefix
+    if (i + 1 >= End) {
+      return 0;
+    }
+    Segs = Table[i + 1];
+    i += 2;
+  } else if (Table[i] == 0x00 && i > Pos) { //NullName after a prefix, "\"
+    return i + 1 - Pos;
+  }
+  if (Segs == 0 || i + Segs * 4 > End) {
+    return 0;
+  }
+  for (k = 0; k < Segs * 4; k += 4) {
+    if (!IsLeadNameChar(Table[i + k]) || !IsNameChar(Table[i + k + 1]) ||
+        !IsNameChar(Table[i + k + 2]) || !IsNameChar(Table[i + k + 3])) {
+      return 0;
+    }
+  }
+  return i + Segs * 4 - Pos;
+}
+
+// PkgLength at SizeAdr, the object must end before Limit
+static BOOLEAN ReadPkgLength(const UINT8* Table, UINT32 SizeAdr, UINT32 Limit, UINT32* Size, UINT8* SizeLen)
+{
+  UINT8 i;
+  if (SizeAdr >= Limit) {
+    return FALSE;
+  }
+  *SizeLen = (Table[SizeAdr] >> 6) + 1;
+  if (*SizeLen == 1) {
+    *Size = Table[SizeAdr] & 0x3F;
+  } else {
+    if ((Table[SizeAdr] & 0x30) != 0 || SizeAdr + *SizeLen > Limit) {
+      return FALSE;
+    }
+    *Size = Table[SizeAdr] & 0x0F;
+    for (i = 1; i < *SizeLen; i++) {
+      *Size |= (UINT32)Table[SizeAdr + i] << (4 + (i - 1) * 8);
+    }
+  }
+  return *Size >= *SizeLen && *Size <= Limit - SizeAdr;
+}
+
+static void WritePkgLength(UINT8* Out, UINT32 Size, UINT8 SizeLen)
+{
+  UINT8 i;
+  if (SizeLen == 1) {
+    Out[0] = (UINT8)Size;
+    return;
+  }
+  Out[0] = (UINT8)(((SizeLen - 1) << 6) | (Size & 0x0F));
+  for (i = 1; i < SizeLen; i++) {
+    Out[i] = (UINT8)(Size >> (4 + (i - 1) * 8));
+  }
+}
+
+// code objects: their terms are If/Else/While, not Scope or Device
+static BOOLEAN IsCodeObject(const AML_OBJECT& Object)
+{
+  return !Object.ExtOp && (Object.Opcode == 0x14 || Object.Opcode == 0xA0 ||
+                           Object.Opcode == 0xA1 || Object.Opcode == 0xA2);
+}
+
+// Sure - a term begins at Pos, else Pos is a candidate found by search and is checked harder
+// TermStart - a term is known to begin at Pos (search after an object)
+// Body - where the terms of the content begin
+BOOLEAN AmlTree::ParseObject(UINT32 Pos, UINT32 ParentIndex, BOOLEAN Sure, BOOLEAN TermStart, AML_OBJECT* Object, UINT32* Body) const
+{
+  const AML_OBJECT& Parent = Objects.ElementAt((size_t)ParentIndex);
+  UINT32  Limit = Parent.End;
+  BOOLEAN InCode = IsCodeObject(Parent);
+  BOOLEAN Named = FALSE;
+  UINT32  SizeAdr;
+  UINT32  Size;
+  UINT32  NameLen = 0;
+  UINT32  Fixed = 0;   //data after the name
+  UINT8   SizeLen;
+  UINT8   Op = Table[Pos];
+
+  //a byte of a ByteConst, WordConst or DWordConst is data
+  if (!Sure && !TermStart && Pos >= 4 &&
+      ((Table[Pos - 1] >= 0x0A && Table[Pos - 1] <= 0x0C) ||
+       Table[Pos - 2] == 0x0B || Table[Pos - 2] == 0x0C ||
+       Table[Pos - 3] == 0x0C || Table[Pos - 4] == 0x0C)) {
+    return FALSE;
+  }
+
+  Object->ExtOp = FALSE;
+  Object->Container = TRUE;
+  if (Op == 0x5B) {
+    if (Pos + 1 >= Limit) {
+      return FALSE;
+    }
+    Op = Table[Pos + 1];
+    Object->ExtOp = TRUE;
+    SizeAdr = Pos + 2;
+    switch (Op) {
+      case 0x83: //Processor
+        Fixed = 6;
+        Named = TRUE;
+        break;
+      case 0x84: //PowerResource
+        Fixed = 3;
+        Named = TRUE;
+        break;
+      case 0x82: //Device
+      case 0x85: //ThermalZone
+        Named = TRUE;
+        break;
+      case 0x81: //Field
+      case 0x86: //IndexField
+      case 0x87: //BankField
+        Object->Container = FALSE;
+        break;
+      default:
+        return FALSE;
+    }
+    if (InCode && !Sure) {
+      return FALSE;
+    }
+  } else {
+    SizeAdr = Pos + 1;
+    switch (Op) {
+      case 0x14: //Method
+        Fixed = 1;
+        //fallthrough
+      case 0x10: //Scope
+        if (InCode && !Sure) {
+          return FALSE;
+        }
+        Named = TRUE;
+        break;
+      case 0xA0: //If
+      case 0xA2: //While
+        if (!InCode && !Sure) {
+          return FALSE;
+        }
+        break;
+      case 0xA1: //Else follows its If
+        if (!Sure && (!InCode || Parent.Last == 0 ||
+                      Objects.ElementAt((size_t)Parent.Last).End != Pos ||
+                      Objects.ElementAt((size_t)Parent.Last).Opcode != 0xA0)) {
+          return FALSE;
+        }
+        break;
+      case 0x12: //Package, NumElements
+        Fixed = 1;
+        //fallthrough
+      case 0x13: //VarPackage
+        if (!Sure) {
+          return FALSE;
+        }
+        break;
+      case 0x11: //Buffer
+        Object->Container = FALSE;
+        break;
+      default:
+        return FALSE;
+    }
+  }
+
+  if (!ReadPkgLength(Table, SizeAdr, Limit, &Size, &SizeLen)) {
+    return FALSE;
+  }
+
+  if (Named) {
+    NameLen = NameLength(Table, SizeAdr + SizeLen, SizeAdr + Size);
+    if (NameLen == 0) {
+      return FALSE;
+    }
+  } else if (Op == 0x11 && !Object->ExtOp && !Sure) {
+    //BufferSize is a constant not smaller than the initializer
+    UINT32 Data = SizeAdr + SizeLen;
+    UINT32 Declared;
+    if (Data + 2 > SizeAdr + Size) {
+      return FALSE;
+    }
+    if (Table[Data] == 0x0A) {
+      Declared = Table[Data + 1];
+      Data += 2;
+    } else if (Table[Data] == 0x0B && Data + 3 <= SizeAdr + Size) {
+      Declared = Table[Data + 1] | (Table[Data + 2] << 8);
+      Data += 3;
+    } else {
+      return FALSE;
+    }
+    if (Declared < SizeAdr + Size - Data) {
+      return FALSE;
+    }
+  }
+  if (SizeLen + NameLen + Fixed > Size) {
+    return FALSE;
+  }
+
+  Object->Opcode = Op;
+  Object->Removed = FALSE;
+  Object->SizeLen = SizeLen;
+  Object->NewSizeLen = SizeLen;
+  Object->Start = Pos;
+  Object->SizeAdr = SizeAdr;
+  Object->End = SizeAdr + Size;
+  Object->EditDelta = 0;
+  Object->Delta = 0;
+  Object->NewSize = Size;
+  Object->Parent = ParentIndex;
+  Object->First = 0;
+  Object->Last = 0;
+  Object->Next = 0;
+  *Body = SizeAdr + SizeLen + NameLen + Fixed;
+  return TRUE;
+}
+
+UINT32 AmlTree::AddObject(const AML_OBJECT& Object)
+{
+  UINT32 Index = (UINT32)Objects.size();
+  Objects.Add(Object);
+  AML_OBJECT& Parent = Objects.ElementAt((size_t)Object.Parent);
+  if (Parent.First == 0) {
+    Parent.First = Index;
+  } else {
+    Objects.ElementAt((size_t)Parent.Last).Next = Index;
+  }
+  Parent.Last = Index;
+  return Index;
+}
+
+// object with PkgLength at Pos, its content is parsed. Returns its end or 0
+UINT32 AmlTree::ParsePkgObject(UINT32 Pos, UINT32 ParentIndex, UINT32 Depth)
+{
+  AML_OBJECT Object;
+  UINT32     Body;
+  UINT32     Index;
+  if (!ParseObject(Pos, ParentIndex, TRUE, TRUE, &Object, &Body)) {
+    return 0;
+  }
+  Index = AddObject(Object);
+  if (Object.Container) {
+    ParseTermList(Index, Body, Depth + 1);
+  }
+  return Object.End;
+}
+
+UINT32 AmlTree::ParseOperand(CHAR8 Kind, UINT32 Pos, UINT32 ParentIndex, UINT32 Depth)
+{
+  UINT32 Limit = Objects.ElementAt((size_t)ParentIndex).End;
+  UINT32 Len;
+  switch (Kind) {
+    case 'B':
+      return (Pos + 1 <= Limit) ? Pos + 1 : 0;
+    case 'W':
+      return (Pos + 2 <= Limit) ? Pos + 2 : 0;
+    case 'D':
+      return (Pos + 4 <= Limit) ? Pos + 4 : 0;
+    case 'Q':
+      return (Pos + 8 <= Limit) ? Pos + 8 : 0;
+    case 'N':
+      Len = NameLength(Table, Pos, Limit);
+      return Len ? Pos + Len : 0;
+    case 'G':
+      if (Pos < Limit && Table[Pos] == 0x00) { //NullName
+        return Pos + 1;
+      }
+      //fallthrough
+    case 'S':
+      if (Pos < Limit && IsNameStart(Table[Pos])) { //a name here is not invoked
+        Len = NameLength(Table, Pos, Limit);
+        return Len ? Pos + Len : 0;
+      }
+      //fallthrough
+    default:
+      return ParseTerm(Pos, ParentIndex, Depth + 1);
+  }
+}
+
+// returns the end of the term at Pos, or 0 if it can't be parsed
+UINT32 AmlTree::ParseTerm(UINT32 Pos, UINT32 ParentIndex, UINT32 Depth)
+{
+  UINT32       Limit = Objects.ElementAt((size_t)ParentIndex).End;
+  CONST CHAR8* Operands;
+  UINT8        Op;
+  UINT32       Len;
+
+  if (Pos >= Limit || Depth > AML_MAX_DEPTH) {
+    return 0;
+  }
+  Op = Table[Pos];
+  if (IsNameStart(Op)) {
+    //a method invocation is the name, its arguments are parsed as next terms
+    Len = NameLength(Table, Pos, Limit);
+    return Len ? Pos + Len : 0;
+  }
+  if (Op >= 0x60 && Op <= 0x6E) { //Local0-7, Arg0-6
+    return Pos + 1;
+  }
+  switch (Op) {
+    case 0x0D: //String
+      for (Len = Pos + 1; Len < Limit; Len++) {
+        if (Table[Len] == 0) {
+          return Len + 1;
+        }
+      }
+      return 0;
+    case 0x10: //Scope
+    case 0x11: //Buffer
+    case 0x12: //Package
+    case 0x13: //VarPackage
+    case 0x14: //Method
+    case 0xA0: //If
+    case 0xA1: //Else
+    case 0xA2: //While
+      return ParsePkgObject(Pos, ParentIndex, Depth);
+    case 0x5B:
+      if (Pos + 1 >= Limit) {
+        return 0;
+      }
+      if (Table[Pos + 1] >= 0x81 && Table[Pos + 1] <= 0x87) {
+        return ParsePkgObject(Pos, ParentIndex, Depth);
+      }
+      Operands = FindOperands(AmlExtOpcodes, sizeof(AmlExtOpcodes) / sizeof(AmlExtOpcodes[0]), Table[Pos + 1]);
+      Pos += 2;
+      break;
+    default:
+      Operands = FindOperands(AmlOpcodes, sizeof(AmlOpcodes) / sizeof(AmlOpcodes[0]), Op);
+      Pos += 1;
+      break;
+  }
+  if (!Operands) {
+    return 0;
+  }
+  for (; *Operands != 0 && Pos != 0; Operands++) {
+    Pos = ParseOperand(*Operands, Pos, ParentIndex, Depth);
+  }
+  return Pos;
+}
+
+// Terms from Pos to the end of the parent.
+// If a term can't be parsed the objects are searched byte by byte until one is found,
+// its end is a known term start again.
+void AmlTree::ParseTermList(UINT32 ParentIndex, UINT32 Pos, UINT32 Depth)
+{
+  UINT32     End = Objects.ElementAt((size_t)ParentIndex).End;
+  BOOLEAN    Search = FALSE;
+  BOOLEAN    TermStart = TRUE;
+  AML_OBJECT Object;
+  UINT32     Body;
+  UINT32     Next;
+
+  while (Pos < End) {
+    if (!Search) {
+      size_t Mark = Objects.size();
+      UINT32 Last = Objects.ElementAt((size_t)ParentIndex).Last;
+      Next = ParseTerm(Pos, ParentIndex, Depth);
+      if (Next != 0) {
+        Pos = Next;
+        continue;
+      }
+      //forget the objects of the failed term
+      Objects.setSize(Mark);
+      Objects.ElementAt((size_t)ParentIndex).Last = Last;
+      if (Last == 0) {
+        Objects.ElementAt((size_t)ParentIndex).First = 0;
+      } else {
+        Objects.ElementAt((size_t)Last).Next = 0;
+      }
+      DBG("AmlTree: unknown term %02X at %X, search objects\n", Table[Pos], Pos);
+      Search = TRUE;
+      TermStart = TRUE;
+    }
+    if (Depth <= AML_MAX_DEPTH && ParseObject(Pos, ParentIndex, FALSE, TermStart, &Object, &Body)) {
+      UINT32 Index = AddObject(Object);
+      if (Object.Container) {
+        ParseTermList(Index, Body, Depth + 1);
+      }
+      Pos = Object.End;
+      Search = FALSE;
+    } else {
+      Pos++;
+      TermStart = FALSE;
+    }
+  }
+}
+
+BOOLEAN AmlTree::Parse(const UINT8* Buffer, UINT32 Len)
+{
+  AML_OBJECT Root;
+
+  Table = Buffer;
+  Length = Len;
+  Objects.setEmpty();
+  Edits.setEmpty();
+  if (!Buffer || Len < sizeof(EFI_ACPI_DESCRIPTION_HEADER)) {
+    return FALSE;
+  }
+  //the root is the table, its "header" is the ACPI header
+  Root.Container = TRUE;
+  Root.SizeLen = sizeof(EFI_ACPI_DESCRIPTION_HEADER);
+  Root.NewSizeLen = Root.SizeLen;
+  Root.End = Len;
+  Objects.Add(Root);
+  ParseTermList(0, sizeof(EFI_ACPI_DESCRIPTION_HEADER), 0);
+  DBG("AmlTree: %llu objects in %u bytes\n", (UINT64)Objects.size(), Len);
+  return TRUE;
+}
+
+// innermost object whose content holds the edit, objects covered by the edit are marked as Removed
+// AML_NOT_FOUND if the edit cuts an object header or the end of an object
+UINT32 AmlTree::FindOwner(UINT32 Start, UINT32 OldLen)
+{
+  UINT32 EditEnd = Start + OldLen;
+  size_t Low = 0;
+  size_t High = Objects.size();
+  size_t i;
+  UINT32 Owner;
+
+  //objects are in the order of the table: last one beginning before the edit
+  while (High - Low > 1) {
+    size_t Middle = (Low + High) / 2;
+    if (Objects.ElementAt(Middle).Start < Start) {
+      Low = Middle;
+    } else {
+      High = Middle;
+    }
+  }
+  //it or one of its parents holds the edit
+  Owner = (UINT32)Low;
+  while (Owner != 0 && Objects.ElementAt((size_t)Owner).End <= Start) {
+    Owner = Objects.ElementAt((size_t)Owner).Parent;
+  }
+  const AML_OBJECT& Object = Objects.ElementAt((size_t)Owner);
+  if (Start < Object.ContentStart() || EditEnd > Object.End) {
+    return AML_NOT_FOUND;
+  }
+  //objects beginning inside the edit must be inside it entirely
+  for (i = Low + 1; i < Objects.size() && Objects.ElementAt(i).Start < EditEnd; i++) {
+    if (Objects.ElementAt(i).End > EditEnd) {
+      return AML_NOT_FOUND;
+    }
+  }
+  for (i = Low + 1; i < Objects.size() && Objects.ElementAt(i).Start < EditEnd; i++) {
+    Objects.ElementAt(i).Removed = TRUE;
+  }
+  return Owner;
+}
+
+BOOLEAN AmlTree::AddEdit(UINT32 Start, UINT32 OldLen, const UINT8* Data, UINT32 NewLen)
+{
+  AML_EDIT Edit;
+  UINT32   Owner;
+
+  if (Objects.isEmpty() || Start > Length || OldLen > Length - Start || (NewLen > 0 && !Data)) {
+    return FALSE;
+  }
+  if (!Edits.isEmpty()) {
+    const AML_EDIT& Last = Edits.ElementAt(Edits.size() - 1);
+    if (Start < Last.Start + Last.OldLen) {
+      return FALSE;
+    }
+  }
+  Owner = FindOwner(Start, OldLen);
+  if (Owner == AML_NOT_FOUND) {
+    return FALSE;
+  }
+  Objects.ElementAt((size_t)Owner).EditDelta += (INT32)NewLen - (INT32)OldLen;
+  Edit.Start = Start;
+  Edit.OldLen = OldLen;
+  Edit.Data = Data;
+  Edit.NewLen = NewLen;
+  Edits.Add(Edit);
+  return TRUE;
+}
+
+// lengths are computed from the inner objects to the outer ones
+// a PkgLength keeps its width unless the new size needs more bytes, so objects not changed stay the same
+UINT32 AmlTree::GetNewLength()
+{
+  size_t i;
+  if (Objects.isEmpty()) {
+    return Length;
+  }
+  for (i = 0; i < Objects.size(); i++) {
+    Objects.ElementAt(i).Delta = Objects.ElementAt(i).EditDelta;
+  }
+  for (i = Objects.size() - 1; i > 0; i--) {
+    AML_OBJECT& Object = Objects.ElementAt(i);
+    if (Object.Removed) {
+      continue;
+    }
+    UINT32 Content = (UINT32)((INT32)(Object.End - Object.ContentStart()) + Object.Delta);
+    UINT8  SizeLen = Object.SizeLen;
+    while (SizeLen < 4 && Content + SizeLen > PkgLengthMax[SizeLen]) {
+      SizeLen++;
+    }
+    Object.NewSizeLen = SizeLen;
+    Object.NewSize = Content + SizeLen;
+    Objects.ElementAt((size_t)Object.Parent).Delta += Object.Delta + SizeLen - Object.SizeLen;
+  }
+  return (UINT32)((INT32)Length + Objects.ElementAt((size_t)0).Delta);
+}
+
+UINT32 AmlTree::Write(UINT8* Out)
+{
+  UINT32 NewLength = GetNewLength();
+  UINT32 Src = 0;
+  UINT32 Dst = 0;
+  size_t e = 0;
+  size_t o = 1;
+
+  for (;;) {
+    while (o < Objects.size() && Objects.ElementAt(o).Removed) {
+      o++;
+    }
+    UINT32 ObjectPos = (o < Objects.size()) ? Objects.ElementAt(o).SizeAdr : AML_NOT_FOUND;
+    UINT32 EditPos = (e < Edits.size()) ? Edits.ElementAt(e).Start : AML_NOT_FOUND;
+    UINT32 Next = (EditPos <= ObjectPos) ? EditPos : ObjectPos;
+    if (Next == AML_NOT_FOUND) {
+      break;
+    }
+    CopyMem(Out + Dst, Table + Src, Next - Src);
+    Dst += Next - Src;
+    if (EditPos <= ObjectPos) {
+      const AML_EDIT& Edit = Edits.ElementAt(e++);
+      if (Edit.NewLen > 0) {
+        CopyMem(Out + Dst, Edit.Data, Edit.NewLen);
+      }
+      Dst += Edit.NewLen;
+      Src = Edit.Start + Edit.OldLen;
+    } else {
+      const AML_OBJECT& Object = Objects.ElementAt(o++);
+      WritePkgLength(Out + Dst, Object.NewSize, Object.NewSizeLen);
+      Dst += Object.NewSizeLen;
+      Src = Object.SizeAdr + Object.SizeLen;
+    }
+  }
+  CopyMem(Out + Dst, Table + Src, Length - Src);
+  Dst += Length - Src;
+  if (Dst != NewLength) {
+    DBG("AmlTree: written %u bytes instead of %u\n", Dst, NewLength);
+  }
+  ((EFI_ACPI_DESCRIPTION_HEADER*)Out)->Length = Dst;
+  return Dst;
+}
+
+UINT32 AmlTree::Apply(UINT8* Buffer)
+{
+  UINT32 NewLength = GetNewLength();
+  UINT8* Out = (UINT8*)AllocatePool(NewLength);
+  if (!Out) {
+    return 0;
+  }
+  NewLength = Write(Out);
+  CopyMem(Buffer, Out, NewLength);
+  FreePool(Out);
+  return NewLength;
+}
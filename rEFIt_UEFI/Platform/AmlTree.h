@@ -0,0 +1,92 @@
+/*
+ * AmlTree.h
+ *
+ * Tree of the AML objects that carry a PkgLength (Scope, Device, Method, If, Package...)
+ * parsed once from a DSDT/SSDT, so that binary patches can be collected
+ * and the table written back once with all the lengths recomputed,
+ * instead of moving the tail of the table and correcting the outers for every hit.
+ */
+
+#ifndef PLATFORM_AMLTREE_H_
+#define PLATFORM_AMLTREE_H_
+
+#include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+#include "../cpp_foundation/XArray.h"
+
+// one object with a PkgLength
+// the PkgLength is at SizeAdr, the object is [Start, End)
+// First, Last, Next, Parent are indexes in the tree, 0 is the root (whole table), 0 as First/Next means none
+class AML_OBJECT
+{
+public:
+  UINT8   Opcode;     // 0x5B objects keep their second byte
+  BOOLEAN ExtOp;
+  BOOLEAN Container;  // FALSE for Field and Buffer: the content is not parsed
+  BOOLEAN Removed;    // covered by an edit
+  UINT8   SizeLen;    // bytes of the original PkgLength
+  UINT8   NewSizeLen;
+  UINT32  Start;
+  UINT32  SizeAdr;
+  UINT32  End;
+  INT32   EditDelta;  // size change of the edits owned directly by this object
+  INT32   Delta;      // size change of the whole object, inner objects included
+  UINT32  NewSize;    // PkgLength to write
+  UINT32  Parent;
+  UINT32  First;
+  UINT32  Last;
+  UINT32  Next;
+
+  AML_OBJECT() : Opcode(0), ExtOp(FALSE), Container(FALSE), Removed(FALSE), SizeLen(0), NewSizeLen(0),
+                 Start(0), SizeAdr(0), End(0), EditDelta(0), Delta(0), NewSize(0), Parent(0), First(0), Last(0), Next(0) {}
+  UINT32 ContentStart() const { return SizeAdr + SizeLen; }
+};
+
+// replace OldLen bytes at Start by NewLen bytes of Data
+class AML_EDIT
+{
+public:
+  UINT32       Start;
+  UINT32       OldLen;
+  const UINT8* Data;
+  UINT32       NewLen;
+
+  AML_EDIT() : Start(0), OldLen(0), Data(NULL), NewLen(0) {}
+};
+
+class AmlTree
+{
+protected:
+  const UINT8*       Table;
+  UINT32             Length;
+  XArray<AML_OBJECT> Objects; // in the order of the table, Objects[0] is the root
+  XArray<AML_EDIT>   Edits;   // sorted, not overlapping
+
+  BOOLEAN ParseObject(UINT32 Pos, UINT32 ParentIndex, BOOLEAN Sure, BOOLEAN TermStart, AML_OBJECT* Object, UINT32* Body) const;
+  UINT32  AddObject(const AML_OBJECT& Object);
+  UINT32  ParsePkgObject(UINT32 Pos, UINT32 ParentIndex, UINT32 Depth);
+  UINT32  ParseOperand(CHAR8 Kind, UINT32 Pos, UINT32 ParentIndex, UINT32 Depth);
+  UINT32  ParseTerm(UINT32 Pos, UINT32 ParentIndex, UINT32 Depth);
+  void    ParseTermList(UINT32 ParentIndex, UINT32 Pos, UINT32 Depth);
+  UINT32  FindOwner(UINT32 Start, UINT32 OldLen);
+
+public:
+  AmlTree() : Table(NULL), Length(0), Objects(), Edits() {}
+
+  BOOLEAN Parse(const UINT8* Buffer, UINT32 Len);
+  size_t  GetObjectCount() const { return Objects.size(); }
+  const AML_OBJECT& GetObject(size_t Index) const { return Objects.ElementAt(Index); }
+
+  // FALSE if the edit cuts the header of an object without removing it, or overlaps a previous edit
+  // then nothing is recorded and the caller should patch the old way
+  BOOLEAN AddEdit(UINT32 Start, UINT32 OldLen, const UINT8* Data, UINT32 NewLen);
+  size_t  GetEditCount() const { return Edits.size(); }
+
+  // length of the table after Write
+  UINT32  GetNewLength();
+  // write the patched table to Out, NewLength bytes. Out must not be the parsed buffer
+  UINT32  Write(UINT8* Out);
+  // patch the parsed buffer itself, it must have room for the new length. 0 if out of memory
+  UINT32  Apply(UINT8* Buffer);
+};
+
+#endif /* PLATFORM_AMLTREE_H_ */
@@ -15,6 +15,8 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
 #include "../include/Handle.h"
 #include "../Platform/Settings.h"
+#include "../Platform/Nvram.h"
+#include "../Platform/HandleSnapshot.h"
 
 
 /**
@@ -216,6 +218,8 @@ BdsLibConnectAllEfi (
   EFI_HANDLE  *HandleBuffer;
   UINTN       Index;
 
+  BdsLibConnectDeferred(); // the timer doesn't need to go on
+
   Status = gBS->LocateHandleBuffer (
                   AllHandles,
                   NULL,
@@ -287,202 +291,217 @@ BdsLibDisconnectAllEfi (
   return EFI_SUCCESS;
 }
 
-EFI_STATUS ScanDeviceHandles(EFI_HANDLE ControllerHandle,
-                             UINTN *HandleCount,
-                             EFI_HANDLE **HandleBuffer,
-                             UINT32 **HandleType)
+//
+// Boot/DeferConnect : the first BdsLibConnectAllDriversToAllControllers() leaves the PCI controllers the menu
+// doesn't need (network, communication, wireless, FireWire, SMBus...), then a timer connects them one per tick
+// while the menu waits for keys. Boot services are not MP safe, so it is interleaving on the BSP, not parallelism.
+// Boot/LazyConnect also leaves the storage controllers when the boot volume of efi-boot-device-data could be
+// connected by its device path, and all classes but display, bridges and USB (the keyboard).
+//
+#define DEFERRED_CONNECT_MAX      256
+#define DEFERRED_CONNECT_PERIOD   (10 * 1000 * 10) // 10 ms, in 100 ns units
+
+static EFI_HANDLE DeferredHandles[DEFERRED_CONNECT_MAX];
+static UINTN      DeferredCount = 0;
+static UINTN      DeferredNext = 0;
+static EFI_EVENT  DeferredEvent = NULL;
+static BOOLEAN    Deferring = FALSE; // only during the first connect of the boot
+static BOOLEAN    DeferDone = FALSE;
+static BOOLEAN    DeferLazy = FALSE;
+static BOOLEAN    DeferStorage = FALSE;
+
+static BOOLEAN IsDeferredController(const PCI_TYPE00* Pci)
 {
-  EFI_STATUS                          Status;
-  UINTN                               HandleIndex;
-  EFI_GUID                            **ProtocolGuidArray;
-  UINTN                               ArrayCount;
-  UINTN                               ProtocolIndex;
-  EFI_OPEN_PROTOCOL_INFORMATION_ENTRY *OpenInfo;
-  UINTN                               OpenInfoCount;
-  UINTN                               OpenInfoIndex;
-  UINTN                               ChildIndex;
-  
-  *HandleCount  = 0;
-  *HandleBuffer = NULL;
-  *HandleType   = NULL;
-  
-  //
-  // Retrieve the list of all handles from the handle database
-  //
-  Status = gBS->LocateHandleBuffer (AllHandles, NULL, NULL, HandleCount, HandleBuffer);
-  if (EFI_ERROR(Status)) goto Error;
-  
-  *HandleType = (__typeof_am__(*HandleType))AllocatePool (*HandleCount * sizeof (**HandleType));
-  if (*HandleType == NULL) goto Error;
-    
-  for (HandleIndex = 0; HandleIndex < *HandleCount; HandleIndex++) {
-    (*HandleType)[HandleIndex] = EFI_HANDLE_TYPE_UNKNOWN;
-    //
-    // Retrieve the list of all the protocols on each handle
-    //
-    Status = gBS->ProtocolsPerHandle (
-                  (*HandleBuffer)[HandleIndex],
-                  &ProtocolGuidArray,
-                  &ArrayCount
-                  );
-    if (!EFI_ERROR(Status)) {      
-      for (ProtocolIndex = 0; ProtocolIndex < ArrayCount; ProtocolIndex++) {
-        
-        if (CompareGuid (ProtocolGuidArray[ProtocolIndex], &gEfiLoadedImageProtocolGuid)) {
-          (*HandleType)[HandleIndex] |= EFI_HANDLE_TYPE_IMAGE_HANDLE;
-        }
-        
-        if (CompareGuid (ProtocolGuidArray[ProtocolIndex], &gEfiDriverBindingProtocolGuid)) {
-          (*HandleType)[HandleIndex] |= EFI_HANDLE_TYPE_DRIVER_BINDING_HANDLE;
-        }
-        
-        if (CompareGuid (ProtocolGuidArray[ProtocolIndex], &gEfiDriverConfigurationProtocolGuid)) {
-          (*HandleType)[HandleIndex] |= EFI_HANDLE_TYPE_DRIVER_CONFIGURATION_HANDLE;
-        }
-        
-        if (CompareGuid (ProtocolGuidArray[ProtocolIndex], &gEfiDriverDiagnosticsProtocolGuid)) {
-          (*HandleType)[HandleIndex] |= EFI_HANDLE_TYPE_DRIVER_DIAGNOSTICS_HANDLE;
-        }
-        
-        if (CompareGuid (ProtocolGuidArray[ProtocolIndex], &gEfiComponentName2ProtocolGuid)) {
-          (*HandleType)[HandleIndex] |= EFI_HANDLE_TYPE_COMPONENT_NAME_HANDLE;
-        }
-        
-        if (CompareGuid (ProtocolGuidArray[ProtocolIndex], &gEfiComponentNameProtocolGuid) ) {
-          (*HandleType)[HandleIndex] |= EFI_HANDLE_TYPE_COMPONENT_NAME_HANDLE;
-        }
-        
-        if (CompareGuid (ProtocolGuidArray[ProtocolIndex], &gEfiDevicePathProtocolGuid)) {
-          (*HandleType)[HandleIndex] |= EFI_HANDLE_TYPE_DEVICE_HANDLE;
-        }
-        
-        //
-        // Retrieve the list of agents that have opened each protocol
-        //
-        Status = gBS->OpenProtocolInformation (
-                                               (*HandleBuffer)[HandleIndex],
-                                               ProtocolGuidArray[ProtocolIndex],
-                                               &OpenInfo,
-                                               &OpenInfoCount
-                                               );
-        if (!EFI_ERROR(Status)) {
-          
-          for (OpenInfoIndex = 0; OpenInfoIndex < OpenInfoCount; OpenInfoIndex++) {
-            
-            if (OpenInfo[OpenInfoIndex].ControllerHandle == ControllerHandle) {
-              if ((OpenInfo[OpenInfoIndex].Attributes & EFI_OPEN_PROTOCOL_BY_DRIVER) == EFI_OPEN_PROTOCOL_BY_DRIVER) {
-                for (ChildIndex = 0; ChildIndex < *HandleCount; ChildIndex++) {
-                  if ((*HandleBuffer)[ChildIndex] == OpenInfo[OpenInfoIndex].AgentHandle) {
-                    (*HandleType)[ChildIndex] |= EFI_HANDLE_TYPE_DEVICE_DRIVER;
-                  }
-                }
-              }
-              
-              if ((OpenInfo[OpenInfoIndex].Attributes & EFI_OPEN_PROTOCOL_BY_CHILD_CONTROLLER) == EFI_OPEN_PROTOCOL_BY_CHILD_CONTROLLER) {
-                (*HandleType)[HandleIndex] |= EFI_HANDLE_TYPE_PARENT_HANDLE;
-                for (ChildIndex = 0; ChildIndex < *HandleCount; ChildIndex++) 
-                {
-                  if ((*HandleBuffer)[ChildIndex] == OpenInfo[OpenInfoIndex].AgentHandle) {
-                    (*HandleType)[ChildIndex] |= EFI_HANDLE_TYPE_BUS_DRIVER;
-                  }
-                }
-              }
-            }
-          }
-          
-//MsgLog("ScanDeviceHandles FreePool(OpenInfo)\n");
-          FreePool(OpenInfo);
-//MsgLog("ScanDeviceHandles FreePool(OpenInfo) after\n");
-        }
+  switch (Pci->Hdr.ClassCode[2]) {
+    case PCI_CLASS_NETWORK:
+    case PCI_CLASS_SCC:
+    case PCI_CLASS_WIRELESS:
+    case PCI_CLASS_INTELLIGENT_IO:
+    case PCI_CLASS_SATELLITE:
+    case PCI_CLASS_DPIO:
+      return TRUE;
+    case PCI_CLASS_SERIAL:
+      // not USB : keyboard and boot disks. Not Thunderbolt or Fibre Channel : boot disks and displays.
+      return Pci->Hdr.ClassCode[1] == PCI_CLASS_SERIAL_FIREWIRE || Pci->Hdr.ClassCode[1] == PCI_CLASS_SERIAL_SMB;
+    case PCI_CLASS_DISPLAY:
+    case PCI_CLASS_BRIDGE:
+      return FALSE;
+    case PCI_CLASS_MASS_STORAGE:
+      return DeferStorage;
+  }
+  return DeferLazy;
+}
+
+// FALSE if the list is full, the handle is then connected now
+static BOOLEAN DeferConnect(EFI_HANDLE Handle)
+{
+  for (UINTN Index = 0; Index < DeferredCount; Index++) {
+    if (DeferredHandles[Index] == Handle) {
+      return TRUE;
+    }
+  }
+  if (DeferredCount >= DEFERRED_CONNECT_MAX) {
+    return FALSE;
+  }
+  DeferredHandles[DeferredCount++] = Handle;
+  return TRUE;
+}
+
+// Boot/LazyConnect : the boot volume and the consoles, by their device paths. TRUE if the boot volume is there.
+static BOOLEAN LazyConnectBootPaths(VOID)
+{
+  static CONST CHAR16 *ConsoleVariables[] = { L"ConIn", L"ConOut" };
+  EFI_DEVICE_PATH_PROTOCOL *DevicePath;
+  UINTN                     Size = 0;
+  BOOLEAN                   BootVolume = FALSE;
+
+  // a MemoryMapped efi-boot-device-data (BootCampHD) is not found, all storage is then connected
+  DevicePath = (EFI_DEVICE_PATH_PROTOCOL*)GetNvramVariable(L"efi-boot-device-data", &gEfiAppleBootGuid, NULL, &Size);
+  if (DevicePath != NULL) {
+    BootVolume = IsDevicePathValid(DevicePath, Size) && !EFI_ERROR(BdsLibConnectDevicePath(DevicePath));
+    FreePool(DevicePath);
+  }
+  for (UINTN Index = 0; Index < sizeof(ConsoleVariables) / sizeof(ConsoleVariables[0]); Index++) {
+    DevicePath = (EFI_DEVICE_PATH_PROTOCOL*)GetNvramVariable(ConsoleVariables[Index], &gEfiGlobalVariableGuid, NULL, &Size);
+    if (DevicePath != NULL) {
+      if (IsDevicePathValid(DevicePath, Size)) {
+        BdsLibConnectDevicePath(DevicePath);
       }
-//MsgLog("ScanDeviceHandles FreePool(ProtocolGuidArray)\n");
-      
-      FreePool(ProtocolGuidArray);
-//MsgLog("ScanDeviceHandles FreePool(ProtocolGuidArray) after\n");
+      FreePool(DevicePath);
     }
   }
-  
-  return EFI_SUCCESS;
-  
-Error:
-  if (*HandleType != NULL) {
-    FreePool(*HandleType);
+  return BootVolume;
+}
+
+// While deferring, root bridges are connected without their children. Then the PCI devices are connected here, or deferred.
+static VOID ConnectPciNotDeferred(VOID)
+{
+  UINTN       HandleCount = 0;
+  EFI_HANDLE  *Handles = NULL;
+
+  if (EFI_ERROR(gBS->LocateHandleBuffer(ByProtocol, &gEfiPciIoProtocolGuid, NULL, &HandleCount, &Handles))) {
+    return;
   }
-  
-  if (*HandleBuffer != NULL) {
-    FreePool(*HandleBuffer);
+  for (UINTN Index = 0; Index < HandleCount; Index++) {
+    EFI_PCI_IO_PROTOCOL *PciIo;
+    PCI_TYPE00           Pci;
+
+    if (EFI_ERROR(gBS->HandleProtocol(Handles[Index], &gEfiPciIoProtocolGuid, (void**)&PciIo))) {
+      continue;
+    }
+    if (!EFI_ERROR(PciIo->Pci.Read(PciIo, EfiPciIoWidthUint32, 0, sizeof(Pci) / sizeof(UINT32), &Pci)) &&
+        IsDeferredController(&Pci) && DeferConnect(Handles[Index])) {
+      continue;
+    }
+    gBS->ConnectController(Handles[Index], NULL, NULL, TRUE);
   }
-  
-  *HandleCount  = 0;
-  *HandleBuffer = NULL;
-  *HandleType   = NULL;
-  
-  return Status;
+  FreePool(Handles);
 }
 
+static VOID EFIAPI DeferredConnectNotify(IN EFI_EVENT Event, IN VOID *Context)
+{
+  if (DeferredNext < DeferredCount) {
+    gBS->ConnectController(DeferredHandles[DeferredNext++], NULL, NULL, TRUE);
+  }
+  if (DeferredNext >= DeferredCount) {
+    gBS->SetTimer(Event, TimerCancel, 0);
+  }
+}
 
+/**
+  Starts the timer that connects the controllers left by Boot/DeferConnect or Boot/LazyConnect.
+  Called when the menu is shown : the file systems that appear then make the menu rescan the volumes.
+**/
+VOID
+EFIAPI
+BdsLibStartDeferredConnect (
+  VOID
+  )
+{
+  EFI_STATUS Status;
 
+  if (DeferredEvent != NULL || DeferredNext >= DeferredCount) {
+    return;
+  }
+  MsgLog("DeferConnect: %llu controllers connected while the menu is shown\n", DeferredCount - DeferredNext);
+  Status = gBS->CreateEvent(EVT_TIMER | EVT_NOTIFY_SIGNAL, TPL_CALLBACK, DeferredConnectNotify, NULL, &DeferredEvent);
+  if (!EFI_ERROR(Status)) {
+    Status = gBS->SetTimer(DeferredEvent, TimerPeriodic, DEFERRED_CONNECT_PERIOD);
+  }
+  if (EFI_ERROR(Status)) {
+    BdsLibConnectDeferred();
+  }
+}
+
+/**
+  Connects now the controllers left by Boot/DeferConnect that the timer didn't connect yet.
+  Called before starting a loader, a tool or a legacy OS, they may use the drivers of these controllers.
+**/
+VOID
+EFIAPI
+BdsLibConnectDeferred (
+  VOID
+  )
+{
+  if (DeferredEvent != NULL) {
+    // no notify can run after CloseEvent, DeferredNext is ours
+    gBS->SetTimer(DeferredEvent, TimerCancel, 0);
+    gBS->CloseEvent(DeferredEvent);
+    DeferredEvent = NULL;
+  }
+  while (DeferredNext < DeferredCount) {
+    gBS->ConnectController(DeferredHandles[DeferredNext++], NULL, NULL, TRUE);
+  }
+}
+
+//
+// The parents and the types of the handles come from one snapshot of the handle database, instead of a
+// ScanDeviceHandles() of the whole database for each handle. The handles created by the connects below are children,
+// they are connected by ConnectController() of their parent as before.
+//
 EFI_STATUS BdsLibConnectMostlyAllEfi()
 {
 	EFI_STATUS				Status;
-	UINTN             AllHandleCount = 0;
-	EFI_HANDLE				*AllHandleBuffer = NULL;
+	HANDLE_SNAPSHOT		Snapshot;
 	UINTN             Index;
-	UINTN             HandleCount = 0;
-	EFI_HANDLE				*HandleBuffer = NULL;
-	UINT32            *HandleType = NULL;
-	UINTN             HandleIndex;
-	BOOLEAN           Parent;
-	BOOLEAN           Device;
+	EFI_HANDLE				Handle;
+	UINT32            HandleType;
 	EFI_PCI_IO_PROTOCOL*	PciIo = NULL;
+	VOID*					RootBridgeIo;
 	PCI_TYPE00				Pci;
   
-	Status = gBS->LocateHandleBuffer (AllHandles, NULL, NULL, &AllHandleCount, &AllHandleBuffer);
+	Status = Snapshot.Take();
 	if (EFI_ERROR(Status)) 
 		return Status;
   
-	for (Index = 0; Index < AllHandleCount; Index++) {
-		Status = ScanDeviceHandles(AllHandleBuffer[Index], &HandleCount, &HandleBuffer, &HandleType);
-    
-		if (EFI_ERROR(Status))
-			goto Done;
+	for (Index = 0; Index < Snapshot.HandleCount(); Index++) {
+		Handle = Snapshot.Handle(Index).Handle;
+		HandleType = Snapshot.Handle(Index).Type;
     
-		Device = TRUE;
-		
-		if (HandleType[Index] & EFI_HANDLE_TYPE_DRIVER_BINDING_HANDLE)
-			Device = FALSE;
-		if (HandleType[Index] & EFI_HANDLE_TYPE_IMAGE_HANDLE)
-			Device = FALSE;
-    
-		if (Device) {					
-			Parent = FALSE;
-			for (HandleIndex = 0; HandleIndex < HandleCount; HandleIndex++) {
-				if (HandleType[HandleIndex] & EFI_HANDLE_TYPE_PARENT_HANDLE)
-					Parent = TRUE;
-			}
-      
-			if (!Parent) {
-				if (HandleType[Index] & EFI_HANDLE_TYPE_DEVICE_HANDLE) {
-					Status = gBS->HandleProtocol (AllHandleBuffer[Index], &gEfiPciIoProtocolGuid, (void**)&PciIo);
-					if (!EFI_ERROR(Status)) {
-						Status = PciIo->Pci.Read (PciIo,EfiPciIoWidthUint32, 0, sizeof (Pci) / sizeof (UINT32), &Pci);
-						if (!EFI_ERROR(Status)) {
-							if(IS_PCI_VGA(&Pci)==TRUE) {
-								gBS->DisconnectController(AllHandleBuffer[Index], NULL, NULL);
-							}
-						}
-					}
-					Status = gBS->ConnectController(AllHandleBuffer[Index], NULL, NULL, TRUE);
+		if (HandleType & (EFI_HANDLE_TYPE_DRIVER_BINDING_HANDLE | EFI_HANDLE_TYPE_IMAGE_HANDLE))
+			continue;
+		if (Snapshot.HasParent(Index))
+			continue;
+		if ((HandleType & EFI_HANDLE_TYPE_DEVICE_HANDLE) == 0)
+			continue;
+
+		Status = gBS->HandleProtocol (Handle, &gEfiPciIoProtocolGuid, (void**)&PciIo);
+		if (!EFI_ERROR(Status)) {
+			Status = PciIo->Pci.Read (PciIo,EfiPciIoWidthUint32, 0, sizeof (Pci) / sizeof (UINT32), &Pci);
+			if (!EFI_ERROR(Status)) {
+				if(IS_PCI_VGA(&Pci)==TRUE) {
+					gBS->DisconnectController(Handle, NULL, NULL);
 				}
 			}
 		}
-    
-		FreePool(HandleBuffer);
-		FreePool(HandleType);
+		if (Deferring && !EFI_ERROR(Status) && IsDeferredController(&Pci) && DeferConnect(Handle)) {
+			continue;
+		}
+		// the PCI devices are children of the root bridge, ConnectPciNotDeferred() chooses
+		Status = gBS->ConnectController(Handle, NULL, NULL,
+		                                !Deferring || EFI_ERROR(gBS->HandleProtocol(Handle, &gEfiPciRootBridgeIoProtocolGuid, &RootBridgeIo)));
 	}
   
-Done:
-	FreePool(AllHandleBuffer);
 	return Status;
 }
 
@@ -503,12 +522,24 @@ BdsLibConnectAllDriversToAllControllers (
 {
   EFI_STATUS  Status;
 
+  // a connect after the first one doesn't wait for the timer
+  BdsLibConnectDeferred();
+  Deferring = (GlobalConfig.DeferConnect || GlobalConfig.LazyConnect) && !DeferDone;
+  DeferDone = TRUE;
+  if (Deferring && GlobalConfig.LazyConnect) {
+    DeferLazy = TRUE;
+    DeferStorage = LazyConnectBootPaths();
+  }
+
   do {
     //
     // Connect All EFI 1.10 drivers following EFI 1.10 algorithm
     //
     //BdsLibConnectAllEfi ();
     BdsLibConnectMostlyAllEfi ();
+    if (Deferring) {
+      ConnectPciNotDeferred();
+    }
     //
     // Check to see if it's possible to dispatch an more DXE drivers.
     // The BdsLibConnectAllEfi () may have made new DXE drivers show up.
@@ -519,6 +550,7 @@ BdsLibConnectAllDriversToAllControllers (
 
   } while (!EFI_ERROR(Status));
 
+  Deferring = FALSE;
 }
 
 
@@ -32,34 +32,44 @@
 void EFIAPI MemLogCallback(IN INTN DebugMode, IN CHAR8 *LastMessage);
 
 
-/** Prints Number of bytes in a row (hex and ascii). Row size is MaxNumber. */
+#define PRINT_BYTES_ROW_MAX 16
+
+/** Prints Number of bytes in a row (hex and ascii). Row size is MaxNumber, up to PRINT_BYTES_ROW_MAX. */
 void
 PrintBytesRow(IN UINT8 *Bytes, IN UINTN Number, IN UINTN MaxNumber)
 {
+	CHAR8	Hex[PRINT_BYTES_ROW_MAX * 2 + 1];
+	CHAR8	Row[PRINT_BYTES_ROW_MAX * 4 + 4];
 	UINTN	Index;
+	UINTN	Pos = 0;
 	
-	// print hex vals
-	for (Index = 0; Index < Number; Index++) {
-		DebugLog(1, "%02hhX ", Bytes[Index]);
+	if (MaxNumber > PRINT_BYTES_ROW_MAX) {
+		MaxNumber = PRINT_BYTES_ROW_MAX;
+	}
+	if (Number > MaxNumber) {
+		Number = MaxNumber;
 	}
 	
-	// pad to MaxNumber if needed
-	for (; Index < MaxNumber; Index++) {
-		DebugLog(1, "   ");
+	// hex vals, padded to MaxNumber if needed
+	BytesToHex(Bytes, Number, Hex, TRUE);
+	for (Index = 0; Index < MaxNumber; Index++) {
+		Row[Pos++] = (Index < Number) ? Hex[Index * 2] : ' ';
+		Row[Pos++] = (Index < Number) ? Hex[Index * 2 + 1] : ' ';
+		Row[Pos++] = ' ';
 	}
 	
-	DebugLog(1, "| ");
+	Row[Pos++] = '|';
+	Row[Pos++] = ' ';
 	
-	// print ASCII
+	// ASCII
 	for (Index = 0; Index < Number; Index++) {
-		if (Bytes[Index] >= 0x20 && Bytes[Index] <= 0x7e) {
-			DebugLog(1, "%c", (CHAR16)Bytes[Index]);
-		} else {
-			DebugLog(1, "%c", L'.');
-		}
+		Row[Pos++] = (Bytes[Index] >= 0x20 && Bytes[Index] <= 0x7e) ? (CHAR8)Bytes[Index] : '.';
 	}
 	
-	DebugLog(1, "\n");
+	Row[Pos++] = '\n';
+	Row[Pos] = '\0';
+	// one message per row instead of one per byte
+	DebugLog(1, "%s", Row);
 }
 
 /** Prints series of bytes. */
@@ -68,16 +78,22 @@ PrintBytes(IN void *Bytes, IN UINTN Number)
 {
 	UINTN	Index;
 	
-	for (Index = 0; Index < Number; Index += 16) {
-		PrintBytesRow((UINT8*)Bytes + Index, ((Index + 16 < Number) ? 16 : (Number - Index)), 16);
+	for (Index = 0; Index < Number; Index += PRINT_BYTES_ROW_MAX) {
+		PrintBytesRow((UINT8*)Bytes + Index, ((Index + PRINT_BYTES_ROW_MAX < Number) ? PRINT_BYTES_ROW_MAX : (Number - Index)), PRINT_BYTES_ROW_MAX);
 	}
 }
 
 static XStringW debugLogFileName;
 static EFI_FILE_PROTOCOL* gLogFile = NULL;
+// Offset in MemLogBuffer up to which the text is in the debug log file.
+static UINTN debugLogWritten = 0;
+// The file was made GlobalConfig.DebugLogPreallocate long at creation, its size is not the end of the log.
+static BOOLEAN debugLogPreallocated = FALSE;
 // Do not keep a pointer to MemLogBuffer. Because a reallocation, it could become invalid.
 
 
+INTN gDebugLogMinMode = 0;
+
 // Avoid debug looping. TO be able to call DBG from inside function that DBG calls, we need to suspend callback to avoid a loop.
 // Just instanciante this, the destructor will restore the callback.
 class SuspendMemLogCallback
@@ -157,8 +173,38 @@ static UINTN GetDebugLogFile()
       return 0;
     }
     Status = self.getCloverDir().Open(&self.getCloverDir(), &LogFile, debugLogFileName.wc_str(), EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE | EFI_FILE_MODE_CREATE, 0);
+    if ( EFI_ERROR(Status) ) {
+      return 0;
+    }
+    if ( GlobalConfig.DebugLogPreallocate > 0 ) {
+      // Allocate all the clusters now. Blank lines are left after the end of the log.
+      UINTN Size = GlobalConfig.DebugLogPreallocate;
+      CHAR8 *Blank = (CHAR8*)AllocatePool(Size);
+      if ( Blank != NULL ) {
+        SetMem(Blank, Size, '\n');
+        Status = LogFile->Write(LogFile, &Size, Blank);
+        FreePool(Blank);
+        if ( !EFI_ERROR(Status) ) Status = LogFile->SetPosition(LogFile, 0);
+        debugLogPreallocated = !EFI_ERROR(Status);
+      }
+    }
     gLogFile = LogFile;
     return 0;
+  }else if ( debugLogPreallocated ) {
+    // Start from the sector where the previous write ended
+    UINTN Start = debugLogWritten & ~(UINTN)0x1FF;
+    Status = self.getCloverDir().Open(&self.getCloverDir(), &LogFile, debugLogFileName.wc_str(), EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE, 0);
+    if ( EFI_ERROR(Status) ) {
+      return 0;
+    }
+    Status = LogFile->SetPosition(LogFile, Start);
+    if ( EFI_ERROR(Status) ) {
+      DGB_nbCallback("GetDebugLogFile() -> Cannot set log position to %lld : %s\n", Start, efiStrError(Status));
+      LogFile->Close(LogFile);
+      return 0;
+    }
+    gLogFile = LogFile;
+    return Start;
   }else{
     Status = self.getCloverDir().Open(&self.getCloverDir(), &LogFile, debugLogFileName.wc_str(), EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE, 0);
 
@@ -213,10 +259,16 @@ static UINTN GetDebugLogFile()
 //  }
 }
 
-VOID SaveMessageToDebugLogFile(IN CHAR8 *LastMessage)
+//
+// Writes the part of MemLogBuffer that is not in debug log file yet.
+//
+void flushDebugLog()
 {
   EFI_STATUS Status;
 
+  MemLogDrainAp();
+  if ( !GlobalConfig.DebugLog || GetMemLogBuffer() == NULL || GetMemLogLen() == debugLogWritten ) return;
+
   UINTN lastWrittenOffset = GetDebugLogFile();
 
   if ( gLogFile == NULL ) return;
@@ -228,6 +280,7 @@ VOID SaveMessageToDebugLogFile(IN CHAR8 *LastMessage)
 
   Status = gLogFile->Write(gLogFile, &TextLen2, lastWrittenPointer);
   lastWrittenOffset += TextLen2;
+  debugLogWritten = lastWrittenOffset;
   if ( EFI_ERROR(Status) ) {
     DGB_nbCallback("SaveMessageToDebugLogFile write error %s\n", efiStrError(Status));
     closeDebugLog();
@@ -249,6 +302,15 @@ VOID SaveMessageToDebugLogFile(IN CHAR8 *LastMessage)
   closeDebugLog();
 }
 
+VOID SaveMessageToDebugLogFile(IN CHAR8 *LastMessage)
+{
+  // In buffered mode wait for enough text. flushDebugLog() is also called at menu idle,
+  // before starting an image and at ExitBootServices.
+  if ( GlobalConfig.DebugLogBuffer > 0 && GetMemLogLen() - debugLogWritten < GlobalConfig.DebugLogBuffer ) return;
+
+  flushDebugLog();
+}
+
 void EFIAPI MemLogCallback(IN INTN DebugMode, IN CHAR8 *LastMessage)
 {
   // Print message to console
@@ -272,7 +334,7 @@ void EFIAPI DebugLog(IN INTN DebugMode, IN CONST CHAR8 *FormatString, ...)
    //UINTN offset = 0;
    
    // Make sure the buffer is intact for writing
-   if (FormatString == NULL || DebugMode < 0) {
+   if (FormatString == NULL || DebugMode < 0 || !DebugLogIsEnabled(DebugMode)) {
      return;
    }
 
@@ -292,7 +354,12 @@ EFI_STATUS SetupBooterLog(BOOLEAN AllowGrownSize)
   EFI_STATUS              Status = EFI_SUCCESS;
   CHAR8                   *MemLogBuffer;
   UINTN                   MemLogLen;
+  UINT8                   *LzssBuffer;
+  UINTN                   LzssLen;
+  const MEM_LOG_PHASE     *Phases;
+  UINTN                   PhaseCount;
   
+  MemLogDrainAp();
   MemLogBuffer = GetMemLogBuffer();
   MemLogLen = GetMemLogLen();
   
@@ -300,6 +367,21 @@ EFI_STATUS SetupBooterLog(BOOLEAN AllowGrownSize)
 		return EFI_NOT_FOUND;
   }
   
+  // Full log compressed, with the phase index, so tools can fetch a phase without the plain log.
+  // When it is there the plain boot-log is kept for older tools, but cut to MEM_LOG_INITIAL_SIZE.
+  LzssBuffer = (UINT8*)AllocatePool(MEM_LOG_INITIAL_SIZE);
+  if (LzssBuffer != NULL) {
+    LzssLen = MemLogCompress(MemLogBuffer, MemLogLen, LzssBuffer, MEM_LOG_INITIAL_SIZE);
+    if (LzssLen != 0 && !EFI_ERROR(LogDataHub(&gEfiMiscSubClassGuid, L"boot-log-lzss", LzssBuffer, (UINT32)LzssLen))) {
+      AllowGrownSize = FALSE;
+      PhaseCount = GetMemLogPhases(&Phases);
+      if (PhaseCount != 0) {
+        LogDataHub(&gEfiMiscSubClassGuid, L"boot-log-phases", Phases, (UINT32)(PhaseCount * sizeof(MEM_LOG_PHASE)));
+      }
+    }
+    FreePool(LzssBuffer);
+  }
+
   if (MemLogLen > MEM_LOG_INITIAL_SIZE && !AllowGrownSize) {
     CHAR8 PrevChar = MemLogBuffer[MEM_LOG_INITIAL_SIZE-1];
     MemLogBuffer[MEM_LOG_INITIAL_SIZE-1] = '\0';
@@ -319,6 +401,7 @@ EFI_STATUS SaveBooterLog(const EFI_FILE* BaseDir OPTIONAL, IN CONST CHAR16 *File
   CHAR8                   *MemLogBuffer;
   UINTN                   MemLogLen;
   
+  MemLogDrainAp();
   MemLogBuffer = GetMemLogBuffer();
   MemLogLen = GetMemLogLen();
   
@@ -29,6 +29,7 @@ void
 InitBooterLog (void);
 
 void closeDebugLog(void);
+void flushDebugLog(void);
 
 EFI_STATUS
 SetupBooterLog (
@@ -51,6 +52,11 @@ DebugLog (
   IN        INTN  DebugMode,
   IN  CONST CHAR8 *FormatString, ...) __attribute__((format(printf, 2, 3)));
 
+// Messages with a DebugMode below this are dropped before they are formatted. Boot/DebugLevel, 0 keeps everything.
+extern INTN gDebugLogMinMode;
+// For DBG macros : test it before the call, so the arguments aren't even evaluated.
+#define DebugLogIsEnabled(DebugMode) ((DebugMode) >= gDebugLogMinMode)
+
 
 /** Prints series of bytes. */
 void
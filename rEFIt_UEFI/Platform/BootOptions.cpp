@@ -680,6 +680,282 @@ CompileBootOption (
 }
 
 
+//
+// Index of the BootXXXX vars : one GetNextVariableName sweep reads and parses them all, then the
+// lookups below are served from memory. AddBootOption() and DeleteBootOption() keep it in sync.
+// The NVRAM snapshot only holds the Apple GUIDs, so the index does its own sweep of the global GUID.
+// PathHash covers what DevicePathEqual() compares, most options are rejected without a node walk.
+// EmuVariable swaps the variable services in and out, the index belongs to the services it was read with.
+//
+typedef struct {
+  BO_BOOT_OPTION  Option;     // Option.Variable belongs to the index
+  EFI_STATUS      Status;     // ParseBootOption() result, the number is taken anyway
+  UINT32          PathHash;
+} BO_INDEX_ENTRY;
+
+static BO_INDEX_ENTRY   *BoIndexEntries = NULL;
+static UINTN             BoIndexCount = 0;
+static UINTN             BoIndexCapacity = 0;
+static BOOLEAN           BoIndexValid = FALSE;
+static BOOLEAN           BoIndexTried = FALSE;
+static EFI_GET_VARIABLE  BoIndexService = NULL;
+
+/** FNV-1a hash of a device path of at most Size bytes. File path nodes are hashed case insensitive
+ *  and without the leading \ char, as DevicePathEqual() compares them.
+ */
+static UINT32
+BootOptionPathHash (
+    IN  CONST EFI_DEVICE_PATH_PROTOCOL *DevicePath,
+    IN  UINTN                          Size
+    )
+{
+  UINT32              Hash = 2166136261u;
+  CONST UINT8         *Node = (CONST UINT8*)DevicePath;
+  CONST UINT8         *End = Node + Size;
+  CONST CHAR16        *Path;
+  UINTN               PathLen;
+  UINTN               Len;
+  UINTN               Index;
+  CHAR16              Chr;
+
+  while (Node + sizeof(EFI_DEVICE_PATH_PROTOCOL) <= End) {
+    Len = DevicePathNodeLength (Node);
+    if (Len < sizeof(EFI_DEVICE_PATH_PROTOCOL) || Len > (UINTN)(End - Node)) {
+      break;
+    }
+    // type, subtype and length
+    for (Index = 0; Index < sizeof(EFI_DEVICE_PATH_PROTOCOL); Index++) {
+      Hash = (Hash ^ Node[Index]) * 16777619u;
+    }
+    if (IsDevicePathEnd (Node)) {
+      break;
+    }
+    if (DevicePathType (Node) == MEDIA_DEVICE_PATH && DevicePathSubType (Node) == MEDIA_FILEPATH_DP) {
+      Path = &((CONST FILEPATH_DEVICE_PATH *)Node)->PathName[0];
+      PathLen = (Len - sizeof(EFI_DEVICE_PATH_PROTOCOL)) / sizeof(CHAR16);
+      Index = (PathLen > 0 && Path[0] == L'\\') ? 1 : 0;
+      for (; Index < PathLen && Path[Index] != L'\0'; Index++) {
+        Chr = Path[Index];
+        if (Chr >= L'a' && Chr <= L'z') {
+          Chr -= (L'a' - L'A');
+        }
+        Hash = (Hash ^ (UINT8)Chr) * 16777619u;
+        Hash = (Hash ^ (UINT8)(Chr >> 8)) * 16777619u;
+      }
+    } else {
+      for (Index = sizeof(EFI_DEVICE_PATH_PROTOCOL); Index < Len; Index++) {
+        Hash = (Hash ^ Node[Index]) * 16777619u;
+      }
+    }
+    Node += Len;
+  }
+  return Hash;
+}
+
+static void
+BootOptionIndexFree (void)
+{
+  UINTN               Index;
+
+  for (Index = 0; Index < BoIndexCount; Index++) {
+    FreePool(BoIndexEntries[Index].Option.Variable);
+  }
+  if (BoIndexEntries != NULL) {
+    FreePool(BoIndexEntries);
+    BoIndexEntries = NULL;
+  }
+  BoIndexCount = 0;
+  BoIndexCapacity = 0;
+  BoIndexValid = FALSE;
+}
+
+static BO_INDEX_ENTRY *
+BootOptionIndexFind (
+    IN  UINT16          BootNum
+    )
+{
+  UINTN               Index;
+
+  for (Index = 0; Index < BoIndexCount; Index++) {
+    if (BoIndexEntries[Index].Option.BootNum == BootNum) {
+      return &BoIndexEntries[Index];
+    }
+  }
+  return NULL;
+}
+
+/** Replaces or adds BootXXXX with a copy of Variable. FALSE if out of memory. */
+static BOOLEAN
+BootOptionIndexStore (
+    IN  UINT16          BootNum,
+    IN  CONST void      *Variable,
+    IN  UINTN           VariableSize
+    )
+{
+  BO_INDEX_ENTRY      *Entry;
+  BO_INDEX_ENTRY      *NewEntries;
+  void                *NewVariable;
+  UINTN               NewCapacity;
+
+  NewVariable = AllocateCopyPool(VariableSize, Variable);
+  if (NewVariable == NULL) {
+    return FALSE;
+  }
+  Entry = BootOptionIndexFind (BootNum);
+  if (Entry == NULL) {
+    if (BoIndexCount == BoIndexCapacity) {
+      NewCapacity = (BoIndexCapacity == 0) ? 32 : BoIndexCapacity * 2;
+      NewEntries = (BO_INDEX_ENTRY*)ReallocatePool(BoIndexCapacity * sizeof(BO_INDEX_ENTRY),
+                                                   NewCapacity * sizeof(BO_INDEX_ENTRY), BoIndexEntries);
+      if (NewEntries == NULL) {
+        FreePool(NewVariable);
+        return FALSE;
+      }
+      BoIndexEntries = NewEntries;
+      BoIndexCapacity = NewCapacity;
+    }
+    Entry = &BoIndexEntries[BoIndexCount++];
+  } else {
+    FreePool(Entry->Option.Variable);
+  }
+  ZeroMem(Entry, sizeof(*Entry));
+  Entry->Option.BootNum = BootNum;
+  Entry->Option.Variable = NewVariable;
+  Entry->Option.VariableSize = VariableSize;
+  Entry->Status = ParseBootOption (&Entry->Option);
+  if (!EFI_ERROR(Entry->Status)) {
+    Entry->PathHash = BootOptionPathHash (Entry->Option.FilePathList, Entry->Option.FilePathListLength);
+  }
+  return TRUE;
+}
+
+static void
+BootOptionIndexRemove (
+    IN  UINT16          BootNum
+    )
+{
+  BO_INDEX_ENTRY      *Entry = BootOptionIndexFind (BootNum);
+
+  if (Entry != NULL) {
+    FreePool(Entry->Option.Variable);
+    *Entry = BoIndexEntries[--BoIndexCount];
+  }
+}
+
+/** TRUE if Name is BootXXXX, XXXX being 4 upper case hex digits. */
+static BOOLEAN
+IsBootOptionName (
+    IN  CONST CHAR16    *Name,
+    OUT UINT16          *BootNum
+    )
+{
+  UINTN               Index;
+  UINT16              Num = 0;
+  CHAR16              Chr;
+
+  if (StrnCmp(Name, L"Boot", 4) != 0 || StrLen(Name) != 8) {
+    return FALSE;
+  }
+  for (Index = 4; Index < 8; Index++) {
+    Chr = Name[Index];
+    if (Chr >= L'0' && Chr <= L'9') {
+      Num = (UINT16)((Num << 4) | (Chr - L'0'));
+    } else if (Chr >= L'A' && Chr <= L'F') {
+      Num = (UINT16)((Num << 4) | (Chr - L'A' + 10));
+    } else {
+      return FALSE;
+    }
+  }
+  *BootNum = Num;
+  return TRUE;
+}
+
+static void
+BootOptionIndexBuild (void)
+{
+  EFI_STATUS          Status;
+  EFI_GUID            Guid;
+  CHAR16              *Name;
+  UINTN               NameSize = 64 * sizeof(CHAR16);
+  UINTN               NewNameSize;
+  UINT8               *Data = NULL;
+  UINTN               DataCapacity = 0;
+  UINTN               DataSize;
+  UINT16              BootNum;
+
+  BootOptionIndexFree ();
+  BoIndexTried = TRUE;
+  BoIndexService = gRT->GetVariable;
+  Name = (CHAR16*)AllocateZeroPool(NameSize);
+  if (Name == NULL) {
+    return;
+  }
+  ZeroMem(&Guid, sizeof(Guid));
+
+  while (TRUE) {
+    NewNameSize = NameSize;
+    Status = gRT->GetNextVariableName (&NewNameSize, Name, &Guid);
+    if (Status == EFI_BUFFER_TOO_SMALL) {
+      Name = (CHAR16*)ReallocatePool(NameSize, NewNameSize, Name);
+      if (Name == NULL) {
+        break;
+      }
+      NameSize = NewNameSize;
+      Status = gRT->GetNextVariableName (&NewNameSize, Name, &Guid);
+    }
+    if (Status == EFI_NOT_FOUND) {
+      BoIndexValid = TRUE;
+      break;
+    }
+    if (EFI_ERROR(Status)) {
+      break;
+    }
+    if (!CompareGuid(&Guid, &gEfiGlobalVariableGuid) || !IsBootOptionName (Name, &BootNum)) {
+      continue;
+    }
+    DataSize = DataCapacity;
+    Status = gRT->GetVariable (Name, &Guid, NULL, &DataSize, Data);
+    if (Status == EFI_BUFFER_TOO_SMALL) {
+      Data = (UINT8*)ReallocatePool(DataCapacity, DataSize, Data);
+      if (Data == NULL) {
+        break;
+      }
+      DataCapacity = DataSize;
+      Status = gRT->GetVariable (Name, &Guid, NULL, &DataSize, Data);
+    }
+    if (EFI_ERROR(Status) || !BootOptionIndexStore (BootNum, Data, DataSize)) {
+      break;
+    }
+  }
+
+  if (Name != NULL) {
+    FreePool(Name);
+  }
+  if (Data != NULL) {
+    FreePool(Data);
+  }
+  if (!BoIndexValid) {
+    // the lookups go to the firmware
+    BootOptionIndexFree ();
+  }
+  DBG("Boot options index: %s, %llu options\n", BoIndexValid ? "ok" : "failed", BoIndexCount);
+}
+
+/** TRUE if the lookups can be served from the index, built at the first call. */
+static BOOLEAN
+BootOptionIndexReady (void)
+{
+  if (BoIndexTried && BoIndexService != gRT->GetVariable) {
+    BootOptionIndexFree ();
+    BoIndexTried = FALSE;
+  }
+  if (!BoIndexTried) {
+    BootOptionIndexBuild ();
+  }
+  return BoIndexValid;
+}
+
+
 /** Reads BootXXXX (XXXX = BootNum) var, parses it and returns in BootOption.
  *  Caller is responsible for releasing BootOption->Variable with FreePool().
  */
@@ -690,11 +966,25 @@ GetBootOption (
     )
 {
   CHAR16              VarName[16];
+  BO_INDEX_ENTRY      *Entry;
 
   //
   // Get BootXXXX var.
   //
   BootOption->BootNum = BootNum;
+  if (BootOptionIndexReady ()) {
+    Entry = BootOptionIndexFind (BootNum);
+    if (Entry == NULL) {
+      BootOption->Variable = NULL;
+      return EFI_NOT_FOUND;
+    }
+    BootOption->VariableSize = Entry->Option.VariableSize;
+    BootOption->Variable = AllocateCopyPool(Entry->Option.VariableSize, Entry->Option.Variable);
+    if (BootOption->Variable == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+    return ParseBootOption (BootOption);
+  }
 	snwprintf(VarName, sizeof(VarName), "Boot%04hX", BootNum);
 
   BootOption->Variable = (__typeof__(BootOption->Variable))GetNvramVariable(VarName, &gEfiGlobalVariableGuid, NULL, (UINTN *)(UINTN)(OFFSET_OF(BO_BOOT_OPTION, VariableSize) + (UINTN)BootOption));
@@ -721,6 +1011,17 @@ FindFreeBootNum (
   UINTN               VarSize;
 
 
+  if (BootOptionIndexReady ()) {
+    // BoIndexCount numbers are taken, the lowest free one is at most BoIndexCount
+    for (Index = 0; Index <= BoIndexCount && Index <= 0xFFFF; Index++) {
+      if (BootOptionIndexFind ((UINT16)Index) == NULL) {
+        *BootNum = (UINT16)Index;
+        return EFI_SUCCESS;
+      }
+    }
+    return EFI_NOT_FOUND;
+  }
+
   for (Index = 0; Index <= 0xFFFF; Index++) {
 	  snwprintf(VarName, sizeof(VarName), "Boot%04llX", Index);
     VarSize = 0;
@@ -735,6 +1036,48 @@ FindFreeBootNum (
 }
 
 
+/** Returns parsed BootXXXX and the hash of its device path, from the index or,
+ *  without one, read from the firmware into Read. Caller is responsible for releasing
+ *  Read->Variable with FreePool() if not NULL.
+ */
+static EFI_STATUS
+LookupBootOption (
+    IN      UINT16          BootNum,
+    IN OUT  BO_BOOT_OPTION  *Read,
+    OUT     BO_BOOT_OPTION  **BootOption,
+    OUT     UINT32          *PathHash
+    )
+{
+  EFI_STATUS          Status;
+  BO_INDEX_ENTRY      *Entry;
+
+  if (BootOptionIndexReady ()) {
+    Entry = BootOptionIndexFind (BootNum);
+    if (Entry == NULL) {
+      return EFI_NOT_FOUND;
+    }
+    if (EFI_ERROR(Entry->Status)) {
+      return Entry->Status;
+    }
+    *BootOption = &Entry->Option;
+    *PathHash = Entry->PathHash;
+    return EFI_SUCCESS;
+  }
+
+  if (Read->Variable != NULL) {
+    FreePool(Read->Variable);
+    Read->Variable = NULL;
+  }
+  Status = GetBootOption (BootNum, Read);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+  *BootOption = Read;
+  *PathHash = BootOptionPathHash (Read->FilePathList, Read->FilePathListLength);
+  return EFI_SUCCESS;
+}
+
+
 /** Searches BootXXXX vars for entry that points to given FileDeviceHandle/FileName
  *  and returns BootNum (XXXX in BootXXXX variable name) and BootIndex (index in BootOrder)
  *  if found.
@@ -751,9 +1094,12 @@ FindBootOptionForFile (
   UINT16              *BootOrder;
   UINTN               BootOrderLen;
   UINTN               Index;
-  BO_BOOT_OPTION      BootOption;
+  BO_BOOT_OPTION      ReadOption;
+  BO_BOOT_OPTION      *BootOption;
+  UINT32              PathHash;
   EFI_DEVICE_PATH_PROTOCOL    *SearchedDevicePath[2];
   UINTN               SearchedDevicePathSize[2];
+  UINT32              SearchedPathHash[2];
 
 
   DBG("FindBootOptionForFile: %llx, %ls\n", (uintptr_t)FileDeviceHandle, FileName.wc_str());
@@ -782,30 +1128,28 @@ FindBootOptionForFile (
   }
   SearchedDevicePathSize[1] = GetDevicePathSize (SearchedDevicePath[1]);
 	DBG(" and for: %ls (Len: %llu)\n", FileDevicePathToXStringW(SearchedDevicePath[1]).wc_str(), SearchedDevicePathSize[1]);
+  SearchedPathHash[0] = BootOptionPathHash (SearchedDevicePath[0], SearchedDevicePathSize[0]);
+  SearchedPathHash[1] = BootOptionPathHash (SearchedDevicePath[1], SearchedDevicePathSize[1]);
 
   //
   // Iterate over all BootXXXX vars (actually, only ones that are in BootOrder list)
   //
-  BootOption.Variable = NULL;
+  ReadOption.Variable = NULL;
   for (Index = 0; Index < BootOrderLen; Index++) {
-    if (BootOption.Variable != NULL) {
-      FreePool(BootOption.Variable);
-      BootOption.Variable = NULL;
-    }
     //
     // Get boot option
     //
-    Status = GetBootOption (BootOrder[Index], &BootOption);
+    Status = LookupBootOption (BootOrder[Index], &ReadOption, &BootOption, &PathHash);
     if (EFI_ERROR(Status)) {
 		DBG("FindBootOptionForFile: Boot%04hX: %s\n", BootOrder[Index], efiStrError(Status));
       //WaitForKeyPress(L"press a key to continue\n\n");
       continue;
     }
 
-    //PrintBootOption (&BootOption, Index);
+    //PrintBootOption (BootOption, Index);
 
-    if (DevicePathEqual (SearchedDevicePath[0], BootOption.FilePathList) ||
-        DevicePathEqual (SearchedDevicePath[1], BootOption.FilePathList)) {
+    if ((PathHash == SearchedPathHash[0] && DevicePathEqual (SearchedDevicePath[0], BootOption->FilePathList)) ||
+        (PathHash == SearchedPathHash[1] && DevicePathEqual (SearchedDevicePath[1], BootOption->FilePathList))) {
 		DBG("FindBootOptionForFile: Found Boot%04hX, at index %llu\n", BootOrder[Index], Index);
       if (BootNum != NULL) {
         *BootNum = BootOrder[Index];
@@ -813,15 +1157,17 @@ FindBootOptionForFile (
       if (BootIndex != NULL) {
         *BootIndex = Index;
       }
-      FreePool(BootOption.Variable);
+      if (ReadOption.Variable != NULL) {
+        FreePool(ReadOption.Variable);
+      }
       //WaitForKeyPress(L"press a key to continue\n\n");
       return EFI_SUCCESS;
     }
     //WaitForKeyPress(L"press a key to continue\n\n");
   }
 
-  if (BootOption.Variable != NULL) {
-    FreePool(BootOption.Variable);
+  if (ReadOption.Variable != NULL) {
+    FreePool(ReadOption.Variable);
   }
 
   DBG("FindBootOptionForFile: Not found.\n");
@@ -840,6 +1186,8 @@ PrintBootOptions (
   UINTN               Index;
   UINTN               BootNum;
   BO_BOOT_OPTION      BootOption;
+  BO_BOOT_OPTION      *IndexedOption;
+  UINT32              PathHash;
   BOOLEAN             FoundOthers;
 
 
@@ -861,13 +1209,15 @@ PrintBootOptions (
     //
     // Get boot option
     //
-    Status = GetBootOption (BootOrder[Index], &BootOption);
+    Status = LookupBootOption (BootOrder[Index], &BootOption, &IndexedOption, &PathHash);
     if (EFI_ERROR(Status)) {
 		DBG("%2llu) Boot%04hX: ERROR, not found: %s\n", Index, BootOrder[Index], efiStrError(Status));
       continue;
     }
 
-    PrintBootOption (&BootOption, Index);
+    PrintBootOption (IndexedOption, Index);
+  }
+  if (BootOption.Variable != NULL) {
     FreePool(BootOption.Variable);
   }
 
@@ -875,10 +1225,14 @@ PrintBootOptions (
     DBG("\nBoot options not in BootOrder list:\n");
     FoundOthers = FALSE;
     //
-    // Additionally print BootXXXX vars which are not in BootOrder
+    // Additionally print BootXXXX vars which are not in BootOrder,
+    // only the indexed numbers are tried when there's an index
     //
     BootOption.Variable = NULL;
     for (BootNum = 0; BootNum <= 0xFFFF; BootNum++) {
+      if (BootOptionIndexReady () && BootOptionIndexFind ((UINT16)BootNum) == NULL) {
+        continue;
+      }
       //
       // Check if it is in BootOrder
       //
@@ -895,15 +1249,17 @@ PrintBootOptions (
       //
       // Get boot option
       //
-      Status = GetBootOption ((UINT16)BootNum, &BootOption);
+      Status = LookupBootOption ((UINT16)BootNum, &BootOption, &IndexedOption, &PathHash);
       if (EFI_ERROR(Status)) {
         continue;
       }
 
-      PrintBootOption (&BootOption, 0);
-      FreePool(BootOption.Variable);
+      PrintBootOption (IndexedOption, 0);
       FoundOthers = TRUE;
     }
+    if (BootOption.Variable != NULL) {
+      FreePool(BootOption.Variable);
+    }
     if (!FoundOthers) {
       DBG(" not found\n");
     }
@@ -971,6 +1327,10 @@ AddBootOption (
     return Status;
   }
   DBG(" %ls saved\n", VarName);
+  if (BoIndexValid && !BootOptionIndexStore (BootOption->BootNum, BootOption->Variable, BootOption->VariableSize)) {
+    // out of sync, the lookups go to the firmware from now on
+    BootOptionIndexFree ();
+  }
 
   //
   // Free allocated space
@@ -1086,6 +1446,7 @@ DeleteBootOption (
     return Status;
   }
   DBG(" %ls deleted\n", VarName);
+  BootOptionIndexRemove (BootNum);
 
   //
   // Update BootOrder - delete our boot option from the list
@@ -1136,7 +1497,9 @@ DeleteBootOptionsContainingFile (
   UINT16              *BootOrder;
   UINTN               BootOrderLen;
   UINTN               Index;
-  BO_BOOT_OPTION      BootOption;
+  BO_BOOT_OPTION      ReadOption;
+  BO_BOOT_OPTION      *BootOption;
+  UINT32              PathHash;
   FILEPATH_DEVICE_PATH    *FilePathDP;
 
 
@@ -1155,25 +1518,21 @@ DeleteBootOptionsContainingFile (
   //
   // Iterate over all BootXXXX vars (actually, only ones that are in BootOrder list)
   //
-  BootOption.Variable = NULL;
+  ReadOption.Variable = NULL;
   for (Index = 0; Index < BootOrderLen; Index++) {
-    if (BootOption.Variable != NULL) {
-      FreePool(BootOption.Variable);
-      BootOption.Variable = NULL;
-    }
     //
     // Get boot option
     //
-    Status = GetBootOption (BootOrder[Index], &BootOption);
+    Status = LookupBootOption (BootOrder[Index], &ReadOption, &BootOption, &PathHash);
     if (EFI_ERROR(Status)) {
 		DBG("DeleteBootOptionContainingFile: Boot%04hX: ERROR: %s\n", BootOrder[Index], efiStrError(Status));
       //WaitForKeyPress(L"press a key to continue\n\n");
       continue;
     }
 
-    //PrintBootOption (&BootOption, Index);
+    //PrintBootOption (BootOption, Index);
 
-    FilePathDP = (FILEPATH_DEVICE_PATH*) Clover_FindDevicePathNodeWithType (BootOption.FilePathList, MEDIA_DEVICE_PATH, MEDIA_FILEPATH_DP);
+    FilePathDP = (FILEPATH_DEVICE_PATH*) Clover_FindDevicePathNodeWithType (BootOption->FilePathList, MEDIA_DEVICE_PATH, MEDIA_FILEPATH_DP);
 
     if ((FilePathDP != NULL) &&
         (StriStr (FilePathDP->PathName, FileName) != NULL)) {
@@ -1185,8 +1544,8 @@ DeleteBootOptionsContainingFile (
     }
   }
 
-  if (BootOption.Variable != NULL) {
-    FreePool(BootOption.Variable);
+  if (ReadOption.Variable != NULL) {
+    FreePool(ReadOption.Variable);
   }
 
   DBG("DeleteBootOptionContainingFile: %s\n", efiStrError(ReturnStatus));
@@ -0,0 +1,111 @@
+/*
+ * BootTimeline.cpp
+ *
+ * Boot phases timed with the TSC.
+ */
+
+#include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+#include "BootTimeline.h"
+#include "cpu.h"
+#include "../libeg/libeg.h"
+#include "../refit/lib.h"
+
+#define TIMELINE_MAX_SPANS  256
+#define TIMELINE_MAX_DEPTH  16
+#define TIMELINE_FILE       L"misc\\boot-timeline.json"
+
+typedef struct {
+  const char *Name;
+  UINT64      Start;
+  UINT64      End;   // 0 while open
+  UINT8       Depth;
+} TIMELINE_SPAN;
+
+static TIMELINE_SPAN  Spans[TIMELINE_MAX_SPANS];
+static UINTN          SpanCount = 0;
+static UINTN          Open[TIMELINE_MAX_DEPTH];
+static UINTN          Depth = 0;
+static UINTN          Dropped = 0; // TimelineBegin() calls without room, their TimelineEnd() must be ignored too
+static BOOLEAN        Reported = FALSE;
+static UINT64         Origin = 0;
+static const char     Spaces[TIMELINE_MAX_DEPTH * 2 + 1] = "                                "; // 2 per depth
+
+static UINT64 TicksToUs(UINT64 Ticks)
+{
+  if (gCPUStructure.TSCFrequency == 0) {
+    return 0;
+  }
+  return DivU64x64Remainder(MultU64x32(Ticks, 1000000), gCPUStructure.TSCFrequency, NULL);
+}
+
+void TimelineBegin(const char* Name)
+{
+  UINT64 Now = AsmReadTsc();
+  if (SpanCount == 0) {
+    Origin = Now;
+  }
+  if (Dropped > 0 || Depth >= TIMELINE_MAX_DEPTH || SpanCount >= TIMELINE_MAX_SPANS) {
+    Dropped++;
+    return;
+  }
+  Spans[SpanCount].Name = Name;
+  Spans[SpanCount].Start = Now;
+  Spans[SpanCount].End = 0;
+  Spans[SpanCount].Depth = (UINT8)Depth;
+  Open[Depth++] = SpanCount++;
+}
+
+void TimelineEnd(void)
+{
+  UINT64 Now = AsmReadTsc();
+  if (Dropped > 0) {
+    Dropped--;
+    return;
+  }
+  if (Depth == 0) {
+    return;
+  }
+  TIMELINE_SPAN& Span = Spans[Open[--Depth]];
+  Span.End = Now;
+  if (Reported) {
+    MsgLog("Timeline: %s %llu us\n", Span.Name, TicksToUs(Span.End - Span.Start));
+  }
+}
+
+void TimelineReport(const EFI_FILE* BaseDir)
+{
+  UINT64 Now = AsmReadTsc();
+  XString8 Json;
+
+  Reported = TRUE;
+  if (SpanCount == 0) {
+    return;
+  }
+  DbgHeader("BootTimeline");
+  MsgLog("   start ms    duration ms  phase\n");
+  Json.reserve(SpanCount * 80 + 32);
+  Json += "{\"traceEvents\":[\n";
+  for (UINTN Index = 0; Index < SpanCount; Index++) {
+    const TIMELINE_SPAN& Span = Spans[Index];
+    // a span still open is reported up to now, it is what the boot cost so far
+    UINT64 StartUs = TicksToUs(Span.Start - Origin);
+    UINT64 DurationUs = TicksToUs((Span.End != 0 ? Span.End : Now) - Span.Start);
+    const char* Indent = Spaces + sizeof(Spaces) - 1 - Span.Depth * 2;
+    MsgLog("%8llu.%03llu %10llu.%03llu  %s%s%s\n", StartUs / 1000, StartUs % 1000, DurationUs / 1000, DurationUs % 1000,
+           Indent, Span.Name, Span.End != 0 ? "" : " (open)");
+    Json.S8Catf("%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%llu,\"pid\":1,\"tid\":1}",
+                Index > 0 ? ",\n" : "", Span.Name, StartUs, DurationUs);
+  }
+  Json += "\n]}\n";
+  if (gCPUStructure.TSCFrequency == 0) {
+    MsgLog("Timeline: TSC frequency unknown, times are 0\n");
+  }
+  if (Dropped > 0) {
+    MsgLog("Timeline: %llu spans not recorded, more than %d or nested deeper than %d\n", (UINT64)Dropped, TIMELINE_MAX_SPANS, TIMELINE_MAX_DEPTH);
+  }
+
+  EFI_STATUS Status = egSaveFile(BaseDir, TIMELINE_FILE, (const UINT8*)Json.c_str(), Json.length());
+  if (EFI_ERROR(Status)) {
+    MsgLog("Timeline: can't save %ls : %s\n", TIMELINE_FILE, efiStrError(Status));
+  }
+}
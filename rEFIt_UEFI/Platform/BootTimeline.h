@@ -0,0 +1,31 @@
+/*
+ * Boot timeline : TSC timestamps of the boot phases.
+ * TimelineReport() logs a table of the phases and saves misc\boot-timeline.json,
+ * to open in chrome://tracing or https://ui.perfetto.dev.
+ * BSP only, the spans are kept in a static array, no allocation.
+ */
+
+#ifndef __BOOTTIMELINE_H__
+#define __BOOTTIMELINE_H__
+
+#include <Protocol/SimpleFileSystem.h> // for EFI_FILE*
+
+// Spans nest : TimelineEnd() closes the last opened span. Name must be a literal, it is kept as is.
+void TimelineBegin(const char* Name);
+void TimelineEnd(void);
+
+// Log the table of the spans and save the trace in BaseDir\misc. Spans ended after are logged one by one.
+void TimelineReport(const EFI_FILE* BaseDir OPTIONAL);
+
+// Span for the scope of a function
+class TimelineSpan
+{
+public:
+  TimelineSpan(const char* Name) { TimelineBegin(Name); }
+  ~TimelineSpan() { TimelineEnd(); }
+
+  TimelineSpan(const TimelineSpan&) = delete;
+  TimelineSpan& operator=(const TimelineSpan&) = delete;
+};
+
+#endif
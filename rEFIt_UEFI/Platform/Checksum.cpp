@@ -0,0 +1,203 @@
+/*
+ * Checksum.cpp
+ *
+ * Both loops read 8 bytes at a time once the pointer is aligned.
+ * Checksum8() adds the even and the odd bytes of each word in 16 bits lanes, the lanes are
+ * folded every 128 words, before they can overflow.
+ * GetCrc32() is the slicing-by-8 CRC32, 8 tables of 256 entries built at the first call.
+ * Adler32() takes the modulo once per ADLER32_NMAX bytes, like zlib. The SSSE3 path sums 16 bytes
+ * at once: psadbw for s1, pmaddubsw with the weights 16..1 for s2.
+ */
+
+#include "Checksum.h"
+
+#define CRC32_POLYNOMIAL      0xEDB88320U
+#define CHECKSUM8_LANES_MASK  0x00FF00FF00FF00FFULL
+#define ADLER32_BASE          65521U
+#define ADLER32_NMAX          5552U  // largest n such that 255n(n+1)/2 + (n+1)(BASE-1) <= 2^32-1, a multiple of 16
+
+static UINT32  Crc32Table[8][256];
+static BOOLEAN Crc32TableReady = FALSE;
+
+static UINT8 FoldLanes(UINT64 Lanes)
+{
+  return (UINT8)((Lanes & 0xFFFF) + ((Lanes >> 16) & 0xFFFF) + ((Lanes >> 32) & 0xFFFF) + (Lanes >> 48));
+}
+
+UINT8 Checksum8(const void *Buffer, UINTN Length)
+{
+  const UINT8  *Ptr = (const UINT8*)Buffer;
+  const UINT64 *Word;
+  UINT64 Lanes;
+  UINT64 Value;
+  UINTN  Count;
+  UINT8  Sum = 0;
+
+  while (Length > 0 && ((UINTN)Ptr & 7) != 0) {
+    Sum += *Ptr++;
+    Length--;
+  }
+  Word = (const UINT64*)Ptr;
+  while (Length >= 8) {
+    Count = Length / 8;
+    if (Count > 128) {
+      Count = 128;
+    }
+    Length -= Count * 8;
+    Lanes = 0;
+    while (Count--) {
+      Value = *Word++;
+      Lanes += (Value & CHECKSUM8_LANES_MASK) + ((Value >> 8) & CHECKSUM8_LANES_MASK);
+    }
+    Sum += FoldLanes(Lanes);
+  }
+  Ptr = (const UINT8*)Word;
+  while (Length--) {
+    Sum += *Ptr++;
+  }
+  return Sum;
+}
+
+static void BuildCrc32Table()
+{
+  UINT32 Crc;
+  UINTN  i, j;
+
+  for (i = 0; i < 256; i++) {
+    Crc = (UINT32)i;
+    for (j = 0; j < 8; j++) {
+      Crc = (Crc >> 1) ^ ((Crc & 1) ? CRC32_POLYNOMIAL : 0);
+    }
+    Crc32Table[0][i] = Crc;
+  }
+  for (i = 0; i < 256; i++) {
+    for (j = 1; j < 8; j++) {
+      Crc32Table[j][i] = (Crc32Table[j - 1][i] >> 8) ^ Crc32Table[0][Crc32Table[j - 1][i] & 0xFF];
+    }
+  }
+  Crc32TableReady = TRUE;
+}
+
+UINT32 GetCrc32(const void *Buffer, UINTN Size)
+{
+  const UINT8  *Ptr = (const UINT8*)Buffer;
+  const UINT32 *Word;
+  UINT32 Crc = 0xFFFFFFFFU;
+  UINT32 Low, High;
+
+  if (!Buffer) {
+    return 0;
+  }
+  if (!Crc32TableReady) {
+    BuildCrc32Table();
+  }
+  while (Size > 0 && ((UINTN)Ptr & 7) != 0) {
+    Crc = (Crc >> 8) ^ Crc32Table[0][(Crc ^ *Ptr++) & 0xFF];
+    Size--;
+  }
+  // x86 and the little endian ARM only
+  Word = (const UINT32*)Ptr;
+  while (Size >= 8) {
+    Low = *Word++ ^ Crc;
+    High = *Word++;
+    Crc = Crc32Table[7][Low & 0xFF] ^ Crc32Table[6][(Low >> 8) & 0xFF] ^
+          Crc32Table[5][(Low >> 16) & 0xFF] ^ Crc32Table[4][Low >> 24] ^
+          Crc32Table[3][High & 0xFF] ^ Crc32Table[2][(High >> 8) & 0xFF] ^
+          Crc32Table[1][(High >> 16) & 0xFF] ^ Crc32Table[0][High >> 24];
+    Size -= 8;
+  }
+  Ptr = (const UINT8*)Word;
+  while (Size--) {
+    Crc = (Crc >> 8) ^ Crc32Table[0][(Crc ^ *Ptr++) & 0xFF];
+  }
+  return ~Crc;
+}
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define ADLER32_SSSE3 1
+// GCC and clang vector extensions and builtins, as in b64cdecode.cpp
+typedef char      ADLER_V16 __attribute__((vector_size(16)));
+typedef short     ADLER_V8S __attribute__((vector_size(16)));
+typedef int       ADLER_V4S __attribute__((vector_size(16)));
+typedef long long ADLER_V2D __attribute__((vector_size(16)));
+typedef char      ADLER_V16_UNALIGNED __attribute__((vector_size(16), aligned(1)));
+#else
+#define ADLER32_SSSE3 0
+#endif
+
+static BOOLEAN Adler32Simd = FALSE;
+
+void Adler32SetSimd(BOOLEAN Enable)
+{
+  Adler32Simd = Enable && ADLER32_SSSE3;
+}
+
+BOOLEAN Adler32GetSimd(void)
+{
+  return Adler32Simd;
+}
+
+#if ADLER32_SSSE3 == 1
+// Blocks * 16 bytes, at most ADLER32_NMAX, *S1 and *S2 not reduced
+__attribute__((target("ssse3")))
+static void Adler32BlocksSsse3(const UINT8 *Ptr, UINTN Blocks, UINT32 *S1, UINT32 *S2)
+{
+  const ADLER_V16 Weights = { 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1 };
+  const ADLER_V8S Ones = { 1, 1, 1, 1, 1, 1, 1, 1 };
+  const ADLER_V16 Zero = { 0 };
+  ADLER_V4S Sum1 = { 0 };    // bytes of the blocks so far
+  ADLER_V4S Prefix = { 0 };  // Sum1 before each block, counts 16 times in s2
+  ADLER_V4S Sum2 = { 0 };    // bytes weighted by their distance to the end of their block
+  ADLER_V16 Bytes;
+  UINTN     n = Blocks;
+
+  while (n--) {
+    Bytes = *(const ADLER_V16_UNALIGNED *)Ptr;
+    Ptr += 16;
+    Prefix += Sum1;
+    Sum1 += (ADLER_V4S)__builtin_ia32_psadbw128(Bytes, Zero);
+    Sum2 += __builtin_ia32_pmaddwd128(__builtin_ia32_pmaddubsw128(Bytes, Weights), Ones);
+  }
+  *S2 += (UINT32)(Blocks * 16 * *S1) + 16 * (UINT32)(Prefix[0] + Prefix[1] + Prefix[2] + Prefix[3]) +
+         (UINT32)(Sum2[0] + Sum2[1] + Sum2[2] + Sum2[3]);
+  *S1 += (UINT32)(Sum1[0] + Sum1[2]);
+}
+#endif
+
+UINT32 Adler32(UINT32 Adler, const void *Buffer, UINTN Length)
+{
+  const UINT8 *Ptr = (const UINT8*)Buffer;
+  UINT32 S1 = Adler & 0xFFFF;
+  UINT32 S2 = Adler >> 16;
+  UINTN  Count;
+
+  if (!Buffer) {
+    return 1;
+  }
+  while (Length > 0) {
+    Count = (Length < ADLER32_NMAX) ? Length : ADLER32_NMAX;
+    Length -= Count;
+#if ADLER32_SSSE3 == 1
+    if (Adler32Simd && Count >= 16) {
+      Adler32BlocksSsse3(Ptr, Count / 16, &S1, &S2);
+      Ptr += Count & ~(UINTN)15;
+      Count &= 15;
+    }
+#endif
+    while (Count >= 4) {
+      S1 += Ptr[0]; S2 += S1;
+      S1 += Ptr[1]; S2 += S1;
+      S1 += Ptr[2]; S2 += S1;
+      S1 += Ptr[3]; S2 += S1;
+      Ptr += 4;
+      Count -= 4;
+    }
+    while (Count--) {
+      S1 += *Ptr++;
+      S2 += S1;
+    }
+    S1 %= ADLER32_BASE;
+    S2 %= ADLER32_BASE;
+  }
+  return (S2 << 16) | S1;
+}
@@ -0,0 +1,41 @@
+/*
+ * Checksum.h
+ *
+ * Byte sums of the ACPI/SMBIOS/EDID tables and the CRC32 of the caches and of the disk stamps.
+ * GetCrc32() is the CRC32 of gBS->CalculateCrc32() (IEEE 802.3, reflected, ~0 in and out),
+ * computed here so that it can be used before and after ExitBootServices().
+ * Adler32() is the zlib checksum of the PNG streams and of the mkext.
+ */
+
+#ifndef PLATFORM_CHECKSUM_H_
+#define PLATFORM_CHECKSUM_H_
+
+#include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+
+// sum of the bytes modulo 256, a table is valid when it sums to 0
+UINT8
+Checksum8 (
+  const void *Buffer,
+  UINTN Length
+  );
+
+// returns 0 if Buffer is NULL
+UINT32
+GetCrc32 (
+  const void *Buffer,
+  UINTN Size
+  );
+
+// zlib adler32(): start with Adler = 1, or continue with the result of the previous part
+UINT32
+Adler32 (
+  UINT32 Adler,
+  const void *Buffer,
+  UINTN Length
+  );
+
+// SSSE3 path of Adler32(), enabled by GetCPUProperties() when the CPU has it
+void Adler32SetSimd(BOOLEAN Enable);
+BOOLEAN Adler32GetSimd(void);
+
+#endif /* PLATFORM_CHECKSUM_H_ */
@@ -44,6 +44,7 @@
 #include "smbios.h"
 #include "cpu.h"
 #include "DataHubCpu.h"
+#include "Checksum.h"
 
 #include <Guid/DataHubRecords.h>
 
@@ -140,6 +141,48 @@ LogDataHub(IN  EFI_GUID *TypeGuid,
   return Status;
 }
 
+// LogDataHubBatch
+/// Adds several key-value-pairs to the DataHubProtocol, building every record in one buffer.
+/// EFI_DATA_HUB_PROTOCOL is a Framework protocol that the firmware may provide itself,
+/// so there is no batch call on it; LogData copies each record, the buffer is reused.
+///
+/// @return EFI_SUCCESS or the first error returned by LogData
+EFI_STATUS EFIAPI
+LogDataHubBatch(IN  const PLATFORM_DATA_ITEM *Items,
+                IN  UINTN                    Count)
+{
+  UINTN         Index;
+  UINT32        MaxDataSize = 0;
+  UINT32        RecordSize;
+  EFI_STATUS    Status;
+  EFI_STATUS    FirstError = EFI_SUCCESS;
+  PLATFORM_DATA_RECORD *platform_data_record;
+
+  for (Index = 0; Index < Count; Index++) {
+    MaxDataSize = MAX(MaxDataSize, Items[Index].DataSize);
+  }
+  platform_data_record = (PLATFORM_DATA_RECORD*)AllocatePool(sizeof(PLATFORM_DATA_RECORD) + MaxDataSize + EFI_CPU_DATA_MAXIMUM_LENGTH);
+  if (platform_data_record == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  for (Index = 0; Index < Count; Index++) {
+    RecordSize = CopyRecord(platform_data_record, Items[Index].Name, Items[Index].Data, Items[Index].DataSize);
+    Status     = gDataHub->LogData(gDataHub,
+                                   Items[Index].TypeGuid,      // DataRecordGuid
+                                   &gDataHubPlatformGuid,      // ProducerName (always)
+                                   EFI_DATA_RECORD_CLASS_DATA,
+                                   platform_data_record,
+                                   RecordSize);
+    if (EFI_ERROR(Status) && !EFI_ERROR(FirstError)) {
+      FirstError = Status;
+    }
+  }
+
+  FreePool(platform_data_record);
+  return FirstError;
+}
+
 EFI_STATUS EFIAPI
 LogDataHubXString8(IN  EFI_GUID *TypeGuid,
            IN  CONST CHAR16   *Name,
@@ -191,12 +234,11 @@ OvrSetVariable(
 EFI_STATUS EFIAPI
 OvrRuntimeServices(EFI_RUNTIME_SERVICES	*RS)
 {
-  EFI_STATUS Status;
   CopyMem(&gOrgRS, RS, sizeof(EFI_RUNTIME_SERVICES));
   RS->SetVariable = (EFI_SET_VARIABLE)OvrSetVariable;
   RS->Hdr.CRC32 = 0;
-  Status = gBS->CalculateCrc32(RS, RS->Hdr.HeaderSize, &RS->Hdr.CRC32);
-  return Status;
+  RS->Hdr.CRC32 = GetCrc32(RS, RS->Hdr.HeaderSize);
+  return EFI_SUCCESS;
 }
 
 /// Sets the volatile and non-volatile variables used by OS X
@@ -398,7 +440,7 @@ SetVariablesForOSX(LOADER_ENTRY *Entry)
       REFIT_VOLUME *Volume = Entry->Volume;
       const EFI_DEVICE_PATH_PROTOCOL    *DevicePath = Volume->DevicePath;
       // We need to remember from which device we boot, to make silence boot while special recovery boot
-      Status = gRT->SetVariable(L"specialbootdevice", &gEfiAppleBootGuid,
+      Status = NvramSetVariable(L"specialbootdevice", &gEfiAppleBootGuid,
                                 EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS,
                                 GetDevicePathSize(DevicePath), (UINT8 *)DevicePath);
       if (EFI_ERROR(Status)) {
@@ -431,6 +473,16 @@ AddSMCkey(SMC_KEY Key, SMC_DATA_SIZE Size, SMC_KEY_TYPE Type, SMC_DATA *Data)
   }
 }
 
+// AddSMCkeys
+/// Adds and writes several keys with one SMCHelper call
+void
+AddSMCkeys(const SMC_KEY_RECORD *Records, UINTN Count)
+{
+  if (gAppleSmc && (gAppleSmc->Signature == NON_APPLE_SMC_SIGNATURE)) {
+    gAppleSmc->SmcAddKeys(gAppleSmc, Count, Records);
+  }
+}
+
 // SetupDataForOSX
 /// Sets the DataHub data used by OS X
 void EFIAPI
@@ -443,8 +495,13 @@ SetupDataForOSX(BOOLEAN Hibernate)
   UINT64     CpuSpeed;
   UINT64     TscFrequency;
   UINT64     ARTFrequency;
+  UINT8      BoardRev;
   UINTN      Revision;
+  EFI_GUID   uuid;
   UINT16     Zero = 0;
+  UINT8      MSWr;
+  UINT16     MSFW = 1;
+  UINT16     MSPS = 0x300;
   BOOLEAN    isRevLess = (gSettings.REV[0] == 0 &&
                           gSettings.REV[1] == 0 &&
                           gSettings.REV[2] == 0 &&
@@ -491,80 +548,89 @@ SetupDataForOSX(BOOLEAN Hibernate)
     XStringW SerialNumber;
     SerialNumber.takeValueFrom(gSettings.SerialNr);
 
-    LogDataHub(&gEfiProcessorSubClassGuid, L"FSBFrequency",     &FrontSideBus,        sizeof(UINT64));
+    // all current settings
+    XBuffer<UINT8> xb = gSettings.serialize();
+
+    // Records are collected first and sent with one LogDataHubBatch, so every Data pointer must stay valid until then
+    PLATFORM_DATA_ITEM Items[24];
+    UINTN              ItemCount = 0;
+
+    Items[ItemCount++] = { &gEfiProcessorSubClassGuid, L"FSBFrequency",     &FrontSideBus,        sizeof(UINT64) };
 
     if (gCPUStructure.ARTFrequency && gSettings.UseARTFreq) {
       ARTFrequency = gCPUStructure.ARTFrequency;
-      LogDataHub(&gEfiProcessorSubClassGuid, L"ARTFrequency",   &ARTFrequency,        sizeof(UINT64));
+      Items[ItemCount++] = { &gEfiProcessorSubClassGuid, L"ARTFrequency",   &ARTFrequency,        sizeof(UINT64) };
     }
 
     TscFrequency        = 0; //gCPUStructure.TSCFrequency;
-    LogDataHub(&gEfiProcessorSubClassGuid, L"InitialTSC",       &TscFrequency,        sizeof(UINT64));
-    LogDataHub(&gEfiProcessorSubClassGuid, L"CPUFrequency",     &CpuSpeed,            sizeof(UINT64));
+    Items[ItemCount++] = { &gEfiProcessorSubClassGuid, L"InitialTSC",       &TscFrequency,        sizeof(UINT64) };
+    Items[ItemCount++] = { &gEfiProcessorSubClassGuid, L"CPUFrequency",     &CpuSpeed,            sizeof(UINT64) };
 
     //gSettings.BoardNumber
-    LogDataHubXString8(&gEfiMiscSubClassGuid,      L"board-id",         gSettings.BoardNumber);
-    TscFrequency++;
-    LogDataHub(&gEfiProcessorSubClassGuid, L"board-rev",       &TscFrequency,        1);
+    Items[ItemCount++] = { &gEfiMiscSubClassGuid, L"board-id", gSettings.BoardNumber.c_str(), (UINT32)gSettings.BoardNumber.sizeInBytesIncludingTerminator() };
+    BoardRev = 1;
+    Items[ItemCount++] = { &gEfiProcessorSubClassGuid, L"board-rev",       &BoardRev,            1 };
 
     DevPathSupportedVal = 1;
-    LogDataHub(&gEfiMiscSubClassGuid,      L"DevicePathsSupported", &DevPathSupportedVal, sizeof(UINT32));
-    LogDataHubXStringW(&gEfiMiscSubClassGuid,      L"Model",                ProductName);
-    LogDataHubXStringW(&gEfiMiscSubClassGuid,      L"SystemSerialNumber",   SerialNumber);
+    Items[ItemCount++] = { &gEfiMiscSubClassGuid,      L"DevicePathsSupported", &DevPathSupportedVal, sizeof(UINT32) };
+    Items[ItemCount++] = { &gEfiMiscSubClassGuid, L"Model",              ProductName.wc_str(),  (UINT32)ProductName.sizeInBytesIncludingTerminator() };
+    Items[ItemCount++] = { &gEfiMiscSubClassGuid, L"SystemSerialNumber", SerialNumber.wc_str(), (UINT32)SerialNumber.sizeInBytesIncludingTerminator() };
 
     if (gSettings.ShouldInjectSystemID()) {
-      EFI_GUID uuid;
       gSettings.getUUID(&uuid);
-      LogDataHub(&gEfiMiscSubClassGuid, L"system-id", &uuid, sizeof(uuid));
+      Items[ItemCount++] = { &gEfiMiscSubClassGuid, L"system-id", &uuid, sizeof(uuid) };
     }
 
-    LogDataHub(&gEfiProcessorSubClassGuid, L"clovergui-revision", &Revision, sizeof(UINT32));
+    Items[ItemCount++] = { &gEfiProcessorSubClassGuid, L"clovergui-revision", &Revision, sizeof(UINT32) };
 
     // collect info about real hardware
-    LogDataHubXString8(&gEfiMiscSubClassGuid, L"OEMVendor",  gSettings.OEMVendor);
-    LogDataHubXString8(&gEfiMiscSubClassGuid, L"OEMProduct", gSettings.OEMProduct);
-    LogDataHubXString8(&gEfiMiscSubClassGuid, L"OEMBoard",   gSettings.OEMBoard);
+    Items[ItemCount++] = { &gEfiMiscSubClassGuid, L"OEMVendor",  gSettings.OEMVendor.c_str(),  (UINT32)gSettings.OEMVendor.sizeInBytesIncludingTerminator() };
+    Items[ItemCount++] = { &gEfiMiscSubClassGuid, L"OEMProduct", gSettings.OEMProduct.c_str(), (UINT32)gSettings.OEMProduct.sizeInBytesIncludingTerminator() };
+    Items[ItemCount++] = { &gEfiMiscSubClassGuid, L"OEMBoard",   gSettings.OEMBoard.c_str(),   (UINT32)gSettings.OEMBoard.sizeInBytesIncludingTerminator() };
 
     // SMC helper
     if (!isRevLess) {
-      LogDataHub(&gEfiMiscSubClassGuid, L"RBr",  &gSettings.RBr,    8);
-      LogDataHub(&gEfiMiscSubClassGuid, L"EPCI", &gSettings.EPCI,   4);
-      LogDataHub(&gEfiMiscSubClassGuid, L"REV",  &gSettings.REV,    6);
+      Items[ItemCount++] = { &gEfiMiscSubClassGuid, L"RBr",  &gSettings.RBr,    8 };
+      Items[ItemCount++] = { &gEfiMiscSubClassGuid, L"EPCI", &gSettings.EPCI,   4 };
+      Items[ItemCount++] = { &gEfiMiscSubClassGuid, L"REV",  &gSettings.REV,    6 };
     }
-    LogDataHub(&gEfiMiscSubClassGuid, L"RPlt", &gSettings.RPlt,   8);
-    LogDataHub(&gEfiMiscSubClassGuid, L"BEMB", &gSettings.Mobile, 1);
+    Items[ItemCount++] = { &gEfiMiscSubClassGuid, L"RPlt", &gSettings.RPlt,   8 };
+    Items[ItemCount++] = { &gEfiMiscSubClassGuid, L"BEMB", &gSettings.Mobile, 1 };
 
-    // all current settings
-    XBuffer<UINT8> xb = gSettings.serialize();
-    LogDataHub(&gEfiMiscSubClassGuid, L"Settings", xb.data(), (UINT32)xb.size());
+    Items[ItemCount++] = { &gEfiMiscSubClassGuid, L"Settings", xb.data(), (UINT32)xb.size() };
+
+    LogDataHubBatch(Items, ItemCount);
   }else{
     MsgLog("DataHub protocol not located. Smbios not send to datahub\n");
   }
   if (!gAppleSmc) {
     return;
   }
+  // Same order as the former one-by-one AddSMCkey calls; each record keeps its own value
+  SMC_KEY_RECORD SmcKeys[16];
+  UINTN          SmcKeyCount = 0;
   if (!isRevLess) {
-    AddSMCkey(SMC_MAKE_KEY('R','B','r',' '), 8, SmcKeyTypeCh8, (SMC_DATA *)&gSettings.RBr);
-    AddSMCkey(SMC_MAKE_KEY('E','P','C','I'), 4, SmcKeyTypeUint32, (SMC_DATA *)&gSettings.EPCI);
-    AddSMCkey(SMC_MAKE_KEY('R','E','V',' '), 6, SmcKeyTypeCh8, (SMC_DATA *)&gSettings.REV);
+    SmcKeys[SmcKeyCount++] = { SMC_MAKE_KEY('R','B','r',' '), 8, SmcKeyTypeCh8, 0xC0, (SMC_DATA *)&gSettings.RBr };
+    SmcKeys[SmcKeyCount++] = { SMC_MAKE_KEY('E','P','C','I'), 4, SmcKeyTypeUint32, 0xC0, (SMC_DATA *)&gSettings.EPCI };
+    SmcKeys[SmcKeyCount++] = { SMC_MAKE_KEY('R','E','V',' '), 6, SmcKeyTypeCh8, 0xC0, (SMC_DATA *)&gSettings.REV };
   }
-  AddSMCkey(SMC_MAKE_KEY('R','P','l','t'), 8, SmcKeyTypeCh8, (SMC_DATA *)&gSettings.RPlt);
-  AddSMCkey(SMC_MAKE_KEY('B','E','M','B'), 1, SmcKeyTypeFlag, (SMC_DATA *)&gSettings.Mobile);
+  SmcKeys[SmcKeyCount++] = { SMC_MAKE_KEY('R','P','l','t'), 8, SmcKeyTypeCh8, 0xC0, (SMC_DATA *)&gSettings.RPlt };
+  SmcKeys[SmcKeyCount++] = { SMC_MAKE_KEY('B','E','M','B'), 1, SmcKeyTypeFlag, 0xC0, (SMC_DATA *)&gSettings.Mobile };
   //laptop battery keys will be better to import from nvram.plist or read from ACPI(?)
   //they are needed for FileVault2 who want to draw battery status
-  AddSMCkey(SMC_MAKE_KEY('B','A','T','P'), 1, SmcKeyTypeFlag, (SMC_DATA *)&Zero); //isBatteryPowered
-  AddSMCkey(SMC_MAKE_KEY('B','N','u','m'), 1, SmcKeyTypeUint8, (SMC_DATA *)&gSettings.Mobile); // Num Batteries
+  SmcKeys[SmcKeyCount++] = { SMC_MAKE_KEY('B','A','T','P'), 1, SmcKeyTypeFlag, 0xC0, (SMC_DATA *)&Zero }; //isBatteryPowered
+  SmcKeys[SmcKeyCount++] = { SMC_MAKE_KEY('B','N','u','m'), 1, SmcKeyTypeUint8, 0xC0, (SMC_DATA *)&gSettings.Mobile }; // Num Batteries
   if (gSettings.Mobile) {
-    AddSMCkey(SMC_MAKE_KEY('B','B','I','N'), 1, SmcKeyTypeUint8, (SMC_DATA *)&gSettings.Mobile); //Battery inserted
+    SmcKeys[SmcKeyCount++] = { SMC_MAKE_KEY('B','B','I','N'), 1, SmcKeyTypeUint8, 0xC0, (SMC_DATA *)&gSettings.Mobile }; //Battery inserted
   }
-  AddSMCkey(SMC_MAKE_KEY('M','S','T','c'), 1, SmcKeyTypeUint8, (SMC_DATA *)&Zero); // CPU Plimit
-  AddSMCkey(SMC_MAKE_KEY('M','S','A','c'), 2, SmcKeyTypeUint16, (SMC_DATA *)&Zero);// GPU Plimit
-//  AddSMCkey(SMC_MAKE_KEY('M','S','L','D'), 1, SmcKeyTypeUint8, (SMC_DATA *)&Zero);   //isLidClosed
-  Zero = Hibernate?((ResumeFromCoreStorage||GlobalConfig.HibernationFixup)?25:29):0;
-
-  AddSMCkey(SMC_MAKE_KEY('M','S','W','r'), 1, SmcKeyTypeUint8, (SMC_DATA *)&Zero);
-  Zero = 1;
-  AddSMCkey(SMC_MAKE_KEY('M','S','F','W'), 2, SmcKeyTypeUint8, (SMC_DATA *)&Zero);
-  Zero = 0x300;
-  AddSMCkey(SMC_MAKE_KEY('M','S','P','S'), 2, SmcKeyTypeUint16, (SMC_DATA *)&Zero);
+  SmcKeys[SmcKeyCount++] = { SMC_MAKE_KEY('M','S','T','c'), 1, SmcKeyTypeUint8, 0xC0, (SMC_DATA *)&Zero }; // CPU Plimit
+  SmcKeys[SmcKeyCount++] = { SMC_MAKE_KEY('M','S','A','c'), 2, SmcKeyTypeUint16, 0xC0, (SMC_DATA *)&Zero };// GPU Plimit
+//  SmcKeys[SmcKeyCount++] = { SMC_MAKE_KEY('M','S','L','D'), 1, SmcKeyTypeUint8, 0xC0, (SMC_DATA *)&Zero };   //isLidClosed
+  MSWr = Hibernate?((ResumeFromCoreStorage||GlobalConfig.HibernationFixup)?25:29):0;
+
+  SmcKeys[SmcKeyCount++] = { SMC_MAKE_KEY('M','S','W','r'), 1, SmcKeyTypeUint8, 0xC0, (SMC_DATA *)&MSWr };
+  SmcKeys[SmcKeyCount++] = { SMC_MAKE_KEY('M','S','F','W'), 2, SmcKeyTypeUint8, 0xC0, (SMC_DATA *)&MSFW };
+  SmcKeys[SmcKeyCount++] = { SMC_MAKE_KEY('M','S','P','S'), 2, SmcKeyTypeUint16, 0xC0, (SMC_DATA *)&MSPS };
+
+  AddSMCkeys(SmcKeys, SmcKeyCount);
 }
@@ -24,6 +24,22 @@ LogDataHub (
   UINT32   DataSize
   );
 
+// PLATFORM_DATA_ITEM
+/// One key-value-pair for LogDataHubBatch. Data must stay valid until the call returns.
+typedef struct {
+  EFI_GUID      *TypeGuid;
+  CONST CHAR16  *Name;
+  const void    *Data;
+  UINT32        DataSize;
+} PLATFORM_DATA_ITEM;
+
+EFI_STATUS
+EFIAPI
+LogDataHubBatch (
+  const PLATFORM_DATA_ITEM *Items,
+  UINTN                    Count
+  );
+
 void
 EFIAPI
 SetupDataForOSX (BOOLEAN Hibernate);
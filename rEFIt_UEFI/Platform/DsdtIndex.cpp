@@ -0,0 +1,242 @@
+/*
+ * DsdtIndex.cpp
+ *
+ * The lists are sorted positions. move_data() shifts them, removed bytes drop their entries,
+ * inserted bytes are not written yet at this time so their range is kept dirty
+ * and scanned again at the next query.
+ */
+
+#include "DsdtIndex.h"
+
+// the class of a position depends on the bytes [Pos - 1, Pos + 5)
+#define DSDT_INDEX_MARGIN  8
+
+static size_t LowerBound(const XArray<UINT32>& List, UINT32 Pos)
+{
+  size_t Lo = 0;
+  size_t Hi = List.size();
+  size_t Mid;
+
+  while (Lo < Hi) {
+    Mid = (Lo + Hi) / 2;
+    if (List.ElementAt(Mid) < Pos) {
+      Lo = Mid + 1;
+    } else {
+      Hi = Mid;
+    }
+  }
+  return Lo;
+}
+
+static void InsertSorted(XArray<UINT32>& List, UINT32 Pos)
+{
+  size_t Index = LowerBound(List, Pos);
+  if (Index < List.size() && List.ElementAt(Index) == Pos) {
+    return;
+  }
+  List.Insert(Pos, Index);
+}
+
+// drop [Lo, Hi), shift the positions from Hi by Offset
+static void MoveList(XArray<UINT32>& List, UINT32 Lo, UINT32 Hi, INT32 Offset)
+{
+  size_t i, j = 0;
+  UINT32 Pos;
+
+  for (i = 0; i < List.size(); i++) {
+    Pos = List.ElementAt(i);
+    if (Pos >= Lo && Pos < Hi) {
+      continue;
+    }
+    if (Pos >= Hi) {
+      Pos = (UINT32)((INT32)Pos + Offset);
+    }
+    List.ElementAt(j++) = Pos;
+  }
+  List.setSize(j);
+}
+
+void DsdtIndex::Reset()
+{
+  size_t Kind;
+
+  Table = NULL;
+  Length = 0;
+  for (Kind = 0; Kind < DsdtIndexKinds; Kind++) {
+    Lists[Kind].setEmpty();
+  }
+  DirtyStart.setEmpty();
+  DirtyEnd.setEmpty();
+}
+
+void DsdtIndex::Classify(UINT32 Pos, BOOLEAN Insert)
+{
+  DSDT_INDEX_KIND Kind = DsdtIndexKinds;
+
+  switch (Table[Pos]) {
+    case 0x08:
+      if (Insert) {
+        InsertSorted(Lists[DsdtIndexName], Pos);
+      } else {
+        Lists[DsdtIndexName].Add(Pos);
+      }
+      if (Pos + 4 < Length && Table[Pos + 1] == '_') {
+        if (Table[Pos + 2] == 'A' && Table[Pos + 3] == 'D' && Table[Pos + 4] == 'R') {
+          Kind = DsdtIndexAdr;
+        } else if (Table[Pos + 2] == 'H' && Table[Pos + 3] == 'I' && Table[Pos + 4] == 'D') {
+          Kind = DsdtIndexHid;
+        }
+      }
+      break;
+    case 0x82:
+      if (Pos > 0 && Table[Pos - 1] == 0x5B) {
+        Kind = DsdtIndexDevice;
+      }
+      break;
+    case 0x14:
+      Kind = DsdtIndexMethod;
+      break;
+    default:
+      break;
+  }
+  if (Kind != DsdtIndexKinds) {
+    if (Insert) {
+      InsertSorted(Lists[Kind], Pos);
+    } else {
+      Lists[Kind].Add(Pos);
+    }
+  }
+}
+
+void DsdtIndex::Build(const UINT8* Buffer, UINT32 Len)
+{
+  UINT32 Pos;
+
+  Reset();
+  if (!Buffer) {
+    return;
+  }
+  Table = Buffer;
+  Length = Len;
+  for (Pos = 0; Pos < Len; Pos++) {
+    Classify(Pos, FALSE);
+  }
+}
+
+void DsdtIndex::Moved(UINT32 Start, INT32 Offset)
+{
+  size_t i, Kind;
+  UINT32 Hi = Start;
+
+  if (!Table || Offset == 0 || Start > Length) {
+    return;
+  }
+  if (Offset < 0) {
+    Hi = Start - Offset; //removed bytes
+  }
+  for (Kind = 0; Kind < DsdtIndexKinds; Kind++) {
+    MoveList(Lists[Kind], Start, Hi, Offset);
+  }
+
+  //the dirty ranges follow the bytes, a range containing Start covers the gap
+  for (i = 0; i < DirtyStart.size(); i++) {
+    if (Offset > 0) {
+      if (DirtyStart.ElementAt(i) > Start) {
+        DirtyStart.ElementAt(i) += Offset;
+      }
+      if (DirtyEnd.ElementAt(i) >= Start) {
+        DirtyEnd.ElementAt(i) += Offset;
+      }
+    } else {
+      if (DirtyStart.ElementAt(i) >= Hi) {
+        DirtyStart.ElementAt(i) = (UINT32)((INT32)DirtyStart.ElementAt(i) + Offset);
+      } else if (DirtyStart.ElementAt(i) > Start) {
+        DirtyStart.ElementAt(i) = Start;
+      }
+      if (DirtyEnd.ElementAt(i) >= Hi) {
+        DirtyEnd.ElementAt(i) = (UINT32)((INT32)DirtyEnd.ElementAt(i) + Offset);
+      } else if (DirtyEnd.ElementAt(i) > Start) {
+        DirtyEnd.ElementAt(i) = Start;
+      }
+    }
+  }
+  Length = (UINT32)((INT32)Length + Offset);
+  //the gap is filled by the caller after move_data, the seam of a removal changes the neighbours
+  DirtyStart.Add(Start);
+  DirtyEnd.Add((Offset > 0) ? Start + Offset : Start);
+}
+
+void DsdtIndex::Changed(UINT32 Start, UINT32 End, UINT32 NewLength)
+{
+  if (!Table) {
+    return;
+  }
+  Length = NewLength;
+  DirtyStart.Add(Start);
+  DirtyEnd.Add(End);
+}
+
+void DsdtIndex::Flush()
+{
+  size_t i, Kind;
+  UINT32 Lo, Hi, Pos;
+
+  for (i = 0; i < DirtyStart.size(); i++) {
+    Lo = DirtyStart.ElementAt(i);
+    Hi = DirtyEnd.ElementAt(i);
+    Lo = (Lo > DSDT_INDEX_MARGIN) ? Lo - DSDT_INDEX_MARGIN : 0;
+    Hi = (Hi + DSDT_INDEX_MARGIN < Length) ? Hi + DSDT_INDEX_MARGIN : Length;
+    if (Lo >= Hi) {
+      continue;
+    }
+    for (Kind = 0; Kind < DsdtIndexKinds; Kind++) {
+      MoveList(Lists[Kind], Lo, Hi, 0);
+    }
+    for (Pos = Lo; Pos < Hi; Pos++) {
+      Classify(Pos, TRUE);
+    }
+  }
+  DirtyStart.setEmpty();
+  DirtyEnd.setEmpty();
+}
+
+UINT32 DsdtIndex::First(DSDT_INDEX_KIND Kind, const UINT8* Buffer, UINT32 Pos)
+{
+  UINT32 Base;
+  size_t Index;
+
+  if (!Table || Buffer < Table || Buffer >= Table + Length) {
+    return Pos;
+  }
+  Base = (UINT32)(Buffer - Table);
+  if (Base + Pos >= Length) {
+    return Pos;
+  }
+  if (!DirtyStart.isEmpty()) {
+    Flush();
+  }
+  Index = LowerBound(Lists[Kind], Base + Pos);
+  return ((Index < Lists[Kind].size()) ? Lists[Kind].ElementAt(Index) : Length) - Base;
+}
+
+UINT32 DsdtIndex::Last(DSDT_INDEX_KIND Kind, const UINT8* Buffer, UINT32 Pos)
+{
+  UINT32 Base;
+  size_t Index;
+
+  if (!Table || Buffer < Table || Buffer >= Table + Length) {
+    return Pos - 1;
+  }
+  Base = (UINT32)(Buffer - Table);
+  if (Base + Pos > Length) {
+    return Pos - 1;
+  }
+  if (!DirtyStart.isEmpty()) {
+    Flush();
+  }
+  Index = LowerBound(Lists[Kind], Base + Pos);
+  if (Index == 0 || Lists[Kind].ElementAt(Index - 1) < Base) {
+    return 0;
+  }
+  return Lists[Kind].ElementAt(Index - 1) - Base;
+}
@@ -0,0 +1,57 @@
+/*
+ * DsdtIndex.h
+ *
+ * Positions of the opcodes the FixBiosDsdt helpers look for (Name, Name(_ADR), Name(_HID), Device, Method),
+ * collected once per DSDT so that the helpers visit only these positions instead of every byte.
+ * The index follows move_data() and is rescanned lazily where bytes were inserted.
+ * It holds candidates only, the helpers still check the bytes of the table.
+ */
+
+#ifndef PLATFORM_DSDTINDEX_H_
+#define PLATFORM_DSDTINDEX_H_
+
+#include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+#include "../cpp_foundation/XArray.h"
+
+typedef enum {
+  DsdtIndexName,    // 0x08
+  DsdtIndexAdr,     // 0x08 "_ADR"
+  DsdtIndexHid,     // 0x08 "_HID"
+  DsdtIndexDevice,  // 0x82 after 0x5B
+  DsdtIndexMethod,  // 0x14
+  DsdtIndexKinds
+} DSDT_INDEX_KIND;
+
+class DsdtIndex
+{
+protected:
+  const UINT8*   Table;
+  UINT32         Length;
+  XArray<UINT32> Lists[DsdtIndexKinds];  // sorted positions
+  XArray<UINT32> DirtyStart;
+  XArray<UINT32> DirtyEnd;
+
+  void    Classify(UINT32 Pos, BOOLEAN Insert);
+  void    Flush();
+
+public:
+  DsdtIndex() : Table(NULL), Length(0), DirtyStart(), DirtyEnd() {}
+
+  void    Build(const UINT8* Buffer, UINT32 Len);
+  void    Reset();
+  BOOLEAN IsTable(const UINT8* Buffer) const { return Table != NULL && Buffer == Table; }
+
+  // move_data(Start, Table, len, Offset) was done
+  void    Moved(UINT32 Start, INT32 Offset);
+  // the bytes [Start, End) were written, the table is now NewLength long
+  void    Changed(UINT32 Start, UINT32 End, UINT32 NewLength);
+
+  // Buffer may be a part of the table and positions are relative to it.
+  // Outside of the indexed table every position is a candidate.
+  // first candidate at or after Pos, the end of the table if none
+  UINT32  First(DSDT_INDEX_KIND Kind, const UINT8* Buffer, UINT32 Pos);
+  // last candidate before Pos, 0 if none
+  UINT32  Last(DSDT_INDEX_KIND Kind, const UINT8* Buffer, UINT32 Pos);
+};
+
+#endif /* PLATFORM_DSDTINDEX_H_ */
@@ -56,6 +56,7 @@ EFI_EVENT   mVirtualAddressChangeEvent = NULL;
 EFI_EVENT   OnReadyToBootEvent = NULL;
 EFI_EVENT   ExitBootServiceEvent = NULL;
 EFI_EVENT   mSimpleFileSystemChangeEvent = NULL;
+BOOLEAN     ExitBootServicesCalled = FALSE;
 EFI_HANDLE  mHandle = NULL;
 
 extern EFI_RUNTIME_SERVICES gOrgRS;
@@ -221,6 +222,7 @@ void
 EFIAPI
 OnExitBootServices(IN EFI_EVENT Event, IN void *Context)
 {
+  ExitBootServicesCalled = TRUE;
   /*
   if (gCPUStructure.Vendor == CPU_VENDOR_INTEL &&
       (gCPUStructure.Family == 0x06 && gCPUStructure.Model >= CPU_MODEL_SANDY_BRIDGE)
@@ -255,6 +257,8 @@ OnExitBootServices(IN EFI_EVENT Event, IN void *Context)
 */  
 
   gST->ConOut->OutputString (gST->ConOut, L"+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++\n");
+  // last chance to write buffered log
+  flushDebugLog();
 	//
 	// Patch kernel and kexts if needed
 	//
@@ -393,12 +397,13 @@ OnSimpleFileSystem (
 	
 }  
 
+static void*					RegSimpleFileSystem = NULL;
+
 EFI_STATUS
 GuiEventsInitialize ()
 {
 	EFI_STATUS				Status;
 	EFI_EVENT				Event;
-	void*				  	RegSimpleFileSystem = NULL;
 	
 	gEvent = 0;
 	Status = gBS->CreateEvent (
@@ -419,6 +424,20 @@ GuiEventsInitialize ()
 	return Status;
 }  
 
+// the handles that got a SimpleFileSystem since the previous call, one per call, NULL when there is no more
+EFI_HANDLE
+GetNewFileSystemHandle ()
+{
+	EFI_HANDLE				Handle = NULL;
+	UINTN					Size = sizeof(Handle);
+	
+	if (RegSimpleFileSystem == NULL ||
+		EFI_ERROR(gBS->LocateHandle(ByRegisterNotify, NULL, RegSimpleFileSystem, &Size, &Handle))) {
+		return NULL;
+	}
+	return Handle;
+}
+
 //EFI_STATUS
 //WaitForSingleEvent (
 //          IN EFI_EVENT        Event,
@@ -12,6 +12,8 @@ extern EFI_EVENT                       mVirtualAddressChangeEvent;
 extern EFI_EVENT                       OnReadyToBootEvent;
 extern EFI_EVENT                       ExitBootServiceEvent;
 extern EFI_EVENT                       mSimpleFileSystemChangeEvent;
+// set first thing in OnExitBootServices(), boot services must not be used after
+extern BOOLEAN                         ExitBootServicesCalled;
 
 
 EFI_STATUS
@@ -23,6 +25,9 @@ EventsInitialize (
 EFI_STATUS
 GuiEventsInitialize (void);
 
+EFI_HANDLE
+GetNewFileSystemHandle (void);
+
 
 // timeout will be in ms here, as small as 1ms and up
 EFI_STATUS
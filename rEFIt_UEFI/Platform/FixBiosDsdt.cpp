@@ -7,9 +7,12 @@
 
 #include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
 #include "FixBiosDsdt.h"
+#include "AmlTree.h"
+#include "DsdtIndex.h"
 #include "StateGenerator.h"
 #include "AcpiPatcher.h"
 #include "cpu.h"
+#include "Self.h"
 #include "../include/Pci.h"
 #include "../include/Devices.h"
 
@@ -40,6 +43,12 @@ extern "C" {
 
 OPER_REGION *gRegions = NULL;
 
+// built by FixBiosDsdt once the patches are done, followed by move_data()
+static DsdtIndex gDsdtIndex;
+
+// CRC32 of the PCI devices seen by CheckHardware(), part of the key of the DSDT cache
+static UINT32 HardwareCrc32 = 0;
+
 CHAR8*  device_name[12];  // 0=>Display  1=>network  2=>firewire 3=>LPCB 4=>HDAAudio 5=>RTC 6=>TMR 7=>SBUS 8=>PIC 9=>Airport 10=>XHCI 11=>HDMI
 CHAR8*  UsbName[10];
 
@@ -615,6 +624,7 @@ void CheckHardware()
   UINTN               Device;
   UINTN               Function;
   UINTN               display=0;
+  XBuffer<UINT8>      Devices;
 
 
 //  pci_dt_t            PCIdevice;
@@ -651,6 +661,13 @@ void CheckHardware()
                                   );
 
         deviceid = Pci.Hdr.DeviceId | (Pci.Hdr.VendorId << 16);
+        Devices.cat((UINT32)PCIADDR(Bus, Device, Function));
+        Devices.cat(Pci.Hdr.VendorId);
+        Devices.cat(Pci.Hdr.DeviceId);
+        Devices.cat(Pci.Hdr.RevisionID);
+        Devices.ncat(Pci.Hdr.ClassCode, sizeof(Pci.Hdr.ClassCode));
+        Devices.cat(Pci.Device.SubsystemVendorID);
+        Devices.cat(Pci.Device.SubsystemID);
 
         // add for auto patch dsdt get DSDT Device _ADR
    //     PCIdevice.DeviceHandle = Handle;
@@ -847,6 +864,10 @@ void CheckHardware()
       }
     }
   }
+  HardwareCrc32 = 0;
+  if (Devices.size() > 0) {
+    HardwareCrc32 = GetCrc32(Devices.data(), Devices.size());
+  }
 }
 
 UINT8 slash[] = {0x5c, 0};
@@ -894,6 +915,18 @@ void InsertScore(UINT8* dsdt, UINT32 off2, INTN root)
   acpi_cpu_score[ind] = 0;
 }
 
+// names used when the DSDT declares no processor
+static void DefaultCpuNames()
+{
+  UINT32 i;
+
+  for (i=0; i < acpi_cpu_max; i++) {
+    acpi_cpu_name[i] = (__typeof_am__(acpi_cpu_name[i]))AllocateZeroPool(5);
+    snprintf(acpi_cpu_name[i], 5, "CPU%X", i);
+    acpi_cpu_processor_id[i] = (UINT8)(i & 0x7F);
+  }
+}
+
 void findCPU(UINT8* dsdt, UINT32 length)
 {
   UINT32  i, k, size;
@@ -1075,11 +1108,7 @@ void findCPU(UINT8* dsdt, UINT32 length)
   DBG(", within the score: %s\n", acpi_cpu_score);
 
   if (!acpi_cpu_count) {
-    for (i=0; i < acpi_cpu_max; i++) {
-      acpi_cpu_name[i] = (__typeof_am__(acpi_cpu_name[i]))AllocateZeroPool(5);
-      snprintf(acpi_cpu_name[i], 5, "CPU%X", i);
-      acpi_cpu_processor_id[i] = (UINT8)(i & 0x7F);
-    }
+    DefaultCpuNames();
   }
   return;
 }
@@ -1094,6 +1123,9 @@ UINT32 move_data(UINT32 start, UINT8* buffer, UINT32 len, INT32 offset)
 {
   UINT32 i;
 
+  if (gDsdtIndex.IsTable(buffer)) {
+    gDsdtIndex.Moved(start, offset);
+  }
   if (offset<0) {
     for (i=start; i<len+offset; i++) {
       buffer[i] = buffer[i-offset];
@@ -1195,7 +1227,7 @@ INT32 write_size(UINT32 adr, UINT8* buffer, UINT32 len, INT32 sizeoffset)
 INT32 FindName(UINT8 *dsdt, INT32 len, CONST CHAR8* name)
 {
   INT32 i;
-  for (i = 0; len >= 5 && i < len-5; i++) {
+  for (i = 0; len >= 5 && i < len-5; i = (INT32)gDsdtIndex.First(DsdtIndexName, dsdt, i + 1)) {
     if ((dsdt[i] == 0x08) && (dsdt[i+1] == name[0]) &&
         (dsdt[i+2] == name[1]) && (dsdt[i+3] == name[2]) &&
         (dsdt[i+4] == name[3])) {
@@ -1354,13 +1386,39 @@ INT32 FindBin (UINT8 *dsdt, size_t len, const XBuffer<UINT8>& bin) {
   return FindBin(dsdt, (UINT32)len, bin.data(), (UINT32)bin.size());
 }
 
+// next i from i where CmpAdr can be true: Name (_ADR) at i + 4
+static UINT32 NextAdr(UINT8 *dsdt, UINT32 i)
+{
+  return gDsdtIndex.First(DsdtIndexAdr, dsdt, i + 4) - 4;
+}
+
+// next i from i where CmpPNP can be true: Name (_HID) at i
+static UINT32 NextHid(UINT8 *dsdt, UINT32 i)
+{
+  return gDsdtIndex.First(DsdtIndexHid, dsdt, i);
+}
+
+// next i from i where CmpDev can be true: Device opcode at i - 4 .. i - 2
+static UINT32 NextDevName(UINT8 *dsdt, UINT32 i)
+{
+  UINT32 k = gDsdtIndex.First(DsdtIndexDevice, dsdt, (i > 4) ? i - 4 : 0) + 2;
+  return (k > i) ? k : i;
+}
+
+// next i from i where FindMethod can match: Method opcode at i - 1 .. i + 1
+static UINT32 NextMethodName(UINT8 *dsdt, UINT32 i)
+{
+  UINT32 k = gDsdtIndex.First(DsdtIndexMethod, dsdt, (i > 1) ? i - 1 : 0);
+  return (k > i + 1) ? k - 1 : i;
+}
+
 //if (!FindMethod(dsdt, len, "DTGP"))
 // return address of size field. Assume size not more then 0x0FFF = 4095 bytes
 //assuming only short methods
 UINT32 FindMethod (UINT8 *dsdt, UINT32 len, CONST CHAR8* Name)
 {
   UINT32 i;
-  for (i = 0; len >= 7 && i < len - 7; i++) {
+  for (i = 0; len >= 7 && i < len - 7; i = NextMethodName(dsdt, i + 1)) {
     if (((dsdt[i] == 0x14) || (dsdt[i+1] == 0x14) || (i>0 && dsdt[i-1] == 0x14)) &&
         (dsdt[i+3] == Name[0]) && (dsdt[i+4] == Name[1]) &&
         (dsdt[i+5] == Name[2]) && (dsdt[i+6] == Name[3])
@@ -1547,6 +1605,52 @@ INTN ReplaceName(UINT8 *dsdt, UINT32 len, CONST CHAR8 *OldName, CONST CHAR8 *New
   return j; //number of replacement
 }
 
+// ReplaceName for several pairs { OldName, NewName } with one scan of the table for all the names.
+// If some names can overlap in the table, the pairs are renamed one after the other.
+static void ReplaceNames(UINT8 *dsdt, UINT32 len, CONST CHAR8 *Names[][2], UINTN Count)
+{
+  AcpiPatternSet Set;
+  XArray<ACPI_PATTERN_HIT> Hits;
+  XArray<BOOLEAN> Present;
+  size_t i, n;
+  BOOLEAN OnePass = (len > 4);
+
+  for (i = 0; OnePass && i < Count; i++) {
+    for (n = 0; n < 2; n++) {
+      if (!Set.IsIndependent((const UINT8*)Names[i][n], NULL, 4) || !Set.Add((const UINT8*)Names[i][n], NULL, 4)) {
+        OnePass = FALSE;
+        break;
+      }
+    }
+    Present.Add(FALSE);
+  }
+  if (!OnePass || !Set.Build()) {
+    for (i = 0; i < Count; i++) {
+      ReplaceName(dsdt, len, Names[i][0], Names[i][1]);
+    }
+    return;
+  }
+
+  //pattern 2*i is OldName, 2*i+1 is NewName of the pair i
+  Set.FindAll(dsdt, 0, len - 1, Hits);
+  for (i = 0; i < Hits.size(); i++) {
+    n = Hits.ElementAt(i).Pattern / 2;
+    if ((Hits.ElementAt(i).Pattern & 1) && !Present.ElementAt(n)) {
+      MsgLog("NewName %s already present, renaming impossible\n", Names[n][1]);
+      Present.ElementAt(n) = TRUE;
+    }
+  }
+  for (i = 0; i < Hits.size(); i++) {
+    const ACPI_PATTERN_HIT& Hit = Hits.ElementAt(i);
+    n = Hit.Pattern / 2;
+    if ((Hit.Pattern & 1) || Present.ElementAt(n)) {
+      continue;
+    }
+    MsgLog("Name %s present at 0x%X, renaming to %s\n", Names[n][0], Hit.Pos, Names[n][1]);
+    CopyMem(dsdt + Hit.Pos, Names[n][1], 4);
+  }
+}
+
 //the procedure search nearest "Device" code before given address
 //should restrict the search by 6 bytes... OK, 10, .. until dsdt begin
 //hmmm? will check device name
@@ -1555,7 +1659,10 @@ UINT32 devFind(UINT8 *dsdt, UINT32 address)
   UINT32 k = address;
   INT32 size = 0;
   while (k > 30) {
-    k--;
+    k = gDsdtIndex.Last(DsdtIndexDevice, dsdt, k);
+    if (k < 30) {
+      break;
+    }
     if (dsdt[k] == 0x82 && dsdt[k-1] == 0x5B) {
       size = get_size(dsdt, k+1);
       if (!size) {
@@ -1573,24 +1680,19 @@ UINT32 devFind(UINT8 *dsdt, UINT32 address)
 
 BOOLEAN CustProperties(AML_CHUNK* pack, UINT32 Dev)
 {
-  UINTN i;
+  DEV_PROPERTY *Prop;
   BOOLEAN Injected = FALSE;
-  if (gSettings.NrAddProperties == 0xFFFE) {
-    return FALSE; // not do this for Arbitrary properties?
-  }
-  for (i = 0; i < gSettings.NrAddProperties; i++) {
-    if (gSettings.AddProperties[i].Device != Dev) {
-      continue;
-    }
+  // GetAddProperties() is empty for Arbitrary properties (NrAddProperties == 0xFFFE)
+  for (Prop = GetAddProperties(Dev); Prop; Prop = Prop->Next) {
     Injected = TRUE;
 
-    if (!gSettings.AddProperties[i].MenuItem.BValue) {
-      //DBG("  disabled property Key: %s, len: %d\n", gSettings.AddProperties[i].Key, gSettings.AddProperties[i].ValueLen);
+    if (!Prop->MenuItem.BValue) {
+      //DBG("  disabled property Key: %s, len: %d\n", Prop->Key, Prop->ValueLen);
     } else {
-      aml_add_string(pack, gSettings.AddProperties[i].Key);
-      aml_add_byte_buffer(pack, gSettings.AddProperties[i].Value,
-                          (UINT32)gSettings.AddProperties[i].ValueLen);
-      //DBG("  added property Key: %s, len: %d\n", gSettings.AddProperties[i].Key, gSettings.AddProperties[i].ValueLen);
+      aml_add_string(pack, Prop->Key);
+      aml_add_byte_buffer(pack, Prop->Value,
+                          (UINT32)Prop->ValueLen);
+      //DBG("  added property Key: %s, len: %d\n", Prop->Key, Prop->ValueLen);
     }
   }
   return Injected;
@@ -1602,13 +1704,24 @@ UINT32 DeleteDevice(const XString8& Name, UINT8 *dsdt, UINT32 len)
   UINT32 i, j;
   INT32 size = 0, sizeoffset;
   MsgLog(" deleting device %s\n", Name.c_str());
-  for (i=20; i<len; i++) {
+  for (i=20; i<len; i = NextDevName(dsdt, i + 1)) {
     j = CmpDev(dsdt, i, Name);
     if (j != 0) {
       size = get_size(dsdt, j);
       if (!size) {
         continue;
       }
+      AmlTree Tree;
+      if (Tree.Parse(dsdt, len) && Tree.AddEdit(j - 2, 2 + size, NULL, 0)) {
+        UINT32 NewLen = Tree.Apply(dsdt);
+        if (NewLen != 0) {
+          len = NewLen;
+          if (gDsdtIndex.IsTable(dsdt)) {
+            gDsdtIndex.Build(dsdt, len); //the whole table was rewritten
+          }
+          break;
+        }
+      }
       sizeoffset = - 2 - size;
       len = move_data(j-2, dsdt, len, sizeoffset);
       //to correct outers we have to calculate offset
@@ -1623,7 +1736,7 @@ UINT32 GetPciDevice(UINT8 *dsdt, UINT32 len)
 {
   UINT32 i;
   UINT32 PCIADR = 0, PCISIZE = 0;
-  for (i=20; i<len; i++) {
+  for (i=20; i<len; i = NextHid(dsdt, i + 1)) {
     // Find Device PCI0   // PNP0A03
     if (CmpPNP(dsdt, i, 0x0A03)) {
       PCIADR = devFind(dsdt, i);
@@ -1638,7 +1751,7 @@ UINT32 GetPciDevice(UINT8 *dsdt, UINT32 len)
     } // End find
   }
   if (!PCISIZE) {
-    for (i=20; i<len; i++) {
+    for (i=20; i<len; i = NextHid(dsdt, i + 1)) {
       // Find Device PCIE   // PNP0A08
       if (CmpPNP(dsdt, i, 0x0A08)) {
         PCIADR = devFind(dsdt, i);
@@ -1767,12 +1880,52 @@ UINT32 FixADP1 (UINT8* dsdt, UINT32 len)
   return len;
 }
 
-UINT32 FixAny (UINT8* dsdt, UINT32 len, const XBuffer<UINT8> ToFind, const XBuffer<UINT8> ToReplace)
+//the old way: move the tail of the table and correct the outers for each hit
+static UINT32 FixAnyByShift (UINT8* dsdt, UINT32 len, const XBuffer<UINT8>& ToFind, const XBuffer<UINT8>& ToReplace, INT32 sizeoffset)
 {
-  size_t sizeoffset;
   INT32 adr;
   UINT32 i;
   BOOLEAN found = FALSE;
+  for (i = 20; i < len; ) {
+    adr = FindBin(dsdt + i, len - i, ToFind);
+    if (adr < 0) {
+      break;
+    }
+
+    if (!found) {
+      MsgLog(" patched at: [");
+      MsgLog(" (%X)", adr); //print once because whole duration is 26 seconds!!!
+    }
+
+//    MsgLog(" (%X)", adr);
+    found = TRUE;
+    len = move_data(adr + i, dsdt, len, sizeoffset);
+    CopyMem(dsdt + adr + i, ToReplace.data(), ToReplace.size());
+    len = CorrectOuterMethod(dsdt, len, adr + i - 2, sizeoffset);
+    len = CorrectOuters(dsdt, len, adr + i - 3, sizeoffset);
+    i += (UINT32)(adr + ToReplace.size()); // if there is no bug before, it should be safe cast.
+  }
+  if (found) {
+    MsgLog(" ]\n");
+  } else {
+    MsgLog(" bin not found / already patched!\n");
+  }
+  return len;
+}
+
+// Same size patches are written in place.
+// Others are collected as edits of the AML tree and the table is written once with the lengths recomputed.
+// If a hit cuts the header of an object (opcode or PkgLength) the tree can't follow, then the old way is used.
+UINT32 FixAny (UINT8* dsdt, UINT32 len, const XBuffer<UINT8>& ToFind, const XBuffer<UINT8>& ToReplace)
+{
+  INT32 sizeoffset;
+  INT32 adr;
+  INT32 first = -1;
+  UINT32 i;
+  UINT32 hits = 0;
+  UINT32 NewLen;
+  AmlTree Tree;
+
   if ( ToFind.isEmpty() || ToReplace.isEmpty() ) {
     DBG(" invalid patches!\n");
     return len;
@@ -1782,36 +1935,47 @@ UINT32 FixAny (UINT8* dsdt, UINT32 len, const XBuffer<UINT8> ToFind, const XBuff
     MsgLog(" the patch is too large!\n");
     return len;
   }
-  sizeoffset = ToReplace.size() - ToFind.size();
-  if ( sizeoffset > MAX_INT32 ) {
-    DBG(" invalid patches (sizeoffset > MAX_INT32)!\n");
+  if ( ToReplace.size() > MAX_INT32 ) {
+    DBG(" invalid patches (replace size > MAX_INT32)!\n");
     return len;
   }
+  sizeoffset = (INT32)ToReplace.size() - (INT32)ToFind.size(); // safe cast, ToFind is smaller than the table
+
+  if (sizeoffset != 0 && !Tree.Parse(dsdt, len)) {
+    return FixAnyByShift(dsdt, len, ToFind, ToReplace, sizeoffset);
+  }
   for (i = 20; i < len; ) {
     adr = FindBin(dsdt + i, len - i, ToFind);
     if (adr < 0) {
-      if (found) {
-        MsgLog(" ]\n");
-      } else {
-        MsgLog(" bin not found / already patched!\n");
-      }
-      return len;
+      break;
     }
-
-    if (!found) {
-      MsgLog(" patched at: [");
-      MsgLog(" (%X)", adr); //print once because whole duration is 26 seconds!!!
+    if (sizeoffset == 0) {
+      CopyMem(dsdt + adr + i, ToReplace.data(), ToReplace.size());
+    } else if (!Tree.AddEdit(adr + i, (UINT32)ToFind.size(), ToReplace.data(), (UINT32)ToReplace.size())) {
+      DBG(" hit at %X cuts an object,", adr + i);
+      return FixAnyByShift(dsdt, len, ToFind, ToReplace, sizeoffset);
     }
-
-//    MsgLog(" (%X)", adr);
-    found = TRUE;
-    len = move_data(adr + i, dsdt, len, (INT32)sizeoffset); // safe cast, sizeoffset < MAX_INT32
-    CopyMem(dsdt + adr + i, ToReplace.data(), ToReplace.size());
-    len = CorrectOuterMethod(dsdt, len, adr + i - 2, (INT32)sizeoffset); // safe cast, sizeoffset < MAX_INT32
-    len = CorrectOuters(dsdt, len, adr + i - 3, (INT32)sizeoffset); // safe cast, sizeoffset < MAX_INT32
-    i += (UINT32)(adr + ToReplace.size()); // if there is no bug before, it should be safe cast.
+    if (first < 0) {
+      first = adr;
+    }
+    hits++;
+    i += (UINT32)(adr + ToFind.size());
+  }
+  if (hits == 0) {
+    MsgLog(" bin not found / already patched!\n");
+    return len;
   }
-  MsgLog(" ]\n"); //should not be here
+  if (sizeoffset != 0) {
+    NewLen = Tree.Apply(dsdt);
+    if (NewLen == 0) {
+      return FixAnyByShift(dsdt, len, ToFind, ToReplace, sizeoffset);
+    }
+    len = NewLen;
+    if (gDsdtIndex.IsTable(dsdt)) {
+      gDsdtIndex.Build(dsdt, len); //the whole table was rewritten
+    }
+  }
+  MsgLog(" patched at: [ (%X) ] %u times\n", first, hits);
   return len;
 }
 
@@ -1840,7 +2004,7 @@ UINT32 FixRenameByBridge2 (UINT8* dsdt, UINT32 len, const XBuffer<UINT8>& TgtBrg
   }
 
   DBG("Start ByBridge Rename Fix\n");
-  for (i=0x20; len >= 10 && i < len - 10; i++) {
+  for (i=0x20; len >= 10 && i < len - 10; i = NextDevName(dsdt, i + 1)) {
     if (CmpDev(dsdt, i, TgtBrgName)) {
       BrdADR = devFind(dsdt, i);
       if (!BrdADR) {
@@ -1880,6 +2044,141 @@ UINT32 FixRenameByBridge2 (UINT8* dsdt, UINT32 len, const XBuffer<UINT8>& TgtBrg
   return len;
 }
 
+DSDT_FIX_TIMES *gDsdtFixTimes = NULL;
+
+DsdtFixSpan::~DsdtFixSpan()
+{
+  if (gDsdtFixTimes && gDsdtFixTimes->Count < DSDT_FIX_TIMES_MAX) {
+    gDsdtFixTimes->Fix[gDsdtFixTimes->Count].Name = Name;
+    gDsdtFixTimes->Fix[gDsdtFixTimes->Count].Ticks = AsmReadTsc() - Start;
+    gDsdtFixTimes->Count++;
+  }
+}
+
+UINT64 AcpiPatchTime (UINT64 Start)
+{
+  UINT64 Ticks = AsmReadTsc() - Start;
+  if (gCPUStructure.TSCFrequency == 0) {
+    return 0;
+  }
+  return DivU64x64Remainder(MultU64x32(Ticks, 1000000), gCPUStructure.TSCFrequency, NULL);
+}
+
+// A same size patch joins the open step if its Find can't meet the Find or the Replace of the patches already there.
+// Then one scan gives the table the patches would give one after the other.
+// A size changing patch, a patch in a bridge or a dependent one closes the step.
+void DsdtPatchPlan::Build()
+{
+  DSDT_PATCH_STEP* Group = NULL;
+  DSDT_PATCH_STEP* Step;
+  size_t i;
+
+  Steps.setEmpty();
+  for (i = 0; i < gSettings.DSDTPatchArray.size(); i++) {
+    const DSDT_Patch& Patch = gSettings.DSDTPatchArray[i];
+    if ( Patch.PatchDsdtFind.isEmpty() ) {
+      continue;
+    }
+    if (!Patch.PatchDsdtMenuItem.BValue) {
+      if (Group) {
+        Group->Patches.Add(i);
+        continue;
+      }
+    } else if (Patch.PatchDsdtTgt.isEmpty() && Patch.PatchDsdtFind.size() == Patch.PatchDsdtReplace.size() &&
+               Patch.PatchDsdtFind.size() <= MAX_INT32) {
+      if (Group && Group->Set.IsIndependent(Patch.PatchDsdtFind.data(), Patch.PatchDsdtReplace.data(), (UINT32)Patch.PatchDsdtFind.size()) &&
+          Group->Set.Add(Patch.PatchDsdtFind.data(), Patch.PatchDsdtReplace.data(), (UINT32)Patch.PatchDsdtFind.size())) {
+        Group->Patches.Add(i);
+        if (Group->MaxSize < Patch.PatchDsdtFind.size()) {
+          Group->MaxSize = (UINT32)Patch.PatchDsdtFind.size();
+        }
+        continue;
+      }
+      Step = new DSDT_PATCH_STEP;
+      if (Step->Set.Add(Patch.PatchDsdtFind.data(), Patch.PatchDsdtReplace.data(), (UINT32)Patch.PatchDsdtFind.size())) {
+        Step->MaxSize = (UINT32)Patch.PatchDsdtFind.size();
+        Group = Step;
+      } else {
+        Group = NULL;
+      }
+      Step->Patches.Add(i);
+      Steps.AddReference(Step, true);
+      continue;
+    }
+    Group = NULL;
+    Step = new DSDT_PATCH_STEP;
+    Step->Patches.Add(i);
+    Steps.AddReference(Step, true);
+  }
+
+  for (i = 0; i < Steps.size(); i++) {
+    if (Steps[i].Set.GetCount() > 0 && !Steps[i].Set.Build()) {
+      Steps[i].Set.Reset(); //out of memory, the patches go one by one
+    }
+  }
+}
+
+UINT32 DsdtPatchPlan::ApplyOne(UINT8* Table, UINT32 Len, size_t Index, BOOLEAN ShowLabels) const
+{
+  const DSDT_Patch& Patch = gSettings.DSDTPatchArray[Index];
+
+  if (ShowLabels) {
+    MsgLog(" - [%s]:", Patch.PatchDsdtLabel.c_str());
+  }
+  if (!Patch.PatchDsdtMenuItem.BValue) {
+    if (ShowLabels) {
+      MsgLog(" disabled\n");
+    }
+    return Len;
+  }
+  if (Patch.PatchDsdtTgt.isEmpty()) {
+    return FixAny(Table, Len, Patch.PatchDsdtFind, Patch.PatchDsdtReplace);
+  }
+  return FixRenameByBridge2(Table, Len, Patch.PatchDsdtTgt, Patch.PatchDsdtFind, Patch.PatchDsdtReplace);
+}
+
+UINT32 DsdtPatchPlan::Apply(UINT8* Table, UINT32 Len, BOOLEAN ShowLabels) const
+{
+  XArray<UINT32> Hits;
+  XArray<UINT32> First;
+  size_t i, j, k;
+
+  for (i = 0; i < Steps.size(); i++) {
+    const DSDT_PATCH_STEP& Step = Steps[i];
+    if (Step.Set.GetCount() == 0 || (Step.MaxSize + sizeof(EFI_ACPI_DESCRIPTION_HEADER)) > Len) {
+      for (j = 0; j < Step.Patches.size(); j++) {
+        Len = ApplyOne(Table, Len, Step.Patches.ElementAt(j), ShowLabels);
+      }
+      continue;
+    }
+    Hits.setSize(Step.Set.GetCount());
+    First.setSize(Step.Set.GetCount());
+    //as FixAny, from the end of the header to the last byte excluded
+    Step.Set.ReplaceAll(Table, 20, Len - 1, Hits.data(), First.data());
+    k = 0;
+    for (j = 0; j < Step.Patches.size(); j++) {
+      const DSDT_Patch& Patch = gSettings.DSDTPatchArray[Step.Patches.ElementAt(j)];
+      if (ShowLabels) {
+        MsgLog(" - [%s]:", Patch.PatchDsdtLabel.c_str());
+      }
+      if (!Patch.PatchDsdtMenuItem.BValue) {
+        if (ShowLabels) {
+          MsgLog(" disabled\n");
+        }
+        continue;
+      }
+      MsgLog(" pattern %02hhX%02hhX%02hhX%02hhX,", Patch.PatchDsdtFind[0], Patch.PatchDsdtFind[1], Patch.PatchDsdtFind[2], Patch.PatchDsdtFind[3]);
+      if (Hits.ElementAt(k) == 0) {
+        MsgLog(" bin not found / already patched!\n");
+      } else {
+        MsgLog(" patched at: [ (%X) ] %u times\n", First.ElementAt(k), Hits.ElementAt(k));
+      }
+      k++;
+    }
+  }
+  return Len;
+}
+
 UINT32 FIXDarwin (UINT8* dsdt, UINT32 len)
 {
   CONST UINT32  adr  = 0x24;
@@ -1933,7 +2232,7 @@ UINT32 AddPNLF (UINT8 *dsdt, UINT32 len)
     return len; //the device already exists
   }
   //search  PWRB PNP0C0C
-  for (i=0x20; len >= 6 && i < len - 6; i++) {
+  for (i=0x20; len >= 6 && i < len - 6; i = NextHid(dsdt, i + 1)) {
     if (CmpPNP(dsdt, i, 0x0C0C)) {
       DBG("found PWRB at %X\n", i);
       adr = devFind(dsdt, i);
@@ -1943,7 +2242,7 @@ UINT32 AddPNLF (UINT8 *dsdt, UINT32 len)
   if (!adr) {
     //search battery
     DBG("not found PWRB, look BAT0\n");
-    for (i=0x20; len >= 6 && i < len - 6; i++) {
+    for (i=0x20; len >= 6 && i < len - 6; i = NextHid(dsdt, i + 1)) {
       if (CmpPNP(dsdt, i, 0x0C0A)) {
         adr = devFind(dsdt, i);
         DBG("found BAT0 at %X\n", i);
@@ -2097,7 +2396,7 @@ UINT32 FixRTC (UINT8 *dsdt, UINT32 len)
 
   DBG("Start RTC Fix\n");
 
-  for (j=20; j<len; j++) {
+  for (j=20; j<len; j = NextHid(dsdt, j + 1)) {
     // Find Device RTC // Name (_HID, EisaId ("PNP0B00")) for RTC
     if (CmpPNP(dsdt, j, 0x0B00))
     {
@@ -2187,7 +2486,7 @@ UINT32 FixTMR (UINT8 *dsdt, UINT32 len)
   INT32  offset  = 0, sizeoffset = 0;
   DBG("Start TMR Fix\n");
 
-  for (j=20; j<len; j++) {
+  for (j=20; j<len; j = NextHid(dsdt, j + 1)) {
     // Find Device TMR   PNP0100
     if (CmpPNP(dsdt, j, 0x0100)) {
       TMRADR = devFind(dsdt, j);
@@ -2263,7 +2562,7 @@ UINT32 FixPIC (UINT8 *dsdt, UINT32 len)
   UINT32 PICADR, picsize = 0;
 
   DBG("Start PIC Fix\n");
-  for (j=20; j<len; j++) {
+  for (j=20; j<len; j = NextHid(dsdt, j + 1)) {
     // Find Device PIC or IPIC  PNP0000
     if (CmpPNP(dsdt, j, 0x0000)) {
       PICADR = devFind(dsdt, j);
@@ -2349,7 +2648,7 @@ UINT32 FixHPET (UINT8* dsdt, UINT32 len)
 
   MsgLog("Start HPET Fix\n");
   //have to find LPC
-  for (j=0x20; len >= 10 && j < len - 10; j++) {
+  for (j=0x20; len >= 10 && j < len - 10; j = NextAdr(dsdt, j + 1)) {
     if (CmpAdr(dsdt, j, 0x001F0000)) {
       LPCBADR = devFind(dsdt, j);
       if (!LPCBADR) {
@@ -2362,7 +2661,7 @@ UINT32 FixHPET (UINT8* dsdt, UINT32 len)
     MsgLog("No LPCB device! Patch HPET will not be applied\n");
     return len;
   }
-  for (j=20; j<len; j++) {
+  for (j=20; j<len; j = NextHid(dsdt, j + 1)) {
     // Find Device HPET   // PNP0103
     if (CmpPNP(dsdt, j, 0x0103)) {
       adr = devFind(dsdt, j);
@@ -2416,7 +2715,7 @@ UINT32 FIXLPCB (UINT8 *dsdt, UINT32 len)
   DBG("Start LPCB Fix\n");
   //DBG("len = 0x%08X\n", len);
   //have to find LPC
-  for (j=0x20; len >= 10 && j < len - 10; j++) {
+  for (j=0x20; len >= 10 && j < len - 10; j = NextAdr(dsdt, j + 1)) {
     if (CmpAdr(dsdt, j, 0x001F0000))
     {
       LPCBADR = devFind(dsdt, j);
@@ -2472,10 +2771,8 @@ UINT32 FIXLPCB (UINT8 *dsdt, UINT32 len)
   aml_add_buffer(met, dtgp_1, sizeof(dtgp_1));
   // finish Method(_DSM,4,NotSerialized)
 
-  aml_calculate_size(root);
-  lpcb = (__typeof__(lpcb))AllocateZeroPool(root->Size);
-  sizeoffset = root->Size;
-  aml_write_node(root, lpcb, 0);
+  lpcb = (__typeof__(lpcb))AllocateZeroPool(aml_max_size(root));
+  sizeoffset = aml_write_node(root, lpcb, 0);
   aml_destroy_node(root);
   // add LPCB code
   len = move_data(LPCBADR1, dsdt, len, sizeoffset);
@@ -2524,7 +2821,7 @@ UINT32 FIXDisplay (UINT8 *dsdt, UINT32 len, INT32 VCard)
   root = aml_create_node(NULL);
 
   //search DisplayADR1[0]
-  for (j=0x20; len >= 10 && j < len - 10; j++) {
+  for (j=0x20; len >= 10 && j < len - 10; j = NextAdr(dsdt, j + 1)) {
     if (CmpAdr(dsdt, j, DisplayADR1[VCard])) { //for example 0x00020000=2,0
       devadr = devFind(dsdt, j);  //PEG0@2,0
       if (!devadr) {
@@ -2540,7 +2837,7 @@ UINT32 FIXDisplay (UINT8 *dsdt, UINT32 len, INT32 VCard)
 
   //what if PEG0 is not found?
   if (devadr) {
-    for (j=devadr; j<devadr+devsize; j++) { //search card inside PEG0@0
+    for (j=devadr; j<devadr+devsize; j = NextAdr(dsdt, j + 1)) { //search card inside PEG0@0
       if (CmpAdr(dsdt, j, DisplayADR2[VCard])) { //else DISPLAYFIX==false
         devadr1 = devFind(dsdt, j); //found PEGP
         if (!devadr1) {
@@ -2556,7 +2853,7 @@ UINT32 FIXDisplay (UINT8 *dsdt, UINT32 len, INT32 VCard)
     }
 
     if (!DISPLAYFIX) {
-      for (j=devadr; j<devadr+devsize; j++) { //search card inside PEGP@0
+      for (j=devadr; j<devadr+devsize; j = NextAdr(dsdt, j + 1)) { //search card inside PEGP@0
         if (CmpAdr(dsdt, j, 0xFFFF)) {  //Special case? want to change to 0
           devadr1 = devFind(dsdt, j); //found PEGP
           if (!devadr1) {
@@ -2722,10 +3019,8 @@ Skip_DSM:
   if (!NonUsable) {
     //now insert video
     DBG("now inserting Video device\n");
-    aml_calculate_size(root);
-    display = (__typeof__(display))AllocateZeroPool(root->Size);
-    sizeoffset = root->Size;
-    aml_write_node(root, display, 0);
+    display = (__typeof__(display))AllocateZeroPool(aml_max_size(root));
+    sizeoffset = aml_write_node(root, display, 0);
     aml_destroy_node(root);
 
 
@@ -2812,7 +3107,7 @@ UINT32 AddHDMI (UINT8 *dsdt, UINT32 len)
 
   DBG("Start HDMI Fix\n");
   // Device Address
-  for (i=0x20; len >= 10 && i < len - 10; i++) {
+  for (i=0x20; len >= 10 && i < len - 10; i = NextAdr(dsdt, i + 1)) {
     if (CmpAdr(dsdt, i, HDMIADR1)) {
       devadr = devFind(dsdt, i);
       if (!devadr) {
@@ -2824,7 +3119,7 @@ UINT32 AddHDMI (UINT8 *dsdt, UINT32 len)
       }
       BridgeFound = TRUE;
       if (HDMIADR2 != 0xFFFE){
-        for (k = devadr + 9; k < devadr + BridgeSize; k++) {
+        for (k = devadr + 9; k < devadr + BridgeSize; k = NextAdr(dsdt, k + 1)) {
           if (CmpAdr(dsdt, k, HDMIADR2))
           {
             devadr1 = devFind(dsdt, k);
@@ -2918,10 +3213,8 @@ UINT32 AddHDMI (UINT8 *dsdt, UINT32 len)
   aml_add_buffer(met, dtgp_1, sizeof(dtgp_1));
   // finish Method(_DSM,4,NotSerialized)
 
-  aml_calculate_size(root);
-  hdmi = (__typeof__(hdmi))AllocateZeroPool(root->Size);
-  sizeoffset = root->Size;
-  aml_write_node(root, hdmi, 0);
+  hdmi = (__typeof__(hdmi))AllocateZeroPool(aml_max_size(root));
+  sizeoffset = aml_write_node(root, hdmi, 0);
   aml_destroy_node(root);
   //insert HDAU
   if (BridgeFound) { // bridge or lan
@@ -2981,7 +3274,7 @@ UINT32 FIXNetwork (UINT8 *dsdt, UINT32 len, UINT32 card)
   if (!PCISIZE) return len; //what is the bad DSDT ?!
   NetworkName = FALSE;
   // Network Address
-  for (i = 0x24; len >=10 && i < len - 10; i++) {
+  for (i = 0x24; len >=10 && i < len - 10; i = NextAdr(dsdt, i + 1)) {
     if (CmpAdr(dsdt, i, NetworkADR1[card])) { //0x001C0004
       BrdADR = devFind(dsdt, i);
       if (!BrdADR) {
@@ -2993,7 +3286,7 @@ UINT32 FIXNetwork (UINT8 *dsdt, UINT32 len, UINT32 card)
         continue;
       }
       if (NetworkADR2[card] != 0xFFFE){  //0
-        for (k = BrdADR + 9; k < BrdADR + BridgeSize; k++) {
+        for (k = BrdADR + 9; k < BrdADR + BridgeSize; k = NextAdr(dsdt, k + 1)) {
             if (CmpAdr(dsdt, k, NetworkADR2[card])) {
             NetworkADR = devFind(dsdt, k);
             if (!NetworkADR) {
@@ -3111,14 +3404,12 @@ UINT32 FIXNetwork (UINT8 *dsdt, UINT32 len, UINT32 card)
   aml_add_buffer(met, dtgp_1, sizeof(dtgp_1));
   }
   // finish Method(_DSM,4,NotSerialized)
-  aml_calculate_size(root);
-  network = (__typeof__(network))AllocateZeroPool(root->Size);
+  network = (__typeof__(network))AllocateZeroPool(aml_max_size(root));
   if (!network) {
     return len;
   }
-  sizeoffset = root->Size;
+  sizeoffset = aml_write_node(root, network, 0);
   DBG("network DSM created, size=%X\n", sizeoffset);
-  aml_write_node(root, network, 0);
   aml_destroy_node(root);
   if (NetworkADR) { // bridge or lan
     i = NetworkADR;
@@ -3192,7 +3483,7 @@ UINT32 FIXAirport (UINT8 *dsdt, UINT32 len)
       BridgeSize = get_size(dsdt, BrdADR);
       if(!BridgeSize) continue;
       if (ArptADR2 != 0xFFFE){
-        for (k = BrdADR + 9; k < BrdADR + BridgeSize; k++) {
+        for (k = BrdADR + 9; k < BrdADR + BridgeSize; k = NextAdr(dsdt, k + 1)) {
           if (CmpAdr(dsdt, k, ArptADR2)) {
             ArptADR = devFind(dsdt, k);
             if (!ArptADR) {
@@ -3306,10 +3597,8 @@ UINT32 FIXAirport (UINT8 *dsdt, UINT32 len)
   }
   // finish Method(_DSM,4,NotSerialized)
 
-  aml_calculate_size(root);
-  network = (__typeof__(network))AllocateZeroPool(root->Size);
-  sizeoffset = root->Size;
-  aml_write_node(root, network, 0);
+  network = (__typeof__(network))AllocateZeroPool(aml_max_size(root));
+  sizeoffset = aml_write_node(root, network, 0);
   aml_destroy_node(root);
   DBG("AirportADR=%X add patch size=%X\n", ArptADR, sizeoffset);
 
@@ -3351,7 +3640,7 @@ UINT32 FIXSBUS (UINT8 *dsdt, UINT32 len)
 
   // Find Device SBUS
   if (SBUSADR1) {
-    for (i=0x20; len >= 10 && i < len - 10; i++) {
+    for (i=0x20; len >= 10 && i < len - 10; i = NextAdr(dsdt, i + 1)) {
       if (CmpAdr(dsdt, i, SBUSADR1))
       {
         SBUSADR = devFind(dsdt, i);
@@ -3440,7 +3729,7 @@ UINT32 AddMCHC (UINT8 *dsdt, UINT32 len)
     return len;
   }
   //Find Device MCHC by name
-  for (i=0x20; len >= 10 && i < len - 10; i++) {
+  for (i=0x20; len >= 10 && i < len - 10; i = NextDevName(dsdt, i + 1)) {
     k = CmpDev(dsdt, i, "MCHC");
     if (k != 0) {
       DBG("device name (MCHC) found at %X, don't add!\n", k);
@@ -3487,10 +3776,8 @@ UINT32 AddMCHC (UINT8 *dsdt, UINT32 len)
   aml_add_buffer(met, dtgp_1, sizeof(dtgp_1));
   // finish Method(_DSM,4,NotSerialized)
 */
-  aml_calculate_size(root);
-  mchc = (__typeof__(mchc))AllocateZeroPool(root->Size);
-  sizeoffset = root->Size;
-  aml_write_node(root, mchc, 0);
+  mchc = (__typeof__(mchc))AllocateZeroPool(aml_max_size(root));
+  sizeoffset = aml_write_node(root, mchc, 0);
   aml_destroy_node(root);
   // always add on PCIX back
   PCISIZE = get_size(dsdt, PCIADR);
@@ -3533,7 +3820,7 @@ UINT32 AddIMEI (UINT8 *dsdt, UINT32 len)
   }
   // Find Device IMEI
   if (IMEIADR1) {
-    for (i=0x20; len >= 10 && i < len - 10; i++) {
+    for (i=0x20; len >= 10 && i < len - 10; i = NextAdr(dsdt, i + 1)) {
       if (CmpAdr(dsdt, i, IMEIADR1)) {
         k = devFind(dsdt, i);
         if (k) {
@@ -3545,7 +3832,7 @@ UINT32 AddIMEI (UINT8 *dsdt, UINT32 len)
     }
   }
   //Find Device IMEI by name
-  for (i=0x20; len >= 10 && i < len - 10; i++) {
+  for (i=0x20; len >= 10 && i < len - 10; i = NextDevName(dsdt, i + 1)) {
     k = CmpDev(dsdt, i, "IMEI");
     if (k != 0) {
       MsgLog("device name (IMEI) found at %X, don't add!\n", k);
@@ -3574,10 +3861,8 @@ UINT32 AddIMEI (UINT8 *dsdt, UINT32 len)
   // finish Method(_DSM,4,NotSerialized)
   }
 
-  aml_calculate_size(root);
-  imei = (__typeof__(imei))AllocateZeroPool(root->Size);
-  sizeoffset = root->Size;
-  aml_write_node(root, imei, 0);
+  imei = (__typeof__(imei))AllocateZeroPool(aml_max_size(root));
+  sizeoffset = aml_write_node(root, imei, 0);
   aml_destroy_node(root);
   // always add on PCIX back
   len = move_data(PCIADR+PCISIZE, dsdt, len, sizeoffset);
@@ -3616,7 +3901,7 @@ UINT32 FIXFirewire (UINT8 *dsdt, UINT32 len)
   }
 
   // Firewire Address
-  for (i = 0x20; len >=10 && i < len - 10; i++) {
+  for (i = 0x20; len >=10 && i < len - 10; i = NextAdr(dsdt, i + 1)) {
     if (FirewireADR1 != 0x00000000 &&
         CmpAdr(dsdt, i, FirewireADR1)) {
       BrdADR = devFind(dsdt, i);
@@ -3626,7 +3911,7 @@ UINT32 FIXFirewire (UINT8 *dsdt, UINT32 len)
 
       BridgeSize = get_size(dsdt, BrdADR);
       if (FirewireADR2 != 0xFFFE ){
-        for (k = BrdADR + 9; k < BrdADR + BridgeSize; k++) {
+        for (k = BrdADR + 9; k < BrdADR + BridgeSize; k = NextAdr(dsdt, k + 1)) {
           if (CmpAdr(dsdt, k, FirewireADR2)) {
             FirewireADR = devFind(dsdt, k);
             if (!FirewireADR) {
@@ -3717,10 +4002,8 @@ UINT32 FIXFirewire (UINT8 *dsdt, UINT32 len)
   aml_add_buffer(met, dtgp_1, sizeof(dtgp_1));
   // finish Method(_DSM,4,NotSerialized)
 
-  aml_calculate_size(root);
-  firewire = (__typeof__(firewire))AllocateZeroPool(root->Size);
-  sizeoffset = root->Size;
-  aml_write_node(root, firewire, 0);
+  firewire = (__typeof__(firewire))AllocateZeroPool(aml_max_size(root));
+  sizeoffset = aml_write_node(root, firewire, 0);
   aml_destroy_node(root);
 
   // move data to back for add patch
@@ -3762,7 +4045,7 @@ UINT32 AddHDEF (UINT8 *dsdt, UINT32 len, const MacOsVersion& OSVersion)
 //  len = DeleteDevice("AZAL", dsdt, len);
 
   // HDA Address
-  for (i=0x20; len >= 10 && i < len - 10; i++) {
+  for (i=0x20; len >= 10 && i < len - 10; i = NextAdr(dsdt, i + 1)) {
     if (HDAADR1 != 0x00000000 && HDAFIX &&
         CmpAdr(dsdt, i, HDAADR1)) {
       HDAADR = devFind(dsdt, i);
@@ -3833,10 +4116,8 @@ UINT32 AddHDEF (UINT8 *dsdt, UINT32 len, const MacOsVersion& OSVersion)
         // finish Method(_DSM,4,NotSerialized)
         */
   }
-  aml_calculate_size(root);
-  hdef = (__typeof__(hdef))AllocateZeroPool(root->Size);
-  sizeoffset = root->Size;
-  aml_write_node(root, hdef, 0);
+  hdef = (__typeof__(hdef))AllocateZeroPool(aml_max_size(root));
+  sizeoffset = aml_write_node(root, hdef, 0);
   aml_destroy_node(root);
 
   if (!HDAFIX) { // bridge or device
@@ -3905,12 +4186,9 @@ UINT32 FIXUSB (UINT8 *dsdt, UINT32 len)
   aml_add_local0(met2);
   aml_add_buffer(met, dtgp_1, sizeof(dtgp_1));
   // finish Method(_DSM,4,NotSerialized)
-  aml_calculate_size(root);
-
-  USBDATA1 = (__typeof__(USBDATA1))AllocateZeroPool(root->Size);
-  size1 = root->Size;
+  USBDATA1 = (__typeof__(USBDATA1))AllocateZeroPool(aml_max_size(root));
+  size1 = aml_write_node(root, USBDATA1, 0);
 //  DBG("USB1 code size = 0x%08X\n", size1);
-  aml_write_node(root, USBDATA1, 0);
   aml_destroy_node(root);
 
   // add Method(_DSM,4,NotSerialized) for USB2
@@ -3979,19 +4257,15 @@ UINT32 FIXUSB (UINT8 *dsdt, UINT32 len)
   aml_add_buffer(met1, dtgp_1, sizeof(dtgp_1));
   // finish Method(_DSM,4,NotSerialized)
 
-  aml_calculate_size(root1);
-  USBDATA2 = (__typeof__(USBDATA2))AllocateZeroPool(root1->Size);
-  size2 = root1->Size;
+  USBDATA2 = (__typeof__(USBDATA2))AllocateZeroPool(aml_max_size(root1));
+  size2 = aml_write_node(root1, USBDATA2, 0);
 //  DBG("USB2 code size = 0x%08X\n", size2);
-  aml_write_node(root1, USBDATA2, 0);
   aml_destroy_node(root1);
 
   //NFORCE_USB_START -- already done Intel or NForce same USBDATA2
-/*  aml_calculate_size(root1);
-  USBDATA4 = (__typeof__(USBDATA4))AllocateZeroPool(root1->Size);
-  size4 = root1->Size;
+/*  USBDATA4 = (__typeof__(USBDATA4))AllocateZeroPool(aml_max_size(root1));
+  size4 = aml_write_node(root1, USBDATA4, 0);
   DBG("USB OHCI code size = 0x%08X\n", size4);
-  aml_write_node(root1, USBDATA4, 0);
   aml_destroy_node(root1); */
   //NFORCE_USB_END
 
@@ -4028,11 +4302,9 @@ UINT32 FIXUSB (UINT8 *dsdt, UINT32 len)
   aml_add_buffer(met1, dtgp_1, sizeof(dtgp_1));
   // finish Method(_DSM,4,NotSerialized)
 
-  aml_calculate_size(root1);
-  USBDATA3 = (__typeof__(USBDATA3))AllocateZeroPool(root1->Size);
-  size3 = root1->Size;
+  USBDATA3 = (__typeof__(USBDATA3))AllocateZeroPool(aml_max_size(root1));
+  size3 = aml_write_node(root1, USBDATA3, 0);
 //  DBG("USB3 code size = 0x%08X\n", size3);
-  aml_write_node(root1, USBDATA3, 0);
   aml_destroy_node(root1);
 
   if (usb > 0) {
@@ -4041,7 +4313,7 @@ UINT32 FIXUSB (UINT8 *dsdt, UINT32 len)
       INT32 XhciCount = 1;
       INT32 EhciCount = 0;
       // find USB adr
-      for (j = 0x20; len >= 4 && j < len - 4; j++) {
+      for (j = 0x20; len >= 4 && j < len - 4; j = NextAdr(dsdt, j + 1)) {
         if (CmpAdr(dsdt, j, USBADR[i])) {   //j+4 -> _ADR
           XhciName = FALSE;
           UsbName[i] = (__typeof_am__(UsbName[i]))AllocateZeroPool(5);
@@ -4054,7 +4326,7 @@ UINT32 FIXUSB (UINT8 *dsdt, UINT32 len)
           Size = get_size(dsdt, adr1); //bridgesize
           DBG("USB bridge[%X] at %X, size = %X\n", USBADR[i], adr1, Size);
           if (USBADR2[i] != 0xFFFE ){
-            for (k = adr1 + 9; k < adr1 + Size; k++) {
+            for (k = adr1 + 9; k < adr1 + Size; k = NextAdr(dsdt, k + 1)) {
               if (CmpAdr(dsdt, k, USBADR2[i])) {
                 adr = devFind(dsdt, k);
                 if (!adr) {
@@ -4269,7 +4541,7 @@ UINT32 FIXIDE (UINT8 *dsdt, UINT32 len)
 
   if (!IDEADR1) return len;
 
-  for (i=0x20; len >= 10 && i < len - 10; i++) {
+  for (i=0x20; len >= 10 && i < len - 10; i = NextAdr(dsdt, i + 1)) {
     if (CmpAdr(dsdt, i, IDEADR1)) {
               DBG("Found IDEADR1=%X at %X\n", IDEADR1, i);
       IDEADR = devFind(dsdt, i);
@@ -4284,7 +4556,7 @@ UINT32 FIXIDE (UINT8 *dsdt, UINT32 len)
   if (!BridgeSize) return len;
   DBG("Start IDE Fix\n");
   // find Name(_ADR, Zero) if yes, don't need to inject PATA name
-  for (j=IDEADR+9; j<IDEADR+BridgeSize; j++)
+  for (j=IDEADR+9; j<IDEADR+BridgeSize; j = NextAdr(dsdt, j + 1))
   {
     if (CmpAdr(dsdt, j, 0))
     {
@@ -4375,10 +4647,8 @@ UINT32 FIXIDE (UINT8 *dsdt, UINT32 len)
   }
   // finish Method(_DSM,4,NotSerialized)
 
-  aml_calculate_size(root);
-  ide = (__typeof__(ide))AllocateZeroPool(root->Size);
-  sizeoffset = root->Size;
-  aml_write_node(root, ide, 0);
+  ide = (__typeof__(ide))AllocateZeroPool(aml_max_size(root));
+  sizeoffset = aml_write_node(root, ide, 0);
   aml_destroy_node(root);
     // move data to back for add DSM
   j = IDEADR + BridgeSize;
@@ -4426,7 +4696,7 @@ UINT32 FIXSATAAHCI (UINT8 *dsdt, UINT32 len)
 
   if (!SATAAHCIADR1) return len;
 
-  for (i=0x20; len >= 10 && i < len - 10; i++) {
+  for (i=0x20; len >= 10 && i < len - 10; i = NextAdr(dsdt, i + 1)) {
     if (CmpAdr(dsdt, i, SATAAHCIADR1)) {
  //          DBG("Found SATAAHCIADR1=%X at %X\n", SATAAHCIADR1, i);
       SATAAHCIADR = devFind(dsdt, i);
@@ -4480,10 +4750,8 @@ UINT32 FIXSATAAHCI (UINT8 *dsdt, UINT32 len)
   }
   // finish Method(_DSM,4,NotSerialized)
 
-  aml_calculate_size(root);
-  sata = (__typeof__(sata))AllocateZeroPool(root->Size);
-  sizeoffset = root->Size;
-  aml_write_node(root, sata, 0);
+  sata = (__typeof__(sata))AllocateZeroPool(aml_max_size(root));
+  sizeoffset = aml_write_node(root, sata, 0);
   aml_destroy_node(root);
     // move data to back for add DSM
   BridgeSize = get_size(dsdt, SATAAHCIADR);
@@ -4520,7 +4788,7 @@ UINT32 FIXSATA (UINT8 *dsdt, UINT32 len)
 
   if (!SATAADR1) return len;
 
-  for (i=0x20; len >= 10 && i < len - 10; i++) {
+  for (i=0x20; len >= 10 && i < len - 10; i = NextAdr(dsdt, i + 1)) {
     if (CmpAdr(dsdt, i, SATAADR1)) {
       //        DBG("Found SATAAHCIADR1=%X at %X\n", SATAAHCIADR1, j);
       SATAADR = devFind(dsdt, i);
@@ -4571,10 +4839,8 @@ UINT32 FIXSATA (UINT8 *dsdt, UINT32 len)
   }
   // finish Method(_DSM,4,NotSerialized)
 
-  aml_calculate_size(root);
-  sata = (__typeof__(sata))AllocateZeroPool(root->Size);
-  sizeoffset = root->Size;
-  aml_write_node(root, sata, 0);
+  sata = (__typeof__(sata))AllocateZeroPool(aml_max_size(root));
+  sizeoffset = aml_write_node(root, sata, 0);
   aml_destroy_node(root);
   // move data to back for add DSM
   BridgeSize = get_size(dsdt, SATAADR);
@@ -4817,7 +5083,7 @@ UINT32 FIXPWRB (UINT8* dsdt, UINT32 len)
   CHAR8 Name[4];
   INT32 sizeoffset;
   //search  PWRB PNP0C0C
-  for (i=0x20; i<len-6; i++) {
+  for (i=0x20; i<len-6; i = NextHid(dsdt, i + 1)) {
     if (CmpPNP(dsdt, i, 0x0C0C)) {
       adr = devFind(dsdt, i);
       if (!adr) {
@@ -4912,7 +5178,7 @@ UINT32 FIXOTHER (UINT8 *dsdt, UINT32 len)
 
   // Fix USB _PRW value for 0x0X, 0x04 ==> 0x0X, 0x01
   for(j=0; j<usb; j++) {
-    for (i=0; i<len-5; i++) {
+    for (i=0; i<len-5; i = NextAdr(dsdt, i + 1)) {
       if (CmpAdr(dsdt, i, USBADR[j])) {
           // get USB name
           UsbName[j] = (__typeof__(UsbName[j]))AllocateZeroPool(5);
@@ -5241,101 +5507,387 @@ BOOLEAN CmpFullName(UINT8* Table, UINTN Len, ACPI_NAME_LIST *Bridge)
   return TRUE;
 }
 
+// TRUE if the name at adr belongs to the Bridge: a long name like "RP02.PXSX"
+// or an outer Device or Scope with the full name of the bridge
+static BOOLEAN IsNameInBridge(UINT8* table, UINTN len, INTN adr, ACPI_NAME_LIST *Bridge)
+{
+  INTN i;
+  INTN k=0; // Clang complain about possible use uninitialised. Not true, but I don't like warnings.
+  INTN size;
+  BOOLEAN found;
+
+  if (!Bridge || (FindBin(table + adr - 4, 5, (const UINT8*)(Bridge->Name), 4) == 0)) { // long name like "RP02.PXSX"
+    return TRUE;
+  }
+  //find outer device or scope
+  i = adr;
+  while ((i > 0) && isACPI_Char(table[i])) i--; //skip attached name
+  i -= 6;  //skip size and device field
+//     DBG("search for bridge since %d\n", adr);
+  while (i > 0x20) {  //find devices that previous to adr
+    found = FALSE;
+    //check device
+    if ((table[i] == 0x5B) && (table[i + 1] == 0x82) && !CmpNum(table, (INT32)i, TRUE)) { //device candidate
+      k = i + 2;
+      found = TRUE;
+    }
+    //check scope
+
+    if ((table[i] == 0x10) && !CmpNum(table, (INT32)i, TRUE)) {
+      k = i + 1;
+      found = TRUE;
+    }
+    if (found) {  // i points to Device or Scope
+      size = get_size(table, (UINT32)(UINTN)k); //k points to size  //        DBG("found bridge candidate 0x%X size %d\n", table[i], size);
+      if (size) {
+        if ((k + size) > (adr + 4)) {  //Yes - it is outer
+ //            DBG("found Bridge device begin=%X end=%X\n", k, k+size);
+          if (table[k] < 0x40) {
+            k += 1;
+          }
+          else if ((table[k] & 0x40) != 0) {
+            k += 2;
+          }
+          else if ((table[k] & 0x80) != 0) {
+            k += 3;
+          } //now k points to the outer name
+          if (CmpFullName(table + k, len - k, Bridge)) {
+            DBG("found Bridge device begin=%llX end=%llX\n", k, k+size);
+            return TRUE; //cancel search outer bridge, we found it.
+          }
+        }  //else not an outer device
+      } //else wrong size field - not a device
+    } //else not a device or scope
+    i--;
+  }  //while find outer bridge
+  return FALSE;
+}
+
+// renames of DeviceRename[First..First+Count) with one scan of the table for all their names
+// a hit goes to the first rename of the list with this name and in its bridge
+static INTN RenameDevicesInPass(UINT8* table, UINTN len, UINTN First, UINTN Count)
+{
+  AcpiPatternSet Names;
+  XArray<ACPI_PATTERN_HIT> Hits;
+  ACPI_NAME_LIST *List;
+  UINTN index;
+  size_t h, n;
+  INTN Num = 0;
+
+  for (index = First; index < First + Count; index++) {
+    List = gSettings.DeviceRename[index].Next;
+    for (n = 0; n < Names.GetCount(); n++) {
+      if (CompareMem(Names.GetFind(n), List->Name, 4) == 0) {
+        break;
+      }
+    }
+    if (n == Names.GetCount() && !Names.Add((const UINT8*)List->Name, NULL, 4)) {
+      return -1;
+    }
+  }
+  if (!Names.Build()) {
+    return -1;
+  }
+  //a name is never in the header, and as FindBin the last byte is excluded
+  Names.FindAll(table, sizeof(EFI_ACPI_DESCRIPTION_HEADER), (UINT32)len - 1, Hits);
+  for (h = 0; h < Hits.size(); h++) {
+    const ACPI_PATTERN_HIT& Hit = Hits.ElementAt(h);
+    for (index = First; index < First + Count; index++) {
+      List = gSettings.DeviceRename[index].Next;
+      if (CompareMem(Names.GetFind(Hit.Pattern), List->Name, 4) != 0) {
+        continue;
+      }
+//      DBG("found Name @ 0x%X\n", Hit.Pos);
+      if (IsNameInBridge(table, len, Hit.Pos, List->Next)) {
+        CopyMem(table + Hit.Pos, gSettings.DeviceRename[index].Name, 4);
+        Num++;
+        break;
+      }
+    }
+  }
+  return Num;
+}
+
 void RenameDevices(UINT8* table)
 {
   ACPI_NAME_LIST *List;
-  ACPI_NAME_LIST *Bridge;
   CHAR8 *Replace;
-  CHAR8 *Find;
+  UINTN index, index2;
+  UINTN len = ((EFI_ACPI_DESCRIPTION_HEADER*)table)->Length;
+  INTN Num = 0, Renamed;
+  BOOLEAN OnePass = TRUE;
 
   if ( gSettings.DeviceRenameCount <= 0 ) return; // to avoid message "0 replacement"
+  if (len <= sizeof(EFI_ACPI_DESCRIPTION_HEADER)) return;
 
-  INTN i;
-  INTN k=0; // Clang complain about possible use uninitialised. Not true, but I don't like warnings.
-  UINTN index;
-  INTN size;
-  UINTN len = ((EFI_ACPI_DESCRIPTION_HEADER*)table)->Length;
-  INTN adr, shift, Num = 0;
-  BOOLEAN found;
   for (index = 0; index < gSettings.DeviceRenameCount; index++) {
     List = gSettings.DeviceRename[index].Next;
     Replace = gSettings.DeviceRename[index].Name;
-    Find = List->Name;
-    Bridge = List->Next;
-    MsgLog("Name: %s, Bridge: %s, Replace: %s\n", Find, Bridge->Name, Replace);
-    adr = 0;
-    do
-    {
-
-      shift = FindBin(table + adr, (UINT32)(len - adr), (const UINT8*)Find, 4); //next occurence
-      if (shift < 0) {
-        break; //not found
-      }
-      adr += shift;
-//      DBG("found Name @ 0x%X\n", adr);
-      if (!Bridge || (FindBin(table + adr - 4, 5, (const UINT8*)(Bridge->Name), 4) == 0)) { // long name like "RP02.PXSX"
-        CopyMem(table + adr, Replace, 4);
-        adr += 5; //at least, it is impossible to see  PXSXPXSX
-//        DBG("replaced\n");
-        Num++;
-        continue;
-      }
-      //find outer device or scope
-      i = adr;
-      while ((i > 0) && isACPI_Char(table[i])) i--; //skip attached name
-      i -= 6;  //skip size and device field
- //     DBG("search for bridge since %d\n", adr);
-      while (i > 0x20) {  //find devices that previous to adr
-        found = FALSE;
-        //check device
-        if ((table[i] == 0x5B) && (table[i + 1] == 0x82) && !CmpNum(table, (INT32)i, TRUE)) { //device candidate
-          k = i + 2;
-          found = TRUE;
+    MsgLog("Name: %s, Bridge: %s, Replace: %s\n", List->Name, List->Next->Name, Replace);
+    //a new name that is searched by another rename makes the order of the renames matter
+    for (index2 = 0; index2 < gSettings.DeviceRenameCount; index2++) {
+      for (List = gSettings.DeviceRename[index2].Next; List; List = List->Next) {
+        if (CompareMem(List->Name, Replace, 4) == 0) {
+          OnePass = FALSE;
         }
-        //check scope
+      }
+    }
+  }
 
-        if ((table[i] == 0x10) && !CmpNum(table, (INT32)i, TRUE)) {
-          k = i + 1;
-          found = TRUE;
-        }
-        if (found) {  // i points to Device or Scope
-          size = get_size(table, (UINT32)(UINTN)k); //k points to size  //        DBG("found bridge candidate 0x%X size %d\n", table[i], size);
-          if (size) {
-            if ((k + size) > (adr + 4)) {  //Yes - it is outer
-     //            DBG("found Bridge device begin=%X end=%X\n", k, k+size);
-              if (table[k] < 0x40) {
-                k += 1;
-              }
-              else if ((table[k] & 0x40) != 0) {
-                k += 2;
-              }
-              else if ((table[k] & 0x80) != 0) {
-                k += 3;
-              } //now k points to the outer name
-              if (CmpFullName(table + k, len - k, Bridge)) {
-                CopyMem(table + adr, Replace, 4);
-                adr += 5;
-				  DBG("found Bridge device begin=%llX end=%llX\n", k, k+size);
-    //            DBG("   name copied\n");
-                Num++;
-                break; //cancel search outer bridge, we found it.
-              }
-            }  //else not an outer device
-          } //else wrong size field - not a device
-        } //else not a device or scope
-        i--;
-      }  //while find outer bridge
-      adr += 5;
-    } while (1); //next occurence
-  }   //DeviceRenameCount
+  Renamed = OnePass ? RenameDevicesInPass(table, len, 0, gSettings.DeviceRenameCount) : -1;
+  if (Renamed >= 0) {
+    Num = Renamed;
+  } else {
+    for (index = 0; index < gSettings.DeviceRenameCount; index++) {
+      Renamed = RenameDevicesInPass(table, len, index, 1);
+      if (Renamed > 0) {
+        Num += Renamed;
+      }
+    }
+  }
 	MsgLog("  %lld replacements\n", Num);
 }
 
+//
+// With Boot/DsdtCache, the result of FixBiosDsdt() is kept in misc\DsdtCache.bin: the patched DSDT and
+// the ACPI CPU names found in it. The key is the CRC32 of the DSDT given to FixBiosDsdt(), the CRC32 of
+// config.plist, the PCI devices, the CPU, the FixDsdt mask and the OS version. A hit skips the patches
+// and the fixes. Options changed in the GUI are not in the key, ApplyInputs() turns the cache off.
+//
+#define DSDT_CACHE_FILE       L"misc\\DsdtCache.bin"
+#define DSDT_CACHE_SIGNATURE  SIGNATURE_32('D', 'S', 'C', 'H')
+#define DSDT_CACHE_VERSION    1
+#define DSDT_CACHE_MAX        4     // one per OS version booted, roughly
+#define DSDT_CACHE_MAX_KEY    256
+
+typedef struct {
+  UINT32  Signature;
+  UINT32  Version;
+  UINT32  Count;
+  UINT32  Reserved;
+} DSDT_CACHE_HEADER;
+
+typedef struct {
+  UINT32  KeyLength;
+  UINT32  DsdtLength;
+  UINT32  DsdtCrc32;
+  UINT32  CpuCount;
+  // followed by the key, the DSDT, CpuCount names of 4 chars, CpuCount ids and the score (128 bytes)
+} DSDT_CACHE_RECORD;
+
+#define DSDT_CACHE_SCORE  128
+
+class DSDT_CACHE_ENTRY
+{
+public:
+  XBuffer<UINT8>  Key;
+  XBuffer<UINT8>  Dsdt;
+  UINT32          DsdtCrc32;
+  XBuffer<UINT8>  CpuNames;
+  XBuffer<UINT8>  CpuIds;
+  XBuffer<UINT8>  CpuScore;
+
+  DSDT_CACHE_ENTRY() : Key(), Dsdt(), DsdtCrc32(0), CpuNames(), CpuIds(), CpuScore() {}
+  DSDT_CACHE_ENTRY(const DSDT_CACHE_ENTRY& other) = delete; // Can be defined if needed
+  const DSDT_CACHE_ENTRY& operator = ( const DSDT_CACHE_ENTRY & ) = delete; // Can be defined if needed
+};
+
+static XObjArray<DSDT_CACHE_ENTRY> DsdtCache;
+static BOOLEAN                     DsdtCacheLoaded = FALSE;
+
+static void DsdtCacheLoad(void)
+{
+  EFI_STATUS          Status;
+  UINT8               *Data = NULL;
+  UINTN               DataSize = 0;
+  UINTN               Offset;
+  UINT32              Index;
+  DSDT_CACHE_HEADER   *Header;
+  DSDT_CACHE_RECORD   *Record;
+
+  if (DsdtCacheLoaded) {
+    return;
+  }
+  DsdtCacheLoaded = TRUE;
+  DsdtCache.setEmpty();
+
+  Status = egLoadFile(&self.getCloverDir(), DSDT_CACHE_FILE, &Data, &DataSize);
+  if (EFI_ERROR(Status)) {
+    MsgLog("DSDT cache: %s\n", efiStrError(Status));
+    return;
+  }
+  Header = (DSDT_CACHE_HEADER *)Data;
+  if (DataSize < sizeof(DSDT_CACHE_HEADER) || Header->Signature != DSDT_CACHE_SIGNATURE ||
+      Header->Version != DSDT_CACHE_VERSION) {
+    MsgLog("DSDT cache: bad file\n");
+    FreePool(Data);
+    return;
+  }
+
+  Offset = sizeof(DSDT_CACHE_HEADER);
+  for (Index = 0; Index < Header->Count; Index++) {
+    if (DataSize - Offset < sizeof(DSDT_CACHE_RECORD)) {
+      break;
+    }
+    Record = (DSDT_CACHE_RECORD *)(Data + Offset);
+    Offset += sizeof(DSDT_CACHE_RECORD);
+    if (Record->KeyLength > DSDT_CACHE_MAX_KEY || Record->DsdtLength > 1000000 || Record->CpuCount > acpi_cpu_max ||
+        DataSize - Offset < (UINTN)Record->KeyLength + Record->DsdtLength + Record->CpuCount * 5 + DSDT_CACHE_SCORE) {
+      break;
+    }
+    DSDT_CACHE_ENTRY* Entry = new DSDT_CACHE_ENTRY;
+    Entry->DsdtCrc32 = Record->DsdtCrc32;
+    Entry->Key.ncpy(Data + Offset, Record->KeyLength);
+    Offset += Record->KeyLength;
+    Entry->Dsdt.ncpy(Data + Offset, Record->DsdtLength);
+    Offset += Record->DsdtLength;
+    Entry->CpuNames.ncpy(Data + Offset, Record->CpuCount * 4);
+    Offset += Record->CpuCount * 4;
+    Entry->CpuIds.ncpy(Data + Offset, Record->CpuCount);
+    Offset += Record->CpuCount;
+    Entry->CpuScore.ncpy(Data + Offset, DSDT_CACHE_SCORE);
+    Offset += DSDT_CACHE_SCORE;
+    DsdtCache.AddReference(Entry, true);
+  }
+  FreePool(Data);
+}
+
+static void DsdtCacheSave(void)
+{
+  EFI_STATUS          Status;
+  XBuffer<UINT8>      Data;
+  DSDT_CACHE_HEADER   Header;
+  DSDT_CACHE_RECORD   Record;
+  size_t              Index;
+
+  ZeroMem(&Header, sizeof(Header));
+  Header.Signature = DSDT_CACHE_SIGNATURE;
+  Header.Version = DSDT_CACHE_VERSION;
+  Header.Count = (UINT32)DsdtCache.size();
+  Data.ncat(&Header, sizeof(Header));
+  for (Index = 0; Index < DsdtCache.size(); Index++) {
+    const DSDT_CACHE_ENTRY& Entry = DsdtCache[Index];
+    Record.KeyLength = (UINT32)Entry.Key.size();
+    Record.DsdtLength = (UINT32)Entry.Dsdt.size();
+    Record.DsdtCrc32 = Entry.DsdtCrc32;
+    Record.CpuCount = (UINT32)Entry.CpuIds.size();
+    Data.ncat(&Record, sizeof(Record));
+    Data.ncat(Entry.Key.data(), Entry.Key.size());
+    Data.ncat(Entry.Dsdt.data(), Entry.Dsdt.size());
+    Data.ncat(Entry.CpuNames.data(), Entry.CpuNames.size());
+    Data.ncat(Entry.CpuIds.data(), Entry.CpuIds.size());
+    Data.ncat(Entry.CpuScore.data(), Entry.CpuScore.size());
+  }
+  Status = egSaveFile(&self.getCloverDir(), DSDT_CACHE_FILE, Data.data(), Data.size());
+  MsgLog("DSDT cache: saved %zu entries: %s\n", DsdtCache.size(), efiStrError(Status));
+}
+
+static void DsdtCacheKey(XBuffer<UINT8>& Key, const UINT8* Dsdt, UINT32 Length, const MacOsVersion& OSVersion)
+{
+  UINT32    DsdtCrc32 = GetCrc32(Dsdt, Length);
+  XString8  Version = OSVersion.asString();
+
+  Key.setEmpty();
+  Key.cat(Length);
+  Key.cat(DsdtCrc32);
+  Key.cat(gConfigCrc32);
+  Key.cat(HardwareCrc32);
+  Key.cat(gCPUStructure.Signature);
+  Key.cat(gCPUStructure.Family);
+  Key.cat(gSettings.FixDsdt);
+  Key.ncat(Version.c_str(), Version.sizeInBytes());
+}
+
+static DSDT_CACHE_ENTRY* DsdtCacheFind(const XBuffer<UINT8>& Key)
+{
+  for (size_t Index = 0; Index < DsdtCache.size(); Index++) {
+    DSDT_CACHE_ENTRY& Entry = DsdtCache[Index];
+    if (Entry.Key.size() == Key.size() && CompareMem(Entry.Key.data(), Key.data(), Key.size()) == 0) {
+      return &Entry;
+    }
+  }
+  return NULL;
+}
+
+// FixBiosDsdt() from the cache. The DSDT buffer is the one the cached result was made in,
+// allocated by the caller with the same size.
+static BOOLEAN DsdtCacheGet(const XBuffer<UINT8>& Key, UINT8* Dsdt)
+{
+  DSDT_CACHE_ENTRY  *Entry;
+  UINT32            Crc32 = 0;
+  UINT32            Length = ((EFI_ACPI_DESCRIPTION_HEADER*)Dsdt)->Length;
+  UINT32            i;
+
+  DsdtCacheLoad();
+  Entry = DsdtCacheFind(Key);
+  if (Entry == NULL) {
+    return FALSE;
+  }
+  Crc32 = GetCrc32(Entry->Dsdt.data(), Entry->Dsdt.size());
+  if (Entry->Dsdt.size() < sizeof(EFI_ACPI_DESCRIPTION_HEADER) || Crc32 != Entry->DsdtCrc32 ||
+      Entry->Dsdt.size() > EFI_PAGES_TO_SIZE(EFI_SIZE_TO_PAGES(Length + Length / 8))) {
+    MsgLog("DSDT cache: bad entry\n");
+    return FALSE;
+  }
+  CopyMem(Dsdt, Entry->Dsdt.data(), Entry->Dsdt.size());
+
+  // what findCPU() found
+  if (acpi_cpu_score) {
+    FreePool(acpi_cpu_score);
+  }
+  acpi_cpu_score = (__typeof__(acpi_cpu_score))AllocateZeroPool(DSDT_CACHE_SCORE);
+  CopyMem(acpi_cpu_score, Entry->CpuScore.data(), DSDT_CACHE_SCORE - 1);
+  acpi_cpu_count = (UINT8)Entry->CpuIds.size();
+  for (i = 0; i < acpi_cpu_count; i++) {
+    acpi_cpu_name[i] = (__typeof_am__(acpi_cpu_name[i]))AllocateZeroPool(5);
+    CopyMem(acpi_cpu_name[i], Entry->CpuNames.data() + i * 4, 4);
+    acpi_cpu_processor_id[i] = Entry->CpuIds[i];
+  }
+  if (!acpi_cpu_count) {
+    DefaultCpuNames();
+  }
+  MsgLog("DSDT cache: hit, %zu bytes\n", Entry->Dsdt.size());
+  return TRUE;
+}
+
+// remember the result of FixBiosDsdt()
+static void DsdtCachePut(const XBuffer<UINT8>& Key, const UINT8* Dsdt)
+{
+  DSDT_CACHE_ENTRY  *Entry;
+  UINT32            Length = ((EFI_ACPI_DESCRIPTION_HEADER*)Dsdt)->Length;
+  UINT32            i;
+
+  if (Key.size() > DSDT_CACHE_MAX_KEY || acpi_cpu_score == NULL) {
+    return;
+  }
+  DsdtCacheLoad();
+  Entry = DsdtCacheFind(Key);
+  if (Entry == NULL) {
+    if (DsdtCache.size() >= DSDT_CACHE_MAX) {
+      DsdtCache.RemoveAtIndex((size_t)0); // the oldest
+    }
+    Entry = new DSDT_CACHE_ENTRY;
+    Entry->Key = Key;
+    DsdtCache.AddReference(Entry, true);
+  }
+  Entry->Dsdt.ncpy(Dsdt, Length);
+  Entry->DsdtCrc32 = GetCrc32(Dsdt, Length);
+  Entry->CpuNames.setEmpty();
+  Entry->CpuIds.setEmpty();
+  for (i = 0; i < acpi_cpu_count; i++) {
+    Entry->CpuNames.ncat(acpi_cpu_name[i], 4);
+    Entry->CpuIds.cat(acpi_cpu_processor_id[i]);
+  }
+  Entry->CpuScore.ncpy(acpi_cpu_score, DSDT_CACHE_SCORE);
+  DsdtCacheSave();
+}
+
 void FixBiosDsdt(UINT8* temp, EFI_ACPI_2_0_FIXED_ACPI_DESCRIPTION_TABLE* fadt, const MacOsVersion& OSVersion)
 {
   UINT32 DsdtLen;
-
-  UINTN i;
+  UINT64 PatchStart;
+  DsdtPatchPlan Plan;
+  XBuffer<UINT8> CacheKey;
 
   if (!temp) {
     return;
@@ -5358,45 +5910,41 @@ void FixBiosDsdt(UINT8* temp, EFI_ACPI_2_0_FIXED_ACPI_DESCRIPTION_TABLE* fadt, c
   // First check hardware address: GetPciADR(DevicePath, &NetworkADR1, &NetworkADR2);
   CheckHardware();
 
+  if (GlobalConfig.DsdtCache) {
+    DsdtCacheKey(CacheKey, temp, DsdtLen, OSVersion);
+    if (DsdtCacheGet(CacheKey, temp)) {
+      return;
+    }
+  }
+
   //arbitrary fixes
+  PatchStart = AsmReadTsc();
   if (gSettings.DSDTPatchArray.size() > 0) {
+    DsdtFixSpan Span("DsdtPatches");
     MsgLog("Patching DSDT:\n");
-    for (i = 0; i < gSettings.DSDTPatchArray.size(); i++) {
-      if ( gSettings.DSDTPatchArray[i].PatchDsdtFind.isEmpty() ) {
-        continue;
-      }
-
-      MsgLog(" - [%s]:", gSettings.DSDTPatchArray[i].PatchDsdtLabel.c_str()); //yyyy
-      if (gSettings.DSDTPatchArray[i].PatchDsdtMenuItem.BValue) {
-        if (gSettings.DSDTPatchArray[i].PatchDsdtTgt.isEmpty()) {
-              DsdtLen = FixAny(temp, DsdtLen,
-                           gSettings.DSDTPatchArray[i].PatchDsdtFind,
-                           gSettings.DSDTPatchArray[i].PatchDsdtReplace);
-
-        }else{
-    //      DBG("Patching: renaming in bridge\n");
-          DsdtLen = FixRenameByBridge2(temp, DsdtLen,
-                           gSettings.DSDTPatchArray[i].PatchDsdtTgt,
-                           gSettings.DSDTPatchArray[i].PatchDsdtFind,
-                           gSettings.DSDTPatchArray[i].PatchDsdtReplace);
-
-        }
-      } else {
-        MsgLog(" disabled\n");
-      }
-    }
+    Plan.Build();
+    DsdtLen = Plan.Apply(temp, DsdtLen, TRUE);
   }
 
   //renaming Devices
-  RenameDevices(temp);
+  {
+    DsdtFixSpan Span("RenameDevices");
+    RenameDevices(temp);
+  }
+  MsgLog("DSDT patched in %llu us\n", AcpiPatchTime(PatchStart));
+
+  // from here the helpers search the index instead of the whole table
+  gDsdtIndex.Build(temp, DsdtLen);
 
   // find ACPI CPU name and hardware address
   findCPU(temp, DsdtLen);
 
   // add Method (DTGP, 5, NotSerialized)
   if ((gSettings.FixDsdt & FIX_DTGP)) {
+    DsdtFixSpan Span("FIX_DTGP");
     if (!FindMethod(temp, DsdtLen, "DTGP")) {
       CopyMem((CHAR8 *)temp+DsdtLen, dtgp, sizeof(dtgp));
+      gDsdtIndex.Changed(DsdtLen, DsdtLen + sizeof(dtgp), DsdtLen + sizeof(dtgp));
       DsdtLen += sizeof(dtgp);
       ((EFI_ACPI_DESCRIPTION_HEADER*)temp)->Length = DsdtLen;
     }
@@ -5407,36 +5955,42 @@ void FixBiosDsdt(UINT8* temp, EFI_ACPI_2_0_FIXED_ACPI_DESCRIPTION_TABLE* fadt, c
 
   // Fix RTC
   if ((gSettings.FixDsdt & FIX_RTC)) {
+    DsdtFixSpan Span("FIX_RTC");
  //   DBG("patch RTC in DSDT \n");
     DsdtLen = FixRTC(temp, DsdtLen);
   }
 
   // Fix TMR
   if ((gSettings.FixDsdt & FIX_TMR))  {
+    DsdtFixSpan Span("FIX_TMR");
 //    DBG("patch TMR in DSDT \n");
     DsdtLen = FixTMR(temp, DsdtLen);
   }
 
   // Fix PIC or IPIC
   if ((gSettings.FixDsdt & FIX_IPIC) != 0) {
+    DsdtFixSpan Span("FIX_IPIC");
 //    DBG("patch IPIC in DSDT \n");
     DsdtLen = FixPIC(temp, DsdtLen);
   }
 
   // Fix HPET
   if ((gSettings.FixDsdt & FIX_HPET) != 0) {
+    DsdtFixSpan Span("FIX_HPET");
 //    DBG("patch HPET in DSDT \n");
     DsdtLen = FixHPET(temp, DsdtLen);
   }
 
   // Fix LPC if don't had HPET don't need to inject LPC??
   if (LPCBFIX && (gCPUStructure.Family == 0x06)  && (gSettings.FixDsdt & FIX_LPC)) {
+    DsdtFixSpan Span("FIX_LPC");
 //    DBG("patch LPC in DSDT \n");
     DsdtLen = FIXLPCB(temp, DsdtLen);
   }
 
   // Fix Display
   if ((gSettings.FixDsdt & FIX_DISPLAY) || (gSettings.FixDsdt & FIX_INTELGFX)) {
+    DsdtFixSpan Span("FIX_DISPLAY");
     INT32 j;
     for (j=0; j<4; ++j) {
       if (DisplayADR1[j]) {
@@ -5451,6 +6005,7 @@ void FixBiosDsdt(UINT8* temp, EFI_ACPI_2_0_FIXED_ACPI_DESCRIPTION_TABLE* fadt, c
 
   // Fix Network
   if ((gSettings.FixDsdt & FIX_LAN)) {
+    DsdtFixSpan Span("FIX_LAN");
 //    DBG("patch LAN in DSDT \n");
     UINT32 j;
     for (j = 0; j <= net_count; ++j) {
@@ -5463,66 +6018,78 @@ void FixBiosDsdt(UINT8* temp, EFI_ACPI_2_0_FIXED_ACPI_DESCRIPTION_TABLE* fadt, c
 
   // Fix Airport
   if (ArptADR1 && (gSettings.FixDsdt & FIX_WIFI)) {
+    DsdtFixSpan Span("FIX_WIFI");
 //    DBG("patch Airport in DSDT \n");
     DsdtLen = FIXAirport(temp, DsdtLen);
   }
 
   // Fix SBUS
   if (SBUSADR1  && (gSettings.FixDsdt & FIX_SBUS)) {
+    DsdtFixSpan Span("FIX_SBUS");
 //    DBG("patch SBUS in DSDT \n");
     DsdtLen = FIXSBUS(temp, DsdtLen);
   }
 
   // Fix IDE inject
   if (IDEFIX && (IDEVENDOR == 0x8086 || IDEVENDOR == 0x11ab)  && (gSettings.FixDsdt & FIX_IDE)) {
+    DsdtFixSpan Span("FIX_IDE");
 //    DBG("patch IDE in DSDT \n");
     DsdtLen = FIXIDE(temp, DsdtLen);
   }
 
   // Fix SATA AHCI orange icon
   if (SATAAHCIADR1 && (SATAAHCIVENDOR == 0x8086)  && (gSettings.FixDsdt & FIX_SATA)) {
+    DsdtFixSpan Span("FIX_SATA_AHCI");
     DBG("patch AHCI in DSDT \n");
     DsdtLen = FIXSATAAHCI(temp, DsdtLen);
   }
 
   // Fix SATA inject
   if (SATAFIX && (SATAVENDOR == 0x8086)  && (gSettings.FixDsdt & FIX_SATA)) {
+    DsdtFixSpan Span("FIX_SATA");
     DBG("patch SATA in DSDT \n");
     DsdtLen = FIXSATA(temp, DsdtLen);
   }
 
   // Fix Firewire
   if (FirewireADR1  && (gSettings.FixDsdt & FIX_FIREWIRE)) {
+    DsdtFixSpan Span("FIX_FIREWIRE");
     DBG("patch FRWR in DSDT \n");
     DsdtLen = FIXFirewire(temp, DsdtLen);
   }
 
   // HDA HDEF
   if (HDAFIX  && (gSettings.FixDsdt & FIX_HDA)) {
+    DsdtFixSpan Span("FIX_HDA");
     DBG("patch HDEF in DSDT \n");
     DsdtLen = AddHDEF(temp, DsdtLen, OSVersion);
   }
 
   //Always add MCHC for PM
   if ((gCPUStructure.Family == 0x06)  && (gSettings.FixDsdt & FIX_MCHC)) {
+    DsdtFixSpan Span("FIX_MCHC");
 //    DBG("patch MCHC in DSDT \n");
     DsdtLen = AddMCHC(temp, DsdtLen);
   }
   //add IMEI
   if ((gSettings.FixDsdt & FIX_IMEI)) {
+    DsdtFixSpan Span("FIX_IMEI");
     DsdtLen = AddIMEI(temp, DsdtLen);
   }
   //Add HDMI device
   if ((gSettings.FixDsdt & FIX_HDMI)) {
+    DsdtFixSpan Span("FIX_HDMI");
     DsdtLen = AddHDMI(temp, DsdtLen);
   }
 
   // Always Fix USB
   if ((gSettings.FixDsdt & FIX_USB)) {
+    DsdtFixSpan Span("FIX_USB");
     DsdtLen = FIXUSB(temp, DsdtLen);
   }
 
   if ((gSettings.FixDsdt & FIX_WAK)){
+    DsdtFixSpan Span("FIX_WAK");
     // Always Fix _WAK Return value
     DsdtLen = FIXWAK(temp, DsdtLen, fadt);
   }
@@ -5536,6 +6103,7 @@ void FixBiosDsdt(UINT8* temp, EFI_ACPI_2_0_FIXED_ACPI_DESCRIPTION_TABLE* fadt, c
     // USB Device remove error Fix
    // DsdtLen = FIXGPE(temp, DsdtLen);
   if ((gSettings.FixDsdt & FIX_UNUSED)) {
+    DsdtFixSpan Span("FIX_UNUSED");
     //I want these fixes even if no Display fix. We have GraphicsInjector
     DsdtLen = DeleteDevice("CRT_"_XS8, temp, DsdtLen);
     DsdtLen = DeleteDevice("DVI_"_XS8, temp, DsdtLen);
@@ -5549,39 +6117,49 @@ void FixBiosDsdt(UINT8* temp, EFI_ACPI_2_0_FIXED_ACPI_DESCRIPTION_TABLE* fadt, c
   }
 
   if ((gSettings.FixDsdt & FIX_ACST)) {
-    ReplaceName(temp, DsdtLen, "ACST", "OCST");
-    ReplaceName(temp, DsdtLen, "ACSS", "OCSS");
-    ReplaceName(temp, DsdtLen, "APSS", "OPSS");
-    ReplaceName(temp, DsdtLen, "APSN", "OPSN");
-    ReplaceName(temp, DsdtLen, "APLF", "OPLF");
+    DsdtFixSpan Span("FIX_ACST");
+    CONST CHAR8 *AcstNames[][2] = {
+      { "ACST", "OCST" },
+      { "ACSS", "OCSS" },
+      { "APSS", "OPSS" },
+      { "APSN", "OPSN" },
+      { "APLF", "OPLF" },
+    };
+    ReplaceNames(temp, DsdtLen, AcstNames, sizeof(AcstNames) / sizeof(AcstNames[0]));
   }
 
   if ((gSettings.FixDsdt & FIX_PNLF)) {
+    DsdtFixSpan Span("FIX_PNLF");
       DsdtLen = AddPNLF(temp, DsdtLen);
   }
 
   if ((gSettings.FixDsdt & FIX_S3D)) {
+    DsdtFixSpan Span("FIX_S3D");
     FixS3D(temp, DsdtLen);
   }
   //Fix OperationRegions
   if ((gSettings.FixDsdt & FIX_REGIONS)) {
+    DsdtFixSpan Span("FIX_REGIONS");
     FixRegions(temp, DsdtLen);
   }
 
   //RehabMan: Fix Mutex objects
   if ((gSettings.FixDsdt & FIX_MUTEX)) {
+    DsdtFixSpan Span("FIX_MUTEX");
     FixMutex(temp, DsdtLen);
   }
 
 
      // pwrb add _CID sleep button fix
   if ((gSettings.FixDsdt & FIX_ADP1)) {
+    DsdtFixSpan Span("FIX_ADP1");
       DsdtLen = FixADP1(temp, DsdtLen);
   }
     // other compiler warning fix _T_X,  MUTE .... USB _PRW value form 0x04 => 0x01
 //     DsdtLen = FIXOTHER(temp, DsdtLen);
 
   if ((gSettings.FixDsdt & FIX_WARNING) || (gSettings.FixDsdt & FIX_DARWIN)) {
+    DsdtFixSpan Span("FIX_DARWIN");
     if (!FindMethod(temp, DsdtLen, "GET9") &&
         !FindMethod(temp, DsdtLen, "STR9") &&
         !FindMethod(temp, DsdtLen, "OOSI")) {
@@ -5590,6 +6168,7 @@ void FixBiosDsdt(UINT8* temp, EFI_ACPI_2_0_FIXED_ACPI_DESCRIPTION_TABLE* fadt, c
   }
   // Fix SHUTDOWN For ASUS
   if ((gSettings.FixDsdt & FIX_SHUTDOWN)) {
+    DsdtFixSpan Span("FIX_SHUTDOWN");
     DsdtLen = FIXSHUTDOWN_ASUS(temp, DsdtLen); //safe to do twice
   }
 
@@ -5607,6 +6186,11 @@ void FixBiosDsdt(UINT8* temp, EFI_ACPI_2_0_FIXED_ACPI_DESCRIPTION_TABLE* fadt, c
   EFI_ACPI_DESCRIPTION_HEADER* Table = (EFI_ACPI_DESCRIPTION_HEADER*)temp;
   Table->Length = DsdtLen;
   FixChecksum(Table);
+  gDsdtIndex.Reset();
+
+  if (GlobalConfig.DsdtCache) {
+    DsdtCachePut(CacheKey, temp);
+  }
 
   //DBG("========= Auto patch DSDT Finished ========\n");
   //PauseForKey(L"waiting for key press...\n");
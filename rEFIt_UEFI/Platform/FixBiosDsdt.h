@@ -9,7 +9,9 @@
 #define PLATFORM_FIXBIOSDSDT_H_
 
 #include "../cpp_foundation/XBuffer.h"
+#include "../cpp_foundation/XObjArray.h"
 #include "../Platform/MacOsVersion.h"
+#include "AcpiPatternSet.h"
 
 //DSDT fixes MASK
 //0x00FF
@@ -83,9 +85,69 @@ FindBin (
 INT32 FindBin (UINT8 *dsdt, size_t len, const XBuffer<UINT8>& bin);
 
 
-UINT32 FixAny (UINT8* dsdt, UINT32 len, const XBuffer<UINT8> ToFind, const XBuffer<UINT8> ToReplace);
+UINT32 FixAny (UINT8* dsdt, UINT32 len, const XBuffer<UINT8>& ToFind, const XBuffer<UINT8>& ToReplace);
 UINT32 FixRenameByBridge2 (UINT8* dsdt, UINT32 len, const XBuffer<UINT8>& TgtBrgName, const XBuffer<UINT8>& ToFind, const XBuffer<UINT8>& ToReplace);
 
+// microseconds since the TSC value Start
+UINT64 AcpiPatchTime (UINT64 Start);
+
+// Time of each step of FixBiosDsdt(), recorded only while gDsdtFixTimes is set (by the ACPI replay, cpp_unit_test/acpi_replay.cpp)
+#define DSDT_FIX_TIMES_MAX 48
+
+typedef struct {
+  const char *Name;   // literal, kept as is
+  UINT64      Ticks;
+} DSDT_FIX_TIME;
+
+typedef struct {
+  UINTN          Count;
+  DSDT_FIX_TIME  Fix[DSDT_FIX_TIMES_MAX];
+} DSDT_FIX_TIMES;
+
+extern DSDT_FIX_TIMES *gDsdtFixTimes;
+
+class DsdtFixSpan
+{
+  const char *Name;
+  UINT64      Start;
+
+public:
+  DsdtFixSpan(const char* Name) : Name(Name), Start(gDsdtFixTimes ? AsmReadTsc() : 0) {}
+  ~DsdtFixSpan();
+
+  DsdtFixSpan(const DsdtFixSpan&) = delete;
+  DsdtFixSpan& operator=(const DsdtFixSpan&) = delete;
+};
+
+// consecutive patches of gSettings.DSDTPatchArray applied together
+// Set holds the same size patches that can't interfere, they are replaced in one scan of the table.
+// A step with an empty Set is a single patch for FixAny or FixRenameByBridge2.
+class DSDT_PATCH_STEP
+{
+public:
+  AcpiPatternSet Set;
+  XArray<size_t> Patches;  // indexes in gSettings.DSDTPatchArray, disabled ones included for the log
+  UINT32         MaxSize;
+
+  DSDT_PATCH_STEP() : Set(), Patches(), MaxSize(0) {}
+};
+
+// gSettings.DSDTPatchArray grouped once, then applied to the DSDT and to each SSDT
+class DsdtPatchPlan
+{
+protected:
+  XObjArray<DSDT_PATCH_STEP> Steps;
+
+  UINT32 ApplyOne(UINT8* Table, UINT32 Len, size_t Index, BOOLEAN ShowLabels) const;
+
+public:
+  DsdtPatchPlan() : Steps() {}
+
+  void   Build();
+  // ShowLabels logs the label of each patch, and the disabled ones
+  UINT32 Apply(UINT8* Table, UINT32 Len, BOOLEAN ShowLabels) const;
+};
+
 
 
 
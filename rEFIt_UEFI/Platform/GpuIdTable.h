@@ -0,0 +1,53 @@
+/*
+ * GpuIdTable.h
+ *
+ * Lookups in the device id tables of the GPU injectors (nvidia.cpp, ati.cpp, gma.cpp).
+ * The tables are kept sorted by their key in the sources, GpuIdTableSorted() checks it in a static_assert,
+ * GpuIdTableFind() is a binary search. Each table has a GpuIdKey() overload returning its key as UINT64,
+ * e.g. (device << 32) | subdev.
+ */
+
+#ifndef PLATFORM_GPUIDTABLE_H_
+#define PLATFORM_GPUIDTABLE_H_
+
+#include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+
+// Entries Lo..Hi-1 are sorted. Halves recursion, so the constexpr depth is log2 of the table size (C++11).
+template <typename T>
+constexpr bool GpuIdTableSorted(const T* Table, UINTN Lo, UINTN Hi)
+{
+  return Hi - Lo < 2 ||
+         (GpuIdKey(Table[Lo + (Hi - Lo) / 2 - 1]) <= GpuIdKey(Table[Lo + (Hi - Lo) / 2]) &&
+          GpuIdTableSorted(Table, Lo, Lo + (Hi - Lo) / 2) &&
+          GpuIdTableSorted(Table, Lo + (Hi - Lo) / 2, Hi));
+}
+
+// Index of the first entry whose key is not less than Key (Count if none), the caller checks for equality.
+// With duplicate keys this is the first one of the table, as the linear scans returned.
+template <typename T>
+UINTN GpuIdTableLowerBound(const T* Table, UINTN Count, UINT64 Key)
+{
+  UINTN Lo = 0;
+  UINTN Hi = Count;
+  UINTN Mid;
+
+  while (Lo < Hi) {
+    Mid = Lo + (Hi - Lo) / 2;
+    if (GpuIdKey(Table[Mid]) < Key) {
+      Lo = Mid + 1;
+    } else {
+      Hi = Mid;
+    }
+  }
+  return Lo;
+}
+
+// Entry with Key, or NULL
+template <typename T>
+const T* GpuIdTableFind(const T* Table, UINTN Count, UINT64 Key)
+{
+  UINTN Index = GpuIdTableLowerBound(Table, Count, Key);
+  return (Index < Count && GpuIdKey(Table[Index]) == Key) ? &Table[Index] : NULL;
+}
+
+#endif /* PLATFORM_GPUIDTABLE_H_ */
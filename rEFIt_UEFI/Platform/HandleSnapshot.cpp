@@ -0,0 +1,214 @@
+/*
+ * HandleSnapshot.cpp
+ *
+ * The handle database read in one walk.
+ */
+
+#include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+#include "../include/Handle.h"
+#include "HandleSnapshot.h"
+
+#ifndef DEBUG_ALL
+#define DEBUG_HANDLE_SNAPSHOT 1
+#else
+#define DEBUG_HANDLE_SNAPSHOT DEBUG_ALL
+#endif
+
+#if DEBUG_HANDLE_SNAPSHOT == 0
+#define DBG(...)
+#else
+#define DBG(...) DebugLog(DEBUG_HANDLE_SNAPSHOT, __VA_ARGS__)
+#endif
+
+// FNV-1a
+static UINT32 BytesHash(const void* Bytes, UINTN Size)
+{
+  const UINT8* p = (const UINT8*)Bytes;
+  UINT32 hash = 2166136261U;
+  for (UINTN Index = 0; Index < Size; Index++) {
+    hash = (hash ^ p[Index]) * 16777619U;
+  }
+  return hash;
+}
+
+static UINT32 TypeOfProtocol(const EFI_GUID* Guid)
+{
+  if (CompareGuid(Guid, &gEfiLoadedImageProtocolGuid)) return EFI_HANDLE_TYPE_IMAGE_HANDLE;
+  if (CompareGuid(Guid, &gEfiDriverBindingProtocolGuid)) return EFI_HANDLE_TYPE_DRIVER_BINDING_HANDLE;
+  if (CompareGuid(Guid, &gEfiDriverConfigurationProtocolGuid)) return EFI_HANDLE_TYPE_DRIVER_CONFIGURATION_HANDLE;
+  if (CompareGuid(Guid, &gEfiDriverDiagnosticsProtocolGuid)) return EFI_HANDLE_TYPE_DRIVER_DIAGNOSTICS_HANDLE;
+  if (CompareGuid(Guid, &gEfiComponentName2ProtocolGuid)) return EFI_HANDLE_TYPE_COMPONENT_NAME_HANDLE;
+  if (CompareGuid(Guid, &gEfiComponentNameProtocolGuid)) return EFI_HANDLE_TYPE_COMPONENT_NAME_HANDLE;
+  if (CompareGuid(Guid, &gEfiDevicePathProtocolGuid)) return EFI_HANDLE_TYPE_DEVICE_HANDLE;
+  return EFI_HANDLE_TYPE_UNKNOWN;
+}
+
+void HANDLE_SNAPSHOT::setEmpty()
+{
+  Handles.setEmpty();
+  Protocols.setEmpty();
+  Opens.setEmpty();
+  HandleTable.setEmpty();
+  GuidTable.setEmpty();
+}
+
+EFI_STATUS HANDLE_SNAPSHOT::Take()
+{
+  EFI_STATUS                          Status;
+  UINTN                               AllHandleCount = 0;
+  EFI_HANDLE                          *HandleBuffer = NULL;
+  EFI_GUID                            **ProtocolGuidArray;
+  UINTN                               ArrayCount;
+  EFI_OPEN_PROTOCOL_INFORMATION_ENTRY *OpenInfo;
+  UINTN                               OpenInfoCount;
+
+  setEmpty();
+  Status = gBS->LocateHandleBuffer(AllHandles, NULL, NULL, &AllHandleCount, &HandleBuffer);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+  Handles.CheckSize(AllHandleCount, 0);
+
+  for (UINTN HandleIndex = 0; HandleIndex < AllHandleCount; HandleIndex++) {
+    HANDLE_SNAPSHOT_HANDLE Handle;
+    Handle.Handle = HandleBuffer[HandleIndex];
+    Handle.Type = EFI_HANDLE_TYPE_UNKNOWN;
+    Handle.FirstProtocol = Protocols.size();
+    Handle.FirstOpenAsController = HANDLE_SNAPSHOT_NONE;
+
+    Status = gBS->ProtocolsPerHandle(Handle.Handle, &ProtocolGuidArray, &ArrayCount);
+    if (!EFI_ERROR(Status)) {
+      for (UINTN ProtocolIndex = 0; ProtocolIndex < ArrayCount; ProtocolIndex++) {
+        HANDLE_SNAPSHOT_PROTOCOL Protocol;
+        CopyMem(&Protocol.Guid, ProtocolGuidArray[ProtocolIndex], sizeof(EFI_GUID));
+        Protocol.HandleIndex = HandleIndex;
+        Protocol.FirstOpen = Opens.size();
+        Protocol.NextSameGuid = HANDLE_SNAPSHOT_NONE;
+        Handle.Type |= TypeOfProtocol(&Protocol.Guid);
+
+        Status = gBS->OpenProtocolInformation(Handle.Handle, ProtocolGuidArray[ProtocolIndex], &OpenInfo, &OpenInfoCount);
+        if (!EFI_ERROR(Status)) {
+          for (UINTN OpenInfoIndex = 0; OpenInfoIndex < OpenInfoCount; OpenInfoIndex++) {
+            HANDLE_SNAPSHOT_OPEN Open;
+            Open.AgentHandle = OpenInfo[OpenInfoIndex].AgentHandle;
+            Open.ControllerHandle = OpenInfo[OpenInfoIndex].ControllerHandle;
+            Open.Attributes = OpenInfo[OpenInfoIndex].Attributes;
+            Open.ProtocolIndex = Protocols.size();
+            Open.NextSameController = HANDLE_SNAPSHOT_NONE;
+            Opens.Add(Open);
+          }
+          FreePool(OpenInfo);
+        }
+        Protocol.OpenCount = Opens.size() - Protocol.FirstOpen;
+        Protocols.Add(Protocol);
+      }
+      FreePool(ProtocolGuidArray);
+    }
+    Handle.ProtocolCount = Protocols.size() - Handle.FirstProtocol;
+    Handles.Add(Handle);
+  }
+  FreePool(HandleBuffer);
+
+  BuildIndexes();
+  DBG("Handle snapshot: %zu handles, %zu protocols, %zu opens\n", Handles.size(), Protocols.size(), Opens.size());
+  return EFI_SUCCESS;
+}
+
+void HANDLE_SNAPSHOT::BuildIndexes()
+{
+  size_t slotCount = 32;
+  while ( slotCount < Handles.size() * 2 ) slotCount <<= 1;
+  HandleTable.Add(0, slotCount);
+  UINT64* table = HandleTable.data();
+  size_t mask = slotCount - 1;
+  for (size_t HandleIndex = 0; HandleIndex < Handles.size(); HandleIndex++) {
+    EFI_HANDLE Handle = Handles.ElementAt(HandleIndex).Handle;
+    UINT32 hash = BytesHash(&Handle, sizeof(Handle));
+    size_t slot;
+    for (slot = hash & mask ; table[slot] != 0 ; slot = (slot + 1) & mask) {
+      if ( Handles.ElementAt((size_t)(UINT32)table[slot] - 1).Handle == Handle ) break;
+    }
+    if ( table[slot] == 0 ) table[slot] = ((UINT64)hash << 32) | (HandleIndex + 1);
+  }
+
+  // controller -> opens, walked backward so that the chains are in database order
+  for (size_t OpenIndex = Opens.size(); OpenIndex-- > 0; ) {
+    HANDLE_SNAPSHOT_OPEN& Open = Opens.ElementAt(OpenIndex);
+    size_t Controller = FindHandle(Open.ControllerHandle);
+    if (Controller == HANDLE_SNAPSHOT_NONE) {
+      continue;
+    }
+    Open.NextSameController = Handles.ElementAt(Controller).FirstOpenAsController;
+    Handles.ElementAt(Controller).FirstOpenAsController = OpenIndex;
+  }
+
+  // protocol -> handles, same
+  slotCount = 32;
+  while ( slotCount < Protocols.size() * 2 ) slotCount <<= 1;
+  GuidTable.Add(0, slotCount);
+  table = GuidTable.data();
+  mask = slotCount - 1;
+  for (size_t ProtocolIndex = Protocols.size(); ProtocolIndex-- > 0; ) {
+    HANDLE_SNAPSHOT_PROTOCOL& Protocol = Protocols.ElementAt(ProtocolIndex);
+    UINT32 hash = BytesHash(&Protocol.Guid, sizeof(EFI_GUID));
+    size_t slot;
+    for (slot = hash & mask ; table[slot] != 0 ; slot = (slot + 1) & mask) {
+      if ( (UINT32)(table[slot] >> 32) == hash  &&  CompareGuid(&Protocols.ElementAt((size_t)(UINT32)table[slot] - 1).Guid, &Protocol.Guid) ) {
+        Protocol.NextSameGuid = (size_t)(UINT32)table[slot] - 1;
+        break;
+      }
+    }
+    table[slot] = ((UINT64)hash << 32) | (ProtocolIndex + 1);
+  }
+}
+
+size_t HANDLE_SNAPSHOT::FindHandle(EFI_HANDLE Handle) const
+{
+  if (HandleTable.isEmpty() || Handle == NULL) {
+    return HANDLE_SNAPSHOT_NONE;
+  }
+  UINT32 hash = BytesHash(&Handle, sizeof(Handle));
+  const UINT64* table = HandleTable.data();
+  size_t mask = HandleTable.size() - 1;
+  for (size_t slot = hash & mask ; table[slot] != 0 ; slot = (slot + 1) & mask) {
+    if ( (UINT32)(table[slot] >> 32) != hash ) continue;
+    size_t HandleIndex = (size_t)(UINT32)table[slot] - 1;
+    if ( Handles.ElementAt(HandleIndex).Handle == Handle ) return HandleIndex;
+  }
+  return HANDLE_SNAPSHOT_NONE;
+}
+
+size_t HANDLE_SNAPSHOT::FirstWithProtocol(const EFI_GUID* Guid) const
+{
+  if (GuidTable.isEmpty()) {
+    return HANDLE_SNAPSHOT_NONE;
+  }
+  UINT32 hash = BytesHash(Guid, sizeof(EFI_GUID));
+  const UINT64* table = GuidTable.data();
+  size_t mask = GuidTable.size() - 1;
+  for (size_t slot = hash & mask ; table[slot] != 0 ; slot = (slot + 1) & mask) {
+    if ( (UINT32)(table[slot] >> 32) != hash ) continue;
+    size_t ProtocolIndex = (size_t)(UINT32)table[slot] - 1;
+    if ( CompareGuid(&Protocols.ElementAt(ProtocolIndex).Guid, Guid) ) return ProtocolIndex;
+  }
+  return HANDLE_SNAPSHOT_NONE;
+}
+
+size_t HANDLE_SNAPSHOT::FindProtocol(size_t HandleIndex, const EFI_GUID* Guid) const
+{
+  const HANDLE_SNAPSHOT_HANDLE& Handle = Handles.ElementAt(HandleIndex);
+  for (size_t ProtocolIndex = Handle.FirstProtocol; ProtocolIndex < Handle.FirstProtocol + Handle.ProtocolCount; ProtocolIndex++) {
+    if ( CompareGuid(&Protocols.ElementAt(ProtocolIndex).Guid, Guid) ) return ProtocolIndex;
+  }
+  return HANDLE_SNAPSHOT_NONE;
+}
+
+BOOLEAN HANDLE_SNAPSHOT::HasParent(size_t HandleIndex) const
+{
+  for (size_t OpenIndex = Handles.ElementAt(HandleIndex).FirstOpenAsController; OpenIndex != HANDLE_SNAPSHOT_NONE; OpenIndex = Opens.ElementAt(OpenIndex).NextSameController) {
+    if ((Opens.ElementAt(OpenIndex).Attributes & EFI_OPEN_PROTOCOL_BY_CHILD_CONTROLLER) == EFI_OPEN_PROTOCOL_BY_CHILD_CONTROLLER) {
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
@@ -0,0 +1,81 @@
+/*
+ * HandleSnapshot.h
+ *
+ * One walk of the handle database : every handle, its protocols and the agents that opened them,
+ * indexed by protocol (protocol -> handles) and by controller (controller -> opens of its drivers and children).
+ * The connect and disconnect code asks it instead of calling LocateHandleBuffer() and OpenProtocolInformation()
+ * once per protocol and per handle.
+ * The database changes with every connect and disconnect : take a snapshot, compute the set of controllers
+ * to (dis)connect, then do it. Nothing is kept between two Take().
+ */
+
+#ifndef __HANDLESNAPSHOT_H__
+#define __HANDLESNAPSHOT_H__
+
+#include "../cpp_foundation/XArray.h"
+
+#define HANDLE_SNAPSHOT_NONE MAX_XSIZE
+
+typedef struct {
+  EFI_HANDLE  Handle;
+  UINT32      Type;                  // EFI_HANDLE_TYPE_* given by its own protocols (image, binding, device...)
+  size_t      FirstProtocol;         // its protocols are [FirstProtocol, FirstProtocol + ProtocolCount[
+  size_t      ProtocolCount;
+  size_t      FirstOpenAsController; // first open with this handle as ControllerHandle, then NextSameController
+} HANDLE_SNAPSHOT_HANDLE;
+
+typedef struct {
+  EFI_GUID    Guid;
+  size_t      HandleIndex;
+  size_t      FirstOpen;             // its opens are [FirstOpen, FirstOpen + OpenCount[
+  size_t      OpenCount;
+  size_t      NextSameGuid;          // same protocol on the next handle
+} HANDLE_SNAPSHOT_PROTOCOL;
+
+typedef struct {
+  EFI_HANDLE  AgentHandle;
+  EFI_HANDLE  ControllerHandle;
+  UINT32      Attributes;
+  size_t      ProtocolIndex;         // protocol opened, it is on the handle Protocol(ProtocolIndex).HandleIndex
+  size_t      NextSameController;
+} HANDLE_SNAPSHOT_OPEN;
+
+class HANDLE_SNAPSHOT
+{
+protected:
+  XArray<HANDLE_SNAPSHOT_HANDLE>   Handles;
+  XArray<HANDLE_SNAPSHOT_PROTOCOL> Protocols;
+  XArray<HANDLE_SNAPSHOT_OPEN>     Opens;
+  // Open addressing tables. Slot is (hash << 32) | (index + 1), 0 if empty.
+  XArray<UINT64>                   HandleTable;
+  XArray<UINT64>                   GuidTable;   // first protocol entry of each guid
+
+  void BuildIndexes();
+
+public:
+  HANDLE_SNAPSHOT() : Handles(), Protocols(), Opens(), HandleTable(), GuidTable() {}
+  HANDLE_SNAPSHOT(const HANDLE_SNAPSHOT& other) = delete; // Can be defined if needed
+  const HANDLE_SNAPSHOT& operator = ( const HANDLE_SNAPSHOT & ) = delete; // Can be defined if needed
+
+  // All the handles, in the order of LocateHandleBuffer(AllHandles)
+  EFI_STATUS Take();
+  void setEmpty();
+
+  size_t HandleCount() const { return Handles.size(); }
+  const HANDLE_SNAPSHOT_HANDLE& Handle(size_t Index) const { return Handles.ElementAt(Index); }
+  const HANDLE_SNAPSHOT_PROTOCOL& Protocol(size_t Index) const { return Protocols.ElementAt(Index); }
+  size_t OpenCount() const { return Opens.size(); }
+  const HANDLE_SNAPSHOT_OPEN& Open(size_t Index) const { return Opens.ElementAt(Index); }
+
+  // HANDLE_SNAPSHOT_NONE if not found
+  size_t FindHandle(EFI_HANDLE Handle) const;
+  // First protocol entry with Guid, the next ones are chained by NextSameGuid
+  size_t FirstWithProtocol(const EFI_GUID* Guid) const;
+  // Protocol entry of Guid on the handle
+  size_t FindProtocol(size_t HandleIndex, const EFI_GUID* Guid) const;
+  BOOLEAN HasProtocol(size_t HandleIndex, const EFI_GUID* Guid) const { return FindProtocol(HandleIndex, Guid) != HANDLE_SNAPSHOT_NONE; }
+  // TRUE if a bus driver opened a protocol BY_CHILD_CONTROLLER for this handle
+  BOOLEAN HasParent(size_t HandleIndex) const;
+};
+
+#endif
@@ -0,0 +1,146 @@
+/*
+ * Hex.cpp
+ *
+ * The hex conversions of Utils.h, apart from the rest of Utils.cpp so the host tests can build them.
+ * Hex digits are decoded with a 256 entries table, BytesToHex() encodes 16 bytes at once with SSE2.
+ */
+
+#include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+#include "MemoryOperation.h"
+
+//
+// Hex digit values, 0xFF for the other chars
+//
+static const UINT8 HexValues[256] = {
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+#define HEX_VALUE(c) HexValues[(UINT8)(c)]
+
+UINT8 hexstrtouint8 (const CHAR8* buf)
+{
+	UINT8 Hi, Lo;
+
+	Hi = HEX_VALUE(buf[0]);
+	if (Hi == 0xFF) {
+		Hi = 0;
+	}
+	if (buf[0] == 0 || buf[1] == 0) {
+		return Hi;
+	}
+	Lo = HEX_VALUE(buf[1]);
+	if (Lo == 0xFF) {
+		Lo = 0;
+	}
+	return (UINT8)((Hi << 4) | Lo);
+}
+
+BOOLEAN IsHexDigit (CHAR8 c) {
+	return HEX_VALUE(c) != 0xFF;
+}
+
+//out value is a number of byte.  out = len
+
+UINT32 hex2bin(IN const CHAR8 *hex, OUT UINT8 *bin, UINT32 len) //assume len = number of UINT8 values
+{
+	const CHAR8	*p;
+	UINT32	i, outlen = 0;
+	UINT8	Hi, Lo;
+
+	if (hex == NULL || bin == NULL || len <= 0 || strlen(hex) < len * 2) {
+    //		DBG("[ERROR] bin2hex input error\n"); //this is not error, this is empty value
+		return FALSE;
+	}
+
+	p = hex;
+
+	for (i = 0; i < len; i++)
+	{
+		while ((*p == 0x20) || (*p == ',')) {
+			p++; //skip spaces and commas
+		}
+		if (*p == 0) {
+			break;
+		}
+		Hi = HEX_VALUE(p[0]);
+		Lo = HEX_VALUE(p[1]); // p[1] is at worst the terminating 0
+		if (Hi == 0xFF || Lo == 0xFF) {
+			MsgLog("[ERROR] bin2hex '%s' syntax error\n", hex);
+			return 0;
+		}
+		bin[i] = (UINT8)((Hi << 4) | Lo);
+		p += 2;
+		outlen++;
+	}
+	//bin[outlen] = 0;
+	return outlen;
+}
+
+//
+// SSE2 is part of x86_64, we still wait for GetCPUProperties() to enable it through MemoryOperationSetSimd().
+// GCC and clang vector extensions and builtins are used instead of <emmintrin.h> because of freestanding build.
+//
+#if defined(__x86_64__) && defined(__GNUC__)
+#define BYTES_TO_HEX_SSE2 1
+typedef UINT8 HEX_V16 __attribute__((vector_size(16)));
+typedef char  HEX_V16_CHAR __attribute__((vector_size(16)));
+typedef UINT8 HEX_V16_UNALIGNED __attribute__((vector_size(16), aligned(1)));
+#else
+#define BYTES_TO_HEX_SSE2 0
+#endif
+
+void BytesToHex(IN const UINT8 *Data, IN UINTN Len, OUT CHAR8 *Out, IN BOOLEAN Upper)
+{
+	const CHAR8 *Digits = Upper ? "0123456789ABCDEF" : "0123456789abcdef";
+	UINTN       i = 0;
+
+#if BYTES_TO_HEX_SSE2 == 1
+	if (MemoryOperationGetSimd()) {
+		// nibble n -> '0' + n, plus the gap up to 'A' or 'a' when n > 9
+		const HEX_V16 Nibble = { 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F };
+		const HEX_V16 Nine = { 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9 };
+		const HEX_V16 Zero = { '0', '0', '0', '0', '0', '0', '0', '0', '0', '0', '0', '0', '0', '0', '0', '0' };
+		UINT8         Gap = Upper ? 'A' - '0' - 10 : 'a' - '0' - 10;
+		const HEX_V16 Letter = { Gap, Gap, Gap, Gap, Gap, Gap, Gap, Gap, Gap, Gap, Gap, Gap, Gap, Gap, Gap, Gap };
+		HEX_V16 Src, Hi, Lo;
+
+		for (; i + 16 <= Len; i += 16) {
+			Src = *(const HEX_V16_UNALIGNED *)(Data + i);
+			Hi = (Src >> 4) & Nibble;
+			Lo = Src & Nibble;
+			Hi += Zero + ((HEX_V16)(Hi > Nine) & Letter);
+			Lo += Zero + ((HEX_V16)(Lo > Nine) & Letter);
+			*(HEX_V16_UNALIGNED *)(Out + i * 2) = (HEX_V16)__builtin_ia32_punpcklbw128((HEX_V16_CHAR)Hi, (HEX_V16_CHAR)Lo);
+			*(HEX_V16_UNALIGNED *)(Out + i * 2 + 16) = (HEX_V16)__builtin_ia32_punpckhbw128((HEX_V16_CHAR)Hi, (HEX_V16_CHAR)Lo);
+		}
+	}
+#endif
+	for (; i < Len; i++) {
+		Out[i * 2] = Digits[Data[i] >> 4];
+		Out[i * 2 + 1] = Digits[Data[i] & 0x0F];
+	}
+	Out[Len * 2] = '\0';
+}
+
+XString8 Bytes2HexStr(UINT8 *data, UINTN len)
+{
+  XString8 result;
+
+  BytesToHex(data, len, result.dataSized(len*2+1), FALSE);
+  return result;
+}
@@ -371,6 +371,109 @@ EFIAPI OurBlockIoRead (
   return Status;
 }
 
+//
+// Position of the sleepimage found at a previous boot, variable SLEEP_IMAGE_VARIABLE of gEfiAppleBootGuid.
+// Valid for the same volume on a disk of the same geometry, and only when the sleepimage is on that volume.
+//
+#define SLEEP_IMAGE_VARIABLE  L"CloverSleepImage"
+
+typedef struct {
+  UINT32  VolumeCrc;   // CRC32 of the device path of the volume
+  UINT32  BlockSize;   // of the whole disk
+  UINT64  LastBlock;
+  UINT64  Offset;      // of the sleepimage on the whole disk, in bytes
+} SLEEP_IMAGE_CACHE;
+
+STATIC BOOLEAN SleepImageCacheKey(IN REFIT_VOLUME *Volume, OUT SLEEP_IMAGE_CACHE *Key)
+{
+  ZeroMem(Key, sizeof(*Key));
+  if (Volume->DevicePath == NULL || Volume->WholeDiskBlockIO == NULL || Volume->WholeDiskBlockIO->Media == NULL) {
+    return FALSE;
+  }
+  if (EFI_ERROR(gBS->CalculateCrc32(Volume->DevicePath, GetDevicePathSize(Volume->DevicePath), &Key->VolumeCrc))) {
+    return FALSE;
+  }
+  Key->BlockSize = Volume->WholeDiskBlockIO->Media->BlockSize;
+  Key->LastBlock = Volume->WholeDiskBlockIO->Media->LastBlock;
+  return Key->BlockSize != 0;
+}
+
+/** Reads the one block at the cached sleepimage offset.
+ *  Returns the offset if the block is a hibernation header, with gSleepTime and machineSignature set as OurBlockIoRead() does.
+ *  Returns 0 with *NotHibernated = TRUE if it is the header invalidated by the kernel after the last wake,
+ *  and 0 with *NotHibernated = FALSE if the cache can't tell, then the sleepimage must be searched.
+ */
+STATIC UINT64 CheckCachedSleepImage(IN REFIT_VOLUME *Volume, OUT BOOLEAN *NotHibernated)
+{
+  EFI_STATUS                    Status;
+  SLEEP_IMAGE_CACHE             Key;
+  SLEEP_IMAGE_CACHE             Cache;
+  UINTN                         Size = sizeof(Cache);
+  EFI_BLOCK_IO_PROTOCOL         *BlockIo;
+  IOHibernateImageHeaderMin     *Header;
+  IOHibernateImageHeaderMinSnow *Header2;
+  void                          *Buffer;
+  UINTN                         Pages;
+  UINT64                        Offset = 0;
+
+  *NotHibernated = FALSE;
+  if (!GlobalConfig.SleepImageCache || !SleepImageCacheKey(Volume, &Key)) {
+    return 0;
+  }
+  Status = NvramGetVariable(SLEEP_IMAGE_VARIABLE, &gEfiAppleBootGuid, NULL, &Size, &Cache);
+  if (EFI_ERROR(Status) || Size != sizeof(Cache) || Cache.VolumeCrc != Key.VolumeCrc ||
+      Cache.BlockSize != Key.BlockSize || Cache.LastBlock != Key.LastBlock || Cache.Offset % Cache.BlockSize != 0) {
+    return 0;
+  }
+
+  // use 4KB aligned page to avoid possible issues with BlockIo buffer alignment
+  BlockIo = Volume->WholeDiskBlockIO;
+  Pages = EFI_SIZE_TO_PAGES(BlockIo->Media->BlockSize);
+  Buffer = (__typeof__(Buffer))AllocatePages(Pages);
+  if (Buffer == NULL) {
+    return 0;
+  }
+  Status = BlockIo->ReadBlocks(BlockIo, BlockIo->Media->MediaId, DivU64x32(Cache.Offset, Cache.BlockSize), BlockIo->Media->BlockSize, Buffer);
+  if (!EFI_ERROR(Status) && BlockIo->Media->BlockSize >= sizeof(IOHibernateImageHeaderMin)) {
+    Header = (IOHibernateImageHeaderMin *)Buffer;
+    Header2 = (IOHibernateImageHeaderMinSnow *)Buffer;
+    if (Header->signature == kIOHibernateHeaderSignature ||
+        Header2->signature == kIOHibernateHeaderSignature) {
+      Offset = Cache.Offset;
+      machineSignature = Header->machineSignature;
+      gSleepTime = Header->signature == kIOHibernateHeaderSignature ? Header->sleepTime : 0;
+      DBG("    sleepimage found at cached offset %llx\n", Offset);
+    } else if (Header->signature == kIOHibernateHeaderInvalidSignature ||
+               Header2->signature == kIOHibernateHeaderInvalidSignature) {
+      *NotHibernated = TRUE;
+      DBG("    sleepimage at cached offset %llx was used already\n", Cache.Offset);
+    }
+  }
+  FreePages(Buffer, Pages);
+  return Offset;
+}
+
+STATIC void SaveSleepImageCache(IN REFIT_VOLUME *Volume, IN UINT64 Offset)
+{
+  EFI_STATUS          Status;
+  SLEEP_IMAGE_CACHE   Key;
+  SLEEP_IMAGE_CACHE   Cache;
+  UINTN               Size = sizeof(Cache);
+
+  if (!GlobalConfig.SleepImageCache || !SleepImageCacheKey(Volume, &Key)) {
+    return;
+  }
+  Key.Offset = Offset;
+  Status = NvramGetVariable(SLEEP_IMAGE_VARIABLE, &gEfiAppleBootGuid, NULL, &Size, &Cache);
+  if (!EFI_ERROR(Status) && Size == sizeof(Cache) && CompareMem(&Cache, &Key, sizeof(Key)) == 0) {
+    return;
+  }
+  Status = SetNvramVariable(SLEEP_IMAGE_VARIABLE, &gEfiAppleBootGuid,
+                            EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS,
+                            sizeof(Key), &Key);
+  DBG("    sleepimage cache: %s\n", efiStrError(Status));
+}
+
 /** Get sleep image location (volume and name) */
 void
 GetSleepImageLocation(IN REFIT_VOLUME *Volume, REFIT_VOLUME **SleepImageVolume, XStringW* SleepImageNamePtr)
@@ -409,7 +512,7 @@ GetSleepImageLocation(IN REFIT_VOLUME *Volume, REFIT_VOLUME **SleepImageVolume,
   
   if (!EFI_ERROR(Status)) {
     TagDict* PrefDict;
-    Status = ParseXML((const CHAR8*)PrefBuffer, &PrefDict, PrefBufferLen);
+    Status = ParseXMLView((const CHAR8*)PrefBuffer, &PrefDict, PrefBufferLen);
     if (!EFI_ERROR(Status)) {
       const TagDict* dict = PrefDict->dictPropertyForKey("Custom Profile");
       if (dict) {
@@ -488,6 +591,8 @@ GetSleepImagePosition (IN REFIT_VOLUME *Volume, REFIT_VOLUME **SleepImageVolume)
   UINTN               BufferSize;
   XStringW            ImageName;
   REFIT_VOLUME        *ImageVolume;
+  UINT64              CachedOffset;
+  BOOLEAN             NotHibernated;
   
   if (!Volume) {
     DBG("    no volume to get sleepimage\n");
@@ -509,6 +614,17 @@ GetSleepImagePosition (IN REFIT_VOLUME *Volume, REFIT_VOLUME **SleepImageVolume)
     return Volume->SleepImageOffset;
   }
   
+  // One block read instead of a read through the file system, when the sleepimage didn't move
+  CachedOffset = CheckCachedSleepImage(Volume, &NotHibernated);
+  if (CachedOffset != 0 || NotHibernated) {
+    Volume->SleepImageOffset = CachedOffset;
+    gSleepImageOffset = CachedOffset;
+    if (SleepImageVolume != NULL) {
+      *SleepImageVolume = Volume;
+    }
+    return CachedOffset;
+  }
+  
   // Get sleepimage name and volume
   GetSleepImageLocation(Volume, &ImageVolume, &ImageName);
   
@@ -571,6 +687,9 @@ GetSleepImagePosition (IN REFIT_VOLUME *Volume, REFIT_VOLUME **SleepImageVolume)
   if (gSleepImageOffset != 0) {
 	  DBG("     sleepimage offset acquired successfully: %llx\n", gSleepImageOffset);
     ImageVolume->SleepImageOffset = gSleepImageOffset;
+    if (ImageVolume == Volume) {
+      SaveSleepImageCache(Volume, gSleepImageOffset);
+    }
   } else {
     DBG("     sleepimage offset could not be acquired\n");
   }
@@ -940,7 +1059,7 @@ IsOsxHibernated (IN LOADER_ENTRY *Entry)
               DBG("    boot-image corrected: %ls\n", FileDevicePathToXStringW((EFI_DEVICE_PATH_PROTOCOL*)Value).wc_str());
               PrintBytes(Value, Size);
               
-              Status = gRT->SetVariable(L"boot-image", &gEfiAppleBootGuid,
+              Status = NvramSetVariable(L"boot-image", &gEfiAppleBootGuid,
                                         EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS,
                                         Size , Value);
               if (EFI_ERROR(Status)) {
@@ -1018,7 +1137,7 @@ PrepareHibernation (IN REFIT_VOLUME *Volume)
     //  VarData[25] = 0xFF;
     //  DBG("boot-image corrected: %ls\n", FileDevicePathToStr(BootImageDevPath));
     
-    Status = gRT->SetVariable(L"boot-image", &gEfiAppleBootGuid,
+    Status = NvramSetVariable(L"boot-image", &gEfiAppleBootGuid,
                               EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS,
                               Size , BootImageDevPath);
     if (EFI_ERROR(Status)) {
@@ -1076,7 +1195,7 @@ PrepareHibernation (IN REFIT_VOLUME *Volume)
     // Erase RTC variables in NVRAM.
     //
     if (!EFI_ERROR(Status)) {
-      Status = gRT->SetVariable (L"IOHibernateRTCVariables", &gEfiAppleBootGuid,
+      Status = NvramSetVariable(L"IOHibernateRTCVariables", &gEfiAppleBootGuid,
                                  EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS,
                                  0, NULL);
       ZeroMem (Value, Size);
@@ -1087,9 +1206,9 @@ PrepareHibernation (IN REFIT_VOLUME *Volume)
     // Convert RTC data to boot-key and boot-signature
     //
     if (HasHibernateInfo) {
-      gRT->SetVariable (L"boot-image-key", &gEfiAppleBootGuid,
+      NvramSetVariable(L"boot-image-key", &gEfiAppleBootGuid,
                         EFI_VARIABLE_BOOTSERVICE_ACCESS, sizeof (RtcVars.wiredCryptKey), RtcVars.wiredCryptKey);
-      gRT->SetVariable (L"boot-signature", &gEfiAppleBootGuid,
+      NvramSetVariable(L"boot-signature", &gEfiAppleBootGuid,
                         EFI_VARIABLE_BOOTSERVICE_ACCESS, sizeof (RtcVars.booterSignature), RtcVars.booterSignature);
       DBG("variables boot-image-key and boot-signature saved\n");
     }
@@ -1129,7 +1248,7 @@ PrepareHibernation (IN REFIT_VOLUME *Volume)
     //
     // Delete IOHibernateRTCVariables.
     //
-    Status = gRT->SetVariable(L"IOHibernateRTCVariables", &gEfiAppleBootGuid,
+    Status = NvramSetVariable(L"IOHibernateRTCVariables", &gEfiAppleBootGuid,
                               EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS,
                               0, NULL);
     HasIORTCVariables = TRUE;
@@ -1157,7 +1276,7 @@ PrepareHibernation (IN REFIT_VOLUME *Volume)
     Attributes |= EFI_VARIABLE_NON_VOLATILE;
   }
   
-  Status = gRT->SetVariable(L"boot-switch-vars", &gEfiAppleBootGuid,
+  Status = NvramSetVariable(L"boot-switch-vars", &gEfiAppleBootGuid,
                             Attributes,
                             Size, Value);
   
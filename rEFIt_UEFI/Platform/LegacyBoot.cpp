@@ -248,6 +248,11 @@ EFI_STATUS GetBiosDriveCRC32(UINT8 DriveNum,
 	return Status;
 }
 
+// CRC32 of the first 2 sectors of bios drives 0x80-0x87, each drive is read once per boot
+#define BIOS_DRIVE_CRC_COUNT  8
+static UINT32 BiosDriveCRC32[BIOS_DRIVE_CRC_COUNT];
+static UINT8  BiosDriveCRCRead = 0;   // bit per drive: CRC known
+
 /** Scans bios drives 0x80 and up, calculates CRC32 of first 2 sectors and compares it with Volume->DriveCRC32.
  *  First 2 sectors whould be enough - covers MBR and GPT header with signatures.
  *  Requires mThunkContext to be initialiyzed already with InitializeBiosIntCaller().
@@ -256,32 +261,46 @@ UINT8 GetBiosDriveNumForVolume(REFIT_VOLUME *Volume)
 {
 	EFI_STATUS					Status;
 	UINT8						DriveNum, BestNum;
+	UINT8						DriveBit;
 	UINT32						DriveCRC32;
-	UINT8						*Buffer;
-	BIOS_DISK_ADDRESS_PACKET	*Dap;
+	UINT8						*Buffer = NULL;
+	BIOS_DISK_ADDRESS_PACKET	*Dap = NULL;
 	UINTN						LegacyRegionPages;
-	EFI_PHYSICAL_ADDRESS		LegacyRegion;
+	EFI_PHYSICAL_ADDRESS		LegacyRegion = 0;
 	
 //	DBG("Expected volume CRC32 = %hhX\n", Volume->DriveCRC32);
-	LegacyRegion = 0x0C0000;
 	LegacyRegionPages = EFI_SIZE_TO_PAGES(sizeof(BIOS_DISK_ADDRESS_PACKET) + 2 * 512)+1 /* dap + 2 sectors */;
-	Status = gBS->AllocatePages(AllocateMaxAddress,
-								EfiBootServicesData,
-								LegacyRegionPages,
-								&LegacyRegion
-								);
-	if (EFI_ERROR(Status)) {
-		return 0;
-	}
-	
-	Dap = (BIOS_DISK_ADDRESS_PACKET *)(UINTN)LegacyRegion;
-	Buffer = (UINT8 *)(UINTN)(LegacyRegion + 0x200);
 //Slice - some CD has BIOS driveNum = 0	
 	// scan drives from 0x80
   BestNum = 0;
-	for (DriveNum = 0x80; DriveNum < 0x88; DriveNum++) {
+	for (DriveNum = 0x80; DriveNum < 0x80 + BIOS_DRIVE_CRC_COUNT; DriveNum++) {
+    DriveBit = (UINT8)(1 << (DriveNum - 0x80));
     DriveCRC32 = 0;
-		Status = GetBiosDriveCRC32(DriveNum, &DriveCRC32, Dap, Buffer);
+    if ((BiosDriveCRCRead & DriveBit) != 0) {
+      DriveCRC32 = BiosDriveCRC32[DriveNum - 0x80];
+      Status = EFI_SUCCESS;
+    } else {
+      // the legacy buffer is only needed for drives not read yet
+      if (LegacyRegion == 0) {
+        LegacyRegion = 0x0C0000;
+        Status = gBS->AllocatePages(AllocateMaxAddress,
+                                    EfiBootServicesData,
+                                    LegacyRegionPages,
+                                    &LegacyRegion
+                                    );
+        if (EFI_ERROR(Status)) {
+          LegacyRegion = 0;
+          break;
+        }
+        Dap = (BIOS_DISK_ADDRESS_PACKET *)(UINTN)LegacyRegion;
+        Buffer = (UINT8 *)(UINTN)(LegacyRegion + 0x200);
+      }
+      Status = GetBiosDriveCRC32(DriveNum, &DriveCRC32, Dap, Buffer);
+      if (!EFI_ERROR(Status)) {
+        BiosDriveCRC32[DriveNum - 0x80] = DriveCRC32;
+        BiosDriveCRCRead |= DriveBit;
+      }
+    }
 		if (EFI_ERROR(Status)) {
 			// error or no more disks
 			//DriveNum = 0;
@@ -294,7 +313,9 @@ UINT8 GetBiosDriveNumForVolume(REFIT_VOLUME *Volume)
 			break;
 		}
 	}
-	gBS->FreePages(LegacyRegion, LegacyRegionPages);
+	if (LegacyRegion != 0) {
+		gBS->FreePages(LegacyRegion, LegacyRegionPages);
+	}
 	DBG("Returning Bios drive %hhX\n", BestNum);
 	return BestNum;
 }
@@ -907,11 +928,20 @@ EFI_STATUS bootPBR(REFIT_VOLUME* volume, BOOLEAN SataReset)
   }
 
   //
-  // read partition boot record and copy it to BIOS boot area 0000:07C00
+  // copy partition boot record to BIOS boot area 0000:07C00,
+  // ScanVolumeBootcode() normally kept it so there is nothing to read
   //
-  mBootSector = (__typeof__(mBootSector))AllocatePages(1);
-  Status = pDisk->ReadBlocks(pDisk, pDisk->Media->MediaId, 0, 1*512, mBootSector);
-  CopyMem(pBootSector, mBootSector, 1*512);
+  if (volume->BootSector != NULL) {
+    CopyMem(pBootSector, volume->BootSector, 1*512);
+  } else {
+    mBootSector = (__typeof__(mBootSector))AllocatePages(1);
+    if (mBootSector == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+    Status = pDisk->ReadBlocks(pDisk, pDisk->Media->MediaId, 0, 1*512, mBootSector);
+    CopyMem(pBootSector, mBootSector, 1*512);
+    FreePages(mBootSector, 1);
+  }
   DBG("PBR:\n");
   for (i=0; i<4; i++) {
 	  DBG("%04llX: ", i*16);
@@ -10,6 +10,43 @@
 
 MacOsVersion nullMacOsVersion;
 
+// Direct mapped on the hash of the string, a collision just replaces the entry. Failed parses are not cached, to keep lastError.
+#define MAC_OS_VERSION_CACHE_SIZE 64
+
+typedef struct {
+  XString8 versionAsString;
+  int      versionsNumber[AbstractMacOsVersion::nbMaxElement];
+  UINT64   packed;
+} MAC_OS_VERSION_CACHE_ENTRY;
+
+static MAC_OS_VERSION_CACHE_ENTRY macOsVersionCache[MAC_OS_VERSION_CACHE_SIZE];
+
+static size_t macOsVersionCacheSlot(const char* versionAsString)
+{
+  UINT32 hash = 2166136261U;
+  for ( ; *versionAsString ; versionAsString++ ) hash = (hash ^ (UINT8)*versionAsString) * 16777619U;
+  return hash % MAC_OS_VERSION_CACHE_SIZE;
+}
+
+bool MacOsVersion::takeValueFromCache(const char* versionAsString)
+{
+  const MAC_OS_VERSION_CACHE_ENTRY& entry = macOsVersionCache[macOsVersionCacheSlot(versionAsString)];
+  if ( entry.versionAsString.isEmpty() || !entry.versionAsString.equal(versionAsString) ) return false;
+  lastError.setEmpty();
+  memcpy(versionsNumber, entry.versionsNumber, sizeof(versionsNumber));
+  packed = entry.packed;
+  return true;
+}
+
+void MacOsVersion::addToCache(const char* versionAsString) const
+{
+  if ( isEmpty() ) return;
+  MAC_OS_VERSION_CACHE_ENTRY& entry = macOsVersionCache[macOsVersionCacheSlot(versionAsString)];
+  entry.versionAsString.takeValueFrom(versionAsString);
+  memcpy(entry.versionsNumber, versionsNumber, sizeof(versionsNumber));
+  entry.packed = packed;
+}
+
 
 const XString8 getSuffixForMacOsVersion(int LoaderType)
 {
@@ -18,3 +55,26 @@ const XString8 getSuffixForMacOsVersion(int LoaderType)
   if (OSTYPE_IS_OSX(LoaderType)) return "normal"_XS8;
   return NullXString8;
 }
+
+void MacOsVersionPatternList::takeValueFrom(const XString8& list)
+{
+  patterns.setEmpty();
+  all = true;
+  if ( list.isEmpty() ) return;
+  XString8Array items = Split<XString8Array>(list, ","_XS8).trimEachString();
+  if ( items.size() == 0 || items[0] == "All"_XS8 ) return;
+  all = false;
+  for ( size_t i = 0 ; i < items.size() ; i++ ) {
+    MacOsVersionPattern pattern(items[i]);
+    for ( int idx = 0 ; idx < MacOsVersionPattern::nbMaxElement ; idx++ ) patterns.Add(pattern.elementAt(idx));
+  }
+}
+
+bool MacOsVersionPatternList::match(const MacOsVersion& version) const
+{
+  if ( all || version.isEmpty() ) return true; //undefined matched corresponds to old behavior
+  for ( size_t i = 0 ; i < patterns.size() ; i += MacOsVersionPattern::nbMaxElement ) {
+    if ( version.match(&patterns.ElementAt(i)) ) return true;
+  }
+  return false;
+}
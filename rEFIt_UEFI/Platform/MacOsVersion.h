@@ -2,6 +2,7 @@
 #define __MacOsVersion_H__
 
 #include "../cpp_foundation/XStringArray.h"
+#include "../cpp_foundation/XArray.h"
 
 const XString8 getSuffixForMacOsVersion(int LoaderType);
 
@@ -27,6 +28,7 @@ class AbstractMacOsVersion
     void setEmpty() { lastError.setEmpty(); for ( size_t idx=0 ; idx < nbMaxElement ; idx++ ) versionsNumber[idx] = -1; }
     bool isEmpty() const { return versionsNumber[0] == -1; }
     bool notEmpty() const { return !isEmpty(); }
+    const int* numbers() const { return versionsNumber; }
 
     template<typename IntegralType, enable_if(is_integral(IntegralType))>
     int elementAt(IntegralType i) const {
@@ -164,10 +166,31 @@ class MacOsVersionPattern : public AbstractMacOsVersion
 
 class MacOsVersion : public AbstractMacOsVersion
 {
+  protected:
+    // versionsNumber + 1, 12 bits each, first number in the high bits. Ordered like the versions, so comparisons are one integer compare.
+    // 0 if empty or if a number doesn't fit, then comparisons use versionsNumber.
+    UINT64 packed = 0;
+
+    void pack()
+    {
+      packed = 0;
+      for ( size_t idx=0 ; idx < nbMaxElement ; idx++ ) {
+        if ( versionsNumber[idx] < -1 || versionsNumber[idx] > 0xFFE ) { packed = 0; return; }
+        packed = (packed << 12) | (UINT64)(versionsNumber[idx] + 1);
+      }
+    }
+
+    // Memo of the strings parsed by takeValueFrom(). The same literals are parsed for every patch and every entry.
+    bool takeValueFromCache(const char* versionAsString);
+    void addToCache(const char* versionAsString) const;
+
   public:
 
     MacOsVersion() : AbstractMacOsVersion() {};
-    MacOsVersion(int _versionsNumber[nbMaxElement]) : AbstractMacOsVersion(_versionsNumber) {};
+    MacOsVersion(int _versionsNumber[nbMaxElement]) : AbstractMacOsVersion(_versionsNumber) { pack(); };
+
+    void setEmpty() { AbstractMacOsVersion::setEmpty(); packed = 0; }
+    UINT64 packedValue() const { return packed; }
 
     template <class XStringClass, enable_if( is___String(XStringClass) || is___LString(XStringClass) ) >
     MacOsVersion(const XStringClass& versionAsString)
@@ -179,6 +202,9 @@ class MacOsVersion : public AbstractMacOsVersion
 //    MacOsVersion& operator = ( const XStringClass& versionAsString)
     MacOsVersion& takeValueFrom(const XStringClass& versionAsString)
     {
+      // Only char strings are memoized
+      const char* cacheKey = sizeof(typename XStringClass::char_t) == 1 ? (const char*)versionAsString.s() : NULL;
+      if ( cacheKey && takeValueFromCache(cacheKey) ) return *this;
       setEmpty(); // we call our own setEmpty although we already are empty (this is a ctor). That's because in case of nbMaxElement is increased and there is a missing value in versionsNumber array initializer.
       size_t currentElementIdx = 0;
       int* currentElementPtr = &versionsNumber[currentElementIdx];
@@ -210,6 +236,8 @@ class MacOsVersion : public AbstractMacOsVersion
           }
         }
       }
+      pack();
+      if ( cacheKey ) addToCache(cacheKey);
       return *this;
     }
     
@@ -220,38 +248,44 @@ class MacOsVersion : public AbstractMacOsVersion
     {
       lastError = other.lastError;
       memcpy(versionsNumber, other.versionsNumber, sizeof(versionsNumber));
+      packed = other.packed;
     }
     MacOsVersion& operator = ( const MacOsVersion& other)
     {
       lastError = other.lastError;
       memcpy(versionsNumber, other.versionsNumber, sizeof(versionsNumber));
+      packed = other.packed;
       return *this;
     }
 
         
-    bool match(const MacOsVersionPattern& pattern) const
+    bool match(const MacOsVersionPattern& pattern) const { return match(pattern.numbers()); }
+
+    // pattern : the numbers of a MacOsVersionPattern, -1 ends it, -2 is a 'x'
+    bool match(const int pattern[nbMaxElement]) const
     {
-//      int nbMax = nbElemen() <= pattern.nbMaxElement ? nbMaxElement : pattern.nbMaxElement;
       int idx;
-      for ( idx=0 ; idx < nbMaxElement && versionsNumber[idx] != -1 && pattern.elementAt(idx) != -1 ; idx++ ) {
-        if ( pattern.elementAt(idx) == -2 ) continue;
-        if ( versionsNumber[idx] == pattern.elementAt(idx) ) continue;
+      int nb;
+      for ( nb=0 ; nb < nbMaxElement && pattern[nb] != -1 ; nb++ ) {};
+      int last = pattern[nb > 0 ? nb-1 : 0];
+      for ( idx=0 ; idx < nbMaxElement && versionsNumber[idx] != -1 && pattern[idx] != -1 ; idx++ ) {
+        if ( pattern[idx] == -2 ) continue;
+        if ( versionsNumber[idx] == pattern[idx] ) continue;
         return false;
       }
       if ( idx >= nbMaxElement ) return true; // the whole pattern was macthed => ok.
       if ( versionsNumber[idx] == -1 ) {
-        // self is shorter than pattern
-        if ( pattern.elementAt(idx) == -1 ) return true; // pattern and self are the same length, and they matched.
-        if ( pattern.nbElement() == idx+1 && pattern.lastElement() == -2 ) return true;
+        if ( pattern[idx] == -1 ) return true; // pattern and self are the same length, and they matched.
+        if ( nb == idx+1 && last == -2 ) return true;
       }else{
-        // pattern is short then self
-        if ( pattern.lastElement() == -2 ) return true;
+        if ( last == -2 ) return true;
       }
       return false;
     }
     
     bool operator ==(const MacOsVersion &other) const
     {
+      if ( packed && other.packed ) return packed == other.packed;
       for ( size_t idx=0 ; idx < nbMaxElement ; idx++ ) {
         if ( versionsNumber[idx] != other.elementAt(idx) ) return false;
       }
@@ -261,6 +295,7 @@ class MacOsVersion : public AbstractMacOsVersion
     
     bool operator <(const MacOsVersion &other) const
     {
+      if ( packed && other.packed ) return packed < other.packed;
       for ( size_t idx=0 ; idx < nbMaxElement ; idx++ ) {
         if ( versionsNumber[idx] < other.elementAt(idx) ) return true;
         if ( versionsNumber[idx] > other.elementAt(idx) ) return false;
@@ -271,6 +306,7 @@ class MacOsVersion : public AbstractMacOsVersion
     
     bool operator >(const MacOsVersion &other) const
     {
+      if ( packed && other.packed ) return packed > other.packed;
       for ( size_t idx=0 ; idx < nbMaxElement ; idx++ ) {
         if ( versionsNumber[idx] > other.elementAt(idx) ) return true;
         if ( versionsNumber[idx] < other.elementAt(idx) ) return false;
@@ -282,6 +318,23 @@ class MacOsVersion : public AbstractMacOsVersion
 
 
 
+/*
+ * MatchOS of a patch, like "10.14.x,10.15.x,11.x", parsed once when the patch is loaded.
+ * Empty or starting with "All" matches every version.
+ */
+class MacOsVersionPatternList
+{
+  protected:
+    XArray<int> patterns; // nbMaxElement numbers per pattern
+    bool all = true;
+
+  public:
+    MacOsVersionPatternList() : patterns() {};
+
+    void takeValueFrom(const XString8& list);
+    bool match(const MacOsVersion& version) const;
+};
+
 extern MacOsVersion nullMacOsVersion;
 
 #endif // __MacOsVersion_H__
@@ -4,9 +4,13 @@
  */
 
 #include "MemoryOperation.h"
+#include "PerfCounters.h"
 #include <BootLog.h>
 
 #include <Library/BaseMemoryLib.h>
+#ifndef UNIT_TESTS
+#include <Library/MemLogLib.h>
+#endif
 
 #ifndef DEBUG_MEMORYOPERATION
 # ifdef UNIT_TESTS
@@ -20,11 +24,94 @@
 
 #if DEBUG_MEMORYOPERATION == 0
 #define DBG(...)
+#define DBG_AP(...)
 #else
 #define DBG(...) DebugLog(DEBUG_MEMORYOPERATION, __VA_ARGS__)
+// DebugLog() may call boot services, an AP can't
+#define DBG_AP(...) MemLogApf(__VA_ARGS__)
 #endif
 
 
+//
+// SSE2 is part of x86_64, but we still wait for GetCPUProperties() to enable it.
+// GCC and clang vector extensions are used instead of <emmintrin.h> because of freestanding build.
+//
+#if defined(__x86_64__) && defined(__GNUC__)
+#define MEMORY_OPERATION_SSE2 1
+typedef UINT8 MEM_V16 __attribute__((vector_size(16)));
+typedef UINT8 MEM_V16_UNALIGNED __attribute__((vector_size(16), aligned(1)));
+typedef char  MEM_V16_CHAR __attribute__((vector_size(16)));
+#else
+#define MEMORY_OPERATION_SSE2 0
+#endif
+
+static BOOLEAN MemoryOperationSimd = FALSE;
+
+void MemoryOperationSetSimd(BOOLEAN Enable)
+{
+  MemoryOperationSimd = Enable && MEMORY_OPERATION_SSE2;
+}
+
+BOOLEAN MemoryOperationGetSimd(void)
+{
+  return MemoryOperationSimd;
+}
+
+static UINT8 MaskAt(const UINT8 *Mask, UINTN MaskSize, UINTN Ind)
+{
+  return (Mask && Ind < MaskSize) ? Mask[Ind] : 0xFF;
+}
+
+//
+// Returns the first offset in [Pos, Last) where Search is found, or MAX_UINTN.
+// Same result as calling CompareMemMask() at each offset. Like CompareMemMask(), it reads SearchSize bytes
+// at each offset tested, so the caller is responsible for Last.
+// SIMD is only used for offsets where the 16 bytes loads are inside SourceSize, the tail is tested one byte at a time.
+// *Compares is incremented for each CompareMemMask() call, the callers add it to gPerfCounters once.
+//
+static UINTN MemFindNext(const UINT8 *Source, UINTN SourceSize, UINTN Pos, UINTN Last, const UINT8 *Search, UINTN SearchSize, const UINT8 *Mask, UINTN MaskSize, UINT64 *Compares)
+{
+#if MEMORY_OPERATION_SSE2 == 1
+  if (MemoryOperationSimd) {
+    UINT8   MF = MaskAt(Mask, MaskSize, 0);
+    UINT8   ML = MaskAt(Mask, MaskSize, SearchSize - 1);
+    UINT8   F = Search[0] & MF;
+    UINT8   L = Search[SearchSize - 1] & ML;
+    MEM_V16 MaskFirst = { MF, MF, MF, MF, MF, MF, MF, MF, MF, MF, MF, MF, MF, MF, MF, MF };
+    MEM_V16 MaskLast = { ML, ML, ML, ML, ML, ML, ML, ML, ML, ML, ML, ML, ML, ML, ML, ML };
+    MEM_V16 First = { F, F, F, F, F, F, F, F, F, F, F, F, F, F, F, F };
+    MEM_V16 LastByte = { L, L, L, L, L, L, L, L, L, L, L, L, L, L, L, L };
+
+    // a block tests 16 offsets, with 16 bytes loads at Pos and Pos + SearchSize - 1
+    while (Pos < Last && Pos + SearchSize + 15 <= SourceSize) {
+      MEM_V16 BlockFirst = *(const MEM_V16_UNALIGNED *)(Source + Pos) & MaskFirst;
+      MEM_V16 BlockLast = *(const MEM_V16_UNALIGNED *)(Source + Pos + SearchSize - 1) & MaskLast;
+      MEM_V16 Eq = (MEM_V16)((BlockFirst == First) & (BlockLast == LastByte));
+      UINT32  Bits = (UINT32)__builtin_ia32_pmovmskb128((MEM_V16_CHAR)Eq);
+      while (Bits) {
+        UINTN Ofs = Pos + (UINTN)__builtin_ctz(Bits);
+        if (Ofs >= Last) {
+          return MAX_UINTN;
+        }
+        (*Compares)++;
+        if (CompareMemMask(Source + Ofs, Search, SearchSize, Mask, MaskSize)) {
+          return Ofs;
+        }
+        Bits &= Bits - 1;
+      }
+      Pos += 16;
+    }
+  }
+#endif
+  for ( ; Pos < Last; Pos++) {
+    (*Compares)++;
+    if (CompareMemMask(Source + Pos, Search, SearchSize, Mask, MaskSize)) {
+      return Pos;
+    }
+  }
+  return MAX_UINTN;
+}
+
 //
 // Searches Source for Search pattern of size SearchSize
 // and returns the number of occurences.
@@ -32,16 +119,17 @@
 UINTN SearchAndCount(const UINT8 *Source, UINT64 SourceSize, const UINT8 *Search, UINTN SearchSize)
 {
   UINTN        NumFounds = 0;
-  const UINT8  *End = Source + SourceSize;
-  
-  while (Source < End) {
-    if (CompareMem(Source, Search, SearchSize) == 0) {
-      NumFounds++;
-      Source += SearchSize;
-    } else {
-      Source++;
-    }
+  UINTN        Pos = 0;
+  UINT64       Compares = 0;
+
+  if (!Source || !Search || !SearchSize) {
+    return 0;
+  }
+  while ((Pos = MemFindNext(Source, (UINTN)SourceSize, Pos, (UINTN)SourceSize, Search, SearchSize, NULL, 0, &Compares)) != MAX_UINTN) {
+    NumFounds++;
+    Pos += SearchSize;
   }
+  PerfCountersAdd(&gPerfCounters.CompareMemCalls, Compares);
   return NumFounds;
 }
 
@@ -56,15 +144,15 @@ UINTN SearchAndReplace(UINT8 *Source, UINT64 SourceSize, const UINT8 *Search, UI
 {
   UINTN     NumReplaces = 0;
   BOOLEAN   NoReplacesRestriction = MaxReplaces <= 0;
-//  UINT8     *Begin = Source;
-  UINT8     *End = Source + SourceSize;
+  UINTN     Pos = 0;
+  UINT64    Compares = 0;
   if (!Source || !Search || !Replace || !SearchSize) {
     return 0;
   }
   
-  while ((Source < End) && (NoReplacesRestriction || (MaxReplaces > 0))) {
-    if (CompareMem(Source, Search, SearchSize) == 0) {
- //     printf("  found pattern at %llx\n", (UINTN)(Source - Begin));
+  while ((NoReplacesRestriction || (MaxReplaces > 0)) &&
+         (Pos = MemFindNext(Source, (UINTN)SourceSize, Pos, (UINTN)SourceSize, Search, SearchSize, NULL, 0, &Compares)) != MAX_UINTN) {
+ //     printf("  found pattern at %llx\n", Pos);
 
       DBG("Replace " );
       for (UINTN Index = 0; Index < SearchSize; ++Index) {
@@ -73,7 +161,7 @@ UINTN SearchAndReplace(UINT8 *Source, UINT64 SourceSize, const UINT8 *Search, UI
       DBG(" by " );
 
 
-      CopyMem(Source, Replace, SearchSize);
+      CopyMem(Source + Pos, Replace, SearchSize);
 
 
       for (UINTN Index = 0; Index < SearchSize; ++Index) {
@@ -82,11 +170,11 @@ UINTN SearchAndReplace(UINT8 *Source, UINT64 SourceSize, const UINT8 *Search, UI
 
       NumReplaces++;
       MaxReplaces--;
-      Source += SearchSize;
-    } else {
-      Source++;
-    }
+      Pos += SearchSize;
   }
+  PerfCountersAdd(&gPerfCounters.CompareMemCalls, Compares);
+  PerfCountersAdd(&gPerfCounters.PatchMatches, NumReplaces);
+  PerfCountersAdd(&gPerfCounters.PatchReplaces, NumReplaces);
   return NumReplaces;
 }
 
@@ -129,84 +217,97 @@ void CopyMemMask(UINT8 *Dest, const UINT8 *Replace, const UINT8 *Mask, UINTN Sea
 
 UINTN FindMemMask(const UINT8 *Source, UINTN SourceSize, const UINT8 *Search, UINTN SearchSize, const UINT8 *MaskSearch, UINTN MaskSize)
 {
-  if (!Source || !Search || !SearchSize) {
+  if (!Source || !Search || !SearchSize || SourceSize <= SearchSize) {
     return MAX_UINTN;
   }
 
-  for (UINTN i = 0; i < SourceSize - SearchSize; ++i) {
-    if (CompareMemMask(&Source[i], Search, SearchSize, MaskSearch, MaskSize)) {
-      return i;
-    }
-  }
-  return MAX_UINTN;
+  UINT64 Compares = 0;
+  UINTN  Pos = MemFindNext(Source, SourceSize, 0, SourceSize - SearchSize, Search, SearchSize, MaskSearch, MaskSize, &Compares);
+  PerfCountersAdd(&gPerfCounters.CompareMemCalls, Compares);
+  return Pos;
 }
 
-UINTN SearchAndReplaceMask(UINT8 *Source, UINT64 SourceSize, const UINT8 *Search, const UINT8 *MaskSearch, UINTN SearchSize,
-                           const UINT8 *Replace, const UINT8 *MaskReplace, INTN MaxReplaces, INTN Skip)
+//
+// OnAp : only the offset of the replaces is logged, with MemLogApf().
+//
+static UINTN SearchAndReplaceMaskEx(UINT8 *Source, UINT64 SourceSize, const UINT8 *Search, const UINT8 *MaskSearch, UINTN SearchSize,
+                                    const UINT8 *Replace, const UINT8 *MaskReplace, INTN MaxReplaces, INTN Skip, BOOLEAN OnAp)
 {
   UINTN     NumReplaces = 0;
   BOOLEAN   NoReplacesRestriction = MaxReplaces <= 0;
-#if DEBUG_MEMORYOPERATION > 0
-  UINT8*    SourceBak = Source;
-#endif
-  UINT8     *End = Source + SourceSize;
+  UINT8     *Begin = Source;
+  UINTN     Pos = 0;
+  UINT64    Compares = 0;
+  UINT64    Matches = 0;
   if (!Source || !Search || !Replace || !SearchSize) {
     return 0;
   }
-  while ((Source < End) && (NoReplacesRestriction || (MaxReplaces > 0))) {
-    if (CompareMemMask((const UINT8 *)Source, Search, SearchSize, MaskSearch, SearchSize)) {
-      if ( Skip == 0 ) {
-        DBG("Replace " );
+  while ((NoReplacesRestriction || (MaxReplaces > 0)) &&
+         (Pos = MemFindNext(Begin, (UINTN)SourceSize, Pos, (UINTN)SourceSize, Search, SearchSize, MaskSearch, SearchSize, &Compares)) != MAX_UINTN) {
+    Source = Begin + Pos;
+    Matches++;
+    if ( Skip == 0 && OnAp ) {
+      CopyMemMask(Source, Replace, MaskReplace, SearchSize);
+      DBG_AP("Replace at ofs:%llX\n", Pos);
+      NumReplaces++;
+      MaxReplaces--;
+    } else if ( Skip == 0 ) {
+      DBG("Replace " );
+      for (UINTN Index = 0; Index < SearchSize; ++Index) {
+        DBG("%02X", Search[Index]);
+      }
+      if ( MaskSearch ) {
+        DBG("/" );
         for (UINTN Index = 0; Index < SearchSize; ++Index) {
-          DBG("%02X", Search[Index]);
+          DBG("%02X", MaskSearch[Index]);
         }
-        if ( MaskSearch ) {
-          DBG("/" );
-          for (UINTN Index = 0; Index < SearchSize; ++Index) {
-            DBG("%02X", MaskSearch[Index]);
-          }
-          DBG("(" );
-          for (UINTN Index = 0; Index < SearchSize; ++Index) {
-            DBG("%02X", Source[Index]);
-          }
-          DBG(")" );
+        DBG("(" );
+        for (UINTN Index = 0; Index < SearchSize; ++Index) {
+          DBG("%02X", Source[Index]);
         }
-        DBG(" by " );
+        DBG(")" );
+      }
+      DBG(" by " );
 
-        CopyMemMask(Source, Replace, MaskReplace, SearchSize);
+      CopyMemMask(Source, Replace, MaskReplace, SearchSize);
 
+      for (UINTN Index = 0; Index < SearchSize; ++Index) {
+        DBG("%02X", Replace[Index]);
+      }
+      if ( MaskReplace ) {
+        DBG("/");
         for (UINTN Index = 0; Index < SearchSize; ++Index) {
-          DBG("%02X", Replace[Index]);
+          DBG("%02X", MaskReplace[Index]);
         }
-        if ( MaskReplace ) {
-          DBG("/");
-          for (UINTN Index = 0; Index < SearchSize; ++Index) {
-            DBG("%02X", MaskReplace[Index]);
-          }
-          DBG("(");
-          for (UINTN Index = 0; Index < SearchSize; ++Index) {
-            DBG("%02X", Source[Index]);
-          }
-          DBG(")");
+        DBG("(");
+        for (UINTN Index = 0; Index < SearchSize; ++Index) {
+          DBG("%02X", Source[Index]);
         }
+        DBG(")");
+      }
 
-        DBG(" at ofs:%lX\n", Source-SourceBak);
+      DBG(" at ofs:%llX\n", Pos);
 
-        NumReplaces++;
-        MaxReplaces--;
-      }else{
-        --Skip;
-      }
-      Source += SearchSize;
-    } else {
-      Source++;
+      NumReplaces++;
+      MaxReplaces--;
+    }else{
+      --Skip;
     }
-
+    Pos += SearchSize;
   }
 
+  PerfCountersAdd(&gPerfCounters.CompareMemCalls, Compares);
+  PerfCountersAdd(&gPerfCounters.PatchMatches, Matches);
+  PerfCountersAdd(&gPerfCounters.PatchReplaces, NumReplaces);
   return NumReplaces;
 }
 
+UINTN SearchAndReplaceMask(UINT8 *Source, UINT64 SourceSize, const UINT8 *Search, const UINT8 *MaskSearch, UINTN SearchSize,
+                           const UINT8 *Replace, const UINT8 *MaskReplace, INTN MaxReplaces, INTN Skip)
+{
+  return SearchAndReplaceMaskEx(Source, SourceSize, Search, MaskSearch, SearchSize, Replace, MaskReplace, MaxReplaces, Skip, FALSE);
+}
+
 
 UINTN SearchAndReplaceTxt(UINT8 *Source, UINT64 SourceSize, const UINT8 *Search, UINTN SearchSize, const UINT8 *Replace, INTN MaxReplaces)
 {
@@ -267,3 +368,265 @@ UINTN SearchAndReplaceTxt(UINT8 *Source, UINT64 SourceSize, const UINT8 *Search,
   }
   return NumReplaces;
 }
+
+
+//
+// Multi-pattern engine
+//
+
+//
+// Value and mask of byte k of a pattern, as it is in the buffer before (AfterReplace == FALSE)
+// or after (AfterReplace == TRUE) the replace. Bits not known are 0 in Mask.
+//
+static void MultiPatternByteAt(const MULTI_PATTERN_ENTRY *Entry, UINTN k, BOOLEAN AfterReplace, UINT8 *Value, UINT8 *Mask)
+{
+  UINT8 MF = Entry->MaskSearch ? Entry->MaskSearch[k] : 0xFF;
+  UINT8 MR;
+
+  if (!AfterReplace) {
+    *Mask = MF;
+    *Value = Entry->Search[k] & MF;
+    return;
+  }
+  MR = Entry->MaskReplace ? Entry->MaskReplace[k] : 0xFF;
+  *Mask = MR | MF;
+  *Value = (Entry->Replace[k] & MR) | (Entry->Search[k] & MF & ~MR);
+}
+
+//
+// Returns TRUE if there is some data where pattern A and pattern B could both be found with overlapping windows.
+//
+static BOOLEAN MultiPatternCanOverlap(const MULTI_PATTERN_ENTRY *A, BOOLEAN AfterA, const MULTI_PATTERN_ENTRY *B, BOOLEAN AfterB)
+{
+  INTN LenA = (INTN)A->SearchSize;
+  INTN LenB = (INTN)B->SearchSize;
+
+  // d is the offset of B relative to A
+  for (INTN d = 1 - LenB; d < LenA; d++) {
+    INTN    First = d > 0 ? d : 0;
+    INTN    Last = (d + LenB < LenA) ? d + LenB : LenA;
+    BOOLEAN Compatible = TRUE;
+    for (INTN k = First; k < Last && Compatible; k++) {
+      UINT8 VA, MA, VB, MB;
+      MultiPatternByteAt(A, (UINTN)k, AfterA, &VA, &MA);
+      MultiPatternByteAt(B, (UINTN)(k - d), AfterB, &VB, &MB);
+      Compatible = ((VA ^ VB) & MA & MB) == 0;
+    }
+    if (Compatible) {
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+static BOOLEAN MultiPatternInterfere(const MULTI_PATTERN_ENTRY *A, const MULTI_PATTERN_ENTRY *B)
+{
+  return MultiPatternCanOverlap(A, FALSE, B, FALSE) ||
+         MultiPatternCanOverlap(A, FALSE, B, TRUE) ||
+         MultiPatternCanOverlap(B, FALSE, A, TRUE);
+}
+
+//
+// Anchor is the first 2 bytes fully significant of the pattern. Try to avoid 0x00 and 0xFF which are very common in binaries.
+//
+static UINTN MultiPatternFindAnchor(const MULTI_PATTERN_ENTRY *Entry)
+{
+  UINTN Anchor = MULTI_PATTERN_NO_ANCHOR;
+
+  for (UINTN k = 0; k + 1 < Entry->SearchSize; k++) {
+    if (Entry->MaskSearch && (Entry->MaskSearch[k] != 0xFF || Entry->MaskSearch[k + 1] != 0xFF)) {
+      continue;
+    }
+    if (Anchor == MULTI_PATTERN_NO_ANCHOR) {
+      Anchor = k;
+    }
+    if ((Entry->Search[k] != 0x00 && Entry->Search[k] != 0xFF) || (Entry->Search[k + 1] != 0x00 && Entry->Search[k + 1] != 0xFF)) {
+      return k;
+    }
+  }
+  return Anchor;
+}
+
+void MultiPatternCompile(MULTI_PATTERN_ENTRY *Entries, UINTN Count)
+{
+  UINTN   Run = 0;
+  UINTN   RunStart = 0;
+  BOOLEAN RunOpen = FALSE;
+
+  for (UINTN i = 0; i < Count; i++) {
+    MULTI_PATTERN_ENTRY *Entry = &Entries[i];
+
+    Entry->NextInBucket = MAX_UINTN;
+    Entry->NumReplaces = 0;
+    if (!Entry->Search || !Entry->Replace || !Entry->SearchSize) {
+      Entry->Run = MAX_UINTN;
+      RunOpen = FALSE;
+      continue;
+    }
+    Entry->AnchorOffset = MultiPatternFindAnchor(Entry);
+    if (Entry->AnchorOffset == MULTI_PATTERN_NO_ANCHOR) {
+      // will be applied alone with SearchAndReplaceMask()
+      Entry->Run = ++Run;
+      RunOpen = FALSE;
+      continue;
+    }
+    if (RunOpen) {
+      UINTN j = RunStart;
+      while (j < i && !MultiPatternInterfere(&Entries[j], Entry)) {
+        j++;
+      }
+      if (j == i) {
+        Entry->Run = Run;
+        continue;
+      }
+    }
+    Entry->Run = ++Run;
+    RunStart = i;
+    RunOpen = TRUE;
+  }
+  DBG("MultiPatternCompile: %llu patterns in %llu runs\n", Count, Run);
+}
+
+static UINTN MultiPatternApplyRun(MULTI_PATTERN_ENTRY *Entries, UINTN Count, MULTI_PATTERN_INDEX *Index, UINT8 *Source, UINTN SourceSize, BOOLEAN OnAp)
+{
+  UINTN NumReplaces = 0;
+  UINTN Live = 0;
+  UINTN ScanStart = MAX_UINTN;
+  UINTN ScanEnd = 0;
+  UINT64 Compares = 0;
+  UINT64 Matches = 0;
+
+  SetMem(Index->Head, sizeof(Index->Head), 0xFF);
+  ZeroMem(Index->Filter, sizeof(Index->Filter));
+
+  // insert backward, so bucket lists are in entries order
+  for (UINTN k = Count; k-- > 0; ) {
+    MULTI_PATTERN_ENTRY *Entry = &Entries[k];
+    const UINT8         *Anchor;
+    UINT16               Key;
+
+    Entry->NumReplaces = 0;
+    if (!Entry->Active || Entry->Start >= SourceSize || Entry->SearchSize > SourceSize - Entry->Start) {
+      continue;
+    }
+    Entry->Pos = Entry->Start;
+    Entry->End = SourceSize - Entry->SearchSize + 1;
+    if (Entry->Length < Entry->End - Entry->Start) {
+      Entry->End = Entry->Start + Entry->Length;
+    }
+    Entry->SkipLeft = Entry->Skip;
+    Entry->ReplacesLeft = Entry->MaxReplaces;
+
+    Anchor = Entry->Search + Entry->AnchorOffset;
+    Key = (UINT16)(Anchor[0] | (Anchor[1] << 8));
+    Index->Filter[Key >> 3] |= (UINT8)(1 << (Key & 7));
+    Entry->NextInBucket = Index->Head[Anchor[0]];
+    Index->Head[Anchor[0]] = k;
+
+    if (Entry->Start + Entry->AnchorOffset < ScanStart) {
+      ScanStart = Entry->Start + Entry->AnchorOffset;
+    }
+    if (Entry->End + Entry->AnchorOffset + 1 > ScanEnd) {
+      ScanEnd = Entry->End + Entry->AnchorOffset + 1;
+    }
+    Live++;
+  }
+
+  // p is the position of anchors in Source. ScanEnd <= SourceSize, so Source[p + 1] is always readable.
+  for (UINTN p = ScanStart; p + 1 < ScanEnd && Live > 0; p++) {
+    UINT16 Key = (UINT16)(Source[p] | (Source[p + 1] << 8));
+    if ((Index->Filter[Key >> 3] & (1 << (Key & 7))) == 0) {
+      continue;
+    }
+    for (UINTN k = Index->Head[Source[p]]; k != MAX_UINTN; k = Entries[k].NextInBucket) {
+      MULTI_PATTERN_ENTRY *Entry = &Entries[k];
+      UINTN                Ofs;
+
+      if (Entry->Search[Entry->AnchorOffset + 1] != Source[p + 1] || p < Entry->AnchorOffset) {
+        continue;
+      }
+      if (Entry->MaxReplaces > 0 && Entry->ReplacesLeft == 0) {
+        continue;
+      }
+      Ofs = p - Entry->AnchorOffset;
+      if (Ofs < Entry->Pos || Ofs >= Entry->End) {
+        continue;
+      }
+      Compares++;
+      if (!CompareMemMask(Source + Ofs, Entry->Search, Entry->SearchSize, Entry->MaskSearch, Entry->SearchSize)) {
+        continue;
+      }
+      Matches++;
+      if (Entry->SkipLeft == 0) {
+        CopyMemMask(Source + Ofs, Entry->Replace, Entry->MaskReplace, Entry->SearchSize);
+        if (OnAp) {
+          DBG_AP("MultiPattern: entry %llu replaced at ofs:%llX\n", k, Ofs);
+        } else {
+          DBG("MultiPattern: entry %llu replaced at ofs:%llX\n", k, Ofs);
+        }
+        Entry->NumReplaces++;
+        NumReplaces++;
+        if (Entry->MaxReplaces > 0 && --Entry->ReplacesLeft == 0) {
+          Live--;
+        }
+      } else {
+        --Entry->SkipLeft;
+      }
+      Entry->Pos = Ofs + Entry->SearchSize;
+    }
+  }
+  PerfCountersAdd(&gPerfCounters.CompareMemCalls, Compares);
+  PerfCountersAdd(&gPerfCounters.PatchMatches, Matches);
+  PerfCountersAdd(&gPerfCounters.PatchReplaces, NumReplaces);
+  return NumReplaces;
+}
+
+static UINTN MultiPatternApplyEx(MULTI_PATTERN_ENTRY *Entries, UINTN Count, MULTI_PATTERN_INDEX *Index, UINT8 *Source, UINTN SourceSize, BOOLEAN OnAp)
+{
+  UINTN NumReplaces = 0;
+  UINTN i = 0;
+
+  if (!Entries || !Index || !Source) {
+    return 0;
+  }
+  while (i < Count) {
+    MULTI_PATTERN_ENTRY *Entry = &Entries[i];
+    UINTN                RunEnd;
+
+    if (!Entry->Active || Entry->Run == MAX_UINTN) {
+      i++;
+      continue;
+    }
+    if (Entry->AnchorOffset == MULTI_PATTERN_NO_ANCHOR) {
+      Entry->NumReplaces = 0;
+      if (Entry->Start < SourceSize) {
+        UINTN Length = SourceSize - Entry->Start;
+        if (Entry->Length < Length) {
+          Length = Entry->Length;
+        }
+        Entry->NumReplaces = SearchAndReplaceMaskEx(Source + Entry->Start, Length, Entry->Search, Entry->MaskSearch, Entry->SearchSize,
+                                                    Entry->Replace, Entry->MaskReplace, Entry->MaxReplaces, Entry->Skip, OnAp);
+      }
+      NumReplaces += Entry->NumReplaces;
+      i++;
+      continue;
+    }
+    RunEnd = i + 1;
+    while (RunEnd < Count && Entries[RunEnd].Run == Entry->Run) {
+      RunEnd++;
+    }
+    NumReplaces += MultiPatternApplyRun(Entries + i, RunEnd - i, Index, Source, SourceSize, OnAp);
+    i = RunEnd;
+  }
+  return NumReplaces;
+}
+
+UINTN MultiPatternApply(MULTI_PATTERN_ENTRY *Entries, UINTN Count, MULTI_PATTERN_INDEX *Index, UINT8 *Source, UINTN SourceSize)
+{
+  return MultiPatternApplyEx(Entries, Count, Index, Source, SourceSize, FALSE);
+}
+
+UINTN MultiPatternApplyOnAp(MULTI_PATTERN_ENTRY *Entries, UINTN Count, MULTI_PATTERN_INDEX *Index, UINT8 *Source, UINTN SourceSize)
+{
+  return MultiPatternApplyEx(Entries, Count, Index, Source, SourceSize, TRUE);
+}
@@ -23,6 +23,12 @@ extern "C" {
 //#include <Library/DebugLib.h>
 
 
+//
+// Enables SSE2 search, and SSE2 XImage::ComposeRow() and nanosvg scanline fill. Called once by GetCPUProperties(), from CPUID. Ignored if not compiled for x86_64.
+//
+void MemoryOperationSetSimd(BOOLEAN Enable);
+BOOLEAN MemoryOperationGetSimd(void);
+
 //
 // Searches Source for Search pattern of size SearchSize
 // and returns the number of occurences.
@@ -51,6 +57,64 @@ UINTN SearchAndReplaceMask(UINT8 *Source, UINT64 SourceSize, const UINT8 *Search
 UINTN SearchAndReplaceTxt(UINT8 *Source, UINT64 SourceSize, const UINT8 *Search, UINTN SearchSize, const UINT8 *Replace, INTN MaxReplaces);
 
 
+//
+// Multi-pattern search and replace.
+// A set of masked patterns is compiled once by MultiPatternCompile(), then MultiPatternApply() applies
+// all the active ones with a single pass over the buffer instead of one SearchAndReplaceMask() per pattern.
+// Entries are grouped in runs of consecutive patterns that cannot interfere with each other (no pattern
+// can match over bytes found or written by another one of the same run), so the result is identical to
+// calling SearchAndReplaceMask() for each entry, in order.
+// Count (MaxReplaces) and Skip semantics are the same as SearchAndReplaceMask().
+//
+#define MULTI_PATTERN_NO_ANCHOR MAX_UINTN
+
+typedef struct {
+  // Pattern, set before MultiPatternCompile(). Search == NULL means the caller handles this entry itself.
+  const UINT8  *Search;
+  const UINT8  *MaskSearch;   // can be NULL
+  UINTN         SearchSize;
+  const UINT8  *Replace;
+  const UINT8  *MaskReplace;  // can be NULL
+  INTN          MaxReplaces;  // <= 0 : no restriction
+  INTN          Skip;
+  // Set before each MultiPatternApply()
+  BOOLEAN       Active;
+  UINTN         Start;        // offset of the search window in the buffer
+  UINTN         Length;       // size of the search window
+  // Result of MultiPatternApply()
+  UINTN         NumReplaces;
+  // Private
+  UINTN         Run;
+  UINTN         AnchorOffset; // offset in Search of 2 bytes fully masked, MULTI_PATTERN_NO_ANCHOR if none
+  UINTN         NextInBucket;
+  UINTN         Pos;          // next allowed match offset
+  UINTN         End;          // end (excluded) of allowed match offsets
+  INTN          SkipLeft;
+  INTN          ReplacesLeft;
+} MULTI_PATTERN_ENTRY;
+
+//
+// Scratch index used by MultiPatternApply(). Allocated by the caller so the engine never allocates memory.
+//
+typedef struct {
+  UINTN  Head[256];              // first entry (index) for an anchor first byte
+  UINT8  Filter[0x10000 / 8];    // one bit per anchor 2 bytes value
+} MULTI_PATTERN_INDEX;
+
+void MultiPatternCompile(MULTI_PATTERN_ENTRY *Entries, UINTN Count);
+
+//
+// Applies all the entries with Active == TRUE.
+// Returns number of replaces done. Entries[i].NumReplaces is updated for each active entry.
+//
+UINTN MultiPatternApply(MULTI_PATTERN_ENTRY *Entries, UINTN Count, MULTI_PATTERN_INDEX *Index, UINT8 *Source, UINTN SourceSize);
+
+//
+// Same, but safe to call on an AP : nothing is logged with DebugLog(), replaces are logged with MemLogApf().
+//
+UINTN MultiPatternApplyOnAp(MULTI_PATTERN_ENTRY *Entries, UINTN Count, MULTI_PATTERN_INDEX *Index, UINT8 *Source, UINTN SourceSize);
+
+
 #ifdef __cplusplus
 }
 #endif
@@ -11,6 +11,8 @@
 #include "BootOptions.h"
 #include "guid.h"
 #include "../gui/REFIT_MENU_SCREEN.h"
+#include "Self.h"
+#include "Checksum.h"
 
 #ifndef DEBUG_ALL
 #define DEBUG_SET 1
@@ -93,6 +95,415 @@ GetEfiTimeInMs (
     return TimeMs;
 }
 
+//
+// Snapshot of the Apple boot and vendor variables : one GetNextVariableName sweep, then the reads
+// of these GUIDs, absent variables included, are served from memory. NvramSetVariable() writes through,
+// except between NvramBeginBatch() and NvramFlush() : the writes only change the snapshot, a variable
+// written several times is written once, and a write of the value already there is dropped.
+// EmuVariable swaps the variable services in and out, the snapshot belongs to the services it was read with.
+//
+typedef struct {
+  EFI_GUID  Guid;
+  CHAR16   *Name;
+  BOOLEAN   Present;          // FALSE : deleted, not flushed yet
+  BOOLEAN   Dirty;            // written by the next flush
+  BOOLEAN   FlashPresent;     // what the firmware holds while Dirty
+  UINT32    FlashAttributes;
+  UINT32    Attributes;
+  UINTN     DataSize;
+  UINT8    *Data;
+} NVRAM_SNAPSHOT_VAR;
+
+static NVRAM_SNAPSHOT_VAR *SnapshotVars = NULL;
+static UINTN               SnapshotCount = 0;
+static UINTN               SnapshotCapacity = 0;
+static BOOLEAN             SnapshotValid = FALSE;
+static BOOLEAN             SnapshotTried = FALSE;
+static BOOLEAN             SnapshotBatch = FALSE;
+static UINTN               SnapshotDirtyCount = 0;
+static EFI_GET_VARIABLE    SnapshotService = NULL;
+static EFI_SET_VARIABLE    SnapshotSetService = NULL;
+
+static BOOLEAN SnapshotGuid(CONST EFI_GUID *Guid)
+{
+  return CompareGuid(Guid, &gEfiAppleBootGuid) || CompareGuid(Guid, &gEfiAppleVendorGuid);
+}
+
+static void SnapshotFree(void)
+{
+  UINTN Index;
+
+  for (Index = 0; Index < SnapshotCount; Index++) {
+    FreePool(SnapshotVars[Index].Name);
+    if (SnapshotVars[Index].Data != NULL) {
+      FreePool(SnapshotVars[Index].Data);
+    }
+  }
+  if (SnapshotVars != NULL) {
+    FreePool(SnapshotVars);
+    SnapshotVars = NULL;
+  }
+  SnapshotCount = 0;
+  SnapshotCapacity = 0;
+  SnapshotDirtyCount = 0;
+  SnapshotValid = FALSE;
+}
+
+static NVRAM_SNAPSHOT_VAR* SnapshotFind(CONST CHAR16 *Name, CONST EFI_GUID *Guid)
+{
+  UINTN Index;
+
+  for (Index = 0; Index < SnapshotCount; Index++) {
+    if (CompareGuid(&SnapshotVars[Index].Guid, Guid) && StrCmp(SnapshotVars[Index].Name, Name) == 0) {
+      return &SnapshotVars[Index];
+    }
+  }
+  return NULL;
+}
+
+// Replaces or adds the value. NULL if out of memory.
+static NVRAM_SNAPSHOT_VAR* SnapshotStore(CONST CHAR16 *Name, CONST EFI_GUID *Guid, UINT32 Attributes, UINTN DataSize, CONST void *Data)
+{
+  NVRAM_SNAPSHOT_VAR *Var = SnapshotFind(Name, Guid);
+  UINT8              *NewData = NULL;
+
+  if (DataSize != 0) {
+    NewData = (UINT8*)AllocateCopyPool(DataSize, Data);
+    if (NewData == NULL) {
+      return NULL;
+    }
+  }
+  if (Var == NULL) {
+    if (SnapshotCount == SnapshotCapacity) {
+      UINTN NewCapacity = (SnapshotCapacity == 0) ? 32 : SnapshotCapacity * 2;
+      NVRAM_SNAPSHOT_VAR *NewVars = (NVRAM_SNAPSHOT_VAR*)ReallocatePool(SnapshotCapacity * sizeof(NVRAM_SNAPSHOT_VAR),
+                                                                        NewCapacity * sizeof(NVRAM_SNAPSHOT_VAR), SnapshotVars);
+      if (NewVars == NULL) {
+        if (NewData != NULL) {
+          FreePool(NewData);
+        }
+        return NULL;
+      }
+      SnapshotVars = NewVars;
+      SnapshotCapacity = NewCapacity;
+    }
+    Var = &SnapshotVars[SnapshotCount];
+    ZeroMem(Var, sizeof(*Var));
+    Var->Name = (CHAR16*)AllocateCopyPool(StrSize(Name), Name);
+    if (Var->Name == NULL) {
+      if (NewData != NULL) {
+        FreePool(NewData);
+      }
+      return NULL;
+    }
+    CopyGuid(&Var->Guid, Guid);
+    SnapshotCount++;
+  } else if (Var->Data != NULL) {
+    FreePool(Var->Data);
+  }
+  Var->Present = TRUE;
+  Var->Attributes = Attributes;
+  Var->DataSize = DataSize;
+  Var->Data = NewData;
+  return Var;
+}
+
+static void SnapshotRemoveAt(UINTN Index)
+{
+  NVRAM_SNAPSHOT_VAR *Var = &SnapshotVars[Index];
+
+  FreePool(Var->Name);
+  if (Var->Data != NULL) {
+    FreePool(Var->Data);
+  }
+  *Var = SnapshotVars[--SnapshotCount];
+}
+
+static void SnapshotRemove(CONST CHAR16 *Name, CONST EFI_GUID *Guid)
+{
+  NVRAM_SNAPSHOT_VAR *Var = SnapshotFind(Name, Guid);
+
+  if (Var != NULL) {
+    SnapshotRemoveAt((UINTN)(Var - SnapshotVars));
+  }
+}
+
+static void SnapshotBuild(void)
+{
+  EFI_STATUS Status;
+  EFI_GUID   Guid;
+  CHAR16    *Name;
+  UINTN      NameSize = 64 * sizeof(CHAR16);
+  UINTN      NewNameSize;
+  UINT8     *Data = NULL;
+  UINTN      DataCapacity = 0;
+  UINTN      DataSize;
+  UINT32     Attributes;
+
+  SnapshotFree();
+  SnapshotTried = TRUE;
+  SnapshotService = gRT->GetVariable;
+  SnapshotSetService = gRT->SetVariable;
+  Name = (CHAR16*)AllocateZeroPool(NameSize);
+  if (Name == NULL) {
+    return;
+  }
+  ZeroMem(&Guid, sizeof(Guid));
+
+  while (TRUE) {
+    NewNameSize = NameSize;
+    Status = gRT->GetNextVariableName(&NewNameSize, Name, &Guid);
+    if (Status == EFI_BUFFER_TOO_SMALL) {
+      Name = (CHAR16*)ReallocatePool(NameSize, NewNameSize, Name);
+      if (Name == NULL) {
+        break;
+      }
+      NameSize = NewNameSize;
+      Status = gRT->GetNextVariableName(&NewNameSize, Name, &Guid);
+    }
+    if (Status == EFI_NOT_FOUND) {
+      SnapshotValid = TRUE;
+      break;
+    }
+    if (EFI_ERROR(Status)) {
+      break;
+    }
+    if (!SnapshotGuid(&Guid)) {
+      continue;
+    }
+    DataSize = DataCapacity;
+    Status = gRT->GetVariable(Name, &Guid, &Attributes, &DataSize, Data);
+    if (Status == EFI_BUFFER_TOO_SMALL) {
+      Data = (UINT8*)ReallocatePool(DataCapacity, DataSize, Data);
+      if (Data == NULL) {
+        break;
+      }
+      DataCapacity = DataSize;
+      Status = gRT->GetVariable(Name, &Guid, &Attributes, &DataSize, Data);
+    }
+    if (EFI_ERROR(Status) || SnapshotStore(Name, &Guid, Attributes, DataSize, Data) == NULL) {
+      break;
+    }
+  }
+
+  if (Name != NULL) {
+    FreePool(Name);
+  }
+  if (Data != NULL) {
+    FreePool(Data);
+  }
+  if (!SnapshotValid) {
+    // the reads go to the firmware
+    SnapshotFree();
+  }
+  DBG("NVRAM snapshot: %s, %llu variables\n", SnapshotValid ? "ok" : "failed", SnapshotCount);
+}
+
+// Drops the snapshot, it's read again at the next access
+static void SnapshotInvalidate(void)
+{
+  SnapshotFree();
+  SnapshotTried = FALSE;
+}
+
+// Writes the dirty variables with the services the snapshot was read with
+static EFI_STATUS SnapshotWriteBack(void)
+{
+  EFI_STATUS          Status = EFI_SUCCESS;
+  EFI_STATUS          WriteStatus;
+  NVRAM_SNAPSHOT_VAR *Var;
+  UINTN               Index;
+  UINTN               Written = 0;
+
+  if (SnapshotDirtyCount == 0) {
+    return EFI_SUCCESS;
+  }
+  for (Index = 0; Index < SnapshotCount; Index++) {
+    Var = &SnapshotVars[Index];
+    if (!Var->Dirty) {
+      continue;
+    }
+    Var->Dirty = FALSE;
+    WriteStatus = EFI_SUCCESS;
+    if (Var->FlashPresent && (!Var->Present || Var->FlashAttributes != Var->Attributes)) {
+      // the attributes of an existing variable can't be changed
+      WriteStatus = SnapshotSetService(Var->Name, &Var->Guid, 0, 0, NULL);
+    }
+    if (!EFI_ERROR(WriteStatus) && Var->Present) {
+      WriteStatus = SnapshotSetService(Var->Name, &Var->Guid, Var->Attributes, Var->DataSize, Var->Data);
+    }
+    if (EFI_ERROR(WriteStatus)) {
+      DBG("NVRAM flush: %ls: %s\n", Var->Name, efiStrError(WriteStatus));
+      Status = WriteStatus;
+    }
+    Written++;
+  }
+  SnapshotDirtyCount = 0;
+  DBG("NVRAM flush: %llu variables written\n", Written);
+
+  if (EFI_ERROR(Status)) {
+    // what the firmware holds isn't known
+    SnapshotInvalidate();
+    return Status;
+  }
+  for (Index = SnapshotCount; Index-- > 0; ) {
+    if (!SnapshotVars[Index].Present) {
+      SnapshotRemoveAt(Index);
+    }
+  }
+  return Status;
+}
+
+// Builds the snapshot if needed. Pending writes go to the services they were made for.
+static void SnapshotCheck(void)
+{
+  if (SnapshotTried && SnapshotService != gRT->GetVariable) {
+    SnapshotWriteBack();
+    SnapshotInvalidate();
+  }
+  if (!SnapshotTried) {
+    SnapshotBuild();
+  }
+}
+
+/** Until NvramFlush(), the writes of the Apple GUIDs stay in memory. */
+void NvramBeginBatch(void)
+{
+  SnapshotBatch = TRUE;
+}
+
+/** Writes what changed since NvramBeginBatch() and ends the batch. To be called before starting an OS. */
+EFI_STATUS NvramFlush(void)
+{
+  SnapshotBatch = FALSE;
+  return SnapshotWriteBack();
+}
+
+/** gRT->GetVariable(), served from the snapshot for the Apple GUIDs. */
+EFI_STATUS
+NvramGetVariable (
+  IN      CONST CHAR16   *VariableName,
+  IN      EFI_GUID       *VendorGuid,
+  OUT     UINT32         *Attributes    OPTIONAL,
+  IN OUT  UINTN          *DataSize,
+  OUT     void           *Data          OPTIONAL
+  )
+{
+  NVRAM_SNAPSHOT_VAR *Var;
+
+  if (SnapshotGuid(VendorGuid)) {
+    SnapshotCheck();
+    if (SnapshotValid) {
+      Var = SnapshotFind(VariableName, VendorGuid);
+      if (Var == NULL || !Var->Present) {
+        return EFI_NOT_FOUND;
+      }
+      if (Attributes != NULL) {
+        *Attributes = Var->Attributes;
+      }
+      if (*DataSize < Var->DataSize) {
+        *DataSize = Var->DataSize;
+        return EFI_BUFFER_TOO_SMALL;
+      }
+      *DataSize = Var->DataSize;
+      CopyMem(Data, Var->Data, Var->DataSize);
+      return EFI_SUCCESS;
+    }
+  }
+  return gRT->GetVariable(VariableName, VendorGuid, Attributes, DataSize, Data);
+}
+
+/** gRT->SetVariable(), the snapshot is kept up to date. A write that changes nothing is dropped. */
+EFI_STATUS
+NvramSetVariable (
+  IN  CONST CHAR16   *VariableName,
+  IN  EFI_GUID       *VendorGuid,
+  IN  UINT32         Attributes,
+  IN  UINTN          DataSize,
+  IN  CONST void     *Data
+  )
+{
+  EFI_STATUS          Status;
+  NVRAM_SNAPSHOT_VAR *Var;
+  BOOLEAN             Delete;
+  BOOLEAN             FlashPresent;
+  UINT32              FlashAttributes;
+
+  if (!SnapshotGuid(VendorGuid)) {
+    return gRT->SetVariable(VariableName, VendorGuid, Attributes, DataSize, (void*)Data); // CONST missing in EFI_SET_VARIABLE->SetVariable
+  }
+  SnapshotCheck();
+  if (!SnapshotValid) {
+    return gRT->SetVariable(VariableName, VendorGuid, Attributes, DataSize, (void*)Data);
+  }
+  if ((Attributes & EFI_VARIABLE_APPEND_WRITE) != 0) {
+    // the firmware does the append, after the pending writes
+    SnapshotWriteBack();
+    Status = gRT->SetVariable(VariableName, VendorGuid, Attributes, DataSize, (void*)Data);
+    SnapshotInvalidate();
+    return Status;
+  }
+
+  Delete = DataSize == 0 || (Attributes & (EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS)) == 0;
+  Var = SnapshotFind(VariableName, VendorGuid);
+  if (Var == NULL || !Var->Present) {
+    if (Delete) {
+      return EFI_NOT_FOUND;
+    }
+  } else if (!Delete &&
+             Var->Attributes == Attributes &&
+             Var->DataSize == DataSize &&
+             CompareMem(Var->Data, Data, DataSize) == 0) {
+    return EFI_SUCCESS;
+  }
+
+  if (!SnapshotBatch) {
+    Status = gRT->SetVariable(VariableName, VendorGuid, Attributes, DataSize, (void*)Data);
+    if (EFI_ERROR(Status) && Status != EFI_DEVICE_ERROR) {
+      // refused, the variable is unchanged
+      return Status;
+    }
+    if (!EFI_ERROR(Status)) {
+      if (Delete) {
+        SnapshotRemove(VariableName, VendorGuid);
+        return Status;
+      }
+      if (SnapshotStore(VariableName, VendorGuid, Attributes, DataSize, Data) != NULL) {
+        return Status;
+      }
+    }
+    // what the firmware holds isn't known
+    SnapshotInvalidate();
+    return Status;
+  }
+
+  // batch : the firmware state before the first pending write is kept for the flush
+  FlashPresent = (Var == NULL) ? FALSE : (Var->Dirty ? Var->FlashPresent : Var->Present);
+  FlashAttributes = (Var == NULL) ? 0 : (Var->Dirty ? Var->FlashAttributes : Var->Attributes);
+  if (Delete) {
+    if (Var->Data != NULL) {
+      FreePool(Var->Data);
+      Var->Data = NULL;
+    }
+    Var->DataSize = 0;
+    Var->Present = FALSE;
+  } else {
+    Var = SnapshotStore(VariableName, VendorGuid, Attributes, DataSize, Data);
+    if (Var == NULL) {
+      SnapshotWriteBack();
+      SnapshotInvalidate();
+      return gRT->SetVariable(VariableName, VendorGuid, Attributes, DataSize, (void*)Data);
+    }
+  }
+  if (!Var->Dirty) {
+    Var->Dirty = TRUE;
+    SnapshotDirtyCount++;
+  }
+  Var->FlashPresent = FlashPresent;
+  Var->FlashAttributes = FlashAttributes;
+  return EFI_SUCCESS;
+}
+
 /** Reads and returns value of NVRAM variable. */
 void *GetNvramVariable(
 	IN      CONST CHAR16   *VariableName,
@@ -107,7 +518,7 @@ void *GetNvramVariable(
   //
   UINTN      IntDataSize = 0;
   
-  Status = gRT->GetVariable (VariableName, VendorGuid, Attributes, &IntDataSize, NULL);
+  Status = NvramGetVariable (VariableName, VendorGuid, Attributes, &IntDataSize, NULL);
   if (IntDataSize == 0) {
     return NULL;
   }
@@ -121,7 +532,7 @@ void *GetNvramVariable(
       //
       // Read variable into the allocated buffer.
       //
-      Status = gRT->GetVariable (VariableName, VendorGuid, Attributes, &IntDataSize, Data);
+      Status = NvramGetVariable (VariableName, VendorGuid, Attributes, &IntDataSize, Data);
       if (EFI_ERROR(Status)) {
         FreePool(Data);
         IntDataSize = 0;
@@ -149,7 +560,7 @@ XString8 GetNvramVariableAsXString8(
   //
   UINTN      IntDataSize = 0;
   
-  Status = gRT->GetVariable (VariableName, VendorGuid, Attributes, &IntDataSize, NULL);
+  Status = NvramGetVariable (VariableName, VendorGuid, Attributes, &IntDataSize, NULL);
   if (IntDataSize == 0) {
     return NullXString8;
   }
@@ -158,7 +569,7 @@ XString8 GetNvramVariableAsXString8(
     //
     // Read variable into the allocated buffer.
     //
-    Status = gRT->GetVariable(VariableName, VendorGuid, Attributes, &IntDataSize, returnValue.dataSized(IntDataSize+1));
+    Status = NvramGetVariable(VariableName, VendorGuid, Attributes, &IntDataSize, returnValue.dataSized(IntDataSize+1));
     if (EFI_ERROR(Status)) {
       IntDataSize = 0;
       returnValue.setEmpty();
@@ -214,8 +625,7 @@ SetNvramVariable (
   //DBG(" -> writing new (%s)\n", efiStrError(Status));
   //return Status;
  
-  return gRT->SetVariable(VariableName, VendorGuid, Attributes, DataSize, (void*)Data); // CONST missing in EFI_SET_VARIABLE->SetVariable
-  
+  return NvramSetVariable(VariableName, VendorGuid, Attributes, DataSize, Data);
 }
 EFI_STATUS
 SetNvramXString8 (
@@ -245,7 +655,7 @@ AddNvramVariable (
   if (OldData == NULL)
   {
     // set new value
-    return gRT->SetVariable(VariableName, VendorGuid, Attributes, DataSize, Data);
+    return NvramSetVariable(VariableName, VendorGuid, Attributes, DataSize, Data);
 //  DBG(" -> writing new (%s)\n", efiStrError(Status));
 	} else {
 		FreePool(OldData);
@@ -274,7 +684,7 @@ DeleteNvramVariable (
   EFI_STATUS Status;
     
   // Delete: attributes and data size = 0
-  Status = gRT->SetVariable (VariableName, VendorGuid, 0, 0, NULL);
+  Status = NvramSetVariable (VariableName, VendorGuid, 0, 0, NULL);
   //DBG("DeleteNvramVariable (%ls, guid = %s):\n", VariableName, efiStrError(Status));
     
   return Status;
@@ -725,6 +1135,51 @@ BootVolumeDevicePathEqual (
 }
 
 
+/** Hash of what BootVolumeDevicePathEqual() compares, equal dev paths have the same hash.
+ *  Acpi nodes only count as Acpi, Sata, VenHw and NVMe nodes as a disk node, other nodes with all their bytes.
+ */
+UINT32
+BootVolumeDevicePathHash (
+  const   EFI_DEVICE_PATH_PROTOCOL *DevicePath
+  )
+{
+  UINT32      Hash = 2166136261u;
+  UINT8       Type;
+  UINT8       SubType;
+  UINTN       Len;
+  UINTN       Index;
+  const UINT8 *Node;
+
+  if (DevicePath == NULL) {
+    return 0;
+  }
+  while (TRUE) {
+    Type    = DevicePathType (DevicePath);
+    SubType = DevicePathSubType (DevicePath);
+    Len     = DevicePathNodeLength (DevicePath);
+    if (Len < sizeof(EFI_DEVICE_PATH_PROTOCOL)) {
+      break;
+    }
+    if (Type == ACPI_DEVICE_PATH) {
+      Hash = (Hash ^ ACPI_DEVICE_PATH) * 16777619u;
+    } else if ((Type == MESSAGING_DEVICE_PATH && (SubType == MSG_SATA_DP || SubType == MSG_NVME_NAMESPACE_DP))
+               || (Type == HARDWARE_DEVICE_PATH && SubType == HW_VENDOR_DP)) {
+      Hash = (Hash ^ MESSAGING_DEVICE_PATH) * 16777619u;
+    } else {
+      Node = (const UINT8 *)DevicePath;
+      for (Index = 0; Index < Len; Index++) {
+        Hash = (Hash ^ Node[Index]) * 16777619u;
+      }
+    }
+    if (IsDevicePathEnd (DevicePath)) {
+      break;
+    }
+    DevicePath = NextDevicePathNode (DevicePath);
+  }
+  return Hash;
+}
+
+
 /** Returns TRUE if dev paths contain the same MEDIA_DEVICE_PATH. */
 BOOLEAN
 BootVolumeMediaDevicePathNodesEqual (
@@ -742,7 +1197,7 @@ BootVolumeMediaDevicePathNodesEqual (
         return FALSE;
     }
     
-    return (DevicePathNodeLength (DevicePath1) == DevicePathNodeLength (DevicePath1))
+    return (DevicePathNodeLength (DevicePath1) == DevicePathNodeLength (DevicePath2))
             && (CompareMem (DevicePath1, DevicePath2, DevicePathNodeLength (DevicePath1)) == 0);
 }
 
@@ -916,20 +1371,152 @@ LoadNvramPlist(
 }
 
 
+//
+// misc\NvramPlist.bin remembers the volume of the newest nvram.plist and its modification time. Clover
+// runs between two OS starts, so at most one nvram.plist was written since the last search : if it is
+// the remembered one, it's still the newest and the other volumes aren't opened.
+//
+#define NVRAM_PLIST_HINT_FILE       L"misc\\NvramPlist.bin"
+#define NVRAM_PLIST_HINT_SIGNATURE  SIGNATURE_32('N', 'V', 'P', 'H')
+#define NVRAM_PLIST_HINT_VERSION    1
+
+typedef struct {
+  UINT32  Signature;
+  UINT32  Version;
+  UINT64  ModifTimeMs;
+  UINT32  PathLength;   // CHAR16 count of the volume DevicePathString that follows
+  UINT32  Reserved;
+} NVRAM_PLIST_HINT;
+
+static BOOLEAN NvramPlistHintLoad(XStringW& Path, UINT64 *ModifTimeMs)
+{
+  UINT8            *Data = NULL;
+  UINTN            DataSize = 0;
+  NVRAM_PLIST_HINT *Hint;
+
+  if (EFI_ERROR(egLoadFile(&self.getCloverDir(), NVRAM_PLIST_HINT_FILE, &Data, &DataSize))) {
+    return FALSE;
+  }
+  Hint = (NVRAM_PLIST_HINT *)Data;
+  if (DataSize < sizeof(NVRAM_PLIST_HINT) || Hint->Signature != NVRAM_PLIST_HINT_SIGNATURE ||
+      Hint->Version != NVRAM_PLIST_HINT_VERSION || Hint->PathLength == 0 ||
+      (DataSize - sizeof(NVRAM_PLIST_HINT)) / sizeof(CHAR16) < Hint->PathLength) {
+    FreePool(Data);
+    return FALSE;
+  }
+  Path.takeValueFrom((const CHAR16 *)(Data + sizeof(NVRAM_PLIST_HINT)), Hint->PathLength);
+  *ModifTimeMs = Hint->ModifTimeMs;
+  FreePool(Data);
+  return TRUE;
+}
+
+static void NvramPlistHintSave(const XStringW& Path, UINT64 ModifTimeMs)
+{
+  XBuffer<UINT8>   Data;
+  NVRAM_PLIST_HINT Hint;
+
+  ZeroMem(&Hint, sizeof(Hint));
+  Hint.Signature = NVRAM_PLIST_HINT_SIGNATURE;
+  Hint.Version = NVRAM_PLIST_HINT_VERSION;
+  Hint.ModifTimeMs = ModifTimeMs;
+  Hint.PathLength = (UINT32)(Path.sizeInBytes() / sizeof(CHAR16));
+  Data.ncat(&Hint, sizeof(Hint));
+  Data.ncat(Path.wc_str(), Path.sizeInBytes());
+  egSaveFile(&self.getCloverDir(), NVRAM_PLIST_HINT_FILE, Data.data(), Data.size());
+}
+
+/** Modification time of the nvram.plist of Volume. FALSE if there is none. */
+static BOOLEAN NvramPlistTime(REFIT_VOLUME *Volume, UINT64 *ModifTimeMs)
+{
+  EFI_STATUS    Status;
+  EFI_FILE      *FileHandle = NULL;
+  EFI_FILE_INFO *FileInfo;
+
+  Status = Volume->RootDir->Open (Volume->RootDir, &FileHandle, L"nvram.plist", EFI_FILE_MODE_READ, 0);
+  if (EFI_ERROR(Status)) {
+    return FALSE;
+  }
+  FileInfo = EfiLibFileInfo(FileHandle);
+  FileHandle->Close(FileHandle);
+  if (FileInfo == NULL) {
+    return FALSE;
+  }
+  *ModifTimeMs = GetEfiTimeInMs (&(FileInfo->ModificationTime));
+  FreePool(FileInfo);
+  return TRUE;
+}
+
+/** Searches all volumes for the most recent nvram.plist. NULL if there is none. */
+static REFIT_VOLUME *FindLatestNvramPlist(UINT64 *LatestModifTimeMs)
+{
+  REFIT_VOLUME    *Volume;
+  UINT64          LastModifTimeMs;
+  UINT64          ModifTimeMs;
+  REFIT_VOLUME    *VolumeWithLatestNvramPlist = NULL;
+  XStringW        HintPath;
+  UINT64          HintTimeMs = 0;
+  BOOLEAN         HintLoaded = FALSE;
+
+  LastModifTimeMs = 0;
+
+  if (GlobalConfig.FastBoot) {
+    // the first one found
+    for (UINTN Index = 0; Index < Volumes.size(); ++Index) {
+      Volume = &Volumes[Index];
+      if (Volume->RootDir && NvramPlistTime(Volume, &ModifTimeMs)) {
+        VolumeWithLatestNvramPlist = Volume;
+        LastModifTimeMs = ModifTimeMs;
+        break;
+      }
+    }
+  } else {
+    HintLoaded = NvramPlistHintLoad(HintPath, &HintTimeMs);
+    if (HintLoaded) {
+      for (UINTN Index = 0; Index < Volumes.size(); ++Index) {
+        Volume = &Volumes[Index];
+        if (Volume->RootDir && Volume->DevicePathString == HintPath) {
+          if (NvramPlistTime(Volume, &ModifTimeMs) && ModifTimeMs > HintTimeMs) {
+            DBG("nvram.plist rewritten on the last volume\n");
+            VolumeWithLatestNvramPlist = Volume;
+            LastModifTimeMs = ModifTimeMs;
+          }
+          break;
+        }
+      }
+    }
+
+    // search all volumes
+    if (VolumeWithLatestNvramPlist == NULL) {
+      for (UINTN Index = 0; Index < Volumes.size(); ++Index) {
+        Volume = &Volumes[Index];
+        if (!Volume->RootDir || !NvramPlistTime(Volume, &ModifTimeMs)) {
+          continue;
+        }
+        // check if newer
+        if (LastModifTimeMs < ModifTimeMs) {
+          VolumeWithLatestNvramPlist = Volume;
+          LastModifTimeMs = ModifTimeMs;
+        }
+      }
+    }
+    if (VolumeWithLatestNvramPlist != NULL &&
+        (!HintLoaded || HintTimeMs != LastModifTimeMs || HintPath != VolumeWithLatestNvramPlist->DevicePathString)) {
+      NvramPlistHintSave(VolumeWithLatestNvramPlist->DevicePathString, LastModifTimeMs);
+    }
+  }
+
+  *LatestModifTimeMs = LastModifTimeMs;
+  return VolumeWithLatestNvramPlist;
+}
+
 /** Searches all volumes for the most recent nvram.plist and loads it into gNvramDict. */
 EFI_STATUS
 LoadLatestNvramPlist()
 {
   EFI_STATUS      Status;
-//  UINTN           Index;
-  REFIT_VOLUME    *Volume;
-//  EFI_GUID        *Guid;
-  EFI_FILE* FileHandle = NULL;
-  EFI_FILE_INFO   *FileInfo = NULL;
+  REFIT_VOLUME    *VolumeWithLatestNvramPlist;
   UINT64          LastModifTimeMs;
-  UINT64          ModifTimeMs;
-  REFIT_VOLUME    *VolumeWithLatestNvramPlist = NULL;
-  
+
 //there are debug messages not needed for users
   DBG("Searching volumes for latest nvram.plist ...");
   
@@ -942,68 +1529,7 @@ LoadLatestNvramPlist()
   }
   DBG("\n");
   
-  //
-  // find latest nvram.plist
-  //
-  
-  LastModifTimeMs = 0;
-
-  // search all volumes
-  for (UINTN Index = 0; Index < Volumes.size(); ++Index) {
-    Volume = &Volumes[Index];
-    
-    if (!Volume->RootDir) {
-      continue;
-    }
-    
-/*    Guid = FindGPTPartitionGuidInDevicePath (Volume->DevicePath);
-    
-    DBG(" %2d. Volume '%ls', GUID = %s", Index, Volume->VolName, strguid(Guid));
-    if (Guid == NULL) {
-      // not a GUID partition
-      DBG(" - not GPT");
-    } */
-//    DBG("Volume[%d]\n", Index);
-    // check if nvram.plist exists
-    Status = Volume->RootDir->Open (Volume->RootDir, &FileHandle, L"nvram.plist", EFI_FILE_MODE_READ, 0);
-    if (EFI_ERROR(Status)) {
-//      DBG(" - no nvram.plist - skipping!\n");
-      continue;
-    }
-//    DBG(" Status=%s\n", efiStrError(Status));
-    if (GlobalConfig.FastBoot) {
-      VolumeWithLatestNvramPlist = Volume;
-      break;
-    }
-    
-    // get nvram.plist modification date
-    FileInfo = EfiLibFileInfo(FileHandle);
-//    DBG("got FileInfo=0x%X\n", FileInfo);
-    if (FileInfo == NULL) {
-//      DBG(" - no nvram.plist file info - skipping!\n");
-      FileHandle->Close(FileHandle);
-      continue;
-    }
-    
-//    DBG(" Modified = ");
-    ModifTimeMs = GetEfiTimeInMs (&(FileInfo->ModificationTime));
-/*    DBG("%d-%d-%d %d:%d:%d (%ld ms)\n",
-        FileInfo->ModificationTime.Year, FileInfo->ModificationTime.Month, FileInfo->ModificationTime.Day,
-        FileInfo->ModificationTime.Hour, FileInfo->ModificationTime.Minute, FileInfo->ModificationTime.Second,
-        ModifTimeMs); */
-    FreePool(FileInfo);
-    FileHandle->Close(FileHandle);
-    
-    // check if newer
-    if (LastModifTimeMs < ModifTimeMs) {
-//      DBG(" - newer - will use this one\n");
-      VolumeWithLatestNvramPlist = Volume;
-      LastModifTimeMs = ModifTimeMs;
-    }
-//    else {
-//      DBG(" - older - skipping!\n");
-//    }
-  }
+  VolumeWithLatestNvramPlist = FindLatestNvramPlist(&LastModifTimeMs);
   
   Status = EFI_NOT_FOUND;
   
@@ -1022,8 +1548,138 @@ LoadLatestNvramPlist()
 }
 
 
+//
+// misc\NvramStore.bin : the variables PutNvramPlistToRtVars() took from an nvram.plist, as binary records.
+// nvram.plist is written by the OS, so it stays the exchange format, but as long as the newest one is the one
+// the snapshot was made from, the variables are set from the snapshot and the XML isn't read nor parsed.
+//
+#define NVRAM_STORE_SNAPSHOT_FILE               L"misc\\NvramStore.bin"
+#define NVRAM_STORE_SNAPSHOT_SIGNATURE          SIGNATURE_32('N', 'V', 'S', 'S')
+#define NVRAM_STORE_SNAPSHOT_VERSION            1
+#define NVRAM_STORE_SNAPSHOT_HIBERNATION_FIXUP  BIT0   // the plist had Boot0082 or BootNext
+
+typedef struct {
+  UINT32  Signature;
+  UINT32  Version;
+  UINT64  ModifTimeMs;  // of the nvram.plist the records come from
+  UINT32  PathLength;   // CHAR16 count of its volume DevicePathString, right after the header
+  UINT32  Count;        // records after the path
+  UINT32  Flags;
+  UINT32  Crc32;        // of the path and the records
+} NVRAM_STORE_SNAPSHOT;
+
+typedef struct {
+  EFI_GUID  VendorGuid;
+  UINT32    NameSize;   // bytes, terminating 0 included
+  UINT32    DataSize;
+  // CHAR16 Name[], then UINT8 Data[], padded to 4 bytes
+} NVRAM_STORE_RECORD;
+
+#define NVRAM_STORE_RECORD_SIZE(NameSize, DataSize)  ALIGN_VALUE(sizeof(NVRAM_STORE_RECORD) + (NameSize) + (DataSize), 4)
+
+static void NvramSnapshotAdd(XBuffer<UINT8>& Records, const XStringW& Name, const EFI_GUID *VendorGuid, const void *Data, UINTN DataSize)
+{
+  NVRAM_STORE_RECORD Record;
+  UINT32             Pad = 0;
+  UINTN              RecordSize;
+
+  Record.VendorGuid = *VendorGuid;
+  Record.NameSize = (UINT32)Name.sizeInBytesIncludingTerminator();
+  Record.DataSize = (UINT32)DataSize;
+  RecordSize = NVRAM_STORE_RECORD_SIZE(Record.NameSize, Record.DataSize);
+  Records.ncat(&Record, sizeof(Record));
+  Records.ncat(Name.wc_str(), Record.NameSize);
+  Records.ncat(Data, DataSize);
+  Records.ncat(&Pad, RecordSize - sizeof(Record) - Record.NameSize - DataSize);
+}
+
+static void NvramSnapshotSave(const XStringW& Path, UINT64 ModifTimeMs, UINT32 Count, UINT32 Flags, const XBuffer<UINT8>& Records)
+{
+  XBuffer<UINT8>       Data;
+  NVRAM_STORE_SNAPSHOT Snapshot;
+
+  ZeroMem(&Snapshot, sizeof(Snapshot));
+  Snapshot.Signature = NVRAM_STORE_SNAPSHOT_SIGNATURE;
+  Snapshot.Version = NVRAM_STORE_SNAPSHOT_VERSION;
+  Snapshot.ModifTimeMs = ModifTimeMs;
+  Snapshot.PathLength = (UINT32)(Path.sizeInBytes() / sizeof(CHAR16));
+  Snapshot.Count = Count;
+  Snapshot.Flags = Flags;
+  Data.ncat(&Snapshot, sizeof(Snapshot));
+  Data.ncat(Path.wc_str(), Path.sizeInBytes());
+  Data.ncat(Records.data(), Records.size());
+  ((NVRAM_STORE_SNAPSHOT *)Data.data())->Crc32 = GetCrc32(Data.data() + sizeof(Snapshot), Data.size() - sizeof(Snapshot));
+  egSaveFile(&self.getCloverDir(), NVRAM_STORE_SNAPSHOT_FILE, Data.data(), Data.size());
+}
+
+/** Sets the variables of the snapshot made from the nvram.plist of Path at ModifTimeMs. FALSE if there is no such snapshot. */
+static BOOLEAN NvramSnapshotApply(const XStringW& Path, UINT64 ModifTimeMs)
+{
+  UINT8                *Data = NULL;
+  UINTN                DataSize = 0;
+  NVRAM_STORE_SNAPSHOT *Snapshot;
+  NVRAM_STORE_RECORD   *Record;
+  UINTN                Offset;
+  UINTN                RecordSize;
+  UINT32               Index;
+
+  if (EFI_ERROR(egLoadFile(&self.getCloverDir(), NVRAM_STORE_SNAPSHOT_FILE, &Data, &DataSize))) {
+    return FALSE;
+  }
+  Snapshot = (NVRAM_STORE_SNAPSHOT *)Data;
+  if (DataSize < sizeof(NVRAM_STORE_SNAPSHOT) || Snapshot->Signature != NVRAM_STORE_SNAPSHOT_SIGNATURE ||
+      Snapshot->Version != NVRAM_STORE_SNAPSHOT_VERSION || Snapshot->ModifTimeMs != ModifTimeMs ||
+      (DataSize - sizeof(NVRAM_STORE_SNAPSHOT)) / sizeof(CHAR16) < Snapshot->PathLength ||
+      Snapshot->PathLength != Path.sizeInBytes() / sizeof(CHAR16) ||
+      CompareMem(Data + sizeof(NVRAM_STORE_SNAPSHOT), Path.wc_str(), Path.sizeInBytes()) != 0 ||
+      GetCrc32(Data + sizeof(NVRAM_STORE_SNAPSHOT), DataSize - sizeof(NVRAM_STORE_SNAPSHOT)) != Snapshot->Crc32) {
+    FreePool(Data);
+    return FALSE;
+  }
+
+  // the records are checked as a whole before the first one is set
+  Offset = sizeof(NVRAM_STORE_SNAPSHOT) + Snapshot->PathLength * sizeof(CHAR16);
+  for (Index = 0; Index < Snapshot->Count; Index++) {
+    if (DataSize - Offset < sizeof(NVRAM_STORE_RECORD)) {
+      break;
+    }
+    Record = (NVRAM_STORE_RECORD *)(Data + Offset);
+    RecordSize = NVRAM_STORE_RECORD_SIZE((UINTN)Record->NameSize, (UINTN)Record->DataSize);
+    if (Record->NameSize < sizeof(CHAR16) || (Record->NameSize & 1) != 0 || Record->DataSize == 0 ||
+        RecordSize > DataSize - Offset ||
+        *(CHAR16 *)((UINT8 *)(Record + 1) + Record->NameSize - sizeof(CHAR16)) != 0) {
+      break;
+    }
+    Offset += RecordSize;
+  }
+  if (Index != Snapshot->Count || Offset != DataSize) {
+    FreePool(Data);
+    return FALSE;
+  }
+
+  DBG("Setting %u variables of nvram.plist from %ls\n", Snapshot->Count, NVRAM_STORE_SNAPSHOT_FILE);
+  if ((Snapshot->Flags & NVRAM_STORE_SNAPSHOT_HIBERNATION_FIXUP) != 0) {
+    GlobalConfig.HibernationFixup = TRUE;
+  }
+  NvramBeginBatch();
+  Offset = sizeof(NVRAM_STORE_SNAPSHOT) + Snapshot->PathLength * sizeof(CHAR16);
+  for (Index = 0; Index < Snapshot->Count; Index++) {
+    Record = (NVRAM_STORE_RECORD *)(Data + Offset);
+    SetNvramVariable((CHAR16 *)(Record + 1),
+                     &Record->VendorGuid,
+                     EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS,
+                     Record->DataSize,
+                     (UINT8 *)(Record + 1) + Record->NameSize);
+    Offset += NVRAM_STORE_RECORD_SIZE((UINTN)Record->NameSize, (UINTN)Record->DataSize);
+  }
+  NvramFlush();
+  FreePool(Data);
+  return TRUE;
+}
+
 /** Puts all vars from nvram.plist to RT vars. Should be used in CloverEFI only
  *  or if some UEFI boot uses EmuRuntimeDxe driver.
+ *  The variables come from misc\NvramStore.bin while the newest nvram.plist is the one it was made from.
  */
 void
 PutNvramPlistToRtVars ()
@@ -1031,13 +1687,28 @@ PutNvramPlistToRtVars ()
 //  EFI_STATUS Status;
   size_t            Size;
   const void       *Value;
+  REFIT_VOLUME     *PlistVolume = NULL;
+  UINT64            PlistTimeMs = 0;
+  XBuffer<UINT8>    Records;
+  UINT32            RecordCount = 0;
+  UINT32            SnapshotFlags = 0;
   
   if (gNvramDict == NULL) {
-    /*Status = */LoadLatestNvramPlist();
-    if (gNvramDict == NULL) {
+    PlistVolume = FindLatestNvramPlist(&PlistTimeMs);
+    if (PlistVolume == NULL) {
       DBG("PutNvramPlistToRtVars: nvram.plist not found\n");
       return;
     }
+    if (NvramSnapshotApply(PlistVolume->DevicePathString, PlistTimeMs)) {
+      return;
+    }
+    DBG("Loading nvram.plist from Vol '%ls' -", PlistVolume->VolName.wc_str());
+    /*Status = */LoadNvramPlist(PlistVolume->RootDir, L"nvram.plist");
+    DBG("\n");
+    if (gNvramDict == NULL) {
+      DBG("PutNvramPlistToRtVars: nvram.plist not loaded\n");
+      return;
+    }
   }
   if ( !gNvramDict->isDict() ) {
     DBG("PutNvramPlistToRtVars: MALFORMED PLIST nvram.plist. Root must be a dict\n");
@@ -1045,6 +1716,7 @@ PutNvramPlistToRtVars ()
   }
   DbgHeader("PutNvramPlistToRtVars");
 //  DBG("PutNvramPlistToRtVars ...\n");
+  NvramBeginBatch();
   // iterate over dict elements
   size_t count = gNvramDict->dictKeyCount(); // ok
   for (size_t tagIdx = 0 ; tagIdx < count ; tagIdx++ )
@@ -1091,6 +1763,7 @@ PutNvramPlistToRtVars ()
       VendorGuid = &gEfiGlobalVariableGuid;
       // it may happen only in this case
       GlobalConfig.HibernationFixup = TRUE;
+      SnapshotFlags |= NVRAM_STORE_SNAPSHOT_HIBERNATION_FIXUP;
     }
 
 //    AsciiStrToUnicodeStrS(Tag.stringValue(), KeyBuf, 128);
@@ -1148,6 +1821,13 @@ PutNvramPlistToRtVars ()
                       Size,
                       Value
                       );
+    NvramSnapshotAdd(Records, KeyBuf, VendorGuid, Value, Size);
+    RecordCount++;
+  }
+  NvramFlush();
+
+  if (PlistVolume != NULL) {
+    NvramSnapshotSave(PlistVolume->DevicePathString, PlistTimeMs, RecordCount, SnapshotFlags, Records);
   }
 }
 
@@ -1169,6 +1849,7 @@ FindStartupDiskVolume (
   BOOLEAN      IsPartitionVolume;
   XStringW     LoaderPath;
   XStringW     EfiBootVolumeStr;
+  UINT32       EfiBootVolumeHash;
   
   
 //  DBG("FindStartupDiskVolume ...\n");
@@ -1191,6 +1872,7 @@ FindStartupDiskVolume (
   // Check if gEfiBootVolume is disk or partition volume
   //
   EfiBootVolumeStr  = FileDevicePathToXStringW(gEfiBootVolume);
+  EfiBootVolumeHash = BootVolumeDevicePathHash (gEfiBootVolume); // the volumes hold theirs, only the matching ones get the node walk
   IsPartitionVolume = NULL != Clover_FindDevicePathNodeWithType (gEfiBootVolume, MEDIA_DEVICE_PATH, 0);
   DBG("  - Volume: %ls = %ls\n", IsPartitionVolume ? L"partition" : L"disk", EfiBootVolumeStr.wc_str());
 
@@ -1205,7 +1887,7 @@ FindStartupDiskVolume (
         LOADER_ENTRY& LoaderEntry = *MainMenu->Entries[Index].getLOADER_ENTRY();
         REFIT_VOLUME* Volume = LoaderEntry.Volume;
         LoaderPath = LoaderEntry.LoaderPath;
-        if (Volume != NULL && BootVolumeDevicePathEqual(gEfiBootVolume, Volume->DevicePath)) {
+        if (Volume != NULL && Volume->DevicePathHash == EfiBootVolumeHash && BootVolumeDevicePathEqual(gEfiBootVolume, Volume->DevicePath)) {
           DBG("  checking '%ls'\n", DevicePathToXStringW(Volume->DevicePath).wc_str());
           DBG("   '%ls'\n", LoaderPath.wc_str());
           // case insensitive cmp
@@ -1257,7 +1939,7 @@ FindStartupDiskVolume (
       } else if (MainMenu->Entries[Index].getLOADER_ENTRY()) {
         Volume = MainMenu->Entries[Index].getLOADER_ENTRY()->Volume;
       }
-      if (Volume != NULL && BootVolumeDevicePathEqual (gEfiBootVolume, Volume->DevicePath)) {
+      if (Volume != NULL && Volume->DevicePathHash == EfiBootVolumeHash && BootVolumeDevicePathEqual (gEfiBootVolume, Volume->DevicePath)) {
 		  DBG("    - found entry %lld. '%ls', Volume '%ls'\n", Index, MainMenu->Entries[Index].Title.s(), Volume->VolName.wc_str());
         return Index;
       }
@@ -1293,7 +1975,7 @@ FindStartupDiskVolume (
   DBG("   - searching for that disk\n");
   for (Index = 0; Index < (INTN)Volumes.size(); ++Index) {
     REFIT_VOLUME* Volume = &Volumes[Index];
-    if (BootVolumeDevicePathEqual (gEfiBootVolume, Volume->DevicePath)) {
+    if (Volume->DevicePathHash == EfiBootVolumeHash && BootVolumeDevicePathEqual (gEfiBootVolume, Volume->DevicePath)) {
       // that's the one
       DiskVolume = Volume;
 		DBG("    - found disk as volume %lld. '%ls'\n", Index, Volume->VolName.wc_str());
@@ -25,6 +25,12 @@ FindStartupDiskVolume (
   REFIT_MENU_SCREEN *MainMenu
   );
 
+// Same hash for the dev paths the startup disk search takes as equal (REFIT_VOLUME::DevicePathHash)
+UINT32
+BootVolumeDevicePathHash (
+  const EFI_DEVICE_PATH_PROTOCOL *DevicePath
+  );
+
 void
 *GetNvramVariable(
     IN      CONST CHAR16   *VariableName,
@@ -32,6 +38,27 @@ void
     OUT  UINT32            *Attributes    OPTIONAL,
     OUT  UINTN             *DataSize      OPTIONAL
   );
+// gRT->GetVariable()/SetVariable() with the Apple boot and vendor GUIDs served from a snapshot read once.
+// Rebuilt if the variable services were replaced (EmuVariable).
+EFI_STATUS
+NvramGetVariable (
+  IN      CONST CHAR16   *VariableName,
+  IN      EFI_GUID       *VendorGuid,
+  OUT     UINT32         *Attributes    OPTIONAL,
+  IN OUT  UINTN          *DataSize,
+  OUT     void           *Data          OPTIONAL
+  );
+EFI_STATUS
+NvramSetVariable (
+  IN  CONST CHAR16   *VariableName,
+  IN  EFI_GUID       *VendorGuid,
+  IN  UINT32         Attributes,
+  IN  UINTN          DataSize,
+  IN  CONST void     *Data
+  );
+// Between these, the Apple GUID writes are kept in memory and written once
+void NvramBeginBatch(void);
+EFI_STATUS NvramFlush(void);
 XString8 GetNvramVariableAsXString8(
     IN      CONST CHAR16   *VariableName,
     IN      EFI_GUID       *VendorGuid,
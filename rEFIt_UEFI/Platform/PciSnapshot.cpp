@@ -0,0 +1,188 @@
+/*
+ * PciSnapshot.cpp
+ *
+ * The PCI functions read once per boot.
+ */
+
+#include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+#include "PciSnapshot.h"
+
+#ifndef DEBUG_ALL
+#define DEBUG_PCI_SNAPSHOT 1
+#else
+#define DEBUG_PCI_SNAPSHOT DEBUG_ALL
+#endif
+
+#if DEBUG_PCI_SNAPSHOT == 0
+#define DBG(...)
+#else
+#define DBG(...) DebugLog(DEBUG_PCI_SNAPSHOT, __VA_ARGS__)
+#endif
+
+static PCI_SNAPSHOT_DEVICE *Devices = NULL;
+static UINTN                DeviceCount = 0;
+static BOOLEAN              Stale = TRUE;
+static EFI_EVENT            PciIoEvent = NULL;
+static void                *PciIoRegistration = NULL;
+
+static VOID EFIAPI PciIoInstalled(IN EFI_EVENT Event, IN VOID *Context)
+{
+  Stale = TRUE;
+}
+
+static void ReadCapabilities(PCI_SNAPSHOT_DEVICE *Dev)
+{
+  EFI_STATUS Status;
+  UINT8      Offset;
+  UINT16     IdNext;
+  UINTN      Loops = 0;
+
+  Dev->CapCount = 0;
+  if ((Dev->Pci.Hdr.Status & EFI_PCI_STATUS_CAPABILITY) == 0) {
+    return;
+  }
+  Offset = Dev->Pci.Device.CapabilityPtr & 0xFC;
+  // 48 entries at most fit in 0x40-0xFF, more means a loop in the list
+  while (Offset >= 0x40 && Loops++ < 48 && Dev->CapCount < PCI_SNAPSHOT_MAX_CAPS) {
+    Status = Dev->PciIo->Pci.Read(Dev->PciIo, EfiPciIoWidthUint16, Offset, 1, &IdNext);
+    if (EFI_ERROR(Status) || (IdNext & 0xFF) == 0xFF) {
+      break;
+    }
+    Dev->CapId[Dev->CapCount] = (UINT8)(IdNext & 0xFF);
+    Dev->CapOffset[Dev->CapCount] = Offset;
+    Dev->CapCount++;
+    Offset = (UINT8)(IdNext >> 8) & 0xFC;
+  }
+}
+
+// The DUET bus driver publishes what it read during enumeration
+static BOOLEAN CopyDeviceInfo(PCI_SNAPSHOT_DEVICE *Dev, EFI_HANDLE Handle)
+{
+  EFI_STATUS                Status;
+  PCI_DEVICE_INFO_PROTOCOL *Info = NULL;
+  UINTN                     Index;
+
+  Status = gBS->HandleProtocol(Handle, &gPciDeviceInfoProtocolGuid, (void **)&Info);
+  if (EFI_ERROR(Status) || Info->Revision < PCI_DEVICE_INFO_PROTOCOL_REVISION) {
+    return FALSE;
+  }
+  Dev->Segment  = Info->Segment;
+  Dev->Bus      = Info->Bus;
+  Dev->Device   = Info->Device;
+  Dev->Function = Info->Function;
+  CopyMem(&Dev->Pci, &Info->Pci, sizeof(Dev->Pci));
+  Dev->CapCount = (UINT8)MIN(Info->CapCount, PCI_SNAPSHOT_MAX_CAPS);
+  for (Index = 0; Index < Dev->CapCount; Index++) {
+    Dev->CapId[Index] = Info->CapId[Index];
+    Dev->CapOffset[Index] = Info->CapOffset[Index];
+  }
+  return TRUE;
+}
+
+static void BuildSnapshot(void)
+{
+  EFI_STATUS  Status;
+  UINTN       HandleCount = 0;
+  EFI_HANDLE *HandleBuffer = NULL;
+  UINTN       Index;
+  UINTN       Published = 0;
+
+  if (PciIoEvent == NULL) {
+    // registered before the walk so a handle installed meanwhile isn't missed
+    Status = gBS->CreateEvent(EVT_NOTIFY_SIGNAL, TPL_CALLBACK, PciIoInstalled, NULL, &PciIoEvent);
+    if (!EFI_ERROR(Status)) {
+      Status = gBS->RegisterProtocolNotify(&gEfiPciIoProtocolGuid, PciIoEvent, &PciIoRegistration);
+      if (EFI_ERROR(Status)) {
+        gBS->CloseEvent(PciIoEvent);
+        PciIoEvent = NULL;
+      }
+    }
+  }
+
+  if (Devices != NULL) {
+    FreePool(Devices);
+    Devices = NULL;
+  }
+  DeviceCount = 0;
+  // without the notify, every call rebuilds : slow but right
+  Stale = (PciIoEvent == NULL);
+
+  Status = gBS->LocateHandleBuffer(ByProtocol, &gEfiPciIoProtocolGuid, NULL, &HandleCount, &HandleBuffer);
+  if (EFI_ERROR(Status)) {
+    return;
+  }
+  Devices = (PCI_SNAPSHOT_DEVICE*)AllocateZeroPool(HandleCount * sizeof(PCI_SNAPSHOT_DEVICE));
+  if (Devices == NULL) {
+    FreePool(HandleBuffer);
+    Stale = TRUE;
+    return;
+  }
+
+  for (Index = 0; Index < HandleCount; Index++) {
+    PCI_SNAPSHOT_DEVICE *Dev = &Devices[DeviceCount];
+    Status = gBS->HandleProtocol(HandleBuffer[Index], &gEfiPciIoProtocolGuid, (void **)&Dev->PciIo);
+    if (EFI_ERROR(Status)) {
+      continue;
+    }
+    if (CopyDeviceInfo(Dev, HandleBuffer[Index])) {
+      Published++;
+    } else {
+      Status = Dev->PciIo->Pci.Read(Dev->PciIo, EfiPciIoWidthUint32, 0, sizeof(Dev->Pci) / sizeof(UINT32), &Dev->Pci);
+      if (EFI_ERROR(Status)) {
+        continue;
+      }
+      Dev->PciIo->GetLocation(Dev->PciIo, &Dev->Segment, &Dev->Bus, &Dev->Device, &Dev->Function);
+      ReadCapabilities(Dev);
+    }
+    Dev->Handle = HandleBuffer[Index];
+    Dev->DevicePath = DevicePathFromHandle(HandleBuffer[Index]);
+    DeviceCount++;
+  }
+  FreePool(HandleBuffer);
+  DBG("PCI snapshot: %llu functions, %llu from the bus driver\n", DeviceCount, Published);
+}
+
+UINTN PciSnapshotCount(void)
+{
+  if (Stale) {
+    BuildSnapshot();
+  }
+  return DeviceCount;
+}
+
+const PCI_SNAPSHOT_DEVICE* PciSnapshotDevice(UINTN Index)
+{
+  if (Index >= DeviceCount) {
+    return NULL;
+  }
+  return &Devices[Index];
+}
+
+const PCI_SNAPSHOT_DEVICE* PciSnapshotFindHandle(EFI_HANDLE Handle)
+{
+  UINTN Index;
+
+  for (Index = 0; Index < DeviceCount; Index++) {
+    if (Devices[Index].Handle == Handle) {
+      return &Devices[Index];
+    }
+  }
+  return NULL;
+}
+
+UINT8 PciSnapshotFindCapability(const PCI_SNAPSHOT_DEVICE* Dev, UINT8 CapId)
+{
+  UINTN Index;
+
+  for (Index = 0; Index < Dev->CapCount; Index++) {
+    if (Dev->CapId[Index] == CapId) {
+      return Dev->CapOffset[Index];
+    }
+  }
+  return 0;
+}
+
+void PciSnapshotInvalidate(void)
+{
+  Stale = TRUE;
+}
@@ -0,0 +1,46 @@
+/*
+ * PciSnapshot.h
+ *
+ * One walk of the PciIo handles for the whole boot : location, config header,
+ * capabilities and device path of every PCI function, read once and queried by
+ * GetDevices(), SetDevices(), the injectors and the CPU code.
+ * The snapshot is built on the first PciSnapshotCount() and rebuilt by the next one
+ * after a new PciIo handle was installed (a connect can enumerate a bus behind a bridge).
+ * Under CloverEFI the bus driver's PCI_DEVICE_INFO_PROTOCOL is used instead of config reads.
+ */
+
+#ifndef __PCISNAPSHOT_H__
+#define __PCISNAPSHOT_H__
+
+#define PCI_SNAPSHOT_MAX_CAPS  16
+
+typedef struct {
+  EFI_HANDLE                Handle;
+  EFI_PCI_IO_PROTOCOL      *PciIo;
+  UINTN                     Segment;
+  UINTN                     Bus;
+  UINTN                     Device;
+  UINTN                     Function;
+  PCI_TYPE00                Pci;         // config space 0x00-0x3F as read at build time
+  EFI_DEVICE_PATH_PROTOCOL *DevicePath;  // NULL if the handle has none
+  UINT8                     CapCount;
+  UINT8                     CapId[PCI_SNAPSHOT_MAX_CAPS];
+  UINT8                     CapOffset[PCI_SNAPSHOT_MAX_CAPS];
+} PCI_SNAPSHOT_DEVICE;
+
+// Number of PCI functions, (re)builds the snapshot if needed.
+// Call it once before a loop : the pointers given by the functions below stay valid until the next call.
+UINTN PciSnapshotCount(void);
+
+const PCI_SNAPSHOT_DEVICE* PciSnapshotDevice(UINTN Index);
+
+// NULL if the handle isn't in the snapshot. Doesn't rebuild it.
+const PCI_SNAPSHOT_DEVICE* PciSnapshotFindHandle(EFI_HANDLE Handle);
+
+// Config space offset of the capability, 0 if the function doesn't have it.
+UINT8 PciSnapshotFindCapability(const PCI_SNAPSHOT_DEVICE* Dev, UINT8 CapId);
+
+// Force a rebuild at the next PciSnapshotCount().
+void PciSnapshotInvalidate(void);
+
+#endif
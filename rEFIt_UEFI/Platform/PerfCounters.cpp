@@ -0,0 +1,45 @@
+/*
+ * PerfCounters.cpp
+ *
+ * Counters of the hot paths, in the boot log and in NVRAM.
+ */
+
+#include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+#include "PerfCounters.h"
+#include "Nvram.h"
+#include "../refit/lib.h"
+
+extern "C" {
+#include <Library/CppMemLib.h>
+}
+
+PERF_COUNTERS gPerfCounters;
+
+void PerfCountersSave(void)
+{
+  CPP_MEM_STATS Stats;
+
+  CppMemGetStats(&Stats);
+  gPerfCounters.Version = PERF_COUNTERS_VERSION;
+  gPerfCounters.Size = sizeof(gPerfCounters);
+  gPerfCounters.PoolAllocs = Stats.LargeAllocs;
+  for (UINTN Class = 0; Class < CPP_MEM_CLASS_COUNT; Class++) {
+    gPerfCounters.PoolAllocs += Stats.Class[Class].Allocs;
+  }
+  gPerfCounters.PoolPeakBytes = (UINT64)Stats.Chunks * CPP_MEM_CHUNK_PAGES * EFI_PAGE_SIZE;
+
+  DbgHeader("PerfCounters");
+  MsgLog("files: %lld opened, %lld bytes read\n", gPerfCounters.FileOpens, gPerfCounters.FileBytesRead);
+  MsgLog("patches: %lld compares, %lld matches, %lld replaces\n",
+         gPerfCounters.CompareMemCalls, gPerfCounters.PatchMatches, gPerfCounters.PatchReplaces);
+  MsgLog("plist: %lld nodes\n", gPerfCounters.PlistNodes);
+  MsgLog("pool: %lld allocs, peak %lld bytes\n", gPerfCounters.PoolAllocs, gPerfCounters.PoolPeakBytes);
+  MsgLog("blt: %lld calls, %lld pixels\n", gPerfCounters.BltCalls, gPerfCounters.BltPixels);
+
+  EFI_STATUS Status = SetNvramVariable(PERF_COUNTERS_VARIABLE, &gEfiAppleBootGuid,
+                                       EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS,
+                                       sizeof(gPerfCounters), &gPerfCounters);
+  if (EFI_ERROR(Status)) {
+    MsgLog("Can't save %ls : %s\n", PERF_COUNTERS_VARIABLE, efiStrError(Status));
+  }
+}
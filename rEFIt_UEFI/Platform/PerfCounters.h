@@ -0,0 +1,57 @@
+/*
+ * PerfCounters.h
+ *
+ * Counters of the hot paths, saved at boot in the volatile variable Clover.PerfCounters
+ * (gEfiAppleBootGuid), so they can be read from the OS with
+ *   nvram 7C436110-AB2A-4BBB-A880-FE41995C9F82:Clover.PerfCounters
+ * even when the debug log is off. The blob is PERF_COUNTERS as is, little endian.
+ */
+
+#ifndef __PERFCOUNTERS_H__
+#define __PERFCOUNTERS_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <Uefi.h>
+
+#define PERF_COUNTERS_VERSION   1
+#define PERF_COUNTERS_VARIABLE  L"Clover.PerfCounters"
+
+// Only add fields at the end, and bump PERF_COUNTERS_VERSION if a meaning changes.
+typedef struct {
+  UINT32  Version;
+  UINT32  Size;             // sizeof(PERF_COUNTERS), a reader can skip the fields it doesn't know
+  UINT64  FileOpens;        // egLoadFile()
+  UINT64  FileBytesRead;
+  UINT64  CompareMemCalls;  // CompareMemMask() calls of the patch engines in MemoryOperation.c
+  UINT64  PatchMatches;     // occurrences found by the patch engines, skipped ones included
+  UINT64  PatchReplaces;
+  UINT64  PlistNodes;       // tags parsed, xml and binary
+  UINT64  PoolAllocs;       // operator new, small blocks and AllocatePool ones
+  UINT64  PoolPeakBytes;    // pages of the small blocks chunks, never given back, so it is their peak
+  UINT64  BltCalls;         // GOP or UGA Blt
+  UINT64  BltPixels;
+} PERF_COUNTERS;
+
+extern PERF_COUNTERS gPerfCounters;
+
+// Can be called from APs : the patch engines run there.
+static inline void PerfCountersAdd(UINT64 *Counter, UINT64 Value)
+{
+#if defined(__GNUC__)
+  __atomic_fetch_add(Counter, Value, __ATOMIC_RELAXED);
+#else
+  *Counter += Value;
+#endif
+}
+
+// Log the counters and save them in NVRAM. Called once, just before starting the OS.
+void PerfCountersSave(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -43,12 +43,19 @@ SelfOem selfOem;
 //}
 
 
-bool SelfOem::_checkOEMPath()
+bool SelfOem::_checkOEMPath(FILE_PROBE& probe)
 {
   EFI_STATUS Status;
 
 //  if ( !selfOem.oemDirExists() ) return false;
 
+  // Most candidates don't exist : the probe answers them from the listings of the dirs on the way, no Open per candidate.
+  if ( !probe.FileExists(SWPrintf("%ls\\%ls\\%s.plist", self.getCloverDirFullPath().wc_str(), m_OemPathRelToSelfDir.wc_str(), m_ConfName.c_str())) ) {
+    DBG("_checkOEMPath looked for config file at '%ls\\%ls\\%s.plist'. File doesn't exist.\n", self.getCloverDirFullPath().wc_str(), m_OemPathRelToSelfDir.wc_str(), m_ConfName.c_str());
+    m_OemDir = NULL;
+    return false;
+  }
+
 //  EFI_FILE* efiDir;
   Status = self.getCloverDir().Open(&self.getCloverDir(), &m_OemDir, m_OemPathRelToSelfDir.wc_str(), EFI_FILE_MODE_READ, 0);
   if ( Status == EFI_NOT_FOUND ) {
@@ -61,48 +68,42 @@ bool SelfOem::_checkOEMPath()
     m_OemDir = NULL;
     return false;
   }
-  BOOLEAN res2 = FileExists(m_OemDir, SWPrintf("%s.plist", m_ConfName.c_str()));
-  if ( !res2 ) {
-    DBG("_checkOEMPath looked for config file at '%ls\\%ls\\%s.plist'. File doesn't exist.\n", self.getCloverDirFullPath().wc_str(), m_OemPathRelToSelfDir.wc_str(), m_ConfName.c_str());
-    m_OemDir->Close(m_OemDir);
-    m_OemDir = NULL;
-    return false;
-  }
   DBG("_checkOEMPath: set OEMPath: '%ls\\%ls'\n", self.getCloverDirFullPath().wc_str(), m_OemPathRelToSelfDir.wc_str());
   return true;
 }
 
 bool SelfOem::_setOemPathRelToSelfDir(bool isFirmwareClover, const XString8& OEMBoard, const XString8& OEMProduct, INT32 frequency, UINTN nLanCards, UINT8 gLanMac[4][6])
 {
+  FILE_PROBE probe(&self.getSelfVolumeRootDir());
 
   if ( nLanCards > 0 ) {
     m_OemPathRelToSelfDir.SWPrintf("OEM\\%s--%02X-%02X-%02X-%02X-%02X-%02X", OEMProduct.c_str(), gLanMac[0][0], gLanMac[0][1], gLanMac[0][2], gLanMac[0][3], gLanMac[0][4], gLanMac[0][5]);
-    if ( _checkOEMPath() ) return true;
+    if ( _checkOEMPath(probe) ) return true;
   }
   if ( nLanCards > 1 ) {
     m_OemPathRelToSelfDir.SWPrintf("OEM\\%s--%02X-%02X-%02X-%02X-%02X-%02X", OEMProduct.c_str(), gLanMac[1][0], gLanMac[1][1], gLanMac[1][2], gLanMac[1][3], gLanMac[1][4], gLanMac[1][5]);
-    if ( _checkOEMPath() ) return true;
+    if ( _checkOEMPath(probe) ) return true;
   }
   if ( nLanCards > 2 ) {
     m_OemPathRelToSelfDir.SWPrintf("OEM\\%s--%02X-%02X-%02X-%02X-%02X-%02X", OEMProduct.c_str(), gLanMac[2][0], gLanMac[2][1], gLanMac[2][2], gLanMac[2][3], gLanMac[2][4], gLanMac[2][5]);
-    if ( _checkOEMPath() ) return true;
+    if ( _checkOEMPath(probe) ) return true;
   }
   if ( nLanCards > 3 ) {
     m_OemPathRelToSelfDir.SWPrintf("OEM\\%s--%02X-%02X-%02X-%02X-%02X-%02X", OEMProduct.c_str(), gLanMac[3][0], gLanMac[3][1], gLanMac[3][2], gLanMac[3][3], gLanMac[3][4], gLanMac[3][5]);
-    if ( _checkOEMPath() ) return true;
+    if ( _checkOEMPath(probe) ) return true;
   }
   if ( !isFirmwareClover ) {
     m_OemPathRelToSelfDir.SWPrintf("OEM\\%s\\UEFI", OEMBoard.c_str());
-    if ( _checkOEMPath() ) return true;
+    if ( _checkOEMPath(probe) ) return true;
   }
   m_OemPathRelToSelfDir.SWPrintf("OEM\\%s", OEMProduct.c_str());
-  if ( _checkOEMPath() ) return true;
+  if ( _checkOEMPath(probe) ) return true;
   m_OemPathRelToSelfDir.SWPrintf("OEM\\%s-%d", OEMProduct.c_str(), frequency);
-  if ( _checkOEMPath() ) return true;
+  if ( _checkOEMPath(probe) ) return true;
   m_OemPathRelToSelfDir.SWPrintf("OEM\\%s", OEMBoard.c_str());
-  if ( _checkOEMPath() ) return true;
+  if ( _checkOEMPath(probe) ) return true;
   m_OemPathRelToSelfDir.SWPrintf("OEM\\%s-%d", OEMBoard.c_str(), frequency);
-  if ( _checkOEMPath() ) return true;
+  if ( _checkOEMPath(probe) ) return true;
 
 //  m_OemPathRelToSelfDir.takeValueFrom(".");
 //  DBG("set OEMPath to \".\"\n");
@@ -11,6 +11,8 @@
 #include <Platform.h>
 #include "Self.h"
 
+class FILE_PROBE;
+
 class SelfOem
 {
 protected:
@@ -30,7 +32,7 @@ protected:
   XStringW     m_KextsFullPath = NullXStringW;
 
 //  EFI_STATUS _openDir(const XStringW& path, bool* b, EFI_FILE** efiDir);
-  bool _checkOEMPath();
+  bool _checkOEMPath(FILE_PROBE& probe);
   bool _setOemPathRelToSelfDir(bool isFirmwareClover, const XString8& OEMBoard, const XString8& OEMProduct, INT32 frequency, UINTN nLanCards, UINT8 gLanMac[4][6]);
   EFI_STATUS _initialize();
 
@@ -14,6 +14,7 @@
 #include "../refit/menu.h"
 #include "gma.h"
 #include "../libeg/VectorGraphics.h"
+#include "../libeg/ThemePack.h"
 #include "Nvram.h"
 #include "BootOptions.h"
 #include "StartupSound.h"
@@ -27,6 +28,7 @@
 #include "APFS.h"
 #include "hda.h"
 #include "FixBiosDsdt.h"
+#include "PciSnapshot.h"
 #include "../entry_scan/secureboot.h"
 #include "../include/Pci.h"
 #include "../include/Devices.h"
@@ -38,6 +40,7 @@
 #include "Net.h"
 #include "MacOsVersion.h"
 #include "../include/OsType.h"
+#include "BootTimeline.h"
 
 
 #ifndef DEBUG_ALL
@@ -49,7 +52,7 @@
 #if DEBUG_SET == 0
 #define DBG(...)
 #else
-#define DBG(...) DebugLog (DEBUG_SET, __VA_ARGS__)
+#define DBG(...) do { if ( DebugLogIsEnabled(DEBUG_SET) ) DebugLog (DEBUG_SET, __VA_ARGS__); } while (0)
 #endif
 
 //#define DUMP_KERNEL_KEXT_PATCHES 1
@@ -100,6 +103,7 @@ UINTN                           ConfigsNum;
 CHAR16                          *ConfigsList[20];
 UINTN                           DsdtsNum = 0;
 CHAR16                          *DsdtsList[20];
+UINT32                          gConfigCrc32                = 0; // CRC32 of the last config.plist loaded
 XObjArray<HDA_OUTPUTS>          AudioList;
 XObjArray<RT_VARIABLES>         BlockRtVariableArray;
 
@@ -187,20 +191,6 @@ static struct FIX_CONFIG { const CHAR8* oldName; const CHAR8* newName; UINT32 bi
   { NULL, "FixMutex", FIX_MUTEX }
 };
 
-UINT32
-GetCrc32 (
-          UINT8 *Buffer,
-          UINTN Size
-          )
-{
-  UINT32 x = 0;
-  UINT32 *Fake = (UINT32*)Buffer;
-  if (!Fake) return 0;
-  Size >>= 2;
-  while (Size--) x+= *Fake++;
-  return x;
-}
-
 ACPI_NAME_LIST *
 ParseACPIName(const XString8& String)
 {
@@ -547,6 +537,7 @@ LoadUserSettings (
   }
 
   if (!EFI_ERROR(Status) && ConfigPtr != NULL) {
+    gConfigCrc32 = GetCrc32(ConfigPtr, Size);
     Status = ParseXML((const CHAR8*)ConfigPtr, Dict, Size);
     if (EFI_ERROR(Status)) {
       //  Dict = NULL;
@@ -1011,6 +1002,11 @@ FillinKextPatches (IN OUT KERNEL_AND_KEXT_PATCHES *Patches,
     Patches->EightApple = IsPropertyNotNullAndTrue(Prop);
   }
 
+  Prop = DictPointer->propertyForKey("ParallelKextPatching");
+  if (Prop != NULL || gBootChanged) {
+    Patches->KPParallel = IsPropertyNotNullAndTrue(Prop);
+  }
+
   //
   // Dell SMBIOS Patch
   //
@@ -1096,6 +1092,7 @@ FillinKextPatches (IN OUT KERNEL_AND_KEXT_PATCHES *Patches,
     Patches->KextPatches.setEmpty();
     
     if (Count > 0) {
+      Patches->KextPatches.reserve((size_t)Count);
       const TagDict* Prop2 = NULL;
       const TagStruct* Dict = NULL;
 
@@ -1119,8 +1116,7 @@ FillinKextPatches (IN OUT KERNEL_AND_KEXT_PATCHES *Patches,
           continue;
         }
 
-        KEXT_PATCH* newPatchPtr = new KEXT_PATCH();
-        KEXT_PATCH& newPatch = *newPatchPtr;
+        KEXT_PATCH newPatch;
         
         newPatch.Name = Dict->getString()->stringValue();
         newPatch.Label.takeValueFrom(newPatch.Name);
@@ -1223,6 +1219,7 @@ FillinKextPatches (IN OUT KERNEL_AND_KEXT_PATCHES *Patches,
         Dict = Prop2->propertyForKey("MatchOS");
         if ((Dict != NULL) && (Dict->isString())) {
           newPatch.MatchOS = Dict->getString()->stringValue();
+          newPatch.MatchOSPatterns.takeValueFrom(newPatch.MatchOS);
           DBG(" :: MatchOS: %s", newPatch.MatchOS.c_str());
         }
 
@@ -1246,8 +1243,9 @@ FillinKextPatches (IN OUT KERNEL_AND_KEXT_PATCHES *Patches,
         if (!newPatch.MenuItem.BValue) {
           DBG(" - patch disabled at config\n");
         }
-        Patches->KextPatches.AddReference(newPatchPtr, true);
+        Patches->KextPatches.emplace_back(static_cast<KEXT_PATCH&&>(newPatch));
       }
+      Patches->KextPatches.shrink_to_fit(); // some may be skipped
     }
 
     //gSettings.NrKexts = (INT32)i;
@@ -1266,6 +1264,7 @@ FillinKextPatches (IN OUT KERNEL_AND_KEXT_PATCHES *Patches,
     //delete old and create new
     Patches->KernelPatches.setEmpty();
     if (Count > 0) {
+      Patches->KernelPatches.reserve((size_t)Count);
       const TagDict* Prop2 = NULL;
       const TagStruct* prop3 = NULL;
       DBG("KernelToPatch: %lld requested\n", Count);
@@ -1277,8 +1276,7 @@ FillinKextPatches (IN OUT KERNEL_AND_KEXT_PATCHES *Patches,
 
         DBG(" - [%02lld]:", i);
 
-        KEXT_PATCH* newKernelPatchPtr = new KEXT_PATCH;
-        KEXT_PATCH& newKernelPatch = *newKernelPatchPtr;
+        KEXT_PATCH newKernelPatch;
 
         newKernelPatch.Label = "NoLabel"_XS8;
         prop3 = Prop2->propertyForKey("Comment");
@@ -1373,6 +1371,7 @@ FillinKextPatches (IN OUT KERNEL_AND_KEXT_PATCHES *Patches,
         prop3 = Prop2->propertyForKey("MatchOS");
         if ((prop3 != NULL) && (prop3->isString())) {
           newKernelPatch.MatchOS = prop3->getString()->stringValue();
+          newKernelPatch.MatchOSPatterns.takeValueFrom(newKernelPatch.MatchOS);
           DBG(" :: MatchOS: %s", newKernelPatch.MatchOS.c_str());
         }
 
@@ -1382,8 +1381,9 @@ FillinKextPatches (IN OUT KERNEL_AND_KEXT_PATCHES *Patches,
           DBG(" :: MatchBuild: %s", newKernelPatch.MatchBuild.c_str());
         }
         DBG(" :: data len: %zu\n", newKernelPatch.Data.size());
-        Patches->KernelPatches.AddReference(newKernelPatchPtr, true);
+        Patches->KernelPatches.emplace_back(static_cast<KEXT_PATCH&&>(newKernelPatch));
       }
+      Patches->KernelPatches.shrink_to_fit(); // some may be skipped
     }
   }
 
@@ -1397,6 +1397,7 @@ FillinKextPatches (IN OUT KERNEL_AND_KEXT_PATCHES *Patches,
     //delete old and create new
     Patches->BootPatches.setEmpty();
     if (Count > 0) {
+      Patches->BootPatches.reserve((size_t)Count);
       const TagDict* Prop2 = NULL;
       const TagStruct* prop3 = NULL;
 
@@ -1409,8 +1410,7 @@ FillinKextPatches (IN OUT KERNEL_AND_KEXT_PATCHES *Patches,
 
         DBG(" - [%02lld]:", i);
 
-        KEXT_PATCH* newBootPatchPtr = new KEXT_PATCH;
-        KEXT_PATCH& newBootPatch = *newBootPatchPtr;
+        KEXT_PATCH newBootPatch;
 
         newBootPatch.Label = "NoLabel"_XS8;
         prop3 = Prop2->propertyForKey("Comment");
@@ -1493,6 +1493,7 @@ FillinKextPatches (IN OUT KERNEL_AND_KEXT_PATCHES *Patches,
         prop3 = Prop2->propertyForKey("MatchOS");
         if ((prop3 != NULL) && (prop3->isString())) {
           newBootPatch.MatchOS = prop3->getString()->stringValue();
+          newBootPatch.MatchOSPatterns.takeValueFrom(newBootPatch.MatchOS);
           DBG(" :: MatchOS: %s", newBootPatch.MatchOS.c_str());
         }
 
@@ -1503,8 +1504,9 @@ FillinKextPatches (IN OUT KERNEL_AND_KEXT_PATCHES *Patches,
         }
 
         DBG(" :: data len: %zu\n", newBootPatch.Data.size());
-        Patches->BootPatches.AddReference(newBootPatchPtr, true);
+        Patches->BootPatches.emplace_back(static_cast<KEXT_PATCH&&>(newBootPatch));
       }
+      Patches->BootPatches.shrink_to_fit(); // some may be skipped
     }
   }
 
@@ -1513,59 +1515,81 @@ FillinKextPatches (IN OUT KERNEL_AND_KEXT_PATCHES *Patches,
 }
 
 
+// MatchOS and MatchBuild are lists separated by commas. The items are read in place into one
+// buffer, a Split() made a new array at each call, once per patch.
+static BOOLEAN NextMatchItem(const XString8& List, size_t *Pos, XString8& Item)
+{
+  const CHAR8 *s = List.c_str();
+  size_t      Length = List.length();
+  size_t      Start = *Pos;
+  size_t      End = Start;
+
+  if (Start > Length) {
+    return FALSE;
+  }
+  while (End < Length && s[End] != ',') {
+    End++;
+  }
+  *Pos = End + 1;
+  while (Start < End && (UINT8)s[Start] <= 32) {
+    Start++;
+  }
+  while (End > Start && (UINT8)s[End - 1] <= 32) {
+    End--;
+  }
+  Item.takeValueFrom(s + Start, End - Start);
+  return TRUE;
+}
+
 BOOLEAN
 IsPatchEnabledByBuildNumber(const XString8& MatchOSEntry, const XString8& Build)
 {
-  BOOLEAN ret = FALSE;
+  XString8 Item;
+  size_t   Pos = 0;
+  BOOLEAN  First = TRUE;
 
   if (MatchOSEntry.isEmpty() || Build.isEmpty()) {
     return TRUE; //undefined matched corresponds to old behavior
   }
 
-  XString8Array mos = Split<XString8Array>(MatchOSEntry, ","_XS8).trimEachString();
-  
-  if ( mos[0] == "All"_XS8) {
-    return TRUE;
-  }
-
-  for (size_t i = 0; i < mos.size(); ++i) {
-    // dot represent MatchOS
-    MacOsVersion mosv = mos[i];
-    if ( mos[i].contains(Build) ) { // MatchBuild
+  while (NextMatchItem(MatchOSEntry, &Pos, Item)) {
+    if (First && Item == "All"_XS8) {
+      return TRUE;
+    }
+    First = FALSE;
+    if ( Item.contains(Build) ) { // MatchBuild
       //DBG("\nthis patch will activated for OS %ls!\n", mos->array[i]);
-      ret =  TRUE;
-      break;
+      return TRUE;
     }
   }
-  return ret;
+  return FALSE;
 }
 
 
 BOOLEAN
 IsPatchEnabled(const XString8& MatchOSEntry, const MacOsVersion& CurrOS)
 {
-  BOOLEAN ret = FALSE;
+  XString8            Item;
+  MacOsVersionPattern Pattern;
+  size_t              Pos = 0;
+  BOOLEAN             First = TRUE;
 
   if (MatchOSEntry.isEmpty() || CurrOS.isEmpty()) {
     return TRUE; //undefined matched corresponds to old behavior
   }
 
-  XString8Array mos = Split<XString8Array>(MatchOSEntry, ","_XS8).trimEachString();
-  
-  if ( mos[0] == "All"_XS8) {
-    return TRUE;
-  }
-
-  for (size_t i = 0; i < mos.size(); ++i) {
+  while (NextMatchItem(MatchOSEntry, &Pos, Item)) {
+    if (First && Item == "All"_XS8) {
+      return TRUE;
+    }
+    First = FALSE;
     // dot represent MatchOS
-    MacOsVersion mosv = mos[i];
-    if ( CurrOS.match(mos[i]) ) {
+    if ( CurrOS.match(Pattern.takeValueFrom(Item)) ) {
       //DBG("\nthis patch will activated for OS %ls!\n", mos->array[i]);
-      ret =  TRUE;
-      break;
+      return TRUE;
     }
   }
-  return ret;
+  return FALSE;
 }
 
 
@@ -1716,7 +1740,9 @@ FillinCustomEntry (
 //    } else {
 //      Entry->Options.SPrintf("%s", Prop->getString()->stringValue());
 //    }
-	Entry->LoadOptions.import(Split<XString8Array>(Prop->getString()->stringValue(), " "));
+    XArray<XString8View> Args;
+    SplitViews(Prop->getString()->stringValue().c_str(), " ", Args);
+    Entry->LoadOptions.import(Args);
   } else {
     Prop = DictPointer->propertyForKey("Arguments");
     if (Prop != NULL && (Prop->isString())) {
@@ -2343,12 +2369,73 @@ GetEarlyUserSettings (
         }
       }
 
+      // KB of log kept in memory between writes to debug log
+      Prop = BootDict->propertyForKey("DebugBuffer");
+      if ( Prop ) {
+        GlobalConfig.DebugLogBuffer = (UINTN)GetPropertyAsInteger(Prop, 0) * 1024;
+      }
+
+      // KB allocated for debug log once, so every write only rewrites the sectors at its end
+      Prop = BootDict->propertyForKey("DebugPreallocate");
+      if ( Prop ) {
+        GlobalConfig.DebugLogPreallocate = (UINTN)GetPropertyAsInteger(Prop, 0) * 1024;
+      }
+
+      // messages below this DebugMode are not formatted at all : 1 drops what only goes to boot.log, 2 keeps only screen messages
+      Prop = BootDict->propertyForKey("DebugLevel");
+      if ( Prop ) {
+        GlobalConfig.DebugLogLevel = GetPropertyAsInteger(Prop, 0);
+        gDebugLogMinMode = GlobalConfig.DebugLogLevel;
+      }
+
       Prop = BootDict->propertyForKey("Fast");
       GlobalConfig.FastBoot       = IsPropertyNotNullAndTrue(Prop);
 
       Prop = BootDict->propertyForKey("NoEarlyProgress");
       GlobalConfig.NoEarlyProgress = IsPropertyNotNullAndTrue(Prop);
 
+      Prop = BootDict->propertyForKey("VolumeCache");
+      GlobalConfig.VolumeCache = IsPropertyNotNullAndTrue(Prop);
+
+      Prop = BootDict->propertyForKey("KextCache");
+      GlobalConfig.KextCache = IsPropertyNotNullAndTrue(Prop);
+
+      Prop = BootDict->propertyForKey("DsdtCache");
+      GlobalConfig.DsdtCache = IsPropertyNotNullAndTrue(Prop);
+
+      Prop = BootDict->propertyForKey("PmSsdtCache");
+      GlobalConfig.PmSsdtCache = IsPropertyNotNullAndTrue(Prop);
+
+      Prop = BootDict->propertyForKey("SpdCache");
+      GlobalConfig.SpdCache = IsPropertyNotNullAndTrue(Prop);
+
+      Prop = BootDict->propertyForKey("VBiosCache");
+      GlobalConfig.VBiosCache = IsPropertyNotNullAndTrue(Prop);
+
+      Prop = BootDict->propertyForKey("GopModeCache");
+      GlobalConfig.GopModeCache = IsPropertyNotNullAndTrue(Prop);
+
+      Prop = BootDict->propertyForKey("SleepImageCache");
+      GlobalConfig.SleepImageCache = IsPropertyNotNullAndTrue(Prop);
+
+      Prop = BootDict->propertyForKey("DeferConnect");
+      GlobalConfig.DeferConnect = IsPropertyNotNullAndTrue(Prop);
+
+      Prop = BootDict->propertyForKey("LazyConnect");
+      GlobalConfig.LazyConnect = IsPropertyNotNullAndTrue(Prop);
+
+      Prop = BootDict->propertyForKey("IncrementalRescan");
+      GlobalConfig.IncrementalRescan = IsPropertyNotNullAndTrue(Prop);
+
+      Prop = BootDict->propertyForKey("LazyEntryInfo");
+      GlobalConfig.LazyEntryInfo = IsPropertyNotNullAndTrue(Prop);
+
+      Prop = BootDict->propertyForKey("OSVersionCache");
+      GlobalConfig.OSVersionCache = IsPropertyNotNullAndTrue(Prop);
+
+      Prop = BootDict->propertyForKey("FatDelayedFlush");
+      GlobalConfig.FatDelayedFlush = IsPropertyNotNullAndTrue(Prop);
+
       if (SpecialBootMode) {
         GlobalConfig.FastBoot       = TRUE;
         DBG("Fast option enabled\n");
@@ -2627,6 +2714,10 @@ GetEarlyUserSettings (
       // CustomIcons
       Prop = GUIDict->propertyForKey("CustomIcons");
       GlobalConfig.CustomIcons = IsPropertyNotNullAndTrue(Prop);
+      Prop = GUIDict->propertyForKey("IconCache");
+      GlobalConfig.IconCache = IsPropertyNotNullAndTrue(Prop);
+      Prop = GUIDict->propertyForKey("ParallelRasterize");
+      GlobalConfig.ParallelRasterize = IsPropertyNotNullAndTrue(Prop);
       Prop = GUIDict->propertyForKey("TextOnly");
       GlobalConfig.TextOnly = IsPropertyNotNullAndTrue(Prop);
       Prop = GUIDict->propertyForKey("ShowOptimus");
@@ -2642,6 +2733,9 @@ GetEarlyUserSettings (
       Prop = GUIDict->propertyForKey("ProvideConsoleGop");
       gSettings.ProvideConsoleGop = !IsPropertyNotNullAndFalse(Prop); //default is true
 
+      Prop = GUIDict->propertyForKey("FramebufferWriteCombine");
+      GlobalConfig.FramebufferWriteCombine = IsPropertyNotNullAndTrue(Prop);
+
       Prop = GUIDict->propertyForKey("ConsoleMode");
       if (Prop != NULL) {
         if (Prop->isInt64()) {
@@ -3187,46 +3281,63 @@ GetListOfConfigs ()
   DirIterClose(&DirIter);
 }
 
-void
-GetListOfDsdts()
+/*
+ * .aml files of ACPI\patched, listed once for GetListOfDsdts() and GetListOfACPI()
+ */
+XStringWArray
+GetListOfPatchedAml()
 {
   REFIT_DIR_ITER    DirIter;
   EFI_FILE_INFO     *DirEntry;
+  XStringWArray     AmlNames;
+
+  DirIterOpen(&selfOem.getConfigDir(), L"ACPI\\patched", &DirIter);
+  while (DirIterNext(&DirIter, 2, L"*.aml", &DirEntry)) {
+    if (DirEntry->FileName[0] == L'.') {
+      continue;
+    }
+    AmlNames.Add(DirEntry->FileName);
+  }
+  DirIterClose(&DirIter);
+  return AmlNames;
+}
+
+void
+GetListOfDsdts(const XStringWArray& AmlNames)
+{
   INTN              NameLen;
 
   if (DsdtsNum > 0) {
     for (UINTN i = 0; i < DsdtsNum; i++) {
-      if (DsdtsList[DsdtsNum] != NULL) {
-        FreePool(DsdtsList[DsdtsNum]);
+      if (DsdtsList[i] != NULL) {
+        FreePool(DsdtsList[i]);
+        DsdtsList[i] = NULL;
       }
     }
   }   
   DsdtsNum = 0;
   OldChosenDsdt = 0xFFFF;
 
-  DirIterOpen(&selfOem.getConfigDir(), L"ACPI\\patched", &DirIter);
   DbgHeader("Found DSDT tables");
-  while (DirIterNext(&DirIter, 2, L"DSDT*.aml", &DirEntry)) {
-    if (DirEntry->FileName[0] == L'.') {
+  for (size_t idx = 0; idx < AmlNames.size() && DsdtsNum < ARRAY_SIZE(DsdtsList); idx++) {
+    const XStringW& FileName = AmlNames[idx];
+    if (!FileName.startWithIC(L"DSDT")) {
       continue;
     }
-      if ( gSettings.DsdtName.equalIC(DirEntry->FileName) ) {
+      if ( gSettings.DsdtName.equalIC(FileName) ) {
         OldChosenDsdt = DsdtsNum;
       }
-      NameLen = StrLen(DirEntry->FileName); //with ".aml"
-      DsdtsList[DsdtsNum] = (CHAR16*)AllocateCopyPool(NameLen * sizeof(CHAR16) + 2, DirEntry->FileName); // if changing, notice freepool above
+      NameLen = StrLen(FileName.wc_str()); //with ".aml"
+      DsdtsList[DsdtsNum] = (CHAR16*)AllocateCopyPool(NameLen * sizeof(CHAR16) + 2, FileName.wc_str()); // if changing, notice freepool above
       DsdtsList[DsdtsNum++][NameLen] = L'\0';
-      DBG("- %ls\n", DirEntry->FileName);
+      DBG("- %ls\n", FileName.wc_str());
     }
-  DirIterClose(&DirIter);
 }
 
 
 void
-GetListOfACPI()
+GetListOfACPI(const XStringWArray& AmlNames)
 {
-  REFIT_DIR_ITER    DirIter;
-  EFI_FILE_INFO     *DirEntry = NULL;
   ACPI_PATCHED_AML  *ACPIPatchedAMLTmp;
   INTN               Count = gSettings.DisabledAMLCount;
 //  XStringW           AcpiPath = SWPrintf("%ls\\ACPI\\patched", OEMPath.wc_str());
@@ -3241,20 +3352,17 @@ GetListOfACPI()
   }
   ACPIPatchedAML = NULL;
 //  DBG("free acpi list done\n");
-  DirIterOpen(&selfOem.getConfigDir(), L"ACPI\\patched", &DirIter);
 
-  while (DirIterNext(&DirIter, 2, L"*.aml", &DirEntry)) {
-//    DBG("next entry is %ls\n", DirEntry->FileName);
-    if (DirEntry->FileName[0] == L'.') {
+  for (size_t idx = 0; idx < AmlNames.size(); idx++) {
+    const XStringW& FileName = AmlNames[idx];
+//    DBG("next entry is %ls\n", FileName.wc_str());
+    if (StriStr(FileName.wc_str(), L"DSDT")) {
       continue;
     }
-    if (StriStr(DirEntry->FileName, L"DSDT")) {
-      continue;
-    }
-//    DBG("Found name %ls\n", DirEntry->FileName);
+//    DBG("Found name %ls\n", FileName.wc_str());
       BOOLEAN ACPIDisabled = FALSE;
       ACPIPatchedAMLTmp = new ACPI_PATCHED_AML; // if changing, notice freepool above
-      ACPIPatchedAMLTmp->FileName = SWPrintf("%ls", DirEntry->FileName).forgetDataWithoutFreeing(); // if changing, notice freepool above
+      ACPIPatchedAMLTmp->FileName = SWPrintf("%ls", FileName.wc_str()).forgetDataWithoutFreeing(); // if changing, notice freepool above
 
       for (INTN i = 0; i < Count; i++) {
         if ((gSettings.DisabledAML[i] != NULL) &&
@@ -3268,8 +3376,6 @@ GetListOfACPI()
       ACPIPatchedAMLTmp->Next = ACPIPatchedAML;
       ACPIPatchedAML = ACPIPatchedAMLTmp;
     }
-
-  DirIterClose(&DirIter);
 }
 
 /*
@@ -3292,7 +3398,7 @@ XStringW GetBundleVersion(const XStringW& pathUnderSelf)
   }
   if(!EFI_ERROR(Status)) {
     //DBG("about to parse xml file %ls\n", InfoPlistPath.wc_str());
-    Status = ParseXML(InfoPlistPtr, &InfoPlistDict, Size);
+    Status = ParseXMLView(InfoPlistPtr, &InfoPlistDict, Size);
     if(!EFI_ERROR(Status) && (InfoPlistDict != nullptr)) {
       Prop = InfoPlistDict->propertyForKey("CFBundleVersion");
       if (Prop != NULL && Prop->isString() && Prop->getString()->stringValue().notEmpty()) {
@@ -3399,6 +3505,26 @@ void InitKextList()
 #define CONFIG_THEME_FILENAME L"theme.plist"
 #define CONFIG_THEME_SVG L"theme.svg"
 
+// TRUE if Dir holds a non empty file FileName. The file isn't read, a theme is only loaded once chosen.
+static BOOLEAN
+ThemeFileNotEmpty (EFI_FILE *Dir, CONST CHAR16 *FileName)
+{
+  EFI_FILE       *File;
+  EFI_FILE_INFO  *FileInfo;
+  BOOLEAN        NotEmpty;
+
+  if (EFI_ERROR(Dir->Open(Dir, &File, FileName, EFI_FILE_MODE_READ, 0))) {
+    return FALSE;
+  }
+  FileInfo = EfiLibFileInfo(File);
+  NotEmpty = FileInfo != NULL && (FileInfo->Attribute & EFI_FILE_DIRECTORY) == 0 && FileInfo->FileSize > 0;
+  if (FileInfo != NULL) {
+    FreePool(FileInfo);
+  }
+  File->Close(File);
+  return NotEmpty;
+}
+
 void
 GetListOfThemes ()
 {
@@ -3407,8 +3533,6 @@ GetListOfThemes ()
   EFI_FILE_INFO  *DirEntry;
   XStringW        ThemeTestPath;
   EFI_FILE       *ThemeTestDir   = NULL;
-  CHAR8          *ThemePtr       = NULL;
-  UINTN          Size = 0;
 
   DbgHeader("GetListOfThemes");
 
@@ -3427,28 +3551,21 @@ GetListOfThemes ()
 	  DBG("- [%02zu]: %ls", ThemeNameArray.size(), DirEntry->FileName);
     Status = self.getThemesDir().Open(&self.getThemesDir(), &ThemeTestDir, DirEntry->FileName, EFI_FILE_MODE_READ, 0);
     if (!EFI_ERROR(Status)) {
-      Status = egLoadFile(ThemeTestDir, CONFIG_THEME_FILENAME, (UINT8**)&ThemePtr, &Size);
-      if (EFI_ERROR(Status) || (ThemePtr == NULL) || (Size == 0)) {
-        Status = egLoadFile(ThemeTestDir, CONFIG_THEME_SVG, (UINT8**)&ThemePtr, &Size);
-        if (EFI_ERROR(Status)) {
-          Status = EFI_NOT_FOUND;
-          DBG(" - bad theme because %ls nor %ls can't be load", CONFIG_THEME_FILENAME, CONFIG_THEME_SVG);
-        }
+      if (!ThemeFileNotEmpty(ThemeTestDir, CONFIG_THEME_FILENAME) && !ThemeFileNotEmpty(ThemeTestDir, CONFIG_THEME_SVG)) {
+        Status = EFI_NOT_FOUND;
+        DBG(" - bad theme because %ls nor %ls can't be load", CONFIG_THEME_FILENAME, CONFIG_THEME_SVG);
       }
+      ThemeTestDir->Close(ThemeTestDir);
+      ThemeTestDir = NULL;
       if (!EFI_ERROR(Status)) {
         //we found a theme
-        if ((StriCmp(DirEntry->FileName, L"embedded") == 0) ||
-            (StriCmp(DirEntry->FileName, L"random") == 0)) {
-          ThemePtr = NULL;
-        } else {
+        if ((StriCmp(DirEntry->FileName, L"embedded") != 0) &&
+            (StriCmp(DirEntry->FileName, L"random") != 0)) {
           ThemeNameArray.Add(DirEntry->FileName);
         }
       }
     }
     DBG("\n");
-    if (ThemePtr) {
-      FreePool(ThemePtr);
-    }
   }
   DirIterClose(&DirIter);
 }
@@ -3795,7 +3912,10 @@ XTheme::GetThemeTagSettings(const TagDict* DictPointer)
       Prop = Dict3->propertyForKey("Once");
       NewFilm->RunOnce = IsPropertyNotNullAndTrue(Prop);
 
-      NewFilm->GetFrames(ThemeX); //used properties: ID, Path, NumFrames
+      Prop = Dict3->propertyForKey("Stream");
+      NewFilm->Streaming = IsPropertyNotNullAndTrue(Prop); //keep PNG files, decode each frame when shown
+
+      NewFilm->GetFrames(ThemeX); //used properties: ID, Path, NumFrames, Streaming
       ThemeX.Cinema.AddFilm(NewFilm);
  //     delete NewFilm; //looks like already deleted
     }
@@ -3849,11 +3969,13 @@ TagDict* XTheme::LoadTheme(const XStringW& TestTheme)
     m_ThemePath = SWPrintf("%ls", TestTheme.wc_str());
     Status = self.getThemesDir().Open(&self.getThemesDir(), &ThemeDir, m_ThemePath.wc_str(), EFI_FILE_MODE_READ, 0);
   }
+  // from here the theme files may come from theme.pack
+  ThemePackOpen(EFI_ERROR(Status) ? NULL : ThemeDir);
 
   if (!EFI_ERROR(Status)) {
     Status = egLoadFile(ThemeDir, CONFIG_THEME_SVG, (UINT8**)&ThemePtr, &Size);
     if (!EFI_ERROR(Status) && (ThemePtr != NULL) && (Size != 0)) {
-      Status = ParseSVGXTheme(ThemePtr);
+      Status = ParseSVGXTheme(ThemePtr, Size);
       if (EFI_ERROR(Status)) {
         ThemeDict = NULL;
       } else {
@@ -3867,7 +3989,7 @@ TagDict* XTheme::LoadTheme(const XStringW& TestTheme)
     } else {
       Status = egLoadFile(ThemeDir, CONFIG_THEME_FILENAME, (UINT8**)&ThemePtr, &Size);
       if (!EFI_ERROR(Status) && (ThemePtr != NULL) && (Size != 0)) {
-        Status = ParseXML(ThemePtr, &ThemeDict, 0);
+        Status = ParseXML(ThemePtr, &ThemeDict, Size);
         if (EFI_ERROR(Status)) {
           ThemeDict = NULL;
         }
@@ -3888,6 +4010,7 @@ TagDict* XTheme::LoadTheme(const XStringW& TestTheme)
 EFI_STATUS
 InitTheme(BOOLEAN UseThemeDefinedInNVRam)
 {
+  TimelineSpan Span("InitTheme");
   EFI_STATUS Status       = EFI_NOT_FOUND;
   UINTN      Size         = 0;
   UINTN      i;
@@ -5072,9 +5195,119 @@ static void getACPISettings(const TagDict *CfgDict)
   }
 }
 
+//
+// Device properties are indexed once the config is read, so each injector walks only its own ones:
+// AddProperties are chained per DEV_xxx type through their Next field, in config order,
+// arbitrary properties with a PciAddr are sorted by address.
+//
+#define DEV_PROPERTY_TYPES 16
+
+static DEV_PROPERTY  *AddPropertiesByType[DEV_PROPERTY_TYPES];
+static DEV_PROPERTY **ArbPropertiesByAddr = NULL;
+static UINTN          ArbPropertiesByAddrCount = 0;
+
+static INTN DevPropertyType(UINT32 Device)
+{
+  INTN Type;
+
+  for (Type = 0; Type < DEV_PROPERTY_TYPES; Type++) {
+    if (Device == bit(Type)) {
+      return Type;
+    }
+  }
+  return -1;
+}
+
+void IndexDevProperties(void)
+{
+  DEV_PROPERTY  *Last[DEV_PROPERTY_TYPES];
+  DEV_PROPERTY  *Prop;
+  UINTN         i;
+  UINTN         j;
+  INTN          Type;
+
+  ZeroMem(AddPropertiesByType, sizeof(AddPropertiesByType));
+  ZeroMem(Last, sizeof(Last));
+  if (gSettings.AddProperties != NULL && gSettings.NrAddProperties != 0xFFFE) {
+    for (i = 0; i < gSettings.NrAddProperties; i++) {
+      Prop = &gSettings.AddProperties[i];
+      Prop->Next = NULL;
+      Type = DevPropertyType(Prop->Device);
+      if (Type < 0) {
+        continue;
+      }
+      if (Last[Type] != NULL) {
+        Last[Type]->Next = Prop;
+      } else {
+        AddPropertiesByType[Type] = Prop;
+      }
+      Last[Type] = Prop;
+    }
+  }
+
+  if (ArbPropertiesByAddr != NULL) {
+    FreePool(ArbPropertiesByAddr);
+    ArbPropertiesByAddr = NULL;
+  }
+  ArbPropertiesByAddrCount = 0;
+  for (Prop = gSettings.ArbProperties; Prop != NULL; Prop = Prop->Next) {
+    if (Prop->Device != 0) {
+      ArbPropertiesByAddrCount++;
+    }
+  }
+  if (ArbPropertiesByAddrCount == 0) {
+    return;
+  }
+  ArbPropertiesByAddr = (__typeof__(ArbPropertiesByAddr))AllocatePool(ArbPropertiesByAddrCount * sizeof(*ArbPropertiesByAddr));
+  if (ArbPropertiesByAddr == NULL) {
+    ArbPropertiesByAddrCount = 0;
+    return;
+  }
+  // insertion sort is stable: the properties of one address stay in list order
+  i = 0;
+  for (Prop = gSettings.ArbProperties; Prop != NULL; Prop = Prop->Next) {
+    if (Prop->Device == 0) {
+      continue; // device path node, see SetDevices
+    }
+    for (j = i; j > 0 && ArbPropertiesByAddr[j - 1]->Device > Prop->Device; j--) {
+      ArbPropertiesByAddr[j] = ArbPropertiesByAddr[j - 1];
+    }
+    ArbPropertiesByAddr[j] = Prop;
+    i++;
+  }
+}
+
+DEV_PROPERTY *GetAddProperties(UINT32 Device)
+{
+  INTN Type = DevPropertyType(Device);
+
+  return (Type < 0) ? NULL : AddPropertiesByType[Type];
+}
+
+DEV_PROPERTY **GetArbProperties(UINT32 PciAddr, UINTN *Count)
+{
+  UINTN Lo = 0;
+  UINTN Hi = ArbPropertiesByAddrCount;
+  UINTN Mid;
+
+  while (Lo < Hi) {
+    Mid = Lo + (Hi - Lo) / 2;
+    if (ArbPropertiesByAddr[Mid]->Device < PciAddr) {
+      Lo = Mid + 1;
+    } else {
+      Hi = Mid;
+    }
+  }
+  for (Hi = Lo; Hi < ArbPropertiesByAddrCount && ArbPropertiesByAddr[Hi]->Device == PciAddr; Hi++) {
+  }
+  *Count = Hi - Lo;
+  return &ArbPropertiesByAddr[Lo];
+}
+
 EFI_STATUS
 GetUserSettings(const TagDict* CfgDict)
 {
+  TimelineSpan Span("GetUserSettings");
   EFI_STATUS Status = EFI_NOT_FOUND;
 
   if (CfgDict != NULL) {
@@ -5591,6 +5824,7 @@ GetUserSettings(const TagDict* CfgDict)
         }
       }
       //end AddProperties
+      IndexDevProperties();
 
       const TagDict* FakeIDDict = DevicesDict->dictPropertyForKey("FakeID");
       if (FakeIDDict != NULL) {
@@ -6283,7 +6517,309 @@ static CONST CHAR8 *SearchString(
   return NULL;
 }
 */
+
+// The string value of Key, found without building the tag tree. Enough for SystemVersion.plist,
+// where the keys are unique and the values are plain strings.
+static BOOLEAN GetPlistString(IN CONST CHAR8 *Buffer, IN UINTN Length, IN CONST CHAR8 *Key, OUT XString8& Value)
+{
+  XString8    KeyTag = S8Printf("<key>%s</key>", Key);
+  CONST CHAR8 *End = Buffer + Length;
+  CONST CHAR8 *s;
+  CONST CHAR8 *v;
+
+  for (s = Buffer; (UINTN)(End - s) >= KeyTag.length(); s++) {
+    if (*s != '<' || CompareMem(s, KeyTag.c_str(), KeyTag.length()) != 0) {
+      continue;
+    }
+    s += KeyTag.length();
+    while (s < End && (*s == ' ' || *s == '\t' || *s == '\r' || *s == '\n')) {
+      s++;
+    }
+    if ((UINTN)(End - s) < 8 || CompareMem(s, "<string>", 8) != 0) {
+      return FALSE;
+    }
+    s += 8;
+    for (v = s; v < End && *v != '<'; v++) {}
+    if (v == End) {
+      return FALSE;
+    }
+    Value.strncpy(s, (size_t)(v - s));
+    return TRUE;
+  }
+  return FALSE;
+}
+
+// ProductVersion and ProductBuildVersion of a SystemVersion.plist or ServerVersion.plist
+BOOLEAN ReadSystemVersion(IN REFIT_VOLUME *Volume, IN CONST XStringW& File, IN OUT XString8& OSVersion, IN OUT XString8& BuildVersion)
+{
+  UINT8     *Buffer = NULL;
+  UINTN     Length = 0;
+  XString8  Value;
+
+  if (EFI_ERROR(egLoadFile(Volume->RootDir, File.wc_str(), &Buffer, &Length)) || Buffer == NULL) {
+    return FALSE;
+  }
+  if (GetPlistString((CHAR8 *)Buffer, Length, "ProductVersion", Value) && Value.notEmpty()) {
+    OSVersion = Value;
+  }
+  if (GetPlistString((CHAR8 *)Buffer, Length, "ProductBuildVersion", Value) && Value.notEmpty()) {
+    BuildVersion = Value;
+  }
+  FreePool(Buffer);
+  return TRUE;
+}
+
+//
+// With Boot/OSVersionCache, the version of a macOS or recovery entry is kept in misc\OSVersionCache.bin
+// with the plist it was read from. The key is the volume device path and the APFS target UUID. The entry
+// is used while the plist has the same size and modification time, so a hit costs one open instead of
+// the probes and the read. Installers are not cached, their files change while they run.
+//
+#define OS_VERSION_CACHE_FILE       L"misc\\OSVersionCache.bin"
+#define OS_VERSION_CACHE_SIGNATURE  SIGNATURE_32('O', 'S', 'V', 'C')
+#define OS_VERSION_CACHE_VERSION    1
+#define OS_VERSION_CACHE_MAX        32
+#define OS_VERSION_CACHE_MAX_STRING 1024
+
+#pragma pack(push, 1)
+typedef struct {
+  UINT32  Signature;
+  UINT32  Version;
+  UINT32  Count;
+  UINT32  Crc32;          // of the records following the header
+} OS_VERSION_CACHE_HEADER;
+
+typedef struct {
+  UINT64    FileSize;
+  EFI_TIME  ModificationTime;
+  UINT16    PathLength;   // CHAR16 counts of the device path, the target UUID and the plist path,
+  UINT16    UuidLength;   // then CHAR8 counts of the version and the build, no terminators
+  UINT16    FileLength;
+  UINT16    VersionLength;
+  UINT16    BuildLength;
+} OS_VERSION_CACHE_RECORD;
+#pragma pack(pop)
+
+class OS_VERSION_CACHE_ENTRY
+{
+public:
+  XStringW  DevicePathString;
+  XStringW  TargetUUID;
+  XStringW  File;
+  UINT64    FileSize;
+  EFI_TIME  ModificationTime;
+  XString8  OSVersion;
+  XString8  BuildVersion;
+
+  OS_VERSION_CACHE_ENTRY() : DevicePathString(), TargetUUID(), File(), FileSize(0), ModificationTime(), OSVersion(), BuildVersion() {}
+  OS_VERSION_CACHE_ENTRY(const OS_VERSION_CACHE_ENTRY& other) = delete; // Can be defined if needed
+  const OS_VERSION_CACHE_ENTRY& operator = ( const OS_VERSION_CACHE_ENTRY & ) = delete; // Can be defined if needed
+};
+
+static XObjArray<OS_VERSION_CACHE_ENTRY> OSVersionCache;
+static BOOLEAN                           OSVersionCacheLoaded = FALSE;
+static BOOLEAN                           OSVersionCacheDirty = FALSE;
+
+static UINTN OSVersionCacheString(OUT XStringW& String, IN CONST UINT8 *Data, IN UINTN Length)
+{
+  if (Length > 0) {
+    String.strncpy((CONST CHAR16 *)Data, Length);
+  }
+  return Length * sizeof(CHAR16);
+}
+
+static UINTN OSVersionCacheString(OUT XString8& String, IN CONST UINT8 *Data, IN UINTN Length)
+{
+  if (Length > 0) {
+    String.strncpy((CONST CHAR8 *)Data, Length);
+  }
+  return Length;
+}
+
+static void OSVersionCacheLoad(void)
+{
+  EFI_STATUS              Status;
+  UINT8                   *Data = NULL;
+  UINTN                   DataSize = 0;
+  UINTN                   Offset;
+  UINT32                  Index;
+  OS_VERSION_CACHE_HEADER *Header;
+  OS_VERSION_CACHE_RECORD *Record;
+
+  if (OSVersionCacheLoaded) {
+    return;
+  }
+  OSVersionCacheLoaded = TRUE;
+  OSVersionCache.setEmpty();
+
+  Status = egLoadFile(&self.getCloverDir(), OS_VERSION_CACHE_FILE, &Data, &DataSize);
+  if (EFI_ERROR(Status)) {
+    DBG("OS version cache: %s\n", efiStrError(Status));
+    return;
+  }
+  Header = (OS_VERSION_CACHE_HEADER *)Data;
+  if (DataSize < sizeof(OS_VERSION_CACHE_HEADER) || Header->Signature != OS_VERSION_CACHE_SIGNATURE ||
+      Header->Version != OS_VERSION_CACHE_VERSION ||
+      Header->Crc32 != GetCrc32(Data + sizeof(OS_VERSION_CACHE_HEADER), DataSize - sizeof(OS_VERSION_CACHE_HEADER))) {
+    DBG("OS version cache: bad file\n");
+    FreePool(Data);
+    return;
+  }
+
+  Offset = sizeof(OS_VERSION_CACHE_HEADER);
+  for (Index = 0; Index < Header->Count; Index++) {
+    if (DataSize - Offset < sizeof(OS_VERSION_CACHE_RECORD)) {
+      break;
+    }
+    Record = (OS_VERSION_CACHE_RECORD *)(Data + Offset);
+    Offset += sizeof(OS_VERSION_CACHE_RECORD);
+    if (Record->PathLength > OS_VERSION_CACHE_MAX_STRING || Record->UuidLength > OS_VERSION_CACHE_MAX_STRING ||
+        Record->FileLength > OS_VERSION_CACHE_MAX_STRING || Record->VersionLength > OS_VERSION_CACHE_MAX_STRING ||
+        Record->BuildLength > OS_VERSION_CACHE_MAX_STRING ||
+        DataSize - Offset < ((UINTN)Record->PathLength + Record->UuidLength + Record->FileLength) * sizeof(CHAR16) +
+                            Record->VersionLength + Record->BuildLength) {
+      break;
+    }
+    OS_VERSION_CACHE_ENTRY* Entry = new OS_VERSION_CACHE_ENTRY;
+    Entry->FileSize = Record->FileSize;
+    Entry->ModificationTime = Record->ModificationTime;
+    Offset += OSVersionCacheString(Entry->DevicePathString, Data + Offset, Record->PathLength);
+    Offset += OSVersionCacheString(Entry->TargetUUID, Data + Offset, Record->UuidLength);
+    Offset += OSVersionCacheString(Entry->File, Data + Offset, Record->FileLength);
+    Offset += OSVersionCacheString(Entry->OSVersion, Data + Offset, Record->VersionLength);
+    Offset += OSVersionCacheString(Entry->BuildVersion, Data + Offset, Record->BuildLength);
+    OSVersionCache.AddReference(Entry, true);
+  }
+  FreePool(Data);
+  DBG("OS version cache: %zu entries\n", OSVersionCache.size());
+}
+
+void OSVersionCacheSave(void)
+{
+  EFI_STATUS              Status;
+  XBuffer<UINT8>          Data;
+  OS_VERSION_CACHE_HEADER Header;
+  OS_VERSION_CACHE_RECORD Record;
+  size_t                  Index;
+
+  if (!OSVersionCacheDirty) {
+    return;
+  }
+
+  ZeroMem(&Header, sizeof(Header));
+  Header.Signature = OS_VERSION_CACHE_SIGNATURE;
+  Header.Version = OS_VERSION_CACHE_VERSION;
+  Header.Count = (UINT32)OSVersionCache.size();
+  Data.ncat(&Header, sizeof(Header));
+  for (Index = 0; Index < OSVersionCache.size(); Index++) {
+    const OS_VERSION_CACHE_ENTRY& Entry = OSVersionCache[Index];
+    ZeroMem(&Record, sizeof(Record));
+    Record.FileSize = Entry.FileSize;
+    Record.ModificationTime = Entry.ModificationTime;
+    Record.PathLength = (UINT16)MIN(Entry.DevicePathString.length(), OS_VERSION_CACHE_MAX_STRING);
+    Record.UuidLength = (UINT16)MIN(Entry.TargetUUID.length(), OS_VERSION_CACHE_MAX_STRING);
+    Record.FileLength = (UINT16)MIN(Entry.File.length(), OS_VERSION_CACHE_MAX_STRING);
+    Record.VersionLength = (UINT16)MIN(Entry.OSVersion.length(), OS_VERSION_CACHE_MAX_STRING);
+    Record.BuildLength = (UINT16)MIN(Entry.BuildVersion.length(), OS_VERSION_CACHE_MAX_STRING);
+    Data.ncat(&Record, sizeof(Record));
+    Data.ncat(Entry.DevicePathString.wc_str(), Record.PathLength * sizeof(CHAR16));
+    Data.ncat(Entry.TargetUUID.wc_str(), Record.UuidLength * sizeof(CHAR16));
+    Data.ncat(Entry.File.wc_str(), Record.FileLength * sizeof(CHAR16));
+    Data.ncat(Entry.OSVersion.c_str(), Record.VersionLength);
+    Data.ncat(Entry.BuildVersion.c_str(), Record.BuildLength);
+  }
+  ((OS_VERSION_CACHE_HEADER *)Data.data())->Crc32 = GetCrc32(Data.data() + sizeof(Header), Data.size() - sizeof(Header));
+
+  Status = egSaveFile(&self.getCloverDir(), OS_VERSION_CACHE_FILE, Data.data(), Data.size());
+  DBG("OS version cache: saved %zu entries: %s\n", OSVersionCache.size(), efiStrError(Status));
+  if (!EFI_ERROR(Status)) {
+    OSVersionCacheDirty = FALSE;
+  }
+}
+
+static OS_VERSION_CACHE_ENTRY* OSVersionCacheFind(IN LOADER_ENTRY *Entry)
+{
+  for (size_t Index = 0; Index < OSVersionCache.size(); Index++) {
+    OS_VERSION_CACHE_ENTRY& Cached = OSVersionCache[Index];
+    if (Cached.DevicePathString == Entry->Volume->DevicePathString && Cached.TargetUUID == Entry->APFSTargetUUID) {
+      return &Cached;
+    }
+  }
+  return NULL;
+}
+
+// size and modification time of a file, read from its info without reading it
+static BOOLEAN OSVersionFileStamp(IN REFIT_VOLUME *Volume, IN CONST XStringW& File, OUT UINT64 *FileSize, OUT EFI_TIME *ModificationTime)
+{
+  EFI_STATUS    Status;
+  EFI_FILE      *FileHandle = NULL;
+  EFI_FILE_INFO *Info;
+
+  Status = Volume->RootDir->Open(Volume->RootDir, &FileHandle, File.wc_str(), EFI_FILE_MODE_READ, 0);
+  if (EFI_ERROR(Status)) {
+    return FALSE;
+  }
+  Info = EfiLibFileInfo(FileHandle);
+  FileHandle->Close(FileHandle);
+  if (Info == NULL) {
+    return FALSE;
+  }
+  *FileSize = Info->FileSize;
+  *ModificationTime = Info->ModificationTime;
+  FreePool(Info);
+  return TRUE;
+}
+
+static MacOsVersion ReadOSVersion(IN LOADER_ENTRY *Entry, OUT XStringW& VersionFile);
+
 MacOsVersion GetOSVersion(IN LOADER_ENTRY *Entry)
+{
+  OS_VERSION_CACHE_ENTRY  *Cached;
+  XStringW                VersionFile;
+  UINT64                  FileSize = 0;
+  EFI_TIME                ModificationTime;
+  XString8                OSVersion;
+
+  if (!Entry || !Entry->Volume) {
+    return NullXString8;
+  }
+  if (!GlobalConfig.OSVersionCache || OSTYPE_IS_OSX_INSTALLER(Entry->LoaderType) ||
+      (!OSTYPE_IS_OSX(Entry->LoaderType) && !OSTYPE_IS_OSX_RECOVERY(Entry->LoaderType))) {
+    return ReadOSVersion(Entry, VersionFile);
+  }
+
+  OSVersionCacheLoad();
+  Cached = OSVersionCacheFind(Entry);
+  ZeroMem(&ModificationTime, sizeof(ModificationTime));
+  if (Cached != NULL && OSVersionFileStamp(Entry->Volume, Cached->File, &FileSize, &ModificationTime) &&
+      FileSize == Cached->FileSize && CompareMem(&ModificationTime, &Cached->ModificationTime, sizeof(EFI_TIME)) == 0) {
+    DBG("OS version cache: %ls %s (%s)\n", Cached->File.wc_str(), Cached->OSVersion.c_str(), Cached->BuildVersion.c_str());
+    Entry->BuildVersion = Cached->BuildVersion;
+    return Cached->OSVersion;
+  }
+
+  OSVersion = ReadOSVersion(Entry, VersionFile).asString();
+  if (VersionFile.notEmpty() && OSVersionFileStamp(Entry->Volume, VersionFile, &FileSize, &ModificationTime)) {
+    if (Cached == NULL) {
+      if (OSVersionCache.size() >= OS_VERSION_CACHE_MAX) {
+        OSVersionCache.RemoveAtIndex((size_t)0);
+      }
+      Cached = new OS_VERSION_CACHE_ENTRY;
+      Cached->DevicePathString = Entry->Volume->DevicePathString;
+      Cached->TargetUUID = Entry->APFSTargetUUID;
+      OSVersionCache.AddReference(Cached, true);
+    }
+    Cached->File = VersionFile;
+    Cached->FileSize = FileSize;
+    Cached->ModificationTime = ModificationTime;
+    Cached->OSVersion = OSVersion;
+    Cached->BuildVersion = Entry->BuildVersion;
+    OSVersionCacheDirty = TRUE;
+  }
+  return OSVersion;
+}
+
+static MacOsVersion ReadOSVersion(IN LOADER_ENTRY *Entry, OUT XStringW& VersionFile)
 {
   XString8   OSVersion;
   EFI_STATUS Status      = EFI_NOT_FOUND;
@@ -6293,10 +6829,6 @@ MacOsVersion GetOSVersion(IN LOADER_ENTRY *Entry)
   const TagDict*     DictPointer = NULL;
   const TagStruct*     Prop        = NULL;
 
-  if (!Entry || !Entry->Volume) {
-    return NullXString8;
-  }
-
   if (OSTYPE_IS_OSX(Entry->LoaderType))
   {
   	XString8 uuidPrefix;
@@ -6311,29 +6843,8 @@ MacOsVersion GetOSVersion(IN LOADER_ENTRY *Entry)
     }
 
     if ( plist.notEmpty() ) { // found macOS System
-      Status = egLoadFile(Entry->Volume->RootDir, plist.wc_str(), (UINT8 **)&PlistBuffer, &PlistLen);
-      if (!EFI_ERROR(Status) && PlistBuffer != NULL && ParseXML(PlistBuffer, &Dict, 0) == EFI_SUCCESS) {
-        Prop = Dict->propertyForKey("ProductVersion");
-        if ( Prop != NULL ) {
-          if ( !Prop->isString() ) {
-            MsgLog("ATTENTION : property not string in ProductVersion\n");
-          }else{
-            if( Prop->getString()->stringValue().notEmpty() ) {
-              OSVersion = Prop->getString()->stringValue();
-            }
-          }
-        }
-        Prop = Dict->propertyForKey("ProductBuildVersion");
-        if ( Prop != NULL ) {
-          if ( !Prop->isString() ) {
-            MsgLog("ATTENTION : property not string in ProductBuildVersion\n");
-          }else{
-            if( Prop->getString()->stringValue().notEmpty() ) {
-              Entry->BuildVersion = Prop->getString()->stringValue();
-            }
-          }
-        }
-        Dict->FreeTag();
+      if ( ReadSystemVersion(Entry->Volume, plist, OSVersion, Entry->BuildVersion) ) {
+        VersionFile = plist;
       }
     }
   }
@@ -6365,30 +6876,7 @@ MacOsVersion GetOSVersion(IN LOADER_ENTRY *Entry)
       }
     }
     if (FileExists (Entry->Volume->RootDir, InstallerPlist)) {
-      Status = egLoadFile(Entry->Volume->RootDir, InstallerPlist.wc_str(), (UINT8 **)&PlistBuffer, &PlistLen);
-      if (!EFI_ERROR(Status) && PlistBuffer != NULL && ParseXML(PlistBuffer, &Dict, 0) == EFI_SUCCESS) {
-        Prop = Dict->propertyForKey("ProductVersion");
-        if ( Prop != NULL ) {
-          if ( !Prop->isString() ) {
-            MsgLog("ATTENTION : property not string in ProductVersion\n");
-          }else{
-            if( Prop->getString()->stringValue().notEmpty() ) {
-              OSVersion = Prop->getString()->stringValue();
-            }
-          }
-        }
-        Prop = Dict->propertyForKey("ProductBuildVersion");
-        if ( Prop != NULL ) {
-          if ( !Prop->isString() ) {
-            MsgLog("ATTENTION : property not string in ProductBuildVersion\n");
-          }else{
-            if( Prop->getString()->stringValue().notEmpty() ) {
-              Entry->BuildVersion = Prop->getString()->stringValue();
-            }
-          }
-        }
-        Dict->FreeTag();
-      }
+      ReadSystemVersion(Entry->Volume, InstallerPlist, OSVersion, Entry->BuildVersion);
     }
 
 //    if ( OSVersion.isEmpty() )
@@ -6576,30 +7064,10 @@ MacOsVersion GetOSVersion(IN LOADER_ENTRY *Entry)
 			}
 
       if ( plist.notEmpty() ) { // found macOS System
-
-        Status = egLoadFile(Entry->Volume->RootDir, plist.wc_str(), (UINT8 **)&PlistBuffer, &PlistLen);
-        if (!EFI_ERROR(Status) && PlistBuffer != NULL && ParseXML(PlistBuffer, &Dict, 0) == EFI_SUCCESS) {
-          Prop = Dict->propertyForKey("ProductVersion");
-          if ( Prop != NULL ) {
-            if ( !Prop->isString() ) {
-              MsgLog("ATTENTION : property not string in ProductVersion\n");
-            }else{
-              OSVersion = Prop->getString()->stringValue();
-            }
-          }
-          Prop = Dict->propertyForKey("ProductBuildVersion");
-          if ( Prop != NULL ) {
-            if ( !Prop->isString() ) {
-              MsgLog("ATTENTION : property not string in ProductBuildVersion\n");
-            }else{
-              Entry->BuildVersion = Prop->getString()->stringValue();
-            }
-          }
-        }
-        Dict->FreeTag();
-      }
-    }
-  }
+        ReadSystemVersion(Entry->Volume, plist, OSVersion, Entry->BuildVersion);
+      }
+    }
+  }
 
   if (OSTYPE_IS_OSX_RECOVERY (Entry->LoaderType)) {
 
@@ -6622,26 +7090,9 @@ MacOsVersion GetOSVersion(IN LOADER_ENTRY *Entry)
 
     // Detect exact version for OS X Recovery
     if ( plist.notEmpty() ) { // found macOS System
-      Status = egLoadFile(Entry->Volume->RootDir, plist.wc_str(), (UINT8 **)&PlistBuffer, &PlistLen);
-      if (!EFI_ERROR(Status) && PlistBuffer != NULL && ParseXML(PlistBuffer, &Dict, 0) == EFI_SUCCESS) {
-        Prop = Dict->propertyForKey("ProductVersion");
-        if ( Prop != NULL ) {
-          if ( !Prop->isString() ) {
-            MsgLog("ATTENTION : property not string in ProductVersion\n");
-          }else{
-            OSVersion = Prop->getString()->stringValue();
-          }
-        }
-        Prop = Dict->propertyForKey("ProductBuildVersion");
-        if ( Prop != NULL ) {
-          if ( !Prop->isString() ) {
-            MsgLog("ATTENTION : property not string in ProductBuildVersion\n");
-          }else{
-            Entry->BuildVersion = Prop->getString()->stringValue();
-          }
-        }
+      if ( ReadSystemVersion(Entry->Volume, plist, OSVersion, Entry->BuildVersion) ) {
+        VersionFile = plist;
       }
-      Dict->FreeTag();
     } else if (FileExists (Entry->Volume->RootDir, L"\\com.apple.recovery.boot\\boot.efi")) {
       // Special case - com.apple.recovery.boot/boot.efi exists but SystemVersion.plist doesn't --> 10.9 recovery
       OSVersion = "10.9"_XS8;
@@ -6819,6 +7270,7 @@ GetDevices ()
   EFI_PCI_IO_PROTOCOL *PciIo;
   PCI_TYPE00          Pci;
   UINTN               Index;
+  UINTN               PciCount;
   UINTN               Segment      = 0;
   UINTN               Bus          = 0;
   UINTN               Device       = 0;
@@ -6826,7 +7278,7 @@ GetDevices ()
   UINTN               i;
   UINT32              Bar0;
   //  UINT8               *Mmio        = NULL;
-  radeon_card_info_t  *info;
+  const radeon_card_info_t *info;
   SLOT_DEVICE         *SlotDevice;
 
   NGFX = 0;
@@ -6845,332 +7297,310 @@ GetDevices ()
     DBG("GOP found at: %ls\n", GopDevicePathStr.wc_str());
   }
 
-  // Scan PCI handles
-  Status = gBS->LocateHandleBuffer (
-                                    ByProtocol,
-                                    &gEfiPciIoProtocolGuid,
-                                    NULL,
-                                    &HandleCount,
-                                    &HandleArray
-                                    );
-
-  if (!EFI_ERROR(Status)) {
-    for (Index = 0; Index < HandleCount; ++Index) {
-      Status = gBS->HandleProtocol(HandleArray[Index], &gEfiPciIoProtocolGuid, (void **)&PciIo);
-      if (!EFI_ERROR(Status)) {
-        // Read PCI BUS
-        PciIo->GetLocation (PciIo, &Segment, &Bus, &Device, &Function);
-        Status = PciIo->Pci.Read (
-                                  PciIo,
-                                  EfiPciIoWidthUint32,
-                                  0,
-                                  sizeof (Pci) / sizeof (UINT32),
-                                  &Pci
-                                  );
+  // Scan PCI functions
+  PciCount = PciSnapshotCount();
+  for (Index = 0; Index < PciCount; ++Index) {
+    const PCI_SNAPSHOT_DEVICE *PciDev = PciSnapshotDevice(Index);
+    PciIo    = PciDev->PciIo;
+    Segment  = PciDev->Segment;
+    Bus      = PciDev->Bus;
+    Device   = PciDev->Device;
+    Function = PciDev->Function;
+    CopyMem(&Pci, &PciDev->Pci, sizeof(Pci));
 
 		  DBG("PCI (%02llX|%02llX:%02llX.%02llX) : %04hX %04hX class=%02hhX%02hhX%02hhX\n",
-             Segment,
-             Bus,
-             Device,
-             Function,
-             Pci.Hdr.VendorId,
-             Pci.Hdr.DeviceId,
-             Pci.Hdr.ClassCode[2],
-             Pci.Hdr.ClassCode[1],
-             Pci.Hdr.ClassCode[0]
-             );
-
-        // GFX
-        //if ((Pci.Hdr.ClassCode[2] == PCI_CLASS_DISPLAY) &&
-        //    (Pci.Hdr.ClassCode[1] == PCI_CLASS_DISPLAY_VGA) &&
-        //    (NGFX < 4)) {
-
-        if ((Pci.Hdr.ClassCode[2] == PCI_CLASS_DISPLAY) &&
-            ((Pci.Hdr.ClassCode[1] == (PCI_CLASS_DISPLAY_VGA)) ||
-             (Pci.Hdr.ClassCode[1] == (PCI_CLASS_DISPLAY_OTHER))) &&
-            (NGFX < 4)) {
-          CONST CHAR8 *CardFamily = "";
-          UINT16 UFamily;
-          GFX_PROPERTIES *gfx = &gGraphics[NGFX];
-
-          // GOP device path should contain the device path of the GPU to which the monitor is connected
-          DevicePathStr = DevicePathToXStringW(DevicePathFromHandle(HandleArray[Index]));
-          if (StrStr(GopDevicePathStr.wc_str(), DevicePathStr.wc_str())) {
-            DBG(" - GOP: Provided by device\n");
-            if (NGFX != 0) {
-               // we found GOP on a GPU scanned later, make space for this GPU at first position
-               for (i=NGFX; i>0; i--) {
-                 CopyMem(&gGraphics[i], &gGraphics[i-1], sizeof(GFX_PROPERTIES));
-               }
-               ZeroMem(&gGraphics[0], sizeof(GFX_PROPERTIES));
-               gfx = &gGraphics[0]; // GPU with active GOP will be added at the first position
-            }
-          }
-
-          gfx->DeviceID       = Pci.Hdr.DeviceId;
-          gfx->Segment        = Segment;
-          gfx->Bus            = Bus;
-          gfx->Device         = Device;
-          gfx->Function       = Function;
-          gfx->Handle         = HandleArray[Index];
-
-          switch (Pci.Hdr.VendorId) {
-            case 0x1002:
-              info        = NULL;
-              gfx->Vendor = Ati;
-
-              i = 0;
-              do {
-                info      = &radeon_cards[i];
-                if (info->device_id == Pci.Hdr.DeviceId) {
-                  break;
-                }
-              } while (radeon_cards[i++].device_id != 0);
+         Segment,
+         Bus,
+         Device,
+         Function,
+         Pci.Hdr.VendorId,
+         Pci.Hdr.DeviceId,
+         Pci.Hdr.ClassCode[2],
+         Pci.Hdr.ClassCode[1],
+         Pci.Hdr.ClassCode[0]
+         );
+
+    // GFX
+    //if ((Pci.Hdr.ClassCode[2] == PCI_CLASS_DISPLAY) &&
+    //    (Pci.Hdr.ClassCode[1] == PCI_CLASS_DISPLAY_VGA) &&
+    //    (NGFX < 4)) {
+
+    if ((Pci.Hdr.ClassCode[2] == PCI_CLASS_DISPLAY) &&
+        ((Pci.Hdr.ClassCode[1] == (PCI_CLASS_DISPLAY_VGA)) ||
+         (Pci.Hdr.ClassCode[1] == (PCI_CLASS_DISPLAY_OTHER))) &&
+        (NGFX < 4)) {
+      CONST CHAR8 *CardFamily = "";
+      UINT16 UFamily;
+      GFX_PROPERTIES *gfx = &gGraphics[NGFX];
+
+      // GOP device path should contain the device path of the GPU to which the monitor is connected
+      DevicePathStr = DevicePathToXStringW(PciDev->DevicePath);
+      if (StrStr(GopDevicePathStr.wc_str(), DevicePathStr.wc_str())) {
+        DBG(" - GOP: Provided by device\n");
+        if (NGFX != 0) {
+           // we found GOP on a GPU scanned later, make space for this GPU at first position
+           for (i=NGFX; i>0; i--) {
+             CopyMem(&gGraphics[i], &gGraphics[i-1], sizeof(GFX_PROPERTIES));
+           }
+           ZeroMem(&gGraphics[0], sizeof(GFX_PROPERTIES));
+           gfx = &gGraphics[0]; // GPU with active GOP will be added at the first position
+        }
+      }
+
+      gfx->DeviceID       = Pci.Hdr.DeviceId;
+      gfx->Segment        = Segment;
+      gfx->Bus            = Bus;
+      gfx->Device         = Device;
+      gfx->Function       = Function;
+      gfx->Handle         = PciDev->Handle;
+
+      switch (Pci.Hdr.VendorId) {
+        case 0x1002:
+          gfx->Vendor = Ati;
+          info        = get_radeon_card(Pci.Hdr.DeviceId);
 
 				  snprintf (gfx->Model,  64, "%s", info->model_name);
 				  snprintf (gfx->Config, 64, "%s", card_configs[info->cfg_name].name);
-              gfx->Ports                  = card_configs[info->cfg_name].ports;
-              DBG(" - GFX: Model=%s (ATI/AMD)\n", gfx->Model);
+          gfx->Ports                  = card_configs[info->cfg_name].ports;
+          DBG(" - GFX: Model=%s (ATI/AMD)\n", gfx->Model);
 
-              //get mmio
-              if (info->chip_family < CHIP_FAMILY_HAINAN) {
-                gfx->Mmio = (UINT8 *)(UINTN)(Pci.Device.Bar[2] & ~0x0f);
-              } else {
-                gfx->Mmio = (UINT8 *)(UINTN)(Pci.Device.Bar[5] & ~0x0f);
-              }
-              gfx->Connectors = *(UINT32*)(gfx->Mmio + RADEON_BIOS_0_SCRATCH);
-              //           DBG(" - RADEON_BIOS_0_SCRATCH = 0x%08X\n", gfx->Connectors);
-              gfx->ConnChanged = FALSE;
-
-              SlotDevice                  = &SlotDevices[0];
-              SlotDevice->SegmentGroupNum = (UINT16)Segment;
-              SlotDevice->BusNum          = (UINT8)Bus;
-              SlotDevice->DevFuncNum      = (UINT8)((Device << 3) | (Function & 0x07));
-              SlotDevice->Valid           = TRUE;
-              snprintf (SlotDevice->SlotName, 31, "PCI Slot 0");
-              SlotDevice->SlotID          = 1;
-              SlotDevice->SlotType        = SlotTypePciExpressX16;
-              break;
-
-            case 0x8086:
-              gfx->Vendor                 = Intel;
-				  snprintf (gfx->Model, 64, "%s", get_gma_model (Pci.Hdr.DeviceId));
-              DBG(" - GFX: Model=%s (Intel)\n", gfx->Model);
-              gfx->Ports = 1;
-              gfx->Connectors = (1 << NGFX);
-              gfx->ConnChanged = FALSE;
-              break;
-
-            case 0x10de:
-              gfx->Vendor = Nvidia;
-              Bar0        = Pci.Device.Bar[0];
-              gfx->Mmio   = (UINT8*)(UINTN)(Bar0 & ~0x0f);
-              //DBG("BAR: 0x%p\n", Mmio);
-              // get card type
-              gfx->Family = (REG32(gfx->Mmio, 0) >> 20) & 0x1ff;
-              UFamily = gfx->Family & 0x1F0;
-              if ((UFamily == NV_ARCH_KEPLER1) ||
-                  (UFamily == NV_ARCH_KEPLER2) ||
-                  (UFamily == NV_ARCH_KEPLER3)) {
-                CardFamily = "Kepler";
-              }
-              else if ((UFamily == NV_ARCH_FERMI1) ||
-                       (UFamily == NV_ARCH_FERMI2)) {
-                CardFamily = "Fermi";
-              }
-              else if ((UFamily == NV_ARCH_MAXWELL1) ||
-                       (UFamily == NV_ARCH_MAXWELL2)) {
-                CardFamily = "Maxwell";
-              }
-              else if (UFamily == NV_ARCH_PASCAL) {
-                CardFamily = "Pascal";
-              }
-              else if (UFamily == NV_ARCH_VOLTA) {
-                CardFamily = "Volta";
-              }
-              else if (UFamily == NV_ARCH_TURING) {
-                CardFamily = "Turing";
-              }
-              else if ((UFamily >= NV_ARCH_TESLA) && (UFamily < 0xB0)) { //not sure if 0xB0 is Tesla or Fermi
-                CardFamily = "Tesla";
-              } else {
-                CardFamily = "NVidia unknown";
-              }
-
-              snprintf (
-                          gfx->Model,
-                          64,
-                          "%s",
-                          get_nvidia_model (((Pci.Hdr.VendorId << 16) | Pci.Hdr.DeviceId),
-                                            ((Pci.Device.SubsystemVendorID << 16) | Pci.Device.SubsystemID),
-                                             NULL) //NULL: get from generic lists
-                          );
-
-            DBG(" - GFX: Model=%s family %hX (%s)\n", gfx->Model, gfx->Family, CardFamily);
-              gfx->Ports                  = 0;
-
-              SlotDevice                  = &SlotDevices[1];
-              SlotDevice->SegmentGroupNum = (UINT16)Segment;
-              SlotDevice->BusNum          = (UINT8)Bus;
-              SlotDevice->DevFuncNum      = (UINT8)((Device << 3) | (Function & 0x07));
-              SlotDevice->Valid           = TRUE;
-              snprintf (SlotDevice->SlotName, 31, "PCI Slot 0");
-              SlotDevice->SlotID          = 1;
-              SlotDevice->SlotType        = SlotTypePciExpressX16;
-              break;
-
-            default:
-              gfx->Vendor = Unknown;
-				  snprintf (gfx->Model, 64, "pci%hx,%hx", Pci.Hdr.VendorId, Pci.Hdr.DeviceId);
-              gfx->Ports  = 1;
-              gfx->Connectors = (1 << NGFX);
-              gfx->ConnChanged = FALSE;
-
-              break;
+          //get mmio
+          if (info->chip_family < CHIP_FAMILY_HAINAN) {
+            gfx->Mmio = (UINT8 *)(UINTN)(Pci.Device.Bar[2] & ~0x0f);
+          } else {
+            gfx->Mmio = (UINT8 *)(UINTN)(Pci.Device.Bar[5] & ~0x0f);
           }
+          gfx->Connectors = *(UINT32*)(gfx->Mmio + RADEON_BIOS_0_SCRATCH);
+          //           DBG(" - RADEON_BIOS_0_SCRATCH = 0x%08X\n", gfx->Connectors);
+          gfx->ConnChanged = FALSE;
 
-          NGFX++;
-        }   //if gfx
-
-        else if ((Pci.Hdr.ClassCode[2] == PCI_CLASS_NETWORK) &&
-                 (Pci.Hdr.ClassCode[1] == PCI_CLASS_NETWORK_OTHER)) {
-          SlotDevice                  = &SlotDevices[6];
+          SlotDevice                  = &SlotDevices[0];
           SlotDevice->SegmentGroupNum = (UINT16)Segment;
           SlotDevice->BusNum          = (UINT8)Bus;
           SlotDevice->DevFuncNum      = (UINT8)((Device << 3) | (Function & 0x07));
           SlotDevice->Valid           = TRUE;
-          snprintf (SlotDevice->SlotName, 31, "AirPort");
-          SlotDevice->SlotID          = 0;
-          SlotDevice->SlotType        = SlotTypePciExpressX1;
-          DBG(" - WIFI: Vendor= ");
-          switch (Pci.Hdr.VendorId) {
-            case 0x11ab:
-              DBG("Marvell\n");
-              break;
-            case 0x10ec:
-              DBG("Realtek\n");
-              break;
-            case 0x14e4:
-              DBG("Broadcom\n");
-              break;
-            case 0x1969:
-            case 0x168C:
-              DBG("Atheros\n");
-              break;
-            case 0x1814:
-              DBG("Ralink\n");
-              break;
-            case 0x8086:
-              DBG("Intel\n");
-              break;
+          snprintf (SlotDevice->SlotName, 31, "PCI Slot 0");
+          SlotDevice->SlotID          = 1;
+          SlotDevice->SlotType        = SlotTypePciExpressX16;
+          break;
 
-            default:
-              DBG(" 0x%04X\n", Pci.Hdr.VendorId);
-              break;
-          }
-        }
+        case 0x8086:
+          gfx->Vendor                 = Intel;
+				  snprintf (gfx->Model, 64, "%s", get_gma_model (Pci.Hdr.DeviceId));
+          DBG(" - GFX: Model=%s (Intel)\n", gfx->Model);
+          gfx->Ports = 1;
+          gfx->Connectors = (1 << NGFX);
+          gfx->ConnChanged = FALSE;
+          break;
 
-        else if ((Pci.Hdr.ClassCode[2] == PCI_CLASS_NETWORK) &&
-                 (Pci.Hdr.ClassCode[1] == PCI_CLASS_NETWORK_ETHERNET)) {
-          SlotDevice                  = &SlotDevices[5];
-          SlotDevice->SegmentGroupNum = (UINT16)Segment;
-          SlotDevice->BusNum          = (UINT8)Bus;
-          SlotDevice->DevFuncNum      = (UINT8)((Device << 3) | (Function & 0x07));
-          SlotDevice->Valid           = TRUE;
-          snprintf (SlotDevice->SlotName, 31, "Ethernet");
-          SlotDevice->SlotID          = 2;
-          SlotDevice->SlotType        = SlotTypePciExpressX1;
-          gLanVendor[nLanCards]       = Pci.Hdr.VendorId;
-          Bar0                        = Pci.Device.Bar[0];
-          gLanMmio[nLanCards++]       = (UINT8*)(UINTN)(Bar0 & ~0x0f);
-          if (nLanCards >= 4) {
-            DBG(" - [!] too many LAN card in the system (upto 4 limit exceeded), overriding the last one\n");
-            nLanCards = 3; // last one will be rewritten
+        case 0x10de:
+          gfx->Vendor = Nvidia;
+          Bar0        = Pci.Device.Bar[0];
+          gfx->Mmio   = (UINT8*)(UINTN)(Bar0 & ~0x0f);
+          //DBG("BAR: 0x%p\n", Mmio);
+          // get card type
+          gfx->Family = (REG32(gfx->Mmio, 0) >> 20) & 0x1ff;
+          UFamily = gfx->Family & 0x1F0;
+          if ((UFamily == NV_ARCH_KEPLER1) ||
+              (UFamily == NV_ARCH_KEPLER2) ||
+              (UFamily == NV_ARCH_KEPLER3)) {
+            CardFamily = "Kepler";
           }
-          DBG(" - LAN: %llu Vendor=", nLanCards-1);
-          switch (Pci.Hdr.VendorId) {
-            case 0x11ab:
-              DBG("Marvell\n");
-              break;
-            case 0x10ec:
-              DBG("Realtek\n");
-              break;
-            case 0x14e4:
-              DBG("Broadcom\n");
-              break;
-            case 0x1969:
-            case 0x168C:
-              DBG("Atheros\n");
-              break;
-            case 0x8086:
-              DBG("Intel\n");
-              break;
-            case 0x10de:
-              DBG("Nforce\n");
-              break;
-
-            default:
-              DBG("Unknown\n");
-              break;
+          else if ((UFamily == NV_ARCH_FERMI1) ||
+                   (UFamily == NV_ARCH_FERMI2)) {
+            CardFamily = "Fermi";
+          }
+          else if ((UFamily == NV_ARCH_MAXWELL1) ||
+                   (UFamily == NV_ARCH_MAXWELL2)) {
+            CardFamily = "Maxwell";
+          }
+          else if (UFamily == NV_ARCH_PASCAL) {
+            CardFamily = "Pascal";
+          }
+          else if (UFamily == NV_ARCH_VOLTA) {
+            CardFamily = "Volta";
+          }
+          else if (UFamily == NV_ARCH_TURING) {
+            CardFamily = "Turing";
+          }
+          else if ((UFamily >= NV_ARCH_TESLA) && (UFamily < 0xB0)) { //not sure if 0xB0 is Tesla or Fermi
+            CardFamily = "Tesla";
+          } else {
+            CardFamily = "NVidia unknown";
           }
-        }
 
-        else if ((Pci.Hdr.ClassCode[2] == PCI_CLASS_SERIAL) &&
-                 (Pci.Hdr.ClassCode[1] == PCI_CLASS_SERIAL_FIREWIRE)) {
-          SlotDevice = &SlotDevices[12];
+          snprintf (
+                      gfx->Model,
+                      64,
+                      "%s",
+                      get_nvidia_model (((Pci.Hdr.VendorId << 16) | Pci.Hdr.DeviceId),
+                                        ((Pci.Device.SubsystemVendorID << 16) | Pci.Device.SubsystemID),
+                                         NULL) //NULL: get from generic lists
+                      );
+
+        DBG(" - GFX: Model=%s family %hX (%s)\n", gfx->Model, gfx->Family, CardFamily);
+          gfx->Ports                  = 0;
+
+          SlotDevice                  = &SlotDevices[1];
           SlotDevice->SegmentGroupNum = (UINT16)Segment;
           SlotDevice->BusNum          = (UINT8)Bus;
           SlotDevice->DevFuncNum      = (UINT8)((Device << 3) | (Function & 0x07));
           SlotDevice->Valid           = TRUE;
-          snprintf (SlotDevice->SlotName, 31, "FireWire");
-          SlotDevice->SlotID          = 3;
-          SlotDevice->SlotType        = SlotTypePciExpressX4;
-        }
+          snprintf (SlotDevice->SlotName, 31, "PCI Slot 0");
+          SlotDevice->SlotID          = 1;
+          SlotDevice->SlotType        = SlotTypePciExpressX16;
+          break;
 
-        else if ((Pci.Hdr.ClassCode[2] == PCI_CLASS_MEDIA) &&
-                 ((Pci.Hdr.ClassCode[1] == PCI_CLASS_MEDIA_HDA) ||
-                  (Pci.Hdr.ClassCode[1] == PCI_CLASS_MEDIA_AUDIO)) &&
-                 (NHDA < 4)) {
-          HDA_PROPERTIES *hda = &gAudios[NHDA];
+        default:
+          gfx->Vendor = Unknown;
+				  snprintf (gfx->Model, 64, "pci%hx,%hx", Pci.Hdr.VendorId, Pci.Hdr.DeviceId);
+          gfx->Ports  = 1;
+          gfx->Connectors = (1 << NGFX);
+          gfx->ConnChanged = FALSE;
 
-          // Populate Controllers IDs
-          hda->controller_vendor_id       = Pci.Hdr.VendorId;
-          hda->controller_device_id       = Pci.Hdr.DeviceId;
+          break;
+      }
 
-          // HDA Controller Info
-          HdaControllerGetName(((hda->controller_device_id << 16) | hda->controller_vendor_id), &hda->controller_name);
- 
+      NGFX++;
+    }   //if gfx
+
+    else if ((Pci.Hdr.ClassCode[2] == PCI_CLASS_NETWORK) &&
+             (Pci.Hdr.ClassCode[1] == PCI_CLASS_NETWORK_OTHER)) {
+      SlotDevice                  = &SlotDevices[6];
+      SlotDevice->SegmentGroupNum = (UINT16)Segment;
+      SlotDevice->BusNum          = (UINT8)Bus;
+      SlotDevice->DevFuncNum      = (UINT8)((Device << 3) | (Function & 0x07));
+      SlotDevice->Valid           = TRUE;
+      snprintf (SlotDevice->SlotName, 31, "AirPort");
+      SlotDevice->SlotID          = 0;
+      SlotDevice->SlotType        = SlotTypePciExpressX1;
+      DBG(" - WIFI: Vendor= ");
+      switch (Pci.Hdr.VendorId) {
+        case 0x11ab:
+          DBG("Marvell\n");
+          break;
+        case 0x10ec:
+          DBG("Realtek\n");
+          break;
+        case 0x14e4:
+          DBG("Broadcom\n");
+          break;
+        case 0x1969:
+        case 0x168C:
+          DBG("Atheros\n");
+          break;
+        case 0x1814:
+          DBG("Ralink\n");
+          break;
+        case 0x8086:
+          DBG("Intel\n");
+          break;
 
-          if (IsHDMIAudio(HandleArray[Index])) {
-            DBG(" - HDMI Audio: \n");
-
-            SlotDevice = &SlotDevices[4];
-            SlotDevice->SegmentGroupNum = (UINT16)Segment;
-            SlotDevice->BusNum          = (UINT8)Bus;
-            SlotDevice->DevFuncNum      = (UINT8)((Device << 3) | (Function & 0x07));
-            SlotDevice->Valid           = TRUE;
-            snprintf (SlotDevice->SlotName, 31, "HDMI port");
-            SlotDevice->SlotID          = 5;
-            SlotDevice->SlotType        = SlotTypePciExpressX4;
-          }
-          if (gSettings.ResetHDA) {
-            //Slice method from VoodooHDA
-            //PCI_HDA_TCSEL_OFFSET = 0x44
-            UINT8 Value = 0;
-            Status = PciIo->Pci.Read (PciIo, EfiPciIoWidthUint8, 0x44, 1, &Value);
+        default:
+          DBG(" 0x%04X\n", Pci.Hdr.VendorId);
+          break;
+      }
+    }
 
-            if (EFI_ERROR(Status)) {
-              continue;
-            }
+    else if ((Pci.Hdr.ClassCode[2] == PCI_CLASS_NETWORK) &&
+             (Pci.Hdr.ClassCode[1] == PCI_CLASS_NETWORK_ETHERNET)) {
+      SlotDevice                  = &SlotDevices[5];
+      SlotDevice->SegmentGroupNum = (UINT16)Segment;
+      SlotDevice->BusNum          = (UINT8)Bus;
+      SlotDevice->DevFuncNum      = (UINT8)((Device << 3) | (Function & 0x07));
+      SlotDevice->Valid           = TRUE;
+      snprintf (SlotDevice->SlotName, 31, "Ethernet");
+      SlotDevice->SlotID          = 2;
+      SlotDevice->SlotType        = SlotTypePciExpressX1;
+      gLanVendor[nLanCards]       = Pci.Hdr.VendorId;
+      Bar0                        = Pci.Device.Bar[0];
+      gLanMmio[nLanCards++]       = (UINT8*)(UINTN)(Bar0 & ~0x0f);
+      if (nLanCards >= 4) {
+        DBG(" - [!] too many LAN card in the system (upto 4 limit exceeded), overriding the last one\n");
+        nLanCards = 3; // last one will be rewritten
+      }
+      DBG(" - LAN: %llu Vendor=", nLanCards-1);
+      switch (Pci.Hdr.VendorId) {
+        case 0x11ab:
+          DBG("Marvell\n");
+          break;
+        case 0x10ec:
+          DBG("Realtek\n");
+          break;
+        case 0x14e4:
+          DBG("Broadcom\n");
+          break;
+        case 0x1969:
+        case 0x168C:
+          DBG("Atheros\n");
+          break;
+        case 0x8086:
+          DBG("Intel\n");
+          break;
+        case 0x10de:
+          DBG("Nforce\n");
+          break;
 
-            Value &= 0xf8;
-            PciIo->Pci.Write (PciIo, EfiPciIoWidthUint8, 0x44, 1, &Value);
-            //ResetControllerHDA();
-          }
-          NHDA++;
-        } // if Audio device
+        default:
+          DBG("Unknown\n");
+          break;
       }
     }
+
+    else if ((Pci.Hdr.ClassCode[2] == PCI_CLASS_SERIAL) &&
+             (Pci.Hdr.ClassCode[1] == PCI_CLASS_SERIAL_FIREWIRE)) {
+      SlotDevice = &SlotDevices[12];
+      SlotDevice->SegmentGroupNum = (UINT16)Segment;
+      SlotDevice->BusNum          = (UINT8)Bus;
+      SlotDevice->DevFuncNum      = (UINT8)((Device << 3) | (Function & 0x07));
+      SlotDevice->Valid           = TRUE;
+      snprintf (SlotDevice->SlotName, 31, "FireWire");
+      SlotDevice->SlotID          = 3;
+      SlotDevice->SlotType        = SlotTypePciExpressX4;
+    }
+
+    else if ((Pci.Hdr.ClassCode[2] == PCI_CLASS_MEDIA) &&
+             ((Pci.Hdr.ClassCode[1] == PCI_CLASS_MEDIA_HDA) ||
+              (Pci.Hdr.ClassCode[1] == PCI_CLASS_MEDIA_AUDIO)) &&
+             (NHDA < 4)) {
+      HDA_PROPERTIES *hda = &gAudios[NHDA];
+
+      // Populate Controllers IDs
+      hda->controller_vendor_id       = Pci.Hdr.VendorId;
+      hda->controller_device_id       = Pci.Hdr.DeviceId;
+
+      // HDA Controller Info
+      HdaControllerGetName(((hda->controller_device_id << 16) | hda->controller_vendor_id), &hda->controller_name);
+ 
+
+      if (IsHDMIAudio(PciDev->Handle)) {
+        DBG(" - HDMI Audio: \n");
+
+        SlotDevice = &SlotDevices[4];
+        SlotDevice->SegmentGroupNum = (UINT16)Segment;
+        SlotDevice->BusNum          = (UINT8)Bus;
+        SlotDevice->DevFuncNum      = (UINT8)((Device << 3) | (Function & 0x07));
+        SlotDevice->Valid           = TRUE;
+        snprintf (SlotDevice->SlotName, 31, "HDMI port");
+        SlotDevice->SlotID          = 5;
+        SlotDevice->SlotType        = SlotTypePciExpressX4;
+      }
+      if (gSettings.ResetHDA) {
+        //Slice method from VoodooHDA
+        //PCI_HDA_TCSEL_OFFSET = 0x44
+        UINT8 Value = 0;
+        Status = PciIo->Pci.Read (PciIo, EfiPciIoWidthUint8, 0x44, 1, &Value);
+
+        if (EFI_ERROR(Status)) {
+          continue;
+        }
+
+        Value &= 0xf8;
+        PciIo->Pci.Write (PciIo, EfiPciIoWidthUint8, 0x44, 1, &Value);
+        //ResetControllerHDA();
+      }
+      NHDA++;
+    } // if Audio device
   }
 }
 
@@ -7178,13 +7608,13 @@ GetDevices ()
 void
 SetDevices (LOADER_ENTRY *Entry)
 {
+  TimelineSpan Span("SetDevices");
   //  EFI_GRAPHICS_OUTPUT_MODE_INFORMATION  *modeInfo;
   EFI_STATUS          Status;
   EFI_PCI_IO_PROTOCOL *PciIo;
   PCI_TYPE00          Pci;
-  UINTN               HandleCount;
+  UINTN               PciCount;
   UINTN               i, j;
-  EFI_HANDLE          *HandleBuffer;
   pci_dt_t            PCIdevice;
   UINTN               Segment;
   UINTN               Bus;
@@ -7197,6 +7627,8 @@ SetDevices (LOADER_ENTRY *Entry)
   UINT32              Hptc;
   DEV_PROPERTY *Prop = NULL;
   DEV_PROPERTY *Prop2 = NULL;
+  DEV_PROPERTY **ArbProps;
+  UINTN         ArbCount;
   DevPropDevice *device = NULL;
 
   GetEdidDiscovered ();
@@ -7242,778 +7674,763 @@ SetDevices (LOADER_ENTRY *Entry)
   }
 
   devices_number = 1; //should initialize for reentering GUI
-  // Scan PCI handles
-  Status = gBS->LocateHandleBuffer (
-                                    ByProtocol,
-                                    &gEfiPciIoProtocolGuid,
-                                    NULL,
-                                    &HandleCount,
-                                    &HandleBuffer
-                                    );
-
-  if (!EFI_ERROR(Status)) {
-    for (i = 0; i < HandleCount; i++) {
-      Status = gBS->HandleProtocol (HandleBuffer[i], &gEfiPciIoProtocolGuid, (void **)&PciIo);
-      if (!EFI_ERROR(Status)) {
-        // Read PCI BUS
-        Status = PciIo->Pci.Read (PciIo, EfiPciIoWidthUint32, 0, sizeof (Pci) / sizeof (UINT32), &Pci);
-        if (EFI_ERROR(Status)) {
-          continue;
+  // Scan PCI functions
+  PciCount = PciSnapshotCount();
+  for (i = 0; i < PciCount; i++) {
+    const PCI_SNAPSHOT_DEVICE *PciDev = PciSnapshotDevice(i);
+    PciIo    = PciDev->PciIo;
+    Segment  = PciDev->Segment;
+    Bus      = PciDev->Bus;
+    Device   = PciDev->Device;
+    Function = PciDev->Function;
+    CopyMem(&Pci, &PciDev->Pci, sizeof(Pci));
+
+    PCIdevice.DeviceHandle               = PciDev->Handle;
+    PCIdevice.dev.addr                   = (UINT32)PCIADDR(Bus, Device, Function);
+    PCIdevice.vendor_id                  = Pci.Hdr.VendorId;
+    PCIdevice.device_id                  = Pci.Hdr.DeviceId;
+    PCIdevice.revision                   = Pci.Hdr.RevisionID;
+    PCIdevice.subclass                   = Pci.Hdr.ClassCode[0];
+    PCIdevice.class_id                   = *((UINT16*)(Pci.Hdr.ClassCode+1));
+    PCIdevice.subsys_id.subsys.vendor_id = Pci.Device.SubsystemVendorID;
+    PCIdevice.subsys_id.subsys.device_id = Pci.Device.SubsystemID;
+    PCIdevice.used                       = FALSE;
+
+    //if (gSettings.NrAddProperties == 0xFFFE) {  //yyyy it means Arbitrary
+    //------------------
+    ArbProps = GetArbProperties(PCIdevice.dev.addr, &ArbCount);  //check for additional properties
+    device = NULL;
+    /*       if (!string) {
+     string = devprop_create_string();
+     } */
+    for (j = 0; j < ArbCount; j++) {
+      Prop = ArbProps[j];
+      if (!PCIdevice.used) {
+        device = devprop_add_device_pci(device_inject_string, &PCIdevice, NULL);
+        PCIdevice.used = TRUE;
+      }
+      //special corrections
+      if (Prop->MenuItem.BValue) {
+        if (AsciiStrStr(Prop->Key, "-platform-id") != NULL) {
+          devprop_add_value(device, Prop->Key, (UINT8*)&gSettings.IgPlatform, 4);
+        } else {
+          devprop_add_value(device, Prop->Key, (UINT8*)Prop->Value, Prop->ValueLen);
         }
+      }
 
-        Status                               = PciIo->GetLocation (PciIo, &Segment, &Bus, &Device, &Function);
-        PCIdevice.DeviceHandle               = HandleBuffer[i];
-        PCIdevice.dev.addr                   = (UINT32)PCIADDR(Bus, Device, Function);
-        PCIdevice.vendor_id                  = Pci.Hdr.VendorId;
-        PCIdevice.device_id                  = Pci.Hdr.DeviceId;
-        PCIdevice.revision                   = Pci.Hdr.RevisionID;
-        PCIdevice.subclass                   = Pci.Hdr.ClassCode[0];
-        PCIdevice.class_id                   = *((UINT16*)(Pci.Hdr.ClassCode+1));
-        PCIdevice.subsys_id.subsys.vendor_id = Pci.Device.SubsystemVendorID;
-        PCIdevice.subsys_id.subsys.device_id = Pci.Device.SubsystemID;
-        PCIdevice.used                       = FALSE;
-
-        //if (gSettings.NrAddProperties == 0xFFFE) {  //yyyy it means Arbitrary
-        //------------------
-        Prop = gSettings.ArbProperties;  //check for additional properties
-        device = NULL;
-        /*       if (!string) {
-         string = devprop_create_string();
-         } */
-        while (Prop) {
-          if (Prop->Device != PCIdevice.dev.addr) {
-            Prop = Prop->Next;
-            continue;
-          }
-          if (!PCIdevice.used) {
-            device = devprop_add_device_pci(device_inject_string, &PCIdevice, NULL);
-            PCIdevice.used = TRUE;
+      StringDirty = TRUE;
+    }
+    //------------------
+    if (PCIdevice.used) {
+      DBG("custom properties for device %02llX:%02llX.%02llX injected\n", Bus, Device, Function);
+      //continue;
+    }
+    //}
+
+    // GFX
+    if (/* gSettings.GraphicsInjector && */
+        (Pci.Hdr.ClassCode[2] == PCI_CLASS_DISPLAY) &&
+        ((Pci.Hdr.ClassCode[1] == PCI_CLASS_DISPLAY_VGA) ||
+         (Pci.Hdr.ClassCode[1] == PCI_CLASS_DISPLAY_OTHER))) {
+      //gGraphics.DeviceID = Pci.Hdr.DeviceId;
+
+      switch (Pci.Hdr.VendorId) {
+        case 0x1002:
+          if (gSettings.InjectATI) {
+            //can't do this in one step because of C-conventions
+            TmpDirty    = setup_ati_devprop(Entry, &PCIdevice);
+            StringDirty |=  TmpDirty;
+          } else {
+            MsgLog ("ATI injection not set\n");
           }
-          //special corrections
-          if (Prop->MenuItem.BValue) {
-            if (AsciiStrStr(Prop->Key, "-platform-id") != NULL) {
-              devprop_add_value(device, Prop->Key, (UINT8*)&gSettings.IgPlatform, 4);
-            } else {
-              devprop_add_value(device, Prop->Key, (UINT8*)Prop->Value, Prop->ValueLen);
+
+          for (j = 0; j < 4; j++) {
+            if (gGraphics[j].Handle == PCIdevice.DeviceHandle) {
+              if (gGraphics[j].ConnChanged) {
+                *(UINT32*)(gGraphics[j].Mmio + RADEON_BIOS_0_SCRATCH) = gGraphics[j].Connectors;
+              }
+              break;
             }
           }
 
-          StringDirty = TRUE;
-          Prop = Prop->Next;
-        }
-        //------------------
-        if (PCIdevice.used) {
-          DBG("custom properties for device %02llX:%02llX.%02llX injected\n", Bus, Device, Function);
-          //continue;
-        }
-        //}
-
-        // GFX
-        if (/* gSettings.GraphicsInjector && */
-            (Pci.Hdr.ClassCode[2] == PCI_CLASS_DISPLAY) &&
-            ((Pci.Hdr.ClassCode[1] == PCI_CLASS_DISPLAY_VGA) ||
-             (Pci.Hdr.ClassCode[1] == PCI_CLASS_DISPLAY_OTHER))) {
-          //gGraphics.DeviceID = Pci.Hdr.DeviceId;
-
-          switch (Pci.Hdr.VendorId) {
-            case 0x1002:
-              if (gSettings.InjectATI) {
-                //can't do this in one step because of C-conventions
-                TmpDirty    = setup_ati_devprop(Entry, &PCIdevice);
-                StringDirty |=  TmpDirty;
-              } else {
-                MsgLog ("ATI injection not set\n");
+          if (gSettings.DeInit) {
+            for (j = 0; j < 4; j++) {
+              if (gGraphics[j].Handle == PCIdevice.DeviceHandle) {
+                *(UINT32*)(gGraphics[j].Mmio + 0x6848) = 0; //EVERGREEN_GRPH_FLIP_CONTROL, 1<<0 SURFACE_UPDATE_H_RETRACE_EN
+                *(UINT32*)(gGraphics[j].Mmio + 0x681C) = 0; //EVERGREEN_GRPH_PRIMARY_SURFACE_ADDRESS_HIGH
+                *(UINT32*)(gGraphics[j].Mmio + 0x6820) = 0; //EVERGREEN_GRPH_SECONDARY_SURFACE_ADDRESS_HIGH
+                *(UINT32*)(gGraphics[j].Mmio + 0x6808) = 0; //EVERGREEN_GRPH_LUT_10BIT_BYPASS_CONTROL, EVERGREEN_LUT_10BIT_BYPASS_EN  (1 << 8)
+                *(UINT32*)(gGraphics[j].Mmio + 0x6800) = 1; //EVERGREEN_GRPH_ENABLE
+                *(UINT32*)(gGraphics[j].Mmio + 0x6EF8) = 0; //EVERGREEN_MASTER_UPDATE_MODE
+                //*(UINT32*)(gGraphics[j].Mmio + R600_BIOS_0_SCRATCH) = 0x00810000;
+                DBG("Device %llu deinited\n", j);
               }
+            }
+          }
+          break;
+
+        case 0x8086:
+          if (gSettings.InjectIntel) {
+            TmpDirty    = setup_gma_devprop(Entry, &PCIdevice);
+            StringDirty |=  TmpDirty;
+            MsgLog ("Intel GFX revision  = 0x%hhX\n", PCIdevice.revision);
+          } else {
+            MsgLog ("Intel GFX injection not set\n");
+          }
 
-              for (j = 0; j < 4; j++) {
-                if (gGraphics[j].Handle == PCIdevice.DeviceHandle) {
-                  if (gGraphics[j].ConnChanged) {
-                    *(UINT32*)(gGraphics[j].Mmio + RADEON_BIOS_0_SCRATCH) = gGraphics[j].Connectors;
+          // IntelBacklight reworked by Sherlocks. 2018.10.07
+          if (gSettings.IntelBacklight || gSettings.IntelMaxBacklight) {
+            UINT32 LEV2 = 0, LEVL = 0, P0BL = 0, GRAN = 0;
+            UINT32 LEVW = 0, LEVX = 0, LEVD = 0, PCHL = 0;
+            UINT32 ShiftLEVX = 0, FBLEVX = 0;
+            UINT32 SYSLEVW = 0x80000000;
+            UINT32 MACLEVW = 0xC0000000;
+
+            MsgLog ("Intel GFX IntelBacklight\n");
+            // Read LEV2
+            /*Status = */PciIo->Mem.Read(
+                                         PciIo,
+                                         EfiPciIoWidthUint32,
+                                         0,
+                                         0x48250,
+                                         1,
+                                         &LEV2
+                                         );
+            // Read LEVL
+            /*Status = */PciIo->Mem.Read(
+                                         PciIo,
+                                         EfiPciIoWidthUint32,
+                                         0,
+                                         0x48254,
+                                         1,
+                                         &LEVL
+                                         );
+            // Read P0BL -- what is the sense to read if not used?
+            /*Status = */PciIo->Mem.Read(
+                                         PciIo,
+                                         EfiPciIoWidthUint32,
+                                         0,
+                                         0x70040,
+                                         1,
+                                         &P0BL
+                                         );
+            // Read GRAN
+            /*Status = */PciIo->Mem.Read(
+                                         PciIo,
+                                         EfiPciIoWidthUint32,
+                                         0,
+                                         0xC2000,
+                                         1,
+                                         &GRAN
+                                         );
+            // Read LEVW
+            /*Status = */PciIo->Mem.Read(
+                                         PciIo,
+                                         EfiPciIoWidthUint32,
+                                         0,
+                                         0xC8250,
+                                         1,
+                                         &LEVW
+                                         );
+            // Read LEVX
+            /*Status = */PciIo->Mem.Read(
+                                         PciIo,
+                                         EfiPciIoWidthUint32,
+                                         0,
+                                         0xC8254,
+                                         1,
+                                         &LEVX
+                                         );
+            ShiftLEVX = LEVX >> 16;
+            // Read LEVD
+            /*Status = */PciIo->Mem.Read(
+                                         PciIo,
+                                         EfiPciIoWidthUint32,
+                                         0,
+                                         0xC8258,
+                                         1,
+                                         &LEVD
+                                         );
+            // Read PCHL
+            /*Status = */PciIo->Mem.Read(
+                                         PciIo,
+                                         EfiPciIoWidthUint32,
+                                         0,
+                                         0xE1180,
+                                         1,
+                                         &PCHL
+                                         );
+            MsgLog ("  LEV2 = 0x%X, LEVL = 0x%X, P0BL = 0x%X, GRAN = 0x%X\n", LEV2, LEVL, P0BL, GRAN);
+            MsgLog ("  LEVW = 0x%X, LEVX = 0x%X, LEVD = 0x%X, PCHL = 0x%X\n", LEVW, LEVX, LEVD, PCHL);
+
+            // Maximum brightness level of each framebuffers
+            //  Sandy Bridge/Ivy Bridge: 0x0710
+            //  Haswell/Broadwell: 0x056C/0x07A1/0x0AD9/0x1499
+            //  Skylake/KabyLake: 0x056C
+            //  Coffee Lake: 0xFFFF
+            switch (Pci.Hdr.DeviceId) {
+              case 0x0102: // "Intel HD Graphics 2000"
+              case 0x0106: // "Intel HD Graphics 2000"
+              case 0x010A: // "Intel HD Graphics P3000"
+              case 0x0112: // "Intel HD Graphics 3000"
+              case 0x0116: // "Intel HD Graphics 3000"
+              case 0x0122: // "Intel HD Graphics 3000"
+              case 0x0126: // "Intel HD Graphics 3000"
+                if (gSettings.IgPlatform) {
+                  switch (gSettings.IgPlatform) {
+                    case (UINT32)0x00030010:
+                    case (UINT32)0x00050000:
+                      FBLEVX = 0xFFFF;
+                      break;
+                    default:
+                      FBLEVX = 0x0710;
+                      break;
                   }
-                  break;
+                } else {
+                  FBLEVX = 0x0710;
                 }
-              }
-
-              if (gSettings.DeInit) {
-                for (j = 0; j < 4; j++) {
-                  if (gGraphics[j].Handle == PCIdevice.DeviceHandle) {
-                    *(UINT32*)(gGraphics[j].Mmio + 0x6848) = 0; //EVERGREEN_GRPH_FLIP_CONTROL, 1<<0 SURFACE_UPDATE_H_RETRACE_EN
-                    *(UINT32*)(gGraphics[j].Mmio + 0x681C) = 0; //EVERGREEN_GRPH_PRIMARY_SURFACE_ADDRESS_HIGH
-                    *(UINT32*)(gGraphics[j].Mmio + 0x6820) = 0; //EVERGREEN_GRPH_SECONDARY_SURFACE_ADDRESS_HIGH
-                    *(UINT32*)(gGraphics[j].Mmio + 0x6808) = 0; //EVERGREEN_GRPH_LUT_10BIT_BYPASS_CONTROL, EVERGREEN_LUT_10BIT_BYPASS_EN  (1 << 8)
-                    *(UINT32*)(gGraphics[j].Mmio + 0x6800) = 1; //EVERGREEN_GRPH_ENABLE
-                    *(UINT32*)(gGraphics[j].Mmio + 0x6EF8) = 0; //EVERGREEN_MASTER_UPDATE_MODE
-                    //*(UINT32*)(gGraphics[j].Mmio + R600_BIOS_0_SCRATCH) = 0x00810000;
-                    DBG("Device %llu deinited\n", j);
+                break;
+
+              case 0x0152: // "Intel HD Graphics 2500"
+              case 0x0156: // "Intel HD Graphics 2500"
+              case 0x015A: // "Intel HD Graphics 2500"
+              case 0x0162: // "Intel HD Graphics 4000"
+              case 0x0166: // "Intel HD Graphics 4000"
+              case 0x016A: // "Intel HD Graphics P4000"
+                FBLEVX = 0x0710;
+                break;
+
+              case 0x0412: // "Intel HD Graphics 4600"
+              case 0x0416: // "Intel HD Graphics 4600"
+              case 0x041A: // "Intel HD Graphics P4600"
+              case 0x041E: // "Intel HD Graphics 4400"
+              case 0x0422: // "Intel HD Graphics 5000"
+              case 0x0426: // "Intel HD Graphics 5000"
+              case 0x042A: // "Intel HD Graphics 5000"
+              case 0x0A06: // "Intel HD Graphics"
+              case 0x0A16: // "Intel HD Graphics 4400"
+              case 0x0A1E: // "Intel HD Graphics 4200"
+              case 0x0A22: // "Intel Iris Graphics 5100"
+              case 0x0A26: // "Intel HD Graphics 5000"
+              case 0x0A2A: // "Intel Iris Graphics 5100"
+              case 0x0A2B: // "Intel Iris Graphics 5100"
+              case 0x0A2E: // "Intel Iris Graphics 5100"
+              case 0x0D12: // "Intel HD Graphics 4600"
+              case 0x0D16: // "Intel HD Graphics 4600"
+              case 0x0D22: // "Intel Iris Pro Graphics 5200"
+              case 0x0D26: // "Intel Iris Pro Graphics 5200"
+              case 0x0D2A: // "Intel Iris Pro Graphics 5200"
+              case 0x0D2B: // "Intel Iris Pro Graphics 5200"
+              case 0x0D2E: // "Intel Iris Pro Graphics 5200"
+                if (gSettings.IgPlatform) {
+                  switch (gSettings.IgPlatform) {
+                    case (UINT32)0x04060000:
+                    case (UINT32)0x0c060000:
+                    case (UINT32)0x04160000:
+                    case (UINT32)0x0c160000:
+                    case (UINT32)0x04260000:
+                    case (UINT32)0x0c260000:
+                    case (UINT32)0x0d260000:
+                    case (UINT32)0x0d220003:
+                      FBLEVX = 0x1499;
+                      break;
+                    case (UINT32)0x0a160000:
+                    case (UINT32)0x0a260000:
+                    case (UINT32)0x0a260005:
+                    case (UINT32)0x0a260006:
+                      FBLEVX = 0x0AD9;
+                      break;
+                    case (UINT32)0x0d260007:
+                      FBLEVX = 0x07A1;
+                      break;
+                    case (UINT32)0x04120004:
+                    case (UINT32)0x0412000b:
+                      break;
+                    default:
+                      FBLEVX = 0x056C;
+                      break;
+                  }
+                } else {
+                  switch (Pci.Hdr.DeviceId) {
+                    case 0x0406:
+                    case 0x0C06:
+                    case 0x0416:
+                    case 0x0C16:
+                    case 0x0426:
+                    case 0x0C26:
+                    case 0x0D22:
+                      FBLEVX = 0x1499;
+                      break;
+                    case 0x0A16:
+                    case 0x0A26:
+                      FBLEVX = 0x0AD9;
+                      break;
+                    case 0x0D26:
+                      FBLEVX = 0x07A1;
+                      break;
+                    default:
+                      FBLEVX = 0x056C;
+                      break;
                   }
                 }
-              }
-              break;
-
-            case 0x8086:
-              if (gSettings.InjectIntel) {
-                TmpDirty    = setup_gma_devprop(Entry, &PCIdevice);
-                StringDirty |=  TmpDirty;
-                MsgLog ("Intel GFX revision  = 0x%hhX\n", PCIdevice.revision);
-              } else {
-                MsgLog ("Intel GFX injection not set\n");
-              }
-
-              // IntelBacklight reworked by Sherlocks. 2018.10.07
-              if (gSettings.IntelBacklight || gSettings.IntelMaxBacklight) {
-                UINT32 LEV2 = 0, LEVL = 0, P0BL = 0, GRAN = 0;
-                UINT32 LEVW = 0, LEVX = 0, LEVD = 0, PCHL = 0;
-                UINT32 ShiftLEVX = 0, FBLEVX = 0;
-                UINT32 SYSLEVW = 0x80000000;
-                UINT32 MACLEVW = 0xC0000000;
-
-                MsgLog ("Intel GFX IntelBacklight\n");
-                // Read LEV2
-                /*Status = */PciIo->Mem.Read(
-                                             PciIo,
-                                             EfiPciIoWidthUint32,
-                                             0,
-                                             0x48250,
-                                             1,
-                                             &LEV2
-                                             );
-                // Read LEVL
-                /*Status = */PciIo->Mem.Read(
-                                             PciIo,
-                                             EfiPciIoWidthUint32,
-                                             0,
-                                             0x48254,
-                                             1,
-                                             &LEVL
-                                             );
-                // Read P0BL -- what is the sense to read if not used?
-                /*Status = */PciIo->Mem.Read(
-                                             PciIo,
-                                             EfiPciIoWidthUint32,
-                                             0,
-                                             0x70040,
-                                             1,
-                                             &P0BL
-                                             );
-                // Read GRAN
-                /*Status = */PciIo->Mem.Read(
-                                             PciIo,
-                                             EfiPciIoWidthUint32,
-                                             0,
-                                             0xC2000,
-                                             1,
-                                             &GRAN
-                                             );
-                // Read LEVW
-                /*Status = */PciIo->Mem.Read(
-                                             PciIo,
-                                             EfiPciIoWidthUint32,
-                                             0,
-                                             0xC8250,
-                                             1,
-                                             &LEVW
-                                             );
-                // Read LEVX
-                /*Status = */PciIo->Mem.Read(
-                                             PciIo,
-                                             EfiPciIoWidthUint32,
-                                             0,
-                                             0xC8254,
-                                             1,
-                                             &LEVX
-                                             );
-                ShiftLEVX = LEVX >> 16;
-                // Read LEVD
-                /*Status = */PciIo->Mem.Read(
-                                             PciIo,
-                                             EfiPciIoWidthUint32,
-                                             0,
-                                             0xC8258,
-                                             1,
-                                             &LEVD
-                                             );
-                // Read PCHL
-                /*Status = */PciIo->Mem.Read(
-                                             PciIo,
-                                             EfiPciIoWidthUint32,
-                                             0,
-                                             0xE1180,
-                                             1,
-                                             &PCHL
-                                             );
-                MsgLog ("  LEV2 = 0x%X, LEVL = 0x%X, P0BL = 0x%X, GRAN = 0x%X\n", LEV2, LEVL, P0BL, GRAN);
-                MsgLog ("  LEVW = 0x%X, LEVX = 0x%X, LEVD = 0x%X, PCHL = 0x%X\n", LEVW, LEVX, LEVD, PCHL);
-
-                // Maximum brightness level of each framebuffers
-                //  Sandy Bridge/Ivy Bridge: 0x0710
-                //  Haswell/Broadwell: 0x056C/0x07A1/0x0AD9/0x1499
-                //  Skylake/KabyLake: 0x056C
-                //  Coffee Lake: 0xFFFF
-                switch (Pci.Hdr.DeviceId) {
-                  case 0x0102: // "Intel HD Graphics 2000"
-                  case 0x0106: // "Intel HD Graphics 2000"
-                  case 0x010A: // "Intel HD Graphics P3000"
-                  case 0x0112: // "Intel HD Graphics 3000"
-                  case 0x0116: // "Intel HD Graphics 3000"
-                  case 0x0122: // "Intel HD Graphics 3000"
-                  case 0x0126: // "Intel HD Graphics 3000"
-                    if (gSettings.IgPlatform) {
-                      switch (gSettings.IgPlatform) {
-                        case (UINT32)0x00030010:
-                        case (UINT32)0x00050000:
-                          FBLEVX = 0xFFFF;
-                          break;
-                        default:
-                          FBLEVX = 0x0710;
-                          break;
-                      }
-                    } else {
-                      FBLEVX = 0x0710;
-                    }
-                    break;
-
-                  case 0x0152: // "Intel HD Graphics 2500"
-                  case 0x0156: // "Intel HD Graphics 2500"
-                  case 0x015A: // "Intel HD Graphics 2500"
-                  case 0x0162: // "Intel HD Graphics 4000"
-                  case 0x0166: // "Intel HD Graphics 4000"
-                  case 0x016A: // "Intel HD Graphics P4000"
-                    FBLEVX = 0x0710;
-                    break;
-
-                  case 0x0412: // "Intel HD Graphics 4600"
-                  case 0x0416: // "Intel HD Graphics 4600"
-                  case 0x041A: // "Intel HD Graphics P4600"
-                  case 0x041E: // "Intel HD Graphics 4400"
-                  case 0x0422: // "Intel HD Graphics 5000"
-                  case 0x0426: // "Intel HD Graphics 5000"
-                  case 0x042A: // "Intel HD Graphics 5000"
-                  case 0x0A06: // "Intel HD Graphics"
-                  case 0x0A16: // "Intel HD Graphics 4400"
-                  case 0x0A1E: // "Intel HD Graphics 4200"
-                  case 0x0A22: // "Intel Iris Graphics 5100"
-                  case 0x0A26: // "Intel HD Graphics 5000"
-                  case 0x0A2A: // "Intel Iris Graphics 5100"
-                  case 0x0A2B: // "Intel Iris Graphics 5100"
-                  case 0x0A2E: // "Intel Iris Graphics 5100"
-                  case 0x0D12: // "Intel HD Graphics 4600"
-                  case 0x0D16: // "Intel HD Graphics 4600"
-                  case 0x0D22: // "Intel Iris Pro Graphics 5200"
-                  case 0x0D26: // "Intel Iris Pro Graphics 5200"
-                  case 0x0D2A: // "Intel Iris Pro Graphics 5200"
-                  case 0x0D2B: // "Intel Iris Pro Graphics 5200"
-                  case 0x0D2E: // "Intel Iris Pro Graphics 5200"
-                    if (gSettings.IgPlatform) {
-                      switch (gSettings.IgPlatform) {
-                        case (UINT32)0x04060000:
-                        case (UINT32)0x0c060000:
-                        case (UINT32)0x04160000:
-                        case (UINT32)0x0c160000:
-                        case (UINT32)0x04260000:
-                        case (UINT32)0x0c260000:
-                        case (UINT32)0x0d260000:
-                        case (UINT32)0x0d220003:
-                          FBLEVX = 0x1499;
-                          break;
-                        case (UINT32)0x0a160000:
-                        case (UINT32)0x0a260000:
-                        case (UINT32)0x0a260005:
-                        case (UINT32)0x0a260006:
-                          FBLEVX = 0x0AD9;
-                          break;
-                        case (UINT32)0x0d260007:
-                          FBLEVX = 0x07A1;
-                          break;
-                        case (UINT32)0x04120004:
-                        case (UINT32)0x0412000b:
-                          break;
-                        default:
-                          FBLEVX = 0x056C;
-                          break;
-                      }
-                    } else {
-                      switch (Pci.Hdr.DeviceId) {
-                        case 0x0406:
-                        case 0x0C06:
-                        case 0x0416:
-                        case 0x0C16:
-                        case 0x0426:
-                        case 0x0C26:
-                        case 0x0D22:
-                          FBLEVX = 0x1499;
-                          break;
-                        case 0x0A16:
-                        case 0x0A26:
-                          FBLEVX = 0x0AD9;
-                          break;
-                        case 0x0D26:
-                          FBLEVX = 0x07A1;
-                          break;
-                        default:
-                          FBLEVX = 0x056C;
-                          break;
-                      }
-                    }
-                    break;
-
-                  case 0x1612: // "Intel HD Graphics 5600"
-                  case 0x1616: // "Intel HD Graphics 5500"
-                  case 0x161E: // "Intel HD Graphics 5300"
-                  case 0x1626: // "Intel HD Graphics 6000"
-                  case 0x162B: // "Intel Iris Graphics 6100"
-                  case 0x162D: // "Intel Iris Pro Graphics P6300"
-                  case 0x1622: // "Intel Iris Pro Graphics 6200"
-                  case 0x162A: // "Intel Iris Pro Graphics P6300"
-                    if (gSettings.IgPlatform) {
-                      switch (gSettings.IgPlatform) {
-                        case (UINT32)0x16060000:
-                        case (UINT32)0x160e0000:
-                        case (UINT32)0x16160000:
-                        case (UINT32)0x161e0000:
-                        case (UINT32)0x16220000:
-                        case (UINT32)0x16260000:
-                        case (UINT32)0x162b0000:
-                        case (UINT32)0x16260004:
-                        case (UINT32)0x162b0004:
-                        case (UINT32)0x16220007:
-                        case (UINT32)0x16260008:
-                        case (UINT32)0x162b0008:
-                          FBLEVX = 0x1499;
-                          break;
-                        case (UINT32)0x16260005:
-                        case (UINT32)0x16260006:
-                          FBLEVX = 0x0AD9;
-                          break;
-                        case (UINT32)0x16120003:
-                          FBLEVX = 0x07A1;
-                          break;
-                        default:
-                          FBLEVX = 0x056C;
-                          break;
-                      }
-                    } else {
-                      switch (Pci.Hdr.DeviceId) {
-                        case 0x1606:
-                        case 0x160E:
-                        case 0x1616:
-                        case 0x161E:
-                        case 0x1622:
-                          FBLEVX = 0x1499;
-                          break;
-                        case 0x1626:
-                          FBLEVX = 0x0AD9;
-                          break;
-                        case 0x1612:
-                          FBLEVX = 0x07A1;
-                          break;
-                        default:
-                          FBLEVX = 0x056C;
-                          break;
-                      }
-                    }
-                    break;
-
-                  case 0x1902: // "Intel HD Graphics 510"
-                  case 0x1906: // "Intel HD Graphics 510"
-                  case 0x190B: // "Intel HD Graphics 510"
-                  case 0x1912: // "Intel HD Graphics 530"
-                  case 0x1916: // "Intel HD Graphics 520"
-                  case 0x191B: // "Intel HD Graphics 530"
-                  case 0x191D: // "Intel HD Graphics P530"
-                  case 0x191E: // "Intel HD Graphics 515"
-                  case 0x1921: // "Intel HD Graphics 520"
-                  case 0x1923: // "Intel HD Graphics 535"
-                  case 0x1926: // "Intel Iris Graphics 540"
-                  case 0x1927: // "Intel Iris Graphics 550"
-                  case 0x192B: // "Intel Iris Graphics 555"
-                  case 0x192D: // "Intel Iris Graphics P555"
-                  case 0x1932: // "Intel Iris Pro Graphics 580"
-                  case 0x193A: // "Intel Iris Pro Graphics P580"
-                  case 0x193B: // "Intel Iris Pro Graphics 580"
-                  case 0x193D: // "Intel Iris Pro Graphics P580"
-                    if (gSettings.IgPlatform) {
-                      switch (gSettings.IgPlatform) {
-                        case (UINT32)0x19120001:
-                        FBLEVX = 0xFFFF;
-                        break;
-                      default:
-                        FBLEVX = 0x056C;
-                        break;
-                      }
-                    } else {
+                break;
+
+              case 0x1612: // "Intel HD Graphics 5600"
+              case 0x1616: // "Intel HD Graphics 5500"
+              case 0x161E: // "Intel HD Graphics 5300"
+              case 0x1626: // "Intel HD Graphics 6000"
+              case 0x162B: // "Intel Iris Graphics 6100"
+              case 0x162D: // "Intel Iris Pro Graphics P6300"
+              case 0x1622: // "Intel Iris Pro Graphics 6200"
+              case 0x162A: // "Intel Iris Pro Graphics P6300"
+                if (gSettings.IgPlatform) {
+                  switch (gSettings.IgPlatform) {
+                    case (UINT32)0x16060000:
+                    case (UINT32)0x160e0000:
+                    case (UINT32)0x16160000:
+                    case (UINT32)0x161e0000:
+                    case (UINT32)0x16220000:
+                    case (UINT32)0x16260000:
+                    case (UINT32)0x162b0000:
+                    case (UINT32)0x16260004:
+                    case (UINT32)0x162b0004:
+                    case (UINT32)0x16220007:
+                    case (UINT32)0x16260008:
+                    case (UINT32)0x162b0008:
+                      FBLEVX = 0x1499;
+                      break;
+                    case (UINT32)0x16260005:
+                    case (UINT32)0x16260006:
+                      FBLEVX = 0x0AD9;
+                      break;
+                    case (UINT32)0x16120003:
+                      FBLEVX = 0x07A1;
+                      break;
+                    default:
                       FBLEVX = 0x056C;
-                    }
-                    break;
-
-                  case 0x5902: // "Intel HD Graphics 610"
-                  case 0x5906: // "Intel HD Graphics 610"
-                  case 0x5912: // "Intel HD Graphics 630"
-                  case 0x5916: // "Intel HD Graphics 620"
-                  case 0x591A: // "Intel HD Graphics P630"
-                  case 0x591B: // "Intel HD Graphics 630"
-                  case 0x591D: // "Intel HD Graphics P630"
-                  case 0x591E: // "Intel HD Graphics 615"
-                  case 0x5923: // "Intel HD Graphics 635"
-                  case 0x5926: // "Intel Iris Plus Graphics 640"
-                  case 0x5927: // "Intel Iris Plus Graphics 650"
-                  case 0x5917: // "Intel UHD Graphics 620"
-                  case 0x591C: // "Intel UHD Graphics 615"
-                  case 0x87C0: // "Intel UHD Graphics 617"
-                  case 0x87CA: // "Intel UHD Graphics 615"
-                    FBLEVX = 0x056C;
-                    break;
-
-                  case 0x3E90: // "Intel UHD Graphics 610"
-                  case 0x3E93: // "Intel UHD Graphics 610"
-                  case 0x3E91: // "Intel UHD Graphics 630"
-                  case 0x3E92: // "Intel UHD Graphics 630"
-                  case 0x3E98: // "Intel UHD Graphics 630"
-                  case 0x3E9B: // "Intel UHD Graphics 630"
-                  case 0x3EA5: // "Intel Iris Plus Graphics 655"
-                  case 0x3EA0: // "Intel UHD Graphics 620"
-                  case 0x9B41: // "Intel UHD Graphics 620"
-                  case 0x9BCA: // "Intel UHD Graphics 620"
+                      break;
+                  }
+                } else {
+                  switch (Pci.Hdr.DeviceId) {
+                    case 0x1606:
+                    case 0x160E:
+                    case 0x1616:
+                    case 0x161E:
+                    case 0x1622:
+                      FBLEVX = 0x1499;
+                      break;
+                    case 0x1626:
+                      FBLEVX = 0x0AD9;
+                      break;
+                    case 0x1612:
+                      FBLEVX = 0x07A1;
+                      break;
+                    default:
+                      FBLEVX = 0x056C;
+                      break;
+                  }
+                }
+                break;
+
+              case 0x1902: // "Intel HD Graphics 510"
+              case 0x1906: // "Intel HD Graphics 510"
+              case 0x190B: // "Intel HD Graphics 510"
+              case 0x1912: // "Intel HD Graphics 530"
+              case 0x1916: // "Intel HD Graphics 520"
+              case 0x191B: // "Intel HD Graphics 530"
+              case 0x191D: // "Intel HD Graphics P530"
+              case 0x191E: // "Intel HD Graphics 515"
+              case 0x1921: // "Intel HD Graphics 520"
+              case 0x1923: // "Intel HD Graphics 535"
+              case 0x1926: // "Intel Iris Graphics 540"
+              case 0x1927: // "Intel Iris Graphics 550"
+              case 0x192B: // "Intel Iris Graphics 555"
+              case 0x192D: // "Intel Iris Graphics P555"
+              case 0x1932: // "Intel Iris Pro Graphics 580"
+              case 0x193A: // "Intel Iris Pro Graphics P580"
+              case 0x193B: // "Intel Iris Pro Graphics 580"
+              case 0x193D: // "Intel Iris Pro Graphics P580"
+                if (gSettings.IgPlatform) {
+                  switch (gSettings.IgPlatform) {
+                    case (UINT32)0x19120001:
                     FBLEVX = 0xFFFF;
                     break;
-
                   default:
-                    FBLEVX = 0xFFFF;
+                    FBLEVX = 0x056C;
                     break;
+                  }
+                } else {
+                  FBLEVX = 0x056C;
                 }
+                break;
+
+              case 0x5902: // "Intel HD Graphics 610"
+              case 0x5906: // "Intel HD Graphics 610"
+              case 0x5912: // "Intel HD Graphics 630"
+              case 0x5916: // "Intel HD Graphics 620"
+              case 0x591A: // "Intel HD Graphics P630"
+              case 0x591B: // "Intel HD Graphics 630"
+              case 0x591D: // "Intel HD Graphics P630"
+              case 0x591E: // "Intel HD Graphics 615"
+              case 0x5923: // "Intel HD Graphics 635"
+              case 0x5926: // "Intel Iris Plus Graphics 640"
+              case 0x5927: // "Intel Iris Plus Graphics 650"
+              case 0x5917: // "Intel UHD Graphics 620"
+              case 0x591C: // "Intel UHD Graphics 615"
+              case 0x87C0: // "Intel UHD Graphics 617"
+              case 0x87CA: // "Intel UHD Graphics 615"
+                FBLEVX = 0x056C;
+                break;
+
+              case 0x3E90: // "Intel UHD Graphics 610"
+              case 0x3E93: // "Intel UHD Graphics 610"
+              case 0x3E91: // "Intel UHD Graphics 630"
+              case 0x3E92: // "Intel UHD Graphics 630"
+              case 0x3E98: // "Intel UHD Graphics 630"
+              case 0x3E9B: // "Intel UHD Graphics 630"
+              case 0x3EA5: // "Intel Iris Plus Graphics 655"
+              case 0x3EA0: // "Intel UHD Graphics 620"
+              case 0x9B41: // "Intel UHD Graphics 620"
+              case 0x9BCA: // "Intel UHD Graphics 620"
+                FBLEVX = 0xFFFF;
+                break;
+
+              default:
+                FBLEVX = 0xFFFF;
+                break;
+            }
+
+            // Write LEVW
+            if (LEVW != SYSLEVW) {
+              MsgLog ("  Found invalid LEVW, set System LEVW: 0x%X\n", SYSLEVW);
+              /*Status = */PciIo->Mem.Write(
+                                            PciIo,
+                                            EfiPciIoWidthUint32,
+                                            0,
+                                            0xC8250,
+                                            1,
+                                            &SYSLEVW
+                                            );
+            }
+
+            switch (gCPUStructure.Model) {
+              case CPU_MODEL_SANDY_BRIDGE:
+              case CPU_MODEL_IVY_BRIDGE:
+              case CPU_MODEL_IVY_BRIDGE_E5:
+                // if change SYS LEVW to macOS LEVW, the brightness of the pop-up may decrease or increase.
+                // but the brightness of the monitor will not actually change. so we should not use this.
+                MsgLog ("  Skip writing macOS LEVW: 0x%X\n", MACLEVW);
+                break;
+
+              case CPU_MODEL_HASWELL:
+              case CPU_MODEL_HASWELL_ULT:
+              case CPU_MODEL_HASWELL_U5:    // Broadwell
+              case CPU_MODEL_BROADWELL_HQ:
+              case CPU_MODEL_BROADWELL_E5:
+              case CPU_MODEL_BROADWELL_DE:
+                // if not change SYS LEVW to macOS LEVW, backlight will be dark and don't work keys for backlight.
+                // so we should use this.
+                MsgLog ("  Write macOS LEVW: 0x%X\n", MACLEVW);
+
+                /*Status = */PciIo->Mem.Write(
+                                              PciIo,
+                                              EfiPciIoWidthUint32,
+                                              0,
+                                              0xC8250,
+                                              1,
+                                              &MACLEVW
+                                              );
+                break;
+
+              default:
+                if (gSettings.IntelBacklight) {
+                  MsgLog ("  Write macOS LEVW: 0x%X\n", MACLEVW);
 
-                // Write LEVW
-                if (LEVW != SYSLEVW) {
-                  MsgLog ("  Found invalid LEVW, set System LEVW: 0x%X\n", SYSLEVW);
                   /*Status = */PciIo->Mem.Write(
                                                 PciIo,
                                                 EfiPciIoWidthUint32,
                                                 0,
                                                 0xC8250,
                                                 1,
-                                                &SYSLEVW
+                                                &MACLEVW
                                                 );
                 }
+                break;
+            }
 
-                switch (gCPUStructure.Model) {
-                  case CPU_MODEL_SANDY_BRIDGE:
-                  case CPU_MODEL_IVY_BRIDGE:
-                  case CPU_MODEL_IVY_BRIDGE_E5:
-                    // if change SYS LEVW to macOS LEVW, the brightness of the pop-up may decrease or increase.
-                    // but the brightness of the monitor will not actually change. so we should not use this.
-                    MsgLog ("  Skip writing macOS LEVW: 0x%X\n", MACLEVW);
-                    break;
-
-                  case CPU_MODEL_HASWELL:
-                  case CPU_MODEL_HASWELL_ULT:
-                  case CPU_MODEL_HASWELL_U5:    // Broadwell
-                  case CPU_MODEL_BROADWELL_HQ:
-                  case CPU_MODEL_BROADWELL_E5:
-                  case CPU_MODEL_BROADWELL_DE:
-                    // if not change SYS LEVW to macOS LEVW, backlight will be dark and don't work keys for backlight.
-                    // so we should use this.
-                    MsgLog ("  Write macOS LEVW: 0x%X\n", MACLEVW);
-
-                    /*Status = */PciIo->Mem.Write(
-                                                  PciIo,
-                                                  EfiPciIoWidthUint32,
-                                                  0,
-                                                  0xC8250,
-                                                  1,
-                                                  &MACLEVW
-                                                  );
-                    break;
-
-                  default:
-                    if (gSettings.IntelBacklight) {
-                      MsgLog ("  Write macOS LEVW: 0x%X\n", MACLEVW);
-
-                      /*Status = */PciIo->Mem.Write(
-                                                    PciIo,
-                                                    EfiPciIoWidthUint32,
-                                                    0,
-                                                    0xC8250,
-                                                    1,
-                                                    &MACLEVW
-                                                    );
-                    }
-                    break;
-                }
-
-                switch (Pci.Hdr.DeviceId) {
-                  case 0x0042: // "Intel HD Graphics"
-                  case 0x0046: // "Intel HD Graphics"
-                  case 0x0102: // "Intel HD Graphics 2000"
-                  case 0x0106: // "Intel HD Graphics 2000"
-                  case 0x010A: // "Intel HD Graphics P3000"
-                  case 0x0112: // "Intel HD Graphics 3000"
-                  case 0x0116: // "Intel HD Graphics 3000"
-                  case 0x0122: // "Intel HD Graphics 3000"
-                  case 0x0126: // "Intel HD Graphics 3000"
-                  case 0x0152: // "Intel HD Graphics 2500"
-                  case 0x0156: // "Intel HD Graphics 2500"
-                  case 0x015A: // "Intel HD Graphics 2500"
-                  case 0x0162: // "Intel HD Graphics 4000"
-                  case 0x0166: // "Intel HD Graphics 4000"
-                  case 0x016A: // "Intel HD Graphics P4000"
-                    // Write LEVL/LEVX
-                    if (gSettings.IntelMaxBacklight) {
-                      if (!LEVL) {
-                        LEVL = FBLEVX;
-                        MsgLog ("  Found invalid LEVL, set LEVL: 0x%X\n", LEVL);
-                      }
+            switch (Pci.Hdr.DeviceId) {
+              case 0x0042: // "Intel HD Graphics"
+              case 0x0046: // "Intel HD Graphics"
+              case 0x0102: // "Intel HD Graphics 2000"
+              case 0x0106: // "Intel HD Graphics 2000"
+              case 0x010A: // "Intel HD Graphics P3000"
+              case 0x0112: // "Intel HD Graphics 3000"
+              case 0x0116: // "Intel HD Graphics 3000"
+              case 0x0122: // "Intel HD Graphics 3000"
+              case 0x0126: // "Intel HD Graphics 3000"
+              case 0x0152: // "Intel HD Graphics 2500"
+              case 0x0156: // "Intel HD Graphics 2500"
+              case 0x015A: // "Intel HD Graphics 2500"
+              case 0x0162: // "Intel HD Graphics 4000"
+              case 0x0166: // "Intel HD Graphics 4000"
+              case 0x016A: // "Intel HD Graphics P4000"
+                // Write LEVL/LEVX
+                if (gSettings.IntelMaxBacklight) {
+                  if (!LEVL) {
+                    LEVL = FBLEVX;
+                    MsgLog ("  Found invalid LEVL, set LEVL: 0x%X\n", LEVL);
+                  }
 
-                      if (!LEVX) {
-                        ShiftLEVX = FBLEVX;
-                        MsgLog ("  Found invalid LEVX, set LEVX: 0x%X\n", ShiftLEVX);
-                      }
+                  if (!LEVX) {
+                    ShiftLEVX = FBLEVX;
+                    MsgLog ("  Found invalid LEVX, set LEVX: 0x%X\n", ShiftLEVX);
+                  }
 
-                      if (gSettings.IntelMaxValue) {
-                        FBLEVX = gSettings.IntelMaxValue;
-                        MsgLog ("  Read IntelMaxValue: 0x%X\n", FBLEVX);
-                      } else {
-                        MsgLog ("  Read default Framebuffer LEVX: 0x%X\n", FBLEVX);
-                      }
+                  if (gSettings.IntelMaxValue) {
+                    FBLEVX = gSettings.IntelMaxValue;
+                    MsgLog ("  Read IntelMaxValue: 0x%X\n", FBLEVX);
+                  } else {
+                    MsgLog ("  Read default Framebuffer LEVX: 0x%X\n", FBLEVX);
+                  }
 
-                      LEVL = (LEVL * FBLEVX) / ShiftLEVX;
-                      MsgLog ("  Write new LEVL: 0x%X\n", LEVL);
-
-                      /*Status = */PciIo->Mem.Write(
-                                                    PciIo,
-                                                    EfiPciIoWidthUint32,
-                                                    0,
-                                                    0x48254,
-                                                    1,
-                                                    &LEVL
-                                                    );
-
-                      LEVX = FBLEVX | FBLEVX << 16;
-                      MsgLog ("  Write new LEVX: 0x%X\n", LEVX);
-
-                      /*Status = */PciIo->Mem.Write(
-                                                    PciIo,
-                                                    EfiPciIoWidthUint32,
-                                                    0,
-                                                    0xC8254,
-                                                    1,
-                                                    &LEVX
-                                                    );
-                    }
-                    break;
+                  LEVL = (LEVL * FBLEVX) / ShiftLEVX;
+                  MsgLog ("  Write new LEVL: 0x%X\n", LEVL);
 
-                  case 0x3E90: // "Intel UHD Graphics 610"
-                  case 0x3E93: // "Intel UHD Graphics 610"
-                  case 0x3E91: // "Intel UHD Graphics 630"
-                  case 0x3E92: // "Intel UHD Graphics 630"
-                  case 0x3E98: // "Intel UHD Graphics 630"
-                  case 0x3E9B: // "Intel UHD Graphics 630"
-                  case 0x3EA5: // "Intel Iris Plus Graphics 655"
-                  case 0x3EA0: // "Intel UHD Graphics 620"
-                  case 0x9B41: // "Intel UHD Graphics 620"
-                  case 0x9BCA: // "Intel UHD Graphics 620"
-                    // Write LEVD
-                    if (gSettings.IntelMaxBacklight) {
-                      if (gSettings.IntelMaxValue) {
-                        FBLEVX = gSettings.IntelMaxValue;
-                        MsgLog ("  Read IntelMaxValue: 0x%X\n", FBLEVX);
-                      } else {
-                        MsgLog ("  Read default Framebuffer LEVX: 0x%X\n", FBLEVX);
-                      }
+                  /*Status = */PciIo->Mem.Write(
+                                                PciIo,
+                                                EfiPciIoWidthUint32,
+                                                0,
+                                                0x48254,
+                                                1,
+                                                &LEVL
+                                                );
 
-                      LEVD = (UINT32)DivU64x32(MultU64x32(FBLEVX, LEVX), 0xFFFF);
-                      MsgLog ("  Write new LEVD: 0x%X\n", LEVD);
-
-                      /*Status = */PciIo->Mem.Write(
-                                                    PciIo,
-                                                    EfiPciIoWidthUint32,
-                                                    0,
-                                                    0xC8258,
-                                                    1,
-                                                    &LEVD
-                                                    );
-                    }
-                    break;
+                  LEVX = FBLEVX | FBLEVX << 16;
+                  MsgLog ("  Write new LEVX: 0x%X\n", LEVX);
 
-                  default:
-                    // Write LEVX
-                    if (gSettings.IntelMaxBacklight) {
-                      if (gSettings.IntelMaxValue) {
-                        FBLEVX = gSettings.IntelMaxValue;
-                        MsgLog ("  Read IntelMaxValue: 0x%X\n", FBLEVX);
-                        LEVX = FBLEVX | FBLEVX << 16;
-                      } else if (!LEVX) {
-                        MsgLog ("  Found invalid LEVX, set LEVX: 0x%X\n", FBLEVX);
-                        LEVX = FBLEVX | FBLEVX << 16;
-                      } else if (ShiftLEVX != FBLEVX) {
-                        MsgLog ("  Read default Framebuffer LEVX: 0x%X\n", FBLEVX);
-                        LEVX = (((LEVX & 0xFFFF) * FBLEVX / ShiftLEVX) | FBLEVX << 16);
-                      }
+                  /*Status = */PciIo->Mem.Write(
+                                                PciIo,
+                                                EfiPciIoWidthUint32,
+                                                0,
+                                                0xC8254,
+                                                1,
+                                                &LEVX
+                                                );
+                }
+                break;
+
+              case 0x3E90: // "Intel UHD Graphics 610"
+              case 0x3E93: // "Intel UHD Graphics 610"
+              case 0x3E91: // "Intel UHD Graphics 630"
+              case 0x3E92: // "Intel UHD Graphics 630"
+              case 0x3E98: // "Intel UHD Graphics 630"
+              case 0x3E9B: // "Intel UHD Graphics 630"
+              case 0x3EA5: // "Intel Iris Plus Graphics 655"
+              case 0x3EA0: // "Intel UHD Graphics 620"
+              case 0x9B41: // "Intel UHD Graphics 620"
+              case 0x9BCA: // "Intel UHD Graphics 620"
+                // Write LEVD
+                if (gSettings.IntelMaxBacklight) {
+                  if (gSettings.IntelMaxValue) {
+                    FBLEVX = gSettings.IntelMaxValue;
+                    MsgLog ("  Read IntelMaxValue: 0x%X\n", FBLEVX);
+                  } else {
+                    MsgLog ("  Read default Framebuffer LEVX: 0x%X\n", FBLEVX);
+                  }
 
-                      MsgLog ("  Write new LEVX: 0x%X\n", LEVX);
+                  LEVD = (UINT32)DivU64x32(MultU64x32(FBLEVX, LEVX), 0xFFFF);
+                  MsgLog ("  Write new LEVD: 0x%X\n", LEVD);
 
-                      /*Status = */PciIo->Mem.Write(
-                                                    PciIo,
-                                                    EfiPciIoWidthUint32,
-                                                    0,
-                                                    0xC8254,
-                                                    1,
-                                                    &LEVX
-                                                    );
-                    }
-                    break;
+                  /*Status = */PciIo->Mem.Write(
+                                                PciIo,
+                                                EfiPciIoWidthUint32,
+                                                0,
+                                                0xC8258,
+                                                1,
+                                                &LEVD
+                                                );
                 }
+                break;
+
+              default:
+                // Write LEVX
+                if (gSettings.IntelMaxBacklight) {
+                  if (gSettings.IntelMaxValue) {
+                    FBLEVX = gSettings.IntelMaxValue;
+                    MsgLog ("  Read IntelMaxValue: 0x%X\n", FBLEVX);
+                    LEVX = FBLEVX | FBLEVX << 16;
+                  } else if (!LEVX) {
+                    MsgLog ("  Found invalid LEVX, set LEVX: 0x%X\n", FBLEVX);
+                    LEVX = FBLEVX | FBLEVX << 16;
+                  } else if (ShiftLEVX != FBLEVX) {
+                    MsgLog ("  Read default Framebuffer LEVX: 0x%X\n", FBLEVX);
+                    LEVX = (((LEVX & 0xFFFF) * FBLEVX / ShiftLEVX) | FBLEVX << 16);
+                  }
 
-                if (gSettings.FakeIntel == 0x00008086) {
-                  UINT32 IntelDisable = 0x03;
-                  PciIo->Pci.Write (PciIo, EfiPciIoWidthUint32, 0x50, 1, &IntelDisable);
-                }
-              }
-              break;
+                  MsgLog ("  Write new LEVX: 0x%X\n", LEVX);
 
-            case 0x10de:
-              if (gSettings.InjectNVidia) {
-                TmpDirty    = setup_nvidia_devprop(&PCIdevice);
-                StringDirty |=  TmpDirty;
-              } else {
-                MsgLog ("NVidia GFX injection not set\n");
-              }
-              break;
+                  /*Status = */PciIo->Mem.Write(
+                                                PciIo,
+                                                EfiPciIoWidthUint32,
+                                                0,
+                                                0xC8254,
+                                                1,
+                                                &LEVX
+                                                );
+                }
+                break;
+            }
 
-            default:
-              break;
+            if (gSettings.FakeIntel == 0x00008086) {
+              UINT32 IntelDisable = 0x03;
+              PciIo->Pci.Write (PciIo, EfiPciIoWidthUint32, 0x50, 1, &IntelDisable);
+            }
           }
-        }
-
-        //LAN
-        else if ((Pci.Hdr.ClassCode[2] == PCI_CLASS_NETWORK) &&
-                 (Pci.Hdr.ClassCode[1] == PCI_CLASS_NETWORK_ETHERNET)) {
-          //MsgLog ("Ethernet device found\n");
-            TmpDirty = set_eth_props (&PCIdevice);
-            StringDirty |=  TmpDirty;
-        }
+          break;
 
-        //USB
-        else if ((Pci.Hdr.ClassCode[2] == PCI_CLASS_SERIAL) &&
-                 (Pci.Hdr.ClassCode[1] == PCI_CLASS_SERIAL_USB)) {
-          if (gSettings.USBInjection) {
-            TmpDirty = set_usb_props (&PCIdevice);
+        case 0x10de:
+          if (gSettings.InjectNVidia) {
+            TmpDirty    = setup_nvidia_devprop(&PCIdevice);
             StringDirty |=  TmpDirty;
+          } else {
+            MsgLog ("NVidia GFX injection not set\n");
           }
-        }
+          break;
 
-        // HDA
-        else if ((Pci.Hdr.ClassCode[2] == PCI_CLASS_MEDIA) &&
-                 ((Pci.Hdr.ClassCode[1] == PCI_CLASS_MEDIA_HDA) ||
-                  (Pci.Hdr.ClassCode[1] == PCI_CLASS_MEDIA_AUDIO))) {
-                   // HDMI injection inside
-          if (gSettings.HDAInjection ) {
-            TmpDirty    = setup_hda_devprop (PciIo, &PCIdevice, Entry->OSVersion);
-            StringDirty |= TmpDirty;
-          }
-          if (gSettings.ResetHDA) {
-            
-            //PCI_HDA_TCSEL_OFFSET = 0x44
-            UINT8 Value = 0;
-            Status = PciIo->Pci.Read (PciIo, EfiPciIoWidthUint8, 0x44, 1, &Value);
-            
-            if (EFI_ERROR(Status)) {
-              continue;
-            }
-            
-            Value &= 0xf8;
-            PciIo->Pci.Write (PciIo, EfiPciIoWidthUint8, 0x44, 1, &Value);
-          }
-        }
+        default:
+          break;
+      }
+    }
 
-        //LPC
-        else if ((Pci.Hdr.ClassCode[2] == PCI_CLASS_BRIDGE) &&
-                 (Pci.Hdr.ClassCode[1] == PCI_CLASS_BRIDGE_ISA))
-        {
-          if (gSettings.LpcTune) {
-            Status = PciIo->Pci.Read (PciIo, EfiPciIoWidthUint16, GEN_PMCON_1, 1, &PmCon);
-            MsgLog ("Initial PmCon value=%hX\n", PmCon);
+    //LAN
+    else if ((Pci.Hdr.ClassCode[2] == PCI_CLASS_NETWORK) &&
+             (Pci.Hdr.ClassCode[1] == PCI_CLASS_NETWORK_ETHERNET)) {
+      //MsgLog ("Ethernet device found\n");
+        TmpDirty = set_eth_props (&PCIdevice);
+        StringDirty |=  TmpDirty;
+    }
 
-            if (gSettings.EnableC6) {
-              PmCon |= 1 << 11;
-              DBG("C6 enabled\n");
-            } else {
-              PmCon &= ~(1 << 11);
-              DBG("C6 disabled\n");
-            }
-            /*
-             if (gSettings.EnableC2) {
-             PmCon |= 1 << 10;
-             DBG("BIOS_PCIE enabled\n");
-             } else {
-             PmCon &= ~(1 << 10);
-             DBG("BIOS_PCIE disabled\n");
-             }
-             */
-            if (gSettings.EnableC4) {
-              PmCon |= 1 << 7;
-              DBG("C4 enabled\n");
-            } else {
-              PmCon &= ~(1 << 7);
-              DBG("C4 disabled\n");
-            }
+    //USB
+    else if ((Pci.Hdr.ClassCode[2] == PCI_CLASS_SERIAL) &&
+             (Pci.Hdr.ClassCode[1] == PCI_CLASS_SERIAL_USB)) {
+      if (gSettings.USBInjection) {
+        TmpDirty = set_usb_props (&PCIdevice);
+        StringDirty |=  TmpDirty;
+      }
+    }
 
-            if (gSettings.EnableISS) {
-              PmCon |= 1 << 3;
-              DBG("SpeedStep enabled\n");
-            } else {
-              PmCon &= ~(1 << 3);
-              DBG("SpeedStep disabled\n");
-            }
+    // HDA
+    else if ((Pci.Hdr.ClassCode[2] == PCI_CLASS_MEDIA) &&
+             ((Pci.Hdr.ClassCode[1] == PCI_CLASS_MEDIA_HDA) ||
+              (Pci.Hdr.ClassCode[1] == PCI_CLASS_MEDIA_AUDIO))) {
+               // HDMI injection inside
+      if (gSettings.HDAInjection ) {
+        TmpDirty    = setup_hda_devprop (PciIo, &PCIdevice, Entry->OSVersion);
+        StringDirty |= TmpDirty;
+      }
+      if (gSettings.ResetHDA) {
+        
+        //PCI_HDA_TCSEL_OFFSET = 0x44
+        UINT8 Value = 0;
+        Status = PciIo->Pci.Read (PciIo, EfiPciIoWidthUint8, 0x44, 1, &Value);
+        
+        if (EFI_ERROR(Status)) {
+          continue;
+        }
+        
+        Value &= 0xf8;
+        PciIo->Pci.Write (PciIo, EfiPciIoWidthUint8, 0x44, 1, &Value);
+      }
+    }
 
-            PciIo->Pci.Write (PciIo, EfiPciIoWidthUint16, GEN_PMCON_1, 1, &PmCon);
+    //LPC
+    else if ((Pci.Hdr.ClassCode[2] == PCI_CLASS_BRIDGE) &&
+             (Pci.Hdr.ClassCode[1] == PCI_CLASS_BRIDGE_ISA))
+    {
+      if (gSettings.LpcTune) {
+        Status = PciIo->Pci.Read (PciIo, EfiPciIoWidthUint16, GEN_PMCON_1, 1, &PmCon);
+        MsgLog ("Initial PmCon value=%hX\n", PmCon);
 
-            Status = PciIo->Pci.Read (PciIo, EfiPciIoWidthUint16,GEN_PMCON_1, 1, &PmCon);
-            MsgLog ("Set PmCon value=%hX\n", PmCon);
+        if (gSettings.EnableC6) {
+          PmCon |= 1 << 11;
+          DBG("C6 enabled\n");
+        } else {
+          PmCon &= ~(1 << 11);
+          DBG("C6 disabled\n");
+        }
+        /*
+         if (gSettings.EnableC2) {
+         PmCon |= 1 << 10;
+         DBG("BIOS_PCIE enabled\n");
+         } else {
+         PmCon &= ~(1 << 10);
+         DBG("BIOS_PCIE disabled\n");
+         }
+         */
+        if (gSettings.EnableC4) {
+          PmCon |= 1 << 7;
+          DBG("C4 enabled\n");
+        } else {
+          PmCon &= ~(1 << 7);
+          DBG("C4 disabled\n");
+        }
 
-          }
-          Rcba   = 0;
-          /* Scan Port */
-          Status = PciIo->Pci.Read (PciIo, EfiPciIoWidthUint32, 0xF0, 1, &Rcba);
-          if (EFI_ERROR(Status)) continue;
-          //        Rcba &= 0xFFFFC000;
-          if ((Rcba & 0xFFFFC000) == 0) {
-            MsgLog (" RCBA disabled; cannot use it\n");
-            continue;
-          }
-          if ((Rcba & 1) == 0) {
-            MsgLog (" RCBA access disabled; trying to enable\n");
-            Rcba |= 1;
+        if (gSettings.EnableISS) {
+          PmCon |= 1 << 3;
+          DBG("SpeedStep enabled\n");
+        } else {
+          PmCon &= ~(1 << 3);
+          DBG("SpeedStep disabled\n");
+        }
 
-            PciIo->Pci.Write (PciIo, EfiPciIoWidthUint32, 0xF0, 1, &Rcba);
-          }
+        PciIo->Pci.Write (PciIo, EfiPciIoWidthUint16, GEN_PMCON_1, 1, &PmCon);
 
-          Rcba &= 0xFFFFC000;
-          if (gSettings.ForceHPET) {
-            Hptc = REG32 ((UINTN)Rcba, 0x3404);
-            if ((Hptc & 0x80) != 0) {
-              DBG("HPET is already enabled\n");
-            } else {
-              DBG("HPET is disabled, trying to enable...\n");
-              REG32 ((UINTN)Rcba, 0x3404) = Hptc | 0x80;
-            }
-            // Re-Check if HPET is enabled.
-            Hptc = REG32 ((UINTN)Rcba, 0x3404);
-            if ((Hptc & 0x80) == 0) {
-              DBG("HPET is disabled in HPTC. Cannot enable!\n");
-            } else {
-              DBG("HPET is enabled\n");
-            }
-          }
+        Status = PciIo->Pci.Read (PciIo, EfiPciIoWidthUint16,GEN_PMCON_1, 1, &PmCon);
+        MsgLog ("Set PmCon value=%hX\n", PmCon);
 
-          if (gSettings.DisableFunctions){
-            UINT32 FD = REG32 ((UINTN)Rcba, 0x3418);
-            DBG("Initial value of FD register 0x%X\n", FD);
-            FD |= gSettings.DisableFunctions;
-            REG32 ((UINTN)Rcba, 0x3418) = FD;
-            FD = REG32 ((UINTN)Rcba, 0x3418);
-            DBG(" recheck value after patch 0x%X\n", FD);
-          }
+      }
+      Rcba   = 0;
+      /* Scan Port */
+      Status = PciIo->Pci.Read (PciIo, EfiPciIoWidthUint32, 0xF0, 1, &Rcba);
+      if (EFI_ERROR(Status)) continue;
+      //        Rcba &= 0xFFFFC000;
+      if ((Rcba & 0xFFFFC000) == 0) {
+        MsgLog (" RCBA disabled; cannot use it\n");
+        continue;
+      }
+      if ((Rcba & 1) == 0) {
+        MsgLog (" RCBA access disabled; trying to enable\n");
+        Rcba |= 1;
+
+        PciIo->Pci.Write (PciIo, EfiPciIoWidthUint32, 0xF0, 1, &Rcba);
+      }
+
+      Rcba &= 0xFFFFC000;
+      if (gSettings.ForceHPET) {
+        Hptc = REG32 ((UINTN)Rcba, 0x3404);
+        if ((Hptc & 0x80) != 0) {
+          DBG("HPET is already enabled\n");
+        } else {
+          DBG("HPET is disabled, trying to enable...\n");
+          REG32 ((UINTN)Rcba, 0x3404) = Hptc | 0x80;
+        }
+        // Re-Check if HPET is enabled.
+        Hptc = REG32 ((UINTN)Rcba, 0x3404);
+        if ((Hptc & 0x80) == 0) {
+          DBG("HPET is disabled in HPTC. Cannot enable!\n");
+        } else {
+          DBG("HPET is enabled\n");
         }
       }
+
+      if (gSettings.DisableFunctions){
+        UINT32 FD = REG32 ((UINTN)Rcba, 0x3418);
+        DBG("Initial value of FD register 0x%X\n", FD);
+        FD |= gSettings.DisableFunctions;
+        REG32 ((UINTN)Rcba, 0x3418) = FD;
+        FD = REG32 ((UINTN)Rcba, 0x3418);
+        DBG(" recheck value after patch 0x%X\n", FD);
+      }
     }
   }
 
@@ -8023,30 +8440,24 @@ SetDevices (LOADER_ENTRY *Entry)
     DBG("stringlength = %d\n", device_inject_stringlength);
     // gDeviceProperties = (__typeof__(gDeviceProperties))AllocateAlignedPages EFI_SIZE_TO_PAGES (device_inject_stringlength + 1), 64);
 
+    // the binary blob is written in place, its size is known : no hex string in between
     Status = gBS->AllocatePages (
                                  AllocateMaxAddress,
                                  EfiACPIReclaimMemory,
-                                 EFI_SIZE_TO_PAGES ((UINTN)device_inject_stringlength + 1),
+                                 EFI_SIZE_TO_PAGES ((UINTN)device_inject_string->length),
                                  &BufferPtr
                                  );
 
     if (!EFI_ERROR(Status)) {
       mProperties       = (UINT8*)(UINTN)BufferPtr;
-      gDeviceProperties = devprop_generate_string (device_inject_string);
-      gDeviceProperties[device_inject_stringlength] = 0;
-      //     DBG(gDeviceProperties);
-      //     DBG("\n");
-      //     StringDirty = FALSE;
-      //-------
-      mPropSize = (UINT32)AsciiStrLen(gDeviceProperties) / 2;
-      //     DBG("Preliminary size of mProperties=%d\n", mPropSize);
-      mPropSize = hex2bin (gDeviceProperties, mProperties, mPropSize);
-      //     DBG("Final size of mProperties=%d\n", mPropSize);
+      mPropSize         = devprop_serialize (device_inject_string, mProperties, device_inject_string->length);
+      DBG("size of mProperties=%d\n", mPropSize);
       //---------
       //      Status = egSaveFile(&self.getSelfRootDir(),  SWPrintf("%ls\\misc\\devprop.bin", self.getCloverDirFullPath().wc_str()).wc_str()    , (UINT8*)mProperties, mPropSize);
       //and now we can free memory?
       if (gSettings.AddProperties) {
         FreePool(gSettings.AddProperties);
+        gSettings.AddProperties = NULL;
       }
       if (gSettings.ArbProperties) {
         DEV_PROPERTY *Props;
@@ -8088,7 +8499,9 @@ SetDevices (LOADER_ENTRY *Entry)
           FreePool(Prop);
           Prop = Next;
         }
+        gSettings.ArbProperties = NULL;
       }
+      IndexDevProperties();
     }
   }
 
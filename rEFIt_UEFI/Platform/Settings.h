@@ -8,6 +8,7 @@
 #include "../Platform/plist/plist.h"
 #include "../Platform/guid.h"
 #include "MacOsVersion.h"
+#include "Checksum.h"
 
 //// SysVariables
 //typedef struct SYSVARIABLES SYSVARIABLES;
@@ -759,6 +760,7 @@ extern XStringWArray ThemeNameArray;
 extern CHAR16*       ConfigsList[20];
 extern CHAR16*       DsdtsList[20];
 extern UINTN DsdtsNum;
+extern UINT32 gConfigCrc32;
 extern UINTN ConfigsNum;
 //extern INTN    ScrollButtonsHeight;
 //extern INTN    ScrollBarDecorationsHeight;
@@ -839,6 +841,9 @@ public:
   BOOLEAN     LegacyFirst;
   BOOLEAN     NoLegacy;
   BOOLEAN     DebugLog;
+  UINTN       DebugLogBuffer;      // bytes kept before writing debug log, 0 - write every message
+  UINTN       DebugLogPreallocate; // debug log file size made at creation, 0 - grow at every write
+  INTN        DebugLogLevel;       // messages with a lower DebugMode are not formatted, 0 - keep all
   BOOLEAN     FastBoot;
   BOOLEAN     NeverHibernate;
   BOOLEAN     StrictHibernate;
@@ -851,6 +856,23 @@ public:
   BOOLEAN     CustomIcons;
   INTN        IconFormat;
   BOOLEAN     NoEarlyProgress;
+  BOOLEAN     VolumeCache;         // reuse boot sector detection of unchanged disks from misc\VolumeCache.bin
+  BOOLEAN     KextCache;           // reuse images of unchanged force kexts from misc\KextCache.bin
+  BOOLEAN     IconCache;           // reuse rasterized icons of an unchanged vector theme from misc\IconCache.bin
+  BOOLEAN     ParallelRasterize;   // rasterize the icons of a vector theme on all processors
+  BOOLEAN     DsdtCache;           // reuse the FixBiosDsdt() result of an unchanged DSDT and config from misc\DsdtCache.bin
+  BOOLEAN     PmSsdtCache;         // reuse the P-States and C-States SSDTs generated for the same CPU and config from misc\PmSsdtCache.bin
+  BOOLEAN     SpdCache;            // reuse the SPD of unchanged memory modules from misc\SpdCache.bin
+  BOOLEAN     VBiosCache;          // reuse what the NVidia injector reads in an unchanged VBIOS from misc\VBiosCache.bin
+  BOOLEAN     GopModeCache;        // reuse the best GOP mode found for the same display, kept in nvram
+  BOOLEAN     SleepImageCache;     // check the sleepimage at the disk offset found at a previous boot, kept in nvram
+  BOOLEAN     DeferConnect;        // connect network and other controllers the menu doesn't need while it is shown
+  BOOLEAN     LazyConnect;         // DeferConnect, and also the disks that are not the boot volume
+  BOOLEAN     IncrementalRescan;   // a menu refresh rescans only the volumes that changed
+  BOOLEAN     LazyEntryInfo;       // macOS entries get their volume label, icon and version while the menu is shown
+  BOOLEAN     OSVersionCache;      // reuse the macOS version of an unchanged SystemVersion.plist from misc\OSVersionCache.bin
+  BOOLEAN     FatDelayedFlush;     // the FAT driver commits metadata on a timer, Clover flushes the volumes before boot and reset
+  BOOLEAN     FramebufferWriteCombine; // the GOP framebuffer is write-combining while Clover runs, restored before boot
   INT32       Timezone;
   BOOLEAN     ShowOptimus;
   INTN        Codepage;
@@ -865,6 +887,9 @@ public:
    *   FALSE,          // BOOLEAN     LegacyFirst;
    *   FALSE,          // BOOLEAN     NoLegacy;
    *   FALSE,          // BOOLEAN     DebugLog;
+   *   0,              // UINTN       DebugLogBuffer;
+   *   0,              // UINTN       DebugLogPreallocate;
+   *   0,              // INTN        DebugLogLevel;
    *   FALSE,          // BOOLEAN     FastBoot;
    *   FALSE,          // BOOLEAN     NeverHibernate;
    *   FALSE,          // BOOLEAN     StrictHibernate;
@@ -877,6 +902,23 @@ public:
    *   FALSE,          // BOOLEAN     CustomIcons;
    *   ICON_FORMAT_DEF, // INTN       IconFormat;
    *   FALSE,          // BOOLEAN     NoEarlyProgress;
+   *   FALSE,          // BOOLEAN     VolumeCache;
+   *   FALSE,          // BOOLEAN     KextCache;
+   *   FALSE,          // BOOLEAN     IconCache;
+   *   FALSE,          // BOOLEAN     ParallelRasterize;
+   *   FALSE,          // BOOLEAN     DsdtCache;
+   *   FALSE,          // BOOLEAN     PmSsdtCache;
+   *   FALSE,          // BOOLEAN     SpdCache;
+   *   FALSE,          // BOOLEAN     VBiosCache;
+   *   FALSE,          // BOOLEAN     GopModeCache;
+   *   FALSE,          // BOOLEAN     SleepImageCache;
+   *   FALSE,          // BOOLEAN     DeferConnect;
+   *   FALSE,          // BOOLEAN     LazyConnect;
+   *   FALSE,          // BOOLEAN     IncrementalRescan;
+   *   FALSE,          // BOOLEAN     LazyEntryInfo;
+   *   FALSE,          // BOOLEAN     OSVersionCache;
+   *   FALSE,          // BOOLEAN     FatDelayedFlush;
+   *   FALSE,          // BOOLEAN     FramebufferWriteCombine;
    *   0xFF,           // INT32       Timezone; / 0xFF - not set
    *   FALSE,          // BOOLEAN     ShowOptimus;
    *   0xC0,           // INTN        Codepage;
@@ -885,8 +927,8 @@ public:
    *
    */
   REFIT_CONFIG() : Timeout(-1), DisableFlags(0), TextOnly(FALSE), Quiet(TRUE), LegacyFirst(FALSE), NoLegacy(FALSE),
-                   DebugLog(FALSE), FastBoot(FALSE), NeverHibernate(FALSE), StrictHibernate(FALSE),
-                   RtcHibernateAware(FALSE), HibernationFixup(FALSE), SignatureFixup(FALSE), Theme(), ScreenResolution(), ConsoleMode(0), CustomIcons(FALSE), IconFormat(ICON_FORMAT_DEF), NoEarlyProgress(FALSE), Timezone(0xFF),
+                   DebugLog(FALSE), DebugLogBuffer(0), DebugLogPreallocate(0), DebugLogLevel(0), FastBoot(FALSE), NeverHibernate(FALSE), StrictHibernate(FALSE),
+                   RtcHibernateAware(FALSE), HibernationFixup(FALSE), SignatureFixup(FALSE), Theme(), ScreenResolution(), ConsoleMode(0), CustomIcons(FALSE), IconFormat(ICON_FORMAT_DEF), NoEarlyProgress(FALSE), VolumeCache(FALSE), KextCache(FALSE), IconCache(FALSE), ParallelRasterize(FALSE), DsdtCache(FALSE), PmSsdtCache(FALSE), SpdCache(FALSE), VBiosCache(FALSE), GopModeCache(FALSE), SleepImageCache(FALSE), DeferConnect(FALSE), LazyConnect(FALSE), IncrementalRescan(FALSE), LazyEntryInfo(FALSE), OSVersionCache(FALSE), FatDelayedFlush(FALSE), FramebufferWriteCombine(FALSE), Timezone(0xFF),
                    ShowOptimus(FALSE), Codepage(0xC0), CodepageSize(0xC0) {};
   REFIT_CONFIG(const REFIT_CONFIG& other) = delete; // Can be defined if needed
   const REFIT_CONFIG& operator = ( const REFIT_CONFIG & ) = delete; // Can be defined if needed
@@ -919,24 +961,30 @@ GetOSVersion (
   IN  LOADER_ENTRY *Entry
   );
 
+void OSVersionCacheSave(void);
+BOOLEAN ReadSystemVersion(IN REFIT_VOLUME *Volume, IN CONST XStringW& File, IN OUT XString8& OSVersion, IN OUT XString8& BuildVersion);
+
 
 void GetListOfThemes(void);
 void GetListOfConfigs(void);
-void GetListOfACPI(void);
-void GetListOfDsdts(void);
+XStringWArray GetListOfPatchedAml(void);
+void GetListOfACPI(const XStringWArray& AmlNames);
+void GetListOfDsdts(const XStringWArray& AmlNames);
 
 // syscl - get list of inject kext(s)
 void GetListOfInjectKext(CHAR16 *);
 
-UINT32
-GetCrc32 (
-  UINT8 *Buffer,
-  UINTN Size
-  );
 
 void
 GetDevices(void);
 
+// AddProperties and arbitrary properties indexed by GetUserSettings
+void IndexDevProperties(void);
+// AddProperties of one DEV_xxx type in config order, chained through Next
+DEV_PROPERTY *GetAddProperties(UINT32 Device);
+// arbitrary properties set for a PCI address (PCIADDR), Count of them
+DEV_PROPERTY **GetArbProperties(UINT32 PciAddr, UINTN *Count);
+
 
 CONST XStringW
 GetOSIconName (
@@ -0,0 +1,208 @@
+/*
+ * Sha1.c
+ *
+ * FIPS 180-4 SHA-1. Plain C, built by Protocols/HashServiceFix. Sha1BlocksShaNi() keeps A..D reversed in one
+ * vector and E in the top lane of another, the layout sha1rnds4 wants, and does 4 rounds per message vector.
+ * Vector extensions and builtins instead of <immintrin.h>, like Sha256.c.
+ */
+
+#include "Sha1.h"
+
+#include <Library/BaseMemoryLib.h>
+
+// __builtin_shufflevector appeared in GCC 12, clang always had it
+#if defined(__x86_64__) && defined(__GNUC__) && (defined(__clang__) || __GNUC__ >= 12)
+#define SHA1_SHA_NI 1
+typedef UINT32 SHA1_V4U __attribute__((vector_size(16)));
+typedef int    SHA1_V4I __attribute__((vector_size(16)));
+typedef UINT8  SHA1_V16 __attribute__((vector_size(16)));
+typedef UINT8  SHA1_V16_UNALIGNED __attribute__((vector_size(16), aligned(1)));
+typedef UINT32 SHA1_V4U_UNALIGNED __attribute__((vector_size(16), aligned(4)));
+#else
+#define SHA1_SHA_NI 0
+#endif
+
+static BOOLEAN Sha1ShaNi = FALSE;
+
+void Sha1SetShaNi(BOOLEAN Enable)
+{
+  Sha1ShaNi = Enable && SHA1_SHA_NI;
+}
+
+BOOLEAN Sha1GetShaNi(void)
+{
+  return Sha1ShaNi;
+}
+
+static UINT32 Rol32(UINT32 Value, UINTN Count)
+{
+  return (Value << Count) | (Value >> (32 - Count));
+}
+
+static UINT32 LoadBe32(const UINT8 *Ptr)
+{
+  return ((UINT32)Ptr[0] << 24) | ((UINT32)Ptr[1] << 16) | ((UINT32)Ptr[2] << 8) | Ptr[3];
+}
+
+static void Sha1BlocksC(UINT32 *State, const UINT8 *Data, UINTN Count)
+{
+  UINT32 W[80];
+  UINT32 A, B, C, D, E, F, K, T;
+  UINTN  i;
+
+  while (Count--) {
+    for (i = 0; i < 16; i++) {
+      W[i] = LoadBe32(Data + i * 4);
+    }
+    for (i = 16; i < 80; i++) {
+      W[i] = Rol32(W[i - 3] ^ W[i - 8] ^ W[i - 14] ^ W[i - 16], 1);
+    }
+    A = State[0]; B = State[1]; C = State[2]; D = State[3]; E = State[4];
+    for (i = 0; i < 80; i++) {
+      if (i < 20) {
+        F = (B & C) | (~B & D);
+        K = 0x5a827999;
+      } else if (i < 40) {
+        F = B ^ C ^ D;
+        K = 0x6ed9eba1;
+      } else if (i < 60) {
+        F = (B & C) | (B & D) | (C & D);
+        K = 0x8f1bbcdc;
+      } else {
+        F = B ^ C ^ D;
+        K = 0xca62c1d6;
+      }
+      T = Rol32(A, 5) + F + E + K + W[i];
+      E = D; D = C; C = Rol32(B, 30); B = A; A = T;
+    }
+    State[0] += A; State[1] += B; State[2] += C; State[3] += D; State[4] += E;
+    Data += SHA1_BLOCK_SIZE;
+  }
+}
+
+#if SHA1_SHA_NI == 1
+// the round function selector of sha1rnds4 is an immediate
+#define SHA1_RNDS4(Abcd, E, Group)                                                        \
+  ((Group) < 5  ? (SHA1_V4U)__builtin_ia32_sha1rnds4((SHA1_V4I)(Abcd), (SHA1_V4I)(E), 0) : \
+   (Group) < 10 ? (SHA1_V4U)__builtin_ia32_sha1rnds4((SHA1_V4I)(Abcd), (SHA1_V4I)(E), 1) : \
+   (Group) < 15 ? (SHA1_V4U)__builtin_ia32_sha1rnds4((SHA1_V4I)(Abcd), (SHA1_V4I)(E), 2) : \
+                  (SHA1_V4U)__builtin_ia32_sha1rnds4((SHA1_V4I)(Abcd), (SHA1_V4I)(E), 3))
+
+__attribute__((target("sha,sse4.1")))
+static void Sha1BlocksShaNi(UINT32 *State, const UINT8 *Data, UINTN Count)
+{
+  SHA1_V4U Abcd = *(const SHA1_V4U_UNALIGNED *)State;
+  SHA1_V4U E0 = { 0, 0, 0, State[4] };
+  SHA1_V4U AbcdSave, E0Save, E1, Msg, W[4];
+  SHA1_V16 Bytes;
+  UINTN    i;
+
+  Abcd = __builtin_shufflevector(Abcd, Abcd, 3, 2, 1, 0);
+  while (Count--) {
+    AbcdSave = Abcd;
+    E0Save = E0;
+    for (i = 0; i < 20; i++) {
+      if (i < 4) {
+        // big endian words, W[t] in the top lane
+        Bytes = *(const SHA1_V16_UNALIGNED *)(Data + i * 16);
+        W[i] = (SHA1_V4U)__builtin_shufflevector(Bytes, Bytes, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+      } else {
+        // W[i] from W[i - 4] .. W[i - 1], the ring slot of W[i - 4] is reused
+        Msg = (SHA1_V4U)__builtin_ia32_sha1msg1((SHA1_V4I)W[i & 3], (SHA1_V4I)W[(i + 1) & 3]) ^ W[(i + 2) & 3];
+        W[i & 3] = (SHA1_V4U)__builtin_ia32_sha1msg2((SHA1_V4I)Msg, (SHA1_V4I)W[(i + 3) & 3]);
+      }
+      // E of these 4 rounds is A rotated from 4 rounds before, sha1nexte adds it to the message
+      if (i == 0) {
+        Msg = E0 + W[0];
+      } else {
+        Msg = (SHA1_V4U)__builtin_ia32_sha1nexte((SHA1_V4I)E1, (SHA1_V4I)W[i & 3]);
+      }
+      E1 = Abcd;
+      Abcd = SHA1_RNDS4(Abcd, Msg, i);
+    }
+    E0 = (SHA1_V4U)__builtin_ia32_sha1nexte((SHA1_V4I)E1, (SHA1_V4I)E0Save);
+    Abcd += AbcdSave;
+    Data += SHA1_BLOCK_SIZE;
+  }
+  *(SHA1_V4U_UNALIGNED *)State = __builtin_shufflevector(Abcd, Abcd, 3, 2, 1, 0);
+  State[4] = E0[3];
+}
+#endif
+
+static void Sha1Blocks(UINT32 *State, const UINT8 *Data, UINTN Count)
+{
+#if SHA1_SHA_NI == 1
+  if (Sha1ShaNi) {
+    Sha1BlocksShaNi(State, Data, Count);
+    return;
+  }
+#endif
+  Sha1BlocksC(State, Data, Count);
+}
+
+void Sha1Init(SHA1_CONTEXT *Context)
+{
+  Context->State[0] = 0x67452301;
+  Context->State[1] = 0xefcdab89;
+  Context->State[2] = 0x98badcfe;
+  Context->State[3] = 0x10325476;
+  Context->State[4] = 0xc3d2e1f0;
+  Context->Length = 0;
+  Context->BlockLength = 0;
+}
+
+void Sha1Update(SHA1_CONTEXT *Context, const void *Data, UINTN Size)
+{
+  const UINT8 *Ptr = (const UINT8 *)Data;
+  UINTN        Part;
+
+  Context->Length += Size;
+  if (Context->BlockLength != 0) {
+    Part = SHA1_BLOCK_SIZE - Context->BlockLength;
+    if (Part > Size) {
+      Part = Size;
+    }
+    CopyMem(Context->Block + Context->BlockLength, Ptr, Part);
+    Context->BlockLength += Part;
+    Ptr += Part;
+    Size -= Part;
+    if (Context->BlockLength < SHA1_BLOCK_SIZE) {
+      return;
+    }
+    Sha1Blocks(Context->State, Context->Block, 1);
+    Context->BlockLength = 0;
+  }
+  if (Size >= SHA1_BLOCK_SIZE) {
+    Sha1Blocks(Context->State, Ptr, Size / SHA1_BLOCK_SIZE);
+    Ptr += Size & ~(UINTN)(SHA1_BLOCK_SIZE - 1);
+    Size &= SHA1_BLOCK_SIZE - 1;
+  }
+  if (Size != 0) {
+    CopyMem(Context->Block, Ptr, Size);
+    Context->BlockLength = Size;
+  }
+}
+
+void Sha1Final(SHA1_CONTEXT *Context, UINT8 Digest[SHA1_DIGEST_SIZE])
+{
+  UINT64 Bits = Context->Length * 8;
+  UINTN  i;
+
+  Context->Block[Context->BlockLength++] = 0x80;
+  if (Context->BlockLength > SHA1_BLOCK_SIZE - 8) {
+    SetMem(Context->Block + Context->BlockLength, SHA1_BLOCK_SIZE - Context->BlockLength, 0);
+    Sha1Blocks(Context->State, Context->Block, 1);
+    Context->BlockLength = 0;
+  }
+  SetMem(Context->Block + Context->BlockLength, SHA1_BLOCK_SIZE - 8 - Context->BlockLength, 0);
+  for (i = 0; i < 8; i++) {
+    Context->Block[SHA1_BLOCK_SIZE - 1 - i] = (UINT8)(Bits >> (i * 8));
+  }
+  Sha1Blocks(Context->State, Context->Block, 1);
+  for (i = 0; i < 5; i++) {
+    Digest[i * 4]     = (UINT8)(Context->State[i] >> 24);
+    Digest[i * 4 + 1] = (UINT8)(Context->State[i] >> 16);
+    Digest[i * 4 + 2] = (UINT8)(Context->State[i] >> 8);
+    Digest[i * 4 + 3] = (UINT8)Context->State[i];
+  }
+}
@@ -0,0 +1,39 @@
+/*
+ * Sha1.h
+ *
+ * SHA-1 of the HashServiceFix driver, same layout as Sha256.h. The blocks are hashed with the SHA extensions
+ * (sha1rnds4/sha1nexte/sha1msg1/sha1msg2) when enabled from CPUID, else in C.
+ */
+
+#ifndef PLATFORM_SHA1_H_
+#define PLATFORM_SHA1_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <Uefi.h>
+
+#define SHA1_DIGEST_SIZE  20
+#define SHA1_BLOCK_SIZE   64
+
+typedef struct {
+  UINT32  State[5];
+  UINT64  Length;                   // bytes hashed so far
+  UINT8   Block[SHA1_BLOCK_SIZE];   // partial block
+  UINTN   BlockLength;
+} SHA1_CONTEXT;
+
+// Enables the SHA extensions, from CPUID. Ignored if not compiled for x86_64.
+void Sha1SetShaNi(BOOLEAN Enable);
+BOOLEAN Sha1GetShaNi(void);
+
+void Sha1Init(SHA1_CONTEXT *Context);
+void Sha1Update(SHA1_CONTEXT *Context, const void *Data, UINTN Size);
+void Sha1Final(SHA1_CONTEXT *Context, UINT8 Digest[SHA1_DIGEST_SIZE]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PLATFORM_SHA1_H_ */
@@ -0,0 +1,206 @@
+/*
+ * Sha256.c
+ *
+ * FIPS 180-4 SHA-256. Plain C, also built by Protocols/HashServiceFix. Sha256BlocksShaNi() keeps the state as ABEF/CDGH, the layout sha256rnds2 wants,
+ * and does 4 rounds per message vector. GCC and clang vector extensions and builtins are used
+ * instead of <immintrin.h> because of freestanding build, like MemoryOperation.c.
+ */
+
+#include "Sha256.h"
+
+#include <Library/BaseMemoryLib.h>
+
+// __builtin_shufflevector appeared in GCC 12, clang always had it
+#if defined(__x86_64__) && defined(__GNUC__) && (defined(__clang__) || __GNUC__ >= 12)
+#define SHA256_SHA_NI 1
+typedef UINT32 SHA_V4U __attribute__((vector_size(16)));
+typedef int    SHA_V4I __attribute__((vector_size(16)));
+typedef UINT8  SHA_V16 __attribute__((vector_size(16)));
+typedef UINT8  SHA_V16_UNALIGNED __attribute__((vector_size(16), aligned(1)));
+typedef UINT32 SHA_V4U_UNALIGNED __attribute__((vector_size(16), aligned(4)));
+#else
+#define SHA256_SHA_NI 0
+#endif
+
+static const UINT32 Sha256K[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static BOOLEAN Sha256ShaNi = FALSE;
+
+void Sha256SetShaNi(BOOLEAN Enable)
+{
+  Sha256ShaNi = Enable && SHA256_SHA_NI;
+}
+
+BOOLEAN Sha256GetShaNi(void)
+{
+  return Sha256ShaNi;
+}
+
+static UINT32 Ror32(UINT32 Value, UINTN Count)
+{
+  return (Value >> Count) | (Value << (32 - Count));
+}
+
+static UINT32 LoadBe32(const UINT8 *Ptr)
+{
+  return ((UINT32)Ptr[0] << 24) | ((UINT32)Ptr[1] << 16) | ((UINT32)Ptr[2] << 8) | Ptr[3];
+}
+
+static void Sha256BlocksC(UINT32 *State, const UINT8 *Data, UINTN Count)
+{
+  UINT32 W[64];
+  UINT32 A, B, C, D, E, F, G, H, T1, T2;
+  UINTN  i;
+
+  while (Count--) {
+    for (i = 0; i < 16; i++) {
+      W[i] = LoadBe32(Data + i * 4);
+    }
+    for (i = 16; i < 64; i++) {
+      UINT32 S0 = Ror32(W[i - 15], 7) ^ Ror32(W[i - 15], 18) ^ (W[i - 15] >> 3);
+      UINT32 S1 = Ror32(W[i - 2], 17) ^ Ror32(W[i - 2], 19) ^ (W[i - 2] >> 10);
+      W[i] = W[i - 16] + S0 + W[i - 7] + S1;
+    }
+    A = State[0]; B = State[1]; C = State[2]; D = State[3];
+    E = State[4]; F = State[5]; G = State[6]; H = State[7];
+    for (i = 0; i < 64; i++) {
+      T1 = H + (Ror32(E, 6) ^ Ror32(E, 11) ^ Ror32(E, 25)) + ((E & F) ^ (~E & G)) + Sha256K[i] + W[i];
+      T2 = (Ror32(A, 2) ^ Ror32(A, 13) ^ Ror32(A, 22)) + ((A & B) ^ (A & C) ^ (B & C));
+      H = G; G = F; F = E; E = D + T1;
+      D = C; C = B; B = A; A = T1 + T2;
+    }
+    State[0] += A; State[1] += B; State[2] += C; State[3] += D;
+    State[4] += E; State[5] += F; State[6] += G; State[7] += H;
+    Data += SHA256_BLOCK_SIZE;
+  }
+}
+
+#if SHA256_SHA_NI == 1
+__attribute__((target("sha,sse4.1")))
+static void Sha256BlocksShaNi(UINT32 *State, const UINT8 *Data, UINTN Count)
+{
+  SHA_V4U Abcd = *(const SHA_V4U_UNALIGNED *)State;
+  SHA_V4U Efgh = *(const SHA_V4U_UNALIGNED *)(State + 4);
+  SHA_V4U Abef = __builtin_shufflevector(Efgh, Abcd, 1, 0, 5, 4);
+  SHA_V4U Cdgh = __builtin_shufflevector(Efgh, Abcd, 3, 2, 7, 6);
+  SHA_V4U AbefSave, CdghSave, Msg, W[4];
+  SHA_V16 Bytes;
+  UINTN   i;
+
+  while (Count--) {
+    AbefSave = Abef;
+    CdghSave = Cdgh;
+    for (i = 0; i < 16; i++) {
+      if (i < 4) {
+        // big endian words
+        Bytes = *(const SHA_V16_UNALIGNED *)(Data + i * 16);
+        W[i] = (SHA_V4U)__builtin_shufflevector(Bytes, Bytes, 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+      } else {
+        // W[i] from W[i - 4] .. W[i - 1], the ring slot of W[i - 4] is reused
+        Msg = (SHA_V4U)__builtin_ia32_sha256msg1((SHA_V4I)W[i & 3], (SHA_V4I)W[(i + 1) & 3]);
+        Msg += __builtin_shufflevector(W[(i + 2) & 3], W[(i + 3) & 3], 1, 2, 3, 4);
+        W[i & 3] = (SHA_V4U)__builtin_ia32_sha256msg2((SHA_V4I)Msg, (SHA_V4I)W[(i + 3) & 3]);
+      }
+      Msg = W[i & 3] + *(const SHA_V4U_UNALIGNED *)(Sha256K + i * 4);
+      Cdgh = (SHA_V4U)__builtin_ia32_sha256rnds2((SHA_V4I)Cdgh, (SHA_V4I)Abef, (SHA_V4I)Msg);
+      Msg = __builtin_shufflevector(Msg, Msg, 2, 3, 0, 0);
+      Abef = (SHA_V4U)__builtin_ia32_sha256rnds2((SHA_V4I)Abef, (SHA_V4I)Cdgh, (SHA_V4I)Msg);
+    }
+    Abef += AbefSave;
+    Cdgh += CdghSave;
+    Data += SHA256_BLOCK_SIZE;
+  }
+  *(SHA_V4U_UNALIGNED *)State = __builtin_shufflevector(Abef, Cdgh, 3, 2, 7, 6);
+  *(SHA_V4U_UNALIGNED *)(State + 4) = __builtin_shufflevector(Abef, Cdgh, 1, 0, 5, 4);
+}
+#endif
+
+static void Sha256Blocks(UINT32 *State, const UINT8 *Data, UINTN Count)
+{
+#if SHA256_SHA_NI == 1
+  if (Sha256ShaNi) {
+    Sha256BlocksShaNi(State, Data, Count);
+    return;
+  }
+#endif
+  Sha256BlocksC(State, Data, Count);
+}
+
+void Sha256Init(SHA256_CONTEXT *Context)
+{
+  Context->State[0] = 0x6a09e667;
+  Context->State[1] = 0xbb67ae85;
+  Context->State[2] = 0x3c6ef372;
+  Context->State[3] = 0xa54ff53a;
+  Context->State[4] = 0x510e527f;
+  Context->State[5] = 0x9b05688c;
+  Context->State[6] = 0x1f83d9ab;
+  Context->State[7] = 0x5be0cd19;
+  Context->Length = 0;
+  Context->BlockLength = 0;
+}
+
+void Sha256Update(SHA256_CONTEXT *Context, const void *Data, UINTN Size)
+{
+  const UINT8 *Ptr = (const UINT8 *)Data;
+  UINTN        Part;
+
+  Context->Length += Size;
+  if (Context->BlockLength != 0) {
+    Part = SHA256_BLOCK_SIZE - Context->BlockLength;
+    if (Part > Size) {
+      Part = Size;
+    }
+    CopyMem(Context->Block + Context->BlockLength, Ptr, Part);
+    Context->BlockLength += Part;
+    Ptr += Part;
+    Size -= Part;
+    if (Context->BlockLength < SHA256_BLOCK_SIZE) {
+      return;
+    }
+    Sha256Blocks(Context->State, Context->Block, 1);
+    Context->BlockLength = 0;
+  }
+  if (Size >= SHA256_BLOCK_SIZE) {
+    Sha256Blocks(Context->State, Ptr, Size / SHA256_BLOCK_SIZE);
+    Ptr += Size & ~(UINTN)(SHA256_BLOCK_SIZE - 1);
+    Size &= SHA256_BLOCK_SIZE - 1;
+  }
+  if (Size != 0) {
+    CopyMem(Context->Block, Ptr, Size);
+    Context->BlockLength = Size;
+  }
+}
+
+void Sha256Final(SHA256_CONTEXT *Context, UINT8 Digest[SHA256_DIGEST_SIZE])
+{
+  UINT64 Bits = Context->Length * 8;
+  UINTN  i;
+
+  Context->Block[Context->BlockLength++] = 0x80;
+  if (Context->BlockLength > SHA256_BLOCK_SIZE - 8) {
+    SetMem(Context->Block + Context->BlockLength, SHA256_BLOCK_SIZE - Context->BlockLength, 0);
+    Sha256Blocks(Context->State, Context->Block, 1);
+    Context->BlockLength = 0;
+  }
+  SetMem(Context->Block + Context->BlockLength, SHA256_BLOCK_SIZE - 8 - Context->BlockLength, 0);
+  for (i = 0; i < 8; i++) {
+    Context->Block[SHA256_BLOCK_SIZE - 1 - i] = (UINT8)(Bits >> (i * 8));
+  }
+  Sha256Blocks(Context->State, Context->Block, 1);
+  for (i = 0; i < 8; i++) {
+    Digest[i * 4]     = (UINT8)(Context->State[i] >> 24);
+    Digest[i * 4 + 1] = (UINT8)(Context->State[i] >> 16);
+    Digest[i * 4 + 2] = (UINT8)(Context->State[i] >> 8);
+    Digest[i * 4 + 3] = (UINT8)Context->State[i];
+  }
+}
@@ -0,0 +1,41 @@
+/*
+ * Sha256.h
+ *
+ * SHA-256 of the secure boot image hashes and of the HashServiceFix driver. The blocks are hashed with the SHA extensions
+ * (sha256rnds2/sha256msg1/sha256msg2) when GetCPUProperties() found them in CPUID, else in C.
+ * Sha256Update() hashes the whole blocks straight from the caller's buffer, only a partial
+ * block is copied in the context.
+ */
+
+#ifndef PLATFORM_SHA256_H_
+#define PLATFORM_SHA256_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <Uefi.h>
+
+#define SHA256_DIGEST_SIZE  32
+#define SHA256_BLOCK_SIZE   64
+
+typedef struct {
+  UINT32  State[8];
+  UINT64  Length;                     // bytes hashed so far
+  UINT8   Block[SHA256_BLOCK_SIZE];   // partial block
+  UINTN   BlockLength;
+} SHA256_CONTEXT;
+
+// Enables the SHA extensions. Called once by GetCPUProperties() or HashServiceFix, from CPUID. Ignored if not compiled for x86_64.
+void Sha256SetShaNi(BOOLEAN Enable);
+BOOLEAN Sha256GetShaNi(void);
+
+void Sha256Init(SHA256_CONTEXT *Context);
+void Sha256Update(SHA256_CONTEXT *Context, const void *Data, UINTN Size);
+void Sha256Final(SHA256_CONTEXT *Context, UINT8 Digest[SHA256_DIGEST_SIZE]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PLATFORM_SHA256_H_ */
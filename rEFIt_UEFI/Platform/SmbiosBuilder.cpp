@@ -0,0 +1,170 @@
+/*
+ * SmbiosBuilder.cpp
+ *
+ * The source index is a counting sort of the structures by type: TypeStart[Type] is the first
+ * entry of this type in ByType and TypeStart[Type + 1] is the end.
+ */
+
+#include "SmbiosBuilder.h"
+
+static UINT16 StructureLength(const UINT8* Raw)
+{
+  const UINT8* AChar = Raw + Raw[1];
+
+  while (AChar[0] != 0 || AChar[1] != 0) {
+    AChar++;
+  }
+  return (UINT16)(AChar - Raw + 2);
+}
+
+void SmbiosSourceIndex::Reset()
+{
+  Source = NULL;
+  Structures.setEmpty();
+  ByType.setEmpty();
+  SetMem(TypeStart, sizeof(TypeStart), 0);
+}
+
+void SmbiosSourceIndex::Build(const UINT8* Table)
+{
+  SMBIOS_SOURCE_STRUCTURE Structure;
+  UINT16 Count[256];
+  UINTN  Offset = 0;
+  size_t i;
+  UINTN  Type;
+
+  Reset();
+  if (Table == NULL) {
+    return;
+  }
+  Source = Table;
+  while (Offset < SMBIOS_BUILDER_MAX_LENGTH && Table[Offset + 1] >= 4) {
+    Structure.Raw = Table + Offset;
+    Structure.Length = StructureLength(Structure.Raw);
+    Structures.Add(Structure);
+    if (Structure.Raw[0] == SMBIOS_BUILDER_END_OF_TABLE) {
+      break;
+    }
+    Offset += Structure.Length;
+  }
+
+  SetMem(Count, sizeof(Count), 0);
+  for (i = 0; i < Structures.size(); i++) {
+    Count[Structures.ElementAt(i).Raw[0]]++;
+  }
+  for (Type = 0; Type < 256; Type++) {
+    TypeStart[Type + 1] = (UINT16)(TypeStart[Type] + Count[Type]);
+  }
+  ByType.setSize(Structures.size());
+  SetMem(Count, sizeof(Count), 0);
+  for (i = 0; i < Structures.size(); i++) {
+    Type = Structures.ElementAt(i).Raw[0];
+    ByType.ElementAt((size_t)(TypeStart[Type] + Count[Type])) = (UINT16)i;
+    Count[Type]++;
+  }
+}
+
+const UINT8* SmbiosSourceIndex::Get(UINT8 Type, UINTN Index) const
+{
+  if (Index >= GetCount(Type)) {
+    return NULL;
+  }
+  return Structures.ElementAt((size_t)ByType.ElementAt((size_t)(TypeStart[Type] + Index))).Raw;
+}
+
+UINT16 SmbiosSourceIndex::LengthOf(const UINT8* Raw) const
+{
+  size_t Lo = 0;
+  size_t Hi = Structures.size();
+  size_t Mid;
+
+  while (Lo < Hi) {
+    Mid = (Lo + Hi) / 2;
+    if (Structures.ElementAt(Mid).Raw < Raw) {
+      Lo = Mid + 1;
+    } else {
+      Hi = Mid;
+    }
+  }
+  if (Lo < Structures.size() && Structures.ElementAt(Lo).Raw == Raw) {
+    return Structures.ElementAt(Lo).Length;
+  }
+  return 0;
+}
+
+void SmbiosStringPool::Reset()
+{
+  Table = NULL;
+  Pool.setEmpty();
+  Strings.setEmpty();
+}
+
+void SmbiosStringPool::Load(const UINT8* Raw)
+{
+  const CHAR8* AString;
+  UINTN        Length;
+
+  Reset();
+  Table = Raw;
+  AString = (const CHAR8*)(Raw + Raw[1]);
+  while (*AString != 0) {
+    Length = strlen(AString);
+    SetString(0, AString, Length);
+    AString += Length + 1;
+  }
+}
+
+UINT8 SmbiosStringPool::SetString(UINT8 StringNumber, const CHAR8* String, UINTN Length)
+{
+  SMBIOS_POOL_STRING Entry;
+
+  Entry.Offset = (UINT32)Pool.size();
+  Entry.Length = (UINT32)Length;
+  Pool.AddArray(String, Length);
+  if (StringNumber == 0 || StringNumber > Strings.size()) {
+    Strings.Add(Entry);
+    return (UINT8)Strings.size();
+  }
+  Strings.ElementAt((size_t)StringNumber - 1) = Entry;
+  return StringNumber;
+}
+
+UINTN SmbiosStringPool::GetLength() const
+{
+  UINTN  Length;
+  size_t i;
+
+  if (Table == NULL) {
+    return 0;
+  }
+  Length = Table[1] + 1;
+  for (i = 0; i < Strings.size(); i++) {
+    Length += Strings.ElementAt(i).Length + 1;
+  }
+  if (Strings.size() == 0) {
+    Length++;
+  }
+  return Length;
+}
+
+UINTN SmbiosStringPool::Write(UINT8* Out) const
+{
+  UINT8* Ptr = Out;
+  size_t i;
+
+  if (Table == NULL) {
+    return 0;
+  }
+  CopyMem(Ptr, Table, Table[1]);
+  Ptr += Table[1];
+  for (i = 0; i < Strings.size(); i++) {
+    CopyMem(Ptr, Pool.data() + Strings.ElementAt(i).Offset, Strings.ElementAt(i).Length);
+    Ptr += Strings.ElementAt(i).Length;
+    *Ptr++ = 0;
+  }
+  if (Strings.size() == 0) {
+    *Ptr++ = 0;
+  }
+  *Ptr++ = 0;
+  return (UINTN)(Ptr - Out);
+}
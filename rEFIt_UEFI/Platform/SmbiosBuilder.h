@@ -0,0 +1,80 @@
+/*
+ * SmbiosBuilder.h
+ *
+ * Helpers of PatchSmbios() to build the new SMBIOS table in one pass.
+ * SmbiosSourceIndex lists the structures of the original table once, by type, so that the
+ * PatchTable* routines don't walk the table from its start for each structure they look for.
+ * SmbiosStringPool keeps the strings of the structure being patched, a string is replaced or
+ * added without shifting the others, and the structure is written once with all its strings.
+ * Both only use the SMBIOS header bytes: Type at 0, Length at 1, Handle at 2.
+ */
+
+#ifndef PLATFORM_SMBIOSBUILDER_H_
+#define PLATFORM_SMBIOSBUILDER_H_
+
+#include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+#include "../cpp_foundation/XArray.h"
+
+#define SMBIOS_BUILDER_END_OF_TABLE  127
+#define SMBIOS_BUILDER_MAX_LENGTH    0xFFFF  // a 2.x entry point can't describe a longer table
+
+typedef struct {
+  const UINT8* Raw;
+  UINT16       Length;  // including the strings and the double 0
+} SMBIOS_SOURCE_STRUCTURE;
+
+class SmbiosSourceIndex
+{
+protected:
+  const UINT8*                    Source;
+  XArray<SMBIOS_SOURCE_STRUCTURE> Structures;  // table order, so ascending addresses
+  XArray<UINT16>                  ByType;      // indexes in Structures grouped by type
+  UINT16                          TypeStart[257];
+
+public:
+  SmbiosSourceIndex() : Source(NULL), Structures(), ByType() { SetMem(TypeStart, sizeof(TypeStart), 0); }
+
+  // walks the table up to the end-of-table structure, as GetSmbiosTableFromType() did
+  void    Build(const UINT8* Table);
+  void    Reset();
+  BOOLEAN IsBuiltFrom(const UINT8* Table) const { return Source != NULL && Source == Table; }
+  size_t  size() const { return Structures.size(); }
+
+  UINTN        GetCount(UINT8 Type) const { return (UINTN)(TypeStart[Type + 1] - TypeStart[Type]); }
+  // the Index-th structure of this type, NULL if none
+  const UINT8* Get(UINT8 Type, UINTN Index) const;
+  // 0 if Raw is not the start of a structure of the source
+  UINT16       LengthOf(const UINT8* Raw) const;
+};
+
+typedef struct {
+  UINT32 Offset;  // in Pool
+  UINT32 Length;  // without the ending 0
+} SMBIOS_POOL_STRING;
+
+class SmbiosStringPool
+{
+protected:
+  const UINT8*               Table;  // the structure the strings were loaded from, NULL if none
+  XArray<CHAR8>              Pool;
+  XArray<SMBIOS_POOL_STRING> Strings;
+
+public:
+  SmbiosStringPool() : Table(NULL), Pool(), Strings() {}
+
+  void    Reset();
+  BOOLEAN IsLoadedFrom(const UINT8* Raw) const { return Table != NULL && Table == Raw; }
+  // the strings following the formatted area of Raw
+  void    Load(const UINT8* Raw);
+  size_t  GetCount() const { return Strings.size(); }
+
+  // replaces the string StringNumber (1 based) or adds a new one if StringNumber is 0 or past
+  // the last string. Returns the number of the string to put in the field
+  UINT8   SetString(UINT8 StringNumber, const CHAR8* String, UINTN Length);
+
+  // formatted area of the loaded structure, strings and the double 0
+  UINTN   GetLength() const;
+  UINTN   Write(UINT8* Out) const;
+};
+
+#endif /* PLATFORM_SMBIOSBUILDER_H_ */
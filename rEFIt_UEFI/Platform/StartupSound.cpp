@@ -57,6 +57,27 @@ extern EFI_GUID gBootChimeVendorVariableGuid;
 
 EFI_AUDIO_IO_PROTOCOL *AudioIo = NULL;
 
+// Samples of the async playback. The controller copies them block by block into its DMA ring
+// from its poll timer, so they live until the stream ends or is stopped.
+static UINT8            *AsyncSamples = NULL;
+static UINTN             AsyncSamplesLength = 0;
+static volatile BOOLEAN  AsyncDone = FALSE;
+
+// Called from the HDA poll timer at TPL_NOTIFY, only flags the end.
+static VOID EFIAPI AsyncSoundDone(IN EFI_AUDIO_IO_PROTOCOL *Io, IN VOID *Context)
+{
+  AsyncDone = TRUE;
+}
+
+static void FreeAsyncSamples()
+{
+  if (AsyncSamples) {
+    FreeAlignedPages(AsyncSamples, EFI_SIZE_TO_PAGES(AsyncSamplesLength + 4095));
+    AsyncSamples = NULL;
+    AsyncSamplesLength = 0;
+  }
+}
+
 
 EFI_STATUS
 StartupSoundPlay(const EFI_FILE* Dir, CONST CHAR16* SoundFile)
@@ -66,8 +87,6 @@ StartupSoundPlay(const EFI_FILE* Dir, CONST CHAR16* SoundFile)
   UINTN           FileDataLength = 0U;
   WAVE_FILE_DATA  WaveData;
   UINT8           OutputVolume = DefaultAudioVolume;
-  UINT16          *TempData = NULL;
-  UINTN           Len;
   
   if (OldChosenAudio >= AudioList.size()) {
     OldChosenAudio = 0; //security correction
@@ -81,6 +100,11 @@ StartupSoundPlay(const EFI_FILE* Dir, CONST CHAR16* SoundFile)
     //    DBG("not found AudioIo to play\n");
     goto DONE_ERROR;
   }
+  if (AsyncSamples) {
+    // a previous sound is still owned by the stream
+    AudioIo->StopPlayback(AudioIo);
+    FreeAsyncSamples();
+  }
 
   if (SoundFile) {
     Status = egLoadFile(Dir, SoundFile, &FileData, &FileDataLength);
@@ -101,7 +125,6 @@ StartupSoundPlay(const EFI_FILE* Dir, CONST CHAR16* SoundFile)
     //if error then data not allocated
     goto DONE_ERROR;
   }
-  Len = WaveData.SamplesLength; //byte length
 	MsgLog("  Channels: %hu  Sample rate: %u Hz  Bits: %hu\n", WaveData.Format->Channels, WaveData.Format->SamplesPerSec, WaveData.Format->BitsPerSample);
 
   EFI_AUDIO_IO_PROTOCOL_BITS bits;
@@ -170,38 +193,7 @@ StartupSoundPlay(const EFI_FILE* Dir, CONST CHAR16* SoundFile)
     goto DONE_ERROR;
   }
 
-  if ((freq == EfiAudioIoFreq8kHz) && (bits == EfiAudioIoBits16)) {
-    //making conversion
-    Len *= 6; //8000<->48000
-    UINTN Ind, Out=0, Tact;
-    INT16 Tmp, Next;
-    float Delta;
-    INT16 *Ptr = (INT16*)WaveData.Samples;
-    if (!Ptr) {
-      Status = EFI_NOT_FOUND;
- //     DBG("not found wave data\n");
-      goto DONE_ERROR;
-    }
-//    TempData = (__typeof__(TempData))AllocateZeroPool(Len * sizeof(INT16));
-    TempData = (__typeof__(TempData))AllocateAlignedPages(EFI_SIZE_TO_PAGES(Len + 4095), 128);
-    Tmp = *(Ptr++);
-    for (Ind = 0; Ind < WaveData.SamplesLength / 2 - 1; Ind++) {
-      Next = *(Ptr++);
-      Delta = (Next - Tmp) / 6.f;
-      for (Tact = 0; Tact < 6; Tact++) {
-        TempData[Out++] = Tmp;
-        Tmp = (INT16)(Delta + Tmp + 0.5f);
-      }
-      Tmp = Next;
-    }
-    freq = EfiAudioIoFreq48kHz;
-    // Samples was allocated via AllocateAlignedPages, so it must not be freed with FreePool, but according to the number of pages allocated
-    FreeAlignedPages(WaveData.Samples,EFI_SIZE_TO_PAGES(WaveData.SamplesLength + 4095));
-    WaveData.SamplesLength *= 6;
-    DBG("sound converted to 48kHz\n");
-    WaveData.Samples = (UINT8*)TempData;
-  }
-
+  // a format the codec doesn't support is converted by AudioDxe while streaming
   // Setup playback.
   if (OutputIndex >= AudioList.size()) {
     OutputIndex = 0;
@@ -216,8 +208,15 @@ StartupSoundPlay(const EFI_FILE* Dir, CONST CHAR16* SoundFile)
 //  DBG("playback set\n");
   // Start playback.
   if (gSettings.PlayAsync) {
-    Status = AudioIo->StartPlaybackAsync(AudioIo, WaveData.Samples, WaveData.SamplesLength, 0, NULL, NULL);
+    AsyncDone = FALSE;
+    Status = AudioIo->StartPlaybackAsync(AudioIo, WaveData.Samples, WaveData.SamplesLength, 0, AsyncSoundDone, NULL);
 //    DBG("async started, status=%s\n", efiStrError(Status));
+    if (!EFI_ERROR(Status)) {
+      // the stream owns the samples now, CheckSyncSound() frees them
+      AsyncSamples = WaveData.Samples;
+      AsyncSamplesLength = WaveData.SamplesLength;
+      WaveData.Samples = NULL;
+    }
   } else {
     Status = AudioIo->StartPlayback(AudioIo, WaveData.Samples, WaveData.SamplesLength, 0);
 //    DBG("sync started, status=%s\n", efiStrError(Status));
@@ -235,10 +234,7 @@ DONE_ERROR:
 //    DBG("free sound\n");
     FreePool(FileData);
   }
-  if (!gSettings.PlayAsync && WaveData.Samples) {
-    //dont free sound when async play
-    // here we have memory leak with WaveData.Samples
-    // and we can't free memory up to stop AsyncPlay
+  if (WaveData.Samples) {
     FreeAlignedPages(WaveData.Samples, EFI_SIZE_TO_PAGES(WaveData.SamplesLength + 4095));
   }
   DBG("sound play end with status=%s\n", efiStrError(Status));
@@ -326,7 +322,7 @@ GetStoredOutput()
 
   // Get stored device index.
   OutputPortIndex = 0;
-  Status = gRT->GetVariable(L"Clover.SoundIndex", &gEfiAppleBootGuid, NULL,
+  Status = NvramGetVariable(L"Clover.SoundIndex", &gEfiAppleBootGuid, NULL,
                             &OutputPortIndexSize, &OutputPortIndex);
   if (EFI_ERROR(Status)) {
     Status = gRT->GetVariable(BOOT_CHIME_VAR_INDEX, &gBootChimeVendorVariableGuid, NULL,
@@ -344,7 +340,7 @@ GetStoredOutput()
   }
   // Get stored volume. If this fails, just use the max.
   OutputVolume = DefaultAudioVolume;
-  Status = gRT->GetVariable(L"Clover.SoundVolume", &gEfiAppleBootGuid, NULL,
+  Status = NvramGetVariable(L"Clover.SoundVolume", &gEfiAppleBootGuid, NULL,
                             &OutputVolumeSize, &OutputVolume);
   if (EFI_ERROR(Status)) {
     Status = gRT->GetVariable(BOOT_CHIME_VAR_VOLUME, &gBootChimeVendorVariableGuid, NULL,
@@ -385,6 +381,10 @@ EFI_STATUS CheckSyncSound(BOOLEAN Stop)
   }
   HdaIo = AudioIoPrivateData->HdaCodecDev->HdaIo;
 
+  if (AsyncDone) {
+    // the poll timer already stopped the stream
+    FreeAsyncSamples();
+  }
   Status = HdaIo->GetStream(HdaIo, EfiHdaIoTypeOutput, &StreamRunning);
   if ((EFI_ERROR(Status) || Stop) && StreamRunning) {
     DBG("stream stopping & controller reset\n");
@@ -395,6 +395,9 @@ EFI_STATUS CheckSyncSound(BOOLEAN Stop)
 //    HdaControllerCleanup(HdaControllerDev);
   }
 
+  if (!StreamRunning || Stop) {
+    FreeAsyncSamples();
+  }
   if (!StreamRunning) {
     AudioIo = NULL;
     Status = EFI_NOT_STARTED;
@@ -7,6 +7,7 @@
 #include "cpu.h"
 #include "smbios.h"
 #include "AcpiPatcher.h"
+#include "Self.h"
 
 CONST UINT8 pss_ssdt_header[] =
 {
@@ -72,6 +73,230 @@ struct p_state
 };
 typedef struct p_state P_STATE;
 
+//
+// With Boot/PmSsdtCache, the generated P-States and C-States SSDTs are kept in misc\PmSsdtCache.bin.
+// The key is what they are made of: the CRC32 of config.plist, the CPU signature, ratios and bus
+// frequency read by GetCPUProperties(), the ACPI CPU names and, for C-States, the FADT fields used.
+// A hit returns the cached AML without reading MSRs nor building AML nodes. P-States of CPUs before
+// Nehalem are not cached, generate_pss_ssdt() also turns their dynamic FSB on. Options changed in the
+// GUI are not in the key, ApplyInputs() turns the cache off.
+//
+#define PM_SSDT_CACHE_FILE       L"misc\\PmSsdtCache.bin"
+#define PM_SSDT_CACHE_SIGNATURE  SIGNATURE_32('P', 'M', 'C', 'H')
+#define PM_SSDT_CACHE_VERSION    1
+#define PM_SSDT_CACHE_MAX        4     // P-States and C-States of two configs, roughly
+#define PM_SSDT_CACHE_MAX_KEY    128
+#define PM_SSDT_CACHE_MAX_SSDT   0x10000
+
+#define PM_SSDT_PSS              SIGNATURE_32('P', 'S', 'S', '_')
+#define PM_SSDT_CST              SIGNATURE_32('C', 'S', 'T', '_')
+
+typedef struct {
+  UINT32  Signature;
+  UINT32  Version;
+  UINT32  Count;
+  UINT32  Reserved;
+} PM_SSDT_CACHE_HEADER;
+
+typedef struct {
+  UINT32  KeyLength;
+  UINT32  SsdtLength;
+  UINT32  SsdtCrc32;
+  UINT32  Reserved;
+  // followed by the key and the SSDT
+} PM_SSDT_CACHE_RECORD;
+
+class PM_SSDT_CACHE_ENTRY
+{
+public:
+  XBuffer<UINT8>  Key;
+  XBuffer<UINT8>  Ssdt;
+  UINT32          SsdtCrc32;
+
+  PM_SSDT_CACHE_ENTRY() : Key(), Ssdt(), SsdtCrc32(0) {}
+  PM_SSDT_CACHE_ENTRY(const PM_SSDT_CACHE_ENTRY& other) = delete; // Can be defined if needed
+  const PM_SSDT_CACHE_ENTRY& operator = ( const PM_SSDT_CACHE_ENTRY & ) = delete; // Can be defined if needed
+};
+
+static XObjArray<PM_SSDT_CACHE_ENTRY> PmSsdtCache;
+static BOOLEAN                        PmSsdtCacheLoaded = FALSE;
+
+static void PmSsdtCacheLoad(void)
+{
+  EFI_STATUS            Status;
+  UINT8                 *Data = NULL;
+  UINTN                 DataSize = 0;
+  UINTN                 Offset;
+  UINT32                Index;
+  PM_SSDT_CACHE_HEADER  *Header;
+  PM_SSDT_CACHE_RECORD  *Record;
+
+  if (PmSsdtCacheLoaded) {
+    return;
+  }
+  PmSsdtCacheLoaded = TRUE;
+  PmSsdtCache.setEmpty();
+
+  Status = egLoadFile(&self.getCloverDir(), PM_SSDT_CACHE_FILE, &Data, &DataSize);
+  if (EFI_ERROR(Status)) {
+    MsgLog("PM SSDT cache: %s\n", efiStrError(Status));
+    return;
+  }
+  Header = (PM_SSDT_CACHE_HEADER *)Data;
+  if (DataSize < sizeof(PM_SSDT_CACHE_HEADER) || Header->Signature != PM_SSDT_CACHE_SIGNATURE ||
+      Header->Version != PM_SSDT_CACHE_VERSION) {
+    MsgLog("PM SSDT cache: bad file\n");
+    FreePool(Data);
+    return;
+  }
+
+  Offset = sizeof(PM_SSDT_CACHE_HEADER);
+  for (Index = 0; Index < Header->Count && Index < PM_SSDT_CACHE_MAX; Index++) {
+    if (DataSize - Offset < sizeof(PM_SSDT_CACHE_RECORD)) {
+      break;
+    }
+    Record = (PM_SSDT_CACHE_RECORD *)(Data + Offset);
+    Offset += sizeof(PM_SSDT_CACHE_RECORD);
+    if (Record->KeyLength > PM_SSDT_CACHE_MAX_KEY || Record->SsdtLength > PM_SSDT_CACHE_MAX_SSDT ||
+        DataSize - Offset < (UINTN)Record->KeyLength + Record->SsdtLength) {
+      break;
+    }
+    PM_SSDT_CACHE_ENTRY* Entry = new PM_SSDT_CACHE_ENTRY;
+    Entry->SsdtCrc32 = Record->SsdtCrc32;
+    Entry->Key.ncpy(Data + Offset, Record->KeyLength);
+    Offset += Record->KeyLength;
+    Entry->Ssdt.ncpy(Data + Offset, Record->SsdtLength);
+    Offset += Record->SsdtLength;
+    PmSsdtCache.AddReference(Entry, true);
+  }
+  FreePool(Data);
+}
+
+static void PmSsdtCacheSave(void)
+{
+  EFI_STATUS            Status;
+  XBuffer<UINT8>        Data;
+  PM_SSDT_CACHE_HEADER  Header;
+  PM_SSDT_CACHE_RECORD  Record;
+  size_t                Index;
+
+  ZeroMem(&Header, sizeof(Header));
+  Header.Signature = PM_SSDT_CACHE_SIGNATURE;
+  Header.Version = PM_SSDT_CACHE_VERSION;
+  Header.Count = (UINT32)PmSsdtCache.size();
+  Data.ncat(&Header, sizeof(Header));
+  for (Index = 0; Index < PmSsdtCache.size(); Index++) {
+    const PM_SSDT_CACHE_ENTRY& Entry = PmSsdtCache[Index];
+    ZeroMem(&Record, sizeof(Record));
+    Record.KeyLength = (UINT32)Entry.Key.size();
+    Record.SsdtLength = (UINT32)Entry.Ssdt.size();
+    Record.SsdtCrc32 = Entry.SsdtCrc32;
+    Data.ncat(&Record, sizeof(Record));
+    Data.ncat(Entry.Key.data(), Entry.Key.size());
+    Data.ncat(Entry.Ssdt.data(), Entry.Ssdt.size());
+  }
+  Status = egSaveFile(&self.getCloverDir(), PM_SSDT_CACHE_FILE, Data.data(), Data.size());
+  MsgLog("PM SSDT cache: saved %zu entries: %s\n", PmSsdtCache.size(), efiStrError(Status));
+}
+
+// FALSE for the CPUs whose P-States are read from MSR_IA32_PERF_STATUS, see generate_pss_ssdt()
+static BOOLEAN PmSsdtCacheable(void)
+{
+  if (gCPUStructure.Family != 0x06) {
+    return TRUE;
+  }
+  switch (gCPUStructure.Model) {
+    case CPU_MODEL_DOTHAN:
+    case CPU_MODEL_CELERON:
+    case CPU_MODEL_PENTIUM_M:
+    case CPU_MODEL_YONAH:
+    case CPU_MODEL_MEROM:
+    case CPU_MODEL_PENRYN:
+    case CPU_MODEL_ATOM:
+      return FALSE;
+    default:
+      return TRUE;
+  }
+}
+
+static void PmSsdtCacheKey(XBuffer<UINT8>& Key, UINT32 Kind, UINTN Number)
+{
+  XBuffer<UINT8>  Names;
+  UINTN           i;
+
+  if (acpi_cpu_score) {
+    Names.ncat(acpi_cpu_score, AsciiStrLen(acpi_cpu_score));
+  }
+  for (i = 0; i < Number; i++) {
+    Names.ncat(acpi_cpu_name[i], 4);
+  }
+
+  Key.setEmpty();
+  Key.cat(Kind);
+  Key.cat(gConfigCrc32);
+  Key.cat(gCPUStructure.Signature);
+  Key.cat(gCPUStructure.MaxRatio);
+  Key.cat(gCPUStructure.MinRatio);
+  Key.cat(gCPUStructure.Turbo1);
+  Key.cat(gCPUStructure.Turbo4);
+  Key.cat(gCPUStructure.FSBFrequency);
+  Key.cat(gMobile);
+  Key.cat((UINT32)Number);
+  Key.cat(GetCrc32(Names.data(), Names.size()));
+}
+
+static PM_SSDT_CACHE_ENTRY* PmSsdtCacheFind(const XBuffer<UINT8>& Key)
+{
+  for (size_t Index = 0; Index < PmSsdtCache.size(); Index++) {
+    PM_SSDT_CACHE_ENTRY& Entry = PmSsdtCache[Index];
+    if (Entry.Key.size() == Key.size() && CompareMem(Entry.Key.data(), Key.data(), Key.size()) == 0) {
+      return &Entry;
+    }
+  }
+  return NULL;
+}
+
+// a copy of the cached SSDT, NULL if there is none
+static SSDT_TABLE *PmSsdtCacheGet(const XBuffer<UINT8>& Key)
+{
+  PM_SSDT_CACHE_ENTRY *Entry;
+
+  PmSsdtCacheLoad();
+  Entry = PmSsdtCacheFind(Key);
+  if (Entry == NULL) {
+    return NULL;
+  }
+  if (Entry->Ssdt.size() < sizeof(SSDT_TABLE) || GetCrc32(Entry->Ssdt.data(), Entry->Ssdt.size()) != Entry->SsdtCrc32 ||
+      ((SSDT_TABLE *)Entry->Ssdt.data())->Length != Entry->Ssdt.size()) {
+    MsgLog("PM SSDT cache: bad entry\n");
+    return NULL;
+  }
+  MsgLog("PM SSDT cache: hit, %zu bytes\n", Entry->Ssdt.size());
+  return (SSDT_TABLE *)AllocateCopyPool(Entry->Ssdt.size(), Entry->Ssdt.data());
+}
+
+static void PmSsdtCachePut(const XBuffer<UINT8>& Key, const SSDT_TABLE *Ssdt)
+{
+  PM_SSDT_CACHE_ENTRY *Entry;
+
+  if (Key.size() > PM_SSDT_CACHE_MAX_KEY || Ssdt->Length > PM_SSDT_CACHE_MAX_SSDT) {
+    return;
+  }
+  PmSsdtCacheLoad();
+  Entry = PmSsdtCacheFind(Key);
+  if (Entry == NULL) {
+    if (PmSsdtCache.size() >= PM_SSDT_CACHE_MAX) {
+      PmSsdtCache.RemoveAtIndex((size_t)0); // the oldest
+    }
+    Entry = new PM_SSDT_CACHE_ENTRY;
+    Entry->Key = Key;
+    PmSsdtCache.AddReference(Entry, true);
+  }
+  Entry->Ssdt.ncpy(Ssdt, Ssdt->Length);
+  Entry->SsdtCrc32 = GetCrc32(Ssdt, Ssdt->Length);
+  PmSsdtCacheSave();
+}
+
 SSDT_TABLE *generate_pss_ssdt(UINTN Number)
 {
   CHAR8 name[31];
@@ -84,6 +309,9 @@ SSDT_TABLE *generate_pss_ssdt(UINTN Number)
   UINT8 cpu_noninteger_bus_ratio = 0;
 //  UINT32 i, j;
   UINT16 realMax, realMin = 6, realTurbo = 0, Apsn = 0, Aplf = 0;
+  BOOLEAN UseCache;
+  XBuffer<UINT8> CacheKey;
+  SSDT_TABLE *Cached;
   
   if (gCPUStructure.Vendor != CPU_VENDOR_INTEL) {
     MsgLog ("Not an Intel platform: P-States will not be generated !!!\n");
@@ -134,6 +362,15 @@ SSDT_TABLE *generate_pss_ssdt(UINTN Number)
     gSettings.GenerateAPLF = FALSE;
   }
 
+  UseCache = GlobalConfig.PmSsdtCache && Number > 0 && PmSsdtCacheable();
+  if (UseCache) {
+    PmSsdtCacheKey(CacheKey, PM_SSDT_PSS, Number);
+    Cached = PmSsdtCacheGet(CacheKey);
+    if (Cached) {
+      return Cached;
+    }
+  }
+
   if (Number > 0) {
     // Retrieving P-States, ported from code by superhai (c)
     switch (gCPUStructure.Family) {
@@ -461,16 +698,16 @@ SSDT_TABLE *generate_pss_ssdt(UINTN Number)
         aml_add_byte(scop, gSettings.PluginType);
       }
 
-      aml_calculate_size(root);
-
-      ssdt = (SSDT_TABLE *)AllocateZeroPool(root->Size);
-      aml_write_node(root, (CHAR8*)ssdt, 0);
-      ssdt->Length = root->Size;
+      ssdt = (SSDT_TABLE *)AllocateZeroPool(aml_max_size(root));
+      ssdt->Length = aml_write_node(root, (CHAR8*)ssdt, 0);
       FixChecksum(ssdt);
       //ssdt->Checksum = 0;
       //ssdt->Checksum = (UINT8)(256 - Checksum8(ssdt, ssdt->Length));
 
       aml_destroy_node(root);
+      if (UseCache) {
+        PmSsdtCachePut(CacheKey, ssdt);
+      }
 
       if (gSettings.GeneratePStates && !gSettings.HWP) {
         if (gSettings.PluginType && gSettings.GeneratePluginType) {
@@ -513,10 +750,24 @@ SSDT_TABLE *generate_cst_ssdt(EFI_ACPI_2_0_FIXED_ACPI_DESCRIPTION_TABLE* fadt, U
 //  AML_CHUNK* ret;
   UINTN i;
   SSDT_TABLE *ssdt;
+  BOOLEAN UseCache;
+  XBuffer<UINT8> CacheKey;
   
   if (!fadt) {
     return NULL;
   }
+
+  UseCache = GlobalConfig.PmSsdtCache;
+  if (UseCache) {
+    PmSsdtCacheKey(CacheKey, PM_SSDT_CST, Number);
+    CacheKey.cat(fadt->Pm1aEvtBlk);
+    CacheKey.cat(fadt->PLvl2Lat);
+    CacheKey.cat(fadt->PLvl3Lat);
+    ssdt = PmSsdtCacheGet(CacheKey);
+    if (ssdt) {
+      return ssdt;
+    }
+  }
   
   acpi_cpu_p_blk = fadt->Pm1aEvtBlk + 0x10;
   c2_enabled = c2_enabled || (fadt->PLvl2Lat < 100);
@@ -680,18 +931,17 @@ SSDT_TABLE *generate_cst_ssdt(EFI_ACPI_2_0_FIXED_ACPI_DESCRIPTION_TABLE* fadt, U
 
   }
   
-  aml_calculate_size(root);
-  
-  ssdt = (SSDT_TABLE *)AllocateZeroPool(root->Size);
+  ssdt = (SSDT_TABLE *)AllocateZeroPool(aml_max_size(root));
   
-  aml_write_node(root, (CHAR8*)ssdt, 0);
-  
-  ssdt->Length = root->Size;
+  ssdt->Length = aml_write_node(root, (CHAR8*)ssdt, 0);
   FixChecksum(ssdt);
 //  ssdt->Checksum = 0;
 //  ssdt->Checksum = (UINT8)(256 - Checksum8((void*)ssdt, ssdt->Length));
   
   aml_destroy_node(root);
+  if (UseCache) {
+    PmSsdtCachePut(CacheKey, ssdt);
+  }
   
   //dumpPhysAddr("C-States SSDT content: ", ssdt, ssdt->Length);
   
@@ -38,6 +38,8 @@
 UINT32      hex2bin(IN const CHAR8 *hex, OUT UINT8 *bin, UINT32 len);
 BOOLEAN     IsHexDigit (CHAR8 c);
 UINT8       hexstrtouint8 (CONST CHAR8* buf); //one or two hex letters to one byte
+// Len bytes to 2*Len hex digits and a terminating 0 in Out, SSE2 when enabled
+void        BytesToHex(IN const UINT8 *Data, IN UINTN Len, OUT CHAR8 *Out, IN BOOLEAN Upper);
 
 
 #ifdef __cplusplus
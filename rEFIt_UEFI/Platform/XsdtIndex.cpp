@@ -0,0 +1,224 @@
+/*
+ * XsdtIndex.cpp
+ *
+ * The signatures are hashed into Slots with linear probing. An XSDT has a few tens of different
+ * signatures, if ever the slots are full the lists are searched one by one.
+ */
+
+#include "XsdtIndex.h"
+
+static UINT32 SlotOf(UINT32 Signature)
+{
+  return (Signature * 2654435761U) >> 26; // 64 slots
+}
+
+static size_t LowerBound(const XArray<UINT32>& List, UINT32 Index)
+{
+  size_t Lo = 0;
+  size_t Hi = List.size();
+  size_t Mid;
+
+  while (Lo < Hi) {
+    Mid = (Lo + Hi) / 2;
+    if (List.ElementAt(Mid) < Index) {
+      Lo = Mid + 1;
+    } else {
+      Hi = Mid;
+    }
+  }
+  return Lo;
+}
+
+static EFI_ACPI_DESCRIPTION_HEADER* TableOf(UINT64 Entry)
+{
+  return (EFI_ACPI_DESCRIPTION_HEADER*)(UINTN)Entry;
+}
+
+void XsdtIndex::Reset()
+{
+  Source = NULL;
+  Entries.setEmpty();
+  MergedPages.setEmpty();
+  Lists.setEmpty();
+  SetMem(Slots, sizeof(Slots), 0);
+}
+
+XSDT_SIGNATURE_LIST* XsdtIndex::FindList(UINT32 Signature) const
+{
+  UINT32 Slot = SlotOf(Signature);
+  UINT32 i;
+  size_t List;
+
+  for (i = 0; i < XSDT_INDEX_SLOTS; i++) {
+    List = Slots[(Slot + i) % XSDT_INDEX_SLOTS];
+    if (List == 0) {
+      return NULL;
+    }
+    if (Lists[List - 1].Signature == Signature) {
+      return (XSDT_SIGNATURE_LIST*)&Lists[List - 1];
+    }
+  }
+  //the slots are full
+  for (List = XSDT_INDEX_SLOTS; List < Lists.size(); List++) {
+    if (Lists[List].Signature == Signature) {
+      return (XSDT_SIGNATURE_LIST*)&Lists[List];
+    }
+  }
+  return NULL;
+}
+
+XSDT_SIGNATURE_LIST& XsdtIndex::GetList(UINT32 Signature)
+{
+  XSDT_SIGNATURE_LIST* List = FindList(Signature);
+  UINT32 Slot = SlotOf(Signature);
+  UINT32 i;
+
+  if (List) {
+    return *List;
+  }
+  List = new XSDT_SIGNATURE_LIST;
+  List->Signature = Signature;
+  Lists.AddReference(List, true);
+  if (Lists.size() <= XSDT_INDEX_SLOTS) {
+    for (i = 0; i < XSDT_INDEX_SLOTS; i++) {
+      if (Slots[(Slot + i) % XSDT_INDEX_SLOTS] == 0) {
+        Slots[(Slot + i) % XSDT_INDEX_SLOTS] = (UINT16)Lists.size();
+        break;
+      }
+    }
+  }
+  return *List;
+}
+
+void XsdtIndex::Build(const void* Xsdt, const UINT64* Entry, UINT32 Count)
+{
+  UINT32 Index;
+  UINT64 Table;
+
+  Reset();
+  Source = Xsdt;
+  for (Index = 0; Index < Count; Index++) {
+    Table = ReadUnaligned64(Entry + Index);
+    Entries.Add(Table);
+    MergedPages.Add(0);
+    if (Table) {
+      GetList(TableOf(Table)->Signature).Entries.Add(Index);
+    }
+  }
+}
+
+UINT32 XsdtIndex::Find(UINT32 Signature, UINT64 TableId, UINTN MatchIndex) const
+{
+  const XSDT_SIGNATURE_LIST* List;
+  UINTN  MatchingCount = 0;
+  UINT32 Index;
+  size_t i;
+
+  if (Signature == 0) {
+    //any signature, same walk as the XSDT
+    for (Index = 0; Index < Entries.size(); Index++) {
+      if (!Entries.ElementAt((size_t)Index)) {
+        continue;
+      }
+      if ((TableId == 0 || TableOf(Entries.ElementAt((size_t)Index))->OemTableId == TableId) &&
+          (MatchIndex == MAX_UINTN || MatchingCount == MatchIndex)) {
+        return Index;
+      }
+      ++MatchingCount;
+    }
+    return XSDT_INDEX_NONE;
+  }
+
+  List = FindList(Signature);
+  if (!List) {
+    return XSDT_INDEX_NONE;
+  }
+  if (MatchIndex != MAX_UINTN) {
+    if (MatchIndex >= List->Entries.size()) {
+      return XSDT_INDEX_NONE;
+    }
+    Index = List->Entries.ElementAt((size_t)MatchIndex);
+    if (TableId != 0 && TableOf(Entries.ElementAt((size_t)Index))->OemTableId != TableId) {
+      return XSDT_INDEX_NONE;
+    }
+    return Index;
+  }
+  for (i = 0; i < List->Entries.size(); i++) {
+    Index = List->Entries.ElementAt(i);
+    if (TableId == 0 || TableOf(Entries.ElementAt((size_t)Index))->OemTableId == TableId) {
+      return Index;
+    }
+  }
+  return XSDT_INDEX_NONE;
+}
+
+UINT32 XsdtIndex::GetNth(UINT32 Signature, UINTN Nth) const
+{
+  const XSDT_SIGNATURE_LIST* List = FindList(Signature);
+
+  if (!List || Nth >= List->Entries.size()) {
+    return XSDT_INDEX_NONE;
+  }
+  return List->Entries.ElementAt((size_t)Nth);
+}
+
+UINT32 XsdtIndex::Add(UINT64 Table)
+{
+  UINT32 Index = (UINT32)Entries.size();
+
+  Entries.Add(Table);
+  MergedPages.Add(0);
+  if (Table) {
+    GetList(TableOf(Table)->Signature).Entries.Add(Index);
+  }
+  return Index;
+}
+
+void XsdtIndex::Drop(UINT32 Index)
+{
+  XSDT_SIGNATURE_LIST* List;
+  UINT64 Table = GetEntry(Index);
+  size_t i;
+
+  if (!Table) {
+    return;
+  }
+  List = FindList(TableOf(Table)->Signature);
+  if (List) {
+    i = LowerBound(List->Entries, Index);
+    if (i < List->Entries.size() && List->Entries.ElementAt(i) == Index) {
+      List->Entries.RemoveAtIndex(i);
+    }
+  }
+  Entries.ElementAt((size_t)Index) = 0;
+}
+
+void XsdtIndex::SetMergedPages(UINT32 Index, UINTN Pages)
+{
+  if (Index < MergedPages.size()) {
+    MergedPages.ElementAt((size_t)Index) = Pages;
+  }
+}
+
+void XsdtIndex::ClearMergedPages()
+{
+  size_t Index;
+
+  for (Index = 0; Index < MergedPages.size(); Index++) {
+    MergedPages.ElementAt(Index) = 0;
+  }
+}
+
+UINT32 XsdtIndex::Write(UINT64* Entry) const
+{
+  UINT32 Count = 0;
+  size_t Index;
+
+  for (Index = 0; Index < Entries.size(); Index++) {
+    if (Entries.ElementAt(Index)) {
+      WriteUnaligned64(Entry + Count, Entries.ElementAt(Index));
+      Count++;
+    }
+  }
+  return Count;
+}
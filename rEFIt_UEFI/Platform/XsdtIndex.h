@@ -0,0 +1,72 @@
+/*
+ * XsdtIndex.h
+ *
+ * Working copy of the XSDT entries while PatchACPI() merges, drops and inserts tables.
+ * The entries of each signature are listed in XSDT order and the lists are found by a hash
+ * of the signature, so a table is found without walking the whole XSDT.
+ * Dropped entries stay as 0 so that the indexes are the ones of the XSDT, the XSDT is written
+ * once at the end by Write().
+ */
+
+#ifndef PLATFORM_XSDTINDEX_H_
+#define PLATFORM_XSDTINDEX_H_
+
+#include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+#include "../cpp_foundation/XArray.h"
+#include "../cpp_foundation/XObjArray.h"
+
+#define XSDT_INDEX_SLOTS  64
+#define XSDT_INDEX_NONE   MAX_UINT32
+
+class XSDT_SIGNATURE_LIST
+{
+public:
+  UINT32         Signature;
+  XArray<UINT32> Entries;  // indexes of the tables having this signature, ascending
+
+  XSDT_SIGNATURE_LIST() : Signature(0), Entries() {}
+};
+
+class XsdtIndex
+{
+protected:
+  const void*                     Source;       // the XSDT the index was built from
+  XArray<UINT64>                  Entries;      // table address, 0 if dropped
+  XArray<UINTN>                   MergedPages;  // pages of a table merged from ACPI/patched, 0 if none
+  XObjArray<XSDT_SIGNATURE_LIST>  Lists;
+  UINT16                          Slots[XSDT_INDEX_SLOTS];  // list + 1, 0 if free
+
+  XSDT_SIGNATURE_LIST* FindList(UINT32 Signature) const;
+  XSDT_SIGNATURE_LIST& GetList(UINT32 Signature);
+
+public:
+  XsdtIndex() : Source(NULL), Entries(), MergedPages(), Lists() { SetMem(Slots, sizeof(Slots), 0); }
+
+  void    Build(const void* Xsdt, const UINT64* Entry, UINT32 Count);
+  void    Reset();
+  BOOLEAN IsBuiltFrom(const void* Xsdt) const { return Source != NULL && Source == Xsdt; }
+
+  UINT32  GetCount() const { return (UINT32)Entries.size(); }
+  UINT64  GetEntry(UINT32 Index) const { return (Index < Entries.size()) ? Entries.ElementAt((size_t)Index) : 0; }
+  UINT64* GetEntryPtr(UINT32 Index) { return Entries.data() + Index; }
+
+  // same semantic as ScanXSDT2(): TableId 0 matches any, MatchIndex counts the tables having this signature
+  // and is ignored if MAX_UINTN. Returns XSDT_INDEX_NONE if not found
+  UINT32  Find(UINT32 Signature, UINT64 TableId, UINTN MatchIndex) const;
+  // the n-th table having this signature, XSDT_INDEX_NONE after the last one
+  UINT32  GetNth(UINT32 Signature, UINTN Nth) const;
+
+  // the new table must have the signature of the replaced one
+  void    Replace(UINT32 Index, UINT64 Table) { Entries.ElementAt((size_t)Index) = Table; }
+  UINT32  Add(UINT64 Table);
+  void    Drop(UINT32 Index);
+
+  UINTN   GetMergedPages(UINT32 Index) const { return (Index < MergedPages.size()) ? MergedPages.ElementAt((size_t)Index) : 0; }
+  void    SetMergedPages(UINT32 Index, UINTN Pages);
+  void    ClearMergedPages();
+
+  // writes the entries not dropped, returns their count
+  UINT32  Write(UINT64* Entry) const;
+};
+
+#endif /* PLATFORM_XSDTINDEX_H_ */
@@ -15,6 +15,7 @@
 #include "../Platform/Settings.h"
 #include "Self.h"
 #include "SelfOem.h"
+#include "GpuIdTable.h"
 
 #ifndef DEBUG_ALL
 #define DEBUG_ATI 1
@@ -145,7 +146,7 @@ card_config_t card_configs[] = {
   {"Radeon",4},
 };
 
-radeon_card_info_t radeon_cards[] = {
+constexpr radeon_card_info_t radeon_cards[] = {
 
   // Earlier cards are not supported
   //
@@ -500,10 +501,6 @@ radeon_card_info_t radeon_cards[] = {
   { 0x6987,  CHIP_FAMILY_GREENLAND, "AMD Radeon Polaris 12",        kNull },
   { 0x6995,  CHIP_FAMILY_GREENLAND, "AMD Radeon Polaris 12",        kNull },
   { 0x699F,  CHIP_FAMILY_GREENLAND, "AMD Radeon RX550",        kNull },
-
-  { 0x7300,  CHIP_FAMILY_FIJI, "AMD Radeon R9 Fury",        kNull },
-
-  { 0x731F,  CHIP_FAMILY_NAVI10, "AMD Radeon RX5700",        kNull },
   /*
    6900 Topaz XT [Radeon R7 M260/M265]
    6901 Topaz PRO [Radeon R5 M255]
@@ -595,6 +592,10 @@ radeon_card_info_t radeon_cards[] = {
   { 0x7200,  CHIP_FAMILY_RV515, "ATI Radeon HD Desktop ",    kWormy  },
   { 0x7210,  CHIP_FAMILY_RV515, "ATI Radeon HD Mobile ",     kWormy  },
   { 0x7211,  CHIP_FAMILY_RV515, "ATI Radeon HD Mobile ",     kWormy  },
+
+  { 0x7300,  CHIP_FAMILY_FIJI, "AMD Radeon R9 Fury",        kNull },
+
+  { 0x731F,  CHIP_FAMILY_NAVI10, "AMD Radeon RX5700",        kNull },
   /*
    // R580
    { 0x7240,  CHIP_FAMILY_R580,  "ATI Radeon HD Desktop ", kAlopias },
@@ -672,16 +673,6 @@ radeon_card_info_t radeon_cards[] = {
   { 0x940B,  CHIP_FAMILY_R600, "ATI FireGL V8600",           kNull  },
   { 0x940F,  CHIP_FAMILY_R600, "ATI FireGL V7600",           kNull  },
 
-  // RV740
-  { 0x94A0,  CHIP_FAMILY_RV740, "ATI Radeon HD 4830M",       kFlicker },
-  { 0x94A1,  CHIP_FAMILY_RV740, "ATI Radeon HD 4860M",       kFlicker },
-  { 0x94A3,  CHIP_FAMILY_RV740, "ATI FirePro M7740",         kFlicker },
-  { 0x94B1,  CHIP_FAMILY_RV740, "ATI Radeon HD",             kFlicker },
-  { 0x94B3,  CHIP_FAMILY_RV740, "ATI Radeon HD 4770",        kFlicker },
-  { 0x94B4,  CHIP_FAMILY_RV740, "ATI Radeon HD 4700 Series", kFlicker },
-  { 0x94B5,  CHIP_FAMILY_RV740, "ATI Radeon HD 4770",        kFlicker },
-  { 0x94B9,  CHIP_FAMILY_RV740, "ATI Radeon HD",             kFlicker },
-
   //9440, 944A - Cardinal
   // RV770
   { 0x9440,  CHIP_FAMILY_RV770, "ATI Radeon HD 4870 ",            kMotmot  },
@@ -722,6 +713,16 @@ radeon_card_info_t radeon_cards[] = {
   { 0x949E,  CHIP_FAMILY_RV730, "ATI FirePro V5700 (FireGL)",   kGliff  },
   { 0x949F,  CHIP_FAMILY_RV730, "ATI FirePro V3750 (FireGL)",   kGliff  },
 
+  // RV740
+  { 0x94A0,  CHIP_FAMILY_RV740, "ATI Radeon HD 4830M",       kFlicker },
+  { 0x94A1,  CHIP_FAMILY_RV740, "ATI Radeon HD 4860M",       kFlicker },
+  { 0x94A3,  CHIP_FAMILY_RV740, "ATI FirePro M7740",         kFlicker },
+  { 0x94B1,  CHIP_FAMILY_RV740, "ATI Radeon HD",             kFlicker },
+  { 0x94B3,  CHIP_FAMILY_RV740, "ATI Radeon HD 4770",        kFlicker },
+  { 0x94B4,  CHIP_FAMILY_RV740, "ATI Radeon HD 4700 Series", kFlicker },
+  { 0x94B5,  CHIP_FAMILY_RV740, "ATI Radeon HD 4770",        kFlicker },
+  { 0x94B9,  CHIP_FAMILY_RV740, "ATI Radeon HD",             kFlicker },
+
   //94C8 -Iago
   // RV610
   /*
@@ -941,6 +942,24 @@ radeon_card_info_t radeon_cards[] = {
   { 0x0000,  CHIP_FAMILY_UNKNOW, "AMD Unknown",   kNull  }
 };
 
+// Sorted by device_id but the terminator, searched by binary search
+constexpr UINT64 GpuIdKey(const radeon_card_info_t& Info) { return Info.device_id; }
+
+#define RADEON_CARDS_COUNT (sizeof(radeon_cards) / sizeof(radeon_cards[0]) - 1)
+static_assert(GpuIdTableSorted(radeon_cards, 0, RADEON_CARDS_COUNT), "radeon_cards must be sorted by device_id");
+
+const radeon_card_info_t *get_radeon_card(UINT16 device_id)
+{
+  const radeon_card_info_t *info = GpuIdTableFind(radeon_cards, RADEON_CARDS_COUNT, device_id);
+  return (info != NULL) ? info : &radeon_cards[RADEON_CARDS_COUNT];
+}
+
+const radeon_card_info_t *get_radeon_card_brother(UINT16 device_id)
+{
+  UINTN Index = GpuIdTableLowerBound(radeon_cards, RADEON_CARDS_COUNT, device_id & ~0xf);
+  return (Index < RADEON_CARDS_COUNT && (radeon_cards[Index].device_id & ~0xf) == (device_id & ~0xf)) ? &radeon_cards[Index] : NULL;
+}
+
 //native ID for 10.8.3
 /*
  ATI7000
@@ -1933,6 +1952,7 @@ static BOOLEAN init_card(pci_dt_t *pci_dev)
   INTN  n_ports = 0;
   UINTN   ExpansionRom = 0;
   UINTN Reg1, Reg3, Reg5;
+  const radeon_card_info_t *info;
 
   card = (__typeof__(card))AllocateZeroPool(sizeof(card_t));
   if (!card) {
@@ -1940,15 +1960,12 @@ static BOOLEAN init_card(pci_dt_t *pci_dev)
   }
   card->pci_dev = pci_dev;
 
-  for (i = 0; radeon_cards[i].device_id ; i++) {
-    if (radeon_cards[i].device_id != pci_dev->device_id) {
-      continue;
-    }
-    card->info = (__typeof__(card->info))AllocateCopyPool(sizeof(radeon_card_info_t), &radeon_cards[i]);
+  info = get_radeon_card(pci_dev->device_id);
+  if (info->device_id != 0) {
+    card->info = (__typeof__(card->info))AllocateCopyPool(sizeof(radeon_card_info_t), info);
     if (!card->info->cfg_name) {
       card->info->cfg_name = kRadeon;
     }
-    break;
   }
 
   for (j = 0; j < NGFX; j++) {
@@ -1965,11 +1982,9 @@ static BOOLEAN init_card(pci_dt_t *pci_dev)
 	  DBG("Unsupported ATI card! Device ID: [%04hX:%04hX] Subsystem ID: [%08X] \n",
         pci_dev->vendor_id, pci_dev->device_id, pci_dev->subsys_id.subsys_id);
     DBG("search for brothers family\n");
-    for (i = 0; radeon_cards[i].device_id ; i++) {
-      if ((radeon_cards[i].device_id & ~0xf) == (pci_dev->device_id & ~0xf)) {
-        card->info = (__typeof__(card->info))AllocateCopyPool(sizeof(radeon_card_info_t), &radeon_cards[i]);
-        break;
-      }
+    info = get_radeon_card_brother(pci_dev->device_id);
+    if (info != NULL) {
+      card->info = (__typeof__(card->info))AllocateCopyPool(sizeof(radeon_card_info_t), info);
     }
     if (!card->info->cfg_name) {
       DBG("...compatible config is not found, set common\n");
@@ -2085,7 +2100,7 @@ BOOLEAN setup_ati_devprop(LOADER_ENTRY *Entry, pci_dt_t *ati_dev)
   CHAR8 compatible[64];
   XString8 devicepath;
   UINT32 FakeID = 0;
-  UINTN i;
+  DEV_PROPERTY *Prop;
 
   if (!init_card(ati_dev)) {
     return FALSE;
@@ -2139,21 +2154,15 @@ BOOLEAN setup_ati_devprop(LOADER_ENTRY *Entry, pci_dt_t *ati_dev)
   }
 
 
-  if (gSettings.NrAddProperties != 0xFFFE) {
-    for (i = 0; i < gSettings.NrAddProperties; i++) {
-      if (gSettings.AddProperties[i].Device != DEV_ATI) {
-        continue;
-      }
-
-      if (!gSettings.AddProperties[i].MenuItem.BValue) {
-        //DBG("  disabled property Key: %s, len: %d\n", gSettings.AddProperties[i].Key, gSettings.AddProperties[i].ValueLen);
-      } else {
-        devprop_add_value(card->device,
-                          gSettings.AddProperties[i].Key,
-                          (UINT8*)gSettings.AddProperties[i].Value,
-                          gSettings.AddProperties[i].ValueLen);
-        //DBG("  added property Key: %s, len: %d\n", gSettings.AddProperties[i].Key, gSettings.AddProperties[i].ValueLen);
-      }
+  for (Prop = GetAddProperties(DEV_ATI); Prop; Prop = Prop->Next) {
+    if (!Prop->MenuItem.BValue) {
+      //DBG("  disabled property Key: %s, len: %d\n", Prop->Key, Prop->ValueLen);
+    } else {
+      devprop_add_value(card->device,
+                        Prop->Key,
+                        (UINT8*)Prop->Value,
+                        Prop->ValueLen);
+      //DBG("  added property Key: %s, len: %d\n", Prop->Key, Prop->ValueLen);
     }
   }
 
@@ -307,7 +307,12 @@ BOOLEAN get_dual_link_val(value_t *val, INTN index, BOOLEAN Sier);
 BOOLEAN get_name_pci_val(value_t *val, INTN index, BOOLEAN Sier);
 
 extern card_config_t card_configs[];
-extern radeon_card_info_t radeon_cards[];
+extern const radeon_card_info_t radeon_cards[];
+
+// entry of device_id in radeon_cards, or its last entry "AMD Unknown" (device_id 0)
+const radeon_card_info_t *get_radeon_card(UINT16 device_id);
+// first entry with the same device_id but the low nibble, or NULL
+const radeon_card_info_t *get_radeon_card_brother(UINT16 device_id);
 extern AtiDevProp ati_devprop_list[];
 extern const CHAR8 *chip_family_name[];
 
@@ -88,6 +88,149 @@ long base64_decode_block(const char* code_in, const int length_in, char* plainte
 }
 
 
+//
+// Table driven decoder, 4 chars -> 3 bytes, used by Base64DecodeClover().
+// Chars outside of the alphabet (whitespace, '=' and anything else) are skipped, like base64_decode_value() does.
+// The SSSE3 path translates and packs 16 chars -> 12 bytes at once, when all 16 are in the alphabet.
+// GCC and clang vector extensions and builtins are used instead of <tmmintrin.h> because of freestanding build.
+//
+#define BASE64_SKIP  0xFF
+
+static const UINT8 Base64Values[256] = {
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x3E, 0xFF, 0xFF, 0xFF, 0x3F,
+  0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
+  0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+  0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define BASE64_SSSE3 1
+typedef char   B64_V16 __attribute__((vector_size(16)));
+typedef UINT8  B64_V16U __attribute__((vector_size(16)));
+typedef short  B64_V8S __attribute__((vector_size(16)));
+typedef int    B64_V4S __attribute__((vector_size(16)));
+typedef UINT8  B64_V16U_UNALIGNED __attribute__((vector_size(16), aligned(1)));
+#else
+#define BASE64_SSSE3 0
+#endif
+
+static BOOLEAN Base64Simd = FALSE;
+
+void Base64SetSimd(BOOLEAN Enable)
+{
+	Base64Simd = Enable && BASE64_SSSE3;
+}
+
+BOOLEAN Base64GetSimd(void)
+{
+	return Base64Simd;
+}
+
+#if BASE64_SSSE3 == 1
+// Decodes 16 chars into the first 12 bytes of Out (16 bytes are written). FALSE if a char is not in the alphabet.
+__attribute__((target("ssse3")))
+static BOOLEAN Base64Decode16Ssse3(const UINT8 *In, UINT8 *Out)
+{
+	// classification by nibbles : a char is valid when LutLo[low nibble] & LutHi[high nibble] == 0
+	const B64_V16 LutLo = { 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A };
+	const B64_V16 LutHi = { 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10 };
+	// offset to add by high nibble, '/' is moved to slot 1
+	const B64_V16 LutRoll = { 0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0 };
+	const B64_V16 Pack = { 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1 };
+	const B64_V16U Nibble = { 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F };
+	const B64_V16 MergeBytes = { 0x40, 0x01, 0x40, 0x01, 0x40, 0x01, 0x40, 0x01, 0x40, 0x01, 0x40, 0x01, 0x40, 0x01, 0x40, 0x01 };
+	const B64_V8S MergeWords = { 0x1000, 0x0001, 0x1000, 0x0001, 0x1000, 0x0001, 0x1000, 0x0001 };
+	B64_V16U Src = *(const B64_V16U_UNALIGNED *)In;
+	B64_V16U Hi = (Src >> 4) & Nibble;
+	B64_V16U Lo = Src & Nibble;
+	B64_V16  Check, Roll, Values;
+	B64_V4S  Words;
+
+	Check = __builtin_ia32_pshufb128(LutLo, (B64_V16)Lo) & __builtin_ia32_pshufb128(LutHi, (B64_V16)Hi);
+	if (__builtin_ia32_pmovmskb128((B64_V16)(Check != 0)) != 0) {
+		return FALSE;
+	}
+	Roll = __builtin_ia32_pshufb128(LutRoll, (B64_V16)Hi + (B64_V16)(Src == '/'));
+	Values = (B64_V16)Src + Roll;
+	// 00aaaaaa 00bbbbbb 00cccccc 00dddddd -> aaaaaabb bbbbcccc ccdddddd, in each 32 bits, then the 12 bytes together
+	Words = __builtin_ia32_pmaddwd128(__builtin_ia32_pmaddubsw128((B64_V16)Values, MergeBytes), MergeWords);
+	*(B64_V16U_UNALIGNED *)Out = (B64_V16U)__builtin_ia32_pshufb128((B64_V16)Words, Pack);
+	return TRUE;
+}
+#endif
+
+// Decodes InLen chars into Out, that has OutSize bytes, at least InLen / 4 * 3 + 2. Returns the decoded size.
+static UINTN Base64DecodeBuffer(const UINT8 *In, UINTN InLen, UINT8 *Out, UINTN OutSize)
+{
+	const UINT8 *InEnd = In + InLen;
+	UINT8       *OutStart = Out;
+	UINT8       *OutEnd = Out + OutSize;
+	UINT32      Acc = 0;
+	UINTN       Count = 0; // chars in Acc
+	UINT8       A, B, C, D;
+
+	while (In < InEnd) {
+		if (Count == 0) {
+#if BASE64_SSSE3 == 1
+			if (Base64Simd && InEnd - In >= 16 && OutEnd - Out >= 16 && Base64Decode16Ssse3(In, Out)) {
+				In += 16;
+				Out += 12;
+				continue;
+			}
+#endif
+			if (InEnd - In >= 4) {
+				A = Base64Values[In[0]];
+				B = Base64Values[In[1]];
+				C = Base64Values[In[2]];
+				D = Base64Values[In[3]];
+				if (((A | B | C | D) & 0x80) == 0) {
+					Acc = ((UINT32)A << 18) | ((UINT32)B << 12) | ((UINT32)C << 6) | D;
+					Out[0] = (UINT8)(Acc >> 16);
+					Out[1] = (UINT8)(Acc >> 8);
+					Out[2] = (UINT8)Acc;
+					In += 4;
+					Out += 3;
+					continue;
+				}
+			}
+		}
+		// one char at a time around whitespace and padding
+		A = Base64Values[*In++];
+		if (A == BASE64_SKIP) {
+			continue;
+		}
+		Acc = (Acc << 6) | A;
+		if (++Count == 4) {
+			Out[0] = (UINT8)(Acc >> 16);
+			Out[1] = (UINT8)(Acc >> 8);
+			Out[2] = (UINT8)Acc;
+			Out += 3;
+			Count = 0;
+		}
+	}
+	// incomplete last group, as base64_decode_block() does
+	if (Count == 2) {
+		*Out++ = (UINT8)(Acc >> 4);
+	} else if (Count == 3) {
+		*Out++ = (UINT8)(Acc >> 10);
+		*Out++ = (UINT8)(Acc >> 2);
+	}
+	return (UINTN)(Out - OutStart);
+}
+
+
 /** UEFI interface to base54 decode.
  * Decodes EncodedData into a new allocated buffer and returns it. Caller is responsible to FreePool() it.
  * If DecodedSize != NULL, then size od decoded data is put there.
@@ -96,10 +239,13 @@ long base64_decode_block(const char* code_in, const int length_in, char* plainte
 UINT8 *Base64DecodeClover(IN CONST CHAR8 *EncodedData, OUT UINTN *DecodedSize)
 {
 	UINTN				EncodedSize;
-	INTN				DecodedSizeInternal;
+	UINTN				DecodedSizeInternal;
+	UINTN				AllocatedSize;
 	UINT8				*DecodedData;
-	base64_decodestate	state_in;
 
+	if (DecodedSize != NULL) {
+		*DecodedSize = 0;
+	}
 	if (EncodedData == NULL) {
 		return NULL;
 	}
@@ -107,11 +253,14 @@ UINT8 *Base64DecodeClover(IN CONST CHAR8 *EncodedData, OUT UINTN *DecodedSize)
 	if (EncodedSize == 0) {
 		return NULL;
 	}
-	// to simplify, we'll allocate the same size, although smaller size is needed
-	DecodedData = (__typeof__(DecodedData))AllocateZeroPool(EncodedSize);
+	// exact size when there is no whitespace, the SSSE3 path falls back to the scalar one in the last 16 bytes
+	AllocatedSize = EncodedSize / 4 * 3 + 2;
+	DecodedData = (__typeof__(DecodedData))AllocatePool(AllocatedSize);
+	if (DecodedData == NULL) {
+		return NULL;
+	}
 
-	base64_init_decodestate(&state_in);
-	DecodedSizeInternal = base64_decode_block(EncodedData, (const int)EncodedSize, (char*) DecodedData, &state_in);
+	DecodedSizeInternal = Base64DecodeBuffer((const UINT8*)EncodedData, EncodedSize, DecodedData, AllocatedSize);
 
 	if ( DecodedSizeInternal == 0 ) {
     FreePool(DecodedData);
@@ -119,8 +268,7 @@ UINT8 *Base64DecodeClover(IN CONST CHAR8 *EncodedData, OUT UINTN *DecodedSize)
   }
 
 	if (DecodedSize != NULL) {
-    if ( DecodedSizeInternal < 0 ) panic("Base64DecodeClover : DecodedSizeInternal < 0");
-		*DecodedSize = (UINTN)DecodedSizeInternal;
+		*DecodedSize = DecodedSizeInternal;
 	}
 
 	return DecodedData;
@@ -57,6 +57,10 @@ UINT8
      OUT  UINTN *DecodedSize
   );
 
+// SSSE3 path of Base64DecodeClover(), enabled by GetCPUProperties() when the CPU has it
+void Base64SetSimd(BOOLEAN Enable);
+BOOLEAN Base64GetSimd(void);
+
 
 #endif /* BASE64_CDECODE_H */
 
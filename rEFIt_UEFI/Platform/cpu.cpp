@@ -38,6 +38,11 @@
 #include "cpu.h"
 #include "smbios.h"
 #include "kernel_patcher.h"
+#include "MemoryOperation.h"
+#include "PciSnapshot.h"
+#include "Sha256.h"
+#include "b64cdecode.h"
+#include "Checksum.h"
 #include "../Platform/Settings.h"
 
 #ifndef DEBUG_ALL
@@ -113,10 +118,7 @@ void GetCPUProperties (void)
   UINT64    msr = 0;
   
   EFI_STATUS      Status;
-  EFI_HANDLE      *HandleBuffer;
   //  EFI_GUID        **ProtocolGuidArray;
-  EFI_PCI_IO_PROTOCOL *PciIo;
-  PCI_TYPE00          Pci;
   UINTN         HandleCount;
   //  UINTN         ArrayCount;
   UINTN         HandleIndex;
@@ -127,10 +129,6 @@ void GetCPUProperties (void)
   UINT64        ExternalClock;
   UINT64        tmpU;
   UINT16        did, vid;
-  UINTN         Segment;
-  UINTN         Bus;
-  UINTN         Device;
-  UINTN         Function;
   CHAR8         str[128];
 
   DbgHeader("GetCPUProperties");
@@ -189,6 +187,14 @@ void GetCPUProperties (void)
   gCPUStructure.ExtFeatures  = quad(gCPUStructure.CPUID[CPUID_81][ECX], gCPUStructure.CPUID[CPUID_81][EDX]);
 
   DBG(" The CPU%s supported SSE4.1\n", (gCPUStructure.Features & CPUID_FEATURE_SSE4_1)?"":" not");
+  MemoryOperationSetSimd((gCPUStructure.Features & CPUID_FEATURE_SSE2) != 0);
+  Base64SetSimd((gCPUStructure.Features & CPUID_FEATURE_SSSE3) != 0);
+  Adler32SetSimd((gCPUStructure.Features & CPUID_FEATURE_SSSE3) != 0);
+  // SHA extensions : CPUID.(EAX=7,ECX=0):EBX bit 29
+  if (gCPUStructure.CPUID[CPUID_0][EAX] >= 7) {
+    AsmCpuidEx(7, 0, NULL, &reg[EBX], NULL, NULL);
+    Sha256SetShaNi((reg[EBX] & BIT29) != 0 && (gCPUStructure.Features & CPUID_FEATURE_SSE4_1) != 0);
+  }
   /* Pack CPU Family and Model */
   if (gCPUStructure.Family == 0x0f) {
     gCPUStructure.Family += gCPUStructure.Extfamily;
@@ -414,7 +420,11 @@ void GetCPUProperties (void)
     DBG(" TSC/CCC Information Leaf:\n");
     DBG("  numerator     : %d\n", Num);
     DBG("  denominator   : %d\n", Denom);
-    if (Num && Denom) {
+    if (Num && Denom && gCPUStructure.CPUID[CPUID_15][ECX]) {
+      // the crystal clock is enumerated, it is the ART frequency itself
+      gCPUStructure.ARTFrequency = gCPUStructure.CPUID[CPUID_15][ECX];
+      DBG(" Crystal clock ARTFrequency: %lld\n", gCPUStructure.ARTFrequency);
+    } else if (Num && Denom) {
       gCPUStructure.ARTFrequency = DivU64x32(MultU64x32(gCPUStructure.TSCCalibr, Denom), Num);
       DBG(" Calibrated ARTFrequency: %lld\n", gCPUStructure.ARTFrequency);
       UINT64 Stokg = DivU64x32(gCPUStructure.ARTFrequency + 49999, 100000);
@@ -1096,45 +1106,32 @@ void GetCPUProperties (void)
     // info: https://en.wikipedia.org/wiki/List_of_Intel_Xeon_microprocessors#Nehalem-based_Xeons
     qpimult = 2; //init
     /* Scan PCI BUS For QPI Frequency */
-    // get all PciIo handles
-    Status = gBS->LocateHandleBuffer(ByProtocol, &gEfiPciIoProtocolGuid, NULL, &HandleCount, &HandleBuffer);
-    if (Status == EFI_SUCCESS) {
-      for (HandleIndex = 0; HandleIndex < HandleCount; HandleIndex++) {
-        Status = gBS->HandleProtocol(HandleBuffer[HandleIndex], &gEfiPciIoProtocolGuid, (void **) &PciIo);
-        if (!EFI_ERROR(Status)) {
-          /* Read PCI BUS */
-          Status = PciIo->GetLocation (PciIo, &Segment, &Bus, &Device, &Function);
-          if ((Bus & 0x3F) != 0x3F) {
-            continue;
-          }
-          Status = PciIo->Pci.Read (
-                                    PciIo,
-                                    EfiPciIoWidthUint32,
-                                    0,
-                                    sizeof (Pci) / sizeof (UINT32),
-                                    &Pci
-                                    );
-          vid = Pci.Hdr.VendorId & 0xFFFF;
-          did = Pci.Hdr.DeviceId & 0xFF00;
-          if ((vid == 0x8086) && (did >= 0x2C00)
-              //Slice - why 2:1? Intel spec said 3:4 - QCLK_RATIO at offset 0x50
-              //  && (Device == 2) && (Function == 1)) {
-              && (Device == 3) && (Function == 4)) {
-            DBG("Found QCLK_RATIO at bus 0x%02llX dev=%llX funs=%llX\n", Bus, Device, Function);
-            Status = PciIo->Mem.Read (
-                                      PciIo,
-                                      EfiPciIoWidthUint32,
-                                      EFI_PCI_IO_PASS_THROUGH_BAR,
-                                      0x50,
-                                      1,
-                                      &qpimult
-                                      );
-            DBG("qpi read from PCI %X\n", qpimult & 0x1F);
-            if (EFI_ERROR(Status)) continue;
-            qpimult &= 0x1F; //bits 0:4
-            break;
-          }
-        }
+    HandleCount = PciSnapshotCount();
+    for (HandleIndex = 0; HandleIndex < HandleCount; HandleIndex++) {
+      const PCI_SNAPSHOT_DEVICE *PciDev = PciSnapshotDevice(HandleIndex);
+      /* Read PCI BUS */
+      if ((PciDev->Bus & 0x3F) != 0x3F) {
+        continue;
+      }
+      vid = PciDev->Pci.Hdr.VendorId & 0xFFFF;
+      did = PciDev->Pci.Hdr.DeviceId & 0xFF00;
+      if ((vid == 0x8086) && (did >= 0x2C00)
+          //Slice - why 2:1? Intel spec said 3:4 - QCLK_RATIO at offset 0x50
+          //  && (Device == 2) && (Function == 1)) {
+          && (PciDev->Device == 3) && (PciDev->Function == 4)) {
+        DBG("Found QCLK_RATIO at bus 0x%02llX dev=%llX funs=%llX\n", PciDev->Bus, PciDev->Device, PciDev->Function);
+        Status = PciDev->PciIo->Mem.Read (
+                                          PciDev->PciIo,
+                                          EfiPciIoWidthUint32,
+                                          EFI_PCI_IO_PASS_THROUGH_BAR,
+                                          0x50,
+                                          1,
+                                          &qpimult
+                                          );
+        DBG("qpi read from PCI %X\n", qpimult & 0x1F);
+        if (EFI_ERROR(Status)) continue;
+        qpimult &= 0x1F; //bits 0:4
+        break;
       }
     }
     
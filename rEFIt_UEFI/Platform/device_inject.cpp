@@ -11,6 +11,7 @@
 #include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
 #include "device_inject.h"
 #include "FixBiosDsdt.h"
+#include "PciSnapshot.h"
 #include "../include/Devices.h"
 #include "../refit/lib.h"
 #include "../Platform/Settings.h"
@@ -90,16 +91,25 @@ UINT32 pci_config_read32(pci_dt_t *PciDt, UINT8 reg)
   EFI_PCI_IO_PROTOCOL		*PciIo;
   PCI_TYPE00				Pci;
   UINT32					res;
+  const PCI_SNAPSHOT_DEVICE *PciDev = PciSnapshotFindHandle(PciDt->DeviceHandle);
 
-  Status = gBS->OpenProtocol(PciDt->DeviceHandle, &gEfiPciIoProtocolGuid, (void**)&PciIo, gImageHandle, NULL, EFI_OPEN_PROTOCOL_GET_PROTOCOL);
-  if (EFI_ERROR(Status)){
-    DBG("pci_config_read cant open protocol\n");
-    return 0;
-  }
-  Status = PciIo->Pci.Read(PciIo,EfiPciIoWidthUint32, 0, sizeof(Pci) / sizeof(UINT32), &Pci);
-  if (EFI_ERROR(Status)) {
-    DBG("pci_config_read cant read pci\n");
-    return 0;
+  if (PciDev != NULL) {
+    // the header doesn't change, but Command and Status do
+    if (reg < sizeof(PciDev->Pci) && (reg & ~3) != PCI_COMMAND_OFFSET) {
+      return ((UINT32*)&PciDev->Pci)[reg / 4];
+    }
+    PciIo = PciDev->PciIo;
+  } else {
+    Status = gBS->OpenProtocol(PciDt->DeviceHandle, &gEfiPciIoProtocolGuid, (void**)&PciIo, gImageHandle, NULL, EFI_OPEN_PROTOCOL_GET_PROTOCOL);
+    if (EFI_ERROR(Status)){
+      DBG("pci_config_read cant open protocol\n");
+      return 0;
+    }
+    Status = PciIo->Pci.Read(PciIo,EfiPciIoWidthUint32, 0, sizeof(Pci) / sizeof(UINT32), &Pci);
+    if (EFI_ERROR(Status)) {
+      DBG("pci_config_read cant read pci\n");
+      return 0;
+    }
   }
   Status = PciIo->Pci.Read (
                             PciIo,
@@ -132,6 +142,10 @@ DevPropDevice *devprop_add_device_pci(DevPropString *StringBuf, pci_dt_t *PciDt,
   if (StringBuf == NULL /* || PciDt == NULL */) {
     return NULL;
   }
+  if (StringBuf->numentries >= MAX_NUM_DEVICES) {
+    DBG("devprop: more than %d devices\n", MAX_NUM_DEVICES);
+    return NULL;
+  }
 
   if (!DevicePath && (PciDt != 0)) {
   DevicePath = DevicePathFromHandle(PciDt->DeviceHandle);
@@ -222,6 +236,7 @@ BOOLEAN devprop_add_value(DevPropDevice *device, CONST CHAR8 *nm, UINT8 *vl, UIN
   UINTN i, l;
   UINT32 *datalength;
   UINT8 *newdata;
+  UINT32 newsize;
 
   if(!device || !nm || !vl /*|| !len*/) //rehabman: allow zero length data
     return FALSE;
@@ -232,9 +247,25 @@ BOOLEAN devprop_add_value(DevPropDevice *device, CONST CHAR8 *nm, UINT8 *vl, UIN
    DBG("\n"); */
   l = AsciiStrLen(nm);
   length = (UINT32)((l * 2) + len + (2 * sizeof(UINT32)) + 2);
-  data = (UINT8*)AllocateZeroPool(length);
-  if(!data)
-    return FALSE;
+  offset = device->length - (24 + (6 * device->num_pci_devpaths));
+
+  // the values of a device are added one by one, the data grows geometrically
+  if (!device->data || offset + length > device->dataAllocated) {
+    newsize = MAX(offset + length, device->dataAllocated * 2);
+    newdata = (UINT8*)AllocatePool(newsize);
+    if(!newdata)
+      return FALSE;
+    if((device->data) && (offset > 1)) {
+      CopyMem((void*)newdata, (void*)device->data, offset);
+    }
+    if (device->data) {
+      FreePool(device->data);
+    }
+    device->data = newdata;
+    device->dataAllocated = newsize;
+  }
+  data = device->data + offset;
+  ZeroMem(data, length);
 
   off= 0;
 
@@ -256,76 +287,81 @@ BOOLEAN devprop_add_value(DevPropDevice *device, CONST CHAR8 *nm, UINT8 *vl, UIN
     data[off] = *vl++;
   }
 
-  offset = device->length - (24 + (6 * device->num_pci_devpaths));
-
-  newdata = (UINT8*)AllocateZeroPool((length + offset));
-  if(!newdata)
-    return FALSE;
-  if((device->data) && (offset > 1)) {
- 		CopyMem((void*)newdata, (void*)device->data, offset);
-  }
-
-  CopyMem((void*)(newdata + offset), (void*)data, length);
-
   device->length += length;
   device->string->length += length;
   device->numentries++;
-  device->data = newdata;
 
-  FreePool(data);
   return TRUE;
 }
 
-CHAR8 *devprop_generate_string(DevPropString *StringBuf)
+//
+// The device-properties blob, in the byte order of the EFI variable : StringBuf->length bytes.
+// Writes nothing and returns 0 if BufferSize is smaller.
+//
+UINT32 devprop_serialize(DevPropString *StringBuf, UINT8 *Buffer, UINT32 BufferSize)
 {
-  UINTN len = StringBuf->length * 2;
-  INT32 i = 0;
-  UINT32 x = 0;
-  CHAR8 *buffer = (CHAR8*)AllocatePool(len + 1);
-  CHAR8 *ptr = buffer;
+  UINT8 *p = Buffer;
+  INT32 i;
+  UINT32 x;
 
-  //   DBG("devprop_generate_string\n");
-  if(!buffer)
-    return NULL;
+  if (!StringBuf || !Buffer || BufferSize < StringBuf->length) {
+    return 0;
+  }
 
-	snprintf(buffer, len, "%08X%08X%04hX%04hX", SwapBytes32(StringBuf->length), StringBuf->WHAT2,
-              SwapBytes16(StringBuf->numentries), StringBuf->WHAT3);
-  buffer += 24;
-
-  while(i < StringBuf->numentries) {
-    UINT8 *dataptr = StringBuf->entries[i]->data;
-	  snprintf(buffer, len, "%08X%04hX%04hX", SwapBytes32(StringBuf->entries[i]->length),
-                SwapBytes16(StringBuf->entries[i]->numentries), StringBuf->entries[i]->WHAT2); //FIXME: wrong buffer sizes!
-
-    buffer += 16;
-	  snprintf(buffer, len, "%02hhX%02hhX%04hX%08X%08X", StringBuf->entries[i]->acpi_dev_path.type,
-                StringBuf->entries[i]->acpi_dev_path.subtype,
-                SwapBytes16(StringBuf->entries[i]->acpi_dev_path.length),
-                SwapBytes32(StringBuf->entries[i]->acpi_dev_path._HID),
-                SwapBytes32(StringBuf->entries[i]->acpi_dev_path._UID));
-
-    buffer += 24;
-    for(x = 0; x < StringBuf->entries[i]->num_pci_devpaths; x++) {
-		snprintf(buffer, len, "%02hhX%02hhX%04hX%02hhX%02hhX", StringBuf->entries[i]->pci_dev_path[x].type,
-                  StringBuf->entries[i]->pci_dev_path[x].subtype,
-                  SwapBytes16(StringBuf->entries[i]->pci_dev_path[x].length),
-                  StringBuf->entries[i]->pci_dev_path[x].function,
-                  StringBuf->entries[i]->pci_dev_path[x].device);
-      buffer += 12;
+  // WHAT fields were always written as is in the hex string, so they are big endian
+  WriteUnaligned32((UINT32*)p, StringBuf->length);
+  WriteUnaligned32((UINT32*)(p + 4), SwapBytes32(StringBuf->WHAT2));
+  WriteUnaligned16((UINT16*)(p + 8), StringBuf->numentries);
+  WriteUnaligned16((UINT16*)(p + 10), SwapBytes16(StringBuf->WHAT3));
+  p += 12;
+
+  for (i = 0; i < StringBuf->numentries; i++) {
+    DevPropDevice *device = StringBuf->entries[i];
+    UINT32 datalength = device->length - (24 + (6 * device->num_pci_devpaths));
+
+    WriteUnaligned32((UINT32*)p, device->length);
+    WriteUnaligned16((UINT16*)(p + 4), device->numentries);
+    WriteUnaligned16((UINT16*)(p + 6), SwapBytes16(device->WHAT2));
+    p += 8;
+    // the device path nodes are packed structs in the EFI layout
+    CopyMem(p, &device->acpi_dev_path, sizeof(device->acpi_dev_path));
+    p += sizeof(device->acpi_dev_path);
+    for (x = 0; x < device->num_pci_devpaths; x++) {
+      CopyMem(p, &device->pci_dev_path[x], sizeof(device->pci_dev_path[x]));
+      p += sizeof(device->pci_dev_path[x]);
+    }
+    CopyMem(p, &device->path_end, sizeof(device->path_end));
+    p += sizeof(device->path_end);
+    if (datalength > 0) {
+      CopyMem(p, device->data, datalength);
+      p += datalength;
     }
+  }
+  return (UINT32)(p - Buffer);
+}
 
-	  snprintf(buffer, len, "%02hhX%02hhX%04hX", StringBuf->entries[i]->path_end.type,
-                StringBuf->entries[i]->path_end.subtype,
-                SwapBytes16(StringBuf->entries[i]->path_end.length));
+// The legacy hex form of the blob, for the log or for a string injection
+CHAR8 *devprop_generate_string(DevPropString *StringBuf)
+{
+  UINT8 *bin;
+  UINT32 size;
+  CHAR8 *buffer;
 
-    buffer += 8;
-    for(x = 0; x < (StringBuf->entries[i]->length) - (24 + (6 * StringBuf->entries[i]->num_pci_devpaths)); x++) {
-      snprintf(buffer, len, "%02hhX", *dataptr++);
-      buffer += 2;
-    }
-    i++;
+  //   DBG("devprop_generate_string\n");
+  if (!StringBuf) {
+    return NULL;
+  }
+  bin = (UINT8*)AllocatePool(StringBuf->length);
+  buffer = (CHAR8*)AllocatePool(StringBuf->length * 2 + 1);
+  if (!bin || !buffer) {
+    if (bin) FreePool(bin);
+    if (buffer) FreePool(buffer);
+    return NULL;
   }
-  return ptr;
+  size = devprop_serialize(StringBuf, bin, StringBuf->length);
+  BytesToHex(bin, size, buffer, TRUE);
+  FreePool(bin);
+  return buffer;
 }
 
 void devprop_free_string(DevPropString *StringBuf)
@@ -355,7 +391,7 @@ BOOLEAN set_eth_props(pci_dt_t *eth_dev)
   DevPropDevice   *device = NULL;
   UINT8           builtin = 0x0;
   BOOLEAN         Injected = FALSE;
-  UINTN           i;
+  DEV_PROPERTY    *Prop;
   CHAR8           compatible[64];
   
   if (!gSettings.LANInjection) {
@@ -383,22 +419,17 @@ BOOLEAN set_eth_props(pci_dt_t *eth_dev)
  		builtin = 0x01;
   }
 
-  if (gSettings.NrAddProperties != 0xFFFE) {
-    for (i = 0; i < gSettings.NrAddProperties; i++) {
-      if (gSettings.AddProperties[i].Device != DEV_LAN) {
-        continue;
-      }
-      Injected = TRUE;
+  for (Prop = GetAddProperties(DEV_LAN); Prop; Prop = Prop->Next) {
+    Injected = TRUE;
 
-      if (!gSettings.AddProperties[i].MenuItem.BValue) {
-        //DBG("  disabled property Key: %s, len: %d\n", gSettings.AddProperties[i].Key, gSettings.AddProperties[i].ValueLen);
-      } else {
-        devprop_add_value(device,
-                          gSettings.AddProperties[i].Key,
-                          (UINT8*)gSettings.AddProperties[i].Value,
-                          gSettings.AddProperties[i].ValueLen);
-        //DBG("  added property Key: %s, len: %d\n", gSettings.AddProperties[i].Key, gSettings.AddProperties[i].ValueLen);
-      }
+    if (!Prop->MenuItem.BValue) {
+      //DBG("  disabled property Key: %s, len: %d\n", Prop->Key, Prop->ValueLen);
+    } else {
+      devprop_add_value(device,
+                        Prop->Key,
+                        (UINT8*)Prop->Value,
+                        Prop->ValueLen);
+      //DBG("  added property Key: %s, len: %d\n", Prop->Key, Prop->ValueLen);
     }
   }
   if (Injected) {
@@ -445,7 +476,7 @@ BOOLEAN set_usb_props(pci_dt_t *usb_dev)
   DevPropDevice   *device = NULL;
   UINT32          fake_devid;
   BOOLEAN         Injected = FALSE;
-  UINTN           i;
+  DEV_PROPERTY    *Prop;
 
   if (!device_inject_string)
     device_inject_string = devprop_create_string();
@@ -465,22 +496,17 @@ BOOLEAN set_usb_props(pci_dt_t *usb_dev)
  // DBG("USB Controller [%04X:%04X] :: %s\n", usb_dev->vendor_id, usb_dev->device_id, devicepath);
  // DBG("Setting dev.prop built-in=0x%X\n", builtin);
 
-  if (gSettings.NrAddProperties != 0xFFFE) {
-    for (i = 0; i < gSettings.NrAddProperties; i++) {
-      if (gSettings.AddProperties[i].Device != DEV_USB) {
-        continue;
-      }
-      Injected = TRUE;
+  for (Prop = GetAddProperties(DEV_USB); Prop; Prop = Prop->Next) {
+    Injected = TRUE;
 
-      if (!gSettings.AddProperties[i].MenuItem.BValue) {
-        //DBG("  disabled property Key: %s, len: %d\n", gSettings.AddProperties[i].Key, gSettings.AddProperties[i].ValueLen);
-      } else {
-        devprop_add_value(device,
-                          gSettings.AddProperties[i].Key,
-                          (UINT8*)gSettings.AddProperties[i].Value,
-                          gSettings.AddProperties[i].ValueLen);
-        //DBG("  added property Key: %s, len: %d\n", gSettings.AddProperties[i].Key, gSettings.AddProperties[i].ValueLen);
-      }
+    if (!Prop->MenuItem.BValue) {
+      //DBG("  disabled property Key: %s, len: %d\n", Prop->Key, Prop->ValueLen);
+    } else {
+      devprop_add_value(device,
+                        Prop->Key,
+                        (UINT8*)Prop->Value,
+                        Prop->ValueLen);
+      //DBG("  added property Key: %s, len: %d\n", Prop->Key, Prop->ValueLen);
     }
   }
   if (Injected) {
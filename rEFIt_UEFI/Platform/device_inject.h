@@ -89,6 +89,7 @@ struct DevPropDevice {
 	// ------------------------
 	UINT8	 num_pci_devpaths;
 	struct DevPropString *string;
+	UINT32 dataAllocated;								// size of data, length counts the used part
 	// ------------------------
 };
 
@@ -116,6 +117,7 @@ DevPropString	*devprop_create_string(void);
 //DevPropDevice	*devprop_add_device(DevPropString *string, char *path);
 DevPropDevice	*devprop_add_device_pci(DevPropString *string, pci_dt_t *PciDt, EFI_DEVICE_PATH_PROTOCOL *DevicePath);
 BOOLEAN			devprop_add_value(DevPropDevice *device, CONST CHAR8 *nm, UINT8 *vl, UINTN len);
+UINT32			devprop_serialize(DevPropString *string, UINT8 *Buffer, UINT32 BufferSize);
 CHAR8			*devprop_generate_string(DevPropString *string);
 void			devprop_free_string(DevPropString *string);
 
@@ -67,6 +67,7 @@
 #include "FixBiosDsdt.h"
 #include "../include/Devices.h"
 #include "../Platform/Settings.h"
+#include "GpuIdTable.h"
 
 #ifndef DEBUG_GMA
 #ifndef DEBUG_ALL
@@ -944,23 +945,56 @@ static struct gma_gpu_t KnownGPUS[] = {
 };
 
 
-CONST CHAR8 *get_gma_model(UINT16 id)
+#define KNOWN_GPUS_COUNT (sizeof(KnownGPUS) / sizeof(KnownGPUS[0]))
+
+// KnownGPUS stays grouped by generation, the lookup goes through this index sorted by id, built on first use
+typedef struct {
+  UINT16 device;
+  UINT16 index;
+} gma_gpu_key_t;
+
+static gma_gpu_key_t KnownGPUSKeys[KNOWN_GPUS_COUNT];
+static BOOLEAN       KnownGPUSKeysReady = FALSE;
+
+static inline UINT64 GpuIdKey(const gma_gpu_key_t& Key)
+{
+  return Key.device;
+}
+
+static void gma_build_keys()
 {
   UINTN i;
+  UINTN j;
+  UINT16 device;
+
+  // insertion sort is stable, so with duplicate ids the first one of KnownGPUS wins, as with the linear scan
+  for (i = 0; i < KNOWN_GPUS_COUNT; i++) {
+    device = (UINT16)KnownGPUS[i].device;
+    for (j = i; j > 0 && KnownGPUSKeys[j - 1].device > device; j--) {
+      KnownGPUSKeys[j] = KnownGPUSKeys[j - 1];
+    }
+    KnownGPUSKeys[j].device = device;
+    KnownGPUSKeys[j].index = (UINT16)i;
+  }
+  KnownGPUSKeysReady = TRUE;
+}
+
+CONST CHAR8 *get_gma_model(UINT16 id)
+{
+  const gma_gpu_key_t *Key;
 
-  for (i = 0; i < (sizeof(KnownGPUS) / sizeof(KnownGPUS[0])); i++)
-  {
-    if (KnownGPUS[i].device == id)
-      return KnownGPUS[i].name;
+  if (!KnownGPUSKeysReady) {
+    gma_build_keys();
   }
-  return KnownGPUS[0].name;
+  Key = GpuIdTableFind(KnownGPUSKeys, KNOWN_GPUS_COUNT, id);
+  return KnownGPUS[Key ? Key->index : 0].name;
 }
 
 
 BOOLEAN setup_gma_devprop(LOADER_ENTRY *Entry, pci_dt_t *gma_dev)
 {
   UINTN           j;
-  UINTN           i;
+  DEV_PROPERTY    *Prop;
   XString8        devicepath;
   CONST CHAR8           *model;
   DevPropDevice   *device = NULL;
@@ -1381,22 +1415,17 @@ BOOLEAN setup_gma_devprop(LOADER_ENTRY *Entry, pci_dt_t *gma_dev)
     return FALSE;
   }
 
-  if (gSettings.NrAddProperties != 0xFFFE) {
-    for (i = 0; i < gSettings.NrAddProperties; i++) {
-      if (gSettings.AddProperties[i].Device != DEV_INTEL) {
-        continue;
-      }
-      Injected = TRUE;
-
-      if (!gSettings.AddProperties[i].MenuItem.BValue) {
-        //DBG("  disabled property Key: %s, len: %d\n", gSettings.AddProperties[i].Key, gSettings.AddProperties[i].ValueLen);
-      } else {
-        devprop_add_value(device,
-                          gSettings.AddProperties[i].Key,
-                          (UINT8*)gSettings.AddProperties[i].Value,
-                          gSettings.AddProperties[i].ValueLen);
-        //DBG("  added property Key: %s, len: %d\n", gSettings.AddProperties[i].Key, gSettings.AddProperties[i].ValueLen);
-      }
+  for (Prop = GetAddProperties(DEV_INTEL); Prop; Prop = Prop->Next) {
+    Injected = TRUE;
+
+    if (!Prop->MenuItem.BValue) {
+      //DBG("  disabled property Key: %s, len: %d\n", Prop->Key, Prop->ValueLen);
+    } else {
+      devprop_add_value(device,
+                        Prop->Key,
+                        (UINT8*)Prop->Value,
+                        Prop->ValueLen);
+      //DBG("  added property Key: %s, len: %d\n", Prop->Key, Prop->ValueLen);
     }
   }
 
@@ -157,7 +157,7 @@ BOOLEAN setup_hda_devprop(EFI_PCI_IO_PROTOCOL *PciIo, pci_dt_t *hda_dev, const M
   UINT32                  layoutId = 0;
   UINT32                  codecId = 0;
   BOOLEAN                 Injected = FALSE;
-  UINTN                   i;
+  DEV_PROPERTY            *Prop;
 
   if (!device_inject_string) {
     device_inject_string = devprop_create_string();
@@ -175,22 +175,17 @@ BOOLEAN setup_hda_devprop(EFI_PCI_IO_PROTOCOL *PciIo, pci_dt_t *hda_dev, const M
       return FALSE;
     }
 
-    if (gSettings.NrAddProperties != 0xFFFE) {
-      for (i = 0; i < gSettings.NrAddProperties; i++) {
-        if (gSettings.AddProperties[i].Device != DEV_HDMI) {
-          continue;
-        }
-        Injected = TRUE;
+    for (Prop = GetAddProperties(DEV_HDMI); Prop; Prop = Prop->Next) {
+      Injected = TRUE;
 
-        if (!gSettings.AddProperties[i].MenuItem.BValue) {
-          //DBG("  disabled property Key: %s, len: %d\n", gSettings.AddProperties[i].Key, gSettings.AddProperties[i].ValueLen);
-        } else {
-          devprop_add_value(device,
-                            gSettings.AddProperties[i].Key,
-                            (UINT8*)gSettings.AddProperties[i].Value,
-                            gSettings.AddProperties[i].ValueLen);
-          //DBG("  added property Key: %s, len: %d\n", gSettings.AddProperties[i].Key, gSettings.AddProperties[i].ValueLen);
-        }
+      if (!Prop->MenuItem.BValue) {
+        //DBG("  disabled property Key: %s, len: %d\n", Prop->Key, Prop->ValueLen);
+      } else {
+        devprop_add_value(device,
+                          Prop->Key,
+                          (UINT8*)Prop->Value,
+                          Prop->ValueLen);
+        //DBG("  added property Key: %s, len: %d\n", Prop->Key, Prop->ValueLen);
       }
     }
     if (Injected) {
@@ -224,22 +219,17 @@ BOOLEAN setup_hda_devprop(EFI_PCI_IO_PROTOCOL *PciIo, pci_dt_t *hda_dev, const M
     } else {
       layoutId = 12;
     }
-    if (gSettings.NrAddProperties != 0xFFFE) {
-      for (i = 0; i < gSettings.NrAddProperties; i++) {
-        if (gSettings.AddProperties[i].Device != DEV_HDA) {
-          continue;
-        }
-        Injected = TRUE;
+    for (Prop = GetAddProperties(DEV_HDA); Prop; Prop = Prop->Next) {
+      Injected = TRUE;
 
-        if (!gSettings.AddProperties[i].MenuItem.BValue) {
-          //DBG("  disabled property Key: %s, len: %d\n", gSettings.AddProperties[i].Key, gSettings.AddProperties[i].ValueLen);
-        } else {
-          devprop_add_value(device,
-                            gSettings.AddProperties[i].Key,
-                            (UINT8*)gSettings.AddProperties[i].Value,
-                            gSettings.AddProperties[i].ValueLen);
-          //DBG("  added property Key: %s, len: %d\n", gSettings.AddProperties[i].Key, gSettings.AddProperties[i].ValueLen);
-        }
+      if (!Prop->MenuItem.BValue) {
+        //DBG("  disabled property Key: %s, len: %d\n", Prop->Key, Prop->ValueLen);
+      } else {
+        devprop_add_value(device,
+                          Prop->Key,
+                          (UINT8*)Prop->Value,
+                          Prop->ValueLen);
+        //DBG("  added property Key: %s, len: %d\n", Prop->Key, Prop->ValueLen);
       }
     }
     if (!Injected) {
@@ -20,6 +20,8 @@
 
 #include "kernel_patcher.h"
 #include "MemoryOperation.h"
+#include "BootTimeline.h"
+#include "Events.h"
 
 //#include "sse3_patcher.h"
 //#include "sse3_5_patcher.h"
@@ -34,7 +36,7 @@
 #if KERNEL_DEBUG == 2
 #define DBG(...)    printf(__VA_ARGS__);
 #elif KERNEL_DEBUG == 1
-#define DBG(...)    DebugLog(KERNEL_DEBUG, __VA_ARGS__)
+#define DBG(...)    do { if ( DebugLogIsEnabled(KERNEL_DEBUG) ) DebugLog(KERNEL_DEBUG, __VA_ARGS__); } while (0)
 #else
 #define DBG(...)
 #endif
@@ -94,11 +96,17 @@ EFI_STATUS LOADER_ENTRY::getVTable()
   //00FFFFFF FF0FFFFF 00000000 FFFFFFFF
 
  // INT32 Tabble  = FindBin(KernelData, 0x5000000, vtableSur, 8);
-  INT32 NTabble = FindBin(KernelData, KERNEL_MAX_SIZE, (const UINT8 *)ctor_used, (UINT32)strlen(ctor_used));
-  DBG("ctor_used found at 0x%x\n", NTabble);
+  INT32 NTabble = CtorUsedOffset;
+  // known from the kernel info cache or from a previous call, the scan is up to KERNEL_MAX_SIZE
+  if (NTabble < 0 || NTabble >= KERNEL_MAX_SIZE ||
+      CompareMem(KernelData + NTabble, ctor_used, strlen(ctor_used)) != 0) {
+    NTabble = FindBin(KernelData, KERNEL_MAX_SIZE, (const UINT8 *)ctor_used, (UINT32)strlen(ctor_used));
+    DBG("ctor_used found at 0x%x\n", NTabble);
+  }
   if (NTabble < 0) {
     return EFI_NOT_FOUND;
   }
+  CtorUsedOffset = NTabble;
   while (KernelData[NTabble] || KernelData[NTabble-1]) --NTabble;
   NTabble &= ~0x03; //align, may be 0x07?
 //  NTabble -=4;
@@ -320,37 +328,174 @@ UINTN LOADER_ENTRY::searchProcInDriver(UINT8 * driver, UINT32 driverLen, const X
   return procAddr;
 }
 
+typedef int (*SYMBOL_COMPARE)(const VTABLE *vArray, const char *Names, UINT32 a, UINT32 b);
+
+static int CompareSymbolsByName(const VTABLE *vArray, const char *Names, UINT32 a, UINT32 b)
+{
+  int Result = strcmp(&Names[vArray[a].NameOffset], &Names[vArray[b].NameOffset]);
+  if (Result == 0) {
+    // first in symtab wins, as with the linear search
+    Result = (a > b) - (a < b);
+  }
+  return Result;
+}
+
+static int CompareSymbolsByAddr(const VTABLE *vArray, const char *Names, UINT32 a, UINT32 b)
+{
+  return (vArray[a].ProcAddr > vArray[b].ProcAddr) - (vArray[a].ProcAddr < vArray[b].ProcAddr);
+}
+
+static void SiftDownSymbols(UINT32 *Index, size_t Root, size_t Count, const VTABLE *vArray, const char *Names, SYMBOL_COMPARE Compare)
+{
+  size_t Child;
+  UINT32 Temp;
+  while ((Child = Root * 2 + 1) < Count) {
+    if (Child + 1 < Count && Compare(vArray, Names, Index[Child], Index[Child + 1]) < 0) {
+      Child++;
+    }
+    if (Compare(vArray, Names, Index[Root], Index[Child]) >= 0) {
+      return;
+    }
+    Temp = Index[Root];
+    Index[Root] = Index[Child];
+    Index[Child] = Temp;
+    Root = Child;
+  }
+}
+
+//
+// Heap sort, no recursion and no allocation.
+//
+static void SortSymbols(UINT32 *Index, size_t Count, const VTABLE *vArray, const char *Names, SYMBOL_COMPARE Compare)
+{
+  UINT32 Temp;
+  if (Count < 2) {
+    return;
+  }
+  for (size_t Root = Count / 2; Root-- > 0; ) {
+    SiftDownSymbols(Index, Root, Count, vArray, Names, Compare);
+  }
+  for (size_t End = Count - 1; End > 0; End--) {
+    Temp = Index[0];
+    Index[0] = Index[End];
+    Index[End] = Temp;
+    SiftDownSymbols(Index, 0, End, vArray, Names, Compare);
+  }
+}
+
+//
+// Compares the start of symbol name with Name, or with "_" + Name if Underscore.
+//
+static int CompareSymbolName(const char *SymbolName, bool Underscore, const char *Name, size_t NameLen)
+{
+  if (Underscore) {
+    if (*SymbolName != '_') {
+      return (int)(UINT8)*SymbolName - '_';
+    }
+    SymbolName++;
+  }
+  return strncmp(SymbolName, Name, NameLen);
+}
+
+//
+// Builds the sorted symbol indexes once the kernel symtab is known,
+// so searchProc() is a binary search instead of a scan of all the symbols.
+//
+void LOADER_ENTRY::IndexKernelSymbols()
+{
+  KernelSymbolsByName.setEmpty();
+  KernelSymbolsByAddr.setEmpty();
+  if (!KernelData || !SizeVtable) {
+    return;
+  }
+  const char* Names = (const char*)(&KernelData[NamesTable]);
+  VTABLE * vArray = (VTABLE*)(&KernelData[AddrVtable]);
+  UINT32 Count;
+
+  // same end as searchProc() always had
+  for (Count = 0; Count < SizeVtable && vArray[Count].NameOffset != 0; ++Count) {}
+  KernelSymbolsByName.CheckSize(Count);
+  KernelSymbolsByAddr.CheckSize(Count);
+  for (UINT32 i = 0; i < Count; ++i) {
+    KernelSymbolsByName.Add(i);
+    KernelSymbolsByAddr.Add(i);
+  }
+  SortSymbols(KernelSymbolsByName.data(), Count, vArray, Names, CompareSymbolsByName);
+  SortSymbols(KernelSymbolsByAddr.data(), Count, vArray, Names, CompareSymbolsByAddr);
+  DBG("indexed %u kernel symbols\n", Count);
+}
+
+//
+// Returns symtab index of the procedure or -1.
+// Same result as the old scan: the first symbol in symtab order whose name contains procedure.
+// The name index gives the first symbol starting with it or with "_" + it,
+// only the symbols before that one are scanned for the name elsewhere.
+//
+INTN LOADER_ENTRY::FindKernelSymbol(const XString8& procedure)
+{
+  const char* Names = (const char*)(&KernelData[NamesTable]);
+  VTABLE * vArray = (VTABLE*)(&KernelData[AddrVtable]);
+  const char* Name = procedure.c_str();
+  size_t NameLen = strlen(Name);
+  size_t Count = KernelSymbolsByName.size();
+  const UINT32 *ByName = KernelSymbolsByName.data();
+
+  if (Count == 0) {
+    //search for the name
+    for (size_t i=0; i<SizeVtable; ++i) {
+      size_t Offset = vArray[i].NameOffset;
+      if (Offset == 0) break;
+      if (AsciiStrStr(&Names[Offset], Name) != NULL) {
+        return (INTN)i;
+      }
+    }
+    return -1;
+  }
+
+  size_t Found = Count;
+  for (int Pass = 0; Pass < 2; ++Pass) {
+    bool Underscore = Pass != 0;
+    size_t Lo = 0, Hi = Count;
+    // lower bound
+    while (Lo < Hi) {
+      size_t Mid = Lo + (Hi - Lo) / 2;
+      if (CompareSymbolName(&Names[vArray[ByName[Mid]].NameOffset], Underscore, Name, NameLen) < 0) {
+        Lo = Mid + 1;
+      } else {
+        Hi = Mid;
+      }
+    }
+    for ( ; Lo < Count && CompareSymbolName(&Names[vArray[ByName[Lo]].NameOffset], Underscore, Name, NameLen) == 0; ++Lo) {
+      if (ByName[Lo] < Found) {
+        Found = ByName[Lo];
+      }
+    }
+  }
+
+  // a name containing procedure elsewhere may come first in symtab
+  for (UINT32 i = 0; i < Found; ++i) {
+    if (AsciiStrStr(&Names[vArray[i].NameOffset], Name) != NULL) {
+      return i;
+    }
+  }
+  return Found < Count ? (INTN)Found : -1;
+}
+
 //static int N = 0;
 //search a procedure by Name and return its offset in the kernel
-UINTN LOADER_ENTRY::searchProc(const XString8& procedure)
+//procLen, if not NULL, gets the distance to the next symbol or 0 if unknown
+UINTN LOADER_ENTRY::searchProc(const XString8& procedure, UINTN *procLen)
 {
+  if (procLen) {
+    *procLen = 0;
+  }
   if (procedure.isEmpty()) {
     return 0;
   }
   DBG("search name in kernel: %s\n", procedure.c_str());
-  const char* Names = (const char*)(&KernelData[NamesTable]);
   VTABLE * vArray = (VTABLE*)(&KernelData[AddrVtable]);
-  //search for the name
-//  gBS->Stall(9000000);
-  size_t i;
-  bool found = false;
-  for (i=0; i<SizeVtable; ++i) {
-    size_t Offset = vArray[i].NameOffset;
-    if (Offset == 0) break;
-//    if (N < 10) {
-//      DBG("Offset %lx Seg=%x\n", Offset, vArray[i].Seg);
-//      DBG("Name to compare %s\n", &Names[Offset]);
-//      N++;
-//    }
-//    DBG_RT("Offset %lx Seg=%x\n", Offset, vArray[i].Seg);
-//    DBG_RT("Name to compare %s\n", &Names[Offset]);
-//    Stall(3000000);
-    if (AsciiStrStr(&Names[Offset], procedure.c_str()) != NULL) {
-      found = true;
-      break;
-    }
-  }
-  if (!found) {
+  INTN i = FindKernelSymbol(procedure);
+  if (i < 0) {
     return 0;
   }
 //  INT32 SegVAddr;
@@ -388,6 +533,22 @@ UINTN LOADER_ENTRY::searchProc(const XString8& procedure)
   }
   *procLen = vArray[i].ProcAddr - prevAddr; //never worked
  */
+  if (procLen && !KernelSymbolsByAddr.isEmpty()) {
+    // next symbol by address is the end of the procedure
+    const UINT32 *ByAddr = KernelSymbolsByAddr.data();
+    size_t Lo = 0, Hi = KernelSymbolsByAddr.size();
+    while (Lo < Hi) {
+      size_t Mid = Lo + (Hi - Lo) / 2;
+      if (vArray[ByAddr[Mid]].ProcAddr <= vArray[i].ProcAddr) {
+        Lo = Mid + 1;
+      } else {
+        Hi = Mid;
+      }
+    }
+    if (Lo < KernelSymbolsByAddr.size()) {
+      *procLen = vArray[ByAddr[Lo]].ProcAddr - vArray[i].ProcAddr;
+    }
+  }
   DBG("kernel: procAddr=0x%llx\n", procAddr);
   return procAddr;
 }
@@ -825,14 +986,26 @@ BOOLEAN LOADER_ENTRY::PatchCPUID(const UINT8* Location, INT32 LenLoc,
 {
   INT32 patchLocation=0, patchLocation1=0;
   INT32 Adr = 0, Num;
+  INT32 Start = 0, End = 0x800000, Base;
+  UINTN procLen = 0;
   BOOLEAN Patched = FALSE;
   UINT8 FakeModel = (KernelAndKextPatches.FakeCPUID >> 4) & 0x0f;
   UINT8 FakeExt = (KernelAndKextPatches.FakeCPUID >> 0x10) & 0x0f;
+  // the model is computed in cpuid_set_generic_info, search there when the kernel has symbols
+  UINTN procAddr = searchProc("cpuid_set_generic_info"_XS8, &procLen);
+  if (procAddr != 0 && procLen != 0 && procAddr + procLen <= (UINTN)End) {
+    Start = (INT32)procAddr;
+    End = (INT32)(procAddr + procLen);
+  }
+SearchCPUID:
+  Base = Start;
   for (Num = 0; Num < 2; Num++) {
-    Adr = FindBin(&KernelData[Adr], 0x800000 - Adr, Location, (UINT32)LenLoc);
+    Adr = FindBin(&KernelData[Base], (UINT32)(End - Base), Location, (UINT32)LenLoc);
     if (Adr < 0) {
       break;
     }
+    Adr += Base;
+    Base = Adr + LenLoc;
     DBG_RT( "found location at %x\n", Adr);
     patchLocation = FindBin(&KernelData[Adr], 0x100, Search4, (UINT32)Len);
     if (patchLocation > 0 && patchLocation < 70) {
@@ -849,6 +1022,12 @@ BOOLEAN LOADER_ENTRY::PatchCPUID(const UINT8* Location, INT32 LenLoc,
       Patched = TRUE;
     }
   }
+  if (!Patched && Start != 0) {
+    // not in the procedure, the whole kernel as before
+    Start = 0;
+    End = 0x800000;
+    goto SearchCPUID;
+  }
   return Patched;
 }
 
@@ -925,12 +1104,16 @@ BOOLEAN LOADER_ENTRY::KernelPatchPm()
   //1. procedure xcpm_idle
   // wrmsr 0xe2 twice
   // B9E2000000 0F30 replace to eb05
-//  UINTN procLen = 0;
-  UINTN procLocation = searchProc("xcpm_idle"_XS8);
+  UINTN procLen = 0;
+  UINTN procLocation = searchProc("xcpm_idle"_XS8, &procLen);
   const UINT8 findJmp[]  = {0xB9, 0xE2, 0x00, 0x00, 0x00, 0x0F, 0x30};
   const UINT8 patchJmp[] = {0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90};
-  DBG_RT("==> xcpm_idle at %llx\n", procLocation);
-  INTN Num = SearchAndReplace(&KernelData[procLocation], 0x400, findJmp, sizeof(findJmp), patchJmp, 0);
+  DBG_RT("==> xcpm_idle at %llx len %llx\n", procLocation, procLen);
+  INTN Num = 0;
+  if (procLocation != 0) {
+    // the whole procedure when the next symbol is known, else the old fixed window
+    Num = SearchAndReplace(&KernelData[procLocation], (procLen != 0) ? procLen : 0x400, findJmp, sizeof(findJmp), patchJmp, 0);
+  }
   DBG_RT("==> found %lld patterns\n", Num);
   //2. procedure xcpm_init
   // indirect call to _xcpm_core_scope_msrs and to _xcpm_SMT_scope_msrs
@@ -1054,7 +1237,9 @@ BOOLEAN LOADER_ENTRY::KernelLapicPatch_64()
 
   UINT8 *bytes = KernelData;
   UINTN      patchLocation1 = 0, patchLocation2 = 0;
+  UINTN      procLen = 0;
   UINT32      i, y;
+  UINT32      searchStart = 0, searchEnd = 0x1000000;
 
   DBG_RT( "Looking for Lapic panic call (64-bit) Start\n");
   //Slice - symbolic method
@@ -1064,7 +1249,7 @@ BOOLEAN LOADER_ENTRY::KernelLapicPatch_64()
   // bytes:658b04251c0000003b058bb97b00
   // call _panic -> change to nop {90,90,90,90,90}
   if ( OSVersion >= MacOsVersion("10.10"_XS8) ) {
-    UINTN procAddr = searchProc("lapic_interrupt"_XS8);
+    UINTN procAddr = searchProc("lapic_interrupt"_XS8, &procLen);
     patchLocation1 = searchProc("_panic"_XS8);
     patchLocation2 = FindRelative32(KernelData, procAddr, 0x140, patchLocation1);
     if (patchLocation2 != 0) {
@@ -1073,10 +1258,17 @@ BOOLEAN LOADER_ENTRY::KernelLapicPatch_64()
       DBG_RT( "Lapic panic patched\n");
       return true;
     }
+    patchLocation1 = 0;
+    // the patterns below are inside lapic_interrupt, no need to scan the whole kernel when its bounds are known
+    if (procAddr != 0 && procLen != 0 && procAddr + procLen <= searchEnd) {
+      searchStart = (UINT32)procAddr;
+      searchEnd = (UINT32)(procAddr + procLen);
+    }
   }
   //else old method
 
-  for (i = 0; i < 0x1000000; i++) {
+SearchLapic:
+  for (i = searchStart; i < searchEnd; i++) {
     if (KernelData[i+0] == 0x65 && KernelData[i+1] == 0x8B && KernelData[i+2] == 0x04 && KernelData[i+3] == 0x25 &&
         KernelData[i+4] == 0x3C && KernelData[i+5] == 0x00 && KernelData[i+6] == 0x00 && KernelData[i+7] == 0x00 &&
         KernelData[i+45] == 0x65 && KernelData[i+46] == 0x8B && KernelData[i+47] == 0x04 && KernelData[i+48] == 0x25 &&
@@ -1104,7 +1296,7 @@ BOOLEAN LOADER_ENTRY::KernelLapicPatch_64()
                bytes[i+5] == 0x31 && bytes[i+6] == 0xDB && bytes[i+7] == 0x8D && bytes[i+8] == 0x47 &&
                bytes[i+9] == 0xFA && bytes[i+10] == 0x83) {
       DBG_RT( "Found Lapic panic Base (10.10 - recent macOS)\n");
-      for (y = i; y < 0x1000000; y++) {
+      for (y = i; y < searchEnd; y++) {
         // Lapic panic patch, by vit9696
         // mov eax, gs:XX
         // cmp eax, cs:_master_cpu
@@ -1122,6 +1314,13 @@ BOOLEAN LOADER_ENTRY::KernelLapicPatch_64()
     }
   }
 
+  if (!patchLocation1 && searchStart != 0) {
+    // not inside lapic_interrupt on this kernel, scan the whole kernel as before
+    searchStart = 0;
+    searchEnd = 0x1000000;
+    goto SearchLapic;
+  }
+
   if (!patchLocation1) {
     DBG_RT( "Can't find Lapic panic, kernel patch aborted.\n");
     return FALSE;
@@ -1263,10 +1462,22 @@ BOOLEAN LOADER_ENTRY::KernelLapicPatch_32()
 //
 // syscl - applyKernPatch a wrapper for SearchAndReplace() to make the CpuPM patch tidy and clean
 //
+// The comment is the name of the patched procedure: it is searched inside this procedure first,
+// the whole kernel is scanned only if the symbol is unknown (or not a procedure) or the pattern isn't there.
+//
 void LOADER_ENTRY::applyKernPatch(const UINT8 *find, UINTN size, const UINT8 *repl, const CHAR8 *comment)
 {
+    XString8 procName;
+    UINTN procLen = 0;
+    UINTN procAddr;
+
     DBG("Searching %s...\n", comment);
-    if (SearchAndReplace(KernelData, KERNEL_MAX_SIZE, find, size, repl, 0)) {
+    procName.takeValueFrom(comment);
+    procAddr = searchProc(procName, &procLen);
+    if (procAddr != 0 && procLen != 0 && procAddr + procLen <= KERNEL_MAX_SIZE &&
+        SearchAndReplace(&KernelData[procAddr], procLen, find, size, repl, 0)) {
+        DBG("Found %s at 0x%llx\nApplied patch\n", comment, procAddr);
+    } else if (SearchAndReplace(KernelData, KERNEL_MAX_SIZE, find, size, repl, 0)) {
         DBG("Found %s\nApplied patch\n", comment);
     } else {
         DBG("%s no found, patched already?\n", comment);
@@ -2351,10 +2562,47 @@ LOADER_ENTRY::FindBootArgs()
   }
 }
 
+//
+// Fill multi-pattern entries from patches, with the same index.
+// Patches disabled, plist patches and patches with a StartPattern are left to the caller (Search == NULL).
+//
+static void CompilePatchEntries(XVector<KEXT_PATCH>& Patches, XArray<MULTI_PATTERN_ENTRY>& Entries)
+{
+  Entries.setEmpty();
+  for (size_t i = 0 ; i < Patches.size(); ++i) {
+    const KEXT_PATCH& Patch = Patches[i];
+    MULTI_PATTERN_ENTRY Entry;
+    ZeroMem(&Entry, sizeof(Entry));
+    if (Patch.MenuItem.BValue && !Patch.IsPlistPatch && Patch.StartPattern.isEmpty() &&
+        Patch.Data.notEmpty() && Patch.Patch.size() >= Patch.Data.size()) {
+      Entry.Search = Patch.Data.data();
+      Entry.MaskSearch = Patch.MaskFind.notEmpty() ? Patch.MaskFind.data() : NULL;
+      Entry.SearchSize = Patch.Data.size();
+      Entry.Replace = Patch.Patch.data();
+      Entry.MaskReplace = Patch.MaskReplace.notEmpty() ? Patch.MaskReplace.data() : NULL;
+      Entry.MaxReplaces = Patch.Count;
+      Entry.Skip = Patch.Skip;
+    }
+    Entries.Add(Entry);
+  }
+  MultiPatternCompile(Entries.data(), Entries.size());
+}
+
+void
+LOADER_ENTRY::CompileUserPatches()
+{
+  if ( !PatchIndex ) {
+    PatchIndex = new MULTI_PATTERN_INDEX;
+  }
+  CompilePatchEntries(KernelAndKextPatches.KernelPatches, KernelPatchEntries);
+  CompilePatchEntries(KernelAndKextPatches.KextPatches, KextPatchEntries);
+}
+
 BOOLEAN
 LOADER_ENTRY::KernelUserPatch()
 {
   INTN Num, y = 0;
+  BOOLEAN Compiled = PatchIndex && KernelPatchEntries.size() == KernelAndKextPatches.KernelPatches.size();
 
 
   // old confuse
@@ -2362,22 +2610,63 @@ LOADER_ENTRY::KernelUserPatch()
   // while config patches go to gSettings.KernelAndKextPatches
   // how to resolve it?
   
-  for (size_t i = 0 ; i < KernelAndKextPatches.KernelPatches.size(); ++i) {
+  size_t i = 0;
+  while (i < KernelAndKextPatches.KernelPatches.size()) {
+    if (Compiled && KernelPatchEntries.ElementAt(i).Search) {
+      // Consecutive compiled patches are all done with one pass over the kernel
+      size_t First = i;
+      for ( ; i < KernelAndKextPatches.KernelPatches.size() && KernelPatchEntries.ElementAt(i).Search; ++i) {
+        const KEXT_PATCH& Patch = KernelAndKextPatches.KernelPatches[i];
+        UINTN procLen = 0;
+        UINTN procAddr = searchProc(Patch.ProcedureName, &procLen);
+        DBG( "Patch[%zu]: %s\n", i, Patch.Label.c_str());
+        DBG("procedure %s found at 0x%llx len 0x%llx\n", Patch.ProcedureName.c_str(), procAddr, procLen);
+        KernelPatchEntries.ElementAt(i).Active = TRUE;
+        KernelPatchEntries.ElementAt(i).Start = procAddr;
+        if (Patch.SearchLen != 0) {
+          KernelPatchEntries.ElementAt(i).Length = (UINTN)Patch.SearchLen;
+        } else if (procLen != 0) {
+          // no SearchLen: bounded to the procedure
+          KernelPatchEntries.ElementAt(i).Length = procLen;
+          DBG("search bounded to the procedure, 0x%llx bytes\n", procLen);
+        } else {
+          KernelPatchEntries.ElementAt(i).Length = KERNEL_MAX_SIZE - procAddr;
+        }
+      }
+      MultiPatternApply(KernelPatchEntries.data() + First, i - First, PatchIndex, KernelData, KERNEL_MAX_SIZE);
+      for (size_t j = First ; j < i; ++j) {
+        Num = (INTN)KernelPatchEntries.ElementAt(j).NumReplaces;
+        KernelPatchEntries.ElementAt(j).Active = FALSE;
+        if (Num) {
+          y++;
+        } else if (KernelAndKextPatches.KernelPatches[j].SearchLen == 0 &&
+                   KernelPatchEntries.ElementAt(j).Length < KERNEL_MAX_SIZE - KernelPatchEntries.ElementAt(j).Start) {
+          DBG("not found in the procedure, set SearchLen to search past its end\n");
+        }
+        DBG( "==> Patch[%zu] %s : %lld replaces done\n", j, Num ? "Success" : "Error", Num);
+      }
+      continue;
+    }
     DBG( "Patch[%zu]: %s\n", i, KernelAndKextPatches.KernelPatches[i].Label.c_str());
     if (!KernelAndKextPatches.KernelPatches[i].MenuItem.BValue) {
       //DBG_RT( "Patch[%d]: %a :: is not allowed for booted OS %a\n", i, KernelAndKextPatches.KernelPatches[i].Label, OSVersion);
       DBG( "==> disabled\n");
+      ++i;
       continue;
     }
     // if we modify directly KernelAndKextPatches.KernelPatches[i].SearchLen, it will wrong for next driver
     UINTN SearchLen = KernelAndKextPatches.KernelPatches[i].SearchLen;
     bool once = false;
     UINTN procLen = 0;
-    UINTN procAddr = searchProc(KernelAndKextPatches.KernelPatches[i].ProcedureName);
-    DBG("procedure %s found at 0x%llx\n", KernelAndKextPatches.KernelPatches[i].ProcedureName.c_str(), procAddr);
+    UINTN procAddr = searchProc(KernelAndKextPatches.KernelPatches[i].ProcedureName, &procLen);
+    DBG("procedure %s found at 0x%llx len 0x%llx\n", KernelAndKextPatches.KernelPatches[i].ProcedureName.c_str(), procAddr, procLen);
     if (SearchLen == 0) {
       SearchLen = KERNEL_MAX_SIZE;
-      procLen = KERNEL_MAX_SIZE - procAddr;
+      if (procLen == 0) {
+        procLen = KERNEL_MAX_SIZE - procAddr;
+      } else {
+        DBG("search bounded to the procedure, 0x%llx bytes\n", procLen);
+      }
       once = true;
     } else {
       procLen = SearchLen;
@@ -2406,6 +2695,8 @@ LOADER_ENTRY::KernelUserPatch()
           y++;
           curs += SearchLen - 1;
           j    += SearchLen - 1;
+        } else if (once && procLen < KERNEL_MAX_SIZE - procAddr) {
+          DBG("not found in the procedure, set SearchLen to search past its end\n");
         }
         DBG( "==> %s : %lld replaces done\n", Num ? "Success" : "Error", Num);
         if ( once || KernelAndKextPatches.KernelPatches[i].StartPattern.isEmpty() ) {
@@ -2414,6 +2705,7 @@ LOADER_ENTRY::KernelUserPatch()
       }
       j++; curs++;
     }
+    ++i;
   }
   if (KernelAndKextPatches.KPDebug) {
     gBS->Stall(2000000);
@@ -2482,15 +2774,128 @@ LOADER_ENTRY::BooterPatch(IN UINT8 *BooterData, IN UINT64 BooterSize)
   return (y != 0);
 }
 
+//
+// Kernel info cache
+//
+// The offsets KernelAndKextPatcherInit() finds in a kernel are kept in KERNEL_INFO_VARIABLE of gEfiAppleBootGuid
+// for the next boot of the same kernel. They are relative to KernelData, so the slide doesn't matter.
+// The key is the LC_UUID and sizeofcmds of the header at KernelData. Each offset is checked before use:
+// LC_SYMTAB at the symtab command, the ctor_used string at the offset that saves getVTable() its scan.
+// SetKernelRelocBase() and FindBootArgs() read this boot's memory and Get_PreLink() depends on KernelRelocBase,
+// they always run. The symbol index doesn't fit in a variable, IndexKernelSymbols() builds it each boot.
+// The patcher may run after ExitBootServices, so the variable is read and written with gRT directly:
+// the NVRAM snapshot of Nvram.cpp allocates.
+//
+#define KERNEL_INFO_VARIABLE  L"CloverKernelInfo"
+#define KERNEL_INFO_VERSION   1
+
+#pragma pack(push, 1)
+typedef struct {
+  UINT32  Version;
+  UINT8   Uuid[16];
+  UINT32  SizeOfCmds;
+  UINT32  KernelOffset;
+  UINT32  SymtabCmdOffset;  // relative to KernelData + KernelOffset, 0 if none
+  INT32   CtorUsedOffset;
+} KERNEL_INFO_CACHE;
+#pragma pack(pop)
+
+static BOOLEAN KernelInfoKey(IN UINT8 *Kernel, OUT KERNEL_INFO_CACHE *Key)
+{
+  struct mach_header_64 *Header = (struct mach_header_64 *)Kernel;
+  UINT32 binaryIndex = sizeof(struct mach_header_64);
+
+  ZeroMem(Key, sizeof(*Key));
+  if (Header->magic != MH_MAGIC_64 || Header->ncmds > 1000) {
+    return FALSE;
+  }
+  for (UINT32 cnt = 0; cnt < Header->ncmds; cnt++) {
+    struct load_command *loadCommand = (struct load_command *)(Kernel + binaryIndex);
+    if (loadCommand->cmd == LC_UUID) {
+      CopyMem(Key->Uuid, ((struct uuid_command *)loadCommand)->uuid, sizeof(Key->Uuid));
+      Key->Version = KERNEL_INFO_VERSION;
+      Key->SizeOfCmds = Header->sizeofcmds;
+      return TRUE;
+    }
+    if (loadCommand->cmdsize == 0) {
+      break;
+    }
+    binaryIndex += loadCommand->cmdsize;
+  }
+  return FALSE;
+}
+
+static BOOLEAN LoadKernelInfo(IN CONST KERNEL_INFO_CACHE *Key, OUT KERNEL_INFO_CACHE *Cache)
+{
+  UINTN Size = sizeof(*Cache);
+  EFI_STATUS Status = gRT->GetVariable(KERNEL_INFO_VARIABLE, &gEfiAppleBootGuid, NULL, &Size, Cache);
+  return !EFI_ERROR(Status) && Size == sizeof(*Cache) && Cache->Version == Key->Version &&
+         Cache->SizeOfCmds == Key->SizeOfCmds && CompareMem(Cache->Uuid, Key->Uuid, sizeof(Key->Uuid)) == 0;
+}
+
+//
+// A cached KernelOffset must be inside the segments of the kernel collection at Kernel
+// and point to the 64 bit MH_EXECUTE header of the kernel.
+//
+static BOOLEAN KernelInfoOffsetValid(IN UINT8 *Kernel, IN UINT32 Offset)
+{
+  struct mach_header_64 *Header = (struct mach_header_64 *)Kernel;
+  UINT32 binaryIndex = sizeof(struct mach_header_64);
+  UINT64 FileEnd = 0;
+
+  if (Offset == 0 || (Offset & 3) != 0 || Header->ncmds > 1000) {
+    return FALSE;
+  }
+  for (UINT32 cnt = 0; cnt < Header->ncmds; cnt++) {
+    struct segment_command_64 *segCmd64 = (struct segment_command_64 *)(Kernel + binaryIndex);
+    if (segCmd64->cmd == LC_SEGMENT_64 && segCmd64->fileoff + segCmd64->filesize > FileEnd) {
+      FileEnd = segCmd64->fileoff + segCmd64->filesize;
+    }
+    if (segCmd64->cmdsize == 0) {
+      break;
+    }
+    binaryIndex += segCmd64->cmdsize;
+  }
+  if ((UINT64)Offset + sizeof(struct mach_header_64) > FileEnd || FileEnd > KERNEL_MAX_SIZE) {
+    return FALSE;
+  }
+  Header = (struct mach_header_64 *)(Kernel + Offset);
+  return Header->magic == MH_MAGIC_64 && Header->filetype == MH_EXECUTE;
+}
+
+static void SaveKernelInfo(IN CONST KERNEL_INFO_CACHE *Info)
+{
+  EFI_STATUS         Status;
+  KERNEL_INFO_CACHE  Cache;
+
+  if (LoadKernelInfo(Info, &Cache) && CompareMem(&Cache, Info, sizeof(Cache)) == 0) {
+    return;
+  }
+  // may be after ExitBootServices: Cache is on the stack and nothing is logged then
+  CopyMem(&Cache, Info, sizeof(Cache));
+  Status = gRT->SetVariable(KERNEL_INFO_VARIABLE, &gEfiAppleBootGuid,
+                            EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS,
+                            sizeof(Cache), &Cache);
+  if (!ExitBootServicesCalled) {
+    DBG("kernel info cache: %s\n", efiStrError(Status));
+  }
+}
+
 void
 LOADER_ENTRY::KernelAndKextPatcherInit()
 {
+  KERNEL_INFO_CACHE KernelInfo;
+  KERNEL_INFO_CACHE CachedInfo;
+  BOOLEAN           HaveKernelInfo = FALSE;
+  BOOLEAN           KernelInfoHit = FALSE;
+
   if (PatcherInited) {
     DBG("patcher inited\n");
     return;
   }
 
   PatcherInited = TRUE;
+  CtorUsedOffset = -1;
 
   // KernelRelocBase will normally be 0
   // but if OsxAptioFixDrv is used, then it will be > 0
@@ -2544,11 +2949,18 @@ LOADER_ENTRY::KernelAndKextPatcherInit()
       KernelOffset += 4;
     }
  */
+    HaveKernelInfo = KernelInfoKey(KernelData, &KernelInfo);
+    KernelInfoHit = HaveKernelInfo && LoadKernelInfo(&KernelInfo, &CachedInfo);
     if ((((struct mach_header_64*)KernelData)->filetype) == MH_KERNEL_COLLECTION) {
       // BigSur
-      KernelOffset = GetTextExec();
+      if (KernelInfoHit && !KernelInfoOffsetValid(KernelData, CachedInfo.KernelOffset)) {
+        DBG("kernel info cache: bad kernel offset 0x%x\n", CachedInfo.KernelOffset);
+        KernelInfoHit = FALSE;
+      }
+      KernelOffset = KernelInfoHit ? CachedInfo.KernelOffset : GetTextExec();
 //      DBG("BigSur: KernelOffset =0x%X\n", KernelOffset);
     }
+    DBG("kernel info cache: %s\n", KernelInfoHit ? "hit" : "miss");
     is64BitKernel = TRUE;
   } else {
     // not valid Mach-O header - exiting
@@ -2565,7 +2977,14 @@ LOADER_ENTRY::KernelAndKextPatcherInit()
   }
   //find symbol tables
   struct  symtab_command  *symCmd = NULL;
-  UINT32 symCmdOffset = Get_Symtab(&KernelData[KernelOffset]);
+  UINT32 symCmdOffset = 0;
+  if (KernelInfoHit && CachedInfo.SymtabCmdOffset != 0 &&
+      CachedInfo.SymtabCmdOffset < sizeof(struct mach_header_64) + ((struct mach_header_64 *)&KernelData[KernelOffset])->sizeofcmds &&
+      ((struct load_command *)&KernelData[KernelOffset + CachedInfo.SymtabCmdOffset])->cmd == LC_SYMTAB) {
+    symCmdOffset = CachedInfo.SymtabCmdOffset;
+  } else {
+    symCmdOffset = Get_Symtab(&KernelData[KernelOffset]);
+  }
   if (symCmdOffset != 0) {
     symCmd = (struct symtab_command *)&KernelData[KernelOffset + symCmdOffset];
     AddrVtable = symCmd->symoff; //this offset relative to KernelData+0
@@ -2585,17 +3004,30 @@ LOADER_ENTRY::KernelAndKextPatcherInit()
     }
   }
 */
+  if (KernelInfoHit) {
+    CtorUsedOffset = CachedInfo.CtorUsedOffset;
+  }
   if (EFI_ERROR(getVTable())) {
     DBG("error getting vtable: \n");
   }
+  if (HaveKernelInfo) {
+    KernelInfo.KernelOffset = KernelOffset;
+    KernelInfo.SymtabCmdOffset = symCmdOffset;
+    KernelInfo.CtorUsedOffset = CtorUsedOffset;
+    SaveKernelInfo(&KernelInfo);
+  }
+  IndexKernelSymbols();
 
   isKernelcache = (PrelinkTextSize > 0) && (PrelinkInfoSize > 0);
 	DBG( "isKernelcache: %ls\n", isKernelcache ? L"Yes" : L"No");
+
+  CompileUserPatches();
 }
 
 void
 LOADER_ENTRY::KernelAndKextsPatcherStart()
 {
+  TimelineSpan Span("KernelAndKextsPatcherStart");
   BOOLEAN KextPatchesNeeded, patchedOk;
   /*
    * it was intended for custom entries but not work if no custom entries used
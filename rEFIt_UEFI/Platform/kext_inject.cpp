@@ -13,6 +13,8 @@ extern "C" {
 #include "../Platform/SelfOem.h"
 #include "MemoryOperation.h"
 #include "../include/OsType.h"
+#include "BootTimeline.h"
+#include "PerfCounters.h"
 
 #ifndef DEBUG_ALL
 #define KEXT_INJECT_DEBUG 1
@@ -41,15 +43,24 @@ LIST_ENTRY gKextList = INITIALIZE_LIST_HEAD_VARIABLE (gKextList);
 ////////////////////
 // before booting
 ////////////////////
-EFI_STATUS EFIAPI ThinFatFile(IN OUT UINT8 **binary, IN OUT UINTN *length, IN cpu_type_t archCpuType)
+
+// Finds the slice of archCpuType in the start of a file, Header holds at least the fat header and the fat_arch table.
+// A thin file of archCpuType is its own slice : *Offset is 0 and *Size is left as is. Without a matching slice in
+// the fat file, *Size is 0.
+static EFI_STATUS FatSlice(IN const UINT8 *Header, IN UINTN HeaderSize, IN cpu_type_t archCpuType, OUT UINTN *Offset, IN OUT UINTN *Size)
 {
-  UINT32 nfat, swapped, size = 0;
-  FAT_HEADER *fhp = (FAT_HEADER *)*binary;
-  FAT_ARCH   *fap = (FAT_ARCH *)(*binary + sizeof(FAT_HEADER));
+  UINT32 nfat, swapped;
+  const FAT_HEADER *fhp = (const FAT_HEADER *)Header;
+  const FAT_ARCH   *fap = (const FAT_ARCH *)(Header + sizeof(FAT_HEADER));
   cpu_type_t fapcputype;
   UINT32 fapoffset;
   UINT32 fapsize;
 
+  *Offset = 0;
+  if (HeaderSize < sizeof(FAT_HEADER)) {
+    MsgLog("Thinning fails\n");
+    return EFI_NOT_FOUND;
+  }
   swapped = 0;
   if (fhp->magic == FAT_MAGIC) {
     nfat = fhp->nfat_arch;
@@ -72,7 +83,9 @@ EFI_STATUS EFIAPI ThinFatFile(IN OUT UINT8 **binary, IN OUT UINTN *length, IN cp
     return EFI_NOT_FOUND;
   }
 
-  for (; nfat > 0; nfat--, fap++) {
+  // the fat_arch table beyond HeaderSize isn't looked at
+  *Size = 0;
+  for (; nfat > 0 && HeaderSize >= sizeof(FAT_HEADER) + sizeof(FAT_ARCH); nfat--, fap++, HeaderSize -= sizeof(FAT_ARCH)) {
     if (swapped) {
       fapcputype = SwapBytes32(fap->cputype);
       fapoffset = SwapBytes32(fap->offset);
@@ -83,16 +96,111 @@ EFI_STATUS EFIAPI ThinFatFile(IN OUT UINT8 **binary, IN OUT UINTN *length, IN cp
       fapsize = fap->size;
     }
     if (fapcputype == archCpuType) {
-      *binary = (*binary + fapoffset);
-      size = fapsize;
+      *Offset = fapoffset;
+      *Size = fapsize;
       break;
     }
   }
-  if (length != 0) *length = size;
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS EFIAPI ThinFatFile(IN OUT UINT8 **binary, IN OUT UINTN *length, IN cpu_type_t archCpuType)
+{
+  EFI_STATUS Status;
+  UINTN      Offset;
+  UINTN      Size = (length != 0) ? *length : 0;
+
+  Status = FatSlice(*binary, (length != 0) ? *length : MAX_UINTN, archCpuType, &Offset, &Size);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+  *binary += Offset;
+  if (length != 0) *length = Size;
 
   return EFI_SUCCESS;
 }
 
+// Loads the slice of archCpuType of a fat file, or the whole thin file, without reading the other slices.
+// The slice is read at Before in a buffer of Before + slice + After bytes, so it lands where the caller wants it.
+// Returns EFI_UNSUPPORTED if thinning fails.
+static EFI_STATUS ThinFatFileLoad(const EFI_FILE *RootDir, const XStringW& FileName, IN cpu_type_t archCpuType,
+                                  IN UINTN Before, IN UINTN After, OUT UINT8 **Buffer, OUT UINTN *Length)
+{
+  EFI_STATUS     Status;
+  EFI_FILE      *FileHandle = NULL;
+  EFI_FILE_INFO *FileInfo;
+  UINT64         FileSize;
+  UINT8          Header[512]; // fat header and 25 fat_arch
+  UINTN          HeaderSize;
+  UINTN          Offset;
+  UINTN          Size;
+  UINTN          ReadSize;
+  UINTN          Expected;
+
+  *Buffer = NULL;
+  *Length = 0;
+  Status = RootDir->Open(RootDir, &FileHandle, (CHAR16*)FileName.wc_str(), EFI_FILE_MODE_READ, 0); // const missing const EFI_FILE*->Open
+  if (EFI_ERROR(Status) || !FileHandle) {
+    return EFI_ERROR(Status) ? Status : EFI_NOT_FOUND;
+  }
+  FileInfo = EfiLibFileInfo(FileHandle);
+  if (FileInfo == NULL) {
+    FileHandle->Close(FileHandle);
+    return EFI_NOT_FOUND;
+  }
+  FileSize = FileInfo->FileSize;
+  FreePool(FileInfo);
+  if (FileSize > MAX_UINT32) {
+    FileHandle->Close(FileHandle);
+    return EFI_UNSUPPORTED;
+  }
+
+  HeaderSize = (FileSize < sizeof(Header)) ? (UINTN)FileSize : sizeof(Header);
+  Status = FileHandle->Read(FileHandle, &HeaderSize, Header);
+  if (EFI_ERROR(Status)) {
+    FileHandle->Close(FileHandle);
+    return Status;
+  }
+  Size = (UINTN)FileSize;
+  if (EFI_ERROR(FatSlice(Header, HeaderSize, archCpuType, &Offset, &Size)) || Offset + Size > FileSize) {
+    FileHandle->Close(FileHandle);
+    return EFI_UNSUPPORTED;
+  }
+
+  *Buffer = (UINT8*)AllocatePool(Before + Size + After);
+  if (*Buffer == NULL) {
+    FileHandle->Close(FileHandle);
+    return EFI_OUT_OF_RESOURCES;
+  }
+  if (Offset == 0 && Size == FileSize) {
+    // thin, the header is already read
+    Expected = Size - HeaderSize;
+    ReadSize = Expected;
+    CopyMem(*Buffer + Before, Header, HeaderSize);
+    Status = FileHandle->Read(FileHandle, &ReadSize, *Buffer + Before + HeaderSize);
+  } else {
+    Expected = Size;
+    ReadSize = Expected;
+    Status = FileHandle->SetPosition(FileHandle, Offset);
+    if (!EFI_ERROR(Status)) {
+      Status = FileHandle->Read(FileHandle, &ReadSize, *Buffer + Before);
+    }
+  }
+  FileHandle->Close(FileHandle);
+  if (!EFI_ERROR(Status) && ReadSize != Expected) {
+    Status = EFI_VOLUME_CORRUPTED;
+  }
+  if (EFI_ERROR(Status)) {
+    FreePool(*Buffer);
+    *Buffer = NULL;
+    return Status;
+  }
+  gPerfCounters.FileOpens++;
+  gPerfCounters.FileBytesRead += HeaderSize + ReadSize;
+  *Length = Size;
+  return EFI_SUCCESS;
+}
+
 void toLowerStr(CHAR8 *tstr, IN CONST CHAR8 *str) {
     UINT16 cnt = 0;
     
@@ -199,15 +307,446 @@ XString8  LOADER_ENTRY::getKextExecPath(const XStringW& dirPath, const SIDELOAD_
   return TempName;
 }
 
+KEXT_INFO_PLIST::~KEXT_INFO_PLIST()
+{
+  if (Dict != NULL) {
+    Dict->FreeTag();
+  }
+}
+
+// one Info.plist read in flight
+typedef struct {
+  KEXT_INFO_PLIST*   Plist;
+  EFI_FILE*          File;
+  EFI_FILE_IO_TOKEN  Token;
+  BOOLEAN            Async;
+} KEXT_PLIST_READ;
+
+// Open the Info.plist of a kext and start reading it. With EFI_FILE_PROTOCOL_REVISION2 the read is queued
+// with ReadEx and completes while the previous plist is parsed, else it is done here.
+static void KextPlistReadStart(const EFI_FILE* Root, const XStringW& BundlePath, KEXT_PLIST_READ* Read)
+{
+  EFI_STATUS      Status;
+  EFI_FILE_INFO*  FileInfo;
+
+  Read->File = NULL;
+  Read->Async = FALSE;
+  Read->Token.Event = NULL;
+  Read->Token.Status = EFI_NOT_FOUND;
+  Read->Token.BufferSize = 0;
+  Read->Token.Buffer = NULL;
+
+  Read->Plist->Path = SWPrintf("%ls\\Contents\\Info.plist", BundlePath.wc_str());
+  Status = Root->Open(Root, &Read->File, (CHAR16*)Read->Plist->Path.wc_str(), EFI_FILE_MODE_READ, 0); // const missing const EFI_FILE*->Open
+  if (EFI_ERROR(Status)) {
+    //try to find a planar kext, without Contents
+    Read->Plist->Path = SWPrintf("%ls\\Info.plist", BundlePath.wc_str());
+    Read->Plist->NoContents = TRUE;
+    Status = Root->Open(Root, &Read->File, (CHAR16*)Read->Plist->Path.wc_str(), EFI_FILE_MODE_READ, 0);
+  }
+  if (EFI_ERROR(Status)) {
+    MsgLog("Failed to load extra kext : %ls \n", Read->Plist->Path.wc_str());
+    Read->Plist->Path.setEmpty();
+    Read->Plist->NoContents = FALSE;
+    Read->File = NULL;
+    return;
+  }
+#ifndef LESS_DEBUG
+  MsgLog("info plist path: %ls\n", Read->Plist->Path.wc_str());
+#endif
+
+  FileInfo = EfiLibFileInfo(Read->File);
+  if (FileInfo == NULL) {
+    return;
+  }
+  Read->Token.BufferSize = (UINTN)FileInfo->FileSize;
+  FreePool(FileInfo);
+  if (Read->Token.BufferSize == 0) {
+    return;
+  }
+  Read->Token.Buffer = AllocatePool(Read->Token.BufferSize);
+  if (Read->Token.Buffer == NULL) {
+    return;
+  }
+
+  if (Read->File->Revision >= EFI_FILE_PROTOCOL_REVISION2 && Read->File->ReadEx != NULL) {
+    Status = gBS->CreateEvent(0, TPL_CALLBACK, NULL, NULL, &Read->Token.Event);
+    if (!EFI_ERROR(Status)) {
+      Status = Read->File->ReadEx(Read->File, &Read->Token);
+      if (!EFI_ERROR(Status)) {
+        Read->Async = TRUE;
+        return;
+      }
+      gBS->CloseEvent(Read->Token.Event);
+      Read->Token.Event = NULL;
+    }
+  }
+  Read->Token.Status = Read->File->Read(Read->File, &Read->Token.BufferSize, Read->Token.Buffer);
+}
+
+// Wait for the read started by KextPlistReadStart and parse the plist
+static void KextPlistReadFinish(KEXT_PLIST_READ* Read)
+{
+  UINTN  Index;
+
+  if (Read->Async) {
+    gBS->WaitForEvent(1, &Read->Token.Event, &Index);
+    gBS->CloseEvent(Read->Token.Event);
+  }
+  if (Read->File != NULL) {
+    Read->File->Close(Read->File);
+  }
+  if (Read->Token.Buffer == NULL) {
+    return;
+  }
+  if (!EFI_ERROR(Read->Token.Status)) {
+    if( ParseXML((CHAR8*)Read->Token.Buffer, &Read->Plist->Dict, Read->Token.BufferSize)!=0 ) {
+      MsgLog("Failed to parse Info.plist: %ls\n", Read->Plist->Path.wc_str());
+      Read->Plist->Dict = NULL;
+    }
+  }
+  FreePool(Read->Token.Buffer);
+}
+
+// Read the Info.plist of every kext of kextArray, kextPlists[i] is for kextArray[i].
+// Reads are pipelined : Info.plist of kext i is read while Info.plist of kext i-1 is parsed.
+void LOADER_ENTRY::PreloadKextsInfoPlist(const XObjArray<SIDELOAD_KEXT>& kextArray, XObjArray<KEXT_INFO_PLIST>* kextPlists)
+{
+  KEXT_PLIST_READ  Reads[2];
+  size_t           AsyncCount = 0;
+
+  kextPlists->setEmpty();
+  for (size_t idx = 0 ; idx < kextArray.size() ; idx++ ) {
+    kextPlists->AddReference(new KEXT_INFO_PLIST, true);
+  }
+  if ( kextArray.size() == 0 || !selfOem.isKextsDirFound() ) return;
+
+  for (size_t idx = 0 ; idx <= kextArray.size() ; idx++ ) {
+    if ( idx < kextArray.size() ) {
+      const SIDELOAD_KEXT& KextEntry = kextArray[idx];
+      KEXT_PLIST_READ* Read = &Reads[idx % 2];
+      Read->Plist = &(*kextPlists)[idx];
+      KextPlistReadStart(&self.getCloverDir(), SWPrintf("%ls\\%ls\\%ls", selfOem.getKextsDirPathRelToSelfDir().wc_str(), KextEntry.KextDirNameUnderOEMPath.wc_str(), KextEntry.FileName.wc_str()), Read);
+      if (Read->Async) AsyncCount++;
+    }
+    if ( idx > 0 ) {
+      KextPlistReadFinish(&Reads[(idx - 1) % 2]);
+    }
+  }
+  DBG("Preloaded %zu kext Info.plist, %zu with ReadEx\n", kextArray.size(), AsyncCount);
+}
+
+//
+// kext cache
+//
+// With Boot/KextCache, the images built by LoadKext() (Info.plist and thinned executable) are kept in
+// misc\KextCache.bin. An image is reused while its Info.plist and executable keep their size and
+// modification time, so a hit costs two Opens and no read, parse or thinning. Each image has its own CRC.
+// The key is the volume, the bundle path, the loader type (OSBundleRequired depends on it) and the arch.
+//
+
+#define KEXT_CACHE_FILE       L"misc\\KextCache.bin"
+#define KEXT_CACHE_SIGNATURE  SIGNATURE_32('K', 'X', 'C', 'H')
+#define KEXT_CACHE_VERSION    1
+#define KEXT_CACHE_MAX_STRING 1024
+
+#pragma pack(push, 1)
+typedef struct {
+  UINT32  Signature;
+  UINT32  Version;
+  UINT32  Count;
+} KEXT_CACHE_HEADER;
+
+typedef struct {
+  UINT64    PlistSize;
+  EFI_TIME  PlistTime;
+  UINT64    ExecSize;
+  EFI_TIME  ExecTime;
+  UINT32    ArchCpuType;
+  UINT32    ImageLength;
+  UINT32    ImageCrc32;
+  UINT8     LoaderType;
+  UINT8     Reserved;
+  UINT16    VolumeLength;  // CHAR16 counts of the strings following the record, no terminator, then the image
+  UINT16    BundleLength;
+  UINT16    PlistLength;
+  UINT16    ExecLength;
+} KEXT_CACHE_RECORD;
+#pragma pack(pop)
+
+class KEXT_CACHE_ENTRY
+{
+public:
+  XStringW        VolumePath;
+  XStringW        BundlePath;
+  UINT8           LoaderType;
+  cpu_type_t      ArchCpuType;
+  XStringW        PlistPath;
+  UINT64          PlistSize;
+  EFI_TIME        PlistTime;
+  XStringW        ExecPath;    // empty for a kext without executable
+  UINT64          ExecSize;
+  EFI_TIME        ExecTime;
+  XBuffer<UINT8>  Image;       // _BooterKextFileInfo with offsets relative to it
+  UINT32          ImageCrc32;
+  BOOLEAN         Seen;        // loaded in this boot, other entries of the same volume are dropped on save
+
+  KEXT_CACHE_ENTRY() : VolumePath(), BundlePath(), LoaderType(0), ArchCpuType(0), PlistPath(), PlistSize(0), PlistTime(), ExecPath(), ExecSize(0), ExecTime(), Image(), ImageCrc32(0), Seen(FALSE) {}
+  KEXT_CACHE_ENTRY(const KEXT_CACHE_ENTRY& other) = delete; // Can be defined if needed
+  const KEXT_CACHE_ENTRY& operator = ( const KEXT_CACHE_ENTRY & ) = delete; // Can be defined if needed
+};
+
+static XObjArray<KEXT_CACHE_ENTRY> KextCache;
+static BOOLEAN                     KextCacheLoaded = FALSE;
+static BOOLEAN                     KextCacheDirty = FALSE;
+
+static UINTN KextCacheString(OUT XStringW& String, IN CONST UINT8 *Data, IN UINTN Length)
+{
+  if (Length > 0) {
+    String.strncpy((CONST CHAR16 *)Data, Length);
+  }
+  return Length * sizeof(CHAR16);
+}
+
+static void KextCacheLoad(void)
+{
+  EFI_STATUS          Status;
+  UINT8               *Data = NULL;
+  UINTN               DataSize = 0;
+  UINTN               Offset;
+  UINT32              Index;
+  KEXT_CACHE_HEADER   *Header;
+  KEXT_CACHE_RECORD   *Record;
+
+  if (KextCacheLoaded) {
+    return;
+  }
+  KextCacheLoaded = TRUE;
+  KextCache.setEmpty();
+
+  Status = egLoadFile(&self.getCloverDir(), KEXT_CACHE_FILE, &Data, &DataSize);
+  if (EFI_ERROR(Status)) {
+    DBG("Kext cache: %s, rebuilding\n", efiStrError(Status));
+    return;
+  }
+  Header = (KEXT_CACHE_HEADER *)Data;
+  if (DataSize < sizeof(KEXT_CACHE_HEADER) || Header->Signature != KEXT_CACHE_SIGNATURE ||
+      Header->Version != KEXT_CACHE_VERSION) {
+    DBG("Kext cache: bad file, rebuilding\n");
+    FreePool(Data);
+    KextCacheDirty = TRUE;
+    return;
+  }
+
+  Offset = sizeof(KEXT_CACHE_HEADER);
+  for (Index = 0; Index < Header->Count; Index++) {
+    if (DataSize - Offset < sizeof(KEXT_CACHE_RECORD)) {
+      break;
+    }
+    Record = (KEXT_CACHE_RECORD *)(Data + Offset);
+    Offset += sizeof(KEXT_CACHE_RECORD);
+    if (Record->VolumeLength > KEXT_CACHE_MAX_STRING || Record->BundleLength > KEXT_CACHE_MAX_STRING ||
+        Record->PlistLength > KEXT_CACHE_MAX_STRING || Record->ExecLength > KEXT_CACHE_MAX_STRING ||
+        DataSize - Offset < ((UINTN)Record->VolumeLength + Record->BundleLength + Record->PlistLength + Record->ExecLength) * sizeof(CHAR16) + Record->ImageLength) {
+      break;
+    }
+    KEXT_CACHE_ENTRY* Entry = new KEXT_CACHE_ENTRY;
+    Entry->LoaderType = Record->LoaderType;
+    Entry->ArchCpuType = (cpu_type_t)Record->ArchCpuType;
+    Entry->PlistSize = Record->PlistSize;
+    Entry->PlistTime = Record->PlistTime;
+    Entry->ExecSize = Record->ExecSize;
+    Entry->ExecTime = Record->ExecTime;
+    Entry->ImageCrc32 = Record->ImageCrc32;
+    Offset += KextCacheString(Entry->VolumePath, Data + Offset, Record->VolumeLength);
+    Offset += KextCacheString(Entry->BundlePath, Data + Offset, Record->BundleLength);
+    Offset += KextCacheString(Entry->PlistPath, Data + Offset, Record->PlistLength);
+    Offset += KextCacheString(Entry->ExecPath, Data + Offset, Record->ExecLength);
+    Entry->Image.ncpy(Data + Offset, Record->ImageLength);
+    Offset += Record->ImageLength;
+    KextCache.AddReference(Entry, true);
+  }
+  FreePool(Data);
+  DBG("Kext cache: %zu kexts\n", KextCache.size());
+}
+
+static void KextCacheSave(const XStringW& VolumePath, UINT8 LoaderType, cpu_type_t ArchCpuType)
+{
+  EFI_STATUS          Status;
+  XBuffer<UINT8>      Data;
+  KEXT_CACHE_HEADER   Header;
+  KEXT_CACHE_RECORD   Record;
+  size_t              Index;
+
+  if (!KextCacheLoaded) {
+    return;
+  }
+  // kexts of this volume not loaded in this boot are gone, forget them. Keep other volumes.
+  for (Index = KextCache.size(); Index-- > 0; ) {
+    const KEXT_CACHE_ENTRY& Entry = KextCache[Index];
+    if (!Entry.Seen && Entry.VolumePath == VolumePath && Entry.LoaderType == LoaderType && Entry.ArchCpuType == ArchCpuType) {
+      KextCache.RemoveAtIndex(Index);
+      KextCacheDirty = TRUE;
+    }
+  }
+  if (!KextCacheDirty) {
+    return;
+  }
+
+  ZeroMem(&Header, sizeof(Header));
+  Header.Signature = KEXT_CACHE_SIGNATURE;
+  Header.Version = KEXT_CACHE_VERSION;
+  Header.Count = (UINT32)KextCache.size();
+  Data.ncat(&Header, sizeof(Header));
+  for (Index = 0; Index < KextCache.size(); Index++) {
+    const KEXT_CACHE_ENTRY& Entry = KextCache[Index];
+    ZeroMem(&Record, sizeof(Record));
+    Record.PlistSize = Entry.PlistSize;
+    Record.PlistTime = Entry.PlistTime;
+    Record.ExecSize = Entry.ExecSize;
+    Record.ExecTime = Entry.ExecTime;
+    Record.ArchCpuType = (UINT32)Entry.ArchCpuType;
+    Record.ImageLength = (UINT32)Entry.Image.size();
+    Record.ImageCrc32 = Entry.ImageCrc32;
+    Record.LoaderType = Entry.LoaderType;
+    Record.VolumeLength = (UINT16)Entry.VolumePath.length();
+    Record.BundleLength = (UINT16)Entry.BundlePath.length();
+    Record.PlistLength = (UINT16)Entry.PlistPath.length();
+    Record.ExecLength = (UINT16)Entry.ExecPath.length();
+    Data.ncat(&Record, sizeof(Record));
+    Data.ncat(Entry.VolumePath.wc_str(), Record.VolumeLength * sizeof(CHAR16));
+    Data.ncat(Entry.BundlePath.wc_str(), Record.BundleLength * sizeof(CHAR16));
+    Data.ncat(Entry.PlistPath.wc_str(), Record.PlistLength * sizeof(CHAR16));
+    Data.ncat(Entry.ExecPath.wc_str(), Record.ExecLength * sizeof(CHAR16));
+    Data.ncat(Entry.Image.data(), Entry.Image.size());
+  }
+
+  Status = egSaveFile(&self.getCloverDir(), KEXT_CACHE_FILE, Data.data(), Data.size());
+  DBG("Kext cache: saved %zu kexts: %s\n", KextCache.size(), efiStrError(Status));
+  if (!EFI_ERROR(Status)) {
+    KextCacheDirty = FALSE;
+  }
+}
+
+static KEXT_CACHE_ENTRY* KextCacheFind(const XStringW& VolumePath, const XStringW& BundlePath, UINT8 LoaderType, cpu_type_t ArchCpuType)
+{
+  for (size_t Index = 0; Index < KextCache.size(); Index++) {
+    KEXT_CACHE_ENTRY& Entry = KextCache[Index];
+    if (Entry.LoaderType == LoaderType && Entry.ArchCpuType == ArchCpuType && Entry.BundlePath == BundlePath && Entry.VolumePath == VolumePath) {
+      return &Entry;
+    }
+  }
+  return NULL;
+}
+
+// size and modification time of a file. FALSE if it can't be opened or the driver gives no time,
+// in which case the file can't be validated and is not cached.
+static BOOLEAN KextCacheFileStamp(const EFI_FILE *RootDir, const XStringW& Path, OUT UINT64 *Size, OUT EFI_TIME *Time)
+{
+  EFI_STATUS      Status;
+  EFI_FILE        *File = NULL;
+  EFI_FILE_INFO   *FileInfo;
+
+  Status = RootDir->Open(RootDir, &File, (CHAR16*)Path.wc_str(), EFI_FILE_MODE_READ, 0); // const missing const EFI_FILE*->Open
+  if (EFI_ERROR(Status)) {
+    return FALSE;
+  }
+  FileInfo = EfiLibFileInfo(File);
+  File->Close(File);
+  if (FileInfo == NULL) {
+    return FALSE;
+  }
+  *Size = FileInfo->FileSize;
+  *Time = FileInfo->ModificationTime;
+  FreePool(FileInfo);
+  return Time->Year != 0;
+}
+
+static BOOLEAN KextCacheFileUnchanged(const EFI_FILE *RootDir, const XStringW& Path, UINT64 Size, const EFI_TIME& Time)
+{
+  UINT64    NewSize;
+  EFI_TIME  NewTime;
+
+  return KextCacheFileStamp(RootDir, Path, &NewSize, &NewTime) && NewSize == Size && CompareMem(&NewTime, &Time, sizeof(EFI_TIME)) == 0;
+}
+
+// LoadKext() from the cache, if the files of the kext didn't change
+static BOOLEAN KextCacheGet(const EFI_FILE *RootDir, const XStringW& VolumePath, const XString8& FileName, UINT8 LoaderType, cpu_type_t ArchCpuType, _DeviceTreeBuffer *kext)
+{
+  KEXT_CACHE_ENTRY  *Entry;
+
+  KextCacheLoad();
+  Entry = KextCacheFind(VolumePath, XStringW(FileName), LoaderType, ArchCpuType);
+  if (Entry == NULL) {
+    return FALSE;
+  }
+  if (!KextCacheFileUnchanged(RootDir, Entry->PlistPath, Entry->PlistSize, Entry->PlistTime) ||
+      (Entry->ExecPath.notEmpty() && !KextCacheFileUnchanged(RootDir, Entry->ExecPath, Entry->ExecSize, Entry->ExecTime))) {
+    DBG("Kext cache: %s changed\n", FileName.c_str());
+    return FALSE;
+  }
+  if (Entry->Image.size() < sizeof(_BooterKextFileInfo) || GetCrc32(Entry->Image.data(), Entry->Image.size()) != Entry->ImageCrc32) {
+    DBG("Kext cache: %s bad checksum\n", FileName.c_str());
+    return FALSE;
+  }
+  // No private copy: a Seen entry keeps its image until boot and InjectKexts() only reads it
+  kext->length = (UINT32)Entry->Image.size();
+  kext->paddr = (UINT32)(UINTN)Entry->Image.data();
+  Entry->Seen = TRUE;
+  DBG("Kext cache: %s\n", FileName.c_str());
+  return TRUE;
+}
+
+// remember an image built by LoadKext()
+static void KextCachePut(const EFI_FILE *RootDir, const XStringW& VolumePath, const XString8& FileName, UINT8 LoaderType, cpu_type_t ArchCpuType,
+                         const XStringW& PlistPath, const XStringW& ExecPath, const void *Image, UINT32 ImageLength)
+{
+  KEXT_CACHE_ENTRY  *Entry;
+  XStringW          BundlePath = XStringW(FileName);
+  UINT64            PlistSize = 0;
+  EFI_TIME          PlistTime;
+  UINT64            ExecSize = 0;
+  EFI_TIME          ExecTime;
+
+  ZeroMem(&PlistTime, sizeof(PlistTime));
+  ZeroMem(&ExecTime, sizeof(ExecTime));
+  if (BundlePath.length() > KEXT_CACHE_MAX_STRING || PlistPath.length() > KEXT_CACHE_MAX_STRING ||
+      ExecPath.length() > KEXT_CACHE_MAX_STRING || VolumePath.length() > KEXT_CACHE_MAX_STRING) {
+    return;
+  }
+  if (!KextCacheFileStamp(RootDir, PlistPath, &PlistSize, &PlistTime) ||
+      (ExecPath.notEmpty() && !KextCacheFileStamp(RootDir, ExecPath, &ExecSize, &ExecTime))) {
+    return;
+  }
+  Entry = KextCacheFind(VolumePath, BundlePath, LoaderType, ArchCpuType);
+  if (Entry == NULL) {
+    Entry = new KEXT_CACHE_ENTRY;
+    Entry->VolumePath = VolumePath;
+    Entry->BundlePath = BundlePath;
+    Entry->LoaderType = LoaderType;
+    Entry->ArchCpuType = ArchCpuType;
+    KextCache.AddReference(Entry, true);
+  }
+  Entry->PlistPath = PlistPath;
+  Entry->PlistSize = PlistSize;
+  Entry->PlistTime = PlistTime;
+  Entry->ExecPath = ExecPath;
+  Entry->ExecSize = ExecSize;
+  Entry->ExecTime = ExecTime;
+  Entry->Image.ncpy(Image, ImageLength);
+  Entry->ImageCrc32 = GetCrc32((UINT8*)Image, ImageLength);
+  Entry->Seen = TRUE;
+  KextCacheDirty = TRUE;
+}
+
 //it seems no more used? Or???
 EFI_STATUS LOADER_ENTRY::LoadKext(const EFI_FILE *RootDir, const XString8& FileName, IN cpu_type_t archCpuType, IN OUT void *kext_v)
 {
   EFI_STATUS  Status;
   UINT8*      infoDictBuffer = NULL;
   UINTN       infoDictBufferLength = 0;
-  UINT8*      executableFatBuffer = NULL;
-  UINT8*      executableBuffer = NULL;
   UINTN       executableBufferLength = 0;
+  UINT8*      kextBuffer = NULL;
 //  CHAR8*      bundlePathBuffer = NULL;
 //  UINTN       bundlePathBufferLength = 0;
   XStringW    TempName;
@@ -217,6 +756,17 @@ EFI_STATUS LOADER_ENTRY::LoadKext(const EFI_FILE *RootDir, const XString8& FileN
   BOOLEAN     inject = FALSE;
   _BooterKextFileInfo *infoAddr = NULL;
   _DeviceTreeBuffer *kext = (_DeviceTreeBuffer *)kext_v;
+  XStringW    CacheVolume;
+  XStringW    PlistName;
+  XStringW    ExecName;
+
+  // kexts of the booted volume can come from the kext cache
+  if (GlobalConfig.KextCache && Volume != NULL && RootDir == Volume->RootDir) {
+    CacheVolume = Volume->DevicePathString;
+    if (KextCacheGet(RootDir, CacheVolume, FileName, LoaderType, archCpuType, kext)) {
+      return EFI_SUCCESS;
+    }
+  }
 
   TempName = SWPrintf("%s\\%ls", FileName.c_str(), L"Contents\\Info.plist");
   Status = egLoadFile(RootDir, TempName.wc_str(), &infoDictBuffer, &infoDictBufferLength);
@@ -231,7 +781,8 @@ EFI_STATUS LOADER_ENTRY::LoadKext(const EFI_FILE *RootDir, const XString8& FileN
     }
     NoContents = TRUE;
   }
-  if( ParseXML((CHAR8*)infoDictBuffer, &dict,infoDictBufferLength)!=0 ) {
+  PlistName = TempName;
+  if( ParseXMLView((CHAR8*)infoDictBuffer, &dict,infoDictBufferLength)!=0 ) {
     FreePool(infoDictBuffer);
     MsgLog("Failed to load extra kext (failed to parse Info.plist): %s\n", FileName.c_str());
     return EFI_NOT_FOUND;
@@ -253,26 +804,30 @@ EFI_STATUS LOADER_ENTRY::LoadKext(const EFI_FILE *RootDir, const XString8& FileN
       TempName = SWPrintf("%s\\Contents\\MacOS\\%s", FileName.c_str(), Executable.c_str());
       //    snwprintf(TempName, 512, L"%s\\%s\\%s", FileName, "Contents\\MacOS",Executable);
     }
-    Status = egLoadFile(RootDir, TempName.wc_str(), &executableFatBuffer, &executableBufferLength);
-    if (EFI_ERROR(Status)) {
+    // only the slice of archCpuType is read, straight at its place in the booter kext
+    Status = ThinFatFileLoad(RootDir, TempName, archCpuType, sizeof(_BooterKextFileInfo) + infoDictBufferLength,
+                             FileName.sizeInBytesIncludingTerminator(), &kextBuffer, &executableBufferLength);
+    if (Status == EFI_UNSUPPORTED) {
       FreePool(infoDictBuffer);
-      MsgLog("Failed to load extra kext (executable not found): %s\n", FileName.c_str());
+      MsgLog("Thinning failed: %s\n", FileName.c_str());
       return EFI_NOT_FOUND;
     }
-    executableBuffer = executableFatBuffer;
-    if (ThinFatFile(&executableBuffer, &executableBufferLength, archCpuType)) {
+    if (EFI_ERROR(Status)) {
       FreePool(infoDictBuffer);
-      FreePool(executableBuffer);
-      MsgLog("Thinning failed: %s\n", FileName.c_str());
+      MsgLog("Failed to load extra kext (executable not found): %s\n", FileName.c_str());
       return EFI_NOT_FOUND;
     }
+    ExecName = TempName;
   }
 //  bundlePathBufferLength = StrLen(FileName) + 1;
 //  bundlePathBuffer = (__typeof__(bundlePathBuffer))AllocateZeroPool(bundlePathBufferLength);
 //  UnicodeStrToAsciiStrS(FileName, bundlePathBuffer, bundlePathBufferLength);
 
   kext->length = (UINT32)(sizeof(_BooterKextFileInfo) + infoDictBufferLength + executableBufferLength + FileName.sizeInBytesIncludingTerminator());
-  infoAddr = (_BooterKextFileInfo *)AllocatePool(kext->length);
+  if (kextBuffer == NULL) {
+    kextBuffer = (UINT8*)AllocatePool(kext->length);
+  }
+  infoAddr = (_BooterKextFileInfo *)kextBuffer;
   infoAddr->infoDictPhysAddr = sizeof(_BooterKextFileInfo);
   infoAddr->infoDictLength = (UINT32)infoDictBufferLength;
   infoAddr->executablePhysAddr = (UINT32)(sizeof(_BooterKextFileInfo) + infoDictBufferLength);
@@ -281,12 +836,13 @@ EFI_STATUS LOADER_ENTRY::LoadKext(const EFI_FILE *RootDir, const XString8& FileN
   infoAddr->bundlePathLength = (UINT32)FileName.sizeInBytesIncludingTerminator();
   kext->paddr = (UINT32)(UINTN)infoAddr; // Note that we cannot free infoAddr because of this
   CopyMem((CHAR8 *)infoAddr + sizeof(_BooterKextFileInfo), infoDictBuffer, infoDictBufferLength);
-  CopyMem((CHAR8 *)infoAddr + sizeof(_BooterKextFileInfo) + infoDictBufferLength, executableBuffer, executableBufferLength);
   CopyMem((CHAR8 *)infoAddr + sizeof(_BooterKextFileInfo) + infoDictBufferLength + executableBufferLength, FileName.c_str(), FileName.sizeInBytesIncludingTerminator());
   FreePool(infoDictBuffer);
-  FreePool(executableFatBuffer);
   dict->FreeTag();
 
+  if (CacheVolume.notEmpty()) {
+    KextCachePut(RootDir, CacheVolume, FileName, LoaderType, archCpuType, PlistName, ExecName, infoAddr, kext->length);
+  }
   return EFI_SUCCESS;
 }
 
@@ -461,6 +1017,13 @@ void LOADER_ENTRY::AddKextsInArray(XObjArray<SIDELOAD_KEXT>* kextArray)
 
   if ( !selfOem.isKextsDirFound() ) return;
 
+  // at most every kext and plug-in of InjectKextList, whatever the dirs they are found in
+  size_t MaxKexts = kextArray->size();
+  for ( size_t idx = 0 ; idx < InjectKextList.size() ; idx ++ ) {
+    MaxKexts += 1 + InjectKextList[idx].PlugInList.size();
+  }
+  kextArray->reserve(MaxKexts);
+
 #if defined(MDE_CPU_X64)
   cpu_type_t              archCpuType=CPU_TYPE_X86_64;
 #else
@@ -516,6 +1079,9 @@ void LOADER_ENTRY::AddKextsInArray(XObjArray<SIDELOAD_KEXT>* kextArray)
         }
       }
     }
+    if (GlobalConfig.KextCache && Volume != NULL) {
+      KextCacheSave(Volume->DevicePathString, LoaderType, archCpuType);
+    }
   }
 
 //  XStringW UniOSVersion;
@@ -683,45 +1249,9 @@ void LOADER_ENTRY::AddKextsInArray(XObjArray<SIDELOAD_KEXT>* kextArray)
 //}
 
 /*
- * Adler32 from Chameleon, not used
+ * mkext v1, not used. Its checksum is Adler32() of Platform/Checksum.
  */
-#define BASE 65521L /* largest prime smaller than 65536 */
-#define NMAX 5000
-// NMAX (was 5521) the largest n such that 255n(n+1)/2 + (n+1)(BASE-1) <= 2^32-1
-
-#define DO1(buf,i)  {s1 += buf[i]; s2 += s1;}
-#define DO2(buf,i)  DO1(buf,i); DO1(buf,i+1);
-#define DO4(buf,i)  DO2(buf,i); DO2(buf,i+2);
-#define DO8(buf,i)  DO4(buf,i); DO4(buf,i+4);
-#define DO16(buf)   DO8(buf,0); DO8(buf,8);
 #if 0
-static UINT32 Adler32(unsigned char *buf, long len)
-{
-  unsigned long s1 = 1; // adler & 0xffff;
-  unsigned long s2 = 0; // (adler >> 16) & 0xffff;
-  unsigned long result;
-  long k;
-
-  while (len > 0) {
-    k = len < NMAX ? len : NMAX;
-    len -= k;
-    while (k >= 16) {
-      DO16(buf);
-      buf += 16;
-      k -= 16;
-    }
-    if (k != 0) do {
-      s1 += *buf++;
-      s2 += s1;
-    } while (--k);
-    s1 %= BASE;
-    s2 %= BASE;
-  }
-  result = (s2 << 16) | s1;
-  // result is in big endian
-  return (UINT32)result;
-}
-
 typedef struct {
   UINT32  Magic;
   UINT32  Signature;
@@ -816,7 +1346,7 @@ void LOADER_ENTRY::patch_mkext_v1(UINT8 *drvPtr)
       mkext_ptr->NumKexts = SwapBytes32(mkext_numKexts);
 
       // update the checksum
-      mkext_ptr->Adler32 = SwapBytes32(Adler32((UINT8*)mkext_ptr + 0x10, mkext_len - 0x10));
+      mkext_ptr->Adler32 = SwapBytes32(Adler32(1, (UINT8*)mkext_ptr + 0x10, mkext_len - 0x10));
 
       // update the memory-map reference
       dtb->length = mkext_len;
@@ -830,6 +1360,7 @@ void LOADER_ENTRY::patch_mkext_v1(UINT8 *drvPtr)
 ////////////////////
 EFI_STATUS LOADER_ENTRY::InjectKexts(IN UINT32 deviceTreeP, IN UINT32* deviceTreeLength)
 {
+  TimelineSpan Span("InjectKexts");
   UINT8                             *dtEntry = (UINT8*)(UINTN) deviceTreeP;
   UINTN                             dtLen = (UINTN) *deviceTreeLength;
 
@@ -852,6 +1383,8 @@ EFI_STATUS LOADER_ENTRY::InjectKexts(IN UINT32 deviceTreeP, IN UINT32* deviceTre
   _BooterKextFileInfo               *drvinfo;
 
   UINT32                            KextCount;
+  UINTN                             KextsSize;
+  UINTN                             MemmapSize;
   UINTN                             Index;
 
 
@@ -911,7 +1444,19 @@ EFI_STATUS LOADER_ENTRY::InjectKexts(IN UINT32 deviceTreeP, IN UINT32* deviceTre
     return EFI_INVALID_PARAMETER;
   }
 
-  // make space for memory map entries
+  // Phase one: measure everything before the device tree is touched. The Driver- properties go where
+  // mm_extra is, the kexts go page aligned into the room left behind the device tree once extra is gone.
+  KextsSize = GetKextsSize();
+  MemmapSize = KextCount * (sizeof(DTProperty) + sizeof(_DeviceTreeBuffer));
+  offset = sizeof(DTProperty) + ((DTProperty*) extraPtr)->Length;
+  if (MemmapSize > sizeof(DTProperty) + ((DTProperty*) infoPtr)->Length ||
+      RoundPage(dtEntry + dtLen - offset) + KextsSize > RoundPage(dtEntry + dtLen)) {
+    printf("\nNot enough space reserved in device tree for %d kexts (%llu bytes)\n", KextCount, (UINT64)KextsSize);
+    gBS->Stall(5000000);
+    return EFI_BUFFER_TOO_SMALL;
+  }
+
+  // Phase two: make space for memory map entries
   platformEntry->NumProperties -= 2;
   offset = sizeof(DTProperty) + ((DTProperty*) infoPtr)->Length;
   CopyMem(drvPtr+offset, drvPtr, infoPtr-drvPtr);
@@ -922,6 +1467,7 @@ EFI_STATUS LOADER_ENTRY::InjectKexts(IN UINT32 deviceTreeP, IN UINT32* deviceTre
   CopyMem(extraPtr, extraPtr+offset, dtLen-(UINTN)(extraPtr-dtEntry)-offset);
   *deviceTreeLength -= (UINT32)offset;
 
+  // and copy each kext once, straight to its final place
   KextBase = RoundPage(dtEntry + *deviceTreeLength);
   if(!IsListEmpty(&gKextList)) {
     Index = 1;
@@ -1009,6 +1555,12 @@ const UINT8   KBELionReplaceEXT_X64[]  = { 0xE8, 0x0C, 0xFD, 0xFF, 0xFF, 0x90, 0
 // Fully reworked by Sherlocks. 2019.06.23
 //
 
+// Search window inside a procedure: the fixed window, cut at the next symbol when it is known
+// so that a pattern of the following procedure is never patched.
+static inline UINTN ProcSearchLen(UINTN procLen, UINTN maxLen)
+{
+  return (procLen != 0 && procLen < maxLen) ? procLen : maxLen;
+}
 
 void EFIAPI LOADER_ENTRY::KernelBooterExtensionsPatch()
 {
@@ -1018,6 +1570,7 @@ void EFIAPI LOADER_ENTRY::KernelBooterExtensionsPatch()
   UINTN   NumLion_i386_EXT   = 0;
   UINTN   NumLion_X64_EXT    = 0;
   UINTN   patchLocation2 = 0, patchLocation3 = 0;
+  UINTN   procLen = 0;
 
 
   DBG_RT("\nPatching kernel for injected kexts...\n");
@@ -1096,11 +1649,11 @@ void EFIAPI LOADER_ENTRY::KernelBooterExtensionsPatch()
 //      E8 ?? 00 00 00 EB 05 E8 -->
 //      E8 ?? 00 00 00 90 90 E8.
 
-      UINTN procLocation = searchProc("readStartupExtensions"_XS8);
+      UINTN procLocation = searchProc("readStartupExtensions"_XS8, &procLen);
       const UINT8 findJmp[] = {0xEB, 0x05};
       const UINT8 patchJmp[] = {0x90, 0x90};
-      DBG("==> readStartupExtensions at %llx\n", procLocation);
-      if (!SearchAndReplace(&KernelData[procLocation], 0x100, findJmp, 2, patchJmp, 1)) {
+      DBG("==> readStartupExtensions at %llx len %llx\n", procLocation, procLen);
+      if (!SearchAndReplace(&KernelData[procLocation], ProcSearchLen(procLen, 0x100), findJmp, 2, patchJmp, 1)) {
         DBG("load kexts not patched\n");
         for (UINTN j=procLocation+0x2b; j<procLocation+0x4b; ++j) {
           DBG("%02x ", KernelData[j]);
@@ -1197,8 +1750,8 @@ void EFIAPI LOADER_ENTRY::KernelBooterExtensionsPatch()
 //ffffff80009a2275 0F843C010000                    je         0xffffff80009a23b7
 //ffffff80009a227b
       UINTN taskLocation = searchProc("IOTaskHasEntitlement"_XS8);
-      procLocation = searchProc("loadExecutable"_XS8);
-      patchLocation2 = FindMemMask(&KernelData[procLocation], 0x500, find3, sizeof(find3), mask3, sizeof(mask3));
+      procLocation = searchProc("loadExecutable"_XS8, &procLen);
+      patchLocation2 = FindMemMask(&KernelData[procLocation], ProcSearchLen(procLen, 0x500), find3, sizeof(find3), mask3, sizeof(mask3));
       DBG("IOTaskHasEntitlement at 0x%llx, loadExecutable at 0x%llx\n", taskLocation, procLocation);
       DBG("find3 at 0x%llx\n", patchLocation2);
       if (patchLocation2 != MAX_UINTN) {
@@ -1211,7 +1764,7 @@ void EFIAPI LOADER_ENTRY::KernelBooterExtensionsPatch()
           KernelData[patchLocation2 + 4] = 0x12;
         }
       } else {
-        patchLocation2 = FindRelative32(KernelData, procLocation, 0x700, taskLocation);
+        patchLocation2 = FindRelative32(KernelData, procLocation, ProcSearchLen(procLen, 0x700), taskLocation);
         DBG("else search relative at 0x%llx\n", patchLocation2);
         if (patchLocation2 != 0) {
           DBG_RT("=> patch2 SIP applied\n");
@@ -1268,10 +1821,10 @@ void EFIAPI LOADER_ENTRY::KernelBooterExtensionsPatch()
  //Slice - hope this patch useful for some system that I have no.
       // KxldUnmap by vit9696
       // Avoid race condition in OSKext::removeKextBootstrap when using booter kexts without keepsyms=1.
-      procLocation = searchProc("removeKextBootstrap"_XS8);
+      procLocation = searchProc("removeKextBootstrap"_XS8, &procLen);
       const UINT8 find5[] = {0x00, 0x0F, 0x85, 00, 00, 0x00, 0x00, 0x48 };
       const UINT8 mask5[] = {0xFF, 0xFF, 0xFF, 00, 00, 0xFF, 0xFF, 0xFF };
-      patchLocation3 = FindMemMask(&KernelData[procLocation], 0x300, find5, sizeof(find5), mask5, sizeof(mask5));
+      patchLocation3 = FindMemMask(&KernelData[procLocation], ProcSearchLen(procLen, 0x300), find5, sizeof(find5), mask5, sizeof(mask5));
       DBG("removeKextBootstrap at 0x%llx\n", patchLocation3);
 
  /*
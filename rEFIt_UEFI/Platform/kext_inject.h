@@ -10,6 +10,7 @@ kext injection
 //#include "device_tree.h"
 #include <UefiLoader.h>
 #include "kernel_patcher.h"
+#include "../cpp_foundation/XString.h"
 
 ////////////////////
 // defines
@@ -90,6 +91,22 @@ typedef struct
 	_DeviceTreeBuffer	kext;
 } KEXT_ENTRY;
 
+class TagDict;
+
+// Info.plist of a kext to inject, read ahead by LOADER_ENTRY::PreloadKextsInfoPlist()
+class KEXT_INFO_PLIST
+{
+public:
+  XStringW  Path;              // relative to Clover dir, empty if the kext has no Info.plist
+  BOOLEAN   NoContents;        // planar kext, without Contents
+  TagDict*  Dict;              // NULL if it couldn't be read or parsed
+
+  KEXT_INFO_PLIST() : Path(), NoContents(FALSE), Dict(NULL) {}
+  KEXT_INFO_PLIST(const KEXT_INFO_PLIST&) = delete;
+  KEXT_INFO_PLIST& operator = (const KEXT_INFO_PLIST&) = delete;
+  ~KEXT_INFO_PLIST();
+};
+
 
 ////////////////////
 // functions
@@ -11,6 +11,8 @@ extern "C" {
 #include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
 #include <Library/OcDeviceTreeLib.h>
+#include <Library/SynchronizationLib.h>
+#include <Protocol/MpService.h>
 
 #ifdef __cplusplus
 }
@@ -22,6 +24,7 @@ extern "C" {
 #include "kext_inject.h"
 #include "../gui/menu_items/menu_items.h"
 #include "MemoryOperation.h"
+#include "Events.h"
 
 #define OLD_METHOD 0
 
@@ -1046,89 +1049,302 @@ void LOADER_ENTRY::KextPatcherRegisterKexts(void *FSInject_v, void *ForceLoadKex
 
 //
 // PatchKext is called for every kext from prelinked kernel (kernelcache) or from DevTree (booting with drivers).
-// Add kext detection code here and call kext specific patch function.
+// Add kext detection code to BuildKextPatchMap() and call kext specific patch function here.
+// BundleIdKnown - gKextBundleIdentifier is already set by the caller
 //
-void LOADER_ENTRY::PatchKext(UINT8 *Driver, UINT32 DriverSize, CHAR8 *InfoPlist, UINT32 InfoPlistSize)
+void LOADER_ENTRY::PatchKext(UINT8 *Driver, UINT32 DriverSize, CHAR8 *InfoPlist, UINT32 InfoPlistSize, BOOLEAN BundleIdKnown)
 {
-  if (KernelAndKextPatches.KPATIConnectorsController.notEmpty()) {
-    //
-    // ATIConnectors
-    //
-    if (!ATIConnectorsPatchInited) {
-      ATIConnectorsPatchInit();
-    }
-    if (   AsciiStrStr(InfoPlist, ATIKextBundleId[0]) != NULL  // ATI boundle id
-        || AsciiStrStr(InfoPlist, ATIKextBundleId[1]) != NULL  // AMD boundle id
-        || AsciiStrStr(InfoPlist, "com.apple.kext.ATIFramebuffer") != NULL // SnowLeo
-        || AsciiStrStr(InfoPlist, "com.apple.kext.AMDFramebuffer") != NULL //Maverics
-        ) {
-      ATIConnectorsPatch(Driver, DriverSize, InfoPlist, InfoPlistSize);
-      return;
-    }
+  if (!BundleIdKnown) {
+    ExtractKextBundleIdentifier(InfoPlist);
   }
   
-  ExtractKextBundleIdentifier(InfoPlist);
-  
-  if (KernelAndKextPatches.KPAppleIntelCPUPM &&
-      (AsciiStrStr(InfoPlist,
-                   "<string>com.apple.driver.AppleIntelCPUPowerManagement</string>") != NULL)) {
-    //
-    // AppleIntelCPUPM
-    //
-    AppleIntelCPUPMPatch(Driver, DriverSize, InfoPlist, InfoPlistSize);
-  } else if (KernelAndKextPatches.KPAppleRTC &&
-             (AsciiStrStr(InfoPlist, "com.apple.driver.AppleRTC") != NULL)) {
-    //
-    // AppleRTC
-    //
-    AppleRTCPatch(Driver, DriverSize, InfoPlist, InfoPlistSize);
-  } else if (KernelAndKextPatches.KPDELLSMBIOS &&
-           (AsciiStrStr(InfoPlist, "com.apple.driver.AppleSMBIOS") != NULL)) {
-    //
-    // DellSMBIOSPatch
-    //
-    DBG_RT("Remap SMBIOS Table require, AppleSMBIOS...\n");
-    DellSMBIOSPatch(Driver, DriverSize, InfoPlist, InfoPlistSize);
-  } else if (KernelAndKextPatches.KPDELLSMBIOS &&
-             (AsciiStrStr(InfoPlist, "com.apple.driver.AppleACPIPlatform") != NULL)) {
-    //
-    // DellSMBIOS
-    //
-    // AppleACPIPlatform
-    //
-    DellSMBIOSPatch(Driver, DriverSize, InfoPlist, InfoPlistSize);
-  } else if (gBDWEIOPCIFixRequire && (AsciiStrStr(InfoPlist, "com.apple.iokit.IOPCIFamily") != NULL)) {
-    //
-    // Broadwell-E IOPCIFamily Patch
-    //
-    BDWE_IOPCIPatch(Driver, DriverSize, InfoPlist, InfoPlistSize);
-  } else if (gSNBEAICPUFixRequire && (AsciiStrStr(InfoPlist, "com.apple.driver.AppleIntelCPUPowerManagement") != NULL)) {
-    //
-    // SandyBridge-E AppleIntelCPUPowerManagement Patch implemented by syscl
-    //
-    SNBE_AICPUPatch(Driver, DriverSize, InfoPlist, InfoPlistSize);
-  } else if (KernelAndKextPatches.EightApple &&
-          /*   (AsciiStrStr(InfoPlist, "com.apple.iokit.IOGraphicsFamily") != NULL) && */
-             (AsciiStrStr(InfoPlist, "I/O Kit Graphics Family") != NULL)) {
-    //
-    // Patch against 8 apple glitch
-    //
-    DBG_RT("Patch 8 apple required, IOGraphicsFamily...\n");
-    EightApplePatch(Driver, DriverSize);
-    Stall(10000000);
+  switch (FindKextPatches()) {
+    case KextBuiltinATIConnectors:
+      //
+      // ATIConnectors
+      //
+      ATIConnectorsPatch(Driver, DriverSize, InfoPlist, InfoPlistSize);
+      return;
+    case KextBuiltinAppleIntelCPUPM:
+      //
+      // AppleIntelCPUPM
+      //
+      AppleIntelCPUPMPatch(Driver, DriverSize, InfoPlist, InfoPlistSize);
+      break;
+    case KextBuiltinAppleRTC:
+      //
+      // AppleRTC
+      //
+      AppleRTCPatch(Driver, DriverSize, InfoPlist, InfoPlistSize);
+      break;
+    case KextBuiltinDellSMBIOS:
+      //
+      // DellSMBIOSPatch
+      //
+      DBG_RT("Remap SMBIOS Table require, AppleSMBIOS...\n");
+      DellSMBIOSPatch(Driver, DriverSize, InfoPlist, InfoPlistSize);
+      break;
+    case KextBuiltinDellACPIPlatform:
+      //
+      // DellSMBIOS
+      //
+      // AppleACPIPlatform
+      //
+      DellSMBIOSPatch(Driver, DriverSize, InfoPlist, InfoPlistSize);
+      break;
+    case KextBuiltinBDWEIOPCI:
+      //
+      // Broadwell-E IOPCIFamily Patch
+      //
+      BDWE_IOPCIPatch(Driver, DriverSize, InfoPlist, InfoPlistSize);
+      break;
+    case KextBuiltinSNBEAICPU:
+      //
+      // SandyBridge-E AppleIntelCPUPowerManagement Patch implemented by syscl
+      //
+      SNBE_AICPUPatch(Driver, DriverSize, InfoPlist, InfoPlistSize);
+      break;
+    case KextBuiltinNone:
+      // "I/O Kit Graphics Family" is CFBundleName, not a bundle id
+      if (KernelAndKextPatches.EightApple &&
+       /*   (AsciiStrStr(InfoPlist, "com.apple.iokit.IOGraphicsFamily") != NULL) && */
+          (AsciiStrStr(InfoPlist, "I/O Kit Graphics Family") != NULL)) {
+        //
+        // Patch against 8 apple glitch
+        //
+        DBG_RT("Patch 8 apple required, IOGraphicsFamily...\n");
+        EightApplePatch(Driver, DriverSize);
+        Stall(10000000);
+      }
+      break;
   }
   //com.apple.iokit.IOGraphicsFamily
   
-    for (size_t i = 0; i < KernelAndKextPatches.KextPatches.size(); i++) {
-      XString8& Name = KernelAndKextPatches.KextPatches[i].Name;
-      BOOLEAN   isBundle = Name.contains(".");
-      if ((KernelAndKextPatches.KextPatches[i].Data.size() > 0) &&
-          isBundle?(AsciiStrCmp(gKextBundleIdentifier, Name.c_str()) == 0):(AsciiStrStr(gKextBundleIdentifier, Name.c_str()) != NULL)) {
-      //    (AsciiStrStr(InfoPlist, KernelAndKextPatches.KextPatches[i].Name) != NULL)) {
+    BOOLEAN Compiled = PatchIndex && KextPatchEntries.size() == KernelAndKextPatches.KextPatches.size();
+    BOOLEAN Pending = FALSE;
+    BOOLEAN Defer = DeferKextPatches && Compiled;
+    for (size_t m = 0; Defer && m < KextPatchMatches.size(); m++) {
+      // only when the order against not compiled patches does not matter
+      Defer = KextPatchEntries.ElementAt(KextPatchMatches.ElementAt(m)).Search != NULL;
+    }
+    for (size_t m = 0; m < KextPatchMatches.size(); m++) {
+      size_t i = KextPatchMatches.ElementAt(m);
         DBG_RT("\n\nPatch kext: %s\n", KernelAndKextPatches.KextPatches[i].Name.c_str());
+        if (Compiled && KextPatchEntries.ElementAt(i).Search) {
+          // collected, to be done in one pass over the driver
+          const KEXT_PATCH& kextpatch = KernelAndKextPatches.KextPatches[i];
+          UINTN SearchLen = kextpatch.SearchLen;
+          UINTN procAddr = searchProcInDriver(Driver, DriverSize, kextpatch.ProcedureName);
+          if (!SearchLen || (SearchLen > DriverSize)) {
+            SearchLen = DriverSize;
+          }
+          KextPatchEntries.ElementAt(i).Active = TRUE;
+          KextPatchEntries.ElementAt(i).Start = procAddr;
+          KextPatchEntries.ElementAt(i).Length = (SearchLen == DriverSize) ? DriverSize - procAddr : SearchLen;
+          Pending = TRUE;
+          continue;
+        }
+        if (Pending) {
+          AnyKextPatchCompiled(Driver, DriverSize);
+          Pending = FALSE;
+        }
         AnyKextPatch(Driver, DriverSize, InfoPlist, InfoPlistSize, i);
+    }
+    if (Pending && !(Defer && DeferKextPatchCompiled(Driver, DriverSize))) {
+      AnyKextPatchCompiled(Driver, DriverSize);
+    }
+}
+
+//
+// Apply all the active compiled kext patches with one pass over the driver.
+//
+void LOADER_ENTRY::AnyKextPatchCompiled(UINT8 *Driver, UINT32 DriverSize)
+{
+  MultiPatternApply(KextPatchEntries.data(), KextPatchEntries.size(), PatchIndex, Driver, DriverSize);
+  ReportKextPatchCompiled(KextPatchEntries.data());
+}
+
+//
+// Logs and deactivates the active entries, KextPatchEntries.size() of them.
+//
+void LOADER_ENTRY::ReportKextPatchCompiled(MULTI_PATTERN_ENTRY *Entries)
+{
+  for (size_t i = 0; i < KextPatchEntries.size(); i++) {
+    if (!Entries[i].Active) {
+      continue;
+    }
+    Entries[i].Active = FALSE;
+    DBG("AnyKextPatch %zu: %s : %llu replaces done\n", i, KernelAndKextPatches.KextPatches[i].Label.c_str(), Entries[i].NumReplaces);
+    if (KernelAndKextPatches.KPDebug) {
+      if (Entries[i].NumReplaces > 0) {
+        DBG_RT("==> %s patched %llu times!\n", KernelAndKextPatches.KextPatches[i].Label.c_str(), Entries[i].NumReplaces);
+      } else {
+        DBG_RT("==> %s NOT patched!\n", KernelAndKextPatches.KextPatches[i].Label.c_str());
       }
     }
+  }
+  if (KernelAndKextPatches.KPDebug) {
+    gBS->Stall(2000000);
+  }
+}
+
+//
+// Keeps a copy of the active compiled kext patches for RunKextPatchJobs().
+// Only in the room reserved by PrepareKextPatchJobs(), no allocation. FALSE if full, the caller applies them.
+//
+BOOLEAN LOADER_ENTRY::DeferKextPatchCompiled(UINT8 *Driver, UINT32 DriverSize)
+{
+  KEXT_PATCH_JOB Job;
+
+  if (KextPatchJobs.size() >= KextPatchJobs.allocatedSize() ||
+      KextPatchJobEntries.size() + KextPatchEntries.size() > KextPatchJobEntries.allocatedSize()) {
+    return FALSE;
+  }
+  Job.Driver = Driver;
+  Job.DriverSize = DriverSize;
+  Job.FirstEntry = KextPatchJobEntries.size();
+  KextPatchJobEntries.AddArray(KextPatchEntries.data(), KextPatchEntries.size());
+  KextPatchJobs.Add(Job);
+  for (size_t i = 0; i < KextPatchEntries.size(); i++) {
+    KextPatchEntries.ElementAt(i).Active = FALSE;
+  }
+  return TRUE;
+}
+
+//
+// Shared by the processors running KextPatchWorker().
+// Each processor takes its own MULTI_PATTERN_INDEX, then jobs one by one.
+// Nothing here may call boot services, APs can't. Log with MemLogApf() only.
+//
+typedef struct {
+  KEXT_PATCH_JOB       *Jobs;
+  UINT32               JobCount;
+  MULTI_PATTERN_ENTRY  *Entries;
+  UINTN                EntryCount;
+  MULTI_PATTERN_INDEX  *Indexes;
+  UINT32               IndexCount;
+  volatile UINT32      NextJob;
+  volatile UINT32      NextIndex;
+} KEXT_PATCH_WORK;
+
+static VOID EFIAPI KextPatchWorker(IN OUT VOID *Buffer)
+{
+  KEXT_PATCH_WORK *Work = (KEXT_PATCH_WORK*)Buffer;
+  UINT32          Slot = InterlockedIncrement(&Work->NextIndex) - 1;
+  UINT32          Job;
+  UINT32          JobsDone = 0;
+
+  if (Slot >= Work->IndexCount) {
+    return;
+  }
+  while ((Job = InterlockedIncrement(&Work->NextJob) - 1) < Work->JobCount) {
+    MultiPatternApplyOnAp(&Work->Entries[Work->Jobs[Job].FirstEntry], Work->EntryCount, &Work->Indexes[Slot],
+                          Work->Jobs[Job].Driver, Work->Jobs[Job].DriverSize);
+    JobsDone++;
+  }
+  MemLogApf("kext patch worker %u: %u kexts\n", Slot, JobsDone);
+}
+
+//
+// Called from StartLoader(), while boot services are there : the kext patching may run
+// around ExitBootServices(), where it can't allocate, locate protocols or create events.
+// Gets the MP services, one MULTI_PATTERN_INDEX per processor and room for KEXT_PATCH_JOBS_MAX jobs.
+// If anything is missing, kext patches are not deferred and run on the BSP.
+//
+#define KEXT_PATCH_JOBS_MAX 64
+
+void LOADER_ENTRY::PrepareKextPatchJobs()
+{
+  EFI_STATUS                Status;
+  EFI_MP_SERVICES_PROTOCOL  *MpServices = NULL;
+  UINTN                     NumberOfProcessors = 0;
+  UINTN                     NumberOfEnabledProcessors = 0;
+
+  if (!KernelAndKextPatches.KPParallel || KextPatchIndexes != NULL) {
+    return;
+  }
+  Status = gBS->LocateProtocol(&gEfiMpServiceProtocolGuid, NULL, (void **)&MpServices);
+  if (!EFI_ERROR(Status)) {
+    Status = MpServices->GetNumberOfProcessors(MpServices, &NumberOfProcessors, &NumberOfEnabledProcessors);
+  }
+  if (EFI_ERROR(Status) || NumberOfEnabledProcessors < 2) {
+    DBG("parallel kext patching: no APs, kexts will be patched on the BSP\n");
+    return;
+  }
+  Status = gBS->CreateEvent(0, TPL_NOTIFY, NULL, NULL, &KextPatchEvent);
+  if (EFI_ERROR(Status)) {
+    KextPatchEvent = NULL;
+    return;
+  }
+  KextPatchMpServices = MpServices;
+  KextPatchIndexCount = (UINT32)MIN(NumberOfEnabledProcessors, KEXT_PATCH_JOBS_MAX);
+  KextPatchIndexes = new MULTI_PATTERN_INDEX[KextPatchIndexCount];
+  KextPatchJobs.reserve(KEXT_PATCH_JOBS_MAX);
+  KextPatchJobEntries.reserve(KEXT_PATCH_JOBS_MAX * KernelAndKextPatches.KextPatches.size());
+  DBG("parallel kext patching: %u processors\n", KextPatchIndexCount);
+}
+
+//
+// Applies the deferred kext patches with all the enabled processors
+// and then logs the results in kext order, as it would be done serially.
+// Uses only what PrepareKextPatchJobs() got. Without boot services, the BSP does all the jobs.
+//
+void LOADER_ENTRY::RunKextPatchJobs()
+{
+  EFI_STATUS                Status;
+  EFI_MP_SERVICES_PROTOCOL  *MpServices = (EFI_MP_SERVICES_PROTOCOL *)KextPatchMpServices;
+  BOOLEAN                   Started = FALSE;
+  KEXT_PATCH_WORK           Work;
+
+  if (KextPatchJobs.isEmpty() || KextPatchIndexes == NULL) {
+    return;
+  }
+
+  Work.Jobs = KextPatchJobs.data();
+  Work.JobCount = (UINT32)KextPatchJobs.size();
+  Work.Entries = KextPatchJobEntries.data();
+  Work.EntryCount = KextPatchEntries.size();
+  Work.IndexCount = (UINT32)MIN(KextPatchIndexCount, KextPatchJobs.size());
+  Work.Indexes = KextPatchIndexes;
+  Work.NextJob = 0;
+  Work.NextIndex = 0;
+
+  if (Work.IndexCount > 1 && !ExitBootServicesCalled) {
+    Status = MpServices->StartupAllAPs(MpServices, KextPatchWorker, FALSE, KextPatchEvent, 0, &Work, NULL);
+    Started = !EFI_ERROR(Status);
+  }
+  DBG("patching %u kexts on %u processors\n", Work.JobCount, Started ? Work.IndexCount : 1);
+
+  // the BSP works too, then waits for the APs
+  KextPatchWorker(&Work);
+  if (Started) {
+    while (gBS->CheckEvent(KextPatchEvent) == EFI_NOT_READY) {
+      CpuPause();
+    }
+    MemLogDrainAp();
+  }
+
+  for (size_t j = 0; j < KextPatchJobs.size(); j++) {
+    DBG_RT("\nKext patches at %llx:\n", (UINTN)KextPatchJobs.ElementAt(j).Driver);
+    ReportKextPatchCompiled(&KextPatchJobEntries.ElementAt(KextPatchJobs.ElementAt(j).FirstEntry));
+  }
+  KextPatchJobs.setEmpty();
+  KextPatchJobEntries.setEmpty();
+}
+
+//
+// Parses the value of <integer> without attributes, it is decimal
+// unless prefixed with 0x.
+//
+static UINT64 GetPlistPlainInteger(CONST CHAR8 *IntValue)
+{
+  if ((IntValue[1] == 'x') || (IntValue[1] == 'X')) {
+    return AsciiStrHexToUintn(IntValue);
+  }
+  if (IntValue[0] == '-') {
+    return (UINTN)(-(INTN)AsciiStrDecimalToUintn(IntValue + 1));
+  }
+  return AsciiStrDecimalToUintn((IntValue[0] == '+') ? (IntValue + 1) : IntValue);
 }
 
 //
@@ -1171,14 +1387,7 @@ UINT64 GetPlistHexValue(CONST CHAR8 *Plist, CONST CHAR8 *Key, CONST CHAR8 *Whole
   // search for <integer>
   IntTag = AsciiStrStr(Value, "<integer>"); //this is decimal value
   if (IntTag != NULL) {
-    IntTag += 9; //next after ">"
-    if ((IntTag[1] == 'x') || (IntTag[1] == 'X')) {
-      return AsciiStrHexToUintn(IntTag);
-    }
-    if (IntTag[0] == '-') {
-      return (UINTN)(-(INTN)AsciiStrDecimalToUintn(IntTag + 1));
-    }
-    return AsciiStrDecimalToUintn((IntTag[0] == '+') ? (IntTag + 1) : IntTag);
+    return GetPlistPlainInteger(IntTag + 9); //next after ">"
   }
   
   // search for <integer
@@ -1271,6 +1480,240 @@ UINT64 GetPlistHexValue(CONST CHAR8 *Plist, CONST CHAR8 *Key, CONST CHAR8 *Whole
   return NumValue;
 }
 
+//
+// Flat table of the kexts in _PrelinkInfoDictionary, filled by one pass of
+// IndexPrelinkedKexts() over the prelink info.
+// Storage is static, as everything else here runs during ExitBootServices()
+// and should not allocate. IDs of <integer ID="xx"> are kept in a small
+// open addressing table so that IDREFs are resolved without rescanning
+// WholePlist. An IDREF always follows its ID in the serialized plist.
+//
+#define PRELINKED_KEXTS_MAX         1024
+#define PRELINK_ID_SLOTS            2048 // power of 2
+#define PRELINK_UNRESOLVED_ADDR     BIT0
+#define PRELINK_UNRESOLVED_SIZE     BIT1
+
+typedef struct {
+  CHAR8         *InfoPlist;      // <dict> of the kext
+  UINT32        InfoPlistSize;   // up to and including </dict>
+  UINT32        BundleIdLen;     // 0 if not found
+  CONST CHAR8   *BundleId;       // CFBundleIdentifier value, not terminated
+  UINT64        ExecAddr;        // _PrelinkExecutableSourceAddr
+  UINT64        ExecSize;        // _PrelinkExecutableSize
+  UINT8         Unresolved;      // PRELINK_UNRESOLVED_xxx, left for GetPlistHexValue()
+} PRELINKED_KEXT;
+
+typedef struct {
+  UINT32        Id;              // ID + 1, 0 means empty slot
+  UINT64        Value;
+} PRELINK_ID_SLOT;
+
+typedef enum {
+  PrelinkKeyNone,
+  PrelinkKeyBundleId,
+  PrelinkKeyExecAddr,
+  PrelinkKeyExecSize
+} PRELINK_KEY;
+
+STATIC PRELINKED_KEXT   mPrelinkedKexts[PRELINKED_KEXTS_MAX];
+STATIC UINTN            mPrelinkedKextsCount;
+STATIC PRELINK_ID_SLOT  mPrelinkIds[PRELINK_ID_SLOTS];
+STATIC UINTN            mPrelinkIdsCount;
+
+//
+// TRUE if the tag at Tag (TagEnd points to its '>') is Name
+// with or without attributes.
+//
+static BOOLEAN PrelinkTagIs(CONST CHAR8 *Tag, CONST CHAR8 *TagEnd, CONST CHAR8 *Name)
+{
+  UINTN Len = AsciiStrLen(Name);
+  if ((UINTN)(TagEnd - Tag) < Len || CompareMem(Tag, Name, Len) != 0) {
+    return FALSE;
+  }
+  return Tag[Len] == '>' || Tag[Len] == ' ' || Tag[Len] == '/';
+}
+
+static BOOLEAN PrelinkKeyIs(CONST CHAR8 *Text, CONST CHAR8 *TextEnd, CONST CHAR8 *Name)
+{
+  UINTN Len = AsciiStrLen(Name);
+  return (UINTN)(TextEnd - Text) == Len && CompareMem(Text, Name, Len) == 0;
+}
+
+//
+// Gets decimal value of attribute Attr (like " ID=\"") of the tag.
+//
+static BOOLEAN PrelinkTagId(CONST CHAR8 *Tag, CONST CHAR8 *TagEnd, CONST CHAR8 *Attr, UINT32 *Id)
+{
+  UINTN        Len = AsciiStrLen(Attr);
+  CONST CHAR8  *Ptr;
+  UINTN        Digits = 0;
+
+  for (Ptr = Tag; Ptr + Len < TagEnd; Ptr++) {
+    if (CompareMem(Ptr, Attr, Len) != 0) {
+      continue;
+    }
+    *Id = 0;
+    for (Ptr += Len; Ptr < TagEnd && *Ptr >= '0' && *Ptr <= '9'; Ptr++) {
+      *Id = *Id * 10 + (*Ptr - '0');
+      Digits++;
+    }
+    return Digits > 0 && Digits <= 8 && *Ptr == '"';
+  }
+  return FALSE;
+}
+
+static void PrelinkIdStore(UINT32 Id, UINT64 Value)
+{
+  UINTN Slot = (Id * 2654435761u) & (PRELINK_ID_SLOTS - 1);
+
+  // keep the table sparse, ids dropped here fall back to GetPlistHexValue()
+  if (mPrelinkIdsCount >= PRELINK_ID_SLOTS / 4 * 3) {
+    return;
+  }
+  while (mPrelinkIds[Slot].Id != 0 && mPrelinkIds[Slot].Id != Id + 1) {
+    Slot = (Slot + 1) & (PRELINK_ID_SLOTS - 1);
+  }
+  if (mPrelinkIds[Slot].Id == 0) {
+    mPrelinkIdsCount++;
+  }
+  mPrelinkIds[Slot].Id = Id + 1;
+  mPrelinkIds[Slot].Value = Value;
+}
+
+static BOOLEAN PrelinkIdLookup(UINT32 Id, UINT64 *Value)
+{
+  UINTN Slot = (Id * 2654435761u) & (PRELINK_ID_SLOTS - 1);
+
+  while (mPrelinkIds[Slot].Id != 0) {
+    if (mPrelinkIds[Slot].Id == Id + 1) {
+      *Value = mPrelinkIds[Slot].Value;
+      return TRUE;
+    }
+    Slot = (Slot + 1) & (PRELINK_ID_SLOTS - 1);
+  }
+  return FALSE;
+}
+
+//
+// Tokenizes prelink info once and fills mPrelinkedKexts.
+// Keys are only taken from the kext's own dict (DictLevel == 2),
+// not from nested dicts like IOKitPersonalities.
+// Returns FALSE if there are more kexts than the table holds.
+//
+static BOOLEAN IndexPrelinkedKexts(CHAR8 *WholePlist, UINTN PlistSize)
+{
+  CHAR8           *Ptr = WholePlist;
+  CHAR8           *End = WholePlist + PlistSize;
+  CHAR8           *Tag;
+  CHAR8           *TagEnd;
+  CHAR8           *Text;
+  INTN            DictLevel = 0;
+  PRELINKED_KEXT  *Kext = NULL;
+  PRELINK_KEY     Key = PrelinkKeyNone;
+  PRELINK_KEY     ValueKey;
+  UINT64          Value;
+  UINT32          Id;
+  BOOLEAN         Known;
+
+  mPrelinkedKextsCount = 0;
+  mPrelinkIdsCount = 0;
+  ZeroMem(mPrelinkIds, sizeof(mPrelinkIds));
+
+  while (Ptr < End && *Ptr != '\0') {
+    if (*Ptr != '<') {
+      Ptr++;
+      continue;
+    }
+    Tag = Ptr;
+    for (TagEnd = Tag + 1; TagEnd < End && *TagEnd != '\0' && *TagEnd != '>'; TagEnd++) {}
+    if (TagEnd >= End || *TagEnd != '>') {
+      break;
+    }
+    Ptr = TagEnd + 1;
+
+    if (Tag[1] == '!' || Tag[1] == '?') {
+      // comment or xml header
+      continue;
+    }
+    if (Tag[1] == '/') {
+      if (PrelinkTagIs(Tag, TagEnd, "</dict")) {
+        Key = PrelinkKeyNone;
+        if (DictLevel == 2 && Kext != NULL) {
+          // kext end
+          Kext->InfoPlistSize = (UINT32)(Ptr - Kext->InfoPlist);
+          Kext = NULL;
+        }
+        DictLevel--;
+      }
+      continue;
+    }
+
+    // any opening tag is the value of the pending key
+    ValueKey = Key;
+    Key = PrelinkKeyNone;
+
+    if (PrelinkTagIs(Tag, TagEnd, "<dict")) {
+      if (TagEnd[-1] == '/') {
+        continue;
+      }
+      DictLevel++;
+      if (DictLevel == 2) {
+        // kext start
+        if (mPrelinkedKextsCount >= PRELINKED_KEXTS_MAX) {
+          return FALSE;
+        }
+        Kext = &mPrelinkedKexts[mPrelinkedKextsCount++];
+        ZeroMem(Kext, sizeof(*Kext));
+        Kext->InfoPlist = Tag;
+        Kext->Unresolved = PRELINK_UNRESOLVED_ADDR | PRELINK_UNRESOLVED_SIZE;
+      }
+    } else if (PrelinkTagIs(Tag, TagEnd, "<key")) {
+      if (DictLevel != 2 || Kext == NULL) {
+        continue;
+      }
+      for (Text = Ptr; Text < End && *Text != '\0' && *Text != '<'; Text++) {}
+      if (PrelinkKeyIs(Ptr, Text, "CFBundleIdentifier")) {
+        Key = PrelinkKeyBundleId;
+      } else if (PrelinkKeyIs(Ptr, Text, kPrelinkExecutableSourceKey)) {
+        Key = PrelinkKeyExecAddr;
+      } else if (PrelinkKeyIs(Ptr, Text, kPrelinkExecutableSizeKey)) {
+        Key = PrelinkKeyExecSize;
+      }
+    } else if (PrelinkTagIs(Tag, TagEnd, "<integer")) {
+      if (TagEnd[-1] == '/') {
+        // <integer IDREF="26"/>
+        Known = PrelinkTagId(Tag, TagEnd, " IDREF=\"", &Id) && PrelinkIdLookup(Id, &Value);
+      } else {
+        // same as GetPlistHexValue(): hex if there are attributes
+        Value = (TagEnd == Tag + 8) ? GetPlistPlainInteger(Ptr) : AsciiStrHexToUint64(Ptr);
+        Known = TRUE;
+        if (PrelinkTagId(Tag, TagEnd, " ID=\"", &Id)) {
+          PrelinkIdStore(Id, Value);
+        }
+      }
+      if (Known && ValueKey == PrelinkKeyExecAddr) {
+        Kext->ExecAddr = Value;
+        Kext->Unresolved &= ~PRELINK_UNRESOLVED_ADDR;
+      } else if (Known && ValueKey == PrelinkKeyExecSize) {
+        Kext->ExecSize = Value;
+        Kext->Unresolved &= ~PRELINK_UNRESOLVED_SIZE;
+      }
+    } else if (PrelinkTagIs(Tag, TagEnd, "<string")) {
+      if (ValueKey == PrelinkKeyBundleId && TagEnd[-1] != '/') {
+        for (Text = Ptr; Text < End && *Text != '\0' && *Text != '<'; Text++) {}
+        Kext->BundleId = Ptr;
+        Kext->BundleIdLen = (UINT32)(Text - Ptr);
+      }
+    }
+  }
+
+  if (Kext != NULL) {
+    // truncated prelink info, drop unfinished kext
+    mPrelinkedKextsCount--;
+  }
+  return TRUE;
+}
+
 //
 // Iterates over kexts in kernelcache
 // and calls PatchKext() for each.
@@ -1340,6 +1783,55 @@ void LOADER_ENTRY::PatchPrelinkedKexts()
   }
   DBG("\n");
 
+  if (IndexPrelinkedKexts(WholePlist, PrelinkInfoSize ? PrelinkInfoSize : MAX_UINT32)) {
+    DBG("indexed %llu prelinked kexts\n", mPrelinkedKextsCount);
+    // kexts are disjoint, so their compiled patches may go to the APs
+    DeferKextPatches = KextPatchIndexes != NULL && !ExitBootServicesCalled;
+    for (UINTN i = 0; i < mPrelinkedKextsCount; i++) {
+      PRELINKED_KEXT *Kext = &mPrelinkedKexts[i];
+      BOOLEAN        BundleIdKnown = Kext->BundleIdLen > 0 && Kext->BundleIdLen < sizeof(gKextBundleIdentifier);
+
+      InfoPlistStart = Kext->InfoPlist;
+      InfoPlistEnd = InfoPlistStart + Kext->InfoPlistSize;
+      
+      // terminate Info.plist with 0
+      SavedValue = *InfoPlistEnd;
+      *InfoPlistEnd = '\0';
+      
+      if (Kext->Unresolved & PRELINK_UNRESOLVED_ADDR) {
+        Kext->ExecAddr = GetPlistHexValue(InfoPlistStart, kPrelinkExecutableSourceKey, WholePlist);
+      }
+      if (Kext->Unresolved & PRELINK_UNRESOLVED_SIZE) {
+        Kext->ExecSize = GetPlistHexValue(InfoPlistStart, kPrelinkExecutableSizeKey, WholePlist);
+      }
+      // truncated to 32 bit and adjusted the same way as below
+      KextAddr = (UINT32)Kext->ExecAddr;
+      KextAddr += KernelSlide;
+      KextAddr += KernelRelocBase;
+      KextSize = (UINT32)Kext->ExecSize;
+      
+      if (BundleIdKnown) {
+        CopyMem(gKextBundleIdentifier, Kext->BundleId, Kext->BundleIdLen);
+        gKextBundleIdentifier[Kext->BundleIdLen] = '\0';
+      }
+      
+      PatchKext(
+                (UINT8*)(UINTN)KextAddr,
+                KextSize,
+                InfoPlistStart,
+                Kext->InfoPlistSize,
+                BundleIdKnown
+                );
+      
+      // return saved char
+      *InfoPlistEnd = SavedValue;
+    }
+    DeferKextPatches = FALSE;
+    RunKextPatchJobs();
+    return;
+  }
+  DBG("too many prelinked kexts for the index, rescanning\n");
+
   DictPtr = WholePlist;
   //new dict is the new kext
   while ((DictPtr = strstr(DictPtr, "dict>")) != NULL) {
@@ -1460,6 +1952,151 @@ void LOADER_ENTRY::PatchLoadedKexts()
   }
 }
 
+//
+// FNV-1a hash of the bundle id
+//
+static UINT32 KextBundleIdHash(const CHAR8 *BundleId)
+{
+  UINT32 Hash = 2166136261u;
+  while (*BundleId != '\0') {
+    Hash = (Hash ^ (UINT8)*BundleId++) * 16777619u;
+  }
+  return Hash;
+}
+
+//
+// Appends to the bucket, so entries stay in the order they were added.
+// BundleId is only kept for the built-in patches, they are static strings. A KextPatches entry keeps
+// its index and is compared with the current KextPatches[Patch].Name: the XString8 buffers may move.
+//
+void LOADER_ENTRY::AddKextPatchMapEntry(const CHAR8 *BundleId, KEXT_BUILTIN_PATCH Builtin, size_t Patch)
+{
+  KEXT_PATCH_MAP_ENTRY Entry;
+  INTN                 *Link;
+
+  Entry.Hash = KextBundleIdHash(BundleId);
+  Entry.BundleId = Builtin != KextBuiltinNone ? BundleId : NULL;
+  Entry.Builtin = Builtin;
+  Entry.Patch = Patch;
+  Entry.Next = -1;
+
+  Link = &KextPatchMapHead.ElementAt((size_t)(Entry.Hash % KEXT_PATCH_MAP_BUCKETS));
+  while (*Link >= 0) {
+    Link = &KextPatchMap.ElementAt((size_t)*Link).Next;
+  }
+  *Link = (INTN)KextPatchMap.size();
+  KextPatchMap.Add(Entry);
+}
+
+//
+// Maps bundle ids to the built-in patches enabled in KernelAndKextPatches
+// and to the KextPatches named by bundle id (Name contains a dot).
+// Other KextPatches are matched by substring of the bundle id.
+//
+void LOADER_ENTRY::BuildKextPatchMap()
+{
+  KextPatchMap.setEmpty();
+  KextPatchMapHead.setEmpty();
+  KextPatchMapHead.Add(-1, KEXT_PATCH_MAP_BUCKETS);
+  KextPatchesByName.setEmpty();
+
+  if (KernelAndKextPatches.KPATIConnectorsController.notEmpty()) {
+    if (!ATIConnectorsPatchInited) {
+      ATIConnectorsPatchInit();
+    }
+    AddKextPatchMapEntry(ATIKextBundleId[0], KextBuiltinATIConnectors, 0); // ATI boundle id
+    AddKextPatchMapEntry(ATIKextBundleId[1], KextBuiltinATIConnectors, 0); // AMD boundle id
+    AddKextPatchMapEntry("com.apple.kext.ATIFramebuffer", KextBuiltinATIConnectors, 0); // SnowLeo
+    AddKextPatchMapEntry("com.apple.kext.AMDFramebuffer", KextBuiltinATIConnectors, 0); //Maverics
+  }
+  if (KernelAndKextPatches.KPAppleIntelCPUPM) {
+    AddKextPatchMapEntry("com.apple.driver.AppleIntelCPUPowerManagement", KextBuiltinAppleIntelCPUPM, 0);
+  } else if (gSNBEAICPUFixRequire) {
+    AddKextPatchMapEntry("com.apple.driver.AppleIntelCPUPowerManagement", KextBuiltinSNBEAICPU, 0);
+  }
+  if (KernelAndKextPatches.KPAppleRTC) {
+    AddKextPatchMapEntry("com.apple.driver.AppleRTC", KextBuiltinAppleRTC, 0);
+  }
+  if (KernelAndKextPatches.KPDELLSMBIOS) {
+    AddKextPatchMapEntry("com.apple.driver.AppleSMBIOS", KextBuiltinDellSMBIOS, 0);
+    AddKextPatchMapEntry("com.apple.driver.AppleACPIPlatform", KextBuiltinDellACPIPlatform, 0);
+  }
+  if (gBDWEIOPCIFixRequire) {
+    AddKextPatchMapEntry("com.apple.iokit.IOPCIFamily", KextBuiltinBDWEIOPCI, 0);
+  }
+
+  for (size_t i = 0; i < KernelAndKextPatches.KextPatches.size(); i++) {
+    const KEXT_PATCH& kextpatch = KernelAndKextPatches.KextPatches[i];
+    if (kextpatch.Data.isEmpty()) {
+      continue;
+    }
+    if (kextpatch.Name.contains(".")) {
+      AddKextPatchMapEntry(kextpatch.Name.c_str(), KextBuiltinNone, i);
+    } else {
+      KextPatchesByName.Add(i);
+    }
+  }
+  DBG("kext patch map: %zu bundle ids, %zu patches by name\n", KextPatchMap.size(), KextPatchesByName.size());
+}
+
+//
+// Looks up gKextBundleIdentifier.
+// Fills KextPatchMatches with the matching KextPatches indexes in ascending order
+// and returns the built-in patch to apply.
+//
+KEXT_BUILTIN_PATCH LOADER_ENTRY::FindKextPatches()
+{
+  KEXT_BUILTIN_PATCH Builtin = KextBuiltinNone;
+  UINT32             Hash;
+  INTN               Index;
+  size_t             ByName = 0;
+
+  if (KextPatchMapHead.isEmpty()) {
+    BuildKextPatchMap();
+  }
+  KextPatchMatches.setEmpty();
+  if (gKextBundleIdentifier[0] == '\0') {
+    return KextBuiltinNone;
+  }
+
+  Hash = KextBundleIdHash(gKextBundleIdentifier);
+  for (Index = KextPatchMapHead.ElementAt((size_t)(Hash % KEXT_PATCH_MAP_BUCKETS)); Index >= 0; Index = KextPatchMap.ElementAt((size_t)Index).Next) {
+    const KEXT_PATCH_MAP_ENTRY& Entry = KextPatchMap.ElementAt((size_t)Index);
+    if (Entry.Hash != Hash) {
+      continue;
+    }
+    if (Entry.Builtin == KextBuiltinNone) {
+      if (Entry.Patch >= KernelAndKextPatches.KextPatches.size() ||
+          AsciiStrCmp(KernelAndKextPatches.KextPatches[Entry.Patch].Name.c_str(), gKextBundleIdentifier) != 0) {
+        continue;
+      }
+    } else if (AsciiStrCmp(Entry.BundleId, gKextBundleIdentifier) != 0) {
+      continue;
+    }
+    if (Entry.Builtin != KextBuiltinNone) {
+      if (Builtin == KextBuiltinNone) {
+        Builtin = Entry.Builtin;
+      }
+      continue;
+    }
+    // merge with patches by name to keep KextPatches order
+    for ( ; ByName < KextPatchesByName.size() && KextPatchesByName.ElementAt(ByName) < Entry.Patch; ByName++) {
+      size_t i = KextPatchesByName.ElementAt(ByName);
+      if (AsciiStrStr(gKextBundleIdentifier, KernelAndKextPatches.KextPatches[i].Name.c_str()) != NULL) {
+        KextPatchMatches.Add(i);
+      }
+    }
+    KextPatchMatches.Add(Entry.Patch);
+  }
+  for ( ; ByName < KextPatchesByName.size(); ByName++) {
+    size_t i = KextPatchesByName.ElementAt(ByName);
+    if (AsciiStrStr(gKextBundleIdentifier, KernelAndKextPatches.KextPatches[i].Name.c_str()) != NULL) {
+      KextPatchMatches.Add(i);
+    }
+  }
+  return Builtin;
+}
+
 //
 // Entry for all kext patches.
 // Will iterate through kext in prelinked kernel (kernelcache)
@@ -1467,6 +2104,7 @@ void LOADER_ENTRY::PatchLoadedKexts()
 //
 void LOADER_ENTRY::KextPatcherStart()
 {
+  BuildKextPatchMap();
 //  if (isKernelcache) {
     DBG_RT("Patching kernelcache ...\n");
       Stall(2000000);
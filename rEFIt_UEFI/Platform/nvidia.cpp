@@ -58,6 +58,7 @@
 #include "../Platform/Settings.h"
 #include "Self.h"
 #include "SelfOem.h"
+#include "GpuIdTable.h"
 
 #ifndef DEBUG_NVIDIA
 #ifndef DEBUG_ALL
@@ -116,7 +117,7 @@ UINT8  pwm_info[] = {
 };
 #define PWM_LEN ( sizeof(pwm_info) / sizeof(UINT8) )
 
-static nvidia_pci_info_t nvidia_card_vendors[] = {
+static constexpr nvidia_pci_info_t nvidia_card_vendors[] = {
   { 0x10190000,  "Elitegroup" },
   { 0x10250000,  "Acer" },
   { 0x10280000,  "Dell" },
@@ -170,7 +171,7 @@ static nvidia_pci_info_t nvidia_card_vendors[] = {
   { 0x73770000,  "Colorful" },
 };
 
-static nvidia_pci_info_t nvidia_card_generic[] = {
+static constexpr nvidia_pci_info_t nvidia_card_generic[] = {
   // 0000 - 0040
   { 0x10DE0000,  "Unknown" },
   // 0040 - 004F
@@ -1448,7 +1449,7 @@ static nvidia_pci_info_t nvidia_card_generic[] = {
   // 2000 - 1EFFF
 };
 
-static nvidia_card_info_t nvidia_card_exceptions[] = {
+static constexpr nvidia_card_info_t nvidia_card_exceptions[] = {
   /* ========================================================================================
    * Layout is device(VendorId + DeviceId), subdev (SubvendorId + SubdeviceId), display name.
    * ========================================================================================
@@ -1665,7 +1666,16 @@ static nvidia_card_info_t nvidia_card_exceptions[] = {
   { 0x10DE124D,  0x146210CC,  "MSi GeForce GT 635M" }
 };
 
-EFI_STATUS read_nVidia_PRAMIN(pci_dt_t *nvda_dev, void* rom, UINT16 arch)
+// The three tables are searched by binary search, keep them sorted
+constexpr UINT64 GpuIdKey(const nvidia_pci_info_t& Info) { return Info.device; }
+constexpr UINT64 GpuIdKey(const nvidia_card_info_t& Info) { return ((UINT64)Info.device << 32) | Info.subdev; }
+
+static_assert(GpuIdTableSorted(nvidia_card_vendors, 0, sizeof(nvidia_card_vendors) / sizeof(nvidia_card_vendors[0])), "nvidia_card_vendors must be sorted by subvendor");
+static_assert(GpuIdTableSorted(nvidia_card_generic, 0, sizeof(nvidia_card_generic) / sizeof(nvidia_card_generic[0])), "nvidia_card_generic must be sorted by device");
+static_assert(GpuIdTableSorted(nvidia_card_exceptions, 0, sizeof(nvidia_card_exceptions) / sizeof(nvidia_card_exceptions[0])), "nvidia_card_exceptions must be sorted by device and subdev");
+
+// Size is NVIDIA_ROM_SIZE, or less to read only the start of the image
+EFI_STATUS read_nVidia_PRAMIN(pci_dt_t *nvda_dev, void* rom, UINT16 arch, UINTN Size)
 {
   EFI_STATUS Status;
   EFI_PCI_IO_PROTOCOL    *PciIo;
@@ -1726,7 +1736,7 @@ EFI_STATUS read_nVidia_PRAMIN(pci_dt_t *nvda_dev, void* rom, UINT16 arch)
                            EfiPciIoWidthUint8,
                            0,
                            NV_PRAMIN_OFFSET,
-                           NVIDIA_ROM_SIZE,
+                           Size,
                            rom
                            );
 
@@ -1749,7 +1759,7 @@ EFI_STATUS read_nVidia_PRAMIN(pci_dt_t *nvda_dev, void* rom, UINT16 arch)
 }
 
 
-EFI_STATUS read_nVidia_PROM(pci_dt_t *nvda_dev, void* rom)
+EFI_STATUS read_nVidia_PROM(pci_dt_t *nvda_dev, void* rom, UINTN Size)
 {
   EFI_STATUS Status;
   EFI_PCI_IO_PROTOCOL    *PciIo;
@@ -1791,7 +1801,7 @@ EFI_STATUS read_nVidia_PROM(pci_dt_t *nvda_dev, void* rom)
                            EfiPciIoWidthUint8,
                            0,
                            NV_PROM_OFFSET,
-                           NVIDIA_ROM_SIZE,
+                           Size,
                            rom
                            );
 
@@ -2014,7 +2024,9 @@ static INT32 patch_nvidia_rom(UINT8 *rom)
 
 CONST CHAR8 *get_nvidia_model(UINT32 device_id, UINT32 subsys_id, CARDLIST * nvcard)
 {
-  UINTN i, j;
+  const nvidia_card_info_t *exception;
+  const nvidia_pci_info_t  *generic;
+  const nvidia_pci_info_t  *vendor;
   //DBG("get_nvidia_model for (%08X, %08X)\n", device_id, subsys_id);
 
   //ErmaC added selector for nVidia "old" style in System Profiler
@@ -2028,39 +2040,36 @@ CONST CHAR8 *get_nvidia_model(UINT32 device_id, UINT32 subsys_id, CARDLIST * nvc
 
     // Then check the exceptions table
     if (subsys_id) {
-      for (i = 0; i < (sizeof(nvidia_card_exceptions) / sizeof(nvidia_card_exceptions[0])); i++) {
-        if ((nvidia_card_exceptions[i].device == device_id) &&
-            (nvidia_card_exceptions[i].subdev == subsys_id)) {
-          return nvidia_card_exceptions[i].name_model;
-        }
+      exception = GpuIdTableFind(nvidia_card_exceptions, sizeof(nvidia_card_exceptions) / sizeof(nvidia_card_exceptions[0]),
+                                 ((UINT64)device_id << 32) | subsys_id);
+      if (exception != NULL) {
+        return exception->name_model;
       }
     }
   }
 
-  // At last try the generic names
-  for (i = 1; i < (sizeof(nvidia_card_generic) / sizeof(nvidia_card_generic[0])); i++) {
-    if (nvidia_card_generic[i].device == device_id) {
-      //--
-      //ErmaC added selector for nVidia "old" style in System Profiler
-      if (gSettings.NvidiaGeneric) {
-        DBG("Apply NvidiaGeneric\n");
-		  snprintf(generic_name, 128, "NVIDIA %s", nvidia_card_generic[i].name_model);
+  // At last try the generic names, [0] is "Unknown"
+  generic = GpuIdTableFind(nvidia_card_generic + 1, sizeof(nvidia_card_generic) / sizeof(nvidia_card_generic[0]) - 1, device_id);
+  if (generic != NULL) {
+    //--
+    //ErmaC added selector for nVidia "old" style in System Profiler
+    if (gSettings.NvidiaGeneric) {
+      DBG("Apply NvidiaGeneric\n");
+		snprintf(generic_name, 128, "NVIDIA %s", generic->name_model);
+      return &generic_name[0]; // generic_name;
+    }
+    //      DBG("Not applied NvidiaGeneric\n");
+    //--
+    if (subsys_id) {
+      vendor = GpuIdTableFind(nvidia_card_vendors, sizeof(nvidia_card_vendors) / sizeof(nvidia_card_vendors[0]), subsys_id & 0xffff0000);
+      if (vendor != NULL) {
+		  snprintf(generic_name, 128, "%s %s",
+                      vendor->name_model,
+                      generic->name_model);
         return &generic_name[0]; // generic_name;
       }
-      //      DBG("Not applied NvidiaGeneric\n");
-      //--
-      if (subsys_id) {
-        for (j = 0; j < (sizeof(nvidia_card_vendors) / sizeof(nvidia_card_vendors[0])); j++) {
-          if (nvidia_card_vendors[j].device == (subsys_id & 0xffff0000)) {
-			  snprintf(generic_name, 128, "%s %s",
-                        nvidia_card_vendors[j].name_model,
-                        nvidia_card_generic[i].name_model);
-            return &generic_name[0]; // generic_name;
-          }
-        }
-      }
-      return nvidia_card_generic[i].name_model;
     }
+    return generic->name_model;
   }
   return nvidia_card_generic[0].name_model;
 }
@@ -2176,9 +2185,213 @@ UINT64 mem_detect(UINT16 nvCardType, pci_dt_t *nvda_dev)
   return vram_size;
 }
 
+//
+// What setup_nvidia_devprop() takes from the VBIOS: the patch_nvidia_rom() result, the ids of the
+// PCIR header and the version string. With Boot/VBiosCache they are kept in misc\VBiosCache.bin,
+// so a known card reads only the first NV_ROM_PROBE_SIZE bytes of its VBIOS instead of NVIDIA_ROM_SIZE
+// bytes of MMIO. The key is the PCI ids, the card type, where the image was read and the CRC32 of
+// those first bytes, which hold the header, the PCIR header and the version string.
+//
+#define NV_BIOS_VERSION_LENGTH  32
+#define NV_ROM_PROBE_SIZE       0x200
+#define VBIOS_CACHE_FILE        L"misc\\VBiosCache.bin"
+#define VBIOS_CACHE_SIGNATURE   SIGNATURE_32('V', 'B', 'C', 'H')
+#define VBIOS_CACHE_VERSION     1
+#define VBIOS_CACHE_MAX         4     // NVidia cards in one machine, roughly
+
+#define NV_ROM_FROM_PRAMIN      1
+#define NV_ROM_FROM_PROM        2
+
+typedef struct {
+  INT32   Patch;                // patch_nvidia_rom() result
+  UINT32  RomDeviceId;          // vendor << 16 | device of the PCIR header, 0 if there is none
+  CHAR8   Version[NV_BIOS_VERSION_LENGTH + 1];
+} NV_ROM_FACTS;
+
+typedef struct {
+  UINT32  Signature;
+  UINT32  Version;
+  UINT32  Count;
+  UINT32  Reserved;
+} VBIOS_CACHE_HEADER;
+
+typedef struct {
+  UINT32        DeviceId;
+  UINT32        SubsysId;
+  UINT32        ProbeCrc32;
+  UINT16        CardType;
+  UINT8         Source;         // NV_ROM_FROM_PRAMIN or NV_ROM_FROM_PROM
+  UINT8         Reserved;
+  NV_ROM_FACTS  Facts;
+} VBIOS_CACHE_RECORD;
+
+static VBIOS_CACHE_RECORD VBiosCache[VBIOS_CACHE_MAX];
+static UINT32             VBiosCacheCount = 0;
+static BOOLEAN            VBiosCacheLoaded = FALSE;
+
+static void GetNvidiaRomFacts(UINT8 *rom, NV_ROM_FACTS *Facts)
+{
+  option_rom_pci_header_t *rom_pci_header;
+  INT32                   crlf_count = 0;
+  UINTN                   i;
+
+  ZeroMem(Facts, sizeof(*Facts));
+  if ((Facts->Patch = patch_nvidia_rom(rom)) == PATCH_ROM_FAILED) {
+    DBG("ERROR: nVidia ROM Patching Failed!\n");
+  }
+  rom_pci_header = (option_rom_pci_header_t*)(rom + *(UINT16 *)&rom[24]);
+
+  // check for 'PCIR' sig
+  if (rom_pci_header->signature == 0x52494350) {
+    Facts->RomDeviceId = (rom_pci_header->vendor_id << 16) | rom_pci_header->device_id;
+  } else {
+    DBG("nVidia incorrect PCI ROM signature: 0x%X\n", rom_pci_header->signature);
+  }
+
+  // get bios version
+
+  // only search the first 384 bytes
+  for (i = 0; i < 0x180; i++) {
+    if (rom[i] == 0x0D && rom[i+1] == 0x0A) {
+      crlf_count++;
+      // second 0x0D0A was found, extract bios version
+      if (crlf_count == 2) {
+        if (rom[i-1] == 0x20) i--; // strip last " "
+
+        for (UINTN version_start = i; version_start > (i-NV_BIOS_VERSION_LENGTH); version_start--) {
+          // find start
+          if (rom[version_start] == 0x00) {
+            version_start++;
+
+            // strip "Version "
+            if (strncmp((const CHAR8*)rom + version_start, "Version ", 8) == 0) {
+              version_start += 8;
+            }
+            CHAR8* s = (CHAR8*)(rom + version_start);
+            CHAR8* p = s;
+            while ((*p > ' ') && (*p < 'z') && ((INTN)(p-s) < NV_BIOS_VERSION_LENGTH)) {
+              p++;
+            }
+            CopyMem(Facts->Version, s, p-s);
+            DBG("version %s\n", Facts->Version);
+            break;
+          }
+        }
+        break;
+      }
+    }
+  }
+}
+
+static void VBiosCacheLoad(void)
+{
+  EFI_STATUS          Status;
+  UINT8               *Data = NULL;
+  UINTN               DataSize = 0;
+  VBIOS_CACHE_HEADER  *Header;
+
+  if (VBiosCacheLoaded) {
+    return;
+  }
+  VBiosCacheLoaded = TRUE;
+  VBiosCacheCount = 0;
+
+  Status = egLoadFile(&self.getCloverDir(), VBIOS_CACHE_FILE, &Data, &DataSize);
+  if (EFI_ERROR(Status)) {
+    MsgLog("VBIOS cache: %s\n", efiStrError(Status));
+    return;
+  }
+  Header = (VBIOS_CACHE_HEADER *)Data;
+  if (DataSize < sizeof(VBIOS_CACHE_HEADER) || Header->Signature != VBIOS_CACHE_SIGNATURE ||
+      Header->Version != VBIOS_CACHE_VERSION || Header->Count > VBIOS_CACHE_MAX ||
+      DataSize < sizeof(VBIOS_CACHE_HEADER) + Header->Count * sizeof(VBIOS_CACHE_RECORD)) {
+    MsgLog("VBIOS cache: bad file\n");
+    FreePool(Data);
+    return;
+  }
+  VBiosCacheCount = Header->Count;
+  CopyMem(VBiosCache, Header + 1, VBiosCacheCount * sizeof(VBIOS_CACHE_RECORD));
+  FreePool(Data);
+}
+
+static void VBiosCacheSave(void)
+{
+  EFI_STATUS          Status;
+  XBuffer<UINT8>      Data;
+  VBIOS_CACHE_HEADER  Header;
+
+  ZeroMem(&Header, sizeof(Header));
+  Header.Signature = VBIOS_CACHE_SIGNATURE;
+  Header.Version = VBIOS_CACHE_VERSION;
+  Header.Count = VBiosCacheCount;
+  Data.ncat(&Header, sizeof(Header));
+  Data.ncat(VBiosCache, VBiosCacheCount * sizeof(VBIOS_CACHE_RECORD));
+  Status = egSaveFile(&self.getCloverDir(), VBIOS_CACHE_FILE, Data.data(), Data.size());
+  MsgLog("VBIOS cache: saved %d cards: %s\n", VBiosCacheCount, efiStrError(Status));
+}
+
+// Reads the start of the VBIOS the way the whole image would be read, and fills Key with it.
+// FALSE if there is no image in PRAMIN nor in PROM.
+static BOOLEAN VBiosCacheKey(pci_dt_t *nvda_dev, UINT16 nvCardType, UINT32 device_id, UINT32 subsys_id, VBIOS_CACHE_RECORD *Key)
+{
+  UINT8 Probe[NV_ROM_PROBE_SIZE];
+
+  ZeroMem(Key, sizeof(*Key));
+  Key->DeviceId = device_id;
+  Key->SubsysId = subsys_id;
+  Key->CardType = nvCardType;
+  ZeroMem(Probe, sizeof(Probe));
+  read_nVidia_PRAMIN(nvda_dev, Probe, nvCardType, sizeof(Probe));
+  Key->Source = NV_ROM_FROM_PRAMIN;
+  if (Probe[0] != 0x55 || Probe[1] != 0xaa) {
+    ZeroMem(Probe, sizeof(Probe));
+    read_nVidia_PROM(nvda_dev, Probe, sizeof(Probe));
+    Key->Source = NV_ROM_FROM_PROM;
+    if (Probe[0] != 0x55 || Probe[1] != 0xaa) {
+      return FALSE;
+    }
+  }
+  gBS->CalculateCrc32(Probe, sizeof(Probe), &Key->ProbeCrc32);
+  return TRUE;
+}
+
+static VBIOS_CACHE_RECORD* VBiosCacheFind(const VBIOS_CACHE_RECORD *Key)
+{
+  UINT32 Index;
+
+  VBiosCacheLoad();
+  for (Index = 0; Index < VBiosCacheCount; Index++) {
+    if (VBiosCache[Index].DeviceId == Key->DeviceId && VBiosCache[Index].SubsysId == Key->SubsysId &&
+        VBiosCache[Index].ProbeCrc32 == Key->ProbeCrc32 && VBiosCache[Index].CardType == Key->CardType &&
+        VBiosCache[Index].Source == Key->Source) {
+      return &VBiosCache[Index];
+    }
+  }
+  return NULL;
+}
+
+// A record of the same card with another VBIOS is replaced, else the oldest one when full
+static void VBiosCacheAdd(const VBIOS_CACHE_RECORD *Record)
+{
+  UINT32 Index;
+
+  for (Index = 0; Index < VBiosCacheCount; Index++) {
+    if (VBiosCache[Index].DeviceId == Record->DeviceId && VBiosCache[Index].SubsysId == Record->SubsysId) {
+      break;
+    }
+  }
+  if (Index == VBIOS_CACHE_MAX) {
+    CopyMem(&VBiosCache[0], &VBiosCache[1], (VBIOS_CACHE_MAX - 1) * sizeof(VBIOS_CACHE_RECORD));
+    Index = VBIOS_CACHE_MAX - 1;
+  } else if (Index == VBiosCacheCount) {
+    VBiosCacheCount++;
+  }
+  CopyMem(&VBiosCache[Index], Record, sizeof(VBIOS_CACHE_RECORD));
+  VBiosCacheSave();
+}
+
 BOOLEAN setup_nvidia_devprop(pci_dt_t *nvda_dev)
 {
-  const         INT32 MAX_BIOS_VERSION_LENGTH = 32;
   EFI_STATUS    Status = EFI_NOT_FOUND;
   DevPropDevice *device = NULL;
   XString8      devicepath;
@@ -2196,12 +2409,15 @@ BOOLEAN setup_nvidia_devprop(pci_dt_t *nvda_dev)
   UINTN         bufferLen = 0;
   UINTN         j, n_ports = 0;
   UINTN         i;
-  INT32         crlf_count = 0;
-  option_rom_pci_header_t    *rom_pci_header;
+  DEV_PROPERTY  *Prop;
   XString8      version_str;
   BOOLEAN       RomAssigned = FALSE;
   UINT32        device_id, subsys_id;
   CARDLIST      *nvcard;
+  BOOLEAN       UseCache = FALSE;
+  VBIOS_CACHE_RECORD CacheKey;
+  VBIOS_CACHE_RECORD *Cached = NULL;
+  NV_ROM_FACTS  Facts;
 
   devicepath = get_pci_dev_path(nvda_dev);
   bar[0] = pci_config_read32(nvda_dev, PCI_BASE_ADDRESS_0);
@@ -2292,24 +2508,31 @@ BOOLEAN setup_nvidia_devprop(pci_dt_t *nvda_dev)
   }
 
   if (EFI_ERROR(Status)) {
-    rom = (__typeof__(rom))AllocateZeroPool(NVIDIA_ROM_SIZE+1);
-    // PRAMIN first
-    read_nVidia_PRAMIN(nvda_dev, rom, nvCardType);
+    if (GlobalConfig.VBiosCache && VBiosCacheKey(nvda_dev, nvCardType, device_id, subsys_id, &CacheKey)) {
+      UseCache = TRUE;
+      Cached = VBiosCacheFind(&CacheKey);
+    }
+    if (Cached != NULL) {
+      DBG("VBIOS unchanged, using cached facts\n");
+    } else {
+      rom = (__typeof__(rom))AllocateZeroPool(NVIDIA_ROM_SIZE+1);
+      // PRAMIN first
+      read_nVidia_PRAMIN(nvda_dev, rom, nvCardType, NVIDIA_ROM_SIZE);
 
-    //DBG("%hhX%hhX\n", rom[0], rom[1]);
-    rom_pci_header = NULL;
+      //DBG("%hhX%hhX\n", rom[0], rom[1]);
 
-    if (rom[0] != 0x55 || rom[1] != 0xaa) {
-      read_nVidia_PROM(nvda_dev, rom);
       if (rom[0] != 0x55 || rom[1] != 0xaa) {
-        DBG("ERROR: Unable to locate nVidia Video BIOS\n");
-        FreePool(rom);
-        rom = NULL;
+        read_nVidia_PROM(nvda_dev, rom, NVIDIA_ROM_SIZE);
+        if (rom[0] != 0x55 || rom[1] != 0xaa) {
+          DBG("ERROR: Unable to locate nVidia Video BIOS\n");
+          FreePool(rom);
+          rom = NULL;
+        }
       }
     }
   }
 
-  if (!rom){
+  if (!rom && Cached == NULL){
     if (buffer) {
       if (buffer[0] != 0x55 && buffer[1] != 0xaa) {
         //DBG("buffer->size: %d\n", bufferLen);
@@ -2337,57 +2560,24 @@ BOOLEAN setup_nvidia_devprop(pci_dt_t *nvda_dev)
     }
   }
 
-  if(rom) {
-
-    if ((nvPatch = patch_nvidia_rom(rom)) == PATCH_ROM_FAILED) {
-      DBG("ERROR: nVidia ROM Patching Failed!\n");
+  if (Cached != NULL) {
+    CopyMem(&Facts, &Cached->Facts, sizeof(Facts));
+  } else if (rom) {
+    GetNvidiaRomFacts(rom, &Facts);
+    if (UseCache && !RomAssigned) {
+      CopyMem(&CacheKey.Facts, &Facts, sizeof(Facts));
+      VBiosCacheAdd(&CacheKey);
     }
-    rom_pci_header = (option_rom_pci_header_t*)(rom + *(UINT16 *)&rom[24]);
-
-    // check for 'PCIR' sig
-    if (rom_pci_header->signature == 0x52494350) {
-      if (rom_pci_header->device_id != nvda_dev->device_id) {
-        // Get Model from the OpROM
-        model = get_nvidia_model(((rom_pci_header->vendor_id << 16) | rom_pci_header->device_id), subsys_id, nvcard);
-        //        DBG(model);
-      }
-    } else {
-      DBG("nVidia incorrect PCI ROM signature: 0x%X\n", rom_pci_header->signature);
-    }
-
-    // get bios version
-
-    // only search the first 384 bytes
-    for (i = 0; i < 0x180; i++) {
-      if (rom[i] == 0x0D && rom[i+1] == 0x0A) {
-        crlf_count++;
-        // second 0x0D0A was found, extract bios version
-        if (crlf_count == 2) {
-          if (rom[i-1] == 0x20) i--; // strip last " "
-
-          for (UINTN version_start = i; version_start > (i-MAX_BIOS_VERSION_LENGTH); version_start--) {
-            // find start
-            if (rom[version_start] == 0x00) {
-              version_start++;
+  }
 
-              // strip "Version "
-              if (strncmp((const CHAR8*)rom + version_start, "Version ", 8) == 0) {
-                version_start += 8;
-              }
-              CHAR8* s = (CHAR8*)(rom + version_start);
-              CHAR8* p = s;
-              while ((*p > ' ') && (*p < 'z') && ((INTN)(p-s) < MAX_BIOS_VERSION_LENGTH)) {
-                p++;
-              }
-              version_str.strncpy(s, p-s);
-              DBG("version %s\n", version_str.c_str());
-              break;
-            }
-          }
-          break;
-        }
-      }
+  if (Cached != NULL || rom) {
+    nvPatch = Facts.Patch;
+    if (Facts.RomDeviceId != 0 && (Facts.RomDeviceId & 0xFFFF) != nvda_dev->device_id) {
+      // Get Model from the OpROM
+      model = get_nvidia_model(Facts.RomDeviceId, subsys_id, nvcard);
+      //        DBG(model);
     }
+    version_str.takeValueFrom(Facts.Version);
   } else {
     version_str.takeValueFrom("1.0");
   }
@@ -2427,28 +2617,23 @@ BOOLEAN setup_nvidia_devprop(pci_dt_t *nvda_dev)
     goto done;
   }
 
-  if (gSettings.NrAddProperties != 0xFFFE) {
-    for (i = 0; i < gSettings.NrAddProperties; i++) {
-      if (gSettings.AddProperties[i].Device != DEV_NVIDIA) {
-        continue;
-      }
-      Injected = TRUE;
+  for (Prop = GetAddProperties(DEV_NVIDIA); Prop; Prop = Prop->Next) {
+    Injected = TRUE;
 
-      if (!gSettings.AddProperties[i].MenuItem.BValue) {
-        //DBG("  disabled property Key: %s, len: %d\n", gSettings.AddProperties[i].Key, gSettings.AddProperties[i].ValueLen);
-      } else {
-        devprop_add_value(device,
-                          gSettings.AddProperties[i].Key,
-                          (UINT8*)gSettings.AddProperties[i].Value,
-                          gSettings.AddProperties[i].ValueLen);
-        //DBG("  added property Key: %s, len: %d\n", gSettings.AddProperties[i].Key, gSettings.AddProperties[i].ValueLen);
-      }
-    }
-    if (Injected) {
-      DBG("custom NVIDIA properties injected, continue\n");
-      //return TRUE;
+    if (!Prop->MenuItem.BValue) {
+      //DBG("  disabled property Key: %s, len: %d\n", Prop->Key, Prop->ValueLen);
+    } else {
+      devprop_add_value(device,
+                        Prop->Key,
+                        (UINT8*)Prop->Value,
+                        Prop->ValueLen);
+      //DBG("  added property Key: %s, len: %d\n", Prop->Key, Prop->ValueLen);
     }
   }
+  if (Injected) {
+    DBG("custom NVIDIA properties injected, continue\n");
+    //return TRUE;
+  }
 
   if (gSettings.FakeNVidia) {
     UINT32 FakeID = gSettings.FakeNVidia >> 16;
@@ -2542,7 +2727,7 @@ done:
   if (buffer) {
     FreePool(buffer);
   }
-  if (!RomAssigned) {
+  if (!RomAssigned && rom) {
     FreePool(rom);
   }
   return TRUE;
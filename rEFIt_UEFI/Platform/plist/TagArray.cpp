@@ -100,6 +100,7 @@ TagArray* TagArray::getEmptyTag()
 
 void TagArray::FreeTag()
 {
+  if ( FreeArenaTag() ) return;
   //while ( tagIdx < _dictOrArrayContent.notEmpty() ) {
   //  _dictOrArrayContent[0].FreeTag();
   //  _dictOrArrayContent.RemoveWithoutFreeingAtIndex(0);
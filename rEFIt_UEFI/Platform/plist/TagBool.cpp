@@ -67,6 +67,7 @@ TagBool* TagBool::getEmptyTag()
 
 void TagBool::FreeTag()
 {
+  if ( FreeArenaTag() ) return;
   value = false;
   tagsFree.AddReference(this, true);
 }
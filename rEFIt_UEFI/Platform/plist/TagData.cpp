@@ -69,6 +69,7 @@ TagData* TagData::getEmptyTag()
 
 void TagData::FreeTag()
 {
+  if ( FreeArenaTag() ) return;
   dataBuffer.setEmpty();
   tagsFree.AddReference(this, true);
 }
@@ -68,6 +68,7 @@ TagDate* TagDate::getEmptyTag()
 
 void TagDate::FreeTag()
 {
+  if ( FreeArenaTag() ) return;
   string.setEmpty();
   tagsFree.AddReference(this, true);
 }
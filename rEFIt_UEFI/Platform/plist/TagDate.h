@@ -27,8 +27,8 @@ public:
   virtual TagDate* getDate() { return this; }
   virtual const TagDate* getDate() const { return this; }
 
-  virtual bool isDict() const { return true; }
-  virtual const XString8 getTypeAsXString8() const { return "Dict"_XS8; }
+  virtual bool isDate() const { return true; }
+  virtual const XString8 getTypeAsXString8() const { return "Date"_XS8; }
   static TagDate* getEmptyTag();
   virtual void FreeTag();
   
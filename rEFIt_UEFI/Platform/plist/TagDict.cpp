@@ -46,6 +46,13 @@
 
 XObjArray<TagDict> TagDict::tagsFree;
 
+UINTN TagDict::lookupCount = 0;
+UINTN TagDict::indexHits = 0;
+UINTN TagDict::indexProbes = 0;
+
+// Dict with less keys are searched linearly
+#define TAG_DICT_INDEX_MIN_KEYS 16
+
 //UINTN newtagcount = 0;
 //UINTN tagcachehit = 0;
 TagDict* TagDict::getEmptyTag()
@@ -67,11 +74,14 @@ TagDict* TagDict::getEmptyTag()
 
 void TagDict::FreeTag()
 {
+  if ( FreeArenaTag() ) return;
   for (size_t tagIdx = _dictContent.size() ; tagIdx > 0  ; ) {
     tagIdx--;
     _dictContent[tagIdx].FreeTag();
     _dictContent.RemoveWithoutFreeingAtIndex(tagIdx);
   }
+  _keyIndex.setEmpty();
+  _keyIndexedSize = 0;
   tagsFree.AddReference(this, true);
 }
 
@@ -147,9 +157,67 @@ EFI_STATUS TagDict::getKeyAndValueAtIndex(INTN id, const TagKey** key, const Tag
   return EFI_UNSUPPORTED;
 }
 
+// FNV-1a of the key with ascii letters lowered, same folding as equalIC()
+static UINT32 KeyHashIC(const CHAR8* key)
+{
+  UINT32 hash = 2166136261U;
+  for ( ; *key ; key++ ) {
+    CHAR8 c = *key;
+    if ( c >= 'A' && c <= 'Z' ) c = (CHAR8)(c - 'A' + 'a');
+    hash = (hash ^ (UINT8)c) * 16777619U;
+  }
+  return hash;
+}
+
+void TagDict::buildKeyIndex() const
+{
+  const XObjArray<TagStruct>& tagList = _dictContent;
+  size_t keyCount = 0;
+  for (size_t tagIdx = 0 ; tagIdx < tagList.size() ; tagIdx++ ) {
+    if ( tagList[tagIdx].isKey() ) keyCount++;
+  }
+  size_t slotCount = 32;
+  while ( slotCount < keyCount * 2 ) slotCount <<= 1;
+
+  _keyIndex.setEmpty();
+  _keyIndex.Add(0, slotCount);
+  UINT64* table = _keyIndex.data();
+  size_t mask = slotCount - 1;
+  for (size_t tagIdx = 0 ; tagIdx < tagList.size() ; tagIdx++ ) {
+    if ( !tagList[tagIdx].isKey() ) continue;
+    const XString8& keyString = tagList[tagIdx].getKey()->keyStringValue();
+    UINT32 hash = KeyHashIC(keyString.c_str());
+    size_t slot;
+    for (slot = hash & mask ; table[slot] != 0 ; slot = (slot + 1) & mask) {
+      // Only the first of duplicate keys is found by a linear search, keep that one
+      if ( (UINT32)(table[slot] >> 32) == hash  &&  tagList[(size_t)(UINT32)table[slot] - 1].getKey()->keyStringValue().equalIC(keyString) ) break;
+    }
+    if ( table[slot] == 0 ) table[slot] = ((UINT64)hash << 32) | (tagIdx + 1);
+  }
+  _keyIndexedSize = tagList.size();
+}
+
 const TagStruct* TagDict::propertyForKey(const CHAR8* key) const
 {
   const XObjArray<TagStruct>& tagList = _dictContent;
+  lookupCount++;
+  if ( tagList.size() >= TAG_DICT_INDEX_MIN_KEYS * 2 ) {
+    if ( _keyIndexedSize != tagList.size() ) buildKeyIndex();
+    UINT32 hash = KeyHashIC(key);
+    const UINT64* table = _keyIndex.data();
+    size_t mask = _keyIndex.size() - 1;
+    for (size_t slot = hash & mask ; table[slot] != 0 ; slot = (slot + 1) & mask) {
+      indexProbes++;
+      if ( (UINT32)(table[slot] >> 32) != hash ) continue;
+      size_t tagIdx = (size_t)(UINT32)table[slot] - 1;
+      if ( !tagList[tagIdx].getKey()->keyStringValue().equalIC(key) ) continue;
+      indexHits++;
+      if ( tagIdx+1 >= tagList.size() ) return NULL;
+      if ( tagList[tagIdx+1].isKey() ) return NULL;
+      return &tagList[tagIdx+1];
+    }
+    return NULL;
+  }
   for (size_t tagIdx = 0 ; tagIdx < tagList.size() ; tagIdx++ )
   {
     if ( tagList[tagIdx].isKey()  &&  tagList[tagIdx].getKey()->keyStringValue().equalIC(key) ) {
@@ -183,6 +251,11 @@ const TagArray* TagDict::arrayPropertyForKey(const CHAR8* key) const
 }
 
 
+void TagDict::printLookupStats()
+{
+  DBG("TagDict lookups=%llu, indexed hits=%llu, probes=%llu\n", (UINT64)lookupCount, (UINT64)indexHits, (UINT64)indexProbes);
+}
+
 void TagDict::sprintf(unsigned int ident, XString8* s) const
 {
   for (size_t i = 0 ; i < (size_t)ident ; i++) *s += " ";
@@ -10,15 +10,25 @@
 
 #include <Platform.h>
 #include "plist.h"
+#include "../../cpp_foundation/XArray.h"
 
 class TagDict : public TagStruct
 {
   static XObjArray<TagDict> tagsFree;
   XObjArray<TagStruct> _dictContent;
+  // Open addressing table of the keys, built by propertyForKey() for big dicts. Slot is (hash << 32) | (tagIdx + 1), 0 if empty.
+  mutable XArray<UINT64> _keyIndex;
+  mutable size_t _keyIndexedSize; // _dictContent.size() when _keyIndex was built
+
+  void buildKeyIndex() const;
 
 public:
+  // Lookup counters, printed by printLookupStats()
+  static UINTN lookupCount;
+  static UINTN indexHits;
+  static UINTN indexProbes;
 
-  TagDict() : _dictContent() {}
+  TagDict() : _dictContent(), _keyIndex(), _keyIndexedSize(0) {}
   TagDict(const TagDict& other) = delete; // Can be defined if needed
   const TagDict& operator = (const TagDict&); // Can be defined if needed
   virtual ~TagDict() { }
@@ -55,6 +65,8 @@ public:
   const TagDict* dictPropertyForKey(const CHAR8* key) const;
   const TagArray* arrayPropertyForKey(const CHAR8* key) const;
 
+  static void printLookupStats();
+
 };
 
 
@@ -65,6 +77,18 @@ ParseXML(
         size_t bufSize
   );
 
+/*
+ * Same as ParseXML(), but tags are allocated from a single arena, which also holds the copy of buffer.
+ * Keys and strings are not copied, they point to the arena : an XString8 copy constructed from them shares that memory (assignment copies).
+ * The dict returned can't be modified. dict->FreeTag() frees everything in one FreePool().
+ */
+EFI_STATUS
+ParseXMLView(
+  CONST CHAR8  *buffer,
+        TagDict** dict,
+        size_t bufSize
+  );
+
 
 
 #endif /* __TagDict_h__ */
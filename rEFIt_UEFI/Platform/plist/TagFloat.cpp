@@ -69,6 +69,7 @@ TagFloat* TagFloat::getEmptyTag()
 
 void TagFloat::FreeTag()
 {
+  if ( FreeArenaTag() ) return;
   value = 0;
   tagsFree.AddReference(this, true);
 }
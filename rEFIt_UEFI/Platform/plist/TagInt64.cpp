@@ -69,6 +69,7 @@ TagInt64* TagInt64::getEmptyTag()
 
 void TagInt64::FreeTag()
 {
+  if ( FreeArenaTag() ) return;
   value = 0;
   tagsFree.AddReference(this, true);
 }
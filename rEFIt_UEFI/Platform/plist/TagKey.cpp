@@ -69,6 +69,7 @@ TagKey* TagKey::getEmptyTag()
 
 void TagKey::FreeTag()
 {
+  if ( FreeArenaTag() ) return;
   _string.setEmpty();
   tagsFree.AddReference(this, true);
 }
@@ -18,6 +18,8 @@ class TagKey : public TagStruct
 public:
 
   TagKey() : _string() {}
+  // Key is not copied, it must live as long as this tag. Used by ParseXMLView().
+  TagKey(const LString8& key) : _string(key) { if ( _string.isEmpty() ) panic("TagKey::TagKey() : key.isEmpty() "); }
   TagKey(const TagKey& other) = delete; // Can be defined if needed
   const TagKey& operator = (const TagKey&); // Can be defined if needed
   virtual ~TagKey() { }
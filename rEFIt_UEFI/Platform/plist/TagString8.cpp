@@ -68,6 +68,7 @@ TagString* TagString::getEmptyTag()
 
 void TagString::FreeTag()
 {
+  if ( FreeArenaTag() ) return;
   _string.setEmpty();
   tagsFree.AddReference(this, true);
 }
@@ -18,6 +18,8 @@ class TagString : public TagStruct
 public:
 
   TagString() : _string() {}
+  // String is not copied, it must live as long as this tag. Used by ParseXMLView().
+  TagString(const LString8& s) : _string(s) {}
   TagString(const TagString& other) = delete; // Can be defined if needed
   const TagString& operator = (const TagString&); // Can be defined if needed
   virtual ~TagString() { }
@@ -33,6 +33,7 @@
 #include "plist.h"
 #include "../../libeg/FloatLib.h"
 #include "xml.h"
+#include "../PerfCounters.h"
 
 #ifndef DEBUG_ALL
 #define DEBUG_PLIST 0
@@ -48,6 +49,24 @@
 
 CHAR8* buffer_start = NULL;
 
+class PlistArena
+{
+public:
+  TagStruct* root;
+  size_t     nodeCount;
+  size_t     nodeMax;
+  UINT8*     nodes;
+  CHAR8*     text; // copy of the xml. Keys and strings point into it.
+};
+
+static PlistArena* currentArena = NULL; // Set by ParseXMLView() while parsing
+
+static constexpr size_t maxSize(size_t a, size_t b) { return a > b ? a : b; }
+// All tags use the same slot size, so the arena can be walked to call destructors.
+static const size_t arenaSlotSize = (maxSize(maxSize(maxSize(sizeof(TagDict), sizeof(TagArray)), maxSize(sizeof(TagKey), sizeof(TagString))),
+                                             maxSize(maxSize(sizeof(TagInt64), sizeof(TagFloat)), maxSize(maxSize(sizeof(TagBool), sizeof(TagData)), sizeof(TagDate))))
+                                     + 7) & ~(size_t)7;
+
 // Forward declarations
 EFI_STATUS ParseTagDict( CHAR8* buffer, TagStruct* * tag, UINT32 empty, UINT32* lenPtr);
 EFI_STATUS ParseTagArray( CHAR8* buffer, TagStruct* * tag, UINT32 empty, UINT32* lenPtr);
@@ -75,6 +94,52 @@ EFI_STATUS FixDataMatchingTag( CHAR8* buffer, CONST CHAR8* tag,UINT32* lenPtr);
 #include "TagFloat.h"
 #include "TagInt64.h"
 #include "TagString8.h"
+
+#if defined(_MSC_VER)
+void* operator new  (size_t count, PlistArena* arena) noexcept
+#else
+void* operator new  (unsigned long count, PlistArena* arena) noexcept
+#endif
+{
+  if ( count > arenaSlotSize  ||  arena->nodeCount >= arena->nodeMax ) return NULL;
+  return arena->nodes + arenaSlotSize * arena->nodeCount++;
+}
+
+void operator delete  (void* ptr, PlistArena* arena) noexcept
+{
+  // Slots are never given back. The arena is freed as a whole.
+}
+
+static void FreePlistArena(PlistArena* arena)
+{
+  for (size_t i = 0 ; i < arena->nodeCount ; i++) {
+    ((TagStruct*)(arena->nodes + arenaSlotSize * i))->~TagStruct();
+  }
+  FreePool(arena);
+}
+
+bool TagStruct::FreeArenaTag()
+{
+  if ( _arena == NULL ) return false;
+  if ( _arena->root == this ) FreePlistArena(_arena);
+  return true;
+}
+
+template <class TagClass>
+static TagClass* arenaTag(TagClass* tag)
+{
+  if ( tag != NULL ) tag->setArena(currentArena);
+  return tag;
+}
+
+template <class TagClass>
+static TagClass* newTag()
+{
+  gPerfCounters.PlistNodes++;
+  if ( currentArena == NULL ) return TagClass::getEmptyTag();
+  return arenaTag(new (currentArena) TagClass());
+}
+
 //
 ////UINTN newtagcount = 0;
 ////UINTN tagcachehit = 0;
@@ -214,6 +279,274 @@ bool TagStruct::isFalseOrNn() const
 }
 
 
+/****************************************  Binary plist  ****************************************/
+
+// Cyclic references would otherwise recurse forever
+#define BPLIST_MAX_DEPTH 64
+
+typedef struct {
+  const UINT8* buffer;
+  const UINT8* offsetTable; // objects are between the header and the offset table
+  UINT8        offsetIntSize;
+  UINT8        objectRefSize;
+  UINT64       numObjects;
+} BPLIST_INFO;
+
+static UINT64 BplistReadUInt(const UINT8* p, size_t size)
+{
+  UINT64 value = 0;
+  for (size_t i = 0 ; i < size ; i++) {
+    value = (value << 8) | p[i];
+  }
+  return value;
+}
+
+static const UINT8* BplistObject(const BPLIST_INFO* info, UINT64 objectRef)
+{
+  if ( objectRef >= info->numObjects ) return NULL;
+  UINT64 offset = BplistReadUInt(info->offsetTable + objectRef * info->offsetIntSize, info->offsetIntSize);
+  if ( offset < 8  ||  offset >= (UINT64)(info->offsetTable - info->buffer) ) return NULL;
+  return info->buffer + offset;
+}
+
+// Count in the low nibble of the marker, or in the integer object that follows when it is 0xF. *p is moved to the content.
+static EFI_STATUS BplistCount(const BPLIST_INFO* info, const UINT8** p, UINT64* count)
+{
+  const UINT8* end = info->offsetTable;
+
+  *count = **p & 0x0F;
+  (*p)++;
+  if ( *count == 0x0F ) {
+    if ( *p >= end  ||  (**p & 0xF0) != 0x10 ) return EFI_UNSUPPORTED;
+    size_t size = (size_t)1 << (**p & 0x0F);
+    if ( size > 8  ||  size >= (size_t)(end - *p) ) return EFI_UNSUPPORTED;
+    *count = BplistReadUInt(*p + 1, size);
+    *p += 1 + size;
+  }
+  return EFI_SUCCESS;
+}
+
+// seconds since 2001-01-01 to the format of <date>
+static XString8 BplistDateString(double seconds)
+{
+  INT64 t = (INT64)seconds + 978307200; // 2001-01-01 in unix time
+  INT64 days = t / 86400;
+  INT64 secs = t % 86400;
+  if ( secs < 0 ) {
+    secs += 86400;
+    days--;
+  }
+  // civil from days
+  days += 719468;
+  INT64  era = (days >= 0 ? days : days - 146096) / 146097;
+  UINT32 doe = (UINT32)(days - era * 146097);
+  UINT32 yoe = (doe - doe/1460 + doe/36524 - doe/146096) / 365;
+  INT64  year = (INT64)yoe + era * 400;
+  UINT32 doy = doe - (365*yoe + yoe/4 - yoe/100);
+  UINT32 mp = (5*doy + 2) / 153;
+  UINT32 day = doy - (153*mp + 2)/5 + 1;
+  UINT32 month = mp < 10 ? mp + 3 : mp - 9;
+  if ( month <= 2 ) year++;
+  return S8Printf("%04lld-%02d-%02dT%02d:%02d:%02dZ", year, month, day, (int)(secs / 3600), (int)(secs / 60 % 60), (int)(secs % 60));
+}
+
+static EFI_STATUS BplistParseObject(const BPLIST_INFO* info, UINT64 objectRef, UINTN depth, TagStruct** tag)
+{
+  EFI_STATUS   Status;
+  const UINT8* p = BplistObject(info, objectRef);
+  const UINT8* end = info->offsetTable;
+  UINT64       count;
+  size_t       size;
+
+  *tag = NULL;
+  if ( p == NULL  ||  depth > BPLIST_MAX_DEPTH ) return EFI_UNSUPPORTED;
+
+  UINT8 marker = *p;
+  switch ( marker >> 4 )
+  {
+    case 0x0:
+    {
+      if ( marker != 0x08  &&  marker != 0x09 ) return EFI_UNSUPPORTED; // null and fill aren't in xml plist
+      TagBool* boolTag = newTag<TagBool>();
+      boolTag->setBoolValue(marker == 0x09);
+      *tag = boolTag;
+      return EFI_SUCCESS;
+    }
+    case 0x1: // integer, 1 << n bytes
+    case 0x8: // uid, n + 1 bytes
+    {
+      size = (marker >> 4) == 0x1 ? (size_t)1 << (marker & 0x0F) : (size_t)(marker & 0x0F) + 1;
+      if ( size > 16  ||  size >= (size_t)(end - p) ) return EFI_UNSUPPORTED;
+      TagInt64* intTag = newTag<TagInt64>();
+      // 8 bytes are signed, 16 bytes are only used for big unsigned numbers : keep the low 64 bits
+      intTag->setIntValue((INTN)(size == 16 ? BplistReadUInt(p + 9, 8) : BplistReadUInt(p + 1, size)));
+      *tag = intTag;
+      return EFI_SUCCESS;
+    }
+    case 0x2: // real
+    case 0x3: // date
+    {
+      size = (size_t)1 << (marker & 0x0F);
+      if ( (marker >> 4) == 0x3  &&  marker != 0x33 ) return EFI_UNSUPPORTED;
+      if ( (size != 4  &&  size != 8)  ||  size >= (size_t)(end - p) ) return EFI_UNSUPPORTED;
+      double value;
+      if ( size == 4 ) {
+        UINT32 bits = (UINT32)BplistReadUInt(p + 1, 4);
+        float f;
+        CopyMem(&f, &bits, sizeof(f));
+        value = f;
+      } else {
+        UINT64 bits = BplistReadUInt(p + 1, 8);
+        CopyMem(&value, &bits, sizeof(value));
+      }
+      if ( marker == 0x33 ) {
+        TagDate* dateTag = newTag<TagDate>();
+        dateTag->setDateValue(BplistDateString(value));
+        *tag = dateTag;
+      } else {
+        TagFloat* floatTag = newTag<TagFloat>();
+        floatTag->setFloatValue((float)value);
+        *tag = floatTag;
+      }
+      return EFI_SUCCESS;
+    }
+    case 0x4: // data
+    {
+      Status = BplistCount(info, &p, &count);
+      if ( EFI_ERROR(Status) ) return Status;
+      if ( count > (UINT64)(end - p) ) return EFI_UNSUPPORTED;
+      UINT8* data = NULL;
+      if ( count > 0 ) {
+        data = (UINT8*)AllocatePool((UINTN)count);
+        if ( data == NULL ) return EFI_OUT_OF_RESOURCES;
+        CopyMem(data, p, (UINTN)count);
+      }
+      TagData* dataTag = newTag<TagData>();
+      dataTag->setDataValue(data, (UINTN)count);
+      *tag = dataTag;
+      return EFI_SUCCESS;
+    }
+    case 0x5: // ascii string
+    case 0x6: // utf16 big endian string
+    {
+      Status = BplistCount(info, &p, &count);
+      if ( EFI_ERROR(Status) ) return Status;
+      XString8 s;
+      if ( (marker >> 4) == 0x5 ) {
+        if ( count > (UINT64)(end - p) ) return EFI_UNSUPPORTED;
+        s.takeValueFrom((const char*)p, (size_t)count);
+      } else {
+        if ( count > (UINT64)(end - p) / 2 ) return EFI_UNSUPPORTED;
+        char16_t* utf16 = (char16_t*)AllocatePool(((size_t)count + 1) * sizeof(char16_t));
+        if ( utf16 == NULL ) return EFI_OUT_OF_RESOURCES;
+        for (size_t i = 0 ; i < (size_t)count ; i++) {
+          utf16[i] = (char16_t)((p[i*2] << 8) | p[i*2+1]);
+        }
+        utf16[count] = 0;
+        s.takeValueFrom(utf16);
+        FreePool(utf16);
+      }
+      TagString* stringTag = newTag<TagString>();
+      stringTag->setStringValue(s);
+      *tag = stringTag;
+      return EFI_SUCCESS;
+    }
+    case 0xA: // array
+    case 0xC: // set, read as an array
+    {
+      Status = BplistCount(info, &p, &count);
+      if ( EFI_ERROR(Status) ) return Status;
+      if ( count > (UINT64)(end - p) / info->objectRefSize ) return EFI_UNSUPPORTED;
+      TagArray* arrayTag = newTag<TagArray>();
+      for (size_t i = 0 ; i < (size_t)count ; i++) {
+        TagStruct* valueTag;
+        Status = BplistParseObject(info, BplistReadUInt(p + i * info->objectRefSize, info->objectRefSize), depth + 1, &valueTag);
+        if ( EFI_ERROR(Status) ) {
+          arrayTag->FreeTag();
+          return Status;
+        }
+        arrayTag->arrayContent().AddReference(valueTag, true);
+      }
+      *tag = arrayTag;
+      return EFI_SUCCESS;
+    }
+    case 0xD: // dict, keys refs followed by values refs
+    {
+      Status = BplistCount(info, &p, &count);
+      if ( EFI_ERROR(Status) ) return Status;
+      if ( count > (UINT64)(end - p) / info->objectRefSize / 2 ) return EFI_UNSUPPORTED;
+      TagDict* dictTag = newTag<TagDict>();
+      const UINT8* valueRefs = p + (size_t)count * info->objectRefSize;
+      for (size_t i = 0 ; i < (size_t)count ; i++) {
+        TagStruct* keyTag;
+        TagStruct* valueTag;
+        Status = BplistParseObject(info, BplistReadUInt(p + i * info->objectRefSize, info->objectRefSize), depth + 1, &keyTag);
+        if ( !EFI_ERROR(Status)  &&  ( !keyTag->isString()  ||  keyTag->getString()->stringValue().isEmpty() ) ) {
+          keyTag->FreeTag();
+          Status = EFI_UNSUPPORTED;
+        }
+        if ( EFI_ERROR(Status) ) {
+          dictTag->FreeTag();
+          return Status;
+        }
+        TagKey* key = newTag<TagKey>();
+        key->setKeyValue(keyTag->getString()->stringValue());
+        keyTag->FreeTag();
+        dictTag->dictContent().AddReference(key, true);
+
+        Status = BplistParseObject(info, BplistReadUInt(valueRefs + i * info->objectRefSize, info->objectRefSize), depth + 1, &valueTag);
+        if ( EFI_ERROR(Status) ) {
+          dictTag->FreeTag();
+          return Status;
+        }
+        dictTag->dictContent().AddReference(valueTag, true);
+      }
+      *tag = dictTag;
+      return EFI_SUCCESS;
+    }
+    default:
+      return EFI_UNSUPPORTED;
+  }
+}
+
+/*
+ * bplist00 : "bplist00", objects, offset table, 32 bytes trailer.
+ * Builds the same tags as the xml parser. The top object must be a dict.
+ */
+static EFI_STATUS ParseBinaryPlist(const UINT8* buffer, size_t bufferSize, TagDict** dict)
+{
+  EFI_STATUS  Status;
+  BPLIST_INFO info;
+  TagStruct*  tag;
+
+  if ( bufferSize < 8 + 1 + 32 ) return EFI_UNSUPPORTED;
+
+  const UINT8* trailer = buffer + bufferSize - 32;
+  info.buffer = buffer;
+  info.offsetIntSize = trailer[6];
+  info.objectRefSize = trailer[7];
+  info.numObjects = BplistReadUInt(trailer + 8, 8);
+  UINT64 topObject = BplistReadUInt(trailer + 16, 8);
+  UINT64 offsetTableOffset = BplistReadUInt(trailer + 24, 8);
+
+  if ( info.offsetIntSize == 0  ||  info.offsetIntSize > 8  ||  info.objectRefSize == 0  ||  info.objectRefSize > 8 ) return EFI_UNSUPPORTED;
+  if ( offsetTableOffset < 9  ||  offsetTableOffset > bufferSize - 32 ) return EFI_UNSUPPORTED;
+  if ( info.numObjects > (bufferSize - 32 - offsetTableOffset) / info.offsetIntSize ) return EFI_UNSUPPORTED;
+  info.offsetTable = buffer + offsetTableOffset;
+
+  Status = BplistParseObject(&info, topObject, 0, &tag);
+  if ( EFI_ERROR(Status) ) {
+    DBG("bplist parse error %s\n", efiStrError(Status));
+    return Status;
+  }
+  if ( !tag->isDict() ) {
+    tag->FreeTag();
+    return EFI_UNSUPPORTED;
+  }
+  *dict = tag->getDict();
+  return EFI_SUCCESS;
+}
+
 /****************************************  XML  ****************************************/
 
 // Expects to see one dictionary in the XML file, the final pos will be returned
@@ -222,12 +555,45 @@ bool TagStruct::isFalseOrNn() const
 // tag pointer and returns the end of the dic, or returns ?? if not found.
 //
 
-EFI_STATUS ParseXML(const CHAR8* buffer, TagDict** dict, size_t bufSize)
+static EFI_STATUS ParseXMLBuffer(CHAR8* configBuffer, TagDict** dict)
 {
   EFI_STATUS  Status;
   UINT32    length = 0;
   UINT32    pos = 0;
   TagStruct*    tag = NULL;
+
+  buffer_start = configBuffer;
+  while (TRUE)
+  {
+    Status = XMLParseNextTag(configBuffer + pos, &tag, &length);
+    DBG("pos=%u\n", pos);
+    if (EFI_ERROR(Status)) {
+      DBG("error parsing next tag\n");
+      break;
+    }
+
+    pos += length;
+
+    if (tag == NULL) {
+      continue;
+    }
+    if (tag->isDict()) {
+      break;
+    }
+
+	  tag->FreeTag();
+    tag = NULL;
+  }
+
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+  *dict = tag->getDict();
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS ParseXML(const CHAR8* buffer, TagDict** dict, size_t bufSize)
+{
   CHAR8*    configBuffer = NULL;
   size_t    bufferSize = 0;
   UINTN     i;
@@ -242,6 +608,10 @@ EFI_STATUS ParseXML(const CHAR8* buffer, TagDict** dict, size_t bufSize)
     return EFI_INVALID_PARAMETER;
   }
 
+  if ( bufSize >= 8  &&  strncmp(buffer, "bplist00", 8) == 0 ) {
+    return ParseBinaryPlist((const UINT8*)buffer, bufSize, dict);
+  }
+
   configBuffer = (__typeof__(configBuffer))AllocateZeroPool(bufferSize+1);
   if(configBuffer == NULL) {
     return EFI_OUT_OF_RESOURCES;
@@ -253,34 +623,64 @@ EFI_STATUS ParseXML(const CHAR8* buffer, TagDict** dict, size_t bufSize)
       configBuffer[i] = 0x20;  //replace random zero bytes to spaces
     }
   }
-  buffer_start = configBuffer;
-  while (TRUE)
-  {
-    Status = XMLParseNextTag(configBuffer + pos, &tag, &length);
-    DBG("pos=%u\n", pos);
-    if (EFI_ERROR(Status)) {
-      DBG("error parsing next tag\n");
-      break;
-    }
+  return ParseXMLBuffer(configBuffer, dict);
+//  FreePool(configBuffer);
+}
 
-    pos += length;
+EFI_STATUS ParseXMLView(const CHAR8* buffer, TagDict** dict, size_t bufSize)
+{
+  EFI_STATUS  Status;
+  size_t    bufferSize = 0;
+  size_t    nodeMax = 0;
+  size_t    i;
 
-    if (tag == NULL) {
-      continue;
-    }
-    if (tag->isDict()) {
-      break;
-    }
+  if (bufSize) {
+    bufferSize = bufSize;
+  } else {
+    bufferSize = (UINT32)strlen(buffer);
+  }
+  DBG("buffer size=%ld\n", bufferSize);
+  if(dict == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
 
-	  tag->FreeTag();
-    tag = NULL;
+  // Binary plist tags are allocated the usual way. FreeTag() frees them as well.
+  if ( bufSize >= 8  &&  strncmp(buffer, "bplist00", 8) == 0 ) {
+    return ParseXML(buffer, dict, bufSize);
+  }
+
+  // Every tag starts with a '<', so it's enough slots.
+  for (i=0; i<bufferSize; i++) {
+    if (buffer[i] == '<') nodeMax++;
   }
-//  FreePool(configBuffer);
 
+  PlistArena* arena = (PlistArena*)AllocatePool(sizeof(PlistArena) + nodeMax * arenaSlotSize + bufferSize + 1);
+  if(arena == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  arena->root = NULL;
+  arena->nodeCount = 0;
+  arena->nodeMax = nodeMax;
+  arena->nodes = (UINT8*)(arena + 1);
+  arena->text = (CHAR8*)(arena->nodes + nodeMax * arenaSlotSize);
+
+  memmove(arena->text, buffer, bufferSize);
+  arena->text[bufferSize] = 0;
+  for (i=0; i<bufferSize; i++) {
+    if (arena->text[i] == 0) {
+      arena->text[i] = 0x20;  //replace random zero bytes to spaces
+    }
+  }
+
+  currentArena = arena;
+  Status = ParseXMLBuffer(arena->text, dict);
+  currentArena = NULL;
   if (EFI_ERROR(Status)) {
+    FreePlistArena(arena);
     return Status;
   }
-  *dict = tag->getDict();
+  arena->root = *dict;
+  DBG("arena %zu tags of %zu\n", arena->nodeCount, nodeMax);
   return EFI_SUCCESS;
 }
 
@@ -442,10 +842,10 @@ EFI_STATUS __ParseTagList(bool isArray, CHAR8* buffer, TagStruct** tag, UINT32 e
   TagStruct* dictOrArrayTag;
   XObjArray<TagStruct>* tagListPtr;
   if (isArray) {
-    dictOrArrayTag = TagArray::getEmptyTag();
+    dictOrArrayTag = newTag<TagArray>();
     tagListPtr = &dictOrArrayTag->getArray()->arrayContent();
   } else {
-    dictOrArrayTag = TagDict::getEmptyTag();
+    dictOrArrayTag = newTag<TagDict>();
     tagListPtr = &dictOrArrayTag->getDict()->dictContent();
   }
   XObjArray<TagStruct>& tagList = *tagListPtr;
@@ -465,7 +865,7 @@ EFI_STATUS __ParseTagList(bool isArray, CHAR8* buffer, TagStruct** tag, UINT32 e
         break;
       }
 
-      tagList.AddReference(newDictOrArrayTag, true);
+      tagList.AddReference(newDictOrArrayTag, currentArena == NULL); // arena tags are not deleted one by one
     }
 
     if (EFI_ERROR(Status)) {
@@ -511,8 +911,16 @@ EFI_STATUS ParseTagKey( char * buffer, TagStruct** tag, UINT32* lenPtr)
 //  if (EFI_ERROR(Status)) {
 //    return Status;
 //  }
-  tmpTag = TagKey::getEmptyTag();
-  tmpTag->setKeyValue(LString8(buffer));
+  gPerfCounters.PlistNodes++;
+  if ( currentArena ) {
+    tmpTag = arenaTag(new (currentArena) TagKey(LString8(buffer)));
+    if (tmpTag == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+  }else{
+    tmpTag = TagKey::getEmptyTag();
+    tmpTag->setKeyValue(LString8(buffer));
+  }
 
   *tag = tmpTag;
   *lenPtr = length + length2;
@@ -534,12 +942,23 @@ EFI_STATUS ParseTagString(CHAR8* buffer, TagStruct* * tag,UINT32* lenPtr)
     return Status;
   }
 
-  tmpTag = TagString::getEmptyTag();
+  // XMLDecode() only shortens the string, in place
+  if ( strchr(buffer, '&') != NULL ) {
+    XMLDecode(buffer);
+  }
+  gPerfCounters.PlistNodes++;
+  if ( currentArena ) {
+    tmpTag = arenaTag(new (currentArena) TagString(LString8(buffer)));
+  }else{
+    tmpTag = TagString::getEmptyTag();
+  }
   if (tmpTag == NULL) {
     return EFI_OUT_OF_RESOURCES;
   }
 
-  tmpTag->setStringValue(LString8(XMLDecode(buffer)));
+  if ( !currentArena ) {
+    tmpTag->setStringValue(LString8(buffer));
+  }
   *tag = tmpTag;
   *lenPtr = length;
   DBG(" parse string %s\n", tmpTag->getString()->stringValue().c_str());
@@ -564,7 +983,10 @@ EFI_STATUS ParseTagInteger(CHAR8* buffer, TagStruct** tag, UINT32* lenPtr)
     return Status;
   }
 
-  tmpTag = TagInt64::getEmptyTag();
+  tmpTag = newTag<TagInt64>();
+  if (tmpTag == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
   tmpTag->setIntValue(0);
 
   size = length;
@@ -642,7 +1064,10 @@ EFI_STATUS ParseTagFloat(CHAR8* buffer, TagStruct* * tag, UINT32* lenPtr)
     return Status;
   }
   
-  tmpTag = TagFloat::getEmptyTag();
+  tmpTag = newTag<TagFloat>();
+  if (tmpTag == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
 //----
   float f;
   AsciiStrToFloat(buffer, NULL, &f);
@@ -668,7 +1093,10 @@ EFI_STATUS ParseTagData(CHAR8* buffer, TagStruct* * tag, UINT32* lenPtr)
     return Status;
   }
 
-  tmpTag = TagData::getEmptyTag();
+  tmpTag = newTag<TagData>();
+  if (tmpTag == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
   //Slice - correction as Apple 2003
 //  tmpTag->setStringValue(LString8(buffer));
   // dmazar: base64 decode data
@@ -696,7 +1124,10 @@ EFI_STATUS ParseTagDate(CHAR8* buffer, TagStruct* * tag,UINT32* lenPtr)
   }
 
 
-  tmpTag = TagDate::getEmptyTag();
+  tmpTag = newTag<TagDate>();
+  if (tmpTag == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
   tmpTag->setDateValue(LString8(buffer));
 
   *tag = tmpTag;
@@ -712,7 +1143,10 @@ EFI_STATUS ParseTagBoolean(TagStruct** tag, bool value, UINT32* lenPtr)
 {
   TagBool* tmpTag;
 
-  tmpTag = TagBool::getEmptyTag();
+  tmpTag = newTag<TagBool>();
+  if (tmpTag == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
   tmpTag->setBoolValue(value);
 
   *tag = tmpTag;
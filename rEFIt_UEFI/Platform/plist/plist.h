@@ -48,9 +48,12 @@ class TagBool;
 class TagData;
 class TagDate;
 class TagArray;
+class PlistArena;
 
 class TagStruct
 {
+  PlistArena* _arena = NULL; // not NULL if this tag was allocated by ParseXMLView()
+
 public:
 
   TagStruct() {}
@@ -62,6 +65,9 @@ public:
 //  static TagStruct* getEmptyDictTag();
 //  static TagStruct* getEmptyArrayTag();
   virtual void FreeTag() = 0;
+  // Tags of an arena are not freed one by one. Freeing the root dict frees the whole arena. Returns true if the tag belongs to an arena.
+  bool FreeArenaTag();
+  void setArena(PlistArena* arena) { _arena = arena; }
   
   virtual bool operator == (const TagStruct& other) const = 0;
   virtual bool operator != (const TagStruct& other) const { return !(*this == other); };
@@ -122,6 +128,14 @@ public:
 #include "TagInt64.h"
 #include "TagString8.h"
 
+// Allocation from a PlistArena. Returns NULL when the arena is full.
+#if defined(_MSC_VER)
+void* operator new  (size_t count, PlistArena* arena) noexcept;
+#else
+void* operator new  (unsigned long count, PlistArena* arena) noexcept;
+#endif
+void operator delete  (void* ptr, PlistArena* arena) noexcept;
+
 EFI_STATUS
 GetNextTag (
   UINT8  *buffer,
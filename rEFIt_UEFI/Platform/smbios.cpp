@@ -25,6 +25,10 @@
 #include "platformdata.h"
 #include "AcpiPatcher.h"
 #include "guid.h"
+#include "SmbiosBuilder.h"
+#include "Checksum.h"
+#include "../cpp_foundation/XBuffer.h"
+#include "BootTimeline.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -96,6 +100,10 @@ BOOLEAN     gMobile;
 UINT8       gBootStatus;
 BOOLEAN     Once;
 
+//the original tables by type, and the strings of the table being patched in newSmbiosTable
+static SmbiosSourceIndex  SmbiosSource;
+static SmbiosStringPool   SmbiosStrings;
+
 MEM_STRUCTURE    gRAM;
 //DMI*              gDMI;
 UINT8 gRAMCount = 0;
@@ -258,8 +266,11 @@ UINTN iStrLen(CONST CHAR8* String, UINTN MaxLen)
 UINT16 SmbiosTableLength (APPLE_SMBIOS_STRUCTURE_POINTER SmbiosTableN)
 {
   CHAR8  *AChar;
-  UINT16  Length;
+  UINT16  Length = SmbiosSource.LengthOf(SmbiosTableN.Raw);
 
+  if (Length != 0) {
+    return Length; //an original table, measured once by the index
+  }
   AChar = (CHAR8 *)(SmbiosTableN.Raw + SmbiosTableN.Hdr->Length);
   while ((*AChar != 0) || (*(AChar + 1) != 0)) {
     AChar ++; //stop at 00 - first 0
@@ -269,78 +280,44 @@ UINT16 SmbiosTableLength (APPLE_SMBIOS_STRUCTURE_POINTER SmbiosTableN)
 }
 
 
+// the strings set by UpdateSmbiosString() are written here, with the table
 EFI_SMBIOS_HANDLE LogSmbiosTable (APPLE_SMBIOS_STRUCTURE_POINTER SmbiosTableN)
 {
-  UINT16  Length = SmbiosTableLength(SmbiosTableN);
+  UINT16  Length;
+  if (SmbiosStrings.IsLoadedFrom(SmbiosTableN.Raw)) {
+    Length = (UINT16)SmbiosStrings.Write(Current);
+    SmbiosStrings.Reset();
+  } else {
+    Length = SmbiosTableLength(SmbiosTableN);
+    CopyMem(Current, SmbiosTableN.Raw, Length);
+  }
   if (Length > MaxStructureSize) {
     MaxStructureSize = Length;
   }
-  CopyMem(Current, SmbiosTableN.Raw, Length);
   Current += Length;
   NumberOfRecords++;
   return SmbiosTableN.Hdr->Handle;
 }
 
-// the procedure insert Buffer into SmbiosTable by copy and update Field
+// the procedure set Buffer as the string of Field, the table is written with its strings by LogSmbiosTable()
 // the Buffer restricted by zero or by space
 EFI_STATUS UpdateSmbiosString(OUT APPLE_SMBIOS_STRUCTURE_POINTER SmbiosTableN,
                               SMBIOS_TABLE_STRING* Field, const XString8& Buffer)
 {
-  CHAR8*  AString;
-  CHAR8*  C1; //pointers for copy
-  CHAR8*  C2;
-  UINTN  Length = SmbiosTableLength(SmbiosTableN);
-  UINTN  ALength, BLength;
-  UINT8  IndexStr = 1;
+  UINTN  BLength;
 
   if ((SmbiosTableN.Raw == NULL) || Buffer.isEmpty() || !Field) {
     return EFI_NOT_FOUND;
   }
-  AString = (CHAR8*)(SmbiosTableN.Raw + SmbiosTableN.Hdr->Length); //first string
-  while (IndexStr != *Field) {
-    if (*AString) {
-      IndexStr++;
-    }
-    while (*AString != 0) AString++; //skip string at index
-    AString++; //next string
-    if (*AString == 0) {
-      //this is end of the table
-      if (*Field == 0) {
-        AString[1] = 0; //one more zero
-      }
-      *Field = IndexStr; //index of the next string that  is empty
-      if (IndexStr == 1) {
-        AString--; //first string has no leading zero
-      }
-      break;
-    }
-  }
-  // AString is at place to copy
-  ALength = iStrLen(AString, 0);
   BLength = iStrLen(Buffer.c_str(), MAX_OEM_STRING);
+  if (BLength == 0) {
+    return EFI_NOT_FOUND; //an empty string would end the table
+  }
+  if (!SmbiosStrings.IsLoadedFrom(SmbiosTableN.Raw)) {
+    SmbiosStrings.Load(SmbiosTableN.Raw);
+  }
   //  DBG("Table type %d field %d\n", SmbiosTable.Hdr->Type, *Field);
-  //  DBG("Old string length=%d new length=%d\n", ALength, BLength);
-  if (BLength > ALength) {
-    //Shift right
-    C1 = (CHAR8*)SmbiosTableN.Raw + Length; //old end
-    C2 = C1  + BLength - ALength; //new end
-    *C2 = 0;
-    while (C1 != AString) *(--C2) = *(--C1);
-
-  } else if (BLength < ALength) {
-    //Shift left
-    C1 = AString + ALength; //old start
-    C2 = AString + BLength; //new start
-    while (C1 != ((CHAR8*)SmbiosTableN.Raw + Length)) {
-      *C2++ = *C1++;
-    }
-    *C2 = 0;
-    *(--C2) = 0; //end of table
-  }
-  //DBG("UpdateSmbiosString() -> CopyMem %s %lld\n", Buffer.c_str(), BLength);
-  CopyMem(AString, Buffer.c_str(), BLength);
-  *(AString + BLength) = 0; // not sure there is 0
-
+  *Field = SmbiosStrings.SetString(*Field, Buffer.c_str(), BLength);
   return EFI_SUCCESS;
 }
 
@@ -348,23 +325,12 @@ APPLE_SMBIOS_STRUCTURE_POINTER GetSmbiosTableFromType (SMBIOS_TABLE_ENTRY_POINT
                                                        UINT8 SmbiosType, UINTN IndexTable)
 {
   APPLE_SMBIOS_STRUCTURE_POINTER SmbiosTableN;
-  UINTN                    SmbiosTypeIndex;
+  const UINT8*                   Table = (const UINT8 *)((UINTN)SmbiosPoint->TableAddress);
 
-  SmbiosTypeIndex = 0;
-  SmbiosTableN.Raw = (UINT8 *)((UINTN)SmbiosPoint->TableAddress);
-  if (SmbiosTableN.Raw == NULL) {
-    return SmbiosTableN;
-  }
-  while ((SmbiosTypeIndex != IndexTable) || (SmbiosTableN.Hdr->Type != SmbiosType)) {
-    if (SmbiosTableN.Hdr->Type == SMBIOS_TYPE_END_OF_TABLE) {
-      SmbiosTableN.Raw = NULL;
-      return SmbiosTableN;
-    }
-    if (SmbiosTableN.Hdr->Type == SmbiosType) {
-      SmbiosTypeIndex++;
-    }
-    SmbiosTableN.Raw = (UINT8 *)(SmbiosTableN.Raw + SmbiosTableLength (SmbiosTableN));
+  if (!SmbiosSource.IsBuiltFrom(Table)) {
+    SmbiosSource.Build(Table);
   }
+  SmbiosTableN.Raw = (UINT8 *)SmbiosSource.Get(SmbiosType, IndexTable);
   return SmbiosTableN;
 }
 
@@ -1998,6 +1964,29 @@ void PatchTableType133()
   return;
 }
 
+// CRC32 of the original memory device tables, the DIMMs as the firmware sees them. 0 if there are none
+UINT32 GetSmbiosMemoryCrc32()
+{
+  APPLE_SMBIOS_STRUCTURE_POINTER  SmbiosTableN;
+  XBuffer<UINT8>                  Devices;
+  UINTN                           Index;
+
+  if (!EntryPoint) {
+    return 0;
+  }
+  for (Index = 0; ; Index++) {
+    SmbiosTableN = GetSmbiosTableFromType(EntryPoint, EFI_SMBIOS_TYPE_MEMORY_DEVICE, Index);
+    if (SmbiosTableN.Raw == NULL) {
+      break;
+    }
+    Devices.ncat(SmbiosTableN.Raw, SmbiosTableLength(SmbiosTableN));
+  }
+  if (Devices.size() == 0) {
+    return 0;
+  }
+  return GetCrc32(Devices.data(), Devices.size());
+}
+
 EFI_STATUS PrepatchSmbios()
 {
   EFI_STATUS        Status = EFI_SUCCESS;
@@ -2092,10 +2081,12 @@ EFI_STATUS PrepatchSmbios()
 
 void PatchSmbios(void) //continue
 {
+  TimelineSpan Span("PatchSmbios");
 
   DbgHeader("PatchSmbios");
 
   newSmbiosTable.Raw = (UINT8*)AllocateZeroPool(MAX_TABLE_SIZE);
+  SmbiosStrings.Reset();
   //Slice - order of patching is significant
   PatchTableType0();
   PatchTableType1();
@@ -2122,6 +2113,7 @@ void PatchSmbios(void) //continue
   if(MaxStructureSize > MAX_TABLE_SIZE){
     //    DBG("Too long SMBIOS!\n");
   }
+  SmbiosStrings.Reset();
   FreePool((void*)newSmbiosTable.Raw);
 
   // there is no need to keep all tables in numeric order. It is not needed
@@ -2130,6 +2122,7 @@ void PatchSmbios(void) //continue
 
 void FinalizeSmbios() //continue
 {
+  TimelineSpan Span("FinalizeSmbios");
   EFI_PEI_HOB_POINTERS  GuidHob;
   EFI_PEI_HOB_POINTERS  HobStart;
   EFI_PHYSICAL_ADDRESS    *Table = NULL;
@@ -2220,7 +2213,7 @@ void FinalizeSmbios() //continue
   }
 
   gST->Hdr.CRC32 = 0;
-  gBS->CalculateCrc32 ((UINT8 *) &gST->Hdr, gST->Hdr.HeaderSize, &gST->Hdr.CRC32);
+  gST->Hdr.CRC32 = GetCrc32(&gST->Hdr, gST->Hdr.HeaderSize);
 
   //
   // Fix it in Hob list
@@ -65,6 +65,9 @@ iStrLen(
 EFI_STATUS
 PrepatchSmbios (void);
 
+UINT32
+GetSmbiosMemoryCrc32 (void);
+
 void
 PatchSmbios (void);
 
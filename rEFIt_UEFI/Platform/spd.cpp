@@ -21,6 +21,8 @@
 #include "memvendors.h"
 #include "cpu.h"
 #include "smbios.h"
+#include "Self.h"
+#include "../cpp_foundation/XBuffer.h"
 
 #ifndef DEBUG_SPD
 #ifndef DEBUG_ALL
@@ -46,6 +48,8 @@ extern UINT16 TotalCount;
 
 BOOLEAN             smbIntel;
 UINT8				smbPage;
+BOOLEAN             smbBlockRead; // I2C block read works on this controller, cleared after a failure
+BOOLEAN             smbSpdWd;     // SPD write disable, the I2C read must then set the R/W bit
 
 CONST CHAR8 *spd_memory_types[] =
 {
@@ -95,6 +99,16 @@ UINT8 spd_mem_to_smbios[] =
 #define SMBHSTDAT 5
 #define SMBHSTDAT1 6
 #define SBMBLKDAT 7
+// Intel SMB status and control bits for the I2C block read
+#define SMBHSTSTS_BYTE_DONE 0x80
+#define SMBHSTSTS_INTR      0x02
+#define SMBHSTSTS_ERRORS    0x1C /* failed, bus error, device error */
+#define SMBHSTCNT_KILL      0x02
+#define SMBHSTCNT_I2C_READ  0x18
+#define SMBHSTCNT_LAST_BYTE 0x20
+#define SMBHSTCNT_START     0x40
+#define SMBHSTCFG_SPD_WD    0x10 /* in hostc */
+#define SMB_BLOCK_MAX       32
 // MCP and nForce SMB reg offsets
 #define SMBHPRTCL_NV 0 /* protocol, PEC */
 #define SMBHSTSTS_NV 1 /* status */
@@ -300,17 +314,121 @@ UINT8 smb_read_byte(UINT32 base, UINT8 adr, UINT16 cmd)
   }
 }
 
+/** Wait for one of the Status bits of the Intel controller, FALSE after 5ms */
+STATIC BOOLEAN smb_wait_status(UINT32 base, UINT8 Status)
+{
+  UINT64 t, t1, t2;
+
+  t1 = AsmReadTsc();
+  while (!(IoRead8(base + SMBHSTSTS) & Status)) {
+    t2 = AsmReadTsc();
+    t = DivU64x64Remainder((t2 - t1), DivU64x32(gCPUStructure.TSCFrequency, 1000), 0);
+    if (t > 5) {
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+/** Read count bytes from i2c in one I2C block read, Intel only. The page of cmd must be selected
+ *  and the range can't cross a page. FALSE if the controller failed, then nothing is read */
+STATIC BOOLEAN smb_read_block(UINT32 base, UINT8 adr, UINT16 cmd, UINT8 count, UINT8* buf)
+{
+  UINT8 i;
+  UINT8 c;
+
+  IoWrite8(base + SMBHSTSTS, SMBHSTSTS_BYTE_DONE | 0x1f); // clear status
+  if (IoRead8(base + SMBHSTSTS) & 0x01) {
+    if (!smb_wait_status(base, 0xFE) || (IoRead8(base + SMBHSTSTS) & 0x01)) {
+      DBG("host is busy for too long for block %2hhX:%d!\n", adr, cmd);
+      return FALSE;
+    }
+  }
+  // ICH5 datasheet: DATA1 is the command and the R/W bit is cleared, unless SPD write disable is set
+  IoWrite8(base + SMBHSTADD, (adr << 1) | (smbSpdWd ? 0x01 : 0x00));
+  IoWrite8(base + SMBHSTDAT1, (UINT8)(cmd & 0xFF));
+  for (i = 0; i < count; i++) {
+    c = SMBHSTCNT_I2C_READ | ((i == count - 1) ? SMBHSTCNT_LAST_BYTE : 0);
+    IoWrite8(base + SMBHSTCNT, c);
+    if (i == 0) {
+      IoWrite8(base + SMBHSTCNT, c | SMBHSTCNT_START);
+    }
+    if (!smb_wait_status(base, SMBHSTSTS_BYTE_DONE | SMBHSTSTS_ERRORS) ||
+        (IoRead8(base + SMBHSTSTS) & SMBHSTSTS_ERRORS)) {
+      IoWrite8(base + SMBHSTCNT, SMBHSTCNT_KILL);
+      IoWrite8(base + SMBHSTCNT, 0);
+      IoWrite8(base + SMBHSTSTS, SMBHSTSTS_BYTE_DONE | 0x1f);
+      return FALSE;
+    }
+    buf[i] = IoRead8(base + SBMBLKDAT);
+    IoWrite8(base + SMBHSTSTS, SMBHSTSTS_BYTE_DONE); // next byte
+  }
+  smb_wait_status(base, SMBHSTSTS_INTR | SMBHSTSTS_ERRORS);
+  IoWrite8(base + SMBHSTSTS, SMBHSTSTS_BYTE_DONE | 0x1f);
+  return TRUE;
+}
+
 /* SPD i2c read optimization: prefetch only what we need, read non prefetcheable bytes on the fly */
 #define READ_SPD(spd, base, slot, x) spd[x] = smb_read_byte(base, 0x50 + slot, x)
 
+// reading a few unused bytes inside a block costs less than a new transaction
+#define SPD_RANGE_GAP 4
 
-/** Read from spd *used* values only*/
-void init_spd(UINT16* spd_indexes, UINT8* spd, UINT32 base, UINT8 slot)
+/** Read the spd bytes start to start + count - 1, in one block read when the controller can */
+STATIC void read_spd_range(UINT8* spd, UINT32 base, UINT8 slot, UINT16 start, UINT16 count)
 {
   UINT16 i;
-  for (i=0; spd_indexes[i]; i++) {
-    READ_SPD(spd, base, slot, spd_indexes[i]);
+
+  if (smbIntel && smbBlockRead && count > 1) {
+    READ_SPD(spd, base, slot, start); // selects the page
+    if (smb_read_block(base, 0x50 + slot, start + 1, (UINT8)(count - 1), spd + start + 1)) {
+      return;
+    }
+    DBG("SPD[%d]: block read failed, reading bytes\n", slot);
+    smbBlockRead = FALSE;
+    start++;
+    count--;
   }
+  for (i = start; i < start + count; i++) {
+    READ_SPD(spd, base, slot, i);
+  }
+}
+
+/** Read from spd *used* values only, the neighbour ones by blocks */
+void init_spd(UINT16* spd_indexes, UINT8* spd, UINT32 base, UINT8 slot)
+{
+  UINT16 sorted[64];
+  UINT16 count = 0;
+  UINT16 start, end;
+  UINT16 i, j, x;
+
+  for (i=0; spd_indexes[i] && count < 64; i++) {
+    x = spd_indexes[i];
+    for (j = count; j > 0 && sorted[j - 1] > x; j--) {
+      sorted[j] = sorted[j - 1];
+    }
+    sorted[j] = x;
+    count++;
+  }
+  if (count == 0) {
+    return;
+  }
+  start = sorted[0];
+  end = start + 1;
+  for (i = 1; i < count; i++) {
+    x = sorted[i];
+    if (x < end) {
+      continue;
+    }
+    if (x - end <= SPD_RANGE_GAP && (x >> 8) == (start >> 8) && x + 1 - start <= SMB_BLOCK_MAX) {
+      end = x + 1;
+    } else {
+      read_spd_range(spd, base, slot, start, end - start);
+      start = x;
+      end = x + 1;
+    }
+  }
+  read_spd_range(spd, base, slot, start, end - start);
 
 #if 0
   DBG("Reading entire spd data\n");
@@ -573,8 +691,8 @@ CHAR8* getDDRPartNum(UINT8* spd, UINT32 base, UINT8 slot)
 
   // Check that the spd part name is zero terminated and that it is ascii:
   ZeroMem(asciiPartNo, 32);  //sizeof(asciiPartNo));
+  read_spd_range(spd, base, slot, start, 20); // only read once the corresponding model part (ddr3 or ddr2)
   for (i = start; i < start + 20; i++) {
-    READ_SPD(spd, base, slot, (UINT16)i); // only read once the corresponding model part (ddr3 or ddr2)
     c = spd[i];
     if (IS_ALFA(c) || IS_DIGIT(c) || IS_PUNCT(c)) // It seems that System Profiler likes only letters and digits...
       asciiPartNo[index++] = c;
@@ -604,6 +722,7 @@ STATIC void read_smb(EFI_PCI_IO_PROTOCOL *PciIo, UINT16	vid, UINT16	did)
   UINT8                  TotalSlotsCount;
 
   smbPage = 0; // valid pages are 0 and 1; assume the first page (page 0) is already selected
+  smbBlockRead = TRUE;
 //  vid = gPci->Hdr.VendorId;
 //  did = gPci->Hdr.DeviceId;
 
@@ -667,6 +786,7 @@ STATIC void read_smb(EFI_PCI_IO_PROTOCOL *PciIo, UINT16	vid, UINT16	did)
 
 	MsgLog("Scanning SMBus [%04hX:%04hX], mmio: 0x%X, ioport: 0x%X, hostc: 0x%X\n",
          vid, did, mmio, base, hostc);
+  smbSpdWd = smbIntel && (hostc & SMBHSTCFG_SPD_WD) != 0;
 
   // needed at least for laptops
   //fullBanks = (gDMI->MemoryModules == gDMI->CntMemorySlots);
@@ -859,6 +979,140 @@ STATIC void read_smb(EFI_PCI_IO_PROTOCOL *PciIo, UINT16	vid, UINT16	did)
   }
 }
 
+//
+// With Boot/SpdCache, the slots found in the SPD are kept in misc\SpdCache.bin. The key is the CRC32 of the
+// original SMBIOS memory devices and XMPDetection: other modules, or the same ones moved, change the tables.
+// A hit skips the SMBus.
+//
+#define SPD_CACHE_FILE       L"misc\\SpdCache.bin"
+#define SPD_CACHE_SIGNATURE  SIGNATURE_32('S', 'P', 'D', 'C')
+#define SPD_CACHE_VERSION    1
+
+typedef struct {
+  UINT32  Signature;
+  UINT32  Version;
+  UINT32  Count;
+  UINT32  Key;
+} SPD_CACHE_HEADER;
+
+typedef struct {
+  UINT8   Slot;
+  UINT8   Type;
+  UINT16  Reserved;
+  UINT32  ModuleSize;
+  UINT32  Frequency;
+  CHAR8   Vendor[32];
+  CHAR8   PartNo[32];
+  CHAR8   SerialNo[20];
+} SPD_CACHE_RECORD;
+
+STATIC UINT32 SpdCacheKey(void)
+{
+  UINT32 Key = GetSmbiosMemoryCrc32();
+
+  if (Key == 0) {
+    return 0; //no memory devices, nothing to compare
+  }
+  return Key ^ ((UINT32)(UINT8)gSettings.XMPDetection * 2654435761U);
+}
+
+STATIC BOOLEAN SpdCacheLoad(UINT32 Key)
+{
+  EFI_STATUS          Status;
+  UINT8               *Data = NULL;
+  UINTN               DataSize = 0;
+  UINT32              Index;
+  SPD_CACHE_HEADER    *Header;
+  SPD_CACHE_RECORD    *Record;
+  RAM_SLOT_INFO       *Slot;
+
+  Status = egLoadFile(&self.getCloverDir(), SPD_CACHE_FILE, &Data, &DataSize);
+  if (EFI_ERROR(Status)) {
+    MsgLog("SPD cache: %s\n", efiStrError(Status));
+    return FALSE;
+  }
+  Header = (SPD_CACHE_HEADER *)Data;
+  if (DataSize < sizeof(SPD_CACHE_HEADER) || Header->Signature != SPD_CACHE_SIGNATURE ||
+      Header->Version != SPD_CACHE_VERSION || Header->Count == 0 || Header->Count > MAX_RAM_SLOTS * 4 ||
+      DataSize < sizeof(SPD_CACHE_HEADER) + Header->Count * sizeof(SPD_CACHE_RECORD)) {
+    MsgLog("SPD cache: bad file\n");
+    FreePool(Data);
+    return FALSE;
+  }
+  if (Header->Key != Key) {
+    MsgLog("SPD cache: memory changed\n");
+    FreePool(Data);
+    return FALSE;
+  }
+  Record = (SPD_CACHE_RECORD *)(Header + 1);
+  for (Index = 0; Index < Header->Count; Index++, Record++) {
+    if (Record->Slot >= MAX_RAM_SLOTS * 4) {
+      continue;
+    }
+    Record->Vendor[sizeof(Record->Vendor) - 1] = 0;
+    Record->PartNo[sizeof(Record->PartNo) - 1] = 0;
+    Record->SerialNo[sizeof(Record->SerialNo) - 1] = 0;
+    Slot = &gRAM.SPD[Record->Slot];
+    Slot->Type = Record->Type;
+    Slot->ModuleSize = Record->ModuleSize;
+    Slot->Frequency = Record->Frequency;
+    Slot->Vendor = (CHAR8 *)AllocateCopyPool(AsciiStrSize(Record->Vendor), Record->Vendor);
+    Slot->PartNo = (CHAR8 *)AllocateCopyPool(AsciiStrSize(Record->PartNo), Record->PartNo);
+    Slot->SerialNo = (CHAR8 *)AllocateCopyPool(AsciiStrSize(Record->SerialNo), Record->SerialNo);
+    Slot->InUse = TRUE;
+    ++(gRAM.SPDInUse);
+    MsgLog("Slot: %d Type %d %dMB %dMHz Vendor=%s PartNo=%s SerialNo=%s (cached)\n",
+           Record->Slot,
+           (int)Slot->Type,
+           Slot->ModuleSize,
+           Slot->Frequency,
+           Slot->Vendor,
+           Slot->PartNo,
+           Slot->SerialNo);
+  }
+  FreePool(Data);
+  return TRUE;
+}
+
+STATIC void SpdCacheSave(UINT32 Key)
+{
+  EFI_STATUS          Status;
+  XBuffer<UINT8>      Data;
+  SPD_CACHE_HEADER    Header;
+  SPD_CACHE_RECORD    Record;
+  UINT8               Index;
+
+  ZeroMem(&Header, sizeof(Header));
+  Header.Signature = SPD_CACHE_SIGNATURE;
+  Header.Version = SPD_CACHE_VERSION;
+  Header.Count = gRAM.SPDInUse;
+  Header.Key = Key;
+  Data.ncat(&Header, sizeof(Header));
+  for (Index = 0; Index < MAX_RAM_SLOTS * 4; Index++) {
+    const RAM_SLOT_INFO& Slot = gRAM.SPD[Index];
+    if (!Slot.InUse) {
+      continue;
+    }
+    ZeroMem(&Record, sizeof(Record));
+    Record.Slot = Index;
+    Record.Type = Slot.Type;
+    Record.ModuleSize = Slot.ModuleSize;
+    Record.Frequency = Slot.Frequency;
+    if (Slot.Vendor) {
+      AsciiStrnCpyS(Record.Vendor, sizeof(Record.Vendor), Slot.Vendor, sizeof(Record.Vendor) - 1);
+    }
+    if (Slot.PartNo) {
+      AsciiStrnCpyS(Record.PartNo, sizeof(Record.PartNo), Slot.PartNo, sizeof(Record.PartNo) - 1);
+    }
+    if (Slot.SerialNo) {
+      AsciiStrnCpyS(Record.SerialNo, sizeof(Record.SerialNo), Slot.SerialNo, sizeof(Record.SerialNo) - 1);
+    }
+    Data.ncat(&Record, sizeof(Record));
+  }
+  Status = egSaveFile(&self.getCloverDir(), SPD_CACHE_FILE, Data.data(), Data.size());
+  MsgLog("SPD cache: saved %d slots: %s\n", gRAM.SPDInUse, efiStrError(Status));
+}
+
 void ScanSPD()
 {
   EFI_STATUS            Status;
@@ -870,9 +1124,17 @@ void ScanSPD()
   UINTN                 Index;
 //  UINTN                 ProtocolIndex;
   PCI_TYPE00            gPci;
+  UINT32                SpdCacheKeyValue = 0;
 
   DbgHeader("ScanSPD");
   
+  if (GlobalConfig.SpdCache) {
+    SpdCacheKeyValue = SpdCacheKey();
+    if (SpdCacheKeyValue != 0 && SpdCacheLoad(SpdCacheKeyValue)) {
+      return;
+    }
+  }
+
   // Scan PCI handles
   Status = gBS->LocateHandleBuffer (
                                     ByProtocol,
@@ -911,6 +1173,9 @@ void ScanSPD()
       }
     }
   }
+  if (SpdCacheKeyValue != 0 && gRAM.SPDInUse > 0) {
+    SpdCacheSave(SpdCacheKeyValue);
+  }
 
 
   // Scan PCI BUS For SmBus controller 
@@ -32,7 +32,9 @@ class XArray
 //	void Init();
 	XArray() : m_data(0), m_len(0), m_allocatedSize(0) { }
 	XArray(const XArray<TYPE> &anArray);
+	XArray(XArray<TYPE> &&anArray) : m_data(anArray.m_data), m_len(anArray.m_len), m_allocatedSize(anArray.m_allocatedSize) { anArray.m_data = 0; anArray.m_len = 0; anArray.m_allocatedSize = 0; }
 	const XArray<TYPE> &operator =(const XArray<TYPE> &anArray);
+	const XArray<TYPE> &operator =(XArray<TYPE> &&anArray);
 	virtual ~XArray();
 
   public:
@@ -91,6 +93,8 @@ class XArray
 
 	void CheckSize(size_t nNewSize);
 	void CheckSize(size_t nNewSize, size_t nGrowBy);
+	void reserve(size_t nNewSize) { CheckSize(nNewSize, 0); }
+	void shrink_to_fit();
 
 	size_t AddUninitialized(size_t count); // add count uninitialzed elements
 	size_t Add(const TYPE newElement, size_t count = 1);
@@ -167,6 +171,21 @@ const XArray<TYPE> &XArray<TYPE>::operator =(const XArray<TYPE> &anArray)
 	return *this;
 }
 
+/* move operator =, the buffer is handed over */
+template<class TYPE>
+const XArray<TYPE> &XArray<TYPE>::operator =(XArray<TYPE> &&anArray)
+{
+  if ( this == &anArray ) return *this;
+  if ( m_data ) free(m_data);
+  m_data = anArray.m_data;
+  m_len = anArray.m_len;
+  m_allocatedSize = anArray.m_allocatedSize;
+  anArray.m_data = 0;
+  anArray.m_len = 0;
+  anArray.m_allocatedSize = 0;
+  return *this;
+}
+
 /* Destructeur */
 template<class TYPE>
 XArray<TYPE>::~XArray()
@@ -182,6 +201,7 @@ void XArray<TYPE>::CheckSize(size_t nNewSize, size_t nGrowBy)
 //XArray_DBG("CheckSize: m_len=%d, m_size=%d, nGrowBy=%d, nNewSize=%d\n", m_len, m_size, nGrowBy, nNewSize);
 	if ( nNewSize > m_allocatedSize ) {
 		nNewSize += nGrowBy;
+		if ( nGrowBy != 0 && nNewSize < m_allocatedSize + m_allocatedSize / 2 ) nNewSize = m_allocatedSize + m_allocatedSize / 2; // geometric growth, Add() is amortized O(1)
 		m_data = (TYPE *)Xrealloc((void *)m_data, nNewSize * sizeof(TYPE), m_allocatedSize * sizeof(TYPE) );
 		if ( !m_data ) {
 			panic("XArray<TYPE>::CheckSize(nNewSize=%zu, nGrowBy=%zu) : Xrealloc(%zu, %lu, %" PRIuPTR ") returned NULL. System halted\n", nNewSize, nGrowBy, m_allocatedSize, nNewSize*sizeof(TYPE), (uintptr_t)m_data);
@@ -198,6 +218,24 @@ void XArray<TYPE>::CheckSize(size_t nNewSize)
 	CheckSize(nNewSize, XArrayGrowByDefault);
 }
 
+/* shrink_to_fit()  // gives back what the geometric growth allocated in advance */
+template<class TYPE>
+void XArray<TYPE>::shrink_to_fit()
+{
+	if ( m_len == m_allocatedSize ) return;
+	if ( m_len == 0 ) {
+		free(m_data);
+		m_data = NULL;
+		m_allocatedSize = 0;
+		return;
+	}
+	m_data = (TYPE *)Xrealloc((void *)m_data, m_len * sizeof(TYPE), m_allocatedSize * sizeof(TYPE) );
+	if ( !m_data ) {
+		panic("XArray<TYPE>::shrink_to_fit() : Xrealloc(%zu, %zu) returned NULL. System halted\n", m_len*sizeof(TYPE), m_allocatedSize*sizeof(TYPE));
+	}
+	m_allocatedSize = m_len;
+}
+
 /* SetLength (size_t i) */
 template<class TYPE>
 void XArray<TYPE>::setSize(size_t l)
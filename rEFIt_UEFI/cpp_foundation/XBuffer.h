@@ -24,15 +24,18 @@ class XBuffer : public XBuffer_Super
 	size_t m_allocatedSize;
 
 	void Initialize(const T* p, size_t count, size_t index);
+	void moveFrom(XBuffer<T> &aBuffer);
   public:
 	XBuffer() : _WData(NULL), m_allocatedSize(0) { Initialize(NULL, 0, 0); } // ": _WData(NULL), m_allocatedSize(0)" to avoid effc++ warning
 
   XBuffer(const XBuffer<T>& aBuffer) : _WData(NULL), m_allocatedSize(0) { Initialize(aBuffer.data(), aBuffer.size(), aBuffer.index()); }
+  XBuffer(XBuffer<T>&& aBuffer) : _WData(NULL), m_allocatedSize(0) { moveFrom(aBuffer); }
   XBuffer(XRBuffer<T> &aBuffer, size_t pos = 0, size_t count = MAX_XSIZE);
 //	XBuffer(XBuffer &aBuffer, size_t pos = 0, size_t count = MAX_XSIZE);
 	XBuffer(void *p, size_t count);
 	const XBuffer &operator =(const XRBuffer<T> &aBuffer);
 	const XBuffer &operator =(const XBuffer &aBuffer);
+	const XBuffer &operator =(XBuffer &&aBuffer);
 
   template<typename IntegralType, enable_if(is_integral(IntegralType))>
 	void stealValueFrom(T* p, IntegralType count) {
@@ -48,6 +51,9 @@ class XBuffer : public XBuffer_Super
 
   public:
 	void CheckSize(size_t nNewSize, size_t nGrowBy = XBufferGrowByDefault);
+	void reserve(size_t nNewSize) { CheckSize(nNewSize, 0); }
+	size_t allocatedSize() const { return m_allocatedSize; }
+	void shrink_to_fit();
 
   void* vdata() const { return (void*)XBuffer_Super::data(); }
   const T* data() const { return _WData; }
@@ -197,6 +203,18 @@ void XBuffer<T>::Initialize(const T* p, size_t count, size_t index)
   }
 }
 
+// take the memory of aBuffer, which is left empty. The current memory must have been freed.
+template <typename T>
+void XBuffer<T>::moveFrom(XBuffer<T> &aBuffer)
+{
+  _WData = aBuffer._WData;
+  m_allocatedSize = aBuffer.m_allocatedSize;
+  XRBuffer<T>::_RData = _WData;
+  XRBuffer<T>::m_size = aBuffer.XRBuffer<T>::m_size;
+  XRBuffer<T>::_Index = aBuffer.XRBuffer<T>::_Index;
+  aBuffer.Initialize(NULL, 0, 0);
+}
+
 //-------------------------------------------------------------------------------------------------
 //                                               CheckSize
 //-------------------------------------------------------------------------------------------------
@@ -206,6 +224,7 @@ void XBuffer<T>::CheckSize(size_t nNewSize, size_t nGrowBy)
   if ( m_allocatedSize < nNewSize )
   {
     nNewSize += nGrowBy;
+    if ( nGrowBy != 0 && nNewSize < m_allocatedSize + m_allocatedSize / 2 ) nNewSize = m_allocatedSize + m_allocatedSize / 2; // geometric growth, cat() is amortized O(1)
     _WData = (unsigned char*)Xrealloc(_WData, nNewSize, m_allocatedSize);
     if ( !_WData ) {
       panic("XBuffer<T>::CheckSize(%zu, %zu) : Xrealloc(%" PRIuPTR " %zu, %zu) returned NULL. System halted\n", nNewSize, nGrowBy, uintptr_t(_WData), nNewSize, m_allocatedSize);
@@ -215,6 +234,18 @@ void XBuffer<T>::CheckSize(size_t nNewSize, size_t nGrowBy)
   }
 }
 
+template <typename T>
+void XBuffer<T>::shrink_to_fit()
+{
+  if ( XRBuffer<T>::m_size == 0 || XRBuffer<T>::m_size >= m_allocatedSize ) return;
+  _WData = (unsigned char*)Xrealloc(_WData, XRBuffer<T>::m_size, m_allocatedSize);
+  if ( !_WData ) {
+    panic("XBuffer<T>::shrink_to_fit() : Xrealloc(%zu, %zu) returned NULL. System halted\n", XRBuffer<T>::m_size, m_allocatedSize);
+  }
+  XRBuffer<T>::_RData = _WData;
+  m_allocatedSize = XRBuffer<T>::m_size;
+}
+
 //-------------------------------------------------------------------------------------------------
 //                                               ctor
 //-------------------------------------------------------------------------------------------------
@@ -274,6 +305,15 @@ const XBuffer<T>& XBuffer<T>::operator =(const XBuffer<T> &aBuffer)
   return *this;
 }
 
+template <typename T>
+const XBuffer<T>& XBuffer<T>::operator =(XBuffer<T> &&aBuffer)
+{
+  if ( this == &aBuffer ) return *this;
+  free(_WData);
+  moveFrom(aBuffer);
+  return *this;
+}
+
 template <typename T>
 const XBuffer<T> &XBuffer<T>::operator +=(const XRBuffer<T> &aBuffer)
 {
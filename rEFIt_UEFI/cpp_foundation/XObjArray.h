@@ -42,6 +42,8 @@ class XObjArrayNC
   public:
 	void Init();
 	XObjArrayNC() : _Data(0), _Len(0), m_allocatedSize(0) { Init(); }
+	XObjArrayNC(XObjArrayNC<TYPE> &&anObjArrayNC) : _Data(anObjArrayNC._Data), _Len(anObjArrayNC._Len), m_allocatedSize(anObjArrayNC.m_allocatedSize) { anObjArrayNC.Init(); }
+	XObjArrayNC<TYPE> &operator =(XObjArrayNC<TYPE> &&anObjArrayNC);
 	virtual ~XObjArrayNC();
 
   protected:
@@ -115,6 +117,8 @@ class XObjArrayNC
 
   public:
 	void CheckSize(size_t nNewSize, size_t nGrowBy = XArrayGrowByDefault);
+	void reserve(size_t nNewSize) { CheckSize(nNewSize, 0); }
+	void shrink_to_fit();
 
 };
 
@@ -142,8 +146,10 @@ class XObjArray : public XObjArrayNC<TYPE>
   XObjArray(const TYPE &n1, const TYPE &n2, const TYPE &n3, const TYPE &n4, const TYPE &n5, const TYPE &n6, const TYPE &n7, const TYPE &n8, const TYPE &n9, const TYPE &n10, const TYPE &n11, const TYPE &n12, const TYPE &n13, const TYPE &n14, bool FreeThem = true);
 
 	XObjArray(const XObjArray<TYPE> &anObjArray);
+	XObjArray(XObjArray<TYPE> &&anObjArray) : XObjArrayNC<TYPE>(static_cast<XObjArrayNC<TYPE>&&>(anObjArray)) {}
 
 	const XObjArray<TYPE> &operator =(const XObjArray<TYPE> &anObjArray);
+	XObjArray<TYPE> &operator =(XObjArray<TYPE> &&anObjArray) { XObjArrayNC<TYPE>::operator =(static_cast<XObjArrayNC<TYPE>&&>(anObjArray)); return *this; }
 
 	size_t AddCopy(const TYPE &newElement, bool FreeIt = true);
 	size_t AddCopies(const TYPE &n1, bool FreeIt = true);
@@ -162,6 +168,18 @@ class XObjArray : public XObjArrayNC<TYPE>
 	size_t AddCopies(const TYPE &n1, const TYPE &n2, const TYPE &n3, const TYPE &n4, const TYPE &n5, const TYPE &n6, const TYPE &n7, const TYPE &n8, const TYPE &n9, const TYPE &n10, const TYPE &n11, const TYPE &n12, const TYPE &n13, const TYPE &n14, bool FreeThem = true);
 	//TYPE &       AddNew(bool FreeIt = true);
 
+	// construct the new element from args, instead of constructing a temporary and copying it
+	template<typename... Args>
+	TYPE &emplace_back(Args&&... args)
+	{
+		XObjArrayNC<TYPE>::CheckSize(XObjArrayNC<TYPE>::_Len+1);
+		TYPE* newElement = new TYPE(static_cast<Args&&>(args)...);
+		XObjArrayNC<TYPE>::_Data[XObjArrayNC<TYPE>::_Len].Object = newElement;
+		XObjArrayNC<TYPE>::_Data[XObjArrayNC<TYPE>::_Len].FreeIt = true;
+		XObjArrayNC<TYPE>::_Len += 1;
+		return *newElement;
+	}
+
 	size_t InsertCopy(const TYPE &newElement, size_t pos);
 
 };
@@ -432,6 +450,20 @@ const XObjArray<TYPE> &XObjArray<TYPE>::operator =(const XObjArray<TYPE> &anObjA
 	return *this;
 }
 
+/* move operator =, the objects are handed over, not copied */
+template<class TYPE>
+XObjArrayNC<TYPE> &XObjArrayNC<TYPE>::operator =(XObjArrayNC<TYPE> &&anObjArrayNC)
+{
+	if ( this == &anObjArrayNC ) return *this; // self assignement
+	setEmpty();
+	if ( _Data ) free(_Data);
+	_Data = anObjArrayNC._Data;
+	_Len = anObjArrayNC._Len;
+	m_allocatedSize = anObjArrayNC.m_allocatedSize;
+	anObjArrayNC.Init();
+	return *this;
+}
+
 /* Destructeur */
 template<class TYPE>
 XObjArrayNC<TYPE>::~XObjArrayNC()
@@ -447,6 +479,7 @@ void XObjArrayNC<TYPE>::CheckSize(size_t nNewSize, size_t nGrowBy)
 {
 	if ( m_allocatedSize < nNewSize ) {
 		nNewSize += nGrowBy + 1;
+		if ( nGrowBy != 0 && nNewSize < m_allocatedSize + m_allocatedSize / 2 ) nNewSize = m_allocatedSize + m_allocatedSize / 2; // geometric growth, Add() is amortized O(1)
 		_Data = (XObjArrayEntry<TYPE> *)Xrealloc((void *)_Data, sizeof(XObjArrayEntry<TYPE>) * nNewSize, sizeof(XObjArrayEntry<TYPE>) * m_allocatedSize);
 		if ( !_Data ) {
 			panic("XObjArrayNC<TYPE>::CheckSize(nNewSize=%zu, nGrowBy=%zu) : Xrealloc(%zu, %zu, %" PRIuPTR ") returned NULL. System halted\n", nNewSize, nGrowBy, m_allocatedSize, sizeof(XObjArrayEntry<TYPE>) * nNewSize, (uintptr_t)_Data);
@@ -456,6 +489,18 @@ void XObjArrayNC<TYPE>::CheckSize(size_t nNewSize, size_t nGrowBy)
 	}
 }
 
+/* shrink_to_fit()  // only the entries are reallocated, the objects don't move */
+template<class TYPE>
+void XObjArrayNC<TYPE>::shrink_to_fit()
+{
+	if ( _Len == 0 || _Len + 1 >= m_allocatedSize ) return;
+	_Data = (XObjArrayEntry<TYPE> *)Xrealloc((void *)_Data, sizeof(XObjArrayEntry<TYPE>) * (_Len + 1), sizeof(XObjArrayEntry<TYPE>) * m_allocatedSize);
+	if ( !_Data ) {
+		panic("XObjArrayNC<TYPE>::shrink_to_fit() : Xrealloc(%zu, %zu) returned NULL. System halted\n", sizeof(XObjArrayEntry<TYPE>) * (_Len + 1), sizeof(XObjArrayEntry<TYPE>) * m_allocatedSize);
+	}
+	m_allocatedSize = _Len + 1;
+}
+
 ///* Add() */
 //template<class TYPE>
 //TYPE &XObjArray<TYPE>::AddNew(bool FreeIt)
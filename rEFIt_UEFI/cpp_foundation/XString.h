@@ -42,12 +42,14 @@ class XString8 : public XStringAbstract<char, XString8>
   public:
 	XString8() : XStringAbstract<char, XString8>() {};
 	XString8(const XString8& S) : XStringAbstract<char, XString8>(S) {}
+	XString8(XString8&& S) : XStringAbstract<char, XString8>(static_cast<XStringAbstract<char, XString8>&&>(S)) {}
 	XString8(const LString8& S) : XStringAbstract<char, XString8>(S) { }
 
 	template<class OtherXStringClass, enable_if( is___String(OtherXStringClass) && !is___LString(OtherXStringClass))> // enable_if is to avoid constructing with a non-corresponding LString. To avoid memory allocation.
 	XString8(const OtherXStringClass& S) : XStringAbstract<char, XString8>(S) {}
 
 	XString8& operator=(const XString8 &S) { this->XStringAbstract<char, XString8>::operator=(S); return *this; }
+	XString8& operator=(XString8&& S) { this->XStringAbstract<char, XString8>::operator=(static_cast<XStringAbstract<char, XString8>&&>(S)); return *this; }
 
 	using XStringAbstract<char, XString8>::operator =;
 
@@ -57,13 +59,14 @@ class XString8 : public XStringAbstract<char, XString8>
 protected:
 	static void transmitS8Printf(const char* buf, unsigned int nbchar, void* context)
 	{
-		((XString8*)(context))->strncat(buf, nbchar);
+		PrintfContext* printfContext = (PrintfContext*)context;
+		printfContext->size = printfContext->str->appendAt(printfContext->size, buf, nbchar);
 	}
 public:
 	void vS8Printf(const char* format, va_list va)
 	{
 		setEmpty();
-		vprintf_with_callback(format, va, transmitS8Printf, this);
+		vS8Catf(format, va);
 	}
 	void S8Printf(const char* format, ...) __attribute__((__format__(__printf__, 2, 3)))
 	{
@@ -75,7 +78,9 @@ public:
 	}
   void vS8Catf(const char* format, va_list va)
   {
-    vprintf_with_callback(format, va, transmitS8Printf, this);
+    PrintfContext printfContext = { this, sizeInNativeChars() };
+    reserve(printfContext.size + size_of_utf_string(format)); // the format length is a fair guess of the output length
+    vprintf_with_callback(format, va, transmitS8Printf, &printfContext);
   }
   void S8Catf(const char* format, ...) __attribute__((__format__(__printf__, 2, 3)))
   {
@@ -102,12 +107,14 @@ class XString16 : public XStringAbstract<char16_t, XString16>
   public:
 	XString16() : XStringAbstract<char16_t, XString16>() {};
   XString16(const XString16& S) : XStringAbstract<char16_t, XString16>(S) {}
+  XString16(XString16&& S) : XStringAbstract<char16_t, XString16>(static_cast<XStringAbstract<char16_t, XString16>&&>(S)) {}
   XString16(const LString16& S) : XStringAbstract<char16_t, XString16>(S) {}
 
 	template<class OtherXStringClass, enable_if( is___String(OtherXStringClass) && !is___LString(OtherXStringClass))> // enable_if is to avoid constructing with a non-corresponding LString. To avoid memory allocation.
 	XString16(const OtherXStringClass& S) : XStringAbstract<char16_t, XString16>(S) {}
 
 	XString16& operator=(const XString16 &S) { this->XStringAbstract<char16_t, XString16>::operator=(S); return *this; }
+	XString16& operator=(XString16&& S) { this->XStringAbstract<char16_t, XString16>::operator=(static_cast<XStringAbstract<char16_t, XString16>&&>(S)); return *this; }
 
 	using XStringAbstract<char16_t, XString16>::operator =;
 
@@ -129,12 +136,14 @@ class XString32 : public XStringAbstract<char32_t, XString32>
   public:
 	XString32() : XStringAbstract<char32_t, XString32>() {};
   XString32(const XString32& S) : XStringAbstract<char32_t, XString32>(S) {}
+  XString32(XString32&& S) : XStringAbstract<char32_t, XString32>(static_cast<XStringAbstract<char32_t, XString32>&&>(S)) {}
   XString32(const LString32& S) : XStringAbstract<char32_t, XString32>(S) {}
 
 	template<class OtherXStringClass, enable_if( is___String(OtherXStringClass) && !is___LString(OtherXStringClass))> // enable_if is to avoid constructing with a non-corresponding LString. To avoid memory allocation.
 	XString32(const OtherXStringClass& S) : XStringAbstract<char32_t, XString32>(S) {}
 
 	XString32& operator=(const XString32 &S) { this->XStringAbstract<char32_t, XString32>::operator=(S); return *this; }
+	XString32& operator=(XString32&& S) { this->XStringAbstract<char32_t, XString32>::operator=(static_cast<XStringAbstract<char32_t, XString32>&&>(S)); return *this; }
 	
 	using XStringAbstract<char32_t, XString32>::operator =;
 
@@ -159,6 +168,7 @@ class XStringW : public XStringAbstract<wchar_t, XStringW>
 public:
 	XStringW() : XStringAbstract<wchar_t, XStringW>() {};
 	XStringW(const XStringW& S) : XStringAbstract<wchar_t, XStringW>(S) {}
+	XStringW(XStringW&& S) : XStringAbstract<wchar_t, XStringW>(static_cast<XStringAbstract<wchar_t, XStringW>&&>(S)) {}
   XStringW(const LStringW& S) : XStringAbstract<wchar_t, XStringW>(S) { }
 
 	template<class OtherXStringClass, enable_if( is___String(OtherXStringClass) && !is___LString(OtherXStringClass))> // enable_if is to avoid constructing with a non-corresponding LString. To avoid memory allocation.
@@ -166,6 +176,7 @@ public:
 	
 
 	XStringW& operator=(const XStringW &S) { this->XStringAbstract<wchar_t, XStringW>::operator=(S); return *this; }
+	XStringW& operator=(XStringW&& S) { this->XStringAbstract<wchar_t, XStringW>::operator=(static_cast<XStringAbstract<wchar_t, XStringW>&&>(S)); return *this; }
 
 	using XStringAbstract<wchar_t, XStringW>::operator =;
 
@@ -174,13 +185,16 @@ public:
 protected:
 	static void transmitSPrintf(const wchar_t* buf, unsigned int nbchar, void* context)
 	{
-		((XStringW*)(context))->strncat(buf, nbchar);
+		PrintfContext* printfContext = (PrintfContext*)context;
+		printfContext->size = printfContext->str->appendAt(printfContext->size, buf, nbchar);
 	}
 public:
 	void vSWPrintf(const char* format, va_list va)
 	{
 		setEmpty();
-		vwprintf_with_callback(format, va, transmitSPrintf, this);
+		PrintfContext printfContext = { this, 0 };
+		reserve(size_of_utf_string(format)); // the format length is a fair guess of the output length
+		vwprintf_with_callback(format, va, transmitSPrintf, &printfContext);
 	}
 	void SWPrintf(const char* format, ...) __attribute__((__format__(__printf__, 2, 3)))
 	{
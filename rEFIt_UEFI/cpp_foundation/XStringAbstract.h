@@ -648,18 +648,36 @@ class XStringAbstract : public __String<T, ThisXStringClass>
 
   protected:
   	size_t m_allocatedSize; // Must include null terminator. Real memory allocated is only m_allocatedSize (not m_allocatedSize+1)
-	
+  	T m_small[XStringSmallSize]; // short strings live here, m_data == m_small and m_allocatedSize == XStringSmallSize. Never shared.
+
+	bool isSmall() const { return m_data == m_small; }
+	bool isOnHeap() const { return m_allocatedSize > 0  &&  m_data != m_small; }
+
 	//xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx
 	// Init , Alloc
 	//xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx
-	
+
 	/*
 	 * nNewSize must include null terminator.
+	 * Up to XStringSmallSize, the in-object buffer is used instead of the heap.
 	 */
 	void Alloc(size_t nNewSize)
 	{
+			if ( nNewSize <= XStringSmallSize ) {
+				if ( isOnHeap() ) {
+					memcpy(m_small, m_data, (nNewSize < m_allocatedSize ? nNewSize : m_allocatedSize)*sizeof(T));
+					free((void*)m_data);
+				}
+				m_data = m_small;
+				m_allocatedSize = XStringSmallSize;
+				return;
+			}
 			if ( m_allocatedSize == 0 ) {
         m_data = (T*)malloc( nNewSize*sizeof(T) );
+      }
+			else if ( isSmall() ) {
+        m_data = (T*)malloc( nNewSize*sizeof(T) );
+        if ( m_data ) memcpy(m_data, m_small, XStringSmallSize*sizeof(T));
       }
 			else {
         m_data = (T*)Xrealloc(m_data, nNewSize*sizeof(T), m_allocatedSize*sizeof(T));
@@ -679,7 +697,10 @@ class XStringAbstract : public __String<T, ThisXStringClass>
 		//DBG_XSTRING("CheckSize: m_size=%d, nNewSize=%d\n", m_size, nNewSize);
 		if ( m_allocatedSize < nNewSize+1 )
 		{
+			bool fitsSmall = nNewSize+1 <= XStringSmallSize;
 			nNewSize += nGrowBy;
+			if ( nGrowBy != 0 && nNewSize+1 < m_allocatedSize + m_allocatedSize / 2 ) nNewSize = m_allocatedSize + m_allocatedSize / 2 - 1; // geometric growth, appending is amortized O(1)
+			if ( fitsSmall ) nNewSize = XStringSmallSize - 1; // no grow by in the small buffer, the next step is the heap anyway
 			if ( m_allocatedSize == 0 ) { //if ( *m_data ) {
 				size_t len = __String<T, ThisXStringClass>::length();
 				if ( nNewSize < len ) nNewSize = len;
@@ -710,10 +731,10 @@ class XStringAbstract : public __String<T, ThisXStringClass>
 public:
 
 	/* default ctor */
-	XStringAbstract() : __String<T, ThisXStringClass>(&nullChar), m_allocatedSize(0) {}
+	XStringAbstract() : __String<T, ThisXStringClass>(&nullChar), m_allocatedSize(0), m_small() {}
 	
 	/* copy ctor */
-	XStringAbstract(const XStringAbstract& S) : __String<T, ThisXStringClass>(&nullChar), m_allocatedSize(0)
+	XStringAbstract(const XStringAbstract& S) : __String<T, ThisXStringClass>(&nullChar), m_allocatedSize(0), m_small()
 	{
 		if ( S.m_data  &&  !S.m_allocatedSize ) {
 			m_data = S.m_data;
@@ -722,26 +743,43 @@ public:
 		}
 	}
 
+	/* move ctor. A heap buffer changes hands, a small one is copied */
+	XStringAbstract(XStringAbstract&& S) : __String<T, ThisXStringClass>(&nullChar), m_allocatedSize(0), m_small()
+	{
+		moveFrom(S);
+	}
+
 	~XStringAbstract()
 	{
 		//DBG_XSTRING("Destructor :%ls\n", data());
-		if ( m_allocatedSize > 0 ) free((void*)m_data);
+		if ( isOnHeap() ) free((void*)m_data);
 	}
 
 	/* ctor */
 	template<class OtherLStringClass>
-	explicit XStringAbstract(const LString<T, OtherLStringClass>& S) : __String<T, ThisXStringClass>(S.s()), m_allocatedSize(0) {}
+	explicit XStringAbstract(const LString<T, OtherLStringClass>& S) : __String<T, ThisXStringClass>(S.s()), m_allocatedSize(0), m_small() {}
 	
 	template<typename O, class OtherXStringClass>
-	explicit XStringAbstract<T, ThisXStringClass>(const XStringAbstract<O, OtherXStringClass>& S) : __String<T, ThisXStringClass>(&nullChar), m_allocatedSize(0) { takeValueFrom(S); }
+	explicit XStringAbstract<T, ThisXStringClass>(const XStringAbstract<O, OtherXStringClass>& S) : __String<T, ThisXStringClass>(&nullChar), m_allocatedSize(0), m_small() { takeValueFrom(S); }
 	template<typename O, class OtherXStringClass>
-	explicit XStringAbstract<T, ThisXStringClass>(const LString<O, OtherXStringClass>& S) : __String<T, ThisXStringClass>(&nullChar), m_allocatedSize(0) { takeValueFrom(S); }
+	explicit XStringAbstract<T, ThisXStringClass>(const LString<O, OtherXStringClass>& S) : __String<T, ThisXStringClass>(&nullChar), m_allocatedSize(0), m_small() { takeValueFrom(S); }
 // TEMPORARILY DISABLED
 //	template<typename O>
 //	explicit __String<T, ThisXStringClass>(const O* S) { Init(0); takeValueFrom(S); }
 //
 	/* Copy Assign */ // Only other XString, no litteral at the moment.
 	XStringAbstract& operator=(const XStringAbstract &S)  { takeValueFrom(S); return *this; }
+	/* Move Assign */
+	XStringAbstract& operator=(XStringAbstract&& S)
+	{
+		if ( &S != this ) {
+			if ( isOnHeap() ) free((void*)m_data);
+			m_data = &nullChar;
+			m_allocatedSize = 0;
+			moveFrom(S);
+		}
+		return *this;
+	}
 	/* Assign */
 	#ifndef _MSC_VER
 	#pragma GCC diagnostic push
@@ -757,6 +795,20 @@ public:
 //	ThisXStringClass& operator =(const O* S)	{ strcpy(S); return *this; }
 
 protected:
+	// this must be empty and own nothing
+	void moveFrom(XStringAbstract& S)
+	{
+		if ( S.isSmall() ) {
+			memcpy(m_small, S.m_small, (size_of_utf_string(S.m_small)+1)*sizeof(T));
+			m_data = m_small;
+		}else{
+			m_data = S.m_data;
+		}
+		m_allocatedSize = S.m_allocatedSize;
+		S.m_data = &nullChar;
+		S.m_allocatedSize = 0;
+	}
+
 	ThisXStringClass& takeValueFromLiteral(const T* s)
 	{
 		if ( m_allocatedSize > 0 ) panic("XStringAbstract::takeValueFromLiteral -> m_allocatedSize > 0");
@@ -774,6 +826,32 @@ public:
 		else m_data[0] = 0;
 	}
 
+protected:
+	/*
+	 * printf output comes in chunks already in our encoding. The context keeps the current size, so a chunk is appended
+	 * without measuring the string or checking the chunk again.
+	 */
+	struct PrintfContext { ThisXStringClass* str; size_t size; };
+	size_t appendAt(size_t pos, const T* buf, size_t count)
+	{
+		CheckSize(pos + count);
+		memcpy(m_data+pos, buf, count*sizeof(T));
+		m_data[pos+count] = 0;
+		return pos + count;
+	}
+
+public:
+	/* room for nNewSize chars (not bytes) plus the terminator, without growing again */
+	void reserve(size_t nNewSize) { CheckSize(nNewSize, 0); }
+
+	/* gives back what the geometric growth allocated in advance */
+	void shrink_to_fit()
+	{
+		if ( !isOnHeap() ) return;
+		size_t size = size_of_utf_string(m_data);
+		if ( size+1 < m_allocatedSize ) Alloc(size+1);
+	}
+
   T* data() const { return m_data; }
 
   template<typename IntegralType, enable_if(is_integral(IntegralType))>
@@ -803,6 +881,11 @@ public:
 	T* forgetDataWithoutFreeing()
 	{
 		T* ret = m_data;
+		if ( isSmall() ) { // the caller will free it
+			ret = (T*)malloc(XStringSmallSize*sizeof(T));
+			if ( !ret ) panic("XStringAbstract::forgetDataWithoutFreeing : malloc returned NULL. System halted\n");
+			memcpy(ret, m_small, XStringSmallSize*sizeof(T));
+		}
 		m_data = &nullChar;
 		m_allocatedSize = 0;
 		return ret;
@@ -824,15 +907,32 @@ public:
 			setEmpty();
 		}
 	}
+	/*
+	 * Write other at m_data+pos, terminated. Return the new size.
+	 * When we own a buffer and other isn't in it, convert and measure in one walk. Only if it didn't fit, grow and convert again.
+	 * nGrowBy as in CheckSize() : 0 to copy, XStringGrowByDefault to append.
+	 */
+	template<typename O>
+	size_t convertAt(size_t pos, const O* other, size_t nGrowBy)
+	{
+		size_t newSize;
+		if ( m_allocatedSize > pos  &&  ( (uintptr_t)other < (uintptr_t)m_data  ||  (uintptr_t)other >= (uintptr_t)(m_data + m_allocatedSize) ) ) {
+			newSize = pos + utf_string_from_utf_string_measure(m_data+pos, m_allocatedSize-pos, other);
+			if ( newSize < m_allocatedSize ) return newSize;
+		}else{
+			newSize = pos + utf_size_of_utf_string(m_data, other);
+		}
+		CheckSize(newSize, nGrowBy);
+		utf_string_from_utf_string(m_data+pos, m_allocatedSize-pos, other);
+		m_data[newSize] = 0;
+		return newSize;
+	}
 	/* strcpy */
 	template<typename O>
 	void strcpy(const O* other)
 	{
 		if ( other && *other ) {
-			size_t newSize = utf_size_of_utf_string(m_data, other);
-			CheckSize(newSize, 0);
-			utf_string_from_utf_string(m_data, m_allocatedSize, other);
-			m_data[newSize] = 0;
+			convertAt(0, other, 0);
 		}else{
 			setEmpty();
 		}
@@ -858,7 +958,7 @@ public:
 		if ( otherChar ) {
 			size_t currentSize = size_of_utf_string(m_data);
 			size_t newSize = currentSize + utf_size_of_utf_string_len(m_data, &otherChar, 1);
-			CheckSize(newSize, 0);
+			CheckSize(newSize);
 			utf_string_from_utf_string_len(m_data+currentSize, m_allocatedSize, &otherChar, 1);
 			m_data[newSize] = 0;
 		}else{
@@ -871,10 +971,7 @@ public:
   {
     if ( other && *other ) {
       size_t currentSize = size_of_utf_string(m_data); // size is number of T, not in bytes
-      size_t newSize = currentSize + utf_size_of_utf_string(m_data, other); // size is number of T, not in bytes
-      CheckSize(newSize, 0);
-      utf_string_from_utf_string(m_data+currentSize, m_allocatedSize-currentSize, other);
-      m_data[newSize] = 0;
+      convertAt(currentSize, other, XStringGrowByDefault);
     }else{
       // nothing to do
     }
@@ -884,10 +981,7 @@ public:
 	void strcat(const __String<OtherCharType, OtherXStringClass>& other)
 	{
 		size_t currentSize = size_of_utf_string(m_data); // size is number of T, not in bytes
-		size_t newSize = currentSize + utf_size_of_utf_string(m_data, other.s()); // size is number of T, not in bytes
-		CheckSize(newSize, 0);
-		utf_string_from_utf_string(m_data+currentSize, m_allocatedSize-currentSize, other.s());
-		m_data[newSize] = 0;
+		convertAt(currentSize, other.s(), XStringGrowByDefault);
 	}
 	/* strncat */
 	template<typename O>
@@ -896,7 +990,7 @@ public:
 		if ( other && *other && other_len > 0 ) {
 			size_t currentSize = size_of_utf_string(m_data);
 			size_t newSize = currentSize + utf_size_of_utf_string_len(m_data, other, other_len);
-			CheckSize(newSize, 0);
+			CheckSize(newSize);
 			utf_string_from_utf_string_len(m_data+currentSize, m_allocatedSize, other, other_len);
 			m_data[newSize] = 0;
 		}else{
@@ -918,7 +1012,7 @@ public:
 
     size_t currentSize = size_of_utf_string(m_data);
     size_t otherSize = utf_size_of_utf_string_len(m_data, other, other_len);
-    CheckSize(currentSize+otherSize, 0);
+    CheckSize(currentSize+otherSize);
     size_t start = size_of_utf_string_len(m_data, pos); // size is number of T, not in bytes
     memmove( m_data + start + otherSize, m_data + start, (currentSize-start+1)*sizeof(T)); // memmove handles overlapping memory move
     utf_stringnn_from_utf_string(m_data+start, otherSize, other);
@@ -940,7 +1034,7 @@ public:
 
     size_t currentSize = size_of_utf_string(m_data);
     size_t otherSize = utf_size_of_utf_string(m_data, other);
-    CheckSize(currentSize+otherSize, 0);
+    CheckSize(currentSize+otherSize);
     size_t start = size_of_utf_string_len(m_data, pos); // size is number of T, not in bytes
     memmove( m_data + start + otherSize, m_data + start, (currentSize-start+1)*sizeof(T)); // memmove handles overlapping memory move
     utf_stringnn_from_utf_string(m_data+start, otherSize, other);
@@ -1088,7 +1182,7 @@ public:
 
 
   ThisXStringClass& stealValueFrom(T* S) {
-    if ( m_allocatedSize > 0 ) free((void*)m_data);
+    if ( isOnHeap() ) free((void*)m_data);
     m_data = S;
     m_allocatedSize = utf_size_of_utf_string(m_data, S) + 1;
     return *((ThisXStringClass*)this);
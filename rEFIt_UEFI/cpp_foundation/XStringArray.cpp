@@ -10,3 +10,107 @@
 
 const XString8Array NullXString8Array;
 const XStringWArray NullXStringWArray;
+
+
+UINT32 XString8View::hash() const
+{
+  UINT32 h = 2166136261U;
+  for ( size_t i = 0 ; i < Length ; i++ ) h = (h ^ (UINT8)Data[i]) * 16777619U;
+  return h;
+}
+
+XString8 XString8View::toXString8() const
+{
+  XString8 s;
+  if ( Length > 0 ) {
+    char* p = s.dataSized(Length+1);
+    memcpy(p, Data, Length);
+    p[Length] = 0;
+  }
+  return s;
+}
+
+// Length of Separator if S starts with it, 0 otherwise
+static size_t startsWithSeparator(const char* S, const char* Separator)
+{
+  size_t i;
+  for ( i = 0 ; Separator[i] ; i++ ) {
+    if ( S[i] != Separator[i] ) return 0;
+  }
+  return i;
+}
+
+void SplitViews(const char* S, const char* Separator, XArray<XString8View>& Views)
+{
+  if ( !S || !*S ) return;
+  if ( !Separator || !*Separator ) {
+    Views.Add(XString8View(S));
+    return;
+  }
+  while ( *S ) {
+    size_t sepLen = startsWithSeparator(S, Separator);
+    if ( sepLen ) {
+      S += sepLen;
+      continue;
+    }
+    const char* t = S;
+    while ( *t  &&  startsWithSeparator(t, Separator) == 0 ) t++;
+    Views.Add(XString8View(S, (size_t)(t - S)));
+    S = t;
+  }
+}
+
+size_t XString8ViewSet::find(const XString8View& V, UINT32 hash) const
+{
+  const UINT64* slots = table.data();
+  size_t mask = table.size() - 1;
+  size_t slot;
+  for ( slot = hash & mask ; slots[slot] != 0 ; slot = (slot + 1) & mask ) {
+    if ( (UINT32)(slots[slot] >> 32) == hash  &&  views.ElementAt((size_t)(UINT32)slots[slot] - 1).equal(V) ) break;
+  }
+  return slot;
+}
+
+void XString8ViewSet::rehash(size_t slotCount)
+{
+  table.setEmpty();
+  table.Add(0, slotCount);
+  for ( size_t viewIdx = 0 ; viewIdx < views.size() ; viewIdx++ ) {
+    UINT32 hash = views.ElementAt(viewIdx).hash();
+    table.ElementAt(find(views.ElementAt(viewIdx), hash)) = ((UINT64)hash << 32) | (viewIdx + 1);
+  }
+}
+
+bool XString8ViewSet::contains(const XString8View& V) const
+{
+  if ( views.size() == 0 ) return false;
+  return table.ElementAt(find(V, V.hash())) != 0;
+}
+
+bool XString8ViewSet::add(const XString8View& V)
+{
+  if ( (views.size() + 1) * 2 > table.size() ) rehash(table.size() ? table.size() * 2 : 32);
+  UINT32 hash = V.hash();
+  size_t slot = find(V, hash);
+  if ( table.ElementAt(slot) != 0 ) return false;
+  views.Add(V);
+  table.ElementAt(slot) = ((UINT64)hash << 32) | views.size();
+  return true;
+}
+
+void XString8Array::import(const XArray<XString8View>& Views)
+{
+  for ( size_t i = 0 ; i < Views.size() ; i++ ) {
+    AddReference(new XString8(Views.ElementAt(i).toXString8()), true);
+  }
+}
+
+void XString8Array::importID(const XArray<XString8View>& Views)
+{
+  XString8ViewSet present;
+  for ( size_t i = 0 ; i < size() ; i++ ) present.add(XString8View(array[i]));
+  for ( size_t i = 0 ; i < Views.size() ; i++ ) {
+    // The view is kept by the set, so a duplicate inside Views is also skipped
+    if ( present.add(Views.ElementAt(i)) ) AddReference(new XString8(Views.ElementAt(i).toXString8()), true);
+  }
+}
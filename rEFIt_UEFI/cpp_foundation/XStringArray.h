@@ -11,6 +11,7 @@
 
 #include <XToolsConf.h>
 #include "XToolsCommon.h"
+#include "XArray.h"
 #include "XObjArray.h"
 #include "XString.h"
 
@@ -276,7 +277,7 @@ class XStringArray_/* : public XStringArraySuper*/
 		size_t i;
 		
 		for ( i=0 ; i<aStrings.size() ; i+=1 ) {
-			if ( !Contains(aStrings[i]) ) AddCopy(aStrings[i]);
+			if ( !contains(aStrings[i]) ) array.AddCopy(aStrings[i]);
 		}
 	}
   void remove(const XStringClass &aString)
@@ -321,8 +322,64 @@ class XStringArray_/* : public XStringArraySuper*/
 
 };
 
+/*
+ * Token of a char string that doesn't own its chars, as made by SplitViews().
+ * Valid as long as the split string is not modified or freed. Comparisons are bytewise.
+ */
+class XString8View
+{
+  public:
+  const char* Data;
+  size_t Length;
+
+  XString8View() : Data(NULL), Length(0) {}
+  XString8View(const char* S, size_t Len) : Data(S), Length(Len) {}
+  explicit XString8View(const char* S) : Data(S), Length(S ? strlen(S) : 0) {}
+  explicit XString8View(const XString8& S) : Data(S.c_str()), Length(S.sizeInBytes()) {}
+
+  bool isEmpty() const { return Length == 0; }
+  bool equal(const char* S, size_t Len) const { return Length == Len  &&  (Len == 0 || memcmp(Data, S, Len) == 0); }
+  bool equal(const XString8View& V) const { return equal(V.Data, V.Length); }
+  UINT32 hash() const;
+  // The only place a token is copied
+  XString8 toXString8() const;
+};
+
+/*
+ * Splits S on Separator like Split<XString8Array>() : consecutive separators are skipped and there is no empty token.
+ * The tokens are appended to Views and point into S.
+ */
+void SplitViews(const char* S, const char* Separator, XArray<XString8View>& Views);
+
+// Set of views, open addressing. Slot is (hash << 32) | (viewIdx + 1), 0 if empty.
+class XString8ViewSet
+{
+  XArray<XString8View> views;
+  XArray<UINT64> table;
+
+  void rehash(size_t slotCount);
+  size_t find(const XString8View& V, UINT32 hash) const; // slot of V, or of the empty slot where it goes
+
+  public:
+  XString8ViewSet() : views(), table() {}
+
+  size_t size() const { return views.size(); }
+  void setEmpty() { views.setEmpty(); table.setEmpty(); }
+  bool contains(const XString8View& V) const;
+  // Returns false if V was already in the set
+  bool add(const XString8View& V);
+};
+
 class XString8Array : public XStringArray_<XString8, XString8Array>
 {
+  public:
+  using XStringArray_<XString8, XString8Array>::import;
+  using XStringArray_<XString8, XString8Array>::importID;
+
+  // Appends a copy of each view, duplicates included.
+  void import(const XArray<XString8View>& Views);
+  // Appends a copy of each view not already in the array. One hash set instead of a contains() per view.
+  void importID(const XArray<XString8View>& Views);
 };
 extern const XString8Array NullXString8Array;
 
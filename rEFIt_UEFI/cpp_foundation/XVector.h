@@ -0,0 +1,232 @@
+//*************************************************************************************************
+//*************************************************************************************************
+//
+//                                          XVector
+//
+// Objects stored by value, one after the other, like std::vector.
+// Unlike XArray, the objects are constructed, copied or moved and destroyed with their ctor/dtor.
+// Unlike XObjArray, there is no pointer per element, so a loop over the elements reads packed memory.
+// The price : adding or removing elements may move the others. Don't keep a pointer to an element
+// if the vector can change.
+//
+//*************************************************************************************************
+//*************************************************************************************************
+
+#if !defined(__XVECTOR_H__)
+#define __XVECTOR_H__
+
+#include <XToolsConf.h>
+#include "XToolsCommon.h"
+
+// There is no <new> in the UEFI build, so this is our own placement new. The tag avoids a clash with the standard one.
+struct XVectorPlacement {};
+inline void* operator new(size_t, void* p, XVectorPlacement) noexcept { return p; }
+inline void operator delete(void*, void*, XVectorPlacement) noexcept {}
+
+template<class TYPE>
+class XVector
+{
+  protected:
+	TYPE*  m_data;
+	size_t m_len;
+	size_t m_allocatedSize;
+
+	void Relocate(size_t nNewSize);
+
+  public:
+	XVector() : m_data(0), m_len(0), m_allocatedSize(0) { }
+	XVector(const XVector<TYPE> &aVector);
+	XVector(XVector<TYPE> &&aVector) : m_data(aVector.m_data), m_len(aVector.m_len), m_allocatedSize(aVector.m_allocatedSize) { aVector.m_data = 0; aVector.m_len = 0; aVector.m_allocatedSize = 0; }
+	const XVector<TYPE> &operator =(const XVector<TYPE> &aVector);
+	const XVector<TYPE> &operator =(XVector<TYPE> &&aVector);
+	virtual ~XVector();
+
+  public:
+	size_t allocatedSize() const { return m_allocatedSize; }
+	size_t size() const { return m_len; }
+	size_t length() const { return m_len; }
+
+	bool notEmpty() const { return size() > 0; }
+	bool isEmpty() const { return size() == 0; }
+
+	const TYPE *data() const { return m_data; }
+	TYPE *data() { return m_data; }
+
+	template<typename IntegralType, enable_if(is_integral(IntegralType))>
+	const TYPE &ElementAt(IntegralType nIndex) const
+	{
+		if (nIndex < 0) {
+			panic("XVector::ElementAt() : i < 0. System halted\n");
+		}
+		if ( (unsigned_type(IntegralType))nIndex >= m_len ) {
+			panic("XVector::ElementAt() const -> operator []  -  index (%zu) greater than length (%zu)\n", (size_t)nIndex, m_len);
+		}
+		return m_data[nIndex];
+	}
+
+	template<typename IntegralType, enable_if(is_integral(IntegralType))>
+	TYPE &ElementAt(IntegralType nIndex)
+	{
+		if (nIndex < 0) {
+			panic("XVector::ElementAt() : i < 0. System halted\n");
+		}
+		if ( (unsigned_type(IntegralType))nIndex >= m_len ) {
+			panic("XVector::ElementAt() -> operator []  -  index (%zu) greater than length (%zu)\n", (size_t)nIndex, m_len);
+		}
+		return m_data[nIndex];
+	}
+
+	template<typename IntegralType, enable_if(is_integral(IntegralType))>
+	const TYPE &operator[](IntegralType nIndex) const { return ElementAt(nIndex); }
+
+	template<typename IntegralType, enable_if(is_integral(IntegralType))>
+	TYPE &operator[](IntegralType nIndex) { return ElementAt(nIndex); }
+
+	void CheckSize(size_t nNewSize, size_t nGrowBy = XArrayGrowByDefault);
+	void reserve(size_t nNewSize) { CheckSize(nNewSize, 0); }
+	void shrink_to_fit();
+
+	size_t AddCopy(const TYPE &newElement);
+
+	// construct the new element from args, in place
+	template<typename... Args>
+	TYPE &emplace_back(Args&&... args)
+	{
+		CheckSize(m_len+1);
+		TYPE* newElement = new (&m_data[m_len], XVectorPlacement()) TYPE(static_cast<Args&&>(args)...);
+		m_len += 1;
+		return *newElement;
+	}
+
+	void RemoveAtIndex(size_t nIndex);
+	void setEmpty();
+};
+
+//xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx
+//
+//                                          XVector
+//
+//xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx
+
+/* Constructeur */
+template<class TYPE>
+XVector<TYPE>::XVector(const XVector<TYPE> &aVector) : m_data(0), m_len(0), m_allocatedSize(0)
+{
+	CheckSize(aVector.size(), 0);
+	for ( size_t ui=0 ; ui<aVector.size() ; ui+=1 ) AddCopy(aVector.ElementAt(ui));
+}
+
+/* operator = */
+template<class TYPE>
+const XVector<TYPE> &XVector<TYPE>::operator =(const XVector<TYPE> &aVector)
+{
+	if ( this == &aVector ) return *this; // self assignement
+	setEmpty();
+	CheckSize(aVector.size(), 0);
+	for ( size_t ui=0 ; ui<aVector.size() ; ui+=1 ) AddCopy(aVector.ElementAt(ui));
+	return *this;
+}
+
+/* move operator =, the memory is handed over, the objects don't move */
+template<class TYPE>
+const XVector<TYPE> &XVector<TYPE>::operator =(XVector<TYPE> &&aVector)
+{
+	if ( this == &aVector ) return *this; // self assignement
+	setEmpty();
+	if ( m_data ) free(m_data);
+	m_data = aVector.m_data;
+	m_len = aVector.m_len;
+	m_allocatedSize = aVector.m_allocatedSize;
+	aVector.m_data = 0;
+	aVector.m_len = 0;
+	aVector.m_allocatedSize = 0;
+	return *this;
+}
+
+/* Destructeur */
+template<class TYPE>
+XVector<TYPE>::~XVector()
+{
+	setEmpty();
+	if ( m_data ) free(m_data);
+}
+
+/* Relocate() : new memory for nNewSize objects. Objects are moved one by one, because they may point into themselves (XString small buffer) */
+template<class TYPE>
+void XVector<TYPE>::Relocate(size_t nNewSize)
+{
+	TYPE* newData = NULL;
+
+	if ( nNewSize > 0 ) {
+		newData = (TYPE *)malloc(nNewSize * sizeof(TYPE));
+		if ( !newData ) {
+			panic("XVector<TYPE>::Relocate(nNewSize=%zu) : malloc(%zu) returned NULL. System halted\n", nNewSize, nNewSize * sizeof(TYPE));
+		}
+	}
+	for ( size_t ui=0 ; ui<m_len ; ui+=1 ) {
+		new (&newData[ui], XVectorPlacement()) TYPE(static_cast<TYPE&&>(m_data[ui]));
+		m_data[ui].~TYPE();
+	}
+	if ( m_data ) free(m_data);
+	m_data = newData;
+	m_allocatedSize = nNewSize;
+}
+
+/* CheckSize()  // nNewSize is number of TYPE, not in bytes */
+template<class TYPE>
+void XVector<TYPE>::CheckSize(size_t nNewSize, size_t nGrowBy)
+{
+	if ( nNewSize > m_allocatedSize ) {
+		nNewSize += nGrowBy;
+		if ( nGrowBy != 0 && nNewSize < m_allocatedSize + m_allocatedSize / 2 ) nNewSize = m_allocatedSize + m_allocatedSize / 2; // geometric growth, Add is amortized O(1)
+		Relocate(nNewSize);
+	}
+}
+
+/* shrink_to_fit() */
+template<class TYPE>
+void XVector<TYPE>::shrink_to_fit()
+{
+	if ( m_len >= m_allocatedSize ) return;
+	Relocate(m_len);
+}
+
+/* AddCopy() */
+template<class TYPE>
+size_t XVector<TYPE>::AddCopy(const TYPE &newElement)
+{
+	if ( m_len >= m_allocatedSize  &&  &newElement >= m_data  &&  &newElement < m_data + m_len ) {
+		// newElement is one of ours, and will move
+		TYPE tmp(newElement);
+		emplace_back(static_cast<TYPE&&>(tmp));
+	}else{
+		emplace_back(newElement);
+	}
+	return m_len-1;
+}
+
+/* RemoveAtIndex() */
+template<class TYPE>
+void XVector<TYPE>::RemoveAtIndex(size_t nIndex)
+{
+	if ( nIndex >= m_len ) {
+		panic("void XVector<TYPE>::RemoveAtIndex(size_t nIndex) : BUG nIndex (%zu) is > length(). System halted\n", nIndex);
+	}
+	for ( size_t ui=nIndex ; ui+1<m_len ; ui+=1 ) {
+		m_data[ui] = static_cast<TYPE&&>(m_data[ui+1]);
+	}
+	m_len -= 1;
+	m_data[m_len].~TYPE();
+}
+
+/* setEmpty() */
+template<class TYPE>
+void XVector<TYPE>::setEmpty()
+{
+	while ( m_len > 0 ) {
+		m_len -= 1;
+		m_data[m_len].~TYPE();
+	}
+}
+
+#endif
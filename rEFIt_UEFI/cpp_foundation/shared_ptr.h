@@ -146,6 +146,143 @@ private:
   T* m_ptr;
 };
 
+// Intrusive reference count : the object carries its own count, so there is no Counter to allocate
+// next to it. Derive from RefCounted and create with make_intrusive<T>(args...), that's one allocation.
+// The count is not atomic : APs may use a shared object, but not copy or release an Intrusive_ptr.
+class RefCounted {
+  template <typename T> friend class Intrusive_ptr;
+
+public:
+  unsigned int use_count() const
+  {
+    return m_refCount;
+  }
+
+protected:
+  RefCounted()
+    : m_refCount(0){};
+
+  // a copy is another object, with its own count
+  RefCounted(const RefCounted&)
+    : m_refCount(0){};
+  RefCounted& operator=(const RefCounted&)
+  {
+    return *this;
+  }
+
+  ~RefCounted()
+  {
+  }
+
+private:
+  unsigned int m_refCount;
+};
+
+// Class representing a pointer to a RefCounted object
+template <typename T>
+class Intrusive_ptr {
+public:
+  Intrusive_ptr()
+    : m_ptr(nullptr){};
+
+  explicit Intrusive_ptr(T* ptr)
+    : m_ptr(ptr)
+  {
+    retain();
+  }
+
+  Intrusive_ptr(const Intrusive_ptr<T>& sp)
+    : m_ptr(sp.m_ptr)
+  {
+    retain();
+  }
+
+  Intrusive_ptr(Intrusive_ptr<T>&& sp)
+    : m_ptr(sp.m_ptr)
+  {
+    sp.m_ptr = nullptr;
+  }
+
+  ~Intrusive_ptr()
+  {
+    release();
+  }
+
+  Intrusive_ptr<T>& operator=(const Intrusive_ptr<T>& sp)
+  {
+    T* old = m_ptr;
+    m_ptr = sp.m_ptr;
+    retain(); // before releasing the old one, in case it's the same object
+    if (old && --static_cast<RefCounted*>(old)->m_refCount == 0) {
+      delete old;
+    }
+    return *this;
+  }
+
+  Intrusive_ptr<T>& operator=(Intrusive_ptr<T>&& sp)
+  {
+    if (this != &sp) {
+      release();
+      m_ptr = sp.m_ptr;
+      sp.m_ptr = nullptr;
+    }
+    return *this;
+  }
+
+  void reset()
+  {
+    release();
+    m_ptr = nullptr;
+  }
+
+  unsigned int use_count() const
+  {
+    return m_ptr ? static_cast<const RefCounted*>(m_ptr)->m_refCount : 0;
+  }
+
+  T* get() const
+  {
+    return m_ptr;
+  }
+
+  T& operator*() const {
+    return *m_ptr;
+  }
+
+  T* operator->() const {
+    return m_ptr;
+  }
+
+  explicit operator bool() const
+  {
+    return m_ptr != nullptr;
+  }
+
+private:
+  void retain()
+  {
+    if (m_ptr) {
+      ++static_cast<RefCounted*>(m_ptr)->m_refCount;
+    }
+  }
+
+  void release()
+  {
+    if (m_ptr && --static_cast<RefCounted*>(m_ptr)->m_refCount == 0) {
+      delete m_ptr;
+    }
+  }
+
+  T* m_ptr;
+};
+
+// make_shared-like : the object and its count in one allocation
+template <typename T, typename... Args>
+Intrusive_ptr<T> make_intrusive(Args&&... args)
+{
+  return Intrusive_ptr<T>(new T(static_cast<Args&&>(args)...));
+}
+
 //int main()
 //{
 //  // ptr1 pointing to an integer.
@@ -31,6 +31,57 @@ extern "C" {
 #endif
 
 
+/*
+ * ASCII fast path.
+ * Most strings we convert (paths, config keys, log lines) are plain ASCII. These scan 8 bytes per step and return how many
+ * leading chars are in 1..0x7F, so they stop at the terminator or at the first char that needs real decoding.
+ * Word reads are aligned : the word holding the terminator can't cross a page boundary. It may read a few bytes after
+ * the terminator, inside the same aligned word. That is harmless, but address sanitizer doesn't know it.
+ */
+typedef unsigned long long ascii_word_t;
+#if defined(__GNUC__) || defined(__clang__)
+  #define ASCII_SCAN_NO_SANITIZE __attribute__((no_sanitize_address))
+  typedef unsigned long long __attribute__((__may_alias__)) ascii_word_alias_t;
+#else
+  #define ASCII_SCAN_NO_SANITIZE
+  typedef unsigned long long ascii_word_alias_t;
+#endif
+
+ASCII_SCAN_NO_SANITIZE static size_t utf8_ascii_prefix_len(const char* s)
+{
+	const char* p = s;
+	while ( ((uintptr_t)p & (sizeof(ascii_word_t)-1)) != 0 ) {
+		if ( (unsigned char)*p - 1u >= 0x7Fu ) return (size_t)(p-s);
+		p++;
+	}
+	// A byte is flagged if it's 0 (the -1 borrows) or >= 0x80. A borrow only comes from a lower byte that is flagged anyway.
+	for ( ;; ) {
+		ascii_word_t w = *(const ascii_word_alias_t*)p;
+		if ( ((w - 0x0101010101010101ULL) | w) & 0x8080808080808080ULL ) break;
+		p += sizeof(ascii_word_t);
+	}
+	while ( (unsigned char)*p - 1u < 0x7Fu ) p++;
+	return (size_t)(p-s);
+}
+
+ASCII_SCAN_NO_SANITIZE static size_t utf16_ascii_prefix_len(const char16_t* s)
+{
+	const char16_t* p = s;
+	while ( ((uintptr_t)p & (sizeof(ascii_word_t)-1)) != 0 ) {
+		if ( (unsigned)*p - 1u >= 0x7Fu ) return (size_t)(p-s);
+		p++;
+	}
+	// Same as above, 4 char16_t per word. A unit is flagged if it's 0 or >= 0x80.
+	for ( ;; ) {
+		ascii_word_t w = *(const ascii_word_alias_t*)p;
+		if ( ((w - 0x0001000100010001ULL) | w) & 0xFF80FF80FF80FF80ULL ) break;
+		p += sizeof(ascii_word_t)/sizeof(char16_t);
+	}
+	while ( (unsigned)*p - 1u < 0x7Fu ) p++;
+	return (size_t)(p-s);
+}
+
+
 //
 //size_t char32_len_from_wchar(const wchar_t* s)
 //{
@@ -288,11 +339,12 @@ size_t utf32_size_of_utf8_string(const char* s)
 {
 	if ( !s ) return 0;
 	size_t size = 0;
-	char32_t char32;
-	s = get_char32_from_utf8_string(s, &char32);
+	char32_t char32 = 1;
 	while ( char32 ) {
-		size += 1;
-		s = get_char32_from_utf8_string(s, &char32);
+		size_t ascii = utf8_ascii_prefix_len(s);
+		size += ascii;
+		s = get_char32_from_utf8_string(s + ascii, &char32);
+		if ( char32 ) size += 1;
 	}
 	return size;
 }
@@ -500,7 +552,16 @@ size_t utf8_size_of_utf16_string(const char16_t* s)
 {
 	if ( !s ) return 0;
 	size_t size = 0;
-	while ( *s ) s = utf8_size_of_utf16_char_ptr(s, &size);
+	while ( *s ) {
+		size_t ascii = utf16_ascii_prefix_len(s);
+		size += ascii;
+		s += ascii;
+		if ( *s ) {
+			const char16_t* next = utf8_size_of_utf16_char_ptr(s, &size);
+			if ( next == s ) break; // lone low surrogate
+			s = next;
+		}
+	}
 	return size;
 }
 
@@ -524,11 +585,12 @@ size_t utf16_size_of_utf8_string(const char* s)
 	if ( !s ) return 0;
 	size_t size = 0;
 
-	char32_t char32;
-	s = get_char32_from_utf8_string(s, &char32);
+	char32_t char32 = 1;
 	while ( char32 ) {
-		size += utf16_size_of_utf32_char(char32);
-		s = get_char32_from_utf8_string(s, &char32);
+		size_t ascii = utf8_ascii_prefix_len(s);
+		size += ascii;
+		s = get_char32_from_utf8_string(s + ascii, &char32);
+		if ( char32 ) size += utf16_size_of_utf32_char(char32);
 	}
 	return size;
 }
@@ -550,6 +612,37 @@ size_t utf16_size_of_utf8_string_len(const char* s, size_t len)
 
 
 
+/*
+ * Convert until the end of s or until dst is full. *dst and *dst_max_size are updated.
+ * Return value : where the conversion stopped in s.
+ */
+static const char16_t* utf8_convert_from_utf16(char** dst, size_t* dst_max_size, const char16_t *s)
+{
+  char* p = *dst;
+  while ( *s  &&  *dst_max_size > 0 ) {
+    size_t ascii = utf16_ascii_prefix_len(s);
+    if ( ascii > *dst_max_size ) ascii = *dst_max_size;
+    for ( size_t i = 0 ; i < ascii ; i++ ) p[i] = (char)s[i];
+    p += ascii;
+    s += ascii;
+    *dst_max_size -= ascii;
+    if ( !*s  ||  *dst_max_size == 0 ) break;
+    char32_t utf32_char;
+    const char16_t* next = get_char32_from_utf16_string(s, &utf32_char);
+    if ( !utf32_char ) { // invalid surrogate, skipped like utf8_size_of_utf16_string does
+      if ( next == s ) break;
+      s = next;
+      continue;
+    }
+    char* pSav = p;
+    p = get_utf8_from_char32(p, dst_max_size, utf32_char);
+    if ( p == pSav ) break; // no room for this char
+    s = next;
+  }
+  *dst = p;
+  return s;
+}
+
 size_t utf8_stringnn_from_utf16_string(char* dst, size_t dst_max_size, const char16_t *s)
 {
   if ( dst_max_size <= 0 ) return 0;
@@ -557,11 +650,7 @@ size_t utf8_stringnn_from_utf16_string(char* dst, size_t dst_max_size, const cha
     return 0;
   }
   char* p = dst;
-  while ( *s  &&  dst_max_size > 0 ) {
-    char32_t utf32_char;
-    s = get_char32_from_utf16_string(s, &utf32_char);
-    p = get_utf8_from_char32(p, &dst_max_size, utf32_char);
-  }
+  utf8_convert_from_utf16(&p, &dst_max_size, s);
   return (size_t)(p-dst);
 }
 
@@ -578,6 +667,20 @@ size_t utf8_string_from_utf16_string(char* dst, size_t dst_max_size, const char1
   }
 }
 
+size_t utf8_string_from_utf16_string_measure(char* dst, size_t dst_max_size, const char16_t *s)
+{
+  if ( !s ) {
+    if ( dst_max_size > 0 ) *dst = 0;
+    return 0;
+  }
+  if ( dst_max_size <= 0 ) return utf8_size_of_utf16_string(s);
+  char* p = dst;
+  size_t room = dst_max_size - 1;
+  s = utf8_convert_from_utf16(&p, &room, s);
+  *p = 0;
+  return (size_t)(p-dst) + utf8_size_of_utf16_string(s);
+}
+
 //size_t utf8_string_from_utf16_string(char* dst, size_t dst_max_size, const char16_t *s)
 //{
 //  if ( dst_max_size <= 0 ) return 0;
@@ -616,24 +719,41 @@ size_t utf8_string_from_utf16_string_len(char* dst, size_t dst_max_size, const c
 }
 
 
+/*
+ * Convert until the end of s, an invalid sequence or until dst is full. *dst and *dst_max_size are updated.
+ * Return value : where the conversion stopped in s.
+ */
+static const char* utf16_convert_from_utf8(char16_t** dst, size_t* dst_max_size, const char* s)
+{
+	char16_t* p = *dst;
+	while ( *dst_max_size > 0 ) {
+		size_t ascii = utf8_ascii_prefix_len(s);
+		if ( ascii > *dst_max_size ) ascii = *dst_max_size;
+		for ( size_t i = 0 ; i < ascii ; i++ ) p[i] = (unsigned char)s[i];
+		p += ascii;
+		s += ascii;
+		*dst_max_size -= ascii;
+		if ( !*s  ||  *dst_max_size == 0 ) break;
+		char32_t char32;
+		const char* next = get_char32_from_utf8_string(s, &char32);
+		if ( !char32 ) break;
+		char16_t* pSav = p;
+		p = get_utf16_from_char32(p, dst_max_size, char32);
+		if ( p == pSav ) break; // no room for this char
+		s = next;
+	}
+	*dst = p;
+	return s;
+}
+
 size_t utf16_stringnn_from_utf8_string(char16_t* dst, size_t dst_max_size, const char* s)
 {
 	if ( dst_max_size <= 0 ) return 0;
 	if ( !s ) {
 		return 0;
 	}
-
-//	size_t dst_len = 0;
 	char16_t* p = dst;
-//	char16_t* p_max = dst + dst_max_size;
-
-	char32_t char32;
-	s = get_char32_from_utf8_string(s, &char32);
-	while ( char32 ) {
-		p = get_utf16_from_char32(p, &dst_max_size, char32);
-    if ( dst_max_size == 0 ) break;
-		s = get_char32_from_utf8_string(s, &char32);
-	}
+	utf16_convert_from_utf8(&p, &dst_max_size, s);
 	return (size_t)(p-dst);
 }
 
@@ -650,6 +770,20 @@ size_t utf16_string_from_utf8_string(char16_t* dst, size_t dst_max_size, const c
   }
 }
 
+size_t utf16_string_from_utf8_string_measure(char16_t* dst, size_t dst_max_size, const char* s)
+{
+  if ( !s ) {
+    if ( dst_max_size > 0 ) *dst = 0;
+    return 0;
+  }
+  if ( dst_max_size <= 0 ) return utf16_size_of_utf8_string(s);
+  char16_t* p = dst;
+  size_t room = dst_max_size - 1;
+  s = utf16_convert_from_utf8(&p, &room, s);
+  *p = 0;
+  return (size_t)(p-dst) + utf16_size_of_utf8_string(s);
+}
+
 //size_t utf16_string_from_utf8_string(char16_t* dst, size_t dst_max_size, const char* s)
 //{
 //  if ( dst_max_size <= 0 ) return 0;
@@ -1250,7 +1384,7 @@ size_t utf8_size_of_utf8_string(const char* s)
 	char32_t char32 = 1;
 	const char* p = s; // = get_char32_from_utf8_string(s, &char32);
 	while ( char32 ) {
-		p = get_char32_from_utf8_string(p, &char32);
+		p = get_char32_from_utf8_string(p + utf8_ascii_prefix_len(p), &char32);
 	}
 	return (uintptr_t)p - (uintptr_t)s;
 //
@@ -1277,7 +1411,7 @@ size_t utf16_size_of_utf16_string(const char16_t* s)
 	char32_t char32 = 1;
 	const char16_t* p = s; // = get_char32_from_utf8_string(s, &char32);
 	while ( char32 ) {
-		p = get_char32_from_utf16_string(p, &char32);
+		p = get_char32_from_utf16_string(p + utf16_ascii_prefix_len(p), &char32);
 	}
 	return (size_t)(p-s);// p-s is in number of char32_t, not bytes. Careful, uintptr_t(p)-uintptr_t(s) would be in bytes
 //	const char16_t* p = s;
@@ -1333,18 +1467,40 @@ size_t wchar_size_of_wchar_string_len(const wchar_t* s, size_t len)
 
 
 
+/*
+ * Copy until the end of s, an invalid sequence or until dst is full. *dst and *dst_max_size are updated.
+ * ASCII runs are copied with memcpy, the rest is checked char by char.
+ * Return value : where the copy stopped in s.
+ */
+static const char* utf8_copy_from_utf8(char** dst, size_t* dst_max_size, const char *s)
+{
+  char* p = *dst;
+  while ( *dst_max_size > 0 ) {
+    size_t ascii = utf8_ascii_prefix_len(s);
+    if ( ascii > *dst_max_size ) ascii = *dst_max_size;
+    memcpy(p, s, ascii);
+    p += ascii;
+    s += ascii;
+    *dst_max_size -= ascii;
+    if ( !*s  ||  *dst_max_size == 0 ) break;
+    char32_t char32;
+    const char* next = get_char32_from_utf8_string(s, &char32);
+    if ( !char32 ) break;
+    char* pSav = p;
+    p = get_utf8_from_char32(p, dst_max_size, char32);
+    if ( p == pSav ) break; // no room for this char
+    s = next;
+  }
+  *dst = p;
+  return s;
+}
+
 size_t utf8_stringnn_from_utf8_string(char* dst, size_t dst_max_size, const char *s)
 {
   if ( !s  ||  dst_max_size <= 0 ) return 0;
 
   char* p = dst;
-  char32_t char32;
-  s = get_char32_from_utf8_string(s, &char32);
-  while ( char32 ) {
-    p = get_utf8_from_char32(p, &dst_max_size, char32);
-    if ( dst_max_size <= 0 ) break;
-    s = get_char32_from_utf8_string(s, &char32);
-  }
+  utf8_copy_from_utf8(&p, &dst_max_size, s);
   return (uintptr_t)p - (uintptr_t)dst;
 }
 
@@ -1360,6 +1516,20 @@ size_t utf8_string_from_utf8_string(char* dst, size_t dst_max_size, const char *
     return size;
   }
 }
+
+size_t utf8_string_from_utf8_string_measure(char* dst, size_t dst_max_size, const char *s)
+{
+  if ( !s ) {
+    if ( dst_max_size > 0 ) *dst = 0;
+    return 0;
+  }
+  if ( dst_max_size <= 0 ) return utf8_size_of_utf8_string(s);
+  char* p = dst;
+  size_t room = dst_max_size - 1;
+  s = utf8_copy_from_utf8(&p, &room, s);
+  *p = 0;
+  return (uintptr_t)p - (uintptr_t)dst + utf8_size_of_utf8_string(s);
+}
 //
 //size_t utf8_string_from_utf8_string(char* dst, size_t dst_max_size, const char *s)
 //{
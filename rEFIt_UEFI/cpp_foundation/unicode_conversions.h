@@ -146,6 +146,12 @@ size_t utf8_string_from_utf16_string_len(char* dst, size_t dst_max_size, const c
 size_t utf16_stringnn_from_utf8_string(char16_t* dst, size_t dst_max_size, const char* s);
 size_t utf16_string_from_utf8_string(char16_t* dst, size_t dst_max_size, const char* s);
 size_t utf16_string_from_utf8_string_len(char16_t* dst, size_t dst_max_size, const char* s, size_t len);
+/*
+ * Convert and measure in one walk : convert what fits in dst (always terminated) and return the size the whole conversion needs, terminator not included.
+ * If the return value is < dst_max_size, dst holds the whole string.
+ */
+size_t utf8_string_from_utf16_string_measure(char* dst, size_t dst_max_size, const char16_t *s);
+size_t utf16_string_from_utf8_string_measure(char16_t* dst, size_t dst_max_size, const char* s);
 
 
 /******   utf16 - utf32   *****/
@@ -235,6 +241,7 @@ size_t wchar_size_of_wchar_string_len(const wchar_t* s, size_t len);
 size_t utf8_stringnn_from_utf8_string(char* dst, size_t dst_max_size, const char *s);
 size_t utf8_string_from_utf8_string(char* dst, size_t dst_max_size, const char *s);
 size_t utf8_string_from_utf8_string_len(char* dst, size_t dst_max_size, const char *s, size_t len);
+size_t utf8_string_from_utf8_string_measure(char* dst, size_t dst_max_size, const char *s);
 size_t utf16_stringnn_from_utf16_string(char16_t* dst, size_t dst_max_size, const char16_t *s);
 size_t utf16_string_from_utf16_string(char16_t* dst, size_t dst_max_size, const char16_t *s);
 size_t utf16_string_from_utf16_string_len(char16_t* dst, size_t dst_max_size, const char16_t *s, size_t len);
@@ -376,6 +383,25 @@ inline size_t utf_string_from_utf_string(char32_t* dst, size_t dst_max_size, con
 inline size_t utf_string_from_utf_string(wchar_t* dst, size_t dst_max_size, const wchar_t *s) { return utf_string_from_utf_string(dst, dst_max_size, (wchar_cast*)s); }
 
 
+/*
+ * Convert and measure in one walk. Return the size the whole conversion needs, terminator not included.
+ * If the return value is < dst_max_size, dst holds the whole string. Otherwise, dst content is undefined.
+ */
+template<typename T, typename O>
+inline size_t utf_string_from_utf_string_measure(T* dst, size_t dst_max_size, const O* s)
+{
+  // no single walk version for this pair, measure then convert
+  size_t size = utf_size_of_utf_string(dst, s);
+  if ( size < dst_max_size ) utf_string_from_utf_string(dst, dst_max_size, s);
+  return size;
+}
+inline size_t utf_string_from_utf_string_measure(char* dst, size_t dst_max_size, const char* s) { return utf8_string_from_utf8_string_measure(dst, dst_max_size, s); }
+inline size_t utf_string_from_utf_string_measure(char16_t* dst, size_t dst_max_size, const char* s) { return utf16_string_from_utf8_string_measure(dst, dst_max_size, s); }
+inline size_t utf_string_from_utf_string_measure(char* dst, size_t dst_max_size, const char16_t *s) { return utf8_string_from_utf16_string_measure(dst, dst_max_size, s); }
+inline size_t utf_string_from_utf_string_measure(wchar_t* dst, size_t dst_max_size, const char* s) { return utf_string_from_utf_string_measure((wchar_cast*)dst, dst_max_size, s); }
+inline size_t utf_string_from_utf_string_measure(char* dst, size_t dst_max_size, const wchar_t *s) { return utf_string_from_utf_string_measure(dst, dst_max_size, (wchar_cast*)s); }
+
+
 
 inline size_t utf_stringnn_from_utf_string(char* dst, size_t dst_max_size, const char* s) { return utf8_stringnn_from_utf8_string(dst, dst_max_size, s); }
 inline size_t utf_stringnn_from_utf_string(char16_t* dst, size_t dst_max_size, const char* s) { return utf16_stringnn_from_utf8_string(dst, dst_max_size, s); }
@@ -0,0 +1,46 @@
+#include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+#include "../Platform/AcpiDumpSet.h"
+
+static int breakpoint(int i)
+{
+  return i;
+}
+
+int AcpiDumpSet_tests()
+{
+  UINT8       Tables[400][16];
+  AcpiDumpSet Set;
+  UINT32      i;
+
+  SetMem(Tables, sizeof(Tables), 0);
+  for (i = 0; i < 400; i++) {
+    Tables[i][0] = (UINT8)i;
+    Tables[i][1] = (UINT8)(i >> 8);
+  }
+  Tables[3][0] = 7; // same bytes as Tables[7]
+
+  // more tables than slots, the chains are used
+  for (i = 0; i < 300; i++) {
+    if ( i != 3 ) Set.Add(Tables[i], 16, i);
+  }
+  if ( Set.size() != 299 ) return breakpoint(1);
+  if ( !Set.IsSaved(Tables[0]) ) return breakpoint(2);
+  if ( !Set.IsSaved(Tables[299]) ) return breakpoint(3);
+  if ( Set.IsSaved(Tables[3]) ) return breakpoint(4);
+  if ( Set.IsSaved(Tables[300]) ) return breakpoint(5);
+
+  // found by content, and only if the bytes are the same
+  if ( Set.FindSame(Tables[3], 16, 7) != Tables[7] ) return breakpoint(6);
+  if ( Set.FindSame(Tables[3], 16, 8) != NULL ) return breakpoint(7);
+  if ( Set.FindSame(Tables[300], 16, 8) != NULL ) return breakpoint(8);
+  if ( Set.FindSame(Tables[3], 15, 7) != NULL ) return breakpoint(9);
+
+  // same address twice is one table
+  Set.Add(Tables[7], 16, 7);
+  if ( Set.size() != 299 ) return breakpoint(10);
+
+  Set.Reset();
+  if ( Set.size() != 0 || Set.IsSaved(Tables[0]) ) return breakpoint(11);
+  if ( Set.FindSame(Tables[3], 16, 7) != NULL ) return breakpoint(12);
+  return 0;
+}
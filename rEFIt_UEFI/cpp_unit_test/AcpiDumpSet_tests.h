@@ -0,0 +1 @@
+int AcpiDumpSet_tests();
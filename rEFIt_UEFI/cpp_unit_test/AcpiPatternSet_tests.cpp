@@ -0,0 +1,43 @@
+#include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+#include "../Platform/AcpiPatternSet.h"
+
+static int breakpoint(int i)
+{
+  return i;
+}
+
+int AcpiPatternSet_tests()
+{
+  UINT8 Table[] = "HEADER_ABCD_EFGH_ABCDABCD_ABABAB";
+  CONST UINT8 Patched[] = "HEADER_WXYZ_IJKL_WXYZWXYZ_ABABAB";
+  UINT32 Hits[2];
+  UINT32 First[2];
+  XArray<ACPI_PATTERN_HIT> Found;
+  AcpiPatternSet Set;
+
+  // a pattern meeting another one, or the result of another one, is refused
+  if ( !Set.Add((const UINT8*)"ABCD", (const UINT8*)"WXYZ", 4) ) return breakpoint(1);
+  if ( Set.IsIndependent((const UINT8*)"CDEF", (const UINT8*)"0000", 4) ) return breakpoint(2);
+  if ( Set.IsIndependent((const UINT8*)"YZ", (const UINT8*)"00", 2) ) return breakpoint(3);
+  if ( !Set.IsIndependent((const UINT8*)"EFGH", (const UINT8*)"IJKL", 4) ) return breakpoint(4);
+  if ( !Set.Add((const UINT8*)"EFGH", (const UINT8*)"IJKL", 4) ) return breakpoint(5);
+  if ( !Set.Build() ) return breakpoint(6);
+
+  // all the hits of both patterns in one scan, the header is skipped
+  Set.ReplaceAll(Table, 7, sizeof(Table) - 1, Hits, First);
+  if ( Hits[0] != 3 || First[0] != 7 ) return breakpoint(10);
+  if ( Hits[1] != 1 || First[1] != 12 ) return breakpoint(11);
+  if ( CompareMem(Table, Patched, sizeof(Patched)) != 0 ) return breakpoint(12);
+
+  // FindAll gives the overlapping hits too
+  Set.Reset();
+  if ( !Set.Add((const UINT8*)"ABAB", NULL, 4) ) return breakpoint(20);
+  if ( !Set.Add((const UINT8*)"BA", NULL, 2) ) return breakpoint(21);
+  if ( !Set.Build() ) return breakpoint(22);
+  Set.FindAll(Table, 0, sizeof(Table) - 1, Found);
+  if ( Found.size() != 4 ) return breakpoint(23);
+  if ( Found.ElementAt(0).Pattern != 1 || Found.ElementAt(0).Pos != 27 ) return breakpoint(24);
+  if ( Found.ElementAt(1).Pattern != 0 || Found.ElementAt(1).Pos != 26 ) return breakpoint(25);
+
+  return 0;
+}
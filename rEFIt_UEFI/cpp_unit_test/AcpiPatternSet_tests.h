@@ -0,0 +1 @@
+int AcpiPatternSet_tests();
@@ -0,0 +1,77 @@
+#include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+#include "../Platform/AmlTree.h"
+
+static int breakpoint(int i)
+{
+  return i;
+}
+
+// Scope (\_SB) {
+//   Device (PCI0) {
+//     Name (_ADR, Zero)
+//     Method (_STA, 0) { If (One) { Return (0x0F) } Else { Return (Zero) } }
+//   }
+//   Device (LPT_) { Name (_HID, One) }
+// }
+static UINT8 Dsdt[] = {
+  0x44, 0x53, 0x44, 0x54, 0x56, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x10, 0x31, 0x5C, 0x5F, 0x53, 0x42, 0x5F, 0x5B, 0x82, 0x1C, 0x50, 0x43,
+  0x49, 0x30, 0x08, 0x5F, 0x41, 0x44, 0x52, 0x00, 0x14, 0x10, 0x5F, 0x53, 0x54, 0x41, 0x00, 0xA0,
+  0x05, 0x01, 0xA4, 0x0A, 0x0F, 0xA1, 0x03, 0xA4, 0x00, 0x5B, 0x82, 0x0B, 0x4C, 0x50, 0x54, 0x5F,
+  0x08, 0x5F, 0x48, 0x49, 0x44, 0x01,
+};
+
+// Return ("Return long value") instead of Return (0x0F), PkgLength of the Scope becomes 2 bytes
+static UINT8 DsdtGrown[] = {
+  0x44, 0x53, 0x44, 0x54, 0x68, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x10, 0x43, 0x04, 0x5C, 0x5F, 0x53, 0x42, 0x5F, 0x5B, 0x82, 0x2D, 0x50,
+  0x43, 0x49, 0x30, 0x08, 0x5F, 0x41, 0x44, 0x52, 0x00, 0x14, 0x21, 0x5F, 0x53, 0x54, 0x41, 0x00,
+  0xA0, 0x16, 0x01, 0xA4, 0x0D, 0x52, 0x65, 0x74, 0x75, 0x72, 0x6E, 0x20, 0x6C, 0x6F, 0x6E, 0x67,
+  0x20, 0x76, 0x61, 0x6C, 0x75, 0x65, 0x00, 0xA1, 0x03, 0xA4, 0x00, 0x5B, 0x82, 0x0B, 0x4C, 0x50,
+  0x54, 0x5F, 0x08, 0x5F, 0x48, 0x49, 0x44, 0x01,
+};
+
+// without Device (LPT_)
+static UINT8 DsdtNoLpt[] = {
+  0x44, 0x53, 0x44, 0x54, 0x49, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x10, 0x24, 0x5C, 0x5F, 0x53, 0x42, 0x5F, 0x5B, 0x82, 0x1C, 0x50, 0x43,
+  0x49, 0x30, 0x08, 0x5F, 0x41, 0x44, 0x52, 0x00, 0x14, 0x10, 0x5F, 0x53, 0x54, 0x41, 0x00, 0xA0,
+  0x05, 0x01, 0xA4, 0x0A, 0x0F, 0xA1, 0x03, 0xA4, 0x00,
+};
+
+static CONST UINT8 ReturnString[] = { 0xA4, 0x0D, 'R', 'e', 't', 'u', 'r', 'n', ' ', 'l', 'o', 'n', 'g', ' ', 'v', 'a', 'l', 'u', 'e', 0x00 };
+
+int AmlTree_tests()
+{
+  UINT8   Out[sizeof(DsdtGrown)];
+  AmlTree Tree;
+
+  // root, Scope, PCI0, Method, If, Else, LPT_
+  if ( !Tree.Parse(Dsdt, sizeof(Dsdt)) ) return breakpoint(1);
+  if ( Tree.GetObjectCount() != 7 ) return breakpoint(2);
+  if ( Tree.GetObject(4).Opcode != 0xA0 || Tree.GetObject(4).Parent != 3 ) return breakpoint(3);
+
+  // the lengths of If, Method, Device and Scope follow the patch
+  if ( !Tree.AddEdit(66, 3, ReturnString, sizeof(ReturnString)) ) return breakpoint(10);
+  if ( Tree.GetNewLength() != sizeof(DsdtGrown) ) return breakpoint(11);
+  if ( Tree.Write(Out) != sizeof(DsdtGrown) ) return breakpoint(12);
+  if ( CompareMem(Out, DsdtGrown, sizeof(DsdtGrown)) != 0 ) return breakpoint(13);
+
+  // removing a whole device
+  Tree.Parse(Dsdt, sizeof(Dsdt));
+  if ( !Tree.AddEdit(73, 13, NULL, 0) ) return breakpoint(20);
+  if ( Tree.Write(Out) != sizeof(DsdtNoLpt) ) return breakpoint(21);
+  if ( CompareMem(Out, DsdtNoLpt, sizeof(DsdtNoLpt)) != 0 ) return breakpoint(22);
+
+  // an edit cutting the header of Device (PCI0) is refused, so is an edit overlapping the previous one
+  Tree.Parse(Dsdt, sizeof(Dsdt));
+  if ( Tree.AddEdit(44, 3, ReturnString, 2) ) return breakpoint(30);
+  if ( !Tree.AddEdit(66, 3, ReturnString, 2) ) return breakpoint(31);
+  if ( Tree.AddEdit(67, 1, ReturnString, 2) ) return breakpoint(32);
+  if ( Tree.GetEditCount() != 1 ) return breakpoint(33);
+
+  return 0;
+}
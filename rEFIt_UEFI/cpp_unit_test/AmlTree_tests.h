@@ -0,0 +1 @@
+int AmlTree_tests();
@@ -0,0 +1,65 @@
+#include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+#include "../Platform/b64cdecode.h"
+
+static int breakpoint(int i)
+{
+  return i;
+}
+
+static const char Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Base64DecodeClover() against libb64, whatever the whitespace and padding, with and without SSSE3
+static int Compare(const char* Encoded, UINTN Length)
+{
+  static char Reference[300];
+  base64_decodestate State;
+  long    ReferenceSize;
+  UINT8*  Decoded;
+  UINTN   DecodedSize;
+
+  base64_init_decodestate(&State);
+  ReferenceSize = base64_decode_block(Encoded, (int)Length, Reference, &State);
+  Decoded = Base64DecodeClover(Encoded, &DecodedSize);
+  if ( ReferenceSize == 0 ) return Decoded == NULL && DecodedSize == 0 ? 0 : 1;
+  if ( Decoded == NULL || DecodedSize != (UINTN)ReferenceSize ) return 1;
+  if ( CompareMem(Decoded, Reference, DecodedSize) != 0 ) { FreePool(Decoded); return 1; }
+  FreePool(Decoded);
+  return 0;
+}
+
+int Base64_tests()
+{
+  static char Encoded[257];
+  BOOLEAN Simd = Base64GetSimd();
+  UINTN   Length, i, Pass;
+  UINT32  Seed = 1;
+  UINTN   DecodedSize;
+  UINT8*  Decoded;
+
+  Decoded = Base64DecodeClover("TWFu", &DecodedSize);
+  if ( Decoded == NULL || DecodedSize != 3 || CompareMem(Decoded, "Man", 3) != 0 ) return breakpoint(1);
+  FreePool(Decoded);
+  Decoded = Base64DecodeClover("\n\tTW\nE=\n", &DecodedSize);
+  if ( Decoded == NULL || DecodedSize != 2 || CompareMem(Decoded, "Ma", 2) != 0 ) return breakpoint(2);
+  FreePool(Decoded);
+  if ( Base64DecodeClover(" \n=", &DecodedSize) != NULL || DecodedSize != 0 ) return breakpoint(3);
+
+  for (Pass = 0; Pass < 2000; Pass++) {
+    Length = Pass % 257;
+    for (i = 0; i < Length; i++) {
+      Seed = Seed * 1103515245U + 12345U;
+      // whitespace or padding in half of the passes, to mix the scalar and the SSSE3 blocks
+      if ( (Pass & 1) && ((Seed >> 16) % 23) == 0 ) {
+        Encoded[i] = "\n\t =\r"[(Seed >> 8) % 5];
+      } else {
+        Encoded[i] = Alphabet[(Seed >> 16) % 64];
+      }
+    }
+    Encoded[Length] = '\0';
+    Base64SetSimd(FALSE);
+    if ( Compare(Encoded, Length) != 0 ) return breakpoint(10);
+    Base64SetSimd(Simd);
+    if ( Compare(Encoded, Length) != 0 ) return breakpoint(11);
+  }
+  return 0;
+}
@@ -0,0 +1 @@
+int Base64_tests();
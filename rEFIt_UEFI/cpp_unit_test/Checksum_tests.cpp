@@ -0,0 +1,87 @@
+#include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+#include "../Platform/Checksum.h"
+
+static int breakpoint(int i)
+{
+  return i;
+}
+
+static UINT8 ByteSum(const UINT8* Buffer, UINTN Length)
+{
+  UINT8 Sum = 0;
+  while (Length--) Sum += *Buffer++;
+  return Sum;
+}
+
+static UINT32 BitwiseCrc32(const UINT8* Buffer, UINTN Length)
+{
+  UINT32 Crc = 0xFFFFFFFFU;
+  UINTN  i;
+
+  while (Length--) {
+    Crc ^= *Buffer++;
+    for (i = 0; i < 8; i++) {
+      Crc = (Crc >> 1) ^ ((Crc & 1) ? 0xEDB88320U : 0);
+    }
+  }
+  return ~Crc;
+}
+
+static UINT32 ModuloAdler32(const UINT8* Buffer, UINTN Length)
+{
+  UINT32 S1 = 1, S2 = 0;
+
+  while (Length--) {
+    S1 = (S1 + *Buffer++) % 65521;
+    S2 = (S2 + S1) % 65521;
+  }
+  return (S2 << 16) | S1;
+}
+
+// with and without SSSE3, in one call and in two parts
+static int CompareAdler32(const UINT8* Buffer, UINTN Length)
+{
+  BOOLEAN Simd = Adler32GetSimd();
+  UINT32  Expected = ModuloAdler32(Buffer, Length);
+  int     ret = 0;
+
+  Adler32SetSimd(FALSE);
+  if ( Adler32(1, Buffer, Length) != Expected ) ret = 1;
+  Adler32SetSimd(Simd);
+  if ( Adler32(1, Buffer, Length) != Expected ) ret = 1;
+  if ( Adler32(Adler32(1, Buffer, Length / 3), Buffer + Length / 3, Length - Length / 3) != Expected ) ret = 1;
+  return ret;
+}
+
+int Checksum_tests()
+{
+  static UINT8 Buffer[12000];
+  UINTN Offset, Length;
+  UINT32 Seed = 1;
+
+  for (Length = 0; Length < sizeof(Buffer); Length++) {
+    Seed = Seed * 1103515245U + 12345U;
+    Buffer[Length] = (UINT8)(Seed >> 16);
+  }
+
+  if ( GetCrc32("123456789", 9) != 0xCBF43926 ) return breakpoint(1);
+  if ( GetCrc32(Buffer, 0) != 0 ) return breakpoint(2);
+  if ( GetCrc32(NULL, 10) != 0 ) return breakpoint(3);
+  if ( Checksum8(Buffer, 0) != 0 ) return breakpoint(4);
+  if ( Adler32(1, "Wikipedia", 9) != 0x11E60398 ) return breakpoint(5);
+  if ( Adler32(1, Buffer, 0) != 1 ) return breakpoint(6);
+
+  // all alignments, the tails and more than 256 words for the lanes of Checksum8
+  for (Offset = 0; Offset < 8; Offset++) {
+    for (Length = 0; Length + Offset <= sizeof(Buffer); Length += (Length < 40) ? 1 : 97) {
+      if ( Checksum8(Buffer + Offset, Length) != ByteSum(Buffer + Offset, Length) ) return breakpoint(10);
+      if ( GetCrc32(Buffer + Offset, Length) != BitwiseCrc32(Buffer + Offset, Length) ) return breakpoint(11);
+      if ( CompareAdler32(Buffer + Offset, Length) != 0 ) return breakpoint(13);
+    }
+  }
+  SetMem(Buffer, sizeof(Buffer), 0xFF);
+  if ( Checksum8(Buffer, sizeof(Buffer)) != ByteSum(Buffer, sizeof(Buffer)) ) return breakpoint(12);
+  // the largest sums, over more than one modulo period
+  if ( CompareAdler32(Buffer, sizeof(Buffer)) != 0 ) return breakpoint(14);
+  return 0;
+}
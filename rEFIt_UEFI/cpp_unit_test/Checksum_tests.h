@@ -0,0 +1 @@
+int Checksum_tests();
@@ -0,0 +1,54 @@
+#include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+
+extern "C" {
+#include <Library/CppMemLib.h>
+}
+
+static int breakpoint(int i)
+{
+  return i;
+}
+
+int CppMemLib_tests()
+{
+  UINT8   *Small[64];
+  UINT8   *Block;
+  UINT8   *Large;
+  UINTN   i;
+
+  // blocks of a class are aligned and don't overlap
+  for (i = 0; i < 64; i++) {
+    Small[i] = (UINT8 *)CppMemAllocate(40);
+    if (Small[i] == NULL || ((UINTN)Small[i] & 15) != 0 || !CppMemIsSmall(Small[i])) return breakpoint(1);
+    SetMem(Small[i], 40, (UINT8)i);
+  }
+  for (i = 0; i < 64; i++) {
+    if (Small[i][0] != (UINT8)i || Small[i][39] != (UINT8)i) return breakpoint(2);
+  }
+
+  // a freed block is reused first
+  Block = Small[10];
+  CppMemFree(Block);
+  if ((UINT8 *)CppMemAllocate(33) != Block) return breakpoint(3);
+  for (i = 0; i < 64; i++) {
+    CppMemFree(Small[i]);
+  }
+
+  // zero byte and class limit
+  Block = (UINT8 *)CppMemAllocate(0);
+  if (Block == NULL || !CppMemIsSmall(Block)) return breakpoint(4);
+  CppMemFree(Block);
+  Block = (UINT8 *)CppMemAllocate(CPP_MEM_MAX_SMALL);
+  if (Block == NULL || !CppMemIsSmall(Block)) return breakpoint(5);
+  SetMem(Block, CPP_MEM_MAX_SMALL, 0xA5);
+  CppMemFree(Block);
+
+  // too big for a class
+  Large = (UINT8 *)CppMemAllocate(CPP_MEM_MAX_SMALL + 1);
+  if (Large == NULL || CppMemIsSmall(Large)) return breakpoint(6);
+  CppMemFree(Large);
+  CppMemFree(NULL);
+  if (CppMemIsSmall(NULL)) return breakpoint(7);
+
+  return 0;
+}
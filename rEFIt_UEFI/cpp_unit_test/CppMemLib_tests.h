@@ -0,0 +1 @@
+int CppMemLib_tests();
@@ -0,0 +1,48 @@
+#include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+#include "../Platform/DsdtIndex.h"
+
+static int breakpoint(int i)
+{
+  return i;
+}
+
+// Device (PCI0) { Name (_ADR, Zero) Method (_STA, 0) { Return (0x0F) } }
+static CONST UINT8 Aml[] = {
+  0x5B, 0x82, 0x15, 0x50, 0x43, 0x49, 0x30, 0x08, 0x5F, 0x41, 0x44, 0x52, 0x00,
+  0x14, 0x08, 0x5F, 0x53, 0x54, 0x41, 0x00, 0xA4, 0x0A, 0x0F,
+};
+
+// Name (_HID, EisaId ("PNP0A08"))
+static CONST UINT8 Hid[] = { 0x08, 0x5F, 0x48, 0x49, 0x44, 0x0C, 0x41, 0xD0, 0x0A, 0x08 };
+
+int DsdtIndex_tests()
+{
+  UINT8     Table[64];
+  UINT32    Len = sizeof(Aml);
+  DsdtIndex Index;
+
+  CopyMem(Table, Aml, sizeof(Aml));
+  Index.Build(Table, Len);
+  if ( Index.First(DsdtIndexDevice, Table, 0) != 1 ) return breakpoint(1);
+  if ( Index.First(DsdtIndexAdr, Table, 0) != 7 ) return breakpoint(2);
+  if ( Index.First(DsdtIndexMethod, Table, 8) != 13 ) return breakpoint(3);
+  if ( Index.First(DsdtIndexHid, Table, 0) != Len ) return breakpoint(4);
+  if ( Index.Last(DsdtIndexDevice, Table, 13) != 1 ) return breakpoint(5);
+
+  // insert Name (_HID) before Name (_ADR), the way the fixes do it with move_data
+  CopyMem(Table + 7 + sizeof(Hid), Table + 7, Len - 7);
+  Index.Moved(7, sizeof(Hid));
+  CopyMem(Table + 7, Hid, sizeof(Hid));
+  Len += sizeof(Hid);
+  if ( Index.First(DsdtIndexHid, Table, 0) != 7 ) return breakpoint(10);
+  if ( Index.First(DsdtIndexAdr, Table, 0) != 17 ) return breakpoint(11);
+  if ( Index.First(DsdtIndexMethod, Table, 0) != 23 ) return breakpoint(12);
+
+  // a part of the table: positions are relative to it
+  if ( Index.First(DsdtIndexMethod, Table + 17, 0) != 6 ) return breakpoint(20);
+
+  // outside of the indexed table every position is a candidate
+  if ( Index.First(DsdtIndexAdr, Aml, 3) != 3 ) return breakpoint(30);
+
+  return 0;
+}
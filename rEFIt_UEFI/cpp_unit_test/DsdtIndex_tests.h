@@ -0,0 +1 @@
+int DsdtIndex_tests();
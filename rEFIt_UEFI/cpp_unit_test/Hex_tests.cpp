@@ -0,0 +1,42 @@
+#include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+#include "../Platform/MemoryOperation.h"
+
+static int breakpoint(int i)
+{
+  return i;
+}
+
+int Hex_tests()
+{
+  static UINT8 Buffer[100];
+  static UINT8 Back[100];
+  static CHAR8 Reference[sizeof(Buffer) * 2 + 1];
+  static CHAR8 Hex[sizeof(Buffer) * 2 + 1];
+  BOOLEAN Simd = MemoryOperationGetSimd();
+  UINTN   Length, Upper;
+  UINT32  Seed = 1;
+
+  BytesToHex((const UINT8*)"\x01\xAB\xff", 3, Hex, FALSE);
+  if ( strcmp(Hex, "01abff") != 0 ) return breakpoint(1);
+  if ( Bytes2HexStr((UINT8*)"\x01\xAB\xff", 3) != "01abff"_XS8 ) return breakpoint(2);
+  if ( hex2bin("01, AB ff", Back, 3) != 3 || CompareMem(Back, "\x01\xAB\xff", 3) != 0 ) return breakpoint(3);
+  if ( hex2bin("0g", Back, 1) != 0 ) return breakpoint(4);
+  if ( hexstrtouint8("f") != 0x0f || hexstrtouint8("Ff") != 0xff ) return breakpoint(5);
+
+  // SSE2 encode, if enabled, gives the digits of the table, for any length
+  for (Length = 0; Length < sizeof(Buffer); Length++) {
+    Seed = Seed * 1103515245U + 12345U;
+    Buffer[Length] = (UINT8)(Seed >> 16);
+  }
+  for (Length = 0; Length <= sizeof(Buffer); Length++) {
+    for (Upper = 0; Upper < 2; Upper++) {
+      MemoryOperationSetSimd(FALSE);
+      BytesToHex(Buffer, Length, Reference, Upper != 0);
+      MemoryOperationSetSimd(Simd);
+      BytesToHex(Buffer, Length, Hex, Upper != 0);
+      if ( strcmp(Hex, Reference) != 0 ) return breakpoint(10);
+      if ( Length > 0 && (hex2bin(Hex, Back, (UINT32)Length) != Length || CompareMem(Back, Buffer, Length) != 0) ) return breakpoint(11);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1 @@
+int Hex_tests();
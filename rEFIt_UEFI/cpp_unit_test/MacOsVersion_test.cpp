@@ -271,6 +271,18 @@ int MacOsVersion_tests()
   if ( ! ( MacOsVersion("10.1.2"_XS8).match(MacOsVersionPattern("xxX.XXx.2"_XS8)) == true ) ) return breakpoint(100);
   if ( ! ( MacOsVersion("10.1.2"_XS8).match(MacOsVersionPattern("xx.xx.XX.XX"_XS8)) == true ) ) return breakpoint(100);
 
+  // packed value and cache
+  if ( ! ( MacOsVersion("10.15.7"_XS8).packedValue() == MacOsVersion("10.15.7"_XS8).packedValue() ) ) return breakpoint(200); // second one from the cache
+  if ( ! ( MacOsVersion("10.15.7"_XS8).packedValue() != 0 ) ) return breakpoint(201);
+  if ( ! ( MacOsVersion(""_XS8).packedValue() == 0 ) ) return breakpoint(202);
+  if ( ! ( MacOsVersion("10.15.4095"_XS8).packedValue() == 0 ) ) return breakpoint(203); // doesn't fit
+  if ( ! ( MacOsVersion("10.15.4095"_XS8) > MacOsVersion("10.15.7"_XS8) ) ) return breakpoint(204);
+  if ( ! ( MacOsVersion("10.15"_XS8) < MacOsVersion("10.15.0"_XS8) ) ) return breakpoint(205);
+  if ( ! ( MacOsVersion("10.15.0"_XS8) < MacOsVersion("11"_XS8) ) ) return breakpoint(206);
+  if ( ! ( MacOsVersion("10.a"_XS8).lastError.notEmpty() ) ) return breakpoint(207);
+  if ( ! ( MacOsVersion("10.a"_XS8).lastError.notEmpty() ) ) return breakpoint(208); // errors are not cached
+  if ( ! ( MacOsVersion(L"10.15.7"_XSW) == MacOsVersion("10.15.7"_XS8) ) ) return breakpoint(209);
+
 
 	return 0;
 }
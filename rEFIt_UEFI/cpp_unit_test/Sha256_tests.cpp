@@ -0,0 +1,61 @@
+#include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+#include "../Platform/Sha256.h"
+
+static int breakpoint(int i)
+{
+  return i;
+}
+
+static const UINT8 DigestAbc[SHA256_DIGEST_SIZE] = {
+  0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+  0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad
+};
+
+// "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 2 blocks once padded
+static const UINT8 Digest448[SHA256_DIGEST_SIZE] = {
+  0x24, 0x8d, 0x6a, 0x61, 0xd2, 0x06, 0x38, 0xb8, 0xe5, 0xc0, 0x26, 0x93, 0x0c, 0x3e, 0x60, 0x39,
+  0xa3, 0x3c, 0xe4, 0x59, 0x64, 0xff, 0x21, 0x67, 0xf6, 0xec, 0xed, 0xd4, 0x19, 0xdb, 0x06, 0xc1
+};
+
+static void Hash(const UINT8* Buffer, UINTN Length, UINTN Split, UINT8* Digest)
+{
+  SHA256_CONTEXT Context;
+
+  Sha256Init(&Context);
+  Sha256Update(&Context, Buffer, Split);
+  Sha256Update(&Context, Buffer + Split, Length - Split);
+  Sha256Final(&Context, Digest);
+}
+
+int Sha256_tests()
+{
+  static UINT8 Buffer[1000];
+  UINT8   Digest[SHA256_DIGEST_SIZE];
+  UINT8   Reference[SHA256_DIGEST_SIZE];
+  BOOLEAN ShaNi = Sha256GetShaNi();
+  UINTN   Length, Split;
+  UINT32  Seed = 1;
+
+  Sha256SetShaNi(FALSE);
+  Hash((const UINT8*)"abc", 3, 1, Digest);
+  if ( CompareMem(Digest, DigestAbc, sizeof(Digest)) != 0 ) return breakpoint(1);
+  Hash((const UINT8*)"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 56, 0, Digest);
+  if ( CompareMem(Digest, Digest448, sizeof(Digest)) != 0 ) return breakpoint(2);
+  Sha256SetShaNi(ShaNi);
+
+  // SHA extensions, if the CPU has them, give the digests of the C rounds, whatever the split of the updates
+  for (Length = 0; Length < sizeof(Buffer); Length++) {
+    Seed = Seed * 1103515245U + 12345U;
+    Buffer[Length] = (UINT8)(Seed >> 16);
+  }
+  for (Length = 0; Length <= sizeof(Buffer); Length += (Length < 140) ? 1 : 61) {
+    for (Split = 0; Split <= Length; Split += 13) {
+      Sha256SetShaNi(FALSE);
+      Hash(Buffer, Length, Split, Reference);
+      Sha256SetShaNi(ShaNi);
+      Hash(Buffer, Length, Split, Digest);
+      if ( CompareMem(Digest, Reference, sizeof(Digest)) != 0 ) return breakpoint(10);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1 @@
+int Sha256_tests();
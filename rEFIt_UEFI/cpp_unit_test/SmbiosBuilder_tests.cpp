@@ -0,0 +1,69 @@
+#include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+#include "../Platform/SmbiosBuilder.h"
+
+static int breakpoint(int i)
+{
+  return i;
+}
+
+static const UINT8 Table[] = {
+  0, 5, 0x00, 0x00, 1,      'A', 'B', 0, 'C', 0, 0,   // type 0, 2 strings
+  4, 6, 0x00, 0x04, 1, 0,   'X', 0, 0,                // type 4, 1 string
+  17, 4, 0x00, 0x11,        0, 0,                     // type 17, no string
+  4, 6, 0x01, 0x04, 0, 0,   0, 0,                     // type 4, no string
+  127, 4, 0xFF, 0xFE,       0, 0,
+  4, 6, 0x02, 0x04, 0, 0,   0, 0,                     // after the end, not indexed
+};
+
+int SmbiosBuilder_tests()
+{
+  SmbiosSourceIndex Index;
+  SmbiosStringPool  Strings;
+  UINT8             Out[64];
+  UINT8             Number;
+
+  Index.Build(Table);
+  if ( Index.size() != 5 ) return breakpoint(1);
+  if ( !Index.IsBuiltFrom(Table) ) return breakpoint(2);
+  if ( Index.GetCount(4) != 2 ) return breakpoint(3);
+  if ( Index.Get(0, 0) != Table ) return breakpoint(4);
+  if ( Index.Get(4, 0) != Table + 11 ) return breakpoint(5);
+  if ( Index.Get(4, 1) != Table + 26 ) return breakpoint(6);
+  if ( Index.Get(4, 2) != NULL ) return breakpoint(7);
+  if ( Index.Get(17, 0) != Table + 20 ) return breakpoint(8);
+  if ( Index.Get(2, 0) != NULL ) return breakpoint(9);
+  if ( Index.LengthOf(Table) != 11 ) return breakpoint(10);
+  if ( Index.LengthOf(Table + 20) != 6 ) return breakpoint(11);
+  if ( Index.LengthOf(Table + 1) != 0 ) return breakpoint(12);
+
+  // replace a string in place, another one is added after the last one
+  Strings.Load(Table);
+  if ( Strings.GetCount() != 2 ) return breakpoint(20);
+  Number = Strings.SetString(1, "Long", 4);
+  if ( Number != 1 ) return breakpoint(21);
+  Number = Strings.SetString(0, "D", 1);
+  if ( Number != 3 ) return breakpoint(22);
+  Number = Strings.SetString(7, "E", 1);
+  if ( Number != 4 ) return breakpoint(23);
+  {
+    static const UINT8 Expected[] = { 0, 5, 0x00, 0x00, 1, 'L', 'o', 'n', 'g', 0, 'C', 0, 'D', 0, 'E', 0, 0 };
+    if ( Strings.GetLength() != sizeof(Expected) ) return breakpoint(24);
+    if ( Strings.Write(Out) != sizeof(Expected) ) return breakpoint(25);
+    if ( CompareMem(Out, Expected, sizeof(Expected)) != 0 ) return breakpoint(26);
+  }
+
+  // a structure without strings keeps its double 0, its first string gets number 1
+  Strings.Load(Table + 20);
+  if ( Strings.GetCount() != 0 ) return breakpoint(30);
+  if ( Strings.Write(Out) != 6 || CompareMem(Out, Table + 20, 6) != 0 ) return breakpoint(31);
+  if ( Strings.SetString(0, "DIMM0", 5) != 1 ) return breakpoint(32);
+  {
+    static const UINT8 Expected[] = { 17, 4, 0x00, 0x11, 'D', 'I', 'M', 'M', '0', 0, 0 };
+    if ( Strings.Write(Out) != sizeof(Expected) ) return breakpoint(33);
+    if ( CompareMem(Out, Expected, sizeof(Expected)) != 0 ) return breakpoint(34);
+  }
+  if ( !Strings.IsLoadedFrom(Table + 20) ) return breakpoint(35);
+  Strings.Reset();
+  if ( Strings.IsLoadedFrom(Table + 20) ) return breakpoint(36);
+  return 0;
+}
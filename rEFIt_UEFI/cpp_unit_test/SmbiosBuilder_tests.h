@@ -0,0 +1 @@
+int SmbiosBuilder_tests();
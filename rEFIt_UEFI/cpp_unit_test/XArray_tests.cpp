@@ -17,5 +17,34 @@ int XArray_tests()
 
 	if ( array1[1] != 56 ) return 4;
 
+	// geometric growth, then reserve and shrink_to_fit
+	XArray<UINTN> array2;
+	size_t reallocs = 0;
+	size_t allocated = 0;
+	for ( UINTN i = 0 ; i < 10000 ; i++ ) {
+		array2.Add(i);
+		if ( array2.allocatedSize() != allocated ) {
+			allocated = array2.allocatedSize();
+			reallocs++;
+		}
+	}
+	if ( reallocs > 30 ) return 5;
+	if ( array2[9999] != 9999 ) return 6;
+	array2.shrink_to_fit();
+	if ( array2.allocatedSize() != 10000 || array2[5000] != 5000 ) return 7;
+	array2.setEmpty();
+	array2.shrink_to_fit();
+	if ( array2.allocatedSize() != 0 ) return 8;
+	array2.reserve(100);
+	if ( array2.allocatedSize() != 100 ) return 9;
+
+	// moving hands the memory over
+	array2.Add(42);
+	const UINTN* array2Data = array2.data();
+	XArray<UINTN> array3(static_cast<XArray<UINTN>&&>(array2));
+	if ( array3.data() != array2Data || array3.size() != 1 || array2.size() != 0 || array2.allocatedSize() != 0 ) return 10;
+	array1 = static_cast<XArray<UINTN>&&>(array3);
+	if ( array1.data() != array2Data || array1[0] != 42 || array3.data() != NULL ) return 11;
+
 	return 0;
 }
@@ -23,5 +23,22 @@ int XBuffer_tests()
 
   if ( xb_uint8_2 != xb_uint8 ) return 1;
 
+  XBuffer<UINT8> xb_big;
+  xb_big.reserve(64);
+  if ( xb_big.allocatedSize() < 64 ) return 2;
+  for ( UINTN i = 0 ; i < 5000 ; i++ ) {
+    xb_big.cat(uint32_t(i));
+  }
+  if ( xb_big.size() != 20000 || xb_big.data()[4*4999] != (UINT8)4999 ) return 3;
+  xb_big.shrink_to_fit();
+  if ( xb_big.allocatedSize() != 20000 || xb_big.data()[4*4999] != (UINT8)4999 ) return 4;
+
+  // moving hands the memory over
+  const UINT8* bigData = xb_big.data();
+  XBuffer<UINT8> xb_moved(static_cast<XBuffer<UINT8>&&>(xb_big));
+  if ( xb_moved.data() != bigData || xb_moved.size() != 20000 || xb_big.size() != 0 || xb_big.data() != NULL ) return 5;
+  xb_uint8 = static_cast<XBuffer<UINT8>&&>(xb_moved);
+  if ( xb_uint8.data() != bigData || xb_uint8.size() != 20000 || xb_moved.size() != 0 ) return 6;
+
   return 0;
 }
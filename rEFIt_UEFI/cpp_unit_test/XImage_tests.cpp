@@ -0,0 +1,116 @@
+#include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+#include "../libeg/XImage.h"
+#include "../Platform/MemoryOperation.h"
+
+static int breakpoint(int i)
+{
+  return i;
+}
+
+int XImage_tests()
+{
+  // SSE2 ComposeRow must give the same pixels as ComposeRowReference
+  BOOLEAN simd = MemoryOperationGetSimd();
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL top[40];
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL comp[40];
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL simdComp[40];
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL refComp[40];
+  UINT32 seed = 1;
+
+  MemoryOperationSetSimd(TRUE);
+  for ( int pass = 0 ; pass < 500 ; pass++ ) {
+    for ( size_t i = 0 ; i < sizeof(top) / sizeof(top[0]) ; i++ ) {
+      seed = seed * 1103515245 + 12345;
+      *(UINT32*)&top[i] = seed;
+      seed = seed * 1103515245 + 12345;
+      *(UINT32*)&comp[i] = seed;
+      // fully transparent and opaque pixels are the usual cases in icons
+      if ( (seed & 0x300) == 0 ) top[i].Reserved = 0;
+      if ( (seed & 0x300) == 0x100 ) top[i].Reserved = 255;
+      if ( (seed & 0x1C00) == 0 ) comp[i].Reserved = 0;
+    }
+    INTN width = (INTN)(pass % 37);
+    INTN offset = (INTN)(pass % 3);
+    for ( int flags = 0 ; flags < 4 ; flags++ ) {
+      bool lowest = (flags & 1) != 0;
+      bool gray = (flags & 2) != 0;
+      memcpy(simdComp, comp, sizeof(comp));
+      memcpy(refComp, comp, sizeof(comp));
+      XImage::ComposeRow(simdComp + offset, top + offset, width, lowest, gray);
+      XImage::ComposeRowReference(refComp + offset, top + offset, width, lowest, gray);
+      if ( memcmp(simdComp, refComp, sizeof(comp)) != 0 ) {
+        MemoryOperationSetSimd(simd);
+        return breakpoint(1);
+      }
+    }
+  }
+
+  // premultiplied compose: SSE2 and scalar give the same pixels, and over an opaque background
+  // the colors are the ones of the straight compose, +-1
+  XImage topImage(40, 1);
+  XImage compImage(40, 1);
+  for ( int pass = 0 ; pass < 500 ; pass++ ) {
+    for ( size_t i = 0 ; i < sizeof(top) / sizeof(top[0]) ; i++ ) {
+      seed = seed * 1103515245 + 12345;
+      *(UINT32*)&top[i] = seed;
+      seed = seed * 1103515245 + 12345;
+      *(UINT32*)&comp[i] = seed;
+      if ( (seed & 0x300) == 0 ) top[i].Reserved = 0;
+      if ( (seed & 0x300) == 0x100 ) top[i].Reserved = 255;
+      comp[i].Reserved = 255;
+    }
+    topImage.setPremultiplied(false);
+    memcpy(topImage.GetPixelPtr(0, 0), top, sizeof(top));
+    topImage.Premultiply();
+    INTN width = (INTN)(pass % 37);
+    for ( int flags = 0 ; flags < 4 ; flags++ ) {
+      bool lowest = (flags & 1) != 0;
+      bool gray = (flags & 2) != 0;
+      compImage.setPremultiplied(false);
+      memcpy(compImage.GetPixelPtr(0, 0), comp, sizeof(comp));
+      compImage.Premultiply();
+      memcpy(refComp, compImage.GetPixelPtr(0, 0), sizeof(comp));
+      MemoryOperationSetSimd(TRUE);
+      XImage::ComposeRowPremultiplied(compImage.GetPixelPtr(0, 0), topImage.GetPixelPtr(0, 0), width, lowest, gray);
+      MemoryOperationSetSimd(FALSE);
+      XImage::ComposeRowPremultiplied(refComp, topImage.GetPixelPtr(0, 0), width, lowest, gray);
+      if ( memcmp(compImage.GetPixelPtr(0, 0), refComp, sizeof(comp)) != 0 ) {
+        MemoryOperationSetSimd(simd);
+        return breakpoint(2);
+      }
+      memcpy(simdComp, comp, sizeof(comp));
+      XImage::ComposeRowReference(simdComp, top, width, lowest, gray);
+      for ( INTN i = 0 ; i < width ; i++ ) {
+        const UINT8* p1 = (const UINT8*)&simdComp[i];
+        const UINT8* p2 = (const UINT8*)&refComp[i];
+        for ( int k = 0 ; k < 4 ; k++ ) {
+          if ( p1[k] > p2[k] + 1 || p2[k] > p1[k] + 1 ) {
+            MemoryOperationSetSimd(simd);
+            return breakpoint(3);
+          }
+        }
+      }
+    }
+  }
+  MemoryOperationSetSimd(simd);
+
+  // copies share the pixels until one of them writes
+  {
+    XImage original(4, 2);
+    original.Fill(EFI_GRAPHICS_OUTPUT_BLT_PIXEL{ 1, 2, 3, 255 });
+    XImage copy(original);
+    XImage assigned;
+    assigned = original;
+    if ( !copy.sharesPixelsWith(original) || !assigned.sharesPixelsWith(original) ) return breakpoint(10);
+    if ( copy.GetPixel(3, 1).Red != 3 ) return breakpoint(11);
+    copy.GetPixelPtr(3, 1)->Red = 9;
+    if ( copy.sharesPixelsWith(original) || !assigned.sharesPixelsWith(original) ) return breakpoint(12);
+    if ( copy.GetPixel(3, 1).Red != 9 || original.GetPixel(3, 1).Red != 3 || assigned.GetPixel(3, 1).Red != 3 ) return breakpoint(13);
+    original.setEmpty();
+    if ( !original.isEmpty() || assigned.GetWidth() != 4 || assigned.GetPixel(3, 1).Red != 3 ) return breakpoint(14);
+    assigned.EnsureImageSize(8, 8);
+    if ( assigned.GetWidth() != 8 || assigned.GetHeight() != 8 || assigned.GetData().size() != 64 ) return breakpoint(15);
+  }
+
+  return 0;
+}
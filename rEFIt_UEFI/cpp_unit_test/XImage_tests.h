@@ -0,0 +1 @@
+int XImage_tests();
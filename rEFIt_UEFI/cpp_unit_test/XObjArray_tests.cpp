@@ -69,5 +69,22 @@ int XObjArray_tests()
     if ( testCtor[1] != "s2"_XS8 ) return 21;
     if ( testCtor[2] != "s3"_XS8 ) return 22;
   }
+
+  // emplace_back constructs in place, TestObjInt can't be copied
+  {
+    bool m_destructor_called31 = false;
+    {
+      XObjArray<TestObjInt> array3;
+      TestObjInt& obj31 = array3.emplace_back(31, &m_destructor_called31);
+      if ( &obj31 != &array3[0] || array3[0].m_v != 31 ) return 30;
+
+      XObjArray<TestObjInt> array4(static_cast<XObjArray<TestObjInt>&&>(array3));
+      if ( array3.size() != 0 || array4.size() != 1 || &array4[0] != &obj31 ) return 31;
+      if ( m_destructor_called31 ) return 32;
+      array3 = static_cast<XObjArray<TestObjInt>&&>(array4);
+      if ( array4.size() != 0 || array3.size() != 1 || &array3[0] != &obj31 ) return 33;
+    }
+    if ( !m_destructor_called31 ) return 34;
+  }
 	return 0;
 }
@@ -212,6 +212,49 @@ int XStringArray_tests()
 		XString8 c = array.ConcatAll();
 //		printf("c=%s\n", c.c_str());
 	}
+	// SplitViews gives the same tokens as Split
+	{
+        const char* s = "  word1 other2  3333 4th_item ";
+        XArray<XString8View> views;
+        SplitViews(s, " ", views);
+        XString8Array array = Split<XString8Array>(s, " ");
+        if ( views.size() != array.size() ) return 60;
+        for ( size_t i = 0 ; i < views.size() ; i++ ) {
+            if ( views.ElementAt(i).toXString8() != array[i] ) return 61;
+        }
+        views.setEmpty();
+        SplitViews("a--b----c", "--", views);
+        if ( views.size() != 3 || !views.ElementAt(2).equal(XString8View("c")) ) return 62;
+        views.setEmpty();
+        SplitViews("   ", " ", views);
+        if ( views.size() != 0 ) return 63;
+	}
+	// XString8ViewSet and importID
+	{
+        XString8ViewSet set;
+        if ( !set.add(XString8View("-v")) ) return 70;
+        if ( set.add(XString8View("-v")) ) return 71;
+        if ( !set.contains(XString8View("-v")) ) return 72;
+        if ( set.contains(XString8View("-v ", 3)) ) return 73;
+        char names[100][2]; // the set keeps views, so the chars must stay
+        for ( int i = 0 ; i < 100 ; i++ ) {
+            names[i][0] = (char)('a' + i / 10);
+            names[i][1] = (char)('a' + i % 10);
+            set.add(XString8View(names[i], 2));
+        }
+        if ( set.size() != 101 ) return 74;
+
+        XString8Array array;
+        array.Add("-v");
+        array.Add("keepsyms=1");
+        XArray<XString8View> views;
+        SplitViews("-v debug=0x100 keepsyms=1 debug=0x100", " ", views);
+        array.importID(views);
+        if ( array.size() != 3 ) return 75;
+        if ( array[2] != "debug=0x100"_XS8 ) return 76;
+        array.import(views);
+        if ( array.size() != 7 ) return 77;
+	}
 
 
 
@@ -1696,6 +1696,104 @@ int XString_tests()
     t16.stealValueFrom(p16);
   }
 
+  // Small strings are kept in the object, no allocation. Moving a bigger one hands over its buffer.
+  {
+    XString8 xsSmall;
+    xsSmall.takeValueFrom("0123456789");
+    if ( xsSmall.s() < (const char*)&xsSmall  ||  xsSmall.s() >= (const char*)(&xsSmall+1) ) {
+      nbTestFailed += 1;
+    }
+    XString8 xsCopy = xsSmall;
+    if ( xsCopy.s() == xsSmall.s()  ||  xsCopy != "0123456789"_XS8 ) {
+      nbTestFailed += 1;
+    }
+    xsSmall += "0123456789";
+    if ( xsSmall != "01234567890123456789"_XS8  ||  xsCopy != "0123456789"_XS8 ) {
+      nbTestFailed += 1;
+    }
+    const char* heapData = xsSmall.s();
+    XString8 xsMoved(static_cast<XString8&&>(xsSmall));
+    if ( xsMoved.s() != heapData  ||  xsMoved != "01234567890123456789"_XS8  ||  !xsSmall.isEmpty() ) {
+      nbTestFailed += 1;
+    }
+    xsMoved.setEmpty();
+    xsMoved += "abc";
+    xsMoved.shrink_to_fit();
+    if ( xsMoved.s() < (const char*)&xsMoved  ||  xsMoved.s() >= (const char*)(&xsMoved+1)  ||  xsMoved != "abc"_XS8 ) {
+      nbTestFailed += 1;
+    }
+    xsSmall = static_cast<XString8&&>(xsCopy);
+    char* forgotten = xsSmall.forgetDataWithoutFreeing();
+    if ( ::strcmp(forgotten, "0123456789") != 0 ) {
+      nbTestFailed += 1;
+    }
+    free(forgotten);
+  }
+  {
+    XStringW xswSmall = L"short"_XSW;
+    xswSmall += L"er";
+    if ( xswSmall.wc_str() < (const wchar_t*)&xswSmall  ||  xswSmall.wc_str() >= (const wchar_t*)(&xswSmall+1)  ||  xswSmall != L"shorter"_XSW ) {
+      nbTestFailed += 1;
+    }
+  }
+
+  // ASCII runs are scanned a word at a time. Start at every offset of a word, so the aligned and unaligned parts are both used.
+  {
+    const char* mixed8 = "0123456789abcdefghijklmnopqrstuvwxyz é 0123456789abcdefghijklmnopqrstuvwxyz 𐅃 ABCDEFGHIJ";
+    const char16_t* mixed16 = u"0123456789abcdefghijklmnopqrstuvwxyz é 0123456789abcdefghijklmnopqrstuvwxyz 𐅃 ABCDEFGHIJ";
+    for ( size_t offset = 0 ; offset < 9 ; offset++ ) {
+      XString16 xs16;
+      xs16.takeValueFrom(mixed8 + offset);
+      if ( xs16 != XString16().takeValueFrom(mixed16 + offset)  ||  xs16.sizeInNativeChars() != utf16_size_of_utf16_string(mixed16 + offset) ) {
+        nbTestFailed += 1;
+      }
+      XString8 xs8;
+      xs8.takeValueFrom(mixed16 + offset);
+      if ( ::strcmp(xs8.c_str(), mixed8 + offset) != 0 ) {
+        nbTestFailed += 1;
+      }
+      if ( utf8_size_of_utf16_string(mixed16 + offset) != ::strlen(mixed8 + offset)  ||  utf16_size_of_utf8_string(mixed8 + offset) != xs16.sizeInNativeChars() ) {
+        nbTestFailed += 1;
+      }
+    }
+    // convert and measure : truncated but terminated, the return value is the whole size
+    char16_t buf16[20];
+    size_t size16 = utf16_string_from_utf8_string_measure(buf16, 20, mixed8);
+    if ( size16 != utf16_size_of_utf8_string(mixed8)  ||  buf16[19] != 0  ||  memcmp(buf16, mixed16, 19*sizeof(char16_t)) != 0 ) {
+      nbTestFailed += 1;
+    }
+    char buf8[39];
+    size_t size8 = utf8_string_from_utf16_string_measure(buf8, 39, mixed16);
+    if ( size8 != ::strlen(mixed8)  ||  ::strlen(buf8) != 37  ||  memcmp(buf8, mixed8, 37) != 0 ) { // 'é' doesn't fit in the last byte
+      nbTestFailed += 1;
+    }
+    size8 = utf8_string_from_utf8_string_measure(buf8, 39, mixed8);
+    if ( size8 != ::strlen(mixed8) ) {
+      nbTestFailed += 1;
+    }
+  }
+
+  // printf output is appended chunk by chunk at the known end of the string
+  {
+    XString8 xs8 = S8Printf("%s-%d-%s", "0123456789abcdefghijklmnopqrstuvwxyz", 42, "ABCDEFGHIJKLMNOPQRSTUVWXYZ");
+    if ( xs8 != "0123456789abcdefghijklmnopqrstuvwxyz-42-ABCDEFGHIJKLMNOPQRSTUVWXYZ"_XS8 ) {
+      nbTestFailed += 1;
+    }
+    xs8.S8Catf("+%d", 7);
+    xs8.S8Catf("%s", "");
+    if ( xs8 != "0123456789abcdefghijklmnopqrstuvwxyz-42-ABCDEFGHIJKLMNOPQRSTUVWXYZ+7"_XS8 ) {
+      nbTestFailed += 1;
+    }
+    xs8.S8Printf("%d", 1);
+    if ( xs8 != "1"_XS8 ) {
+      nbTestFailed += 1;
+    }
+    XStringW xsw = SWPrintf("%s=%d", "a long enough key name", 12345);
+    if ( xsw != L"a long enough key name=12345"_XSW ) {
+      nbTestFailed += 1;
+    }
+  }
+
 
 
 	TEST_ALL_CLASSES(testDefaultCtor, __TEST0);
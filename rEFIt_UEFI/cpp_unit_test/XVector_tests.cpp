@@ -0,0 +1,58 @@
+
+#include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+#include "../cpp_foundation/XVector.h"
+#include "../cpp_foundation/XString.h"
+
+class TestVecObj
+{
+  public:
+    UINTN m_v;
+    int* m_alive;
+
+  TestVecObj(UINTN v, int* alive) : m_v(v), m_alive(alive) { *m_alive += 1; }
+  TestVecObj(const TestVecObj& other) : m_v(other.m_v), m_alive(other.m_alive) { *m_alive += 1; }
+  TestVecObj& operator=(const TestVecObj&) = default;
+  ~TestVecObj() { *m_alive -= 1; }
+};
+
+int XVector_tests()
+{
+  int alive = 0;
+  {
+    XVector<TestVecObj> vector1;
+    for ( UINTN i = 0 ; i < 100 ; i++ ) {
+      vector1.emplace_back(i, &alive);
+    }
+    if ( vector1.size() != 100 || alive != 100 ) return 1;
+    if ( &vector1[1] != &vector1[0] + 1 ) return 2; // packed
+    if ( vector1[0].m_v != 0 || vector1[99].m_v != 99 ) return 3;
+
+    vector1.RemoveAtIndex(1);
+    if ( vector1.size() != 99 || alive != 99 || vector1[1].m_v != 2 ) return 4;
+
+    vector1.AddCopy(vector1[0]); // the source moves when the vector grows
+    if ( vector1[99].m_v != 0 || alive != 100 ) return 5;
+
+    XVector<TestVecObj> vector2(vector1);
+    if ( vector2.size() != 100 || alive != 200 ) return 6;
+    vector2 = static_cast<XVector<TestVecObj>&&>(vector1);
+    if ( vector1.size() != 0 || vector2.size() != 100 || alive != 100 ) return 7;
+    vector2.shrink_to_fit();
+    if ( vector2.allocatedSize() != 100 || vector2[50].m_v != 51 ) return 8;
+  }
+  if ( alive != 0 ) return 9;
+
+  // short XString8 point into themselves, they must survive a relocation
+  {
+    XVector<XString8> vector3;
+    for ( UINTN i = 0 ; i < 50 ; i++ ) {
+      XString8& number = vector3.emplace_back();
+      number += char('0' + i / 10);
+      number += char('0' + i % 10);
+      vector3.emplace_back("a string longer than the small buffer"_XS8);
+    }
+    if ( vector3[20] != "10"_XS8 || vector3[21] != "a string longer than the small buffer"_XS8 ) return 10;
+    if ( vector3[98] != "49"_XS8 || vector3[0] != "00"_XS8 ) return 11;
+  }
+  return 0;
+}
@@ -0,0 +1,3 @@
+
+
+int XVector_tests();
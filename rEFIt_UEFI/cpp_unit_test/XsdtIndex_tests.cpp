@@ -0,0 +1,63 @@
+#include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+#include "../Platform/XsdtIndex.h"
+
+static int breakpoint(int i)
+{
+  return i;
+}
+
+#define FACP_SIGN  SIGNATURE_32('F','A','C','P')
+#define SSDT_SIGN  SIGNATURE_32('S','S','D','T')
+#define APIC_SIGN  SIGNATURE_32('A','P','I','C')
+
+int XsdtIndex_tests()
+{
+  EFI_ACPI_DESCRIPTION_HEADER Tables[5];
+  UINT64    Entry[6];
+  XsdtIndex Index;
+  UINT32    i;
+
+  SetMem(Tables, sizeof(Tables), 0);
+  Tables[0].Signature = FACP_SIGN;
+  Tables[1].Signature = SSDT_SIGN;
+  Tables[1].OemTableId = 1;
+  Tables[2].Signature = SSDT_SIGN;
+  Tables[2].OemTableId = 2;
+  Tables[3].Signature = APIC_SIGN;
+  Tables[4].Signature = SSDT_SIGN;
+  Tables[4].OemTableId = 2;
+  for (i = 0; i < 4; i++) {
+    Entry[i] = (UINT64)(UINTN)&Tables[i];
+  }
+  Entry[4] = 0; // NULL entry is skipped
+
+  Index.Build(Entry, Entry, 5);
+  if ( !Index.IsBuiltFrom(Entry) ) return breakpoint(1);
+  if ( Index.Find(SSDT_SIGN, 0, MAX_UINTN) != 1 ) return breakpoint(2);
+  if ( Index.Find(SSDT_SIGN, 2, MAX_UINTN) != 2 ) return breakpoint(3);
+  if ( Index.Find(SSDT_SIGN, 0, 1) != 2 ) return breakpoint(4);
+  if ( Index.Find(SSDT_SIGN, 1, 1) != XSDT_INDEX_NONE ) return breakpoint(5);
+  if ( Index.Find(0, 2, MAX_UINTN) != 2 ) return breakpoint(6);
+  if ( Index.Find(SIGNATURE_32('D','M','A','R'), 0, MAX_UINTN) != XSDT_INDEX_NONE ) return breakpoint(7);
+
+  // added at the end, match indexes follow the XSDT order
+  if ( Index.Add((UINT64)(UINTN)&Tables[4]) != 5 ) return breakpoint(10);
+  if ( Index.Find(SSDT_SIGN, 0, 2) != 5 ) return breakpoint(11);
+
+  // dropped entries keep their place until Write()
+  Index.Drop(1);
+  if ( Index.Find(SSDT_SIGN, 0, MAX_UINTN) != 2 ) return breakpoint(20);
+  if ( Index.GetNth(SSDT_SIGN, 1) != 5 ) return breakpoint(21);
+  if ( Index.GetEntry(1) != 0 ) return breakpoint(22);
+
+  Index.SetMergedPages(3, 2);
+  if ( Index.GetMergedPages(3) != 2 ) return breakpoint(30);
+  Index.ClearMergedPages();
+  if ( Index.GetMergedPages(3) != 0 ) return breakpoint(31);
+
+  if ( Index.Write(Entry) != 4 ) return breakpoint(40);
+  if ( Entry[0] != (UINT64)(UINTN)&Tables[0] || Entry[1] != (UINT64)(UINTN)&Tables[2] ||
+       Entry[2] != (UINT64)(UINTN)&Tables[3] || Entry[3] != (UINT64)(UINTN)&Tables[4] ) return breakpoint(41);
+
+  return 0;
+}
@@ -0,0 +1 @@
+int XsdtIndex_tests();
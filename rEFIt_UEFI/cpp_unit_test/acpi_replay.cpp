@@ -0,0 +1,263 @@
+#include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+#include "../cpp_foundation/XObjArray.h"
+#include "../Platform/AcpiPatcher.h"
+#include "../Platform/FixBiosDsdt.h"
+#include "../Platform/XsdtIndex.h"
+#include "../Platform/Checksum.h"
+#include "../Platform/Settings.h"
+#include "../Platform/cpu.h"
+#include "../Platform/SelfOem.h"
+#include "../refit/lib.h"
+#include "../libeg/libeg.h"
+
+#include "acpi_replay.h"
+
+// only called from a JIEF_DEBUG build, a release CLOVER.efi doesn't carry it
+#ifdef JIEF_DEBUG
+
+class REPLAY_TABLE
+{
+public:
+  XStringW  FileName;
+  UINT8    *Data;      // as loaded, never patched
+  UINTN     Size;
+  UINTN     SsdtIndex; // from the file name, MAX_UINTN if none
+
+  REPLAY_TABLE() : FileName(), Data(NULL), Size(0), SsdtIndex(MAX_UINTN) {}
+  ~REPLAY_TABLE() { if (Data != NULL) FreePool(Data); }
+
+  REPLAY_TABLE(const REPLAY_TABLE&) = delete;
+  REPLAY_TABLE& operator = (const REPLAY_TABLE&) = delete;
+
+  EFI_ACPI_DESCRIPTION_HEADER* Header() const { return (EFI_ACPI_DESCRIPTION_HEADER*)Data; }
+};
+
+static UINT64 ReplayUs(UINT64 Ticks)
+{
+  if (gCPUStructure.TSCFrequency == 0) {
+    return 0;
+  }
+  return DivU64x64Remainder(MultU64x32(Ticks, 1000000), gCPUStructure.TSCFrequency, NULL);
+}
+
+static void ReplayPrintStep(CONST CHAR16* Table, const char* Step, UINT64 Ticks)
+{
+  MsgLog("{\"acpi\":\"%ls\",\"step\":\"%s\",\"us\":%llu}\n", Table, Step, ReplayUs(Ticks));
+}
+
+// Step with the resulting table : its length, its ACPI checksum byte and the Adler32 of the whole table to compare outputs
+static void ReplayPrintResult(CONST CHAR16* Table, const char* Step, UINT64 Ticks, const UINT8* Data)
+{
+  const EFI_ACPI_DESCRIPTION_HEADER* Header = (const EFI_ACPI_DESCRIPTION_HEADER*)Data;
+  MsgLog("{\"acpi\":\"%ls\",\"step\":\"%s\",\"us\":%llu,\"length\":%u,\"checksum\":\"0x%02X\",\"adler32\":\"0x%08X\"}\n",
+         Table, Step, ReplayUs(Ticks), Header->Length, Header->Checksum, Adler32(1, Data, Header->Length));
+}
+
+// Tables of the dump, the SSDTs in the order of their index as DumpTables() numbered them
+static void ReplayLoadTables(const EFI_FILE* Dir, XObjArray<REPLAY_TABLE>& Tables)
+{
+  REFIT_DIR_ITER  DirIter;
+  EFI_FILE_INFO  *DirEntry;
+
+  DirIterOpen(Dir, ACPI_REPLAY_DIR, &DirIter);
+  while (DirIterNext(&DirIter, 2, L"*.aml", &DirEntry)) {
+    if (DirEntry->FileName[0] == L'.') {
+      continue;
+    }
+    REPLAY_TABLE* Table = new REPLAY_TABLE;
+    Table->FileName.takeValueFrom(DirEntry->FileName);
+    if (EFI_ERROR(egLoadFile(Dir, SWPrintf("%ls\\%ls", ACPI_REPLAY_DIR, DirEntry->FileName).wc_str(), &Table->Data, &Table->Size)) ||
+        Table->Size < sizeof(EFI_ACPI_DESCRIPTION_HEADER) || Table->Header()->Length > Table->Size ||
+        Table->Header()->Length < sizeof(EFI_ACPI_DESCRIPTION_HEADER)) {
+      DBG("acpi_replay: %ls is not a table, skipped\n", DirEntry->FileName);
+      delete Table;
+      continue;
+    }
+    Table->SsdtIndex = IndexFromFileName(DirEntry->FileName);
+    size_t Pos = Tables.size();
+    if (Table->Header()->Signature == EFI_ACPI_4_0_SECONDARY_SYSTEM_DESCRIPTION_TABLE_SIGNATURE) {
+      while (Pos > 0 && Tables[Pos - 1].Header()->Signature == EFI_ACPI_4_0_SECONDARY_SYSTEM_DESCRIPTION_TABLE_SIGNATURE &&
+             Tables[Pos - 1].SsdtIndex > Table->SsdtIndex) {
+        Pos--;
+      }
+    }
+    Tables.InsertRef(Table, Pos, true);
+  }
+  DirIterClose(&DirIter);
+}
+
+static void ReplayDsdt(const REPLAY_TABLE& Dsdt, const REPLAY_TABLE* Facp)
+{
+  EFI_ACPI_2_0_FIXED_ACPI_DESCRIPTION_TABLE Fadt;
+  DSDT_FIX_TIMES Times;
+  UINT32 Length = Dsdt.Header()->Length;
+  // room to grow, as PatchACPI() gives
+  UINT8* Buffer = (UINT8*)AllocateZeroPool(EFI_PAGES_TO_SIZE(EFI_SIZE_TO_PAGES(Length + Length / 8)));
+  if (Buffer == NULL) {
+    return;
+  }
+  SetMem(&Fadt, sizeof(Fadt), 0);
+  if (Facp != NULL) {
+    CopyMem(&Fadt, Facp->Data, MIN(sizeof(Fadt), (UINTN)Facp->Header()->Length));
+  }
+  CopyMem(Buffer, Dsdt.Data, Length);
+
+  BOOLEAN DsdtCache = GlobalConfig.DsdtCache;
+  GlobalConfig.DsdtCache = FALSE; // the fixes, not the cache
+  ZeroMem(&Times, sizeof(Times));
+  gDsdtFixTimes = &Times;
+  UINT64 Start = AsmReadTsc();
+  FixBiosDsdt(Buffer, &Fadt, MacOsVersion());
+  UINT64 Ticks = AsmReadTsc() - Start;
+  gDsdtFixTimes = NULL;
+  GlobalConfig.DsdtCache = DsdtCache;
+
+  for (UINTN i = 0; i < Times.Count; i++) {
+    ReplayPrintStep(Dsdt.FileName.wc_str(), Times.Fix[i].Name, Times.Fix[i].Ticks);
+  }
+  ReplayPrintResult(Dsdt.FileName.wc_str(), "FixBiosDsdt", Ticks, Buffer);
+  FreePool(Buffer);
+}
+
+// Same as PatchAllTables() for an SSDT, headers are not patched
+static void ReplaySsdt(const REPLAY_TABLE& Ssdt, const DsdtPatchPlan& Plan)
+{
+  UINT32 Length = Ssdt.Header()->Length;
+  UINT8* Buffer = (UINT8*)AllocateZeroPool(Length + 4096);
+  if (Buffer == NULL) {
+    return;
+  }
+  CopyMem(Buffer, Ssdt.Data, Length);
+
+  UINT64 Start = AsmReadTsc();
+  if (gSettings.DSDTPatchArray.size() > 0) {
+    Length = Plan.Apply(Buffer, Length, FALSE);
+  }
+  ((EFI_ACPI_DESCRIPTION_HEADER*)Buffer)->Length = Length;
+  UINT64 Ticks = AsmReadTsc() - Start;
+  ReplayPrintStep(Ssdt.FileName.wc_str(), "DsdtPatches", Ticks);
+
+  Start = AsmReadTsc();
+  RenameDevices(Buffer);
+  Ticks = AsmReadTsc() - Start;
+  ReplayPrintStep(Ssdt.FileName.wc_str(), "RenameDevices", Ticks);
+
+  FixChecksum((EFI_ACPI_DESCRIPTION_HEADER*)Buffer);
+  ReplayPrintResult(Ssdt.FileName.wc_str(), "PatchAllTables", 0, Buffer);
+  FreePool(Buffer);
+}
+
+static const REPLAY_TABLE* ReplayTableAt(const XObjArray<REPLAY_TABLE>& Tables, UINT64 Address)
+{
+  for (size_t i = 0; i < Tables.size(); i++) {
+    if ((UINT64)(UINTN)Tables[i].Data == Address) {
+      return &Tables[i];
+    }
+  }
+  return NULL;
+}
+
+//
+// ACPIDropTables then ACPI\patched on an XsdtIndex of the dump, with the matching of DropTableFromXSDT()
+// and of ReplaceOrInsertTable(). Only the decisions are logged, nothing is loaded in the XSDT.
+//
+static void ReplayDropInsert(const XObjArray<REPLAY_TABLE>& Tables)
+{
+  XArray<UINT64> Entries;
+  XsdtIndex      Index;
+
+  // the XSDT doesn't list the DSDT and the FACS
+  for (size_t i = 0; i < Tables.size(); i++) {
+    UINT32 Signature = Tables[i].Header()->Signature;
+    if (Signature != EFI_ACPI_2_0_DIFFERENTIATED_SYSTEM_DESCRIPTION_TABLE_SIGNATURE &&
+        Signature != EFI_ACPI_2_0_FIRMWARE_ACPI_CONTROL_STRUCTURE_SIGNATURE) {
+      Entries.Add((UINT64)(UINTN)Tables[i].Data);
+    }
+  }
+  Index.Build(Entries.data(), Entries.data(), (UINT32)Entries.size());
+
+  UINT64 Start = AsmReadTsc();
+  for (ACPI_DROP_TABLE* Drop = gSettings.ACPIDropTables; Drop != NULL; Drop = Drop->Next) {
+    if (!Drop->MenuItem.BValue || Drop->Signature == 0) {
+      continue;
+    }
+    UINTN  Nth = 0;
+    UINT32 Found;
+    while ((Found = Index.GetNth(Drop->Signature, Nth)) != XSDT_INDEX_NONE) {
+      const EFI_ACPI_DESCRIPTION_HEADER* Header = (const EFI_ACPI_DESCRIPTION_HEADER*)(UINTN)Index.GetEntry(Found);
+      if ((Drop->TableId && Header->OemTableId != Drop->TableId) || (Drop->Length && Header->Length != Drop->Length)) {
+        Nth++;
+        continue;
+      }
+      MsgLog("{\"acpi\":\"%ls\",\"step\":\"drop\"}\n", ReplayTableAt(Tables, Index.GetEntry(Found))->FileName.wc_str());
+      Index.Drop(Found);
+    }
+  }
+  ReplayPrintStep(L"XSDT", "ACPIDropTables", AsmReadTsc() - Start);
+
+  XStringWArray Patched = GetListOfPatchedAml();
+  Start = AsmReadTsc();
+  for (size_t i = 0; i < Patched.size(); i++) {
+    UINT8* Buffer = NULL;
+    UINTN  Size = 0;
+    if (EFI_ERROR(egLoadFile(&selfOem.getConfigDir(), SWPrintf("ACPI\\patched\\%ls", Patched[i].wc_str()).wc_str(), &Buffer, &Size)) ||
+        Size < sizeof(EFI_ACPI_DESCRIPTION_HEADER)) {
+      continue;
+    }
+    const EFI_ACPI_DESCRIPTION_HEADER* Header = (const EFI_ACPI_DESCRIPTION_HEADER*)Buffer;
+    UINTN  MatchIndex = gSettings.AutoMerge ? IndexFromFileName(Patched[i].wc_str()) : MAX_UINTN;
+    UINT32 Found = XSDT_INDEX_NONE;
+    if (gSettings.AutoMerge &&
+        (Header->Signature != EFI_ACPI_4_0_SECONDARY_SYSTEM_DESCRIPTION_TABLE_SIGNATURE || MatchIndex != MAX_UINTN)) {
+      Found = Index.Find(Header->Signature, Header->OemTableId, MatchIndex);
+    }
+    if (Found != XSDT_INDEX_NONE) {
+      const REPLAY_TABLE* Target = ReplayTableAt(Tables, Index.GetEntry(Found));
+      MsgLog("{\"acpi\":\"patched\\\\%ls\",\"step\":\"replace\",\"target\":\"%ls\"}\n", Patched[i].wc_str(),
+             Target ? Target->FileName.wc_str() : L"?");
+    } else {
+      MsgLog("{\"acpi\":\"patched\\\\%ls\",\"step\":\"insert\"}\n", Patched[i].wc_str());
+    }
+    FreePool(Buffer);
+  }
+  ReplayPrintStep(L"XSDT", "ACPIPatchedAML", AsmReadTsc() - Start);
+}
+
+UINTN acpi_replay(const EFI_FILE* Dir)
+{
+  XObjArray<REPLAY_TABLE> Tables;
+  const REPLAY_TABLE*     Dsdt = NULL;
+  const REPLAY_TABLE*     Facp = NULL;
+
+  ReplayLoadTables(Dir, Tables);
+  if (Tables.size() == 0) {
+    return 0;
+  }
+  DbgHeader("acpi_replay");
+  for (size_t i = 0; i < Tables.size(); i++) {
+    if (Tables[i].Header()->Signature == EFI_ACPI_2_0_DIFFERENTIATED_SYSTEM_DESCRIPTION_TABLE_SIGNATURE && Dsdt == NULL) {
+      Dsdt = &Tables[i];
+    } else if (Tables[i].Header()->Signature == EFI_ACPI_2_0_FIXED_ACPI_DESCRIPTION_TABLE_SIGNATURE && Facp == NULL) {
+      Facp = &Tables[i];
+    }
+  }
+
+  if (Dsdt != NULL) {
+    ReplayDsdt(*Dsdt, Facp);
+  }
+
+  DsdtPatchPlan Plan;
+  UINT64 Start = AsmReadTsc();
+  Plan.Build();
+  ReplayPrintStep(L"SSDT", "DsdtPatchPlan.Build", AsmReadTsc() - Start);
+  for (size_t i = 0; i < Tables.size(); i++) {
+    if (Tables[i].Header()->Signature == EFI_ACPI_4_0_SECONDARY_SYSTEM_DESCRIPTION_TABLE_SIGNATURE) {
+      ReplaySsdt(Tables[i], Plan);
+    }
+  }
+
+  ReplayDropInsert(Tables);
+  return Tables.size();
+}
+
+#endif // JIEF_DEBUG
@@ -0,0 +1,15 @@
+/*
+ * Replay of the ACPI patches of the config on tables dumped by DumpTables(), to measure
+ * FixBiosDsdt(), the DSDT patches, RenameDevices and the drop/insert decisions on real vendor tables.
+ * Copy ACPI\origin to ACPI\replay (under the OEM or Clover dir) and boot a JIEF_DEBUG build.
+ * One line of JSON per step in the log :
+ *   {"acpi":"DSDT","step":"FIX_RTC","us":12}
+ *   {"acpi":"DSDT","step":"FixBiosDsdt","us":4120,"length":210466,"checksum":"0x3E","adler32":"0x8F12A0C4"}
+ * The tables of ACPI\replay are not modified, each step works on a copy.
+ */
+
+#define ACPI_REPLAY_DIR L"ACPI\\replay"
+
+// JIEF_DEBUG builds only.
+// Returns the number of tables replayed, 0 if ACPI\replay is missing or empty.
+UINTN acpi_replay(const EFI_FILE* Dir);
@@ -0,0 +1,429 @@
+#include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+#include "../cpp_foundation/XString.h"
+#include "../cpp_foundation/XArray.h"
+#include "../cpp_foundation/XObjArray.h"
+#include "../cpp_foundation/XVector.h"
+#include "../Platform/plist/plist.h"
+#include "../Platform/MemoryOperation.h"
+#include "../Platform/Checksum.h"
+
+#include "all_benchmarks.h"
+
+#if defined(JIEF_DEBUG) && defined(CLOVER_BUILD)
+  #include "../libeg/XImage.h"
+  #include "../libeg/nanosvg.h"
+  #include "../Platform/FixBiosDsdt.h"
+  #include "../Platform/Settings.h"
+#endif
+
+#if defined(CLOVER_BUILD)
+#include "../Platform/cpu.h"
+extern "C" {
+  #include <Library/CppMemLib.h>
+}
+#elif !defined(_MSC_VER)
+  #include <time.h>
+#endif
+
+#ifndef _MSC_VER
+extern const char* config_all; // plist_tests.cpp
+#endif
+
+//
+// Clock, in ns
+//
+#if defined(CLOVER_BUILD)
+static UINT64 BenchNow()
+{
+  return AsmReadTsc();
+}
+static UINT64 BenchNs(UINT64 Ticks)
+{
+  UINT64 TicksPerUs = gCPUStructure.TSCFrequency / 1000000;
+  return TicksPerUs ? Ticks * 1000 / TicksPerUs : 0;
+}
+#else
+static UINT64 BenchNow()
+{
+  struct timespec ts;
+#if defined(_MSC_VER)
+  timespec_get(&ts, TIME_UTC);
+#else
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+  return (UINT64)ts.tv_sec * 1000000000ull + (UINT64)ts.tv_nsec;
+}
+static UINT64 BenchNs(UINT64 Ns)
+{
+  return Ns;
+}
+#endif
+
+//
+// Allocation counter. In Clover, the blocks of operator new (pool allocations are not counted).
+// On a glibc host, every malloc, calloc and realloc : they are interposed here, unless a sanitizer owns them.
+//
+#define BENCH_NO_ALLOC_COUNT MAX_UINT64
+
+#if defined(__has_feature)
+  #if __has_feature(address_sanitizer)
+    #define BENCH_SANITIZED
+  #endif
+#endif
+#if defined(__SANITIZE_ADDRESS__)
+  #define BENCH_SANITIZED
+#endif
+
+#if defined(CLOVER_BUILD)
+static UINT64 BenchAllocs()
+{
+  CPP_MEM_STATS Stats;
+  UINT64        Allocs;
+
+  CppMemGetStats(&Stats);
+  Allocs = Stats.LargeAllocs;
+  for (UINTN Class = 0; Class < CPP_MEM_CLASS_COUNT; Class++) {
+    Allocs += Stats.Class[Class].Allocs;
+  }
+  return Allocs;
+}
+#elif defined(__GLIBC__) && !defined(BENCH_SANITIZED)
+static UINT64 BenchMallocCount = 0;
+
+extern "C" {
+  void* __libc_malloc(size_t size);
+  void* __libc_calloc(size_t count, size_t size);
+  void* __libc_realloc(void* ptr, size_t size);
+
+  void* malloc(size_t size) noexcept
+  {
+    BenchMallocCount += 1;
+    return __libc_malloc(size);
+  }
+  void* calloc(size_t count, size_t size) noexcept
+  {
+    BenchMallocCount += 1;
+    return __libc_calloc(count, size);
+  }
+  void* realloc(void* ptr, size_t size) noexcept
+  {
+    BenchMallocCount += 1;
+    return __libc_realloc(ptr, size);
+  }
+}
+
+static UINT64 BenchAllocs()
+{
+  return BenchMallocCount;
+}
+#else
+static UINT64 BenchAllocs()
+{
+  return BENCH_NO_ALLOC_COUNT;
+}
+#endif
+
+typedef void (*BENCH_FUNC)(void* Context);
+
+// Runs Func Iterations times, after one warm up call, and prints the JSON line
+static void Bench(const char* Name, UINT64 Iterations, BENCH_FUNC Func, void* Context)
+{
+  Func(Context); // first allocations, caches
+
+  UINT64 Allocs = BenchAllocs();
+  UINT64 Start = BenchNow();
+  for (UINT64 i = 0; i < Iterations; i++) {
+    Func(Context);
+  }
+  UINT64 Ns = BenchNs(BenchNow() - Start);
+  UINT64 AllocsEnd = BenchAllocs();
+
+  // ns/op with one decimal, allocs/op with two, no float formatting needed
+  UINT64 NsPerOp10 = Ns * 10 / Iterations;
+  printf("{\"bench\":\"%s\",\"iterations\":%llu,\"ns_per_op\":%llu.%llu,\"allocs_per_op\":", Name,
+         (unsigned long long)Iterations, (unsigned long long)(NsPerOp10 / 10), (unsigned long long)(NsPerOp10 % 10));
+  if (Allocs == BENCH_NO_ALLOC_COUNT) {
+    printf("null}\n");
+  } else {
+    UINT64 AllocsPerOp100 = (AllocsEnd - Allocs) * 100 / Iterations;
+    printf("%llu.%02llu}\n", (unsigned long long)(AllocsPerOp100 / 100), (unsigned long long)(AllocsPerOp100 % 100));
+  }
+}
+
+//
+// Foundation
+//
+static void BenchXString8Strcat(void*)
+{
+  XString8 s;
+  for (int i = 0; i < 256; i++) {
+    s.strcat("0123456789abcdef");
+  }
+}
+
+static void BenchXString8S8Catf(void*)
+{
+  XString8 s;
+  for (int i = 0; i < 100; i++) {
+    s.S8Catf("%d,", i);
+  }
+}
+
+static void BenchXStringWFromUtf8(void* Context)
+{
+  XStringW s;
+  s.takeValueFrom((const char*)Context);
+}
+
+static void BenchXString8FromUtf16(void* Context)
+{
+  XString8 s;
+  s.takeValueFrom((const wchar_t*)Context);
+}
+
+static void BenchXArrayAdd(void*)
+{
+  XArray<UINT32> a;
+  for (UINT32 i = 0; i < 1000; i++) {
+    a.Add(i);
+  }
+}
+
+static void BenchXObjArrayAdd(void*)
+{
+  XObjArray<XString8> a;
+  for (UINT32 i = 0; i < 1000; i++) {
+    a.AddReference(new XString8(), true);
+  }
+}
+
+static void BenchXVectorAdd(void*)
+{
+  XVector<XString8> a;
+  for (UINT32 i = 0; i < 1000; i++) {
+    a.emplace_back();
+  }
+}
+
+//
+// Plist
+//
+typedef struct {
+  const char *Config;
+  size_t      ConfigSize;
+} BENCH_CONFIG;
+
+static void BenchParseXML(void* Context)
+{
+  BENCH_CONFIG* Config = (BENCH_CONFIG*)Context;
+  TagDict*      Dict = NULL;
+  if (!EFI_ERROR(ParseXML(Config->Config, &Dict, Config->ConfigSize))) {
+    Dict->FreeTag();
+  }
+}
+
+static void BenchParseXMLView(void* Context)
+{
+  BENCH_CONFIG* Config = (BENCH_CONFIG*)Context;
+  TagDict*      Dict = NULL;
+  if (!EFI_ERROR(ParseXMLView(Config->Config, &Dict, Config->ConfigSize))) {
+    Dict->FreeTag();
+  }
+}
+
+//
+// Kext and kernel patches. Replace is Search, so the buffer doesn't change from one pass to the next.
+//
+typedef struct {
+  const UINT8  *Search;
+  const UINT8  *Mask;
+  UINTN         Size;
+} BENCH_PATTERN;
+
+static const BENCH_PATTERN BenchPatterns[] = {
+  { (const UINT8*)"\x48\x89\xC7\xE8\x00\x00\x00\x00\x85\xC0", (const UINT8*)"\xFF\xFF\xFF\xFF\x00\x00\x00\x00\xFF\xFF", 10 },
+  { (const UINT8*)"\x0F\x85\x00\x00\x00\x00\x48\x8B", (const UINT8*)"\xFF\xFF\x00\x00\x00\x00\xFF\xFF", 8 },
+  { (const UINT8*)"\xB9\xE2\x00\x00\x00\x0F\x30", NULL, 7 },
+  { (const UINT8*)"IOPCIIsHotplugPort", NULL, 18 },
+  { (const UINT8*)"\x83\xF8\x0F\x0F\x87", NULL, 5 },
+  { (const UINT8*)"AppleIntelCPUPowerManagement", NULL, 28 },
+};
+
+typedef struct {
+  UINT8  *Kernel;
+  size_t  KernelSize;
+} BENCH_KERNEL;
+
+static void BenchSearchAndReplaceMask(void* Context)
+{
+  BENCH_KERNEL* Kernel = (BENCH_KERNEL*)Context;
+  for (size_t i = 0; i < sizeof(BenchPatterns) / sizeof(BenchPatterns[0]); i++) {
+    const BENCH_PATTERN& Pattern = BenchPatterns[i];
+    SearchAndReplaceMask(Kernel->Kernel, Kernel->KernelSize, Pattern.Search, Pattern.Mask, Pattern.Size,
+                         Pattern.Search, NULL, 0, 0);
+  }
+}
+
+//
+// Checksums, over the kernel buffer
+//
+static void BenchAdler32(void* Context)
+{
+  BENCH_KERNEL* Kernel = (BENCH_KERNEL*)Context;
+  Adler32(1, Kernel->Kernel, Kernel->KernelSize);
+}
+
+#if defined(JIEF_DEBUG) && defined(CLOVER_BUILD)
+//
+// Graphics and ACPI, only in Clover for now, like their tests
+//
+typedef struct {
+  XImage  *Background;
+  XImage  *Icon;
+} BENCH_COMPOSE;
+
+static void BenchCompose(void* Context)
+{
+  BENCH_COMPOSE* Compose = (BENCH_COMPOSE*)Context;
+  Compose->Background->Compose(384, 256, *Compose->Icon, false);
+}
+
+typedef struct {
+  NSVGrasterizer  *Rasterizer;
+  NSVGimage       *Image;
+  UINT8           *Pixels;
+  int              Width;
+  int              Height;
+} BENCH_SVG;
+
+static void BenchRasterize(void* Context)
+{
+  BENCH_SVG* Svg = (BENCH_SVG*)Context;
+  nsvgRasterize(Svg->Rasterizer, Svg->Image, 0, 0, 1.f, 1.f, Svg->Pixels, Svg->Width, Svg->Height, Svg->Width * 4);
+}
+
+typedef struct {
+  const UINT8                               *Dsdt;
+  size_t                                     DsdtSize;
+  UINT8                                     *Buffer;
+  EFI_ACPI_2_0_FIXED_ACPI_DESCRIPTION_TABLE *Fadt;
+} BENCH_DSDT;
+
+static void BenchFixBiosDsdt(void* Context)
+{
+  BENCH_DSDT* Dsdt = (BENCH_DSDT*)Context;
+  CopyMem(Dsdt->Buffer, Dsdt->Dsdt, Dsdt->DsdtSize);
+  FixBiosDsdt(Dsdt->Buffer, Dsdt->Fadt, MacOsVersion());
+}
+#endif
+
+void all_benchmarks(const BENCHMARK_INPUTS& Inputs)
+{
+  Bench("XString8.strcat_16x256", 20000, BenchXString8Strcat, NULL);
+  Bench("XString8.S8Catf_x100", 5000, BenchXString8S8Catf, NULL);
+
+  // 4 KiB of mostly ASCII text, with a few accented letters
+  XString8 Utf8;
+  for (int i = 0; i < 128; i++) {
+    Utf8.strcat(i % 8 == 0 ? "Cr\xC3\xA9" "dits bootloader " : "Clover bootloader : ABCDEFGHIJK ");
+  }
+  XStringW Utf16;
+  Utf16.takeValueFrom(Utf8);
+  Bench("XStringW.takeValueFrom_utf8_4k", 20000, BenchXStringWFromUtf8, (void*)Utf8.c_str());
+  Bench("XString8.takeValueFrom_utf16_4k", 20000, BenchXString8FromUtf16, (void*)Utf16.wc_str());
+
+  Bench("XArray.Add_1000", 20000, BenchXArrayAdd, NULL);
+  Bench("XObjArray.AddReference_1000", 2000, BenchXObjArrayAdd, NULL);
+  Bench("XVector.emplace_back_1000", 2000, BenchXVectorAdd, NULL);
+
+  BENCH_CONFIG Config = { Inputs.Config, Inputs.ConfigSize };
+#ifndef _MSC_VER
+  if (Config.Config == NULL) {
+    Config.Config = config_all;
+    Config.ConfigSize = strlen(config_all);
+  }
+#endif
+  if (Config.Config != NULL) {
+    Bench("plist.ParseXML", 200, BenchParseXML, &Config);
+    Bench("plist.ParseXMLView", 200, BenchParseXMLView, &Config);
+  }
+
+  BENCH_KERNEL Kernel = { Inputs.Kernel, Inputs.KernelSize };
+  UINT8* RandomKernel = NULL;
+  if (Kernel.Kernel == NULL) {
+    // 16 MiB, about the size of a kernelcache. Few matches, like in a real one.
+    Kernel.KernelSize = 16 * 1024 * 1024;
+    RandomKernel = (UINT8*)malloc(Kernel.KernelSize);
+    if (RandomKernel != NULL) {
+      UINT32 Seed = 1;
+      for (size_t i = 0; i < Kernel.KernelSize; i++) {
+        Seed = Seed * 1103515245 + 12345;
+        RandomKernel[i] = (UINT8)(Seed >> 16);
+      }
+    }
+    Kernel.Kernel = RandomKernel;
+  }
+  if (Kernel.Kernel != NULL) {
+    Bench("SearchAndReplaceMask.6_patterns", 10, BenchSearchAndReplaceMask, &Kernel);
+    // SSSE3 only if GetCPUProperties() found it
+    BOOLEAN Simd = Adler32GetSimd();
+    Adler32SetSimd(FALSE);
+    Bench("Adler32.scalar", 10, BenchAdler32, &Kernel);
+    Adler32SetSimd(Simd);
+    if (Simd) {
+      Bench("Adler32.ssse3", 10, BenchAdler32, &Kernel);
+    }
+  }
+  if (RandomKernel != NULL) {
+    free(RandomKernel);
+  }
+
+#if defined(JIEF_DEBUG) && defined(CLOVER_BUILD)
+  XImage Background(1024, 768);
+  XImage Icon(256, 256);
+  Background.Fill(EFI_GRAPHICS_OUTPUT_BLT_PIXEL{ 0x40, 0x30, 0x20, 0xFF });
+  Icon.Fill(EFI_GRAPHICS_OUTPUT_BLT_PIXEL{ 0x80, 0x90, 0xA0, 0x80 });
+  EG_RECT Transparent(0, 0, 64, 256);
+  Icon.FillArea(EFI_GRAPHICS_OUTPUT_BLT_PIXEL{ 0, 0, 0, 0 }, Transparent);
+  Icon.Premultiply();
+  BENCH_COMPOSE Compose = { &Background, &Icon };
+  Bench("XImage.Compose_256x256", 1000, BenchCompose, &Compose);
+
+  if (Inputs.Svg != NULL) {
+    // nsvgParse() writes into its input
+    char* SvgCopy = (char*)AllocateCopyPool(Inputs.SvgSize + 1, Inputs.Svg);
+    if (SvgCopy != NULL) {
+      SvgCopy[Inputs.SvgSize] = 0;
+      NSVGparser* Parser = nsvgParse(SvgCopy, 72, 1.f);
+      BENCH_SVG Svg;
+      Svg.Rasterizer = nsvgCreateRasterizer();
+      Svg.Image = Parser ? Parser->image : NULL;
+      if (Svg.Rasterizer != NULL && Svg.Image != NULL) {
+        Svg.Width = MIN(2048, MAX(1, (int)Svg.Image->width));
+        Svg.Height = MIN(2048, MAX(1, (int)Svg.Image->height));
+        Svg.Pixels = (UINT8*)AllocateZeroPool((UINTN)Svg.Width * Svg.Height * 4);
+        if (Svg.Pixels != NULL) {
+          Bench("nsvgRasterize", 5, BenchRasterize, &Svg);
+          FreePool(Svg.Pixels);
+        }
+      }
+      nsvgDeleteRasterizer(Svg.Rasterizer);
+      nsvg__deleteParser(Parser);
+      FreePool(SvgCopy);
+    }
+  }
+
+  if (Inputs.Dsdt != NULL && Inputs.DsdtSize >= sizeof(EFI_ACPI_DESCRIPTION_HEADER)) {
+    EFI_ACPI_2_0_FIXED_ACPI_DESCRIPTION_TABLE Fadt;
+    BOOLEAN DsdtCache = GlobalConfig.DsdtCache;
+    SetMem(&Fadt, sizeof(Fadt), 0);
+    GlobalConfig.DsdtCache = FALSE; // the fixes, not the cache
+    BENCH_DSDT Dsdt = { Inputs.Dsdt, Inputs.DsdtSize, (UINT8*)AllocateZeroPool(Inputs.DsdtSize + Inputs.DsdtSize / 8), &Fadt };
+    if (Dsdt.Buffer != NULL) {
+      Bench("FixBiosDsdt", 5, BenchFixBiosDsdt, &Dsdt);
+      FreePool(Dsdt.Buffer);
+    }
+    GlobalConfig.DsdtCache = DsdtCache;
+  }
+#endif
+}
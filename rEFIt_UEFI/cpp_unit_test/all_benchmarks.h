@@ -0,0 +1,22 @@
+/*
+ * Micro-benchmarks of the foundation classes and of the patch kernels.
+ * One line of JSON per benchmark on stdout, to compare commits :
+ *   {"bench":"plist.ParseXML","iterations":200,"ns_per_op":51234.5,"allocs_per_op":1342.00}
+ * allocs_per_op is null where allocations can't be counted. Other lines are logs of the code measured.
+ */
+
+// Inputs of the benchmarks, all optional.
+// Without Config, the config of plist_tests is parsed. Without Kernel, a pseudo random buffer is searched.
+// Without Svg or Dsdt, the benchmarks that need them are skipped.
+typedef struct {
+  const char   *Config;
+  size_t        ConfigSize;
+  UINT8        *Kernel;
+  size_t        KernelSize;
+  const char   *Svg;
+  size_t        SvgSize;
+  const UINT8  *Dsdt;
+  size_t        DsdtSize;
+} BENCHMARK_INPUTS;
+
+void all_benchmarks(const BENCHMARK_INPUTS& Inputs);
@@ -6,6 +6,7 @@
 
 #include "XArray_tests.h"
 #include "XObjArray_tests.h"
+#include "XVector_tests.h"
 #include "XStringArray_test.h"
 #include "XString_test.h"
 #include "strcmp_test.h"
@@ -19,9 +20,23 @@
 #include "find_replace_mask_Clover_tests.h"
 #include "find_replace_mask_OC_tests.h"
 #include "MacOsVersion_test.h"
+#include "Checksum_tests.h"
+#include "Base64_tests.h"
+#include "Sha256_tests.h"
+#include "Hex_tests.h"
+#include "AcpiPatternSet_tests.h"
+#include "DsdtIndex_tests.h"
+#include "AcpiDumpSet_tests.h"
+#include "SmbiosBuilder_tests.h"
 
+// Firmware debug build only: these tests need UEFI headers or libraries the host project doesn't have
 #if defined(JIEF_DEBUG) && defined(CLOVER_BUILD)
   #include "printlib-test.h"
+  #include "XImage_tests.h" // libeg, GraphicsOutput protocol
+  #include "nanosvg_tests.h" // libeg, Efi.h
+  #include "AmlTree_tests.h" // EFI_ACPI_DESCRIPTION_HEADER
+  #include "XsdtIndex_tests.h" // EFI_ACPI_DESCRIPTION_HEADER
+  #include "CppMemLib_tests.h" // the firmware operator new/delete
 #endif
 
 
@@ -81,6 +96,31 @@ bool all_tests()
         printf("printlib_tests() failed at test %d\n", ret);
         all_ok = false;
       }
+    ret = XImage_tests();
+      if ( ret != 0 ) {
+        printf("XImage_tests() failed at test %d\n", ret);
+        all_ok = false;
+      }
+    ret = nanosvg_tests();
+      if ( ret != 0 ) {
+        printf("nanosvg_tests() failed at test %d\n", ret);
+        all_ok = false;
+      }
+    ret = AmlTree_tests();
+      if ( ret != 0 ) {
+        printf("AmlTree_tests() failed at test %d\n", ret);
+        all_ok = false;
+      }
+    ret = XsdtIndex_tests();
+      if ( ret != 0 ) {
+        printf("XsdtIndex_tests() failed at test %d\n", ret);
+        all_ok = false;
+      }
+    ret = CppMemLib_tests();
+      if ( ret != 0 ) {
+        printf("CppMemLib_tests() failed at test %d\n", ret);
+        all_ok = false;
+      }
 #endif
 #ifndef _MSC_VER
   ret = printf_lite_tests();
@@ -119,6 +159,51 @@ bool all_tests()
     printf("XObjArray_tests() failed at test %d\n", ret);
     all_ok = false;
   }
+  ret = XVector_tests();
+  if ( ret != 0 ) {
+    printf("XVector_tests() failed at test %d\n", ret);
+    all_ok = false;
+  }
+  ret = Checksum_tests();
+  if ( ret != 0 ) {
+    printf("Checksum_tests() failed at test %d\n", ret);
+    all_ok = false;
+  }
+  ret = Base64_tests();
+  if ( ret != 0 ) {
+    printf("Base64_tests() failed at test %d\n", ret);
+    all_ok = false;
+  }
+  ret = Sha256_tests();
+  if ( ret != 0 ) {
+    printf("Sha256_tests() failed at test %d\n", ret);
+    all_ok = false;
+  }
+  ret = Hex_tests();
+  if ( ret != 0 ) {
+    printf("Hex_tests() failed at test %d\n", ret);
+    all_ok = false;
+  }
+  ret = AcpiPatternSet_tests();
+  if ( ret != 0 ) {
+    printf("AcpiPatternSet_tests() failed at test %d\n", ret);
+    all_ok = false;
+  }
+  ret = DsdtIndex_tests();
+  if ( ret != 0 ) {
+    printf("DsdtIndex_tests() failed at test %d\n", ret);
+    all_ok = false;
+  }
+  ret = AcpiDumpSet_tests();
+  if ( ret != 0 ) {
+    printf("AcpiDumpSet_tests() failed at test %d\n", ret);
+    all_ok = false;
+  }
+  ret = SmbiosBuilder_tests();
+  if ( ret != 0 ) {
+    printf("SmbiosBuilder_tests() failed at test %d\n", ret);
+    all_ok = false;
+  }
   ret = XString_tests();
   if ( ret != 0 ) {
     printf("XString_tests() failed at test %d\n", ret);
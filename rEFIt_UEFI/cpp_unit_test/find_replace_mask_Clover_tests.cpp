@@ -119,5 +119,92 @@ int find_replace_mask_Clover_tests()
     if ( memcmp(buf, expectedBuf, 3) != 0 ) breakpoint(1);
   }
 
+  // Multi-pattern : result must be the same as SearchAndReplaceMask for each pattern, in order
+  {
+    UINT8 buf[] = { 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x20, 0x13, 0x14, 0x15, 0x31, 0x32, 0x33, 0x13, 0x14, 0x15 };
+    UINT8 expectedBuf[sizeof(buf)];
+    memcpy(expectedBuf, buf, sizeof(buf));
+    SearchAndReplaceMask(expectedBuf, sizeof(expectedBuf), (UINT8*)"\x13\x14\x15", NULL, 3, (UINT8*)"\x23\x24\x25", NULL, 0, 1);
+    SearchAndReplaceMask(expectedBuf, sizeof(expectedBuf), (UINT8*)"\x17\x18\x00\x20", (UINT8*)"\xFF\xFF\x00\xFF", 4, (UINT8*)"\x27\x28\x29\x30", (UINT8*)"\xFF\x00\xFF\xFF", 0, 0);
+    SearchAndReplaceMask(expectedBuf, sizeof(expectedBuf), (UINT8*)"\x31\x32", NULL, 2, (UINT8*)"\x41\x42", NULL, 1, 0);
+    // this one searches what the first one wrote, so it can't be in the same run
+    SearchAndReplaceMask(expectedBuf, sizeof(expectedBuf), (UINT8*)"\x24\x25", NULL, 2, (UINT8*)"\x34\x35", NULL, 0, 0);
+    // no anchor
+    SearchAndReplaceMask(expectedBuf, sizeof(expectedBuf), (UINT8*)"\x16", NULL, 1, (UINT8*)"\x26", NULL, 0, 0);
+
+    MULTI_PATTERN_ENTRY entries[5];
+    memset(entries, 0, sizeof(entries));
+    entries[0].Search = (UINT8*)"\x13\x14\x15"; entries[0].SearchSize = 3; entries[0].Replace = (UINT8*)"\x23\x24\x25"; entries[0].Skip = 1;
+    entries[1].Search = (UINT8*)"\x17\x18\x00\x20"; entries[1].MaskSearch = (UINT8*)"\xFF\xFF\x00\xFF"; entries[1].SearchSize = 4;
+    entries[1].Replace = (UINT8*)"\x27\x28\x29\x30"; entries[1].MaskReplace = (UINT8*)"\xFF\x00\xFF\xFF";
+    entries[2].Search = (UINT8*)"\x31\x32"; entries[2].SearchSize = 2; entries[2].Replace = (UINT8*)"\x41\x42"; entries[2].MaxReplaces = 1;
+    entries[3].Search = (UINT8*)"\x24\x25"; entries[3].SearchSize = 2; entries[3].Replace = (UINT8*)"\x34\x35";
+    entries[4].Search = (UINT8*)"\x16"; entries[4].SearchSize = 1; entries[4].Replace = (UINT8*)"\x26";
+    MultiPatternCompile(entries, 5);
+    if ( entries[0].Run != entries[1].Run  ||  entries[1].Run != entries[2].Run ) return breakpoint(20);
+    if ( entries[3].Run == entries[2].Run ) return breakpoint(21);
+    if ( entries[4].AnchorOffset != MULTI_PATTERN_NO_ANCHOR ) return breakpoint(22);
+
+    MULTI_PATTERN_INDEX* index = new MULTI_PATTERN_INDEX;
+    for ( size_t i = 0 ; i < 5 ; i++ ) {
+      entries[i].Active = TRUE;
+      entries[i].Start = 0;
+      entries[i].Length = sizeof(buf);
+    }
+    uintn = MultiPatternApply(entries, 5, index, buf, sizeof(buf));
+    delete index;
+    if ( uintn != 7 ) return breakpoint(23);
+    if ( entries[0].NumReplaces != 2  ||  entries[2].NumReplaces != 1  ||  entries[3].NumReplaces != 2 ) return breakpoint(24);
+    if ( memcmp(buf, expectedBuf, sizeof(buf)) != 0 ) return breakpoint(25);
+  }
+
+  // SSE2 search must give the same results as the scalar one
+  {
+    BOOLEAN simd = MemoryOperationGetSimd();
+    UINT8 buf[1000];
+    UINT8 mask[40];
+    UINT8 replace[40];
+    UINT8 scalarBuf[sizeof(buf)];
+    UINT8 simdBuf[sizeof(buf)];
+    UINT32 seed = 1;
+    for ( size_t i = 0 ; i < sizeof(buf) ; i++ ) {
+      seed = seed * 1103515245 + 12345;
+      buf[i] = (UINT8)((seed >> 16) & 0x03);
+    }
+    for ( size_t i = 0 ; i < sizeof(mask) ; i++ ) {
+      mask[i] = (i % 3 == 1) ? 0xF0 : 0xFF;
+      replace[i] = (UINT8)(0x80 + i);
+    }
+    for ( size_t n = 1 ; n < sizeof(mask) ; n++ ) {
+      const UINT8* search = buf + (n * 37) % (sizeof(buf) - n);
+      // sizeof(buf)-n because scalar functions read SearchSize bytes at each offset, even at the end.
+      UINTN size = sizeof(buf) - n;
+      for ( int withMask = 0 ; withMask < 2 ; withMask++ ) {
+        const UINT8* m = withMask ? mask : NULL;
+        UINTN scalarFind, simdFind, scalarCount, simdCount, scalarReplaces, simdReplaces;
+
+        MemoryOperationSetSimd(FALSE);
+        scalarFind = FindMemMask(buf, sizeof(buf), search, n, m, n);
+        scalarCount = SearchAndCount(buf, size, search, n);
+        memcpy(scalarBuf, buf, sizeof(buf));
+        scalarReplaces = SearchAndReplaceMask(scalarBuf, size, search, m, n, replace, m, 0, 1);
+        scalarReplaces += SearchAndReplace(scalarBuf, size, search, n, replace, 2);
+
+        MemoryOperationSetSimd(TRUE);
+        simdFind = FindMemMask(buf, sizeof(buf), search, n, m, n);
+        simdCount = SearchAndCount(buf, size, search, n);
+        memcpy(simdBuf, buf, sizeof(buf));
+        simdReplaces = SearchAndReplaceMask(simdBuf, size, search, m, n, replace, m, 0, 1);
+        simdReplaces += SearchAndReplace(simdBuf, size, search, n, replace, 2);
+
+        if ( scalarFind != simdFind ) return breakpoint(30);
+        if ( scalarCount != simdCount ) return breakpoint(31);
+        if ( scalarReplaces != simdReplaces ) return breakpoint(32);
+        if ( memcmp(scalarBuf, simdBuf, sizeof(buf)) != 0 ) return breakpoint(33);
+      }
+    }
+    MemoryOperationSetSimd(simd);
+  }
+
   return 0;
 }
@@ -0,0 +1,70 @@
+#include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+#include "../libeg/nanosvg.h"
+#include "../Platform/MemoryOperation.h"
+
+static int breakpoint(int i)
+{
+  return i;
+}
+
+int nanosvg_tests()
+{
+  // SSE2 span fillers and coverage accumulation must give the same pixels as the scalar code
+  BOOLEAN simd = MemoryOperationGetSimd();
+  NSVGcachedPaint cache;
+  unsigned char cover[80];
+  unsigned char simdRow[100 * 4];
+  unsigned char refRow[100 * 4];
+  UINT32 seed = 1;
+  UINT32 ditherSeed = 12345;
+
+  for ( int pass = 0 ; pass < 600 ; pass++ ) {
+    SetMem(&cache, sizeof(cache), 0);
+    cache.ditherSeed = &ditherSeed;
+    // gradients without dithering, dither() draws random numbers
+    cache.type = pass % 3 == 0 ? NSVG_PAINT_COLOR : pass % 3 == 1 ? NSVG_PAINT_LINEAR_GRADIENT : NSVG_PAINT_RADIAL_GRADIENT;
+    for ( int i = 0 ; i < 6 ; i++ ) {
+      seed = seed * 1103515245 + 12345;
+      cache.xform[i] = (float)((int)(seed >> 16) % 2000 - 1000) / 3000.0f;
+    }
+    for ( int i = 0 ; i < 256 ; i++ ) {
+      seed = seed * 1103515245 + 12345;
+      cache.colors[i] = seed;
+    }
+    if ( pass % 6 == 0 ) cache.colors[0] |= 0xFF000000;
+    for ( size_t i = 0 ; i < sizeof(cover) ; i++ ) {
+      seed = seed * 1103515245 + 12345;
+      // empty and full coverage are the usual cases
+      cover[i] = (seed & 0x300) == 0 ? 0 : (seed & 0x300) == 0x100 ? 255 : (unsigned char)(seed >> 16);
+    }
+    for ( size_t i = 0 ; i < sizeof(simdRow) ; i++ ) {
+      seed = seed * 1103515245 + 12345;
+      simdRow[i] = refRow[i] = (unsigned char)(seed >> 16);
+    }
+    int count = pass % 77 + 1;
+    int x = pass % 13;
+    MemoryOperationSetSimd(TRUE);
+    nsvg__scanlineSolid(simdRow, count, cover, x, pass, &cache);
+    MemoryOperationSetSimd(FALSE);
+    nsvg__scanlineSolid(refRow, count, cover, x, pass, &cache);
+    if ( memcmp(simdRow, refRow, sizeof(simdRow)) != 0 ) {
+      MemoryOperationSetSimd(simd);
+      return breakpoint(1);
+    }
+
+    int x0 = (pass * 7919 % (120 << NSVG__FIXSHIFT)) - (10 << NSVG__FIXSHIFT);
+    int x1 = x0 + (pass * 104729 % (60 << NSVG__FIXSHIFT));
+    int simdMin = 100, simdMax = 0, refMin = 100, refMax = 0;
+    MemoryOperationSetSimd(TRUE);
+    nsvg__fillScanline(simdRow, 100, x0, x1, 255 / NSVG__SUBSAMPLES, &simdMin, &simdMax);
+    MemoryOperationSetSimd(FALSE);
+    nsvg__fillScanline(refRow, 100, x0, x1, 255 / NSVG__SUBSAMPLES, &refMin, &refMax);
+    if ( memcmp(simdRow, refRow, sizeof(simdRow)) != 0 || simdMin != refMin || simdMax != refMax ) {
+      MemoryOperationSetSimd(simd);
+      return breakpoint(2);
+    }
+  }
+  MemoryOperationSetSimd(simd);
+
+  return 0;
+}
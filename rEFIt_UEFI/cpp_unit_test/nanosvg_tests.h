@@ -0,0 +1 @@
+int nanosvg_tests();
@@ -0,0 +1,381 @@
+#include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+#include "../cpp_foundation/XString.h"
+#include "../cpp_foundation/XBuffer.h"
+#include "../cpp_foundation/XObjArray.h"
+#include "../Platform/plist/plist.h"
+#include "../Platform/MemoryOperation.h"
+
+#include "patch_replay.h"
+
+#if !defined(_MSC_VER)
+  #include <time.h>
+#endif
+
+#define REPLAY_DEFAULT_BINS 16
+
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+
+static UINT64 ReplayNow()
+{
+  struct timespec ts;
+#if defined(_MSC_VER)
+  timespec_get(&ts, TIME_UTC);
+#else
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+  return (UINT64)ts.tv_sec * 1000000000ull + (UINT64)ts.tv_nsec;
+}
+
+//
+// A patch of the config, as Settings.cpp builds its KEXT_PATCH : masks padded to the size of Find,
+// Replace padded with 0.
+//
+class REPLAY_PATCH
+{
+public:
+  XString8       Label;
+  XString8       Procedure;
+  XBuffer<UINT8> Find;
+  XBuffer<UINT8> MaskFind;
+  XBuffer<UINT8> Replace;
+  XBuffer<UINT8> MaskReplace;
+  XBuffer<UINT8> StartPattern;
+  XBuffer<UINT8> StartMask;
+  INTN           Count = 0;
+  INTN           Skip = 0;
+  UINTN          SearchLen = 0;
+
+  REPLAY_PATCH() {}
+  REPLAY_PATCH(const REPLAY_PATCH&) = delete;
+  REPLAY_PATCH& operator = (const REPLAY_PATCH&) = delete;
+};
+
+static const TagData* ReplayData(const TagDict* Dict, const char* Key)
+{
+  const TagStruct* Prop = Dict->propertyForKey(Key);
+  return Prop != NULL && Prop->isData() && Prop->getData()->dataLenValue() > 0 ? Prop->getData() : NULL;
+}
+
+static INTN ReplayInteger(const TagDict* Dict, const char* Key)
+{
+  const TagStruct* Prop = Dict->propertyForKey(Key);
+  return Prop != NULL && Prop->isInt64() ? Prop->getInt64()->intValue() : 0;
+}
+
+// Fill buffer with Size bytes of Fill, then as much of Data as fits
+static void ReplayPadded(XBuffer<UINT8>& Buffer, const TagData* Data, UINTN Size, UINT8 Fill)
+{
+  Buffer.memset(Fill, Size);
+  if (Data != NULL) {
+    memcpy(Buffer.data(), Data->dataValue(), MIN(Data->dataLenValue(), Size));
+  }
+}
+
+static void ReplayReadPatches(const TagDict* Patches, const char* Key, XObjArray<REPLAY_PATCH>& Out)
+{
+  const TagArray* Array = Patches->arrayPropertyForKey(Key);
+  if (Array == NULL) {
+    return;
+  }
+  for (size_t i = 0; i < Array->arrayContent().size(); i++) {
+    const TagDict* Dict = Array->dictElementAt(i, XString8(Key));
+    const TagStruct* Prop;
+    if (Dict == NULL) {
+      continue;
+    }
+    Prop = Dict->propertyForKey("Disabled");
+    if (Prop != NULL && Prop->isTrue()) {
+      continue;
+    }
+    // Info.plist patches are text replaces in a kext plist, not in the image
+    Prop = Dict->propertyForKey("InfoPlistPatch");
+    if (Prop != NULL && Prop->isTrue()) {
+      continue;
+    }
+    const TagData* Find = ReplayData(Dict, "Find");
+    const TagData* Replace = ReplayData(Dict, "Replace");
+    if (Find == NULL || Replace == NULL) {
+      continue;
+    }
+
+    REPLAY_PATCH* Patch = new REPLAY_PATCH;
+    UINTN FindLen = Find->dataLenValue();
+    Prop = Dict->propertyForKey("Comment");
+    Patch->Label = Prop != NULL && Prop->isString() ? Prop->getString()->stringValue() : "NoLabel"_XS8;
+    Prop = Dict->propertyForKey("Procedure");
+    if (Prop != NULL && Prop->isString()) {
+      Patch->Procedure = Prop->getString()->stringValue();
+    }
+    Patch->Find.ncpy(Find->dataValue(), FindLen);
+    ReplayPadded(Patch->Replace, Replace, FindLen, 0);
+    if (ReplayData(Dict, "MaskFind") != NULL) {
+      ReplayPadded(Patch->MaskFind, ReplayData(Dict, "MaskFind"), FindLen, 0xFF);
+    }
+    if (ReplayData(Dict, "MaskReplace") != NULL) {
+      ReplayPadded(Patch->MaskReplace, ReplayData(Dict, "MaskReplace"), FindLen, 0);
+    }
+    const TagData* Start = ReplayData(Dict, "StartPattern");
+    if (Start != NULL) {
+      Patch->StartPattern.ncpy(Start->dataValue(), Start->dataLenValue());
+      ReplayPadded(Patch->StartMask, ReplayData(Dict, "MaskStart"), Start->dataLenValue(), 0xFF);
+    }
+    Patch->Count = ReplayInteger(Dict, "Count");
+    Patch->Skip = ReplayInteger(Dict, "Skip");
+    Patch->SearchLen = (UINTN)ReplayInteger(Dict, "RangeFind");
+    Out.AddReference(Patch, true);
+  }
+}
+
+//
+// Minimal Mach-O 64 symbol lookup, for the Procedure of a patch.
+// Returns the file offset of the procedure, and its length up to the next symbol in *Length.
+// Exact name first, then with a leading underscore, then the first name containing it, like searchProc().
+//
+static UINT32 ReplayRead32(const UINT8* p) { UINT32 v; memcpy(&v, p, 4); return v; }
+static UINT64 ReplayRead64(const UINT8* p) { UINT64 v; memcpy(&v, p, 8); return v; }
+
+static UINTN ReplayFindProc(const UINT8* Image, UINTN Size, const XString8& Name, UINTN* Length)
+{
+  *Length = 0;
+  if (Name.isEmpty() || Size < 32 || ReplayRead32(Image) != 0xFEEDFACF) {
+    return 0;
+  }
+  UINT32 NumCmds = ReplayRead32(Image + 16);
+  UINTN  Cmd = 32;
+  UINTN  SymOff = 0, NumSyms = 0, StrOff = 0, StrSize = 0;
+  UINTN  Segments[16][3]; // vmaddr, vmsize, fileoff
+  UINTN  NumSegments = 0;
+  for (UINT32 i = 0; i < NumCmds && Cmd + 8 <= Size; i++) {
+    UINT32 Type = ReplayRead32(Image + Cmd);
+    UINT32 CmdSize = ReplayRead32(Image + Cmd + 4);
+    if (CmdSize < 8 || Cmd + CmdSize > Size) {
+      break;
+    }
+    if (Type == 0x19 /* LC_SEGMENT_64 */ && CmdSize >= 56 && NumSegments < 16) {
+      Segments[NumSegments][0] = (UINTN)ReplayRead64(Image + Cmd + 24);
+      Segments[NumSegments][1] = (UINTN)ReplayRead64(Image + Cmd + 32);
+      Segments[NumSegments][2] = (UINTN)ReplayRead64(Image + Cmd + 40);
+      NumSegments++;
+    } else if (Type == 0x2 /* LC_SYMTAB */ && CmdSize >= 24) {
+      SymOff = ReplayRead32(Image + Cmd + 8);
+      NumSyms = ReplayRead32(Image + Cmd + 12);
+      StrOff = ReplayRead32(Image + Cmd + 16);
+      StrSize = ReplayRead32(Image + Cmd + 20);
+    }
+    Cmd += CmdSize;
+  }
+  if (NumSyms == 0 || SymOff + NumSyms * 16 > Size || StrOff + StrSize > Size) {
+    return 0;
+  }
+
+  const char* Names = (const char*)Image + StrOff;
+  INTN Found = -1;
+  for (int Pass = 0; Pass < 3 && Found < 0; Pass++) {
+    for (UINTN i = 0; i < NumSyms && Found < 0; i++) {
+      const UINT8* Sym = Image + SymOff + i * 16;
+      UINT32 StrIndex = ReplayRead32(Sym);
+      if (StrIndex == 0 || StrIndex >= StrSize || (Sym[4] & 0x0E) != 0x0E /* N_SECT */) {
+        continue;
+      }
+      const char* SymName = Names + StrIndex;
+      if ((Pass == 0 && strcmp(SymName, Name.c_str()) == 0) ||
+          (Pass == 1 && SymName[0] == '_' && strcmp(SymName + 1, Name.c_str()) == 0) ||
+          (Pass == 2 && strstr(SymName, Name.c_str()) != NULL)) {
+        Found = (INTN)i;
+      }
+    }
+  }
+  if (Found < 0) {
+    return 0;
+  }
+
+  UINT64 Addr = ReplayRead64(Image + SymOff + (UINTN)Found * 16 + 8);
+  UINT64 Next = MAX_UINT64;
+  for (UINTN i = 0; i < NumSyms; i++) {
+    const UINT8* Sym = Image + SymOff + i * 16;
+    UINT64 Value = ReplayRead64(Sym + 8);
+    if ((Sym[4] & 0x0E) == 0x0E && Value > Addr && Value < Next) {
+      Next = Value;
+    }
+  }
+  for (UINTN s = 0; s < NumSegments; s++) {
+    if (Addr >= Segments[s][0] && Addr < Segments[s][0] + Segments[s][1]) {
+      UINTN Offset = (UINTN)(Addr - Segments[s][0]) + Segments[s][2];
+      if (Offset >= Size) {
+        return 0;
+      }
+      if (Next != MAX_UINT64) {
+        *Length = MIN((UINTN)(Next - Addr), Size - Offset);
+      }
+      return Offset;
+    }
+  }
+  return 0;
+}
+
+// Matches of Find per bin of the image, printed as a JSON array
+static void ReplayPrintHits(const UINT8* Image, UINTN Size, const REPLAY_PATCH& Patch, UINTN Bins)
+{
+  UINTN* Hits = (UINTN*)calloc(Bins, sizeof(UINTN));
+  UINTN  BinSize = (Size + Bins - 1) / Bins;
+  UINTN  Offset = 0;
+  const UINT8* Mask = Patch.MaskFind.size() ? Patch.MaskFind.data() : NULL;
+  while (Hits != NULL && Offset < Size) {
+    UINTN Pos = FindMemMask(Image + Offset, Size - Offset, Patch.Find.data(), Patch.Find.size(), Mask, Patch.Find.size());
+    if (Pos == MAX_UINTN) {
+      break;
+    }
+    Hits[(Offset + Pos) / BinSize] += 1;
+    Offset += Pos + 1;
+  }
+  printf("[");
+  for (UINTN i = 0; i < Bins; i++) {
+    printf("%s%llu", i ? "," : "", (unsigned long long)(Hits ? Hits[i] : 0));
+  }
+  printf("]");
+  free(Hits);
+}
+
+//
+// Same steps as LOADER_ENTRY::KernelUserPatch() for a patch that is not compiled.
+// *Scanned is the number of bytes given to SearchAndReplaceMask().
+//
+static UINTN ReplayApply(UINT8* Image, UINTN Size, const REPLAY_PATCH& Patch, UINT64* Scanned)
+{
+  UINTN  Replaces = 0;
+  UINTN  ProcLen = 0;
+  UINTN  ProcAddr = ReplayFindProc(Image, Size, Patch.Procedure, &ProcLen);
+  UINTN  SearchLen = Patch.SearchLen;
+  bool   Once = false;
+  const UINT8* MaskFind = Patch.MaskFind.size() ? Patch.MaskFind.data() : NULL;
+  const UINT8* MaskReplace = Patch.MaskReplace.size() ? Patch.MaskReplace.data() : NULL;
+
+  *Scanned = 0;
+  if (SearchLen == 0) {
+    SearchLen = Size;
+    if (ProcLen == 0) {
+      ProcLen = Size - ProcAddr;
+    }
+    Once = true;
+  } else {
+    ProcLen = SearchLen;
+  }
+  for (UINTN j = ProcAddr; j < Size; j++) {
+    UINTN Len = MIN(ProcLen, Size - j);
+    if (Patch.StartPattern.size() == 0 ||
+        (Patch.StartPattern.size() <= Size - j &&
+         CompareMemMask(Image + j, Patch.StartPattern.data(), Patch.StartPattern.size(),
+                        Patch.StartMask.data(), Patch.StartPattern.size()))) {
+      UINTN Num = SearchAndReplaceMask(Image + j, Len, Patch.Find.data(), MaskFind, Patch.Find.size(),
+                                       Patch.Replace.data(), MaskReplace, Patch.Count, Patch.Skip);
+      *Scanned += Len;
+      Replaces += Num;
+      if (Num) {
+        j += SearchLen - 1;
+      }
+      if (Once || Patch.StartPattern.size() == 0) {
+        break;
+      }
+    }
+  }
+  return Replaces;
+}
+
+// The patches of one list one by one, then all of them compiled in one MultiPatternApply() on a fresh copy
+static void ReplayList(const char* List, const XObjArray<REPLAY_PATCH>& Patches, UINT8* Image, UINTN Size, UINTN Bins)
+{
+  UINT8* Original = (UINT8*)malloc(Size);
+  if (Original == NULL) {
+    return;
+  }
+  memcpy(Original, Image, Size);
+
+  UINT64 Total = 0;
+  for (size_t i = 0; i < Patches.size(); i++) {
+    const REPLAY_PATCH& Patch = Patches[i];
+    printf("{\"replay\":\"%s\",\"index\":%zu,\"label\":\"%s\",\"hits\":", List, i, Patch.Label.c_str());
+    ReplayPrintHits(Image, Size, Patch, Bins);
+    UINT64 Scanned;
+    UINT64 Start = ReplayNow();
+    UINTN Replaces = ReplayApply(Image, Size, Patch, &Scanned);
+    UINT64 Ns = ReplayNow() - Start;
+    Total += Ns;
+    printf(",\"ns\":%llu,\"scanned\":%llu,\"replaces\":%llu}\n",
+           (unsigned long long)Ns, (unsigned long long)Scanned, (unsigned long long)Replaces);
+  }
+  printf("{\"replay\":\"%s\",\"engine\":\"SearchAndReplaceMask\",\"patches\":%zu,\"ns\":%llu}\n",
+         List, Patches.size(), (unsigned long long)Total);
+
+  // Patches with a StartPattern stay out of the multi-pattern pass, like in CompilePatchEntries()
+  MULTI_PATTERN_ENTRY* Entries = (MULTI_PATTERN_ENTRY*)calloc(Patches.size() + 1, sizeof(MULTI_PATTERN_ENTRY));
+  MULTI_PATTERN_INDEX* Index = (MULTI_PATTERN_INDEX*)malloc(sizeof(MULTI_PATTERN_INDEX));
+  UINT8* Copy = (UINT8*)malloc(Size);
+  if (Entries != NULL && Index != NULL && Copy != NULL) {
+    size_t Compiled = 0;
+    for (size_t i = 0; i < Patches.size(); i++) {
+      const REPLAY_PATCH& Patch = Patches[i];
+      MULTI_PATTERN_ENTRY& Entry = Entries[i];
+      if (Patch.StartPattern.size() != 0) {
+        continue;
+      }
+      UINTN ProcLen = 0;
+      Entry.Search = Patch.Find.data();
+      Entry.MaskSearch = Patch.MaskFind.size() ? Patch.MaskFind.data() : NULL;
+      Entry.SearchSize = Patch.Find.size();
+      Entry.Replace = Patch.Replace.data();
+      Entry.MaskReplace = Patch.MaskReplace.size() ? Patch.MaskReplace.data() : NULL;
+      Entry.MaxReplaces = Patch.Count;
+      Entry.Skip = Patch.Skip;
+      Entry.Active = TRUE;
+      Entry.Start = ReplayFindProc(Original, Size, Patch.Procedure, &ProcLen);
+      if (Patch.SearchLen != 0) {
+        Entry.Length = MIN(Patch.SearchLen, Size - Entry.Start);
+      } else if (ProcLen != 0) {
+        Entry.Length = ProcLen;
+      } else {
+        Entry.Length = Size - Entry.Start;
+      }
+      Compiled++;
+    }
+    memcpy(Copy, Original, Size);
+    UINT64 Start = ReplayNow();
+    MultiPatternCompile(Entries, Patches.size());
+    UINT64 CompileNs = ReplayNow() - Start;
+    Start = ReplayNow();
+    UINTN Replaces = MultiPatternApply(Entries, Patches.size(), Index, Copy, Size);
+    UINT64 ApplyNs = ReplayNow() - Start;
+    printf("{\"replay\":\"%s\",\"engine\":\"MultiPatternApply\",\"patches\":%zu,\"compile_ns\":%llu,\"ns\":%llu,\"replaces\":%llu}\n",
+           List, Compiled, (unsigned long long)CompileNs, (unsigned long long)ApplyNs, (unsigned long long)Replaces);
+  }
+  free(Copy);
+  free(Index);
+  free(Entries);
+  free(Original);
+}
+
+int patch_replay(const PATCH_REPLAY_INPUTS& Inputs)
+{
+  TagDict* Dict = NULL;
+  if (Inputs.Config == NULL || Inputs.Kernel == NULL ||
+      EFI_ERROR(ParseXML(Inputs.Config, &Dict, Inputs.ConfigSize))) {
+    return -1;
+  }
+  UINTN Bins = Inputs.Bins ? Inputs.Bins : REPLAY_DEFAULT_BINS;
+  XObjArray<REPLAY_PATCH> KernelPatches;
+  XObjArray<REPLAY_PATCH> KextPatches;
+  const TagDict* Patches = Dict->dictPropertyForKey("KernelAndKextPatches");
+  if (Patches != NULL) {
+    ReplayReadPatches(Patches, "KernelToPatch", KernelPatches);
+    ReplayReadPatches(Patches, "KextsToPatch", KextPatches);
+  }
+
+  // Kernel patches first, as in KernelAndKextPatcherInit() + KernelUserPatch(), then the kexts on the patched image
+  ReplayList("kernel", KernelPatches, Inputs.Kernel, Inputs.KernelSize, Bins);
+  ReplayList("kext", KextPatches, Inputs.Kernel, Inputs.KernelSize, Bins);
+
+  int Count = (int)(KernelPatches.size() + KextPatches.size());
+  Dict->FreeTag();
+  return Count;
+}
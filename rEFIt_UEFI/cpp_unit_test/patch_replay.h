@@ -0,0 +1,19 @@
+/*
+ * Offline replay of the KernelToPatch and KextsToPatch patches of a config.plist on a dumped kernel,
+ * to measure the patch engines against real kernels without rebooting. Host only.
+ * One line of JSON per patch on stdout, then one per engine pass :
+ *   {"replay":"kernel","index":3,"label":"xcpm_bootstrap","ns":81234,"scanned":14680064,"replaces":1,"hits":[0,0,1,0]}
+ * hits is the number of matches of Find in each bin of the image, before the patch is applied.
+ */
+
+// The kernel buffer is patched in place.
+typedef struct {
+  const char   *Config;
+  size_t        ConfigSize;
+  UINT8        *Kernel;
+  size_t        KernelSize;
+  UINTN         Bins;         // bins of the hit map, 0 for the default
+} PATCH_REPLAY_INPUTS;
+
+// Returns the number of patches replayed, -1 if the config can't be parsed.
+int patch_replay(const PATCH_REPLAY_INPUTS& Inputs);
@@ -908,6 +908,41 @@ kk</string> \
 </dict> \
 </plist>";
 
+// python plistlib.dumps(fmt=FMT_BINARY) of bplist_xml
+const unsigned char bplist[] =
+"\x62\x70\x6c\x69\x73\x74\x30\x30\xd7\x01\x02\x03\x04\x05\x06\x07\x08\x09\x12\x13\x14\x1a\x1b\x53"
+"\x42\x69\x67\x54\x42\x6f\x6f\x74\x54\x44\x61\x74\x61\x54\x44\x61\x74\x65\x54\x4c\x69\x73\x74\x54"
+"\x4e\x61\x6d\x65\x53\x4e\x65\x67\x13\x00\x00\x00\x01\x23\x45\x67\x89\xd4\x0a\x0b\x0c\x0d\x0e\x0f"
+"\x10\x11\x59\x41\x72\x67\x75\x6d\x65\x6e\x74\x73\x55\x44\x65\x62\x75\x67\x5f\x10\x0f\x4e\x6f\x45"
+"\x61\x72\x6c\x79\x50\x72\x6f\x67\x72\x65\x73\x73\x57\x54\x69\x6d\x65\x6f\x75\x74\x52\x2d\x76\x09"
+"\x08\x10\x05\x43\x01\x02\x03\x33\x41\xc2\x79\x48\xe0\x00\x00\x00\xa3\x15\x16\x17\x10\x01\x53\x74"
+"\x77\x6f\xd1\x18\x19\x51\x6b\x51\x76\x64\x00\x63\x00\x61\x00\x66\x00\xe9\x13\xff\xff\xff\xff\xff"
+"\xff\xff\xfd\x08\x17\x1b\x20\x25\x2a\x2f\x34\x38\x41\x4a\x54\x5a\x6c\x74\x77\x78\x79\x7b\x7f\x88"
+"\x8c\x8e\x92\x95\x97\x99\xa2\x00\x00\x00\x00\x00\x00\x01\x01\x00\x00\x00\x00\x00\x00\x00\x1c\x00"
+"\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\xab";
+
+const char* bplist_xml =
+"<plist version=\"1.0\"><dict> \
+  <key>Big</key><integer>4886718345</integer> \
+  <key>Boot</key> \
+  <dict> \
+    <key>Arguments</key><string>-v</string> \
+    <key>Debug</key><true/> \
+    <key>NoEarlyProgress</key><false/> \
+    <key>Timeout</key><integer>5</integer> \
+  </dict> \
+  <key>Data</key><data>AQID</data> \
+  <key>Date</key><date>2020-08-23T12:00:00Z</date> \
+  <key>List</key> \
+  <array> \
+    <integer>1</integer> \
+    <string>two</string> \
+    <dict><key>k</key><string>v</string></dict> \
+  </array> \
+  <key>Name</key><string>caf\xc3\xa9</string> \
+  <key>Neg</key><integer>-3</integer> \
+</dict></plist>";
+
 int plist_tests()
 {
   TagDict* dict = NULL;
@@ -925,6 +960,47 @@ int plist_tests()
     }
   }
 
+  TagDict* dict3 = NULL;
+  Status = ParseXMLView(config_all, &dict3, (UINT32)strlen(config_all));
+  if ( EFI_ERROR(Status) ) return 2;
+  if ( !(*dict).debugIsEqual(*dict3, "plist view"_XS8) ) return 3;
+  dict3->FreeTag();
+
+  const char* entities = "<plist><dict><key>a</key><string>&lt;x&gt;</string><key>c</key><string>d</string></dict></plist>";
+  Status = ParseXMLView(entities, &dict3, 0);
+  if ( EFI_ERROR(Status) ) return 4;
+  const TagStruct* prop = dict3->propertyForKey("a");
+  if ( prop == NULL  ||  !prop->isString()  ||  prop->getString()->stringValue() != "<x>"_XS8 ) return 5;
+  prop = dict3->propertyForKey("c");
+  if ( prop == NULL  ||  !prop->isString()  ||  prop->getString()->stringValue() != "d"_XS8 ) return 6;
+  dict3->FreeTag();
+
+  // big enough to be indexed
+  XString8 big = "<plist><dict>"_XS8;
+  for (int i = 0 ; i < 100 ; i++) big.S8Catf("<key>Key%d</key><integer>%d</integer>", i, i);
+  big += "<key>dup</key><integer>1</integer><key>DUP</key><integer>2</integer><key>k</key><key>v</key><integer>3</integer></dict></plist>"_XS8;
+  Status = ParseXML(big.c_str(), &dict3, big.length());
+  if ( EFI_ERROR(Status) ) return 7;
+  for (int i = 0 ; i < 100 ; i++) {
+    prop = dict3->propertyForKey(S8Printf("KEY%d", i).c_str());
+    if ( prop == NULL  ||  !prop->isInt64()  ||  prop->getInt64()->intValue() != i ) return 8;
+  }
+  prop = dict3->propertyForKey("Dup");
+  if ( prop == NULL  ||  prop->getInt64()->intValue() != 1 ) return 9;
+  if ( dict3->propertyForKey("k") != NULL ) return 10;
+  if ( dict3->propertyForKey("Key100") != NULL ) return 11;
+  dict3->FreeTag();
+
+  Status = ParseXML(bplist_xml, &dict, 0);
+  if ( EFI_ERROR(Status) ) return 12;
+  Status = ParseXML((const CHAR8*)bplist, &dict3, sizeof(bplist) - 1);
+  if ( EFI_ERROR(Status) ) return 13;
+  if ( !(*dict).debugIsEqual(*dict3, "bplist"_XS8) ) return 14;
+  dict3->FreeTag();
+  Status = ParseXML((const CHAR8*)bplist, &dict3, sizeof(bplist) - 2); // truncated
+  if ( !EFI_ERROR(Status) ) return 15;
+  dict->FreeTag();
+
   return 0;
 }
 
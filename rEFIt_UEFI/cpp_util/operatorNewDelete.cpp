@@ -1,4 +1,9 @@
 #include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+#include "operatorNewDelete.h"
+
+extern "C" {
+#include <Library/CppMemLib.h>
+}
 
 #if 0
 #define DBG(...) DebugLog(2, __VA_ARGS__)
@@ -12,9 +17,9 @@ void* operator new  (size_t count)
 void* operator new  (unsigned long count)
 #endif
 {
-	void* ptr = AllocatePool(count);
+	void* ptr = CppMemAllocate(count);
 	if ( !ptr ) {
-		DebugLog(2, "AllocatePool(%lu) returned NULL. Cpu halted\n", count);
+		DebugLog(2, "CppMemAllocate(%lu) returned NULL. Cpu halted\n", count);
 		CpuDeadLoop();
 	}
 	return ptr;
@@ -26,9 +31,9 @@ void* operator new[]  (size_t count)
 void* operator new[]  (unsigned long count)
 #endif
 {
-  void* ptr = AllocatePool(count);
+  void* ptr = CppMemAllocate(count);
   if ( !ptr ) {
-    DebugLog(2, "AllocatePool(%lu) returned NULL. Cpu halted\n", count);
+    DebugLog(2, "CppMemAllocate(%lu) returned NULL. Cpu halted\n", count);
     CpuDeadLoop();
   }
   return ptr;
@@ -39,7 +44,12 @@ void* operator new[]  (unsigned long count)
 #endif
 void operator delete  ( void* ptr ) noexcept
 {
-	return FreePool(ptr);
+	return CppMemFree(ptr);
+}
+
+void operator delete[]  ( void* ptr ) noexcept
+{
+  return CppMemFree(ptr);
 }
 
 #ifdef _MSC_VER
@@ -48,7 +58,7 @@ void _cdecl operator delete (void * ptr, unsigned __int64 count)
 void operator delete (void * ptr, UINTN count)
 #endif
 {
-  return FreePool(ptr);
+  return CppMemFree(ptr);
 }
 
 
@@ -58,8 +68,25 @@ void _cdecl operator delete[](void * ptr, unsigned __int64 count)
 void operator delete[](void * ptr, UINTN count)
 #endif
 {
-  return FreePool(ptr);
+  return CppMemFree(ptr);
 }
 
 
+// one line per size class used, in the boot log
+void LogNewDeleteStats()
+{
+  CPP_MEM_STATS Stats;
+  UINTN         Class;
 
+  CppMemGetStats(&Stats);
+  MsgLog("operator new: %d chunks of %d pages, %lld large allocs, %lld large frees\n",
+         Stats.Chunks, CPP_MEM_CHUNK_PAGES, Stats.LargeAllocs, Stats.LargeFrees);
+  for (Class = 0; Class < CPP_MEM_CLASS_COUNT; Class++) {
+    const CPP_MEM_CLASS_STATS& Size = Stats.Class[Class];
+    if (Size.Allocs == 0) {
+      continue;
+    }
+    MsgLog("  %4d bytes: %d chunks, %lld allocs, %lld frees, %lld in use, peak %lld\n",
+           Size.BlockSize, Size.Chunks, Size.Allocs, Size.Frees, Size.InUse, Size.PeakInUse);
+  }
+}
@@ -1,3 +1,8 @@
+/*
+ * Sizes and counts of the blocks allocated by operator new, see Library/CppMemLib
+ */
+void LogNewDeleteStats();
+
 #ifdef __cplusplus
 extern "C" {
 #endif
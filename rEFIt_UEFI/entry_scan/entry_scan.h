@@ -66,6 +66,8 @@ void AddCustomLegacy(void);
 void ScanLoader(void);
 void AddCustomEntries(void);
 BOOLEAN IsCustomBootEntry(IN LOADER_ENTRY *Entry);
+BOOLEAN FetchNextEntryInfo(void);
+BOOLEAN EntryInfoPending(void);
 
 // tool
 void ScanTool(void);
@@ -124,6 +126,13 @@ void *GetAuthorizedDatabase(UINTN *DatabaseSize);
 EFI_STATUS SetAuthorizedDatabase(IN void  *Database,
                                  IN UINTN  DatabaseSize);
 EFI_STATUS ClearAuthorizedDatabase(void);
+// changes of the authorized database between Begin and End are written once, by End
+void BeginAuthorizedDatabaseBatch(void);
+EFI_STATUS EndAuthorizedDatabaseBatch(void);
+// Authenticode SHA-256 (32 bytes) of a PE image, FALSE if it is not a valid image
+BOOLEAN GetImageHash(IN  void   *FileBuffer,
+                     IN  UINT64  FileSize,
+                     OUT UINT8  *Hash);
 void *GetImageSignatureDatabase(IN void    *FileBuffer,
                                 IN UINT64   FileSize,
                                 IN UINTN   *DatabaseSize,
@@ -199,6 +199,9 @@ void ScanLegacy(void)
   for (VolumeIndex = 0; VolumeIndex < Volumes.size(); VolumeIndex++) {
     Volume = &Volumes[VolumeIndex];
 //    DBG("test VI=%d\n", VolumeIndex);
+    if (Volume->MenuScanned) {
+      continue; // its entries are in the menu already
+    }
     if ((Volume->BootType != BOOTING_BY_PBR) &&
         (Volume->BootType != BOOTING_BY_MBR) &&
         (Volume->BootType != BOOTING_BY_CD)) {
@@ -300,6 +303,9 @@ void AddCustomLegacy(void)
     }
     for (VolumeIndex = 0; VolumeIndex < Volumes.size(); ++VolumeIndex) {
       Volume = &Volumes[VolumeIndex];
+      if (Volume->MenuScanned) {
+        continue;
+      }
       
       DBG("   Checking volume \"%ls\" (%ls) ... ", Volume->VolName.wc_str(), Volume->DevicePathString.wc_str());
       
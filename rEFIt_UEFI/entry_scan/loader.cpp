@@ -49,6 +49,7 @@
 #include "Self.h"
 #include "../include/OsType.h"
 #include "../Platform/BootOptions.h"
+#include "../Platform/BootTimeline.h"
 
 #ifndef DEBUG_ALL
 #define DEBUG_SCAN_LOADER 1
@@ -69,7 +70,6 @@ const XStringW LINUX_ISSUE_PATH = L"\\etc\\issue"_XSW;
 #define LINUX_BOOT_ALT_PATH L"\\boot"
 const XString8 LINUX_LOADER_PATH = "vmlinuz"_XS8;
 const XStringW LINUX_FULL_LOADER_PATH = SWPrintf("%ls\\%s", LINUX_BOOT_PATH, LINUX_LOADER_PATH.c_str());
-#define LINUX_LOADER_SEARCH_PATH L"vmlinuz*"
 const XString8Array LINUX_DEFAULT_OPTIONS = Split<XString8Array>("ro add_efi_memmap quiet splash vt.handoff=7", " ");
 
 #if defined(MDE_CPU_X64)
@@ -215,8 +215,25 @@ CONST XStringW OSXInstallerPaths[] = {
 
 STATIC CONST UINTN OSXInstallerPathsCount = (sizeof(OSXInstallerPaths) / sizeof(OSXInstallerPaths[0]));
 
-STATIC INTN TimeCmp(IN EFI_TIME *Time1,
-                    IN EFI_TIME *Time2)
+// Set by ScanLoader() for the volume being scanned, so the many candidate paths
+// are answered from directory listings instead of one Open() each
+STATIC FILE_PROBE *ScanProbe = NULL;
+
+STATIC BOOLEAN ScanFileExists(const EFI_FILE *Root, const XStringW& RelativePath)
+{
+  if (ScanProbe != NULL && ScanProbe->root() == Root) {
+    return ScanProbe->FileExists(RelativePath);
+  }
+  return FileExists(Root, RelativePath);
+}
+
+STATIC BOOLEAN ScanFileExists(const EFI_FILE *Root, const CHAR16 *RelativePath)
+{
+  return ScanFileExists(Root, XStringW().takeValueFrom(RelativePath));
+}
+
+STATIC INTN TimeCmp(IN CONST EFI_TIME *Time1,
+                    IN CONST EFI_TIME *Time2)
 {
    INTN Comparison;
    if (Time1 == NULL) {
@@ -343,40 +360,151 @@ STATIC CONST XStringW& LinuxIconNameFromPath(IN CONST XStringW& Path,
   return linux;
 }
 
-STATIC CONST XString8 LinuxInitImagePath[] = {
-   "initrd%s"_XS8,
-   "initrd.img%s"_XS8,
-   "initrd%s.img"_XS8,
-   "initramfs%s"_XS8,
-   "initramfs.img%s"_XS8,
-   "initramfs%s.img"_XS8,
+//
+// The initrd names a kernel \boot\vmlinuz<Version> is looked for with, in order.
+// The first one that exists for that Version is used.
+//
+typedef struct LINUX_INIT_IMAGE
+{
+   CONST CHAR16 *Prefix;
+   CONST CHAR16 *Suffix;
+} LINUX_INIT_IMAGE;
+
+STATIC CONST LINUX_INIT_IMAGE LinuxInitImage[] = {
+   { L"initrd", L"" },
+   { L"initrd.img", L"" },
+   { L"initrd", L".img" },
+   { L"initramfs", L"" },
+   { L"initramfs.img", L"" },
+   { L"initramfs", L".img" },
+};
+STATIC CONST UINTN LinuxInitImageCount = (sizeof(LinuxInitImage) / sizeof(LinuxInitImage[0]));
+
+class LINUX_KERNEL_FILE
+{
+public:
+  XStringW  Name;
+  EFI_TIME  ModificationTime;
+
+  LINUX_KERNEL_FILE() : Name(), ModificationTime() {}
+  LINUX_KERNEL_FILE(const LINUX_KERNEL_FILE& other) = delete; // Can be defined if needed
+  const LINUX_KERNEL_FILE& operator = ( const LINUX_KERNEL_FILE & ) = delete; // Can be defined if needed
+};
+
+class LINUX_INITRD_FILE
+{
+public:
+  XStringW  Version;
+  XStringW  Name;
+  UINTN     Rank;      // index in LinuxInitImage, the lowest is used
+
+  LINUX_INITRD_FILE() : Version(), Name(), Rank(0) {}
+  LINUX_INITRD_FILE(const LINUX_INITRD_FILE& other) = delete; // Can be defined if needed
+  const LINUX_INITRD_FILE& operator = ( const LINUX_INITRD_FILE & ) = delete; // Can be defined if needed
+};
+
+//
+// The \boot directory of a volume, read once: the kernels in directory order and the initrds keyed by
+// the kernel version they go with. The names are matched against the tables here instead of a MetaiMatch()
+// per entry and a FileExists() per initrd name and kernel.
+//
+class LINUX_BOOT_DIR
+{
+public:
+  XObjArray<LINUX_KERNEL_FILE>  Kernels;   // vmlinuz*, empty files left out
+  XObjArray<LINUX_INITRD_FILE>  InitRds;
+
+  LINUX_BOOT_DIR() : Kernels(), InitRds() {}
+  LINUX_BOOT_DIR(const LINUX_BOOT_DIR& other) = delete; // Can be defined if needed
+  const LINUX_BOOT_DIR& operator = ( const LINUX_BOOT_DIR & ) = delete; // Can be defined if needed
+
+  void Read(const EFI_FILE *RootDir);
+  const LINUX_INITRD_FILE* FindInitRd(IN CONST CHAR16 *Version) const;
+
+protected:
+  void AddInitRd(const XStringW& Name, UINTN Rank);
 };
-STATIC CONST UINTN LinuxInitImagePathCount = (sizeof(LinuxInitImagePath) / sizeof(LinuxInitImagePath[0]));
 
-STATIC XString8Array LinuxKernelOptions(const EFI_FILE_PROTOCOL *Dir,
+void LINUX_BOOT_DIR::AddInitRd(const XStringW& Name, UINTN Rank)
+{
+  size_t PrefixLength = StrLen(LinuxInitImage[Rank].Prefix);
+  size_t SuffixLength = StrLen(LinuxInitImage[Rank].Suffix);
+
+  if (Name.length() < PrefixLength + SuffixLength || !Name.startWithIC(LinuxInitImage[Rank].Prefix) ||
+      !Name.subString(Name.length() - SuffixLength, SuffixLength).equalIC(LinuxInitImage[Rank].Suffix)) {
+    return;
+  }
+  XStringW Version = Name.subString(PrefixLength, Name.length() - PrefixLength - SuffixLength);
+  for (size_t Index = 0; Index < InitRds.size(); Index++) {
+    LINUX_INITRD_FILE& InitRd = InitRds[Index];
+    if (InitRd.Version.equalIC(Version)) {
+      if (Rank < InitRd.Rank) {
+        InitRd.Name = Name;
+        InitRd.Rank = Rank;
+      }
+      return;
+    }
+  }
+  LINUX_INITRD_FILE* InitRd = new LINUX_INITRD_FILE;
+  InitRd->Version = Version;
+  InitRd->Name = Name;
+  InitRd->Rank = Rank;
+  InitRds.AddReference(InitRd, true);
+}
+
+void LINUX_BOOT_DIR::Read(const EFI_FILE *RootDir)
+{
+  REFIT_DIR_ITER  Iter;
+  EFI_FILE_INFO   *FileInfo = NULL;
+
+  Kernels.setEmpty();
+  InitRds.setEmpty();
+  DirIterOpen(RootDir, LINUX_BOOT_PATH, &Iter);
+  while (DirIterNext(&Iter, 2, NULL, &FileInfo)) {
+    if (FileInfo == NULL) {
+      continue;
+    }
+    XStringW Name = XStringW().takeValueFrom(FileInfo->FileName);
+    if (Name.startWithIC(LINUX_LOADER_PATH)) {
+      if (FileInfo->FileSize > 0) {
+        LINUX_KERNEL_FILE* Kernel = new LINUX_KERNEL_FILE;
+        Kernel->Name = Name;
+        Kernel->ModificationTime = FileInfo->ModificationTime;
+        Kernels.AddReference(Kernel, true);
+      }
+      continue;
+    }
+    for (UINTN Rank = 0; Rank < LinuxInitImageCount; Rank++) {
+      AddInitRd(Name, Rank);
+    }
+  }
+  DirIterClose(&Iter);
+}
+
+const LINUX_INITRD_FILE* LINUX_BOOT_DIR::FindInitRd(IN CONST CHAR16 *Version) const
+{
+  for (size_t Index = 0; Index < InitRds.size(); Index++) {
+    if (InitRds[Index].Version.equalIC(Version)) {
+      return &InitRds[Index];
+    }
+  }
+  return NULL;
+}
+
+STATIC XString8Array LinuxKernelOptions(const LINUX_BOOT_DIR& BootDir,
                                   IN CONST CHAR16            *Version,
                                   IN CONST CHAR16            *PartUUID,
                                   IN CONST XString8Array&           Options OPTIONAL)
 {
-  UINTN Index = 0;
-  if ((Dir == NULL) || (PartUUID == NULL)) {
+  if (PartUUID == NULL) {
     return Options;
   }
-  while (Index < LinuxInitImagePathCount) {
-    XStringW InitRd = SWPrintf(LinuxInitImagePath[Index++].c_str(), (Version == NULL) ? L"" : Version);
-    if (InitRd.notEmpty()) {
-      if (FileExists(Dir, InitRd)) {
-        XString8Array CustomOptions;
-        CustomOptions.Add(S8Printf("root=/dev/disk/by-partuuid/%ls", PartUUID));
-        CustomOptions.Add(S8Printf("initrd=%ls\\%ls", LINUX_BOOT_ALT_PATH, InitRd.wc_str()));
-        CustomOptions.import(LINUX_DEFAULT_OPTIONS);
-        CustomOptions.import(Options);
-        return CustomOptions;
-      }
-    }
-  }
+  const LINUX_INITRD_FILE* InitRd = BootDir.FindInitRd((Version == NULL) ? L"" : Version);
   XString8Array CustomOptions;
   CustomOptions.Add(S8Printf("root=/dev/disk/by-partuuid/%ls", PartUUID));
+  if (InitRd != NULL) {
+    CustomOptions.Add(S8Printf("initrd=%ls\\%ls", LINUX_BOOT_ALT_PATH, InitRd->Name.wc_str()));
+  }
   CustomOptions.import(LINUX_DEFAULT_OPTIONS);
   CustomOptions.import(Options);
   return CustomOptions;
@@ -407,7 +535,7 @@ STATIC EFI_STATUS GetOSXVolumeName(LOADER_ENTRY *Entry)
   CONST CHAR16* targetNameFile = L"\\System\\Library\\CoreServices\\.disk_label.contentDetails";
   CHAR8*  fileBuffer;
   UINTN   fileLen = 0;
-  if(FileExists(Entry->Volume->RootDir, targetNameFile)) {
+  if(ScanFileExists(Entry->Volume->RootDir, targetNameFile)) {
     Status = egLoadFile(Entry->Volume->RootDir, targetNameFile, (UINT8 **)&fileBuffer, &fileLen);
     if(!EFI_ERROR(Status)) {
 //      CHAR16  *tmpName;
@@ -442,6 +570,92 @@ STATIC EFI_STATUS GetOSXVolumeName(LOADER_ENTRY *Entry)
   return Status;
 }
 
+STATIC void SetLoaderEntryTitle(LOADER_ENTRY *Entry, IN CONST XStringW& FullTitle, IN CONST XStringW& LoaderTitle)
+{
+  Entry->Title = FullTitle;
+  if (Entry->Title.isEmpty()  &&  Entry->Volume->VolLabel.notEmpty()) {
+    if (Entry->Volume->VolLabel[0] == L'#') {
+      Entry->Title.SWPrintf("Boot %ls from %ls", (!LoaderTitle.isEmpty()) ? LoaderTitle.wc_str() : Entry->LoaderPath.basename().wc_str(), Entry->Volume->VolLabel.data(1));
+    }else{
+      Entry->Title.SWPrintf("Boot %ls from %ls", (!LoaderTitle.isEmpty()) ? LoaderTitle.wc_str() : Entry->LoaderPath.basename().wc_str(), Entry->Volume->VolLabel.wc_str());
+    }
+  }
+
+  BOOLEAN BootCampStyle = ThemeX.BootCampStyle;
+
+  if ( Entry->Title.isEmpty()  &&  Entry->DisplayedVolName.isEmpty() ) {
+    XStringW BasenameXW = XStringW(Basename(Entry->Volume->DevicePathString.wc_str()));
+ //   DBG("encounter Entry->VolName ==%ls and StrLen(Entry->VolName) ==%llu\n",Entry->VolName, StrLen(Entry->VolName));
+    if (BootCampStyle) {
+      if (!LoaderTitle.isEmpty()) {
+        Entry->Title = LoaderTitle;
+      } else {
+        Entry->Title = (BasenameXW.contains(L"-")) ? BasenameXW.subString(0,BasenameXW.indexOf(L"-") + 1) + L"..)" : BasenameXW;
+      }
+    } else {
+      Entry->Title.SWPrintf("Boot %ls from %ls", (!LoaderTitle.isEmpty()) ? LoaderTitle.wc_str() : Entry->LoaderPath.basename().wc_str(),
+                            (BasenameXW.contains(L"-")) ? (BasenameXW.subString(0,BasenameXW.indexOf(L"-") + 1) + L"..)").wc_str() : BasenameXW.wc_str());
+    }
+  }
+//  DBG("check Entry->Title \n");
+  if ( Entry->Title.isEmpty() ) {
+ //   DBG("encounter LoaderTitle ==%ls and Entry->VolName ==%ls\n", LoaderTitle.wc_str(), Entry->VolName);
+    if (BootCampStyle) {
+      if ((StriCmp(LoaderTitle.wc_str(), L"macOS") == 0) || (StriCmp(LoaderTitle.wc_str(), L"Recovery") == 0)) {
+        Entry->Title.takeValueFrom(Entry->DisplayedVolName);
+      } else {
+        if (!LoaderTitle.isEmpty()) {
+          Entry->Title = LoaderTitle;
+        } else {
+          Entry->Title = Entry->LoaderPath.basename();
+        }
+      }
+    } else {
+      Entry->Title.SWPrintf("Boot %ls from %ls", (!LoaderTitle.isEmpty()) ? LoaderTitle.wc_str() : Entry->LoaderPath.basename().wc_str(),
+                            Entry->DisplayedVolName.wc_str());
+    }
+  }
+//  DBG("Entry->Title =%ls\n", Entry->Title.wc_str());
+  // just an example that UI can show hibernated volume to the user
+  // should be better to show it on entry image
+  if (OSFLAG_ISSET(Entry->Flags, OSFLAG_HIBERNATED)) {
+    Entry->Title.SWPrintf("%ls (hibernated)", Entry->Title.s());
+  }
+}
+
+STATIC void SetLoaderEntryImage(LOADER_ENTRY *Entry, IN XIcon *Image, IN CONST XStringW& OSIconName)
+{
+  // get custom volume icon if present, a pending entry shows the theme icon until FetchEntryInfo()
+  if (GlobalConfig.CustomIcons && !Entry->InfoPending && ScanFileExists(Entry->Volume->RootDir, L"\\.VolumeIcon.icns")){
+    Entry->Image.Image.LoadIcns(Entry->Volume->RootDir, L"\\.VolumeIcon.icns", 128);
+    if (!Entry->Image.Image.isEmpty()) {
+      Entry->Image.setFilled();
+      DBG("using VolumeIcon.icns image from Volume\n");
+    }    
+  } else if (Image) {
+    Entry->Image = *Image; //copy image from temporary storage
+  } else {
+    Entry->Image = ThemeX.LoadOSIcon(OSIconName);
+  }
+}
+
+STATIC void SetLoaderEntryBadge(LOADER_ENTRY *Entry)
+{
+//   DBG("HideBadges=%llu Volume=%ls ", ThemeX.HideBadges, Volume->VolName);
+  if (ThemeX.HideBadges & HDBADGES_SHOW) {
+    if (ThemeX.HideBadges & HDBADGES_SWAP) {
+      Entry->BadgeImage.Image = XImage(Entry->DriveImage.Image, 0);
+       DBG("    Show badge as Drive.\n");
+    } else {
+      Entry->BadgeImage.Image = XImage(Entry->Image.Image, 0);
+       DBG("    Show badge as OSImage.\n");
+    }
+    if (!Entry->BadgeImage.Image.isEmpty()) {
+      Entry->BadgeImage.setFilled();
+    }
+  }
+}
+
 STATIC LOADER_ENTRY *CreateLoaderEntry(IN CONST XStringW& LoaderPath,
                                        IN CONST XString8Array& LoaderOptions,
                                        IN CONST XStringW& FullTitle,
@@ -614,7 +828,12 @@ if ( Entry->APFSTargetUUID.startWith("99999999") ) {
   DBG("%s", "");
 }
 #endif
-  Entry->OSVersion = GetOSVersion(Entry);
+  // with LazyEntryInfo a scanned macOS entry gets its version, label and icon later from FetchEntryInfo()
+  Entry->InfoPending = GlobalConfig.LazyEntryInfo && !CustomEntry &&
+                       (OSType == OSTYPE_OSX || OSType == OSTYPE_RECOVERY || OSType == OSTYPE_OSX_INSTALLER);
+  if (!Entry->InfoPending) {
+    Entry->OSVersion = GetOSVersion(Entry);
+  }
 //DBG("OSVersion=%s \n", Entry->OSVersion);
   // detect specific loaders
   XStringW OSIconName;
@@ -642,7 +861,7 @@ if ( Entry->APFSTargetUUID.startWith("99999999") ) {
         Entry->Flags = OSFLAG_SET(Entry->Flags, OSFLAG_WITHKEXTS);
       }
       ShortcutLetter = 'M';
-      if ( Entry->DisplayedVolName.isEmpty() ) {
+      if ( Entry->DisplayedVolName.isEmpty() && !Entry->InfoPending ) {
         // else no sense to override it with dubious name
         GetOSXVolumeName(Entry);
       }
@@ -679,70 +898,15 @@ if ( Entry->APFSTargetUUID.startWith("99999999") ) {
       break;
   }
 //DBG("OSIconName=%ls \n", OSIconName);
-  Entry->Title = FullTitle;
-  if (Entry->Title.isEmpty()  &&  Volume->VolLabel.notEmpty()) {
-    if (Volume->VolLabel[0] == L'#') {
-      Entry->Title.SWPrintf("Boot %ls from %ls", (!LoaderTitle.isEmpty()) ? LoaderTitle.wc_str() : LoaderPath.basename().wc_str(), Volume->VolLabel.data(1));
-    }else{
-      Entry->Title.SWPrintf("Boot %ls from %ls", (!LoaderTitle.isEmpty()) ? LoaderTitle.wc_str() : LoaderPath.basename().wc_str(), Volume->VolLabel.wc_str());
-    }
-  }
-
-  BOOLEAN BootCampStyle = ThemeX.BootCampStyle;
-
-  if ( Entry->Title.isEmpty()  &&  Entry->DisplayedVolName.isEmpty() ) {
-    XStringW BasenameXW = XStringW(Basename(Volume->DevicePathString.wc_str()));
- //   DBG("encounter Entry->VolName ==%ls and StrLen(Entry->VolName) ==%llu\n",Entry->VolName, StrLen(Entry->VolName));
-    if (BootCampStyle) {
-      if (!LoaderTitle.isEmpty()) {
-        Entry->Title = LoaderTitle;
-      } else {
-        Entry->Title = (BasenameXW.contains(L"-")) ? BasenameXW.subString(0,BasenameXW.indexOf(L"-") + 1) + L"..)" : BasenameXW;
-      }
-    } else {
-      Entry->Title.SWPrintf("Boot %ls from %ls", (!LoaderTitle.isEmpty()) ? LoaderTitle.wc_str() : LoaderPath.basename().wc_str(),
-                            (BasenameXW.contains(L"-")) ? (BasenameXW.subString(0,BasenameXW.indexOf(L"-") + 1) + L"..)").wc_str() : BasenameXW.wc_str());
-    }
-  }
-//  DBG("check Entry->Title \n");
-  if ( Entry->Title.isEmpty() ) {
- //   DBG("encounter LoaderTitle ==%ls and Entry->VolName ==%ls\n", LoaderTitle.wc_str(), Entry->VolName);
-    if (BootCampStyle) {
-      if ((StriCmp(LoaderTitle.wc_str(), L"macOS") == 0) || (StriCmp(LoaderTitle.wc_str(), L"Recovery") == 0)) {
-        Entry->Title.takeValueFrom(Entry->DisplayedVolName);
-      } else {
-        if (!LoaderTitle.isEmpty()) {
-          Entry->Title = LoaderTitle;
-        } else {
-          Entry->Title = LoaderPath.basename();
-        }
-      }
-    } else {
-      Entry->Title.SWPrintf("Boot %ls from %ls", (!LoaderTitle.isEmpty()) ? LoaderTitle.wc_str() : LoaderPath.basename().wc_str(),
-                            Entry->DisplayedVolName.wc_str());
-    }
-  }
-//  DBG("Entry->Title =%ls\n", Entry->Title.wc_str());
-  // just an example that UI can show hibernated volume to the user
-  // should be better to show it on entry image
-  if (OSFLAG_ISSET(Entry->Flags, OSFLAG_HIBERNATED)) {
-    Entry->Title.SWPrintf("%ls (hibernated)", Entry->Title.s());
+  SetLoaderEntryTitle(Entry, FullTitle, LoaderTitle);
+  if (Entry->InfoPending) {
+    Entry->PendingFullTitle = FullTitle;
+    Entry->PendingLoaderTitle = LoaderTitle;
   }
 
   Entry->ShortcutLetter = (Hotkey == 0) ? ShortcutLetter : Hotkey;
 
-  // get custom volume icon if present
-  if (GlobalConfig.CustomIcons && FileExists(Volume->RootDir, L"\\.VolumeIcon.icns")){
-    Entry->Image.Image.LoadIcns(Volume->RootDir, L"\\.VolumeIcon.icns", 128);
-    if (!Entry->Image.Image.isEmpty()) {
-      Entry->Image.setFilled();
-      DBG("using VolumeIcon.icns image from Volume\n");
-    }    
-  } else if (Image) {
-    Entry->Image = *Image; //copy image from temporary storage
-  } else {
-    Entry->Image = ThemeX.LoadOSIcon(OSIconName);
-  }
+  SetLoaderEntryImage(Entry, Image, OSIconName);
 //  DBG("Load DriveImage\n");
   // Load DriveImage
   if (DriveImage) {
@@ -751,19 +915,7 @@ if ( Entry->APFSTargetUUID.startWith("99999999") ) {
   } else {
     Entry->DriveImage = ScanVolumeDefaultIcon(Volume, Entry->LoaderType, Volume->DevicePath);
   }
-//   DBG("HideBadges=%llu Volume=%ls ", ThemeX.HideBadges, Volume->VolName);
-  if (ThemeX.HideBadges & HDBADGES_SHOW) {
-    if (ThemeX.HideBadges & HDBADGES_SWAP) {
-      Entry->BadgeImage.Image = XImage(Entry->DriveImage.Image, 0);
-       DBG("    Show badge as Drive.\n");
-    } else {
-      Entry->BadgeImage.Image = XImage(Entry->Image.Image, 0);
-       DBG("    Show badge as OSImage.\n");
-    }
-    if (!Entry->BadgeImage.Image.isEmpty()) {
-      Entry->BadgeImage.setFilled();
-    }
-  }
+  SetLoaderEntryBadge(Entry);
   Entry->BootBgColor = BootBgColor;
 
 //  Entry->KernelAndKextPatches = ((Patches == NULL) ? (KERNEL_AND_KEXT_PATCHES *)(((UINTN)&gSettings) + OFFSET_OF(SETTINGS_DATA, KernelAndKextPatches)) : Patches);
@@ -777,6 +929,80 @@ if ( Entry->APFSTargetUUID.startWith("99999999") ) {
   return Entry;
 }
 
+//
+// With LazyEntryInfo, read what CreateLoaderEntry() left out: the version in SystemVersion.plist, the label in
+// .disk_label.contentDetails and .VolumeIcon.icns. Then title, icon, badge and options submenu are made again
+// and the cached menu tiles dropped.
+//
+void LOADER_ENTRY::FetchEntryInfo()
+{
+  if (!InfoPending) {
+    return;
+  }
+  InfoPending = FALSE;
+  OSVersion = GetOSVersion(this);
+  if ( DisplayedVolName.isEmpty() ) {
+    GetOSXVolumeName(this);
+  }
+  SetLoaderEntryTitle(this, PendingFullTitle, PendingLoaderTitle);
+  SetLoaderEntryImage(this, NULL, GetOSIconName(OSVersion));
+  SetLoaderEntryBadge(this);
+  PendingFullTitle.setEmpty();
+  PendingLoaderTitle.setEmpty();
+  if (SubScreen != NULL) {
+    SubScreen->FreeMenu();
+    SubScreen = NULL;
+  }
+  AddDefaultMenu();
+  Tile[0].setEmpty();
+  Tile[1].setEmpty();
+  DBG("Entry info fetched for '%ls': %s\n", Title.wc_str(), OSVersion.asString().c_str());
+}
+
+//
+// One step of the background fetch, run from the menu wait: the first visible pending entry, else a hidden one.
+// Returns TRUE if an entry changed.
+//
+BOOLEAN FetchNextEntryInfo()
+{
+  LOADER_ENTRY *Hidden = NULL;
+  for (size_t i = 0; i < MainMenu.Entries.sizeIncludingHidden(); i++) {
+    LOADER_ENTRY *Entry = MainMenu.Entries.ElementAt(i).getLOADER_ENTRY();
+    if (Entry == NULL || !Entry->InfoPending) {
+      continue;
+    }
+    if (!Entry->Hidden) {
+      Entry->FetchEntryInfo();
+      if (!EntryInfoPending()) {
+        OSVersionCacheSave();
+      }
+      return TRUE;
+    }
+    if (Hidden == NULL) {
+      Hidden = Entry;
+    }
+  }
+  if (Hidden != NULL) {
+    Hidden->FetchEntryInfo();
+    if (!EntryInfoPending()) {
+      OSVersionCacheSave();
+    }
+    return TRUE;
+  }
+  return FALSE;
+}
+
+BOOLEAN EntryInfoPending()
+{
+  for (size_t i = 0; i < MainMenu.Entries.sizeIncludingHidden(); i++) {
+    LOADER_ENTRY *Entry = MainMenu.Entries.ElementAt(i).getLOADER_ENTRY();
+    if (Entry != NULL && Entry->InfoPending) {
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
 void LOADER_ENTRY::AddDefaultMenu()
 {
   XStringW     FileName;
@@ -1012,7 +1238,7 @@ LOADER_ENTRY* AddLoaderEntry(IN CONST XStringW& LoaderPath, IN CONST XString8Arr
 {
   LOADER_ENTRY *Entry;
 
-  if ((LoaderPath.isEmpty()) || (Volume == NULL) || (Volume->RootDir == NULL) || !FileExists(Volume->RootDir, LoaderPath)) {
+  if ((LoaderPath.isEmpty()) || (Volume == NULL) || (Volume->RootDir == NULL) || !ScanFileExists(Volume->RootDir, LoaderPath)) {
     return NULL;
   }
 
@@ -1096,7 +1322,7 @@ STATIC void LinuxScan(REFIT_VOLUME *Volume, UINT8 KernelScan, UINT8 Type, XStrin
       XStringW File = SWPrintf("EFI\\%ls\\grubx64.efi", DirEntry->FileName);
       XStringW OSName = XStringW().takeValueFrom(DirEntry->FileName); // this is folder name, for example "ubuntu"
       OSName.lowerAscii(); // lowercase for icon name and title (first letter in title will be capitalized later)
-      if (FileExists(Volume->RootDir, File)) {
+      if (ScanFileExists(Volume->RootDir, File)) {
         // check if nonstandard icon mapping is needed
         for (Index = 0; Index < LinuxIconMappingCount; ++Index) {
           if (StrCmp(OSName.wc_str(),LinuxIconMapping[Index].DirectoryName) == 0) {
@@ -1132,7 +1358,7 @@ STATIC void LinuxScan(REFIT_VOLUME *Volume, UINT8 KernelScan, UINT8 Type, XStrin
 
     // check for non-standard grub path
     for (Index = 0; Index < LinuxEntryDataCount; ++Index) {
-      if (FileExists(Volume->RootDir, LinuxEntryData[Index].Path)) {
+      if (ScanFileExists(Volume->RootDir, LinuxEntryData[Index].Path)) {
         XStringW OSIconName = XStringW().takeValueFrom(LinuxEntryData[Index].Icon);
         OSIconName = OSIconName.subString(0, OSIconName.indexOf(','));
         XIcon ImageX = ThemeX.GetIcon(L"os_"_XSW + OSIconName);
@@ -1157,8 +1383,7 @@ STATIC void LinuxScan(REFIT_VOLUME *Volume, UINT8 KernelScan, UINT8 Type, XStrin
     // check for linux kernels
     PartGUID = FindGPTPartitionGuidInDevicePath(Volume->DevicePath);
     if ((PartGUID != NULL) && (Volume->RootDir != NULL)) {
-      REFIT_DIR_ITER  Iter;
-      EFI_FILE_INFO  *FileInfo = NULL;
+      LINUX_BOOT_DIR  BootDir;
       EFI_TIME        PreviousTime;
       XStringW        Path;
       // CHAR16         *Options;
@@ -1167,8 +1392,8 @@ STATIC void LinuxScan(REFIT_VOLUME *Volume, UINT8 KernelScan, UINT8 Type, XStrin
       ZeroMem(&PreviousTime, sizeof(EFI_TIME));
       snwprintf(PartUUID, sizeof(PartUUID), "%s", strguid(PartGUID));
       StrToLower(PartUUID);
-      // open the /boot directory (or whatever directory path)
-      DirIterOpen(Volume->RootDir, LINUX_BOOT_PATH, &Iter);
+      // read the /boot directory (or whatever directory path)
+      BootDir.Read(Volume->RootDir);
   
       // Check which kernel scan to use
   
@@ -1176,86 +1401,61 @@ STATIC void LinuxScan(REFIT_VOLUME *Volume, UINT8 KernelScan, UINT8 Type, XStrin
       switch (KernelScan) {
         case KERNEL_SCAN_FIRST:
           // First kernel found only
-          while (DirIterNext(&Iter, 2, LINUX_LOADER_SEARCH_PATH, &FileInfo)) {
-            if (FileInfo != NULL) {
-              if (FileInfo->FileSize == 0) {
-                continue;
-              }
-              // get the kernel file path
-              Path.SWPrintf("%ls\\%ls", LINUX_BOOT_PATH, FileInfo->FileName);
-              // free the file info
-              break;
-            }
+          if (BootDir.Kernels.notEmpty()) {
+            // get the kernel file path
+            Path.SWPrintf("%ls\\%ls", LINUX_BOOT_PATH, BootDir.Kernels[0].Name.wc_str());
           }
           break;
         case KERNEL_SCAN_LAST:
           // Last kernel found only
-          while (DirIterNext(&Iter, 2, LINUX_LOADER_SEARCH_PATH, &FileInfo)) {
-            if (FileInfo != NULL) {
-              if (FileInfo->FileSize > 0) {
-                // get the kernel file path
-                Path.SWPrintf("%ls\\%ls", LINUX_BOOT_PATH, FileInfo->FileName);
-              }
-            }
+          if (BootDir.Kernels.notEmpty()) {
+            // get the kernel file path
+            Path.SWPrintf("%ls\\%ls", LINUX_BOOT_PATH, BootDir.Kernels[BootDir.Kernels.size() - 1].Name.wc_str());
           }
           break;
         case KERNEL_SCAN_NEWEST:
           // Newest dated kernel only
-          while (DirIterNext(&Iter, 2, LINUX_LOADER_SEARCH_PATH, &FileInfo)) {
-            if (FileInfo != NULL) {
-              if (FileInfo->FileSize > 0) {
-                // get the kernel file path
-                if ((PreviousTime.Year == 0) || (TimeCmp(&PreviousTime, &(FileInfo->ModificationTime)) < 0)) {
-                  Path.SWPrintf("%ls\\%ls", LINUX_BOOT_PATH, FileInfo->FileName);
-                  PreviousTime = FileInfo->ModificationTime;
-                }
-              }
+          for (Index = 0; Index < BootDir.Kernels.size(); ++Index) {
+            const LINUX_KERNEL_FILE& Kernel = BootDir.Kernels[Index];
+            // get the kernel file path
+            if ((PreviousTime.Year == 0) || (TimeCmp(&PreviousTime, &Kernel.ModificationTime) < 0)) {
+              Path.SWPrintf("%ls\\%ls", LINUX_BOOT_PATH, Kernel.Name.wc_str());
+              PreviousTime = Kernel.ModificationTime;
             }
           }
           break;
         case KERNEL_SCAN_OLDEST:
           // Oldest dated kernel only
-          while (DirIterNext(&Iter, 2, LINUX_LOADER_SEARCH_PATH, &FileInfo)) {
-            if (FileInfo != NULL) {
-              if (FileInfo->FileSize > 0) {
-                // get the kernel file path
-                if ((PreviousTime.Year == 0) || (TimeCmp(&PreviousTime, &(FileInfo->ModificationTime)) > 0)) {
-                  Path.SWPrintf("%ls\\%ls", LINUX_BOOT_PATH, FileInfo->FileName);
-                  PreviousTime = FileInfo->ModificationTime;
-                }
-              }
+          for (Index = 0; Index < BootDir.Kernels.size(); ++Index) {
+            const LINUX_KERNEL_FILE& Kernel = BootDir.Kernels[Index];
+            // get the kernel file path
+            if ((PreviousTime.Year == 0) || (TimeCmp(&PreviousTime, &Kernel.ModificationTime) > 0)) {
+              Path.SWPrintf("%ls\\%ls", LINUX_BOOT_PATH, Kernel.Name.wc_str());
+              PreviousTime = Kernel.ModificationTime;
             }
           }
           break;
         case KERNEL_SCAN_MOSTRECENT:
           // most recent kernel version only
-          while (DirIterNext(&Iter, 2, LINUX_LOADER_SEARCH_PATH, &FileInfo)) {
-            if (FileInfo != NULL) {
-              if (FileInfo->FileSize > 0) {
-                // get the kernel file path
-                XStringW NewPath = SWPrintf("%ls\\%ls", LINUX_BOOT_PATH, FileInfo->FileName);
-                if ( Path < NewPath ) {
-                   Path = NewPath;
-                } else {
-                    Path.setEmpty();
-                }
-              }
+          for (Index = 0; Index < BootDir.Kernels.size(); ++Index) {
+            // get the kernel file path
+            XStringW NewPath = SWPrintf("%ls\\%ls", LINUX_BOOT_PATH, BootDir.Kernels[Index].Name.wc_str());
+            if ( Path < NewPath ) {
+               Path = NewPath;
+            } else {
+                Path.setEmpty();
             }
           }
           break;
         case KERNEL_SCAN_EARLIEST:
           // earliest kernel version only
-          while (DirIterNext(&Iter, 2, LINUX_LOADER_SEARCH_PATH, &FileInfo)) {
-            if (FileInfo != NULL) {
-              if (FileInfo->FileSize > 0) {
-                // get the kernel file path
-                XStringW NewPath = SWPrintf("%ls\\%ls", LINUX_BOOT_PATH, FileInfo->FileName);
-                if ( Path > NewPath ) {
-                  Path = NewPath;
-                } else {
-                  Path.setEmpty();
-                }
-              }
+          for (Index = 0; Index < BootDir.Kernels.size(); ++Index) {
+            // get the kernel file path
+            XStringW NewPath = SWPrintf("%ls\\%ls", LINUX_BOOT_PATH, BootDir.Kernels[Index].Name.wc_str());
+            if ( Path > NewPath ) {
+              Path = NewPath;
+            } else {
+              Path.setEmpty();
             }
           }
           break;
@@ -1269,10 +1469,9 @@ STATIC void LinuxScan(REFIT_VOLUME *Volume, UINT8 KernelScan, UINT8 Type, XStrin
       if (Path.notEmpty()) {
         if (CustomPath) {
           *CustomPath = Path;
-          DirIterClose(&Iter);
           return;
         }
-        XString8Array Options = LinuxKernelOptions(Iter.DirHandle, Basename(Path.wc_str()) + LINUX_LOADER_PATH.length(), PartUUID, NullXString8Array);
+        XString8Array Options = LinuxKernelOptions(BootDir, Basename(Path.wc_str()) + LINUX_LOADER_PATH.length(), PartUUID, NullXString8Array);
         // Add the entry
         AddLoaderEntry(Path, (Options.isEmpty()) ? LINUX_DEFAULT_OPTIONS : Options, L""_XSW, L""_XSW, Volume, L""_XSW, NULL, OSTYPE_LINEFI, OSFLAG_NODEFAULTARGS);
         Path.setEmpty();
@@ -1281,22 +1480,16 @@ STATIC void LinuxScan(REFIT_VOLUME *Volume, UINT8 KernelScan, UINT8 Type, XStrin
       // the following produces multiple entries
       // custom entries has a different implementation, and does not use this code
       if (!CustomPath && KernelScan == KERNEL_SCAN_ALL) {
-        // get all the filename matches
-        while (DirIterNext(&Iter, 2, LINUX_LOADER_SEARCH_PATH, &FileInfo)) {
-          if (FileInfo != NULL) {
-            if (FileInfo->FileSize > 0) {
-              // get the kernel file path
-              Path.SWPrintf("%ls\\%ls", LINUX_BOOT_PATH, FileInfo->FileName);
-              XString8Array Options = LinuxKernelOptions(Iter.DirHandle, Basename(Path.wc_str()) + LINUX_LOADER_PATH.length(), PartUUID, NullXString8Array);
-              // Add the entry
-              AddLoaderEntry(Path, (Options.isEmpty()) ? LINUX_DEFAULT_OPTIONS : Options, L""_XSW, L""_XSW, Volume, L""_XSW, NULL, OSTYPE_LINEFI, OSFLAG_NODEFAULTARGS);
-              Path.setEmpty();
-            }
-          }
+        // all the kernels
+        for (Index = 0; Index < BootDir.Kernels.size(); ++Index) {
+          // get the kernel file path
+          Path.SWPrintf("%ls\\%ls", LINUX_BOOT_PATH, BootDir.Kernels[Index].Name.wc_str());
+          XString8Array Options = LinuxKernelOptions(BootDir, Basename(Path.wc_str()) + LINUX_LOADER_PATH.length(), PartUUID, NullXString8Array);
+          // Add the entry
+          AddLoaderEntry(Path, (Options.isEmpty()) ? LINUX_DEFAULT_OPTIONS : Options, L""_XSW, L""_XSW, Volume, L""_XSW, NULL, OSTYPE_LINEFI, OSFLAG_NODEFAULTARGS);
+          Path.setEmpty();
         }
       }
-      //close the directory
-      DirIterClose(&Iter);
     }  
   }
 
@@ -1313,9 +1506,9 @@ void AddPRSEntry(REFIT_VOLUME *Volume)
   //CONST INTN Rock = 2;
   //CONST INTN Scissor = 4;
 
-  WhatBoot |= FileExists(Volume->RootDir, RockBoot)?Rock:0;
-  WhatBoot |= FileExists(Volume->RootDir, PaperBoot)?Paper:0;
-  WhatBoot |= FileExists(Volume->RootDir, ScissorBoot)?Scissor:0;
+  WhatBoot |= ScanFileExists(Volume->RootDir, RockBoot)?Rock:0;
+  WhatBoot |= ScanFileExists(Volume->RootDir, PaperBoot)?Paper:0;
+  WhatBoot |= ScanFileExists(Volume->RootDir, ScissorBoot)?Scissor:0;
   switch (WhatBoot) {
     case Paper:
     case (Paper | Rock):
@@ -1341,6 +1534,7 @@ void AddPRSEntry(REFIT_VOLUME *Volume)
 
 void ScanLoader(void)
 {
+  TimelineSpan Span("ScanLoader");
   //DBG("Scanning loaders...\n");
   DbgHeader("ScanLoader");
    
@@ -1350,6 +1544,9 @@ void ScanLoader(void)
       //DBG(", no file system\n", VolumeIndex);
       continue;
     }
+    if (Volume->MenuScanned) {
+      continue; // its entries are in the menu already
+    }
     DBG("- [%02llu]: '%ls'", VolumeIndex, Volume->VolName.wc_str());
     if (Volume->VolName.isEmpty()) {
       Volume->VolName = L"Unknown"_XSW;
@@ -1364,17 +1561,20 @@ void ScanLoader(void)
 
     DBG("\n");
 
+    FILE_PROBE Probe(Volume->RootDir);
+    ScanProbe = &Probe;
+
     // check for Mac OS X Install Data
     // 1st stage - createinstallmedia
-    if (FileExists(Volume->RootDir, L"\\.IABootFiles\\boot.efi")) {
-      if (FileExists(Volume->RootDir, L"\\Install OS X Mavericks.app") ||
-          FileExists(Volume->RootDir, L"\\Install OS X Yosemite.app") ||
-          FileExists(Volume->RootDir, L"\\Install OS X El Capitan.app")) {
+    if (ScanFileExists(Volume->RootDir, L"\\.IABootFiles\\boot.efi")) {
+      if (ScanFileExists(Volume->RootDir, L"\\Install OS X Mavericks.app") ||
+          ScanFileExists(Volume->RootDir, L"\\Install OS X Yosemite.app") ||
+          ScanFileExists(Volume->RootDir, L"\\Install OS X El Capitan.app")) {
         AddLoaderEntry(L"\\.IABootFiles\\boot.efi"_XSW, NullXString8Array, L""_XSW, L"OS X Install"_XSW, Volume, L""_XSW, NULL, OSTYPE_OSX_INSTALLER, 0); // 10.9 - 10.11
       } else {
         AddLoaderEntry(L"\\.IABootFiles\\boot.efi"_XSW, NullXString8Array, L""_XSW, L"macOS Install"_XSW, Volume, L""_XSW, NULL, OSTYPE_OSX_INSTALLER, 0); // 10.12 - 10.13.3
       }
-    } else if (FileExists(Volume->RootDir, L"\\.IAPhysicalMedia") && FileExists(Volume->RootDir, MACOSX_LOADER_PATH)) {
+    } else if (ScanFileExists(Volume->RootDir, L"\\.IAPhysicalMedia") && ScanFileExists(Volume->RootDir, MACOSX_LOADER_PATH)) {
       AddLoaderEntry(MACOSX_LOADER_PATH, NullXString8Array, L""_XSW, L"macOS Install"_XSW, Volume, L""_XSW, NULL, OSTYPE_OSX_INSTALLER, 0); // 10.13.4+
     }
     // 2nd stage - InstallESD/AppStore/startosinstall/Fusion Drive
@@ -1389,26 +1589,26 @@ void ScanLoader(void)
     AddLoaderEntry(L"\\NetInstall macOS High Sierra.nbi\\i386\\booter"_XSW, NullXString8Array, L""_XSW, L"macOS Install"_XSW, Volume, L""_XSW, NULL, OSTYPE_OSX_INSTALLER, 0);
     // Use standard location for boot.efi, according to the install files is present
     // That file indentifies a DVD/ESD/BaseSystem/Fusion Drive Install Media, so when present, check standard path to avoid entry duplication
-    if (FileExists(Volume->RootDir, MACOSX_LOADER_PATH)) {
-      if (FileExists(Volume->RootDir, L"\\System\\Installation\\CDIS\\Mac OS X Installer.app")) {
+    if (ScanFileExists(Volume->RootDir, MACOSX_LOADER_PATH)) {
+      if (ScanFileExists(Volume->RootDir, L"\\System\\Installation\\CDIS\\Mac OS X Installer.app")) {
         // InstallDVD/BaseSystem
         AddLoaderEntry(MACOSX_LOADER_PATH, NullXString8Array, L""_XSW, L"Mac OS X Install"_XSW, Volume, L""_XSW, NULL, OSTYPE_OSX_INSTALLER, 0); // 10.6/10.7
-      } else if (FileExists(Volume->RootDir, L"\\System\\Installation\\CDIS\\OS X Installer.app")) {
+      } else if (ScanFileExists(Volume->RootDir, L"\\System\\Installation\\CDIS\\OS X Installer.app")) {
         // BaseSystem
         AddLoaderEntry(MACOSX_LOADER_PATH, NullXString8Array, L""_XSW, L"OS X Install"_XSW, Volume, L""_XSW, NULL, OSTYPE_OSX_INSTALLER, 0); // 10.8 - 10.11
-      } else if (FileExists(Volume->RootDir, L"\\System\\Installation\\CDIS\\macOS Installer.app")) {
+      } else if (ScanFileExists(Volume->RootDir, L"\\System\\Installation\\CDIS\\macOS Installer.app")) {
         // BaseSystem
         AddLoaderEntry(MACOSX_LOADER_PATH, NullXString8Array, L""_XSW, L"macOS Install"_XSW, Volume, L""_XSW, NULL, OSTYPE_OSX_INSTALLER, 0); // 10.12+
-      } else if (FileExists(Volume->RootDir, L"\\BaseSystem.dmg") && FileExists(Volume->RootDir, L"\\mach_kernel")) {
+      } else if (ScanFileExists(Volume->RootDir, L"\\BaseSystem.dmg") && ScanFileExists(Volume->RootDir, L"\\mach_kernel")) {
         // InstallESD
-        if (FileExists(Volume->RootDir, L"\\MacOSX_Media_Background.png")) {
+        if (ScanFileExists(Volume->RootDir, L"\\MacOSX_Media_Background.png")) {
           AddLoaderEntry(MACOSX_LOADER_PATH, NullXString8Array, L""_XSW, L"Mac OS X Install"_XSW, Volume, L""_XSW, NULL, OSTYPE_OSX_INSTALLER, 0); // 10.7
         } else {
           AddLoaderEntry(MACOSX_LOADER_PATH, NullXString8Array, L""_XSW, L"OS X Install"_XSW, Volume, L""_XSW, NULL, OSTYPE_OSX_INSTALLER, 0); // 10.8
         }
-      } else if (FileExists(Volume->RootDir, L"\\com.apple.boot.R\\System\\Library\\PrelinkedKernels\\prelinkedkernel") ||
-                 FileExists(Volume->RootDir, L"\\com.apple.boot.P\\System\\Library\\PrelinkedKernels\\prelinkedkernel") ||
-                 FileExists(Volume->RootDir, L"\\com.apple.boot.S\\System\\Library\\PrelinkedKernels\\prelinkedkernel")) {
+      } else if (ScanFileExists(Volume->RootDir, L"\\com.apple.boot.R\\System\\Library\\PrelinkedKernels\\prelinkedkernel") ||
+                 ScanFileExists(Volume->RootDir, L"\\com.apple.boot.P\\System\\Library\\PrelinkedKernels\\prelinkedkernel") ||
+                 ScanFileExists(Volume->RootDir, L"\\com.apple.boot.S\\System\\Library\\PrelinkedKernels\\prelinkedkernel")) {
         if (StriStr(Volume->VolName.wc_str(), L"Recovery") != NULL) {
           // FileVault of HFS+
           // TODO: need info for 10.11 and lower
@@ -1417,45 +1617,28 @@ void ScanLoader(void)
           // Fusion Drive
           AddLoaderEntry(MACOSX_LOADER_PATH, NullXString8Array, L""_XSW, L"OS X Install"_XSW, Volume, L""_XSW, NULL, OSTYPE_OSX_INSTALLER, 0); // 10.11
         }
-      } else if (!FileExists(Volume->RootDir, L"\\.IAPhysicalMedia")) {
+      } else if (!ScanFileExists(Volume->RootDir, L"\\.IAPhysicalMedia")) {
         // Installed
         if (EFI_ERROR(GetRootUUID(Volume)) || isFirstRootUUID(Volume)) {
-          if (!FileExists(Volume->RootDir, L"\\System\\Library\\CoreServices\\NotificationCenter.app") && !FileExists(Volume->RootDir, L"\\System\\Library\\CoreServices\\Siri.app")) {
+          if (!ScanFileExists(Volume->RootDir, L"\\System\\Library\\CoreServices\\NotificationCenter.app") && !ScanFileExists(Volume->RootDir, L"\\System\\Library\\CoreServices\\Siri.app")) {
             AddLoaderEntry(MACOSX_LOADER_PATH, NullXString8Array, L""_XSW, L"Mac OS X"_XSW, Volume, L""_XSW, NULL, OSTYPE_OSX, 0); // 10.6 - 10.7
-          } else if (FileExists(Volume->RootDir, L"\\System\\Library\\CoreServices\\NotificationCenter.app") && !FileExists(Volume->RootDir, L"\\System\\Library\\CoreServices\\Siri.app")) {
+          } else if (ScanFileExists(Volume->RootDir, L"\\System\\Library\\CoreServices\\NotificationCenter.app") && !ScanFileExists(Volume->RootDir, L"\\System\\Library\\CoreServices\\Siri.app")) {
             AddLoaderEntry(MACOSX_LOADER_PATH, NullXString8Array, L""_XSW, L"OS X"_XSW, Volume, L""_XSW, NULL, OSTYPE_OSX, 0); // 10.8 - 10.11
           } else {
             XString8   OSVersion;
             if ( Volume->ApfsFileSystemUUID.notEmpty() && (Volume->ApfsRole & APPLE_APFS_VOLUME_ROLE_SYSTEM) != 0 )
             {
               XStringW plist = SWPrintf("\\System\\Library\\CoreServices\\SystemVersion.plist");
-              if ( !FileExists(Volume->RootDir, plist) ) {
+              if ( !ScanFileExists(Volume->RootDir, plist) ) {
                 plist = SWPrintf("\\System\\Library\\CoreServices\\ServerVersion.plist");
-                if ( !FileExists(Volume->RootDir, plist) ) {
+                if ( !ScanFileExists(Volume->RootDir, plist) ) {
                   plist.setEmpty();
                 }
               }
 
               if ( plist.notEmpty() ) { // found macOS System
-                CHAR8*     PlistBuffer = NULL;
-                UINTN      PlistLen;
-                TagDict*     Dict        = NULL;
-                const TagStruct*     Prop        = NULL;
-
-                EFI_STATUS Status = egLoadFile(Volume->RootDir, plist.wc_str(), (UINT8 **)&PlistBuffer, &PlistLen);
-                if (!EFI_ERROR(Status) && PlistBuffer != NULL && ParseXML(PlistBuffer, &Dict, 0) == EFI_SUCCESS) {
-                  Prop = Dict->propertyForKey("ProductVersion");
-                  if ( Prop != NULL ) {
-                    if ( !Prop->isString() ) {
-                      MsgLog("ATTENTION : property not string in ProductVersion\n");
-                    }else{
-                      if( Prop->getString()->stringValue().notEmpty() ) {
-                        OSVersion = Prop->getString()->stringValue();
-                      }
-                    }
-                  }
-                }
-                if ( PlistBuffer ) FreePool(PlistBuffer);
+                XString8 BuildVersion;
+                ReadSystemVersion(Volume, plist, OSVersion, BuildVersion);
               }
             }
             if ( !OSVersion.equal("11.0") ) {
@@ -1492,10 +1675,10 @@ void ScanLoader(void)
       // check for Android loaders
       for (UINTN Index = 0; Index < AndroidEntryDataCount; ++Index) {
         UINTN aIndex, aFound;
-      if (FileExists(Volume->RootDir, AndroidEntryData[Index].Path)) {
+      if (ScanFileExists(Volume->RootDir, AndroidEntryData[Index].Path)) {
           aFound = 0;
           for (aIndex = 0; aIndex < ANDX86_FINDLEN; ++aIndex) {
-            if ((AndroidEntryData[Index].Find[aIndex].isEmpty()) || FileExists(Volume->RootDir, AndroidEntryData[Index].Find[aIndex])) ++aFound;
+            if ((AndroidEntryData[Index].Find[aIndex].isEmpty()) || ScanFileExists(Volume->RootDir, AndroidEntryData[Index].Find[aIndex])) ++aFound;
           }
           if (aFound && (aFound == aIndex)) {
             XIcon ImageX;
@@ -1593,7 +1776,7 @@ void ScanLoader(void)
             CHAR8*  fileBuffer;
             UINTN   fileLen = 0;
             targetNameFile.SWPrintf("%s\\System\\Library\\CoreServices\\.disk_label.contentDetails", ApfsTargetUUID.c_str());
-            if ( FileExists(bootVolume->RootDir, targetNameFile) ) {
+            if ( ScanFileExists(bootVolume->RootDir, targetNameFile) ) {
               EFI_STATUS Status = egLoadFile(bootVolume->RootDir, targetNameFile.wc_str(), (UINT8 **)&fileBuffer, &fileLen);
               if(!EFI_ERROR(Status)) {
                 FullTitle.SWPrintf("Boot Mac OS X from %.*s via %ls", (int)fileLen, fileBuffer, Volume->getVolLabelOrOSXVolumeNameOrVolName().wc_str());
@@ -1626,6 +1809,8 @@ void ScanLoader(void)
         AddLoaderEntry(SWPrintf("\\%s\\com.apple.installer\\boot.efi", Volume->ApfsTargetUUIDArray[i].c_str()), NullXString8Array, FullTitleInstaller, LoaderTitleInstaller, Volume, Volume->ApfsTargetUUIDArray[i], NULL, OSTYPE_OSX_INSTALLER, 0);
       }
     }
+
+    ScanProbe = NULL;
   }
 
   // Hide redundant preboot partition
@@ -1780,6 +1965,7 @@ void ScanLoader(void)
       ++idx;
     }
   } while ( hasMovedSomething );
+  OSVersionCacheSave();
 }
 
 STATIC void AddCustomEntry(IN UINTN                CustomIndex,
@@ -1789,8 +1975,8 @@ STATIC void AddCustomEntry(IN UINTN                CustomIndex,
 {
   UINTN           VolumeIndex;
   REFIT_VOLUME   *Volume;
-  REFIT_DIR_ITER  SIter;
-  REFIT_DIR_ITER *Iter = &SIter;
+  LINUX_BOOT_DIR  BootDir;
+  size_t          KernelIndex = 0;
   CHAR16          PartUUID[40];
   BOOLEAN         IsSubEntry = (SubMenu != NULL);
   BOOLEAN         FindCustomPath = (CustomPath.isEmpty());
@@ -1851,7 +2037,7 @@ STATIC void AddCustomEntry(IN UINTN                CustomIndex,
     UINT64               VolumeSize;
 
     Volume = &Volumes[VolumeIndex];
-    if ((Volume == NULL) || (Volume->RootDir == NULL)) {
+    if ((Volume == NULL) || (Volume->RootDir == NULL) || Volume->MenuScanned) {
       continue;
     }
     if (Volume->VolName.isEmpty()) {
@@ -1924,10 +2110,11 @@ STATIC void AddCustomEntry(IN UINTN                CustomIndex,
         LinuxScan(Volume, Custom->KernelScan, Custom->Type, &CustomPath, &Image);
       }
       if (Custom->Type == OSTYPE_LINEFI) {
-        // Open the boot directory to determine linux loadoptions when found item, or kernels when KERNEL_SCAN_ALL
-        DirIterOpen(Volume->RootDir, LINUX_BOOT_PATH, Iter);
+        // Read the boot directory to determine linux loadoptions when found item, or kernels when KERNEL_SCAN_ALL
+        BootDir.Read(Volume->RootDir);
+        KernelIndex = 0;
       }
-    } else if (!FileExists(Volume->RootDir, CustomPath)) {
+    } else if (!ScanFileExists(Volume->RootDir, CustomPath)) {
       DBG("skipped because path does not exist\n");
       continue;
     }
@@ -1968,18 +2155,13 @@ STATIC void AddCustomEntry(IN UINTN                CustomIndex,
 
       // for LINEFI with option KERNEL_SCAN_ALL, use this loop to search for kernels
       if (FindCustomPath && Custom->Type == OSTYPE_LINEFI && Custom->KernelScan == KERNEL_SCAN_ALL) {
-        EFI_FILE_INFO *FileInfo = NULL;
         // Get the next kernel path or stop looking
-        if (!DirIterNext(Iter, 2, LINUX_LOADER_SEARCH_PATH, &FileInfo) || (FileInfo == NULL)) {
+        if (KernelIndex >= BootDir.Kernels.size()) {
           DBG("\n");
           break;
         }
-        // who knows....
-        if (FileInfo->FileSize == 0) {
-          continue;
-        }
         // get the kernel file path
-        CustomPath.SWPrintf("%ls\\%ls", LINUX_BOOT_PATH, FileInfo->FileName);
+        CustomPath.SWPrintf("%ls\\%ls", LINUX_BOOT_PATH, BootDir.Kernels[KernelIndex++].Name.wc_str());
       }
       if (CustomPath.isEmpty()) {
         DBG("skipped\n");
@@ -1989,7 +2171,7 @@ STATIC void AddCustomEntry(IN UINTN                CustomIndex,
       // Check to make sure if we should update linux custom options or not
       if (FindCustomPath && Custom->Type == OSTYPE_LINEFI && OSFLAG_ISUNSET(Custom->Flags, OSFLAG_NODEFAULTARGS)) {
         // Find the init ram image and select root
-        CustomOptions = LinuxKernelOptions(Iter->DirHandle, Basename(CustomPath.wc_str()) + LINUX_LOADER_PATH.length(), PartUUID, Custom->LoadOptions);
+        CustomOptions = LinuxKernelOptions(BootDir, Basename(CustomPath.wc_str()) + LINUX_LOADER_PATH.length(), PartUUID, Custom->LoadOptions);
         Custom->Flags = OSFLAG_SET(Custom->Flags, OSFLAG_NODEFAULTARGS);
       }
 
@@ -2137,10 +2319,6 @@ STATIC void AddCustomEntry(IN UINTN                CustomIndex,
       }
     } while (FindCustomPath && Custom->Type == OSTYPE_LINEFI && Custom->KernelScan == KERNEL_SCAN_ALL); // repeat loop only for kernel scanning
 
-    // Close the kernel boot directory
-    if (FindCustomPath && Custom->Type == OSTYPE_LINEFI) {
-      DirIterClose(Iter);
-    }
   }
 
 }
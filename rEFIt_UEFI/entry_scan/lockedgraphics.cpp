@@ -35,6 +35,7 @@
 #include <Platform.h>
 #include "entry_scan.h"
 #include "Self.h"
+#include "../Platform/Checksum.h"
 
 #ifndef DEBUG_ALL
 #define DEBUG_LOCK_BOOT_SCREEN 1
@@ -484,7 +485,7 @@ EFI_STATUS LockBootScreen(void)
   gBS->OpenProtocol = LockedOpenProtocol;
   gBS->CloseProtocol = LockedCloseProtocol;
   gBS->Hdr.CRC32 = 0;
-  gBS->CalculateCrc32(gBS, gBS->Hdr.HeaderSize, &(gBS->Hdr.CRC32));
+  gBS->Hdr.CRC32 = GetCrc32(gBS, gBS->Hdr.HeaderSize);
   // Find graphics and modify them
   LockGraphicsGOP();
   LockGraphicsUGA();
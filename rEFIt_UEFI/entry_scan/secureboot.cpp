@@ -38,6 +38,8 @@
 #ifdef ENABLE_SECURE_BOOT
 
 #include "entry_scan.h"
+#include "../Platform/Checksum.h"
+#include "../Platform/Sha256.h"
 
 #include <Protocol/Security.h>
 #include <Protocol/Security2.h>
@@ -211,6 +213,85 @@ void DisableSecureBoot(void)
 STATIC EFI_SECURITY_FILE_AUTHENTICATION_STATE gSecurityFileAuthentication;
 STATIC EFI_SECURITY2_FILE_AUTHENTICATION      gSecurity2FileAuthentication;
 
+//
+// Images the firmware accepted during this boot. An image loaded again (a loader started again
+// from the menu, a tool) skips the firmware verification if it is the same bytes, from the same
+// device path, with the same boot policy, and db and dbx didn't change since.
+// Not kept across boots: anything stored in nvram or on the ESP could be forged.
+//
+#define VERIFIED_IMAGE_CACHE_SIZE 32
+
+typedef struct {
+  UINT8    Hash[SHA256_DIGEST_SIZE];  // Authenticode SHA-256
+  UINT32   DevicePathCrc;
+  BOOLEAN  BootPolicy;
+} VERIFIED_IMAGE;
+
+STATIC VERIFIED_IMAGE mVerifiedImages[VERIFIED_IMAGE_CACHE_SIZE];
+STATIC UINTN          mVerifiedImageCount = 0;
+STATIC UINTN          mVerifiedImageNext = 0;
+STATIC UINT32         mVerifiedDbCrc = 0;
+STATIC UINT32         mVerifiedDbxCrc = 0;
+
+STATIC UINT32 GetDatabaseCrc(IN CHAR16 *DatabaseName, IN EFI_GUID *DatabaseGuid)
+{
+  UINTN  Size = 0;
+  void  *Database = GetSignatureDatabase(DatabaseName, DatabaseGuid, &Size);
+  UINT32 Crc = GetCrc32(Database, Size);
+  if (Database != NULL) {
+    FreePool(Database);
+  }
+  return Crc;
+}
+
+// Get the key of an image in the cache, FALSE if the image can't be cached
+STATIC BOOLEAN GetVerifiedImageKey(IN  CONST EFI_DEVICE_PATH_PROTOCOL *DevicePath,
+                                   IN  void                           *FileBuffer,
+                                   IN  UINTN                           FileSize,
+                                   IN  BOOLEAN                         BootPolicy,
+                                   OUT VERIFIED_IMAGE                 *Image)
+{
+  UINT32 DbCrc, DbxCrc;
+  if ((FileBuffer == NULL) || (FileSize == 0) || !GetImageHash(FileBuffer, FileSize, Image->Hash)) {
+    return FALSE;
+  }
+  Image->DevicePathCrc = (DevicePath == NULL) ? 0 : GetCrc32(DevicePath, GetDevicePathSize((EFI_DEVICE_PATH_PROTOCOL *)DevicePath));
+  Image->BootPolicy = BootPolicy;
+  // A change of db or dbx invalidates the cache
+  DbCrc = GetDatabaseCrc(AUTHORIZED_DATABASE_NAME, &AUTHORIZED_DATABASE_GUID);
+  DbxCrc = GetDatabaseCrc(UNAUTHORIZED_DATABASE_NAME, &UNAUTHORIZED_DATABASE_GUID);
+  if ((DbCrc != mVerifiedDbCrc) || (DbxCrc != mVerifiedDbxCrc)) {
+    mVerifiedImageCount = 0;
+    mVerifiedImageNext = 0;
+    mVerifiedDbCrc = DbCrc;
+    mVerifiedDbxCrc = DbxCrc;
+  }
+  return TRUE;
+}
+
+STATIC BOOLEAN IsVerifiedImage(IN VERIFIED_IMAGE *Image)
+{
+  UINTN Index;
+  for (Index = 0; Index < mVerifiedImageCount; ++Index) {
+    if ((mVerifiedImages[Index].DevicePathCrc == Image->DevicePathCrc) &&
+        (mVerifiedImages[Index].BootPolicy == Image->BootPolicy) &&
+        (CompareMem(mVerifiedImages[Index].Hash, Image->Hash, SHA256_DIGEST_SIZE) == 0)) {
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+STATIC void AddVerifiedImage(IN VERIFIED_IMAGE *Image)
+{
+  // The oldest entry is replaced when full
+  CopyMem(&mVerifiedImages[mVerifiedImageNext], Image, sizeof(*Image));
+  mVerifiedImageNext = (mVerifiedImageNext + 1) % VERIFIED_IMAGE_CACHE_SIZE;
+  if (mVerifiedImageCount < VERIFIED_IMAGE_CACHE_SIZE) {
+    ++mVerifiedImageCount;
+  }
+}
+
 // Pre check the secure boot policy
 STATIC BOOLEAN EFIAPI
 PrecheckSecureBootPolicy(IN OUT EFI_STATUS                     *AuthenticationStatus,
@@ -371,13 +452,21 @@ Internal2FileAuthentication(IN CONST EFI_SECURITY2_ARCH_PROTOCOL *This,
                             IN UINTN                              FileSize,
                             IN BOOLEAN                            BootPolicy)
 {
-  EFI_STATUS Status = EFI_SECURITY_VIOLATION;
+  EFI_STATUS     Status = EFI_SECURITY_VIOLATION;
+  VERIFIED_IMAGE Image;
   // Check secure boot policy
   if (!PrecheckSecureBootPolicy(&Status, DevicePath)) {
+    BOOLEAN HasKey = GetVerifiedImageKey(DevicePath, FileBuffer, FileSize, BootPolicy, &Image);
+    if (HasKey && IsVerifiedImage(&Image)) {
+      // Already accepted by the firmware during this boot
+      return EFI_SUCCESS;
+    }
     // Return original security policy
     Status = gSecurity2FileAuthentication(This, DevicePath, FileBuffer, FileSize, BootPolicy);
     if (EFI_ERROR(Status)) {
       CheckSecureBootPolicy(&Status, DevicePath, FileBuffer, FileSize);
+    } else if (HasKey) {
+      AddVerifiedImage(&Image);
     }
   }
   if (EFI_ERROR(Status)) {
@@ -39,7 +39,8 @@
 
 #include "entry_scan.h"
 
-#include <openssl/sha.h>
+#include "../Platform/Sha256.h"
+#include "../Platform/Checksum.h"
 
 #include <Guid/ImageAuthentication.h>
 
@@ -60,204 +61,215 @@
 #define PKCS1_1_5_SIZE (CERT_SIZE + sizeof(EFI_GUID))
 #define EFIGUID_SIZE (CERT_SIZE + sizeof(EFI_GUID))
 
-// Check database for signature
-STATIC EFI_STATUS CheckSignatureIsInDatabase(IN void     *Database,
-                                             IN UINTN     DatabaseSize,
-                                             IN EFI_GUID *SignatureType,
-                                             IN void     *Signature,
-                                             IN UINTN     SignatureSize)
+// A signature of a database: type, and data without the owner GUID
+typedef struct {
+  EFI_GUID *SignatureType;
+  UINT8    *Signature;
+  UINTN     SignatureSize;
+} SIGNATURE_REF;
+
+// Open addressing set of the signatures of one or more databases, pointing into them
+typedef struct {
+  SIGNATURE_REF *Slots;
+  UINTN          Mask;
+} SIGNATURE_INDEX;
+
+// Count the signatures of a database, and check its lists
+STATIC EFI_STATUS CountDatabaseSignatures(IN  void  *Database,
+                                          IN  UINTN  DatabaseSize,
+                                          OUT UINTN *Count)
 {
-  UINT8 *DatabasePtr;
-  UINT8 *DatabaseEnd;
-  // Check parameters
-  if ((SignatureType == NULL) || (Signature == NULL) || (SignatureSize == 0)) {
-    return EFI_INVALID_PARAMETER;
-  }
+  UINT8 *Ptr = (UINT8 *)Database;
+  UINT8 *End = Ptr + DatabaseSize;
+  *Count = 0;
   if ((Database == NULL) || (DatabaseSize <= sizeof(EFI_SIGNATURE_LIST))) {
-    return EFI_NOT_FOUND;
-  }
-  // Get the database start and end
-  DatabasePtr = (UINT8 *)Database;
-  DatabaseEnd = DatabasePtr + DatabaseSize;
-  // Traverse the database
-  while (DatabasePtr < DatabaseEnd) {
-    EFI_SIGNATURE_LIST *SignatureList = (EFI_SIGNATURE_LIST *)DatabasePtr;
-    UINT8              *Ptr, *End;
-    // Check the list is valid
-    if ((SignatureList->SignatureListSize <= sizeof(EFI_SIGNATURE_LIST)) || (SignatureList->SignatureSize <= sizeof(EFI_GUID))) {
+    return EFI_SUCCESS;
+  }
+  while (Ptr < End) {
+    EFI_SIGNATURE_LIST *List = (EFI_SIGNATURE_LIST *)Ptr;
+    UINTN               Offset;
+    if (((UINTN)(End - Ptr) < sizeof(EFI_SIGNATURE_LIST)) ||
+        (List->SignatureListSize <= sizeof(EFI_SIGNATURE_LIST)) || (List->SignatureListSize > (UINTN)(End - Ptr)) ||
+        (List->SignatureSize <= sizeof(EFI_GUID))) {
       return EFI_INVALID_PARAMETER;
     }
-    // Check if this signature list can contain the signature
-    if (((SignatureSize + sizeof(EFI_GUID)) == SignatureList->SignatureSize) &&
-        (CompareMem(SignatureType, &(SignatureList->SignatureType), sizeof(EFI_GUID)))) {
-      // Get signature list data start
-      UINTN Offset = SignatureList->SignatureHeaderSize + sizeof(EFI_SIGNATURE_LIST);
-      Ptr = ((UINT8 *)SignatureList) + Offset;
-      End = Ptr + (SignatureList->SignatureListSize - Offset);
-      Ptr += sizeof(EFI_GUID);
-      // Check for the signature
-      while (Ptr < End) {
-        if (CompareMem(Ptr, Signature, SignatureSize) == 0) {
-          // The signature was found
-          return EFI_SUCCESS;
-        }
-        Ptr += SignatureList->SignatureSize;
-      }
+    Offset = sizeof(EFI_SIGNATURE_LIST) + List->SignatureHeaderSize;
+    if ((Offset > List->SignatureListSize) || (((List->SignatureListSize - Offset) % List->SignatureSize) != 0)) {
+      return EFI_INVALID_PARAMETER;
     }
-    // Get the next signature list
-    DatabasePtr += SignatureList->SignatureListSize;
+    *Count += (List->SignatureListSize - Offset) / List->SignatureSize;
+    Ptr += List->SignatureListSize;
   }
-  return EFI_NOT_FOUND;
+  return EFI_SUCCESS;
 }
 
-// Append a signature to a signature list
-STATIC EFI_STATUS AppendSignatureToList(IN OUT EFI_SIGNATURE_LIST **SignatureList,
-                                        IN     EFI_GUID            *SignatureType,
-                                        IN     void                *Signature,
-                                        IN     UINTN                SignatureSize)
+STATIC EFI_STATUS SignatureIndexInit(OUT SIGNATURE_INDEX *Index,
+                                     IN  UINTN            Count)
 {
-  EFI_SIGNATURE_LIST *OldSignatureList;
-  EFI_SIGNATURE_LIST *NewSignatureList;
-  UINT8              *Ptr, *End;
-  UINTN               Offset;
-  UINT32              DataSize = (UINT32)(SignatureSize + sizeof(EFI_GUID));
-  // Check parameters
-  if ((SignatureList == NULL) || (SignatureType == NULL) ||
-      (Signature == NULL) || (SignatureSize == 0)) {
-    return EFI_INVALID_PARAMETER;
+  UINTN Capacity = 16;
+  // Keep the set at most half full
+  while (Capacity < Count * 2) {
+    Capacity <<= 1;
+  }
+  Index->Slots = (SIGNATURE_REF *)AllocateZeroPool(Capacity * sizeof(SIGNATURE_REF));
+  Index->Mask = Capacity - 1;
+  return (Index->Slots == NULL) ? EFI_OUT_OF_RESOURCES : EFI_SUCCESS;
+}
+
+STATIC void SignatureIndexFree(IN SIGNATURE_INDEX *Index)
+{
+  if (Index->Slots != NULL) {
+    FreePool(Index->Slots);
+    Index->Slots = NULL;
   }
-  // Check if there is an old signature list
-  OldSignatureList = *SignatureList;
-  if (OldSignatureList == NULL) {
-    // There is no list so create a new signature list
-    NewSignatureList = (EFI_SIGNATURE_LIST *)AllocateZeroPool(sizeof(EFI_SIGNATURE_LIST) + DataSize);
-    if (NewSignatureList == NULL) {
-      return EFI_OUT_OF_RESOURCES;
+}
+
+// Returns the slot of the signature, or the empty slot where it goes
+STATIC SIGNATURE_REF *SignatureIndexLookup(IN SIGNATURE_INDEX *Index,
+                                           IN EFI_GUID        *SignatureType,
+                                           IN UINT8           *Signature,
+                                           IN UINTN            SignatureSize)
+{
+  UINTN Slot = (GetCrc32(Signature, SignatureSize) ^ SignatureSize) & Index->Mask;
+  while (Index->Slots[Slot].Signature != NULL) {
+    SIGNATURE_REF *Ref = &Index->Slots[Slot];
+    if ((Ref->SignatureSize == SignatureSize) &&
+        (CompareMem(Ref->Signature, Signature, SignatureSize) == 0) &&
+        (CompareMem(Ref->SignatureType, SignatureType, sizeof(EFI_GUID)) == 0)) {
+      break;
     }
-    // Copy the signature to the list
-    CopyMem(&(NewSignatureList->SignatureType), SignatureType, sizeof(EFI_GUID));
-    NewSignatureList->SignatureListSize = (UINT32)(DataSize + sizeof(EFI_SIGNATURE_LIST));
-    NewSignatureList->SignatureSize = (UINT32)DataSize;
-    *SignatureList = NewSignatureList;
-    return EFI_SUCCESS;
+    Slot = (Slot + 1) & Index->Mask;
   }
-  // Check the signature type and size matches this list
-  if ((OldSignatureList->SignatureListSize <= sizeof(EFI_SIGNATURE_LIST)) ||
-      (OldSignatureList->SignatureSize <= sizeof(EFI_GUID)) ||
-      (DataSize != OldSignatureList->SignatureSize) ||
-      (CompareMem(SignatureType, &(OldSignatureList->SignatureType), sizeof(EFI_GUID)) != 0)) {
-    return EFI_INVALID_PARAMETER;
+  return &Index->Slots[Slot];
+}
+
+// Add the signatures of a database, the first one is kept for duplicates
+STATIC void SignatureIndexAddDatabase(IN SIGNATURE_INDEX *Index,
+                                      IN void            *Database,
+                                      IN UINTN            DatabaseSize)
+{
+  UINT8 *Ptr = (UINT8 *)Database;
+  UINT8 *End = Ptr + DatabaseSize;
+  if ((Database == NULL) || (DatabaseSize <= sizeof(EFI_SIGNATURE_LIST))) {
+    return;
   }
-  // Get the start of signatures data but offset by sizeof(EFI_GUID) so we can skip owner
-  Offset = sizeof(EFI_SIGNATURE_LIST) + OldSignatureList->SignatureHeaderSize;
-  Ptr = ((UINT8 *)OldSignatureList) + Offset;
-  End = Ptr + (OldSignatureList->SignatureListSize - Offset);
-  Ptr += sizeof(EFI_GUID);
-  // Check the signature doesn't already exist in list
   while (Ptr < End) {
-    if (CompareMem(Ptr + sizeof(EFI_GUID), Signature, SignatureSize) == 0) {
-      // Just pretend like we added it if it exists already
-      return EFI_SUCCESS;
+    EFI_SIGNATURE_LIST *List = (EFI_SIGNATURE_LIST *)Ptr;
+    UINT8              *Sig = Ptr + sizeof(EFI_SIGNATURE_LIST) + List->SignatureHeaderSize + sizeof(EFI_GUID);
+    UINT8              *ListEnd = Ptr + List->SignatureListSize;
+    UINTN               Size = List->SignatureSize - sizeof(EFI_GUID);
+    for (; Sig < ListEnd; Sig += List->SignatureSize) {
+      SIGNATURE_REF *Ref = SignatureIndexLookup(Index, &(List->SignatureType), Sig, Size);
+      if (Ref->Signature == NULL) {
+        Ref->SignatureType = &(List->SignatureType);
+        Ref->Signature = Sig;
+        Ref->SignatureSize = Size;
+      }
     }
-    Ptr += OldSignatureList->SignatureSize;
-  }
-  // Create a new list for signatures
-  NewSignatureList = (EFI_SIGNATURE_LIST *)AllocateZeroPool(OldSignatureList->SignatureListSize + DataSize);
-  if (NewSignatureList == NULL) {
-    return EFI_OUT_OF_RESOURCES;
+    Ptr += List->SignatureListSize;
   }
-  // Copy old list to new
-  CopyMem(NewSignatureList, OldSignatureList, OldSignatureList->SignatureListSize);
-  // Increase list size
-  NewSignatureList->SignatureListSize += DataSize;
-  // Copy new signature
-  CopyMem(((UINT8 *)NewSignatureList) + OldSignatureList->SignatureListSize + sizeof(EFI_GUID), Signature, SignatureSize);
-  // Update the list and free old
-  *SignatureList = NewSignatureList;
-  FreePool(OldSignatureList);
-  return EFI_SUCCESS;
 }
 
-// Append a signature list to a signature database
-STATIC EFI_STATUS AppendSignatureListToDatabase(IN OUT void               **Database,
-                                                IN OUT UINTN               *DatabaseSize,
-                                                IN     EFI_SIGNATURE_LIST  *SignatureList)
+// Append the signatures of a database that are not already in another one, with a single reallocation
+STATIC EFI_STATUS MergeSignatureDatabase(IN OUT void  **Database,
+                                         IN OUT UINTN  *DatabaseSize,
+                                         IN     void   *SignatureDatabase,
+                                         IN     UINTN   SignatureDatabaseSize)
 {
-  EFI_SIGNATURE_LIST *List = NULL;
-  UINT8              *Ptr, *End;
-  UINT8              *OldDatabase;
-  UINT8              *NewDatabase;
-  UINTN               OldDatabaseSize;
-  UINTN               NewDatabaseSize;
-  UINTN               Size;
+  EFI_STATUS       Status;
+  SIGNATURE_INDEX  Index;
+  UINT8           *OldDatabase;
+  UINT8           *NewDatabase;
+  UINT8           *Ptr, *End, *Out;
+  UINTN            OldDatabaseSize, OldCount, Count, Size;
+  UINTN            NewDatabaseSize;
   // Check parameters
-  if ((Database == NULL) || (DatabaseSize == NULL) || (SignatureList == NULL) ||
-      (SignatureList->SignatureListSize <= sizeof(EFI_SIGNATURE_LIST)) ||
-      (SignatureList->SignatureSize <= sizeof(EFI_GUID))) {
+  if ((Database == NULL) || (DatabaseSize == NULL) ||
+      (SignatureDatabase == NULL) || (SignatureDatabaseSize <= sizeof(EFI_SIGNATURE_LIST))) {
     return EFI_INVALID_PARAMETER;
   }
-  // Get old database
   OldDatabase = (UINT8 *)*Database;
-  OldDatabaseSize = *DatabaseSize;
-  if ((OldDatabase == NULL) || (OldDatabaseSize <= sizeof(EFI_SIGNATURE_LIST))) {
-    // No database so just set it to the signature list
-    NewDatabaseSize = SignatureList->SignatureListSize;
-    NewDatabase = (UINT8 *)AllocatePool(NewDatabaseSize);
-    if (NewDatabase == NULL) {
-      return EFI_OUT_OF_RESOURCES;
-    }
-    // Free the old database if needed
-    if (OldDatabase != NULL) {
-      FreePool(OldDatabase);
-    }
-    // Copy the signature list to the database
-    CopyMem(*Database = NewDatabase, SignatureList, *DatabaseSize = NewDatabaseSize);
-    return EFI_SUCCESS;
+  OldDatabaseSize = (OldDatabase == NULL) ? 0 : *DatabaseSize;
+  Status = CountDatabaseSignatures(SignatureDatabase, SignatureDatabaseSize, &Count);
+  if (EFI_ERROR(Status)) {
+    return Status;
   }
-  // Rebuild the signature list with only signatures that aren't found in database
-  Ptr = ((UINT8 *)SignatureList) + SignatureList->SignatureHeaderSize + sizeof(EFI_SIGNATURE_LIST) + sizeof(EFI_GUID);
-  End = ((UINT8 *)SignatureList) + SignatureList->SignatureListSize;
-  Size = (SignatureList->SignatureSize - sizeof(EFI_GUID));
+  Status = CountDatabaseSignatures(OldDatabase, OldDatabaseSize, &OldCount);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+  Status = SignatureIndexInit(&Index, OldCount + Count);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+  // The signatures that stay in the index with an address in SignatureDatabase are the new ones
+  SignatureIndexAddDatabase(&Index, OldDatabase, OldDatabaseSize);
+  SignatureIndexAddDatabase(&Index, SignatureDatabase, SignatureDatabaseSize);
+  // Size of the lists of new signatures, without their signature header
+  NewDatabaseSize = (OldDatabaseSize <= sizeof(EFI_SIGNATURE_LIST)) ? 0 : OldDatabaseSize;
+  Size = NewDatabaseSize;
+  Ptr = (UINT8 *)SignatureDatabase;
+  End = Ptr + SignatureDatabaseSize;
   while (Ptr < End) {
-    // Check signature is already in database
-    EFI_STATUS Status = CheckSignatureIsInDatabase(OldDatabase, OldDatabaseSize, &(SignatureList->SignatureType), Ptr, Size);
-    if (Status == EFI_NOT_FOUND) {
-      // Add to new signature list if not found in database
-      Status = AppendSignatureToList(&List, &(SignatureList->SignatureType), Ptr, Size);
-    }
-    if (EFI_ERROR(Status)) {
-      if (List != NULL) {
-        FreePool(List);
+    EFI_SIGNATURE_LIST *List = (EFI_SIGNATURE_LIST *)Ptr;
+    UINT8              *Sig = Ptr + sizeof(EFI_SIGNATURE_LIST) + List->SignatureHeaderSize;
+    UINT8              *ListEnd = Ptr + List->SignatureListSize;
+    UINTN               ListSize = 0;
+    for (; Sig < ListEnd; Sig += List->SignatureSize) {
+      if (SignatureIndexLookup(&Index, &(List->SignatureType), Sig + sizeof(EFI_GUID), List->SignatureSize - sizeof(EFI_GUID))->Signature == Sig + sizeof(EFI_GUID)) {
+        ListSize += List->SignatureSize;
       }
-      return Status;
     }
-    Ptr += SignatureList->SignatureSize;
-  }
-  // Check any signatures remain to be added
-  if (List == NULL) {
-    return EFI_SUCCESS;
+    if (ListSize != 0) {
+      Size += sizeof(EFI_SIGNATURE_LIST) + ListSize;
+    }
+    Ptr += List->SignatureListSize;
   }
-  // Check the list is valid
-  if ((List->SignatureListSize <= sizeof(EFI_SIGNATURE_LIST)) ||
-      (List->SignatureSize <= sizeof(EFI_GUID))) {
-    FreePool(List);
-    // Unsure if this should return an error or success
+  // Nothing to add
+  if (Size == NewDatabaseSize) {
+    SignatureIndexFree(&Index);
     return EFI_SUCCESS;
   }
-  // Create a new database
-  NewDatabaseSize = OldDatabaseSize + List->SignatureListSize;
-  NewDatabase = (UINT8 *)AllocatePool(NewDatabaseSize);
+  NewDatabase = (UINT8 *)AllocatePool(Size);
   if (NewDatabase == NULL) {
-    FreePool(List);
+    SignatureIndexFree(&Index);
     return EFI_OUT_OF_RESOURCES;
   }
-  // Copy original database and free it
-  CopyMem(*Database = NewDatabase, OldDatabase, OldDatabaseSize);
-  FreePool(OldDatabase);
-  // Append signature list to end of database
-  CopyMem(NewDatabase + OldDatabaseSize, List, List->SignatureListSize);
-  *DatabaseSize = NewDatabaseSize;
-  FreePool(List);
+  if (NewDatabaseSize != 0) {
+    CopyMem(NewDatabase, OldDatabase, NewDatabaseSize);
+  }
+  // Copy the new signatures, a list for each list of SignatureDatabase
+  Out = NewDatabase + NewDatabaseSize;
+  Ptr = (UINT8 *)SignatureDatabase;
+  while (Ptr < End) {
+    EFI_SIGNATURE_LIST *List = (EFI_SIGNATURE_LIST *)Ptr;
+    EFI_SIGNATURE_LIST *NewList = (EFI_SIGNATURE_LIST *)Out;
+    UINT8              *Sig = Ptr + sizeof(EFI_SIGNATURE_LIST) + List->SignatureHeaderSize;
+    UINT8              *ListEnd = Ptr + List->SignatureListSize;
+    Out += sizeof(EFI_SIGNATURE_LIST);
+    for (; Sig < ListEnd; Sig += List->SignatureSize) {
+      if (SignatureIndexLookup(&Index, &(List->SignatureType), Sig + sizeof(EFI_GUID), List->SignatureSize - sizeof(EFI_GUID))->Signature == Sig + sizeof(EFI_GUID)) {
+        CopyMem(Out, Sig, List->SignatureSize);
+        Out += List->SignatureSize;
+      }
+    }
+    if (Out == (UINT8 *)(NewList + 1)) {
+      // No new signature in this list
+      Out = (UINT8 *)NewList;
+    } else {
+      CopyMem(&(NewList->SignatureType), &(List->SignatureType), sizeof(EFI_GUID));
+      NewList->SignatureListSize = (UINT32)(Out - (UINT8 *)NewList);
+      NewList->SignatureHeaderSize = 0;
+      NewList->SignatureSize = List->SignatureSize;
+    }
+    Ptr += List->SignatureListSize;
+  }
+  SignatureIndexFree(&Index);
+  if (OldDatabase != NULL) {
+    FreePool(OldDatabase);
+  }
+  *Database = NewDatabase;
+  *DatabaseSize = Size;
   return EFI_SUCCESS;
 }
 
@@ -268,17 +280,24 @@ EFI_STATUS AppendSignatureToDatabase(IN OUT void     **Database,
                                      IN     void      *Signature,
                                      IN     UINTN      SignatureSize)
 {
-  // Create a new signature list
-  EFI_SIGNATURE_LIST *List = NULL;
-  EFI_STATUS          Status = AppendSignatureToList(&List, SignatureType, Signature, SignatureSize);
-  if (EFI_ERROR(Status)) {
-    if (List != NULL) {
-      FreePool(List);
-    }
-    return Status;
+  EFI_SIGNATURE_LIST *List;
+  EFI_STATUS          Status;
+  UINT32              DataSize = (UINT32)(SignatureSize + sizeof(EFI_GUID));
+  // Check parameters
+  if ((SignatureType == NULL) || (Signature == NULL) || (SignatureSize == 0)) {
+    return EFI_INVALID_PARAMETER;
   }
+  // Create a new signature list with a null owner
+  List = (EFI_SIGNATURE_LIST *)AllocateZeroPool(sizeof(EFI_SIGNATURE_LIST) + DataSize);
+  if (List == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  CopyMem(&(List->SignatureType), SignatureType, sizeof(EFI_GUID));
+  List->SignatureListSize = (UINT32)(DataSize + sizeof(EFI_SIGNATURE_LIST));
+  List->SignatureSize = DataSize;
+  CopyMem(((UINT8 *)(List + 1)) + sizeof(EFI_GUID), Signature, SignatureSize);
   // Add the signature list to database
-  Status = AppendSignatureListToDatabase(Database, DatabaseSize, List);
+  Status = MergeSignatureDatabase(Database, DatabaseSize, List, List->SignatureListSize);
   FreePool(List);
   return Status;
 }
@@ -289,257 +308,206 @@ EFI_STATUS AppendSignatureDatabaseToDatabase(IN OUT void  **Database,
                                              IN     void   *SignatureDatabase,
                                              IN     UINTN   SignatureDatabaseSize)
 {
-  UINT8 *Ptr, *End;
-  // Check parameters
-  if ((Database == NULL) || (DatabaseSize == NULL) ||
-      (SignatureDatabase == NULL) || (SignatureDatabaseSize <= sizeof(EFI_SIGNATURE_LIST))) {
-    return EFI_INVALID_PARAMETER;
-  }
-  // Get the signature database start
-  Ptr = (UINT8 *)SignatureDatabase;
-  End = Ptr + SignatureDatabaseSize;
-  while (Ptr < End) {
-    // Get each signature list in signature database
-    EFI_SIGNATURE_LIST *List = (EFI_SIGNATURE_LIST *)Ptr;
-    EFI_STATUS          Status;
-    if ((List->SignatureListSize <= sizeof(EFI_SIGNATURE_LIST)) || (List->SignatureSize <= sizeof(EFI_GUID))) {
-      return EFI_INVALID_PARAMETER;
-    }
-    // Add the signature list to the database
-    Status = AppendSignatureListToDatabase(Database, DatabaseSize, List);
-    if (EFI_ERROR(Status)) {
-      return Status;
-    }
-    Ptr += List->SignatureListSize;
-  }
-  return EFI_SUCCESS;
+  return MergeSignatureDatabase(Database, DatabaseSize, SignatureDatabase, SignatureDatabaseSize);
 }
 
-// Add image signature database to authorized database
-EFI_STATUS AppendImageDatabaseToAuthorizedDatabase(IN void  *Database,
-                                                   IN UINTN  DatabaseSize)
+// Remove the signatures of a database from another one, in a single pass
+STATIC EFI_STATUS RemoveSignatureDatabaseFromDatabase(IN OUT void  **Database,
+                                                      IN OUT UINTN  *DatabaseSize,
+                                                      IN     void   *SignatureDatabase,
+                                                      IN     UINTN   SignatureDatabaseSize)
 {
-  EFI_STATUS  Status;
-  void       *AuthDatabase;
-  UINTN       AuthDatabaseSize;
+  EFI_STATUS       Status;
+  SIGNATURE_INDEX  Index;
+  UINT8           *OldDatabase;
+  UINT8           *NewDatabase;
+  UINT8           *Ptr, *End, *Out;
+  UINTN            OldDatabaseSize, Count;
   // Check parameters
-  if ((Database == NULL) || (DatabaseSize <= sizeof(EFI_SIGNATURE_LIST))) {
+  if ((Database == NULL) || (DatabaseSize == NULL) ||
+      (SignatureDatabase == NULL) || (SignatureDatabaseSize <= sizeof(EFI_SIGNATURE_LIST))) {
     return EFI_INVALID_PARAMETER;
   }
-  // Get the authorized database
-  AuthDatabase = GetAuthorizedDatabase(&AuthDatabaseSize);
-  // Add the signature database to the authorized database
-  Status = AppendSignatureDatabaseToDatabase(&AuthDatabase, &AuthDatabaseSize, Database, DatabaseSize);
+  OldDatabase = (UINT8 *)*Database;
+  OldDatabaseSize = *DatabaseSize;
+  if ((OldDatabase == NULL) || (OldDatabaseSize <= sizeof(EFI_SIGNATURE_LIST))) {
+    // Nothing to remove
+    return EFI_SUCCESS;
+  }
+  Status = CountDatabaseSignatures(OldDatabase, OldDatabaseSize, &Count);
   if (EFI_ERROR(Status)) {
-    if (AuthDatabase != NULL) {
-      FreePool(AuthDatabase);
-    }
     return Status;
   }
-  // Check there is any to set
-  if (AuthDatabase == NULL) {
-    return ClearAuthorizedDatabase();
-  }
-  if (AuthDatabaseSize <= sizeof(EFI_SIGNATURE_LIST)) {
-    FreePool(AuthDatabase);
-    return ClearAuthorizedDatabase();
+  Status = CountDatabaseSignatures(SignatureDatabase, SignatureDatabaseSize, &Count);
+  if (EFI_ERROR(Status)) {
+    return Status;
   }
-  // Set the authorized database
-  Status = SetAuthorizedDatabase(AuthDatabase, AuthDatabaseSize);
-  FreePool(AuthDatabase);
-  return Status;
-}
-
-STATIC EFI_STATUS RemoveSignatureFromDatabase(IN OUT void     **Database,
-                                              IN OUT UINTN     *DatabaseSize,
-                                              IN     EFI_GUID  *SignatureType,
-                                              IN     void      *Signature,
-                                              IN     UINTN      SignatureSize)
-{
-  UINT8 *Ptr, *End;
-  void  *OldDatabase;
-  void  *NewDatabase = NULL;
-  UINTN  OldDatabaseSize;
-  UINTN  NewDatabaseSize = 0;
-  // Check parameters
-  if ((Database == NULL) || (DatabaseSize == NULL) || (SignatureType == NULL) || 
-      (Signature == NULL) || (SignatureSize <= sizeof(EFI_SIGNATURE_LIST))) {
-    return EFI_INVALID_PARAMETER;
+  Status = SignatureIndexInit(&Index, Count);
+  if (EFI_ERROR(Status)) {
+    return Status;
   }
-  OldDatabase = (UINT8 *)*Database;
-  OldDatabaseSize = *DatabaseSize;
-  if ((OldDatabase == NULL) || (OldDatabaseSize <= sizeof(EFI_SIGNATURE_LIST))) {
-    // Nothing to do if the database is empty
-    return EFI_SUCCESS;
+  SignatureIndexAddDatabase(&Index, SignatureDatabase, SignatureDatabaseSize);
+  // The new database can only be smaller
+  NewDatabase = (UINT8 *)AllocatePool(OldDatabaseSize);
+  if (NewDatabase == NULL) {
+    SignatureIndexFree(&Index);
+    return EFI_OUT_OF_RESOURCES;
   }
-  // Get the signature database start
-  Ptr = (UINT8 *)OldDatabase;
+  Out = NewDatabase;
+  Ptr = OldDatabase;
   End = Ptr + OldDatabaseSize;
   while (Ptr < End) {
-    // Get each signature list in signature database
     EFI_SIGNATURE_LIST *List = (EFI_SIGNATURE_LIST *)Ptr;
-    EFI_STATUS          Status = EFI_SUCCESS;
-    if ((List->SignatureListSize <= sizeof(EFI_SIGNATURE_LIST)) || (List->SignatureSize <= sizeof(EFI_GUID))) {
-      if (NewDatabase != NULL) {
-        FreePool(NewDatabase);
+    EFI_SIGNATURE_LIST *NewList = (EFI_SIGNATURE_LIST *)Out;
+    UINTN               Offset = sizeof(EFI_SIGNATURE_LIST) + List->SignatureHeaderSize;
+    UINT8              *Sig = Ptr + Offset;
+    UINT8              *ListEnd = Ptr + List->SignatureListSize;
+    // Keep the list header and the signature header
+    CopyMem(Out, Ptr, Offset);
+    Out += Offset;
+    for (; Sig < ListEnd; Sig += List->SignatureSize) {
+      if (SignatureIndexLookup(&Index, &(List->SignatureType), Sig + sizeof(EFI_GUID), List->SignatureSize - sizeof(EFI_GUID))->Signature == NULL) {
+        CopyMem(Out, Sig, List->SignatureSize);
+        Out += List->SignatureSize;
       }
-      return EFI_INVALID_PARAMETER;
     }
-    // Check this signature could be found in this list
-    if (((List->SignatureSize - sizeof(EFI_GUID)) == SignatureSize) &&
-        (CompareMem(SignatureType, &(List->SignatureType), sizeof(EFI_GUID)) == 0)) {
-      // Remove the signature list from the database
-      UINT8 *ListPtr = Ptr + List->SignatureHeaderSize + sizeof(EFI_SIGNATURE_LIST) + sizeof(EFI_GUID);
-      UINT8 *ListEnd = Ptr + List->SignatureListSize;
-      EFI_SIGNATURE_LIST *NewList = NULL;
-      while (ListPtr < ListEnd) {
-        // Compare the signatures
-        if (CompareMem(Ptr, Signature, SignatureSize) != 0) {
-          // Not a match so append it to new list
-          Status = AppendSignatureToList(&NewList, SignatureType, Ptr, SignatureSize);
-          if (EFI_ERROR(Status)) {
-            if (NewList != NULL) {
-              FreePool(NewList);
-            }
-            if (NewDatabase != NULL) {
-              FreePool(NewDatabase);
-            }
-            return Status;
-          }
-        }
-        ListPtr += List->SignatureSize;
-      }
-      // Append new list if any
-      if (NewList != NULL) {
-        Status = AppendSignatureListToDatabase(&NewDatabase, &NewDatabaseSize, NewList);
-        FreePool(NewList);
-      }
+    if (Out == (UINT8 *)NewList + Offset) {
+      // All the signatures of this list were removed
+      Out = (UINT8 *)NewList;
     } else {
-      // Append this whole list as it can't hold the signature
-      Status = AppendSignatureListToDatabase(&NewDatabase, &NewDatabaseSize, List);
-    }
-    if (EFI_ERROR(Status)) {
-      if (NewDatabase != NULL) {
-        FreePool(NewDatabase);
-      }
-      return Status;
+      NewList->SignatureListSize = (UINT32)(Out - (UINT8 *)NewList);
     }
     Ptr += List->SignatureListSize;
   }
-  // Set new database
-  *Database = NewDatabase;
-  *DatabaseSize = NewDatabaseSize;
+  SignatureIndexFree(&Index);
   FreePool(OldDatabase);
+  *DatabaseSize = (UINTN)(Out - NewDatabase);
+  if (*DatabaseSize == 0) {
+    FreePool(NewDatabase);
+    NewDatabase = NULL;
+  }
+  *Database = NewDatabase;
   return EFI_SUCCESS;
 }
 
-STATIC EFI_STATUS RemoveSignatureListFromDatabase(IN OUT void               **Database,
-                                                  IN OUT UINTN               *DatabaseSize,
-                                                  IN     EFI_SIGNATURE_LIST  *SignatureList)
+//
+// Session copy of the authorized database: read once, and written once at the end
+// of a batch of changes (see BeginAuthorizedDatabaseBatch()) instead of after each one.
+//
+STATIC void    *mAuthDatabase = NULL;
+STATIC UINTN    mAuthDatabaseSize = 0;
+STATIC BOOLEAN  mAuthDatabaseLoaded = FALSE;
+STATIC BOOLEAN  mAuthDatabaseDirty = FALSE;
+STATIC UINTN    mAuthDatabaseBatch = 0;
+
+STATIC void DropAuthorizedDatabaseCopy(void)
 {
-  UINT8              *Ptr, *End;
-  UINT8              *OldDatabase;
-  UINTN               OldDatabaseSize;
-  UINTN               Size;
-  // Check parameters
-  if ((Database == NULL) || (DatabaseSize == NULL) || (SignatureList == NULL) ||
-      (SignatureList->SignatureListSize <= sizeof(EFI_SIGNATURE_LIST)) ||
-      (SignatureList->SignatureSize <= sizeof(EFI_GUID))) {
-    return EFI_INVALID_PARAMETER;
+  if (mAuthDatabase != NULL) {
+    FreePool(mAuthDatabase);
   }
-  // Get old database
-  OldDatabase = (UINT8 *)*Database;
-  OldDatabaseSize = *DatabaseSize;
-  if ((OldDatabase == NULL) || (OldDatabaseSize == 0)) {
-    // Nothing to remove
+  mAuthDatabase = NULL;
+  mAuthDatabaseSize = 0;
+  mAuthDatabaseLoaded = FALSE;
+  mAuthDatabaseDirty = FALSE;
+}
+
+STATIC void LoadAuthorizedDatabaseCopy(void)
+{
+  if (!mAuthDatabaseLoaded) {
+    mAuthDatabase = GetSignatureDatabase(AUTHORIZED_DATABASE_NAME, &AUTHORIZED_DATABASE_GUID, &mAuthDatabaseSize);
+    mAuthDatabaseLoaded = TRUE;
+  }
+}
+
+// Write the session copy, now or at the end of the batch
+STATIC EFI_STATUS CommitAuthorizedDatabase(void)
+{
+  EFI_STATUS Status;
+  if (mAuthDatabaseBatch != 0) {
+    mAuthDatabaseDirty = TRUE;
     return EFI_SUCCESS;
   }
-  // Remove the signatures found in the list from the database
-  Ptr = ((UINT8 *)SignatureList) + SignatureList->SignatureHeaderSize + sizeof(EFI_SIGNATURE_LIST) + sizeof(EFI_GUID);
-  End = ((UINT8 *)SignatureList) + SignatureList->SignatureListSize;
-  Size = (SignatureList->SignatureSize - sizeof(EFI_GUID));
-  while (Ptr < End) {
-    // Remove signature from database
-    EFI_STATUS Status = RemoveSignatureFromDatabase(Database, DatabaseSize, &(SignatureList->SignatureType), Ptr, Size);
-    if (EFI_ERROR(Status)) {
-      return Status;
-    }
-    Ptr += SignatureList->SignatureSize;
+  if ((mAuthDatabase == NULL) || (mAuthDatabaseSize <= sizeof(EFI_SIGNATURE_LIST))) {
+    Status = SetSignatureDatabase(AUTHORIZED_DATABASE_NAME, &AUTHORIZED_DATABASE_GUID, NULL, 0);
+  } else {
+    Status = SetSignatureDatabase(AUTHORIZED_DATABASE_NAME, &AUTHORIZED_DATABASE_GUID, mAuthDatabase, mAuthDatabaseSize);
   }
-  return EFI_SUCCESS;
+  mAuthDatabaseDirty = FALSE;
+  if (EFI_ERROR(Status)) {
+    // Read the variable again next time, it is what the firmware has
+    DropAuthorizedDatabaseCopy();
+  }
+  return Status;
 }
 
-STATIC EFI_STATUS RemoveSignatureDatabaseFromDatabase(IN OUT void  **Database,
-                                                      IN OUT UINTN  *DatabaseSize,
-                                                      IN     void   *SignatureDatabase,
-                                                      IN     UINTN   SignatureDatabaseSize)
+void BeginAuthorizedDatabaseBatch(void)
+{
+  ++mAuthDatabaseBatch;
+}
+
+EFI_STATUS EndAuthorizedDatabaseBatch(void)
+{
+  if ((mAuthDatabaseBatch == 0) || (--mAuthDatabaseBatch != 0) || !mAuthDatabaseDirty) {
+    return EFI_SUCCESS;
+  }
+  DBG("Writing authorized database, %llu bytes\n", mAuthDatabaseSize);
+  return CommitAuthorizedDatabase();
+}
+
+// Add image signature database to authorized database
+EFI_STATUS AppendImageDatabaseToAuthorizedDatabase(IN void  *Database,
+                                                   IN UINTN  DatabaseSize)
 {
-  UINT8 *Ptr, *End;
+  EFI_STATUS Status;
   // Check parameters
-  if ((Database == NULL) || (DatabaseSize == NULL) ||
-      (SignatureDatabase == NULL) || (SignatureDatabaseSize <= sizeof(EFI_SIGNATURE_LIST))) {
+  if ((Database == NULL) || (DatabaseSize <= sizeof(EFI_SIGNATURE_LIST))) {
     return EFI_INVALID_PARAMETER;
   }
-  // Get the signature database start
-  Ptr = (UINT8 *)SignatureDatabase;
-  End = Ptr + SignatureDatabaseSize;
-  while (Ptr < End) {
-    // Get each signature list in signature database
-    EFI_SIGNATURE_LIST *List = (EFI_SIGNATURE_LIST *)Ptr;
-    EFI_STATUS          Status;
-    if ((List->SignatureListSize <= sizeof(EFI_SIGNATURE_LIST)) || (List->SignatureSize <= sizeof(EFI_GUID))) {
-      return EFI_INVALID_PARAMETER;
-    }
-    // Remove the signature list from the database
-    Status = RemoveSignatureListFromDatabase(Database, DatabaseSize, List);
-    if (EFI_ERROR(Status)) {
-      return Status;
-    }
-    Ptr += List->SignatureListSize;
+  LoadAuthorizedDatabaseCopy();
+  // Add the signature database to the authorized database
+  Status = MergeSignatureDatabase(&mAuthDatabase, &mAuthDatabaseSize, Database, DatabaseSize);
+  if (EFI_ERROR(Status)) {
+    return Status;
   }
-  return EFI_SUCCESS;
+  return CommitAuthorizedDatabase();
 }
 
 // Remove image signature database from authorized database
 EFI_STATUS RemoveImageDatabaseFromAuthorizedDatabase(IN void  *Database,
                                                      IN UINTN  DatabaseSize)
 {
-  EFI_STATUS  Status;
-  void       *AuthDatabase;
-  UINTN       AuthDatabaseSize;
+  EFI_STATUS Status;
   // Check parameters
   if ((Database == NULL) || (DatabaseSize <= sizeof(EFI_SIGNATURE_LIST))) {
     return EFI_INVALID_PARAMETER;
   }
-  // Get the authorized database
-  AuthDatabase = GetAuthorizedDatabase(&AuthDatabaseSize);
+  LoadAuthorizedDatabaseCopy();
   // Remove the signature database from the authorized database
-  Status = RemoveSignatureDatabaseFromDatabase(&AuthDatabase, &AuthDatabaseSize, Database, DatabaseSize);
+  Status = RemoveSignatureDatabaseFromDatabase(&mAuthDatabase, &mAuthDatabaseSize, Database, DatabaseSize);
   if (EFI_ERROR(Status)) {
-    FreePool(AuthDatabase);
     return Status;
   }
-  // Check there is any to set
-  if (AuthDatabase == NULL) {
-    return ClearAuthorizedDatabase();
-  }
-  if (AuthDatabaseSize <= sizeof(EFI_SIGNATURE_LIST)) {
-    FreePool(AuthDatabase);
-    return ClearAuthorizedDatabase();
-  }
-  // Set the authorized database
-  Status = SetAuthorizedDatabase(AuthDatabase, AuthDatabaseSize);
-  FreePool(AuthDatabase);
-  return Status;
+  return CommitAuthorizedDatabase();
 }
 
 void *GetAuthorizedDatabase(UINTN *DatabaseSize)
 {
-   return GetSignatureDatabase(AUTHORIZED_DATABASE_NAME, &AUTHORIZED_DATABASE_GUID, DatabaseSize);
+  if (DatabaseSize == NULL) {
+    return NULL;
+  }
+  LoadAuthorizedDatabaseCopy();
+  *DatabaseSize = 0;
+  if (mAuthDatabase == NULL) {
+    return NULL;
+  }
+  *DatabaseSize = mAuthDatabaseSize;
+  return AllocateCopyPool(mAuthDatabaseSize, mAuthDatabase);
 }
 EFI_STATUS SetAuthorizedDatabase(IN void  *Database,
                                  IN UINTN  DatabaseSize)
 {
+   // Written now, a pending batch is replaced
+   DropAuthorizedDatabaseCopy();
    return SetSignatureDatabase(AUTHORIZED_DATABASE_NAME, &AUTHORIZED_DATABASE_GUID, Database, DatabaseSize);
 }
 
@@ -560,11 +528,10 @@ STATIC void *CreateImageSignatureDatabase(IN void   *FileBuffer,
   UINT8                               *ImageBase = (UINT8 *)FileBuffer;
   UINT8                               *HashBase = ImageBase;
   UINT8                               *HashPtr;
-  SHA256_CTX                           HashCtx;
+  SHA256_CONTEXT                       HashCtx;
   EFI_SIGNATURE_LIST                  *SignatureListPtr;
-  EFI_IMAGE_SECTION_HEADER            *Sections = NULL;
+  EFI_IMAGE_SECTION_HEADER           **Sections = NULL;
   EFI_IMAGE_SECTION_HEADER            *SectionPtr;
-  EFI_IMAGE_SECTION_HEADER            *SectionEnd;
   EFI_IMAGE_DOS_HEADER                *DosHeader;
   EFI_IMAGE_OPTIONAL_HEADER_PTR_UNION  PeHeader;
   UINT32                               PeHeaderOffset;
@@ -612,13 +579,9 @@ STATIC void *CreateImageSignatureDatabase(IN void   *FileBuffer,
   }
   HashSize = (UINTN)(HashPtr - HashBase);
   // Initialize the hash context
-  if (SHA256_Init(&HashCtx) == 0) {
-    goto Failed;
-  }
+  Sha256Init(&HashCtx);
   // Begin hashing the pe image
-  if (SHA256_Update(&HashCtx, HashBase, HashSize) == 0) {
-    goto Failed;
-  }
+  Sha256Update(&HashCtx, HashBase, HashSize);
   // Skip the checksum
   HashBase = HashPtr + sizeof(UINT32);
   // Skip over the security directory if present
@@ -629,9 +592,7 @@ STATIC void *CreateImageSignatureDatabase(IN void   *FileBuffer,
       HashPtr = (UINT8 *)(&(PeHeader.Pe32->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY]));
       HashSize = (HashPtr - HashBase);
       if (HashSize != 0) {
-        if (SHA256_Update(&HashCtx, HashBase, HashSize) == 0) {
-          goto Failed;
-        }
+        Sha256Update(&HashCtx, HashBase, HashSize);
       }
       // Set to point at the remaining data if any
       HashBase = (UINT8 *)(&(PeHeader.Pe32->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY + 1]));
@@ -645,9 +606,7 @@ STATIC void *CreateImageSignatureDatabase(IN void   *FileBuffer,
       HashPtr = (UINT8 *)(&(PeHeader.Pe32Plus->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY]));
       HashSize = (HashPtr - HashBase);
       if (HashSize != 0) {
-        if (SHA256_Update(&HashCtx, HashBase, HashSize) == 0) {
-          goto Failed;
-        }
+        Sha256Update(&HashCtx, HashBase, HashSize);
       }
       // Set to point at the remaining data if any
       HashBase = (UINT8 *)(&(PeHeader.Pe32Plus->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY + 1]));
@@ -658,15 +617,13 @@ STATIC void *CreateImageSignatureDatabase(IN void   *FileBuffer,
   // Hash the rest of the data directories if any
   HashSize = BytesHashed - (UINTN)(HashBase - ImageBase);
   if (HashSize != 0) {
-    if (SHA256_Update(&HashCtx, HashBase, HashSize) == 0) {
-      goto Failed;
-    }
+    Sha256Update(&HashCtx, HashBase, HashSize);
   }
   // Get the image section headers
   SectionPtr = (EFI_IMAGE_SECTION_HEADER *)(ImageBase + PeHeaderOffset + sizeof(EFI_IMAGE_FILE_HEADER) +
                                             sizeof(UINT32) + PeHeader.Pe32->FileHeader.SizeOfOptionalHeader);
-  // Allocate a new array for the image section headers
-  Sections = (__typeof__(Sections))AllocateZeroPool(sizeof(EFI_IMAGE_SECTION_HEADER) * PeHeader.Pe32->FileHeader.NumberOfSections);
+  // Allocate an array of pointers to the image section headers, the sections are hashed in place
+  Sections = (__typeof__(Sections))AllocateZeroPool(sizeof(*Sections) * PeHeader.Pe32->FileHeader.NumberOfSections);
   if (Sections == NULL) {
     goto Failed;
   }
@@ -674,26 +631,28 @@ STATIC void *CreateImageSignatureDatabase(IN void   *FileBuffer,
   Index = 0;
   while (Index < PeHeader.Pe32->FileHeader.NumberOfSections) {
     UINTN Pos = Index++;
-    while ((Pos > 0) && (SectionPtr->PointerToRawData < Sections[Pos - 1].PointerToRawData)) {
-      CopyMem(&Sections[Pos], &Sections[Pos - 1], sizeof(EFI_IMAGE_SECTION_HEADER));
+    while ((Pos > 0) && (SectionPtr->PointerToRawData < Sections[Pos - 1]->PointerToRawData)) {
+      Sections[Pos] = Sections[Pos - 1];
       --Pos;
     }
-    CopyMem(&Sections[Pos], SectionPtr++, sizeof(EFI_IMAGE_SECTION_HEADER));
+    Sections[Pos] = SectionPtr++;
   }
   // Hash each image section
-  SectionEnd = Sections + PeHeader.Pe32->FileHeader.NumberOfSections;
-  for (SectionPtr = Sections; SectionPtr < SectionEnd; ++SectionPtr) {
+  for (Index = 0; Index < PeHeader.Pe32->FileHeader.NumberOfSections; ++Index) {
+    SectionPtr = Sections[Index];
     // Nothing to do if no size
     if (SectionPtr->SizeOfRawData == 0) {
       continue;
     }
+    // The section must be in the file
+    if ((UINT64)SectionPtr->PointerToRawData + SectionPtr->SizeOfRawData > FileSize) {
+      goto Failed;
+    }
     // Calculate hash base and size
     HashBase  = ImageBase + SectionPtr->PointerToRawData;
     HashSize  = (UINTN)SectionPtr->SizeOfRawData;
     // Hash the image section
-    if (SHA256_Update(&HashCtx, HashBase, HashSize) == 0) {
-      goto Failed;
-    }
+    Sha256Update(&HashCtx, HashBase, HashSize);
     BytesHashed += HashSize;
   }
   // Hash any data remaining after the sections
@@ -704,9 +663,7 @@ STATIC void *CreateImageSignatureDatabase(IN void   *FileBuffer,
     }
     HashSize = (UINTN)(FileSize - (BytesHashed + CertSize));
     if (HashSize != 0) {
-      if (SHA256_Update(&HashCtx, HashBase, HashSize) == 0) {
-        goto Failed;
-      }
+      Sha256Update(&HashCtx, HashBase, HashSize);
     }
   }
   // Create the signature list
@@ -722,9 +679,7 @@ STATIC void *CreateImageSignatureDatabase(IN void   *FileBuffer,
   SignatureListPtr->SignatureSize = (UINT32)(Size - sizeof(EFI_SIGNATURE_LIST));
   // Finalize the hash by placing it in the signature list
   HashPtr = ((UINT8 *)(Database)) + sizeof(EFI_SIGNATURE_LIST) + sizeof(EFI_GUID);
-  if (SHA256_Final(HashPtr, &HashCtx) == 0) {
-    goto Failed;
-  }
+  Sha256Final(&HashCtx, HashPtr);
   // Cleanup and return success
   FreePool(Sections);
   *DatabaseSize = Size;
@@ -741,6 +696,21 @@ Failed:
   return NULL;
 }
 
+// Get the Authenticode SHA-256 of an image
+BOOLEAN GetImageHash(IN  void   *FileBuffer,
+                     IN  UINT64  FileSize,
+                     OUT UINT8  *Hash)
+{
+  UINTN  Size = 0;
+  UINT8 *Database = (UINT8 *)CreateImageSignatureDatabase(FileBuffer, FileSize, &Size);
+  if (Database == NULL) {
+    return FALSE;
+  }
+  CopyMem(Hash, Database + sizeof(EFI_SIGNATURE_LIST) + sizeof(EFI_GUID), SHA256_DIGEST_SIZE);
+  FreePool(Database);
+  return TRUE;
+}
+
 // Get a secure boot image signature
 void *GetImageSignatureDatabase(IN void    *FileBuffer,
                                 IN UINT64   FileSize,
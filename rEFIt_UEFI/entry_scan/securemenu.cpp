@@ -406,6 +406,8 @@ STATIC REFIT_MENU_SCREEN  SecureBootPolicyMenu = { 0, L"Secure Boot Policy", NUL
 BOOLEAN ConfigureSecureBoot(void)
 {
   BOOLEAN StillConfiguring = TRUE;
+  // The image authentications inserted or removed are written once, when leaving the menu
+  BeginAuthorizedDatabaseBatch();
   do
   {
     UINTN             Index = 0, MenuExit;
@@ -493,6 +495,7 @@ BOOLEAN ConfigureSecureBoot(void)
           DBG("User disabled secure boot\n");
           DisableSecureBoot();
           if (!gSettings.SecureBoot) {
+            EndAuthorizedDatabaseBatch();
             return TRUE;
           }
           AlertMessage(L"Disable Secure Boot", L"Disabling secure boot failed!\nClover does not appear to own the PK");
@@ -508,6 +511,9 @@ BOOLEAN ConfigureSecureBoot(void)
     }
     FreePool(SecureBootPolicyEntry.Title);
   } while (StillConfiguring);
+  if (EFI_ERROR(EndAuthorizedDatabaseBatch())) {
+    AlertMessage(L"Image Authentication", L"Writing the image authentication database failed!");
+  }
   return FALSE;
 }
 
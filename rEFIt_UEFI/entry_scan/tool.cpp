@@ -195,7 +195,7 @@ void ScanTool(void)
     return;
 
   //    DBG("Scanning for tools...\n");
-  if (!(ThemeX.HideUIFlags & HIDEUI_FLAG_SHELL)) {
+  if (!(ThemeX.HideUIFlags & HIDEUI_FLAG_SHELL) && !SelfVolume->MenuScanned) {
     if (!AddToolEntry(SWPrintf("%ls\\tools\\Shell64U.efi", self.getCloverDirFullPath().wc_str()), NULL, L"UEFI Shell 64", SelfVolume, ThemeX.GetIcon(BUILTIN_ICON_TOOL_SHELL), 'S', NullXString8Array)) {
       AddToolEntry(SWPrintf("%ls\\tools\\Shell64.efi", self.getCloverDirFullPath().wc_str()), NULL, L"EFI Shell 64", SelfVolume, ThemeX.GetIcon(BUILTIN_ICON_TOOL_SHELL), 'S', NullXString8Array);
     }
@@ -204,7 +204,7 @@ void ScanTool(void)
 //  if (!gFirmwareClover) { //Slice: I wish to extend functionality on emulated nvram
     for (VolumeIndex = 0; VolumeIndex < Volumes.size(); VolumeIndex++) {
       Volume = &Volumes[VolumeIndex];
-      if (!Volume->RootDir || !Volume->DeviceHandle) {
+      if (!Volume->RootDir || !Volume->DeviceHandle || Volume->MenuScanned) {
         continue;
       }
 
@@ -257,6 +257,9 @@ void AddCustomTool(void)
     }
     for (VolumeIndex = 0; VolumeIndex < Volumes.size(); ++VolumeIndex) {
       Volume = &Volumes[VolumeIndex];
+      if (Volume->MenuScanned) {
+        continue;
+      }
 
       DBG("   Checking volume \"%ls\" (%ls) ... ", Volume->VolName, Volume->DevicePathString);
 
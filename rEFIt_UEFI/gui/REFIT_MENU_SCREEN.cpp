@@ -53,6 +53,7 @@
 #include "../Platform/Nvram.h"
 #include "../refit/screen.h"
 #include "../Platform/Events.h"
+#include "../entry_scan/entry_scan.h" // for FetchNextEntryInfo
 #include "Self.h"
 
 #ifndef DEBUG_ALL
@@ -216,6 +217,7 @@ void REFIT_MENU_SCREEN::InitScroll(IN INTN ItemCount, IN UINTN MaxCount,
   ScrollState.IsScrolling = (ScrollState.MaxFirstVisible > 0);
   ScrollState.PaintAll = TRUE;
   ScrollState.PaintSelection = FALSE;
+  ScrollState.ScrolledRows = 0;
 
   ScrollState.LastVisible = ScrollState.FirstVisible + ScrollState.MaxVisible;
 
@@ -247,6 +249,8 @@ void REFIT_MENU_SCREEN::UpdateScroll(IN UINTN Movement)
 {
   INTN Lines;
   UINTN ScrollMovement = SCROLL_SCROLL_DOWN;
+  INTN OldFirstVisible = ScrollState.FirstVisible;
+  BOOLEAN OldPaintAll = ScrollState.PaintAll;
   ScrollState.LastSelection = ScrollState.CurrentSelection;
 
   switch (Movement) {
@@ -413,6 +417,12 @@ void REFIT_MENU_SCREEN::UpdateScroll(IN UINTN Movement)
   if (!ScrollState.PaintAll && ScrollState.CurrentSelection != ScrollState.LastSelection)
     ScrollState.PaintSelection = TRUE;
   ScrollState.LastVisible = ScrollState.FirstVisible + ScrollState.MaxVisible;
+  // scrolled by one line and nothing else to repaint: the style may move the rows on the screen
+  ScrollState.ScrolledRows = 0;
+  if (ScrollState.PaintAll && !OldPaintAll &&
+      (ScrollState.FirstVisible == OldFirstVisible + 1 || ScrollState.FirstVisible == OldFirstVisible - 1)) {
+    ScrollState.ScrolledRows = ScrollState.FirstVisible - OldFirstVisible;
+  }
 
   //ycr.ru
   if ((ScrollState.PaintAll) && (Movement != SCROLL_NONE))
@@ -676,7 +686,9 @@ UINTN REFIT_MENU_SCREEN::InputDialog(IN MENU_STYLE_FUNC  StyleFunc)
     }
     // Redraw the field
     (Entries[ScrollState.CurrentSelection]).Row = Pos;
+    egScreenBeginFrame();
     ((*this).*(StyleFunc))(MENU_FUNCTION_PAINT_SELECTION, NULL);
+    egScreenEndFrame();
   } while (!MenuExit);
 
   switch (MenuExit) {
@@ -708,29 +720,103 @@ UINTN REFIT_MENU_SCREEN::InputDialog(IN MENU_STYLE_FUNC  StyleFunc)
 // return EFI_TIMEOUT if no inputs
 //the function must be in menu_screen class
 //so UpdatePointer(); => mPointer.Update(&gItemID, &Screen->mAction);
+// Sleeps in WaitForEvent on the key, the pointer, the timeout and, only while something moves
+// on the screen, a 10ms frame timer. A still menu doesn't wake until an input or the timeout.
+// While loader entries wait for their info (LazyEntryInfo), each frame tick fetches one; the main
+// menu then returns EFI_NOT_READY with PaintAll set, so the caller redraws it.
+// Pointer input is coalesced per frame: after a pointer event the pointer is left out of the wait
+// until the next frame tick, which reads all the movement at once, so CheckMouseEvent() runs once
+// per redraw instead of once per firmware pointer report.
 EFI_STATUS REFIT_MENU_SCREEN::WaitForInputEventPoll(UINTN TimeoutDefault)
 {
-  EFI_STATUS Status = EFI_SUCCESS;
-  UINTN TimeoutRemain = TimeoutDefault * 100;
+  EFI_STATUS Status;
+  EFI_EVENT  TimeoutEvent = NULL;
+  EFI_EVENT  FrameEvent = NULL;
+  EFI_EVENT  PointerEvent;
+  EFI_EVENT  WaitList[4];
+  UINTN      Count;
+  UINTN      Index;
+  UINTN      Settle = 0; // frame ticks after a pointer input, UpdatePointer() reports a move one update late
+  BOOLEAN    PointerPending = FALSE; // pointer input waiting for the next frame tick
+  BOOLEAN    InfoPending = GlobalConfig.LazyEntryInfo && EntryInfoPending();
+
+  if (gSettings.PlayAsync) {
+    CheckSyncSound(false); // only frees the samples of a finished sound, once per wait is enough
+  }
 
-  while (TimeoutRemain != 0) {
-    Status = WaitFor2EventWithTsc(gST->ConIn->WaitForKey, NULL, 10);
-    if (Status != EFI_TIMEOUT) {
+  Status = gBS->CreateEvent(EVT_TIMER, 0, NULL, NULL, &TimeoutEvent);
+  if (!EFI_ERROR(Status)) {
+    Status = gBS->CreateEvent(EVT_TIMER, 0, NULL, NULL, &FrameEvent);
+  }
+  if (EFI_ERROR(Status)) {
+    if (TimeoutEvent != NULL) {
+      gBS->CloseEvent(TimeoutEvent);
+    }
+    return WaitFor2EventWithTsc(gST->ConIn->WaitForKey, NULL, TimeoutDefault * 1000); // no timers : key only
+  }
+  gBS->SetTimer(TimeoutEvent, TimerRelative, MultU64x32(TimeoutDefault, 10000000));
+  gBS->SetTimer(FrameEvent, TimerPeriodic, 100000);
+
+  for (;;) {
+    PointerEvent = mPointer.isAlive() ? mPointer.GetWaitEvent() : NULL;
+    Count = 0;
+    WaitList[Count++] = gST->ConIn->WaitForKey;
+    WaitList[Count++] = TimeoutEvent;
+    // a signaled pointer event stays signaled until the state is read, so it waits for the frame tick
+    if (PointerEvent != NULL && !PointerPending) {
+      WaitList[Count++] = PointerEvent;
+    }
+    // a pointer without event is polled at the frame rate
+    if ((FilmC != nullptr && FilmC->AnimeRun) || Settle != 0 || PointerPending || (mPointer.isAlive() && PointerEvent == NULL) || InfoPending) {
+      WaitList[Count++] = FrameEvent;
+    }
+    Status = gBS->WaitForEvent(Count, WaitList, &Index);
+    if (EFI_ERROR(Status)) {
+      Status = WaitFor2EventWithTsc(gST->ConIn->WaitForKey, NULL, TimeoutDefault * 1000);
       break;
     }
-    UpdateFilm();
-    if (gSettings.PlayAsync) {
-      CheckSyncSound(false);
+    if (Index == 0) {
+      break;
+    }
+    if (Index == 1) {
+      Status = EFI_TIMEOUT;
+      break;
+    }
+    if (WaitList[Index] == PointerEvent) {
+      Settle = 2;
+      PointerPending = TRUE;
+      continue;
+    }
+    if (Settle != 0) {
+      Settle--;
+    }
+    PointerPending = FALSE;
+    if (InfoPending && WaitList[Index] == FrameEvent) {
+      if (FetchNextEntryInfo() && this == &MainMenu) {
+        ScrollState.PaintAll = TRUE;
+        Status = EFI_NOT_READY;
+        break;
+      }
+      InfoPending = EntryInfoPending();
     }
-    TimeoutRemain--;
+    egScreenBeginFrame(); // film frame and pointer reach the screen together
+    UpdateFilm();
     if (mPointer.isAlive()) {
       mPointer.UpdatePointer(!Daylight);
+    }
+    egScreenEndFrame();
+    if (mPointer.isAlive()) {
+      if (mPointer.GetEvent() != NoEvents) {
+        Settle = 2;
+      }
       Status = CheckMouseEvent(); //out: mItemID, mAction
       if (Status != EFI_TIMEOUT) { //this check should return timeout if no mouse events occured
         break;
       }
     }
   }
+  gBS->CloseEvent(FrameEvent);
+  gBS->CloseEvent(TimeoutEvent);
   return Status;
 }
 
@@ -807,10 +893,12 @@ UINTN REFIT_MENU_SCREEN::RunGenericMenu(IN MENU_STYLE_FUNC StyleFunc, IN OUT INT
     }
 
 
-    // update the screen
+    // update the screen. Every change is blitted at egScreenEndFrame()
+    egScreenBeginFrame();
     if (ScrollState.PaintAll) {
       ((*this).*(StyleFunc))(MENU_FUNCTION_PAINT_ALL, NULL);
       ScrollState.PaintAll = FALSE;
+      ScrollState.ScrolledRows = 0;
     } else if (ScrollState.PaintSelection) {
       ((*this).*(StyleFunc))(MENU_FUNCTION_PAINT_SELECTION, NULL);
       ScrollState.PaintSelection = FALSE;
@@ -820,6 +908,7 @@ UINTN REFIT_MENU_SCREEN::RunGenericMenu(IN MENU_STYLE_FUNC StyleFunc, IN OUT INT
       XStringW TOMessage = SWPrintf("%ls in %lld seconds", TimeoutText.wc_str(), TimeoutCountdown);
       ((*this).*(StyleFunc))(MENU_FUNCTION_PAINT_TIMEOUT, TOMessage.wc_str());
     }
+    egScreenEndFrame();
 
     if (gEvent) { //for now used at CD eject.
       MenuExit = MENU_EXIT_ESCAPE;
@@ -836,6 +925,7 @@ UINTN REFIT_MENU_SCREEN::RunGenericMenu(IN MENU_STYLE_FUNC StyleFunc, IN OUT INT
     
     Status = WaitForInputEventPoll(1); //wait for 1 seconds.
     if (Status == EFI_TIMEOUT) {
+      flushDebugLog(); // nothing to do, write buffered log
       if (HaveTimeout) {
         if (TimeoutCountdown <= 0) {
           // timeout expired
@@ -1669,12 +1759,26 @@ void REFIT_MENU_SCREEN::GraphicsMenuStyle(IN UINTN Function, IN CONST CHAR16 *Pa
 
     case MENU_FUNCTION_PAINT_ALL:
     {
+      if (FilmC != nullptr) FilmC->ForceFullDraw(); //the film place may be painted over
       //         DBG("PAINT_ALL: EntriesPosY=%lld MaxVisible=%lld\n", EntriesPosY, ScrollState.MaxVisible);
       //          DBG("DownButton.Height=%lld TextHeight=%lld MenuWidth=%lld\n", DownButton.Height, TextHeight, MenuWidth);
       t2 = EntriesPosY + (ScrollState.MaxVisible + 1) * ThemeX.TextHeight - DownButton.Height;
       t1 = EntriesPosX + ThemeX.TextHeight + MenuWidth  + (INTN)((TEXT_XMARGIN + 16) * ThemeX.Scale);
       //          DBG("PAINT_ALL: X=%lld Y=%lld\n", t1, t2);
       SetBar(t1, EntriesPosY, t2, &ScrollState); //823 302 554
+
+      // one line scroll: the rows still visible are moved, only the new row and the selection change are painted.
+      // The band goes to the right edge of the screen, it holds the scrollbar, drawn again below
+      INTN Scrolled = ScrollState.ScrolledRows;
+      ScrollState.ScrolledRows = 0;
+      if (Scrolled != 0 && ScrollState.MaxVisible > 0) {
+        UINTN BandHeight = ScrollState.MaxVisible * ThemeX.TextHeight;
+        if (Scrolled > 0) {
+          egScreenMoveRect(EntriesPosX, EntriesPosY + ThemeX.TextHeight, UGAWidth - EntriesPosX, BandHeight, EntriesPosX, EntriesPosY);
+        } else {
+          egScreenMoveRect(EntriesPosX, EntriesPosY, UGAWidth - EntriesPosX, BandHeight, EntriesPosX, EntriesPosY + ThemeX.TextHeight);
+        }
+      }
       /*
        48:307  39:206  UGAWIdth=800 TitleImage=48 MenuWidth=333
        48:635  0:328  PAINT_ALL: EntriesPosY=259 MaxVisible=13
@@ -1702,6 +1806,11 @@ void REFIT_MENU_SCREEN::GraphicsMenuStyle(IN UINTN Function, IN CONST CHAR16 *Pa
         ctrlTextX = ctrlX + ThemeX.Buttons[0].GetWidth() + (INTN)(TEXT_XMARGIN * ThemeX.Scale / 2);
         ctrlY = Entry->Place.YPos + PlaceCentre;
 
+        if (Scrolled != 0 && i != ScrollState.CurrentSelection && i != ScrollState.LastSelection &&
+            j != ((Scrolled > 0) ? ScrollState.MaxVisible : 0)) {
+          continue; // moved with the band
+        }
+
         if ( Entry->getREFIT_INPUT_DIALOG() ) {
           REFIT_INPUT_DIALOG* inputDialogEntry = Entry->getREFIT_INPUT_DIALOG();
           if (inputDialogEntry->Item && inputDialogEntry->Item->ItemType == BoolValue) {
@@ -2002,7 +2111,8 @@ void REFIT_MENU_SCREEN::DrawTextCorner(UINTN TextC, UINT8 Align)
   DrawTextXY(Text, Xpos, UGAHeight - (INTN)(ThemeX.TextHeight * 1.5f), Align);
 }
 
-void REFIT_MENU_SCREEN::DrawMainMenuEntry(REFIT_ABSTRACT_MENU_ENTRY *Entry, BOOLEAN selected, INTN XPos, INTN YPos)
+//the tile of the entry: selection, icon and badge composed on the background at XPos, YPos
+void REFIT_MENU_SCREEN::ComposeMainMenuEntry(REFIT_ABSTRACT_MENU_ENTRY *Entry, BOOLEAN selected, INTN XPos, INTN YPos, XImage& Back)
 {
   INTN MainSize = ThemeX.MainEntriesSize;
 //  XImage MainImage(MainSize, MainSize);
@@ -2051,7 +2161,7 @@ void REFIT_MENU_SCREEN::DrawMainMenuEntry(REFIT_ABSTRACT_MENU_ENTRY *Entry, BOOL
     CompWidth = TopImage.GetWidth();
     CompHeight = CompWidth;
   }
-  XImage Back(CompWidth, CompHeight);
+  Back = XImage(CompWidth, CompHeight);
   Back.CopyRect(ThemeX.Background, XPos, YPos);
 
   INTN OffsetX = (CompWidth - MainImage->GetWidth()) / 2;
@@ -2117,7 +2227,23 @@ void REFIT_MENU_SCREEN::DrawMainMenuEntry(REFIT_ABSTRACT_MENU_ENTRY *Entry, BOOL
   if(ThemeX.SelectionOnTop) {
     Back.Compose(OffsetTX, OffsetTY, TopImage, false); //selection at the top
   }
-  Back.DrawWithoutCompose(XPos, YPos);
+}
+
+void REFIT_MENU_SCREEN::DrawMainMenuEntry(REFIT_ABSTRACT_MENU_ENTRY *Entry, BOOLEAN selected, INTN XPos, INTN YPos)
+{
+  INTN Index = selected ? 1 : 0;
+
+  // both tiles are composed together, a selection change then only draws them
+  if (Entry->TileGeneration != ThemeX.BackgroundGeneration || Entry->Tile[Index].isEmpty() ||
+      Entry->TilePlace.XPos != XPos || Entry->TilePlace.YPos != YPos) {
+    ComposeMainMenuEntry(Entry, FALSE, XPos, YPos, Entry->Tile[0]);
+    ComposeMainMenuEntry(Entry, TRUE, XPos, YPos, Entry->Tile[1]);
+    Entry->TilePlace = Entry->Place;
+    Entry->TileGeneration = ThemeX.BackgroundGeneration;
+  } else {
+    Entry->Place = Entry->TilePlace;
+  }
+  Entry->Tile[Index].DrawWithoutCompose(XPos, YPos);
 
 
   // draw BCS indicator
@@ -2128,9 +2254,9 @@ void REFIT_MENU_SCREEN::DrawMainMenuEntry(REFIT_ABSTRACT_MENU_ENTRY *Entry, BOOL
       const XImage& SelImage = ThemeX.SelectionImages[4 + (selected ? 0 : 1)];
       XPos = XPos + (ThemeX.row0TileSize / 2) - (INTN)(INDICATOR_SIZE * 0.5f * ThemeX.Scale);
       YPos = row0PosY + ThemeX.row0TileSize + ThemeX.TextHeight + (INTN)((BCSMargin * 2) * ThemeX.Scale);
-      CompWidth = (INTN)(INDICATOR_SIZE * ThemeX.Scale);
-      CompHeight = (INTN)(INDICATOR_SIZE * ThemeX.Scale);
-      Back = XImage(CompWidth, CompHeight);
+      INTN CompWidth = (INTN)(INDICATOR_SIZE * ThemeX.Scale);
+      INTN CompHeight = (INTN)(INDICATOR_SIZE * ThemeX.Scale);
+      XImage Back(CompWidth, CompHeight);
       Back.CopyRect(ThemeX.Background, XPos, YPos);
       Back.Compose(0, 0, SelImage, false);
       Back.DrawWithoutCompose(XPos, YPos);
@@ -2215,6 +2341,7 @@ void REFIT_MENU_SCREEN::MainMenuVerticalStyle(IN UINTN Function, IN CONST CHAR16
       break;
 
     case MENU_FUNCTION_PAINT_ALL:
+      if (FilmC != nullptr) FilmC->ForceFullDraw(); //the film place may be painted over
       SetBar(EntriesPosX + EntriesWidth + (int)(10 * ThemeX.Scale),
              EntriesPosY, UGAHeight - (int)(LAYOUT_Y_EDGE * ThemeX.Scale), &ScrollState);
       for (INTN i = 0; i <= ScrollState.MaxIndex; i++) {
@@ -2387,6 +2514,7 @@ void REFIT_MENU_SCREEN::MainMenuStyle(IN UINTN Function, IN CONST CHAR16 *ParamT
       break;
 
     case MENU_FUNCTION_PAINT_ALL:
+      if (FilmC != nullptr) FilmC->ForceFullDraw(); //the film place may be painted over
     
       for (INTN i = 0; i <= ScrollState.MaxIndex; i++) {
         if (Entries[i].Row == 0) {
@@ -2593,15 +2721,14 @@ UINTN REFIT_MENU_SCREEN::RunMainMenu(IN INTN DefaultSelection, OUT REFIT_ABSTRAC
     DBG("AnimeRun=%d\n", (FilmC && FilmC->AnimeRun)?1:0);
     MenuExit = RunGenericMenu(MainStyle, &DefaultEntryIndex, &MainChosenEntry);
     TimeoutSeconds = 0;
+    if (MenuExit == MENU_EXIT_DETAILS && MainChosenEntry->getLOADER_ENTRY()) {
+      MainChosenEntry->getLOADER_ENTRY()->FetchEntryInfo(); // the options submenu is made from it
+    }
 
     if (MenuExit == MENU_EXIT_DETAILS && MainChosenEntry->SubScreen != NULL) {
-      XString8Array TmpArgs;
-      if ( gSettings.BootArgs.length() > 0) {
-        TmpArgs = Split<XString8Array>(gSettings.BootArgs, " ");
-      }
       SubMenuIndex = -1;
 
-      gSettings.OptionsBits = EncodeOptions(TmpArgs);
+      gSettings.OptionsBits = EncodeOptions(gSettings.BootArgs);
 //      DBG("main OptionsBits = 0x%X\n", gSettings.OptionsBits);
 
       if (MainChosenEntry->getLOADER_ENTRY()) {
@@ -46,6 +46,7 @@
 #include "../../cpp_foundation/XString.h"
 #include "../../libeg/XPointer.h"
 #include "../../Platform/MacOsVersion.h"
+#include "../../Platform/MemoryOperation.h"
 
 
 //
@@ -88,6 +89,7 @@ class REFIT_MENU_ITEM_OPTIONS;
 class REFIT_MENU_ITEM_ABSTRACT_ENTRY_LOADER;
 class LOADER_ENTRY;
 class LEGACY_ENTRY;
+class KEXT_INFO_PLIST;
 class REFIT_MENU_ENTRY_OTHER;
 class REFIT_SIMPLE_MENU_ENTRY_TAG;
 class REFIT_MENU_ENTRY_ITEM_ABSTRACT;
@@ -107,6 +109,9 @@ class REFIT_ABSTRACT_MENU_ENTRY
   CHAR16             ShortcutLetter;
   XIcon              Image;
   EG_RECT            Place;
+  XImage             Tile[2];        // main menu tile composed on the background, unselected and selected
+  EG_RECT            TilePlace;      // where the tiles were composed, Width and Height as Place
+  UINTN              TileGeneration; // ThemeX.BackgroundGeneration of the tiles
   ACTION             AtClick;
   ACTION             AtDoubleClick;
   ACTION             AtRightClick;
@@ -139,16 +144,16 @@ class REFIT_ABSTRACT_MENU_ENTRY
   virtual void StartTool() {};
 
   REFIT_ABSTRACT_MENU_ENTRY()
-      : Title(), Hidden(0), Row(0), ShortcutDigit(0), ShortcutLetter(0), Image(), Place(), AtClick(ActionNone), AtDoubleClick(ActionNone), AtRightClick(ActionNone), AtMouseOver(ActionNone), SubScreen(NULL)
+      : Title(), Hidden(0), Row(0), ShortcutDigit(0), ShortcutLetter(0), Image(), Place(), Tile(), TilePlace(), TileGeneration(0), AtClick(ActionNone), AtDoubleClick(ActionNone), AtRightClick(ActionNone), AtMouseOver(ActionNone), SubScreen(NULL)
       {};
   REFIT_ABSTRACT_MENU_ENTRY(const XStringW& Title_)
-      : Title(Title_), Hidden(0), Row(0), ShortcutDigit(0), ShortcutLetter(0), Image(), Place(), AtClick(ActionNone), AtDoubleClick(ActionNone), AtRightClick(ActionNone), AtMouseOver(ActionNone), SubScreen(NULL)
+      : Title(Title_), Hidden(0), Row(0), ShortcutDigit(0), ShortcutLetter(0), Image(), Place(), Tile(), TilePlace(), TileGeneration(0), AtClick(ActionNone), AtDoubleClick(ActionNone), AtRightClick(ActionNone), AtMouseOver(ActionNone), SubScreen(NULL)
       {};
   REFIT_ABSTRACT_MENU_ENTRY(const XStringW& Title_, ACTION AtClick_)
-      : Title(Title_), Hidden(0), Row(0), ShortcutDigit(0), ShortcutLetter(0), Image(), Place(), AtClick(AtClick_), AtDoubleClick(ActionNone), AtRightClick(ActionNone), AtMouseOver(ActionNone), SubScreen(NULL)
+      : Title(Title_), Hidden(0), Row(0), ShortcutDigit(0), ShortcutLetter(0), Image(), Place(), Tile(), TilePlace(), TileGeneration(0), AtClick(AtClick_), AtDoubleClick(ActionNone), AtRightClick(ActionNone), AtMouseOver(ActionNone), SubScreen(NULL)
       {};
   REFIT_ABSTRACT_MENU_ENTRY(const XStringW& Title_, UINTN Row_, CHAR16 ShortcutDigit_, CHAR16 ShortcutLetter_, ACTION AtClick_)
-      : Title(Title_), Hidden(0), Row(Row_), ShortcutDigit(ShortcutDigit_), ShortcutLetter(ShortcutLetter_), Image(), Place(), AtClick(AtClick_), AtDoubleClick(ActionNone), AtRightClick(ActionNone), AtMouseOver(ActionNone), SubScreen(NULL)
+      : Title(Title_), Hidden(0), Row(Row_), ShortcutDigit(ShortcutDigit_), ShortcutLetter(ShortcutLetter_), Image(), Place(), Tile(), TilePlace(), TileGeneration(0), AtClick(AtClick_), AtDoubleClick(ActionNone), AtRightClick(ActionNone), AtMouseOver(ActionNone), SubScreen(NULL)
       {};
 //  REFIT_ABSTRACT_MENU_ENTRY(const XStringW& Title_, UINTN Row_,
 //                            CHAR16 ShortcutDigit_, CHAR16 ShortcutLetter_, const XIcon& Icon_,
@@ -227,9 +232,11 @@ class REFIT_ABSTRACT_MENU_ENTRY
 
 	class REFIT_MENU_ITEM_OPTIONS : public REFIT_ABSTRACT_MENU_ENTRY {
 	public:
-	  REFIT_MENU_ITEM_OPTIONS() : REFIT_ABSTRACT_MENU_ENTRY() {};
+	  REFIT_ABSTRACT_MENU_ENTRY* (*BuildSubMenu)(void); // if not NULL, makes the SubScreen when the entry is first entered
+
+	  REFIT_MENU_ITEM_OPTIONS() : REFIT_ABSTRACT_MENU_ENTRY(), BuildSubMenu(NULL) {};
 	  REFIT_MENU_ITEM_OPTIONS(const XStringW& Title_, UINTN Row_, CHAR16 ShortcutDigit_, CHAR16 ShortcutLetter_, ACTION AtClick_)
-				 : REFIT_ABSTRACT_MENU_ENTRY(Title_, Row_, ShortcutDigit_, ShortcutLetter_, AtClick_)
+				 : REFIT_ABSTRACT_MENU_ENTRY(Title_, Row_, ShortcutDigit_, ShortcutLetter_, AtClick_), BuildSubMenu(NULL)
 				 {};
 	  virtual REFIT_MENU_ITEM_OPTIONS* getREFIT_MENU_ITEM_OPTIONS() { return this; };
 	};
@@ -362,6 +369,35 @@ class REFIT_ABSTRACT_MENU_ENTRY
 
 			//---------------------------------------  LOADER_ENTRY  ---------------------------------------//
 
+			// built-in kext patches, selected by bundle id in PatchKext()
+			typedef enum {
+			  KextBuiltinNone,
+			  KextBuiltinATIConnectors,
+			  KextBuiltinAppleIntelCPUPM,
+			  KextBuiltinAppleRTC,
+			  KextBuiltinDellSMBIOS,
+			  KextBuiltinDellACPIPlatform,
+			  KextBuiltinBDWEIOPCI,
+			  KextBuiltinSNBEAICPU
+			} KEXT_BUILTIN_PATCH;
+
+			#define KEXT_PATCH_MAP_BUCKETS 64
+
+			typedef struct {
+			  UINT32              Hash;
+			  const CHAR8         *BundleId; // static string of a built-in patch, NULL for a KextPatches entry
+			  KEXT_BUILTIN_PATCH  Builtin;  // KextBuiltinNone for a KextPatches entry
+			  size_t              Patch;    // index in KextPatches
+			  INTN                Next;     // next entry in the bucket, -1 at end
+			} KEXT_PATCH_MAP_ENTRY;
+
+			// compiled kext patches of one kext, left for the APs in parallel mode
+			typedef struct {
+			  UINT8               *Driver;
+			  UINT32              DriverSize;
+			  size_t              FirstEntry; // KextPatchEntries.size() entries from here in KextPatchJobEntries
+			} KEXT_PATCH_JOB;
+
 			class LOADER_ENTRY : public REFIT_MENU_ITEM_BOOTNUM
 			{
 			  public:
@@ -373,6 +409,9 @@ class REFIT_ABSTRACT_MENU_ENTRY
 				UINT8             LoaderType;
 				MacOsVersion      OSVersion;
 				XString8          BuildVersion;
+				BOOLEAN           InfoPending;        // LazyEntryInfo: version, label and icon not read yet
+				XStringW          PendingFullTitle;   // CreateLoaderEntry() titles, to make the title again
+				XStringW          PendingLoaderTitle;
         EFI_GRAPHICS_OUTPUT_BLT_PIXEL BootBgColor;
 
 				UINT8             CustomBoot;
@@ -392,6 +431,7 @@ class REFIT_ABSTRACT_MENU_ENTRY
         BOOLEAN           is64BitKernel;
         UINT32            KernelSlide;
         UINT32            KernelOffset;
+        INT32             CtorUsedOffset;     // ctor_used string found by getVTable(), -1 if not searched yet
         // notes:
         // - 64bit segCmd64->vmaddr is 0xffffff80xxxxxxxx and we are taking
         //   only lower 32bit part into PrelinkTextAddr
@@ -412,33 +452,64 @@ class REFIT_ABSTRACT_MENU_ENTRY
         BootArgs2         *bootArgs2;
         CHAR8             *dtRoot;
         UINT32            *dtLength;
+        // compiled KernelPatches and KextPatches, same index as in KernelAndKextPatches
+        XArray<MULTI_PATTERN_ENTRY> KernelPatchEntries;
+        XArray<MULTI_PATTERN_ENTRY> KextPatchEntries;
+        MULTI_PATTERN_INDEX         *PatchIndex;
+        // kernel symtab entries sorted by name and by address, built by IndexKernelSymbols()
+        XArray<UINT32>              KernelSymbolsByName;
+        XArray<UINT32>              KernelSymbolsByAddr;
+        // bundle id -> built-in and user kext patches, built by KextPatcherStart()
+        XArray<KEXT_PATCH_MAP_ENTRY> KextPatchMap;
+        XArray<INTN>                 KextPatchMapHead;
+        XArray<size_t>               KextPatchesByName; // KextPatches whose Name is not a bundle id
+        XArray<size_t>               KextPatchMatches;  // KextPatches matching the current kext
+        // PatchKext() defers compiled patches to KextPatchJobs instead of applying them
+        BOOLEAN                      DeferKextPatches;
+        XArray<KEXT_PATCH_JOB>       KextPatchJobs;
+        XArray<MULTI_PATTERN_ENTRY>  KextPatchJobEntries;
+        // set by PrepareKextPatchJobs() while boot services are there, RunKextPatchJobs() only uses them
+        void                         *KextPatchMpServices;
+        EFI_EVENT                    KextPatchEvent;
+        MULTI_PATTERN_INDEX          *KextPatchIndexes;
+        UINT32                       KextPatchIndexCount;
         
 
 				LOADER_ENTRY()
 						: REFIT_MENU_ITEM_BOOTNUM(), APFSTargetUUID(), DisplayedVolName(), DevicePath(0), Flags(0), LoaderType(0), OSVersion(), BuildVersion(),
+              InfoPending(false), PendingFullTitle(), PendingLoaderTitle(),
               BootBgColor({0,0,0,0}),
               CustomBoot(0), CustomLogo(), KernelAndKextPatches(), Settings(), KernelData(0),
               AddrVtable(0), SizeVtable(0), NamesTable(0), SegVAddr(0), shift(0),
               PatcherInited(false), gSNBEAICPUFixRequire(false), gBDWEIOPCIFixRequire(false), isKernelcache(false), is64BitKernel(false),
-              KernelSlide(0), KernelOffset(0), PrelinkTextLoadCmdAddr(0), PrelinkTextAddr(0), PrelinkTextSize(0),
+              KernelSlide(0), KernelOffset(0), CtorUsedOffset(-1), PrelinkTextLoadCmdAddr(0), PrelinkTextAddr(0), PrelinkTextSize(0),
               PrelinkInfoLoadCmdAddr(0), PrelinkInfoAddr(0), PrelinkInfoSize(0),
-              KernelRelocBase(0), bootArgs1(0), bootArgs2(0), dtRoot(0), dtLength(0)
+              KernelRelocBase(0), bootArgs1(0), bootArgs2(0), dtRoot(0), dtLength(0),
+              KernelPatchEntries(), KextPatchEntries(), PatchIndex(0),
+              KernelSymbolsByName(), KernelSymbolsByAddr(),
+              KextPatchMap(), KextPatchMapHead(), KextPatchesByName(), KextPatchMatches(),
+              DeferKextPatches(false), KextPatchJobs(), KextPatchJobEntries(),
+              KextPatchMpServices(0), KextPatchEvent(0), KextPatchIndexes(0), KextPatchIndexCount(0)
 						{};
         LOADER_ENTRY(const LOADER_ENTRY&) = delete;
         LOADER_ENTRY& operator=(const LOADER_ENTRY&) = delete;
-        ~LOADER_ENTRY() {};
+        ~LOADER_ENTRY() { if ( PatchIndex ) delete PatchIndex; if ( KextPatchIndexes ) delete[] KextPatchIndexes; };
         
+        void          FetchEntryInfo();
         void          SetKernelRelocBase();
         void          FindBootArgs();
         EFI_STATUS    getVTable();
         void          Get_PreLink();
         UINT32        Get_Symtab(UINT8*  binary);
         UINT32        GetTextExec();
-        UINTN         searchProc(const XString8& procedure);
+        void          IndexKernelSymbols();
+        INTN          FindKernelSymbol(const XString8& procedure);
+        UINTN         searchProc(const XString8& procedure, UINTN *procLen = NULL);
         UINTN         searchProcInDriver(UINT8 * driver, UINT32 driverLen, const XString8& procedure);
         UINT32        searchSectionByNum(UINT8 * Binary, UINT32 Num);
         void          KernelAndKextsPatcherStart();
         void          KernelAndKextPatcherInit();
+        void          CompileUserPatches();
         BOOLEAN       KernelUserPatch();
         BOOLEAN       KernelPatchPm();
         BOOLEAN       KernelLapicPatch_32();
@@ -471,10 +542,18 @@ class REFIT_ABSTRACT_MENU_ENTRY
         void      AddKextsInArray(XObjArray<SIDELOAD_KEXT>* kextArray);
         void      KextPatcherRegisterKexts(void *FSInject, void *ForceLoadKexts);
         void      KextPatcherStart();
+        void      BuildKextPatchMap();
+        void      AddKextPatchMapEntry(const CHAR8 *BundleId, KEXT_BUILTIN_PATCH Builtin, size_t Patch);
+        KEXT_BUILTIN_PATCH FindKextPatches();
         void      PatchPrelinkedKexts();
         void      PatchLoadedKexts();
-        void      PatchKext(UINT8 *Driver, UINT32 DriverSize, CHAR8 *InfoPlist, UINT32 InfoPlistSize);
+        void      PatchKext(UINT8 *Driver, UINT32 DriverSize, CHAR8 *InfoPlist, UINT32 InfoPlistSize, BOOLEAN BundleIdKnown = FALSE);
         void      AnyKextPatch(UINT8 *Driver, UINT32 DriverSize, CHAR8 *InfoPlist, UINT32 InfoPlistSize, size_t N);
+        void      AnyKextPatchCompiled(UINT8 *Driver, UINT32 DriverSize);
+        void      ReportKextPatchCompiled(MULTI_PATTERN_ENTRY *Entries);
+        BOOLEAN   DeferKextPatchCompiled(UINT8 *Driver, UINT32 DriverSize);
+        void      PrepareKextPatchJobs();
+        void      RunKextPatchJobs();
         void      ATIConnectorsPatchInit();
         void      ATIConnectorsPatch(UINT8 *Driver, UINT32 DriverSize, CHAR8 *InfoPlist, UINT32 InfoPlistSize);
         void      ATIConnectorsPatchRegisterKexts(void *FSInject_v, void *ForceLoadKexts_v);
@@ -504,6 +583,7 @@ class REFIT_ABSTRACT_MENU_ENTRY
         XStringW getKextPlist(const XStringW& dirPath, const SIDELOAD_KEXT& KextEntry, BOOLEAN* NoContents);
         TagDict* getInfoPlist(const XStringW& infoPlistPath);
         XString8 getKextExecPath(const XStringW& dirPath, const SIDELOAD_KEXT& KextEntry, TagDict* dict, BOOLEAN NoContents);
+        void     PreloadKextsInfoPlist(const XObjArray<SIDELOAD_KEXT>& kextArray, XObjArray<KEXT_INFO_PLIST>* kextPlists);
 			} ;
 
 
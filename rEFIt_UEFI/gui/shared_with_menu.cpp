@@ -90,18 +90,45 @@ UINT32 EncodeOptions(const XString8Array& Options)
   return OptionsBits;
 }
 
+// Same as EncodeOptions(Split<XString8Array>(BootArgs, " ")), without copying the args
+UINT32 EncodeOptions(const XString8& BootArgs)
+{
+  UINT32 OptionsBits = 0;
+  INTN Index;
+  XArray<XString8View> Args;
+  XString8ViewSet ArgSet;
+  SplitViews(BootArgs.c_str(), " ", Args);
+  if (Args.isEmpty()) {
+    return 0;
+  }
+  for (size_t i = 0; i < Args.size(); i++) {
+    ArgSet.add(Args.ElementAt(i));
+  }
+  for (Index = 0; Index < NUM_OPT; Index++) {
+    if ( ArgSet.contains(XString8View(ArgOptional[Index])) ) {
+      OptionsBits |= (1 << Index);
+      if (Index == 1) {
+        OptionsBits &= ~1;
+      }
+    }
+  }
+  return OptionsBits;
+}
+
 void DecodeOptions(REFIT_MENU_ITEM_BOOTNUM *Entry)
 {
   //set checked option
   INTN Index;
+  XArray<XString8View> Checked;
   if (!Entry) {
     return;
   }
   for (Index = 0; Index < INX_NVWEBON; Index++) { //not including INX_NVWEBON
     if (gSettings.OptionsBits & (1 << Index)) {
-      Entry->LoadOptions.AddID(ArgOptional[Index]);
+      Checked.Add(XString8View(ArgOptional[Index]));
     }
   }
+  Entry->LoadOptions.importID(Checked);
   //remove unchecked options
   for (Index = 0; Index < INX_NVWEBON; Index++) { //not including INX_NVWEBON
     if ((gSettings.OptionsBits & (1 << Index)) == 0) {
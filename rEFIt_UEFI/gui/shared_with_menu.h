@@ -21,6 +21,7 @@ extern INPUT_ITEM *InputItems;
 
 void DecodeOptions(REFIT_MENU_ITEM_BOOTNUM *Entry);
 UINT32 EncodeOptions(const XString8Array& Options);
+UINT32 EncodeOptions(const XString8& BootArgs);
 
 
 
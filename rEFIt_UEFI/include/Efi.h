@@ -94,6 +94,7 @@ extern "C" {
 #include <Protocol/MsgLog.h>
 //#include <Protocol/efiConsoleControl.h>
 #include <Protocol/EmuVariableControl.h>
+#include <Protocol/PciDeviceInfo.h>
 #include <Protocol/AppleSMC.h>
 #include <Protocol/AppleImageCodecProtocol.h>
 
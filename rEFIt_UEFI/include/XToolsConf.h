@@ -10,6 +10,7 @@
 //#define MAX_XISIZE MAX_INTN
 
 #define XStringGrowByDefault 10
+#define XStringSmallSize 16 // chars, terminator included, held in the XString object itself
 #define XArrayGrowByDefault 8
 #define XBufferGrowByDefault 16
 
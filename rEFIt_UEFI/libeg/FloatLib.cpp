@@ -371,12 +371,22 @@ float rndf() //expected 0..1
 //  UINT16 Rand = 0;
 //  AsmRdRand16(&Rand);  //it's a pity panic
 //  return (float)Rand / 65536.f;
-  seed = seed * 214013 + 2531011;
-  float x = (float)seed / 4294967296.0f;
+  return rndf_r(&seed);
+}
+
+float rndf_r(UINT32 *state)
+{
+  *state = *state * 214013 + 2531011;
+  float x = (float)*state / 4294967296.0f;
   return x;
 }
 
 int dither(float x, int level)
+{
+  return dither_r(x, level, &seed);
+}
+
+int dither_r(float x, int level, UINT32 *state)
 {
   if (!level) {
     return (int)x;
@@ -384,8 +394,8 @@ int dither(float x, int level)
   int i = (int)(x) * level;  //5.1 * 4 = 20.4, 5.8 * 4 = 23.2|i=20
   float dx = x * level - (float)(i); //0.4, 3.2
   i /= level;
-  if (dx > rndf() * level) {
-    i += (int)((0.9999f+rndf())*level); //because rndf has mean value 0.5, but (int)rnd=0
+  if (dx > rndf_r(state) * level) {
+    i += (int)((0.9999f+rndf_r(state))*level); //because rndf has mean value 0.5, but (int)rnd=0
   }
   return i;
 }
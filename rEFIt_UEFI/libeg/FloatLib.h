@@ -28,6 +28,9 @@ float Atan2F(float X, float Y);
 float FabsF(float X);
 float rndf(void);  //random number from 0 to 1.0f
 int dither(float x, int level);
+// Same, with the caller's random state, for the callers that may run on several processors at once
+float rndf_r(UINT32 *state);
+int dither_r(float x, int level, UINT32 *state);
 float nsvg__vmag(float x, float y); //sqrt(x*x+y*y)
 
 inline float FabsF(float x) {
@@ -0,0 +1,144 @@
+/*
+ * ThemePack.cpp
+ *
+ * theme.pack: THEME_PACK_HEADER, THEME_PACK_ENTRY[Count], then the names and the files.
+ * The offsets are checked once at load, the lookups then trust them.
+ */
+
+#include "ThemePack.h"
+#include "libegint.h"
+
+#ifndef DEBUG_ALL
+#define DEBUG_THEMEPACK 1
+#else
+#define DEBUG_THEMEPACK DEBUG_ALL
+#endif
+
+#if DEBUG_THEMEPACK == 0
+#define DBG(...)
+#else
+#define DBG(...) DebugLog(DEBUG_THEMEPACK, __VA_ARGS__)
+#endif
+
+static UINT8          *Pack = NULL;
+static UINTN           PackSize = 0;
+static const EFI_FILE *PackDir = NULL;
+
+static const THEME_PACK_ENTRY *PackEntries()
+{
+  return (const THEME_PACK_ENTRY *)(Pack + sizeof(THEME_PACK_HEADER));
+}
+
+static BOOLEAN PackIsValid(const UINT8 *Data, UINTN Size)
+{
+  const THEME_PACK_HEADER *Header = (const THEME_PACK_HEADER *)Data;
+  if (Size < sizeof(THEME_PACK_HEADER) || Header->Signature != THEME_PACK_SIGNATURE || Header->Version != THEME_PACK_VERSION) {
+    return FALSE;
+  }
+  if (Header->Count > (Size - sizeof(THEME_PACK_HEADER)) / sizeof(THEME_PACK_ENTRY)) {
+    return FALSE;
+  }
+  const THEME_PACK_ENTRY *Entries = (const THEME_PACK_ENTRY *)(Data + sizeof(THEME_PACK_HEADER));
+  for (UINT32 i = 0; i < Header->Count; i++) {
+    if (Entries[i].NameOffset >= Size || Entries[i].DataOffset > Size || Entries[i].DataSize > Size - Entries[i].DataOffset) {
+      return FALSE;
+    }
+    // the name must be terminated inside the pack
+    if (AsciiStrnLenS((const CHAR8 *)Data + Entries[i].NameOffset, Size - Entries[i].NameOffset) == Size - Entries[i].NameOffset) {
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+void ThemePackOpen(const EFI_FILE *Dir)
+{
+  UINT8 *Data = NULL;
+  UINTN  Size = 0;
+
+  if (Pack != NULL) {
+    FreePool(Pack);
+  }
+  Pack = NULL;
+  PackSize = 0;
+  PackDir = NULL;
+  if (Dir == NULL) {
+    return;
+  }
+  if (EFI_ERROR(egLoadFile(Dir, THEME_PACK_FILENAME, &Data, &Size))) {
+    return;
+  }
+  if (!PackIsValid(Data, Size)) {
+    DBG("%ls is not valid, using the theme files\n", THEME_PACK_FILENAME);
+    FreePool(Data);
+    return;
+  }
+  Pack = Data;
+  PackSize = Size;
+  PackDir = Dir;
+  DBG("%ls: %d files\n", THEME_PACK_FILENAME, ((const THEME_PACK_HEADER *)Pack)->Count);
+}
+
+void ThemePackSetDir(const EFI_FILE *Dir)
+{
+  if (Pack != NULL) {
+    PackDir = Dir;
+  }
+}
+
+BOOLEAN ThemePackServes(const EFI_FILE *Dir)
+{
+  return Pack != NULL && Dir != NULL && Dir == PackDir;
+}
+
+// case insensitive, '/' same as '\', a leading '\' is ignored
+static const THEME_PACK_ENTRY *ThemePackFind(const CHAR16 *FileName)
+{
+  if (Pack == NULL || FileName == NULL) {
+    return NULL;
+  }
+  while (*FileName == L'\\' || *FileName == L'/') {
+    FileName++;
+  }
+  const THEME_PACK_ENTRY *Entries = PackEntries();
+  for (UINT32 i = 0; i < ((const THEME_PACK_HEADER *)Pack)->Count; i++) {
+    const CHAR8  *Name = (const CHAR8 *)Pack + Entries[i].NameOffset;
+    const CHAR16 *Wanted = FileName;
+    for (;; Name++, Wanted++) {
+      CHAR16 a = (*Wanted == L'/') ? L'\\' : *Wanted;
+      CHAR16 b = (CHAR16)(UINT8)*Name;
+      if (a >= L'A' && a <= L'Z') a += L'a' - L'A';
+      if (b >= L'A' && b <= L'Z') b += L'a' - L'A';
+      if (a != b) {
+        break;
+      }
+      if (a == 0) {
+        return &Entries[i];
+      }
+    }
+  }
+  return NULL;
+}
+
+EFI_STATUS ThemePackLoadFile(const CHAR16 *FileName, UINT8 **FileData, UINTN *FileDataLength)
+{
+  const THEME_PACK_ENTRY *Entry = ThemePackFind(FileName);
+  if (Entry == NULL) {
+    return EFI_NOT_FOUND;
+  }
+  // the caller frees it, as with a file read
+  UINT8 *Buffer = (UINT8 *)AllocateCopyPool(Entry->DataSize, Pack + Entry->DataOffset);
+  if (Buffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  *FileData = Buffer;
+  if (FileDataLength != NULL) {
+    *FileDataLength = Entry->DataSize;
+  }
+  return EFI_SUCCESS;
+}
+
+BOOLEAN ThemePackFileExists(const CHAR16 *FileName)
+{
+  return ThemePackFind(FileName) != NULL;
+}
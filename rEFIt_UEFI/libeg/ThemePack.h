@@ -0,0 +1,41 @@
+/*
+ * ThemePack.h
+ *
+ * Optional theme.pack of a theme directory, made by libeg/mkthemepack.py: every file of the theme
+ * in one file, read with one I/O when the theme is opened. While it is bound to the theme directory,
+ * egLoadFile() and FileExists() on that directory are answered from it without opening any file,
+ * so a file missing from the pack is missing. Without theme.pack the directory is read as before.
+ */
+
+#ifndef LIBEG_THEMEPACK_H_
+#define LIBEG_THEMEPACK_H_
+
+#include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+
+#define THEME_PACK_FILENAME   L"theme.pack"
+#define THEME_PACK_SIGNATURE  SIGNATURE_32('T', 'P', 'A', 'K')
+#define THEME_PACK_VERSION    1
+
+typedef struct {
+  UINT32  Signature;
+  UINT32  Version;
+  UINT32  Count;        // THEME_PACK_ENTRY follow the header
+  UINT32  Reserved;
+} THEME_PACK_HEADER;
+
+typedef struct {
+  UINT32  NameOffset;   // zero terminated ASCII, relative to the theme dir, '\' separated
+  UINT32  DataOffset;
+  UINT32  DataSize;
+} THEME_PACK_ENTRY;
+
+// Reads Dir\theme.pack if there is one, and binds it to Dir. Dir == NULL just drops the current pack.
+void ThemePackOpen(const EFI_FILE *Dir);
+// The theme dir was reopened (ReinitRefitLib), or closed with NULL. The pack stays in memory.
+void ThemePackSetDir(const EFI_FILE *Dir);
+
+BOOLEAN ThemePackServes(const EFI_FILE *Dir);
+EFI_STATUS ThemePackLoadFile(const CHAR16 *FileName, UINT8 **FileData, UINTN *FileDataLength);
+BOOLEAN ThemePackFileExists(const CHAR16 *FileName);
+
+#endif /* LIBEG_THEMEPACK_H_ */
@@ -14,6 +14,17 @@
 
 #include "VectorGraphics.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <Library/SynchronizationLib.h>
+#include <Protocol/MpService.h>
+
+#ifdef __cplusplus
+}
+#endif
+
 #include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
 
 #include "nanosvg.h"
@@ -22,6 +33,7 @@
 #include "../refit/screen.h"
 #include "../cpp_foundation/XString.h"
 #include "../refit/lib.h"
+#include "../Platform/Settings.h"
 #include "Self.h"
 
 #ifndef DEBUG_ALL
@@ -55,6 +67,472 @@ extern UINTN FrameTime;
 
 textFaces       textFace[4]; //0-help 1-message 2-menu 3-test, far future it will be infinite list with id
 
+//
+// icon cache
+//
+// With GUI/IconCache, the icons rasterized by ParseSVGXIcon() are kept in misc\IconCache.bin, read in one
+// go when a vector theme is parsed. The file is for one theme at one screen size: the header has the CRC and
+// size of theme.svg and the screen size, a mismatch drops the whole file. A record is an icon name and id with
+// the size, scale and shift it was rasterized at, each pixel array has its own CRC.
+// theme.svg is still parsed at every boot, only the rasterization is saved.
+//
+
+#define ICON_CACHE_FILE       L"misc\\IconCache.bin"
+#define ICON_CACHE_SIGNATURE  SIGNATURE_32('I', 'C', 'C', 'H')
+#define ICON_CACHE_VERSION    1
+#define ICON_CACHE_MAX_NAME   256
+#define ICON_CACHE_BOOTCAMP   0x01
+
+#pragma pack(push, 1)
+typedef struct {
+  UINT32  Signature;
+  UINT32  Version;
+  UINT32  ThemeCrc32;
+  UINT32  ThemeSize;
+  UINT32  ScreenWidth;
+  UINT32  ScreenHeight;
+  UINT32  Count;
+} ICON_CACHE_HEADER;
+
+typedef struct {
+  INT32   Id;
+  UINT32  Width;
+  UINT32  Height;
+  UINT32  Scale;       // bits of the floats
+  UINT32  ShiftX;
+  UINT32  ShiftY;
+  UINT32  PixelsCrc32;
+  UINT16  NameLength;  // CHAR8 count of the name following the record, no terminator, then the pixels
+  UINT8   Flags;
+  UINT8   Reserved;
+} ICON_CACHE_RECORD;
+#pragma pack(pop)
+
+class ICON_CACHE_ENTRY
+{
+public:
+  XString8        Name;
+  INT32           Id;
+  UINT32          Width;
+  UINT32          Height;
+  UINT32          Scale;
+  UINT32          ShiftX;
+  UINT32          ShiftY;
+  UINT8           Flags;
+  XBuffer<UINT8>  Pixels;      // Width*Height EFI_GRAPHICS_OUTPUT_BLT_PIXEL
+  UINT32          PixelsCrc32;
+  BOOLEAN         Seen;        // used by this theme parse, other entries are dropped on save
+
+  ICON_CACHE_ENTRY() : Name(), Id(0), Width(0), Height(0), Scale(0), ShiftX(0), ShiftY(0), Flags(0), Pixels(), PixelsCrc32(0), Seen(FALSE) {}
+  ICON_CACHE_ENTRY(const ICON_CACHE_ENTRY& other) = delete; // Can be defined if needed
+  const ICON_CACHE_ENTRY& operator = ( const ICON_CACHE_ENTRY & ) = delete; // Can be defined if needed
+};
+
+static XObjArray<ICON_CACHE_ENTRY> IconCache;
+static BOOLEAN                     IconCacheActive = FALSE; // only while ParseSVGXTheme() runs
+static BOOLEAN                     IconCacheDirty = FALSE;
+static UINT32                      IconCacheThemeCrc32 = 0;
+static UINT32                      IconCacheThemeSize = 0;
+
+static UINT32 IconCacheFloatBits(float f)
+{
+  UINT32 Bits;
+  CopyMem(&Bits, &f, sizeof(Bits));
+  return Bits;
+}
+
+static void IconCacheLoad(UINT32 ThemeCrc32, UINT32 ThemeSize)
+{
+  EFI_STATUS          Status;
+  UINT8               *Data = NULL;
+  UINTN               DataSize = 0;
+  UINTN               Offset;
+  UINT32              Index;
+  ICON_CACHE_HEADER   *Header;
+  ICON_CACHE_RECORD   *Record;
+
+  IconCache.setEmpty();
+  IconCacheActive = GlobalConfig.IconCache;
+  IconCacheDirty = FALSE;
+  IconCacheThemeCrc32 = ThemeCrc32;
+  IconCacheThemeSize = ThemeSize;
+  if (!IconCacheActive) {
+    return;
+  }
+
+  Status = egLoadFile(&self.getCloverDir(), ICON_CACHE_FILE, &Data, &DataSize);
+  if (EFI_ERROR(Status)) {
+    DBG("Icon cache: %s, rebuilding\n", efiStrError(Status));
+    IconCacheDirty = TRUE;
+    return;
+  }
+  Header = (ICON_CACHE_HEADER *)Data;
+  if (DataSize < sizeof(ICON_CACHE_HEADER) || Header->Signature != ICON_CACHE_SIGNATURE ||
+      Header->Version != ICON_CACHE_VERSION) {
+    DBG("Icon cache: bad file, rebuilding\n");
+    FreePool(Data);
+    IconCacheDirty = TRUE;
+    return;
+  }
+  if (Header->ThemeCrc32 != ThemeCrc32 || Header->ThemeSize != ThemeSize ||
+      Header->ScreenWidth != (UINT32)UGAWidth || Header->ScreenHeight != (UINT32)UGAHeight) {
+    DBG("Icon cache: theme or screen changed, rebuilding\n");
+    FreePool(Data);
+    IconCacheDirty = TRUE;
+    return;
+  }
+
+  Offset = sizeof(ICON_CACHE_HEADER);
+  for (Index = 0; Index < Header->Count; Index++) {
+    if (DataSize - Offset < sizeof(ICON_CACHE_RECORD)) {
+      break;
+    }
+    Record = (ICON_CACHE_RECORD *)(Data + Offset);
+    Offset += sizeof(ICON_CACHE_RECORD);
+    if (Record->NameLength > ICON_CACHE_MAX_NAME || Record->Width > 0x4000 || Record->Height > 0x4000 ||
+        DataSize - Offset < Record->NameLength + (UINTN)Record->Width * Record->Height * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL)) {
+      break;
+    }
+    ICON_CACHE_ENTRY* Entry = new ICON_CACHE_ENTRY;
+    Entry->Id = Record->Id;
+    Entry->Width = Record->Width;
+    Entry->Height = Record->Height;
+    Entry->Scale = Record->Scale;
+    Entry->ShiftX = Record->ShiftX;
+    Entry->ShiftY = Record->ShiftY;
+    Entry->Flags = Record->Flags;
+    Entry->PixelsCrc32 = Record->PixelsCrc32;
+    if (Record->NameLength > 0) {
+      Entry->Name.strncpy((CONST CHAR8 *)(Data + Offset), Record->NameLength);
+    }
+    Offset += Record->NameLength;
+    Entry->Pixels.ncpy(Data + Offset, (UINTN)Record->Width * Record->Height * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+    Offset += Entry->Pixels.size();
+    IconCache.AddReference(Entry, true);
+  }
+  FreePool(Data);
+  DBG("Icon cache: %zu icons\n", IconCache.size());
+}
+
+static void IconCacheSave(void)
+{
+  EFI_STATUS          Status;
+  XBuffer<UINT8>      Data;
+  ICON_CACHE_HEADER   Header;
+  ICON_CACHE_RECORD   Record;
+  size_t              Index;
+
+  if (!IconCacheActive) {
+    return;
+  }
+  // icons not used by this parse belong to an older layout of the theme
+  for (Index = IconCache.size(); Index-- > 0; ) {
+    if (!IconCache[Index].Seen) {
+      IconCache.RemoveAtIndex(Index);
+      IconCacheDirty = TRUE;
+    }
+  }
+  if (IconCacheDirty) {
+    ZeroMem(&Header, sizeof(Header));
+    Header.Signature = ICON_CACHE_SIGNATURE;
+    Header.Version = ICON_CACHE_VERSION;
+    Header.ThemeCrc32 = IconCacheThemeCrc32;
+    Header.ThemeSize = IconCacheThemeSize;
+    Header.ScreenWidth = (UINT32)UGAWidth;
+    Header.ScreenHeight = (UINT32)UGAHeight;
+    Header.Count = (UINT32)IconCache.size();
+    Data.ncat(&Header, sizeof(Header));
+    for (Index = 0; Index < IconCache.size(); Index++) {
+      const ICON_CACHE_ENTRY& Entry = IconCache[Index];
+      ZeroMem(&Record, sizeof(Record));
+      Record.Id = Entry.Id;
+      Record.Width = Entry.Width;
+      Record.Height = Entry.Height;
+      Record.Scale = Entry.Scale;
+      Record.ShiftX = Entry.ShiftX;
+      Record.ShiftY = Entry.ShiftY;
+      Record.PixelsCrc32 = Entry.PixelsCrc32;
+      Record.NameLength = (UINT16)Entry.Name.length();
+      Record.Flags = Entry.Flags;
+      Data.ncat(&Record, sizeof(Record));
+      Data.ncat(Entry.Name.c_str(), Record.NameLength);
+      Data.ncat(Entry.Pixels.data(), Entry.Pixels.size());
+    }
+    Status = egSaveFile(&self.getCloverDir(), ICON_CACHE_FILE, Data.data(), Data.size());
+    DBG("Icon cache: saved %zu icons: %s\n", IconCache.size(), efiStrError(Status));
+  }
+  // the pixels are in the theme images now, don't keep a second copy
+  IconCache.setEmpty();
+  IconCacheActive = FALSE;
+  IconCacheDirty = FALSE;
+}
+
+static ICON_CACHE_ENTRY* IconCacheFind(const XString8& Name, INTN Id, int Width, int Height, float Scale, float ShiftX, float ShiftY, UINT8 Flags)
+{
+  for (size_t Index = 0; Index < IconCache.size(); Index++) {
+    ICON_CACHE_ENTRY& Entry = IconCache[Index];
+    if (Entry.Id == (INT32)Id && Entry.Width == (UINT32)Width && Entry.Height == (UINT32)Height &&
+        Entry.Scale == IconCacheFloatBits(Scale) && Entry.ShiftX == IconCacheFloatBits(ShiftX) &&
+        Entry.ShiftY == IconCacheFloatBits(ShiftY) && Entry.Flags == Flags && Entry.Name == Name) {
+      return &Entry;
+    }
+  }
+  return NULL;
+}
+
+// copy the pixels of an icon rasterized by a previous boot into Image, already sized Width x Height
+static BOOLEAN IconCacheGet(const XString8& Name, INTN Id, float Scale, float ShiftX, float ShiftY, UINT8 Flags, XImage* Image)
+{
+  ICON_CACHE_ENTRY  *Entry;
+
+  if (!IconCacheActive || Image->GetSizeInBytes() == 0) {
+    return FALSE;
+  }
+  Entry = IconCacheFind(Name, Id, (int)Image->GetWidth(), (int)Image->GetHeight(), Scale, ShiftX, ShiftY, Flags);
+  if (Entry == NULL) {
+    return FALSE;
+  }
+  if (Entry->Pixels.size() != Image->GetSizeInBytes() || GetCrc32(Entry->Pixels.data(), Entry->Pixels.size()) != Entry->PixelsCrc32) {
+    DBG("Icon cache: %s bad checksum\n", Name.c_str());
+    return FALSE;
+  }
+  CopyMem(Image->GetPixelPtr(0, 0), Entry->Pixels.data(), Entry->Pixels.size());
+  Entry->Seen = TRUE;
+  return TRUE;
+}
+
+// remember an icon just rasterized
+static void IconCachePut(const XString8& Name, INTN Id, float Scale, float ShiftX, float ShiftY, UINT8 Flags, const XImage& Image)
+{
+  ICON_CACHE_ENTRY  *Entry;
+
+  if (!IconCacheActive || Image.GetSizeInBytes() == 0 || Name.length() > ICON_CACHE_MAX_NAME) {
+    return;
+  }
+  Entry = IconCacheFind(Name, Id, (int)Image.GetWidth(), (int)Image.GetHeight(), Scale, ShiftX, ShiftY, Flags);
+  if (Entry == NULL) {
+    Entry = new ICON_CACHE_ENTRY;
+    Entry->Name = Name;
+    Entry->Id = (INT32)Id;
+    Entry->Width = (UINT32)Image.GetWidth();
+    Entry->Height = (UINT32)Image.GetHeight();
+    Entry->Scale = IconCacheFloatBits(Scale);
+    Entry->ShiftX = IconCacheFloatBits(ShiftX);
+    Entry->ShiftY = IconCacheFloatBits(ShiftY);
+    Entry->Flags = Flags;
+    IconCache.AddReference(Entry, true);
+  }
+  Entry->Pixels.ncpy(Image.GetPixelPtr(0, 0), Image.GetSizeInBytes());
+  Entry->PixelsCrc32 = GetCrc32(Entry->Pixels.data(), Entry->Pixels.size());
+  Entry->Seen = TRUE;
+  IconCacheDirty = TRUE;
+}
+
+//
+// parallel rasterization
+//
+// With GUI/ParallelRasterize, ParseSVGXIcon() only queues the icons of the theme and SvgRasterRun() rasterizes
+// them all at once, with every enabled processor through EFI_MP_SERVICES_PROTOCOL. Large images (the background)
+// are cut in horizontal bands, so that one of them doesn't keep a processor busy alone.
+// Each processor takes its own rasterizer with a preallocated arena: APs can't allocate, log or call boot services.
+// A band which doesn't fit in the arena is redone on the BSP with a normal rasterizer.
+//
+
+#define SVG_RASTER_ARENA_SIZE   (4 * 1024 * 1024)
+#define SVG_RASTER_MAX_SLOTS    16
+#define SVG_RASTER_BAND_ROWS    64           // minimal height of a band
+#define SVG_RASTER_BAND_PIXELS  (256 * 256)  // smaller images are not cut
+
+class SVG_RASTER_ICON
+{
+public:
+  XString8    Name;
+  INTN        Id;
+  NSVGimage   *Image;
+  float       ShiftX;
+  float       ShiftY;
+  float       Scale;
+  UINT8       CacheFlags;
+  XImage      *Target;     // already sized by ParseSVGXIcon()
+
+  SVG_RASTER_ICON(const XString8& name, INTN id, NSVGimage *image, float shiftX, float shiftY, float scale, UINT8 cacheFlags, XImage *target) :
+    Name(name), Id(id), Image(image), ShiftX(shiftX), ShiftY(shiftY), Scale(scale), CacheFlags(cacheFlags), Target(target) {}
+  SVG_RASTER_ICON(const SVG_RASTER_ICON& other) = delete; // Can be defined if needed
+  const SVG_RASTER_ICON& operator = ( const SVG_RASTER_ICON & ) = delete; // Can be defined if needed
+};
+
+typedef struct {
+  NSVGimage   *Image;
+  float       ShiftX;
+  float       ShiftY;
+  float       Scale;
+  UINT8       *Pixels;     // first row of the band
+  int         Width;
+  int         Top;
+  int         Rows;
+  BOOLEAN     Failed;      // out of arena
+} SVG_RASTER_JOB;
+
+//
+// Shared by the processors running SvgRasterWorker().
+// Nothing here may log or call boot services, APs can't.
+// Each worker takes its own rasterizer, with its own arena and dither random state.
+//
+typedef struct {
+  SVG_RASTER_JOB   *Jobs;
+  UINT32           JobCount;
+  NSVGrasterizer   **Rasterizers;
+  UINT32           RasterizerCount;
+  volatile UINT32  NextJob;
+  volatile UINT32  NextRasterizer;
+} SVG_RASTER_WORK;
+
+static XObjArray<SVG_RASTER_ICON> SvgRasterQueue;
+static BOOLEAN                    SvgRasterDeferred = FALSE;  // only while ParseSVGXTheme() runs
+
+static void SvgRasterBand(NSVGrasterizer *rast, SVG_RASTER_JOB *Job)
+{
+  nsvgRasterize(rast, Job->Image, Job->ShiftX, Job->ShiftY - (float)Job->Top, Job->Scale, Job->Scale,
+                Job->Pixels, Job->Width, Job->Rows, Job->Width * 4);
+  Job->Failed = rast->outOfMemory != 0;
+}
+
+static VOID EFIAPI SvgRasterWorker(IN OUT VOID *Buffer)
+{
+  SVG_RASTER_WORK *Work = (SVG_RASTER_WORK*)Buffer;
+  UINT32          Slot = InterlockedIncrement(&Work->NextRasterizer) - 1;
+  UINT32          Job;
+
+  if (Slot >= Work->RasterizerCount) {
+    return;
+  }
+  while ((Job = InterlockedIncrement(&Work->NextJob) - 1) < Work->JobCount) {
+    SvgRasterBand(Work->Rasterizers[Slot], &Work->Jobs[Job]);
+  }
+}
+
+//
+// Rasterizes the queued icons with all the enabled processors, then puts them in the icon cache.
+// Falls back to the BSP alone if there are no MP services or APs.
+//
+static void SvgRasterRun(void)
+{
+  EFI_STATUS                Status;
+  EFI_MP_SERVICES_PROTOCOL  *MpServices = NULL;
+  UINTN                     NumberOfProcessors = 1;
+  UINTN                     NumberOfEnabledProcessors = 1;
+  EFI_EVENT                 Event = NULL;
+  BOOLEAN                   Started = FALSE;
+  XArray<SVG_RASTER_JOB>    Jobs;
+  SVG_RASTER_WORK           Work;
+  NSVGrasterizer            *rast = NULL;
+  UINT32                    Redone = 0;
+
+  if (SvgRasterQueue.isEmpty()) {
+    return;
+  }
+
+  Status = gBS->LocateProtocol(&gEfiMpServiceProtocolGuid, NULL, (void **)&MpServices);
+  if (!EFI_ERROR(Status)) {
+    Status = MpServices->GetNumberOfProcessors(MpServices, &NumberOfProcessors, &NumberOfEnabledProcessors);
+  }
+  if (EFI_ERROR(Status) || NumberOfEnabledProcessors == 0) {
+    NumberOfEnabledProcessors = 1;
+  }
+  NumberOfEnabledProcessors = MIN(NumberOfEnabledProcessors, (UINTN)SVG_RASTER_MAX_SLOTS);
+
+  // the background comes first in the queue, so the longest jobs are taken first
+  for (size_t i = 0; i < SvgRasterQueue.size(); i++) {
+    const SVG_RASTER_ICON& Icon = SvgRasterQueue[i];
+    int Width = (int)Icon.Target->GetWidth();
+    int Height = (int)Icon.Target->GetHeight();
+    int Bands = 1;
+    if (NumberOfEnabledProcessors > 1 && Width * Height >= SVG_RASTER_BAND_PIXELS) {
+      Bands = MAX(1, MIN((int)NumberOfEnabledProcessors, Height / SVG_RASTER_BAND_ROWS));
+    }
+    int Rows = (Height + Bands - 1) / Bands;
+    for (int Top = 0; Top < Height; Top += Rows) {
+      SVG_RASTER_JOB Job;
+      Job.Image = Icon.Image;
+      Job.ShiftX = Icon.ShiftX;
+      Job.ShiftY = Icon.ShiftY;
+      Job.Scale = Icon.Scale;
+      Job.Pixels = (UINT8*)Icon.Target->GetPixelPtr(0, Top);
+      Job.Width = Width;
+      Job.Top = Top;
+      Job.Rows = MIN(Rows, Height - Top);
+      Job.Failed = TRUE;  // until a rasterizer did it
+      Jobs.Add(Job);
+    }
+  }
+
+  Work.Jobs = Jobs.data();
+  Work.JobCount = (UINT32)Jobs.size();
+  Work.RasterizerCount = (UINT32)MIN(NumberOfEnabledProcessors, Jobs.size());
+  Work.Rasterizers = new NSVGrasterizer*[Work.RasterizerCount];
+  Work.NextJob = 0;
+  Work.NextRasterizer = 0;
+  for (UINT32 i = 0; i < Work.RasterizerCount; i++) {
+    Work.Rasterizers[i] = nsvgCreateRasterizerArena(SVG_RASTER_ARENA_SIZE);
+    if (Work.Rasterizers[i] == NULL) {
+      Work.RasterizerCount = i;
+      break;
+    }
+    // each worker dithers with its own random sequence
+    Work.Rasterizers[i]->ditherSeed = 12345 + i * 2654435761U;
+  }
+
+  if (Work.RasterizerCount > 1) {
+    Status = gBS->CreateEvent(0, TPL_NOTIFY, NULL, NULL, &Event);
+    if (!EFI_ERROR(Status)) {
+      Status = MpServices->StartupAllAPs(MpServices, SvgRasterWorker, FALSE, Event, 0, &Work, NULL);
+      Started = !EFI_ERROR(Status);
+    }
+  }
+
+  // the BSP works too, then waits for the APs
+  SvgRasterWorker(&Work);
+  if (Started) {
+    while (gBS->CheckEvent(Event) == EFI_NOT_READY) {
+      CpuPause();
+    }
+  }
+  if (Event != NULL) {
+    gBS->CloseEvent(Event);
+  }
+  MemLogDrainAp();
+  for (UINT32 i = 0; i < Work.RasterizerCount; i++) {
+    nsvgDeleteRasterizer(Work.Rasterizers[i]);
+  }
+  delete[] Work.Rasterizers;
+
+  // bands too big for an arena, or all of them if there was no memory for arenas
+  for (size_t j = 0; j < Jobs.size(); j++) {
+    SVG_RASTER_JOB& Job = Jobs.ElementAt(j);
+    if (!Job.Failed) {
+      continue;
+    }
+    if (rast == NULL) {
+      rast = nsvgCreateRasterizer();
+      if (rast == NULL) {
+        break;
+      }
+    }
+    SetMem(Job.Pixels, (UINTN)Job.Width * Job.Rows * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL), 0);
+    SvgRasterBand(rast, &Job);
+    Redone++;
+  }
+  nsvgDeleteRasterizer(rast);
+  DBG("rasterized %zu icons in %zu bands on %u processors, %u redone on BSP\n", SvgRasterQueue.size(), Jobs.size(),
+      Started ? Work.RasterizerCount : 1, Redone);
+
+  for (size_t i = 0; i < SvgRasterQueue.size(); i++) {
+    const SVG_RASTER_ICON& Icon = SvgRasterQueue[i];
+    IconCachePut(Icon.Name, Icon.Id, Icon.Scale, Icon.ShiftX, Icon.ShiftY, Icon.CacheFlags, *Icon.Target);
+  }
+  SvgRasterQueue.setEmpty();
+}
+
 EFI_STATUS XTheme::ParseSVGXIcon(INTN Id, const XString8& IconNameX, OUT XImage* Image, OUT void **SVGIcon)
 {
   EFI_STATUS      Status = EFI_NOT_FOUND;
@@ -216,7 +694,16 @@ EFI_STATUS XTheme::ParseSVGXIcon(INTN Id, const XString8& IconNameX, OUT XImage*
     ty = (Height - realHeight) * 0.5f;
   }
 
-  nsvgRasterize(rast, IconImage, tx, ty, Scale, Scale, (UINT8*)NewImage.GetPixelPtr(0,0), iWidth, iHeight, iWidth*4);
+  UINT8 CacheFlags = BootCampStyle ? ICON_CACHE_BOOTCAMP : 0;
+  BOOLEAN Queued = FALSE;
+  if (!IconCacheGet(IconNameX, Id, Scale, tx, ty, CacheFlags, &NewImage)) {
+    if (SvgRasterDeferred && NewImage.GetSizeInBytes() > 0) {
+      Queued = TRUE; // SvgRasterRun() will fill *Image
+    } else {
+      nsvgRasterize(rast, IconImage, tx, ty, Scale, Scale, (UINT8*)NewImage.GetPixelPtr(0,0), iWidth, iHeight, iWidth*4);
+      IconCachePut(IconNameX, Id, Scale, tx, ty, CacheFlags, NewImage);
+    }
+  }
   //  DBG("%s rastered, blt\n", IconImage);
 
   nsvgDeleteRasterizer(rast);
@@ -224,6 +711,9 @@ EFI_STATUS XTheme::ParseSVGXIcon(INTN Id, const XString8& IconNameX, OUT XImage*
   //  nsvgDelete(p2->image); //somehow we can't delete them producing memory leaks
   // well, we will use them later
   *Image = NewImage; //copy array
+  if (Queued) {
+    SvgRasterQueue.AddReference(new SVG_RASTER_ICON(IconNameX, Id, IconImage, tx, ty, Scale, CacheFlags, Image), true);
+  }
   if (SVGIcon) {
     *SVGIcon = (void*)IconImage; //copy pointer into parser
   }
@@ -231,11 +721,15 @@ EFI_STATUS XTheme::ParseSVGXIcon(INTN Id, const XString8& IconNameX, OUT XImage*
   return EFI_SUCCESS;
 }
 
-EFI_STATUS XTheme::ParseSVGXTheme(CONST CHAR8* buffer)
+EFI_STATUS XTheme::ParseSVGXTheme(CONST CHAR8* buffer, UINTN Size)
 {
   EFI_STATUS      Status;
 
   Icons.setEmpty();
+  IconPending.setEmpty();
+
+  // the icon cache is keyed by the file as loaded, nsvgParse() changes it
+  UINT32 ThemeCrc32 = GlobalConfig.IconCache ? GetCrc32((UINT8*)buffer, Size) : 0;
 
   // --- Parse theme.svg --- low case
   NSVGparser   *mainParser = nsvgParse((CHAR8*)buffer, 72, 1.f); //the buffer will be modified, it is how nanosvg works
@@ -262,6 +756,9 @@ EFI_STATUS XTheme::ParseSVGXTheme(CONST CHAR8* buffer)
   Scale = ScaleF;
   CentreShift = (vbx * Scale - (float)UGAWidth) * 0.5f;
 
+  IconCacheLoad(ThemeCrc32, (UINT32)Size);
+  SvgRasterDeferred = GlobalConfig.ParallelRasterize;
+
   Background = XImage(UGAWidth, UGAHeight);
   if (!BigBack.isEmpty()) {
     BigBack.setEmpty();
@@ -288,6 +785,7 @@ EFI_STATUS XTheme::ParseSVGXTheme(CONST CHAR8* buffer)
   DBG(" parsed banner->width=%lld height=%lld\n", Banner.GetWidth(), BanHeight); //parsed banner->width=467 height=89
   
   // --- Make other icons
+  XArray<INTN> MissingIcons; // filled from alternates once they are rasterized
   for (INTN i = BUILTIN_ICON_FUNC_ABOUT; i <= BUILTIN_CHECKBOX_CHECKED; ++i) {
     if (i == BUILTIN_ICON_BANNER) { //exclude "logo" as it done as Banner
       continue;
@@ -303,12 +801,7 @@ EFI_STATUS XTheme::ParseSVGXTheme(CONST CHAR8* buffer)
  //   DBG("parse night %s status %s\n", NewIcon->Name.c_str(), efiStrError(Status));
     Icons.AddReference(NewIcon, true);
     if (EFI_ERROR(Status)) {
-      if (i >= BUILTIN_ICON_VOL_INTERNAL_HFS && i <= BUILTIN_ICON_VOL_INTERNAL_REC) {
-        // call to GetIconAlt will get alternate/embedded into Icon if missing
-        GetIconAlt(i, BUILTIN_ICON_VOL_INTERNAL);
-      } else if (i == BUILTIN_SELECTION_BIG) {
-        GetIconAlt(i, BUILTIN_SELECTION_SMALL);
-      }
+      MissingIcons.Add(i);
     }
   }
   
@@ -332,6 +825,19 @@ EFI_STATUS XTheme::ParseSVGXTheme(CONST CHAR8* buffer)
   }
   Icons.AddReference(NewIcon, true);
 
+  SvgRasterRun();
+  SvgRasterDeferred = FALSE;
+
+  for (size_t j = 0; j < MissingIcons.size(); j++) {
+    INTN i = MissingIcons[j];
+    if (i >= BUILTIN_ICON_VOL_INTERNAL_HFS && i <= BUILTIN_ICON_VOL_INTERNAL_REC) {
+      // call to GetIconAlt will get alternate/embedded into Icon if missing
+      GetIconAlt(i, BUILTIN_ICON_VOL_INTERNAL);
+    } else if (i == BUILTIN_SELECTION_BIG) {
+      GetIconAlt(i, BUILTIN_SELECTION_SMALL);
+    }
+  }
+
   //selections
   SelectionBackgroundPixel.Red      = (SelectionColor >> 24) & 0xFF;
   SelectionBackgroundPixel.Green    = (SelectionColor >> 16) & 0xFF;
@@ -430,6 +936,7 @@ EFI_STATUS XTheme::ParseSVGXTheme(CONST CHAR8* buffer)
     row1TileSize = (INTN)(64.f * Scale);
     MainEntriesSize = (INTN)(128.f * Scale);
   }
+  IconCacheSave();
  // DBG("parsing svg theme finished\n");
 
   return EFI_SUCCESS;
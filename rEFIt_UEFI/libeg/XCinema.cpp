@@ -51,15 +51,13 @@ void REFIT_MENU_SCREEN::UpdateFilm()
 
   if (TimeDiff(FilmC->LastDraw, Now) < (UINTN)FilmC->FrameTime) return;
 
-  XImage Frame = FilmC->GetImage(); //take current image
-  if (!Frame.isEmpty()) {
-    Frame.DrawOnBack(FilmC->FilmPlace.XPos, FilmC->FilmPlace.YPos, ThemeX.Background);
-  }
+  FilmC->DrawFrame(ThemeX.Background); //draw current image
   FilmC->Advance(); //next frame no matter if previous was not found
   if (FilmC->Finished()) { //first loop finished
     FilmC->AnimeRun = !FilmC->RunOnce; //will stop anime if it set as RunOnce
   }
   FilmC->LastDraw = Now;
+  FilmC->Prefetch(); //decode the next frame while waiting for its time
 }
 
 FILM* XCinema::GetFilm(INTN Id)
@@ -80,45 +78,177 @@ void XCinema::AddFilm(FILM* NewFilm)
   Cinema.AddReference(NewFilm, true);
 }
 
-static XImage NullImage;
-const XImage& FILM::GetImage(INTN Index) const
+//the smallest rect where two images of the same size differ, empty if they are equal
+static EG_RECT ChangedRect(const XImage& Old, const XImage& New)
 {
-  DBG("ask for frame #%lld from total of %zu\n", Index, Frames.size());
-  for (size_t i = 0; i < Frames.size(); ++i) {
-    if (Frames[i].getIndex() == Index) {
-      DBG("...found\n");
-      return Frames[i].getImage();
+  INTN W = New.GetWidth();
+  INTN H = New.GetHeight();
+  if (Old.GetWidth() != W || Old.GetHeight() != H || Old.isPremultiplied() != New.isPremultiplied()) {
+    return EG_RECT(0, 0, W, H);
+  }
+  UINTN RowBytes = W * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+  INTN Top = 0;
+  while (Top < H && CompareMem(Old.GetPixelPtr(0, Top), New.GetPixelPtr(0, Top), RowBytes) == 0) {
+    Top++;
+  }
+  if (Top == H) {
+    return EG_RECT();
+  }
+  INTN Bottom = H - 1;
+  while (Bottom > Top && CompareMem(Old.GetPixelPtr(0, Bottom), New.GetPixelPtr(0, Bottom), RowBytes) == 0) {
+    Bottom--;
+  }
+  INTN Left = W;
+  INTN Right = -1;
+  for (INTN y = Top; y <= Bottom; ++y) {
+    const EFI_GRAPHICS_OUTPUT_BLT_PIXEL* A = Old.GetPixelPtr(0, y);
+    const EFI_GRAPHICS_OUTPUT_BLT_PIXEL* B = New.GetPixelPtr(0, y);
+    for (INTN x = 0; x < Left; ++x) {
+      if (CompareMem(&A[x], &B[x], sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL)) != 0) {
+        Left = x;
+        break;
+      }
+    }
+    for (INTN x = W - 1; x > Right; --x) {
+      if (CompareMem(&A[x], &B[x], sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL)) != 0) {
+        Right = x;
+        break;
+      }
     }
   }
-  DBG("...not found\n");
-  return NullImage;
+  return EG_RECT(Left, Top, Right - Left + 1, Bottom - Top + 1);
+}
+
+//draw only the Rect part of a whole Frame placed at XPos, YPos
+static void DrawFrameRect(const XImage& Frame, const EG_RECT& Rect, INTN XPos, INTN YPos, const XImage& Back)
+{
+  XImage BackLayer(Rect.Width, Rect.Height);
+  BackLayer.CopyRect(Back, XPos + Rect.XPos, YPos + Rect.YPos);
+  BackLayer.Compose(EG_RECT(0, 0, Rect.Width, Rect.Height), Rect, Frame, true);
+  BackLayer.DrawWithoutCompose(XPos + Rect.XPos, YPos + Rect.YPos);
 }
 
-const XImage& FILM::GetImage(bool *free) const
+FILM_FRAME* FILM::FindFrame(INTN Index)
 {
-  /*
-   * for SVG anime we have to generate new XImage using CurrentFrame as an argument
-    product(IconToAnime.ImageSVG, CurrentFrame, method); -- ImageSVG will be changed?
-   or
-    XImage *frame = IconToAnime.GetBest(!Daylight, free, CurrentFrame, method);
-    
-   return frame;
-   *
-   */
   for (size_t i = 0; i < Frames.size(); ++i) {
-    if (Frames[i].getIndex() == CurrentFrame) {
-      if (free) *free = false;
-      return Frames[i].getImage();
+    if (Frames[i].Index == Index) {
+      return &Frames[i];
     }
   }
-  if (free) *free = false;
-  return NullImage;
+  return nullptr;
+}
+
+/*
+ * streaming film: decode frame Index into the ring
+ * the frame on the screen is never evicted, so if BaseIndex is the frame on the screen
+ * the returned slot has Rect changed from it
+ */
+FILM_DECODED* FILM::Decode(INTN Index, INTN BaseIndex)
+{
+  FILM_DECODED* Slot = nullptr;
+  ++RingClock;
+  for (INTN i = 0; i < FILM_RING_SIZE; ++i) {
+    if (Ring[i].Index == Index) {
+      Slot = &Ring[i];
+      break;
+    }
+  }
+  if (Slot == nullptr) {
+    FILM_FRAME* Frame = FindFrame(Index);
+    if (Frame == nullptr || Frame->Png.size() == 0) {
+      return nullptr;
+    }
+    for (INTN i = 0; i < FILM_RING_SIZE; ++i) {
+      if (LastDrawn >= 0 && Ring[i].Index == LastDrawn) continue;
+      if (Slot == nullptr || Ring[i].LastUse < Slot->LastUse) {
+        Slot = &Ring[i];
+      }
+    }
+    Slot->Index = -1;
+    Slot->BaseIndex = -1;
+    if (EFI_ERROR(Slot->Image.FromPNG(Frame->Png.data(), Frame->Png.size()))) {
+      DBG("frame %lld not decoded\n", Index);
+      Slot->Image.setEmpty();
+      return nullptr;
+    }
+    Slot->Index = Index;
+  }
+  Slot->LastUse = RingClock;
+  if (BaseIndex >= 0 && BaseIndex != Index && Slot->BaseIndex != BaseIndex) {
+    Slot->BaseIndex = -1;
+    for (INTN i = 0; i < FILM_RING_SIZE; ++i) {
+      if (Ring[i].Index == BaseIndex) {
+        Slot->Rect = ChangedRect(Ring[i].Image, Slot->Image);
+        Slot->BaseIndex = BaseIndex;
+        break;
+      }
+    }
+  }
+  return Slot;
+}
+
+void FILM::Prefetch()
+{
+  if (Streaming && AnimeRun) {
+    Decode(CurrentFrame, LastDrawn);
+  }
+}
+
+/*
+ * a delta frame is drawn as its changed rect if the previous frame is on the screen,
+ * else the whole frame is rebuilt from its key frame
+ * a missing frame is not drawn and the screen keeps the previous one
+ */
+void FILM::DrawFrame(const XImage& Back)
+{
+  INTN Index = CurrentFrame;
+  if (Streaming) {
+    FILM_DECODED* Slot = Decode(Index, LastDrawn);
+    if (Slot == nullptr || Slot->Image.isEmpty()) return;
+    if (LastDrawn >= 0 && Slot->BaseIndex == LastDrawn) {
+      if (Slot->Rect.Width > 0 && Slot->Rect.Height > 0) {
+        DrawFrameRect(Slot->Image, Slot->Rect, FilmPlace.XPos, FilmPlace.YPos, Back);
+      }
+    } else {
+      Slot->Image.DrawOnBack(FilmPlace.XPos, FilmPlace.YPos, Back);
+    }
+    LastDrawn = Index;
+    return;
+  }
+
+  FILM_FRAME* Frame = FindFrame(Index);
+  if (Frame == nullptr) return;
+  if (Frame->BaseIndex < 0) {
+    if (Frame->Image.isEmpty()) return;
+    Frame->Image.DrawOnBack(FilmPlace.XPos, FilmPlace.YPos, Back);
+  } else if (Frame->BaseIndex == LastDrawn) {
+    if (!Frame->Image.isEmpty()) {
+      Frame->Image.DrawOnBack(FilmPlace.XPos + Frame->Rect.XPos, FilmPlace.YPos + Frame->Rect.YPos, Back);
+    }
+  } else {
+    FILM_FRAME* Key = Frame;
+    while (Key != nullptr && Key->BaseIndex >= 0) {
+      Key = FindFrame(Key->BaseIndex);
+    }
+    if (Key == nullptr || Key->Image.isEmpty()) return;
+    XImage Canvas;
+    Canvas = Key->Image;
+    for (INTN i = Key->Index + 1; i <= Index; ++i) {
+      FILM_FRAME* Delta = FindFrame(i);
+      if (Delta != nullptr && !Delta->Image.isEmpty()) {
+        Canvas.CopyRect(Delta->Image, Delta->Rect, EG_RECT(0, 0, Delta->Rect.Width, Delta->Rect.Height));
+      }
+    }
+    Canvas.DrawOnBack(FilmPlace.XPos, FilmPlace.YPos, Back);
+  }
+  LastDrawn = Index;
 }
 
 void FILM::AddFrame(XImage* Frame, INTN Index)
 {
-  IndexedImage* NewFrame = new IndexedImage(Index);
-  NewFrame->setImage(*Frame);
+  FILM_FRAME* NewFrame = new FILM_FRAME;
+  NewFrame->Index = Index;
+  NewFrame->Image = *Frame;
   Frames.AddReference(NewFrame, true);
   DBG("index=%lld last=%lld\n", Index, LastIndex);
   if (Index > LastIndex) {
@@ -126,11 +256,21 @@ void FILM::AddFrame(XImage* Frame, INTN Index)
   }
 }
 
+/*
+ * Frames with the same size as the previous frame are kept as a delta: only the rect changed from it.
+ * Streaming films keep PNG files as is and decode a frame when it is shown, see DrawFrame()
+ */
 void FILM::GetFrames(XTheme& TheTheme /*, const XStringW& Path*/) // Path already exist as a member. Is it the same ?
 {
   const EFI_FILE *ThemeDir = &TheTheme.getThemeDir();
   EFI_STATUS Status;
+  XImage PrevImage;
+  INTN PrevIndex = -1;
   LastIndex = 0;
+  LastDrawn = -1;
+  if (TheTheme.TypeSVG) {
+    Streaming = false; //SVG frames are rendered from the theme, nothing to stream
+  }
   for (INTN Index = 0; Index < NumFrames; Index++) {
     XImage NewImage;
     Status = EFI_NOT_FOUND;
@@ -140,12 +280,59 @@ void FILM::GetFrames(XTheme& TheTheme /*, const XStringW& Path*/) // Path alread
       XStringW Name = SWPrintf("%ls\\%ls_%03lld.png", Path.wc_str(), Path.wc_str(), Index);
  //     DBG("try to load %ls\n", Name.wc_str()); //fine
       if (FileExists(ThemeDir, Name)) {
+        if (Streaming) {
+          UINT8 *FileData = NULL;
+          UINTN FileDataLength = 0;
+          Status = egLoadFile(ThemeDir, Name.wc_str(), &FileData, &FileDataLength);
+          if (!EFI_ERROR(Status)) {
+            FILM_FRAME* NewFrame = new FILM_FRAME;
+            NewFrame->Index = Index;
+            NewFrame->Png.ncpy(FileData, FileDataLength);
+            FreePool(FileData);
+            Frames.AddReference(NewFrame, true);
+            if (Index > LastIndex) {
+              LastIndex = Index;
+            }
+          }
+          continue;
+        }
         Status = NewImage.LoadXImage(ThemeDir, Name);
       }
 //      DBG("  read status=%s\n", efiStrError(Status));
     }
-    if (!EFI_ERROR(Status)) {
-      AddFrame(&NewImage, Index);
+    if (EFI_ERROR(Status)) {
+      continue;
+    }
+    FrameWidth = NewImage.GetWidth();
+    FrameHeight = NewImage.GetHeight();
+    if (PrevIndex == Index - 1 && PrevImage.GetWidth() == FrameWidth && PrevImage.GetHeight() == FrameHeight) {
+      EG_RECT Rect = ChangedRect(PrevImage, NewImage);
+      if (Rect.Width * Rect.Height * 4 < FrameWidth * FrameHeight * 3) {
+        FILM_FRAME* NewFrame = new FILM_FRAME;
+        NewFrame->Index = Index;
+        NewFrame->BaseIndex = PrevIndex;
+        NewFrame->Rect = Rect;
+        if (Rect.Width > 0 && Rect.Height > 0) {
+          NewFrame->Image = XImage(NewImage, Rect);
+        }
+        Frames.AddReference(NewFrame, true);
+        if (Index > LastIndex) {
+          LastIndex = Index;
+        }
+        PrevImage = NewImage;
+        PrevIndex = Index;
+        continue;
+      }
+    }
+    AddFrame(&NewImage, Index);
+    PrevImage = NewImage;
+    PrevIndex = Index;
+  }
+  if (Streaming && Frames.size() > 0) {
+    FILM_DECODED* Last = Decode(LastIndex, -1); //size of the film
+    if (Last != nullptr) {
+      FrameWidth = Last->Image.GetWidth();
+      FrameHeight = Last->Image.GetHeight();
     }
   }
 }
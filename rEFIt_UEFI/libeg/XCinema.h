@@ -14,12 +14,48 @@ extern "C" {
 }
 #include "../cpp_foundation/XArray.h"
 #include "../cpp_foundation/XString.h"
+#include "../cpp_foundation/XBuffer.h"
 #include "../libeg/libeg.h"
 #include "XImage.h"
 
 class XTheme;
 class XCinema;
 
+#define FILM_RING_SIZE  3  //decoded frames kept by a streaming film: on screen, next, spare
+
+//one frame as loaded
+// BaseIndex < 0 - Image is the whole frame
+// else the frame differs from frame BaseIndex only in Rect and Image is that rect (delta frame)
+// a streaming film keeps the PNG file instead, decoded when needed
+class FILM_FRAME
+{
+public:
+  INTN            Index;
+  INTN            BaseIndex;
+  EG_RECT         Rect;
+  XImage          Image;
+  XBuffer<UINT8>  Png;
+
+  FILM_FRAME() : Index(0), BaseIndex(-1), Rect(), Image(), Png() {}
+  FILM_FRAME(const FILM_FRAME& other) = delete; // Can be defined if needed
+  const FILM_FRAME& operator = ( const FILM_FRAME & ) = delete; // Can be defined if needed
+};
+
+//a decoded frame of a streaming film, Rect is the part changed from frame BaseIndex if BaseIndex >= 0
+class FILM_DECODED
+{
+public:
+  INTN      Index;
+  INTN      BaseIndex;
+  EG_RECT   Rect;
+  XImage    Image;
+  UINT64    LastUse;
+
+  FILM_DECODED() : Index(-1), BaseIndex(-1), Rect(), Image(), LastUse(0) {}
+  FILM_DECODED(const FILM_DECODED& other) = delete; // Can be defined if needed
+  const FILM_DECODED& operator = ( const FILM_DECODED & ) = delete; // Can be defined if needed
+};
+
 class FILM
 {
 protected:
@@ -36,37 +72,51 @@ public:
   XStringW  Path; //user defined name for folder and files Path/Path_002.png etc
   BOOLEAN   AnimeRun;
   UINT64    LastDraw;
+  BOOLEAN   Streaming; //keep PNG files and decode frames when shown, set by Stream in Theme.plist
 
 protected:
-  XObjArray<IndexedImage> Frames; //Frames can be not sorted
+  XObjArray<FILM_FRAME> Frames; //Frames can be not sorted
   INTN      LastIndex; // it is not Frames.size(), it is last index inclusive, so frames 0,1,2,5,8 be LastIndex = 8
   INTN      CurrentFrame; // must be unique for each film
+  INTN      FrameWidth, FrameHeight;
+  INTN      LastDrawn; // frame on the screen, -1 after Reset()
+  FILM_DECODED Ring[FILM_RING_SIZE];
+  UINT64    RingClock;
 
 public:
   EG_RECT FilmPlace;  // Screen has several Films each in own place
 
 public:
   FILM() : Id(0), RunOnce(0), NumFrames(0), FrameTime(0), FilmX(0), FilmY(0), ScreenEdgeHorizontal(0), ScreenEdgeVertical(0),
-           NudgeX(0), NudgeY(0), Path(), AnimeRun(0), LastDraw(0), Frames(), LastIndex(0), CurrentFrame(0), FilmPlace()
+           NudgeX(0), NudgeY(0), Path(), AnimeRun(0), LastDraw(0), Streaming(0), Frames(), LastIndex(0), CurrentFrame(0),
+           FrameWidth(0), FrameHeight(0), LastDrawn(-1), Ring(), RingClock(0), FilmPlace()
          {}
   FILM(INTN Id) : Id(Id), RunOnce(0), NumFrames(0), FrameTime(0), FilmX(0), FilmY(0), ScreenEdgeHorizontal(0), ScreenEdgeVertical(0),
-           NudgeX(0), NudgeY(0), Path(), AnimeRun(0), LastDraw(0), Frames(), LastIndex(0), CurrentFrame(0), FilmPlace()
+           NudgeX(0), NudgeY(0), Path(), AnimeRun(0), LastDraw(0), Streaming(0), Frames(), LastIndex(0), CurrentFrame(0),
+           FrameWidth(0), FrameHeight(0), LastDrawn(-1), Ring(), RingClock(0), FilmPlace()
          {}
   ~FILM() {}
 
   INTN GetIndex() { return  Id; }
   void SetIndex(INTN Index) { Id = Index; }
 
-  const XImage& GetImage(INTN Index) const;
-  const XImage& GetImage(bool *free = nullptr) const;
-  void AddFrame(XImage* Frame, INTN Index); //IndexedImage will be created
+  void AddFrame(XImage* Frame, INTN Index); //FILM_FRAME will be created
   size_t Size() { return Frames.size(); }
   INTN LastFrameID() { return LastIndex; }
+  INTN GetFrameWidth() { return FrameWidth; }
+  INTN GetFrameHeight() { return FrameHeight; }
   bool Finished() { return CurrentFrame == 0; }
   void GetFrames(XTheme& TheTheme/*, const XStringW& Path*/); //read image sequence from Theme/Path/
   void SetPlace(const EG_RECT& Rect) { FilmPlace = Rect; }
   void Advance() { ++CurrentFrame %= (LastIndex + 1); }
-  void Reset() { CurrentFrame = 0; }
+  void Reset() { CurrentFrame = 0; LastDrawn = -1; }
+  void ForceFullDraw() { LastDrawn = -1; } //the film place was painted over, next frame can't be a delta
+  void DrawFrame(const XImage& Back); //draw CurrentFrame over Back at FilmPlace
+  void Prefetch(); //streaming: decode CurrentFrame before it is drawn
+
+protected:
+  FILM_FRAME* FindFrame(INTN Index);
+  FILM_DECODED* Decode(INTN Index, INTN BaseIndex);
 //  EFI_STATUS GetFrame(IN INTN Index, OUT XImage *Frame); //usually Index=CurrentFrame
 //  EFI_STATUS GetFrame(OUT XImage *Frame); 
   
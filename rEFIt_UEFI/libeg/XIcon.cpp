@@ -89,13 +89,14 @@ const INTN IconsNamesSize = sizeof(IconsNames) / sizeof(IconsNames[0]);
 
 //icons class
 //if ImageNight is not set then Image should be used
+//ico##_rle is the already decoded ico, see mkegemb_rle.py
 #define DEC_BUILTIN_ICON(id, ico) { \
-Empty = EFI_ERROR(Image.FromPNG(ACCESS_EMB_DATA(ico), ACCESS_EMB_SIZE(ico))); \
+Empty = EFI_ERROR(Image.FromRLE(ACCESS_EMB_DATA(ico##_rle), ACCESS_EMB_SIZE(ico##_rle))); \
 }
 
 #define DEC_BUILTIN_ICON2(id, ico, dark) { \
-Empty = EFI_ERROR(Image.FromPNG(ACCESS_EMB_DATA(ico), ACCESS_EMB_SIZE(ico))); \
-ImageNight.FromPNG(ACCESS_EMB_DATA(dark), ACCESS_EMB_SIZE(dark)); \
+Empty = EFI_ERROR(Image.FromRLE(ACCESS_EMB_DATA(ico##_rle), ACCESS_EMB_SIZE(ico##_rle))); \
+ImageNight.FromRLE(ACCESS_EMB_DATA(dark##_rle), ACCESS_EMB_SIZE(dark##_rle)); \
 }
 
 XIcon::XIcon(INTN Index, bool TakeEmbedded) : Id(Index), Name(), Image(), ImageNight(), Native(false),
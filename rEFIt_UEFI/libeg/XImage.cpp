@@ -4,6 +4,8 @@
 #include "libegint.h"  //for egDecodeIcns
 #include "../refit/lib.h"
 #include "../Platform/Settings.h"
+#include "../Platform/MemoryOperation.h"
+#include "../Platform/PerfCounters.h"
 
 #ifndef DEBUG_ALL
 #define DEBUG_XIMAGE 1
@@ -19,8 +21,38 @@
 
 EFI_GRAPHICS_OUTPUT_BLT_PIXEL NullColor = {0,0,0,0};
 
+// x/255 without division, exact for x <= 255*255. Same as nsvg__div255
+static inline UINT32 Div255(UINT32 x)
+{
+  return ((x + 1) * 257) >> 16;
+}
+
+static EFI_GRAPHICS_OUTPUT_BLT_PIXEL PremultiplyPixel(const EFI_GRAPHICS_OUTPUT_BLT_PIXEL& Pixel)
+{
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Result = Pixel;
+  UINT32 Alpha = Pixel.Reserved;
+  if (Alpha != 255) {
+    Result.Blue = (UINT8)Div255(Pixel.Blue * Alpha);
+    Result.Green = (UINT8)Div255(Pixel.Green * Alpha);
+    Result.Red = (UINT8)Div255(Pixel.Red * Alpha);
+  }
+  return Result;
+}
+
+static EFI_GRAPHICS_OUTPUT_BLT_PIXEL UnpremultiplyPixel(const EFI_GRAPHICS_OUTPUT_BLT_PIXEL& Pixel)
+{
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Result = Pixel;
+  UINT32 Alpha = Pixel.Reserved;
+  if (Alpha != 255 && Alpha != 0) {
+    Result.Blue = (UINT8)MIN(255, (Pixel.Blue * 255 + Alpha / 2) / Alpha);
+    Result.Green = (UINT8)MIN(255, (Pixel.Green * 255 + Alpha / 2) / Alpha);
+    Result.Red = (UINT8)MIN(255, (Pixel.Red * 255 + Alpha / 2) / Alpha);
+  }
+  return Result;
+}
+
 
-XImage::XImage(UINTN W, UINTN H) : Width(0), Height(0), PixelData() // initialisation of Width and Height and , PixelData() to avoid warning with -Weffc++
+XImage::XImage(UINTN W, UINTN H) : Width(0), Height(0), PixelData(), Premultiplied(false) // initialisation of Width and Height and , PixelData() to avoid warning with -Weffc++
 {
 //  Width = W;
 //  Height = H; //included below
@@ -29,32 +61,35 @@ XImage::XImage(UINTN W, UINTN H) : Width(0), Height(0), PixelData() // initialis
 
 XImage& XImage::operator= (const XImage& other)
 {
-	setSizeInPixels(other.GetWidth(), other.GetHeight()); // change the size, ie the number of element in the array. Reaalocate buffer if needed
-	PixelData = other.PixelData;
+	Width = other.Width;
+	Height = other.Height;
+	PixelData = other.PixelData; // shared until one of us writes
+	Premultiplied = other.Premultiplied;
 	return *this;
 }
 
-XImage::XImage(const XImage& Image, float scale) : Width(0), Height(0), PixelData() // initialisation of Width and Height and , PixelData() to avoid warning with -Weffc++
+XImage::XImage(const XImage& Image, float scale) : Width(0), Height(0), PixelData(), Premultiplied(Image.Premultiplied) // initialisation of Width and Height and , PixelData() to avoid warning with -Weffc++
 {
   UINTN SrcWidth = Image.GetWidth();
   UINTN SrcHeight = Image.GetHeight();
 
   if (scale < 1.e-4) {
-//    Width = SrcWidth;
-//    Height = SrcHeight;
-    setSizeInPixels(SrcWidth, SrcHeight);
-    for (UINTN y = 0; y < Height; ++y)
-      for (UINTN x = 0; x < Width; ++x)
-        PixelData[y * Width + x] = Image.GetPixel(x, y);
-
+    Width = SrcWidth;
+    Height = SrcHeight;
+    PixelData = Image.PixelData; // shared until one of us writes
   } else {
 //    Width = (UINTN)(SrcWidth * scale);
 //    Height = (UINTN)(SrcHeight * scale);
-    setSizeInPixels((UINTN)(SrcWidth * scale), (UINTN)(SrcHeight * scale));
-    CopyScaled(Image, scale);
+    *this = Image.GetScaled(scale);
   }
 }
 
+XImage::XImage(const XImage& Image, const EG_RECT& Rect) : Width(0), Height(0), PixelData(), Premultiplied(Image.Premultiplied)
+{
+  setSizeInPixels(Rect.Width, Rect.Height);
+  CopyRect(Image, Rect.XPos, Rect.YPos);
+}
+
 #if 0
   UINTN Offset = OFFSET_OF(EFI_GRAPHICS_OUTPUT_BLT_PIXEL, Blue);
 
@@ -121,24 +156,78 @@ XImage::~XImage()
 {
 }
 
+static const XArray<EFI_GRAPHICS_OUTPUT_BLT_PIXEL> NoPixels;
+
+const XArray<EFI_GRAPHICS_OUTPUT_BLT_PIXEL>& XImage::Pixels() const
+{
+  return PixelData ? PixelData->Data : NoPixels;
+}
+
+XArray<EFI_GRAPHICS_OUTPUT_BLT_PIXEL>& XImage::PixelsForWrite()
+{
+  if (!PixelData) {
+    PixelData = make_intrusive<XImagePixels>();
+  } else if (PixelData.use_count() > 1) {
+    PixelData = make_intrusive<XImagePixels>(*PixelData);
+  }
+  return PixelData->Data;
+}
+
 const XArray<EFI_GRAPHICS_OUTPUT_BLT_PIXEL>& XImage::GetData() const
 {
-  return PixelData;
+  return Pixels();
 }
 
 EFI_GRAPHICS_OUTPUT_BLT_PIXEL* XImage::GetPixelPtr(INTN x, INTN y)
 {
-	return &PixelData[x + y * Width];
+	return &PixelsForWrite()[x + y * Width];
 }
 
 const EFI_GRAPHICS_OUTPUT_BLT_PIXEL* XImage::GetPixelPtr(INTN x, INTN y) const
 {
-	return &PixelData[x + y * Width];
+	return &Pixels()[x + y * Width];
 }
 
 const EFI_GRAPHICS_OUTPUT_BLT_PIXEL& XImage::GetPixel(INTN x, INTN y) const
 {
-	return PixelData[x + y * Width];
+	return Pixels()[x + y * Width];
+}
+
+EFI_GRAPHICS_OUTPUT_BLT_PIXEL XImage::GetStraightPixel(INTN x, INTN y) const
+{
+  return Premultiplied ? UnpremultiplyPixel(GetPixel(x, y)) : GetPixel(x, y);
+}
+
+/*
+ * Premultiplied images are composed without division, straight alpha is only needed to save a PNG
+ * or for the code that looks at the colors
+ */
+void XImage::Premultiply()
+{
+  if (Premultiplied) {
+    return;
+  }
+  XArray<EFI_GRAPHICS_OUTPUT_BLT_PIXEL>& Data = PixelsForWrite();
+  for (size_t i = 0; i < Data.size(); ++i) {
+    if (Data[i].Reserved != 255) {
+      Data[i] = PremultiplyPixel(Data[i]);
+    }
+  }
+  Premultiplied = true;
+}
+
+void XImage::Unpremultiply()
+{
+  if (!Premultiplied) {
+    return;
+  }
+  XArray<EFI_GRAPHICS_OUTPUT_BLT_PIXEL>& Data = PixelsForWrite();
+  for (size_t i = 0; i < Data.size(); ++i) {
+    if (Data[i].Reserved != 255) {
+      Data[i] = UnpremultiplyPixel(Data[i]);
+    }
+  }
+  Premultiplied = false;
 }
 
 /*
@@ -154,21 +243,26 @@ UINTN      XImage::GetHeight() const
 */
 UINTN XImage::GetSizeInBytes() const
 {
-  return PixelData.size() * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+  return Pixels().size() * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
 }
 
 void XImage::setSizeInPixels(UINTN W, UINTN H) //unused arguments?
 {
   Width = W;
   Height = H;
-	PixelData.setSize(Width * Height);
+  if (PixelData && PixelData.use_count() > 1 && PixelData->Data.size() != W * H) {
+    PixelData = make_intrusive<XImagePixels>(); // no need to copy pixels that are about to be rewritten
+  }
+	PixelsForWrite().setSize(Width * Height);
 }
 
 void XImage::Fill(const EFI_GRAPHICS_OUTPUT_BLT_PIXEL& Color)
 {
+  Premultiplied = false;
+  XArray<EFI_GRAPHICS_OUTPUT_BLT_PIXEL>& Data = PixelsForWrite();
   for (UINTN y = 0; y < Height; ++y)
     for (UINTN x = 0; x < Width; ++x)
-      PixelData[y * Width + x] = Color;
+      Data[y * Width + x] = Color;
 }
 
 void XImage::Fill(const EG_PIXEL* Color)
@@ -183,53 +277,176 @@ void XImage::FillArea(const EG_PIXEL* Color, EG_RECT& Rect)
 
 void XImage::FillArea(const EFI_GRAPHICS_OUTPUT_BLT_PIXEL& Color, EG_RECT& Rect)
 {
+  const EFI_GRAPHICS_OUTPUT_BLT_PIXEL FillColor = Premultiplied ? PremultiplyPixel(Color) : Color;
+  XArray<EFI_GRAPHICS_OUTPUT_BLT_PIXEL>& Data = PixelsForWrite();
   for (INTN y = Rect.YPos; y < GetHeight() && (y - Rect.YPos) < Rect.Height; ++y) {
     for (INTN x = Rect.XPos; x < GetWidth() && (x - Rect.XPos) < Rect.Width; ++x) {
-      PixelData[y * Width + x] = Color;
+      Data[y * Width + x] = FillColor;
     }
   }
 }
 
 
-UINT8 XImage::Smooth(const UINT8* p, int a01, int a10, int a21, int a12,  float dx, float dy, float scale)
+//
+// Bilinear taps of the destination pixels along one axis: the center of destination pixel i maps to the
+// source coordinate (i + 0.5) / scale - 0.5, kept in 16.16 fixed point. Index is the left/top source pixel,
+// Weight (0..256) the part of the next one.
+//
+static void ScaleTaps(INTN DstSize, INTN SrcSize, float scale, XArray<INTN>& Index, XArray<UINT32>& Weight)
 {
-  return (UINT8)((*(p + a01) * (scale - dx) * 3.f + *(p + a10) * (scale - dy) * 3.f + *(p + a21) * dx * 3.f +
-                  *(p + a12) * dy * 3.f + *(p) * 2.f *scale) / (scale * 8.f));
+  INT64 Step = (INT64)(65536.f / scale);
+  Index.setSize(DstSize);
+  Weight.setSize(DstSize);
+  for (INTN i = 0; i < DstSize; ++i) {
+    INT64 Pos = i * Step + Step / 2 - 32768;
+    if (Pos < 0) {
+      Pos = 0;
+    }
+    INTN i0 = (INTN)(Pos >> 16);
+    UINT32 w = (UINT32)((Pos >> 8) & 0xFF);
+    if (i0 >= SrcSize - 1) {
+      i0 = SrcSize - 1;
+      w = 0;
+    }
+    Index[i] = i0;
+    Weight[i] = w;
+  }
+}
+
+// one source row resampled horizontally, 4 channels per pixel scaled by 256
+static void ScaleRow(const EFI_GRAPHICS_OUTPUT_BLT_PIXEL* Src, INTN DstWidth, const INTN* Index, const UINT32* Weight, UINT32* Out)
+{
+  for (INTN x = 0; x < DstWidth; ++x) {
+    const EFI_GRAPHICS_OUTPUT_BLT_PIXEL& a = Src[Index[x]];
+    const EFI_GRAPHICS_OUTPUT_BLT_PIXEL& b = (Weight[x] != 0) ? Src[Index[x] + 1] : a;
+    UINT32 wb = Weight[x];
+    UINT32 wa = 256 - wb;
+    *Out++ = a.Blue * wa + b.Blue * wb;
+    *Out++ = a.Green * wa + b.Green * wb;
+    *Out++ = a.Red * wa + b.Red * wb;
+    *Out++ = a.Reserved * wa + b.Reserved * wb;
+  }
 }
 
 //sizes remain as were assumed input image is large enough?
+// Separable bilinear in fixed point, rows are resampled horizontally once and then blended vertically.
+// Alpha is interpolated like the colors, so a premultiplied image stays premultiplied.
 void XImage::CopyScaled(const XImage& Image, float scale)
 {
-  int SrcWidth = (int)Image.GetWidth(); //because Source[] requires int argument, why not long long int?
+  INTN SrcWidth = Image.GetWidth();
+  INTN SrcHeight = Image.GetHeight();
+  INTN W = GetWidth();
+  INTN H = GetHeight();
+
+  Premultiplied = Image.Premultiplied;
+  if (W == 0 || H == 0 || SrcWidth == 0 || SrcHeight == 0) {
+    return;
+  }
+  if (scale < 1.e-4) {
+    scale = 1.f;
+  }
 
-  int Pixel = sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
-  int Row = SrcWidth * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
-  int W = (int)GetWidth();
-  int H = (int)GetHeight();
+  XArray<INTN>   XIndex, YIndex;
+  XArray<UINT32> XWeight, YWeight;
+  ScaleTaps(W, SrcWidth, scale, XIndex, XWeight);
+  ScaleTaps(H, SrcHeight, scale, YIndex, YWeight);
 
-  const XArray<EFI_GRAPHICS_OUTPUT_BLT_PIXEL>& Source = Image.GetData();
+  XArray<UINT32> Rows;
+  Rows.setSize(W * 8);
+  UINT32* Upper = &Rows[0];
+  UINT32* Lower = &Rows[W * 4];
+  INTN UpperY = -1, LowerY = -1;
+
+  const EFI_GRAPHICS_OUTPUT_BLT_PIXEL* Source = Image.GetPixelPtr(0, 0);
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL* Dst = GetPixelPtr(0, 0);
 
   for (INTN y = 0; y < H; y++) //destination coordinates
   {
-    int ly = (int)(y / scale); //integer part of src coord
-    float dy = y - ly * scale; //fractional part
-    for (INTN x = 0; x < W; x++)
-    {
-      int lx = (int)(x / scale);
-      float dx = x - lx * scale;
-      int a01 = (lx == 0) ? 0 : -Pixel;
-      int a10 = (ly == 0) ? 0 : -Row;
-      int a21 = (lx == W - 1) ? 0 : Pixel;
-      int a12 = (ly == H - 1) ? 0 : Row;
-      EFI_GRAPHICS_OUTPUT_BLT_PIXEL& dst = *GetPixelPtr(x, y);
-      dst.Blue = Smooth(&Source[lx + ly * SrcWidth].Blue, a01, a10, a21, a12, dx, dy, scale);
-      dst.Green = Smooth(&Source[lx + ly * SrcWidth].Green, a01, a10, a21, a12, dx, dy, scale);
-      dst.Red = Smooth(&Source[lx + ly * SrcWidth].Red, a01, a10, a21, a12, dx, dy, scale);
-      dst.Reserved = Source[lx + ly * SrcWidth].Reserved;
+    INTN y0 = YIndex[y];
+    INTN y1 = (YWeight[y] != 0) ? y0 + 1 : y0;
+    if (UpperY != y0) {
+      if (LowerY == y0) { // going down by one source row: the lower row is already done
+        UINT32* Tmp = Upper;
+        Upper = Lower;
+        Lower = Tmp;
+        LowerY = UpperY;
+      } else {
+        ScaleRow(Source + y0 * SrcWidth, W, &XIndex[0], &XWeight[0], Upper);
+      }
+      UpperY = y0;
+    }
+    if (LowerY != y1 && y1 != y0) {
+      ScaleRow(Source + y1 * SrcWidth, W, &XIndex[0], &XWeight[0], Lower);
+      LowerY = y1;
+    }
+    UINT32 wb = YWeight[y];
+    UINT32 wa = 256 - wb;
+    const UINT32* a = Upper;
+    const UINT32* b = (y1 != y0) ? Lower : Upper;
+    UINT8* Out = (UINT8*)(Dst + y * W);
+    for (INTN i = 0; i < W * 4; ++i) {
+      Out[i] = (UINT8)((a[i] * wa + b[i] * wb + 32768) >> 16);
     }
   }
 }
 
+//
+// Images scaled by GetScaled, found again by their source pixels and the scale. An entry keeps a reference to
+// the source pixels, so if the source is written afterwards it gets new pixels and the entry is just not found.
+//
+#define SCALED_CACHE_SIZE 16
+#define SCALED_CACHE_MAX_PIXELS (1024 * 1024) //bigger copies are not kept
+
+class XImageScaledEntry
+{
+public:
+  Intrusive_ptr<XImagePixels> Source;
+  float  Scale;
+  bool   Premultiplied;
+  XImage Scaled;
+
+  XImageScaledEntry() : Source(), Scale(0.f), Premultiplied(false), Scaled() {}
+};
+
+static XImageScaledEntry ScaledCache[SCALED_CACHE_SIZE];
+static UINTN ScaledCacheNext = 0;
+
+XImage XImage::GetScaled(float scale) const
+{
+  XImage Scaled;
+  Scaled.setSizeInPixels((UINTN)(GetWidth() * scale), (UINTN)(GetHeight() * scale));
+  if (!PixelData || Scaled.Width == 0 || Scaled.Height == 0) {
+    Scaled.Premultiplied = Premultiplied;
+    return Scaled;
+  }
+  for (UINTN i = 0; i < SCALED_CACHE_SIZE; ++i) {
+    if (ScaledCache[i].Source.get() == PixelData.get() && ScaledCache[i].Scale == scale &&
+        ScaledCache[i].Premultiplied == Premultiplied &&
+        ScaledCache[i].Scaled.Width == Scaled.Width && ScaledCache[i].Scaled.Height == Scaled.Height) {
+      return ScaledCache[i].Scaled;
+    }
+  }
+  Scaled.CopyScaled(*this, scale);
+  if (Scaled.Width * Scaled.Height <= SCALED_CACHE_MAX_PIXELS) {
+    XImageScaledEntry& Entry = ScaledCache[ScaledCacheNext];
+    ScaledCacheNext = (ScaledCacheNext + 1) % SCALED_CACHE_SIZE;
+    Entry.Source = PixelData;
+    Entry.Scale = scale;
+    Entry.Premultiplied = Premultiplied;
+    Entry.Scaled = Scaled;
+  }
+  return Scaled;
+}
+
+void XImage::FreeScaledCache()
+{
+  for (UINTN i = 0; i < SCALED_CACHE_SIZE; ++i) {
+    ScaledCache[i].Source.reset();
+    ScaledCache[i].Scaled.setEmpty();
+  }
+  ScaledCacheNext = 0;
+}
+
 /* Place Top image over this image at PosX,PosY
  * Lowest means final image is opaque
  * else transparency will be multiplied
@@ -264,8 +481,7 @@ void XImage::Compose(const EG_RECT& OutPlace, const EG_RECT& InPlace, const XIma
   }
   XImage Top2;
   if (TopScale != 0.f && TopScale != 1.f) {
-    Top2.setSizeInPixels((UINTN)(TopImage.GetWidth() * TopScale), (UINTN)(TopImage.GetHeight() * TopScale));
-    Top2.CopyScaled(TopImage, TopScale);
+    Top2 = TopImage.GetScaled(TopScale);
     PosX = (int)(PosX * TopScale);
     PosY = (int)(PosY * TopScale);
     WArea = (int)(WArea * TopScale);
@@ -284,13 +500,98 @@ void XImage::Compose(const EG_RECT& OutPlace, const EG_RECT& InPlace, const XIma
     HArea = GetHeight() - OutPlace.YPos;
   }
 //change only affected pixels
+  INTN WRow = MIN(WArea, Top.GetWidth() - PosX);
+  if (WRow <= 0) {
+    return;
+  }
+  if (!Premultiplied && !Top.isPremultiplied()) {
+    for (INTN y = 0; y < HArea && (y + PosY) < Top.GetHeight(); ++y) {
+      ComposeRow(GetPixelPtr(OutPlace.XPos, OutPlace.YPos + y), Top.GetPixelPtr(PosX, y + PosY), WRow, Lowest, gray);
+    }
+    return;
+  }
+  // premultiplied compose is a multiply-add. Convert what is not premultiplied yet: this whole image as
+  // the result will be premultiplied, or the rows of Top
+  Premultiply();
+  XArray<EFI_GRAPHICS_OUTPUT_BLT_PIXEL> TopRow;
+  if (!Top.isPremultiplied()) {
+    TopRow.setSize(WRow);
+  }
   for (INTN y = 0; y < HArea && (y + PosY) < Top.GetHeight(); ++y) {
- //   EFI_GRAPHICS_OUTPUT_BLT_PIXEL& CompPtr = *GetPixelPtr(PosX, y); // I assign a ref to avoid the operator ->. Compiler will produce the same anyway.
-    EFI_GRAPHICS_OUTPUT_BLT_PIXEL* CompPtr = GetPixelPtr(OutPlace.XPos, OutPlace.YPos + y);
-    for (INTN x = 0; x < WArea && (x + PosX) < Top.GetWidth(); ++x) {
+    const EFI_GRAPHICS_OUTPUT_BLT_PIXEL* TopPtr = Top.GetPixelPtr(PosX, y + PosY);
+    if (!Top.isPremultiplied()) {
+      for (INTN x = 0; x < WRow; ++x) {
+        TopRow[x] = PremultiplyPixel(TopPtr[x]);
+      }
+      TopPtr = &TopRow[0];
+    }
+    ComposeRowPremultiplied(GetPixelPtr(OutPlace.XPos, OutPlace.YPos + y), TopPtr, WRow, Lowest, gray);
+  }
+}
+
+//
+// Puts Width pixels of TopPtr over CompPtr.
+// ComposeRowReference() is the per pixel reference, ComposeRow() gives the same pixels 4 at a time with SSE2.
+// The division by FinalAlpha is done in float: the dividend is < 2^24 so it is exact, and a quotient that is
+// not an integer is at least 1/FinalAlpha below the next one, more than half a float ulp. So truncation gives
+// the same result as the integer division.
+//
+#if defined(__x86_64__) && defined(__GNUC__)
+#define XIMAGE_SSE2 1
+typedef UINT32 XIMAGE_V4U __attribute__((vector_size(16), may_alias));
+typedef UINT32 XIMAGE_V4U_UNALIGNED __attribute__((vector_size(16), aligned(4), may_alias));
+typedef INT32  XIMAGE_V4I __attribute__((vector_size(16)));
+typedef float  XIMAGE_V4F __attribute__((vector_size(16)));
+#else
+#define XIMAGE_SSE2 0
+#endif
+
+void XImage::ComposeRow(EFI_GRAPHICS_OUTPUT_BLT_PIXEL* CompPtr, const EFI_GRAPHICS_OUTPUT_BLT_PIXEL* TopPtr, INTN Width, bool Lowest, bool gray)
+{
+  INTN x = 0;
+#if XIMAGE_SSE2 == 1
+  if (MemoryOperationGetSimd()) {
+    const XIMAGE_V4U Mask = { 0xFF, 0xFF, 0xFF, 0xFF };
+    const XIMAGE_V4U One = { 1, 1, 1, 1 };
+    for ( ; x + 4 <= Width; x += 4) {
+      XIMAGE_V4U Top = *(const XIMAGE_V4U_UNALIGNED*)(TopPtr + x);
+      XIMAGE_V4U TopAlpha = Top >> 24;
+      if (!Lowest && (TopAlpha[0] | TopAlpha[1] | TopAlpha[2] | TopAlpha[3]) == 0) {
+        continue; // transparent top doesn't change anything
+      }
+      XIMAGE_V4U Comp = *(const XIMAGE_V4U_UNALIGNED*)(CompPtr + x);
+      XIMAGE_V4U TempAlpha = (Comp >> 24) * (Mask - TopAlpha);
+      XIMAGE_V4U TopWeight = TopAlpha * Mask;
+      XIMAGE_V4U FinalAlpha = TopWeight + TempAlpha;
+      XIMAGE_V4U Blend = (XIMAGE_V4U)(FinalAlpha != 0); // lanes where the colors are computed
+      XIMAGE_V4F Divisor = __builtin_convertvector((XIMAGE_V4I)(FinalAlpha | (~Blend & One)), XIMAGE_V4F);
+      XIMAGE_V4U Result = { 0, 0, 0, 0 };
+      for (int Shift = 0; Shift < 24; Shift += 8) { // Blue, Green, Red
+        XIMAGE_V4U CompColor = (Comp >> Shift) & Mask;
+        XIMAGE_V4U Temp = CompColor * TempAlpha + ((Top >> Shift) & Mask) * TopWeight;
+        XIMAGE_V4U Color = (XIMAGE_V4U)__builtin_convertvector(__builtin_convertvector((XIMAGE_V4I)Temp, XIMAGE_V4F) / Divisor, XIMAGE_V4I);
+        Result |= ((Color & Blend) | (CompColor & ~Blend)) << Shift;
+      }
+      if (gray) {
+        XIMAGE_V4U Gray = (Result & Mask) + 2 * ((Result >> 16) & Mask) + 4 * ((Result >> 8) & Mask);
+        Gray = (Gray * 9363) >> 16; // same as / 7 below 13107
+        XIMAGE_V4U IsTop = (XIMAGE_V4U)(TopAlpha != 0);
+        Result = (Result & ~IsTop) | ((Gray | (Gray << 8) | (Gray << 16)) & IsTop);
+      }
+      XIMAGE_V4U Alpha = Lowest ? Mask : (FinalAlpha * 32897) >> 23; // same as / 255 below 66052
+      *(XIMAGE_V4U_UNALIGNED*)(CompPtr + x) = Result | (Alpha << 24);
+    }
+  }
+#endif
+  ComposeRowReference(CompPtr + x, TopPtr + x, Width - x, Lowest, gray);
+}
+
+void XImage::ComposeRowReference(EFI_GRAPHICS_OUTPUT_BLT_PIXEL* CompPtr, const EFI_GRAPHICS_OUTPUT_BLT_PIXEL* TopPtr, INTN Width, bool Lowest, bool gray)
+{
+    for (INTN x = 0; x < Width; ++x) {
       //------
       // test compAlpha = 255; TopAlpha = 0 -> only Comp, TopAplha = 255 -> only Top
-      UINT32 TopAlpha = Top.GetPixel(x + PosX, y + PosY).Reserved & 0xFF; //0, 255
+      UINT32 TopAlpha = TopPtr->Reserved & 0xFF; //0, 255
       UINT32 CompAlpha = CompPtr->Reserved & 0xFF; //255
       UINT32 RevAlpha = 255 - TopAlpha; //2<<8; 255, 0
       UINT32 TempAlpha = CompAlpha * RevAlpha; //2<<16; 255*255, 0
@@ -299,13 +600,13 @@ void XImage::Compose(const EG_RECT& OutPlace, const EG_RECT& InPlace, const XIma
 //final alpha =(1-(1-x)*(1-y)) =(255*255-(255-topA)*(255-compA))/255 = topA+compA*(1-topA)
 
       if (FinalAlpha != 0) {
-        UINT32 Temp = (CompPtr->Blue * TempAlpha) + (Top.GetPixel(x + PosX, y + PosY).Blue * TopAlpha);
+        UINT32 Temp = (CompPtr->Blue * TempAlpha) + (TopPtr->Blue * TopAlpha);
         CompPtr->Blue = (UINT8)(Temp / FinalAlpha);
 
-        Temp = (CompPtr->Green * TempAlpha) + (Top.GetPixel(x + PosX, y + PosY).Green * TopAlpha);
+        Temp = (CompPtr->Green * TempAlpha) + (TopPtr->Green * TopAlpha);
         CompPtr->Green = (UINT8)(Temp / FinalAlpha);
 
-        Temp = (CompPtr->Red * TempAlpha) + (Top.GetPixel(x + PosX, y + PosY).Red * TopAlpha);
+        Temp = (CompPtr->Red * TempAlpha) + (TopPtr->Red * TopAlpha);
         CompPtr->Red = (UINT8)(Temp / FinalAlpha);
       
         if (gray && (TopAlpha != 0)) {
@@ -322,6 +623,64 @@ void XImage::Compose(const EG_RECT& OutPlace, const EG_RECT& InPlace, const XIma
         CompPtr->Reserved = (UINT8)(FinalAlpha / 255);
       }
       CompPtr++; //faster way to move to next pixel
+      TopPtr++;
+    }
+}
+
+//
+// Same for premultiplied pixels: Comp = Top + Comp * (255 - TopAlpha) / 255, alpha included.
+// There is no division. With Lowest the alpha becomes 255, so the result is Comp over black.
+//
+void XImage::ComposeRowPremultiplied(EFI_GRAPHICS_OUTPUT_BLT_PIXEL* CompPtr, const EFI_GRAPHICS_OUTPUT_BLT_PIXEL* TopPtr, INTN Width, bool Lowest, bool gray)
+{
+  INTN x = 0;
+#if XIMAGE_SSE2 == 1
+  if (MemoryOperationGetSimd()) {
+    const XIMAGE_V4U Mask = { 0xFF, 0xFF, 0xFF, 0xFF };
+    const XIMAGE_V4U One = { 1, 1, 1, 1 };
+    const XIMAGE_V4U Div = { 257, 257, 257, 257 };
+    for ( ; x + 4 <= Width; x += 4) {
+      XIMAGE_V4U Top = *(const XIMAGE_V4U_UNALIGNED*)(TopPtr + x);
+      if (!Lowest && (Top[0] | Top[1] | Top[2] | Top[3]) == 0) {
+        continue; // transparent top doesn't change anything
+      }
+      XIMAGE_V4U Comp = *(const XIMAGE_V4U_UNALIGNED*)(CompPtr + x);
+      XIMAGE_V4U TopAlpha = Top >> 24;
+      XIMAGE_V4U RevAlpha = Mask - TopAlpha;
+      XIMAGE_V4U Result = { 0, 0, 0, 0 };
+      for (int Shift = 0; Shift < 32; Shift += 8) { // Blue, Green, Red, Alpha
+        XIMAGE_V4U Color = ((Top >> Shift) & Mask) + ((((Comp >> Shift) & Mask) * RevAlpha + One) * Div >> 16);
+        XIMAGE_V4U Over = (XIMAGE_V4U)(Color > Mask);
+        Result |= ((Color & ~Over) | (Mask & Over)) << Shift;
+      }
+      if (gray) {
+        XIMAGE_V4U Gray = (Result & Mask) + 2 * ((Result >> 16) & Mask) + 4 * ((Result >> 8) & Mask);
+        Gray = (Gray * 9363) >> 16; // same as / 7 below 13107
+        XIMAGE_V4U IsTop = (XIMAGE_V4U)(TopAlpha != 0);
+        Result = (Result & ~IsTop) | ((Gray | (Gray << 8) | (Gray << 16) | (Result & (Mask << 24))) & IsTop);
+      }
+      if (Lowest) {
+        Result |= Mask << 24;
+      }
+      *(XIMAGE_V4U_UNALIGNED*)(CompPtr + x) = Result;
+    }
+  }
+#endif
+  for ( ; x < Width; ++x) {
+    UINT32 RevAlpha = 255 - TopPtr[x].Reserved;
+    EFI_GRAPHICS_OUTPUT_BLT_PIXEL& Comp = CompPtr[x];
+    Comp.Blue = (UINT8)MIN(255, TopPtr[x].Blue + Div255(Comp.Blue * RevAlpha));
+    Comp.Green = (UINT8)MIN(255, TopPtr[x].Green + Div255(Comp.Green * RevAlpha));
+    Comp.Red = (UINT8)MIN(255, TopPtr[x].Red + Div255(Comp.Red * RevAlpha));
+    Comp.Reserved = (UINT8)MIN(255, TopPtr[x].Reserved + Div255(Comp.Reserved * RevAlpha));
+    if (gray && RevAlpha != 255) {
+      UINT8 Gray = (UINT8)(((UINT32)Comp.Blue + 2 * (UINT32)Comp.Red + 4 * (UINT32)Comp.Green) / 7);
+      Comp.Blue = Gray;
+      Comp.Green = Gray;
+      Comp.Red = Gray;
+    }
+    if (Lowest) {
+      Comp.Reserved = 255;
     }
   }
 }
@@ -351,24 +710,74 @@ void XImage::FlipRB()
  * The function converted plain array into XImage object
  * Error = 0 - Success
  * Error = 28 - invalid signature
+ * lodepng decodes right into PixelData in the BGRA order of EFI_GRAPHICS_OUTPUT_BLT_PIXEL
  */
 EFI_STATUS XImage::FromPNG(const UINT8 * Data, UINTN Length)
 {
 //  DBG("XImage len=%llu\n", Length);
   if (Data == NULL) return EFI_INVALID_PARAMETER;
-  UINT8 * PixelPtr; // = (UINT8 *)&PixelData[0];
-  unsigned Error = eglodepng_decode(&PixelPtr, &Width, &Height, Data, Length);
-  if (Error != 0 && Error != 28) {
+  size_t NewWidth = 0;
+  size_t NewHeight = 0;
+  unsigned Error = eglodepng_inspect(&NewWidth, &NewHeight, Data, Length);
+  if (Error == 28) return EFI_UNSUPPORTED;
+  if (Error != 0 || NewWidth == 0 || NewHeight == 0) {
     return EFI_NOT_FOUND;
   }
-  if ( !PixelPtr ) return EFI_UNSUPPORTED; // It's possible to get error 28 and PixelPtr == NULL
-  setSizeInPixels(Width, Height);
-  //now we have a new pointer and want to move data
-  INTN NewLength = Width * Height * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
-  CopyMem(GetPixelPtr(0,0), PixelPtr, NewLength);
-  FreePool(PixelPtr); //allocated by lodepng
+  setSizeInPixels(NewWidth, NewHeight);
+  Error = eglodepng_decode_bgra((UINT8*)GetPixelPtr(0,0), Width, Height, Data, Length);
+  if (Error != 0) {
+    setEmpty();
+    return EFI_NOT_FOUND;
+  }
+
+  Premultiplied = false;
+  Premultiply(); //once at load, so Compose doesn't divide
+  return EFI_SUCCESS;
+}
 
-  FlipRB();
+/*
+ * Embedded asset generated by mkegemb_rle.py: UINT16 Width, UINT16 Height, then packets of
+ * premultiplied BGRA pixels. A packet byte n < 0x80 is followed by n + 1 pixels, n >= 0x80 by
+ * one pixel repeated (n & 0x7F) + 1 times. Nothing to decode, the embedded theme starts at once.
+ */
+EFI_STATUS XImage::FromRLE(const UINT8 * Data, UINTN Length)
+{
+  if (Data == NULL || Length < 4) return EFI_INVALID_PARAMETER;
+  UINTN NewWidth = Data[0] | (Data[1] << 8);
+  UINTN NewHeight = Data[2] | (Data[3] << 8);
+  if (NewWidth == 0 || NewHeight == 0) {
+    return EFI_NOT_FOUND;
+  }
+  setSizeInPixels(NewWidth, NewHeight);
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL* Pixel = GetPixelPtr(0, 0);
+  UINTN Left = NewWidth * NewHeight;
+  UINTN Pos = 4;
+  while (Left > 0 && Pos < Length) {
+    UINTN Count = (Data[Pos] & 0x7F) + 1;
+    bool Repeat = (Data[Pos] & 0x80) != 0;
+    Pos++;
+    if (Count > Left || Pos + (Repeat ? 1 : Count) * 4 > Length) {
+      break;
+    }
+    if (Repeat) {
+      EFI_GRAPHICS_OUTPUT_BLT_PIXEL Color;
+      CopyMem(&Color, Data + Pos, 4);
+      Pos += 4;
+      for (UINTN i = 0; i < Count; i++) {
+        *Pixel++ = Color;
+      }
+    } else {
+      CopyMem(Pixel, Data + Pos, Count * 4);
+      Pixel += Count;
+      Pos += Count * 4;
+    }
+    Left -= Count;
+  }
+  if (Left != 0) {
+    setEmpty();
+    return EFI_NOT_FOUND;
+  }
+  Premultiplied = true;
   return EFI_SUCCESS;
 }
 
@@ -378,12 +787,18 @@ EFI_STATUS XImage::FromPNG(const UINT8 * Data, UINTN Length)
  * The caller is responsible to free the array.
  */
 
-EFI_STATUS XImage::ToPNG(UINT8** Data, UINTN& OutSize)
+EFI_STATUS XImage::ToPNG(UINT8** Data, UINTN& OutSize, bool Fast)
 {
+  if (Premultiplied) { //PNG is straight alpha
+    XImage Straight(*this);
+    Straight.Unpremultiply();
+    return Straight.ToPNG(Data, OutSize, Fast);
+  }
   size_t           FileDataLength = 0;
   FlipRB(); //commomly we want alpha for PNG, but not for screenshot, fix alpha there
-  UINT8 * PixelPtr = (UINT8 *)&PixelData[0];
-  unsigned Error = eglodepng_encode(Data, &FileDataLength, PixelPtr, Width, Height);
+  UINT8 * PixelPtr = (UINT8 *)GetPixelPtr(0, 0);
+  unsigned Error = Fast ? eglodepng_encode_fast(Data, &FileDataLength, PixelPtr, Width, Height)
+                        : eglodepng_encode(Data, &FileDataLength, PixelPtr, Width, Height);
   OutSize = FileDataLength;
   if (Error) return EFI_UNSUPPORTED;
   return EFI_SUCCESS;
@@ -416,7 +831,8 @@ EFI_STATUS XImage::FromSVG(const CHAR8 *SVGData, float scale)
     Scale *= scale;
 
     DBG("Test image width=%d heigth=%d\n", (int)(SVGimage->width), (int)(SVGimage->height));
-    nsvgRasterize(rast, SVGimage, 0.f, 0.f, Scale, Scale, (UINT8*)&PixelData[0], (int)Width, (int)Height, (int)Width * sizeof(PixelData[0]));
+    nsvgRasterizePremultiplied(rast, SVGimage, 0.f, 0.f, Scale, Scale, (UINT8*)GetPixelPtr(0, 0), (int)Width, (int)Height, (int)Width * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+    Premultiplied = true;
     FreePool(SVGimage);
   }
 //  nsvg__deleteParser(p); //can't delete raster until we make imageChain
@@ -462,7 +878,12 @@ void XImage::GetArea(INTN x, INTN y, UINTN W, UINTN H)
   Height = (y + H > (UINTN)UGAHeight) ? (y > UGAHeight ? 0 : UGAHeight - y) : H;
 
   setSizeInPixels(Width, Height); // setSizeInPixels BEFORE, so &PixelData[0]
+  Premultiplied = false; // opaque anyway
   if ( Width == 0 || Height == 0 ) return; // nothing to get, area is zero. &PixelData[0] would crash
+  if (egScreenBufferGetArea(x, y, Width, Height, GetPixelPtr(0, 0))) {
+    GraphicsOutput = NULL; // got from the RAM copy of the screen, no need to read the video memory
+    UgaDraw = NULL;
+  }
 /*
  * Blt(...Width, Height, Delta);
  * if (Delta == 0) {
@@ -472,7 +893,7 @@ void XImage::GetArea(INTN x, INTN y, UINTN W, UINTN H)
  */
   if (GraphicsOutput != NULL) {
     GraphicsOutput->Blt(GraphicsOutput,
-      &PixelData[0],
+      GetPixelPtr(0, 0),
       EfiBltVideoToBltBuffer,
       x, y, 0, 0, Width, Height, 0); // Width*sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
   }
@@ -482,6 +903,10 @@ void XImage::GetArea(INTN x, INTN y, UINTN W, UINTN H)
       EfiUgaVideoToBltBuffer,
       x, y, 0, 0, Width, Height, 0); //Width*sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
   }
+  if (GraphicsOutput != NULL || UgaDraw != NULL) {
+    gPerfCounters.BltCalls++;
+    gPerfCounters.BltPixels += (UINT64)Width * Height;
+  }
   //fix alpha
   UINTN ImageSize = (Width * Height);
   EFI_GRAPHICS_OUTPUT_BLT_PIXEL* Pixel = GetPixelPtr(0,0);
@@ -502,30 +927,8 @@ void XImage::DrawWithoutCompose(INTN x, INTN y, UINTN width, UINTN height)
   UINTN AreaHeight = (y + height > (UINTN)UGAHeight) ? (y > UGAHeight ? 0 : UGAHeight - y) : height;
 
 //  DBG("area=%d,%d\n", AreaWidth, AreaHeight);
-  // prepare protocols
-  EFI_STATUS Status;
-  EFI_GUID UgaDrawProtocolGuid = EFI_UGA_DRAW_PROTOCOL_GUID;
-  EFI_UGA_DRAW_PROTOCOL *UgaDraw = NULL;
-  EFI_GUID GraphicsOutputProtocolGuid = EFI_GRAPHICS_OUTPUT_PROTOCOL_GUID;
-  EFI_GRAPHICS_OUTPUT_PROTOCOL *GraphicsOutput = NULL;
-
-  Status = EfiLibLocateProtocol(&GraphicsOutputProtocolGuid, (void **)&GraphicsOutput);
-  if (EFI_ERROR(Status)) {
-    GraphicsOutput = NULL;
-    Status = EfiLibLocateProtocol(&UgaDrawProtocolGuid, (void **)&UgaDraw);
-    if (EFI_ERROR(Status))
-      UgaDraw = NULL;
-  }
-  //output combined image
-  if (GraphicsOutput != NULL) {
-    GraphicsOutput->Blt(GraphicsOutput, (*this).GetPixelPtr(0, 0),
-      EfiBltBufferToVideo,
-      0, 0, x, y, AreaWidth, AreaHeight, GetWidth()*sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
-  }
-  else if (UgaDraw != NULL) {
-    UgaDraw->Blt(UgaDraw, (EFI_UGA_PIXEL *)(*this).GetPixelPtr(0, 0), EfiUgaBltBufferToVideo,
-      0, 0, x, y, AreaWidth, AreaHeight, GetWidth()*sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
-  }
+  //output combined image, through the RAM copy of the screen
+  egScreenBufferDraw(Pixels().data(), GetWidth(), x, y, AreaWidth, AreaHeight);
 }
 
 void XImage::Draw(INTN x, INTN y)
@@ -651,9 +1054,11 @@ void XImage::EnsureImageSize(IN UINTN NewWidth, IN UINTN NewHeight, IN CONST EFI
   XImage NewImage(NewWidth, NewHeight);
   NewImage.Fill(Color);
   NewImage.Compose(0, 0, (*this), false); //should keep existing opacity
-  setSizeInPixels(NewWidth, NewHeight); //include reallocate but loose data
-  CopyMem(&PixelData[0], &NewImage.PixelData[0], GetSizeInBytes());
-  //we have to copy pixels twice? because we can't return newimage instead of this
+  //take the pixels of NewImage, no copy
+  Width = NewWidth;
+  Height = NewHeight;
+  PixelData = static_cast<Intrusive_ptr<XImagePixels>&&>(NewImage.PixelData);
+  Premultiplied = NewImage.Premultiplied;
 }
 
 void XImage::DummyImage(IN UINTN PixelSize)
@@ -663,6 +1068,7 @@ void XImage::DummyImage(IN UINTN PixelSize)
   CHAR8           *Ptr, *YPtr;
 
   setSizeInPixels(PixelSize, PixelSize);
+  Premultiplied = false;
 
   LineOffset = PixelSize * 4;
 
@@ -691,9 +1097,11 @@ void XImage::Copy(XImage* Image)
 }
 void XImage::CopyRect(const XImage& Image, INTN XPos, INTN YPos)
 {
+  XArray<EFI_GRAPHICS_OUTPUT_BLT_PIXEL>& Data = PixelsForWrite();
   for (INTN y = 0; y < GetHeight() && (y + YPos) < Image.GetHeight(); ++y) {
     for (INTN x = 0; x < GetWidth() && (x + XPos) < Image.GetWidth(); ++x) {
-      PixelData[y * Width + x] = Image.GetPixel(x + XPos, y + YPos);
+      Data[y * Width + x] = (Premultiplied == Image.Premultiplied) ? Image.GetPixel(x + XPos, y + YPos) :
+        Premultiplied ? PremultiplyPixel(Image.GetPixel(x + XPos, y + YPos)) : Image.GetStraightPixel(x + XPos, y + YPos);
     }
   }
 }
@@ -709,13 +1117,37 @@ void XImage::CopyRect(const XImage& Image, const EG_RECT& OwnPlace, const EG_REC
   INTN Dy = OwnPlace.YPos - InputRect.YPos;
   INTN W = MIN(OwnPlace.Width, InputRect.Width);
   INTN H = MIN(OwnPlace.Height, InputRect.Height);
+  XArray<EFI_GRAPHICS_OUTPUT_BLT_PIXEL>& Data = PixelsForWrite();
   for (INTN y = OwnPlace.YPos; y - OwnPlace.YPos < H && y < GetHeight() && (y - Dy) < Image.GetHeight(); ++y) {
     for (INTN x = OwnPlace.XPos; x - OwnPlace.XPos < W && x < GetWidth() && (x - Dx) < Image.GetWidth(); ++x) {
-      PixelData[y * Width + x] = Image.GetPixel(x - Dx, y - Dy);
+      Data[y * Width + x] = (Premultiplied == Image.Premultiplied) ? Image.GetPixel(x - Dx, y - Dy) :
+        Premultiplied ? PremultiplyPixel(Image.GetPixel(x - Dx, y - Dy)) : Image.GetStraightPixel(x - Dx, y - Dy);
     }
   }
 }
 
+//
+// Decoded .icns files, found again by directory, name, size and the file's modification time. The volume
+// icons are asked for once per entry of the volume and again at each rescan.
+//
+#define ICNS_CACHE_SIZE 8
+
+class XImageIcnsEntry
+{
+public:
+  const EFI_FILE* BaseDir;
+  XStringW        FileName;
+  UINTN           PixelSize;
+  UINT64          FileSize;
+  EFI_TIME        ModificationTime;
+  XImage          Image;
+
+  XImageIcnsEntry() : BaseDir(NULL), FileName(), PixelSize(0), FileSize(0), ModificationTime(), Image() {}
+};
+
+static XImageIcnsEntry IcnsCache[ICNS_CACHE_SIZE];
+static UINTN IcnsCacheNext = 0;
+
 //
 // Load an image from a .icns file
 //
@@ -727,21 +1159,53 @@ EFI_STATUS XImage::LoadIcns(const EFI_FILE* BaseDir, IN CONST CHAR16 *FileName,
     EFI_STATUS  Status = EFI_NOT_FOUND;
     UINT8           *FileData = NULL;
     UINTN           FileDataLength = 0;
-    //TODO - make XImage
- //   EG_IMAGE        *NewImage;
-
+    EFI_FILE*       FileHandle = NULL;
+    EFI_FILE_INFO   *FileInfo = NULL;
+
+    // the file's size and time tell if a cached decode is still good
+    Status = BaseDir->Open(BaseDir, &FileHandle, (CHAR16*)FileName, EFI_FILE_MODE_READ, 0);
+    if (!EFI_ERROR(Status) && FileHandle) {
+      FileInfo = EfiLibFileInfo(FileHandle);
+      FileHandle->Close(FileHandle);
+    }
+    if (FileInfo) {
+      for (UINTN i = 0; i < ICNS_CACHE_SIZE; ++i) {
+        XImageIcnsEntry& Entry = IcnsCache[i];
+        if (Entry.BaseDir == BaseDir && Entry.PixelSize == PixelSize && Entry.FileSize == FileInfo->FileSize &&
+            CompareMem(&Entry.ModificationTime, &FileInfo->ModificationTime, sizeof(EFI_TIME)) == 0 &&
+            Entry.FileName.equalIC(FileName)) {
+          FreePool(FileInfo);
+          *this = Entry.Image;
+          return EFI_SUCCESS;
+        }
+      }
+    }
 
     // load file
     Status = egLoadFile(BaseDir, FileName, &FileData, &FileDataLength);
     if (EFI_ERROR(Status)) {
+      if (FileInfo) {
+        FreePool(FileInfo);
+      }
       return Status;
     }
 
     // decode it
-//    NewImage = egDecodeICNS(FileData, FileDataLength, PixelSize, TRUE);
-//    Status = FromEGImage(NewImage);
     Status = FromICNS(FileData, FileDataLength, PixelSize);
     FreePool(FileData);
+    if (!EFI_ERROR(Status) && FileInfo) {
+      XImageIcnsEntry& Entry = IcnsCache[IcnsCacheNext];
+      IcnsCacheNext = (IcnsCacheNext + 1) % ICNS_CACHE_SIZE;
+      Entry.BaseDir = BaseDir;
+      Entry.FileName.takeValueFrom(FileName);
+      Entry.PixelSize = PixelSize;
+      Entry.FileSize = FileInfo->FileSize;
+      Entry.ModificationTime = FileInfo->ModificationTime;
+      Entry.Image = *this;
+    }
+    if (FileInfo) {
+      FreePool(FileInfo);
+    }
     return Status;
 
   }
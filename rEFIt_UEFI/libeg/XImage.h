@@ -10,6 +10,7 @@ extern "C" {
 }
 #include "../cpp_foundation/XArray.h"
 #include "../cpp_foundation/XString.h"
+#include "../cpp_foundation/shared_ptr.h"
 #include "../libeg/libeg.h"
 //#include "lodepng.h"
 //
@@ -39,23 +40,40 @@ typedef struct {
   UINTN Height;
 } EgRect;
 */
+//
+// The pixels of an XImage. Copies of an image (theme icons, menu entries, the icon cache) share them,
+// the first write through one of the copies gives it its own pixels.
+//
+class XImagePixels : public RefCounted
+{
+public:
+  XArray<EFI_GRAPHICS_OUTPUT_BLT_PIXEL> Data;
+
+  XImagePixels() : RefCounted(), Data() {}
+  XImagePixels(const XImagePixels& other) : RefCounted(), Data(other.Data) {}
+};
+
 class XImage
 {
 protected:
   size_t      Width; //may be better to use INTN - signed integer as it always compared with expressions
   size_t      Height;
-  XArray<EFI_GRAPHICS_OUTPUT_BLT_PIXEL> PixelData;
+  Intrusive_ptr<XImagePixels> PixelData; //null for an empty image
+  bool        Premultiplied; //colors are stored already multiplied by alpha. FromPNG and FromSVG produce such images
  
 public:
-  XImage() : Width(0), Height(0), PixelData() {};
+  XImage() : Width(0), Height(0), PixelData(), Premultiplied(false) {};
   XImage(UINTN W, UINTN H);
   XImage(const XImage& Image, float scale = 0.f); //the constructor can accept 0 scale as 1.f
+  XImage(const XImage& Image, const EG_RECT& Rect); //copy of the Rect part of Image
   virtual ~XImage();
 
   XImage& operator= (const XImage& other);
 
 protected:
   UINTN GetSizeInBytes() const;  //in bytes
+  const XArray<EFI_GRAPHICS_OUTPUT_BLT_PIXEL>& Pixels() const;
+  XArray<EFI_GRAPHICS_OUTPUT_BLT_PIXEL>& PixelsForWrite(); //unshare before writing
 
 public:
 
@@ -64,6 +82,7 @@ public:
   const XArray<EFI_GRAPHICS_OUTPUT_BLT_PIXEL>& GetData() const;
 
   const EFI_GRAPHICS_OUTPUT_BLT_PIXEL& GetPixel(INTN x, INTN y) const;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL GetStraightPixel(INTN x, INTN y) const; //not premultiplied, whatever the storage is
   const EFI_GRAPHICS_OUTPUT_BLT_PIXEL* GetPixelPtr(INTN x, INTN y) const ;
   EFI_GRAPHICS_OUTPUT_BLT_PIXEL* GetPixelPtr(INTN x, INTN y);
   INTN      GetWidth() const { return (INTN)Width; }
@@ -71,8 +90,14 @@ public:
 
   void setZero() { SetMem( (void*)GetPixelPtr(0, 0), GetSizeInBytes(), 0); }
 
-  void setEmpty() { Width=0; Height=0; PixelData.setEmpty(); }
-  bool isEmpty() const { return PixelData.size() == 0; }
+  void setEmpty() { Width=0; Height=0; PixelData.reset(); Premultiplied = false; }
+  bool isEmpty() const { return Pixels().size() == 0; }
+  bool sharesPixelsWith(const XImage& other) const { return PixelData && PixelData.get() == other.PixelData.get(); }
+
+  bool isPremultiplied() const { return Premultiplied; }
+  void setPremultiplied(bool NewPremultiplied) { Premultiplied = NewPremultiplied; } //only the flag, pixels are not converted
+  void Premultiply();
+  void Unpremultiply();
 
 
   void Fill(const EFI_GRAPHICS_OUTPUT_BLT_PIXEL& Color = { 0, 0, 0, 0 });
@@ -81,13 +106,19 @@ public:
   void FillArea(const EFI_GRAPHICS_OUTPUT_BLT_PIXEL& Color, EG_RECT& Rect);
   void Copy(XImage* Image);
   void CopyScaled(const XImage& Image, float scale = 0.f);
+  XImage GetScaled(float scale) const; //shares the pixels of a cached copy scaled by CopyScaled
+  static void FreeScaledCache();
   void CopyRect(const XImage& Image, INTN X, INTN Y);
   void CopyRect(const XImage& Image, const EG_RECT& OwnPlace, const EG_RECT& InputRect);
   void Compose(const EG_RECT& OwnPlace, const EG_RECT& InputRect, const XImage& TopImage, bool Lowest, float TopScale = 0.f);
   void Compose(INTN PosX, INTN PosY, const XImage& TopImage, bool Lowest, float topScale = 0); //instead of compose we often can Back.Draw(...) + Top.Draw(...)
+  static void ComposeRow(EFI_GRAPHICS_OUTPUT_BLT_PIXEL* CompPtr, const EFI_GRAPHICS_OUTPUT_BLT_PIXEL* TopPtr, INTN Width, bool Lowest, bool gray);
+  static void ComposeRowReference(EFI_GRAPHICS_OUTPUT_BLT_PIXEL* CompPtr, const EFI_GRAPHICS_OUTPUT_BLT_PIXEL* TopPtr, INTN Width, bool Lowest, bool gray);
+  static void ComposeRowPremultiplied(EFI_GRAPHICS_OUTPUT_BLT_PIXEL* CompPtr, const EFI_GRAPHICS_OUTPUT_BLT_PIXEL* TopPtr, INTN Width, bool Lowest, bool gray);
   void FlipRB();
   EFI_STATUS FromPNG(const UINT8 * Data, UINTN Lenght);
-  EFI_STATUS ToPNG(UINT8** Data, UINTN& OutSize);
+  EFI_STATUS FromRLE(const UINT8 * Data, UINTN Length); //emb_xxx_rle made by mkegemb_rle.py
+  EFI_STATUS ToPNG(UINT8** Data, UINTN& OutSize, bool Fast = false); //Fast: opaque RGB, quick deflate, for screenshots
   EFI_STATUS FromSVG(const CHAR8 *SVGData, float scale);
   EFI_STATUS FromICNS(IN UINT8 *FileData, IN UINTN FileDataLength, IN UINTN IconSize);
 
@@ -107,8 +138,6 @@ public:
   void EnsureImageSize(IN UINTN Width, IN UINTN Height, IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL& Color);
   void EnsureImageSize(IN UINTN NewWidth, IN UINTN NewHeight);
   void DummyImage(IN UINTN PixelSize);
-protected:
-  UINT8 Smooth(const UINT8* p, int a01, int a10, int a21, int a12,  float dx, float dy, float scale);
 };
 
 class IndexedImage
@@ -43,6 +43,8 @@ public:
   bool isEmpty() const { return PointerImage->isEmpty(); }
   void ClearEvent() { MouseEvent = NoEvents; }
   MOUSE_EVENT GetEvent();
+  // signaled by the driver when the pointer moves or a button changes, NULL if there is no pointer
+  EFI_EVENT GetWaitEvent() const { return SimplePointerProtocol ? SimplePointerProtocol->WaitForInput : NULL; }
   EG_RECT& GetPlace() { return newPlace; }
 
 protected:
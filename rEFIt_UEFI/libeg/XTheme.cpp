@@ -35,8 +35,8 @@ XTheme::XTheme() : Icons(), ThemeDir(0), HideBadges(0), HideUIFlags(0), Font(FON
                    MainEntriesSize(0), TileXSpace(0), TileYSpace(0), Proportional(0), embedded(0), DarkEmbedded(0), TypeSVG(0), Scale(0), CentreShift(0),
                    row0TileSize(0), row1TileSize(0), BanHeight(0), LayoutHeight(0), LayoutBannerOffset(0), LayoutButtonOffset(0), LayoutTextOffset(0),
                    LayoutAnimMoveForMenuX(0), ScrollWidth(0), ScrollButtonsHeight(0), ScrollBarDecorationsHeight(0), ScrollScrollDecorationsHeight(0),
-                   FontWidth(0), FontHeight(0), TextHeight(0), Daylight(0), Background(), BigBack(), Banner(), SelectionImages(), Buttons(), ScrollbarBackgroundImage(), BarStartImage(), BarEndImage(),
-                   ScrollbarImage(), ScrollStartImage(), ScrollEndImage(), UpButtonImage(), DownButtonImage(), FontImage(), BannerPlace(), Cinema(), SVGParser(0)
+                   FontWidth(0), FontHeight(0), TextHeight(0), Daylight(0), Background(), BackgroundGeneration(0), BigBack(), Banner(), SelectionImages(), Buttons(), ScrollbarBackgroundImage(), BarStartImage(), BarEndImage(),
+                   ScrollbarImage(), ScrollStartImage(), ScrollEndImage(), UpButtonImage(), DownButtonImage(), FontImage(), GlyphRightSpace(), GlyphMetricsWidth(0), BannerPlace(), Cinema(), SVGParser(0)
 {
   Init();
 }
@@ -47,6 +47,7 @@ XTheme::~XTheme() {
 
 void XTheme::Init()
 {
+  XImage::FreeScaledCache(); // the scaled images of the previous theme
 //  DisableFlags = 0;             
   HideBadges = 0; 
   HideUIFlags = 0; 
@@ -162,6 +163,7 @@ bool XTheme::CheckNative(INTN Id)
   {
     if (Icons[i].Id == Id)
     {
+      ResolveIcon(i);
       return Icons[i].Native;
     }
   }
@@ -197,6 +199,12 @@ XIcon& XTheme::GetIconAlt(INTN Id, INTN Alt) //if not found then take embedded
       AltFound = i;
     }
   }
+  if (IdFound >= 0) {
+    ResolveIcon(IdFound);
+  }
+  if (AltFound >= 0) {
+    ResolveIcon(AltFound);
+  }
 
   // if icon is empty, try to fill it with alternative
   if (IdFound >= 0 && Icons[IdFound].Image.isEmpty()) {
@@ -295,6 +303,7 @@ void XTheme::FillByEmbedded()
   SelectionBackgroundPixel = { 0xa0, 0xa0, 0xa0, 0x80 };
 
   Icons.setEmpty();
+  IconPending.setEmpty();
   for (INTN i = 0; i < BUILTIN_ICON_COUNT; ++i) { //this is embedded icon count
     XIcon* NewIcon = new XIcon(i, true);
     Icons.AddReference(NewIcon, true);
@@ -302,28 +311,29 @@ void XTheme::FillByEmbedded()
 
   BigBack.setEmpty();
   Background = XImage(UGAWidth, UGAHeight);
+  BackgroundGeneration++;
 
   if (Daylight) {
-    Banner.FromPNG(ACCESS_EMB_DATA(emb_logo), emb_logo_size);
+    Banner.FromRLE(ACCESS_EMB_DATA(emb_logo_rle), ACCESS_EMB_SIZE(emb_logo_rle));
   } else {
-    Banner.FromPNG(ACCESS_EMB_DATA(emb_dark_logo), emb_dark_logo_size);
+    Banner.FromRLE(ACCESS_EMB_DATA(emb_dark_logo_rle), ACCESS_EMB_SIZE(emb_dark_logo_rle));
   }
   
   //and buttons
-  Buttons[0].FromPNG(ACCESS_EMB_DATA(emb_radio_button), ACCESS_EMB_SIZE(emb_radio_button));
-  Buttons[1].FromPNG(ACCESS_EMB_DATA(emb_radio_button_selected), ACCESS_EMB_SIZE(emb_radio_button_selected));
-  Buttons[2].FromPNG(ACCESS_EMB_DATA(emb_checkbox), ACCESS_EMB_SIZE(emb_checkbox));
-  Buttons[3].FromPNG(ACCESS_EMB_DATA(emb_checkbox_checked), ACCESS_EMB_SIZE(emb_checkbox_checked));
+  Buttons[0].FromRLE(ACCESS_EMB_DATA(emb_radio_button_rle), ACCESS_EMB_SIZE(emb_radio_button_rle));
+  Buttons[1].FromRLE(ACCESS_EMB_DATA(emb_radio_button_selected_rle), ACCESS_EMB_SIZE(emb_radio_button_selected_rle));
+  Buttons[2].FromRLE(ACCESS_EMB_DATA(emb_checkbox_rle), ACCESS_EMB_SIZE(emb_checkbox_rle));
+  Buttons[3].FromRLE(ACCESS_EMB_DATA(emb_checkbox_checked_rle), ACCESS_EMB_SIZE(emb_checkbox_checked_rle));
 
   if (Daylight) {
-    SelectionImages[0].FromPNG(ACCESS_EMB_DATA(emb_selection_big), ACCESS_EMB_SIZE(emb_selection_big));
-    SelectionImages[2].FromPNG(ACCESS_EMB_DATA(emb_selection_small), ACCESS_EMB_SIZE(emb_selection_small));
+    SelectionImages[0].FromRLE(ACCESS_EMB_DATA(emb_selection_big_rle), ACCESS_EMB_SIZE(emb_selection_big_rle));
+    SelectionImages[2].FromRLE(ACCESS_EMB_DATA(emb_selection_small_rle), ACCESS_EMB_SIZE(emb_selection_small_rle));
   } else {
-    SelectionImages[0].FromPNG(ACCESS_EMB_DATA(emb_dark_selection_big), ACCESS_EMB_SIZE(emb_dark_selection_big));
-    SelectionImages[2].FromPNG(ACCESS_EMB_DATA(emb_dark_selection_small), ACCESS_EMB_SIZE(emb_dark_selection_small));
+    SelectionImages[0].FromRLE(ACCESS_EMB_DATA(emb_dark_selection_big_rle), ACCESS_EMB_SIZE(emb_dark_selection_big_rle));
+    SelectionImages[2].FromRLE(ACCESS_EMB_DATA(emb_dark_selection_small_rle), ACCESS_EMB_SIZE(emb_dark_selection_small_rle));
   }
 
-  SelectionImages[4].FromPNG(ACCESS_EMB_DATA(emb_selection_indicator), ACCESS_EMB_SIZE(emb_selection_indicator));
+  SelectionImages[4].FromRLE(ACCESS_EMB_DATA(emb_selection_indicator_rle), ACCESS_EMB_SIZE(emb_selection_indicator_rle));
 }
 
 void XTheme::ClearScreen() //and restore background and banner
@@ -342,7 +352,7 @@ void XTheme::ClearScreen() //and restore background and banner
   if (!(HideUIFlags & HIDEUI_FLAG_BANNER)) {
     //Banner image prepared before
     if (!Banner.isEmpty()) {
-      FirstBannerPixel = Banner.GetPixel(0,0);
+      FirstBannerPixel = Banner.GetStraightPixel(0,0);
 
       BannerPlace.Width = Banner.GetWidth();
       BannerPlace.Height = (BanHeight >= Banner.GetHeight()) ? Banner.GetHeight() : BanHeight;
@@ -380,6 +390,7 @@ void XTheme::ClearScreen() //and restore background and banner
   float BigScale;
   float BigScaleY;
   if (!BigBack.isEmpty()) {
+    Background.setPremultiplied(BigBack.isPremultiplied()); //all pixels will be copied from BigBack
     switch (BackgroundScale) {
     case imScale:
       BigScale = (float)UGAWidth/BigBack.GetWidth();
@@ -452,43 +463,133 @@ void XTheme::ClearScreen() //and restore background and banner
   if (!Banner.isEmpty()) {
     Background.Compose(BannerPlace.XPos, BannerPlace.YPos, Banner, true);
   }
+  BackgroundGeneration++;
   Background.DrawWithoutCompose(0, 0, UGAWidth, UGAHeight);
 }
 
 
+/*
+ * List ThemeDir and ThemeDir\icons once, so a missing icon costs no file open.
+ * If a listing fails, ThemeFileExists() answers true and the files are opened as before.
+ */
+void XTheme::ListThemeFiles()
+{
+  REFIT_DIR_ITER  DirIter;
+  EFI_FILE_INFO  *DirEntry;
+  EFI_STATUS      Status;
+
+  ThemeFiles.setEmpty();
+  ThemeFilesListed = false;
+  if (ThemeDir == NULL || ThemePackServes(ThemeDir)) { //theme.pack answers without I/O
+    return;
+  }
+  DirIterOpen(ThemeDir, NULL, &DirIter);
+  while (DirIterNext(&DirIter, 2, NULL, &DirEntry)) {
+    ThemeFiles.Add(DirEntry->FileName);
+  }
+  Status = DirIterClose(&DirIter);
+  if (EFI_ERROR(Status)) {
+    return;
+  }
+  DirIterOpen(ThemeDir, L"icons", &DirIter);
+  while (DirIterNext(&DirIter, 2, NULL, &DirEntry)) {
+    ThemeFiles.Add(SWPrintf("icons\\%ls", DirEntry->FileName));
+  }
+  Status = DirIterClose(&DirIter);
+  if (EFI_ERROR(Status) && Status != EFI_NOT_FOUND) { //no icons dir is fine
+    return;
+  }
+  ThemeFilesListed = true;
+  DBG("theme dir listed: %zu files\n", ThemeFiles.size());
+}
+
+bool XTheme::ThemeFileExists(const XStringW& FileName)
+{
+  if (!ThemeFilesListed) {
+    return true;
+  }
+  // only ThemeDir and ThemeDir\icons are listed
+  size_t Slash = FileName.rindexOf('\\');
+  if (Slash != MAX_XSIZE && !(Slash == 5 && FileName.startWithIC("icons\\"))) {
+    return true;
+  }
+  return ThemeFiles.containsIC(FileName);
+}
+
+// same search order as XImage::LoadXImage() but only existing files are opened
+EFI_STATUS XTheme::LoadThemeImage(XImage& Image, const XStringW& IconName)
+{
+  if (IconName.isEmpty()) {
+    return EFI_NOT_FOUND;
+  }
+  const XStringW FileNames[] = { L"icons\\" + IconName + L".icns", L"icons\\" + IconName + L".png", IconName + L".png", IconName };
+  for (size_t i = 0; i < sizeof(FileNames) / sizeof(FileNames[0]); i++) {
+    if (!ThemeFileExists(FileNames[i])) {
+      continue;
+    }
+    UINT8      *FileData = NULL;
+    UINTN       FileDataLength = 0;
+    EFI_STATUS  Status = egLoadFile(ThemeDir, FileNames[i].wc_str(), &FileData, &FileDataLength);
+    if (EFI_ERROR(Status)) {
+      continue;
+    }
+    Status = Image.FromPNG(FileData, FileDataLength);
+    if (EFI_ERROR(Status)) {
+      DBG("%ls not decoded. Status=%s\n", FileNames[i].wc_str(), efiStrError(Status));
+    }
+    FreePool(FileData);
+    return Status;
+  }
+  return EFI_NOT_FOUND;
+}
+
+// load the FillByDir() icon at Index, only the variant of the current Daylight
+void XTheme::ResolveIcon(size_t Index)
+{
+  if (Index >= IconPending.size() || !IconPending[Index]) {
+    return;
+  }
+  IconPending[Index] = false;
+
+  XIcon& Icon = Icons[Index];
+  INTN Id = Icon.Id;
+  EFI_STATUS Status = EFI_NOT_FOUND;
+  switch (Id) {
+    case BUILTIN_SELECTION_SMALL:
+      Status = LoadThemeImage(Icon.Image, SelectionSmallFileName);
+      break;
+    case BUILTIN_SELECTION_BIG:
+      Status = LoadThemeImage(Icon.Image, SelectionBigFileName);
+      break;
+  }
+  if (EFI_ERROR(Status)) {
+    Status = LoadThemeImage(Icon.Image, XStringW().takeValueFrom(IconsNames[Id]));
+  }
+  Icon.Native = !EFI_ERROR(Status);
+  if (!EFI_ERROR(Status)) {
+    Icon.setFilled();
+    if (!Daylight) {
+      LoadThemeImage(Icon.ImageNight, SWPrintf("%s_night", IconsNames[Id]));
+    }
+  } else if (Id >= BUILTIN_ICON_VOL_INTERNAL_HFS && Id <= BUILTIN_ICON_VOL_INTERNAL_REC) {
+    // call to GetIconAlt will get alternate/embedded into Icon if missing
+    GetIconAlt(Id, BUILTIN_ICON_VOL_INTERNAL);
+  } else if (Id == BUILTIN_SELECTION_BIG) {
+    GetIconAlt(Id, BUILTIN_SELECTION_SMALL);
+  }
+}
+
 //use this only for PNG theme
 void XTheme::FillByDir() //assume ThemeDir is defined by InitTheme() procedure
 {
   EFI_STATUS Status;
   Icons.setEmpty();
+  IconPending.setEmpty();
+  ListThemeFiles();
   for (INTN i = 0; i < IconsNamesSize; ++i) { //scan full table
-    Status = EFI_NOT_FOUND;
-    XIcon* NewIcon = new XIcon(i); //initialize without embedded
-    switch (i) {
-      case BUILTIN_SELECTION_SMALL:
-        Status = NewIcon->Image.LoadXImage(ThemeDir, SelectionSmallFileName);
-        break;
-      case BUILTIN_SELECTION_BIG:
-        Status = NewIcon->Image.LoadXImage(ThemeDir, SelectionBigFileName);
-        break;
-    }
-    if (EFI_ERROR(Status)) {
-      Status = NewIcon->Image.LoadXImage(ThemeDir, IconsNames[i]);
-    }
-    NewIcon->Native = !EFI_ERROR(Status);
-    if (!EFI_ERROR(Status)) {
-      NewIcon->setFilled();
-      NewIcon->ImageNight.LoadXImage(ThemeDir, SWPrintf("%s_night", IconsNames[i]));
-    }
+    XIcon* NewIcon = new XIcon(i); //initialize without embedded, loaded by ResolveIcon()
     Icons.AddReference(NewIcon, true);
-    if (EFI_ERROR(Status)) {
-      if (i >= BUILTIN_ICON_VOL_INTERNAL_HFS && i <= BUILTIN_ICON_VOL_INTERNAL_REC) {
-        // call to GetIconAlt will get alternate/embedded into Icon if missing
-        GetIconAlt(i, BUILTIN_ICON_VOL_INTERNAL);
-      } else if (i == BUILTIN_SELECTION_BIG) {
-        GetIconAlt(i, BUILTIN_SELECTION_SMALL);
-      }
-    } 
+    IconPending.Add(true);
   }
   if (BootCampStyle) {
     XIcon *NewIcon = new XIcon(BUILTIN_ICON_SELECTION);
@@ -498,6 +599,7 @@ void XTheme::FillByDir() //assume ThemeDir is defined by InitTheme() procedure
       Status = NewIcon->Image.LoadXImage(ThemeDir, "selection_indicator");
     }
     Icons.AddReference(NewIcon, true);
+    IconPending.Add(false);
   }
 
   SelectionBackgroundPixel.Red      = (SelectionColor >> 24) & 0xFF;
@@ -522,7 +624,7 @@ void XTheme::FillByDir() //assume ThemeDir is defined by InitTheme() procedure
   Status = BigBack.LoadXImage(ThemeDir, BackgroundName);
   if (EFI_ERROR(Status) && !Banner.isEmpty()) {
     //take first pixel from banner
-    const EFI_GRAPHICS_OUTPUT_BLT_PIXEL& firstPixel = Banner.GetPixel(0,0);
+    const EFI_GRAPHICS_OUTPUT_BLT_PIXEL firstPixel = Banner.GetStraightPixel(0,0);
     BigBack.setSizeInPixels(UGAWidth, UGAHeight);
     BigBack.Fill(firstPixel);
   }
@@ -557,31 +659,31 @@ void XTheme::InitBar()
     // fill these from embedded only for non-svg
     // Question: why we don't want these for svg? (upbutton, downbutton, scrollstart, scrollend - also have hardcoded 0 height in REFIT_MENU_SCREEN.cpp)
     if (BarStartImage.isEmpty()) {
-      BarStartImage.FromPNG(ACCESS_EMB_DATA(emb_scroll_bar_start), ACCESS_EMB_SIZE(emb_scroll_bar_start));
+      BarStartImage.FromRLE(ACCESS_EMB_DATA(emb_scroll_bar_start_rle), ACCESS_EMB_SIZE(emb_scroll_bar_start_rle));
     }
     if (BarEndImage.isEmpty()) {
-      BarEndImage.FromPNG(ACCESS_EMB_DATA(emb_scroll_bar_end), ACCESS_EMB_SIZE(emb_scroll_bar_end));
+      BarEndImage.FromRLE(ACCESS_EMB_DATA(emb_scroll_bar_end_rle), ACCESS_EMB_SIZE(emb_scroll_bar_end_rle));
     }
     if (ScrollStartImage.isEmpty()) {
-      ScrollStartImage.FromPNG(ACCESS_EMB_DATA(emb_scroll_scroll_start), ACCESS_EMB_SIZE(emb_scroll_scroll_start));
+      ScrollStartImage.FromRLE(ACCESS_EMB_DATA(emb_scroll_scroll_start_rle), ACCESS_EMB_SIZE(emb_scroll_scroll_start_rle));
     }
     if (ScrollEndImage.isEmpty()) {
-      ScrollEndImage.FromPNG(ACCESS_EMB_DATA(emb_scroll_scroll_end), ACCESS_EMB_SIZE(emb_scroll_scroll_end));
+      ScrollEndImage.FromRLE(ACCESS_EMB_DATA(emb_scroll_scroll_end_rle), ACCESS_EMB_SIZE(emb_scroll_scroll_end_rle));
     }
     if (UpButtonImage.isEmpty()) {
-      UpButtonImage.FromPNG(ACCESS_EMB_DATA(emb_scroll_up_button), ACCESS_EMB_SIZE(emb_scroll_up_button));
+      UpButtonImage.FromRLE(ACCESS_EMB_DATA(emb_scroll_up_button_rle), ACCESS_EMB_SIZE(emb_scroll_up_button_rle));
     }
    if (DownButtonImage.isEmpty()) {
-      DownButtonImage.FromPNG(ACCESS_EMB_DATA(emb_scroll_down_button), ACCESS_EMB_SIZE(emb_scroll_down_button));
+      DownButtonImage.FromRLE(ACCESS_EMB_DATA(emb_scroll_down_button_rle), ACCESS_EMB_SIZE(emb_scroll_down_button_rle));
     }
   }
 
   // fill these from embedded for both svg and non-svg
   if (ScrollbarBackgroundImage.isEmpty()) {
-    ScrollbarBackgroundImage.FromPNG(ACCESS_EMB_DATA(emb_scroll_bar_fill), ACCESS_EMB_SIZE(emb_scroll_bar_fill));
+    ScrollbarBackgroundImage.FromRLE(ACCESS_EMB_DATA(emb_scroll_bar_fill_rle), ACCESS_EMB_SIZE(emb_scroll_bar_fill_rle));
   }
   if (ScrollbarImage.isEmpty()) {
-    ScrollbarImage.FromPNG(ACCESS_EMB_DATA(emb_scroll_scroll_fill), ACCESS_EMB_SIZE(emb_scroll_scroll_fill));
+    ScrollbarImage.FromRLE(ACCESS_EMB_DATA(emb_scroll_scroll_fill_rle), ACCESS_EMB_SIZE(emb_scroll_scroll_fill_rle));
   }
 
 }
@@ -3,12 +3,14 @@
 
 #include "../cpp_foundation/XObjArray.h"
 #include "../cpp_foundation/XString.h"
+#include "../cpp_foundation/XStringArray.h"
 #include "libeg.h"
 //#include "nanosvg.h"
 #include "XImage.h"
 #include "XIcon.h"
 #include "XCinema.h"
 #include "Self.h"
+#include "ThemePack.h"
 
 class TagDict;
 
@@ -28,10 +30,12 @@ public:
   void openThemeDir() {
     if ( ThemeDir != NULL ) ThemeDir->Close(ThemeDir);
     /*Status = */self.getCloverDir().Open(&self.getCloverDir(), &ThemeDir, m_ThemePath.wc_str(), EFI_FILE_MODE_READ, 0);
+    ThemePackSetDir(ThemeDir);
   }
   void closeThemeDir() {
     if ( ThemeDir != NULL ) ThemeDir->Close(ThemeDir);
     ThemeDir = NULL;
+    ThemePackSetDir(NULL);
   }
 //  const XStringW& getThemePath() { return m_ThemePath; }
 //  void setThemePath(const XStringW& aThemePath) {
@@ -120,6 +124,7 @@ public:
   BOOLEAN     Daylight;
 
   XImage  Background; //Background and Banner will not be in array as they live own life
+  UINTN   BackgroundGeneration; //changes each time Background is rebuilt, images composed on it are stale then
   XImage  BigBack; //it size is not equal to screen size will be scaled or cropped
   XImage  Banner; //same as logo in the array, make a link?
   XImage  SelectionImages[6];
@@ -134,6 +139,8 @@ public:
   XImage  DownButtonImage;
 
   XImage  FontImage;
+  INTN    GlyphRightSpace[256]; //empty columns at the right of each char of FontImage, for proportional fonts
+  INTN    GlyphMetricsWidth;    //FontWidth the table was built for, 0 = not built
 
   EG_RECT  BannerPlace;
 
@@ -165,6 +172,7 @@ public:
   void LoadFontImage(IN BOOLEAN UseEmbedded, IN INTN Rows, IN INTN Cols);
   void PrepareFont();
   INTN GetEmpty(const XImage& Buffer, const EFI_GRAPHICS_OUTPUT_BLT_PIXEL& FirstPixel, INTN MaxWidth, INTN Start, INTN Step);
+  void PrepareGlyphMetrics();
   INTN RenderText(IN const XStringW& Text, OUT XImage* CompImage_ptr,
                     IN INTN PosX, IN INTN PosY, IN UINTN Cursor, INTN textType, float textScale = 0.f);
   //overload for UTF8 text
@@ -178,7 +186,7 @@ public:
   void FillByDir();
   EFI_STATUS GetThemeTagSettings(const TagDict* DictPointer);
   void parseTheme(void* p, const char** dict); //in nano project
-  EFI_STATUS ParseSVGXTheme(const CHAR8* buffer); // in VectorTheme
+  EFI_STATUS ParseSVGXTheme(const CHAR8* buffer, UINTN Size); // in VectorTheme
   EFI_STATUS ParseSVGXIcon(INTN Id, const XString8& IconNameX, XImage* Image, void **SVGIcon);
   TagDict* LoadTheme(const XStringW& TestTheme); //return TagStruct* why?
   EFI_STATUS LoadSvgFrame(INTN i, OUT XImage* XFrame); // for animation
@@ -192,5 +200,15 @@ public:
 protected:
   //internal layout variables instead of globals in menu.cpp
 
+  //FillByDir() icons are loaded at first GetIconAlt()/CheckNative()
+  XArray<bool>  IconPending;   //indexed like Icons
+  XStringWArray ThemeFiles;    //files of ThemeDir and ThemeDir\icons, listed once by FillByDir()
+  bool          ThemeFilesListed = false;
+
+  void ListThemeFiles();
+  bool ThemeFileExists(const XStringW& FileName);
+  EFI_STATUS LoadThemeImage(XImage& Image, const XStringW& IconName);
+  void ResolveIcon(size_t Index);
+
 };
 #endif
@@ -0,0 +1,50 @@
+// Generated by mkegemb_rle.py, do not edit
+
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_pointer_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_func_about_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_func_clover_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_func_options_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_func_reset_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_func_secureboot_config_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_func_secureboot_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_func_shell_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_func_exit_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_func_help_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_logo_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_selection_big_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_selection_small_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_vol_internal_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_vol_internal_booter_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_vol_internal_hfs_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_vol_internal_apfs_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_vol_internal_ntfs_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_vol_internal_ext_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_vol_internal_recovery_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_vol_external_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_vol_optical_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_dark_func_about_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_dark_func_clover_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_dark_func_options_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_dark_func_reset_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_dark_func_secureboot_config_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_dark_func_secureboot_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_dark_func_shell_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_dark_func_exit_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_dark_func_help_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_dark_logo_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_dark_selection_big_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_dark_selection_small_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_scroll_up_button_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_scroll_bar_start_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_scroll_scroll_start_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_scroll_scroll_fill_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_scroll_scroll_end_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_scroll_bar_fill_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_scroll_bar_end_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_scroll_down_button_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_radio_button_selected_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_radio_button_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_selection_indicator_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_checkbox_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_checkbox_checked_rle)
+DECLARE_EMB_EXTERN_WITH_SIZE(emb_font_data_rle)
@@ -36,6 +36,8 @@
 
 #include "libegint.h"
 #include "lodepng.h"
+#include "../Platform/PerfCounters.h"
+#include "ThemePack.h"
 
 #define MAX_FILE_SIZE (1024*1024*1024)
 
@@ -67,6 +69,9 @@ EFI_STATUS egLoadFile(const EFI_FILE* BaseDir, IN CONST CHAR16 *FileName,
   if (!BaseDir) {
     goto Error;
   }
+  if (ThemePackServes(BaseDir)) {
+    return ThemePackLoadFile(FileName, FileData, FileDataLength);
+  }
 
   Status = BaseDir->Open(BaseDir, &FileHandle, (CHAR16*)FileName, EFI_FILE_MODE_READ, 0); // const missing const EFI_FILE*->Open
   if (EFI_ERROR(Status) || !FileHandle) {
@@ -97,6 +102,8 @@ EFI_STATUS egLoadFile(const EFI_FILE* BaseDir, IN CONST CHAR16 *FileName,
     FreePool(Buffer);
     goto Error;
   }
+  gPerfCounters.FileOpens++;
+  gPerfCounters.FileBytesRead += BufferSize;
 
   if(FileData) {
     *FileData = Buffer;
@@ -42,6 +42,8 @@
 #include "../cpp_foundation/XString.h"
 #include "../cpp_foundation/XStringArray.h"
 #include "../cpp_foundation/XBuffer.h"
+#include "../cpp_foundation/XVector.h"
+#include "../Platform/MacOsVersion.h"
 
 extern "C" {
 #include <Library/OcConfigurationLib.h>
@@ -100,6 +102,7 @@ typedef struct {
   INTN    MaxScroll, MaxIndex;
   INTN    FirstVisible, LastVisible, MaxVisible, MaxFirstVisible;
   BOOLEAN IsScrolling, PaintAll, PaintSelection;
+  INTN    ScrolledRows; // FirstVisible change of a one line scroll, the other rows on screen can be moved
 } SCROLL_STATE;
 
 typedef enum {
@@ -165,6 +168,7 @@ public:
   EFI_HANDLE          DeviceHandle;
   EFI_FILE            *RootDir;
   XStringW            DevicePathString;
+  UINT32              DevicePathHash = 0; // BootVolumeDevicePathHash(DevicePath)
   XStringW            VolName; // comes from EfiLibFileSystemInfo, EfiLibFileSystemVolumeLabelInfo, "EFI" if gEfiPartTypeSystemPartGuid or "Unknown HD"
   XStringW            VolLabel; // comes from \\.VolumeLabel.txt, or empty.
   UINT8               DiskKind;
@@ -182,6 +186,7 @@ public:
   EFI_HANDLE          WholeDiskDeviceHandle;
   MBR_PARTITION_INFO  *MbrPartitionTable;
   UINT32              DriveCRC32;
+  UINT8               *BootSector = NULL; // first 512 bytes as read by ScanVolumeBootcode() for BOOTING_BY_PBR, reused by bootPBR()
   EFI_GUID            RootUUID; //for recovery it is UUID of parent partition
   UINT64              SleepImageOffset;
   XStringW            osxVolumeName = NullXStringW; // comes from \\System\\Library\\CoreServices\\.disk_label.contentDetails, or empty.
@@ -189,6 +194,8 @@ public:
   XString8            ApfsContainerUUID = NullXString8;
   APPLE_APFS_VOLUME_ROLE  ApfsRole = 0;
   XString8Array        ApfsTargetUUIDArray; // this is the array of folders that are named as UUID
+  BOOLEAN             BootcodeCached = FALSE; // bootcode fields come from the volume cache and weren't read this boot
+  BOOLEAN             MenuScanned = FALSE; // its entries are in the main menu, RescanVolumes() keeps them
 
   REFIT_VOLUME() : DevicePath(0), DeviceHandle(0), RootDir(0), DevicePathString(), VolName(), VolLabel(), DiskKind(0), LegacyOS(0), Hidden(0), BootType(0), IsAppleLegacy(0), HasBootCode(0),
                    IsMbrPartition(0), MbrPartitionIndex(0), BlockIO(0), BlockIOOffset(0), WholeDiskBlockIO(0), WholeDiskDevicePath(0), WholeDiskDeviceHandle(0),
@@ -222,6 +229,7 @@ public:
   INTN             Count;
   INTN             Skip;
   XString8         MatchOS;
+  MacOsVersionPatternList MatchOSPatterns; // MatchOS parsed by FillinKextPatches()
   XString8         MatchBuild;
 //  CHAR8       *Name;
 //  CHAR8       *Label;
@@ -246,10 +254,12 @@ public:
 //                   StartPattern(0), StartMask(0), StartPatternLen(0), SearchLen(0), ProcedureName(0), Count(-1), MatchOS(0), MatchBuild(0), MenuItem()
 //                 { }
   KEXT_PATCH() : Name(), Label(), IsPlistPatch(0), Data(), Patch(), MaskFind(), MaskReplace(),
-                   StartPattern(), StartMask(), SearchLen(0), ProcedureName(), Count(-1), Skip(0), MatchOS(), MatchBuild(), MenuItem()
+                   StartPattern(), StartMask(), SearchLen(0), ProcedureName(), Count(-1), Skip(0), MatchOS(), MatchOSPatterns(), MatchBuild(), MenuItem()
                  { }
   KEXT_PATCH(const KEXT_PATCH& other) = default; // default is fine if there is only native type and objects that have copy ctor
+  KEXT_PATCH(KEXT_PATCH&& other) = default; // XVector moves the patches when it grows
   KEXT_PATCH& operator = ( const KEXT_PATCH & ) = default; // default is fine if there is only native type and objects that have copy ctor
+  KEXT_PATCH& operator = ( KEXT_PATCH && ) = default;
   ~KEXT_PATCH() {}
 };
 
@@ -295,7 +305,8 @@ public:
   BOOLEAN KPDELLSMBIOS;  // Dell SMBIOS patch
   BOOLEAN KPPanicNoKextDump;
   BOOLEAN EightApple;
-  UINT8   pad[7];
+  BOOLEAN KPParallel;    // kext patches are applied on all the processors
+  UINT8   pad[6];
   UINT32  FakeCPUID;
   //  UINT32  align0;
   XString8 KPATIConnectorsController;
@@ -318,7 +329,7 @@ public:
 
 //  INT32   NrKexts;
   UINT32  align40;
-  XObjArray<KEXT_PATCH> KextPatches;
+  XVector<KEXT_PATCH> KextPatches; // by value, the patch loops scan packed memory
 #if defined(MDE_CPU_IA32)
   UINT32  align5;
 #endif
@@ -331,12 +342,12 @@ public:
   UINT32 align6;
 #endif
 //  INT32   NrKernels;
-  XObjArray<KEXT_PATCH> KernelPatches;
+  XVector<KEXT_PATCH> KernelPatches;
 //  INT32   NrBoots;
-  XObjArray<KEXT_PATCH> BootPatches;
+  XVector<KEXT_PATCH> BootPatches;
 
   KERNEL_AND_KEXT_PATCHES() : FuzzyMatch(0), OcKernelCache(), OcKernelQuirks{0}, KPDebug(0), KPKernelLapic(0), KPKernelXCPM(0), KPKernelPm(0), KPAppleIntelCPUPM(0), KPAppleRTC(0), KPDELLSMBIOS(0), KPPanicNoKextDump(0),
-                   EightApple(0), pad{0}, FakeCPUID(0), KPATIConnectorsController(0), KPATIConnectorsData(),
+                   EightApple(0), KPParallel(0), pad{0}, FakeCPUID(0), KPATIConnectorsController(0), KPATIConnectorsData(),
                    KPATIConnectorsPatch(), align40(0), KextPatches(), align50(0), ForceKexts(),
                    KernelPatches(), BootPatches()
                  { }
@@ -420,6 +431,7 @@ typedef struct EG_RECT {
 /* functions */
 
 void    egInitScreen(IN BOOLEAN SetMaxResolution);
+void    egRestoreFramebufferCaching(void);
 void    egDumpGOPVideoModes(void);
 //EFI_STATUS egSetScreenResolution(IN CHAR16 *WidthHeight); 
 //EFI_STATUS egSetMaxResolution(void);
@@ -444,6 +456,14 @@ EFI_STATUS egFindESP(OUT EFI_FILE** RootDir);
 
 void egClearScreen(IN const void *Color);
 
+// RAM copy of the screen, used by XImage::GetArea and XImage::DrawWithoutCompose
+void egScreenBufferInvalidate(void);
+BOOLEAN egScreenBufferGetArea(INTN x, INTN y, UINTN Width, UINTN Height, EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Dst);
+void egScreenBufferDraw(const EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Src, UINTN SrcWidth, INTN x, INTN y, UINTN Width, UINTN Height);
+void egScreenMoveRect(INTN x, INTN y, UINTN Width, UINTN Height, INTN DstX, INTN DstY);
+void egScreenBeginFrame(void);
+void egScreenEndFrame(void);
+
 EFI_STATUS egScreenShot(void);
 
 
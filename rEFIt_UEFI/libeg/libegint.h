@@ -147,6 +147,9 @@ DECLARE_EMB_EXTERN_WITH_SIZE(emb_dark_checkbox)
 DECLARE_EMB_EXTERN_WITH_SIZE(emb_dark_checkbox_checked)
 */
 
+// the same assets already decoded, for XImage::FromRLE()
+#include "egemb_icons_rle.h"
+
 /* types */
 
 
@@ -39,6 +39,13 @@
 #include "lodepng.h"
 #include "../Platform/Settings.h"
 #include "Self.h"
+#include "../Platform/PerfCounters.h"
+#include "../Platform/Nvram.h"
+
+extern "C" {
+#include <Library/DxeServicesTableLib.h>
+#include <Library/MtrrLib.h>
+}
 
 
 // Console defines and variables
@@ -56,12 +63,20 @@ static BOOLEAN egHasGraphics = FALSE;
 static UINTN egScreenWidth  = 0; //1024;
 static UINTN egScreenHeight = 0; //768;
 
+// Copy of the screen in RAM: GetArea() reads it instead of the video memory, which is slow to read on
+// some firmwares. Inside a frame, draws are only copied here and the dirty rects blitted at the end
+static XImage ScreenBuffer;
+static BOOLEAN ScreenBufferValid = FALSE;
+static XArray<EG_RECT> ScreenDirty;
+static INTN ScreenFrameLevel = 0;
+
 static BOOLEAN IgnoreConsoleSetMode = FALSE;
 static EFI_CONSOLE_CONTROL_SCREEN_MODE CurrentForcedConsoleMode = EfiConsoleControlScreenText;
 static EFI_CONSOLE_CONTROL_PROTOCOL_GET_MODE ConsoleControlGetMode = NULL;
 static EFI_CONSOLE_CONTROL_PROTOCOL_SET_MODE ConsoleControlSetMode = NULL;
 
 static EFI_STATUS GopSetModeAndReconnectTextOut(IN UINT32 ModeNumber);
+static void egFramebufferWriteCombine(void);
 
 //
 // Wrapped ConsoleControl GetMode() implementation - for blocking resolution switch when changing modes
@@ -93,6 +108,72 @@ egConsoleControlSetMode(IN EFI_CONSOLE_CONTROL_PROTOCOL *This, IN EFI_CONSOLE_CO
     return ConsoleControlSetMode(This, Mode);
 }
 
+//
+// Best GOP mode found at a previous boot, variable GOP_MODE_VARIABLE of gEfiAppleBootGuid.
+// Valid for the same display (CRC32 of its EDID) and the same GOP mode count.
+//
+#define GOP_MODE_VARIABLE  L"CloverGopMode"
+
+typedef struct {
+  UINT32  EdidCrc;
+  UINT32  MaxMode;
+  UINT32  Mode;
+  UINT32  Width;
+  UINT32  Height;
+} GOP_MODE_CACHE;
+
+// FALSE without an EDID : another display could be plugged without us knowing
+static BOOLEAN GopModeCacheKey(OUT GOP_MODE_CACHE *Key)
+{
+  EFI_STATUS                      Status;
+  EFI_EDID_ACTIVE_PROTOCOL        *EdidActive;
+  EFI_EDID_DISCOVERED_PROTOCOL    *EdidDiscovered;
+  UINT8                           *Edid = NULL;
+  UINT32                          EdidSize = 0;
+
+  ZeroMem(Key, sizeof(*Key));
+  Status = gBS->LocateProtocol(&gEfiEdidActiveProtocolGuid, NULL, (void**)&EdidActive);
+  if (!EFI_ERROR(Status) && EdidActive->SizeOfEdid > 0) {
+    Edid = EdidActive->Edid;
+    EdidSize = EdidActive->SizeOfEdid;
+  } else {
+    Status = gBS->LocateProtocol(&gEfiEdidDiscoveredProtocolGuid, NULL, (void**)&EdidDiscovered);
+    if (!EFI_ERROR(Status) && EdidDiscovered->SizeOfEdid > 0) {
+      Edid = EdidDiscovered->Edid;
+      EdidSize = EdidDiscovered->SizeOfEdid;
+    }
+  }
+  if (Edid == NULL || EFI_ERROR(gBS->CalculateCrc32(Edid, EdidSize, &Key->EdidCrc))) {
+    return FALSE;
+  }
+  Key->MaxMode = GraphicsOutput->Mode->MaxMode;
+  return TRUE;
+}
+
+// The cached mode if it is for this key and a QueryMode still gives its resolution
+static BOOLEAN GopModeCacheFind(IN OUT GOP_MODE_CACHE *Key)
+{
+  GOP_MODE_CACHE                        Cache;
+  UINTN                                 Size = sizeof(Cache);
+  UINTN                                 SizeOfInfo = 0;
+  EFI_GRAPHICS_OUTPUT_MODE_INFORMATION  *Info = NULL;
+  BOOLEAN                               Found;
+
+  if (EFI_ERROR(NvramGetVariable(GOP_MODE_VARIABLE, &gEfiAppleBootGuid, NULL, &Size, &Cache)) || Size != sizeof(Cache) ||
+      Cache.EdidCrc != Key->EdidCrc || Cache.MaxMode != Key->MaxMode || Cache.Mode >= Key->MaxMode) {
+    return FALSE;
+  }
+  if (EFI_ERROR(GraphicsOutput->QueryMode(GraphicsOutput, Cache.Mode, &SizeOfInfo, &Info))) {
+    return FALSE;
+  }
+  Found = Info->HorizontalResolution == Cache.Width && Info->VerticalResolution == Cache.Height;
+  FreePool(Info);
+  if (Found) {
+    *Key = Cache;
+  }
+  return Found;
+}
+
 //
 // Screen handling
 //
@@ -215,6 +296,9 @@ EFI_STATUS egSetMaxResolution()
   UINT32      Mode;
   UINTN       SizeOfInfo = 0;
   EFI_GRAPHICS_OUTPUT_MODE_INFORMATION *Info = NULL;
+  GOP_MODE_CACHE Key;
+  BOOLEAN     HasKey = FALSE;
+  BOOLEAN     Cached = FALSE;
   
   if (GraphicsOutput == NULL) {
     return EFI_UNSUPPORTED;
@@ -222,7 +306,17 @@ EFI_STATUS egSetMaxResolution()
 
   MsgLog("SetMaxResolution: ");
   MaxMode = GraphicsOutput->Mode->MaxMode;
-  for (Mode = 0; Mode < MaxMode; Mode++) {
+  if (GlobalConfig.GopModeCache) {
+    // some firmwares read the EDID again at each QueryMode, one call instead of MaxMode
+    HasKey = GopModeCacheKey(&Key);
+    if (HasKey && GopModeCacheFind(&Key)) {
+      BestMode = Key.Mode;
+      Width = Key.Width;
+      Height = Key.Height;
+      Cached = TRUE;
+    }
+  }
+  for (Mode = 0; Mode < MaxMode && !Cached; Mode++) {
     Status = GraphicsOutput->QueryMode(GraphicsOutput, Mode, &SizeOfInfo, &Info);
     if (Status == EFI_SUCCESS) {
       if (Width > Info->HorizontalResolution) {
@@ -236,7 +330,7 @@ EFI_STATUS egSetMaxResolution()
       BestMode = Mode;
     }
   }
-  MsgLog("found best mode %d: %dx%d\n", BestMode, Width, Height);
+  MsgLog("found best mode %d: %dx%d%s\n", BestMode, Width, Height, Cached ? " (cached)" : "");
   // check if requested mode is equal to current mode
   if (BestMode == GraphicsOutput->Mode->Mode) {
     MsgLog(" - already set\n");
@@ -251,12 +345,27 @@ EFI_STATUS egSetMaxResolution()
       egScreenHeight = Height;
       MsgLog(" - set\n");
     } else {
+      if (Cached) {
+        DeleteNvramVariable(GOP_MODE_VARIABLE, &gEfiAppleBootGuid);
+        Cached = FALSE;
+      }
       // we can not set BestMode - search for first one that we can
       MsgLog(" - %s\n", efiStrError(Status));
       Status = egSetMode(1);
     }
   }
 
+  if (HasKey && !Cached && Status == EFI_SUCCESS && Width != 0 && GraphicsOutput->Mode->Mode == BestMode) {
+    Key.Mode = BestMode;
+    Key.Width = Width;
+    Key.Height = Height;
+    Status = SetNvramVariable(GOP_MODE_VARIABLE, &gEfiAppleBootGuid,
+                              EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS,
+                              sizeof(Key), &Key);
+    MsgLog("GOP mode cache: %s\n", efiStrError(Status));
+    Status = EFI_SUCCESS;
+  }
+
   return Status;
 }
 
@@ -355,6 +464,85 @@ EFI_STATUS egSetScreenResolution(IN const CHAR16 *WidthHeight)
     return EFI_UNSUPPORTED;
 }
 
+//
+// FramebufferWriteCombine : the GOP framebuffer is made write-combining for the Clover session, blits
+// to an uncached framebuffer (DUET BiosVideo, some firmwares) go at the speed of single bus writes.
+// Through GCD when the CPU driver programs the MTRRs itself, else through MtrrLib; what was
+// there before is put back by egRestoreFramebufferCaching() before anything is handed the machine.
+//
+static EFI_PHYSICAL_ADDRESS FramebufferWcBase = 0;
+static UINT64               FramebufferWcLength = 0;
+static UINT64               FramebufferWcAttributes = 0;  // GCD attributes before, when set through GCD
+static BOOLEAN              FramebufferWcByMtrr = FALSE;
+static MTRR_SETTINGS        FramebufferSavedMtrrs;
+
+static void egFramebufferWriteCombine(void)
+{
+    EFI_STATUS                      Status;
+    EFI_PHYSICAL_ADDRESS            Base;
+    UINT64                          Length;
+    EFI_GCD_MEMORY_SPACE_DESCRIPTOR Descriptor;
+
+    if (!GlobalConfig.FramebufferWriteCombine || GraphicsOutput == NULL ||
+        GraphicsOutput->Mode->FrameBufferBase == 0 || GraphicsOutput->Mode->FrameBufferSize == 0) {
+        return;
+    }
+    Base = GraphicsOutput->Mode->FrameBufferBase & ~(UINT64)EFI_PAGE_MASK;
+    Length = ALIGN_VALUE(GraphicsOutput->Mode->FrameBufferBase + GraphicsOutput->Mode->FrameBufferSize, EFI_PAGE_SIZE) - Base;
+    if (FramebufferWcLength != 0) {
+        if (Base == FramebufferWcBase && Length == FramebufferWcLength) {
+            return;
+        }
+        // new mode, new framebuffer
+        egRestoreFramebufferCaching();
+    }
+
+    if (gDS != NULL && !EFI_ERROR(gDS->GetMemorySpaceDescriptor(Base, &Descriptor)) &&
+        Descriptor.BaseAddress + Descriptor.Length >= Base + Length &&
+        (Descriptor.Capabilities & EFI_MEMORY_WC) != 0) {
+        Status = gDS->SetMemorySpaceAttributes(Base, Length, (Descriptor.Attributes & ~EFI_MEMORY_CACHETYPE_MASK) | EFI_MEMORY_WC);
+        if (!EFI_ERROR(Status)) {
+            FramebufferWcBase = Base;
+            FramebufferWcLength = Length;
+            FramebufferWcAttributes = Descriptor.Attributes;
+            FramebufferWcByMtrr = FALSE;
+            MsgLog("Framebuffer 0x%llX-0x%llX write-combining\n", Base, Base + Length - 1);
+            return;
+        }
+    }
+
+    // CloverEFI CpuDxe doesn't program MTRRs for GCD
+    if (!IsMtrrSupported()) {
+        MsgLog("Framebuffer write-combining: no MTRR\n");
+        return;
+    }
+    MtrrGetAllMtrrs(&FramebufferSavedMtrrs);
+    Status = (EFI_STATUS)MtrrSetMemoryAttribute(Base, Length, CacheWriteCombining);
+    if (EFI_ERROR(Status)) {
+        MsgLog("Framebuffer write-combining: %s\n", efiStrError(Status));
+        MtrrSetAllMtrrs(&FramebufferSavedMtrrs);
+        return;
+    }
+    FramebufferWcBase = Base;
+    FramebufferWcLength = Length;
+    FramebufferWcByMtrr = TRUE;
+    MsgLog("Framebuffer 0x%llX-0x%llX write-combining by MTRR\n", Base, Base + Length - 1);
+}
+
+void egRestoreFramebufferCaching(void)
+{
+    if (FramebufferWcLength == 0) {
+        return;
+    }
+    if (FramebufferWcByMtrr) {
+        MtrrSetAllMtrrs(&FramebufferSavedMtrrs);
+    } else {
+        gDS->SetMemorySpaceAttributes(FramebufferWcBase, FramebufferWcLength, FramebufferWcAttributes);
+    }
+    FramebufferWcBase = 0;
+    FramebufferWcLength = 0;
+}
+
 void egInitScreen(IN BOOLEAN SetMaxResolution)
 {
     EFI_STATUS Status;
@@ -387,6 +575,7 @@ void egInitScreen(IN BOOLEAN SetMaxResolution)
       XStringW Resolution = SWPrintf("%llux%llu", egScreenWidth, egScreenHeight);
       Status = egSetScreenResolution(Resolution.wc_str());
       if (!EFI_ERROR(Status)) {
+        egFramebufferWriteCombine();
         return;
       }
     }
@@ -411,6 +600,7 @@ void egInitScreen(IN BOOLEAN SetMaxResolution)
         egScreenWidth = GraphicsOutput->Mode->Info->HorizontalResolution;
         egScreenHeight = GraphicsOutput->Mode->Info->VerticalResolution;
         egHasGraphics = TRUE;
+        egFramebufferWriteCombine();
     } 
     //is there anybody ever see UGA protocol???
     else if (UgaDraw != NULL) {
@@ -471,6 +661,9 @@ void egSetGraphicsModeEnabled(IN BOOLEAN Enable)
     EFI_CONSOLE_CONTROL_SCREEN_MODE CurrentMode;
     EFI_CONSOLE_CONTROL_SCREEN_MODE NewMode;
 
+    // text may be written over the graphics from now on
+    egScreenBufferInvalidate();
+
     if (ConsoleControl != NULL) {   
         // Some UEFI bioses may cause resolution switch when switching to Text Mode via the ConsoleControl->SetMode command
         // EFI applications wishing to use text, call the ConsoleControl->GetMode() command, and depending on its result may call ConsoleControl->SetMode().
@@ -514,6 +707,11 @@ void egClearScreen(IN const void *Color)
   if (!egHasGraphics)
     return;
 
+  ScreenBuffer.setSizeInPixels(egScreenWidth, egScreenHeight);
+  ScreenBuffer.Fill(FillColor);
+  ScreenBufferValid = TRUE;
+  ScreenDirty.setEmpty(); // everything is overwritten by the fill
+
   if (GraphicsOutput != NULL) {
     // EFI_GRAPHICS_OUTPUT_BLT_PIXEL and EFI_UGA_PIXEL have the same
     // layout, and the header from TianoCore actually defines them
@@ -524,11 +722,199 @@ void egClearScreen(IN const void *Color)
     UgaDraw->Blt(UgaDraw, (EFI_UGA_PIXEL*)&FillColor, EfiUgaVideoFill,
                  0, 0, 0, 0, egScreenWidth, egScreenHeight, 0);
   }
+  gPerfCounters.BltCalls++;
+  gPerfCounters.BltPixels += (UINT64)egScreenWidth * egScreenHeight;
+}
+
+static void egBltToVideo(const EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Src, UINTN SrcX, UINTN SrcY, UINTN DstX, UINTN DstY, UINTN Width, UINTN Height, UINTN SrcWidth)
+{
+  if (Width == 0 || Height == 0) {
+    return;
+  }
+  if (GraphicsOutput != NULL) {
+    GraphicsOutput->Blt(GraphicsOutput, (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *)Src, EfiBltBufferToVideo,
+                        SrcX, SrcY, DstX, DstY, Width, Height, SrcWidth * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+  } else if (UgaDraw != NULL) {
+    UgaDraw->Blt(UgaDraw, (EFI_UGA_PIXEL *)Src, EfiUgaBltBufferToVideo,
+                 SrcX, SrcY, DstX, DstY, Width, Height, SrcWidth * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+  }
+  gPerfCounters.BltCalls++;
+  gPerfCounters.BltPixels += (UINT64)Width * Height;
+}
+
+static void egScreenBufferFlush(void)
+{
+  // coalesce the rects that overlap or touch, then one blit per rect
+  for (size_t i = 0; i < ScreenDirty.size(); ) {
+    BOOLEAN Merged = FALSE;
+    for (size_t j = i + 1; j < ScreenDirty.size() && !Merged; j++) {
+      EG_RECT& A = ScreenDirty[i];
+      const EG_RECT& B = ScreenDirty[j];
+      if (A.XPos <= B.XPos + B.Width && B.XPos <= A.XPos + A.Width &&
+          A.YPos <= B.YPos + B.Height && B.YPos <= A.YPos + A.Height) {
+        INTN Right = MAX(A.XPos + A.Width, B.XPos + B.Width);
+        INTN Bottom = MAX(A.YPos + A.Height, B.YPos + B.Height);
+        A.XPos = MIN(A.XPos, B.XPos);
+        A.YPos = MIN(A.YPos, B.YPos);
+        A.Width = Right - A.XPos;
+        A.Height = Bottom - A.YPos;
+        ScreenDirty.RemoveAtIndex(j);
+        Merged = TRUE;
+      }
+    }
+    if (!Merged) {
+      i++; // nothing merged into this one, go to the next
+    }
+  }
+  for (size_t i = 0; i < ScreenDirty.size(); i++) {
+    const EG_RECT& Rect = ScreenDirty[i];
+    egBltToVideo(ScreenBuffer.GetPixelPtr(0, 0), Rect.XPos, Rect.YPos, Rect.XPos, Rect.YPos, Rect.Width, Rect.Height, egScreenWidth);
+  }
+  ScreenDirty.setEmpty();
+}
+
+//
+// Something else than XImage may have drawn, or the resolution changed
+//
+void egScreenBufferInvalidate(void)
+{
+  if (ScreenBufferValid) {
+    egScreenBufferFlush();
+  }
+  ScreenBufferValid = FALSE;
+}
+
+//
+// Get a screen area from the RAM copy. Returns FALSE if there is no valid copy, then the video memory must be read
+//
+BOOLEAN egScreenBufferGetArea(INTN x, INTN y, UINTN Width, UINTN Height, EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Dst)
+{
+  if (!ScreenBufferValid || (UINTN)ScreenBuffer.GetWidth() != egScreenWidth || (UINTN)ScreenBuffer.GetHeight() != egScreenHeight) {
+    return FALSE;
+  }
+  if (x < 0 || y < 0 || x + Width > egScreenWidth || y + Height > egScreenHeight) {
+    return FALSE;
+  }
+  for (UINTN j = 0; j < Height; j++) {
+    CopyMem(Dst + j * Width, ScreenBuffer.GetPixelPtr(x, y + j), Width * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+  }
+  return TRUE;
+}
+
+//
+// Draw Width x Height pixels of Src (SrcWidth pixels per row) at x,y.
+// With a valid RAM copy, it is updated, and the video memory too but only at the end of the frame if we are in one
+//
+void egScreenBufferDraw(const EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Src, UINTN SrcWidth, INTN x, INTN y, UINTN Width, UINTN Height)
+{
+  if (!egHasGraphics || x < 0 || y < 0 || (UINTN)x >= egScreenWidth || (UINTN)y >= egScreenHeight) {
+    return;
+  }
+  Width = MIN(Width, egScreenWidth - x);
+  Height = MIN(Height, egScreenHeight - y);
+  if (Width == 0 || Height == 0) {
+    return;
+  }
+  if ((UINTN)ScreenBuffer.GetWidth() != egScreenWidth || (UINTN)ScreenBuffer.GetHeight() != egScreenHeight) {
+    ScreenBufferValid = FALSE;
+  }
+  if (!ScreenBufferValid) {
+    if (x != 0 || y != 0 || Width != egScreenWidth || Height != egScreenHeight) {
+      egBltToVideo(Src, 0, 0, x, y, Width, Height, SrcWidth); // we don't know the rest of the screen yet
+      return;
+    }
+    // a full screen draw gives the RAM copy
+    ScreenBuffer.setSizeInPixels(egScreenWidth, egScreenHeight);
+    ScreenBufferValid = TRUE;
+    ScreenDirty.setEmpty();
+  }
+  for (UINTN j = 0; j < Height; j++) {
+    CopyMem(ScreenBuffer.GetPixelPtr(x, y + j), Src + j * SrcWidth, Width * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+  }
+  if (ScreenFrameLevel > 0) {
+    ScreenDirty.Add(EG_RECT(x, y, Width, Height));
+  } else {
+    egBltToVideo(ScreenBuffer.GetPixelPtr(0, 0), x, y, x, y, Width, Height, egScreenWidth);
+  }
+}
+
+//
+// Move a screen area by a video to video blit, for a scroll. The RAM copy is moved too.
+// Pending draws of the frame are blitted first, they may be in the moved area.
+//
+void egScreenMoveRect(INTN x, INTN y, UINTN Width, UINTN Height, INTN DstX, INTN DstY)
+{
+  if (!egHasGraphics || x < 0 || y < 0 || DstX < 0 || DstY < 0 || Width == 0 || Height == 0 ||
+      (UINTN)MAX(x, DstX) + Width > egScreenWidth || (UINTN)MAX(y, DstY) + Height > egScreenHeight) {
+    return;
+  }
+  if (ScreenBufferValid) {
+    egScreenBufferFlush();
+    if (DstY <= y) {
+      for (UINTN j = 0; j < Height; j++) {
+        CopyMem(ScreenBuffer.GetPixelPtr(DstX, DstY + j), ScreenBuffer.GetPixelPtr(x, y + j), Width * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+      }
+    } else {
+      for (UINTN j = Height; j-- > 0; ) {
+        CopyMem(ScreenBuffer.GetPixelPtr(DstX, DstY + j), ScreenBuffer.GetPixelPtr(x, y + j), Width * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+      }
+    }
+  }
+  if (GraphicsOutput != NULL) {
+    GraphicsOutput->Blt(GraphicsOutput, NULL, EfiBltVideoToVideo, x, y, DstX, DstY, Width, Height, 0);
+  } else if (UgaDraw != NULL) {
+    UgaDraw->Blt(UgaDraw, NULL, EfiUgaVideoToVideo, x, y, DstX, DstY, Width, Height, 0);
+  }
+  gPerfCounters.BltCalls++;
+  gPerfCounters.BltPixels += (UINT64)Width * Height;
+}
+
+//
+// Draws between egScreenBeginFrame() and egScreenEndFrame() reach the screen together, at the end. Can be nested
+//
+void egScreenBeginFrame(void)
+{
+  ScreenFrameLevel++;
+}
+
+void egScreenEndFrame(void)
+{
+  if (ScreenFrameLevel > 0 && --ScreenFrameLevel == 0) {
+    egScreenBufferFlush();
+  }
 }
 
 //
 // Make a screenshot
 //
+#define SCREENSHOT_MAX 60
+
+// First free index of misc\screenshotN.png, from one read of misc instead of a FileExists per name
+static UINTN ScreenShotFreeIndex(void)
+{
+  REFIT_DIR_ITER  DirIter;
+  EFI_FILE_INFO  *DirEntry;
+  BOOLEAN         Used[SCREENSHOT_MAX];
+
+  ZeroMem(Used, sizeof(Used));
+  DirIterOpen(&self.getCloverDir(), L"misc", &DirIter);
+  while (DirIterNext(&DirIter, 2, L"screenshot*.png", &DirEntry)) {
+    CONST CHAR16 *Number = DirEntry->FileName + 10; // after "screenshot"
+    if (*Number >= L'0' && *Number <= L'9') {
+      UINTN Index = StrDecimalToUintn(Number);
+      if (Index < SCREENSHOT_MAX) {
+        Used[Index] = TRUE;
+      }
+    }
+  }
+  DirIterClose(&DirIter);
+  UINTN Index = 0;
+  while (Index < SCREENSHOT_MAX && Used[Index]) {
+    Index++;
+  }
+  return Index;
+}
+
 EFI_STATUS egScreenShot(void)
 {
   EFI_STATUS      Status = EFI_NOT_READY;
@@ -539,7 +925,7 @@ EFI_STATUS egScreenShot(void)
   //convert to PNG
   UINT8           *FileData = NULL;
   UINTN           FileDataLength = 0U;
-  Status = Screen.ToPNG(&FileData, FileDataLength);
+  Status = Screen.ToPNG(&FileData, FileDataLength, true);
   if (EFI_ERROR(Status)) {
     if (FileData != NULL) {
       FreePool(FileData);
@@ -550,17 +936,13 @@ EFI_STATUS egScreenShot(void)
     return EFI_NOT_READY;
   }
   //save file with a first unoccupied name
-  for (UINTN Index = 0; Index < 60; Index++) {
+  UINTN Index = ScreenShotFreeIndex();
+  if (Index < SCREENSHOT_MAX) {
     XStringW Name = SWPrintf("misc\\screenshot%lld.png", Index);
-    if (!FileExists(&self.getCloverDir(), Name.wc_str())) {
-      Status = egSaveFile(&self.getCloverDir(), Name.wc_str(), FileData, FileDataLength);
-      // Jief : don't write outside SelfDir
-//      if (EFI_ERROR(Status))
-//        Status = egSaveFile(NULL, Name.wc_str(), FileData, FileDataLength);
-      if (!EFI_ERROR(Status)) {
-        break;
-      }
-    }
+    Status = egSaveFile(&self.getCloverDir(), Name.wc_str(), FileData, FileDataLength);
+    // Jief : don't write outside SelfDir
+//    if (EFI_ERROR(Status))
+//      Status = egSaveFile(NULL, Name.wc_str(), FileData, FileDataLength);
   }
   FreePool(FileData);
   return Status;
@@ -581,8 +963,12 @@ static EFI_STATUS GopSetModeAndReconnectTextOut(IN UINT32 ModeNumber)
         return EFI_UNSUPPORTED;
     }
 
+    egScreenBufferInvalidate(); // the screen will be cleared and resized
     Status = GraphicsOutput->SetMode(GraphicsOutput, ModeNumber);
     MsgLog("Video mode change to mode #%d: %s\n", ModeNumber, efiStrError(Status));
+    if (!EFI_ERROR(Status)) {
+        egFramebufferWriteCombine();
+    }
 
     if (gFirmwareClover && !EFI_ERROR(Status)) { 
         // When we change mode on GOP, we need to reconnect the drivers which produce simple text out
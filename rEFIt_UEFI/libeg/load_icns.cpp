@@ -94,68 +94,102 @@ void egCopyPlane(IN UINT8 *SrcPlanePtr, IN UINT8 *DestPlanePtr, IN UINTN PixelCo
 
 
 //
-// Decompress .icns RLE data
+// Decode the RGB planes of an icns RLE block straight into the pixels: the planes follow each other in
+// the stream, a packet may continue into the next plane.
 //
-
-void egDecompressIcnsRLE(IN OUT UINT8 **CompData, IN OUT UINTN *CompLen, IN UINT8 *PixelData, IN UINTN PixelCount)
+static void egDecompressIcnsRGB(const UINT8 *cp, UINTN CompLen, EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Pixels, UINTN PixelCount)
 {
-    UINT8 *cp;
-    UINT8 *cp_end;
-    UINT8 *pp;
-    UINTN pp_left;
-    UINTN len, i;
-    UINT8 value;
-    
-    // setup variables
-    cp = *CompData;
-    cp_end = cp + *CompLen;
-    pp = PixelData;
-    pp_left = PixelCount;
-    
-    // decode
-    while (cp + 1 < cp_end && pp_left > 0) {
-        len = *cp++;
-        if (len & 0x80) {   // compressed data: repeat next byte
-            len -= 125;
-            if (len > pp_left)
-                break;
-            value = *cp++;
-            for (i = 0; i < len; i++) {
-                *pp = value;
-                pp += 4;
-            }
-        } else {            // uncompressed data: copy bytes
-            len++;
-            if (len > pp_left || cp + len > cp_end)
-                break;
-            for (i = 0; i < len; i++) {
-                *pp = *cp++;
-                pp += 4;
-            }
+  static const UINTN PlaneOffset[3] = {
+    OFFSET_OF(EFI_GRAPHICS_OUTPUT_BLT_PIXEL, Red),
+    OFFSET_OF(EFI_GRAPHICS_OUTPUT_BLT_PIXEL, Green),
+    OFFSET_OF(EFI_GRAPHICS_OUTPUT_BLT_PIXEL, Blue)
+  };
+  const UINT8 *cp_end = cp + CompLen;
+  UINTN Plane = 0;
+  UINT8 *pp = (UINT8 *)Pixels + PlaneOffset[0];
+  UINTN pp_left = PixelCount;
+
+  while (cp + 1 < cp_end && Plane < 3) {
+    UINTN len = *cp++;
+    BOOLEAN Repeat = (len & 0x80) != 0;
+    UINT8 value = 0;
+    if (Repeat) {   // compressed data: repeat next byte
+      len -= 125;
+      value = *cp++;
+    } else {        // uncompressed data: copy bytes
+      len++;
+      if (cp + len > cp_end) {
+        break;
+      }
+    }
+    while (len > 0 && Plane < 3) {
+      UINTN n = (len < pp_left) ? len : pp_left;
+      len -= n;
+      pp_left -= n;
+      if (Repeat) {
+        for (; n > 0; n--, pp += 4) {
+          *pp = value;
+        }
+      } else {
+        for (; n > 0; n--, pp += 4) {
+          *pp = *cp++;
         }
-        pp_left -= len;
+      }
+      if (pp_left == 0 && ++Plane < 3) {
+        pp = (UINT8 *)Pixels + PlaneOffset[Plane];
+        pp_left = PixelCount;
+      }
     }
-    
-  if (pp_left > 0) {
-	  DBG(" egDecompressIcnsRLE: still need %llu bytes of pixel data\n", pp_left);
   }
-    
-    // record what's left of the compressed data stream
-    *CompData = cp;
-    *CompLen = (UINTN)(cp_end - cp);
+  if (Plane < 3) {
+    DBG(" egDecompressIcnsRGB: still need %llu bytes of pixel data\n", (3 - Plane - 1) * PixelCount + pp_left);
+  } else if (cp < cp_end) {
+    DBG(" egDecompressIcnsRGB: %llu bytes of compressed data left\n", (UINTN)(cp_end - cp));
+  }
 }
 
 //
 // Load Apple .icns icons
 //
 
+// the icns block types we can decode, one row per pixel size
+typedef struct {
+  UINTN  PixelSize;
+  UINT32 DataType;   // RGB, RLE compressed below 3 bytes per pixel
+  UINT32 MaskType;   // 8 bit alpha
+  UINT32 PngType;    // PNG in newer files, 0 if none
+} ICNS_SIZE;
+
+#define ICNS_TYPE(a, b, c, d) (((UINT32)(a) << 24) | ((UINT32)(b) << 16) | ((UINT32)(c) << 8) | (UINT32)(d))
+
+static const ICNS_SIZE IcnsSizes[] = {
+  {  16, ICNS_TYPE('i','s','3','2'), ICNS_TYPE('s','8','m','k'), 0 },
+  {  32, ICNS_TYPE('i','l','3','2'), ICNS_TYPE('l','8','m','k'), ICNS_TYPE('i','c','1','1') },
+  {  48, ICNS_TYPE('i','h','3','2'), ICNS_TYPE('h','8','m','k'), 0 },
+  {  64, 0,                          0,                          ICNS_TYPE('i','c','1','2') },
+  { 128, ICNS_TYPE('i','t','3','2'), ICNS_TYPE('t','8','m','k'), ICNS_TYPE('i','c','0','7') },
+  { 256, 0,                          0,                          ICNS_TYPE('i','c','0','8') },
+  { 512, 0,                          0,                          ICNS_TYPE('i','c','0','9') },
+};
+#define ICNS_SIZE_COUNT (sizeof(IcnsSizes) / sizeof(IcnsSizes[0]))
+
+typedef struct {
+  UINT8  *DataPtr;
+  UINT32 DataLen;
+  UINT8  *MaskPtr;
+  UINT32 MaskLen;
+  UINT8  *PngPtr;
+  UINT32 PngLen;
+} ICNS_BLOCKS;
+
+static const UINT8 PngSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
 EFI_STATUS XImage::FromICNS(IN UINT8 *FileData, IN UINTN FileDataLength, IN UINTN IconSize)
 {
-    UINT8               *Ptr, *BufferEnd, *DataPtr, *MaskPtr;
-    UINT32              BlockLen, DataLen, MaskLen;
-    UINTN               FetchPixelSize, PixelCount, i;
-    UINT8               *CompData;
-    UINTN               CompLen;
+    ICNS_BLOCKS         Blocks[ICNS_SIZE_COUNT];
+    UINT8               *Ptr, *BufferEnd;
+    UINT32              BlockType, BlockLen;
+    UINTN               Index, Best, FetchPixelSize, PixelCount, i;
     UINT8               *SrcPtr;
     EFI_GRAPHICS_OUTPUT_BLT_PIXEL            *DestPtr;
     
@@ -166,119 +200,94 @@ EFI_STATUS XImage::FromICNS(IN UINT8 *FileData, IN UINTN FileDataLength, IN UINT
       return EFI_NOT_FOUND; //it is null at this moment
     }
     
-    FetchPixelSize = IconSize;
-    for (;;) {
-        DataPtr = NULL;
-        DataLen = 0;
-        MaskPtr = NULL;
-        MaskLen = 0;
-        
-        Ptr = FileData + 8;
-        BufferEnd = FileData + FileDataLength;
-        // iterate over tagged blocks in the file
-        while (Ptr + 8 <= BufferEnd) {
-            BlockLen = ((UINT32)Ptr[4] << 24) + ((UINT32)Ptr[5] << 16) + ((UINT32)Ptr[6] << 8) + (UINT32)Ptr[7];
-            if (Ptr + BlockLen > BufferEnd)   // block continues beyond end of file
-                break;
-            
-            // extract the appropriate blocks for each pixel size
-            if (FetchPixelSize == 128) {
-                if (Ptr[0] == 'i' && Ptr[1] == 't' && Ptr[2] == '3' && Ptr[3] == '2') {
-                    if (Ptr[8] == 0 && Ptr[9] == 0 && Ptr[10] == 0 && Ptr[11] == 0) {
-                        DataPtr = Ptr + 12;
-                        DataLen = BlockLen - 12;
+    // one walk over the tagged blocks, remembering where each size is. Nothing is decoded yet
+    ZeroMem(Blocks, sizeof(Blocks));
+    Ptr = FileData + 8;
+    BufferEnd = FileData + FileDataLength;
+    while (Ptr + 8 <= BufferEnd) {
+        BlockType = ICNS_TYPE(Ptr[0], Ptr[1], Ptr[2], Ptr[3]);
+        BlockLen = ((UINT32)Ptr[4] << 24) + ((UINT32)Ptr[5] << 16) + ((UINT32)Ptr[6] << 8) + (UINT32)Ptr[7];
+        if (BlockLen < 8 || BlockLen > (UINTN)(BufferEnd - Ptr))   // block continues beyond end of file
+            break;
+        for (Index = 0; Index < ICNS_SIZE_COUNT; Index++) {
+            if (BlockType == IcnsSizes[Index].DataType) {
+                if (IcnsSizes[Index].PixelSize == 128) { // it32 data starts with 4 zero bytes
+                    if (BlockLen >= 12 && Ptr[8] == 0 && Ptr[9] == 0 && Ptr[10] == 0 && Ptr[11] == 0) {
+                        Blocks[Index].DataPtr = Ptr + 12;
+                        Blocks[Index].DataLen = BlockLen - 12;
                     }
-                } else if (Ptr[0] == 't' && Ptr[1] == '8' && Ptr[2] == 'm' && Ptr[3] == 'k') {
-                    MaskPtr = Ptr + 8;
-                    MaskLen = BlockLen - 8;
+                } else {
+                    Blocks[Index].DataPtr = Ptr + 8;
+                    Blocks[Index].DataLen = BlockLen - 8;
                 }
-                
-            } else if (FetchPixelSize == 48) {
-                if (Ptr[0] == 'i' && Ptr[1] == 'h' && Ptr[2] == '3' && Ptr[3] == '2') {
-                    DataPtr = Ptr + 8;
-                    DataLen = BlockLen - 8;
-                } else if (Ptr[0] == 'h' && Ptr[1] == '8' && Ptr[2] == 'm' && Ptr[3] == 'k') {
-                    MaskPtr = Ptr + 8;
-                    MaskLen = BlockLen - 8;
-                }
-                
-            } else if (FetchPixelSize == 32) {
-                if (Ptr[0] == 'i' && Ptr[1] == 'l' && Ptr[2] == '3' && Ptr[3] == '2') {
-                    DataPtr = Ptr + 8;
-                    DataLen = BlockLen - 8;
-                } else if (Ptr[0] == 'l' && Ptr[1] == '8' && Ptr[2] == 'm' && Ptr[3] == 'k') {
-                    MaskPtr = Ptr + 8;
-                    MaskLen = BlockLen - 8;
-                }
-                
-            } else if (FetchPixelSize == 16) {
-                if (Ptr[0] == 'i' && Ptr[1] == 's' && Ptr[2] == '3' && Ptr[3] == '2') {
-                    DataPtr = Ptr + 8;
-                    DataLen = BlockLen - 8;
-                } else if (Ptr[0] == 's' && Ptr[1] == '8' && Ptr[2] == 'm' && Ptr[3] == 'k') {
-                    MaskPtr = Ptr + 8;
-                    MaskLen = BlockLen - 8;
-                }
-                
+            } else if (BlockType == IcnsSizes[Index].MaskType) {
+                Blocks[Index].MaskPtr = Ptr + 8;
+                Blocks[Index].MaskLen = BlockLen - 8;
+            } else if (IcnsSizes[Index].PngType != 0 && BlockType == IcnsSizes[Index].PngType &&
+                       BlockLen >= 16 && CompareMem(Ptr + 8, PngSignature, sizeof(PngSignature)) == 0) { // not JPEG 2000
+                Blocks[Index].PngPtr = Ptr + 8;
+                Blocks[Index].PngLen = BlockLen - 8;
             }
-            
-            Ptr += BlockLen;
         }
-        //TODO - take different larger size if not found
-        // FUTURE: try to load a different size and scale it later
-            if (DataPtr == NULL && FetchPixelSize == 128) {
-                FetchPixelSize = 32;
-                continue;
-            }
-        
-        break;
+        Ptr += BlockLen;
+    }
+
+    // the requested size, else the smallest bigger one, else the biggest we have
+    Best = ICNS_SIZE_COUNT;
+    for (Index = 0; Index < ICNS_SIZE_COUNT; Index++) {
+        if (Blocks[Index].DataPtr == NULL && Blocks[Index].PngPtr == NULL) {
+            continue;
+        }
+        if (Best == ICNS_SIZE_COUNT ||
+            (IcnsSizes[Best].PixelSize < IconSize && IcnsSizes[Index].PixelSize > IcnsSizes[Best].PixelSize)) {
+            Best = Index;
+        }
     }
     
-  if (DataPtr == NULL) {
+  if (Best == ICNS_SIZE_COUNT) {
     DBG("not found such IconSize\n");
     return EFI_NOT_FOUND;   // no image found
   }
-    
-    // allocate image structure and buffer
-//    NewImage = egCreateImage(FetchPixelSize, FetchPixelSize, WantAlpha);
- //   if (NewImage == NULL)
- //       return NULL;
-    setSizeInPixels(FetchPixelSize, FetchPixelSize);
-    PixelCount = FetchPixelSize * FetchPixelSize;
-    
-    if (DataLen < PixelCount * 3) {
-        
-        // pixel data is compressed, RGB planar
-        CompData = DataPtr;
-        CompLen  = DataLen;
-        egDecompressIcnsRLE(&CompData, &CompLen, PLPTR(*this, Red), PixelCount);
-        egDecompressIcnsRLE(&CompData, &CompLen, PLPTR(*this, Green), PixelCount);
-        egDecompressIcnsRLE(&CompData, &CompLen, PLPTR(*this, Blue), PixelCount);
-        // possible assertion: CompLen == 0
-        if (CompLen > 0) {
-          DBG(" egLoadICNSIcon: %llu bytes of compressed data left\n", CompLen);
+    FetchPixelSize = IcnsSizes[Best].PixelSize;
+
+    if (Blocks[Best].DataPtr == NULL) {
+        // only a PNG of this size
+        EFI_STATUS Status = FromPNG(Blocks[Best].PngPtr, Blocks[Best].PngLen);
+        if (EFI_ERROR(Status)) {
+            return Status;
         }
-        
     } else {
+        setSizeInPixels(FetchPixelSize, FetchPixelSize);
+        Premultiplied = false;
+        PixelCount = FetchPixelSize * FetchPixelSize;
         
-        // pixel data is uncompressed, RGB interleaved
-        SrcPtr  = DataPtr;
-        DestPtr = GetPixelPtr(0,0);
-        for (i = 0; i < PixelCount; i++, DestPtr++) {
-            DestPtr->Red = *SrcPtr++;
-            DestPtr->Green = *SrcPtr++;
-            DestPtr->Blue = *SrcPtr++;
+        if (Blocks[Best].DataLen < PixelCount * 3) {
+            // pixel data is compressed, RGB planar
+            egDecompressIcnsRGB(Blocks[Best].DataPtr, Blocks[Best].DataLen, GetPixelPtr(0,0), PixelCount);
+        } else {
+            // pixel data is uncompressed, RGB interleaved
+            SrcPtr  = Blocks[Best].DataPtr;
+            DestPtr = GetPixelPtr(0,0);
+            for (i = 0; i < PixelCount; i++, DestPtr++) {
+                DestPtr->Red = *SrcPtr++;
+                DestPtr->Green = *SrcPtr++;
+                DestPtr->Blue = *SrcPtr++;
+            }
         }
         
+        // add/set alpha plane
+        if (Blocks[Best].MaskPtr != NULL && Blocks[Best].MaskLen >= PixelCount)
+            egInsertPlane(Blocks[Best].MaskPtr, PLPTR(*this, Reserved), PixelCount);
+        else
+            egSetPlane(PLPTR(*this, Reserved),  255, PixelCount);
     }
     
-    // add/set alpha plane
-    if (MaskPtr != NULL && MaskLen >= PixelCount)
-        egInsertPlane(MaskPtr, PLPTR(*this, Reserved), PixelCount);
-    else
-        egSetPlane(PLPTR(*this, Reserved),  255, PixelCount);
-    
-    // FUTURE: scale to originally requested size if we had to load another size
+    // a bigger size is scaled down to the requested one, a smaller one is left as it is
+    if (FetchPixelSize > IconSize && IconSize > 0) {
+        XImage Scaled(IconSize, IconSize);
+        Scaled.CopyScaled(*this, (float)IconSize / (float)FetchPixelSize);
+        *this = Scaled;
+    }
     
     return EFI_SUCCESS;
 }
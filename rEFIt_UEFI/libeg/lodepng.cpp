@@ -34,6 +34,7 @@ Rename this file to lodepng.cpp to use it for C++, or to lodepng.c to use it for
 
 #include "libegint.h"
 #include "lodepng.h"
+#include "../Platform/Checksum.h"
 //#include "../cpp_util/panic.h"
 
 #ifdef LODEPNG_COMPILE_DISK
@@ -314,8 +315,8 @@ typedef struct ucvector {
   size_t allocsize; /*allocated size*/
 } ucvector;
 
-/*returns 1 if success, 0 if failure ==> nothing done*/
-static unsigned ucvector_resize(ucvector* p, size_t size) {
+/*makes room for size bytes without changing the used size. returns 1 if success, 0 if failure ==> nothing done*/
+static unsigned ucvector_reserve(ucvector* p, size_t size) {
   if(size > p->allocsize) {
     size_t newsize = (size > p->allocsize * 2u) ? size : ((size * 3u) >> 1u);
     void* data = lodepng_realloc(p->data, p->allocsize, newsize);
@@ -325,6 +326,12 @@ static unsigned ucvector_resize(ucvector* p, size_t size) {
     }
     else return 0; /*error: not enough memory*/
   }
+  return 1; /*success*/
+}
+
+/*returns 1 if success, 0 if failure ==> nothing done*/
+static unsigned ucvector_resize(ucvector* p, size_t size) {
+  if(!ucvector_reserve(p, size)) return 0;
   p->size = size;
   return 1; /*success*/
 }
@@ -1352,10 +1359,141 @@ static unsigned getTreeInflateDynamic(HuffmanTree* tree_ll, HuffmanTree* tree_d,
   return error;
 }
 
-/*inflate a block with dynamic of fixed Huffman tree. btype must be 1 or 2.*/
+/*copies 8 bytes, the compiler makes it a single unaligned load and store*/
+static LODEPNG_INLINE void lodepng_copy8(unsigned char* LODEPNG_RESTRICT dst, const unsigned char* LODEPNG_RESTRICT src) {
+#if defined(__GNUC__)
+  __builtin_memcpy(dst, src, 8);
+#else
+  unsigned i;
+  for(i = 0; i != 8; ++i) dst[i] = src[i];
+#endif
+}
+
+/*reads 8 bytes as a little endian 64 bit value*/
+static LODEPNG_INLINE UINT64 lodepng_read64le(const unsigned char* p) {
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+  UINT64 v;
+  __builtin_memcpy(&v, p, 8);
+  return v;
+#else
+  return (UINT64)p[0] | ((UINT64)p[1] << 8u) | ((UINT64)p[2] << 16u) | ((UINT64)p[3] << 24u) |
+         ((UINT64)p[4] << 32u) | ((UINT64)p[5] << 40u) | ((UINT64)p[6] << 48u) | ((UINT64)p[7] << 56u);
+#endif
+}
+
+/*copy a match of length bytes from distance bytes back, source and destination may overlap*/
+static LODEPNG_INLINE void copyMatch(unsigned char* dst, size_t distance, size_t length) {
+  const unsigned char* src = dst - distance;
+  if(distance == 1) {
+    lodepng_memset(dst, *src, length); /*run of one byte, common for flat image areas*/
+    return;
+  }
+  if(distance < 8 && length >= 16) {
+    /*repeat the pattern until it is at least 8 bytes long, then copy it 8 bytes at once
+    from the nearest multiple of distance back, the bytes there are already written*/
+    size_t lag = distance * ((8u + distance - 1u) / distance);
+    size_t head = lag - distance;
+    length -= head;
+    while(head--) *dst++ = *src++;
+    src = dst - lag;
+    distance = lag;
+  }
+  if(distance >= 8) {
+    for(; length >= 8; length -= 8, dst += 8, src += 8) lodepng_copy8(dst, src);
+  }
+  while(length--) *dst++ = *src++;
+}
+
+/*huffmanDecodeSymbol for a 64 bit buffer holding at least 15 bits, returns the symbol and its length in *len*/
+static LODEPNG_INLINE unsigned huffmanDecodeSymbol64(UINT64 buf, const HuffmanTree* codetree, unsigned* len) {
+  unsigned code = (unsigned)buf & ((1u << FIRSTBITS) - 1u);
+  unsigned l = codetree->table_len[code];
+  unsigned value = codetree->table_value[code];
+  if(l > FIRSTBITS) {
+    unsigned index2 = value + ((unsigned)(buf >> FIRSTBITS) & ((1u << (l - FIRSTBITS)) - 1u));
+    l = codetree->table_len[index2];
+    value = codetree->table_value[index2];
+  }
+  *len = l;
+  return value;
+}
+
+/*margins for inflateHuffmanFast: input bytes that can be read with one 8 byte load after up to 8 bytes
+of advance, and output for two literals and the longest match*/
+#define INFLATE_FAST_IN 16u
+#define INFLATE_FAST_OUT (258u + 3u)
+
+/*
+The bulk of a huffman block. One 8 byte load gives at least 57 bits: enough for three literals,
+or for a length and distance with their extra bits after a reload. Stops without error when
+the input or output margins run out, inflateHuffmanBlock goes on from there symbol by symbol.
+*end is set when the end code is read.
+*/
+static unsigned inflateHuffmanFast(ucvector* out, size_t* pos, LodePNGBitReader* reader,
+                                   const HuffmanTree* tree_ll, const HuffmanTree* tree_d, unsigned* end) {
+  const unsigned char* data = reader->data;
+  unsigned char* o = out->data;
+  size_t bp = reader->bp;
+  size_t p = *pos;
+  unsigned error = 0;
+
+  if(reader->size < INFLATE_FAST_IN || out->allocsize < INFLATE_FAST_OUT) return 0;
+
+  while((bp >> 3u) <= reader->size - INFLATE_FAST_IN && p <= out->allocsize - INFLATE_FAST_OUT) {
+    UINT64 buf = lodepng_read64le(data + (bp >> 3u)) >> (bp & 7u);
+    unsigned l, n, symbol = 0;
+    for(n = 0; n != 3; ++n) {
+      symbol = huffmanDecodeSymbol64(buf, tree_ll, &l);
+      buf >>= l;
+      bp += l;
+      if(symbol > 255) break;
+      o[p++] = (unsigned char)symbol;
+    }
+    if(symbol <= 255) continue; /*three literals*/
+    if(symbol >= FIRST_LENGTH_CODE_INDEX && symbol <= LAST_LENGTH_CODE_INDEX) {
+      size_t length, distance;
+      unsigned code_d;
+      buf = lodepng_read64le(data + (bp >> 3u)) >> (bp & 7u);
+      length = LENGTHBASE[symbol - FIRST_LENGTH_CODE_INDEX];
+      l = LENGTHEXTRA[symbol - FIRST_LENGTH_CODE_INDEX];
+      length += (size_t)(buf & ((1u << l) - 1u));
+      buf >>= l;
+      bp += l;
+      code_d = huffmanDecodeSymbol64(buf, tree_d, &l);
+      buf >>= l;
+      bp += l;
+      if(code_d > 29) {
+        if(code_d <= 31) {
+          ERROR_BREAK(18); /*error: invalid distance code (30-31 are never used)*/
+        } else /* if(code_d == INVALIDSYMBOL) */{
+          ERROR_BREAK(16); /*error: tried to read disallowed huffman symbol*/
+        }
+      }
+      l = DISTANCEEXTRA[code_d];
+      distance = DISTANCEBASE[code_d] + (size_t)(buf & ((1u << l) - 1u));
+      bp += l;
+      if(distance > p) ERROR_BREAK(52); /*too long backward distance*/
+      copyMatch(o + p, distance, length);
+      p += length;
+    } else if(symbol == 256) {
+      *end = 1;
+      break;
+    } else /*if(symbol == INVALIDSYMBOL)*/ {
+      ERROR_BREAK(16); /*error: tried to read disallowed huffman symbol*/
+    }
+  }
+
+  reader->bp = bp;
+  *pos = p;
+  return error;
+}
+
+/*inflate a block with dynamic of fixed Huffman tree. btype must be 1 or 2.
+The output is reserved, not resized, per symbol: out->size is updated once at the end*/
 static unsigned inflateHuffmanBlock(ucvector* out, size_t* pos, LodePNGBitReader* reader,
                                     unsigned btype) {
   unsigned error = 0;
+  unsigned end = 0;
   HuffmanTree tree_ll; /*the huffman tree for literal and length codes*/
   HuffmanTree tree_d; /*the huffman tree for distance codes*/
 
@@ -1368,17 +1506,18 @@ static unsigned inflateHuffmanBlock(ucvector* out, size_t* pos, LodePNGBitReader
   while(!error) /*decode all symbols until end reached, breaks at end code*/ {
     /*code_ll is literal, length or end code*/
     unsigned code_ll;
+    error = inflateHuffmanFast(out, pos, reader, &tree_ll, &tree_d, &end);
+    if(error || end) break;
+    /*near the end of the input or of the reserved output: one symbol at a time*/
+    if(*pos >= out->allocsize && !ucvector_reserve(out, (*pos) + 1)) ERROR_BREAK(83 /*alloc fail*/);
     ensureBits25(reader, 20); /* up to 15 for the huffman symbol, up to 5 for the length extra bits */
     code_ll = huffmanDecodeSymbol(reader, &tree_ll);
     if(code_ll <= 255) /*literal symbol*/ {
-      /*ucvector_push_back would do the same, but for some reason the two lines below run 10% faster*/
-      if(!ucvector_resize(out, (*pos) + 1)) ERROR_BREAK(83 /*alloc fail*/);
-      out->data[*pos] = (unsigned char)code_ll;
-      ++(*pos);
+      out->data[(*pos)++] = (unsigned char)code_ll;
     } else if(code_ll >= FIRST_LENGTH_CODE_INDEX && code_ll <= LAST_LENGTH_CODE_INDEX) /*length code*/ {
       unsigned code_d, distance;
       unsigned numextrabits_l, numextrabits_d; /*extra bits for length and distance*/
-      size_t start, backward, length;
+      size_t length;
 
       /*part 1: get length base*/
       length = LENGTHBASE[code_ll - FIRST_LENGTH_CODE_INDEX];
@@ -1410,22 +1549,11 @@ static unsigned inflateHuffmanBlock(ucvector* out, size_t* pos, LodePNGBitReader
       }
 
       /*part 5: fill in all the out[n] values based on the length and dist*/
-      start = (*pos);
-      if(distance > start) ERROR_BREAK(52); /*too long backward distance*/
-      backward = start - distance;
-
-      if(!ucvector_resize(out, (*pos) + length)) ERROR_BREAK(83 /*alloc fail*/);
-      if(distance < length) {
-        size_t forward;
-        lodepng_memcpy(out->data + *pos, out->data + backward, distance);
-        *pos += distance;
-        for(forward = distance; forward < length; ++forward) {
-          out->data[(*pos)++] = out->data[backward++];
-        }
-      } else {
-        lodepng_memcpy(out->data + *pos, out->data + backward, length);
-        *pos += length;
-      }
+      if(distance > *pos) ERROR_BREAK(52); /*too long backward distance*/
+
+      if(!ucvector_reserve(out, (*pos) + length)) ERROR_BREAK(83 /*alloc fail*/);
+      copyMatch(out->data + *pos, distance, length);
+      *pos += length;
     } else if(code_ll == 256) {
       break; /*end code, break the loop*/
     } else /*if(code_ll == INVALIDSYMBOL)*/ {
@@ -1439,6 +1567,7 @@ static unsigned inflateHuffmanBlock(ucvector* out, size_t* pos, LodePNGBitReader
       ERROR_BREAK(51); /*error, bit pointer jumps past memory*/
     }
   }
+  out->size = *pos;
 
   HuffmanTree_cleanup(&tree_ll);
   HuffmanTree_cleanup(&tree_d);
@@ -1517,16 +1646,6 @@ unsigned lodepng_inflate(unsigned char** out, size_t* outsize,
   return error;
 }
 
-static unsigned inflate(unsigned char** out, size_t* outsize,
-                        const unsigned char* in, size_t insize,
-                        const LodePNGDecompressSettings* settings) {
-  if(settings->custom_inflate) {
-    return settings->custom_inflate(out, outsize, in, insize, settings);
-  } else {
-    return lodepng_inflate(out, outsize, in, insize, settings);
-  }
-}
-
 #endif /*LODEPNG_COMPILE_DECODER*/
 
 #ifdef LODEPNG_COMPILE_ENCODER
@@ -2230,24 +2349,9 @@ static unsigned deflate(unsigned char** out, size_t* outsize,
 /* / Adler32                                                                / */
 /* ////////////////////////////////////////////////////////////////////////// */
 
+/*Clover: shared with the mkext code, with its SSSE3 path*/
 static unsigned update_adler32(unsigned adler, const unsigned char* data, unsigned len) {
-  unsigned s1 = adler & 0xffffu;
-  unsigned s2 = (adler >> 16u) & 0xffffu;
-
-  while(len != 0u) {
-    unsigned i;
-    /*at least 5552 sums can be done before the sums overflow, saving a lot of module divisions*/
-    unsigned amount = len > 5552u ? 5552u : len;
-    len -= amount;
-    for(i = 0; i != amount; ++i) {
-      s1 += (*data++);
-      s2 += s1;
-    }
-    s1 %= 65521u;
-    s2 %= 65521u;
-  }
-
-  return (s2 << 16u) | s1;
+  return Adler32(adler, data, len);
 }
 
 /*Return the adler32 of the bytes data[0..len-1]*/
@@ -2261,8 +2365,9 @@ static unsigned adler32(const unsigned char* data, unsigned len) {
 
 #ifdef LODEPNG_COMPILE_DECODER
 
-unsigned lodepng_zlib_decompress(unsigned char** out, size_t* outsize, const unsigned char* in,
-                                 size_t insize, const LodePNGDecompressSettings* settings) {
+/*as lodepng_zlib_decompress, into a vector that may already have room reserved for the result*/
+static unsigned lodepng_zlib_decompressv(ucvector* out, const unsigned char* in,
+                                         size_t insize, const LodePNGDecompressSettings* settings) {
   unsigned error = 0;
   unsigned CM, CINFO, FDICT;
 
@@ -2289,24 +2394,50 @@ unsigned lodepng_zlib_decompress(unsigned char** out, size_t* outsize, const uns
     return 26;
   }
 
-  error = inflate(out, outsize, in + 2, insize - 2, settings);
+  if(settings->custom_inflate) {
+    error = settings->custom_inflate(&out->data, &out->size, in + 2, insize - 2, settings);
+    if(out->size > out->allocsize) out->allocsize = out->size;
+  } else {
+    error = lodepng_inflatev(out, in + 2, insize - 2, settings);
+  }
   if(error) return error;
 
   if(!settings->ignore_adler32) {
     unsigned ADLER32 = lodepng_read32bitInt(&in[insize - 4]);
-    unsigned checksum = adler32(*out, (unsigned)(*outsize));
+    unsigned checksum = adler32(out->data, (unsigned)(out->size));
     if(checksum != ADLER32) return 58; /*error, adler checksum not correct, data must be corrupted*/
   }
 
   return 0; /*no error*/
 }
 
-static unsigned zlib_decompress(unsigned char** out, size_t* outsize, const unsigned char* in,
-                                size_t insize, const LodePNGDecompressSettings* settings) {
+unsigned lodepng_zlib_decompress(unsigned char** out, size_t* outsize, const unsigned char* in,
+                                 size_t insize, const LodePNGDecompressSettings* settings) {
+  unsigned error;
+  ucvector v;
+  ucvector_init_buffer(&v, *out, *outsize);
+  error = lodepng_zlib_decompressv(&v, in, insize, settings);
+  *out = v.data;
+  *outsize = v.size;
+  return error;
+}
+
+/*expected_size: if not 0, *out is already allocated with room for that many bytes
+and the built in inflate fills it without reallocating*/
+static unsigned zlib_decompress(unsigned char** out, size_t* outsize, size_t expected_size,
+                                const unsigned char* in, size_t insize,
+                                const LodePNGDecompressSettings* settings) {
   if(settings->custom_zlib) {
     return settings->custom_zlib(out, outsize, in, insize, settings);
   } else {
-    return lodepng_zlib_decompress(out, outsize, in, insize, settings);
+    unsigned error;
+    ucvector v;
+    ucvector_init_buffer(&v, *out, *outsize);
+    if(*out && expected_size > v.allocsize) v.allocsize = expected_size;
+    error = lodepng_zlib_decompressv(&v, in, insize, settings);
+    *out = v.data;
+    *outsize = v.size;
+    return error;
   }
 }
 
@@ -2366,8 +2497,10 @@ static unsigned zlib_compress(unsigned char** out, size_t* outsize, const unsign
 #else /*no LODEPNG_COMPILE_ZLIB*/
 
 #ifdef LODEPNG_COMPILE_DECODER
-static unsigned zlib_decompress(unsigned char** out, size_t* outsize, const unsigned char* in,
-                                size_t insize, const LodePNGDecompressSettings* settings) {
+static unsigned zlib_decompress(unsigned char** out, size_t* outsize, size_t expected_size,
+                                const unsigned char* in, size_t insize,
+                                const LodePNGDecompressSettings* settings) {
+  (void)expected_size;
   if(!settings->custom_zlib) return 87; /*no custom zlib function provided */
   return settings->custom_zlib(out, outsize, in, insize, settings);
 }
@@ -4537,7 +4670,7 @@ static unsigned readChunk_zTXt(LodePNGInfo* info, const LodePNGDecompressSetting
 
     length = (unsigned)chunkLength - string2_begin;
     /*will fail if zlib error, e.g. if length is too small*/
-    error = zlib_decompress(&decoded.data, &decoded.size,
+    error = zlib_decompress(&decoded.data, &decoded.size, 0,
                             &data[string2_begin],
                             length, zlibsettings);
     if(error) break;
@@ -4617,7 +4750,7 @@ static unsigned readChunk_iTXt(LodePNGInfo* info, const LodePNGDecompressSetting
 
     if(compressed) {
       /*will fail if zlib error, e.g. if length is too small*/
-      error = zlib_decompress(&decoded.data, &decoded.size,
+      error = zlib_decompress(&decoded.data, &decoded.size, 0,
                               &data[begin],
                               length, zlibsettings);
       if(error) break;
@@ -4730,7 +4863,7 @@ static unsigned readChunk_iCCP(LodePNGInfo* info, const LodePNGDecompressSetting
 
   length = (unsigned)chunkLength - string2_begin;
   ucvector_init(&decoded);
-  error = zlib_decompress(&decoded.data, &decoded.size,
+  error = zlib_decompress(&decoded.data, &decoded.size, 0,
                           &data[string2_begin],
                           length, zlibsettings);
   if(!error) {
@@ -4804,10 +4937,12 @@ unsigned lodepng_inspect_chunk(LodePNGState* state, size_t pos,
   return error;
 }
 
-/*read a PNG, the result will be in the same color type as the PNG (hence "generic")*/
+/*read a PNG, the result will be in the same color type as the PNG (hence "generic")
+if image is not NULL and imagesize is exactly the size of the result, the result is written there*/
 static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
                           LodePNGState* state,
-                          const unsigned char* in, size_t insize) {
+                          const unsigned char* in, size_t insize,
+                          unsigned char* image, size_t imagesize) {
   unsigned char IEND = 0;
   const unsigned char* chunk;
   size_t i;
@@ -4978,16 +5113,13 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
     expected_size += lodepng_get_raw_size_idat((*w + 0), (*h + 0) >> 1, bpp);
   }
   if(!state->error) {
-    /* This allocated data will be realloced by zlib_decompress, initially at
-    smaller size again. But the fact that it's already allocated at full size
-    here speeds the multiple reallocs up. TODO: make zlib_decompress support
-    receiving already allocated buffer with expected size instead. */
+    /* Allocated at full size, zlib_decompress inflates into it without reallocating */
     scanlines = (unsigned char*)lodepng_malloc(expected_size);
     if(!scanlines) state->error = 83; /*alloc fail*/
     scanlines_size = 0;
   }
   if(!state->error) {
-    state->error = zlib_decompress(&scanlines, &scanlines_size, idat.data,
+    state->error = zlib_decompress(&scanlines, &scanlines_size, expected_size, idat.data,
                                    idat.size, &state->decoder.zlibsettings);
     if(!state->error && scanlines_size != expected_size) state->error = 91; /*decompressed size doesn't match prediction*/
   }
@@ -4995,8 +5127,12 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
 
   if(!state->error) {
     outsize = lodepng_get_raw_size(*w, *h, &state->info_png.color);
-    *out = (unsigned char*)lodepng_malloc(outsize);
-    if(!*out) state->error = 83; /*alloc fail*/
+    if(image && outsize == imagesize) {
+      *out = image;
+    } else {
+      *out = (unsigned char*)lodepng_malloc(outsize);
+      if(!*out) state->error = 83; /*alloc fail*/
+    }
   }
   if(!state->error) {
     lodepng_memset(*out, 0, outsize);
@@ -5009,7 +5145,7 @@ unsigned lodepng_decode(unsigned char** out, unsigned* w, unsigned* h,
                         LodePNGState* state,
                         const unsigned char* in, size_t insize) {
   *out = 0;
-  decodeGeneric(out, w, h, state, in, insize);
+  decodeGeneric(out, w, h, state, in, insize, NULL, 0);
   if(state->error) return state->error;
   if(!state->decoder.color_convert || lodepng_color_mode_equal(&state->info_raw, &state->info_png.color)) {
     /*same color type, no copying or converting of data needed*/
@@ -6311,7 +6447,7 @@ unsigned decompress(XArray<unsigned char>& out, const unsigned char* in, size_t
                     const LodePNGDecompressSettings& settings) {
   unsigned char* buffer = 0;
   size_t buffersize = 0;
-  unsigned error = zlib_decompress(&buffer, &buffersize, in, insize, &settings);
+  unsigned error = zlib_decompress(&buffer, &buffersize, 0, in, insize, &settings);
   if(buffer) {
 //    out.insert(out.end(), &buffer[0], &buffer[buffersize]);
     out.AddArray(buffer, buffersize);
@@ -6494,6 +6630,31 @@ unsigned eglodepng_encode(unsigned char** out, size_t* outsize, const unsigned c
 {
   return lodepng_encode_memory(out, outsize, image, (unsigned)w, (unsigned)h, LCT_RGBA, 8);
 }
+
+/*Screenshot: RGBA in, opaque RGB out, the alpha of the framebuffer means nothing.
+One fixed filter and a small LZ77 window with fixed Huffman codes: a few times faster
+than the defaults on a full screen, for a somewhat bigger file.*/
+unsigned eglodepng_encode_fast(unsigned char** out, size_t* outsize, const unsigned char* image, size_t w, size_t h)
+{
+  unsigned error;
+  LodePNGState state;
+  lodepng_state_init(&state);
+  state.info_raw.colortype = LCT_RGBA;
+  state.info_raw.bitdepth = 8;
+  state.info_png.color.colortype = LCT_RGB;
+  state.info_png.color.bitdepth = 8;
+  state.encoder.auto_convert = 0; /*no color statistics over the whole screen*/
+  state.encoder.filter_palette_zero = 0;
+  state.encoder.filter_strategy = LFS_ONE; /*"sub", good on flat UI areas*/
+  state.encoder.zlibsettings.btype = 1;
+  state.encoder.zlibsettings.windowsize = 256;
+  state.encoder.zlibsettings.nicematch = 32;
+  state.encoder.zlibsettings.lazymatching = 0;
+  lodepng_encode(out, outsize, image, (unsigned)w, (unsigned)h, &state);
+  error = state.error;
+  lodepng_state_cleanup(&state);
+  return error;
+}
 #endif /*LODEPNG_COMPILE_ENCODER*/
 
 #ifdef LODEPNG_COMPILE_DECODER
@@ -6507,6 +6668,98 @@ unsigned eglodepng_decode(unsigned char** out, size_t* w, size_t* h, const unsig
   }
   return _r;
 }
+
+/*Converts to B, G, R, A with 8 bits each, the byte order of EFI_GRAPHICS_OUTPUT_BLT_PIXEL.
+buffer and in may be the same memory only if mode is 8 bit RGBA.*/
+static void getPixelColorsBGRA8(unsigned char* buffer, size_t numpixels,
+                                const unsigned char* in, const LodePNGColorMode* mode) {
+  size_t i;
+  if(mode->colortype == LCT_RGBA && mode->bitdepth == 8) {
+    for(i = 0; i != numpixels; ++i, buffer += 4, in += 4) {
+      unsigned char r = in[0];
+      buffer[0] = in[2];
+      buffer[1] = in[1];
+      buffer[2] = r;
+      buffer[3] = in[3];
+    }
+  } else if(mode->colortype == LCT_RGB && mode->bitdepth == 8 && !mode->key_defined) {
+    for(i = 0; i != numpixels; ++i, buffer += 4, in += 3) {
+      buffer[0] = in[2];
+      buffer[1] = in[1];
+      buffer[2] = in[0];
+      buffer[3] = 255;
+    }
+  } else if(mode->colortype == LCT_PALETTE) {
+    unsigned char palette[256 * 4]; /*the palette already in BGRA order*/
+    for(i = 0; i != 256; ++i) {
+      palette[i * 4 + 0] = mode->palette[i * 4 + 2];
+      palette[i * 4 + 1] = mode->palette[i * 4 + 1];
+      palette[i * 4 + 2] = mode->palette[i * 4 + 0];
+      palette[i * 4 + 3] = mode->palette[i * 4 + 3];
+    }
+    if(mode->bitdepth == 8) {
+      for(i = 0; i != numpixels; ++i, buffer += 4) lodepng_memcpy(buffer, &palette[in[i] * 4], 4);
+    } else {
+      size_t j = 0;
+      for(i = 0; i != numpixels; ++i, buffer += 4) {
+        unsigned index = readBitsFromReversedStream(&j, in, mode->bitdepth);
+        lodepng_memcpy(buffer, &palette[index * 4], 4);
+      }
+    }
+  } else if(mode->colortype == LCT_GREY_ALPHA && mode->bitdepth == 8) {
+    for(i = 0; i != numpixels; ++i, buffer += 4, in += 2) {
+      buffer[0] = buffer[1] = buffer[2] = in[0];
+      buffer[3] = in[1];
+    }
+  } else {
+    /*16 bit, low bit depth grey and color keys: convert to RGBA and swap*/
+    getPixelColorsRGBA8(buffer, numpixels, in, mode);
+    for(i = 0; i != numpixels; ++i, buffer += 4) {
+      unsigned char r = buffer[0];
+      buffer[0] = buffer[2];
+      buffer[2] = r;
+    }
+  }
+}
+
+unsigned eglodepng_inspect(size_t* w, size_t* h, const unsigned char* in, size_t insize)
+{
+  unsigned _w = 0, _h = 0, _r;
+  LodePNGState state;
+  lodepng_state_init(&state);
+  _r = lodepng_inspect(&_w, &_h, &state, in, insize);
+  lodepng_state_cleanup(&state);
+  if (!_r) {
+    if (w) *w = (size_t)_w;
+    if (h) *h = (size_t)_h;
+  }
+  return _r;
+}
+
+/*
+ decode into out which has room for w * h BGRA pixels, w and h as given by eglodepng_inspect
+ 8 bit RGBA images, the most common in themes, are unfiltered right into out and swapped there
+*/
+unsigned eglodepng_decode_bgra(unsigned char* out, size_t w, size_t h, const unsigned char* in, size_t insize)
+{
+  unsigned _w = 0, _h = 0, _r;
+  unsigned char* raw = NULL;
+  LodePNGState state;
+  lodepng_state_init(&state);
+  _r = lodepng_inspect(&_w, &_h, &state, in, insize);
+  if (!_r && (_w != w || _h != h)) _r = 84; /*the buffer doesn't fit the image*/
+  if (!_r) {
+    unsigned direct = state.info_png.color.colortype == LCT_RGBA && state.info_png.color.bitdepth == 8;
+    decodeGeneric(&raw, &_w, &_h, &state, in, insize, direct ? out : NULL, w * h * 4);
+    _r = state.error;
+  }
+  if (!_r) {
+    getPixelColorsBGRA8(out, w * h, raw, &state.info_png.color);
+  }
+  if (raw && raw != out) lodepng_free(raw);
+  lodepng_state_cleanup(&state);
+  return _r;
+}
 // EXPORT FOR CLOVER <==
 
 #endif /*LODEPNG_COMPILE_DECODER*/
@@ -1049,7 +1049,10 @@ unsigned compress(XArray<unsigned char>& out, const XArray<unsigned char>& in,
 } /* namespace lodepng */
 #endif /*LODEPNG_COMPILE_CPP*/
 unsigned eglodepng_encode(unsigned char** out, size_t* outsize, const unsigned char* image, size_t w, size_t h);
+unsigned eglodepng_encode_fast(unsigned char** out, size_t* outsize, const unsigned char* image, size_t w, size_t h);
 unsigned eglodepng_decode(unsigned char** out, size_t* w, size_t* h, const unsigned char* in, size_t insize);
+unsigned eglodepng_inspect(size_t* w, size_t* h, const unsigned char* in, size_t insize);
+unsigned eglodepng_decode_bgra(unsigned char* out, size_t w, size_t h, const unsigned char* in, size_t insize);
 /*
 TODO:
 [.] test if there are no memory leaks or security exploits - done a lot but needs to be checked often
@@ -0,0 +1,171 @@
+#!/usr/bin/env python3
+#
+# mkegemb_rle.py
+#
+# Generates egemb_icons_rle.cpp/.h, the embedded theme assets already decoded, from the PNG arrays of
+# egemb_icons.cpp, egemb_icons_dark.cpp, scroll_images.cpp and egemb_font.cpp. Rerun it after changing one of them:
+#   cd rEFIt_UEFI/libeg && python3 mkegemb_rle.py
+#
+# emb_xxx_rle is read by XImage::FromRLE():
+#   UINT16 Width, UINT16 Height (little endian)
+#   then packets until Width * Height pixels:
+#     n < 0x80  : n + 1 literal pixels follow
+#     n >= 0x80 : the next pixel is repeated (n & 0x7F) + 1 times
+#   a pixel is 4 bytes B, G, R, A, alpha premultiplied like XImage::Premultiply() does.
+#
+# Only python3 standard modules are used, zlib inflates the PNG.
+#
+
+import re
+import struct
+import sys
+import zlib
+
+SOURCES = ["egemb_icons.cpp", "egemb_icons_dark.cpp", "scroll_images.cpp", "egemb_font.cpp"]
+OUTPUT = "egemb_icons_rle"
+
+
+def read_arrays(path):
+    text = open(path).read()
+    text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+    text = re.sub(r"//[^\n]*", "", text)
+    arrays = []
+    for m in re.finditer(r"DEFINE_EMB_DATA\((\w+)\)\s*\{(.*?)\};", text, re.S):
+        data = bytes(int(x, 16) for x in re.findall(r"0x([0-9a-fA-F]{2})", m.group(2)))
+        arrays.append((m.group(1), data))
+    return arrays
+
+
+def paeth(a, b, c):
+    p = a + b - c
+    pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+    if pa <= pb and pa <= pc:
+        return a
+    return b if pb <= pc else c
+
+
+# PNG to a list of straight (R, G, B, A), the formats of our assets: RGBA8, RGB8, palette 1/2/4/8 bits
+def decode_png(name, data):
+    if data[:8] != b"\x89PNG\r\n\x1a\n":
+        sys.exit("%s: not a PNG" % name)
+    pos = 8
+    idat = b""
+    palette = b""
+    trns = b""
+    while pos < len(data):
+        length, kind = struct.unpack(">I4s", data[pos:pos + 8])
+        chunk = data[pos + 8:pos + 8 + length]
+        pos += 12 + length
+        if kind == b"IHDR":
+            width, height, depth, colortype, _, _, interlace = struct.unpack(">IIBBBBB", chunk)
+        elif kind == b"PLTE":
+            palette = chunk
+        elif kind == b"tRNS":
+            trns = chunk
+        elif kind == b"IDAT":
+            idat += chunk
+        elif kind == b"IEND":
+            break
+    channels = {2: 3, 3: 1, 6: 4}.get(colortype)
+    if channels is None or interlace != 0 or (colortype != 3 and depth != 8):
+        sys.exit("%s: unsupported PNG colortype %d depth %d interlace %d" % (name, colortype, depth, interlace))
+
+    bpp = max(1, channels * depth // 8)
+    stride = (width * channels * depth + 7) // 8
+    raw = zlib.decompress(idat)
+    prev = bytearray(stride)
+    pixels = []
+    for y in range(height):
+        kind = raw[y * (stride + 1)]
+        line = bytearray(raw[y * (stride + 1) + 1:(y + 1) * (stride + 1)])
+        for i in range(stride):
+            a = line[i - bpp] if i >= bpp else 0
+            b = prev[i]
+            c = prev[i - bpp] if i >= bpp else 0
+            if kind == 1:
+                line[i] = (line[i] + a) & 0xFF
+            elif kind == 2:
+                line[i] = (line[i] + b) & 0xFF
+            elif kind == 3:
+                line[i] = (line[i] + (a + b) // 2) & 0xFF
+            elif kind == 4:
+                line[i] = (line[i] + paeth(a, b, c)) & 0xFF
+        for x in range(width):
+            if colortype == 6:
+                pixels.append(tuple(line[x * 4:x * 4 + 4]))
+            elif colortype == 2:
+                pixels.append(tuple(line[x * 3:x * 3 + 3]) + (255,))
+            else:
+                bit = x * depth
+                index = (line[bit // 8] >> (8 - depth - bit % 8)) & ((1 << depth) - 1)
+                alpha = trns[index] if index < len(trns) else 255
+                pixels.append(tuple(palette[index * 3:index * 3 + 3]) + (alpha,))
+        prev = line
+    return width, height, pixels
+
+
+def div255(x):
+    return ((x + 1) * 257) >> 16   # same as Div255() of XImage.cpp
+
+
+def premultiplied_bgra(pixels):
+    out = []
+    for r, g, b, a in pixels:
+        if a != 255:
+            r, g, b = div255(r * a), div255(g * a), div255(b * a)
+        out.append(bytes((b, g, r, a)))
+    return out
+
+
+def encode_rle(width, height, pixels):
+    out = bytearray(struct.pack("<HH", width, height))
+    literal = []
+
+    def flush():
+        while literal:
+            part = literal[:128]
+            del literal[:128]
+            out.append(len(part) - 1)
+            out.extend(b"".join(part))
+
+    i = 0
+    while i < len(pixels):
+        j = i + 1
+        while j < len(pixels) and j - i < 128 and pixels[j] == pixels[i]:
+            j += 1
+        if j - i >= 2:
+            flush()
+            out.append(0x80 | (j - i - 1))
+            out.extend(pixels[i])
+            i = j
+        else:
+            literal.append(pixels[i])
+            i += 1
+    flush()
+    return bytes(out)
+
+
+def main():
+    cpp = ["// Generated by mkegemb_rle.py from the PNG arrays of %s, do not edit" % ", ".join(SOURCES), "",
+           '#include "libegint.h"', ""]
+    header = ["// Generated by mkegemb_rle.py, do not edit", ""]
+    for source in SOURCES:
+        for name, data in read_arrays(source):
+            width, height, pixels = decode_png(name, data)
+            if width > 0xFFFF or height > 0xFFFF:
+                sys.exit("%s: too big" % name)
+            rle = encode_rle(width, height, premultiplied_bgra(pixels))
+            cpp.append("// %s %dx%d" % (name, width, height))
+            cpp.append("DEFINE_EMB_DATA(%s_rle) {" % name)
+            for i in range(0, len(rle), 16):
+                cpp.append("\t" + ", ".join("0x%02x" % v for v in rle[i:i + 16]) + ",")
+            cpp.append("};")
+            cpp.append("DEFINE_EMB_SIZE(%s_rle)" % name)
+            cpp.append("")
+            header.append("DECLARE_EMB_EXTERN_WITH_SIZE(%s_rle)" % name)
+    open(OUTPUT + ".cpp", "w").write("\n".join(cpp))
+    open(OUTPUT + ".h", "w").write("\n".join(header) + "\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+#
+# mkthemepack.py
+#
+# Packs every file of a theme directory into <theme>/theme.pack, read by libeg/ThemePack.cpp with one
+# I/O instead of one file open per icon, frame and font:
+#   python3 mkthemepack.py EFI/CLOVER/themes/<theme>
+# When theme.pack is present the theme files themselves are not read anymore, so run it again after
+# changing the theme, or delete theme.pack.
+#
+# Layout, little endian, see ThemePack.h:
+#   THEME_PACK_HEADER  'TPAK', Version 1, Count, 0
+#   THEME_PACK_ENTRY   NameOffset, DataOffset, DataSize   (Count times)
+#   names              zero terminated ASCII, '\' separated, relative to the theme dir
+#   files              each aligned to 8 bytes
+#
+
+import os
+import struct
+import sys
+
+PACK_NAME = "theme.pack"
+SIGNATURE = b"TPAK"
+VERSION = 1
+
+
+def collect(theme_dir):
+    files = []
+    for root, dirs, names in os.walk(theme_dir):
+        dirs[:] = sorted(d for d in dirs if not d.startswith("."))
+        for name in sorted(names):
+            if name.startswith(".") or (root == theme_dir and name.lower() == PACK_NAME):
+                continue
+            path = os.path.join(root, name)
+            rel = os.path.relpath(path, theme_dir).replace(os.sep, "\\")
+            try:
+                rel.encode("ascii")
+            except UnicodeEncodeError:
+                sys.exit("%s: only ASCII names can be packed" % rel)
+            files.append((rel, path))
+    return files
+
+
+def align8(n):
+    return (n + 7) & ~7
+
+
+def main():
+    if len(sys.argv) != 2 or not os.path.isdir(sys.argv[1]):
+        sys.exit("usage: %s <theme dir>" % sys.argv[0])
+    theme_dir = os.path.normpath(sys.argv[1])
+    files = collect(theme_dir)
+
+    names = b""
+    name_offsets = []
+    table_end = 16 + 12 * len(files)
+    for rel, _ in files:
+        name_offsets.append(table_end + len(names))
+        names += rel.encode("ascii") + b"\0"
+
+    entries = b""
+    data = b""
+    data_start = align8(table_end + len(names))
+    for (rel, path), name_offset in zip(files, name_offsets):
+        content = open(path, "rb").read()
+        entries += struct.pack("<III", name_offset, data_start + len(data), len(content))
+        data += content + b"\0" * (align8(len(content)) - len(content))
+
+    header = SIGNATURE + struct.pack("<III", VERSION, len(files), 0)
+    pack = header + entries + names
+    pack += b"\0" * (data_start - len(pack)) + data
+    if len(pack) >= 1 << 32:
+        sys.exit("theme too big for a pack")
+    open(os.path.join(theme_dir, PACK_NAME), "wb").write(pack)
+    print("%s: %d files, %d bytes" % (os.path.join(theme_dir, PACK_NAME), len(files), len(pack)))
+
+
+if __name__ == "__main__":
+    main()
@@ -471,6 +471,10 @@ typedef void (*recursive_image)(const void *obj, NSVGrasterizer *r, const char *
 // Allocated rasterizer context.
 NSVGrasterizer* nsvgCreateRasterizer(void);
 
+// Same, but all the memory it will need is allocated now: arenaSize bytes. It never calls boot services
+// afterwards, so it can rasterize on an AP. If the arena is too small, r->outOfMemory is set by nsvgRasterize().
+NSVGrasterizer* nsvgCreateRasterizerArena(UINTN arenaSize);
+
 // Rasterizes SVG image, returns RGBA image (non-premultiplied alpha)
 //   r - pointer to rasterizer context
 //   image - pointer to image to rasterize
@@ -484,6 +488,11 @@ void nsvgRasterize(NSVGrasterizer* r,
                    NSVGimage* image, float tx, float ty, float scalex, float scaley,
                    unsigned char* dst, int w, int h, int stride);
 
+// Same but returns premultiplied alpha, as it is rasterized. Skips the unpremultiply and defringe pass.
+void nsvgRasterizePremultiplied(NSVGrasterizer* r,
+                   NSVGimage* image, float tx, float ty, float scalex, float scaley,
+                   unsigned char* dst, int w, int h, int stride);
+
 // Deletes rasterizer context.
 void nsvgDeleteRasterizer(NSVGrasterizer*);
 
@@ -492,7 +501,9 @@ void nsvgDeleteRasterizer(NSVGrasterizer*);
 #define NSVG__FIXSHIFT    14
 #define NSVG__FIX      (1 << NSVG__FIXSHIFT)
 #define NSVG__FIXMASK    (NSVG__FIX-1)
-#define NSVG__MEMPAGE_SIZE  1024
+#define NSVG__RADIX_BITS  8
+#define NSVG__RADIX_SIZE  (1 << NSVG__RADIX_BITS)
+#define NSVG__INSERTION_SORT_MAX  32
 
 typedef struct NSVGedge {
   float x0,y0, x1,y1;
@@ -516,12 +527,6 @@ typedef struct NSVGactiveEdge {
   struct NSVGactiveEdge *next;
 } NSVGactiveEdge;
 
-typedef struct NSVGmemPage {
-  unsigned char mem[NSVG__MEMPAGE_SIZE];
-  int size;
-  struct NSVGmemPage* next;
-} NSVGmemPage;
-
 typedef struct NSVGcachedPaint {
   char type;
   char spread;
@@ -530,6 +535,7 @@ typedef struct NSVGcachedPaint {
   float xform[6];
 //  float opacity;
   void *image;
+  UINT32 *ditherSeed;     // the rasterizer's random state for dither_r()
   unsigned int colors[256];
 //  unsigned int colors2[256];
 } NSVGcachedPaint;
@@ -538,6 +544,10 @@ typedef void (*NSVGscanlineFunction)(
         unsigned char* dst, int count, unsigned char* cover, int x, int y,
     /*    float tx, float ty, float scalex, float scaley, */ NSVGcachedPaint* cache);
 
+// Internal, exposed for the SIMD/scalar comparison in cpp_unit_test.
+void nsvg__fillScanline(unsigned char* scanline, int len, int x0, int x1, int maxWeight, int* xmin, int* xmax);
+void nsvg__scanlineSolid(unsigned char* dst, int count, unsigned char* cover, int x, int y, NSVGcachedPaint* cache);
+
 struct NSVGrasterizer
 {
   float px, py;
@@ -549,6 +559,10 @@ struct NSVGrasterizer
   int nedges;
   int cedges;
 
+  NSVGedge* edges2;       // radix sort scratch, swapped with edges
+  int cedges2;
+  UINT32 radixCount[4][NSVG__RADIX_SIZE];
+
   NSVGpoint* points;
   int npoints;
   int cpoints;
@@ -557,9 +571,10 @@ struct NSVGrasterizer
   int npoints2;
   int cpoints2;
 
+  NSVGactiveEdge* active;  // flat pool, one slot per edge of the shape
+  int nactive;
+  int cactive;
   NSVGactiveEdge* freelist;
-  NSVGmemPage* pages;
-  NSVGmemPage* curpage;
 
   unsigned char* scanline;
   int cscanline;
@@ -568,9 +583,17 @@ struct NSVGrasterizer
   unsigned char* stencil;
   int stencilSize;
   int stencilStride;
+  int cstencil;
 
   unsigned char* bitmap;
   int width, height, stride;
+
+  UINT32 ditherSeed;      // own random state, so rasterizers on different processors don't share one
+
+  unsigned char* arena;   // NULL - memory pool
+  UINTN arenaSize;
+  UINTN arenaUsed;
+  int outOfMemory;        // the last image is incomplete
 };
 
 extern NSVGfontChain *fontsDB;
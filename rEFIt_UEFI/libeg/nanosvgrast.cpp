@@ -38,6 +38,7 @@
 #include "nanosvg.h"
 #include "FloatLib.h"
 #include "XImage.h"
+#include "../Platform/MemoryOperation.h"
 
 #ifndef DEBUG_ALL
 #define DEBUG_SVG 0
@@ -65,6 +66,24 @@
 //#define fabsf(x) ((x >= 0.0f)?x:(-x))
 #define fabsf(x) FabsF(x)
 
+//
+// Span fillers and coverage accumulation use GCC vector extensions (SSE2 on x86_64), gated at runtime by
+// MemoryOperationGetSimd() like XImage::ComposeRow(). They give exactly the same pixels as the scalar code.
+//
+#if defined(__x86_64__) && defined(__GNUC__)
+#define NSVG_SSE2 1
+typedef UINT32 NSVG_V4U __attribute__((vector_size(16)));
+typedef UINT32 NSVG_V4U_UNALIGNED __attribute__((vector_size(16), aligned(4), may_alias));
+typedef float  NSVG_V4F __attribute__((vector_size(16)));
+typedef float  NSVG_V4F_UNALIGNED __attribute__((vector_size(16), aligned(4), may_alias));
+typedef unsigned char NSVG_V16B_UNALIGNED __attribute__((vector_size(16), aligned(1), may_alias));
+#else
+#define NSVG_SSE2 0
+#endif
+
+// gradient colors are resolved for this many pixels, then blended at once
+#define NSVG__SPAN  64
+
 
 static void renderShape(NSVGrasterizer* r,
                         NSVGshape* shape, float *xform, float min_scale);
@@ -84,40 +103,6 @@ void DumpFloat (char* s, float* t, int N)
 #endif
 }
 
-void nsvg_qsort(NSVGedge* Array, int Low, int High)
-{
-  int i = Low, j = High;
-  NSVGedge Temp;
-//  UINTN Size = sizeof(NSVGedge);
-  int Imed;
-  Imed = (Low + High) / 2; // Central element, just pointer
-  float med = Array[Imed].y0;
-  //  Temp = (__typeof__(Temp))AllocatePool(sizeof(NSVGedge));
-  // Sort around center
-  while (i <= j) {
-    while (Array[i].y0 < med) i++;
-    while (Array[j].y0 > med) j--;
-    // Change
-    if (i <= j) {
-      memcpy(&Temp, &Array[i], sizeof(NSVGedge));
-      memcpy(&Array[i++], &Array[j], sizeof(NSVGedge));
-      memcpy(&Array[j--], &Temp, sizeof(NSVGedge));
-    }
-  }
-  //  FreePool(Temp);
-  // Recursion
-  if (j > Low)    nsvg_qsort(Array, Low, j);
-  if (High > i)   nsvg_qsort(Array, i, High);
-}
-
-
-void qsort(void* Array, int Num, INTN Size,
-           int (*compare)(const void* a, const void* b))
-{
-  //  QuickSort(Array, 0, Num - 1, Size, compare);
-  nsvg_qsort((NSVGedge*)Array, 0, Num - 1);
-}
-
 //caller is responsible for free memory
 NSVGrasterizer* nsvgCreateRasterizer()
 {
@@ -125,23 +110,37 @@ NSVGrasterizer* nsvgCreateRasterizer()
   if (r == NULL) return NULL;
   r->tessTol = 0.1f;  //0.25f;
   r->distTol = 0.01f;
+  r->ditherSeed = 12345;
   return r;
 }
 
-void nsvgDeleteRasterizer(NSVGrasterizer* r)
+NSVGrasterizer* nsvgCreateRasterizerArena(UINTN arenaSize)
 {
-  NSVGmemPage* p;
+  NSVGrasterizer* r = nsvgCreateRasterizer();
+  if (r == NULL) return NULL;
+  r->arena = (unsigned char*)AllocatePool(arenaSize);
+  if (r->arena == NULL) {
+    FreePool(r);
+    return NULL;
+  }
+  r->arenaSize = arenaSize;
+  return r;
+}
 
+void nsvgDeleteRasterizer(NSVGrasterizer* r)
+{
   if (r == NULL) return;
 
-  p = r->pages;
-  while (p != NULL) {
-    NSVGmemPage* next = p->next;
-    FreePool(p);
-    p = next;
+  if (r->arena) {
+    // everything else is inside
+    FreePool(r->arena);
+    FreePool(r);
+    return;
   }
 
   if (r->edges) FreePool(r->edges);
+  if (r->edges2) FreePool(r->edges2);
+  if (r->active) FreePool(r->active);
   if (r->points) FreePool(r->points);
   if (r->points2) FreePool(r->points2);
   if (r->scanline) FreePool(r->scanline);
@@ -150,49 +149,32 @@ void nsvgDeleteRasterizer(NSVGrasterizer* r)
   FreePool(r);
 }
 
-static NSVGmemPage* nsvg__nextPage(NSVGrasterizer* r, NSVGmemPage* cur)
+// Grows a buffer of the rasterizer, keeping its content. With an arena, takes the new buffer from it and never
+// calls the memory pool, the old buffer is just abandoned (sizes double, so at most half the arena is lost).
+// Returns NULL and leaves the old buffer in place if there is no memory, r->outOfMemory tells the caller
+// that the image is incomplete.
+static void* nsvg__realloc(NSVGrasterizer* r, void* old, UINTN oldSize, UINTN newSize)
 {
-  NSVGmemPage *newp;
-
-  // If using existing chain, return the next page in chain
-  if (cur != NULL && cur->next != NULL) {
-    return cur->next;
-  }
-
-  // Alloc new page
-  newp = (NSVGmemPage*)AllocateZeroPool(sizeof(NSVGmemPage));
-  if (newp == NULL) return NULL;
-
+  void* p;
 
-  // Add to linked list
-  if (cur != NULL)
-    cur->next = newp;
-  else
-    r->pages = newp;
-
-  return newp;
-}
-
-static void nsvg__resetPool(NSVGrasterizer* r)
-{
-  NSVGmemPage* p = r->pages;
-  while (p != NULL) {
-    p->size = 0;
-    p = p->next;
+  if (r->arena == NULL) {
+    p = old == NULL ? AllocatePool(newSize) : ReallocatePool(oldSize, newSize, old);
+  } else {
+    newSize = ALIGN_VALUE(newSize, sizeof(UINT64));
+    if (r->arenaSize - r->arenaUsed < newSize) {
+      p = NULL;
+    } else {
+      p = r->arena + r->arenaUsed;
+      r->arenaUsed += newSize;
+      if (old != NULL) {
+        CopyMem(p, old, oldSize);
+      }
+    }
   }
-  r->curpage = r->pages;
-}
-
-static unsigned char* nsvg__alloc(NSVGrasterizer* r, int size)
-{
-  unsigned char* buf;
-  if (size > NSVG__MEMPAGE_SIZE) return NULL;
-  if (r->curpage == NULL || r->curpage->size+size > NSVG__MEMPAGE_SIZE) {
-    r->curpage = nsvg__nextPage(r, r->curpage);
+  if (p == NULL) {
+    r->outOfMemory = 1;
   }
-  buf = &r->curpage->mem[r->curpage->size];
-  r->curpage->size += size;
-  return buf;
+  return p;
 }
 
 static int nsvg__ptEquals(NSVGpoint* pt1, NSVGpoint* pt2, float tol)
@@ -223,14 +205,11 @@ static void nsvg__addPathPoint(NSVGrasterizer* r, NSVGpoint* pt, float* t, int f
   }
 
   if (r->npoints+1 > r->cpoints) {
-    int OldSize = r->cpoints * sizeof(NSVGpoint);
-    r->cpoints = r->cpoints > 0 ? r->cpoints * 2 : 64;
-    if (OldSize == 0) {
-      r->points = (NSVGpoint*)AllocatePool(64 * sizeof(NSVGpoint));
-    } else {
-      r->points = (NSVGpoint*)ReallocatePool(OldSize, sizeof(NSVGpoint) * r->cpoints, r->points);
-    }
-    if (r->points == NULL) return;
+    int cpoints = r->cpoints > 0 ? r->cpoints * 2 : 64;
+    NSVGpoint* points = (NSVGpoint*)nsvg__realloc(r, r->points, r->cpoints * sizeof(NSVGpoint), cpoints * sizeof(NSVGpoint));
+    if (points == NULL) return;
+    r->points = points;
+    r->cpoints = cpoints;
   }
 
   pt1 = &r->points[r->npoints];
@@ -244,13 +223,11 @@ static void nsvg__addPathPoint(NSVGrasterizer* r, NSVGpoint* pt, float* t, int f
 static void nsvg__appendPathPoint(NSVGrasterizer* r, NSVGpoint* pt)
 {
   if (r->npoints+1 > r->cpoints) {
-    int OldSize = r->cpoints * sizeof(NSVGpoint);
-    r->cpoints = r->cpoints > 0 ? r->cpoints * 2 : 64;
-    if (OldSize == 0) {
-      r->points = (NSVGpoint*)AllocatePool(64 * sizeof(NSVGpoint));
-    } else
-      r->points = (NSVGpoint*)ReallocatePool(OldSize, sizeof(NSVGpoint) * r->cpoints, r->points);
-    if (r->points == NULL) return;
+    int cpoints = r->cpoints > 0 ? r->cpoints * 2 : 64;
+    NSVGpoint* points = (NSVGpoint*)nsvg__realloc(r, r->points, r->cpoints * sizeof(NSVGpoint), cpoints * sizeof(NSVGpoint));
+    if (points == NULL) return;
+    r->points = points;
+    r->cpoints = cpoints;
   }
   r->points[r->npoints] = *pt;
   r->npoints++;
@@ -259,13 +236,14 @@ static void nsvg__appendPathPoint(NSVGrasterizer* r, NSVGpoint* pt)
 static void nsvg__duplicatePoints(NSVGrasterizer* r)
 {
   if (r->npoints > r->cpoints2) {
-    int OldSize = r->cpoints2 * sizeof(NSVGpoint);
+    // the old content is overwritten below
+    NSVGpoint* points2 = (NSVGpoint*)nsvg__realloc(r, NULL, 0, r->npoints * sizeof(NSVGpoint));
+    if (points2 == NULL) return;
+    if (r->points2 != NULL && r->arena == NULL) {
+      FreePool(r->points2);
+    }
+    r->points2 = points2;
     r->cpoints2 = r->npoints;
-    if (OldSize == 0) {
-      r->points2 = (NSVGpoint*)AllocatePool(r->npoints * sizeof(NSVGpoint));
-    } else
-      r->points2 = (NSVGpoint*)ReallocatePool(OldSize, sizeof(NSVGpoint) * r->cpoints2, r->points2);
-    if (r->points2 == NULL) return;
   }
 
   if (r->npoints) {
@@ -284,13 +262,11 @@ static void nsvg__addEdge(NSVGrasterizer* r, float x0, float y0, float x1, float
     return;
   //  DBG("nedges=%d cedges=%d\n", r->nedges, r->cedges);
   if (r->nedges+1 > r->cedges) {
-    int OldSize = r->cedges * sizeof(NSVGedge);
-    r->cedges = r->cedges > 0 ? r->cedges * 2 : 64;
-    if (OldSize == 0) {
-      r->edges = (NSVGedge*)AllocatePool(64 * sizeof(NSVGedge));
-    } else
-      r->edges = (NSVGedge*)ReallocatePool(OldSize, sizeof(NSVGedge) * r->cedges, r->edges);
-    if (r->edges == NULL) return;
+    int cedges = r->cedges > 0 ? r->cedges * 2 : 64;
+    NSVGedge* edges = (NSVGedge*)nsvg__realloc(r, r->edges, r->cedges * sizeof(NSVGedge), cedges * sizeof(NSVGedge));
+    if (edges == NULL) return;
+    r->edges = edges;
+    r->cedges = cedges;
   }
 
   e = &r->edges[r->nedges];
@@ -929,6 +905,103 @@ static void nsvg__flattenShapeStroke(NSVGrasterizer* r, NSVGshape* shape, float*
  }
  */
 
+// Float bits mapped to an unsigned key with the same order, so the radix sort gives exactly the order of y0.
+static inline UINT32 nsvg__edgeKey(float y)
+{
+  UINT32 u;
+  memcpy(&u, &y, sizeof(u));
+  return (u & 0x80000000U) ? ~u : (u | 0x80000000U);
+}
+
+// Stable sort of the edges by y0. Short arrays use an insertion sort, longer ones an LSD radix sort
+// through r->edges2, skipping the byte passes where all keys are the same (usually the high byte).
+static void nsvg__sortEdges(NSVGrasterizer* r)
+{
+  int n = r->nedges;
+  int i, d;
+
+  if (n < 2) return;
+
+  if (n <= NSVG__INSERTION_SORT_MAX) {
+    for (i = 1; i < n; i++) {
+      NSVGedge t = r->edges[i];
+      int j = i - 1;
+      while (j >= 0 && r->edges[j].y0 > t.y0) {
+        r->edges[j + 1] = r->edges[j];
+        j--;
+      }
+      r->edges[j + 1] = t;
+    }
+    return;
+  }
+
+  if (n > r->cedges2) {
+    // scratch only, no need to keep the content
+    NSVGedge* edges2 = (NSVGedge*)nsvg__realloc(r, NULL, 0, r->cedges * sizeof(NSVGedge));
+    if (edges2 == NULL) return;
+    if (r->edges2 != NULL && r->arena == NULL) {
+      FreePool(r->edges2);
+    }
+    r->edges2 = edges2;
+    r->cedges2 = r->cedges;
+  }
+
+  SetMem(r->radixCount, sizeof(r->radixCount), 0);
+  for (i = 0; i < n; i++) {
+    UINT32 k = nsvg__edgeKey(r->edges[i].y0);
+    for (d = 0; d < 4; d++) {
+      r->radixCount[d][(k >> (d * NSVG__RADIX_BITS)) & (NSVG__RADIX_SIZE - 1)]++;
+    }
+  }
+
+  NSVGedge* src = r->edges;
+  NSVGedge* dst = r->edges2;
+  UINT32 first = nsvg__edgeKey(src[0].y0);
+  for (d = 0; d < 4; d++) {
+    UINT32* count = r->radixCount[d];
+    int shift = d * NSVG__RADIX_BITS;
+    UINT32 sum = 0;
+    if (count[(first >> shift) & (NSVG__RADIX_SIZE - 1)] == (UINT32)n) {
+      continue;
+    }
+    for (i = 0; i < NSVG__RADIX_SIZE; i++) {
+      UINT32 c = count[i];
+      count[i] = sum;
+      sum += c;
+    }
+    for (i = 0; i < n; i++) {
+      dst[count[(nsvg__edgeKey(src[i].y0) >> shift) & (NSVG__RADIX_SIZE - 1)]++] = src[i];
+    }
+    NSVGedge* t = src; src = dst; dst = t;
+  }
+
+  if (src != r->edges) {
+    int c = r->cedges;
+    r->edges2 = r->edges;
+    r->edges = src;
+    r->cedges = r->cedges2;
+    r->cedges2 = c;
+  }
+}
+
+// Active edges live in a flat array with one slot per edge of the shape, so taking one never allocates
+// during the scan. Reserved before each shape, the old content is not needed.
+static int nsvg__reserveActive(NSVGrasterizer* r)
+{
+  if (r->nedges > r->cactive) {
+    NSVGactiveEdge* active = (NSVGactiveEdge*)nsvg__realloc(r, NULL, 0, r->cedges * sizeof(NSVGactiveEdge));
+    if (active == NULL) return 0;
+    if (r->active != NULL && r->arena == NULL) {
+      FreePool(r->active);
+    }
+    r->active = active;
+    r->cactive = r->cedges;
+  }
+  r->nactive = 0;
+  r->freelist = NULL;
+  return 1;
+}
+
 static NSVGactiveEdge* nsvg__addActive(NSVGrasterizer* r, NSVGedge* e, float startPoint)
 {
   NSVGactiveEdge* z;
@@ -938,9 +1011,8 @@ static NSVGactiveEdge* nsvg__addActive(NSVGrasterizer* r, NSVGedge* e, float sta
     z = r->freelist;
     r->freelist = z->next;
   } else {
-    // Alloc new edge.
-    z = (NSVGactiveEdge*)nsvg__alloc(r, sizeof(NSVGactiveEdge));
-    if (z == NULL) return NULL;
+    if (r->nactive >= r->cactive) return NULL;
+    z = &r->active[r->nactive++];
   }
 
   float dxdy = (e->x1 - e->x0) / (e->y1 - e->y0);
@@ -965,7 +1037,25 @@ static void nsvg__freeActive(NSVGrasterizer* r, NSVGactiveEdge* z)
   r->freelist = z;
 }
 
-static void nsvg__fillScanline(unsigned char* scanline, int len, int x0, int x1, int maxWeight, int* xmin, int* xmax)
+// Adds weight to count coverage bytes, wrapping like the byte arithmetic of the scanline.
+static void nsvg__addCoverage(unsigned char* p, int count, int weight)
+{
+  int i = 0;
+#if NSVG_SSE2 == 1
+  if (MemoryOperationGetSimd()) {
+    NSVG_V16B_UNALIGNED w = {};
+    w += (unsigned char)weight;
+    for ( ; i + 16 <= count; i += 16) {
+      *(NSVG_V16B_UNALIGNED*)(p + i) += w;
+    }
+  }
+#endif
+  for ( ; i < count; i++) {
+    p[i] = (unsigned char)(p[i] + weight);
+  }
+}
+
+void nsvg__fillScanline(unsigned char* scanline, int len, int x0, int x1, int maxWeight, int* xmin, int* xmax)
 {
   int i = x0 >> NSVG__FIXSHIFT;
   int j = x1 >> NSVG__FIXSHIFT;
@@ -986,8 +1076,7 @@ static void nsvg__fillScanline(unsigned char* scanline, int len, int x0, int x1,
       else
         j = len; // clip
 
-      for (++i; i < j; ++i) // fill pixels between x0 and x1
-        scanline[i] = (unsigned char)(scanline[i] + maxWeight);
+      nsvg__addCoverage(scanline + i + 1, j - i - 1, maxWeight); // fill pixels between x0 and x1
     }
   }
 }
@@ -1078,136 +1167,173 @@ static void nsvg__scanlineBit(
   }
 }
 
-static void nsvg__scanlineSolid(unsigned char* row, int count, unsigned char* cover, int x, int y,
+// Puts one pixel of color c (not premultiplied, r in the low byte) with coverage cover over premultiplied dst.
+static inline void nsvg__blendPixel(unsigned char* dst, unsigned int c, int cover)
+{
+  int r,g,b;
+  int a = nsvg__div255(cover * (int)((c >> 24) & 0xff));
+  int ia = 255 - a;
+  // Premultiply
+  r = nsvg__div255((int)(c & 0xff) * a);
+  g = nsvg__div255((int)((c >> 8) & 0xff) * a);
+  b = nsvg__div255((int)((c >> 16) & 0xff) * a);
+
+  // Blend over
+  r += nsvg__div255(ia * (int)dst[0]);
+  g += nsvg__div255(ia * (int)dst[1]);
+  b += nsvg__div255(ia * (int)dst[2]);
+  a += nsvg__div255(ia * (int)dst[3]);
+
+  dst[0] = (unsigned char)r;
+  dst[1] = (unsigned char)g;
+  dst[2] = (unsigned char)b;
+  dst[3] = (unsigned char)a;
+}
+
+#if NSVG_SSE2 == 1
+static inline NSVG_V4U nsvg__div255V(NSVG_V4U x)
+{
+  return ((x + 1) * 257) >> 16;
+}
+
+// nsvg__blendPixel() for 4 pixels
+static inline NSVG_V4U nsvg__blend4(NSVG_V4U d, NSVG_V4U c, NSVG_V4U cover)
+{
+  NSVG_V4U a = nsvg__div255V(cover * (c >> 24));
+  NSVG_V4U ia = 255 - a;
+  NSVG_V4U res = (a + nsvg__div255V(ia * (d >> 24))) << 24;
+  for (int shift = 0; shift < 24; shift += 8) {
+    NSVG_V4U v = nsvg__div255V(((c >> shift) & 0xff) * a) + nsvg__div255V(ia * ((d >> shift) & 0xff));
+    res |= (v & 0xff) << shift;
+  }
+  return res;
+}
+
+static inline NSVG_V4U nsvg__cover4(const unsigned char* cover)
+{
+  NSVG_V4U v = { cover[0], cover[1], cover[2], cover[3] };
+  return v;
+}
+
+// SqrtF() on 4 lanes, same operations so the same result
+static inline NSVG_V4F nsvg__sqrt4(NSVG_V4F x)
+{
+  NSVG_V4U zero = (NSVG_V4U)(x == 0.0f);
+  NSVG_V4F y;
+  x = (NSVG_V4F)((NSVG_V4U)x & 0x7fffffff);
+  y = x * 0.3f;
+  for (int i = 0; i < 6; i++) {
+    y = y * 0.5f + x / (y * 2.0f);
+  }
+  return (NSVG_V4F)((NSVG_V4U)y & ~zero);
+}
+#endif
+
+// Blends count pixels, each with its own color.
+static void nsvg__blendSpan(unsigned char* dst, const unsigned char* cover, const unsigned int* colors, int count)
+{
+  int i = 0;
+#if NSVG_SSE2 == 1
+  if (MemoryOperationGetSimd()) {
+    for ( ; i + 4 <= count; i += 4) {
+      NSVG_V4U_UNALIGNED* d = (NSVG_V4U_UNALIGNED*)(dst + i * 4);
+      if ((cover[i] | cover[i + 1] | cover[i + 2] | cover[i + 3]) == 0) {
+        continue; // no coverage doesn't change dst
+      }
+      *d = nsvg__blend4(*d, *(const NSVG_V4U_UNALIGNED*)(colors + i), nsvg__cover4(cover + i));
+    }
+  }
+#endif
+  for ( ; i < count; i++) {
+    nsvg__blendPixel(dst + i * 4, colors[i], cover[i]);
+  }
+}
+
+void nsvg__scanlineSolid(unsigned char* row, int count, unsigned char* cover, int x, int y,
                                 /*  float tx, float ty, float scalex, float scaley, */ NSVGcachedPaint* cache)
 {
   //  static int once = 0;
   unsigned char* dst = row + x*4;
   if (cache->type == NSVG_PAINT_COLOR) {
-    int i, cr, cg, cb, ca;
-    cr = cache->colors[0] & 0xff;
-    cg = (cache->colors[0] >> 8) & 0xff;
-    cb = (cache->colors[0] >> 16) & 0xff;
-    ca = (cache->colors[0] >> 24) & 0xff;
-
-    for (i = 0; i < count; i++) {
-      int r,g,b;
-      int a = nsvg__div255((int)cover[0] * ca);
-      int ia = 255 - a;
-      // Premultiply
-      r = nsvg__div255(cr * a);
-      g = nsvg__div255(cg * a);
-      b = nsvg__div255(cb * a);
-
-      // Blend over
-      r += nsvg__div255(ia * (int)dst[0]);
-      g += nsvg__div255(ia * (int)dst[1]);
-      b += nsvg__div255(ia * (int)dst[2]);
-      a += nsvg__div255(ia * (int)dst[3]);
-
-      dst[0] = (unsigned char)r;
-      dst[1] = (unsigned char)g;
-      dst[2] = (unsigned char)b;
-      dst[3] = (unsigned char)a;
-
-      cover++;
-      dst += 4;
+    unsigned int c = cache->colors[0];
+    int i = 0;
+#if NSVG_SSE2 == 1
+    if (MemoryOperationGetSimd()) {
+      NSVG_V4U cv = { c, c, c, c };
+      for ( ; i + 4 <= count; i += 4) {
+        NSVG_V4U_UNALIGNED* d = (NSVG_V4U_UNALIGNED*)(dst + i * 4);
+        UINT32 cover4 = cover[i] | (cover[i + 1] << 8) | (cover[i + 2] << 16) | ((UINT32)cover[i + 3] << 24);
+        if (cover4 == 0) {
+          continue;
+        }
+        if (cover4 == 0xffffffff && (c >> 24) == 0xff) {
+          *d = cv; // opaque inside of the shape
+          continue;
+        }
+        *d = nsvg__blend4(*d, cv, nsvg__cover4(cover + i));
+      }
+    }
+#endif
+    for ( ; i < count; i++) {
+      nsvg__blendPixel(dst + i * 4, c, cover[i]);
     }
   } else if (cache->type == NSVG_PAINT_LINEAR_GRADIENT) {
     // TODO: spread modes.
-    // TODO: plenty of opportunities to optimize.
     float fx, fy, gy;
     float* t = cache->xform;
-
-    //    DumpFloat("cache grad xform", t, 6);
-    int i, cr, cg, cb, ca;
-    unsigned int c;
+    unsigned int colors[NSVG__SPAN];
+    int i, n;
+    int level = cache->coarse;
     //x,y - pixels
     fx = (float)x;
     fy = (float)y;
-    //    dx = 1.0f;
     gy = fx*t[1] + fy*t[3] + t[5]; //gradient direction. Point at cut
 
-    for (i = 0; i < count; i++) {
-      int r,g,b,a,ia;
-      int level = cache->coarse;
-      c = cache->colors[dither(nsvg__clampf(gy*(255.0f-level), 0, (float)(255-level)), level)]; //assumed gy = 0.0 ... 1.0f
-      cr = (c) & 0xff;
-      cg = (c >> 8) & 0xff;
-      cb = (c >> 16) & 0xff;
-      ca = (c >> 24) & 0xff;
-      a = nsvg__div255((int)cover[0] * ca);
-      ia = 255 - a;
-
-      // Premultiply
-      r = nsvg__div255(cr * a);
-      g = nsvg__div255(cg * a);
-      b = nsvg__div255(cb * a);
-      // Blend over
-      r += nsvg__div255(ia * (int)dst[0]);
-      g += nsvg__div255(ia * (int)dst[1]);
-      b += nsvg__div255(ia * (int)dst[2]);
-      a += nsvg__div255(ia * (int)dst[3]);
-      dst[0] = (unsigned char)r;
-      dst[1] = (unsigned char)g;
-      dst[2] = (unsigned char)b;
-      dst[3] = (unsigned char)a;
-
-      cover++;
-      dst += 4;
-      //      fx += dx;
-      gy += t[1];
+    for (i = 0; i < count; i += n) {
+      n = count - i < NSVG__SPAN ? count - i : NSVG__SPAN;
+      // dither_r() draws random numbers, the colors are chosen in pixel order
+      for (int k = 0; k < n; k++) {
+        colors[k] = cache->colors[dither_r(nsvg__clampf(gy*(255.0f-level), 0, (float)(255-level)), level, cache->ditherSeed)]; //assumed gy = 0.0 ... 1.0f
+        gy += t[1];
+      }
+      nsvg__blendSpan(dst + i * 4, cover + i, colors, n);
     }
   } else if (cache->type == NSVG_PAINT_RADIAL_GRADIENT) {
     // TODO: spread modes.
-    // TODO: plenty of opportunities to optimize.
     // TODO: focus (fx,fy)
-    float fx, fy, gx, gy, gd;
+    float fx, fy, gx, gy;
     float* t = cache->xform;
-    //    DumpFloat("cache grad xform", t, 6);
-    int i, cr, cg, cb, ca;
-    unsigned int c;
+    unsigned int colors[NSVG__SPAN];
+    float gd[NSVG__SPAN];
+    int i, n;
+    int level = cache->coarse;
     fx = (float)x;
     fy = (float)y;
-    //    dx = 1.0f;
     gx = fx*t[0] + fy*t[2] + t[4];
     gy = fx*t[1] + fy*t[3] + t[5];
 
-    for (i = 0; i < count; i++) {
-      int r,g,b,a,ia;
-      gd = sqrtf(gx*gx + gy*gy);
-      //     DBG("gx=%f gy=%f\n", gx, gy);
-      int level = cache->coarse;
-      c = cache->colors[dither(nsvg__clampf(gd*(255.0f-level*2), 0, (254.99f-level*2)), level)];
-      cr = (c) & 0xff;
-      cg = (c >> 8) & 0xff;
-      cb = (c >> 16) & 0xff;
-      ca = (c >> 24) & 0xff;
-
-      a = nsvg__div255((int)cover[0] * ca);
-      ia = 255 - a;
-
-      // Premultiply
-      r = nsvg__div255(cr * a);
-      g = nsvg__div255(cg * a);
-      b = nsvg__div255(cb * a);
-
-      // Blend over
-      r += nsvg__div255(ia * (int)dst[0]);
-      g += nsvg__div255(ia * (int)dst[1]);
-      b += nsvg__div255(ia * (int)dst[2]);
-      a += nsvg__div255(ia * (int)dst[3]);
-
-      dst[0] = (unsigned char)r;
-      dst[1] = (unsigned char)g;
-      dst[2] = (unsigned char)b;
-      dst[3] = (unsigned char)a;
-
-      cover++;
-      dst += 4;
-      //      fx += dx;
-      gx += t[0];
-      gy += t[1];
+    for (i = 0; i < count; i += n) {
+      int k = 0;
+      n = count - i < NSVG__SPAN ? count - i : NSVG__SPAN;
+      for (int j = 0; j < n; j++) {
+        gd[j] = gx*gx + gy*gy; // squared here, sqrt below
+        gx += t[0];
+        gy += t[1];
+      }
+#if NSVG_SSE2 == 1
+      if (MemoryOperationGetSimd()) {
+        for ( ; k + 4 <= n; k += 4) {
+          *(NSVG_V4F_UNALIGNED*)(gd + k) = nsvg__sqrt4(*(NSVG_V4F_UNALIGNED*)(gd + k));
+        }
+      }
+#endif
+      for ( ; k < n; k++) {
+        gd[k] = sqrtf(gd[k]);
+      }
+      for (k = 0; k < n; k++) {
+        colors[k] = cache->colors[dither_r(nsvg__clampf(gd[k]*(255.0f-level*2), 0, (254.99f-level*2)), level, cache->ditherSeed)];
+      }
+      nsvg__blendSpan(dst + i * 4, cover + i, colors, n);
     }
   } else if (cache->type == NSVG_PAINT_PATTERN) {
     // TODO
@@ -1216,7 +1342,7 @@ static void nsvg__scanlineSolid(unsigned char* row, int count, unsigned char* co
 //    EG_IMAGE *Pattern = (EG_IMAGE *)cache->image;
     XImage *Pattern = (XImage*)cache->image;
     if (!Pattern) {
-      DBG("no pattern to fill\n");
+      // no log, this may run on an AP
       return;
     }
     INTN Width = Pattern->GetWidth();
@@ -1232,8 +1358,8 @@ static void nsvg__scanlineSolid(unsigned char* row, int count, unsigned char* co
       int r,g,b,a,ia;
       gx = fx*t[0] + fy*t[2] + t[4];
       gy = fx*t[1] + fy*t[3] + t[5];
-      ix = dither(gx * Width, 2) % Width;
-      iy = dither(gy * Height, 2) % Height;
+      ix = dither_r(gx * Width, 2, cache->ditherSeed) % Width;
+      iy = dither_r(gy * Height, 2, cache->ditherSeed) % Height;
 //      j = iy * Width + ix;
       EFI_GRAPHICS_OUTPUT_BLT_PIXEL cp = Pattern->GetPixel(ix, iy);
 //      cr = Pattern->PixelData[j].r;
@@ -1243,10 +1369,16 @@ static void nsvg__scanlineSolid(unsigned char* row, int count, unsigned char* co
  //     cr = cp.Red;
       a = nsvg__div255((int)cover[0] * cp.Reserved);
       ia = 255 - a;
-      // Premultiply
-      r = nsvg__div255(cp.Red * a);
-      g = nsvg__div255(cp.Green * a);
-      b = nsvg__div255(cp.Blue * a);
+      if (Pattern->isPremultiplied()) {
+        r = nsvg__div255(cp.Red * (int)cover[0]);
+        g = nsvg__div255(cp.Green * (int)cover[0]);
+        b = nsvg__div255(cp.Blue * (int)cover[0]);
+      } else {
+        // Premultiply
+        r = nsvg__div255(cp.Red * a);
+        g = nsvg__div255(cp.Green * a);
+        b = nsvg__div255(cp.Blue * a);
+      }
 
       // Blend over
       r += nsvg__div255(ia * (int)dst[0]);
@@ -1266,57 +1398,30 @@ static void nsvg__scanlineSolid(unsigned char* row, int count, unsigned char* co
 
   } else if (cache->type == NSVG_PAINT_CONIC_GRADIENT) {
     // TODO: spread modes.
-    // TODO: plenty of opportunities to optimize.
     // TODO: focus (fx,fy)
     float fx, fy, gx, gy, gd;
     float* t = cache->xform;
-    //    DumpFloat("cache grad xform", t, 6);
-    int i, cr, cg, cb, ca;
-    unsigned int c;
+    unsigned int colors[NSVG__SPAN];
+    int i, n;
 
     fx = (float)x;
     fy = (float)y;
-    //     dx = 1.0f;
     gx = fx*t[0] + fy*t[2] + t[4];
     gy = fx*t[1] + fy*t[3] + t[5];
 
-    for (i = 0; i < count; i++) {
-      int r,g,b,a,ia;
-      if ((gx == 0.f) && (gy == 0.f)) {
-        c = 0;
-      } else {
-        gd = (Atan2F(gy, gx) + PI) / PI2;
-        c = cache->colors[dither(nsvg__clampf(gd*254.0f, 0, 253.99f), 1)];
+    for (i = 0; i < count; i += n) {
+      n = count - i < NSVG__SPAN ? count - i : NSVG__SPAN;
+      for (int k = 0; k < n; k++) {
+        if ((gx == 0.f) && (gy == 0.f)) {
+          colors[k] = 0;
+        } else {
+          gd = (Atan2F(gy, gx) + PI) / PI2;
+          colors[k] = cache->colors[dither_r(nsvg__clampf(gd*254.0f, 0, 253.99f), 1, cache->ditherSeed)];
+        }
+        gx += t[0];
+        gy += t[1];
       }
-      cr = (c) & 0xff;
-      cg = (c >> 8) & 0xff;
-      cb = (c >> 16) & 0xff;
-      ca = (c >> 24) & 0xff;
-
-      a = nsvg__div255((int)cover[0] * ca);
-      ia = 255 - a;
-
-      // Premultiply
-      r = nsvg__div255(cr * a);
-      g = nsvg__div255(cg * a);
-      b = nsvg__div255(cb * a);
-
-      // Blend over
-      r += nsvg__div255(ia * (int)dst[0]);
-      g += nsvg__div255(ia * (int)dst[1]);
-      b += nsvg__div255(ia * (int)dst[2]);
-      a += nsvg__div255(ia * (int)dst[3]);
-
-      dst[0] = (unsigned char)r;
-      dst[1] = (unsigned char)g;
-      dst[2] = (unsigned char)b;
-      dst[3] = (unsigned char)a;
-
-      cover++;
-      dst += 4;
-      //        fx += dx;
-      gx += t[0];
-      gy += t[1];
+      nsvg__blendSpan(dst + i * 4, cover + i, colors, n);
     }
   }
 }
@@ -1332,6 +1437,14 @@ static void nsvg__rasterizeSortedEdges(NSVGrasterizer *r,
   int xmin, xmax;
 
   for (y = 0; y < r->height; y++) {
+    if (active == NULL) {
+      // nothing to draw until the next edge starts, jump to its first row
+      int row;
+      if (e >= r->nedges) break;
+      row = (int)floorf((r->edges[e].y0 - 0.5f) / NSVG__SUBSAMPLES);
+      if (row >= r->height) break;
+      if (row > y) y = row;
+    }
     SetMem(r->scanline, r->width, 0);
     xmin = r->width;
     xmax = 0;
@@ -1630,14 +1743,10 @@ static void nsvg__rasterizeShapes(NSVGrasterizer* r,
   r->fscanline = fscanline;
 
   if (w > r->cscanline) {
-    int oldw = r->cscanline;
+    unsigned char* scanline = (unsigned char*)nsvg__realloc(r, r->scanline, r->cscanline, w);
+    if (scanline == NULL) return;
+    r->scanline = scanline;
     r->cscanline = w;
-    if (oldw == 0) {
-      r->scanline = (unsigned char*)AllocatePool(w);
-    } else {
-      r->scanline = (unsigned char*)ReallocatePool(oldw, w, r->scanline);
-    }
-    if (r->scanline == NULL) return;
   }
 
   nsvg__xformSetScale(&xform2[0], scalex, scaley);
@@ -1685,10 +1794,9 @@ static void renderShape(NSVGrasterizer* r,
   NSVGcachedPaint cache;
   int i;
   SetMem(&cache, sizeof(NSVGcachedPaint), 0);
+  cache.ditherSeed = &r->ditherSeed;
 
   if (shape->fill.type != NSVG_PAINT_NONE) {
-    nsvg__resetPool(r);
-    r->freelist = NULL;
     r->nedges = 0;
 
     nsvg__flattenShape(r, shape, xform);
@@ -1700,15 +1808,14 @@ static void renderShape(NSVGrasterizer* r,
     }
 
     // Rasterize edges
-    qsort(r->edges, r->nedges, sizeof(NSVGedge), NULL);
+    nsvg__sortEdges(r);
+    if (!nsvg__reserveActive(r)) return;
 
     // now, traverse the scanlines and find the intersections on each scanline, use non-zero rule
     nsvg__initPaint(&cache, &shape->fill, shape, xform);
     nsvg__rasterizeSortedEdges(r, &cache, shape->fillRule, &shape->clip);
   }
   if (shape->stroke.type != NSVG_PAINT_NONE && (shape->strokeWidth * min_scale) > 0.01f) {
-    nsvg__resetPool(r);
-    r->freelist = NULL;
     r->nedges = 0;
     nsvg__flattenShapeStroke(r, shape, xform);
 
@@ -1720,7 +1827,8 @@ static void renderShape(NSVGrasterizer* r,
     }
 
     // Rasterize edges
-    qsort(r->edges, r->nedges, sizeof(NSVGedge), NULL);
+    nsvg__sortEdges(r);
+    if (!nsvg__reserveActive(r)) return;
 
     // now, traverse the scanlines and find the intersections on each scanline, use non-zero rule
     nsvg__initPaint(&cache, &shape->stroke, shape, xform);
@@ -1745,19 +1853,21 @@ void nsvg__rasterizeClipPaths(
     clipPathCount++;
     clipPath = clipPath->next;
   }
-  UINTN oldSize = r->stencilSize * clipPathCount;
   r->stencilStride = w / 8 + (w % 8 != 0 ? 1 : 0);
   r->stencilSize = h * r->stencilStride;
   // r->stencil = (unsigned char*)realloc(
   //                                      r->stencil, r->stencilSize * clipPathCount);
-  if (oldSize == 0) {
-    r->stencil = (unsigned char*)AllocateZeroPool(r->stencilSize * clipPathCount);
-    if (r->stencil == NULL) return;
-  } else {
-    r->stencil = (unsigned char*)ReallocatePool(oldSize, r->stencilSize * clipPathCount, r->stencil);
-    if (r->stencil == NULL) return;
-    SetMem(r->stencil, r->stencilSize * clipPathCount, 0);
+  if (r->stencilSize * clipPathCount > r->cstencil) {
+    // cleared below, no need to keep the content
+    unsigned char* stencil = (unsigned char*)nsvg__realloc(r, NULL, 0, r->stencilSize * clipPathCount);
+    if (stencil == NULL) return;
+    if (r->stencil != NULL && r->arena == NULL) {
+      FreePool(r->stencil);
+    }
+    r->stencil = stencil;
+    r->cstencil = r->stencilSize * clipPathCount;
   }
+  SetMem(r->stencil, r->stencilSize * clipPathCount, 0);
 
   clipPath = image->clipPaths;
   while (clipPath != NULL) {
@@ -1768,7 +1878,7 @@ void nsvg__rasterizeClipPaths(
   }
 }
 
-void nsvgRasterize(NSVGrasterizer* r,
+void nsvgRasterizePremultiplied(NSVGrasterizer* r,
                    NSVGimage* image, float tx, float ty, float scalex, float scaley,
                    unsigned char* dst, int w, int h, int stride)
 {
@@ -1782,11 +1892,21 @@ void nsvgRasterize(NSVGrasterizer* r,
 //    DBG("  image will be shifted by [%f,%f]\n", tx, ty);
 //   DumpFloat("  image real bounds ", image->realBounds, 4);
 
+  r->outOfMemory = 0;
   nsvg__rasterizeClipPaths(r, image, w, h, tx, ty, scalex, scaley);
+  if (r->outOfMemory) {
+    return; // clipped shapes would read a missing stencil
+  }
 
   nsvg__rasterizeShapes(r, image->shapes, tx, ty, scalex, scaley,
                         dst, w, h, stride, nsvg__scanlineSolid);
+}
 
+void nsvgRasterize(NSVGrasterizer* r,
+                   NSVGimage* image, float tx, float ty, float scalex, float scaley,
+                   unsigned char* dst, int w, int h, int stride)
+{
+  nsvgRasterizePremultiplied(r, image, tx, ty, scalex, scaley, dst, w, h, stride);
   nsvg__unpremultiplyAlpha(dst, w, h, stride);
 }
 
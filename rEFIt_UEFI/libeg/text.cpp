@@ -65,6 +65,127 @@ extern "C" {
 const EFI_GRAPHICS_OUTPUT_BLT_PIXEL SemiWhitePixel = {0xFF, 0xFF, 0xFF, 0xD2}; //semitransparent white
 NSVGfontChain *fontsDB = NULL;
 
+//
+// Rendered strings cache
+//
+// Menus redraw the same strings (entry titles, help, options) every time. A raster font string depends on
+// the render parameters and on what is in the buffer before (background, selection bar), so the entry is keyed
+// by both, the buffer by a hash of its pixels. A hit is one copy of the rendered buffer.
+// Emptied by PrepareFont().
+//
+#define TEXT_CACHE_ENTRIES    32
+#define TEXT_CACHE_MAX_BYTES  (4 * 1024 * 1024)
+
+class TEXT_CACHE_ENTRY
+{
+public:
+  XStringW  Text;
+  INTN      PosX;
+  INTN      PosY;
+  UINTN     Cursor;
+  INTN      TextType;
+  UINT32    Scale;      // bits of the float
+  INTN      Language;
+  INTN      Width;
+  INTN      Height;
+  bool      Premultiplied;
+  UINT64    BackHash;   // buffer before rendering
+  XImage    Image;      // buffer after rendering
+  INTN      EndX;       // RenderText() result
+  UINT64    LastUse;
+
+  TEXT_CACHE_ENTRY() : Text(), PosX(0), PosY(0), Cursor(0), TextType(0), Scale(0), Language(0), Width(0), Height(0),
+                       Premultiplied(false), BackHash(0), Image(), EndX(0), LastUse(0) {}
+  TEXT_CACHE_ENTRY(const TEXT_CACHE_ENTRY& other) = delete; // Can be defined if needed
+  const TEXT_CACHE_ENTRY& operator = ( const TEXT_CACHE_ENTRY & ) = delete; // Can be defined if needed
+};
+
+static XObjArray<TEXT_CACHE_ENTRY> TextCache;
+static UINTN                       TextCacheBytes = 0;
+static UINT64                      TextCacheClock = 0;
+
+static UINTN TextCacheImageBytes(const XImage& Image)
+{
+  return (UINTN)Image.GetWidth() * (UINTN)Image.GetHeight() * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+}
+
+// not a checksum, only to tell buffers apart
+static UINT64 TextCacheHash(const XImage& Image)
+{
+  const UINT32* p = (const UINT32*)Image.GetPixelPtr(0, 0);
+  UINTN Count = TextCacheImageBytes(Image) / sizeof(UINT32);
+  UINT64 Hash = 0xCBF29CE484222325ULL;
+  for (UINTN i = 0; i < Count; i++) {
+    Hash = (Hash ^ p[i]) * 0x100000001B3ULL;
+  }
+  return Hash ^ (Hash >> 29);
+}
+
+static UINT32 TextCacheFloatBits(float f)
+{
+  UINT32 Bits;
+  CopyMem(&Bits, &f, sizeof(Bits));
+  return Bits;
+}
+
+static void TextCacheClear()
+{
+  TextCache.setEmpty();
+  TextCacheBytes = 0;
+}
+
+static TEXT_CACHE_ENTRY* TextCacheFind(const XStringW& Text, const XImage& CompImage, UINT64 BackHash,
+                                       INTN PosX, INTN PosY, UINTN Cursor, INTN TextType, float Scale)
+{
+  for (size_t Index = 0; Index < TextCache.size(); Index++) {
+    TEXT_CACHE_ENTRY& Entry = TextCache[Index];
+    if (Entry.BackHash == BackHash && Entry.Width == CompImage.GetWidth() && Entry.Height == CompImage.GetHeight() &&
+        Entry.Premultiplied == CompImage.isPremultiplied() && Entry.PosX == PosX && Entry.PosY == PosY &&
+        Entry.Cursor == Cursor && Entry.TextType == TextType && Entry.Scale == TextCacheFloatBits(Scale) &&
+        Entry.Language == (INTN)gLanguage && Entry.Text == Text) {
+      return &Entry;
+    }
+  }
+  return NULL;
+}
+
+static void TextCachePut(const XStringW& Text, const XImage& CompImage, UINT64 BackHash,
+                         INTN PosX, INTN PosY, UINTN Cursor, INTN TextType, float Scale, INTN EndX)
+{
+  UINTN Bytes = TextCacheImageBytes(CompImage);
+  if (Bytes > TEXT_CACHE_MAX_BYTES / 4) {
+    return;
+  }
+  // drop the least recently used entries
+  while (TextCache.size() > 0 && (TextCache.size() >= TEXT_CACHE_ENTRIES || TextCacheBytes + Bytes > TEXT_CACHE_MAX_BYTES)) {
+    size_t Oldest = 0;
+    for (size_t Index = 1; Index < TextCache.size(); Index++) {
+      if (TextCache[Index].LastUse < TextCache[Oldest].LastUse) {
+        Oldest = Index;
+      }
+    }
+    TextCacheBytes -= TextCacheImageBytes(TextCache[Oldest].Image);
+    TextCache.RemoveAtIndex(Oldest);
+  }
+  TEXT_CACHE_ENTRY* Entry = new TEXT_CACHE_ENTRY;
+  Entry->Text = Text;
+  Entry->PosX = PosX;
+  Entry->PosY = PosY;
+  Entry->Cursor = Cursor;
+  Entry->TextType = TextType;
+  Entry->Scale = TextCacheFloatBits(Scale);
+  Entry->Language = (INTN)gLanguage;
+  Entry->Width = CompImage.GetWidth();
+  Entry->Height = CompImage.GetHeight();
+  Entry->Premultiplied = CompImage.isPremultiplied();
+  Entry->BackHash = BackHash;
+  Entry->Image = CompImage;
+  Entry->EndX = EndX;
+  Entry->LastUse = ++TextCacheClock;
+  TextCache.AddReference(Entry, true);
+  TextCacheBytes += Bytes;
+}
+
 //
 // Text rendering
 //
@@ -98,7 +219,7 @@ void XTheme::LoadFontImage(IN BOOLEAN UseEmbedded, IN INTN Rows, IN INTN Cols)
   const XStringW& commonFontDir = L"font"_XSW;
 
   if (IsEmbeddedTheme() && !isKorean) { //or initial screen before theme init
-    Status = NewImage.FromPNG(ACCESS_EMB_DATA(emb_font_data), ACCESS_EMB_SIZE(emb_font_data)); //always success
+    Status = NewImage.FromRLE(ACCESS_EMB_DATA(emb_font_data_rle), ACCESS_EMB_SIZE(emb_font_data_rle)); //always success
     MsgLog("Using embedded font\n");
   } else if (isKorean){
     Status = NewImage.LoadXImage(ThemeDir, L"FontKorean.png"_XSW);
@@ -125,7 +246,7 @@ void XTheme::LoadFontImage(IN BOOLEAN UseEmbedded, IN INTN Rows, IN INTN Cols)
     Status = NewImage.LoadXImage(&self.getCloverDir(), fontFilePath);
     //else use embedded even if it is not embedded
     if (EFI_ERROR(Status)) {
-      Status = NewImage.FromPNG(ACCESS_EMB_DATA(emb_font_data), ACCESS_EMB_SIZE(emb_font_data));
+      Status = NewImage.FromRLE(ACCESS_EMB_DATA(emb_font_data_rle), ACCESS_EMB_SIZE(emb_font_data_rle));
     }
     if (EFI_ERROR(Status)) {
       MsgLog("No font found!\n");
@@ -133,6 +254,7 @@ void XTheme::LoadFontImage(IN BOOLEAN UseEmbedded, IN INTN Rows, IN INTN Cols)
     }
   }
 
+  NewImage.Unpremultiply(); //the colors are compared and changed below
   ImageWidth = NewImage.GetWidth();
   //  DBG("ImageWidth=%lld\n", ImageWidth);
   ImageHeight = NewImage.GetHeight();
@@ -173,6 +295,7 @@ void XTheme::LoadFontImage(IN BOOLEAN UseEmbedded, IN INTN Rows, IN INTN Cols)
 
 void XTheme::PrepareFont()
 {
+  TextCacheClear();
 
   TextHeight = FontHeight + (int)(TEXT_YMARGIN * 2 * Scale);
   if (TypeSVG) {
@@ -199,6 +322,7 @@ void XTheme::PrepareFont()
       }
  //     FontImage.Draw(0, 300, 0.6f); //for debug purpose
     }
+    PrepareGlyphMetrics();
     DBG("Font %d prepared WxH=%lldx%lld CharWidth=%lld\n", Font, FontWidth, FontHeight, CharWidth);
 
   } else {
@@ -251,6 +375,20 @@ INTN XTheme::GetEmpty(const XImage& Buffer, const EFI_GRAPHICS_OUTPUT_BLT_PIXEL&
   return m;
 }
 
+//the right space of a char depends only on the font, measured once for all chars
+void XTheme::PrepareGlyphMetrics()
+{
+  SetMem(GlyphRightSpace, sizeof(GlyphRightSpace), 0);
+  GlyphMetricsWidth = FontWidth;
+  if (FontImage.isEmpty()) {
+    return;
+  }
+  const EFI_GRAPHICS_OUTPUT_BLT_PIXEL FontPixel = FontImage.GetPixel(0,0);
+  for (INTN c = 0; c < 256 && (c + 1) * FontWidth <= FontImage.GetWidth(); c++) {
+    GlyphRightSpace[c] = GetEmpty(FontImage, FontPixel, FontWidth, c * FontWidth, 1); //not scaled yet
+  }
+}
+
 INTN XTheme::RenderText(IN const XString8& Text, OUT XImage* CompImage_ptr,
                         IN INTN PosX, IN INTN PosY, IN UINTN Cursor, INTN textType, float textScale)
 {
@@ -263,7 +401,6 @@ INTN XTheme::RenderText(IN const XStringW& Text, OUT XImage* CompImage_ptr,
 {
   XImage& CompImage = *CompImage_ptr;
 
-  EFI_GRAPHICS_OUTPUT_BLT_PIXEL    FontPixel;
   EFI_GRAPHICS_OUTPUT_BLT_PIXEL    FirstPixel;
   UINTN           TextLength;
   UINTN          Cho = 0, Jong = 0, Joong = 0;
@@ -284,10 +421,25 @@ INTN XTheme::RenderText(IN const XStringW& Text, OUT XImage* CompImage_ptr,
   if (FontImage.isEmpty()) {
     PrepareFont(); //at the boot screen there is embedded font
   }
+  if (GlyphMetricsWidth != FontWidth) {
+    PrepareGlyphMetrics();
+  }
+
+  // same text over the same buffer as before, take the result
+  UINT64 BackHash = 0;
+  if (!CompImage.isEmpty()) {
+    BackHash = TextCacheHash(CompImage);
+    TEXT_CACHE_ENTRY* Entry = TextCacheFind(Text, CompImage, BackHash, PosX, PosY, Cursor, textType, textScale);
+    if (Entry != NULL) {
+      CopyMem(CompImage.GetPixelPtr(0,0), Entry->Image.GetPixelPtr(0,0), TextCacheImageBytes(CompImage));
+      Entry->LastUse = ++TextCacheClock;
+      return Entry->EndX;
+    }
+  }
+  const INTN StartX = PosX;
 
   DBG("TextLength =%lld PosX=%lld PosY=%lld\n", TextLength, PosX, PosY);
   FirstPixel = CompImage.GetPixel(0,0);
-  FontPixel  = FontImage.GetPixel(0,0);
   UINT16 c0 = 0x20;
   INTN RealWidth = CharScaledWidth;
   INTN Shift = INTN((FontWidth - CharWidth) * textScale / 2); // cast to INTN to avoid warning
@@ -327,7 +479,7 @@ INTN XTheme::RenderText(IN const XStringW& Text, OUT XImage* CompImage_ptr,
           RightSpace = 1;
           RealWidth = (CharScaledWidth >> 1) + 1;
         } else {
-          RightSpace = GetEmpty(FontImage, FontPixel, FontWidth, c * FontWidth, 1); //not scaled yet
+          RightSpace = GlyphRightSpace[c]; //not scaled yet
           if (RightSpace >= FontWidth) {
             RightSpace = 0; //empty place for invisible characters
           }
@@ -425,6 +577,9 @@ INTN XTheme::RenderText(IN const XStringW& Text, OUT XImage* CompImage_ptr,
       PosX += CharWidth; //Shift;
     }
   }
+  if (!CompImage.isEmpty()) {
+    TextCachePut(Text, CompImage, BackHash, StartX, PosY, Cursor, textType, textScale, PosX);
+  }
   return PosX;
 }
 
@@ -44,7 +44,11 @@
 #include "../Platform/Settings.h"
 #include "Self.h"
 #include "SelfOem.h"
+#include "../libeg/ThemePack.h"
 #include "../include/OC.h"
+#include "../Platform/BootTimeline.h"
+#include "../Platform/Events.h"
+#include "../Platform/Nvram.h"
 
 #ifndef DEBUG_ALL
 #define DEBUG_LIB 1
@@ -184,6 +188,7 @@ void UninitRefitLib(void)
   selfOem.closeHandle();
   self.closeHandle();
   
+  flushDebugLog();
   closeDebugLog();
   UninitVolumes();
 }
@@ -300,6 +305,10 @@ static void ScanVolumeBootcode(IN OUT REFIT_VOLUME *Volume, OUT BOOLEAN *Bootabl
   //  CHAR16      *kind = NULL;
   
   Volume->HasBootCode = FALSE;
+  if (Volume->BootSector != NULL) {
+    FreePool(Volume->BootSector);
+    Volume->BootSector = NULL;
+  }
   Volume->LegacyOS->IconName.setEmpty();
   Volume->LegacyOS->Name.setEmpty();
   //  Volume->BootType = BOOTING_BY_MBR; //default value
@@ -535,6 +544,11 @@ static void ScanVolumeBootcode(IN OUT REFIT_VOLUME *Volume, OUT BOOLEAN *Bootabl
     if (FindMem(SectorBuffer, 512, "Non-system disk", 15) >= 0)   // dummy FAT boot sector
       Volume->HasBootCode = FALSE;
 
+    // keep the boot sector so that a chainload doesn't read it again
+    if (Volume->HasBootCode && Volume->BootType == BOOTING_BY_PBR && Volume->BlockIOOffset == 0) {
+      Volume->BootSector = (__typeof__(Volume->BootSector))AllocateCopyPool(512, SectorBuffer);
+    }
+
 #ifdef JIEF_DEBUG
 //*Bootable = TRUE;
 //Volume->HasBootCode = TRUE;
@@ -569,6 +583,330 @@ static void ScanVolumeBootcode(IN OUT REFIT_VOLUME *Volume, OUT BOOLEAN *Bootabl
   FreeAlignedPages((void*)SectorBuffer, EFI_SIZE_TO_PAGES (2048));
 }
 
+//
+// volume cache
+//
+// With Boot/VolumeCache, the bootcode detection of fixed disk volumes is kept in
+// misc\VolumeCache.bin and reused while the disk's first two blocks are unchanged.
+// Those hold the MBR and the GPT header, whose CRC covers the partition array, so
+// the check costs one read per disk instead of one per volume. A boot sector can
+// change without touching them: a cached volume is read again before legacy boot.
+//
+
+#define VOLUME_CACHE_FILE       L"misc\\VolumeCache.bin"
+#define VOLUME_CACHE_SIGNATURE  SIGNATURE_32('V', 'C', 'C', 'H')
+#define VOLUME_CACHE_VERSION    1
+#define VOLUME_CACHE_BOOTCODE   0x01  // Volume->HasBootCode
+#define VOLUME_CACHE_BOOTABLE   0x02  // ScanVolumeBootcode() *Bootable
+#define VOLUME_CACHE_MAX_STRING 1024
+
+#pragma pack(push, 1)
+typedef struct {
+  UINT32  Signature;
+  UINT32  Version;
+  UINT32  Count;
+  UINT32  Crc32;       // of the records following the header
+} VOLUME_CACHE_HEADER;
+
+typedef struct {
+  UINT32  DiskStamp;
+  UINT32  DriveCRC32;
+  UINT8   Flags;
+  UINT8   BootType;
+  UINT8   OsType;
+  UINT8   Reserved;
+  UINT16  PathLength;  // CHAR16 counts of the strings following the record, no terminator
+  UINT16  NameLength;
+  UINT16  IconLength;
+} VOLUME_CACHE_RECORD;
+#pragma pack(pop)
+
+class VOLUME_CACHE_ENTRY
+{
+public:
+  XStringW  DevicePathString;
+  UINT32    DiskStamp;
+  UINT32    DriveCRC32;
+  UINT8     Flags;
+  UINT8     BootType;
+  UINT8     OsType;
+  XStringW  Name;
+  XStringW  IconName;
+  BOOLEAN   Seen;      // volume present in this scan, others are dropped on save
+
+  VOLUME_CACHE_ENTRY() : DevicePathString(), DiskStamp(0), DriveCRC32(0), Flags(0), BootType(0), OsType(0), Name(), IconName(), Seen(FALSE) {}
+  VOLUME_CACHE_ENTRY(const VOLUME_CACHE_ENTRY& other) = delete; // Can be defined if needed
+  const VOLUME_CACHE_ENTRY& operator = ( const VOLUME_CACHE_ENTRY & ) = delete; // Can be defined if needed
+};
+
+class VOLUME_CACHE_DISK
+{
+public:
+  EFI_BLOCK_IO  *BlockIO;
+  UINT32        Stamp;
+  BOOLEAN       Valid;
+
+  VOLUME_CACHE_DISK() : BlockIO(NULL), Stamp(0), Valid(FALSE) {}
+};
+
+static XObjArray<VOLUME_CACHE_ENTRY> VolumeCache;
+static XObjArray<VOLUME_CACHE_DISK>  VolumeCacheDisks;
+static BOOLEAN                       VolumeCacheDirty = FALSE;
+
+// strncpy() would look at the first char even for an empty string at the end of the file
+static UINTN VolumeCacheString(OUT XStringW& String, IN CONST UINT8 *Data, IN UINTN Length)
+{
+  if (Length > 0) {
+    String.strncpy((CONST CHAR16 *)Data, Length);
+  }
+  return Length * sizeof(CHAR16);
+}
+
+static void VolumeCacheLoad(void)
+{
+  EFI_STATUS          Status;
+  UINT8               *Data = NULL;
+  UINTN               DataSize = 0;
+  UINTN               Offset;
+  UINT32              Index;
+  VOLUME_CACHE_HEADER *Header;
+  VOLUME_CACHE_RECORD *Record;
+
+  VolumeCache.setEmpty();
+  VolumeCacheDisks.setEmpty();
+  VolumeCacheDirty = FALSE;
+
+  Status = egLoadFile(&self.getCloverDir(), VOLUME_CACHE_FILE, &Data, &DataSize);
+  if (EFI_ERROR(Status)) {
+    DBG("Volume cache: %s, rebuilding\n", efiStrError(Status));
+    VolumeCacheDirty = TRUE;
+    return;
+  }
+  Header = (VOLUME_CACHE_HEADER *)Data;
+  if (DataSize < sizeof(VOLUME_CACHE_HEADER) || Header->Signature != VOLUME_CACHE_SIGNATURE ||
+      Header->Version != VOLUME_CACHE_VERSION ||
+      Header->Crc32 != GetCrc32(Data + sizeof(VOLUME_CACHE_HEADER), DataSize - sizeof(VOLUME_CACHE_HEADER))) {
+    DBG("Volume cache: bad file, rebuilding\n");
+    FreePool(Data);
+    VolumeCacheDirty = TRUE;
+    return;
+  }
+
+  Offset = sizeof(VOLUME_CACHE_HEADER);
+  for (Index = 0; Index < Header->Count; Index++) {
+    if (DataSize - Offset < sizeof(VOLUME_CACHE_RECORD)) {
+      break;
+    }
+    Record = (VOLUME_CACHE_RECORD *)(Data + Offset);
+    Offset += sizeof(VOLUME_CACHE_RECORD);
+    if (Record->PathLength > VOLUME_CACHE_MAX_STRING || Record->NameLength > VOLUME_CACHE_MAX_STRING ||
+        Record->IconLength > VOLUME_CACHE_MAX_STRING ||
+        DataSize - Offset < ((UINTN)Record->PathLength + Record->NameLength + Record->IconLength) * sizeof(CHAR16)) {
+      break;
+    }
+    VOLUME_CACHE_ENTRY* Entry = new VOLUME_CACHE_ENTRY;
+    Entry->DiskStamp = Record->DiskStamp;
+    Entry->DriveCRC32 = Record->DriveCRC32;
+    Entry->Flags = Record->Flags;
+    Entry->BootType = Record->BootType;
+    Entry->OsType = Record->OsType;
+    Offset += VolumeCacheString(Entry->DevicePathString, Data + Offset, Record->PathLength);
+    Offset += VolumeCacheString(Entry->Name, Data + Offset, Record->NameLength);
+    Offset += VolumeCacheString(Entry->IconName, Data + Offset, Record->IconLength);
+    VolumeCache.AddReference(Entry, true);
+  }
+  FreePool(Data);
+  DBG("Volume cache: %zu volumes\n", VolumeCache.size());
+}
+
+static void VolumeCacheSave(void)
+{
+  EFI_STATUS          Status;
+  XBuffer<UINT8>      Data;
+  VOLUME_CACHE_HEADER Header;
+  VOLUME_CACHE_RECORD Record;
+  size_t              Index;
+
+  // volumes not seen in this scan are gone or changed disk, forget them
+  for (Index = VolumeCache.size(); Index-- > 0; ) {
+    if (!VolumeCache[Index].Seen) {
+      VolumeCache.RemoveAtIndex(Index);
+      VolumeCacheDirty = TRUE;
+    }
+  }
+  if (!VolumeCacheDirty) {
+    return;
+  }
+
+  ZeroMem(&Header, sizeof(Header));
+  Header.Signature = VOLUME_CACHE_SIGNATURE;
+  Header.Version = VOLUME_CACHE_VERSION;
+  Header.Count = (UINT32)VolumeCache.size();
+  Data.ncat(&Header, sizeof(Header));
+  for (Index = 0; Index < VolumeCache.size(); Index++) {
+    const VOLUME_CACHE_ENTRY& Entry = VolumeCache[Index];
+    ZeroMem(&Record, sizeof(Record));
+    Record.DiskStamp = Entry.DiskStamp;
+    Record.DriveCRC32 = Entry.DriveCRC32;
+    Record.Flags = Entry.Flags;
+    Record.BootType = Entry.BootType;
+    Record.OsType = Entry.OsType;
+    Record.PathLength = (UINT16)MIN(Entry.DevicePathString.length(), VOLUME_CACHE_MAX_STRING);
+    Record.NameLength = (UINT16)MIN(Entry.Name.length(), VOLUME_CACHE_MAX_STRING);
+    Record.IconLength = (UINT16)MIN(Entry.IconName.length(), VOLUME_CACHE_MAX_STRING);
+    Data.ncat(&Record, sizeof(Record));
+    Data.ncat(Entry.DevicePathString.wc_str(), Record.PathLength * sizeof(CHAR16));
+    Data.ncat(Entry.Name.wc_str(), Record.NameLength * sizeof(CHAR16));
+    Data.ncat(Entry.IconName.wc_str(), Record.IconLength * sizeof(CHAR16));
+  }
+  ((VOLUME_CACHE_HEADER *)Data.data())->Crc32 = GetCrc32(Data.data() + sizeof(Header), Data.size() - sizeof(Header));
+
+  Status = egSaveFile(&self.getCloverDir(), VOLUME_CACHE_FILE, Data.data(), Data.size());
+  DBG("Volume cache: saved %zu volumes: %s\n", VolumeCache.size(), efiStrError(Status));
+  if (!EFI_ERROR(Status)) {
+    VolumeCacheDirty = FALSE;
+  }
+}
+
+static VOLUME_CACHE_ENTRY* VolumeCacheFind(const XStringW& DevicePathString)
+{
+  for (size_t Index = 0; Index < VolumeCache.size(); Index++) {
+    if (VolumeCache[Index].DevicePathString == DevicePathString) {
+      return &VolumeCache[Index];
+    }
+  }
+  return NULL;
+}
+
+// CRC of the first two blocks of the disk holding Volume, read once per disk and scan.
+// Removable media are never cached: the medium can be swapped under the same path.
+static BOOLEAN VolumeCacheDiskStamp(IN REFIT_VOLUME *Volume, OUT UINT32 *Stamp)
+{
+  EFI_STATUS          Status;
+  EFI_BLOCK_IO        *DiskIO = Volume->WholeDiskBlockIO;
+  UINT8               *Buffer;
+  UINTN               BlockSize;
+  size_t              Index;
+
+  if (DiskIO == NULL && !Volume->BlockIO->Media->LogicalPartition) {
+    DiskIO = Volume->BlockIO; // this is the whole disk
+  }
+  if (DiskIO == NULL || DiskIO->Media->RemovableMedia || !DiskIO->Media->MediaPresent) {
+    return FALSE;
+  }
+  for (Index = 0; Index < VolumeCacheDisks.size(); Index++) {
+    if (VolumeCacheDisks[Index].BlockIO == DiskIO) {
+      *Stamp = VolumeCacheDisks[Index].Stamp;
+      return VolumeCacheDisks[Index].Valid;
+    }
+  }
+
+  VOLUME_CACHE_DISK* Disk = new VOLUME_CACHE_DISK;
+  Disk->BlockIO = DiskIO;
+  VolumeCacheDisks.AddReference(Disk, true);
+  BlockSize = DiskIO->Media->BlockSize;
+  if (BlockSize == 0 || BlockSize > 4096 || DiskIO->Media->LastBlock < 1) {
+    return FALSE;
+  }
+  Buffer = (__typeof__(Buffer))AllocateAlignedPages(EFI_SIZE_TO_PAGES(2 * BlockSize), 16);
+  if (Buffer == NULL) {
+    return FALSE;
+  }
+  Status = DiskIO->ReadBlocks(DiskIO, DiskIO->Media->MediaId, 0, 2 * BlockSize, Buffer);
+  if (!EFI_ERROR(Status)) {
+    Disk->Stamp = GetCrc32(Buffer, 2 * BlockSize);
+    Disk->Valid = TRUE;
+  }
+  FreeAlignedPages((void*)Buffer, EFI_SIZE_TO_PAGES(2 * BlockSize));
+  *Stamp = Disk->Stamp;
+  return Disk->Valid;
+}
+
+// remember what ScanVolumeBootcode() found, marks the cache dirty if it differs
+static BOOLEAN VolumeCacheStore(IN REFIT_VOLUME *Volume, IN UINT32 Stamp, IN BOOLEAN Bootable)
+{
+  VOLUME_CACHE_ENTRY  *Entry = VolumeCacheFind(Volume->DevicePathString);
+  UINT8               Flags = (Volume->HasBootCode ? VOLUME_CACHE_BOOTCODE : 0) | (Bootable ? VOLUME_CACHE_BOOTABLE : 0);
+
+  if (Entry == NULL) {
+    Entry = new VOLUME_CACHE_ENTRY;
+    Entry->DevicePathString = Volume->DevicePathString;
+    VolumeCache.AddReference(Entry, true);
+  } else if (Entry->DiskStamp == Stamp && Entry->DriveCRC32 == Volume->DriveCRC32 && Entry->Flags == Flags &&
+             Entry->BootType == Volume->BootType && Entry->OsType == Volume->LegacyOS->Type &&
+             Entry->Name == Volume->LegacyOS->Name && Entry->IconName == Volume->LegacyOS->IconName) {
+    Entry->Seen = TRUE;
+    return FALSE;
+  }
+  Entry->DiskStamp = Stamp;
+  Entry->DriveCRC32 = Volume->DriveCRC32;
+  Entry->Flags = Flags;
+  Entry->BootType = Volume->BootType;
+  Entry->OsType = Volume->LegacyOS->Type;
+  Entry->Name = Volume->LegacyOS->Name;
+  Entry->IconName = Volume->LegacyOS->IconName;
+  Entry->Seen = TRUE;
+  VolumeCacheDirty = TRUE;
+  return TRUE;
+}
+
+// ScanVolumeBootcode() for a hard disk volume, answered from the cache when its disk is unchanged
+static void ScanVolumeBootcodeCached(IN OUT REFIT_VOLUME *Volume, OUT BOOLEAN *Bootable)
+{
+  VOLUME_CACHE_ENTRY  *Entry;
+  UINT32              Stamp = 0;
+
+  if (!GlobalConfig.VolumeCache || Volume->BlockIO->Media->RemovableMedia || !VolumeCacheDiskStamp(Volume, &Stamp)) {
+    ScanVolumeBootcode(Volume, Bootable);
+    return;
+  }
+  Entry = VolumeCacheFind(Volume->DevicePathString);
+  if (Entry == NULL || Entry->DiskStamp != Stamp || !Volume->BlockIO->Media->MediaPresent) {
+    ScanVolumeBootcode(Volume, Bootable);
+    VolumeCacheStore(Volume, Stamp, *Bootable);
+    return;
+  }
+  Volume->HasBootCode = (Entry->Flags & VOLUME_CACHE_BOOTCODE) != 0;
+  *Bootable = (Entry->Flags & VOLUME_CACHE_BOOTABLE) != 0;
+  Volume->DriveCRC32 = Entry->DriveCRC32;
+  Volume->BootType = Entry->BootType;
+  Volume->LegacyOS->Type = Entry->OsType;
+  Volume->LegacyOS->Name = Entry->Name;
+  Volume->LegacyOS->IconName = Entry->IconName;
+  Volume->BootcodeCached = TRUE;
+  Entry->Seen = TRUE;
+  DBG("        Bootcode from volume cache: %ls %ls\n", Volume->HasBootCode ? L"bootable" : L"non-bootable",
+      Volume->LegacyOS->Name.notEmpty() ? Volume->LegacyOS->Name.wc_str() : L"unknown");
+}
+
+void RevalidateVolumeBootcode(IN OUT REFIT_VOLUME *Volume)
+{
+  VOLUME_CACHE_ENTRY  *Entry;
+  UINT8               DiskKind;
+  BOOLEAN             Bootable;
+
+  if (!Volume->BootcodeCached) {
+    return;
+  }
+  Volume->BootcodeCached = FALSE;
+  Entry = VolumeCacheFind(Volume->DevicePathString);
+  // same conditions as the read in ScanVolume(), done before the device type was known
+  DiskKind = Volume->DiskKind;
+  Volume->DiskKind = DISK_KIND_INTERNAL;
+  ScanVolumeBootcode(Volume, &Bootable);
+  Volume->DiskKind = DiskKind;
+  if (Entry != NULL && VolumeCacheStore(Volume, Entry->DiskStamp, Bootable)) {
+    DBG("Volume cache was stale for %ls\n", Volume->DevicePathString.wc_str());
+    VolumeCacheSave();
+  }
+  if (!Bootable) {
+    Volume->HasBootCode = FALSE;
+  }
+  if (Volume->LegacyOS->IconName.isEmpty()) {
+    Volume->LegacyOS->IconName = L"legacy"_XSW;
+  }
+}
+
 //at start we have only Volume->DeviceHandle
 static EFI_STATUS ScanVolume(IN OUT REFIT_VOLUME *Volume)
 {
@@ -592,6 +930,7 @@ static EFI_STATUS ScanVolume(IN OUT REFIT_VOLUME *Volume)
   Volume->DevicePath = (__typeof__(Volume->DevicePath))AllocateAlignedPages(EFI_SIZE_TO_PAGES(DevicePathSize), 64);
   CopyMem(Volume->DevicePath, DiskDevicePath, DevicePathSize);
   Volume->DevicePathString = FileDevicePathToXStringW(Volume->DevicePath);
+  Volume->DevicePathHash = BootVolumeDevicePathHash(Volume->DevicePath);
 
 #if REFIT_DEBUG > 0
   if (Volume->DevicePath != NULL) {
@@ -618,6 +957,52 @@ static EFI_STATUS ScanVolume(IN OUT REFIT_VOLUME *Volume)
     return Status;
   }
   
+  // the whole disk is needed before bootcode scan, the volume cache is keyed by it
+  DevicePath = DuplicateDevicePath(Volume->DevicePath);
+  RemainingDevicePath = DevicePath; //initial value
+	//
+	// find the partition device path node
+	//
+	while (DevicePath && !IsDevicePathEnd (DevicePath)) {
+		if ((DevicePathType (DevicePath) == MEDIA_DEVICE_PATH) &&
+        (DevicePathSubType (DevicePath) == MEDIA_HARDDRIVE_DP)) {
+      HdPath = (HARDDRIVE_DEVICE_PATH *)DevicePath;
+      //			break;
+		}
+		DevicePath = NextDevicePathNode (DevicePath);
+	}
+//    DBG("DevicePath scanned\n");
+  if (HdPath) {
+    //      printf("Partition found %s\n", DevicePathToStr((EFI_DEVICE_PATH *)HdPath));
+    
+    PartialLength = (UINTN)((UINT8 *)HdPath - (UINT8 *)(RemainingDevicePath));
+    if (PartialLength > 0x1000) {
+      PartialLength = sizeof(EFI_DEVICE_PATH); //something wrong here but I don't want to be freezed
+      //       return EFI_SUCCESS;
+    }
+    DiskDevicePath = (EFI_DEVICE_PATH *)AllocatePool(PartialLength + sizeof(EFI_DEVICE_PATH));
+    CopyMem(DiskDevicePath, Volume->DevicePath, PartialLength);
+    CopyMem((UINT8 *)DiskDevicePath + PartialLength, DevicePath, sizeof(EFI_DEVICE_PATH)); //EndDevicePath
+  //        DBG("WholeDevicePath  %ls\n", DevicePathToStr(DiskDevicePath));
+    RemainingDevicePath = DiskDevicePath;
+    Status = gBS->LocateDevicePath(&gEfiDevicePathProtocolGuid, &RemainingDevicePath, &WholeDiskHandle);
+    if (EFI_ERROR(Status)) {
+      DBG("Can't find WholeDevicePath: %s\n", efiStrError(Status));
+    } else {
+      Volume->WholeDiskDeviceHandle = WholeDiskHandle;
+      Volume->WholeDiskDevicePath = DuplicateDevicePath(RemainingDevicePath);
+      // look at the BlockIO protocol
+      Status = gBS->HandleProtocol(WholeDiskHandle, &gEfiBlockIoProtocolGuid, (void **) &Volume->WholeDiskBlockIO);
+      if (EFI_ERROR(Status)) {
+        Volume->WholeDiskBlockIO = NULL;
+      //  DBG("no WholeDiskBlockIO: %s\n", efiStrError(Status));
+        
+        //CheckError(Status, L"from HandleProtocol");
+      }
+    }
+    FreePool(DiskDevicePath);
+  }
+
   Bootable = FALSE;
   if (Volume->BlockIO->Media->BlockSize == 2048){
 //    DBG("        Found optical drive\n");
@@ -628,7 +1013,7 @@ static EFI_STATUS ScanVolume(IN OUT REFIT_VOLUME *Volume)
     //        DBG("        Found HD drive\n");
     Volume->BlockIOOffset = 0;
     // scan for bootcode and MBR table
-    ScanVolumeBootcode(Volume, &Bootable);
+    ScanVolumeBootcodeCached(Volume, &Bootable);
  //     DBG("        ScanVolumeBootcode success\n");
     // detect device type
     DevicePath = DuplicateDevicePath(Volume->DevicePath);
@@ -709,55 +1094,10 @@ static EFI_STATUS ScanVolume(IN OUT REFIT_VOLUME *Volume)
   }
   
   
-  DevicePath = DuplicateDevicePath(Volume->DevicePath);
-  RemainingDevicePath = DevicePath; //initial value
-	//
-	// find the partition device path node
-	//
-	while (DevicePath && !IsDevicePathEnd (DevicePath)) {
-		if ((DevicePathType (DevicePath) == MEDIA_DEVICE_PATH) &&
-        (DevicePathSubType (DevicePath) == MEDIA_HARDDRIVE_DP)) {
-      HdPath = (HARDDRIVE_DEVICE_PATH *)DevicePath;
-      //			break;
-		}
-		DevicePath = NextDevicePathNode (DevicePath);
-	}
-//    DBG("DevicePath scanned\n");
-  if (HdPath) {
-    //      printf("Partition found %s\n", DevicePathToStr((EFI_DEVICE_PATH *)HdPath));
-    
-    PartialLength = (UINTN)((UINT8 *)HdPath - (UINT8 *)(RemainingDevicePath));
-    if (PartialLength > 0x1000) {
-      PartialLength = sizeof(EFI_DEVICE_PATH); //something wrong here but I don't want to be freezed
-      //       return EFI_SUCCESS;
-    }
-    DiskDevicePath = (EFI_DEVICE_PATH *)AllocatePool(PartialLength + sizeof(EFI_DEVICE_PATH));
-    CopyMem(DiskDevicePath, Volume->DevicePath, PartialLength);
-    CopyMem((UINT8 *)DiskDevicePath + PartialLength, DevicePath, sizeof(EFI_DEVICE_PATH)); //EndDevicePath
-  //        DBG("WholeDevicePath  %ls\n", DevicePathToStr(DiskDevicePath));
-    RemainingDevicePath = DiskDevicePath;
-    Status = gBS->LocateDevicePath(&gEfiDevicePathProtocolGuid, &RemainingDevicePath, &WholeDiskHandle);
-    if (EFI_ERROR(Status)) {
-      DBG("Can't find WholeDevicePath: %s\n", efiStrError(Status));
-    } else {
-      Volume->WholeDiskDeviceHandle = WholeDiskHandle;
-      Volume->WholeDiskDevicePath = DuplicateDevicePath(RemainingDevicePath);
-      // look at the BlockIO protocol
-      Status = gBS->HandleProtocol(WholeDiskHandle, &gEfiBlockIoProtocolGuid, (void **) &Volume->WholeDiskBlockIO);
-      if (!EFI_ERROR(Status)) {
-        //          DBG("WholeDiskBlockIO %hhX BlockSize=%d\n", Volume->WholeDiskBlockIO, Volume->WholeDiskBlockIO->Media->BlockSize);
-        // check the media block size
-        if (Volume->WholeDiskBlockIO->Media->BlockSize == 2048)
-          Volume->DiskKind = DISK_KIND_OPTICAL;
-        
-      } else {
-        Volume->WholeDiskBlockIO = NULL;
-      //  DBG("no WholeDiskBlockIO: %s\n", efiStrError(Status));
-        
-        //CheckError(Status, L"from HandleProtocol");
-      }
-    }
-    FreePool(DiskDevicePath);
+  // check the media block size
+  if (Volume->WholeDiskBlockIO != NULL && Volume->WholeDiskBlockIO->Media->BlockSize == 2048) {
+    //          DBG("WholeDiskBlockIO %hhX BlockSize=%d\n", Volume->WholeDiskBlockIO, Volume->WholeDiskBlockIO->Media->BlockSize);
+    Volume->DiskKind = DISK_KIND_OPTICAL;
   }
   /*  else {
    DBG("HD path is not found\n"); //master volume!
@@ -964,90 +1304,62 @@ static void ScanExtendedPartition(REFIT_VOLUME *WholeDiskVolume, MBR_PARTITION_I
   gBS->FreePages((EFI_PHYSICAL_ADDRESS)(UINTN)SectorBuffer, 1);
 }
 
-void ScanVolumes(void)
+// first pass of ScanVolumes() for one BlockIo handle
+static void AddScannedVolume(EFI_HANDLE Handle, UINTN HandleIndex)
 {
-  EFI_STATUS              Status;
-  UINTN                   HandleCount = 0;
-  UINTN                   HandleIndex;
-  EFI_HANDLE              *Handles = NULL;
-  REFIT_VOLUME            *WholeDiskVolume;
-  UINTN                   VolumeIndex, VolumeIndex2;
-  MBR_PARTITION_INFO      *MbrTable;
-  UINTN                   PartitionIndex;
-  UINT8                   *SectorBuffer1, *SectorBuffer2;
-  UINTN                   SectorSum, i;
-  //  EFI_DEVICE_PATH_PROTOCOL  *VolumeDevicePath;
-  //  EFI_GUID                *Guid; //for debug only
-  //  EFI_INPUT_KEY Key;
+  EFI_STATUS Status;
+
+  REFIT_VOLUME* Volume = new REFIT_VOLUME;
+  Volume->LegacyOS = new LEGACY_OS;
+  Volume->DeviceHandle = Handle;
+  if (Volume->DeviceHandle == self.getSelfDeviceHandle()) {
+    SelfVolume = Volume;
+  }
   
-  //    DBG("Scanning volumes...\n");
-  DbgHeader("ScanVolumes");
+	  DBG("- [%02llu]: Volume:", HandleIndex);
   
-  // get all BlockIo handles
-  Status = gBS->LocateHandleBuffer(ByProtocol, &gEfiBlockIoProtocolGuid, NULL, &HandleCount, &Handles);
-  if (Status == EFI_NOT_FOUND)
-    return;
-	DBG("Found %llu volumes with blockIO\n", HandleCount);
-  // first pass: collect information about all handles
-  for (HandleIndex = 0; HandleIndex < HandleCount; HandleIndex++) {
-    
-    REFIT_VOLUME* Volume = new REFIT_VOLUME;
-    Volume->LegacyOS = new LEGACY_OS;
-    Volume->DeviceHandle = Handles[HandleIndex];
-    if (Volume->DeviceHandle == self.getSelfDeviceHandle()) {
-      SelfVolume = Volume;
+  Volume->Hidden = FALSE; // default to not hidden
+  
+  Status = ScanVolume(Volume);
+  if (!EFI_ERROR(Status)) {
+    Volumes.AddReference(Volume, false);
+    for (size_t HVi = 0; HVi < gSettings.HVHideStrings.size(); HVi++) {
+      if ( Volume->DevicePathString.containsIC(gSettings.HVHideStrings[HVi]) ||
+           Volume->VolName.containsIC(gSettings.HVHideStrings[HVi])
+         ) {
+        Volume->Hidden = TRUE;
+        DBG("        hiding this volume\n");
+      }
     }
     
-	  DBG("- [%02llu]: Volume:", HandleIndex);
-    
-    Volume->Hidden = FALSE; // default to not hidden
-    
-    Status = ScanVolume(Volume);
-    if (!EFI_ERROR(Status)) {
-      Volumes.AddReference(Volume, false);
-      for (size_t HVi = 0; HVi < gSettings.HVHideStrings.size(); HVi++) {
-        if ( Volume->DevicePathString.containsIC(gSettings.HVHideStrings[HVi]) ||
-             Volume->VolName.containsIC(gSettings.HVHideStrings[HVi])
-           ) {
-          Volume->Hidden = TRUE;
-          DBG("        hiding this volume\n");
-        }
-      }
-      
 //      Guid = FindGPTPartitionGuidInDevicePath(Volume->DevicePath);
-      if (Volume->LegacyOS->IconName.isEmpty()) {
-        Volume->LegacyOS->IconName = L"legacy"_XSW;
-      }
+    if (Volume->LegacyOS->IconName.isEmpty()) {
+      Volume->LegacyOS->IconName = L"legacy"_XSW;
+    }
 //      DBG("  Volume '%ls', LegacyOS '%ls', LegacyIcon(s) '%ls', GUID = %s\n",
 //          Volume->VolName, Volume->LegacyOS->Name ? Volume->LegacyOS->Name : L"", Volume->LegacyOS->IconName, strguid(Guid));
-      if (SelfVolume == Volume) {
-        DBG("        This is SelfVolume !!\n");
-      }
-      
-    } else {
-		DBG("        wrong volume Nr%llu?!\n", HandleIndex);
-      FreePool(Volume);
+    if (SelfVolume == Volume) {
+      DBG("        This is SelfVolume !!\n");
     }
+    
+  } else {
+		DBG("        wrong volume Nr%llu?!\n", HandleIndex);
+    FreePool(Volume);
   }
-  FreePool(Handles);
-  //  DBG("Found %d volumes\n", VolumesCount);
-  if (SelfVolume == NULL){
-    DBG("        WARNING: SelfVolume not found"); //Slice - and what?
-    SelfVolume = new REFIT_VOLUME;
-    SelfVolume->DeviceHandle = self.getSelfDeviceHandle();
-    SelfVolume->DevicePath = DuplicateDevicePath(&self.getSelfDevicePath());
-    SelfVolume->RootDir = const_cast<EFI_FILE*>(&self.getSelfVolumeRootDir()); // TODO : SelfVolume->RootDir should be const ! we should duplicate ?
-    SelfVolume->DiskKind = DISK_KIND_BOOTER;
-    SelfVolume->VolName = L"Clover"_XSW;
-    SelfVolume->LegacyOS->Type = OSTYPE_EFI;
-    SelfVolume->HasBootCode = TRUE;
-    SelfVolume->BootType = BOOTING_BY_PBR;
-    //   AddListElement((void ***) &Volumes, &VolumesCount, SelfVolume);
-    //    DBG("SelfVolume Nr %d created\n", VolumesCount);
-  }
-  
-  // second pass: relate partitions and whole disk devices
-  for (VolumeIndex = 0; VolumeIndex < Volumes.size(); VolumeIndex++) {
+}
+
+// second pass of ScanVolumes(): relate partitions and whole disk devices, from FirstIndex to the end of Volumes
+static void RelateVolumes(size_t FirstIndex)
+{
+  EFI_STATUS              Status;
+  REFIT_VOLUME            *WholeDiskVolume;
+  UINTN                   VolumeIndex, VolumeIndex2;
+  MBR_PARTITION_INFO      *MbrTable;
+  UINTN                   PartitionIndex;
+  UINT8                   *SectorBuffer1, *SectorBuffer2;
+  UINTN                   SectorSum, i;
+
+  for (VolumeIndex = FirstIndex; VolumeIndex < Volumes.size(); VolumeIndex++) {
     REFIT_VOLUME* Volume = &Volumes[VolumeIndex];
     
     // check MBR partition table for extended partitions
@@ -1119,6 +1431,131 @@ void ScanVolumes(void)
   }
 }
 
+void ScanVolumes(void)
+{
+  TimelineSpan Span("ScanVolumes");
+  EFI_STATUS              Status;
+  UINTN                   HandleCount = 0;
+  UINTN                   HandleIndex;
+  EFI_HANDLE              *Handles = NULL;
+  //  EFI_DEVICE_PATH_PROTOCOL  *VolumeDevicePath;
+  //  EFI_GUID                *Guid; //for debug only
+  //  EFI_INPUT_KEY Key;
+  
+  //    DBG("Scanning volumes...\n");
+  DbgHeader("ScanVolumes");
+
+  if (GlobalConfig.VolumeCache) {
+    VolumeCacheLoad();
+  }
+  // the file systems installed until now are the ones scanned, RescanVolumes() looks at the next ones
+  while (GetNewFileSystemHandle() != NULL) {
+  }
+  
+  // get all BlockIo handles
+  Status = gBS->LocateHandleBuffer(ByProtocol, &gEfiBlockIoProtocolGuid, NULL, &HandleCount, &Handles);
+  if (Status == EFI_NOT_FOUND)
+    return;
+	DBG("Found %llu volumes with blockIO\n", HandleCount);
+  // first pass: collect information about all handles
+  for (HandleIndex = 0; HandleIndex < HandleCount; HandleIndex++) {
+    AddScannedVolume(Handles[HandleIndex], HandleIndex);
+  }
+  FreePool(Handles);
+  //  DBG("Found %d volumes\n", VolumesCount);
+  if (SelfVolume == NULL){
+    DBG("        WARNING: SelfVolume not found"); //Slice - and what?
+    SelfVolume = new REFIT_VOLUME;
+    SelfVolume->DeviceHandle = self.getSelfDeviceHandle();
+    SelfVolume->DevicePath = DuplicateDevicePath(&self.getSelfDevicePath());
+    SelfVolume->RootDir = const_cast<EFI_FILE*>(&self.getSelfVolumeRootDir()); // TODO : SelfVolume->RootDir should be const ! we should duplicate ?
+    SelfVolume->DiskKind = DISK_KIND_BOOTER;
+    SelfVolume->VolName = L"Clover"_XSW;
+    SelfVolume->LegacyOS->Type = OSTYPE_EFI;
+    SelfVolume->HasBootCode = TRUE;
+    SelfVolume->BootType = BOOTING_BY_PBR;
+    //   AddListElement((void ***) &Volumes, &VolumesCount, SelfVolume);
+    //    DBG("SelfVolume Nr %d created\n", VolumesCount);
+  }
+  
+  // second pass: relate partitions and whole disk devices
+  RelateVolumes(0);
+
+  if (GlobalConfig.VolumeCache) {
+    VolumeCacheSave();
+  }
+}
+
+/*
+ * Boot/IncrementalRescan : updates Volumes after a refresh instead of rebuilding it.
+ * A volume is dropped when its handle lost its BlockIo or its file system, or got a file system
+ * since the last scan (media change). Drivers don't tell when a handle goes away, so that is checked.
+ * New BlockIo handles are then scanned. The kept volumes keep their MenuScanned.
+ * Dropped volumes are moved to Removed : the caller removes their menu entries before freeing them.
+ * Returns TRUE if Volumes changed.
+ */
+BOOLEAN RescanVolumes(XObjArray<REFIT_VOLUME>& Removed)
+{
+  TimelineSpan Span("RescanVolumes");
+  EFI_STATUS              Status;
+  UINTN                   HandleCount = 0;
+  UINTN                   HandleIndex;
+  EFI_HANDLE              *Handles = NULL;
+  EFI_HANDLE              Handle;
+  XArray<EFI_HANDLE>      NewFileSystems;
+  size_t                  VolumeIndex, RemovedIndex;
+  size_t                  FirstNew;
+  void                    *Interface;
+
+  DbgHeader("RescanVolumes");
+  while ((Handle = GetNewFileSystemHandle()) != NULL) {
+    NewFileSystems.Add(Handle);
+  }
+
+  for (VolumeIndex = Volumes.size(); VolumeIndex-- > 0; ) {
+    REFIT_VOLUME* Volume = &Volumes[VolumeIndex];
+    if (Volume == SelfVolume) {
+      continue;
+    }
+    BOOLEAN Drop = EFI_ERROR(gBS->HandleProtocol(Volume->DeviceHandle, &gEfiBlockIoProtocolGuid, &Interface)) ||
+                   (Volume->RootDir != NULL && EFI_ERROR(gBS->HandleProtocol(Volume->DeviceHandle, &gEfiSimpleFileSystemProtocolGuid, &Interface)));
+    for (size_t Index = 0; !Drop && Index < NewFileSystems.size(); Index++) {
+      Drop = NewFileSystems[Index] == Volume->DeviceHandle;
+    }
+    // partitions of a dropped disk, their MbrPartitionTable may point into it
+    for (RemovedIndex = 0; !Drop && RemovedIndex < Removed.size(); RemovedIndex++) {
+      Drop = Volume->WholeDiskBlockIO != NULL && Volume->WholeDiskBlockIO == Removed[RemovedIndex].BlockIO;
+    }
+    if (Drop) {
+      // its file system is gone or was reinstalled, RootDir is not closed
+      DBG("- '%ls' removed\n", Volume->VolName.wc_str());
+      Volumes.RemoveAtIndex(VolumeIndex);
+      Removed.AddReference(Volume, true);
+    }
+  }
+
+  // the volume cache loaded by ScanVolumes() is used, not saved : it would forget the volumes kept
+  FirstNew = Volumes.size();
+  Status = gBS->LocateHandleBuffer(ByProtocol, &gEfiBlockIoProtocolGuid, NULL, &HandleCount, &Handles);
+  if (!EFI_ERROR(Status)) {
+    for (HandleIndex = 0; HandleIndex < HandleCount; HandleIndex++) {
+      for (VolumeIndex = 0; VolumeIndex < FirstNew; VolumeIndex++) {
+        if (Volumes[VolumeIndex].DeviceHandle == Handles[HandleIndex]) {
+          break;
+        }
+      }
+      if (VolumeIndex == FirstNew) {
+        AddScannedVolume(Handles[HandleIndex], HandleIndex);
+      }
+    }
+    FreePool(Handles);
+  }
+  RelateVolumes(FirstNew);
+
+  DBG("%zu volumes removed, %zu added\n", Removed.size(), Volumes.size() - FirstNew);
+  return Removed.size() > 0 || Volumes.size() > FirstNew;
+}
+
 static void UninitVolumes(void)
 {
   REFIT_VOLUME            *Volume;
@@ -1230,6 +1667,9 @@ BOOLEAN FileExists(IN CONST EFI_FILE *Root, IN CONST CHAR16 *RelativePath)
   EFI_STATUS  Status;
   EFI_FILE    *TestFile = NULL;
   
+  if (ThemePackServes(Root)) {
+    return ThemePackFileExists(RelativePath);
+  }
   Status = Root->Open(Root, &TestFile, RelativePath, EFI_FILE_MODE_READ, 0);
   if (Status == EFI_SUCCESS) {
     if (TestFile && TestFile->Close) {
@@ -1250,6 +1690,91 @@ BOOLEAN FileExists(const EFI_FILE& Root, const XStringW& RelativePath)
   return FileExists(&Root, RelativePath.wc_str());
 }
 
+//
+// FILE_PROBE
+//
+
+#define FILE_PROBE_UNKNOWN 0  // not read, fall back to Open
+#define FILE_PROBE_LISTED  1  // Names holds every entry
+#define FILE_PROBE_MISSING 2  // the directory itself does not exist
+#define FILE_PROBE_MAX_NAMES 64
+
+FILE_PROBE::DIR_LISTING& FILE_PROBE::getListing(const XStringW& DirPath)
+{
+  for (size_t i = 0; i < Dirs.size(); i++) {
+    if (Dirs[i].Path.equalIC(DirPath)) {
+      return Dirs[i];
+    }
+  }
+
+  DIR_LISTING* Listing = new DIR_LISTING;
+  Listing->Path = DirPath;
+  Dirs.AddReference(Listing, true);
+
+  // no need to read a directory whose parent doesn't list it
+  if (DirPath.notEmpty() && !FileExists(DirPath)) {
+    Listing->State = FILE_PROBE_MISSING;
+    return *Listing;
+  }
+
+  REFIT_DIR_ITER  DirIter;
+  EFI_FILE_INFO  *DirEntry = NULL;
+  XStringW        OpenPath = L"\\"_XSW + DirPath;
+  DirIterOpen(Root, OpenPath.wc_str(), &DirIter);
+  if (EFI_ERROR(DirIter.LastStatus)) {
+    DirIterClose(&DirIter);
+    return *Listing;
+  }
+  Listing->State = FILE_PROBE_LISTED;
+  while (DirIterNext(&DirIter, 0, NULL, &DirEntry)) {
+    if (Listing->Names.size() >= FILE_PROBE_MAX_NAMES) {
+      Listing->State = FILE_PROBE_UNKNOWN;
+      break;
+    }
+    Listing->Names.Add(DirEntry->FileName);
+  }
+  // a listing cut short by an error says nothing about the missing names
+  if (EFI_ERROR(DirIter.LastStatus)) {
+    Listing->State = FILE_PROBE_UNKNOWN;
+  }
+  DirIterClose(&DirIter);
+  if (Listing->State != FILE_PROBE_LISTED) {
+    Listing->Names.setEmpty();
+  }
+  return *Listing;
+}
+
+BOOLEAN FILE_PROBE::FileExists(const XStringW& RelativePath)
+{
+  XStringW Path = RelativePath;
+  while (Path.notEmpty() && Path.wc_str()[0] == L'\\') {
+    Path.deleteCharsAtPos(0, 1);
+  }
+  // leave empty, "." and ".." components to the driver
+  XStringW Check = L"\\"_XSW + Path + L"\\"_XSW;
+  if (Path.isEmpty() || Check.contains(L"\\\\") || Check.contains(L"\\.\\") || Check.contains(L"\\..\\")) {
+    return ::FileExists(Root, RelativePath);
+  }
+
+  size_t Sep = Path.rindexOf('\\');
+  XStringW DirPath = (Sep == MAX_XSIZE) ? XStringW() : Path.subString(0, Sep);
+  XStringW Name = (Sep == MAX_XSIZE) ? Path : Path.subString(Sep + 1, MAX_XSIZE);
+
+  DIR_LISTING& Listing = getListing(DirPath);
+  if (Listing.State == FILE_PROBE_MISSING) {
+    return FALSE;
+  }
+  if (Listing.State == FILE_PROBE_LISTED) {
+    if (Listing.Names.contains(Name)) {
+      return TRUE;
+    }
+    if (!Listing.Names.containsIC(Name)) {
+      return FALSE;
+    }
+  }
+  return ::FileExists(Root, RelativePath);
+}
+
 BOOLEAN DeleteFile(const EFI_FILE *Root, IN CONST CHAR16 *RelativePath)
 {
   EFI_STATUS  Status;
@@ -1633,6 +2158,7 @@ void DbgHeader(CONST CHAR8 *str)
 
   SetMem(&strLog[end], len , '=');
   strLog[49] = '\0';
+  MemLogMarkPhase(str); // index for bdmesg -p
   DebugLog (1, "%s\n", strLog);
 }
 
@@ -297,6 +297,8 @@ EFI_STATUS  ReinitRefitLib(void);
 EFI_STATUS ExtractLegacyLoaderPaths(EFI_DEVICE_PATH **PathList, UINTN MaxPaths, EFI_DEVICE_PATH **HardcodedPathList);
 
 void ScanVolumes(void);
+BOOLEAN RescanVolumes(XObjArray<REFIT_VOLUME>& Removed);
+void RevalidateVolumeBootcode(IN OUT REFIT_VOLUME *Volume);
 
 REFIT_VOLUME *FindVolumeByName(IN CONST CHAR16 *VolName);
 
@@ -304,6 +306,38 @@ BOOLEAN FileExists(const EFI_FILE *BaseDir, const CHAR16 *RelativePath);
 BOOLEAN FileExists(const EFI_FILE *BaseDir, const XStringW& RelativePath);
 BOOLEAN FileExists(const EFI_FILE& Root, const XStringW& RelativePath);
 
+/*
+ * Answers FileExists() for many candidate paths on one volume by reading each
+ * parent directory once, instead of an Open/Close per candidate.
+ * A listing is only trusted to say that a name is missing: a name matching
+ * only case-insensitively is still opened, since the file system may be
+ * case-sensitive. Large, unreadable or odd directories fall back to Open too.
+ */
+class FILE_PROBE
+{
+  class DIR_LISTING
+  {
+  public:
+    XStringW      Path;
+    XStringWArray Names;
+    UINT8         State;
+    DIR_LISTING() : Path(), Names(), State(0) {}
+  };
+
+  const EFI_FILE          *Root;
+  XObjArray<DIR_LISTING>   Dirs;
+
+  DIR_LISTING& getListing(const XStringW& DirPath);
+
+public:
+  FILE_PROBE(const EFI_FILE *aRoot) : Root(aRoot), Dirs() {}
+  FILE_PROBE(const FILE_PROBE&) = delete;
+  FILE_PROBE& operator = (const FILE_PROBE&) = delete;
+
+  const EFI_FILE *root() const { return Root; }
+  BOOLEAN FileExists(const XStringW& RelativePath);
+};
+
 inline EFI_DEVICE_PATH_PROTOCOL* FileDevicePath (IN EFI_HANDLE Device, IN CONST XStringW& FileName) { return FileDevicePath(Device, FileName.wc_str()); }
 
 BOOLEAN DeleteFile(const EFI_FILE *Root, IN CONST CHAR16 *RelativePath);
@@ -38,7 +38,9 @@
 #include "../cpp_foundation/XString.h"
 #include "../cpp_util/globals_ctor.h"
 #include "../cpp_util/globals_dtor.h"
+#include "../cpp_util/operatorNewDelete.h"
 #include "../cpp_unit_test/all_tests.h"
+#include "../cpp_unit_test/acpi_replay.h"
 
 #include "../entry_scan/entry_scan.h"
 #include "../libeg/nanosvg.h"
@@ -64,6 +66,8 @@
 #include "../Platform/Edid.h"
 #include "../Platform/Console.h"
 #include "../Platform/Net.h"
+#include "../Platform/PciSnapshot.h"
+#include "../Platform/HandleSnapshot.h"
 #include "../Platform/spd.h"
 #include "../Platform/Injectors.h"
 #include "../Platform/StartupSound.h"
@@ -77,6 +81,18 @@
 #include "../include/OsType.h"
 
 #include "../include/OC.h"
+#include "../Platform/BootTimeline.h"
+#include "../Platform/PerfCounters.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <Protocol/PartitionInfo.h>
+
+#ifdef __cplusplus
+}
+#endif
 
 
 #ifndef DEBUG_ALL
@@ -151,10 +167,97 @@ extern EFI_DXE_SERVICES  *gDS;
 //}
 //#endif
 
+// Tools started from the menu (shell, gptsync, bdmesg...) are read once per session, then LoadImage()
+// gets them from memory. LoadImage() still relocates them, that's cheap next to the read from the ESP.
+#define TOOL_IMAGE_CACHE_COUNT  8
+#define TOOL_IMAGE_CACHE_BYTES  (16 * 1024 * 1024)
+
+typedef struct {
+  EFI_DEVICE_PATH  *DevicePath;
+  UINTN             DevicePathSize;
+  UINT8            *Buffer;
+  UINTN             Size;
+} TOOL_IMAGE;
+
+static TOOL_IMAGE ToolImages[TOOL_IMAGE_CACHE_COUNT];
+static UINTN      ToolImagesCount = 0;
+static UINTN      ToolImagesBytes = 0;
+
+// Returns the cached file of a tool, read now if it wasn't. NULL if it can't be read or cached, then
+// LoadImage() reads the file itself.
+static const TOOL_IMAGE* GetToolImage(IN EFI_DEVICE_PATH *DevicePath)
+{
+  EFI_STATUS                Status;
+  EFI_DEVICE_PATH          *TmpDevicePath;
+  EFI_DEVICE_PATH          *FilePath;
+  EFI_HANDLE                Handle = NULL;
+  EFI_FILE                 *Root;
+  FILEPATH_DEVICE_PATH     *FilePathNode;
+  TOOL_IMAGE               *Image;
+  UINTN                     DevicePathSize;
+  UINTN                     Index;
+
+  if (DevicePath == NULL) {
+    return NULL;
+  }
+  DevicePathSize = GetDevicePathSize(DevicePath);
+  for (Index = 0; Index < ToolImagesCount; Index++) {
+    if (ToolImages[Index].DevicePathSize == DevicePathSize && CompareMem(ToolImages[Index].DevicePath, DevicePath, DevicePathSize) == 0) {
+      return &ToolImages[Index];
+    }
+  }
+  if (ToolImagesCount >= TOOL_IMAGE_CACHE_COUNT) {
+    return NULL;
+  }
+
+  // the tool entries are a volume and one file path node
+  TmpDevicePath = DuplicateDevicePath(DevicePath);
+  if (TmpDevicePath == NULL) {
+    return NULL;
+  }
+  FilePath = TmpDevicePath;
+  Status = gBS->LocateDevicePath(&gEfiSimpleFileSystemProtocolGuid, &FilePath, &Handle);
+  FilePathNode = (FILEPATH_DEVICE_PATH *)FilePath;
+  if (EFI_ERROR(Status) || DevicePathType(FilePath) != MEDIA_DEVICE_PATH || DevicePathSubType(FilePath) != MEDIA_FILEPATH_DP ||
+      !IsDevicePathEnd(NextDevicePathNode(FilePath))) {
+    FreePool(TmpDevicePath);
+    return NULL;
+  }
+  Root = EfiLibOpenRoot(Handle);
+  if (Root == NULL) {
+    FreePool(TmpDevicePath);
+    return NULL;
+  }
+  Image = &ToolImages[ToolImagesCount];
+  Status = egLoadFile(Root, FilePathNode->PathName, &Image->Buffer, &Image->Size);
+  Root->Close(Root);
+  FreePool(TmpDevicePath);
+  if (EFI_ERROR(Status)) {
+    return NULL;
+  }
+  if (ToolImagesBytes + Image->Size > TOOL_IMAGE_CACHE_BYTES) {
+    FreePool(Image->Buffer);
+    Image->Buffer = NULL;
+    return NULL;
+  }
+  Image->DevicePath = DuplicateDevicePath(DevicePath);
+  if (Image->DevicePath == NULL) {
+    FreePool(Image->Buffer);
+    Image->Buffer = NULL;
+    return NULL;
+  }
+  Image->DevicePathSize = DevicePathSize;
+  ToolImagesBytes += Image->Size;
+  ToolImagesCount++;
+  return Image;
+}
+
 static EFI_STATUS LoadEFIImageList(IN EFI_DEVICE_PATH **DevicePaths,
                                     IN CONST XStringW& ImageTitle,
                                     OUT UINTN *ErrorInStep,
-                                    OUT EFI_HANDLE *NewImageHandle)
+                                    OUT EFI_HANDLE *NewImageHandle,
+                                    IN void *SourceBuffer = NULL,
+                                    IN UINTN SourceSize = 0)
 {
   EFI_STATUS              Status, ReturnStatus;
   EFI_HANDLE              ChildImageHandle = 0;
@@ -172,7 +275,7 @@ static EFI_STATUS LoadEFIImageList(IN EFI_DEVICE_PATH **DevicePaths,
   // load the image into memory
   ReturnStatus = Status = EFI_NOT_FOUND;  // in case the list is empty
   for (DevicePathIndex = 0; DevicePaths[DevicePathIndex] != NULL; DevicePathIndex++) {
-    ReturnStatus = Status = gBS->LoadImage(FALSE, self.getSelfImageHandle(), DevicePaths[DevicePathIndex], NULL, 0, &ChildImageHandle);
+    ReturnStatus = Status = gBS->LoadImage(FALSE, self.getSelfImageHandle(), DevicePaths[DevicePathIndex], SourceBuffer, SourceSize, &ChildImageHandle);
     DBG("  status=%s", efiStrError(Status));
     if (ReturnStatus != EFI_NOT_FOUND)
       break;
@@ -299,7 +402,8 @@ bailout:
 static EFI_STATUS LoadEFIImage(IN EFI_DEVICE_PATH *DevicePath,
                                 IN CONST XStringW& ImageTitle,
                                 OUT UINTN *ErrorInStep,
-                                OUT EFI_HANDLE *NewImageHandle)
+                                OUT EFI_HANDLE *NewImageHandle,
+                                IN const TOOL_IMAGE *Cached = NULL)
 {
   EFI_DEVICE_PATH *DevicePaths[2];
 
@@ -317,6 +421,9 @@ static EFI_STATUS LoadEFIImage(IN EFI_DEVICE_PATH *DevicePath,
   // Load the image now
   DevicePaths[0] = DevicePath;
   DevicePaths[1] = NULL;
+  if (Cached != NULL) {
+    return LoadEFIImageList(DevicePaths, ImageTitle, ErrorInStep, NewImageHandle, Cached->Buffer, Cached->Size);
+  }
   return LoadEFIImageList(DevicePaths, ImageTitle, ErrorInStep, NewImageHandle);
 }
 
@@ -325,12 +432,13 @@ static EFI_STATUS StartEFIImage(IN EFI_DEVICE_PATH *DevicePath,
                                 IN CONST XString8Array& LoadOptions, IN CONST CHAR16 *LoadOptionsPrefix,
                                 IN CONST XStringW& ImageTitle,
                                 OUT UINTN *ErrorInStep,
-                                OUT EFI_HANDLE *NewImageHandle)
+                                OUT EFI_HANDLE *NewImageHandle,
+                                IN const TOOL_IMAGE *Cached = NULL)
 {
   EFI_STATUS Status;
   EFI_HANDLE ChildImageHandle = NULL;
 
-  Status = LoadEFIImage(DevicePath, ImageTitle, ErrorInStep, &ChildImageHandle);
+  Status = LoadEFIImage(DevicePath, ImageTitle, ErrorInStep, &ChildImageHandle, Cached);
   if (!EFI_ERROR(Status)) {
     Status = StartEFILoadedImage(ChildImageHandle, LoadOptions, LoadOptionsPrefix, ImageTitle, ErrorInStep);
   }
@@ -341,6 +449,194 @@ static EFI_STATUS StartEFIImage(IN EFI_DEVICE_PATH *DevicePath,
   return Status;
 }
 
+//
+// Optional Drivers.plist in a driver directory. The drivers it doesn't name start as before, the others are deferred :
+//   <key>AudioDxe.efi</key>
+//   <dict>
+//     <key>Start</key>
+//     <string>Menu</string>
+//     <key>PartitionTypes</key>
+//     <array>
+//       <string>48465300-0000-11AA-AA11-00306543ECAC</string>
+//     </array>
+//   </dict>
+// Start : Now (default), or Menu to start the driver when the menu is shown, or before a boot when there is no menu.
+// PartitionTypes : start the driver only if a GPT partition has one of these types. It is checked after the first
+// connect, so a driver with only this condition still starts before the volumes are scanned.
+// Without EFI_PARTITION_INFO_PROTOCOL in the firmware, the types can't be checked and the driver starts.
+//
+#define DRIVERS_MANIFEST L"Drivers.plist"
+
+typedef enum {
+  DriverStartNow,
+  DriverStartConnected,
+  DriverStartMenu
+} DRIVER_START;
+
+class DEFERRED_DRIVER
+{
+public:
+  XStringW       FileName;   // full path
+  XStringW       Name;
+  DRIVER_START   Start;
+  XString8Array  PartitionTypes;
+
+  DEFERRED_DRIVER() : FileName(), Name(), Start(DriverStartNow), PartitionTypes() {}
+  DEFERRED_DRIVER(const DEFERRED_DRIVER& other) = delete; // Can be defined if needed
+  const DEFERRED_DRIVER& operator = ( const DEFERRED_DRIVER & ) = delete; // Can be defined if needed
+};
+
+static XObjArray<DEFERRED_DRIVER> DeferredDrivers;
+
+static void DriverStarted(const XStringW& FileName, EFI_HANDLE DriverHandle)
+{
+  if ( FileName.containsIC("AudioDxe") ) {
+    AudioDriverHandle = DriverHandle;
+  }
+  if ( FileName.containsIC("EmuVariable") ) {
+    gDriversFlags.EmuVariableLoaded = TRUE;
+  } else if ( FileName.containsIC("Video") ) {
+    gDriversFlags.VideoLoaded = TRUE;
+  } else if ( FileName.containsIC("Partition") ) {
+    gDriversFlags.PartitionLoaded = TRUE;
+  } else if ( FileName.containsIC("HFS") ) {
+    gDriversFlags.HFSLoaded = TRUE;
+  } else if ( FileName.containsIC("apfs") ) {
+    gDriversFlags.APFSLoaded = TRUE;
+  }
+}
+
+static TagDict* LoadDriversManifest(IN CONST CHAR16 *Path)
+{
+  EFI_STATUS  Status;
+  UINT8       *Buffer = NULL;
+  UINTN       Size = 0;
+  TagDict*    Dict = NULL;
+  XStringW    ManifestPath = SWPrintf("%ls\\%ls", Path, DRIVERS_MANIFEST);
+
+  Status = egLoadFile(&self.getCloverDir(), ManifestPath.wc_str(), &Buffer, &Size);
+  if (EFI_ERROR(Status)) {
+    return NULL;
+  }
+  Status = ParseXML((const CHAR8*)Buffer, &Dict, Size);
+  FreePool(Buffer);
+  if (EFI_ERROR(Status)) {
+    MsgLog("%ls: %s, drivers start as without it\n", ManifestPath.wc_str(), efiStrError(Status));
+    return NULL;
+  }
+  return Dict;
+}
+
+// When a driver of the manifest starts. DriverStartNow if it is not in the manifest.
+static DRIVER_START DriverStartFromManifest(const TagDict* Manifest, IN CONST CHAR16 *Name, OUT XString8Array* PartitionTypes)
+{
+  DRIVER_START Start = DriverStartNow;
+
+  PartitionTypes->setEmpty();
+  if (Manifest == NULL) {
+    return DriverStartNow;
+  }
+  const TagDict* DriverDict = Manifest->dictPropertyForKey(XString8().takeValueFrom(Name).c_str());
+  if (DriverDict == NULL) {
+    return DriverStartNow;
+  }
+  const TagStruct* Prop = DriverDict->propertyForKey("Start");
+  if (Prop != NULL && Prop->isString() && Prop->getString()->stringValue().equalIC("Menu")) {
+    Start = DriverStartMenu;
+  }
+  const TagArray* Types = DriverDict->arrayPropertyForKey("PartitionTypes");
+  if (Types != NULL) {
+    for (size_t i = 0; i < Types->arrayContent().size(); i++) {
+      const TagStruct* Type = &Types->arrayContent()[i];
+      if ( !Type->isString() ) {
+        MsgLog("MALFORMED PLIST : PartitionTypes must be an array of string");
+        continue;
+      }
+      PartitionTypes->Add(Type->getString()->stringValue());
+    }
+  }
+  if (Start == DriverStartNow && PartitionTypes->notEmpty()) {
+    Start = DriverStartConnected;
+  }
+  return Start;
+}
+
+// TRUE if a GPT partition has one of the Types, or if the firmware can't tell
+static BOOLEAN PartitionTypeExists(const XString8Array& Types)
+{
+  EFI_STATUS                  Status;
+  UINTN                       HandleCount = 0;
+  EFI_HANDLE                  *Handles = NULL;
+  EFI_PARTITION_INFO_PROTOCOL *PartitionInfo;
+  EFI_GUID                    TypeGuid;
+  BOOLEAN                     Found = FALSE;
+
+  Status = gBS->LocateHandleBuffer(ByProtocol, &gEfiPartitionInfoProtocolGuid, NULL, &HandleCount, &Handles);
+  if (EFI_ERROR(Status) || HandleCount == 0) {
+    DBG(" - no PartitionInfo, partition types not checked\n");
+    return TRUE;
+  }
+  for (UINTN Index = 0; Index < HandleCount && !Found; Index++) {
+    Status = gBS->HandleProtocol(Handles[Index], &gEfiPartitionInfoProtocolGuid, (void **)&PartitionInfo);
+    if (EFI_ERROR(Status) || PartitionInfo->Type != PARTITION_TYPE_GPT) {
+      continue;
+    }
+    for (size_t i = 0; i < Types.size() && !Found; i++) {
+      if (!EFI_ERROR(StrToGuidLE(Types[i], &TypeGuid))) {
+        Found = CompareGuid(&PartitionInfo->Info.Gpt.PartitionTypeGUID, &TypeGuid);
+      }
+    }
+  }
+  FreePool(Handles);
+  return Found;
+}
+
+// Starts the drivers deferred to Phase and connects them to the controllers
+static void StartDeferredDrivers(DRIVER_START Phase)
+{
+  EFI_STATUS                   Status;
+  EFI_HANDLE                   DriverHandle;
+  EFI_DRIVER_BINDING_PROTOCOL  *DriverBinding;
+  XArray<EFI_HANDLE>           Started;
+  UINTN                        HandleCount = 0;
+  EFI_HANDLE                   *Handles = NULL;
+
+  for (size_t Index = 0; Index < DeferredDrivers.size(); ) {
+    const DEFERRED_DRIVER& Driver = DeferredDrivers[Index];
+    if (Driver.Start != Phase) {
+      Index++;
+      continue;
+    }
+    if (Driver.PartitionTypes.isEmpty() || PartitionTypeExists(Driver.PartitionTypes)) {
+      DriverHandle = NULL;
+      Status = StartEFIImage(FileDevicePath(self.getSelfLoadedImage().DeviceHandle, Driver.FileName), NullXString8Array, Driver.Name.wc_str(), Driver.Name, NULL, &DriverHandle);
+      DBG("Deferred driver %ls: %s\n", Driver.Name.wc_str(), efiStrError(Status));
+      if (!EFI_ERROR(Status)) {
+        DriverStarted(Driver.FileName, DriverHandle);
+        if (DriverHandle != NULL && !EFI_ERROR(gBS->HandleProtocol(DriverHandle, &gEfiDriverBindingProtocolGuid, (void **)&DriverBinding))) {
+          Started.Add(DriverHandle);
+        }
+      }
+    } else {
+      DBG("Deferred driver %ls: no partition of its types, not started\n", Driver.Name.wc_str());
+    }
+    DeferredDrivers.RemoveAtIndex(Index);
+  }
+  if (Started.isEmpty()) {
+    return;
+  }
+  // only these drivers, the controllers are connected already
+  Started.Add(NULL);
+  Status = gBS->LocateHandleBuffer(AllHandles, NULL, NULL, &HandleCount, &Handles);
+  if (EFI_ERROR(Status)) {
+    return;
+  }
+  for (UINTN Index = 0; Index < HandleCount; Index++) {
+    gBS->ConnectController(Handles[Index], Started.data(), NULL, TRUE);
+  }
+  FreePool(Handles);
+}
+
 /*
 static EFI_STATUS StartEFIImageList(IN EFI_DEVICE_PATH **DevicePaths,
                                 IN CHAR16 *LoadOptions, IN CHAR16 *LoadOptionsPrefix,
@@ -448,7 +744,7 @@ void LOADER_ENTRY::FilterKextPatches()
         continue; 
       }
 
-      KernelAndKextPatches.KextPatches[i].MenuItem.BValue = IsPatchEnabled(KernelAndKextPatches.KextPatches[i].MatchOS, OSVersion);
+      KernelAndKextPatches.KextPatches[i].MenuItem.BValue = KernelAndKextPatches.KextPatches[i].MatchOSPatterns.match(OSVersion);
       DBG(" ==> %s\n", KernelAndKextPatches.KextPatches[i].MenuItem.BValue ? "allowed" : "not allowed");
     }
   }
@@ -478,7 +774,7 @@ void LOADER_ENTRY::FilterKernelPatches()
         continue; 
       }
 
-      KernelAndKextPatches.KernelPatches[i].MenuItem.BValue = IsPatchEnabled(KernelAndKextPatches.KernelPatches[i].MatchOS, OSVersion);
+      KernelAndKextPatches.KernelPatches[i].MenuItem.BValue = KernelAndKextPatches.KernelPatches[i].MatchOSPatterns.match(OSVersion);
       DBG(" ==> %s by OS\n", KernelAndKextPatches.KernelPatches[i].MenuItem.BValue ? "allowed" : "not allowed");
     }
   }
@@ -507,7 +803,7 @@ void LOADER_ENTRY::FilterBootPatches()
         continue;
       }
  
-      KernelAndKextPatches.BootPatches[i].MenuItem.BValue = IsPatchEnabled(KernelAndKextPatches.BootPatches[i].MatchOS, OSVersion);
+      KernelAndKextPatches.BootPatches[i].MenuItem.BValue = KernelAndKextPatches.BootPatches[i].MatchOSPatterns.match(OSVersion);
       DBG(" ==> %s by OS\n", KernelAndKextPatches.BootPatches[i].MenuItem.BValue ? "allowed" : "not allowed");
   
     }
@@ -731,6 +1027,60 @@ if ( kextPatch.Label ==  "algrey - cpuid_set_info - ryzen cores and logicals cou
   }
 }
 
+//
+// FatDelayedFlush : the FAT driver reads this volatile variable and leaves the FAT, dirent and FSInfo
+// updates of the log and dump writes in its cache for that many milliseconds. Before anything is
+// handed the machine, the policy is turned off and every volume is flushed.
+//
+#define FAT_DELAYED_FLUSH_VARIABLE L"Clover.FatDelayedFlush"
+#define FAT_DELAYED_FLUSH_DELAY    1000
+
+static void SetFatDelayedFlush(BOOLEAN Enable)
+{
+  UINT32 Delay = FAT_DELAYED_FLUSH_DELAY;
+
+  // gRT directly : the driver has to see it at once, not at the next NvramFlush()
+  gRT->SetVariable(FAT_DELAYED_FLUSH_VARIABLE, &gEfiAppleBootGuid, EFI_VARIABLE_BOOTSERVICE_ACCESS,
+                   Enable ? sizeof(Delay) : 0, Enable ? &Delay : NULL);
+}
+
+/** Ends the delayed FAT commits and writes what is still pending on every volume. To be called before a boot or a reset. */
+static void CommitFatVolumes(void)
+{
+  EFI_STATUS                       Status;
+  UINTN                            HandleCount = 0;
+  EFI_HANDLE                       *Handles = NULL;
+  EFI_SIMPLE_FILE_SYSTEM_PROTOCOL  *FileSystem;
+  EFI_FILE_PROTOCOL                *Root;
+
+  if (!GlobalConfig.FatDelayedFlush) {
+    return;
+  }
+  SetFatDelayedFlush(FALSE);
+
+  Status = gBS->LocateHandleBuffer(ByProtocol, &gEfiSimpleFileSystemProtocolGuid, NULL, &HandleCount, &Handles);
+  if (EFI_ERROR(Status)) {
+    return;
+  }
+  for (UINTN Index = 0; Index < HandleCount; Index++) {
+    Status = gBS->HandleProtocol(Handles[Index], &gEfiSimpleFileSystemProtocolGuid, (void **)&FileSystem);
+    if (EFI_ERROR(Status) || EFI_ERROR(FileSystem->OpenVolume(FileSystem, &Root))) {
+      continue;
+    }
+    // Flush() of a read only handle is refused, so reopen the root for writing. Read only volumes fail here and have nothing to commit.
+    EFI_FILE_PROTOCOL *WritableRoot = NULL;
+    if (!EFI_ERROR(Root->Open(Root, &WritableRoot, L"\\", EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE, 0))) {
+      Status = WritableRoot->Flush(WritableRoot);
+      if (EFI_ERROR(Status)) {
+        DBG("Flush of volume %llu: %s\n", Index, efiStrError(Status));
+      }
+      WritableRoot->Close(WritableRoot);
+    }
+    Root->Close(Root);
+  }
+  FreePool(Handles);
+}
+
 void LOADER_ENTRY::StartLoader()
 {
   EFI_STATUS              Status;
@@ -743,6 +1093,10 @@ void LOADER_ENTRY::StartLoader()
   DbgHeader("StartLoader");
   
   DBG("Starting %ls\n", FileDevicePathToXStringW(DevicePath).wc_str());
+  StartDeferredDrivers(DriverStartMenu);
+  BdsLibConnectDeferred();
+  FetchEntryInfo(); // OSVersion is needed from here on
+  OSVersionCacheSave();
 
   if (Settings.notEmpty()) {
     DBG("  Settings: %ls\n", Settings.wc_str());
@@ -1044,9 +1398,14 @@ DBG("Beginning OC\n");
   pos = setKextAtPos(&kextArray, "HS80211Family.kext"_XS8, pos);
   pos = setKextAtPos(&kextArray, "AirPortAtheros40.kext"_XS8, pos);
 
+  // read all Info.plist first, in a pipeline
+  XObjArray<KEXT_INFO_PLIST> kextPlists;
+  PreloadKextsInfoPlist(kextArray, &kextPlists);
+
   for (size_t kextIdx = 0 ; kextIdx < kextArray.size() ; kextIdx++ )
   {
     const SIDELOAD_KEXT& KextEntry = kextArray[kextIdx];
+    const KEXT_INFO_PLIST& KextPlist = kextPlists[kextIdx];
     DBG("Bridge kext to OC : Path=%ls\n", KextEntry.FileName.wc_str());
     mOpenCoreConfiguration.Kernel.Add.Values[kextIdx] = (__typeof_am__(*mOpenCoreConfiguration.Kernel.Add.Values))malloc(mOpenCoreConfiguration.Kernel.Add.ValueSize);
     memset(mOpenCoreConfiguration.Kernel.Add.Values[kextIdx], 0, mOpenCoreConfiguration.Kernel.Add.ValueSize);
@@ -1061,16 +1420,17 @@ DBG("Beginning OC\n");
     XStringW dirPath = SWPrintf("%ls\\%ls", selfOem.getKextsDirPathRelToSelfDir().wc_str(), KextEntry.KextDirNameUnderOEMPath.wc_str());
 //    XString8 bundlePath = S8Printf("%ls\\%ls\\%ls", selfOem.getKextsPathRelToSelfDir().wc_str(), KextEntry.KextDirNameUnderOEMPath.wc_str(), KextEntry.FileName.wc_str());
     XString8 bundlePath = S8Printf("%ls\\%ls", dirPath.wc_str(), KextEntry.FileName.wc_str());
-    if ( FileExists(&self.getCloverDir(), bundlePath) ) {
+    // a bundle with an Info.plist exists, no need for one more Open
+    if ( KextPlist.Path.notEmpty() || FileExists(&self.getCloverDir(), bundlePath) ) {
       OC_STRING_ASSIGN(mOpenCoreConfiguration.Kernel.Add.Values[kextIdx]->BundlePath, bundlePath.c_str());
     }else{
       DBG("Cannot find kext bundlePath at '%s'\n", bundlePath.c_str());
     }
 #if 1
     //CFBundleExecutable
-    BOOLEAN   NoContents = FALSE;
-    XStringW  infoPlistPath = getKextPlist(dirPath, KextEntry, &NoContents); //it will be fullPath, including dir
-    TagDict*  dict = getInfoPlist(infoPlistPath);
+    BOOLEAN   NoContents = KextPlist.NoContents;
+    const XStringW& infoPlistPath = KextPlist.Path; //it will be fullPath, including dir
+    TagDict*  dict = KextPlist.Dict;
 //    BOOLEAN inject = checkOSBundleRequired(dict);
     BOOLEAN inject = true;
     if (inject) {
@@ -1083,7 +1443,7 @@ DBG("Beginning OC\n");
       }else{
         DBG("Cannot find kext info.plist at '%ls'\n", KextEntry.FileName.wc_str());
       }
-      XString8 execpath = getKextExecPath(dirPath, KextEntry, dict, NoContents);
+      XString8 execpath = dict == NULL ? XString8() : getKextExecPath(dirPath, KextEntry, dict, NoContents);
       if (execpath.notEmpty()) {
         OC_STRING_ASSIGN(mOpenCoreConfiguration.Kernel.Add.Values[kextIdx]->ExecutablePath, execpath.c_str());
         DBG("assign executable as '%s'\n", execpath.c_str());
@@ -1197,6 +1557,8 @@ DBG("Beginning OC\n");
 }
 
   egClearScreen(&BootBgColor); //if not set then it is already MenuBackgroundPixel
+  // the NVRAM writes of the boot preparation are flushed before the start
+  NvramBeginBatch();
 
 //  KillMouse();
 
@@ -1281,6 +1643,7 @@ DBG("Beginning OC\n");
     }
     
     DelegateKernelPatches();
+    PrepareKextPatchJobs();
 
     // Set boot argument for kernel if no caches, this should force kernel loading
     if (  OSFLAG_ISSET(Flags, OSFLAG_NOCACHES)  &&  !LoadOptions.containsStartWithIC("Kernel=")  ) {
@@ -1486,6 +1849,10 @@ DBG("Beginning OC\n");
     }
   } // !OSTYPE_IS_WINDOWS
 
+  LogNewDeleteStats();
+  TimelineReport(&self.getCloverDir());
+  PerfCountersSave();
+
   if (OSTYPE_IS_OSX(LoaderType) ||
       OSTYPE_IS_OSX_RECOVERY(LoaderType) ||
       OSTYPE_IS_OSX_INSTALLER(LoaderType)) {
@@ -1500,7 +1867,7 @@ DBG("Beginning OC\n");
       SavePreBootLog = FALSE;
     } else {
       // delete boot-switch-vars if exists
-      Status = gRT->SetVariable(L"boot-switch-vars", &gEfiAppleBootGuid,
+      Status = NvramSetVariable(L"boot-switch-vars", &gEfiAppleBootGuid,
                                 EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS,
                                 0, NULL);
       DeleteNvramVariable(L"IOHibernateRTCVariables", &gEfiAppleBootGuid);
@@ -1525,6 +1892,9 @@ DBG("Beginning OC\n");
 //    }
   }
 
+  CommitFatVolumes();
+  NvramFlush();
+  egRestoreFramebufferCaching();
   // point to OcStartImage from OC
   Status = gBS->StartImage (ImageHandle, 0, NULL);
   if ( EFI_ERROR(Status) ) return; // TODO message ?
@@ -1534,6 +1904,9 @@ DBG("Beginning OC\n");
 //                Basename(LoaderPath), Basename(LoaderPath), NULL, NULL);
 
 //  DBG("StartEFILoadedImage\n");
+  CommitFatVolumes();
+  NvramFlush();
+  egRestoreFramebufferCaching();
   StartEFILoadedImage(ImageHandle, LoadOptions, Basename(LoaderPath.wc_str()), LoaderPath.basename(), NULL);
 }
   // Unlock boot screen
@@ -1555,6 +1928,14 @@ void LEGACY_ENTRY::StartLegacy()
 {
     EFI_STATUS          Status = EFI_UNSUPPORTED;
 
+    StartDeferredDrivers(DriverStartMenu);
+    BdsLibConnectDeferred();
+    // bootcode taken from the volume cache is read again, DriveCRC32 and BootType must be current
+    RevalidateVolumeBootcode(Volume);
+
+    CommitFatVolumes();
+    egRestoreFramebufferCaching();
+
     // Unload EmuVariable before booting legacy.
     // This is not needed in most cases, but it seems to interfere with legacy OS
     // booted on some UEFI bioses, such as Phoenix UEFI 2.0
@@ -1614,10 +1995,12 @@ void LEGACY_ENTRY::StartLegacy()
 void REFIT_MENU_ENTRY_LOADER_TOOL::StartTool()
 {
   DBG("Start Tool: %ls\n", LoaderPath.wc_str());
+  StartDeferredDrivers(DriverStartMenu);
+  BdsLibConnectDeferred();
   egClearScreen(&MenuBackgroundPixel);
 	// assumes "Start <title>" as assigned below
 	BeginExternalScreen(OSFLAG_ISSET(Flags, OSFLAG_USEGRAPHICS)/*, &Entry->Title[6]*/); // Shouldn't we check that length of Title is at least 6 ?
-    StartEFIImage(DevicePath, LoadOptions, Basename(LoaderPath.wc_str()), LoaderPath.basename(), NULL, NULL);
+    StartEFIImage(DevicePath, LoadOptions, Basename(LoaderPath.wc_str()), LoaderPath.basename(), NULL, NULL, GetToolImage(DevicePath));
     FinishExternalScreen();
 }
 
@@ -1637,6 +2020,9 @@ static void ScanDriverDir(IN CONST CHAR16 *Path, OUT EFI_HANDLE **DriversToConne
   EFI_HANDLE              *DriversArr;
   BOOLEAN                 Skip;
   UINT8                   AptioBlessed;
+  TagDict*                Manifest;
+  DRIVER_START            Start;
+  XString8Array           PartitionTypes;
   STATIC CHAR16 CONST * CONST AptioNames[] = {
     L"AptioMemoryFix",
     L"AptioFix3Drv",
@@ -1675,6 +2061,8 @@ static void ScanDriverDir(IN CONST CHAR16 *Path, OUT EFI_HANDLE **DriversToConne
   }
   DirIterClose(&DirIter);
 
+  Manifest = LoadDriversManifest(Path);
+
   // look through contents of the directory
   DirIterOpen(&self.getCloverDir(), Path, &DirIter);
   while (DirIterNext(&DirIter, 2, L"*.efi", &DirEntry)) {
@@ -1714,24 +2102,22 @@ static void ScanDriverDir(IN CONST CHAR16 *Path, OUT EFI_HANDLE **DriversToConne
 #undef BOOLEAN_AT_INDEX
 
 	  XStringW FileName = SWPrintf("%ls\\%ls\\%ls", self.getCloverDirFullPath().wc_str(), Path, DirEntry->FileName);
+    Start = DriverStartFromManifest(Manifest, DirEntry->FileName, &PartitionTypes);
+    if (Start != DriverStartNow) {
+      DEFERRED_DRIVER* Deferred = new DEFERRED_DRIVER;
+      Deferred->FileName = FileName;
+      Deferred->Name.takeValueFrom(DirEntry->FileName);
+      Deferred->Start = Start;
+      Deferred->PartitionTypes = PartitionTypes;
+      DeferredDrivers.AddReference(Deferred, true);
+      DBG("Driver %ls deferred\n", DirEntry->FileName);
+      continue;
+    }
     Status = StartEFIImage(FileDevicePath(self.getSelfLoadedImage().DeviceHandle, FileName), NullXString8Array, DirEntry->FileName, XStringW().takeValueFrom(DirEntry->FileName), NULL, &DriverHandle);
     if (EFI_ERROR(Status)) {
       continue;
     }
-    if ( FileName.containsIC("AudioDxe") ) {
-      AudioDriverHandle = DriverHandle;
-    }
-    if ( FileName.containsIC("EmuVariable") ) {
-      gDriversFlags.EmuVariableLoaded = TRUE;
-    } else if ( FileName.containsIC("Video") ) {
-      gDriversFlags.VideoLoaded = TRUE;
-    } else if ( FileName.containsIC("Partition") ) {
-      gDriversFlags.PartitionLoaded = TRUE;
-    } else if ( FileName.containsIC("HFS") ) {
-      gDriversFlags.HFSLoaded = TRUE;
-    } else if ( FileName.containsIC("apfs") ) {
-      gDriversFlags.APFSLoaded = TRUE;
-    }
+    DriverStarted(FileName, DriverHandle);
     if (DriverHandle != NULL && DriversToConnectNum != NULL && DriversToConnect != NULL) {
       // driver loaded - check for EFI_DRIVER_BINDING_PROTOCOL
       Status = gBS->HandleProtocol(DriverHandle, &gEfiDriverBindingProtocolGuid, (void **) &DriverBinding);
@@ -1760,6 +2146,10 @@ static void ScanDriverDir(IN CONST CHAR16 *Path, OUT EFI_HANDLE **DriversToConne
     CheckError(Status, SWPrintf( "while scanning the %ls directory", Path).wc_str());
   }
 
+  if (Manifest != NULL) {
+    Manifest->FreeTag();
+  }
+
   if (DriversToConnectNum != NULL && DriversToConnect != NULL) {
     *DriversToConnectNum = DriversArrNum;
     *DriversToConnect = DriversArr;
@@ -1775,37 +2165,29 @@ static void ScanDriverDir(IN CONST CHAR16 *Path, OUT EFI_HANDLE **DriversToConne
  * To fix it: we will disconnect drivers that connected to DiskIo BY_DRIVER
  * if this is partition volume and if those drivers did not produce file system.
  */
-void DisconnectInvalidDiskIoChildDrivers(void)
+void DisconnectInvalidDiskIoChildDrivers(const HANDLE_SNAPSHOT& Snapshot)
 {
   EFI_STATUS                            Status;
-  UINTN                                 HandleCount = 0;
-  UINTN                                 Index;
-  UINTN                                 OpenInfoIndex;
-  EFI_HANDLE                            *Handles = NULL;
-  EFI_SIMPLE_FILE_SYSTEM_PROTOCOL       *Fs;
+  size_t                                ProtocolIndex;
+  size_t                                OpenIndex;
+  EFI_HANDLE                            Handle;
   EFI_BLOCK_IO_PROTOCOL                 *BlockIo;
-  EFI_OPEN_PROTOCOL_INFORMATION_ENTRY   *OpenInfo;
-  UINTN                                 OpenInfoCount;
   BOOLEAN                               Found;
 
   DBG("Searching for invalid DiskIo BY_DRIVER connects:");
 
   //
-  // Get all DiskIo handles
+  // Check every DiskIo handle
   //
-  Status = gBS->LocateHandleBuffer(ByProtocol, &gEfiDiskIoProtocolGuid, NULL, &HandleCount, &Handles);
-  if (EFI_ERROR(Status) || HandleCount == 0) {
+  ProtocolIndex = Snapshot.FirstWithProtocol(&gEfiDiskIoProtocolGuid);
+  if (ProtocolIndex == HANDLE_SNAPSHOT_NONE) {
     DBG(" no DiskIo handles\n");
     return;
   }
-
-  //
-  // Check every DiskIo handle
-  //
   Found = FALSE;
-  for (Index = 0; Index < HandleCount; Index++) {
-    //DBG("\n");
-    //DBG(" - Handle %p:", Handles[Index]);
+  for ( ; ProtocolIndex != HANDLE_SNAPSHOT_NONE; ProtocolIndex = Snapshot.Protocol(ProtocolIndex).NextSameGuid) {
+    const HANDLE_SNAPSHOT_PROTOCOL& DiskIo = Snapshot.Protocol(ProtocolIndex);
+    Handle = Snapshot.Handle(DiskIo.HandleIndex).Handle;
     //
     // If this is not partition - skip it.
     // This is then whole disk and DiskIo
@@ -1813,7 +2195,7 @@ void DisconnectInvalidDiskIoChildDrivers(void)
     // to produce partition volumes.
     //
     Status = gBS->HandleProtocol (
-                                  Handles[Index],
+                                  Handle,
                                   &gEfiBlockIoProtocolGuid,
                                   (void **) &BlockIo
                                   );
@@ -1831,97 +2213,76 @@ void DisconnectInvalidDiskIoChildDrivers(void)
       continue;
 
     }
-    //DBG(" BlockIo: partition");
 
     //
     // If SimpleFileSystem is already produced - skip it, this is ok
     //
-    Status = gBS->HandleProtocol (
-                                  Handles[Index],
-                                  &gEfiSimpleFileSystemProtocolGuid,
-                                  (void **) &Fs
-                                  );
-    if (Status == EFI_SUCCESS) {
+    if (Snapshot.HasProtocol(DiskIo.HandleIndex, &gEfiSimpleFileSystemProtocolGuid)) {
       //DBG(" FS: ok - skipping\n");
       continue;
     }
-    //DBG(" FS: no");
 
     //
     // If no SimpleFileSystem on this handle but DiskIo is opened BY_DRIVER
     // then disconnect this connection
     //
-    Status = gBS->OpenProtocolInformation (
-                                           Handles[Index],
-                                           &gEfiDiskIoProtocolGuid,
-                                           &OpenInfo,
-                                           &OpenInfoCount
-                                           );
-    if (EFI_ERROR(Status)) {
-      //DBG(" OpenInfo: no - skipping\n");
-      continue;
-    }
-    //DBG(" OpenInfo: %d", OpenInfoCount);
-    for (OpenInfoIndex = 0; OpenInfoIndex < OpenInfoCount; OpenInfoIndex++) {
-      if ((OpenInfo[OpenInfoIndex].Attributes & EFI_OPEN_PROTOCOL_BY_DRIVER) == EFI_OPEN_PROTOCOL_BY_DRIVER) {
+    for (OpenIndex = DiskIo.FirstOpen; OpenIndex < DiskIo.FirstOpen + DiskIo.OpenCount; OpenIndex++) {
+      const HANDLE_SNAPSHOT_OPEN& Open = Snapshot.Open(OpenIndex);
+      if ((Open.Attributes & EFI_OPEN_PROTOCOL_BY_DRIVER) == EFI_OPEN_PROTOCOL_BY_DRIVER) {
         if (!Found) {
           DBG("\n");
         }
         Found = TRUE;
-        Status = gBS->DisconnectController (Handles[Index], OpenInfo[OpenInfoIndex].AgentHandle, NULL);
-        //DBG(" BY_DRIVER Agent: %p, Disconnect: %s", OpenInfo[OpenInfoIndex].AgentHandle, efiStrError(Status));
-        DBG(" - Handle %llx with DiskIo, is Partition, no Fs, BY_DRIVER Agent: %llx, Disconnect: %s\n", (uintptr_t)Handles[Index], (uintptr_t)(OpenInfo[OpenInfoIndex].AgentHandle), efiStrError(Status));
+        Status = gBS->DisconnectController (Handle, Open.AgentHandle, NULL);
+        DBG(" - Handle %llx with DiskIo, is Partition, no Fs, BY_DRIVER Agent: %llx, Disconnect: %s\n", (uintptr_t)Handle, (uintptr_t)(Open.AgentHandle), efiStrError(Status));
       }
     }
-    FreePool(OpenInfo);
   }
-  FreePool(Handles);
 
   if (!Found) {
     DBG(" not found, all ok\n");
   }
 }
 
+//
+// The handles, their protocols and the drivers that opened them come from one snapshot of the handle database,
+// taken before the first disconnect. A handle removed by an earlier disconnect (the partitions of a CD) makes
+// DisconnectController() fail for it, nothing else.
+//
 void DisconnectSomeDevices(void)
 {
   EFI_STATUS              Status;
   UINTN                   HandleCount;
-  UINTN                   Index, Index2;
-  EFI_HANDLE              *Handles ;
-  EFI_HANDLE              *ControllerHandles;
-  UINTN                   ControllerHandleCount;
+  UINTN                   Index;
+  size_t                  ProtocolIndex;
+  size_t                  OpenIndex;
+  HANDLE_SNAPSHOT         Snapshot;
+  XArray<EFI_HANDLE>      FsDrivers;
   EFI_BLOCK_IO_PROTOCOL   *BlockIo  = NULL;
-//  EFI_DISK_IO_PROTOCOL    *DiskIo = NULL;
-  EFI_PCI_IO_PROTOCOL     *PciIo  = NULL;
-//  EFI_FILE_PROTOCOL       *RootFP = NULL;
-//  EFI_SIMPLE_FILE_SYSTEM_PROTOCOL *VolumeFS = NULL;
-  PCI_TYPE00              Pci;
   CHAR16                           *DriverName;
   EFI_COMPONENT_NAME_PROTOCOL      *CompName;
 
+  if (gDriversFlags.PartitionLoaded || gDriversFlags.HFSLoaded || gDriversFlags.APFSLoaded || !gFirmwareClover) {
+    Status = Snapshot.Take();
+    if (EFI_ERROR(Status)) {
+      DBG("Handle snapshot: %s\n", efiStrError(Status));
+    }
+  }
+
   if (gDriversFlags.PartitionLoaded) {
     DBG("Partition driver loaded: ");
-    // get all BlockIo handles
-    HandleCount = 0;
-    Handles = NULL;
-
-    Status = gBS->LocateHandleBuffer(ByProtocol, &gEfiBlockIoProtocolGuid, NULL, &HandleCount, &Handles);
-    if (Status == EFI_SUCCESS) {
-      for (Index = 0; Index < HandleCount; Index++) {
-        Status = gBS->HandleProtocol(Handles[Index], &gEfiBlockIoProtocolGuid, (void **) &BlockIo);
-        if (EFI_ERROR(Status)) {
-          continue;
-        }
-        if (BlockIo->Media->BlockSize == 2048) {
-          // disconnect CD controller
-          Status = gBS->DisconnectController(Handles[Index], NULL, NULL);
-          DBG("CD disconnect %s", efiStrError(Status));
-        }
+    // all BlockIo handles
+    for (ProtocolIndex = Snapshot.FirstWithProtocol(&gEfiBlockIoProtocolGuid); ProtocolIndex != HANDLE_SNAPSHOT_NONE; ProtocolIndex = Snapshot.Protocol(ProtocolIndex).NextSameGuid) {
+      EFI_HANDLE Handle = Snapshot.Handle(Snapshot.Protocol(ProtocolIndex).HandleIndex).Handle;
+      Status = gBS->HandleProtocol(Handle, &gEfiBlockIoProtocolGuid, (void **) &BlockIo);
+      if (EFI_ERROR(Status)) {
+        continue;
+      }
+      if (BlockIo->Media->BlockSize == 2048) {
+        // disconnect CD controller
+        Status = gBS->DisconnectController(Handle, NULL, NULL);
+        DBG("CD disconnect %s", efiStrError(Status));
       }
-/*      for (Index = 0; Index < HandleCount; Index++) {
-        Status = gBS->DisconnectController(Handles[Index], NULL, NULL);
-      } */
-      FreePool(Handles);
     }
     DBG("\n");
   }
@@ -1934,84 +2295,67 @@ void DisconnectSomeDevices(void)
       DBG("APFS driver loaded\n");
     }
 
-    // get all FileSystem handles
-    ControllerHandleCount = 0;
-    ControllerHandles = NULL;
+    // the HFS+ and APFS drivers, by name
+    for (ProtocolIndex = Snapshot.FirstWithProtocol(&gEfiComponentNameProtocolGuid); ProtocolIndex != HANDLE_SNAPSHOT_NONE; ProtocolIndex = Snapshot.Protocol(ProtocolIndex).NextSameGuid) {
+      EFI_HANDLE Handle = Snapshot.Handle(Snapshot.Protocol(ProtocolIndex).HandleIndex).Handle;
+      Status = gBS->OpenProtocol(
+                                 Handle,
+                                 &gEfiComponentNameProtocolGuid,
+                                 (void**)&CompName,
+                                 gImageHandle,
+                                 NULL,
+                                 EFI_OPEN_PROTOCOL_GET_PROTOCOL);
 
-    Status = gBS->LocateHandleBuffer(ByProtocol, &gEfiSimpleFileSystemProtocolGuid, NULL, &ControllerHandleCount, &ControllerHandles);
- /*   if (!EFI_ERROR(Status)) {
-      for (Index2 = 0; Index2 < ControllerHandleCount; Index2++) {
-        Status = gBS->DisconnectController(ControllerHandles[Index2],
-                                           NULL, NULL);
-        DBG("Driver [%d] disconnect %s\n", Index2, efiStrError(Status));
+      if (EFI_ERROR(Status)) {
+//        DBG("CompName %s\n", efiStrError(Status));
+        continue;
       }
-    } */
-
-    HandleCount = 0;
-    Handles = NULL;
-
-    Status = gBS->LocateHandleBuffer(ByProtocol, &gEfiComponentNameProtocolGuid, NULL, &HandleCount, &Handles);
-    if (!EFI_ERROR(Status)) {
-      for (Index = 0; Index < HandleCount; Index++) {
-        Status = gBS->OpenProtocol(
-                                   Handles[Index],
-                                   &gEfiComponentNameProtocolGuid,
-                                   (void**)&CompName,
-                                   gImageHandle,
-                                   NULL,
-                                   EFI_OPEN_PROTOCOL_GET_PROTOCOL);
+      Status = CompName->GetDriverName(CompName, "eng", &DriverName);
+      if (EFI_ERROR(Status)) {
+        continue;
+      }
+      if ((StriStr(DriverName, L"HFS")) || (StriStr(DriverName, L"apfs"))) {
+        FsDrivers.Add(Handle);
+      }
+    }
 
-        if (EFI_ERROR(Status)) {
-//          DBG("CompName %s\n", efiStrError(Status));
-          continue;
-        }
-        Status = CompName->GetDriverName(CompName, "eng", &DriverName);
-        if (EFI_ERROR(Status)) {
-          continue;
-        }
-        if ((StriStr(DriverName, L"HFS")) || (StriStr(DriverName, L"apfs"))) {
-          for (Index2 = 0; Index2 < ControllerHandleCount; Index2++) {
-            Status = gBS->DisconnectController(ControllerHandles[Index2],
-                                               Handles[Index], NULL);
-//            DBG("Disconnect [%ls] from %X: %s\n", DriverName, ControllerHandles[Index2], efiStrError(Status));
-          }
+    // disconnect them from the FileSystem handles they manage, instead of trying every FileSystem handle
+    for (OpenIndex = 0; OpenIndex < Snapshot.OpenCount() && !FsDrivers.isEmpty(); OpenIndex++) {
+      const HANDLE_SNAPSHOT_OPEN& Open = Snapshot.Open(OpenIndex);
+      if ((Open.Attributes & EFI_OPEN_PROTOCOL_BY_DRIVER) != EFI_OPEN_PROTOCOL_BY_DRIVER) {
+        continue;
+      }
+      size_t Controller = Snapshot.FindHandle(Open.ControllerHandle);
+      if (Controller == HANDLE_SNAPSHOT_NONE || !Snapshot.HasProtocol(Controller, &gEfiSimpleFileSystemProtocolGuid)) {
+        continue;
+      }
+      for (size_t Driver = 0; Driver < FsDrivers.size(); Driver++) {
+        if (FsDrivers.ElementAt(Driver) == Open.AgentHandle) {
+          Status = gBS->DisconnectController(Open.ControllerHandle, Open.AgentHandle, NULL);
+//          DBG("Disconnect [%ls] from %X: %s\n", DriverName, Open.ControllerHandle, efiStrError(Status));
+          break;
         }
       }
-      FreePool(Handles);
     }
-//    DBG("\n");
-    FreePool(ControllerHandles);
   }
 
 
   if (gDriversFlags.VideoLoaded) {
     DBG("Video driver loaded: ");
-    // get all PciIo handles
-    HandleCount = 0;
-    Handles = NULL;
-    Status = gBS->LocateHandleBuffer(ByProtocol, &gEfiPciIoProtocolGuid, NULL, &HandleCount, &Handles);
-    if (Status == EFI_SUCCESS) {
-      for (Index = 0; Index < HandleCount; Index++) {
-        Status = gBS->HandleProtocol(Handles[Index], &gEfiPciIoProtocolGuid, (void **) &PciIo);
-        if (EFI_ERROR(Status)) {
-          continue;
-        }
-        Status = PciIo->Pci.Read (PciIo, EfiPciIoWidthUint32, 0, sizeof (Pci) / sizeof (UINT32), &Pci);
-        if (!EFI_ERROR(Status)) {
-          if(IS_PCI_VGA(&Pci) == TRUE) {
-            // disconnect VGA
-            Status = gBS->DisconnectController(Handles[Index], NULL, NULL);
-            DBG("disconnect %s", efiStrError(Status));
-          }
-        }
+    HandleCount = PciSnapshotCount();
+    for (Index = 0; Index < HandleCount; Index++) {
+      const PCI_SNAPSHOT_DEVICE *PciDev = PciSnapshotDevice(Index);
+      if(IS_PCI_VGA(&PciDev->Pci) == TRUE) {
+        // disconnect VGA
+        Status = gBS->DisconnectController(PciDev->Handle, NULL, NULL);
+        DBG("disconnect %s", efiStrError(Status));
       }
-      FreePool(Handles);
     }
     DBG("\n");
   }
 
   if (!gFirmwareClover) {
-    DisconnectInvalidDiskIoChildDrivers();
+    DisconnectInvalidDiskIoChildDrivers(Snapshot);
   }
 }
 
@@ -2031,6 +2375,7 @@ void PatchVideoBios(UINT8 *Edid)
 
 static void LoadDrivers(void)
 {
+  TimelineSpan Span("LoadDrivers");
   EFI_STATUS  Status;
   EFI_HANDLE  *DriversToConnect = NULL;
   UINTN       DriversToConnectNum = 0;
@@ -2109,6 +2454,8 @@ static void LoadDrivers(void)
   }else{
     BdsLibConnectAllEfi(); // jief : without any driver loaded, i couldn't see my CD, unless I call BdsLibConnectAllEfi
   }
+  // the partitions are known now
+  StartDeferredDrivers(DriverStartConnected);
   ReinitRefitLib();
 }
 
@@ -2309,6 +2656,118 @@ void SetVariablesFromNvram()
 //  }
 
 
+// Options, About, Reset and Shutdown, after the entries of the volumes
+static void AddMainMenuFunctionEntries(void)
+{
+  MenuEntryOptions.Image = ThemeX.GetIcon(BUILTIN_ICON_FUNC_OPTIONS);
+//      DBG("Options: IconID=%lld name=%s empty=%s\n", MenuEntryOptions.Image.Id, MenuEntryOptions.Image.Name.c_str(),
+//          MenuEntryOptions.Image.isEmpty()?"пусто":"нет");
+  if (gSettings.DisableCloverHotkeys)
+    MenuEntryOptions.ShortcutLetter = 0x00;
+  MainMenu.AddMenuEntry(&MenuEntryOptions, false);
+  
+  MenuEntryAbout.Image = ThemeX.GetIcon((INTN)BUILTIN_ICON_FUNC_ABOUT);
+//      DBG("About: IconID=%lld name=%s empty=%s\n", MenuEntryAbout.Image.Id, MenuEntryAbout.Image.Name.c_str(),
+//          MenuEntryAbout.Image.isEmpty()?"пусто":"нет");
+  if (gSettings.DisableCloverHotkeys)
+    MenuEntryAbout.ShortcutLetter = 0x00;
+  MainMenu.AddMenuEntry(&MenuEntryAbout, false);
+
+  if (!(ThemeX.HideUIFlags & HIDEUI_FLAG_FUNCS) || MainMenu.Entries.size() == 0) {
+    if (gSettings.DisableCloverHotkeys)
+      MenuEntryReset.ShortcutLetter = 0x00;
+    MenuEntryReset.Image = ThemeX.GetIcon(BUILTIN_ICON_FUNC_RESET);
+    MainMenu.AddMenuEntry(&MenuEntryReset, false);
+    if (gSettings.DisableCloverHotkeys)
+      MenuEntryShutdown.ShortcutLetter = 0x00;
+    MenuEntryShutdown.Image = ThemeX.GetIcon(BUILTIN_ICON_FUNC_EXIT);
+    MainMenu.AddMenuEntry(&MenuEntryShutdown, false);
+  }
+}
+
+static void MarkVolumesScanned(void)
+{
+  for (size_t VolumeIndex = 0; VolumeIndex < Volumes.size(); VolumeIndex++) {
+    Volumes[VolumeIndex].MenuScanned = TRUE;
+  }
+  if (SelfVolume != NULL) {
+    SelfVolume->MenuScanned = TRUE;
+  }
+}
+
+// Boot/IncrementalRescan : a menu refresh rescans only the volumes that changed and replaces their entries.
+// FALSE if the refresh must be a full one.
+static BOOLEAN RefreshChangedVolumes(void)
+{
+  XObjArray<REFIT_VOLUME> Removed;
+
+  if (!GlobalConfig.IncrementalRescan || GlobalConfig.FastBoot || gThemeChanged || gBootChanged) {
+    return FALSE;
+  }
+  DBG("Refresh changed volumes\n");
+  if (!gFirmwareClover) {
+    BdsLibConnectAllEfi();
+  } else {
+    BdsLibConnectAllDriversToAllControllers();
+  }
+  gEvent = 0; // the file systems connected now are found by RescanVolumes()
+  if (!RescanVolumes(Removed)) {
+    return TRUE;
+  }
+
+  // entries of removed volumes, and the function entries that are added again after the new ones
+  for (size_t Index = MainMenu.Entries.sizeIncludingHidden(); Index-- > 0; ) {
+    REFIT_ABSTRACT_MENU_ENTRY& Entry = MainMenu.Entries.ElementAt(Index);
+    BOOLEAN Remove = &Entry == &MenuEntryOptions || &Entry == &MenuEntryAbout || &Entry == &MenuEntryReset || &Entry == &MenuEntryShutdown;
+    REFIT_VOLUME* Volume = NULL;
+    if (Entry.getREFIT_MENU_ITEM_BOOTNUM()) {
+      Volume = Entry.getREFIT_MENU_ITEM_BOOTNUM()->Volume;
+    } else if (Entry.getREFIT_MENU_ENTRY_CLOVER()) {
+      Volume = Entry.getREFIT_MENU_ENTRY_CLOVER()->Volume;
+    }
+    for (size_t RemovedIndex = 0; !Remove && RemovedIndex < Removed.size(); RemovedIndex++) {
+      const REFIT_VOLUME& RemovedVolume = Removed[RemovedIndex];
+      Remove = Volume == &RemovedVolume;
+      // tools only have their device path : the volume path followed by the file path
+      if (!Remove && Entry.getREFIT_MENU_ENTRY_LOADER_TOOL() && Entry.getREFIT_MENU_ENTRY_LOADER_TOOL()->DevicePath != NULL && RemovedVolume.DevicePath != NULL) {
+        UINTN VolumePathSize = GetDevicePathSize(RemovedVolume.DevicePath) - END_DEVICE_PATH_LENGTH;
+        Remove = VolumePathSize <= GetDevicePathSize(Entry.getREFIT_MENU_ENTRY_LOADER_TOOL()->DevicePath) &&
+                 CompareMem(RemovedVolume.DevicePath, Entry.getREFIT_MENU_ENTRY_LOADER_TOOL()->DevicePath, VolumePathSize) == 0;
+      }
+    }
+    if (Remove) {
+      MainMenu.Entries.RemoveAtIndex(Index);
+    }
+  }
+
+  // the scans skip the volumes with MenuScanned
+  if (GlobalConfig.LegacyFirst) {
+    AddCustomLegacy();
+    if (!GlobalConfig.NoLegacy) {
+      ScanLegacy();
+    }
+  }
+  AddCustomEntries();
+  if (!gSettings.DisableEntryScan) {
+    ScanLoader();
+  }
+  if (!GlobalConfig.LegacyFirst) {
+    AddCustomLegacy();
+    if (!GlobalConfig.NoLegacy) {
+      ScanLegacy();
+    }
+  }
+  if (!(ThemeX.HideUIFlags & HIDEUI_FLAG_TOOLS)) {
+    AddCustomTool();
+    if (!gSettings.DisableToolScan) {
+      ScanTool();
+    }
+  }
+  AddMainMenuFunctionEntries();
+  MarkVolumesScanned();
+  return TRUE;
+}
+
 //
 // main entry point
 //
@@ -2746,6 +3205,10 @@ RefitMain (IN EFI_HANDLE           ImageHandle,
       }
     }
   }
+  TagDict::printLookupStats();
+  if (GlobalConfig.FatDelayedFlush) {
+    SetFatDelayedFlush(TRUE);
+  }
   
 
   if (gSettings.QEMU) {
@@ -2812,10 +3275,14 @@ RefitMain (IN EFI_HANDLE           ImageHandle,
   gGuiIsReady = TRUE;
   gBootChanged = TRUE;
   gThemeChanged = TRUE;
+#ifdef JIEF_DEBUG
+  acpi_replay(&selfOem.getConfigDir()); // does nothing without ACPI\replay
+#endif
   do {
     if (gBootChanged && gThemeChanged) { // config changed
-      GetListOfDsdts(); //only after GetUserSettings
-      GetListOfACPI(); //ssdt and other tables
+      XStringWArray PatchedAml = GetListOfPatchedAml(); // one listing of ACPI\patched for both
+      GetListOfDsdts(PatchedAml); //only after GetUserSettings
+      GetListOfACPI(PatchedAml); //ssdt and other tables
     }
     gBootChanged = FALSE;
     MainMenu.Entries.setEmpty();
@@ -2862,9 +3329,8 @@ RefitMain (IN EFI_HANDLE           ImageHandle,
       //now it is a time to set RtVariables
       SetVariablesFromNvram();
       
-    XString8Array TmpArgs = Split<XString8Array>(gSettings.BootArgs, " ");
       DBG("after NVRAM boot-args=%s\n", gSettings.BootArgs.c_str());
-      gSettings.OptionsBits = EncodeOptions(TmpArgs);
+      gSettings.OptionsBits = EncodeOptions(gSettings.BootArgs);
 //      DBG("initial OptionsBits %X\n", gSettings.OptionsBits);
       FillInputs(TRUE);
 
@@ -2906,30 +3372,7 @@ RefitMain (IN EFI_HANDLE           ImageHandle,
         }
       }
 
-      MenuEntryOptions.Image = ThemeX.GetIcon(BUILTIN_ICON_FUNC_OPTIONS);
-//      DBG("Options: IconID=%lld name=%s empty=%s\n", MenuEntryOptions.Image.Id, MenuEntryOptions.Image.Name.c_str(),
-//          MenuEntryOptions.Image.isEmpty()?"пусто":"нет");
-      if (gSettings.DisableCloverHotkeys)
-        MenuEntryOptions.ShortcutLetter = 0x00;
-      MainMenu.AddMenuEntry(&MenuEntryOptions, false);
-      
-      MenuEntryAbout.Image = ThemeX.GetIcon((INTN)BUILTIN_ICON_FUNC_ABOUT);
-//      DBG("About: IconID=%lld name=%s empty=%s\n", MenuEntryAbout.Image.Id, MenuEntryAbout.Image.Name.c_str(),
-//          MenuEntryAbout.Image.isEmpty()?"пусто":"нет");
-      if (gSettings.DisableCloverHotkeys)
-        MenuEntryAbout.ShortcutLetter = 0x00;
-      MainMenu.AddMenuEntry(&MenuEntryAbout, false);
-
-      if (!(ThemeX.HideUIFlags & HIDEUI_FLAG_FUNCS) || MainMenu.Entries.size() == 0) {
-        if (gSettings.DisableCloverHotkeys)
-          MenuEntryReset.ShortcutLetter = 0x00;
-        MenuEntryReset.Image = ThemeX.GetIcon(BUILTIN_ICON_FUNC_RESET);
-        MainMenu.AddMenuEntry(&MenuEntryReset, false);
-        if (gSettings.DisableCloverHotkeys)
-          MenuEntryShutdown.ShortcutLetter = 0x00;
-        MenuEntryShutdown.Image = ThemeX.GetIcon(BUILTIN_ICON_FUNC_EXIT);
-        MainMenu.AddMenuEntry(&MenuEntryShutdown, false);
-      }
+      AddMainMenuFunctionEntries();
 
 // font already changed and this message very quirky, clear line here
 //     if (!GlobalConfig.NoEarlyProgress && !GlobalConfig.FastBoot && GlobalConfig.Timeout>0) {
@@ -2938,6 +3381,7 @@ RefitMain (IN EFI_HANDLE           ImageHandle,
 //        DrawTextXY(Message, (UGAWidth >> 1), (UGAHeight >> 1) + 20, X_IS_CENTER);
 //      }
     }
+    MarkVolumesScanned();
     // wait for user ACK when there were errors
     FinishTextScreen(FALSE);
 #if CHECK_SMC
@@ -2973,6 +3417,8 @@ RefitMain (IN EFI_HANDLE           ImageHandle,
 //    DBG("MainAnime=%d\n", MainAnime);
     AfterTool = FALSE;
     gEvent = 0; //clear to cancel loop
+    StartDeferredDrivers(DriverStartMenu);
+    BdsLibStartDeferredConnect(); // new file systems set gEvent, the menu is then refreshed
     while (MainLoopRunning) {
  //     CHAR8 *LastChosenOS = NULL;
       if (GlobalConfig.Timeout == 0 && DefaultEntry != NULL && !ReadAllKeyStrokes()) {
@@ -3038,6 +3484,11 @@ RefitMain (IN EFI_HANDLE           ImageHandle,
 
       // We don't allow exiting the main menu with the Escape key.
       if (MenuExit == MENU_EXIT_ESCAPE){
+        if (RefreshChangedVolumes()) {
+          DefaultIndex = FindDefaultEntry();
+          DefaultEntry = (DefaultIndex >= 0 && DefaultIndex < (INTN)MainMenu.Entries.size()) ? &MainMenu.Entries[DefaultIndex] : NULL;
+          continue;
+        }
         break;   //refresh main menu
         //           continue;
       }
@@ -3060,6 +3511,7 @@ RefitMain (IN EFI_HANDLE           ImageHandle,
 
 //          }
         }
+        CommitFatVolumes();
         // Attempt warm reboot
         gRT->ResetSystem(EfiResetWarm, EFI_SUCCESS, 0, NULL);
         // Warm reboot may not be supported attempt cold reboot
@@ -3072,6 +3524,8 @@ RefitMain (IN EFI_HANDLE           ImageHandle,
       }
 
       if ( ChosenEntry->getREFIT_MENU_ITEM_SHUTDOWN() ) { // It is not Shut Down, it is Exit from Clover
+        CommitFatVolumes();
+        egRestoreFramebufferCaching();
         TerminateScreen();
         //         gRT->ResetSystem(EfiResetShutdown, EFI_SUCCESS, 0, NULL);
         MainLoopRunning = FALSE;   // just in case we get this far
@@ -123,6 +123,8 @@ REFIT_MENU_SCREEN AboutMenu(2, L"About"_XSW, L""_XSW);
 REFIT_MENU_SCREEN HelpMenu(3, L"Help"_XSW, L""_XSW);
 REFIT_MENU_SCREEN OptionMenu(4, L"Options"_XSW, L""_XSW);
 
+#define INPUT_ITEMS_COUNT 130
+
 
 void FillInputs(BOOLEAN New)
 {
@@ -135,7 +137,7 @@ void FillInputs(BOOLEAN New)
   UINTN InputItemsCount = 0;
   if (New) {
 //    InputItems = (__typeof__(InputItems))A_llocateZeroPool(130 * sizeof(INPUT_ITEM)); //XXX
-    InputItems = new INPUT_ITEM[130];
+    InputItems = new INPUT_ITEM[INPUT_ITEMS_COUNT];
   }
 
   InputItems[InputItemsCount].ItemType = ASString;  //0
@@ -475,6 +477,14 @@ void ApplyInputs(void)
   CHAR8  AString[256];
 
 //  DBG("ApplyInputs\n");
+  // Valid is set on the item just edited, nothing to apply when the menus are only left
+  for (j = 0; j < INPUT_ITEMS_COUNT && !InputItems[j].Valid; j++) {}
+  if (j == INPUT_ITEMS_COUNT) {
+    return;
+  }
+  // the options changed here are not in the keys of the DSDT and PM SSDT caches
+  GlobalConfig.DsdtCache = FALSE;
+  GlobalConfig.PmSsdtCache = FALSE;
   if (InputItems[i].Valid) {
 	  gSettings.BootArgs = InputItems[i].SValue;
 	  gSettings.BootArgs.replaceAll('\\', '_');
@@ -490,14 +500,17 @@ void ApplyInputs(void)
   }
   i++; //3
   if (InputItems[i].Valid) {
+    XStringW OldTheme = GlobalConfig.Theme;
     if (OldChosenTheme == 0xFFFF) {
       GlobalConfig.Theme = L"embedded"_XSW;
     } else {
       GlobalConfig.Theme.takeValueFrom(ThemeNameArray[OldChosenTheme]);
     }
 
-    //will change theme after ESC
-    gThemeChanged = TRUE;
+    //will change theme after ESC, InitTheme() is long so not for the same theme
+    if (!GlobalConfig.Theme.equal(OldTheme)) {
+      gThemeChanged = TRUE;
+    }
   }
   i++; //4
   if (InputItems[i].Valid) {
@@ -2541,6 +2554,31 @@ REFIT_ABSTRACT_MENU_ENTRY* SubMenuQuirks()
 }
 
 
+// The entry is in the Options menu at once, Build makes its submenu when it is first entered
+static REFIT_ABSTRACT_MENU_ENTRY* LazySubMenu(const XString8& Title, REFIT_ABSTRACT_MENU_ENTRY* (*Build)(void))
+{
+  REFIT_MENU_ITEM_OPTIONS* Entry = new REFIT_MENU_ITEM_OPTIONS();
+  Entry->Title = Title;
+  Entry->Image = OptionMenu.TitleImage;
+  Entry->AtClick = ActionEnter;
+  Entry->BuildSubMenu = Build;
+  return Entry;
+}
+
+static void BuildLazySubMenu(REFIT_ABSTRACT_MENU_ENTRY* Entry)
+{
+  REFIT_MENU_ITEM_OPTIONS* Options = Entry->getREFIT_MENU_ITEM_OPTIONS();
+  if (Options == NULL || Options->SubScreen != NULL || Options->BuildSubMenu == NULL) {
+    return;
+  }
+  // the submenu moves to the entry already in the menu
+  REFIT_ABSTRACT_MENU_ENTRY* Built = Options->BuildSubMenu();
+  Options->SubScreen = Built->SubScreen;
+  Options->Title = Built->Title;
+  Built->SubScreen = NULL;
+  delete Built;
+}
+
 void  OptionsMenu(OUT REFIT_ABSTRACT_MENU_ENTRY **ChosenEntry)
 {
   REFIT_ABSTRACT_MENU_ENTRY    *TmpChosenEntry = NULL;
@@ -2582,21 +2620,23 @@ void  OptionsMenu(OUT REFIT_ABSTRACT_MENU_ENTRY **ChosenEntry)
 
 //    AddMenuItemInput(&OptionMenu, 90, "Config:", TRUE);
 //   InputBootArgs->ShortcutDigit = 0xF1;
-    OptionMenu.AddMenuEntry( SubMenuConfigs(), true);
+    // the submenus are made when entered, the titles must be the ones the SubMenu functions give.
+    // Quirks shows the mask in its title, it is made now
+    OptionMenu.AddMenuEntry( LazySubMenu("Configs->"_XS8, SubMenuConfigs), true);
 
     if (AllowGraphicsMode) {
-      OptionMenu.AddMenuEntry( SubMenuGUI(), true);
+      OptionMenu.AddMenuEntry( LazySubMenu("GUI tuning->"_XS8, SubMenuGUI), true);
     }
-    OptionMenu.AddMenuEntry( SubMenuACPI(), true);
-    OptionMenu.AddMenuEntry( SubMenuSmbios(), true);
-    OptionMenu.AddMenuEntry( SubMenuBinaries(), true);
+    OptionMenu.AddMenuEntry( LazySubMenu("ACPI patching->"_XS8, SubMenuACPI), true);
+    OptionMenu.AddMenuEntry( LazySubMenu("SMBIOS->"_XS8, SubMenuSmbios), true);
+    OptionMenu.AddMenuEntry( LazySubMenu("Binaries patching->"_XS8, SubMenuBinaries), true);
     OptionMenu.AddMenuEntry( SubMenuQuirks(), true);
-    OptionMenu.AddMenuEntry( SubMenuGraphics(), true);
-    OptionMenu.AddMenuEntry( SubMenuPCI(), true);
-    OptionMenu.AddMenuEntry( SubMenuSpeedStep(), true);
-    OptionMenu.AddMenuEntry( SubMenuAudio(), true);
-    OptionMenu.AddMenuEntry( SubMenuAudioPort(), true);
-    OptionMenu.AddMenuEntry( SubMenuSystem(), true);
+    OptionMenu.AddMenuEntry( LazySubMenu("Graphics Injector->"_XS8, SubMenuGraphics), true);
+    OptionMenu.AddMenuEntry( LazySubMenu("PCI devices->"_XS8, SubMenuPCI), true);
+    OptionMenu.AddMenuEntry( LazySubMenu("CPU tuning->"_XS8, SubMenuSpeedStep), true);
+    OptionMenu.AddMenuEntry( LazySubMenu("Audio tuning->"_XS8, SubMenuAudio), true);
+    OptionMenu.AddMenuEntry( LazySubMenu("Startup sound output->"_XS8, SubMenuAudioPort), true);
+    OptionMenu.AddMenuEntry( LazySubMenu("System Parameters->"_XS8, SubMenuSystem), true);
     OptionMenu.AddMenuEntry( &MenuEntryReturn, false);
     //DBG("option menu created entries=%d\n", OptionMenu.Entries.size());
   }
@@ -2607,6 +2647,7 @@ void  OptionsMenu(OUT REFIT_ABSTRACT_MENU_ENTRY **ChosenEntry)
       break;
     if (MenuExit == MENU_EXIT_ENTER || MenuExit == MENU_EXIT_DETAILS) {
       //enter input dialog or subscreen
+      BuildLazySubMenu(*ChosenEntry);
       if ((*ChosenEntry)->SubScreen != NULL) {
         SubMenuExit = 0;
         while (!SubMenuExit) {
@@ -402,9 +402,8 @@ void REFIT_MENU_SCREEN::InitAnime()
 //  DBG("Path=%ls\n", FilmC->Path.wc_str());
 //  DBG("LastFrame=%lld\n\n", FilmC->LastFrameID());
 
-  XImage FirstFrame = FilmC->GetImage(FilmC->LastFrameID()); //can not be absent
-  INTN CWidth = FirstFrame.GetWidth();
-  INTN CHeight = FirstFrame.GetHeight();
+  INTN CWidth = FilmC->GetFrameWidth();
+  INTN CHeight = FilmC->GetFrameHeight();
   if ((FilmC->FilmX >=0) && (FilmC->FilmX <=100) &&
       (FilmC->FilmY >=0) && (FilmC->FilmY <=100)) { //default is 0xFFFF
     // Check if screen size being used is different from theme origination size.